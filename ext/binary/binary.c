@@ -527,3 +527,230 @@ void Scm_PutBinaryF64(ScmUVector *uv, int off, ScmObj val, ScmSymbol *e)
     SWAP_D(e, v);
     inject(uv, v.buf, off, 8);
 }
+
+/*===========================================================
+ * Struct codecs
+ *
+ *   A codec is a sequence of (code, count) pairs packed in a u32vector,
+ *   prepared by make-binary-codec in io.scm.  Decoding and encoding
+ *   a whole record is done in one call, resolving the endianness
+ *   only once.
+ */
+
+static const int codec_eltsize[] = {
+    1, 1, 2, 2, 4, 4, 8, 8, 2, 4, 8
+};
+
+static ScmObj codec_decode_elt(int code, const unsigned char *p,
+                               ScmSymbol *e)
+{
+    switch (code) {
+    case CODEC_U8: return SCM_MAKE_INT(p[0]);
+    case CODEC_S8: return SCM_MAKE_INT((signed char)p[0]);
+    case CODEC_U16: {
+        swap_u16_t v; memcpy(v.buf, p, 2); SWAP_16(e, v);
+        return SCM_MAKE_INT(v.val);
+    }
+    case CODEC_S16: {
+        swap_s16_t v; memcpy(v.buf, p, 2); SWAP_16(e, v);
+        return SCM_MAKE_INT(v.val);
+    }
+    case CODEC_U32: {
+        swap_u32_t v; memcpy(v.buf, p, 4); SWAP_32(e, v);
+        return Scm_MakeIntegerFromUI(v.val);
+    }
+    case CODEC_S32: {
+        swap_s32_t v; memcpy(v.buf, p, 4); SWAP_32(e, v);
+        return Scm_MakeInteger(v.val);
+    }
+    case CODEC_U64: {
+        swap_u64_t v; memcpy(v.buf, p, 8); SWAP_64(e, v);
+        return Scm_MakeIntegerU64(v.val);
+    }
+    case CODEC_S64: {
+        swap_s64_t v; memcpy(v.buf, p, 8); SWAP_64(e, v);
+        return Scm_MakeInteger64(v.val);
+    }
+    case CODEC_F16: {
+        swap_f16_t v; memcpy(v.buf, p, 2); SWAP_16(e, v);
+        return Scm_MakeFlonum(Scm_HalfToDouble(v.val));
+    }
+    case CODEC_F32: {
+        swap_f32_t v; memcpy(v.buf, p, 4); SWAP_32(e, v);
+        return Scm_MakeFlonum((double)v.val);
+    }
+    case CODEC_F64: {
+        swap_f64_t v; memcpy(v.buf, p, 8); SWAP_D(e, v);
+        return Scm_MakeFlonum(v.val);
+    }
+    default:
+        Scm_Error("[internal] bad codec element: %d", code);
+        return SCM_UNDEFINED;   /* dummy */
+    }
+}
+
+static void codec_encode_elt(int code, unsigned char *p, ScmObj val,
+                             ScmSymbol *e)
+{
+    switch (code) {
+    case CODEC_U8:
+        p[0] = (u_char)Scm_GetIntegerU8Clamp(val, SCM_CLAMP_NONE, NULL);
+        break;
+    case CODEC_S8:
+        p[0] = (u_char)Scm_GetInteger8Clamp(val, SCM_CLAMP_NONE, NULL);
+        break;
+    case CODEC_U16: {
+        swap_u16_t v;
+        v.val = Scm_GetIntegerU16Clamp(val, SCM_CLAMP_NONE, NULL);
+        SWAP_16(e, v); memcpy(p, v.buf, 2);
+        break;
+    }
+    case CODEC_S16: {
+        swap_s16_t v;
+        v.val = Scm_GetInteger16Clamp(val, SCM_CLAMP_NONE, NULL);
+        SWAP_16(e, v); memcpy(p, v.buf, 2);
+        break;
+    }
+    case CODEC_U32: {
+        swap_u32_t v;
+        v.val = Scm_GetIntegerU32Clamp(val, FALSE, FALSE);
+        SWAP_32(e, v); memcpy(p, v.buf, 4);
+        break;
+    }
+    case CODEC_S32: {
+        swap_s32_t v;
+        v.val = Scm_GetInteger32Clamp(val, FALSE, FALSE);
+        SWAP_32(e, v); memcpy(p, v.buf, 4);
+        break;
+    }
+    case CODEC_U64: {
+        swap_u64_t v;
+        v.val = Scm_GetIntegerU64Clamp(val, FALSE, FALSE);
+        SWAP_64(e, v); memcpy(p, v.buf, 8);
+        break;
+    }
+    case CODEC_S64: {
+        swap_s64_t v;
+        v.val = Scm_GetInteger64Clamp(val, FALSE, FALSE);
+        SWAP_64(e, v); memcpy(p, v.buf, 8);
+        break;
+    }
+    case CODEC_F16: {
+        swap_f16_t v;
+        v.val = Scm_DoubleToHalf(Scm_GetDouble(val));
+        SWAP_16(e, v); memcpy(p, v.buf, 2);
+        break;
+    }
+    case CODEC_F32: {
+        swap_f32_t v;
+        v.val = (float)Scm_GetDouble(val);
+        SWAP_32(e, v); memcpy(p, v.buf, 4);
+        break;
+    }
+    case CODEC_F64: {
+        swap_f64_t v;
+        v.val = Scm_GetDouble(val);
+        SWAP_D(e, v); memcpy(p, v.buf, 8);
+        break;
+    }
+    default:
+        Scm_Error("[internal] bad codec element: %d", code);
+    }
+}
+
+static ScmObj codec_decode(ScmUVector *ops, const unsigned char *p,
+                           int nvals, ScmSymbol *e)
+{
+    const ScmUInt32 *op = SCM_U32VECTOR_ELEMENTS(ops);
+    int nops = SCM_U32VECTOR_SIZE(ops);
+    ScmObj r = Scm_MakeVector(nvals, SCM_FALSE);
+    int k = 0;
+
+    for (int i=0; i+1<nops; i+=2) {
+        int code = (int)op[i];
+        ScmUInt32 cnt = op[i+1];
+        if (code == CODEC_PAD) { p += cnt; continue; }
+        int sz = codec_eltsize[code];
+        for (ScmUInt32 j=0; j<cnt; j++, p+=sz) {
+            SCM_ASSERT(k < nvals);
+            SCM_VECTOR_ELEMENT(r, k++) = codec_decode_elt(code, p, e);
+        }
+    }
+    return r;
+}
+
+static void codec_encode(ScmUVector *ops, unsigned char *p,
+                         ScmObj vals, ScmSymbol *e)
+{
+    const ScmUInt32 *op = SCM_U32VECTOR_ELEMENTS(ops);
+    int nops = SCM_U32VECTOR_SIZE(ops);
+    int k = 0;
+
+    for (int i=0; i+1<nops; i+=2) {
+        int code = (int)op[i];
+        ScmUInt32 cnt = op[i+1];
+        if (code == CODEC_PAD) {
+            memset(p, 0, cnt);
+            p += cnt;
+            continue;
+        }
+        int sz = codec_eltsize[code];
+        for (ScmUInt32 j=0; j<cnt; j++, p+=sz) {
+            codec_encode_elt(code, p, SCM_VECTOR_ELEMENT(vals, k++), e);
+        }
+    }
+}
+
+/* SRC is either a uvector or an input port.  Returns a vector of
+   NVALS decoded values, or EOF if the port doesn't have SIZE bytes. */
+ScmObj Scm_BinaryCodecDecode(ScmUVector *ops, ScmObj src, int off,
+                             int nvals, int size, ScmSymbol *endian)
+{
+    CHECK_ENDIAN(endian);
+    if (SCM_UVECTORP(src)) {
+        int srcsize = Scm_UVectorSizeInBytes(SCM_UVECTOR(src));
+        if (off < 0 || off+size > srcsize) {
+            Scm_Error("offset %d is out of bound of the uvector.", off);
+        }
+        return codec_decode(ops,
+                            (unsigned char*)SCM_UVECTOR_ELEMENTS(src) + off,
+                            nvals, endian);
+    } else if (SCM_IPORTP(src)) {
+        unsigned char sbuf[256];
+        unsigned char *buf = (size <= (int)sizeof(sbuf))
+            ? sbuf : SCM_NEW_ATOMIC2(unsigned char*, size);
+        if (getbytes((char*)buf, size, SCM_PORT(src)) == EOF) return SCM_EOF;
+        return codec_decode(ops, buf, nvals, endian);
+    } else {
+        Scm_TypeError("source", "uniform vector or input port", src);
+        return SCM_UNDEFINED;   /* dummy */
+    }
+}
+
+/* DEST is either a uvector or an output port.  VALS must be a vector
+   of NVALS elements. */
+void Scm_BinaryCodecEncode(ScmUVector *ops, ScmObj vals, ScmObj dest, int off,
+                           int nvals, int size, ScmSymbol *endian)
+{
+    CHECK_ENDIAN(endian);
+    if (!SCM_VECTORP(vals) || SCM_VECTOR_SIZE(vals) != nvals) {
+        Scm_Error("vector of %d elements required, but got: %S", nvals, vals);
+    }
+    if (SCM_UVECTORP(dest)) {
+        int destsize = Scm_UVectorSizeInBytes(SCM_UVECTOR(dest));
+        SCM_UVECTOR_CHECK_MUTABLE(dest);
+        if (off < 0 || off+size > destsize) {
+            Scm_Error("offset %d is out of bound of the uvector.", off);
+        }
+        codec_encode(ops, (unsigned char*)SCM_UVECTOR_ELEMENTS(dest) + off,
+                     vals, endian);
+    } else if (SCM_OPORTP(dest)) {
+        unsigned char sbuf[256];
+        unsigned char *buf = (size <= (int)sizeof(sbuf))
+            ? sbuf : SCM_NEW_ATOMIC2(unsigned char*, size);
+        codec_encode(ops, buf, vals, endian);
+        Scm_Putz((char*)buf, size, SCM_PORT(dest));
+    } else {
+        Scm_TypeError("destination", "uniform vector or output port", dest);
+    }
+}
@@ -81,3 +81,15 @@ extern void Scm_PutBinaryS64(ScmUVector *uv, int off, ScmObj v, ScmSymbol *e);
 extern void Scm_PutBinaryF16(ScmUVector *uv, int off, ScmObj v, ScmSymbol *e);
 extern void Scm_PutBinaryF32(ScmUVector *uv, int off, ScmObj v, ScmSymbol *e);
 extern void Scm_PutBinaryF64(ScmUVector *uv, int off, ScmObj v, ScmSymbol *e);
+
+/* Struct codecs.  The codes must match the ones in io.scm. */
+enum {
+    CODEC_U8, CODEC_S8, CODEC_U16, CODEC_S16, CODEC_U32, CODEC_S32,
+    CODEC_U64, CODEC_S64, CODEC_F16, CODEC_F32, CODEC_F64,
+    CODEC_PAD
+};
+
+extern ScmObj Scm_BinaryCodecDecode(ScmUVector *ops, ScmObj src, int off,
+                                    int nvals, int size, ScmSymbol *e);
+extern void Scm_BinaryCodecEncode(ScmUVector *ops, ScmObj vals, ScmObj dest,
+                                  int off, int nvals, int size, ScmSymbol *e);
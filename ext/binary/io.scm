@@ -17,6 +17,7 @@
 ;; renamed them for shorter names, and added uvector access routines.
 
 (define-module binary.io
+  (use gauche.uvector)
   (export read-uint read-u8 read-u16 read-u32 read-u64
           read-sint read-s8 read-s16 read-s32 read-s64
           read-ber-integer read-f16 read-f32 read-f64
@@ -34,6 +35,11 @@
           put-s16be! put-s16le! put-s32be! put-s32le! put-s64be! put-s64le!
           put-f16be! put-f16le! put-f32be! put-f32le! put-f64be! put-f64le!
 
+          make-binary-codec binary-codec? binary-codec-size
+          binary-codec-num-values
+          binary-codec-decode binary-codec-decode-array
+          binary-codec-encode
+
           ;; old names
           read-binary-uint
           read-binary-uint8 read-binary-uint16
@@ -517,3 +523,90 @@
                 (SCM_MAKE_INT (alignof int64_align)))
      NULL)))
  )
+
+;;;
+;;; Struct codecs
+;;;
+
+;; A codec describes the layout of a fixed-size binary record.  The spec
+;; is a list of field descriptors, each of which is either a type
+;; name (u8, s8, u16, s16, u32, s32, u64, s64, f16, f32 or f64),
+;; (TYPE COUNT) for COUNT consecutive values, or (pad COUNT) to skip
+;; COUNT bytes.  The spec is compiled into a u32vector of (code, count)
+;; pairs, which is interpreted by C routines to decode/encode a whole
+;; record at once.
+
+(define-class <binary-codec> ()
+  ((ops     :init-keyword :ops)          ; u32vector
+   (size    :init-keyword :size)         ; record size in bytes
+   (nvals   :init-keyword :nvals)        ; # of values in a record
+   (endian  :init-keyword :endian)))     ; symbol or #f (default-endian)
+
+(define *codec-types*
+  ;; name code size; code must match CODEC_* enum in binary.h
+  '((u8 0 1) (s8 1 1) (u16 2 2) (s16 3 2) (u32 4 4) (s32 5 4)
+    (u64 6 8) (s64 7 8) (f16 8 2) (f32 9 4) (f64 10 8)))
+(define-constant *codec-pad* 11)
+
+(define (make-binary-codec spec :optional (endian #f))
+  (define (bad-field f) (error "invalid binary codec field:" f))
+  (define (field-type&count f)
+    (cond [(symbol? f) (values f 1)]
+          [(and (list? f) (= (length f) 2)
+                (symbol? (car f))
+                (exact-integer? (cadr f)) (>= (cadr f) 0))
+           (values (car f) (cadr f))]
+          [else (bad-field f)]))
+  (let loop ([spec spec] [ops '()] [size 0] [nvals 0])
+    (if (null? spec)
+      (make <binary-codec>
+        :ops (list->u32vector (reverse ops))
+        :size size :nvals nvals :endian endian)
+      (receive (type n) (field-type&count (car spec))
+        (if (eq? type 'pad)
+          (loop (cdr spec) `(,n ,*codec-pad* ,@ops) (+ size n) nvals)
+          (if-let1 t (assq type *codec-types*)
+            (loop (cdr spec) `(,n ,(cadr t) ,@ops)
+                  (+ size (* (caddr t) n)) (+ nvals n))
+            (bad-field (car spec))))))))
+
+(define (binary-codec? obj) (is-a? obj <binary-codec>))
+(define (binary-codec-size codec) (~ codec'size))
+(define (binary-codec-num-values codec) (~ codec'nvals))
+
+(define (binary-codec-decode codec source :optional (offset 0))
+  (%codec-decode (~ codec'ops) source offset
+                 (~ codec'nvals) (~ codec'size) (~ codec'endian)))
+
+;; Decodes COUNT consecutive records.  If SOURCE is a port and it reaches
+;; EOF before COUNT records, the records read so far are returned.
+(define (binary-codec-decode-array codec source count :optional (offset 0))
+  (let ([ops (~ codec'ops)] [size (~ codec'size)]
+        [nvals (~ codec'nvals)] [endian (~ codec'endian)])
+    (let loop ([i 0] [off offset] [r '()])
+      (if (= i count)
+        (list->vector (reverse r))
+        (let1 rec (%codec-decode ops source off nvals size endian)
+          (if (eof-object? rec)
+            (list->vector (reverse r))
+            (loop (+ i 1) (if (port? source) off (+ off size))
+                  (cons rec r))))))))
+
+;; VALUES can be a vector or a list.  If DEST is omitted, a fresh
+;; u8vector is created and returned.
+(define (binary-codec-encode codec values :optional (dest #f) (offset 0))
+  (let ([vals (if (list? values) (list->vector values) values)]
+        [dest (or dest (make-u8vector (~ codec'size)))])
+    (%codec-encode (~ codec'ops) vals dest offset
+                   (~ codec'nvals) (~ codec'size) (~ codec'endian))
+    dest))
+
+(inline-stub
+ (define-cproc %codec-decode (ops::<u32vector> source off::<int>
+                              nvals::<int> size::<int> endian::<symbol>?)
+   Scm_BinaryCodecDecode)
+ (define-cproc %codec-encode (ops::<u32vector> vals dest off::<int>
+                              nvals::<int> size::<int> endian::<symbol>?)
+   ::<void>
+   Scm_BinaryCodecEncode)
+ )
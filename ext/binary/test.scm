@@ -534,6 +534,51 @@
          (put-f64! v 9 -1.0 'arm-little-endian)
          v))
 
+;; struct codecs
+(let ([c (make-binary-codec '(u8 (pad 1) s16 (u32 2) f64) 'big-endian)]
+      [c-le (make-binary-codec '(u8 (pad 1) s16 (u32 2) f64) 'little-endian)]
+      [data '#u8(#x01 #x00 #xff #xfe #x00 #x00 #x00 #x02 #x80 #x00 #x00 #x00
+                 #x3f #xf0 #x00 #x00 #x00 #x00 #x00 #x00)])
+  (test* "binary-codec-size" 20 (binary-codec-size c))
+  (test* "binary-codec-num-values" 5 (binary-codec-num-values c))
+  (test* "binary-codec-decode" `#(1 -2 2 ,(expt 2 31) 1.0)
+         (binary-codec-decode c data))
+  (test* "binary-codec-decode (offset)" `#(1 -2 2 ,(expt 2 31) 1.0)
+         (binary-codec-decode c (u8vector-append '#u8(0 0 0) data) 3))
+  (test* "binary-codec-decode (out of range)" (test-error)
+         (binary-codec-decode c data 1))
+  (test* "binary-codec-decode (port)" `(#(1 -2 2 ,(expt 2 31) 1.0) ,(eof-object))
+         (let1 p (open-input-string (u8vector->string (u8vector-append data '#u8(1 2 3))))
+           (list (binary-codec-decode c p)
+                 (binary-codec-decode c p))))
+  (test* "binary-codec-encode" data
+         (binary-codec-encode c `(1 -2 2 ,(expt 2 31) 1.0)))
+  (test* "binary-codec-encode (le)"
+         (let1 v (make-u8vector 20 0)
+           (put-u8! v 0 1)
+           (put-s16le! v 2 -2)
+           (put-u32le! v 4 2)
+           (put-u32le! v 8 (expt 2 31))
+           (put-f64le! v 12 1.0)
+           v)
+         (binary-codec-encode c-le `#(1 -2 2 ,(expt 2 31) 1.0)))
+  (test* "binary-codec-encode (wrong # of values)" (test-error)
+         (binary-codec-encode c '(1 2 3)))
+  (test* "binary-codec-encode (port)" data
+         (let1 p (open-output-string)
+           (binary-codec-encode c `(1 -2 2 ,(expt 2 31) 1.0) p)
+           (string->u8vector (get-output-string p))))
+  (test* "binary-codec-decode-array" `#(#(1 -2 2 ,(expt 2 31) 1.0)
+                                        #(1 -2 2 ,(expt 2 31) 1.0))
+         (binary-codec-decode-array c (u8vector-append data data) 2))
+  (test* "binary-codec-decode-array (port, short)"
+         `#(#(1 -2 2 ,(expt 2 31) 1.0))
+         (binary-codec-decode-array c (open-input-string (u8vector->string data))
+                                    3))
+  (test* "make-binary-codec (bad spec)" (test-error)
+         (make-binary-codec '(u8 (u3 2))))
+  )
+
 ;;----------------------------------------------------------
 (test-section "binary.ftype")
 
@@ -40,10 +40,12 @@
 
 #define DEFAULT_CONVERSION_BUFFER_SIZE 1024
 #define MINIMUM_CONVERSION_BUFFER_SIZE 16
+#define GUESS_CHUNK_SIZE               128
 
 typedef struct conv_guess_rec {
     const char *codeName;
     ScmCodeGuessingProc proc;
+    ScmCodeGuessingStepProc step; /* may be NULL */
     void *data;
     struct conv_guess_rec *next;
 } conv_guess;
@@ -99,6 +101,7 @@ void Scm_RegisterCodeGuessingProc(const char *code,
     conv_guess *rec = SCM_NEW(conv_guess);
     rec->codeName = code;
     rec->proc = proc;
+    rec->step = NULL;
     rec->data = data;
     (void)SCM_INTERNAL_MUTEX_LOCK(guess.mutex);
     rec->next = guess.procs;
@@ -106,6 +109,19 @@ void Scm_RegisterCodeGuessingProc(const char *code,
     (void)SCM_INTERNAL_MUTEX_UNLOCK(guess.mutex);
 }
 
+static conv_guess *findGuessingProc(const char *code);
+
+/* Attach an incremental guesser to the already registered scheme CODE. */
+void Scm_RegisterCodeGuessingStepProc(const char *code,
+                                      ScmCodeGuessingStepProc step)
+{
+    conv_guess *rec = findGuessingProc(code);
+    if (rec == NULL) {
+        Scm_Error("unknown code guessing scheme: %s", code);
+    }
+    rec->step = step;
+}
+
 static conv_guess *findGuessingProc(const char *code)
 {
     conv_guess *rec;
@@ -260,14 +276,40 @@ ScmObj Scm_MakeInputConversionPort(ScmPort *fromPort,
         const char *guessed;
 
         inbuf = SCM_NEW_ATOMIC2(char *, bufsiz);
-        preread = Scm_Getz(inbuf, bufsiz, fromPort);
-        if (preread <= 0) {
-            /* Input buffer is already empty or unreadable.
-               Determining character code is not necessary.
-               We just return a dummy empty port. */
-            return Scm_MakeInputStringPort(SCM_STRING(SCM_MAKE_STR("")), FALSE);
+        if (guess->step) {
+            /* Feed the input by chunks and stop reading as soon as
+               the guesser decides. */
+            void *state = NULL;
+            int decided = FALSE;
+            while (preread < bufsiz) {
+                int chunk = bufsiz - preread;
+                if (chunk > GUESS_CHUNK_SIZE) chunk = GUESS_CHUNK_SIZE;
+                int n = Scm_Getz(inbuf + preread, chunk, fromPort);
+                if (n <= 0) break;
+                decided = guess->step(&state, inbuf + preread, n,
+                                      &guessed, guess->data);
+                preread += n;
+                if (decided) break;
+            }
+            if (preread <= 0) {
+                return Scm_MakeInputStringPort(SCM_STRING(SCM_MAKE_STR("")),
+                                               FALSE);
+            }
+            if (!decided) {
+                guess->step(&state, inbuf + preread, 0, &guessed,
+                            guess->data);
+            }
+        } else {
+            preread = Scm_Getz(inbuf, bufsiz, fromPort);
+            if (preread <= 0) {
+                /* Input buffer is already empty or unreadable.
+                   Determining character code is not necessary.
+                   We just return a dummy empty port. */
+                return Scm_MakeInputStringPort(SCM_STRING(SCM_MAKE_STR("")),
+                                               FALSE);
+            }
+            guessed = guess->proc(inbuf, preread, guess->data);
         }
-        guessed = guess->proc(inbuf, preread, guess->data);
         if (guessed == NULL)
             Scm_Error("%s: failed to guess input encoding", fromCode);
         fromCode = guessed;
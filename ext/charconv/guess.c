@@ -69,75 +69,154 @@ typedef struct guess_dfa_rec {
 /* include DFA table generated by guess.scm */
 #include "guess_tab.c"
 
-static const char *guess_jp(const char *buf, int buflen, void *data)
+/* The state of incremental guessing for "*JP" */
+typedef struct guess_jp_state_rec {
+    guess_dfa eucj;
+    guess_dfa sjis;
+    guess_dfa utf8;
+    int esc;                    /* TRUE if the previous chunk ended with
+                                   ESC */
+} guess_jp_state;
+
+static guess_jp_state *guess_jp_init(guess_jp_state *st)
 {
     guess_dfa eucj = DFA_INIT(guess_eucj_st, guess_eucj_ar);
     guess_dfa sjis = DFA_INIT(guess_sjis_st, guess_sjis_ar);
     guess_dfa utf8 = DFA_INIT(guess_utf8_st, guess_utf8_ar);
+    st->eucj = eucj;
+    st->sjis = sjis;
+    st->utf8 = utf8;
+    st->esc = FALSE;
+    return st;
+}
 
-    for (int i=0; i<buflen; i++) {
-        int c = (unsigned char)buf[i];
-
-        /* special treatment of jis escape sequence */
-        if (c == 0x1b) {
-            if (i < buflen-1) {
-                c = (unsigned char)buf[++i];
-                if (c == '$' || c == '(') return "ISO-2022-JP";
-            }
-        }
-
-        if (DFA_ALIVE(eucj)) {
-            if (!DFA_ALIVE(sjis) && !DFA_ALIVE(utf8)) return "EUC-JP";
-            DFA_NEXT(eucj, c);
+/* Feeds a byte C to the DFAs.  Returns TRUE if it is decided. */
+static inline int guess_jp_feed(guess_jp_state *st, int c,
+                                const char **guessed)
+{
+    if (DFA_ALIVE(st->eucj)) {
+        if (!DFA_ALIVE(st->sjis) && !DFA_ALIVE(st->utf8)) {
+            *guessed = "EUC-JP";
+            return TRUE;
         }
-        if (DFA_ALIVE(sjis)) {
-            if (!DFA_ALIVE(eucj) && !DFA_ALIVE(utf8)) return "Shift_JIS";
-            DFA_NEXT(sjis, c);
+        DFA_NEXT(st->eucj, c);
+    }
+    if (DFA_ALIVE(st->sjis)) {
+        if (!DFA_ALIVE(st->eucj) && !DFA_ALIVE(st->utf8)) {
+            *guessed = "Shift_JIS";
+            return TRUE;
         }
-        if (DFA_ALIVE(utf8)) {
-            if (!DFA_ALIVE(sjis) && !DFA_ALIVE(eucj)) return "UTF-8";
-            DFA_NEXT(utf8, c);
+        DFA_NEXT(st->sjis, c);
+    }
+    if (DFA_ALIVE(st->utf8)) {
+        if (!DFA_ALIVE(st->sjis) && !DFA_ALIVE(st->eucj)) {
+            *guessed = "UTF-8";
+            return TRUE;
         }
+        DFA_NEXT(st->utf8, c);
+    }
 
-        if (!DFA_ALIVE(eucj) && !DFA_ALIVE(sjis) && !DFA_ALIVE(utf8)) {
-            /* we ran out the possibilities */
-            return NULL;
-        }
+    if (!DFA_ALIVE(st->eucj) && !DFA_ALIVE(st->sjis) && !DFA_ALIVE(st->utf8)) {
+        /* we ran out the possibilities */
+        *guessed = NULL;
+        return TRUE;
     }
+    return FALSE;
+}
 
-    /* Now, we have ambigous code.  Pick the highest score.  If more than
-       one candidate tie, pick the default encoding. */
+/* We have ambigous code.  Pick the highest score.  If more than
+   one candidate tie, pick the default encoding. */
+static const char *guess_jp_pick(guess_jp_state *st)
+{
     guess_dfa *top = NULL;
-    if (DFA_ALIVE(eucj)) top = &eucj;
-    if (DFA_ALIVE(utf8)) {
+    if (DFA_ALIVE(st->eucj)) top = &st->eucj;
+    if (DFA_ALIVE(st->utf8)) {
         if (top) {
 #if defined GAUCHE_CHAR_ENCODING_UTF_8
-            if (top->score <= utf8.score)  top = &utf8;
+            if (top->score <= st->utf8.score)  top = &st->utf8;
 #else
-            if (top->score <  utf8.score) top = &utf8;
+            if (top->score <  st->utf8.score) top = &st->utf8;
 #endif
         } else {
-            top = &utf8;
+            top = &st->utf8;
         }
     }
-    if (DFA_ALIVE(sjis)) {
+    if (DFA_ALIVE(st->sjis)) {
         if (top) {
 #if defined GAUCHE_CHAR_ENCODING_SJIS
-            if (top->score <= sjis.score)  top = &sjis;
+            if (top->score <= st->sjis.score)  top = &st->sjis;
 #else
-            if (top->score <  sjis.score) top = &sjis;
+            if (top->score <  st->sjis.score) top = &st->sjis;
 #endif
         } else {
-            top = &sjis;
+            top = &st->sjis;
         }
     }
 
-    if (top == &eucj) return "EUC-JP";
-    if (top == &utf8) return "UTF-8";
-    if (top == &sjis) return "Shift_JIS";
+    if (top == &st->eucj) return "EUC-JP";
+    if (top == &st->utf8) return "UTF-8";
+    if (top == &st->sjis) return "Shift_JIS";
     return NULL;
 }
 
+static int guess_jp_step(void **state, const char *buf, int buflen,
+                         const char **guessed, void *data)
+{
+    guess_jp_state *st = (guess_jp_state*)*state;
+    if (st == NULL) {
+        st = guess_jp_init(SCM_NEW_ATOMIC(guess_jp_state));
+        *state = st;
+    }
+
+    if (buflen == 0) {
+        /* end of input */
+        if (st->esc && guess_jp_feed(st, 0x1b, guessed)) return TRUE;
+        *guessed = guess_jp_pick(st);
+        return TRUE;
+    }
+
+    for (int i=0; i<buflen; i++) {
+        int c = (unsigned char)buf[i];
+
+        /* special treatment of jis escape sequence */
+        if (st->esc) {
+            st->esc = FALSE;
+            if (c == '$' || c == '(') {
+                *guessed = "ISO-2022-JP";
+                return TRUE;
+            }
+        } else if (c == 0x1b) {
+            if (i < buflen-1) {
+                c = (unsigned char)buf[++i];
+                if (c == '$' || c == '(') {
+                    *guessed = "ISO-2022-JP";
+                    return TRUE;
+                }
+            } else {
+                /* wait for the next chunk */
+                st->esc = TRUE;
+                return FALSE;
+            }
+        }
+
+        if (guess_jp_feed(st, c, guessed)) return TRUE;
+    }
+    return FALSE;
+}
+
+static const char *guess_jp(const char *buf, int buflen, void *data)
+{
+    guess_jp_state st;
+    const char *guessed = NULL;
+    void *state = guess_jp_init(&st);
+
+    if (buflen > 0 && guess_jp_step(&state, buf, buflen, &guessed, data)) {
+        return guessed;
+    }
+    guess_jp_step(&state, buf, 0, &guessed, data);
+    return guessed;
+}
+
 
 /*
  * Initialization
@@ -146,4 +225,5 @@ static const char *guess_jp(const char *buf, int buflen, void *data)
 void Scm_Init_convguess(void)
 {
     Scm_RegisterCodeGuessingProc("*JP", guess_jp, NULL);
+    Scm_RegisterCodeGuessingStepProc("*JP", guess_jp_step);
 }
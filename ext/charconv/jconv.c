@@ -1216,6 +1216,43 @@ static size_t jconv_ident(ScmConvInfo *info, const char **iptr,
     }
 }
 
+/* Most text has long runs of ASCII, and the stateless converters
+   (i.e. other than ISO2022-JP) pass bytes below 0x7f through unchanged.
+   Returns the length of such run at the beginning of P, up to SIZE bytes,
+   looking at a word at a time.  For the bytes below 0x80, adding 1 to
+   each byte doesn't carry over, and only 0x7f gets the MSB set. */
+#define ASCII_WORD_ONES  ((uint64_t)0x0101010101010101ULL)
+#define ASCII_WORD_MSBS  ((uint64_t)0x8080808080808080ULL)
+
+static inline size_t ascii_run(const char *p, size_t size)
+{
+    const char *q = p, *end = p + size;
+    while (end - q >= 8) {
+        uint64_t w;
+        memcpy(&w, q, 8);
+        if ((w | (w + ASCII_WORD_ONES)) & ASCII_WORD_MSBS) break;
+        q += 8;
+    }
+    while (q < end && (unsigned char)*q < 0x7f) q++;
+    return q - p;
+}
+
+/* Copies the run of ASCII bytes at the input to the output, and
+   updates the pointers and counts.  Returns the number of bytes copied. */
+static inline int ascii_through(const char **inp, int *inr,
+                                char **outp, int *outr)
+{
+    int n = (int)ascii_run(*inp, (*inr < *outr)? *inr : *outr);
+    if (n > 0) {
+        memcpy(*outp, *inp, n);
+        *inp += n;
+        *inr -= n;
+        *outp += n;
+        *outr -= n;
+    }
+    return n;
+}
+
 /* case (2) or (3) */
 static size_t jconv_1tier(ScmConvInfo *info, const char **iptr,
                           size_t *iroom, char **optr, size_t *oroom)
@@ -1231,6 +1268,10 @@ static size_t jconv_1tier(ScmConvInfo *info, const char **iptr,
 #endif
     SCM_ASSERT(cvt != NULL);
     while (inr > 0 && outr > 0) {
+        if (info->asciiThrough) {
+            converted += ascii_through(&inp, &inr, &outp, &outr);
+            if (inr == 0 || outr == 0) break;
+        }
         size_t outchars;
         size_t inchars = cvt(info, inp, inr, outp, outr, &outchars);
         if (ERRP(inchars)) {
@@ -1268,6 +1309,10 @@ static size_t jconv_2tier(ScmConvInfo *info, const char **iptr, size_t *iroom,
     fprintf(stderr, "jconv_2tier %s->%s\n", info->fromCode, info->toCode);
 #endif
     while (inr > 0 && outr > 0) {
+        if (info->asciiThrough) {
+            converted += ascii_through(&inp, &inr, &outp, &outr);
+            if (inr == 0 || outr == 0) break;
+        }
         size_t outchars, bufchars;
         size_t inchars = icvt(info, inp, inr, buf, INTBUFSIZ, &bufchars);
         if (ERRP(inchars)) {
@@ -1400,6 +1445,8 @@ ScmConvInfo *jconv_open(const char *toCode, const char *fromCode)
     info->handle = handle;
     info->toCode = toCode;
     info->istate = info->ostate = JIS_ASCII;
+    info->asciiThrough = (handler == jconv_1tier || handler == jconv_2tier)
+        && incode != JCODE_ISO2022JP && outcode != JCODE_ISO2022JP;
     info->fromCode = fromCode;
     return info;
 }
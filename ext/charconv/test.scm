@@ -256,6 +256,30 @@
           '("EUCJP" "UTF-8" "SJIS" "ISO2022JP")
           '("*JP"))
 
+;; Guessing on conversion ports feeds the input incrementally; make sure
+;; the decision doesn't depend on where the chunks are split.
+(let ()
+  (define (test-guess-port file code)
+    (test* #"guess port *JP from ~|file|.~|code|"
+           (string-complete->incomplete (file->string #"~|file|.EUCJP"))
+           (string-complete->incomplete
+            (port->string
+             (open-input-conversion-port
+              (open-input-file #"~|file|.~|code|")
+              "*JP" :to-code "EUCJP" :owner? #t)))))
+  (dolist [f '("data/jp1" "data/jp2" "data/jp3")]
+    (dolist [c '("EUCJP" "UTF-8" "SJIS" "ISO2022JP")]
+      (test-guess-port f c)))
+  ;; JIS escape sequence straddling a chunk boundary
+  (dolist [n '(126 127 128 129)]
+    (test* #"guess port *JP, escape at ~n"
+           (string-append (make-string n #\a) "\u3042")
+           (port->string
+            (open-input-conversion-port
+             (open-input-string
+              (string-append (make-string n #\a) "\x1b;$B$\"\x1b;(B"))
+             "*JP" :owner? #t)))))
+
 ;;--------------------------------------------------------------------
 (test-section "string conversion")
 
@@ -286,6 +310,16 @@
           '("EUCJP" "UTF-8" "SJIS" "ISO2022JP")
           '("EUCJP" "UTF-8" "SJIS" "ISO2022JP"))
 
+;; ASCII runs are copied by the word; check the runs of various lengths
+;; and alignment.
+(let1 ascii (string-append (make-string 37 #\a) "\t~\\" (make-string 9 #\z))
+  (dolist [from '("EUCJP" "UTF-8" "SJIS")]
+    (dolist [to '("EUCJP" "UTF-8" "SJIS")]
+      (dotimes [i 11]
+        (let1 s (substring ascii i (string-length ascii))
+          (test* (format "string(ascii ~a) ~a => ~a" i from to)
+                 s (ces-convert s from to)))))))
+
 ;;--------------------------------------------------------------------
 (test-section "wrapping conversion")
 
@@ -0,0 +1,452 @@
+/*
+ * bitvector.c - bit vectors for data.bitvector
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Bits are kept in ScmBits words, and most operations work a word at
+ * a time.  Bulk logical operations and population count use AVX2, and
+ * the population count falls back to the popcnt instruction, if the
+ * CPU has them.  As in ext/rfc/codec.c, those are compiled with
+ * per-function target attributes and selected at initialization, so
+ * no special compiler flags are needed.
+ */
+
+#include <gauche.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include <gauche/bits_inline.h>
+#include "bitvector.h"
+
+#if (defined(__x86_64__) || defined(__i386__))                          \
+    && ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 5)     \
+        || (defined(__clang__)                                          \
+            && (__clang_major__ > 3                                     \
+                || (__clang_major__ == 3 && __clang_minor__ >= 8))))
+#define BITVECTOR_X86 1
+#include <immintrin.h>
+#define AVX2_TARGET   __attribute__((target("avx2")))
+#define POPCNT_TARGET __attribute__((target("popcnt")))
+#endif
+
+#define WB           SCM_WORD_BITS
+#define NWORDS(size) SCM_BITS_NUM_WORDS(size)
+
+static void bitvector_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    ScmBitvector *bv = SCM_BITVECTOR(obj);
+    ScmSmallInt n = (bv->size > 64)? 64 : bv->size;
+    Scm_Printf(port, "#<bitvector %ld ", bv->size);
+    for (ScmSmallInt i = 0; i < n; i++) {
+        Scm_Putc(SCM_BITS_TEST(bv->bits, i)? '1' : '0', port);
+    }
+    if (n < bv->size) Scm_Putz("...", -1, port);
+    Scm_Putc('>', port);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_BitvectorClass, bitvector_print);
+
+/* Mask of the valid bits in the last word */
+static inline u_long last_word_mask(ScmSmallInt size)
+{
+    int r = (int)(size % WB);
+    return r? (1UL<<r) - 1 : ~0UL;
+}
+
+static inline void clear_padding(ScmBitvector *bv)
+{
+    if (bv->size > 0) bv->bits[NWORDS(bv->size)-1] &= last_word_mask(bv->size);
+}
+
+static ScmBitvector *make_bitvector(ScmSmallInt size)
+{
+    if (size < 0) {
+        Scm_Error("bitvector size must be nonnegative, but got %ld", size);
+    }
+    ScmSmallInt nw = NWORDS(size);
+    if (nw == 0) nw = 1;
+    ScmBitvector *bv = SCM_NEW(ScmBitvector);
+    SCM_SET_CLASS(bv, SCM_CLASS_BITVECTOR);
+    bv->size = size;
+    bv->bits = SCM_NEW_ATOMIC_ARRAY(ScmBits, nw);
+    memset(bv->bits, 0, nw * sizeof(ScmBits));
+    return bv;
+}
+
+ScmObj Scm__MakeBitvector(ScmSmallInt size, int fill)
+{
+    ScmBitvector *bv = make_bitvector(size);
+    if (fill) Scm__BitvectorFill(bv, TRUE, 0, size);
+    return SCM_OBJ(bv);
+}
+
+/*=====================================================
+ * Word loops
+ */
+
+static ScmSmallInt count_words_generic(const ScmBits *w, ScmSmallInt n)
+{
+    ScmSmallInt cnt = 0;
+    for (ScmSmallInt i = 0; i < n; i++) cnt += Scm__CountBitsInWord(w[i]);
+    return cnt;
+}
+
+static void operate_words_generic(ScmBits *r, ScmBitOp op,
+                                  const ScmBits *a, const ScmBits *b,
+                                  ScmSmallInt n)
+{
+#define LOOP(expr) for (ScmSmallInt i = 0; i < n; i++) r[i] = (expr); break
+    switch (op) {
+    case SCM_BIT_AND:   LOOP(a[i] & b[i]);
+    case SCM_BIT_IOR:   LOOP(a[i] | b[i]);
+    case SCM_BIT_XOR:   LOOP(a[i] ^ b[i]);
+    case SCM_BIT_EQV:   LOOP(~(a[i] ^ b[i]));
+    case SCM_BIT_NAND:  LOOP(~(a[i] & b[i]));
+    case SCM_BIT_NOR:   LOOP(~(a[i] | b[i]));
+    case SCM_BIT_ANDC1: LOOP(~a[i] & b[i]);
+    case SCM_BIT_ANDC2: LOOP(a[i] & ~b[i]);
+    case SCM_BIT_IORC1: LOOP(~a[i] | b[i]);
+    case SCM_BIT_IORC2: LOOP(a[i] | ~b[i]);
+    case SCM_BIT_XORC1: LOOP(~a[i] ^ b[i]);
+    case SCM_BIT_XORC2: LOOP(a[i] ^ ~b[i]);
+    case SCM_BIT_SRC1:  LOOP(a[i]);
+    case SCM_BIT_SRC2:  LOOP(b[i]);
+    case SCM_BIT_NOT1:  LOOP(~a[i]);
+    case SCM_BIT_NOT2:  LOOP(~b[i]);
+    }
+#undef LOOP
+}
+
+#if BITVECTOR_X86
+POPCNT_TARGET
+static ScmSmallInt count_words_popcnt(const ScmBits *w, ScmSmallInt n)
+{
+    ScmSmallInt cnt = 0;
+    for (ScmSmallInt i = 0; i < n; i++) cnt += __builtin_popcountl(w[i]);
+    return cnt;
+}
+
+/* Counts 4 bits at a time with a table lookup by pshufb, and sums up
+   the bytes with psadbw.  Faster than popcnt on long vectors. */
+AVX2_TARGET
+static ScmSmallInt count_words_avx2(const ScmBits *w, ScmSmallInt n)
+{
+    const ScmSmallInt step = sizeof(__m256i)/sizeof(ScmBits);
+    const __m256i table = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                           0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+    const __m256i low4 = _mm256_set1_epi8(0x0f);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc = zero;
+    ScmSmallInt i = 0;
+    for (; i + step <= n; i += step) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(w+i));
+        __m256i lo = _mm256_and_si256(v, low4);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low4);
+        __m256i c = _mm256_add_epi8(_mm256_shuffle_epi8(table, lo),
+                                    _mm256_shuffle_epi8(table, hi));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(c, zero));
+    }
+    uint64_t sums[4];
+    _mm256_storeu_si256((__m256i*)sums, acc);
+    ScmSmallInt cnt = (ScmSmallInt)(sums[0] + sums[1] + sums[2] + sums[3]);
+    return cnt + count_words_generic(w+i, n-i);
+}
+
+AVX2_TARGET
+static void operate_words_avx2(ScmBits *r, ScmBitOp op,
+                               const ScmBits *a, const ScmBits *b,
+                               ScmSmallInt n)
+{
+    const ScmSmallInt step = sizeof(__m256i)/sizeof(ScmBits);
+    const __m256i ones = _mm256_set1_epi8(-1);
+    ScmSmallInt i = 0;
+#define LOOP(expr)                                                      \
+    for (; i + step <= n; i += step) {                                  \
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a+i));          \
+        __m256i y = _mm256_loadu_si256((const __m256i*)(b+i));          \
+        _mm256_storeu_si256((__m256i*)(r+i), (expr));                   \
+        (void)y;                                                        \
+    }                                                                   \
+    break
+    switch (op) {
+    case SCM_BIT_AND:   LOOP(_mm256_and_si256(x, y));
+    case SCM_BIT_IOR:   LOOP(_mm256_or_si256(x, y));
+    case SCM_BIT_XOR:   LOOP(_mm256_xor_si256(x, y));
+    case SCM_BIT_ANDC2: LOOP(_mm256_andnot_si256(y, x));
+    case SCM_BIT_NOT1:  LOOP(_mm256_xor_si256(x, ones));
+    default: break;
+    }
+#undef LOOP
+    operate_words_generic(r+i, op, a+i, b+i, n-i);
+}
+#endif /*BITVECTOR_X86*/
+
+static ScmSmallInt (*count_words)(const ScmBits*, ScmSmallInt)
+    = count_words_generic;
+static void (*operate_words)(ScmBits*, ScmBitOp,
+                             const ScmBits*, const ScmBits*, ScmSmallInt)
+    = operate_words_generic;
+
+/*=====================================================
+ * Fill and copy
+ */
+
+void Scm__BitvectorFill(ScmBitvector *bv, int b,
+                        ScmSmallInt start, ScmSmallInt end)
+{
+    if (start >= end) return;
+    ScmSmallInt sw = start/WB, ew = (end-1)/WB;
+    int sb = (int)(start%WB), eb = (int)(end%WB);
+    ScmBits *bits = bv->bits;
+
+    if (sw == ew) {
+        u_long m = SCM_BITS_MASK(sb, eb);
+        if (b) bits[sw] |= m;
+        else   bits[sw] &= ~m;
+        return;
+    }
+    u_long sm = SCM_BITS_MASK(sb, 0), em = SCM_BITS_MASK(0, eb);
+    if (b) {
+        bits[sw] |= sm;
+        bits[ew] |= em;
+    } else {
+        bits[sw] &= ~sm;
+        bits[ew] &= ~em;
+    }
+    memset(bits+sw+1, b? 0xff : 0, (ew-sw-1) * sizeof(ScmBits));
+}
+
+/* Returns WB bits starting from POS.  Bits beyond the NW-th word
+   read as zero. */
+static inline u_long fetch_bits(const ScmBits *bits, ScmSmallInt nw,
+                                ScmSmallInt pos)
+{
+    ScmSmallInt w = pos/WB;
+    int s = (int)(pos%WB);
+    u_long v = bits[w] >> s;
+    if (s == 0 || w+1 >= nw) return v;
+    return v | (bits[w+1] << (WB-s));
+}
+
+/* Stores the lower N bits of V at POS, where 0 < N <= WB. */
+static inline void store_bits(ScmBits *bits, ScmSmallInt pos,
+                              u_long v, int n)
+{
+    ScmSmallInt w = pos/WB;
+    int s = (int)(pos%WB);
+    u_long m = (n == WB)? ~0UL : (1UL<<n) - 1;
+    v &= m;
+    bits[w] = (bits[w] & ~(m<<s)) | (v<<s);
+    if (s + n > WB) {
+        int r = WB - s;
+        bits[w+1] = (bits[w+1] & ~(m>>r)) | (v>>r);
+    }
+}
+
+void Scm__BitvectorCopyX(ScmBitvector *dst, ScmSmallInt at,
+                         ScmBitvector *src,
+                         ScmSmallInt start, ScmSmallInt end)
+{
+    ScmSmallInt n = end - start;
+    ScmSmallInt nw = NWORDS(src->size);
+    if (n <= 0) return;
+
+    if (dst == src && at > start) {
+        /* Overlapping; copy from the top. */
+        for (ScmSmallInt k = n; k > 0;) {
+            int c = (k >= WB)? WB : (int)k;
+            k -= c;
+            store_bits(dst->bits, at+k, fetch_bits(src->bits, nw, start+k), c);
+        }
+    } else if (at%WB == 0 && start%WB == 0) {
+        ScmSmallInt full = n/WB;
+        memmove(dst->bits + at/WB, src->bits + start/WB,
+                full * sizeof(ScmBits));
+        if (n%WB) {
+            store_bits(dst->bits, at + full*WB,
+                       src->bits[start/WB + full], (int)(n%WB));
+        }
+    } else {
+        for (ScmSmallInt k = 0; k < n; k += WB) {
+            int c = (n-k >= WB)? WB : (int)(n-k);
+            store_bits(dst->bits, at+k, fetch_bits(src->bits, nw, start+k), c);
+        }
+    }
+}
+
+ScmObj Scm__BitvectorCopy(ScmBitvector *bv, ScmSmallInt start, ScmSmallInt end)
+{
+    ScmBitvector *r = make_bitvector(end - start);
+    Scm__BitvectorCopyX(r, 0, bv, start, end);
+    return SCM_OBJ(r);
+}
+
+/*=====================================================
+ * Logical operations
+ */
+
+void Scm__BitvectorOperate(ScmBitvector *r, ScmBitOp op,
+                           ScmBitvector *a, ScmBitvector *b)
+{
+    if (b == NULL) b = a;
+    if (r->size != a->size || r->size != b->size) {
+        Scm_Error("bitvector sizes don't match: %ld, %ld and %ld",
+                  r->size, a->size, b->size);
+    }
+    operate_words(r->bits, op, a->bits, b->bits, NWORDS(r->size));
+    clear_padding(r);
+}
+
+int Scm__BitvectorEqual(ScmBitvector *a, ScmBitvector *b)
+{
+    return (a->size == b->size
+            && memcmp(a->bits, b->bits, NWORDS(a->size)*sizeof(ScmBits)) == 0);
+}
+
+/*=====================================================
+ * Counting and searching
+ */
+
+ScmSmallInt Scm__BitvectorCount(ScmBitvector *bv,
+                                ScmSmallInt start, ScmSmallInt end)
+{
+    if (start >= end) return 0;
+    ScmSmallInt sw = start/WB, ew = (end-1)/WB;
+    int sb = (int)(start%WB), eb = (int)(end%WB);
+    const ScmBits *bits = bv->bits;
+
+    if (sw == ew) return Scm__CountBitsInWord(bits[sw] & SCM_BITS_MASK(sb, eb));
+    return Scm__CountBitsInWord(bits[sw] & SCM_BITS_MASK(sb, 0))
+        + count_words(bits+sw+1, ew-sw-1)
+        + Scm__CountBitsInWord(bits[ew] & SCM_BITS_MASK(0, eb));
+}
+
+ScmSmallInt Scm__BitvectorNext(ScmBitvector *bv, int b, ScmSmallInt start)
+{
+    if (start >= bv->size) return -1;
+    ScmSmallInt nw = NWORDS(bv->size);
+    ScmSmallInt w = start/WB;
+    u_long flip = b? 0 : ~0UL;
+    u_long word = (bv->bits[w] ^ flip) & SCM_BITS_MASK(start%WB, 0);
+    for (;;) {
+        if (word) {
+            /* When searching 0, the padding bits read as 1. */
+            ScmSmallInt i = w*WB + Scm__LowestBitNumber(word);
+            return (i < bv->size)? i : -1;
+        }
+        if (++w >= nw) return -1;
+        word = bv->bits[w] ^ flip;
+    }
+}
+
+/* We skip blocks of this many words with count_words before looking
+   into individual words. */
+#define SELECT_BLOCK 32
+
+ScmSmallInt Scm__BitvectorSelect(ScmBitvector *bv, ScmSmallInt k)
+{
+    if (k < 0) return -1;
+    ScmSmallInt nw = NWORDS(bv->size);
+    ScmSmallInt w = 0;
+    for (; w + SELECT_BLOCK <= nw; w += SELECT_BLOCK) {
+        ScmSmallInt c = count_words(bv->bits+w, SELECT_BLOCK);
+        if (c > k) break;
+        k -= c;
+    }
+    for (; w < nw; w++) {
+        u_long word = bv->bits[w];
+        ScmSmallInt c = Scm__CountBitsInWord(word);
+        if (c > k) {
+            while (k-- > 0) word &= word - 1;   /* drop the lowest '1' */
+            return w*WB + Scm__LowestBitNumber(word);
+        }
+        k -= c;
+    }
+    return -1;
+}
+
+/*=====================================================
+ * Conversion
+ */
+
+/* On little-endian machines the byte layout of ScmBits is the same
+   as the u8vector's, so we just copy. */
+ScmObj Scm__U8VectorToBitvector(ScmUVector *v,
+                                ScmSmallInt start, ScmSmallInt end)
+{
+    const u_char *p = SCM_U8VECTOR_ELEMENTS(v) + start;
+    ScmSmallInt n = end - start;
+    ScmBitvector *bv = make_bitvector(n*8);
+#if defined(WORDS_BIGENDIAN)
+    for (ScmSmallInt i = 0; i < n; i++) {
+        bv->bits[i/SIZEOF_LONG] |= (u_long)p[i] << ((i%SIZEOF_LONG)*8);
+    }
+#else
+    memcpy(bv->bits, p, n);
+#endif
+    return SCM_OBJ(bv);
+}
+
+ScmObj Scm__BitvectorToU8Vector(ScmBitvector *bv)
+{
+    ScmSmallInt n = (bv->size + 7)/8;
+    ScmObj v = Scm_MakeU8Vector(n, 0);
+    u_char *p = SCM_U8VECTOR_ELEMENTS(v);
+#if defined(WORDS_BIGENDIAN)
+    for (ScmSmallInt i = 0; i < n; i++) {
+        p[i] = (u_char)(bv->bits[i/SIZEOF_LONG] >> ((i%SIZEOF_LONG)*8));
+    }
+#else
+    memcpy(p, bv->bits, n);
+#endif
+    return v;
+}
+
+/*=====================================================
+ * Initialization
+ */
+
+void Scm__InitBitvector(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_BitvectorClass, "<bitvector>", mod, NULL, 0);
+
+#if BITVECTOR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        count_words = count_words_avx2;
+        operate_words = operate_words_avx2;
+    } else if (__builtin_cpu_supports("popcnt")) {
+        count_words = count_words_popcnt;
+    }
+#endif
+}
@@ -0,0 +1,88 @@
+/*
+ * bitvector.h - bit vectors for data.bitvector
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_DATA_BITVECTOR_H
+#define GAUCHE_DATA_BITVECTOR_H
+
+/* A fixed-size bit vector on top of ScmBits.  The bits beyond SIZE in
+ * the last word are always kept zero, so that the whole-word operations
+ * (counting, comparison, conversion) don't need to mask them.
+ */
+typedef struct ScmBitvectorRec {
+    SCM_HEADER;
+    ScmSmallInt size;           /* number of bits */
+    ScmBits *bits;
+} ScmBitvector;
+
+SCM_CLASS_DECL(Scm_BitvectorClass);
+#define SCM_CLASS_BITVECTOR     (&Scm_BitvectorClass)
+#define SCM_BITVECTOR(obj)      ((ScmBitvector*)(obj))
+#define SCM_BITVECTOR_P(obj)    SCM_XTYPEP(obj, SCM_CLASS_BITVECTOR)
+#define SCM_BITVECTOR_SIZE(obj) (SCM_BITVECTOR(obj)->size)
+
+extern ScmObj Scm__MakeBitvector(ScmSmallInt size, int fill);
+extern ScmObj Scm__BitvectorCopy(ScmBitvector *bv,
+                                 ScmSmallInt start, ScmSmallInt end);
+/* Copies bits [START, END) of SRC into DST at AT.  SRC and DST may be
+   the same. */
+extern void Scm__BitvectorCopyX(ScmBitvector *dst, ScmSmallInt at,
+                                ScmBitvector *src,
+                                ScmSmallInt start, ScmSmallInt end);
+extern void Scm__BitvectorFill(ScmBitvector *bv, int b,
+                               ScmSmallInt start, ScmSmallInt end);
+
+/* R = A op B, word by word.  All must have the same size; B is ignored
+   for SCM_BIT_NOT1. */
+extern void Scm__BitvectorOperate(ScmBitvector *r, ScmBitOp op,
+                                  ScmBitvector *a, ScmBitvector *b);
+extern int  Scm__BitvectorEqual(ScmBitvector *a, ScmBitvector *b);
+
+/* Number of 1 bits in [START, END). */
+extern ScmSmallInt Scm__BitvectorCount(ScmBitvector *bv,
+                                       ScmSmallInt start, ScmSmallInt end);
+/* Index of the first bit B at or after START, or -1. */
+extern ScmSmallInt Scm__BitvectorNext(ScmBitvector *bv, int b,
+                                      ScmSmallInt start);
+/* Index of the K-th (0-based) 1 bit, or -1. */
+extern ScmSmallInt Scm__BitvectorSelect(ScmBitvector *bv, ScmSmallInt k);
+
+/* Bit i corresponds to the bit (i%8) of the byte (i/8). */
+extern ScmObj Scm__U8VectorToBitvector(ScmUVector *v,
+                                       ScmSmallInt start, ScmSmallInt end);
+extern ScmObj Scm__BitvectorToU8Vector(ScmBitvector *bv);
+
+/* Called once at initialization. */
+extern void Scm__InitBitvector(ScmModule *mod);
+
+#endif /* GAUCHE_DATA_BITVECTOR_H */
@@ -0,0 +1,193 @@
+;;;
+;;; data.bitvector - bit vectors
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; Fixed-size bit vectors, implemented in bitvector.c.
+;; Bit values are taken as a boolean or 0/1, and returned as a boolean.
+
+(define-module data.bitvector
+  (export <bitvector> make-bitvector bitvector? bitvector-length
+          bitvector-ref bitvector-set! bitvector-fill!
+          bitvector-copy bitvector-copy! bitvector=?
+          bitvector-and bitvector-ior bitvector-xor bitvector-not
+          bitvector-and! bitvector-ior! bitvector-xor! bitvector-not!
+          bitvector-popcount bitvector-next-set bitvector-next-clear
+          bitvector-rank bitvector-select
+          u8vector->bitvector bitvector->u8vector
+          list->bitvector bitvector->list
+          string->bitvector bitvector->string))
+(select-module data.bitvector)
+
+(inline-stub
+ (declcode "#include \"bitvector.h\"")
+ (initcode "Scm__InitBitvector(Scm_CurrentModule());")
+
+ (define-type <bitvector> "ScmBitvector*" "bitvector"
+   "SCM_BITVECTOR_P" "SCM_BITVECTOR")
+
+ (define-cfn bit-value (v) ::int :static
+   (cond [(SCM_EQ v (SCM_MAKE_INT 0)) (return FALSE)]
+         [(SCM_EQ v (SCM_MAKE_INT 1)) (return TRUE)]
+         [(SCM_BOOLP v) (return (SCM_BOOL_VALUE v))]
+         [else (SCM_TYPE_ERROR v "boolean, 0 or 1") (return FALSE)]))
+
+ (define-cfn check-index (bv::ScmBitvector* k::ScmSmallInt) ::void :static
+   (unless (and (<= 0 k) (< k (-> bv size)))
+     (Scm_Error "bitvector index out of range: %ld" k)))
+
+ (define-cproc make-bitvector (size::<fixnum> :optional (fill #f))
+   (return (Scm__MakeBitvector size (bit-value fill))))
+ (define-cproc bitvector? (obj) ::<boolean>
+   (return (SCM_BITVECTOR_P obj)))
+ (define-cproc bitvector-length (bv::<bitvector>) ::<fixnum>
+   (return (-> bv size)))
+
+ (define-cproc bitvector-ref (bv::<bitvector> k::<fixnum>) ::<boolean>
+   (check-index bv k)
+   (return (SCM_BITS_TEST (-> bv bits) k)))
+ (define-cproc bitvector-set! (bv::<bitvector> k::<fixnum> v) ::<void>
+   (check-index bv k)
+   (if (bit-value v)
+     (SCM_BITS_SET (-> bv bits) k)
+     (SCM_BITS_RESET (-> bv bits) k)))
+
+ (define-cproc bitvector-fill! (bv::<bitvector> v :optional (start::<fixnum> 0)
+                                                          (end::<fixnum> -1))
+   ::<void>
+   (SCM_CHECK_START_END start end (-> bv size))
+   (Scm__BitvectorFill bv (bit-value v) start end))
+
+ (define-cproc bitvector-copy (bv::<bitvector> :optional (start::<fixnum> 0)
+                                                         (end::<fixnum> -1))
+   (SCM_CHECK_START_END start end (-> bv size))
+   (return (Scm__BitvectorCopy bv start end)))
+ (define-cproc bitvector-copy! (to::<bitvector> at::<fixnum> from::<bitvector>
+                                :optional (start::<fixnum> 0)
+                                          (end::<fixnum> -1))
+   ::<void>
+   (SCM_CHECK_START_END start end (-> from size))
+   (unless (and (<= 0 at) (<= (+ at (- end start)) (-> to size)))
+     (Scm_Error "destination index out of range: %ld" at))
+   (Scm__BitvectorCopyX to at from start end))
+
+ (define-cproc bitvector=? (a::<bitvector> b::<bitvector>) ::<boolean>
+   Scm__BitvectorEqual)
+
+ ;; Destructively updates A with each of BS in turn.
+ (define-cfn bitvector-op! (op::ScmBitOp a::ScmBitvector* bs) :static
+   (dolist [b bs]
+     (unless (SCM_BITVECTOR_P b) (SCM_TYPE_ERROR b "bitvector"))
+     (Scm__BitvectorOperate a op a (SCM_BITVECTOR b)))
+   (return (SCM_OBJ a)))
+
+ (define-cproc bitvector-and! (a::<bitvector> :rest bs)
+   (return (bitvector-op! SCM_BIT_AND a bs)))
+ (define-cproc bitvector-ior! (a::<bitvector> :rest bs)
+   (return (bitvector-op! SCM_BIT_IOR a bs)))
+ (define-cproc bitvector-xor! (a::<bitvector> :rest bs)
+   (return (bitvector-op! SCM_BIT_XOR a bs)))
+ (define-cproc bitvector-not! (a::<bitvector>)
+   (Scm__BitvectorOperate a SCM_BIT_NOT1 a NULL)
+   (return (SCM_OBJ a)))
+
+ (define-cproc bitvector-popcount (bv::<bitvector>
+                                   :optional (start::<fixnum> 0)
+                                             (end::<fixnum> -1))
+   ::<fixnum>
+   (SCM_CHECK_START_END start end (-> bv size))
+   (return (Scm__BitvectorCount bv start end)))
+
+ ;; Returns the index of the first 1 (0) bit at or after START, or #f.
+ (define-cproc bitvector-next-set (bv::<bitvector> :optional (start::<fixnum> 0))
+   (when (< start 0) (Scm_Error "start argument out of range: %ld" start))
+   (let* ([i::ScmSmallInt (Scm__BitvectorNext bv TRUE start)])
+     (return (?: (< i 0) SCM_FALSE (SCM_MAKE_INT i)))))
+ (define-cproc bitvector-next-clear (bv::<bitvector>
+                                     :optional (start::<fixnum> 0))
+   (when (< start 0) (Scm_Error "start argument out of range: %ld" start))
+   (let* ([i::ScmSmallInt (Scm__BitvectorNext bv FALSE start)])
+     (return (?: (< i 0) SCM_FALSE (SCM_MAKE_INT i)))))
+
+ ;; Number of 1 bits below K.
+ (define-cproc bitvector-rank (bv::<bitvector> k::<fixnum>) ::<fixnum>
+   (unless (and (<= 0 k) (<= k (-> bv size)))
+     (Scm_Error "bitvector index out of range: %ld" k))
+   (return (Scm__BitvectorCount bv 0 k)))
+ ;; Index of the K-th 1 bit (counting from 0), or #f.
+ (define-cproc bitvector-select (bv::<bitvector> k::<fixnum>)
+   (let* ([i::ScmSmallInt (Scm__BitvectorSelect bv k)])
+     (return (?: (< i 0) SCM_FALSE (SCM_MAKE_INT i)))))
+
+ (define-cproc u8vector->bitvector (v::<u8vector>
+                                    :optional (start::<fixnum> 0)
+                                              (end::<fixnum> -1))
+   (SCM_CHECK_START_END start end (SCM_UVECTOR_SIZE v))
+   (return (Scm__U8VectorToBitvector v start end)))
+ (define-cproc bitvector->u8vector (bv::<bitvector>) Scm__BitvectorToU8Vector)
+ )
+
+(define (bitvector-and a . bs) (apply bitvector-and! (bitvector-copy a) bs))
+(define (bitvector-ior a . bs) (apply bitvector-ior! (bitvector-copy a) bs))
+(define (bitvector-xor a . bs) (apply bitvector-xor! (bitvector-copy a) bs))
+(define (bitvector-not a) (bitvector-not! (bitvector-copy a)))
+
+(define-method object-equal? ((a <bitvector>) (b <bitvector>))
+  (bitvector=? a b))
+
+(define (list->bitvector lis)
+  (rlet1 bv (make-bitvector (length lis))
+    (let loop ([i 0] [lis lis])
+      (unless (null? lis)
+        (bitvector-set! bv i (car lis))
+        (loop (+ i 1) (cdr lis))))))
+
+(define (bitvector->list bv)
+  (let loop ([i (- (bitvector-length bv) 1)] [r '()])
+    (if (< i 0) r (loop (- i 1) (cons (bitvector-ref bv i) r)))))
+
+;; "0110" <-> bitvector, bit 0 first
+(define (string->bitvector str)
+  (rlet1 bv (make-bitvector (string-length str))
+    (let loop ([i 0] [cs (string->list str)])
+      (unless (null? cs)
+        (case (car cs)
+          [(#\0)]
+          [(#\1) (bitvector-set! bv i #t)]
+          [else (error "bitvector string must consist of 0 and 1, but got:"
+                       str)])
+        (loop (+ i 1) (cdr cs))))))
+
+(define (bitvector->string bv)
+  (with-output-to-string
+    (^[] (dotimes [i (bitvector-length bv)]
+           (write-char (if (bitvector-ref bv i) #\1 #\0))))))
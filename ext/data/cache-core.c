@@ -0,0 +1,530 @@
+/*
+ * cache-core.c - native cache tables for data.cache
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "cache-core.h"
+
+/*=====================================================
+ * Structure
+ *
+ *  Each shard has a hash core that maps a key to its node.  The
+ *  nodes are also linked in the order of eviction, so that lookup,
+ *  promotion and eviction are all O(1).
+ *
+ *  LRU and TinyLFU keep one circular list of nodes; lru.next is
+ *  the most recently used one and lru.prev is the victim.
+ *
+ *  LFU keeps a list of frequency buckets in increasing order of
+ *  frequency, and each bucket keeps a circular list of its nodes
+ *  in LRU order.  Touching a node moves it to the bucket of the next
+ *  frequency, which is right after the current one (the O(1) LFU
+ *  of Shah, Mitra and Matani).  The victim is the LRU node of the
+ *  first bucket.
+ *
+ *  TinyLFU estimates the frequency of the keys, including the ones not
+ *  in the cache, with a count-min sketch of 4 rows of 4-bit counters
+ *  (we use a byte per counter for simplicity).  Every counter is halved
+ *  after 10*width increments, so the estimate follows recent history.
+ *  When the shard is full, a new entry replaces the victim only if its
+ *  estimate is higher; otherwise it isn't cached at all.  This keeps
+ *  one-off keys from flushing frequently used ones.
+ */
+
+typedef struct freq_bucket_rec freq_bucket;
+
+typedef struct cache_node_rec {
+    ScmObj key;
+    ScmObj value;
+    uint64_t hash;              /* mixed hash value of the key */
+    struct cache_node_rec *prev;
+    struct cache_node_rec *next;
+    freq_bucket *bucket;        /* LFU only */
+} cache_node;
+
+struct freq_bucket_rec {
+    u_long freq;
+    cache_node *nodes;          /* most recently used; nodes->prev is LRU */
+    freq_bucket *prev;
+    freq_bucket *next;
+};
+
+#define SKETCH_DEPTH       4
+#define SKETCH_MAX_COUNT  15
+
+typedef struct cache_shard_rec {
+    ScmHashCore table;          /* key -> cache_node* */
+    cache_node lru;             /* sentinel of the node list */
+    freq_bucket fhead;          /* sentinel of the bucket list */
+    ScmSmallInt capacity;
+    ScmSmallInt count;
+    /* TinyLFU */
+    uint8_t *sketch;            /* SKETCH_DEPTH rows of 2^(64-sshift) */
+    int sshift;
+    u_long additions;
+    u_long resetAt;
+    /* statistics */
+    u_long hits;
+    u_long misses;
+    u_long evictions;
+    u_long rejections;
+    ScmInternalMutex mutex;
+} cache_shard;
+
+struct ScmCacheCoreRec {
+    SCM_HEADER;
+    int policy;
+    int locking;
+    ScmHashType type;
+    ScmHashProc *hashfn;
+    ScmSmallInt capacity;
+    int nshards;
+    cache_shard *shards;
+};
+
+static const char *policy_names[] = { "lru", "lfu", "tinylfu" };
+
+static void core_print(ScmObj obj, ScmPort *port,
+                       ScmWriteContext *ctx)
+{
+    ScmCacheCore *c = SCM_CACHE_CORE(obj);
+    Scm_Printf(port, "#<cache-core %s %ld/%ld>", policy_names[c->policy],
+               Scm__CacheCoreCount(c), c->capacity);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_CacheCoreClass, core_print);
+
+/*=====================================================
+ * Hashing
+ */
+
+/* The hash functions of the hash core may leave patterns in the
+   low bits (e.g. addresses for eq?), so we mix them before choosing
+   a shard and sketch counters. */
+static inline uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+/* Called outside of the lock, since it may call back Scheme. */
+static uint64_t key_hash(ScmCacheCore *c, ScmObj key)
+{
+    if (c->type == SCM_HASH_STRING && !SCM_STRINGP(key)) {
+        Scm_Error("cache keyed by string=? got non-string key: %S", key);
+    }
+    return mix64((uint64_t)c->hashfn(&c->shards[0].table, (intptr_t)key));
+}
+
+static inline cache_shard *shard_of(ScmCacheCore *c, uint64_t h)
+{
+    return &c->shards[(h >> 32) % (uint64_t)c->nshards];
+}
+
+static const uint64_t sketch_seeds[SKETCH_DEPTH] = {
+    0x9e3779b97f4a7c15ULL, 0xbf58476d1ce4e5b9ULL,
+    0x94d049bb133111ebULL, 0xd6e8feb86659fd93ULL
+};
+
+static inline uint8_t *sketch_counter(cache_shard *s, int row, uint64_t h)
+{
+    size_t width = (size_t)1 << (64 - s->sshift);
+    return s->sketch + row*width + ((h * sketch_seeds[row]) >> s->sshift);
+}
+
+static void sketch_increment(cache_shard *s, uint64_t h)
+{
+    for (int i=0; i<SKETCH_DEPTH; i++) {
+        uint8_t *p = sketch_counter(s, i, h);
+        if (*p < SKETCH_MAX_COUNT) (*p)++;
+    }
+    if (++s->additions >= s->resetAt) {
+        size_t size = ((size_t)1 << (64 - s->sshift)) * SKETCH_DEPTH;
+        for (size_t i=0; i<size; i++) s->sketch[i] >>= 1;
+        s->additions /= 2;
+    }
+}
+
+static int sketch_estimate(cache_shard *s, uint64_t h)
+{
+    int m = SKETCH_MAX_COUNT;
+    for (int i=0; i<SKETCH_DEPTH; i++) {
+        int v = *sketch_counter(s, i, h);
+        if (v < m) m = v;
+    }
+    return m;
+}
+
+/*=====================================================
+ * Lists
+ */
+
+static void lru_unlink(cache_node *n)
+{
+    n->prev->next = n->next;
+    n->next->prev = n->prev;
+}
+
+static void lru_push(cache_shard *s, cache_node *n)
+{
+    n->next = s->lru.next;
+    n->prev = &s->lru;
+    s->lru.next->prev = n;
+    s->lru.next = n;
+}
+
+/* Returns the bucket of FREQ right after B, creating it if needed.
+   B may be the sentinel. */
+static freq_bucket *bucket_after(cache_shard *s, freq_bucket *b, u_long freq)
+{
+    if (b->next != &s->fhead && b->next->freq == freq) return b->next;
+    freq_bucket *nb = SCM_NEW(freq_bucket);
+    nb->freq = freq;
+    nb->nodes = NULL;
+    nb->prev = b;
+    nb->next = b->next;
+    b->next->prev = nb;
+    b->next = nb;
+    return nb;
+}
+
+static void bucket_add(freq_bucket *b, cache_node *n)
+{
+    cache_node *m = b->nodes;
+    if (m == NULL) {
+        n->next = n->prev = n;
+    } else {
+        n->next = m;
+        n->prev = m->prev;
+        m->prev->next = n;
+        m->prev = n;
+    }
+    b->nodes = n;
+    n->bucket = b;
+}
+
+/* Removes N from its bucket, and the bucket if it becomes empty. */
+static void bucket_remove(cache_node *n)
+{
+    freq_bucket *b = n->bucket;
+    if (n->next == n) {
+        b->prev->next = b->next;
+        b->next->prev = b->prev;
+        b->nodes = NULL;
+    } else {
+        n->prev->next = n->next;
+        n->next->prev = n->prev;
+        if (b->nodes == n) b->nodes = n->next;
+    }
+    n->bucket = NULL;
+}
+
+static void node_link(ScmCacheCore *c, cache_shard *s, cache_node *n)
+{
+    if (c->policy == SCM_CACHE_LFU) {
+        bucket_add(bucket_after(s, &s->fhead, 1), n);
+    } else {
+        lru_push(s, n);
+    }
+}
+
+static void node_unlink(ScmCacheCore *c, cache_node *n)
+{
+    if (c->policy == SCM_CACHE_LFU) bucket_remove(n);
+    else lru_unlink(n);
+}
+
+static void node_touch(ScmCacheCore *c, cache_shard *s, cache_node *n)
+{
+    if (c->policy == SCM_CACHE_LFU) {
+        freq_bucket *b = n->bucket;
+        /* create the next bucket before B may go away */
+        freq_bucket *nb = bucket_after(s, b, b->freq + 1);
+        bucket_remove(n);
+        bucket_add(nb, n);
+    } else if (s->lru.next != n) {
+        lru_unlink(n);
+        lru_push(s, n);
+    }
+}
+
+static cache_node *victim(ScmCacheCore *c, cache_shard *s)
+{
+    if (c->policy == SCM_CACHE_LFU) return s->fhead.next->nodes->prev;
+    else return s->lru.prev;
+}
+
+static void shard_reset(ScmCacheCore *c, cache_shard *s)
+{
+    s->lru.next = s->lru.prev = &s->lru;
+    s->fhead.next = s->fhead.prev = &s->fhead;
+    s->count = 0;
+    if (s->sketch) {
+        memset(s->sketch, 0, ((size_t)1 << (64 - s->sshift)) * SKETCH_DEPTH);
+        s->additions = 0;
+    }
+}
+
+/*=====================================================
+ * Operations on a shard.  Called with the shard locked.
+ */
+
+static cache_node *shard_find(cache_shard *s, ScmObj key)
+{
+    ScmDictEntry *e = Scm_HashCoreSearch(&s->table, (intptr_t)key,
+                                         SCM_DICT_GET);
+    return e ? (cache_node*)e->value : NULL;
+}
+
+static void shard_remove(ScmCacheCore *c, cache_shard *s, cache_node *n)
+{
+    node_unlink(c, n);
+    Scm_HashCoreSearch(&s->table, (intptr_t)n->key, SCM_DICT_DELETE);
+    s->count--;
+}
+
+static ScmObj shard_check(ScmCacheCore *c, cache_shard *s,
+                          ScmObj key, uint64_t h)
+{
+    if (c->policy == SCM_CACHE_TINYLFU) sketch_increment(s, h);
+    cache_node *n = shard_find(s, key);
+    if (n == NULL) {
+        s->misses++;
+        return SCM_FALSE;
+    }
+    s->hits++;
+    node_touch(c, s, n);
+    return Scm_Cons(key, n->value);
+}
+
+static int shard_put(ScmCacheCore *c, cache_shard *s,
+                     ScmObj key, ScmObj value, uint64_t h)
+{
+    cache_node *n = shard_find(s, key);
+    if (n != NULL) {
+        n->value = value;
+        node_touch(c, s, n);
+        return TRUE;
+    }
+    if (c->policy == SCM_CACHE_TINYLFU) sketch_increment(s, h);
+    if (s->count >= s->capacity) {
+        cache_node *v = victim(c, s);
+        if (c->policy == SCM_CACHE_TINYLFU
+            && sketch_estimate(s, v->hash) >= sketch_estimate(s, h)) {
+            s->rejections++;
+            return FALSE;
+        }
+        shard_remove(c, s, v);
+        s->evictions++;
+    }
+    n = SCM_NEW(cache_node);
+    n->key = key;
+    n->value = value;
+    n->hash = h;
+    n->bucket = NULL;
+    ScmDictEntry *e = Scm_HashCoreSearch(&s->table, (intptr_t)key,
+                                         SCM_DICT_CREATE);
+    e->value = (intptr_t)n;
+    node_link(c, s, n);
+    s->count++;
+    return TRUE;
+}
+
+/* Runs STMT with the shard locked if needed.  STMT may raise an error
+   through the hash function or the comparison of keys. */
+#define WITH_SHARD(c, s, stmt)                                          \
+    do {                                                                \
+        if ((c)->locking) {                                             \
+            (void)SCM_INTERNAL_MUTEX_LOCK((s)->mutex);                  \
+            SCM_UNWIND_PROTECT { stmt; }                                \
+            SCM_WHEN_ERROR {                                            \
+                (void)SCM_INTERNAL_MUTEX_UNLOCK((s)->mutex);            \
+                SCM_NEXT_HANDLER;                                       \
+            } SCM_END_PROTECT;                                          \
+            (void)SCM_INTERNAL_MUTEX_UNLOCK((s)->mutex);                \
+        } else {                                                        \
+            stmt;                                                       \
+        }                                                               \
+    } while (0)
+
+/*=====================================================
+ * API
+ */
+
+ScmObj Scm__MakeCacheCore(int policy, ScmSmallInt capacity,
+                          ScmHashType type, int nshards, int locking)
+{
+    ScmHashCompareProc *cmpfn;
+
+    if (policy < SCM_CACHE_LRU || policy > SCM_CACHE_TINYLFU) {
+        Scm_Error("invalid cache policy: %d", policy);
+    }
+    if (capacity <= 0) {
+        Scm_Error("cache capacity must be positive, but got %ld", capacity);
+    }
+    if (nshards <= 0) {
+        Scm_Error("number of shards must be positive, but got %d", nshards);
+    }
+    if (type != SCM_HASH_EQ && type != SCM_HASH_EQV
+        && type != SCM_HASH_EQUAL && type != SCM_HASH_STRING) {
+        Scm_Error("unsupported hash type for a cache: %d", type);
+    }
+
+    ScmCacheCore *c = SCM_NEW(ScmCacheCore);
+    SCM_SET_CLASS(c, SCM_CLASS_CACHE_CORE);
+    c->policy = policy;
+    c->locking = locking;
+    c->type = type;
+    Scm_HashCoreTypeToProcs(type, &c->hashfn, &cmpfn);
+    c->capacity = capacity;
+    c->nshards = nshards;
+    c->shards = SCM_NEW_ARRAY(cache_shard, nshards);
+
+    ScmSmallInt cap = (capacity + nshards - 1) / nshards;
+    for (int i=0; i<nshards; i++) {
+        cache_shard *s = &c->shards[i];
+        memset(s, 0, sizeof(cache_shard));
+        Scm_HashCoreInitSimple(&s->table, type, 0, NULL);
+        s->capacity = cap;
+        if (policy == SCM_CACHE_TINYLFU) {
+            int log2w = 4;
+            while (((ScmSmallInt)1 << log2w) < cap && log2w < 30) log2w++;
+            s->sshift = 64 - log2w;
+            s->sketch = SCM_NEW_ATOMIC2(uint8_t*,
+                                        ((size_t)1 << log2w) * SKETCH_DEPTH);
+            s->resetAt = ((u_long)1 << log2w) * 10;
+        }
+        shard_reset(c, s);
+        SCM_INTERNAL_MUTEX_INIT(s->mutex);
+    }
+    return SCM_OBJ(c);
+}
+
+ScmObj Scm__CacheCoreCheck(ScmCacheCore *c, ScmObj key)
+{
+    uint64_t h = key_hash(c, key);
+    cache_shard *s = shard_of(c, h);
+    ScmObj r = SCM_FALSE;
+    WITH_SHARD(c, s, r = shard_check(c, s, key, h));
+    return r;
+}
+
+ScmObj Scm__CacheCorePeek(ScmCacheCore *c, ScmObj key, ScmObj fallback)
+{
+    uint64_t h = key_hash(c, key);
+    cache_shard *s = shard_of(c, h);
+    cache_node *n = NULL;
+    ScmObj r = fallback;
+    WITH_SHARD(c, s, n = shard_find(s, key); if (n) r = n->value);
+    return r;
+}
+
+int Scm__CacheCorePut(ScmCacheCore *c, ScmObj key, ScmObj value)
+{
+    uint64_t h = key_hash(c, key);
+    cache_shard *s = shard_of(c, h);
+    int r = FALSE;
+    WITH_SHARD(c, s, r = shard_put(c, s, key, value, h));
+    return r;
+}
+
+int Scm__CacheCoreDelete(ScmCacheCore *c, ScmObj key)
+{
+    uint64_t h = key_hash(c, key);
+    cache_shard *s = shard_of(c, h);
+    cache_node *n = NULL;
+    WITH_SHARD(c, s, n = shard_find(s, key); if (n) shard_remove(c, s, n));
+    return n != NULL;
+}
+
+void Scm__CacheCoreClear(ScmCacheCore *c)
+{
+    for (int i=0; i<c->nshards; i++) {
+        cache_shard *s = &c->shards[i];
+        WITH_SHARD(c, s, Scm_HashCoreClear(&s->table); shard_reset(c, s));
+    }
+}
+
+ScmSmallInt Scm__CacheCoreCount(ScmCacheCore *c)
+{
+    ScmSmallInt count = 0;
+    for (int i=0; i<c->nshards; i++) count += c->shards[i].count;
+    return count;
+}
+
+ScmObj Scm__CacheCoreToAlist(ScmCacheCore *c)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    for (int i=0; i<c->nshards; i++) {
+        cache_shard *s = &c->shards[i];
+        ScmHashIter iter;
+        ScmDictEntry *e;
+        /* no user code can run while we iterate */
+        if (c->locking) (void)SCM_INTERNAL_MUTEX_LOCK(s->mutex);
+        Scm_HashIterInit(&iter, &s->table);
+        while ((e = Scm_HashIterNext(&iter)) != NULL) {
+            cache_node *n = (cache_node*)e->value;
+            SCM_APPEND1(h, t, Scm_Cons(n->key, n->value));
+        }
+        if (c->locking) (void)SCM_INTERNAL_MUTEX_UNLOCK(s->mutex);
+    }
+    return h;
+}
+
+/* The counters are read without the lock; they're just a snapshot. */
+ScmObj Scm__CacheCoreStats(ScmCacheCore *c)
+{
+    u_long hits = 0, misses = 0, evictions = 0, rejections = 0;
+    for (int i=0; i<c->nshards; i++) {
+        cache_shard *s = &c->shards[i];
+        hits += s->hits;
+        misses += s->misses;
+        evictions += s->evictions;
+        rejections += s->rejections;
+    }
+    return SCM_LIST4(Scm_MakeIntegerU(hits), Scm_MakeIntegerU(misses),
+                     Scm_MakeIntegerU(evictions),
+                     Scm_MakeIntegerU(rejections));
+}
+
+void Scm__InitCacheCore(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_CacheCoreClass, "<cache-core>", mod, NULL, 0);
+}
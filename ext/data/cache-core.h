@@ -0,0 +1,86 @@
+/*
+ * cache-core.h - native cache tables for data.cache
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_DATA_CACHE_CORE_H
+#define GAUCHE_DATA_CACHE_CORE_H
+
+/* A bounded key-value table with an eviction policy, behind the
+ * native caches of data.cache.  The keys are compared by one of the
+ * builtin hash types other than SCM_HASH_GENERAL.
+ *
+ * The table can be split into shards by the hash value of the key,
+ * each of which has its own capacity and, if LOCKING is given to
+ * Scm__MakeCacheCore, its own mutex.
+ */
+typedef struct ScmCacheCoreRec ScmCacheCore;
+
+SCM_CLASS_DECL(Scm_CacheCoreClass);
+#define SCM_CLASS_CACHE_CORE     (&Scm_CacheCoreClass)
+#define SCM_CACHE_CORE(obj)      ((ScmCacheCore*)(obj))
+#define SCM_CACHE_CORE_P(obj)    SCM_XTYPEP(obj, SCM_CLASS_CACHE_CORE)
+
+/* Eviction policies */
+enum {
+    SCM_CACHE_LRU,              /* least recently used */
+    SCM_CACHE_LFU,              /* least frequently used, LRU among ties */
+    SCM_CACHE_TINYLFU           /* LRU, and a new entry is admitted only
+                                   if it's used more often than the one
+                                   it would evict */
+};
+
+extern ScmObj Scm__MakeCacheCore(int policy, ScmSmallInt capacity,
+                                 ScmHashType type, int nshards, int locking);
+
+/* Returns (key . value) and counts a hit, or returns #f and counts
+   a miss.  A hit makes the entry recently (or more frequently) used. */
+extern ScmObj Scm__CacheCoreCheck(ScmCacheCore *c, ScmObj key);
+/* Returns the value, or FALLBACK.  Doesn't change the order nor
+   the statistics. */
+extern ScmObj Scm__CacheCorePeek(ScmCacheCore *c, ScmObj key,
+                                 ScmObj fallback);
+/* Inserts or updates the entry, evicting another if the shard is full.
+   Returns FALSE if TinyLFU declined to admit a new entry. */
+extern int    Scm__CacheCorePut(ScmCacheCore *c, ScmObj key, ScmObj value);
+/* Returns TRUE if KEY was in the table. */
+extern int    Scm__CacheCoreDelete(ScmCacheCore *c, ScmObj key);
+extern void   Scm__CacheCoreClear(ScmCacheCore *c);
+extern ScmSmallInt Scm__CacheCoreCount(ScmCacheCore *c);
+/* Returns a fresh list of (key . value). */
+extern ScmObj Scm__CacheCoreToAlist(ScmCacheCore *c);
+/* Returns a list (hits misses evictions rejections). */
+extern ScmObj Scm__CacheCoreStats(ScmCacheCore *c);
+
+/* Called once at initialization. */
+extern void Scm__InitCacheCore(ScmModule *mod);
+
+#endif /* GAUCHE_DATA_CACHE_CORE_H */
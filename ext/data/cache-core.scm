@@ -0,0 +1,98 @@
+;;;
+;;; data.cache-core - native cache tables
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; Bounded hash tables with LRU, LFU or TinyLFU eviction, implemented
+;; in cache-core.c.  This is the storage of the native caches of
+;; data.cache; see there for the user-level interface.
+
+(define-module data.cache-core
+  (export <cache-core> make-cache-core cache-core?
+          cache-core-check cache-core-peek cache-core-put!
+          cache-core-delete! cache-core-clear! cache-core-count
+          cache-core->alist cache-core-stats))
+(select-module data.cache-core)
+
+(inline-stub
+ (declcode "#include \"cache-core.h\"")
+ (initcode "Scm__InitCacheCore(Scm_CurrentModule());")
+
+ (define-type <cache-core> "ScmCacheCore*" "cache core"
+   "SCM_CACHE_CORE_P" "SCM_CACHE_CORE")
+
+ (define-cproc %make-cache-core (policy::<int> capacity::<fixnum>
+                                 type::<int> nshards::<int> locking::<boolean>)
+   (return (Scm__MakeCacheCore policy capacity (cast ScmHashType type)
+                               nshards locking)))
+
+ (define-cproc cache-core? (obj) ::<boolean> (return (SCM_CACHE_CORE_P obj)))
+
+ (define-cproc cache-core-check (c::<cache-core> key) Scm__CacheCoreCheck)
+ (define-cproc cache-core-peek (c::<cache-core> key :optional (fallback #f))
+   Scm__CacheCorePeek)
+ (define-cproc cache-core-put! (c::<cache-core> key value) ::<boolean>
+   Scm__CacheCorePut)
+ (define-cproc cache-core-delete! (c::<cache-core> key) ::<boolean>
+   Scm__CacheCoreDelete)
+ (define-cproc cache-core-clear! (c::<cache-core>) ::<void>
+   Scm__CacheCoreClear)
+ (define-cproc cache-core-count (c::<cache-core>) ::<fixnum>
+   Scm__CacheCoreCount)
+ (define-cproc cache-core->alist (c::<cache-core>) Scm__CacheCoreToAlist)
+ (define-cproc cache-core-stats (c::<cache-core>) Scm__CacheCoreStats)
+
+ (define-cproc %policy-code (name::<symbol>) ::<int>
+   (cond [(SCM_EQ (SCM_OBJ name) 'lru) (return SCM_CACHE_LRU)]
+         [(SCM_EQ (SCM_OBJ name) 'lfu) (return SCM_CACHE_LFU)]
+         [(SCM_EQ (SCM_OBJ name) 'tinylfu) (return SCM_CACHE_TINYLFU)]
+         [else (Scm_Error "cache policy must be one of lru, lfu or tinylfu, \
+                           but got: %S" name)
+               (return 0)]))
+
+ (define-cproc %type-code (name::<symbol>) ::<int>
+   (cond [(SCM_EQ (SCM_OBJ name) 'eq?) (return SCM_HASH_EQ)]
+         [(SCM_EQ (SCM_OBJ name) 'eqv?) (return SCM_HASH_EQV)]
+         [(SCM_EQ (SCM_OBJ name) 'equal?) (return SCM_HASH_EQUAL)]
+         [(SCM_EQ (SCM_OBJ name) 'string=?) (return SCM_HASH_STRING)]
+         [else (Scm_Error "cache key type must be one of eq?, eqv?, equal? \
+                           or string=?, but got: %S" name)
+               (return 0)]))
+ )
+
+;; SHARDS is the number of independently locked partitions.  If it is #f,
+;; the table has a single partition without a lock, and must be used by
+;; one thread at a time.
+(define (make-cache-core policy capacity :key (type 'equal?) (shards #f))
+  (unless (or (not shards) (and (exact-integer? shards) (positive? shards)))
+    (error "shards must be #f or a positive exact integer, but got:" shards))
+  (%make-cache-core (%policy-code policy) capacity (%type-code type)
+                    (or shards 1) (and shards #t)))
@@ -0,0 +1,423 @@
+/*
+ * heap-core.c - indexed binary heap for data.heap
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gauche.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "heap-core.h"
+
+/*
+ * The heap is an array of slots, S[0] being the root and S[i]'s
+ * children being S[2i+1] and S[2i+2].  A slot has a copy of the key,
+ * unboxed for fixnums and flonums, so that comparisons don't touch
+ * the handles.  Whenever a slot moves, the index of its handle is
+ * updated.
+ *
+ * Fixnum and flonum keys can't raise an error while comparing, so we
+ * sift by moving a hole.  Other keys may raise an error (or escape)
+ * in the middle of sifting; for them we swap slots, so that the heap
+ * still contains every entry exactly once even in that case.
+ */
+
+typedef struct heap_slot_rec {
+    union {
+        ScmSmallInt i;
+        double d;
+        ScmObj o;
+    } k;
+    ScmHeapHandle *h;
+} heap_slot;
+
+struct ScmIndexedHeapRec {
+    SCM_HEADER;
+    int keytype;
+    ScmObj lt;                  /* ordering predicate for SCM_IHEAP_PROC */
+    heap_slot *slots;
+    ScmSmallInt size;
+    ScmSmallInt capacity;
+};
+
+static const char *keytype_names[] = {
+    "fixnum", "flonum", "default", "comparator"
+};
+
+static void heap_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    ScmIndexedHeap *h = SCM_INDEXED_HEAP(obj);
+    Scm_Printf(port, "#<indexed-heap %s %ld>",
+               keytype_names[h->keytype], h->size);
+}
+
+static void handle_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<heap-handle %S>", SCM_HEAP_HANDLE(obj)->key);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_IndexedHeapClass, heap_print);
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_HeapHandleClass, handle_print);
+
+/*=====================================================
+ * Keys
+ */
+
+static void set_slot_key(ScmIndexedHeap *h, heap_slot *s, ScmObj key)
+{
+    switch (h->keytype) {
+    case SCM_IHEAP_FIXNUM:
+        if (!SCM_INTP(key)) Scm_Error("fixnum key required, but got: %S", key);
+        s->k.i = SCM_INT_VALUE(key);
+        break;
+    case SCM_IHEAP_FLONUM:
+        if (!SCM_REALP(key)) Scm_Error("real number key required, but got: %S",
+                                       key);
+        s->k.d = Scm_GetDouble(key);
+        break;
+    default:
+        s->k.o = key;
+    }
+}
+
+static inline void place(ScmIndexedHeap *h, ScmSmallInt i, heap_slot s)
+{
+    h->slots[i] = s;
+    s.h->index = i;
+}
+
+/*=====================================================
+ * Sifting, unboxed keys
+ */
+
+#define DEFINE_SIFT(name, LESS)                                         \
+    static void SCM_CPP_CAT(sift_up_, name)(ScmIndexedHeap *h,          \
+                                            ScmSmallInt i)              \
+    {                                                                   \
+        heap_slot *S = h->slots;                                        \
+        heap_slot x = S[i];                                             \
+        while (i > 0) {                                                 \
+            ScmSmallInt p = (i-1)/2;                                    \
+            if (!LESS(x, S[p])) break;                                  \
+            place(h, i, S[p]);                                          \
+            i = p;                                                      \
+        }                                                               \
+        place(h, i, x);                                                 \
+    }                                                                   \
+    static void SCM_CPP_CAT(sift_down_, name)(ScmIndexedHeap *h,        \
+                                              ScmSmallInt i)            \
+    {                                                                   \
+        heap_slot *S = h->slots;                                        \
+        ScmSmallInt n = h->size;                                        \
+        heap_slot x = S[i];                                             \
+        for (;;) {                                                      \
+            ScmSmallInt c = 2*i + 1;                                    \
+            if (c >= n) break;                                          \
+            if (c+1 < n && LESS(S[c+1], S[c])) c++;                     \
+            if (!LESS(S[c], x)) break;                                  \
+            place(h, i, S[c]);                                          \
+            i = c;                                                      \
+        }                                                               \
+        place(h, i, x);                                                 \
+    }
+
+#define FIXNUM_LESS(a, b)  ((a).k.i < (b).k.i)
+#define FLONUM_LESS(a, b)  ((a).k.d < (b).k.d)
+
+DEFINE_SIFT(fixnum, FIXNUM_LESS)
+DEFINE_SIFT(flonum, FLONUM_LESS)
+
+/*=====================================================
+ * Sifting, boxed keys
+ */
+
+/* May call back Scheme.  We re-read slots after each call, since the
+   callback may have touched the heap. */
+static int generic_less(ScmIndexedHeap *h, ScmObj a, ScmObj b)
+{
+    if (h->keytype == SCM_IHEAP_DEFAULT) return Scm_Compare(a, b) < 0;
+    return !SCM_FALSEP(Scm_ApplyRec2(h->lt, a, b));
+}
+
+static void swap_slots(ScmIndexedHeap *h, ScmSmallInt i, ScmSmallInt j)
+{
+    heap_slot t = h->slots[i];
+    place(h, i, h->slots[j]);
+    place(h, j, t);
+}
+
+static void sift_up_generic(ScmIndexedHeap *h, ScmSmallInt i)
+{
+    while (i > 0 && i < h->size) {
+        ScmSmallInt p = (i-1)/2;
+        if (!generic_less(h, h->slots[i].k.o, h->slots[p].k.o)) break;
+        swap_slots(h, i, p);
+        i = p;
+    }
+}
+
+static void sift_down_generic(ScmIndexedHeap *h, ScmSmallInt i)
+{
+    for (;;) {
+        ScmSmallInt c = 2*i + 1;
+        if (c >= h->size) break;
+        if (c+1 < h->size
+            && generic_less(h, h->slots[c+1].k.o, h->slots[c].k.o)) c++;
+        if (c >= h->size
+            || !generic_less(h, h->slots[c].k.o, h->slots[i].k.o)) break;
+        swap_slots(h, i, c);
+        i = c;
+    }
+}
+
+static void sift_up(ScmIndexedHeap *h, ScmSmallInt i)
+{
+    switch (h->keytype) {
+    case SCM_IHEAP_FIXNUM: sift_up_fixnum(h, i); break;
+    case SCM_IHEAP_FLONUM: sift_up_flonum(h, i); break;
+    default:               sift_up_generic(h, i);
+    }
+}
+
+static void sift_down(ScmIndexedHeap *h, ScmSmallInt i)
+{
+    switch (h->keytype) {
+    case SCM_IHEAP_FIXNUM: sift_down_fixnum(h, i); break;
+    case SCM_IHEAP_FLONUM: sift_down_flonum(h, i); break;
+    default:               sift_down_generic(h, i);
+    }
+}
+
+/* Returns TRUE if slot I is less than its parent. */
+static int less_than_parent(ScmIndexedHeap *h, ScmSmallInt i)
+{
+    if (i == 0) return FALSE;
+    heap_slot *a = &h->slots[i], *b = &h->slots[(i-1)/2];
+    switch (h->keytype) {
+    case SCM_IHEAP_FIXNUM: return FIXNUM_LESS(*a, *b);
+    case SCM_IHEAP_FLONUM: return FLONUM_LESS(*a, *b);
+    default:               return generic_less(h, a->k.o, b->k.o);
+    }
+}
+
+/* Restores the heap property around slot I after its key changed. */
+static void fix_at(ScmIndexedHeap *h, ScmSmallInt i)
+{
+    if (less_than_parent(h, i)) sift_up(h, i);
+    else sift_down(h, i);
+}
+
+/*=====================================================
+ * API
+ */
+
+ScmObj Scm__MakeIndexedHeap(int keytype, ScmObj lt, ScmSmallInt capacity)
+{
+    if (keytype < SCM_IHEAP_FIXNUM || keytype > SCM_IHEAP_PROC) {
+        Scm_Error("invalid key type of indexed heap: %d", keytype);
+    }
+    if (keytype == SCM_IHEAP_PROC && !SCM_PROCEDUREP(lt)) {
+        Scm_Error("ordering predicate required, but got: %S", lt);
+    }
+    if (capacity < 16) capacity = 16;
+    ScmIndexedHeap *h = SCM_NEW(ScmIndexedHeap);
+    SCM_SET_CLASS(h, SCM_CLASS_INDEXED_HEAP);
+    h->keytype = keytype;
+    h->lt = (keytype == SCM_IHEAP_PROC) ? lt : SCM_FALSE;
+    h->slots = SCM_NEW_ARRAY(heap_slot, capacity);
+    h->size = 0;
+    h->capacity = capacity;
+    return SCM_OBJ(h);
+}
+
+ScmSmallInt Scm__IndexedHeapNumEntries(ScmIndexedHeap *h)
+{
+    return h->size;
+}
+
+static void ensure_capacity(ScmIndexedHeap *h, ScmSmallInt n)
+{
+    if (n <= h->capacity) return;
+    ScmSmallInt newcap = h->capacity;
+    while (newcap < n) newcap *= 2;
+    heap_slot *s = SCM_NEW_ARRAY(heap_slot, newcap);
+    memcpy(s, h->slots, sizeof(heap_slot) * h->size);
+    h->slots = s;
+    h->capacity = newcap;
+}
+
+static ScmHeapHandle *make_handle(ScmObj key, ScmObj value)
+{
+    ScmHeapHandle *e = SCM_NEW(ScmHeapHandle);
+    SCM_SET_CLASS(e, SCM_CLASS_HEAP_HANDLE);
+    e->key = key;
+    e->value = value;
+    e->heap = NULL;
+    e->index = -1;
+    return e;
+}
+
+/* Appends an entry at the end, without sifting. */
+static ScmHeapHandle *append_entry(ScmIndexedHeap *h, ScmObj key, ScmObj value)
+{
+    heap_slot s;
+    set_slot_key(h, &s, key);   /* may raise; nothing's changed yet */
+    s.h = make_handle(key, value);
+    s.h->heap = h;
+    place(h, h->size++, s);
+    return s.h;
+}
+
+ScmObj Scm__IndexedHeapPush(ScmIndexedHeap *h, ScmObj key, ScmObj value)
+{
+    ensure_capacity(h, h->size + 1);
+    ScmHeapHandle *e = append_entry(h, key, value);
+    sift_up(h, e->index);
+    return SCM_OBJ(e);
+}
+
+ScmObj Scm__IndexedHeapPushAll(ScmIndexedHeap *h,
+                               ScmVector *keys, ScmVector *values)
+{
+    ScmSmallInt n = SCM_VECTOR_SIZE(keys);
+    if (values && SCM_VECTOR_SIZE(values) != n) {
+        Scm_Error("keys and values differ in length: %S vs %S",
+                  SCM_OBJ(keys), SCM_OBJ(values));
+    }
+    if (h->keytype <= SCM_IHEAP_FLONUM) {
+        /* check keys first, so that an error leaves the heap intact */
+        heap_slot dummy;
+        for (ScmSmallInt i=0; i<n; i++) {
+            set_slot_key(h, &dummy, SCM_VECTOR_ELEMENT(keys, i));
+        }
+    }
+    ScmObj r = Scm_MakeVector(n, SCM_FALSE);
+    ScmSmallInt start = h->size;
+    ensure_capacity(h, start + n);
+    for (ScmSmallInt i=0; i<n; i++) {
+        ScmObj v = values ? SCM_VECTOR_ELEMENT(values, i) : SCM_FALSE;
+        SCM_VECTOR_ELEMENT(r, i) =
+            SCM_OBJ(append_entry(h, SCM_VECTOR_ELEMENT(keys, i), v));
+    }
+    if (n > start) {
+        /* Floyd's heapify is cheaper than n sift-ups */
+        for (ScmSmallInt i=h->size/2-1; i>=0; i--) sift_down(h, i);
+    } else {
+        for (ScmSmallInt i=start; i<h->size; i++) sift_up(h, i);
+    }
+    return r;
+}
+
+ScmObj Scm__IndexedHeapFindMin(ScmIndexedHeap *h, ScmObj fallback)
+{
+    if (h->size == 0) {
+        if (SCM_UNBOUNDP(fallback)) Scm_Error("indexed heap is empty: %S", h);
+        return fallback;
+    }
+    return SCM_OBJ(h->slots[0].h);
+}
+
+static void check_handle(ScmIndexedHeap *h, ScmHeapHandle *e)
+{
+    if (e->heap != h) {
+        Scm_Error("heap handle %S isn't in the heap %S", SCM_OBJ(e), SCM_OBJ(h));
+    }
+}
+
+static void remove_at(ScmIndexedHeap *h, ScmSmallInt i)
+{
+    ScmHeapHandle *e = h->slots[i].h;
+    ScmSmallInt last = --h->size;
+    if (i != last) place(h, i, h->slots[last]);
+    memset(&h->slots[last], 0, sizeof(heap_slot)); /* for GC */
+    e->heap = NULL;
+    e->index = -1;
+    if (i != last) fix_at(h, i);
+}
+
+ScmObj Scm__IndexedHeapPopMin(ScmIndexedHeap *h)
+{
+    if (h->size == 0) Scm_Error("indexed heap is empty: %S", h);
+    ScmObj r = SCM_OBJ(h->slots[0].h);
+    remove_at(h, 0);
+    return r;
+}
+
+void Scm__IndexedHeapUpdate(ScmIndexedHeap *h, ScmHeapHandle *e,
+                            ScmObj key, int decrease)
+{
+    check_handle(h, e);
+    heap_slot s = h->slots[e->index];
+    set_slot_key(h, &s, key);
+    if (decrease) {
+        int increased;
+        switch (h->keytype) {
+        case SCM_IHEAP_FIXNUM:
+            increased = FIXNUM_LESS(h->slots[e->index], s); break;
+        case SCM_IHEAP_FLONUM:
+            increased = FLONUM_LESS(h->slots[e->index], s); break;
+        default:
+            increased = generic_less(h, e->key, key);
+            check_handle(h, e); /* in case the predicate removed it */
+        }
+        if (increased) {
+            Scm_Error("new key %S is greater than the current key %S",
+                      key, e->key);
+        }
+    }
+    e->key = key;
+    h->slots[e->index].k = s.k;
+    fix_at(h, e->index);
+}
+
+void Scm__IndexedHeapDelete(ScmIndexedHeap *h, ScmHeapHandle *e)
+{
+    check_handle(h, e);
+    remove_at(h, e->index);
+}
+
+void Scm__IndexedHeapClear(ScmIndexedHeap *h)
+{
+    for (ScmSmallInt i=0; i<h->size; i++) {
+        h->slots[i].h->heap = NULL;
+        h->slots[i].h->index = -1;
+    }
+    memset(h->slots, 0, sizeof(heap_slot) * h->size);
+    h->size = 0;
+}
+
+void Scm__InitHeapCore(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_IndexedHeapClass, "<indexed-heap>", mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_HeapHandleClass, "<heap-handle>", mod, NULL, 0);
+}
@@ -0,0 +1,99 @@
+/*
+ * heap-core.h - indexed binary heap for data.heap
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_DATA_HEAP_CORE_H
+#define GAUCHE_DATA_HEAP_CORE_H
+
+/* A binary min-heap of (key, value) entries, behind the indexed heap
+ * of data.heap.  Each entry is a handle object that knows its position
+ * in the heap, so that its key can be changed, or the entry can be
+ * removed, in O(log n).
+ *
+ * Fixnum and flonum keys are compared inline.  Other keys are compared
+ * by Scm_Compare, or by the ordering predicate of a comparator.
+ */
+typedef struct ScmIndexedHeapRec ScmIndexedHeap;
+
+typedef struct ScmHeapHandleRec {
+    SCM_HEADER;
+    ScmObj key;
+    ScmObj value;
+    ScmIndexedHeap *heap;       /* NULL if not in a heap */
+    ScmSmallInt index;          /* position in the heap, or -1 */
+} ScmHeapHandle;
+
+SCM_CLASS_DECL(Scm_IndexedHeapClass);
+#define SCM_CLASS_INDEXED_HEAP   (&Scm_IndexedHeapClass)
+#define SCM_INDEXED_HEAP(obj)    ((ScmIndexedHeap*)(obj))
+#define SCM_INDEXED_HEAP_P(obj)  SCM_XTYPEP(obj, SCM_CLASS_INDEXED_HEAP)
+
+SCM_CLASS_DECL(Scm_HeapHandleClass);
+#define SCM_CLASS_HEAP_HANDLE    (&Scm_HeapHandleClass)
+#define SCM_HEAP_HANDLE(obj)     ((ScmHeapHandle*)(obj))
+#define SCM_HEAP_HANDLE_P(obj)   SCM_XTYPEP(obj, SCM_CLASS_HEAP_HANDLE)
+
+/* Key types */
+enum {
+    SCM_IHEAP_FIXNUM,           /* fixnums */
+    SCM_IHEAP_FLONUM,           /* real numbers, compared as doubles */
+    SCM_IHEAP_DEFAULT,          /* anything, compared by Scm_Compare */
+    SCM_IHEAP_PROC              /* compared by the ordering predicate */
+};
+
+/* LT is the ordering predicate for SCM_IHEAP_PROC, ignored otherwise. */
+extern ScmObj Scm__MakeIndexedHeap(int keytype, ScmObj lt,
+                                   ScmSmallInt capacity);
+extern ScmSmallInt Scm__IndexedHeapNumEntries(ScmIndexedHeap *h);
+
+/* Returns a new handle. */
+extern ScmObj Scm__IndexedHeapPush(ScmIndexedHeap *h, ScmObj key, ScmObj value);
+/* Adds the entries at once, in O(n).  Returns a vector of new handles
+   in the order of KEYS. */
+extern ScmObj Scm__IndexedHeapPushAll(ScmIndexedHeap *h,
+                                      ScmVector *keys, ScmVector *values);
+/* Returns the handle of the minimum entry, or FALLBACK if empty. */
+extern ScmObj Scm__IndexedHeapFindMin(ScmIndexedHeap *h, ScmObj fallback);
+/* Removes and returns the handle of the minimum entry. */
+extern ScmObj Scm__IndexedHeapPopMin(ScmIndexedHeap *h);
+/* Changes the key of the entry.  If DECREASE is TRUE, it's an error
+   to increase the key. */
+extern void   Scm__IndexedHeapUpdate(ScmIndexedHeap *h, ScmHeapHandle *e,
+                                     ScmObj key, int decrease);
+extern void   Scm__IndexedHeapDelete(ScmIndexedHeap *h, ScmHeapHandle *e);
+extern void   Scm__IndexedHeapClear(ScmIndexedHeap *h);
+
+/* Called once at initialization. */
+extern void Scm__InitHeapCore(ScmModule *mod);
+
+#endif /* GAUCHE_DATA_HEAP_CORE_H */
@@ -0,0 +1,118 @@
+;;;
+;;; data.heap-core - indexed binary heap
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; A binary min-heap whose entries are handles, implemented in
+;; heap-core.c.  The user-level interface is exported from data.heap.
+
+(define-module data.heap-core
+  (export <indexed-heap> <heap-handle>
+          make-indexed-heap build-indexed-heap indexed-heap?
+          indexed-heap-num-entries indexed-heap-empty?
+          indexed-heap-push! indexed-heap-push-all!
+          indexed-heap-find-min indexed-heap-pop-min!
+          indexed-heap-update-key! indexed-heap-decrease-key!
+          indexed-heap-delete! indexed-heap-clear!
+          heap-handle? heap-handle-key heap-handle-value
+          heap-handle-value-set! heap-handle-active?))
+(select-module data.heap-core)
+
+(inline-stub
+ (declcode "#include \"heap-core.h\"")
+ (initcode "Scm__InitHeapCore(Scm_CurrentModule());")
+
+ (define-type <indexed-heap> "ScmIndexedHeap*" "indexed heap"
+   "SCM_INDEXED_HEAP_P" "SCM_INDEXED_HEAP")
+ (define-type <heap-handle> "ScmHeapHandle*" "heap handle"
+   "SCM_HEAP_HANDLE_P" "SCM_HEAP_HANDLE")
+
+ (define-cproc %make-indexed-heap (keytype::<int> lt capacity::<fixnum>)
+   Scm__MakeIndexedHeap)
+
+ (define-cproc indexed-heap? (obj) ::<boolean>
+   (return (SCM_INDEXED_HEAP_P obj)))
+ (define-cproc indexed-heap-num-entries (h::<indexed-heap>) ::<fixnum>
+   Scm__IndexedHeapNumEntries)
+ (define-cproc indexed-heap-empty? (h::<indexed-heap>) ::<boolean>
+   (return (== (Scm__IndexedHeapNumEntries h) 0)))
+
+ (define-cproc indexed-heap-push! (h::<indexed-heap> key
+                                   :optional (value #f))
+   Scm__IndexedHeapPush)
+ (define-cproc indexed-heap-push-all! (h::<indexed-heap> keys::<vector>
+                                       :optional (vals::<vector>? #f))
+   Scm__IndexedHeapPushAll)
+ (define-cproc indexed-heap-find-min (h::<indexed-heap> :optional fallback)
+   Scm__IndexedHeapFindMin)
+ (define-cproc indexed-heap-pop-min! (h::<indexed-heap>)
+   Scm__IndexedHeapPopMin)
+ (define-cproc indexed-heap-update-key! (h::<indexed-heap> e::<heap-handle>
+                                         key)
+   ::<void>
+   (Scm__IndexedHeapUpdate h e key FALSE))
+ (define-cproc indexed-heap-decrease-key! (h::<indexed-heap> e::<heap-handle>
+                                           key)
+   ::<void>
+   (Scm__IndexedHeapUpdate h e key TRUE))
+ (define-cproc indexed-heap-delete! (h::<indexed-heap> e::<heap-handle>)
+   ::<void> Scm__IndexedHeapDelete)
+ (define-cproc indexed-heap-clear! (h::<indexed-heap>) ::<void>
+   Scm__IndexedHeapClear)
+
+ (define-cproc heap-handle? (obj) ::<boolean>
+   (return (SCM_HEAP_HANDLE_P obj)))
+ (define-cproc heap-handle-key (e::<heap-handle>) (return (-> e key)))
+ (define-cproc heap-handle-value (e::<heap-handle>) (return (-> e value)))
+ (define-cproc heap-handle-value-set! (e::<heap-handle> v) ::<void>
+   (set! (-> e value) v))
+ (define-cproc heap-handle-active? (e::<heap-handle>) ::<boolean>
+   (return (!= (-> e heap) NULL)))
+ )
+
+;; KEY-TYPE is fixnum, flonum, or an ordered comparator.  Flonum keys
+;; may be any real numbers; they're compared as doubles.
+(define (make-indexed-heap :optional (key-type default-comparator)
+                                     (capacity 0))
+  (cond [(eq? key-type 'fixnum) (%make-indexed-heap 0 #f capacity)]
+        [(eq? key-type 'flonum) (%make-indexed-heap 1 #f capacity)]
+        [(eq? key-type default-comparator) (%make-indexed-heap 2 #f capacity)]
+        [(and (comparator? key-type) (comparator-ordered? key-type))
+         (%make-indexed-heap 3 (comparator-ordering-predicate key-type)
+                             capacity)]
+        [else (error "make-indexed-heap requires fixnum, flonum \
+                      or an ordered comparator, but got:" key-type)]))
+
+;; Returns the heap and a vector of handles in the order of KEYS.
+(define (build-indexed-heap key-type keys :optional (vals #f))
+  (let1 h (make-indexed-heap key-type (vector-length keys))
+    (values h (indexed-heap-push-all! h keys vals))))
@@ -0,0 +1,371 @@
+/*
+ * imap-core.c - persistent balanced tree for data.imap
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gauche.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "imap-core.h"
+
+/*
+ * Weight-balanced tree, with the parameters (delta, gamma) = (3, 2)
+ * shown to be correct by Hirai and Yamamoto.  The weight of a subtree
+ * is its size + 1.  A node is balanced if neither child's weight
+ * exceeds DELTA times the other's; when an update breaks it, we do a
+ * single rotation if the inner grandchild is lighter than GAMMA times
+ * the outer one, or a double rotation otherwise.
+ *
+ * Nodes are never modified once they're made visible, so an error
+ * (or an escape) from the comparator in the middle of an update
+ * leaves every tree intact.
+ */
+
+struct ScmIMapNodeRec {
+    ScmObj kv;                  /* (key . value) */
+    ScmIMapNode *left;
+    ScmIMapNode *right;
+    ScmSmallInt size;
+};
+
+#define DELTA  3
+#define GAMMA  2
+
+#define SIZE(n)    ((n)? (n)->size : 0)
+#define WEIGHT(n)  (SIZE(n) + 1)
+#define KEY(n)     SCM_CAR((n)->kv)
+
+static void imap_tree_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<imap-tree %ld>", SIZE(SCM_IMAP_TREE(obj)->root));
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_IMapTreeClass, imap_tree_print);
+
+/*=====================================================
+ * Comparison
+ */
+
+/* Same as tree-map's, plus inline fixnum comparison. */
+static int imap_cmp(ScmComparator *c, ScmObj x, ScmObj y)
+{
+    if (c->flags & SCM_COMPARATOR_NATIVE_COMPARE) {
+        if (SCM_INTP(x) && SCM_INTP(y)
+            && ((c->flags & SCM_COMPARATOR_ANY_TYPE)
+                || (SCM_COMPARATOR_TYPE_TAG(c)
+                    == SCM_COMPARATOR_TYPE_EXACT_INTEGER))) {
+            ScmSmallInt a = SCM_INT_VALUE(x), b = SCM_INT_VALUE(y);
+            return (a < b)? -1 : (a > b)? 1 : 0;
+        }
+        if (Scm_ComparatorTestType(c, x) && Scm_ComparatorTestType(c, y)) {
+            return Scm_Compare(x, y);
+        }
+    }
+    ScmObj r = Scm_ApplyRec2(Scm_ComparatorComparisonProcedure(c), x, y);
+    if (!SCM_INTP(r)) {
+        Scm_Error("compare procedure of imap's comparator %S returned "
+                  "non-integral value: %S", c, r);
+    }
+    return (int)SCM_INT_VALUE(r);
+}
+
+/*=====================================================
+ * Nodes
+ */
+
+static ScmIMapNode *make_node(ScmObj kv, ScmIMapNode *l, ScmIMapNode *r)
+{
+    ScmIMapNode *n = SCM_NEW(ScmIMapNode);
+    n->kv = kv;
+    n->left = l;
+    n->right = r;
+    n->size = SIZE(l) + SIZE(r) + 1;
+    return n;
+}
+
+/* Makes a node, rotating it if L and R are out of balance by one
+   insertion or deletion. */
+static ScmIMapNode *balance(ScmObj kv, ScmIMapNode *l, ScmIMapNode *r)
+{
+    if (WEIGHT(r) > DELTA*WEIGHT(l)) {
+        ScmIMapNode *rl = r->left, *rr = r->right;
+        if (WEIGHT(rl) < GAMMA*WEIGHT(rr)) {
+            return make_node(r->kv, make_node(kv, l, rl), rr);
+        } else {
+            return make_node(rl->kv, make_node(kv, l, rl->left),
+                             make_node(r->kv, rl->right, rr));
+        }
+    }
+    if (WEIGHT(l) > DELTA*WEIGHT(r)) {
+        ScmIMapNode *ll = l->left, *lr = l->right;
+        if (WEIGHT(lr) < GAMMA*WEIGHT(ll)) {
+            return make_node(l->kv, ll, make_node(kv, lr, r));
+        } else {
+            return make_node(lr->kv, make_node(l->kv, ll, lr->left),
+                             make_node(kv, lr->right, r));
+        }
+    }
+    return make_node(kv, l, r);
+}
+
+static ScmIMapNode *insert(ScmComparator *c, ScmIMapNode *n,
+                           ScmObj key, ScmObj kv)
+{
+    if (n == NULL) return make_node(kv, NULL, NULL);
+    int r = imap_cmp(c, key, KEY(n));
+    if (r < 0) return balance(n->kv, insert(c, n->left, key, kv), n->right);
+    if (r > 0) return balance(n->kv, n->left, insert(c, n->right, key, kv));
+    return make_node(kv, n->left, n->right);
+}
+
+/* Removes the minimum node of N and stores its pair in *KV. */
+static ScmIMapNode *delete_min(ScmIMapNode *n, ScmObj *kv)
+{
+    if (n->left == NULL) {
+        *kv = n->kv;
+        return n->right;
+    }
+    return balance(n->kv, delete_min(n->left, kv), n->right);
+}
+
+static ScmIMapNode *delete_max(ScmIMapNode *n, ScmObj *kv)
+{
+    if (n->right == NULL) {
+        *kv = n->kv;
+        return n->left;
+    }
+    return balance(n->kv, n->left, delete_max(n->right, kv));
+}
+
+/* Joins two subtrees of a deleted node. */
+static ScmIMapNode *glue(ScmIMapNode *l, ScmIMapNode *r)
+{
+    ScmObj kv;
+    if (l == NULL) return r;
+    if (r == NULL) return l;
+    if (SIZE(l) > SIZE(r)) {
+        ScmIMapNode *l2 = delete_max(l, &kv);
+        return balance(kv, l2, r);
+    } else {
+        ScmIMapNode *r2 = delete_min(r, &kv);
+        return balance(kv, l, r2);
+    }
+}
+
+/* Returns N itself if KEY isn't found, so that nothing is copied. */
+static ScmIMapNode *delete(ScmComparator *c, ScmIMapNode *n, ScmObj key)
+{
+    if (n == NULL) return NULL;
+    int r = imap_cmp(c, key, KEY(n));
+    if (r < 0) {
+        ScmIMapNode *l = delete(c, n->left, key);
+        return (l == n->left)? n : balance(n->kv, l, n->right);
+    }
+    if (r > 0) {
+        ScmIMapNode *rr = delete(c, n->right, key);
+        return (rr == n->right)? n : balance(n->kv, n->left, rr);
+    }
+    return glue(n->left, n->right);
+}
+
+/* Builds a perfectly balanced tree from sorted, unique pairs. */
+static ScmIMapNode *build(ScmObj *kvs, ScmSmallInt lo, ScmSmallInt hi)
+{
+    if (lo >= hi) return NULL;
+    ScmSmallInt mid = lo + (hi - lo)/2;
+    return make_node(kvs[mid], build(kvs, lo, mid), build(kvs, mid+1, hi));
+}
+
+static ScmObj make_tree(ScmComparator *cmpr, ScmIMapNode *root)
+{
+    ScmIMapTree *t = SCM_NEW(ScmIMapTree);
+    SCM_SET_CLASS(t, SCM_CLASS_IMAP_TREE);
+    t->cmpr = cmpr;
+    t->root = root;
+    return SCM_OBJ(t);
+}
+
+/*=====================================================
+ * API
+ */
+
+ScmObj Scm__MakeIMapTree(ScmComparator *cmpr)
+{
+    return make_tree(cmpr, NULL);
+}
+
+ScmSmallInt Scm__IMapTreeSize(ScmIMapTree *t)
+{
+    return SIZE(t->root);
+}
+
+ScmObj Scm__IMapTreeLookup(ScmIMapTree *t, ScmObj key)
+{
+    ScmIMapNode *n = t->root;
+    while (n) {
+        int r = imap_cmp(t->cmpr, key, KEY(n));
+        if (r == 0) return n->kv;
+        n = (r < 0)? n->left : n->right;
+    }
+    return SCM_FALSE;
+}
+
+ScmObj Scm__IMapTreePut(ScmIMapTree *t, ScmObj key, ScmObj value)
+{
+    return make_tree(t->cmpr,
+                     insert(t->cmpr, t->root, key, Scm_Cons(key, value)));
+}
+
+ScmObj Scm__IMapTreeDelete(ScmIMapTree *t, ScmObj key)
+{
+    ScmIMapNode *root = delete(t->cmpr, t->root, key);
+    if (root == t->root) return SCM_OBJ(t);
+    return make_tree(t->cmpr, root);
+}
+
+ScmObj Scm__IMapTreeMin(ScmIMapTree *t)
+{
+    ScmIMapNode *n = t->root;
+    if (n == NULL) return SCM_FALSE;
+    while (n->left) n = n->left;
+    return n->kv;
+}
+
+ScmObj Scm__IMapTreeMax(ScmIMapTree *t)
+{
+    ScmIMapNode *n = t->root;
+    if (n == NULL) return SCM_FALSE;
+    while (n->right) n = n->right;
+    return n->kv;
+}
+
+ScmObj Scm__AlistToIMapTree(ScmComparator *cmpr, ScmObj alist)
+{
+    ScmSmallInt len = Scm_Length(alist);
+    if (len < 0) Scm_Error("proper list required, but got: %S", alist);
+    if (len == 0) return make_tree(cmpr, NULL);
+
+    ScmObj *kvs = SCM_NEW_ARRAY(ScmObj, len);
+    ScmObj cp;
+    ScmSmallInt i = 0;
+    SCM_FOR_EACH(cp, alist) {
+        ScmObj p = SCM_CAR(cp);
+        if (!SCM_PAIRP(p)) Scm_Error("alist required, but got: %S", alist);
+        kvs[i++] = Scm_Cons(SCM_CAR(p), SCM_CDR(p));
+    }
+
+    /* Find out the direction, then check the rest follows it.  Equal
+       adjacent keys are merged; the later one in ALIST wins. */
+    int dir = 0;
+    ScmSmallInt n = 1;          /* number of unique pairs so far */
+    for (i = 1; i < len; i++) {
+        int r = imap_cmp(cmpr, SCM_CAR(kvs[i]), SCM_CAR(kvs[n-1]));
+        if (r == 0) { kvs[n-1] = kvs[i]; continue; }
+        if (dir == 0) dir = r;
+        else if ((r < 0) != (dir < 0)) break;
+        kvs[n++] = kvs[i];
+    }
+
+    if (i < len) {
+        /* Not sorted.  Insert one by one in the original order. */
+        ScmIMapNode *root = NULL;
+        SCM_FOR_EACH(cp, alist) {
+            ScmObj p = SCM_CAR(cp);
+            root = insert(cmpr, root, SCM_CAR(p),
+                          Scm_Cons(SCM_CAR(p), SCM_CDR(p)));
+        }
+        return make_tree(cmpr, root);
+    }
+    if (dir < 0) {
+        for (ScmSmallInt j = 0; j < n/2; j++) {
+            ScmObj tmp = kvs[j];
+            kvs[j] = kvs[n-1-j];
+            kvs[n-1-j] = tmp;
+        }
+    }
+    return make_tree(cmpr, build(kvs, 0, n));
+}
+
+static ScmObj fold_rec(ScmIMapNode *n, ScmObj proc, ScmObj seed, int reverse)
+{
+    while (n) {
+        seed = fold_rec(reverse? n->right : n->left, proc, seed, reverse);
+        seed = Scm_ApplyRec2(proc, n->kv, seed);
+        n = reverse? n->left : n->right;
+    }
+    return seed;
+}
+
+ScmObj Scm__IMapTreeFold(ScmIMapTree *t, ScmObj proc, ScmObj seed,
+                         int reverse)
+{
+    return fold_rec(t->root, proc, seed, reverse);
+}
+
+/* The height of a weight-balanced tree of size n is at most
+   log_{4/3}(n+1) < 2.5*log2(n+1). */
+typedef struct imap_iter_rec {
+    ScmIMapNode **stack;
+    int sp;
+} imap_iter;
+
+static void iter_push_left(imap_iter *it, ScmIMapNode *n)
+{
+    for (; n; n = n->left) it->stack[it->sp++] = n;
+}
+
+static ScmObj imap_iter_next(ScmObj *args, int nargs, void *data)
+{
+    imap_iter *it = (imap_iter*)data;
+    if (it->sp == 0) return SCM_EOF;
+    ScmIMapNode *n = it->stack[--it->sp];
+    iter_push_left(it, n->right);
+    return n->kv;
+}
+
+ScmObj Scm__IMapTreeIterator(ScmIMapTree *t)
+{
+    int bits = 0;
+    for (ScmSmallInt s = SIZE(t->root) + 1; s > 0; s >>= 1) bits++;
+    imap_iter *it = SCM_NEW(imap_iter);
+    it->stack = SCM_NEW_ARRAY(ScmIMapNode*, bits*5/2 + 2);
+    it->sp = 0;
+    iter_push_left(it, t->root);
+    return Scm_MakeSubr(imap_iter_next, it, 0, 0,
+                        SCM_MAKE_STR("imap-tree-iterator"));
+}
+
+void Scm__InitIMapCore(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_IMapTreeClass, "<imap-tree>", mod, NULL, 0);
+}
@@ -0,0 +1,87 @@
+/*
+ * imap-core.h - persistent balanced tree for data.imap
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_DATA_IMAP_CORE_H
+#define GAUCHE_DATA_IMAP_CORE_H
+
+/* An immutable weight-balanced tree behind data.imap.  Updates copy
+ * the path from the root to the modified node and share the rest, so
+ * every version stays valid.
+ *
+ * Each node keeps the (key . value) pair, which is what imap-min and
+ * the iterators return.  Keys are compared by the comparator; if its
+ * order coincides with Scm_Compare, we call it directly (and compare
+ * fixnums inline) instead of calling back to Scheme.
+ */
+typedef struct ScmIMapNodeRec ScmIMapNode;
+
+typedef struct ScmIMapTreeRec {
+    SCM_HEADER;
+    ScmComparator *cmpr;
+    ScmIMapNode *root;          /* NULL if empty */
+} ScmIMapTree;
+
+SCM_CLASS_DECL(Scm_IMapTreeClass);
+#define SCM_CLASS_IMAP_TREE     (&Scm_IMapTreeClass)
+#define SCM_IMAP_TREE(obj)      ((ScmIMapTree*)(obj))
+#define SCM_IMAP_TREE_P(obj)    SCM_XTYPEP(obj, SCM_CLASS_IMAP_TREE)
+
+extern ScmObj Scm__MakeIMapTree(ScmComparator *cmpr);
+extern ScmSmallInt Scm__IMapTreeSize(ScmIMapTree *t);
+
+/* Returns the (key . value) pair, or #f if KEY isn't in the tree. */
+extern ScmObj Scm__IMapTreeLookup(ScmIMapTree *t, ScmObj key);
+/* These return a new tree; T is unchanged. */
+extern ScmObj Scm__IMapTreePut(ScmIMapTree *t, ScmObj key, ScmObj value);
+extern ScmObj Scm__IMapTreeDelete(ScmIMapTree *t, ScmObj key);
+/* Returns the (key . value) pair of the minimum/maximum key, or #f. */
+extern ScmObj Scm__IMapTreeMin(ScmIMapTree *t);
+extern ScmObj Scm__IMapTreeMax(ScmIMapTree *t);
+
+/* Builds a tree from an alist.  Later entries take precedence.  If the
+   keys are sorted (in either direction), it takes O(n). */
+extern ScmObj Scm__AlistToIMapTree(ScmComparator *cmpr, ScmObj alist);
+
+/* Calls PROC with each (key . value) pair and the seed, in the
+   ascending (or descending, if REVERSE is TRUE) order of keys. */
+extern ScmObj Scm__IMapTreeFold(ScmIMapTree *t, ScmObj proc, ScmObj seed,
+                                int reverse);
+/* Returns a procedure that returns the pairs in the ascending order
+   of keys, then EOF. */
+extern ScmObj Scm__IMapTreeIterator(ScmIMapTree *t);
+
+/* Called once at initialization. */
+extern void Scm__InitIMapCore(ScmModule *mod);
+
+#endif /* GAUCHE_DATA_IMAP_CORE_H */
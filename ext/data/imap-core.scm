@@ -0,0 +1,77 @@
+;;;
+;;; data.imap-core - persistent balanced tree
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; An immutable weight-balanced tree, implemented in imap-core.c.
+;; The user-level interface is <imap> of data.imap.
+
+(define-module data.imap-core
+  (export <imap-tree>
+          make-imap-tree alist->imap-tree imap-tree?
+          imap-tree-comparator imap-tree-size
+          imap-tree-lookup imap-tree-put imap-tree-delete
+          imap-tree-min imap-tree-max
+          imap-tree-fold imap-tree-fold-right imap-tree-iterator))
+(select-module data.imap-core)
+
+(inline-stub
+ (declcode "#include \"imap-core.h\"")
+ (initcode "Scm__InitIMapCore(Scm_CurrentModule());")
+
+ (define-type <imap-tree> "ScmIMapTree*" "imap tree"
+   "SCM_IMAP_TREE_P" "SCM_IMAP_TREE")
+
+ (define-cproc make-imap-tree (cmpr::<comparator>) Scm__MakeIMapTree)
+ (define-cproc alist->imap-tree (cmpr::<comparator> alist)
+   Scm__AlistToIMapTree)
+ (define-cproc imap-tree? (obj) ::<boolean>
+   (return (SCM_IMAP_TREE_P obj)))
+ (define-cproc imap-tree-comparator (t::<imap-tree>)
+   (return (SCM_OBJ (-> t cmpr))))
+ (define-cproc imap-tree-size (t::<imap-tree>) ::<fixnum>
+   Scm__IMapTreeSize)
+
+ ;; Returns (key . value) or #f
+ (define-cproc imap-tree-lookup (t::<imap-tree> key) Scm__IMapTreeLookup)
+ (define-cproc imap-tree-put (t::<imap-tree> key value) Scm__IMapTreePut)
+ (define-cproc imap-tree-delete (t::<imap-tree> key) Scm__IMapTreeDelete)
+ (define-cproc imap-tree-min (t::<imap-tree>) Scm__IMapTreeMin)
+ (define-cproc imap-tree-max (t::<imap-tree>) Scm__IMapTreeMax)
+
+ ;; PROC takes (key . value) and seed
+ (define-cproc imap-tree-fold (t::<imap-tree> proc seed)
+   (return (Scm__IMapTreeFold t proc seed FALSE)))
+ (define-cproc imap-tree-fold-right (t::<imap-tree> proc seed)
+   (return (Scm__IMapTreeFold t proc seed TRUE)))
+ (define-cproc imap-tree-iterator (t::<imap-tree>) Scm__IMapTreeIterator)
+ )
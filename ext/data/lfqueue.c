@@ -0,0 +1,368 @@
+/*
+ * lfqueue.c - lock-free queue core for data.queue
+ *
+ *   Copyright (c) 2010-2015  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "atomic_ops.h"
+#include <gauche.h>
+#include "lfqueue.h"
+
+/*=====================================================
+ * Lock-free MPMC queue
+ *
+ *  A bounded queue is a ring of cells, each of which has a sequence
+ *  number (Vyukov's bounded MPMC queue).  A producer claims position
+ *  POS by CAS on enqPos when the cell's sequence number is 2*POS,
+ *  stores the item, then publishes it by setting the sequence to
+ *  2*POS+1.  A consumer claims POS by CAS on deqPos when the sequence
+ *  is 2*POS+1, and sets it to 2*(POS+size) to hand the cell to the
+ *  producer of the next lap.  (The original uses POS and POS+1, which
+ *  can't tell a full cell from a free one when size is 1.)
+ *  Positions only increase; AO_t doesn't wrap in practice on 64-bit
+ *  platforms.
+ *
+ *  An unbounded queue is a linked list of fixed-size segments
+ *  (FAA array queue).  Producers and consumers take slots by
+ *  fetch-and-add on the segment's indices.  A producer stores its item
+ *  by CAS on an empty slot; a consumer swaps TAKEN into it.  If the
+ *  consumer gets there first, the producer's CAS fails and it takes
+ *  another slot.  Once a segment's slots are used up, a new segment
+ *  is linked, and tail and head move on.  Segments are never reused,
+ *  so we don't need to care about ABA nor reclamation; GC collects
+ *  the segments consumers left behind.
+ *
+ *  Blocking operations spin a bit, then park on a condition variable.
+ *  A waiter increments waiting[] and retries while holding the mutex,
+ *  and the other side reads waiting[] after its operation; both with
+ *  full barriers, so either the waiter sees the change or the other
+ *  side sees the waiter and signals under the mutex.  Nonblocking
+ *  operations never touch the mutex unless someone is parked.
+ */
+
+#define SEGMENT_SIZE  256
+#define SPIN_COUNT    64
+
+enum { READER, WRITER };
+
+typedef struct CellRec {
+    volatile AO_t seq;
+    ScmObj val;
+} Cell;
+
+typedef struct SegmentRec {
+    volatile AO_t enqIdx;
+    volatile AO_t deqIdx;
+    volatile AO_t next;                 /* Segment* */
+    volatile AO_t items[SEGMENT_SIZE];  /* ScmObj, 0 or TAKEN */
+} Segment;
+
+struct ScmLfqRec {
+    long size;                  /* ring size, or -1 if unbounded */
+    /* bounded */
+    Cell *cells;
+    volatile AO_t enqPos;
+    char pad0[64];              /* keep producers and consumers apart */
+    volatile AO_t deqPos;
+    char pad1[64];
+    /* unbounded */
+    volatile AO_t head;         /* Segment* */
+    char pad2[64];
+    volatile AO_t tail;         /* Segment* */
+    char pad3[64];
+    volatile AO_t count;
+    /* parking */
+    volatile AO_t waiting[2];
+    ScmInternalMutex mutex;
+    ScmInternalCond readerWait;
+    ScmInternalCond writerWait;
+};
+
+static char taken_marker;
+#define TAKEN  ((AO_t)&taken_marker)
+
+static Segment *make_segment(void)
+{
+    Segment *s = SCM_NEW(Segment);
+    s->enqIdx = s->deqIdx = 0;
+    s->next = 0;
+    for (int i = 0; i < SEGMENT_SIZE; i++) s->items[i] = 0;
+    return s;
+}
+
+ScmLfq *Scm__MakeLfq(long maxlen)
+{
+    SCM_ASSERT(maxlen != 0);
+    ScmLfq *q = SCM_NEW(ScmLfq);
+    q->size = maxlen;
+    q->enqPos = q->deqPos = 0;
+    q->count = 0;
+    if (maxlen > 0) {
+        q->cells = SCM_NEW_ARRAY(Cell, maxlen);
+        for (long i = 0; i < maxlen; i++) {
+            q->cells[i].seq = (AO_t)(2*i);
+            q->cells[i].val = SCM_FALSE;
+        }
+        q->head = q->tail = 0;
+    } else {
+        q->cells = NULL;
+        q->head = q->tail = (AO_t)make_segment();
+    }
+    q->waiting[READER] = q->waiting[WRITER] = 0;
+    SCM_INTERNAL_MUTEX_INIT(q->mutex);
+    SCM_INTERNAL_COND_INIT(q->readerWait);
+    SCM_INTERNAL_COND_INIT(q->writerWait);
+    return q;
+}
+
+/*
+ * Bounded
+ */
+static int ring_enqueue(ScmLfq *q, ScmObj obj)
+{
+    AO_t pos = AO_load(&q->enqPos);
+    for (;;) {
+        Cell *c = &q->cells[pos % q->size];
+        long dif = (long)(AO_load_acquire(&c->seq) - 2*pos);
+        if (dif == 0) {
+            if (AO_compare_and_swap_full(&q->enqPos, pos, pos+1)) {
+                c->val = obj;
+                AO_store_release(&c->seq, 2*pos+1);
+                return TRUE;
+            }
+        } else if (dif < 0) {
+            return FALSE;       /* full */
+        }
+        pos = AO_load(&q->enqPos);
+    }
+}
+
+static int ring_dequeue(ScmLfq *q, ScmObj *result)
+{
+    AO_t pos = AO_load(&q->deqPos);
+    for (;;) {
+        Cell *c = &q->cells[pos % q->size];
+        long dif = (long)(AO_load_acquire(&c->seq) - (2*pos+1));
+        if (dif == 0) {
+            if (AO_compare_and_swap_full(&q->deqPos, pos, pos+1)) {
+                *result = c->val;
+                c->val = SCM_FALSE; /* to be friendly to GC */
+                AO_store_release(&c->seq, 2*(pos + q->size));
+                return TRUE;
+            }
+        } else if (dif < 0) {
+            return FALSE;       /* empty */
+        }
+        pos = AO_load(&q->deqPos);
+    }
+}
+
+/*
+ * Unbounded
+ */
+static AO_t swap_word(volatile AO_t *p, AO_t v)
+{
+    AO_t old;
+    do {
+        old = AO_load(p);
+    } while (!AO_compare_and_swap_full(p, old, v));
+    return old;
+}
+
+static int seg_enqueue(ScmLfq *q, ScmObj obj)
+{
+    for (;;) {
+        Segment *t = (Segment*)AO_load_full(&q->tail);
+        AO_t i = AO_fetch_and_add1_full(&t->enqIdx);
+        if (i < SEGMENT_SIZE) {
+            if (AO_compare_and_swap_full(&t->items[i], 0, SCM_WORD(obj))) {
+                return TRUE;
+            }
+            continue;           /* a consumer took the slot */
+        }
+        if (t != (Segment*)AO_load_full(&q->tail)) continue;
+        Segment *n = (Segment*)AO_load_full(&t->next);
+        if (n == NULL) {
+            Segment *s = make_segment();
+            s->items[0] = SCM_WORD(obj);
+            s->enqIdx = 1;
+            if (AO_compare_and_swap_full(&t->next, 0, (AO_t)s)) {
+                AO_compare_and_swap_full(&q->tail, (AO_t)t, (AO_t)s);
+                return TRUE;
+            }
+        } else {
+            AO_compare_and_swap_full(&q->tail, (AO_t)t, (AO_t)n);
+        }
+    }
+}
+
+static int seg_dequeue(ScmLfq *q, ScmObj *result)
+{
+    for (;;) {
+        Segment *h = (Segment*)AO_load_full(&q->head);
+        if (AO_load_full(&h->deqIdx) >= AO_load_full(&h->enqIdx)
+            && AO_load_full(&h->next) == 0) {
+            return FALSE;
+        }
+        AO_t i = AO_fetch_and_add1_full(&h->deqIdx);
+        if (i < SEGMENT_SIZE) {
+            AO_t v = swap_word(&h->items[i], TAKEN);
+            if (v != 0) {
+                *result = SCM_OBJ(v);
+                return TRUE;
+            }
+            continue;           /* the producer hasn't stored yet */
+        }
+        Segment *n = (Segment*)AO_load_full(&h->next);
+        if (n == NULL) return FALSE;
+        AO_compare_and_swap_full(&q->head, (AO_t)h, (AO_t)n);
+    }
+}
+
+/*
+ * Operations
+ */
+static int try_enqueue(ScmLfq *q, ScmObj obj)
+{
+    if (q->size > 0) return ring_enqueue(q, obj);
+    seg_enqueue(q, obj);
+    AO_fetch_and_add1_full(&q->count);
+    return TRUE;
+}
+
+static int try_dequeue(ScmLfq *q, ScmObj *result)
+{
+    if (q->size > 0) return ring_dequeue(q, result);
+    if (!seg_dequeue(q, result)) return FALSE;
+    AO_fetch_and_sub1_full(&q->count);
+    return TRUE;
+}
+
+/* Called after an operation of the other side of KIND. */
+static void notify(ScmLfq *q, int kind)
+{
+#ifdef GAUCHE_HAS_THREADS
+    if (AO_load_full(&q->waiting[kind]) > 0) {
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+        if (kind == READER) SCM_INTERNAL_COND_SIGNAL(q->readerWait);
+        else                SCM_INTERNAL_COND_SIGNAL(q->writerWait);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    }
+#endif /*GAUCHE_HAS_THREADS*/
+}
+
+int Scm__LfqEnqueue(ScmLfq *q, ScmObj obj)
+{
+    if (!try_enqueue(q, obj)) return FALSE;
+    notify(q, READER);
+    return TRUE;
+}
+
+int Scm__LfqDequeue(ScmLfq *q, ScmObj *result)
+{
+    if (!try_dequeue(q, result)) return FALSE;
+    notify(q, WRITER);
+    return TRUE;
+}
+
+/* KIND is READER or WRITER.  Returns TRUE if the operation is done. */
+static int try_op(ScmLfq *q, int kind, ScmObj obj, ScmObj *result)
+{
+    if (kind == READER) return try_dequeue(q, result);
+    else                return try_enqueue(q, obj);
+}
+
+static int wait_op(ScmLfq *q, int kind, ScmObj obj, ScmObj *result,
+                   ScmTimeSpec *pts)
+{
+    for (int i = 0; i < SPIN_COUNT; i++) {
+        if (try_op(q, kind, obj, result)) return TRUE;
+    }
+#ifdef GAUCHE_HAS_THREADS
+    ScmInternalCond *cv = (kind == READER)? &q->readerWait : &q->writerWait;
+    for (;;) {
+        int done = FALSE, timedout = FALSE, intr = FALSE;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+        AO_fetch_and_add1_full(&q->waiting[kind]);
+        while (!(done = try_op(q, kind, obj, result))) {
+            if (pts) {
+                int tr = SCM_INTERNAL_COND_TIMEDWAIT(*cv, q->mutex, pts);
+                if (tr == SCM_INTERNAL_COND_TIMEDOUT) { timedout = TRUE; break; }
+                if (tr == SCM_INTERNAL_COND_INTR) { intr = TRUE; break; }
+            } else {
+                SCM_INTERNAL_COND_WAIT(*cv, q->mutex);
+            }
+        }
+        AO_fetch_and_sub1_full(&q->waiting[kind]);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        if (done) return TRUE;
+        /* We may have consumed a signal meant for another waiter. */
+        if (try_op(q, kind, obj, result)) return TRUE;
+        if (timedout) return FALSE;
+        if (intr) Scm_SigCheck(Scm_VM());
+    }
+#else  /*!GAUCHE_HAS_THREADS*/
+    return FALSE;
+#endif /*!GAUCHE_HAS_THREADS*/
+}
+
+int Scm__LfqEnqueueWait(ScmLfq *q, ScmObj obj, ScmTimeSpec *pts)
+{
+    if (!wait_op(q, WRITER, obj, NULL, pts)) return FALSE;
+    notify(q, READER);
+    return TRUE;
+}
+
+int Scm__LfqDequeueWait(ScmLfq *q, ScmObj *result, ScmTimeSpec *pts)
+{
+    if (!wait_op(q, READER, SCM_FALSE, result, pts)) return FALSE;
+    notify(q, WRITER);
+    return TRUE;
+}
+
+long Scm__LfqLength(ScmLfq *q)
+{
+    long n;
+    if (q->size > 0) {
+        AO_t d = AO_load_full(&q->deqPos);
+        n = (long)(AO_load_full(&q->enqPos) - d);
+    } else {
+        n = (long)AO_load_full(&q->count);
+    }
+    if (n < 0) return 0;
+    if (q->size > 0 && n > q->size) return q->size;
+    return n;
+}
+
+int Scm__LfqNumWaitingReaders(ScmLfq *q)
+{
+    return (int)AO_load_full(&q->waiting[READER]);
+}
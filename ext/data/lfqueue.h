@@ -0,0 +1,58 @@
+/*
+ * lfqueue.h - lock-free queue core for data.queue
+ *
+ *   Copyright (c) 2010-2015  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_DATA_LFQUEUE_H
+#define GAUCHE_DATA_LFQUEUE_H
+
+/* The lock-free core of <lock-free-mtqueue>.  Internal to data.queue. */
+
+typedef struct ScmLfqRec ScmLfq;
+
+/* MAXLEN < 0 for an unbounded queue.  MAXLEN must not be 0. */
+extern ScmLfq *Scm__MakeLfq(long maxlen);
+
+/* Return FALSE if the queue is full (resp. empty).  Never block. */
+extern int  Scm__LfqEnqueue(ScmLfq *q, ScmObj obj);
+extern int  Scm__LfqDequeue(ScmLfq *q, ScmObj *result);
+
+/* Block while the queue is full (resp. empty).  PTS is an absolute
+   deadline or NULL.  Return FALSE on timeout. */
+extern int  Scm__LfqEnqueueWait(ScmLfq *q, ScmObj obj, ScmTimeSpec *pts);
+extern int  Scm__LfqDequeueWait(ScmLfq *q, ScmObj *result, ScmTimeSpec *pts);
+
+/* These are only snapshots. */
+extern long Scm__LfqLength(ScmLfq *q);
+extern int  Scm__LfqNumWaitingReaders(ScmLfq *q);
+
+#endif /*GAUCHE_DATA_LFQUEUE_H*/
@@ -45,10 +45,15 @@
 ;; to do so with holding C-level mutex, since Scheme procedure may
 ;; take indefinitely long.  So we use Scheme-level slot to keep the
 ;; thread that is working on the queue.
+;;
+;; <lock-free-mtqueue> is an mtqueue whose content is kept in a lock-free
+;; ring or segment list (lfqueue.c) instead of the list.  Enqueue and
+;; dequeue don't take the mutex, and blocking ones park only when they
+;; have to.  Operations that need to see the whole queue aren't supported.
 
 (define-module data.queue
-  (export <queue> <mtqueue>
-          make-queue make-mtqueue queue? mtqueue?
+  (export <queue> <mtqueue> <lock-free-mtqueue>
+          make-queue make-mtqueue queue? mtqueue? lock-free-mtqueue?
           queue-length mtqueue-max-length mtqueue-room
           mtqueue-num-waiting-readers
           queue-empty? copy-queue
@@ -68,6 +73,7 @@
 ;;;
 (inline-stub
  "#include <gauche/class.h>"
+ "#include \"lfqueue.h\""
 
  ;;
  ;; <queue>
@@ -163,6 +169,49 @@
    (printer
     (Scm_Printf port "#<mt-queue %d @%p>" (%qlength (Q obj)) obj)))
 
+ ;;
+ ;; <lock-free-mtqueue>
+ ;;
+ "typedef struct LfMtQueueRec {"
+ "  MtQueue mtq;"
+ "  ScmLfq *lfq;"
+ "} LfMtQueue;"
+
+ "SCM_CLASS_DECL(LfMtQueueClass);"
+ "#define LFQP(obj)       SCM_ISA(obj, &LfMtQueueClass)"
+ "#define LFMTQ(obj)      ((LfMtQueue*)(obj))"
+ "#define LFQ(obj)        (LFMTQ(obj)->lfq)"
+
+ (define-cfn makelfq (klass::ScmClass* maxlen::int)
+   (when (== maxlen 0)
+     (Scm_Error "lock-free mtqueue can't be zero-length"))
+   (let* ([z::LfMtQueue* (SCM_NEW_INSTANCE LfMtQueue klass)])
+     (set! (Q_LENGTH z) 0 (Q_HEAD z) SCM_NIL (Q_TAIL z) SCM_NIL
+           (MTQ_MAXLEN z) maxlen
+           (MTQ_LOCKER z) SCM_FALSE
+           (MTQ_READER_SEM z) 0
+           (LFQ z) (Scm__MakeLfq maxlen))
+     (SCM_INTERNAL_MUTEX_INIT (MTQ_MUTEX z))
+     (SCM_INTERNAL_COND_INIT (MTQ_CV z lockWait))
+     (SCM_INTERNAL_COND_INIT (MTQ_CV z readerWait))
+     (SCM_INTERNAL_COND_INIT (MTQ_CV z writerWait))
+     (return (SCM_OBJ z))))
+
+ (define-type <lock-free-mtqueue> "LfMtQueue*" "lock-free mt-queue"
+   "LFQP" "LFMTQ")
+ (define-cclass <lock-free-mtqueue>
+   "LfMtQueue*" "LfMtQueueClass" ("MtQueueClass" "QueueClass")
+   ((length :getter "return Scm_MakeInteger(Scm__LfqLength(obj->lfq));"
+            :setter #f)
+    (max-length :getter "return mtq_maxlen_get(MTQ(obj));"
+                :setter #f))
+   (allocator
+    (let* ([ml (Scm_GetKeyword ':max-length initargs SCM_FALSE)])
+      (return (makelfq klass (?: (SCM_INTP ml) (SCM_INT_VALUE ml) -1)))))
+   (printer
+    (Scm_Printf port "#<lock-free-mt-queue %ld @%p>"
+                (Scm__LfqLength (LFQ obj)) obj)))
+
  ;; lock macros
  (define-cise-expr big-locked?
    [(_ q) `(and (SCM_VMP (MTQ_LOCKER ,q))
@@ -249,7 +298,12 @@
              [(CW_INTR)     (Scm_SigCheck (Scm_VM)) (continue)]) ;restart op
            (break))))])
 
- (define-cproc %lock-mtq (q::<mtqueue>) ::<void>   (grab-mtq-big-lock q))
+ ;; Everything that goes through the big lock looks at the list, which
+ ;; a lock-free mtqueue doesn't have.
+ (define-cproc %lock-mtq (q::<mtqueue>) ::<void>
+   (when (LFQP q)
+     (Scm_Error "operation not supported on lock-free mtqueue: %S" q))
+   (grab-mtq-big-lock q))
  (define-cproc %unlock-mtq (q::<mtqueue>) ::<void> (release-mtq-big-lock q))
  (define-cproc %notify-writers (q::<mtqueue>) ::<void> (notify-writers q))
  (define-cproc %notify-readers (q::<mtqueue>) ::<void> (notify-readers q))
@@ -270,14 +324,19 @@
 (inline-stub
  (define-cproc make-queue ()
    (return (makeq (& QueueClass))))
- (define-cproc make-mtqueue (:key (max-length #f))
-   (return (makemtq (& MtQueueClass)
-                    (?: (SCM_UINTP max-length)
-                        (SCM_INT_VALUE max-length)
-                        -1))))
+ (define-cproc make-mtqueue (:key (max-length #f) (lock-free #f))
+   (let* ([ml::int (?: (SCM_UINTP max-length) (SCM_INT_VALUE max-length) -1)])
+     (if (SCM_FALSEP lock-free)
+       (return (makemtq (& MtQueueClass) ml))
+       (return (makelfq (& LfMtQueueClass) ml)))))
 
  ;; caller must hold lock
  (define-cproc %queue-set-content! (q::<queue> list last-pair) ::<void>
+   (when (LFQP q)                       ; only used for a new queue
+     (dolist [x list]
+       (unless (Scm__LfqEnqueue (LFQ q) x)
+         (Scm_Error "queue is full: %S" q)))
+     (return))
    (if (SCM_PAIRP list)
      (let* ([tail (?: (SCM_PAIRP last-pair) last-pair (Scm_LastPair list))])
        (set! (Q_TAIL q) tail
@@ -304,6 +363,8 @@
 ;;;
 (inline-stub
  (define-cproc queue-empty? (q::<queue>) ::<boolean>
+   (when (LFQP q)
+     (return (== (Scm__LfqLength (LFQ q)) 0)))
    (if (MTQP q)
      (let* ([r::int FALSE])
        (with-mtq-light-lock q (set! r (Q_EMPTY_P q)))
@@ -313,6 +374,7 @@
 
 (define-inline (queue? q)   (is-a? q <queue>))
 (define-inline (mtqueue? q) (is-a? q <mtqueue>))
+(define-inline (lock-free-mtqueue? q) (is-a? q <lock-free-mtqueue>))
 
 ;;;
 ;;; Queries
@@ -324,7 +386,10 @@
           (> (+ ,cnt (%qlength (Q ,q))) (MTQ_MAXLEN ,q)))])
 
  ;; API
- (define-cproc queue-length (q::<queue>) ::<int> %qlength)
+ (define-cproc queue-length (q::<queue>) ::<int>
+   (if (LFQP q)
+     (return (Scm__LfqLength (LFQ q)))
+     (return (%qlength q))))
  (define-cproc mtqueue-max-length (q::<mtqueue>)
    (return (?: (>= (MTQ_MAXLEN q) 0) (SCM_MAKE_INT (MTQ_MAXLEN q)) '#f)))
 
@@ -335,9 +400,13 @@
  ;; API
  (define-cproc mtqueue-room (q::<mtqueue>) ::<number>
    (let* ([room::int -1])
-     (with-mtq-light-lock q
-       (when (>= (MTQ_MAXLEN q) 0)
-         (set! room (- (MTQ_MAXLEN q) (%qlength (Q q))))))
+     (cond [(LFQP q)
+            (when (>= (MTQ_MAXLEN q) 0)
+              (set! room (- (MTQ_MAXLEN q) (Scm__LfqLength (LFQ q)))))]
+           [else
+            (with-mtq-light-lock q
+              (when (>= (MTQ_MAXLEN q) 0)
+                (set! room (- (MTQ_MAXLEN q) (%qlength (Q q))))))])
      (if (>= room 0)
        (return (SCM_MAKE_INT room))
        (return SCM_POSITIVE_INFINITY))))
@@ -355,6 +424,8 @@
 
  (define-cproc %queue-peek (q::<queue> :optional fallback) ::(<top> <top>)
    (let* ([ok::int FALSE] [h] [t])
+     (when (LFQP q)
+       (Scm_Error "can't peek lock-free mtqueue: %S" q))
      (if (not (MTQP q))
        (set! ok (queue-peek-both-int q (& h) (& t)))
        (with-mtq-light-lock q (set! ok (queue-peek-both-int q (& h) (& t)))))
@@ -424,12 +495,24 @@
      (if (SCM_NULLP more-objs)
        (set! tail head cnt 1)
        (set! tail (Scm_LastPair more-objs) cnt (Scm_Length head)))
-     (q-write-op enqueue_int q cnt head tail)
+     (if (LFQP q)
+       ;; Objects go in one by one; other threads may see some of them
+       ;; before the queue gets full.
+       (dolist [x head]
+         (unless (Scm__LfqEnqueue (LFQ q) x)
+           (Scm_Error "queue is full: %S" q)))
+       (q-write-op enqueue_int q cnt head tail))
      (return (SCM_OBJ q))))
 
  ;; API
  (define-cproc enqueue/wait! (q::<mtqueue> obj :optional (timeout #f)
                                                          (timeout-val #f))
+   (when (LFQP q)
+     (let* ([ts::ScmTimeSpec]
+            [pts::ScmTimeSpec* (Scm_GetTimeSpec timeout (& ts))])
+       (if (Scm__LfqEnqueueWait (LFQ q) obj pts)
+         (return '#t)
+         (return timeout-val))))
    (let* ([cell (SCM_LIST1 obj)] [retval (SCM_OBJ q)])
      (.if "defined(GAUCHE_HAS_THREADS)"
           (do-with-timeout q retval timeout timeout-val writerWait
@@ -470,6 +553,8 @@
      (set! (Q_LENGTH q) (+ (Q_LENGTH q) cnt))))
 
  (define-cproc queue-push! (q::<queue> obj :rest more-objs)
+   (when (LFQP q)
+     (Scm_Error "can't push to the head of lock-free mtqueue: %S" q))
    (let* ([objs (Scm_Cons obj more-objs)] [head] [tail] [cnt::u_int])
      (if (SCM_NULLP more-objs)
        (set! head objs tail objs cnt 1)
@@ -481,6 +566,8 @@
 
  (define-cproc queue-push/wait! (q::<mtqueue> obj :optional (timeout #f)
                                                             (timeout-val #f))
+   (when (LFQP q)
+     (Scm_Error "can't push to the head of lock-free mtqueue: %S" q))
    (let* ([cell (SCM_LIST1 obj)] [retval (SCM_OBJ q)])
      (.if "defined(GAUCHE_HAS_THREADS)"
           (do-with-timeout q retval timeout timeout-val writerWait
@@ -524,18 +611,25 @@
 
  (define-cproc dequeue! (q::<queue> :optional fallback)
    (let* ([empty::int FALSE] [r SCM_UNDEFINED])
-     (if (not (MTQP q))
-       (set! empty (dequeue-int q (& r)))
-       (with-mtq-light-lock q (set! empty (dequeue-int q (& r)))))
+     (cond [(LFQP q) (set! empty (not (Scm__LfqDequeue (LFQ q) (& r))))]
+           [(not (MTQP q)) (set! empty (dequeue-int q (& r)))]
+           [else (with-mtq-light-lock q (set! empty (dequeue-int q (& r))))])
      (if empty
        (if (SCM_UNBOUNDP fallback)
          (Scm_Error "queue is empty: %S" q)
          (set! r fallback))
-       (when (MTQP q) (notify-writers q)))
+       (when (and (MTQP q) (not (LFQP q))) (notify-writers q)))
      (return r)))
 
  (define-cproc dequeue/wait! (q::<mtqueue> :optional (timeout #f)
                                                      (timeout-val #f))
+   (when (LFQP q)
+     (let* ([ts::ScmTimeSpec]
+            [pts::ScmTimeSpec* (Scm_GetTimeSpec timeout (& ts))]
+            [r SCM_UNDEFINED])
+       (if (Scm__LfqDequeueWait (LFQ q) (& r) pts)
+         (return r)
+         (return timeout-val))))
    (let* ([retval SCM_UNDEFINED])
      (.if "defined(GAUCHE_HAS_THREADS)"
           (do-with-timeout q retval timeout timeout-val readerWait
@@ -555,6 +649,11 @@
      (return lis)))
 
  (define-cproc dequeue-all! (q::<queue>)
+   (when (LFQP q)
+     (let* ([h SCM_NIL] [t SCM_NIL] [x])
+       (while (Scm__LfqDequeue (LFQ q) (& x))
+         (SCM_APPEND1 h t x))
+       (return h)))
    (if (not (MTQP q))
      (return (dequeue-all-int q))
      (let* ([r])
@@ -571,6 +670,8 @@
 ;; operation the caller need another mutex to prevent new items
 ;; from being inserted into the mtq.
 (define-cproc mtqueue-num-waiting-readers (q::<mtqueue>) ::<int>
+  (when (LFQP q)
+    (return (Scm__LfqNumWaitingReaders (LFQ q))))
   (let* ([n::int 0])
     (with-mtq-light-lock q (set! n (MTQ_READER_SEM q)))
     (return n)))
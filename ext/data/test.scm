@@ -202,6 +202,211 @@
 
 (test* "mtqueue room" +inf.0 (mtqueue-room (make-mtqueue)))
 
+(define (lock-free-mtqueue-test what q)
+  (test* #"~what lock-free-mtqueue?" '(#t #t)
+         (list (mtqueue? q) (lock-free-mtqueue? q)))
+  (test* #"~what enqueue!" 4
+         (begin (enqueue! q 'a) (enqueue! q 'b 'c 'd) (queue-length q)))
+  (test* #"~what dequeue!" '(a b) (list (dequeue! q) (dequeue! q)))
+  (test* #"~what dequeue-all!" '(c d) (dequeue-all! q))
+  (test* #"~what queue-empty?" #t (queue-empty? q))
+  (test* #"~what dequeue! (fallback)" "empty!" (dequeue! q "empty!"))
+  (test* #"~what wraparound" (iota 1000)
+         (let loop ([i 0] [r '()])
+           (if (= i 1000)
+             (reverse r)
+             (begin (enqueue! q i) (loop (+ i 1) (cons (dequeue! q) r))))))
+  (test* #"~what queue-push!" (test-error) (queue-push! q 'z))
+  (test* #"~what queue->list" (test-error) (queue->list q))
+  (test* #"~what queue-front" (test-error) (queue-front q)))
+
+(lock-free-mtqueue-test "bounded" (make-mtqueue :max-length 3 :lock-free #t))
+(lock-free-mtqueue-test "unbounded" (make-mtqueue :lock-free #t))
+
+(let1 q (make-mtqueue :max-length 3 :lock-free #t)
+  (test* "lock-free mtqueue room" '(3 1 0)
+         (let1 r0 (mtqueue-room q)
+           (enqueue! q 'a 'b)
+           (let1 r1 (mtqueue-room q)
+             (enqueue! q 'c)
+             (list r0 r1 (mtqueue-room q)))))
+  (test* "lock-free mtqueue overflow" (test-error) (enqueue! q 'd))
+  (test* "lock-free mtqueue after overflow" '(a b c) (dequeue-all! q))
+  (test* "lock-free mtqueue max-length" 3 (mtqueue-max-length q)))
+
+(test* "lock-free mtqueue unbounded, many segments" (iota 2000)
+       (let1 q (list->queue (iota 2000) <lock-free-mtqueue>)
+         (dequeue-all! q)))
+(test* "lock-free mtqueue room" +inf.0
+       (mtqueue-room (make-mtqueue :lock-free #t)))
+(test* "lock-free mtqueue zero length" (test-error)
+       (make-mtqueue :max-length 0 :lock-free #t))
+
+;;-----------------------------------------------
+(test-section "data.cache-core")
+(use data.cache-core)
+(test-module 'data.cache-core)
+
+(let1 c (make-cache-core 'lru 2 :type 'eqv?)
+  (test* "cache-core put" '(#t #t 2) (list (cache-core-put! c 1 'a)
+                                          (cache-core-put! c 2 'b)
+                                          (cache-core-count c)))
+  (test* "cache-core check" '((1 . a) #f) (list (cache-core-check c 1)
+                                               (cache-core-check c 3)))
+  (test* "cache-core peek" '(b none) (list (cache-core-peek c 2)
+                                          (cache-core-peek c 3 'none)))
+  (test* "cache-core spill" '((1 . a) (3 . c))
+         (begin
+           (cache-core-put! c 3 'c)     ; 2 is LRU, since peek doesn't touch
+           (sort (cache-core->alist c) < car)))
+  (test* "cache-core delete" '(#t #f 1)
+         (list (cache-core-delete! c 1)
+               (cache-core-delete! c 1)
+               (cache-core-count c)))
+  (test* "cache-core stats" '(1 1 1 0) (cache-core-stats c))
+  (test* "cache-core clear" 0 (begin (cache-core-clear! c)
+                                     (cache-core-count c))))
+
+(test* "cache-core policy" (test-error) (make-cache-core 'mru 2))
+(test* "cache-core capacity" (test-error) (make-cache-core 'lru 0))
+(test* "cache-core shards" (test-error) (make-cache-core 'lru 2 :shards 0))
+
+;;-----------------------------------------------
+(test-section "data.heap-core")
+(use data.heap-core)
+(test-module 'data.heap-core)
+
+;; More tests are in test/data.scm, through data.heap.
+(let1 h (make-indexed-heap 'flonum)
+  (test* "indexed heap push" '(1 2.5 3)
+         (begin
+           (indexed-heap-push! h 3 'c)
+           (indexed-heap-push! h 1 'a)
+           (indexed-heap-push! h 2.5 'b)
+           (map (^_ (heap-handle-key (indexed-heap-pop-min! h))) '(0 1 2)))))
+
+(test* "indexed heap key type" (test-error) (make-indexed-heap 'bignum))
+
+;;-----------------------------------------------
+(test-section "data.trie-core")
+(use data.trie-core)
+(test-module 'data.trie-core)
+
+;; More tests are in test/data.scm, through data.trie.
+(let1 t (alist->radix-trie '(("/" . root) ("/api" . api) ("/api/v1" . v1)))
+  (test* "radix trie longest-match" '(("/api/v1" . v1) ("/api" . api)
+                                      ("/" . root))
+         (map (cut radix-trie-longest-match t <>)
+              '("/api/v1/users" "/api/v2" "/index.html")))
+  (test* "radix trie common-prefix" '(("/api" . api) ("/api/v1" . v1))
+         (radix-trie-common-prefix t "/a")))
+
+;;-----------------------------------------------
+(test-section "data.imap-core")
+(use data.imap-core)
+(test-module 'data.imap-core)
+
+;; More tests are in test/data.scm, through data.imap.
+(let* ([t0 (alist->imap-tree default-comparator '((1 . a) (2 . b) (3 . c)))]
+       [t1 (imap-tree-put t0 0 'z)])
+  (test* "imap-tree" '(3 4 (0 . z) #f (3 . c))
+         (list (imap-tree-size t0) (imap-tree-size t1)
+               (imap-tree-lookup t1 0) (imap-tree-lookup t0 0)
+               (imap-tree-max t1)))
+  (test* "imap-tree-iterator" '((0 . z) (1 . a) (2 . b) (3 . c))
+         (let1 next (imap-tree-iterator t1)
+           (let loop ([r '()])
+             (let1 p (next)
+               (if (eof-object? p) (reverse r) (loop (cons p r))))))))
+
+;;-----------------------------------------------
+(test-section "data.bitvector")
+(use data.bitvector)
+(test-module 'data.bitvector)
+
+(let ([a (string->bitvector "0110100110010110")]
+      [b (string->bitvector "0011001100110011")])
+  (test* "bitvector basics" '(16 #t #f "0110100110010110")
+         (list (bitvector-length a) (bitvector-ref a 1) (bitvector-ref a 0)
+               (bitvector->string a)))
+  (test* "bitvector-ref out of range" (test-error)
+         (bitvector-ref a 16))
+  (test* "bitvector-and" "0010000100010010"
+         (bitvector->string (bitvector-and a b)))
+  (test* "bitvector-ior" "0111101110110111"
+         (bitvector->string (bitvector-ior a b)))
+  (test* "bitvector-xor" "0101101010100101"
+         (bitvector->string (bitvector-xor a b)))
+  (test* "bitvector-not" "1001011001101001"
+         (bitvector->string (bitvector-not a)))
+  (test* "bitvector-not keeps originals" "0110100110010110"
+         (bitvector->string a))
+  (test* "bitvector-and size mismatch" (test-error)
+         (bitvector-and a (make-bitvector 15)))
+  (test* "bitvector-popcount" '(8 2 0)
+         (list (bitvector-popcount a) (bitvector-popcount a 0 4)
+               (bitvector-popcount a 3 3)))
+  (test* "bitvector-next-set" '(1 4 #f)
+         (list (bitvector-next-set a) (bitvector-next-set a 3)
+               (bitvector-next-set a 15)))
+  (test* "bitvector-next-clear" '(0 3 15 #f)
+         (list (bitvector-next-clear a) (bitvector-next-clear a 1)
+               (bitvector-next-clear a 15) (bitvector-next-clear a 16)))
+  (test* "bitvector-rank" '(0 1 8)
+         (list (bitvector-rank a 0) (bitvector-rank a 2) (bitvector-rank a 16)))
+  (test* "bitvector-select" '(1 2 4 14 #f)
+         (map (cut bitvector-select a <>) '(0 1 2 7 8)))
+  (test* "bitvector->u8vector" '#u8(#x96 #x69)
+         (bitvector->u8vector a))
+  (test* "u8vector->bitvector" #t
+         (bitvector=? a (u8vector->bitvector '#u8(0 #x96 #x69) 1)))
+  (test* "equal?" #t (equal? a (bitvector-copy a)))
+  )
+
+;; Vectors long enough to take the word-parallel paths, checked against
+;; bit-by-bit computation.
+(let* ([n 1000]
+       [a (rlet1 v (make-bitvector n)
+            (dotimes [i n] (when (zero? (modulo (* i i) 7)) (bitvector-set! v i 1))))]
+       [b (rlet1 v (make-bitvector n #t)
+            (dotimes [i n] (when (zero? (modulo i 3)) (bitvector-set! v i 0))))]
+       [ref (^[bv] (filter (cut bitvector-ref bv <>) (iota n)))])
+  (test* "long bitvector-and" (filter (^i (and (bitvector-ref a i)
+                                               (bitvector-ref b i)))
+                                      (iota n))
+         (ref (bitvector-and a b)))
+  (test* "long bitvector-ior!" (filter (^i (or (bitvector-ref a i)
+                                               (bitvector-ref b i)))
+                                       (iota n))
+         (ref (bitvector-ior! (bitvector-copy a) b)))
+  (test* "long bitvector-not" (remove (cut bitvector-ref a <>) (iota n))
+         (ref (bitvector-not a)))
+  (test* "long bitvector-popcount" (length (ref a)) (bitvector-popcount a))
+  (test* "long bitvector-popcount range"
+         (count (^i (bitvector-ref b i)) (iota 700 123))
+         (bitvector-popcount b 123 823))
+  (test* "long bitvector-select" (ref a)
+         (map (cut bitvector-select a <>) (iota (bitvector-popcount a))))
+  (test* "long bitvector-next-set" (ref b)
+         (let loop ([i (bitvector-next-set b)] [r '()])
+           (if i (loop (bitvector-next-set b (+ i 1)) (cons i r)) (reverse r))))
+  (test* "long bitvector-copy" (filter (cut bitvector-ref a <>) (iota 500 77))
+         (map (cut + 77 <>) (ref (bitvector-copy a 77 577))))
+  (test* "bitvector-copy! overlapping"
+         (append (take (bitvector->list a) 10)
+                 (take (drop (bitvector->list a) 3) 900)
+                 (drop (bitvector->list a) 910))
+         (bitvector->list (rlet1 v (bitvector-copy a)
+                            (bitvector-copy! v 10 v 3 903))))
+  (test* "bitvector-fill!" (append (make-list 30 #f) (make-list 900 #t)
+                                   (make-list 70 #f))
+         (bitvector->list (rlet1 v (make-bitvector n)
+                            (bitvector-fill! v #t 30 930))))
+  (test* "u8vector roundtrip" #t
+         (bitvector=? a (bitvector-copy
+                         (u8vector->bitvector (bitvector->u8vector a)) 0 n)))
+  )
+
 ;; Note: */wait! APIs are tested in ext/threads/test.scm instead of here,
 ;; since we need threads working.
 
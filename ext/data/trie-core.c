@@ -0,0 +1,607 @@
+/*
+ * trie-core.c - adaptive radix trie for data.trie
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gauche.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "trie-core.h"
+
+/*
+ * The layout follows the Adaptive Radix Tree (V. Leis, A. Kemper,
+ * T. Neumann, "The Adaptive Radix Tree: ARTful Indexing for Main-Memory
+ * Databases", ICDE 2013), except that an entry is kept in the node
+ * where its key ends, instead of in a separate leaf.
+ *
+ * Each node has a compressed path (prefix), the bytes between its
+ * parent's branch and its own branch, and maps the next byte to the
+ * children with one of four representations chosen by the number of
+ * children:
+ *
+ *   N4, N16  - sorted arrays of bytes and children
+ *   N48      - 256 bytes of index to 48 children
+ *   N256     - 256 children
+ *
+ * Nodes are grown and shrunk as children come and go (with some
+ * hysteresis), and a node without an entry and with only one child is
+ * merged into the child.  So every node except the root branches or
+ * has an entry.
+ */
+
+enum { RT_N4, RT_N16, RT_N48, RT_N256 };
+
+typedef struct rt_node_rec {
+    uint8_t type;
+    uint16_t count;             /* number of children */
+    uint32_t plen;
+    uint8_t *prefix;
+    ScmObj key;                 /* SCM_UNBOUND if no entry ends here */
+    ScmObj value;
+} rt_node;
+
+typedef struct {
+    rt_node n;
+    uint8_t keys[4];
+    rt_node *child[4];
+} rt_node4;
+
+typedef struct {
+    rt_node n;
+    uint8_t keys[16];
+    rt_node *child[16];
+} rt_node16;
+
+typedef struct {
+    rt_node n;
+    uint8_t index[256];         /* slot+1, or 0 if none */
+    rt_node *child[48];
+} rt_node48;
+
+typedef struct {
+    rt_node n;
+    rt_node *child[256];
+} rt_node256;
+
+/* root[0] for string keys, root[1] for u8vector keys */
+struct ScmRadixTrieRec {
+    SCM_HEADER;
+    rt_node *root[2];
+    ScmSmallInt count;
+};
+
+static void trie_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<radix-trie %ld>", SCM_RADIX_TRIE(obj)->count);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_RadixTrieClass, trie_print);
+
+/*=====================================================
+ * Keys
+ */
+
+/* Returns the index of the root for KEY. */
+static int key_bytes(ScmObj key, const uint8_t **p, ScmSmallInt *len)
+{
+    if (SCM_STRINGP(key)) {
+        const ScmStringBody *b = SCM_STRING_BODY(key);
+        *p = (const uint8_t*)SCM_STRING_BODY_START(b);
+        *len = SCM_STRING_BODY_SIZE(b);
+        return 0;
+    }
+    if (SCM_U8VECTORP(key)) {
+        *p = SCM_U8VECTOR_ELEMENTS(key);
+        *len = SCM_U8VECTOR_SIZE(key);
+        return 1;
+    }
+    Scm_Error("string or u8vector required, but got: %S", key);
+    return 0;                   /* dummy */
+}
+
+/*=====================================================
+ * Nodes
+ */
+
+static const size_t node_sizes[] = {
+    sizeof(rt_node4), sizeof(rt_node16), sizeof(rt_node48), sizeof(rt_node256)
+};
+
+static rt_node *new_node(int type)
+{
+    rt_node *n = SCM_NEW2(rt_node*, node_sizes[type]);
+    memset(n, 0, node_sizes[type]);
+    n->type = type;
+    n->key = SCM_UNBOUND;
+    n->value = SCM_UNBOUND;
+    return n;
+}
+
+static void set_prefix(rt_node *n, const uint8_t *p, ScmSmallInt len)
+{
+    if (len > UINT32_MAX) Scm_Error("radix trie key too long");
+    n->plen = (uint32_t)len;
+    if (len > 0) {
+        n->prefix = SCM_NEW_ATOMIC2(uint8_t*, len);
+        memcpy(n->prefix, p, len);
+    } else {
+        n->prefix = NULL;
+    }
+}
+
+static rt_node *new_leaf(const uint8_t *p, ScmSmallInt len,
+                         ScmObj key, ScmObj value)
+{
+    rt_node *n = new_node(RT_N4);
+    set_prefix(n, p, len);
+    n->key = key;
+    n->value = value;
+    return n;
+}
+
+static inline int has_entry(rt_node *n)
+{
+    return !SCM_UNBOUNDP(n->key);
+}
+
+static inline uint8_t *small_keys(rt_node *n)
+{
+    return (n->type == RT_N4) ? ((rt_node4*)n)->keys : ((rt_node16*)n)->keys;
+}
+
+static inline rt_node **small_children(rt_node *n)
+{
+    return (n->type == RT_N4) ? ((rt_node4*)n)->child : ((rt_node16*)n)->child;
+}
+
+static rt_node **find_child(rt_node *n, uint8_t b)
+{
+    switch (n->type) {
+    case RT_N4: case RT_N16: {
+        uint8_t *keys = small_keys(n);
+        for (int i=0; i<n->count; i++) {
+            if (keys[i] == b) return &small_children(n)[i];
+            if (keys[i] > b) break;
+        }
+        return NULL;
+    }
+    case RT_N48: {
+        rt_node48 *n48 = (rt_node48*)n;
+        int i = n48->index[b];
+        return i ? &n48->child[i-1] : NULL;
+    }
+    default: {
+        rt_node256 *n256 = (rt_node256*)n;
+        return n256->child[b] ? &n256->child[b] : NULL;
+    }
+    }
+}
+
+/* Runs BODY for each child C of N in the order of the branch byte B.
+   BODY must not add or remove children of N. */
+#define FOR_EACH_CHILD(n, b, c, body)                                   \
+    do {                                                                \
+        switch ((n)->type) {                                            \
+        case RT_N4: case RT_N16:                                        \
+            for (int i_=0; i_<(n)->count; i_++) {                       \
+                uint8_t b = small_keys(n)[i_];                          \
+                rt_node *c = small_children(n)[i_];                     \
+                (void)b;                                                \
+                body;                                                   \
+            }                                                           \
+            break;                                                      \
+        case RT_N48:                                                    \
+            for (int i_=0; i_<256; i_++) {                              \
+                int x_ = ((rt_node48*)(n))->index[i_];                  \
+                if (x_ == 0) continue;                                  \
+                uint8_t b = (uint8_t)i_;                                \
+                rt_node *c = ((rt_node48*)(n))->child[x_-1];            \
+                (void)b;                                                \
+                body;                                                   \
+            }                                                           \
+            break;                                                      \
+        default:                                                        \
+            for (int i_=0; i_<256; i_++) {                              \
+                rt_node *c = ((rt_node256*)(n))->child[i_];             \
+                if (c == NULL) continue;                                \
+                uint8_t b = (uint8_t)i_;                                \
+                (void)b;                                                \
+                body;                                                   \
+            }                                                           \
+        }                                                               \
+    } while (0)
+
+static rt_node *retype(rt_node *n, int type)
+{
+    rt_node *m = new_node(type);
+    m->plen = n->plen;
+    m->prefix = n->prefix;
+    m->key = n->key;
+    m->value = n->value;
+    /* children are added by the caller */
+    return m;
+}
+
+static void add_child(rt_node **ref, uint8_t b, rt_node *c);
+
+/* Moves the children of N to a new node of TYPE, and replaces N at REF. */
+static void resize(rt_node **ref, int type)
+{
+    rt_node *n = *ref;
+    rt_node *m = retype(n, type);
+    *ref = m;
+    FOR_EACH_CHILD(n, b, c, add_child(ref, b, c));
+}
+
+static void add_child(rt_node **ref, uint8_t b, rt_node *c)
+{
+    rt_node *n = *ref;
+    switch (n->type) {
+    case RT_N4: case RT_N16: {
+        int cap = (n->type == RT_N4) ? 4 : 16;
+        if (n->count == cap) {
+            resize(ref, (n->type == RT_N4) ? RT_N16 : RT_N48);
+            add_child(ref, b, c);
+            return;
+        }
+        uint8_t *keys = small_keys(n);
+        rt_node **children = small_children(n);
+        int i = 0;
+        while (i < n->count && keys[i] < b) i++;
+        memmove(keys+i+1, keys+i, n->count-i);
+        memmove(children+i+1, children+i, sizeof(rt_node*)*(n->count-i));
+        keys[i] = b;
+        children[i] = c;
+        n->count++;
+        return;
+    }
+    case RT_N48: {
+        rt_node48 *n48 = (rt_node48*)n;
+        if (n->count == 48) {
+            resize(ref, RT_N256);
+            add_child(ref, b, c);
+            return;
+        }
+        int slot = 0;
+        while (n48->child[slot] != NULL) slot++;
+        n48->child[slot] = c;
+        n48->index[b] = (uint8_t)(slot+1);
+        n->count++;
+        return;
+    }
+    default:
+        ((rt_node256*)n)->child[b] = c;
+        n->count++;
+    }
+}
+
+static void remove_child(rt_node **ref, uint8_t b)
+{
+    rt_node *n = *ref;
+    switch (n->type) {
+    case RT_N4: case RT_N16: {
+        uint8_t *keys = small_keys(n);
+        rt_node **children = small_children(n);
+        int i = 0;
+        while (keys[i] != b) i++;
+        memmove(keys+i, keys+i+1, n->count-i-1);
+        memmove(children+i, children+i+1, sizeof(rt_node*)*(n->count-i-1));
+        n->count--;
+        children[n->count] = NULL;
+        if (n->type == RT_N16 && n->count <= 3) resize(ref, RT_N4);
+        return;
+    }
+    case RT_N48: {
+        rt_node48 *n48 = (rt_node48*)n;
+        n48->child[n48->index[b]-1] = NULL;
+        n48->index[b] = 0;
+        n->count--;
+        if (n->count <= 12) resize(ref, RT_N16);
+        return;
+    }
+    default:
+        ((rt_node256*)n)->child[b] = NULL;
+        n->count--;
+        if (n->count <= 37) resize(ref, RT_N48);
+    }
+}
+
+/* Called after an entry or a child is removed from the node at REF. */
+static void compact(rt_node **ref)
+{
+    rt_node *n = *ref;
+    if (has_entry(n) || n->count > 1) return;
+    if (n->count == 0) {
+        *ref = NULL;
+        return;
+    }
+    /* merge into the only child */
+    uint8_t cb = 0;
+    rt_node *child = NULL;
+    FOR_EACH_CHILD(n, b, c, { cb = b; child = c; });
+    ScmSmallInt len = (ScmSmallInt)n->plen + 1 + child->plen;
+    uint8_t *buf = SCM_NEW_ATOMIC2(uint8_t*, len);
+    if (n->plen) memcpy(buf, n->prefix, n->plen);
+    buf[n->plen] = cb;
+    if (child->plen) memcpy(buf + n->plen + 1, child->prefix, child->plen);
+    if (len > UINT32_MAX) Scm_Error("radix trie key too long");
+    child->prefix = buf;
+    child->plen = (uint32_t)len;
+    *ref = child;
+}
+
+/*=====================================================
+ * Search
+ */
+
+/* Returns the node whose subtree has the keys beginning with P.
+   *EXACT is set to TRUE if P ends right after the node's prefix. */
+static rt_node *locate(rt_node *n, const uint8_t *p, ScmSmallInt len,
+                       int *exact)
+{
+    ScmSmallInt depth = 0;
+    while (n != NULL) {
+        ScmSmallInt rem = len - depth;
+        if (rem <= (ScmSmallInt)n->plen) {
+            if (rem > 0 && memcmp(n->prefix, p + depth, rem) != 0) return NULL;
+            *exact = (rem == (ScmSmallInt)n->plen);
+            return n;
+        }
+        if (n->plen > 0 && memcmp(n->prefix, p + depth, n->plen) != 0) {
+            return NULL;
+        }
+        depth += n->plen;
+        rt_node **c = find_child(n, p[depth]);
+        if (c == NULL) return NULL;
+        n = *c;
+        depth++;
+    }
+    return NULL;
+}
+
+static rt_node *lookup(ScmRadixTrie *t, ScmObj key)
+{
+    const uint8_t *p;
+    ScmSmallInt len;
+    int r = key_bytes(key, &p, &len);
+    int exact = FALSE;
+    rt_node *n = locate(t->root[r], p, len, &exact);
+    return (n && exact && has_entry(n)) ? n : NULL;
+}
+
+/* Appends the entries in the subtree of N in the order of bytes.
+   Returns FALSE when LIMIT is reached. */
+static int collect(rt_node *n, ScmObj *h, ScmObj *tail, ScmSmallInt *limit)
+{
+    if (*limit == 0) return FALSE;
+    if (has_entry(n)) {
+        SCM_APPEND1(*h, *tail, Scm_Cons(n->key, n->value));
+        if (*limit > 0 && --*limit == 0) return FALSE;
+    }
+    FOR_EACH_CHILD(n, b, c, { if (!collect(c, h, tail, limit)) return FALSE; });
+    return TRUE;
+}
+
+/*=====================================================
+ * Modification
+ */
+
+/* Returns TRUE if a new entry is created. */
+static int insert(rt_node **ref, const uint8_t *p, ScmSmallInt len,
+                  ScmObj key, ScmObj value)
+{
+    ScmSmallInt depth = 0;
+    for (;;) {
+        rt_node *n = *ref;
+        if (n == NULL) {
+            *ref = new_leaf(p + depth, len - depth, key, value);
+            return TRUE;
+        }
+        ScmSmallInt rem = len - depth;
+        ScmSmallInt m = 0;
+        while (m < (ScmSmallInt)n->plen && m < rem
+               && n->prefix[m] == p[depth+m]) m++;
+        if (m < (ScmSmallInt)n->plen) {
+            /* split the prefix of N at m */
+            rt_node *s = new_node(RT_N4);
+            set_prefix(s, n->prefix, m);
+            uint8_t nb = n->prefix[m];
+            set_prefix(n, n->prefix + m + 1, n->plen - m - 1);
+            add_child(&s, nb, n);
+            depth += m;
+            if (depth == len) {
+                s->key = key;
+                s->value = value;
+            } else {
+                add_child(&s, p[depth],
+                          new_leaf(p + depth + 1, len - depth - 1,
+                                   key, value));
+            }
+            *ref = s;
+            return TRUE;
+        }
+        depth += n->plen;
+        if (depth == len) {
+            int created = !has_entry(n);
+            n->key = key;
+            n->value = value;
+            return created;
+        }
+        rt_node **c = find_child(n, p[depth]);
+        if (c == NULL) {
+            add_child(ref, p[depth],
+                      new_leaf(p + depth + 1, len - depth - 1, key, value));
+            return TRUE;
+        }
+        ref = c;
+        depth++;
+    }
+}
+
+static int delete_rec(rt_node **ref, const uint8_t *p, ScmSmallInt len,
+                      ScmSmallInt depth)
+{
+    rt_node *n = *ref;
+    if (n == NULL) return FALSE;
+    if (len - depth < (ScmSmallInt)n->plen) return FALSE;
+    if (n->plen > 0 && memcmp(n->prefix, p + depth, n->plen) != 0) {
+        return FALSE;
+    }
+    depth += n->plen;
+    if (depth == len) {
+        if (!has_entry(n)) return FALSE;
+        n->key = n->value = SCM_UNBOUND;
+        compact(ref);
+        return TRUE;
+    }
+    uint8_t b = p[depth];
+    rt_node **c = find_child(n, b);
+    if (c == NULL) return FALSE;
+    if (!delete_rec(c, p, len, depth+1)) return FALSE;
+    if (*c == NULL) {
+        remove_child(ref, b);
+        compact(ref);
+    }
+    return TRUE;
+}
+
+/*=====================================================
+ * API
+ */
+
+ScmObj Scm__MakeRadixTrie(void)
+{
+    ScmRadixTrie *t = SCM_NEW(ScmRadixTrie);
+    SCM_SET_CLASS(t, SCM_CLASS_RADIX_TRIE);
+    t->root[0] = t->root[1] = NULL;
+    t->count = 0;
+    return SCM_OBJ(t);
+}
+
+ScmSmallInt Scm__RadixTrieNumEntries(ScmRadixTrie *t)
+{
+    return t->count;
+}
+
+ScmObj Scm__RadixTrieGet(ScmRadixTrie *t, ScmObj key, ScmObj fallback)
+{
+    rt_node *n = lookup(t, key);
+    if (n) return n->value;
+    if (SCM_UNBOUNDP(fallback)) {
+        Scm_Error("radix trie doesn't have an entry for key: %S", key);
+    }
+    return fallback;
+}
+
+int Scm__RadixTriePut(ScmRadixTrie *t, ScmObj key, ScmObj value)
+{
+    const uint8_t *p;
+    ScmSmallInt len;
+    int r = key_bytes(key, &p, &len);
+    int created = insert(&t->root[r], p, len, key, value);
+    if (created) t->count++;
+    return created;
+}
+
+int Scm__RadixTrieDelete(ScmRadixTrie *t, ScmObj key)
+{
+    const uint8_t *p;
+    ScmSmallInt len;
+    int r = key_bytes(key, &p, &len);
+    int found = delete_rec(&t->root[r], p, len, 0);
+    if (found) t->count--;
+    return found;
+}
+
+void Scm__RadixTrieClear(ScmRadixTrie *t)
+{
+    t->root[0] = t->root[1] = NULL;
+    t->count = 0;
+}
+
+ScmObj Scm__RadixTrieLongestMatch(ScmRadixTrie *t, ScmObj key)
+{
+    const uint8_t *p;
+    ScmSmallInt len;
+    int r = key_bytes(key, &p, &len);
+    rt_node *n = t->root[r], *last = NULL;
+    ScmSmallInt depth = 0;
+    while (n != NULL) {
+        if (len - depth < (ScmSmallInt)n->plen) break;
+        if (n->plen > 0 && memcmp(n->prefix, p + depth, n->plen) != 0) break;
+        depth += n->plen;
+        if (has_entry(n)) last = n;
+        if (depth == len) break;
+        rt_node **c = find_child(n, p[depth]);
+        if (c == NULL) break;
+        n = *c;
+        depth++;
+    }
+    return last ? Scm_Cons(last->key, last->value) : SCM_FALSE;
+}
+
+int Scm__RadixTriePartialKeyP(ScmRadixTrie *t, ScmObj prefix)
+{
+    const uint8_t *p;
+    ScmSmallInt len;
+    int r = key_bytes(prefix, &p, &len);
+    int exact = FALSE;
+    rt_node *n = locate(t->root[r], p, len, &exact);
+    if (n == NULL) return FALSE;
+    /* the entry of N, if any, is longer than PREFIX unless exact */
+    return !exact || n->count > 0;
+}
+
+ScmObj Scm__RadixTrieToList(ScmRadixTrie *t, ScmObj prefix, ScmSmallInt limit)
+{
+    ScmObj h = SCM_NIL, tail = SCM_NIL;
+    if (SCM_FALSEP(prefix)) {
+        for (int r=0; r<2; r++) {
+            if (t->root[r] && !collect(t->root[r], &h, &tail, &limit)) break;
+        }
+    } else {
+        const uint8_t *p;
+        ScmSmallInt len;
+        int r = key_bytes(prefix, &p, &len);
+        int exact = FALSE;
+        rt_node *n = locate(t->root[r], p, len, &exact);
+        if (n) collect(n, &h, &tail, &limit);
+    }
+    return h;
+}
+
+void Scm__InitTrieCore(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_RadixTrieClass, "<radix-trie>", mod, NULL, 0);
+}
@@ -0,0 +1,77 @@
+/*
+ * trie-core.h - adaptive radix trie for data.trie
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_DATA_TRIE_CORE_H
+#define GAUCHE_DATA_TRIE_CORE_H
+
+/* A compressed radix trie keyed by the bytes of strings and u8vectors,
+ * behind the radix trie of data.trie.  String keys and u8vector keys
+ * live in separate trees, so "ab" and #u8(97 98) are different keys.
+ *
+ * Keys are kept as given, as in hash tables; don't modify a key after
+ * putting it in a trie.
+ */
+typedef struct ScmRadixTrieRec ScmRadixTrie;
+
+SCM_CLASS_DECL(Scm_RadixTrieClass);
+#define SCM_CLASS_RADIX_TRIE     (&Scm_RadixTrieClass)
+#define SCM_RADIX_TRIE(obj)      ((ScmRadixTrie*)(obj))
+#define SCM_RADIX_TRIE_P(obj)    SCM_XTYPEP(obj, SCM_CLASS_RADIX_TRIE)
+
+extern ScmObj Scm__MakeRadixTrie(void);
+extern ScmSmallInt Scm__RadixTrieNumEntries(ScmRadixTrie *t);
+
+/* Returns the value, or FALLBACK. */
+extern ScmObj Scm__RadixTrieGet(ScmRadixTrie *t, ScmObj key, ScmObj fallback);
+/* Returns TRUE if KEY is new. */
+extern int    Scm__RadixTriePut(ScmRadixTrie *t, ScmObj key, ScmObj value);
+/* Returns TRUE if KEY was in the trie. */
+extern int    Scm__RadixTrieDelete(ScmRadixTrie *t, ScmObj key);
+extern void   Scm__RadixTrieClear(ScmRadixTrie *t);
+
+/* Returns (key . value) of the longest key that is a prefix of KEY,
+   or #f. */
+extern ScmObj Scm__RadixTrieLongestMatch(ScmRadixTrie *t, ScmObj key);
+/* Returns TRUE if some key has PREFIX as a proper prefix. */
+extern int    Scm__RadixTriePartialKeyP(ScmRadixTrie *t, ScmObj prefix);
+/* Returns a fresh list of (key . value) whose keys begin with PREFIX,
+   in the order of bytes, up to LIMIT entries (negative for all).
+   If PREFIX is #f, all entries are returned; strings come first. */
+extern ScmObj Scm__RadixTrieToList(ScmRadixTrie *t, ScmObj prefix,
+                                   ScmSmallInt limit);
+
+/* Called once at initialization. */
+extern void Scm__InitTrieCore(ScmModule *mod);
+
+#endif /* GAUCHE_DATA_TRIE_CORE_H */
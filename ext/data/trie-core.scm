@@ -0,0 +1,122 @@
+;;;
+;;; data.trie-core - adaptive radix trie
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; A compressed radix trie keyed by strings and u8vectors, implemented
+;; in trie-core.c.  The user-level interface is exported from data.trie.
+
+(define-module data.trie-core
+  (export <radix-trie>
+          make-radix-trie radix-trie? radix-trie-num-entries
+          radix-trie-exists? radix-trie-partial-key?
+          radix-trie-get radix-trie-put! radix-trie-update!
+          radix-trie-delete! radix-trie-clear!
+          radix-trie-longest-match
+          radix-trie-common-prefix radix-trie-common-prefix-keys
+          radix-trie-common-prefix-values radix-trie-common-prefix-fold
+          radix-trie->list radix-trie-keys radix-trie-values
+          radix-trie-fold radix-trie-for-each alist->radix-trie))
+(select-module data.trie-core)
+
+(inline-stub
+ (declcode "#include \"trie-core.h\"")
+ (initcode "Scm__InitTrieCore(Scm_CurrentModule());")
+
+ (define-type <radix-trie> "ScmRadixTrie*" "radix trie"
+   "SCM_RADIX_TRIE_P" "SCM_RADIX_TRIE")
+
+ (define-cproc make-radix-trie () Scm__MakeRadixTrie)
+ (define-cproc radix-trie? (obj) ::<boolean> (return (SCM_RADIX_TRIE_P obj)))
+ (define-cproc radix-trie-num-entries (t::<radix-trie>) ::<fixnum>
+   Scm__RadixTrieNumEntries)
+
+ (define-cproc radix-trie-get (t::<radix-trie> key :optional fallback)
+   Scm__RadixTrieGet)
+ (define-cproc radix-trie-exists? (t::<radix-trie> key) ::<boolean>
+   (return (not (SCM_UNBOUNDP (Scm__RadixTrieGet t key SCM_UNBOUND)))))
+ (define-cproc radix-trie-put! (t::<radix-trie> key value) ::<void>
+   (Scm__RadixTriePut t key value))
+ (define-cproc radix-trie-delete! (t::<radix-trie> key) ::<boolean>
+   Scm__RadixTrieDelete)
+ (define-cproc radix-trie-clear! (t::<radix-trie>) ::<void>
+   Scm__RadixTrieClear)
+ (define-cproc radix-trie-partial-key? (t::<radix-trie> prefix) ::<boolean>
+   Scm__RadixTriePartialKeyP)
+
+ (define-cproc %radix-trie-longest-match (t::<radix-trie> key)
+   Scm__RadixTrieLongestMatch)
+ (define-cproc %radix-trie->list (t::<radix-trie> prefix limit::<fixnum>)
+   Scm__RadixTrieToList)
+ )
+
+;; Same as trie-update!.  It walks the trie twice, but each walk only
+;; costs the length of KEY.
+(define (radix-trie-update! t key proc . fallback)
+  (radix-trie-put! t key (proc (apply radix-trie-get t key fallback))))
+
+(define (radix-trie-longest-match t key . fallback)
+  (or (%radix-trie-longest-match t key)
+      (if (pair? fallback)
+        (car fallback)
+        (error "radix trie doesn't have an entry matching key:" key))))
+
+;; The entries are returned in the order of bytes of the keys.  If LIMIT
+;; is given, at most that many entries are returned, e.g. for completion.
+(define (radix-trie-common-prefix t prefix :optional (limit #f))
+  (%radix-trie->list t prefix (or limit -1)))
+
+(define (radix-trie-common-prefix-keys t prefix :optional (limit #f))
+  (map car (radix-trie-common-prefix t prefix limit)))
+
+(define (radix-trie-common-prefix-values t prefix :optional (limit #f))
+  (map cdr (radix-trie-common-prefix t prefix limit)))
+
+;; PROC is called after the entries are collected, so it may modify
+;; the trie.
+(define (radix-trie-common-prefix-fold t prefix proc seed)
+  (fold (^[kv s] (proc (car kv) (cdr kv) s)) seed
+        (radix-trie-common-prefix t prefix)))
+
+(define (radix-trie->list t) (%radix-trie->list t #f -1))
+(define (radix-trie-keys t) (map car (radix-trie->list t)))
+(define (radix-trie-values t) (map cdr (radix-trie->list t)))
+
+(define (radix-trie-fold t proc seed)
+  (fold (^[kv s] (proc (car kv) (cdr kv) s)) seed (radix-trie->list t)))
+
+(define (radix-trie-for-each t proc)
+  (for-each (^[kv] (proc (car kv) (cdr kv))) (radix-trie->list t)))
+
+(define (alist->radix-trie alist)
+  (rlet1 t (make-radix-trie)
+    (for-each (^p (radix-trie-put! t (car p) (cdr p))) alist)))
@@ -130,6 +130,36 @@
   (when (positive? (gdbm-delete (gdbm-file-of self) (%dbm-k2s self key)))
     (errorf "dbm-delete!: deleteting key ~s from ~s failed" key self)))
 
+;;
+;; Transactions
+;;
+;;  gdbm can't roll back, but we can stop syncing at every write
+;;  during the transaction and sync once at the end.
+;;
+
+(define-method dbm-begin! ((self <gdbm>))
+  (next-method)
+  (when (slot-ref self 'sync)
+    (gdbm-setopt (gdbm-file-of self) GDBM_SYNCMODE #f)))
+
+(define-method dbm-commit! ((self <gdbm>))
+  (let1 gdbm (gdbm-file-of self)
+    (when (and gdbm (not (gdbm-closed? gdbm)) (slot-ref self 'sync))
+      (gdbm-setopt gdbm GDBM_SYNCMODE #t)
+      (gdbm-sync gdbm))))
+
+(define-method dbm-batch-put! ((self <gdbm>) kvs)
+  (%dbm-check-writable self "dbm-batch-put!")
+  (dbm-transaction
+   self
+   (^[]
+     (unless (zero? (%gdbm-store-pairs
+                     (gdbm-file-of self)
+                     (map (^[kv] (cons (%dbm-k2s self (car kv))
+                                       (%dbm-v2s self (cdr kv))))
+                          kvs)))
+       (error "dbm-batch-put! failed" self)))))
+
 ;;
 ;; Iterations
 ;;
@@ -261,6 +291,22 @@
      (TO_DATUM dval val)
      (return (gdbm_store (-> gdbm dbf) dkey dval flags))))
 
+ ;; Stores a list of (key . value) of strings.  Returns 0 on success,
+ ;; or the gdbm_store result of the first failure.
+ (define-cproc %gdbm-store-pairs (gdbm::<gdbm-file> kvs) ::<int>
+   (let* ([dkey::datum] [dval::datum])
+     (CHECK_GDBM gdbm)
+     (dolist [kv kvs]
+       (unless (and (SCM_PAIRP kv)
+                    (SCM_STRINGP (SCM_CAR kv))
+                    (SCM_STRINGP (SCM_CDR kv)))
+         (Scm_Error "pair of strings required, but got: %S" kv))
+       (TO_DATUM dkey (SCM_STRING (SCM_CAR kv)))
+       (TO_DATUM dval (SCM_STRING (SCM_CDR kv)))
+       (let* ([r::int (gdbm_store (-> gdbm dbf) dkey dval GDBM_REPLACE)])
+         (unless (== r 0) (return r))))
+     (return 0)))
+
  (define-cproc gdbm-fetch (gdbm::<gdbm-file> key::<string>)
    (let* ([dkey::datum] [dval::datum])
      (CHECK_GDBM gdbm)
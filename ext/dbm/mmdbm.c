@@ -0,0 +1,1706 @@
+/*
+ * mmdbm.c - memory-mapped B+-tree dbm
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "atomic_ops.h"
+#include <gauche.h>
+#include <gauche/vm.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "dbmconf.h"
+#if defined(HAVE_FLOCK)
+#include <sys/file.h>
+#endif
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "mmdbm.h"
+
+/*=====================================================
+ * File layout
+ *
+ *  The data file is an array of 4KB pages.  Pages 0 and 1 are meta
+ *  pages; the one with the larger transaction id is current.  A write
+ *  transaction never modifies a page reachable from the current meta.
+ *  It copies the pages on the path to the modified leaf, writes them
+ *  to free places, and finally writes a new meta into the other meta
+ *  page.  That's the commit point; if we crash before it, the old meta
+ *  is still intact.  A meta page is protected by a checksum, so that
+ *  a torn meta is ignored.
+ *
+ *  Readers take no lock.  They note the current meta's transaction id
+ *  in the reader table, and use the root page number in it.  Pages
+ *  freed by transaction T were reachable from snapshot T-1, so they
+ *  can be reused only when no reader looks at a snapshot older than T.
+ *
+ *  The reader table lives in a separate lock file, PATH.lock, mapped
+ *  read-write by every process.  A slot holds the pid of the reader
+ *  and the transaction id it's looking at (0 while it's getting the
+ *  meta).  A reader claims a free slot with CAS.  Writers are
+ *  serialized by flock(2) on the lock file.  If a slot remains
+ *  occupied by a dead process, the writer clears it.
+ *  NB: On 32bit platforms the transaction id in the slot is truncated
+ *  to a word, which goes wrong after 2^32 commits.
+ *
+ *  Tree pages are slotted pages: an array of 16bit node offsets
+ *  follows the header, and nodes are placed from the end of the page.
+ *  The first node of a branch page has an empty key, which stands
+ *  for "less than anything".  A value that makes its leaf node larger
+ *  than NODE_MAX is stored in a run of overflow pages.
+ *
+ *  Free pages are recorded in freelist record pages, each of which
+ *  lists page numbers freed by one transaction (or by anyone, if its
+ *  transaction id is 0).  The record pages are listed in a chain of
+ *  directory pages in ascending order of the transaction id.  A write
+ *  transaction loads the directory, takes records that are old enough
+ *  when it needs a page, and writes a new directory at commit.
+ */
+
+#define PAGESIZE       4096
+#define MMDBM_MAGIC    0x4d4d4442u  /* "MMDB" */
+#define MMDBM_VERSION  1
+#define LOCK_MAGIC     (0x4d4d4c4bu + sizeof(AO_t))
+#define MAX_KEY        511
+#define NODE_MAX       1000
+#define MAX_DEPTH      64
+#define NSLOTS         500
+
+#if SIZEOF_LONG >= 8
+#define DEFAULT_MAPSIZE  ((size_t)1<<30)
+#else
+#define DEFAULT_MAPSIZE  ((size_t)64<<20)
+#endif
+
+enum {
+    P_META = 1,
+    P_BRANCH,
+    P_LEAF,
+    P_OVERFLOW,
+    P_FREEREC,
+    P_FREEDIR
+};
+
+typedef struct {
+    uint32_t type;
+    uint16_t nkeys;             /* # of nodes or entries */
+    uint16_t lower;             /* end of the offset array */
+    uint16_t upper;             /* start of the node area */
+    uint16_t unused;
+    uint32_t aux;               /* overflow: # of pages,
+                                   directory: next directory page */
+} page_hdr;
+
+#define HDRSIZE        sizeof(page_hdr)
+#define PHDR(p)        ((page_hdr*)(p))
+#define OFFS(p)        ((uint16_t*)((char*)(p) + HDRSIZE))
+#define NODE(p, i)     ((node_hdr*)((char*)(p) + OFFS(p)[i]))
+#define FREESPACE(p)   (PHDR(p)->upper - PHDR(p)->lower)
+#define USEDSPACE(p)   (PAGESIZE - HDRSIZE - FREESPACE(p))
+#define ALIGN4(n)      (((n) + 3) & ~(size_t)3)
+#define MAX_NODES      (PAGESIZE/10 + 2)
+
+/* Nodes are aligned to 4 bytes.  In a leaf node, the key is followed
+   by the value, or the first page number of the overflow pages. */
+typedef struct {
+    uint32_t val;               /* leaf: value size; branch: child page */
+    uint16_t ksize;
+    uint16_t flags;
+} node_hdr;
+
+#define NHDRSIZE       sizeof(node_hdr)
+#define NKEY(n)        ((const char*)(n) + NHDRSIZE)
+#define N_BIG          1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pagesize;
+    uint32_t depth;
+    uint64_t txnid;
+    uint64_t mapsize;
+    uint64_t nentries;
+    uint32_t root;              /* 0 if the tree is empty */
+    uint32_t npages;
+    uint32_t freedir;           /* 0 if there's no free page */
+    uint32_t unused;
+    uint64_t checksum;
+} meta_t;
+
+/* Freelist */
+#define REC_ENTRIES    ((PAGESIZE - HDRSIZE)/sizeof(uint32_t))
+#define DIR_ENTRIES    ((PAGESIZE - HDRSIZE)/sizeof(dir_ent))
+
+typedef struct {
+    uint64_t txnid;
+    uint32_t pgno;
+    uint32_t unused;
+} dir_ent;
+
+/* Lock file */
+typedef struct {
+    volatile AO_t pid;          /* 0 if free */
+    volatile AO_t txnid;        /* 0 while setting up */
+} reader_slot;
+
+typedef struct {
+    volatile AO_t magic;
+    AO_t unused;
+    reader_slot slots[NSLOTS];
+} lock_area;
+
+#define LOCKSIZE  ((sizeof(lock_area) + PAGESIZE - 1) & ~(size_t)(PAGESIZE-1))
+
+/* Write transaction */
+typedef struct {
+    uint32_t pgno;              /* 0 for an empty entry */
+    uint32_t npg;               /* # of pages; 0 if freed again */
+    char *buf;
+} dirty_ent;
+
+typedef struct {
+    uint32_t *v;
+    size_t n;
+    size_t cap;
+} pgvec;
+
+typedef struct {
+    ScmMmdbm *db;
+    ScmVM *owner;
+    meta_t m;                   /* working meta */
+    uint32_t basepages;         /* npages of the snapshot we started */
+    uint64_t oldest;            /* oldest snapshot a reader may look at */
+    dirty_ent *dirty;           /* open addressing table of new pages */
+    size_t dsize;
+    size_t dcount;
+    pgvec freed;                /* pages freed by this transaction */
+    pgvec pool;                 /* pages we can use now */
+    pgvec olddir;               /* old directory pages */
+    dir_ent *dir;               /* directory entries */
+    size_t ndir;
+    size_t dirnext;             /* entries before this are taken */
+    int changed;
+    int busy;                   /* set while an operation runs.  if it's
+                                   left set, the operation failed. */
+} txn_t;
+
+struct ScmMmdbmCursorRec {
+    SCM_HEADER;
+    ScmMmdbm *db;
+    reader_slot *slot;          /* NULL if closed */
+    uint32_t npages;
+    int depth;
+    struct {
+        uint32_t pgno;
+        int idx;
+    } stack[MAX_DEPTH];
+};
+
+static void txn_end(ScmMmdbm *db);
+
+/*=====================================================
+ * Utilities
+ */
+
+static int keycmp(const char *a, size_t alen, const char *b, size_t blen)
+{
+    int r = memcmp(a, b, (alen < blen)? alen : blen);
+    if (r != 0) return r;
+    return (alen < blen)? -1 : (alen > blen)? 1 : 0;
+}
+
+static uint64_t meta_sum(const meta_t *m)
+{
+    const unsigned char *p = (const unsigned char*)m;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < offsetof(meta_t, checksum); i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static int meta_valid(const meta_t *m)
+{
+    return (m->magic == MMDBM_MAGIC
+            && m->version == MMDBM_VERSION
+            && m->pagesize == PAGESIZE
+            && m->npages >= 2
+            && m->checksum == meta_sum(m));
+}
+
+/* Picks the current meta from M0 and M1.  Returns FALSE if neither
+   is valid. */
+static int pick_meta(const meta_t *m0, const meta_t *m1, meta_t *out)
+{
+    int v0 = meta_valid(m0), v1 = meta_valid(m1);
+    if (v0 && (!v1 || m0->txnid > m1->txnid)) { *out = *m0; return TRUE; }
+    if (v1) { *out = *m1; return TRUE; }
+    return FALSE;
+}
+
+/* Reads the current meta through the mapping.  The writer may be
+   overwriting the older one; we retry if we see a torn one. */
+static int read_meta(ScmMmdbm *db, meta_t *out)
+{
+    for (int tries = 0; tries < 100; tries++) {
+        meta_t m0, m1;
+        AO_nop_full();
+        memcpy(&m0, db->map + HDRSIZE, sizeof(meta_t));
+        memcpy(&m1, db->map + PAGESIZE + HDRSIZE, sizeof(meta_t));
+        if (pick_meta(&m0, &m1, out)) return TRUE;
+    }
+    return FALSE;
+}
+
+static void pgvec_push(pgvec *v, uint32_t pgno)
+{
+    if (v->n == v->cap) {
+        size_t ncap = v->cap? v->cap*2 : 64;
+        uint32_t *nv = SCM_NEW_ATOMIC_ARRAY(uint32_t, ncap);
+        if (v->n) memcpy(nv, v->v, v->n * sizeof(uint32_t));
+        v->v = nv;
+        v->cap = ncap;
+    }
+    v->v[v->n++] = pgno;
+}
+
+static void write_all(ScmMmdbm *db, const char *buf, size_t size, off_t off)
+{
+    while (size > 0) {
+        ssize_t r = pwrite(db->fd, buf, size, off);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            Scm_SysError("mmdbm: write failed on %S", db->name);
+        }
+        buf += r; size -= r; off += r;
+    }
+}
+
+static void sync_file(ScmMmdbm *db)
+{
+    int r;
+    if (db->nosync) return;
+#if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+    SCM_SYSCALL(r, fdatasync(db->fd));
+#else
+    SCM_SYSCALL(r, fsync(db->fd));
+#endif
+    if (r < 0) Scm_SysError("mmdbm: sync failed on %S", db->name);
+}
+
+static int lock_writer(int fd, int lock)
+{
+    int r;
+#if defined(HAVE_FLOCK)
+    SCM_SYSCALL(r, flock(fd, lock? LOCK_EX : LOCK_UN));
+#else
+    struct flock fl;
+    fl.l_type = lock? F_WRLCK : F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fl.l_start = 0;
+    fl.l_len = 1;
+    SCM_SYSCALL(r, fcntl(fd, F_SETLKW, &fl));
+#endif
+    return r;
+}
+
+static void check_open(ScmMmdbm *db)
+{
+    if (db->fd < 0) Scm_Error("mmdbm: database already closed: %S", db);
+}
+
+static void corrupted(ScmMmdbm *db, uint32_t pgno)
+{
+    Scm_Error("mmdbm: database %S is corrupted (page %u)",
+              db->name, pgno);
+}
+
+/*=====================================================
+ * Reader table
+ */
+
+static reader_slot *reader_begin(ScmMmdbm *db, meta_t *m)
+{
+    lock_area *la = (lock_area*)db->lock;
+    AO_t pid = (AO_t)db->pid;
+    size_t start = AO_fetch_and_add1((volatile AO_t*)&db->slotHint);
+    reader_slot *s = NULL;
+
+    for (size_t k = 0; k < NSLOTS; k++) {
+        reader_slot *c = &la->slots[(start + k) % NSLOTS];
+        if (AO_load(&c->pid) == 0
+            && AO_compare_and_swap_full(&c->pid, 0, pid)) {
+            s = c;
+            break;
+        }
+    }
+    if (s == NULL) {
+        Scm_Error("mmdbm: too many concurrent readers on %S", db->name);
+    }
+    /* Once our snapshot id is visible in the slot, the writer won't
+       reuse the pages we need.  We check the meta again, for it may
+       have been updated before the writer saw our slot. */
+    for (;;) {
+        meta_t m2;
+        if (!read_meta(db, m)) break;
+        AO_store_full(&s->txnid, (AO_t)m->txnid);
+        if (!read_meta(db, &m2)) break;
+        if (m2.txnid == m->txnid) {
+            if ((size_t)m->npages * PAGESIZE <= db->mapsize) return s;
+            AO_store_release(&s->txnid, 0);
+            AO_store_release(&s->pid, 0);
+            Scm_Error("mmdbm: database %S has grown beyond the map size "
+                      "of this handle; reopen it", db->name);
+        }
+    }
+    AO_store_release(&s->txnid, 0);
+    AO_store_release(&s->pid, 0);
+    Scm_Error("mmdbm: %S doesn't have a valid meta page", db->name);
+    return NULL;                /* dummy */
+}
+
+static void reader_end(reader_slot *s)
+{
+    AO_store_release(&s->txnid, 0);
+    AO_store_release(&s->pid, 0);
+}
+
+/* Returns the id of the oldest snapshot a reader may be looking at.
+   Slots left by dead processes are cleared. */
+static uint64_t oldest_reader(ScmMmdbm *db, uint64_t current)
+{
+    lock_area *la = (lock_area*)db->lock;
+    uint64_t oldest = current;
+
+    for (int i = 0; i < NSLOTS; i++) {
+        reader_slot *s = &la->slots[i];
+        AO_t pid = AO_load_full(&s->pid);
+        if (pid == 0) continue;
+        AO_t txnid = AO_load_full(&s->txnid);
+        if (txnid == 0 || (uint64_t)txnid >= oldest) continue;
+        if (pid != (AO_t)db->pid
+            && kill((pid_t)pid, 0) < 0 && errno == ESRCH) {
+            /* Nobody but writers touches the slot of a dead process,
+               and we're the only writer. */
+            AO_store_full(&s->txnid, 0);
+            AO_store_full(&s->pid, 0);
+            continue;
+        }
+        oldest = (uint64_t)txnid;
+    }
+    return oldest;
+}
+
+/*=====================================================
+ * Pages
+ */
+
+static void page_init(char *p, uint32_t type)
+{
+    memset(p, 0, HDRSIZE);
+    PHDR(p)->type = type;
+    PHDR(p)->lower = HDRSIZE;
+    PHDR(p)->upper = PAGESIZE;
+}
+
+static size_t node_size(const node_hdr *n, int leaf)
+{
+    if (!leaf) return ALIGN4(NHDRSIZE + n->ksize);
+    if (n->flags & N_BIG) return ALIGN4(NHDRSIZE + n->ksize + 4);
+    return ALIGN4(NHDRSIZE + n->ksize + n->val);
+}
+
+static uint32_t node_overflow(const node_hdr *n)
+{
+    uint32_t pgno;
+    memcpy(&pgno, NKEY(n) + n->ksize, sizeof(pgno));
+    return pgno;
+}
+
+/* The caller must make sure that the node fits. */
+static void page_insert(char *p, int i, const void *node, size_t size)
+{
+    uint16_t *offs = OFFS(p);
+    int n = PHDR(p)->nkeys;
+    memmove(offs + i + 1, offs + i, (n - i) * sizeof(uint16_t));
+    PHDR(p)->upper -= size;
+    memcpy(p + PHDR(p)->upper, node, size);
+    offs[i] = PHDR(p)->upper;
+    PHDR(p)->nkeys++;
+    PHDR(p)->lower += sizeof(uint16_t);
+}
+
+static void page_append(char *p, const void *node, size_t size)
+{
+    page_insert(p, PHDR(p)->nkeys, node, size);
+}
+
+/* Appends a branch node with its key replaced by KEY. */
+static void page_append_branch(char *p, uint32_t child,
+                               const char *key, size_t klen)
+{
+    char buf[NHDRSIZE + MAX_KEY + 4];
+    node_hdr *n = (node_hdr*)buf;
+    size_t size = ALIGN4(NHDRSIZE + klen);
+    memset(buf, 0, size);
+    n->val = child;
+    n->ksize = (uint16_t)klen;
+    memcpy(buf + NHDRSIZE, key, klen);
+    page_append(p, buf, size);
+}
+
+/* Removes the I-th node.  If it's the first node of a branch, the
+   next one becomes the first and loses its key. */
+static void page_remove(char *p, int i)
+{
+    char tmp[PAGESIZE];
+    int leaf = (PHDR(p)->type == P_LEAF);
+    int n = PHDR(p)->nkeys;
+
+    page_init(tmp, PHDR(p)->type);
+    for (int k = 0; k < n; k++) {
+        if (k == i) continue;
+        node_hdr *nd = NODE(p, k);
+        if (!leaf && PHDR(tmp)->nkeys == 0) {
+            page_append_branch(tmp, nd->val, "", 0);
+        } else {
+            page_append(tmp, nd, node_size(nd, leaf));
+        }
+    }
+    memcpy(p, tmp, PAGESIZE);
+}
+
+/* Returns the index of the first node whose key isn't less than KEY. */
+static int leaf_search(const char *p, const char *key, size_t klen,
+                       int *exact)
+{
+    int lo = 0, hi = PHDR(p)->nkeys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const node_hdr *n = NODE(p, mid);
+        if (keycmp(NKEY(n), n->ksize, key, klen) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    *exact = FALSE;
+    if (lo < PHDR(p)->nkeys) {
+        const node_hdr *n = NODE(p, lo);
+        *exact = (keycmp(NKEY(n), n->ksize, key, klen) == 0);
+    }
+    return lo;
+}
+
+/* Returns the index of the child that covers KEY. */
+static int branch_search(const char *p, const char *key, size_t klen)
+{
+    int lo = 1, hi = PHDR(p)->nkeys;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        const node_hdr *n = NODE(p, mid);
+        if (keycmp(NKEY(n), n->ksize, key, klen) <= 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo - 1;
+}
+
+/*=====================================================
+ * Read access
+ */
+
+/* Returns the page, or NULL if PGNO is out of the snapshot. */
+static const char *snap_page(ScmMmdbm *db, uint32_t npages, uint32_t pgno)
+{
+    if (pgno < 2 || pgno >= npages) return NULL;
+    return db->map + (size_t)pgno * PAGESIZE;
+}
+
+/* Looks up KEY in the snapshot and returns the value, or NULL.
+   *BAD is set if the file is broken. */
+static const char *snap_get(ScmMmdbm *db, const meta_t *m,
+                            const char *key, size_t klen,
+                            size_t *vlen, int *bad)
+{
+    uint32_t pgno = m->root;
+    *bad = FALSE;
+    if (pgno == 0) return NULL;
+    for (int depth = 0; depth < MAX_DEPTH; depth++) {
+        const char *p = snap_page(db, m->npages, pgno);
+        if (p == NULL) break;
+        if (PHDR(p)->type == P_BRANCH && PHDR(p)->nkeys > 0) {
+            pgno = NODE(p, branch_search(p, key, klen))->val;
+            continue;
+        }
+        if (PHDR(p)->type != P_LEAF) break;
+        int exact;
+        int i = leaf_search(p, key, klen, &exact);
+        if (!exact) return NULL;
+        const node_hdr *n = NODE(p, i);
+        *vlen = n->val;
+        if (!(n->flags & N_BIG)) return NKEY(n) + n->ksize;
+        uint32_t ov = node_overflow(n);
+        const char *op = snap_page(db, m->npages, ov);
+        if (op == NULL || PHDR(op)->type != P_OVERFLOW
+            || (uint64_t)ov + PHDR(op)->aux > m->npages
+            || HDRSIZE + (uint64_t)n->val > (uint64_t)PHDR(op)->aux*PAGESIZE) {
+            break;
+        }
+        return op + HDRSIZE;
+    }
+    *bad = TRUE;
+    return NULL;
+}
+
+/*=====================================================
+ * Write transaction - page management
+ */
+
+static dirty_ent *dirty_find(txn_t *t, uint32_t pgno)
+{
+    size_t mask = t->dsize - 1;
+    for (size_t i = (pgno * 2654435761u) & mask; ; i = (i + 1) & mask) {
+        if (t->dirty[i].pgno == pgno) return &t->dirty[i];
+        if (t->dirty[i].pgno == 0) return NULL;
+    }
+}
+
+static void dirty_add(txn_t *t, uint32_t pgno, uint32_t npg, char *buf)
+{
+    if ((t->dcount + 1) * 4 > t->dsize * 3) {
+        dirty_ent *old = t->dirty;
+        size_t osize = t->dsize;
+        t->dsize *= 2;
+        t->dirty = SCM_NEW_ARRAY(dirty_ent, t->dsize);
+        memset(t->dirty, 0, t->dsize * sizeof(dirty_ent));
+        t->dcount = 0;
+        for (size_t i = 0; i < osize; i++) {
+            if (old[i].pgno) dirty_add(t, old[i].pgno, old[i].npg, old[i].buf);
+        }
+    }
+    size_t mask = t->dsize - 1;
+    size_t i = (pgno * 2654435761u) & mask;
+    while (t->dirty[i].pgno != 0) i = (i + 1) & mask;
+    t->dirty[i].pgno = pgno;
+    t->dirty[i].npg = npg;
+    t->dirty[i].buf = buf;
+    t->dcount++;
+}
+
+/* Returns a page as this transaction sees it. */
+static const char *txn_page(txn_t *t, uint32_t pgno)
+{
+    dirty_ent *e = dirty_find(t, pgno);
+    if (e && e->npg) return e->buf;
+    const char *p = snap_page(t->db, t->basepages, pgno);
+    if (p == NULL) corrupted(t->db, pgno);
+    return p;
+}
+
+static void check_room(txn_t *t, uint32_t npg)
+{
+    if (((uint64_t)t->m.npages + npg) * PAGESIZE > t->db->mapsize) {
+        Scm_Error("mmdbm: database %S is full (map size %lu bytes); "
+                  "reopen it with a larger map size",
+                  t->db->name, (u_long)t->db->mapsize);
+    }
+}
+
+/* Moves the page numbers in the next freelist record to the pool.
+   The record page itself is freed by us. */
+static void take_record(txn_t *t)
+{
+    uint32_t pgno = t->dir[t->dirnext++].pgno;
+    const char *p = snap_page(t->db, t->basepages, pgno);
+    if (p == NULL || PHDR(p)->type != P_FREEREC
+        || PHDR(p)->nkeys > REC_ENTRIES) {
+        corrupted(t->db, pgno);
+    }
+    const uint32_t *e = (const uint32_t*)(p + HDRSIZE);
+    for (int i = 0; i < PHDR(p)->nkeys; i++) {
+        if (e[i] < 2 || e[i] >= t->basepages) corrupted(t->db, pgno);
+        pgvec_push(&t->pool, e[i]);
+    }
+    pgvec_push(&t->freed, pgno);
+}
+
+static uint32_t new_page(txn_t *t, uint32_t pgno, char **buf)
+{
+    dirty_ent *e = dirty_find(t, pgno);
+    if (e) {
+        /* we freed it in this transaction */
+        e->npg = 1;
+        *buf = e->buf;
+    } else {
+        *buf = SCM_NEW_ATOMIC2(char*, PAGESIZE);
+        dirty_add(t, pgno, 1, *buf);
+    }
+    memset(*buf, 0, PAGESIZE);
+    return pgno;
+}
+
+/* Allocates a page for the freelist.  It doesn't take records, which
+   would change the freelist we're writing. */
+static uint32_t alloc_list_page(txn_t *t, char **buf)
+{
+    if (t->pool.n > 0) return new_page(t, t->pool.v[--t->pool.n], buf);
+    check_room(t, 1);
+    return new_page(t, t->m.npages++, buf);
+}
+
+static uint32_t alloc_page(txn_t *t, char **buf)
+{
+    while (t->pool.n == 0
+           && t->dirnext < t->ndir
+           && t->dir[t->dirnext].txnid <= t->oldest) {
+        take_record(t);
+    }
+    return alloc_list_page(t, buf);
+}
+
+/* A run of pages for a large value is always taken from the end. */
+static uint32_t alloc_run(txn_t *t, uint32_t npg, char **buf)
+{
+    if (npg == 1) return alloc_page(t, buf);
+    check_room(t, npg);
+    uint32_t pgno = t->m.npages;
+    t->m.npages += npg;
+    *buf = SCM_NEW_ATOMIC2(char*, (size_t)npg * PAGESIZE);
+    memset(*buf, 0, (size_t)npg * PAGESIZE);
+    dirty_add(t, pgno, npg, *buf);
+    return pgno;
+}
+
+/* A page we allocated can be reused at once.  A page of the snapshot
+   waits until the readers are gone. */
+static void free_pages(txn_t *t, uint32_t pgno, uint32_t npg)
+{
+    dirty_ent *e = dirty_find(t, pgno);
+    if (e && e->npg) {
+        for (uint32_t k = 0; k < e->npg; k++) pgvec_push(&t->pool, pgno + k);
+        e->npg = 0;
+    } else {
+        for (uint32_t k = 0; k < npg; k++) pgvec_push(&t->freed, pgno + k);
+    }
+}
+
+/* Returns a writable copy of the page and its new page number. */
+static uint32_t touch(txn_t *t, uint32_t pgno, char **buf)
+{
+    dirty_ent *e = dirty_find(t, pgno);
+    if (e && e->npg) {
+        *buf = e->buf;
+        return pgno;
+    }
+    const char *src = snap_page(t->db, t->basepages, pgno);
+    if (src == NULL) corrupted(t->db, pgno);
+    uint32_t np = alloc_page(t, buf);
+    memcpy(*buf, src, PAGESIZE);
+    free_pages(t, pgno, 1);
+    return np;
+}
+
+static void free_overflow(txn_t *t, const node_hdr *n)
+{
+    uint32_t ov = node_overflow(n);
+    const char *p = txn_page(t, ov);
+    if (PHDR(p)->type != P_OVERFLOW) corrupted(t->db, ov);
+    free_pages(t, ov, PHDR(p)->aux);
+}
+
+static const char *tree_page(txn_t *t, uint32_t pgno)
+{
+    const char *p = txn_page(t, pgno);
+    uint32_t type = PHDR(p)->type;
+    if ((type != P_LEAF && type != P_BRANCH)
+        || (type == P_BRANCH && PHDR(p)->nkeys == 0)) {
+        corrupted(t->db, pgno);
+    }
+    return p;
+}
+
+/*=====================================================
+ * Write transaction - tree operations
+ */
+
+typedef struct {
+    int split;
+    uint32_t right;             /* new right sibling */
+    size_t seplen;              /* its separator key */
+    char sep[MAX_KEY];
+} split_t;
+
+/* Builds a leaf node in BUF and returns its size.  A large value is
+   written to overflow pages here. */
+static size_t make_leaf(txn_t *t, char *buf, const char *key, size_t klen,
+                        const char *val, size_t vlen)
+{
+    node_hdr *n = (node_hdr*)buf;
+    size_t size;
+
+    if (NHDRSIZE + klen + vlen <= NODE_MAX) {
+        size = ALIGN4(NHDRSIZE + klen + vlen);
+        memset(buf, 0, size);
+        memcpy(buf + NHDRSIZE + klen, val, vlen);
+    } else {
+        char *ob;
+        uint32_t npg = (uint32_t)((HDRSIZE + vlen + PAGESIZE - 1) / PAGESIZE);
+        uint32_t ov = alloc_run(t, npg, &ob);
+        PHDR(ob)->type = P_OVERFLOW;
+        PHDR(ob)->aux = npg;
+        memcpy(ob + HDRSIZE, val, vlen);
+        size = ALIGN4(NHDRSIZE + klen + 4);
+        memset(buf, 0, size);
+        memcpy(buf + NHDRSIZE + klen, &ov, sizeof(ov));
+        n->flags = N_BIG;
+    }
+    n->val = (uint32_t)vlen;
+    n->ksize = (uint16_t)klen;
+    memcpy(buf + NHDRSIZE, key, klen);
+    return size;
+}
+
+/* Page P doesn't have room for NODE at AT.  Distributes the nodes to
+   P and a new right sibling, as evenly as possible in bytes. */
+static void split_page(txn_t *t, char *p, int at, const void *node,
+                       size_t nsize, split_t *sp)
+{
+    char old[PAGESIZE];
+    const node_hdr *nodes[MAX_NODES];
+    size_t sizes[MAX_NODES];
+    uint32_t type = PHDR(p)->type;
+    int leaf = (type == P_LEAF);
+    int n = PHDR(p)->nkeys + 1;
+
+    memcpy(old, p, PAGESIZE);
+    for (int k = 0; k < n; k++) {
+        if (k < at)       nodes[k] = NODE(old, k);
+        else if (k == at) nodes[k] = (const node_hdr*)node;
+        else              nodes[k] = NODE(old, k-1);
+        sizes[k] = (k == at)? nsize : node_size(nodes[k], leaf);
+    }
+
+    size_t total = 0;
+    for (int k = 0; k < n; k++) total += sizes[k] + 2;
+    int split = 1;
+    size_t best = SIZE_MAX, acc = 0;
+    for (int s = 1; s < n; s++) {
+        acc += sizes[s-1] + 2;
+        size_t rest = total - acc;
+        /* the first node of the right branch loses its key */
+        if (!leaf) rest = rest - sizes[s] + NHDRSIZE;
+        size_t big = (acc > rest)? acc : rest;
+        if (big < best) { best = big; split = s; }
+    }
+    SCM_ASSERT(best <= PAGESIZE - HDRSIZE);
+
+    const node_hdr *first = nodes[split];
+    if (leaf) {
+        /* The shortest prefix of the right key that is greater than
+           the left key will do. */
+        const node_hdr *last = nodes[split-1];
+        size_t lcp = 0;
+        while (lcp < last->ksize && lcp < first->ksize
+               && NKEY(last)[lcp] == NKEY(first)[lcp]) {
+            lcp++;
+        }
+        sp->seplen = (lcp < first->ksize)? lcp + 1 : first->ksize;
+    } else {
+        sp->seplen = first->ksize;
+    }
+    memcpy(sp->sep, NKEY(first), sp->seplen);
+
+    char *rp;
+    sp->right = alloc_page(t, &rp);
+    sp->split = TRUE;
+    page_init(p, type);
+    page_init(rp, type);
+    for (int k = 0; k < split; k++) page_append(p, nodes[k], sizes[k]);
+    for (int k = split; k < n; k++) {
+        if (!leaf && k == split) {
+            page_append_branch(rp, nodes[k]->val, "", 0);
+        } else {
+            page_append(rp, nodes[k], sizes[k]);
+        }
+    }
+}
+
+static uint32_t tree_insert(txn_t *t, uint32_t pgno,
+                            const char *node, size_t nsize,
+                            const char *key, size_t klen,
+                            int *replaced, split_t *sp, int depth)
+{
+    char *p;
+    uint32_t np;
+
+    if (depth >= MAX_DEPTH) corrupted(t->db, pgno);
+    tree_page(t, pgno);
+    np = touch(t, pgno, &p);
+
+    if (PHDR(p)->type == P_LEAF) {
+        int exact;
+        int i = leaf_search(p, key, klen, &exact);
+        if (exact) {
+            node_hdr *old = NODE(p, i);
+            if (old->flags & N_BIG) free_overflow(t, old);
+            page_remove(p, i);
+            *replaced = TRUE;
+        }
+        if (nsize + 2 <= FREESPACE(p)) {
+            page_insert(p, i, node, nsize);
+            sp->split = FALSE;
+        } else {
+            split_page(t, p, i, node, nsize, sp);
+        }
+    } else {
+        split_t csp;
+        int i = branch_search(p, key, klen);
+        uint32_t child = tree_insert(t, NODE(p, i)->val, node, nsize,
+                                     key, klen, replaced, &csp, depth+1);
+        NODE(p, i)->val = child;
+        sp->split = FALSE;
+        if (csp.split) {
+            char buf[NHDRSIZE + MAX_KEY + 4];
+            node_hdr *bn = (node_hdr*)buf;
+            size_t bsize = ALIGN4(NHDRSIZE + csp.seplen);
+            memset(buf, 0, bsize);
+            bn->val = csp.right;
+            bn->ksize = (uint16_t)csp.seplen;
+            memcpy(buf + NHDRSIZE, csp.sep, csp.seplen);
+            if (bsize + 2 <= FREESPACE(p)) {
+                page_insert(p, i+1, buf, bsize);
+            } else {
+                split_page(t, p, i+1, buf, bsize, sp);
+            }
+        }
+    }
+    return np;
+}
+
+static void txn_put(txn_t *t, const char *key, size_t klen,
+                    const char *val, size_t vlen)
+{
+    char node[NODE_MAX + 4];
+    size_t nsize = make_leaf(t, node, key, klen, val, vlen);
+    char *p;
+
+    if (t->m.root == 0) {
+        t->m.root = alloc_page(t, &p);
+        page_init(p, P_LEAF);
+        page_append(p, node, nsize);
+        t->m.depth = 1;
+        t->m.nentries = 1;
+    } else {
+        split_t sp;
+        int replaced = FALSE;
+        uint32_t root = tree_insert(t, t->m.root, node, nsize, key, klen,
+                                    &replaced, &sp, 0);
+        if (sp.split) {
+            uint32_t right = sp.right;
+            uint32_t nroot = alloc_page(t, &p);
+            page_init(p, P_BRANCH);
+            page_append_branch(p, root, "", 0);
+            page_append_branch(p, right, sp.sep, sp.seplen);
+            root = nroot;
+            t->m.depth++;
+        }
+        t->m.root = root;
+        if (!replaced) t->m.nentries++;
+    }
+    t->changed = TRUE;
+}
+
+/* Merges the children at I and I+1 of the branch P, if they fit
+   in one page. */
+static void merge_children(txn_t *t, char *p, int i)
+{
+    const node_hdr *sepn = NODE(p, i+1);
+    uint32_t lpg = NODE(p, i)->val, rpg = sepn->val;
+    const char *l = tree_page(t, lpg);
+    const char *r = tree_page(t, rpg);
+    int leaf = (PHDR(l)->type == P_LEAF);
+    char sep[MAX_KEY];
+    size_t seplen = sepn->ksize;
+
+    if (PHDR(r)->type != PHDR(l)->type) corrupted(t->db, rpg);
+    size_t need = USEDSPACE(l) + USEDSPACE(r);
+    if (!leaf) need += ALIGN4(NHDRSIZE + seplen) - NHDRSIZE;
+    if (need > PAGESIZE - HDRSIZE) return;
+
+    memcpy(sep, NKEY(sepn), seplen);
+    char *lp;
+    uint32_t nl = touch(t, lpg, &lp);
+    for (int k = 0; k < PHDR(r)->nkeys; k++) {
+        const node_hdr *n = NODE(r, k);
+        if (!leaf && k == 0) {
+            /* the separator comes down as the key */
+            page_append_branch(lp, n->val, sep, seplen);
+        } else {
+            page_append(lp, n, node_size(n, leaf));
+        }
+    }
+    free_pages(t, rpg, 1);
+    NODE(p, i)->val = nl;
+    page_remove(p, i+1);
+}
+
+/* Returns the new page number of PGNO, or 0 if it became empty. */
+static uint32_t tree_delete(txn_t *t, uint32_t pgno,
+                            const char *key, size_t klen,
+                            int *found, int depth)
+{
+    const char *rp = tree_page(t, pgno);
+    char *p;
+    uint32_t np;
+
+    if (depth >= MAX_DEPTH) corrupted(t->db, pgno);
+    if (PHDR(rp)->type == P_LEAF) {
+        int exact;
+        int i = leaf_search(rp, key, klen, &exact);
+        *found = exact;
+        if (!exact) return pgno;
+        np = touch(t, pgno, &p);
+        node_hdr *n = NODE(p, i);
+        if (n->flags & N_BIG) free_overflow(t, n);
+        if (PHDR(p)->nkeys == 1) {
+            free_pages(t, np, 1);
+            return 0;
+        }
+        page_remove(p, i);
+        return np;
+    } else {
+        int i = branch_search(rp, key, klen);
+        uint32_t child = tree_delete(t, NODE(rp, i)->val, key, klen,
+                                     found, depth+1);
+        if (!*found) return pgno;
+        np = touch(t, pgno, &p);
+        if (child == 0) {
+            if (PHDR(p)->nkeys == 1) {
+                free_pages(t, np, 1);
+                return 0;
+            }
+            page_remove(p, i);
+        } else {
+            NODE(p, i)->val = child;
+            if (USEDSPACE(txn_page(t, child)) < PAGESIZE/4
+                && PHDR(p)->nkeys > 1) {
+                merge_children(t, p, (i+1 < PHDR(p)->nkeys)? i : i-1);
+            }
+        }
+        return np;
+    }
+}
+
+static int txn_delete(txn_t *t, const char *key, size_t klen)
+{
+    int found = FALSE;
+    if (t->m.root == 0) return FALSE;
+    uint32_t root = tree_delete(t, t->m.root, key, klen, &found, 0);
+    if (!found) return FALSE;
+    /* shrink the tree if the root has only one child */
+    while (root != 0) {
+        const char *p = tree_page(t, root);
+        if (PHDR(p)->type != P_BRANCH || PHDR(p)->nkeys > 1) break;
+        uint32_t child = NODE(p, 0)->val;
+        free_pages(t, root, 1);
+        root = child;
+        t->m.depth--;
+    }
+    t->m.root = root;
+    if (root == 0) t->m.depth = 0;
+    t->m.nentries--;
+    t->changed = TRUE;
+    return TRUE;
+}
+
+static const char *txn_get(txn_t *t, const char *key, size_t klen,
+                           size_t *vlen)
+{
+    uint32_t pgno = t->m.root;
+    if (pgno == 0) return NULL;
+    for (int depth = 0; depth < MAX_DEPTH; depth++) {
+        const char *p = tree_page(t, pgno);
+        if (PHDR(p)->type == P_BRANCH) {
+            pgno = NODE(p, branch_search(p, key, klen))->val;
+            continue;
+        }
+        int exact;
+        int i = leaf_search(p, key, klen, &exact);
+        if (!exact) return NULL;
+        const node_hdr *n = NODE(p, i);
+        *vlen = n->val;
+        if (!(n->flags & N_BIG)) return NKEY(n) + n->ksize;
+        return txn_page(t, node_overflow(n)) + HDRSIZE;
+    }
+    corrupted(t->db, pgno);
+    return NULL;                /* dummy */
+}
+
+/*=====================================================
+ * Write transaction - begin and commit
+ */
+
+static void load_freelist(txn_t *t, uint32_t pgno)
+{
+    size_t cap = 0;
+    while (pgno != 0) {
+        const char *p = snap_page(t->db, t->basepages, pgno);
+        if (p == NULL || PHDR(p)->type != P_FREEDIR
+            || PHDR(p)->nkeys > DIR_ENTRIES
+            || t->olddir.n >= t->basepages) {
+            corrupted(t->db, pgno);
+        }
+        int n = PHDR(p)->nkeys;
+        if (t->ndir + n > cap) {
+            size_t ncap = (cap? cap*2 : DIR_ENTRIES);
+            while (ncap < t->ndir + n) ncap *= 2;
+            dir_ent *nd = SCM_NEW_ATOMIC_ARRAY(dir_ent, ncap);
+            if (t->ndir) memcpy(nd, t->dir, t->ndir * sizeof(dir_ent));
+            t->dir = nd;
+            cap = ncap;
+        }
+        memcpy(t->dir + t->ndir, p + HDRSIZE, n * sizeof(dir_ent));
+        t->ndir += n;
+        pgvec_push(&t->olddir, pgno);
+        pgno = PHDR(p)->aux;
+    }
+}
+
+#define CEILDIV(a, b)  (((a) + (b) - 1) / (b))
+
+/* Writes the new freelist.  Its pages come from the pool or the end of
+   the file.  Taking a page from the pool can reduce the # of records
+   we need, so we may end up with an extra page; it's written as an
+   empty record, or as a directory page if we need one more. */
+static void write_freelist(txn_t *t)
+{
+    pgvec alloc = {NULL, 0, 0};
+    size_t nrem = t->ndir - t->dirnext;
+    size_t ndirp;
+    char *buf;
+
+    for (size_t i = 0; i < t->olddir.n; i++) {
+        pgvec_push(&t->freed, t->olddir.v[i]);
+    }
+    for (;;) {
+        size_t nrec = CEILDIV(t->freed.n, REC_ENTRIES)
+            + CEILDIV(t->pool.n, REC_ENTRIES);
+        ndirp = CEILDIV(nrem + nrec, DIR_ENTRIES);
+        if (alloc.n >= nrec + ndirp) break;
+        pgvec_push(&alloc, alloc_list_page(t, &buf));
+    }
+    while (nrem + (alloc.n - ndirp) > ndirp * DIR_ENTRIES) ndirp++;
+
+    /* Directory entries in ascending order of transaction ids:
+       records of usable pages (id 0), the old entries we didn't take,
+       and the records of pages freed by us. */
+    size_t nrec = alloc.n - ndirp;
+    size_t nent = nrem + nrec;
+    dir_ent *ents = SCM_NEW_ATOMIC_ARRAY(dir_ent, nent? nent : 1);
+    size_t nzero = 0, nmine = 0, fi = 0, pi = 0;
+
+    for (size_t r = 0; r < nrec; r++) {
+        uint32_t pgno = alloc.v[ndirp + r];
+        char *p = (char*)txn_page(t, pgno);
+        uint32_t *v = (uint32_t*)(p + HDRSIZE);
+        size_t n = 0;
+        page_init(p, P_FREEREC);
+        if (pi < t->pool.n) {
+            while (pi < t->pool.n && n < REC_ENTRIES) v[n++] = t->pool.v[pi++];
+            ents[nzero++].pgno = pgno;
+        } else if (fi < t->freed.n) {
+            while (fi < t->freed.n && n < REC_ENTRIES) v[n++] = t->freed.v[fi++];
+            nmine++;
+            ents[nent - nmine].pgno = pgno;
+        } else {
+            ents[nzero++].pgno = pgno;
+        }
+        PHDR(p)->nkeys = (uint16_t)n;
+    }
+    SCM_ASSERT(pi == t->pool.n && fi == t->freed.n);
+    for (size_t k = 0; k < nzero; k++) {
+        ents[k].txnid = 0;
+        ents[k].unused = 0;
+    }
+    memcpy(ents + nzero, t->dir + t->dirnext, nrem * sizeof(dir_ent));
+    /* ours were filled from the end; put them back in order */
+    for (size_t k = 0; k < nmine; k++) {
+        ents[nzero + nrem + k].txnid = t->m.txnid;
+        ents[nzero + nrem + k].unused = 0;
+    }
+    for (size_t k = 0; k < nmine/2; k++) {
+        size_t a = nzero + nrem + k, b = nent - 1 - k;
+        uint32_t tmp = ents[a].pgno;
+        ents[a].pgno = ents[b].pgno;
+        ents[b].pgno = tmp;
+    }
+
+    for (size_t d = 0, e = 0; d < ndirp; d++) {
+        char *p = (char*)txn_page(t, alloc.v[d]);
+        size_t n = nent - e;
+        if (n > DIR_ENTRIES) n = DIR_ENTRIES;
+        page_init(p, P_FREEDIR);
+        memcpy(p + HDRSIZE, ents + e, n * sizeof(dir_ent));
+        PHDR(p)->nkeys = (uint16_t)n;
+        PHDR(p)->aux = (d + 1 < ndirp)? alloc.v[d+1] : 0;
+        e += n;
+    }
+    t->m.freedir = ndirp? alloc.v[0] : 0;
+}
+
+static int dirty_cmp(const void *a, const void *b)
+{
+    uint32_t x = ((const dirty_ent*)a)->pgno, y = ((const dirty_ent*)b)->pgno;
+    return (x < y)? -1 : (x > y)? 1 : 0;
+}
+
+static void txn_flush(txn_t *t)
+{
+    ScmMmdbm *db = t->db;
+    dirty_ent *ents = SCM_NEW_ATOMIC_ARRAY(dirty_ent, t->dcount? t->dcount : 1);
+    size_t n = 0;
+
+    for (size_t i = 0; i < t->dsize; i++) {
+        if (t->dirty[i].pgno && t->dirty[i].npg) ents[n++] = t->dirty[i];
+    }
+    qsort(ents, n, sizeof(dirty_ent), dirty_cmp);
+    for (size_t i = 0; i < n; i++) {
+        write_all(db, ents[i].buf, (size_t)ents[i].npg * PAGESIZE,
+                  (off_t)ents[i].pgno * PAGESIZE);
+    }
+    sync_file(db);
+
+    char buf[HDRSIZE + sizeof(meta_t)];
+    meta_t *m = (meta_t*)(buf + HDRSIZE);
+    page_init(buf, P_META);
+    *m = t->m;
+    if (m->mapsize < db->mapsize) m->mapsize = db->mapsize;
+    m->checksum = meta_sum(m);
+    write_all(db, buf, sizeof(buf), (off_t)(m->txnid % 2) * PAGESIZE);
+    sync_file(db);
+}
+
+static txn_t *own_txn(ScmMmdbm *db)
+{
+    txn_t *t = (txn_t*)db->txn;
+    if (t == NULL) return NULL;
+    if (t->owner != Scm_VM()) {
+        Scm_Error("mmdbm: %S is in a transaction of another thread", db);
+    }
+    return t;
+}
+
+void Scm__MmdbmBegin(ScmMmdbm *db)
+{
+    meta_t base;
+
+    check_open(db);
+    if (db->rdonly) Scm_Error("mmdbm: database is read only: %S", db);
+    if (db->txn) Scm_Error("mmdbm: transaction already in progress: %S", db);
+    if (lock_writer(db->lockfd, TRUE) < 0) {
+        Scm_SysError("mmdbm: couldn't lock %S", db->name);
+    }
+    if (!read_meta(db, &base)) {
+        lock_writer(db->lockfd, FALSE);
+        Scm_Error("mmdbm: %S doesn't have a valid meta page", db->name);
+    }
+    if ((size_t)base.npages * PAGESIZE > db->mapsize) {
+        lock_writer(db->lockfd, FALSE);
+        Scm_Error("mmdbm: database %S has grown beyond the map size "
+                  "of this handle; reopen it", db->name);
+    }
+
+    txn_t *t = SCM_NEW(txn_t);
+    memset(t, 0, sizeof(txn_t));
+    t->db = db;
+    t->owner = Scm_VM();
+    t->m = base;
+    t->m.txnid = base.txnid + 1;
+    t->basepages = base.npages;
+    t->oldest = oldest_reader(db, base.txnid);
+    t->dsize = 64;
+    t->dirty = SCM_NEW_ARRAY(dirty_ent, t->dsize);
+    memset(t->dirty, 0, t->dsize * sizeof(dirty_ent));
+    db->txn = t;
+    SCM_UNWIND_PROTECT {
+        load_freelist(t, base.freedir);
+    } SCM_WHEN_ERROR {
+        txn_end(db);
+        SCM_NEXT_HANDLER;
+    } SCM_END_PROTECT;
+}
+
+static void txn_end(ScmMmdbm *db)
+{
+    if (db->txn) {
+        db->txn = NULL;
+        lock_writer(db->lockfd, FALSE);
+    }
+}
+
+void Scm__MmdbmCommit(ScmMmdbm *db)
+{
+    txn_t *t = own_txn(db);
+    if (t == NULL) Scm_Error("mmdbm: no transaction in progress: %S", db);
+    if (t->busy) {
+        txn_end(db);
+        Scm_Error("mmdbm: transaction on %S is aborted by an earlier error",
+                  db);
+    }
+    if (t->changed) {
+        SCM_UNWIND_PROTECT {
+            write_freelist(t);
+            txn_flush(t);
+        } SCM_WHEN_ERROR {
+            txn_end(db);
+            SCM_NEXT_HANDLER;
+        } SCM_END_PROTECT;
+    }
+    txn_end(db);
+}
+
+void Scm__MmdbmAbort(ScmMmdbm *db)
+{
+    if (own_txn(db)) txn_end(db);
+}
+
+int Scm__MmdbmInTransactionP(ScmMmdbm *db)
+{
+    txn_t *t = (txn_t*)db->txn;
+    return (t != NULL && t->owner == Scm_VM());
+}
+
+/*=====================================================
+ * Operations
+ */
+
+static const char *key_bytes(ScmString *key, size_t *len)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(key);
+    *len = SCM_STRING_BODY_SIZE(b);
+    if (*len > MAX_KEY) {
+        Scm_Error("mmdbm: key too long (%ld bytes; max %d): %S",
+                  (long)*len, MAX_KEY, key);
+    }
+    return SCM_STRING_BODY_START(b);
+}
+
+ScmObj Scm__MmdbmGet(ScmMmdbm *db, ScmString *key)
+{
+    size_t klen, vlen;
+    const char *k = key_bytes(key, &klen), *v;
+
+    check_open(db);
+    txn_t *t = (txn_t*)db->txn;
+    if (t && t->owner == Scm_VM()) {
+        v = txn_get(t, k, klen, &vlen);
+        return v? Scm_MakeString(v, vlen, -1, SCM_STRING_COPYING) : SCM_FALSE;
+    }
+
+    meta_t m;
+    int bad;
+    ScmObj r = SCM_FALSE;
+    reader_slot *s = reader_begin(db, &m);
+    v = snap_get(db, &m, k, klen, &vlen, &bad);
+    /* Copy the value before we leave the snapshot */
+    if (v) r = Scm_MakeString(v, vlen, -1, SCM_STRING_COPYING);
+    reader_end(s);
+    if (bad) Scm_Error("mmdbm: database %S is corrupted", db->name);
+    return r;
+}
+
+int Scm__MmdbmExistsP(ScmMmdbm *db, ScmString *key)
+{
+    size_t klen, vlen;
+    const char *k = key_bytes(key, &klen), *v;
+
+    check_open(db);
+    txn_t *t = (txn_t*)db->txn;
+    if (t && t->owner == Scm_VM()) return txn_get(t, k, klen, &vlen) != NULL;
+
+    meta_t m;
+    int bad;
+    reader_slot *s = reader_begin(db, &m);
+    v = snap_get(db, &m, k, klen, &vlen, &bad);
+    reader_end(s);
+    if (bad) Scm_Error("mmdbm: database %S is corrupted", db->name);
+    return v != NULL;
+}
+
+/* Runs an update.  Outside of a transaction, it's committed at once. */
+#define WITH_TXN(db, t, body)                                   \
+    do {                                                        \
+        txn_t *t = own_txn(db);                                 \
+        if (t) {                                                \
+            if (t->busy) {                                      \
+                Scm_Error("mmdbm: transaction on %S is aborted" \
+                          " by an earlier error", db);          \
+            }                                                   \
+            t->busy = TRUE;                                     \
+            body;                                               \
+            t->busy = FALSE;                                    \
+        } else {                                                \
+            Scm__MmdbmBegin(db);                                \
+            t = (txn_t*)db->txn;                                \
+            SCM_UNWIND_PROTECT {                                \
+                body;                                           \
+            } SCM_WHEN_ERROR {                                  \
+                txn_end(db);                                    \
+                SCM_NEXT_HANDLER;                               \
+            } SCM_END_PROTECT;                                  \
+            Scm__MmdbmCommit(db);                               \
+        }                                                       \
+    } while (0)
+
+void Scm__MmdbmPut(ScmMmdbm *db, ScmString *key, ScmString *val)
+{
+    size_t klen;
+    const char *k = key_bytes(key, &klen);
+    const ScmStringBody *vb = SCM_STRING_BODY(val);
+    size_t vlen = SCM_STRING_BODY_SIZE(vb);
+
+    check_open(db);
+    if (db->rdonly) Scm_Error("mmdbm: database is read only: %S", db);
+    if ((uint64_t)vlen > UINT32_MAX) {
+        Scm_Error("mmdbm: value too long: %ld bytes", (long)vlen);
+    }
+    WITH_TXN(db, t, txn_put(t, k, klen, SCM_STRING_BODY_START(vb), vlen));
+}
+
+int Scm__MmdbmDelete(ScmMmdbm *db, ScmString *key)
+{
+    size_t klen;
+    const char *k = key_bytes(key, &klen);
+    int r = FALSE;
+
+    check_open(db);
+    if (db->rdonly) Scm_Error("mmdbm: database is read only: %S", db);
+    WITH_TXN(db, t, r = txn_delete(t, k, klen));
+    return r;
+}
+
+ScmSmallInt Scm__MmdbmCount(ScmMmdbm *db)
+{
+    meta_t m;
+    check_open(db);
+    txn_t *t = (txn_t*)db->txn;
+    if (t && t->owner == Scm_VM()) return (ScmSmallInt)t->m.nentries;
+    if (!read_meta(db, &m)) {
+        Scm_Error("mmdbm: %S doesn't have a valid meta page", db->name);
+    }
+    return (ScmSmallInt)m.nentries;
+}
+
+/*=====================================================
+ * Cursor
+ */
+
+static void cursor_print(ScmObj obj, ScmPort *port,
+                         ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<mmdbm-cursor %S%s>",
+               SCM_MMDBM_CURSOR(obj)->db->name,
+               SCM_MMDBM_CURSOR(obj)->slot? "" : " (closed)");
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_MmdbmCursorClass, cursor_print);
+
+static void unmap_db(ScmMmdbm *db)
+{
+    if (db->map) munmap((void*)db->map, db->mapsize);
+    if (db->lock) munmap(db->lock, LOCKSIZE);
+    db->map = NULL;
+    db->lock = NULL;
+}
+
+static void cursor_finalize(ScmObj obj, void *data)
+{
+    Scm__MmdbmCursorClose(SCM_MMDBM_CURSOR(obj));
+}
+
+ScmObj Scm__MmdbmCursorOpen(ScmMmdbm *db)
+{
+    meta_t m;
+    check_open(db);
+    ScmMmdbmCursor *c = SCM_NEW(ScmMmdbmCursor);
+    SCM_SET_CLASS(c, SCM_CLASS_MMDBM_CURSOR);
+    c->db = db;
+    c->slot = reader_begin(db, &m);
+    c->npages = m.npages;
+    c->depth = 0;
+    if (m.root) {
+        c->stack[0].pgno = m.root;
+        c->stack[0].idx = 0;
+        c->depth = 1;
+    }
+    (void)SCM_INTERNAL_MUTEX_LOCK(db->mutex);
+    db->ncursors++;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(db->mutex);
+    Scm_RegisterFinalizer(SCM_OBJ(c), cursor_finalize, NULL);
+    return SCM_OBJ(c);
+}
+
+void Scm__MmdbmCursorClose(ScmMmdbmCursor *c)
+{
+    ScmMmdbm *db = c->db;
+    if (c->slot == NULL) return;
+    reader_end(c->slot);
+    c->slot = NULL;
+    (void)SCM_INTERNAL_MUTEX_LOCK(db->mutex);
+    /* the database may have been closed while we were reading */
+    if (--db->ncursors == 0 && db->fd < 0) unmap_db(db);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(db->mutex);
+}
+
+ScmObj Scm__MmdbmCursorNext(ScmMmdbmCursor *c)
+{
+    ScmMmdbm *db = c->db;
+    if (c->slot == NULL) return SCM_FALSE;
+    check_open(db);
+    while (c->depth > 0) {
+        int top = c->depth - 1;
+        const char *p = snap_page(db, c->npages, c->stack[top].pgno);
+        if (p == NULL
+            || (PHDR(p)->type != P_LEAF && PHDR(p)->type != P_BRANCH)) {
+            break;
+        }
+        int idx = c->stack[top].idx;
+        if (idx >= PHDR(p)->nkeys) {
+            /* done with this page; go to the parent's next child */
+            if (--c->depth > 0) c->stack[c->depth-1].idx++;
+            continue;
+        }
+        const node_hdr *n = NODE(p, idx);
+        if (PHDR(p)->type == P_BRANCH) {
+            if (c->depth >= MAX_DEPTH) break;
+            c->stack[c->depth].pgno = n->val;
+            c->stack[c->depth].idx = 0;
+            c->depth++;
+            continue;
+        }
+        const char *v = NKEY(n) + n->ksize;
+        if (n->flags & N_BIG) {
+            uint32_t ov = node_overflow(n);
+            const char *op = snap_page(db, c->npages, ov);
+            if (op == NULL || PHDR(op)->type != P_OVERFLOW
+                || (uint64_t)ov + PHDR(op)->aux > c->npages) {
+                break;
+            }
+            v = op + HDRSIZE;
+        }
+        c->stack[top].idx++;
+        return Scm_Cons(Scm_MakeString(NKEY(n), n->ksize, -1,
+                                       SCM_STRING_COPYING),
+                        Scm_MakeString(v, n->val, -1, SCM_STRING_COPYING));
+    }
+    int bad = (c->depth > 0);
+    Scm__MmdbmCursorClose(c);
+    if (bad) Scm_Error("mmdbm: database %S is corrupted", db->name);
+    return SCM_FALSE;
+}
+
+/*=====================================================
+ * Open and close
+ */
+
+static void db_print(ScmObj obj, ScmPort *port,
+                     ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<mmdbm-file %S>", SCM_MMDBM(obj)->name);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_MmdbmClass, db_print);
+
+static void db_finalize(ScmObj obj, void *data)
+{
+    Scm__MmdbmClose(SCM_MMDBM(obj));
+}
+
+static void init_file(int fd, size_t mapsize)
+{
+    char buf[2*PAGESIZE];
+    memset(buf, 0, sizeof(buf));
+    for (int i = 0; i < 2; i++) {
+        char *p = buf + i*PAGESIZE;
+        meta_t *m = (meta_t*)(p + HDRSIZE);
+        page_init(p, P_META);
+        m->magic = MMDBM_MAGIC;
+        m->version = MMDBM_VERSION;
+        m->pagesize = PAGESIZE;
+        m->txnid = i;
+        m->mapsize = mapsize;
+        m->npages = 2;
+        m->checksum = meta_sum(m);
+    }
+    for (size_t off = 0; off < sizeof(buf); ) {
+        ssize_t r = pwrite(fd, buf + off, sizeof(buf) - off, off);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            Scm_SysError("mmdbm: couldn't initialize the database");
+        }
+        off += r;
+    }
+    if (fsync(fd) < 0) Scm_SysError("mmdbm: couldn't initialize the database");
+}
+
+static int read_meta_fd(int fd, meta_t *out)
+{
+    meta_t m[2];
+    for (int i = 0; i < 2; i++) {
+        ssize_t r;
+        SCM_SYSCALL(r, pread(fd, &m[i], sizeof(meta_t), i*PAGESIZE + HDRSIZE));
+        if (r != sizeof(meta_t)) memset(&m[i], 0, sizeof(meta_t));
+    }
+    return pick_meta(&m[0], &m[1], out);
+}
+
+ScmObj Scm__MmdbmOpen(ScmString *path, int flags, int mode, size_t mapsize)
+{
+    const char *cpath = Scm_GetStringConst(path);
+    int rdonly = (flags & SCM_MMDBM_RDONLY) != 0;
+    int fd = -1, lockfd = -1;
+    void *lock = MAP_FAILED, *map = MAP_FAILED;
+    const char *err = NULL;
+    struct stat st;
+    meta_t m;
+
+    if (mapsize == 0) mapsize = DEFAULT_MAPSIZE;
+    mapsize = (mapsize + PAGESIZE - 1) & ~(size_t)(PAGESIZE - 1);
+    if (mapsize < 16*PAGESIZE) mapsize = 16*PAGESIZE;
+
+    SCM_SYSCALL(fd, open(cpath, rdonly? O_RDONLY
+                         : (O_RDWR|((flags & SCM_MMDBM_CREATE)? O_CREAT : 0)),
+                         mode));
+    if (fd < 0) Scm_SysError("mmdbm: couldn't open database %S", path);
+
+    ScmObj lockpath = Scm_StringAppendC(path, ".lock", -1, -1);
+    SCM_SYSCALL(lockfd, open(Scm_GetStringConst(SCM_STRING(lockpath)),
+                             O_RDWR|O_CREAT, mode));
+    if (lockfd < 0) { err = "couldn't open lock file for"; goto syserr; }
+    if (fstat(lockfd, &st) < 0) { err = "couldn't stat lock file for"; goto syserr; }
+    if ((size_t)st.st_size < LOCKSIZE && ftruncate(lockfd, LOCKSIZE) < 0) {
+        err = "couldn't extend lock file for";
+        goto syserr;
+    }
+    lock = mmap(NULL, LOCKSIZE, PROT_READ|PROT_WRITE, MAP_SHARED, lockfd, 0);
+    if (lock == MAP_FAILED) { err = "couldn't map lock file for"; goto syserr; }
+    lock_area *la = (lock_area*)lock;
+    AO_compare_and_swap_full(&la->magic, 0, LOCK_MAGIC);
+    if (AO_load_full(&la->magic) != LOCK_MAGIC) {
+        err = "incompatible lock file for";
+        goto error;
+    }
+
+    if (!rdonly) {
+        if (lock_writer(lockfd, TRUE) < 0) { err = "couldn't lock"; goto syserr; }
+        if (flags & SCM_MMDBM_TRUNCATE) {
+            if (ftruncate(fd, 0) < 0) {
+                lock_writer(lockfd, FALSE);
+                err = "couldn't truncate";
+                goto syserr;
+            }
+        }
+        if (fstat(fd, &st) < 0) {
+            lock_writer(lockfd, FALSE);
+            err = "couldn't stat";
+            goto syserr;
+        }
+        if (st.st_size == 0) init_file(fd, mapsize);
+        lock_writer(lockfd, FALSE);
+    }
+    if (!read_meta_fd(fd, &m)) { err = "not an mmdbm database:"; goto error; }
+    if (m.mapsize > mapsize) mapsize = (size_t)m.mapsize;
+    if ((size_t)m.npages * PAGESIZE > mapsize) {
+        mapsize = (size_t)m.npages * PAGESIZE;
+    }
+    map = mmap(NULL, mapsize, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) { err = "couldn't map"; goto syserr; }
+
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+    (void)fcntl(lockfd, F_SETFD, FD_CLOEXEC);
+
+    ScmMmdbm *db = SCM_NEW(ScmMmdbm);
+    SCM_SET_CLASS(db, SCM_CLASS_MMDBM);
+    db->name = SCM_OBJ(path);
+    db->fd = fd;
+    db->lockfd = lockfd;
+    db->rdonly = rdonly;
+    db->nosync = (flags & SCM_MMDBM_NOSYNC) != 0;
+    db->map = (const char*)map;
+    db->mapsize = mapsize;
+    db->lock = lock;
+    db->txn = NULL;
+    db->slotHint = 0;
+    db->pid = (long)getpid();
+    db->ncursors = 0;
+    SCM_INTERNAL_MUTEX_INIT(db->mutex);
+    Scm_RegisterFinalizer(SCM_OBJ(db), db_finalize, NULL);
+    return SCM_OBJ(db);
+
+  syserr:
+    {
+        int e = errno;
+        if (lock != MAP_FAILED) munmap(lock, LOCKSIZE);
+        if (lockfd >= 0) close(lockfd);
+        close(fd);
+        errno = e;
+        Scm_SysError("mmdbm: %s %S", err, path);
+    }
+  error:
+    if (lock != MAP_FAILED) munmap(lock, LOCKSIZE);
+    if (lockfd >= 0) close(lockfd);
+    close(fd);
+    Scm_Error("mmdbm: %s %S", err, path);
+    return SCM_UNDEFINED;       /* dummy */
+}
+
+void Scm__MmdbmClose(ScmMmdbm *db)
+{
+    if (db->fd < 0) return;
+    txn_end(db);
+    (void)SCM_INTERNAL_MUTEX_LOCK(db->mutex);
+    close(db->fd);
+    close(db->lockfd);
+    db->fd = db->lockfd = -1;
+    /* open cursors still look at the mapping; the last one unmaps it */
+    if (db->ncursors == 0) unmap_db(db);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(db->mutex);
+}
+
+void Scm__InitMmdbm(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_MmdbmClass, "<mmdbm-file>", mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_MmdbmCursorClass, "<mmdbm-cursor>",
+                        mod, NULL, 0);
+}
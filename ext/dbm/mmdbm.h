@@ -0,0 +1,109 @@
+/*
+ * mmdbm.h - memory-mapped B+-tree dbm
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_DBM_MMDBM_H
+#define GAUCHE_DBM_MMDBM_H
+
+/* A database handle.  The data file is mapped read-only and shared;
+ * the writer writes pages with pwrite(2).  The lock file beside it
+ * is mapped read-write and holds the reader table; see mmdbm.c.
+ */
+typedef struct ScmMmdbmRec {
+    SCM_HEADER;
+    ScmObj name;                /* path of the data file */
+    int fd;                     /* data file, -1 if closed */
+    int lockfd;                 /* lock file */
+    int rdonly;
+    int nosync;                 /* don't fsync on commit */
+    const char *map;            /* mapping of the data file */
+    size_t mapsize;
+    void *lock;                 /* mapping of the lock file */
+    void *txn;                  /* active write transaction, or NULL */
+    long pid;                   /* our pid, for the reader table */
+    volatile size_t slotHint;   /* where to look for a free slot */
+    int ncursors;               /* # of open cursors */
+    ScmInternalMutex mutex;     /* protects ncursors and unmapping */
+} ScmMmdbm;
+
+SCM_CLASS_DECL(Scm_MmdbmClass);
+#define SCM_CLASS_MMDBM     (&Scm_MmdbmClass)
+#define SCM_MMDBM(obj)      ((ScmMmdbm*)(obj))
+#define SCM_MMDBM_P(obj)    SCM_XTYPEP(obj, SCM_CLASS_MMDBM)
+
+/* A cursor iterates over a snapshot in key order.  It occupies a
+   reader slot until it is closed or reaches the end. */
+typedef struct ScmMmdbmCursorRec ScmMmdbmCursor;
+
+SCM_CLASS_DECL(Scm_MmdbmCursorClass);
+#define SCM_CLASS_MMDBM_CURSOR     (&Scm_MmdbmCursorClass)
+#define SCM_MMDBM_CURSOR(obj)      ((ScmMmdbmCursor*)(obj))
+#define SCM_MMDBM_CURSOR_P(obj)    SCM_XTYPEP(obj, SCM_CLASS_MMDBM_CURSOR)
+
+/* Flags for Scm__MmdbmOpen */
+enum {
+    SCM_MMDBM_RDONLY = (1L<<0),
+    SCM_MMDBM_CREATE = (1L<<1),   /* create if it doesn't exist */
+    SCM_MMDBM_TRUNCATE = (1L<<2), /* discard the existing content */
+    SCM_MMDBM_NOSYNC = (1L<<3)
+};
+
+/* MAPSIZE is the maximum size of the database; 0 for the default. */
+extern ScmObj Scm__MmdbmOpen(ScmString *path, int flags, int mode,
+                             size_t mapsize);
+extern void   Scm__MmdbmClose(ScmMmdbm *db);
+
+/* Returns a string, or #f if KEY isn't in the database. */
+extern ScmObj Scm__MmdbmGet(ScmMmdbm *db, ScmString *key);
+extern int    Scm__MmdbmExistsP(ScmMmdbm *db, ScmString *key);
+extern void   Scm__MmdbmPut(ScmMmdbm *db, ScmString *key, ScmString *val);
+/* Returns TRUE if KEY was in the database. */
+extern int    Scm__MmdbmDelete(ScmMmdbm *db, ScmString *key);
+extern ScmSmallInt Scm__MmdbmCount(ScmMmdbm *db);
+
+/* Explicit write transaction.  Put and delete outside of it commit
+   by themselves.  Only one thread can own the transaction; the caller
+   is responsible to serialize threads. */
+extern void Scm__MmdbmBegin(ScmMmdbm *db);
+extern void Scm__MmdbmCommit(ScmMmdbm *db);
+extern void Scm__MmdbmAbort(ScmMmdbm *db);
+extern int  Scm__MmdbmInTransactionP(ScmMmdbm *db);
+
+extern ScmObj Scm__MmdbmCursorOpen(ScmMmdbm *db);
+/* Returns (key . value), or #f at the end. */
+extern ScmObj Scm__MmdbmCursorNext(ScmMmdbmCursor *c);
+extern void   Scm__MmdbmCursorClose(ScmMmdbmCursor *c);
+
+/* Called once at initialization. */
+extern void Scm__InitMmdbm(ScmModule *mod);
+
+#endif /* GAUCHE_DBM_MMDBM_H */
@@ -0,0 +1,285 @@
+;;;
+;;; mmdbm - memory-mapped B+-tree dbm
+;;;
+;;;   Copyright (c) 2000-2015  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; The database file is a copy-on-write B+-tree that every handle maps
+;; read-only.  Readers never take a lock; they pin a snapshot through
+;; the reader table in PATH.lock.  There's at most one writer at a time
+;; across processes.  See mmdbm.c for the file layout.
+
+(define-module dbm.mmdbm
+  (extend dbm)
+  (use gauche.threads)
+  (export <mmdbm> mmdbm-transaction
+          ;; low-level functions
+          mmdbm-open         mmdbm-close         mmdbm-closed?
+          mmdbm-get          mmdbm-exists?       mmdbm-put!
+          mmdbm-delete!      mmdbm-count
+          mmdbm-begin!       mmdbm-commit!       mmdbm-abort!
+          mmdbm-in-transaction?
+          mmdbm-cursor       mmdbm-cursor-next!  mmdbm-cursor-close!)
+  )
+(select-module dbm.mmdbm)
+
+;;;
+;;; High-level dbm interface
+;;;
+
+(define-class <mmdbm-meta> (<dbm-meta>)
+  ())
+
+(define-class <mmdbm> (<dbm>)
+  ((mmdbm-file :initform #f)
+   (map-size   :init-keyword :map-size :initform 0)
+   (sync       :init-keyword :sync     :initform #t)
+   ;; serializes writers within this process
+   (lock       :initform (make-mutex)))
+  :metaclass <mmdbm-meta>)
+
+(define-method dbm-open ((self <mmdbm>))
+  (next-method)
+  (unless (slot-bound? self 'path)
+    (error "path must be set to open mmdbm database"))
+  (when (slot-ref self 'mmdbm-file)
+    (errorf "mmdbm ~S already opened" self))
+  (slot-set! self 'mmdbm-file
+             (mmdbm-open (slot-ref self 'path)
+                         :rw-mode (slot-ref self 'rw-mode)
+                         :file-mode (slot-ref self 'file-mode)
+                         :map-size (slot-ref self 'map-size)
+                         :sync (slot-ref self 'sync)))
+  self)
+
+(define (%mmdbm-file self) (slot-ref self 'mmdbm-file))
+
+;; The writer lock is reentrant, so that dbm-put! can be called within
+;; mmdbm-transaction.
+(define (%with-writer self thunk)
+  (let1 m (slot-ref self 'lock)
+    (if (eq? (mutex-state m) (current-thread))
+      (thunk)
+      (with-locking-mutex m thunk))))
+
+;; Runs THUNK in a write transaction.  It is committed when THUNK
+;; returns normally, and aborted if THUNK raises an error or escapes.
+(define (mmdbm-transaction self thunk)
+  (%with-writer
+   self
+   (^[]
+     (let1 f (%mmdbm-file self)
+       (if (mmdbm-in-transaction? f)
+         (thunk)                        ;nested; the outer one commits
+         (dynamic-wind
+             (^[] (mmdbm-begin! f))
+             (^[] (begin0 (thunk) (mmdbm-commit! f)))
+             (^[] (when (mmdbm-in-transaction? f) (mmdbm-abort! f)))))))))
+
+;; The dbm transaction protocol.  dbm-begin! holds the writer lock
+;; until dbm-commit! or dbm-abort!.
+(define-method dbm-transaction ((self <mmdbm>) thunk)
+  (mmdbm-transaction self thunk))
+
+(define-method dbm-begin! ((self <mmdbm>))
+  (next-method)
+  (let1 m (slot-ref self 'lock)
+    (when (eq? (mutex-state m) (current-thread))
+      (errorf "mmdbm ~s is already in a transaction" self))
+    (mutex-lock! m)
+    (guard (e [else (mutex-unlock! m) (raise e)])
+      (mmdbm-begin! (%mmdbm-file self)))))
+
+(define (%end-transaction self end!)
+  (let1 m (slot-ref self 'lock)
+    (unless (eq? (mutex-state m) (current-thread))
+      (errorf "mmdbm ~s is not in a transaction" self))
+    (unwind-protect (end! (%mmdbm-file self))
+      (mutex-unlock! m))))
+
+(define-method dbm-commit! ((self <mmdbm>))
+  (%end-transaction self mmdbm-commit!))
+
+(define-method dbm-abort! ((self <mmdbm>))
+  (%end-transaction self mmdbm-abort!))
+
+;;
+;; close operation
+;;
+
+(define-method dbm-close ((self <mmdbm>))
+  (let1 f (%mmdbm-file self)
+    (and f (mmdbm-close f))))
+
+(define-method dbm-closed? ((self <mmdbm>))
+  (let1 f (%mmdbm-file self)
+    (or (not f) (mmdbm-closed? f))))
+
+;;
+;; accessors
+;;
+
+(define-method dbm-put! ((self <mmdbm>) key value)
+  (next-method)
+  (%with-writer self
+                (^[] (mmdbm-put! (%mmdbm-file self)
+                                 (%dbm-k2s self key)
+                                 (%dbm-v2s self value)))))
+
+(define-method dbm-get ((self <mmdbm>) key . args)
+  (next-method)
+  (cond [(mmdbm-get (%mmdbm-file self) (%dbm-k2s self key))
+         => (cut %dbm-s2v self <>)]
+        [(pair? args) (car args)]     ;fall-back value
+        [else  (errorf "mmdbm: no data for key ~s in database ~s"
+                       key (%mmdbm-file self))]))
+
+(define-method dbm-exists? ((self <mmdbm>) key)
+  (next-method)
+  (mmdbm-exists? (%mmdbm-file self) (%dbm-k2s self key)))
+
+(define-method dbm-delete! ((self <mmdbm>) key)
+  (next-method)
+  (%with-writer self
+                (^[] (mmdbm-delete! (%mmdbm-file self) (%dbm-k2s self key))))
+  (undefined))
+
+;;
+;; Iterations
+;;
+
+;; The cursor sees the snapshot at the time it is opened, in key order.
+(define-method dbm-fold ((self <mmdbm>) proc knil)
+  (let1 c (mmdbm-cursor (%mmdbm-file self))
+    (unwind-protect
+        (let loop ([r knil])
+          (if-let1 kv (mmdbm-cursor-next! c)
+            (loop (proc (%dbm-s2k self (car kv)) (%dbm-s2v self (cdr kv)) r))
+            r))
+      (mmdbm-cursor-close! c))))
+
+;;
+;; Metaoperations
+;;
+
+(autoload file.util copy-file move-file)
+
+(define (%lock-file-of name) (string-append name ".lock"))
+
+(define-method dbm-db-exists? ((class <mmdbm-meta>) name)
+  (file-exists? name))
+
+(define-method dbm-db-remove ((class <mmdbm-meta>) name)
+  (sys-unlink name)
+  (when (file-exists? (%lock-file-of name))
+    (sys-unlink (%lock-file-of name))))
+
+;; Holding a write transaction keeps the file from changing while
+;; it is copied or moved.
+(define (%with-mmdbm-locking name thunk)
+  (let1 f (mmdbm-open name :rw-mode :write)
+    (unwind-protect
+        (begin (mmdbm-begin! f)
+               (unwind-protect (thunk) (mmdbm-abort! f)))
+      (mmdbm-close f))))
+
+(define-method dbm-db-copy ((class <mmdbm-meta>) from to . keys)
+  (%with-mmdbm-locking from
+   (^[] (apply copy-file from to :safe #t keys))))
+
+(define-method dbm-db-move ((class <mmdbm-meta>) from to . keys)
+  (%with-mmdbm-locking from
+   (^[] (apply move-file from to :safe #t keys)))
+  (when (file-exists? (%lock-file-of from))
+    (sys-unlink (%lock-file-of from))))
+
+;;;
+;;; Low-level bindings
+;;;
+
+;; RW-MODE is the same as dbm's; :create discards the existing content.
+;; MAP-SIZE limits how large the database can grow through this handle;
+;; 0 takes the default, or the size recorded in the file if larger.
+(define (mmdbm-open path :key (rw-mode :write) (file-mode #o664)
+                              (map-size 0) (sync #t))
+  (receive (rdonly create truncate)
+      (case rw-mode
+        [(:read)   (values #t #f #f)]
+        [(:write)  (values #f #t #f)]
+        [(:create) (values #f #t #t)]
+        [else (error "rw-mode must be one of :read, :write or :create, \
+                      but got:" rw-mode)])
+    (%mmdbm-open path rdonly create truncate (and sync #t) file-mode
+                 map-size)))
+
+(inline-stub
+ (declcode "#include \"mmdbm.h\"")
+ (initcode "Scm__InitMmdbm(Scm_CurrentModule());")
+
+ (define-type <mmdbm-file> "ScmMmdbm*" "mmdbm file"
+   "SCM_MMDBM_P" "SCM_MMDBM")
+ (define-type <mmdbm-cursor> "ScmMmdbmCursor*" "mmdbm cursor"
+   "SCM_MMDBM_CURSOR_P" "SCM_MMDBM_CURSOR")
+
+ (define-cproc %mmdbm-open (path::<string> rdonly::<boolean>
+                            create::<boolean> truncate::<boolean>
+                            sync::<boolean> mode::<fixnum> mapsize::<ulong>)
+   (return (Scm__MmdbmOpen path
+                           (logior (?: rdonly SCM_MMDBM_RDONLY 0)
+                                   (?: create SCM_MMDBM_CREATE 0)
+                                   (?: truncate SCM_MMDBM_TRUNCATE 0)
+                                   (?: sync 0 SCM_MMDBM_NOSYNC))
+                           mode mapsize)))
+
+ (define-cproc mmdbm-close (db::<mmdbm-file>) ::<void> Scm__MmdbmClose)
+
+ (define-cproc mmdbm-closed? (db::<mmdbm-file>) ::<boolean>
+   (return (< (-> db fd) 0)))
+
+ (define-cproc mmdbm-get (db::<mmdbm-file> key::<string>) Scm__MmdbmGet)
+ (define-cproc mmdbm-exists? (db::<mmdbm-file> key::<string>) ::<boolean>
+   Scm__MmdbmExistsP)
+ (define-cproc mmdbm-put! (db::<mmdbm-file> key::<string> val::<string>)
+   ::<void> Scm__MmdbmPut)
+ (define-cproc mmdbm-delete! (db::<mmdbm-file> key::<string>) ::<boolean>
+   Scm__MmdbmDelete)
+ (define-cproc mmdbm-count (db::<mmdbm-file>) ::<fixnum> Scm__MmdbmCount)
+
+ (define-cproc mmdbm-begin! (db::<mmdbm-file>) ::<void> Scm__MmdbmBegin)
+ (define-cproc mmdbm-commit! (db::<mmdbm-file>) ::<void> Scm__MmdbmCommit)
+ (define-cproc mmdbm-abort! (db::<mmdbm-file>) ::<void> Scm__MmdbmAbort)
+ (define-cproc mmdbm-in-transaction? (db::<mmdbm-file>) ::<boolean>
+   Scm__MmdbmInTransactionP)
+
+ (define-cproc mmdbm-cursor (db::<mmdbm-file>) Scm__MmdbmCursorOpen)
+ (define-cproc mmdbm-cursor-next! (c::<mmdbm-cursor>) Scm__MmdbmCursorNext)
+ (define-cproc mmdbm-cursor-close! (c::<mmdbm-cursor>) ::<void>
+   Scm__MmdbmCursorClose)
+ )
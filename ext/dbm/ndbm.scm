@@ -117,6 +117,18 @@
   (when (positive? (ndbm-delete (ndbm-file-of self) (%dbm-k2s self key)))
     (errorf "dbm-delete!: deleteting key ~s from ~s failed" key self)))
 
+(define-method dbm-batch-put! ((self <ndbm>) kvs)
+  (%dbm-check-writable self "dbm-batch-put!")
+  (dbm-transaction
+   self
+   (^[]
+     (unless (zero? (%ndbm-store-pairs
+                     (ndbm-file-of self)
+                     (map (^[kv] (cons (%dbm-k2s self (car kv))
+                                       (%dbm-v2s self (cdr kv))))
+                          kvs)))
+       (error "dbm-batch-put! failed" self)))))
+
 (define-method dbm-fold ((self <ndbm>) proc knil)
   (let1 ndbm (ndbm-file-of self)
     (let loop ([key (ndbm-firstkey ndbm)] [r knil])
@@ -249,6 +261,22 @@
      (TO_DATUM dval val)
      (return (dbm_store (-> ndbm dbf) dkey dval flags))))
 
+ ;; Stores a list of (key . value) of strings.  Returns 0 on success,
+ ;; or the dbm_store result of the first failure.
+ (define-cproc %ndbm-store-pairs (ndbm::<ndbm-file> kvs) ::<int>
+   (let* ([dkey::datum] [dval::datum])
+     (CHECK_NDBM ndbm)
+     (dolist [kv kvs]
+       (unless (and (SCM_PAIRP kv)
+                    (SCM_STRINGP (SCM_CAR kv))
+                    (SCM_STRINGP (SCM_CDR kv)))
+         (Scm_Error "pair of strings required, but got: %S" kv))
+       (TO_DATUM dkey (SCM_STRING (SCM_CAR kv)))
+       (TO_DATUM dval (SCM_STRING (SCM_CDR kv)))
+       (let* ([r::int (dbm_store (-> ndbm dbf) dkey dval DBM_REPLACE)])
+         (unless (== r 0) (return r))))
+     (return 0)))
+
  (define-cproc ndbm-fetch (ndbm::<ndbm-file> key::<string>)
    (let* ([dkey::datum] [dval::datum])
      (CHECK_NDBM ndbm)
@@ -138,6 +138,20 @@
          (return #f))))
     #t))
 
+;; does batch-put! work?
+(define (test:batch-put! dataset)
+  (dbm-batch-put! *current-dbm* (hash-table->alist dataset))
+  (test:get dataset))
+
+;; does transaction commit the updates?
+(define (test:transaction)
+  (dbm-transaction *current-dbm*
+                   (^[]
+                     (dbm-transaction *current-dbm*
+                                      (^[] (dbm-put! *current-dbm* "a" "b")))
+                     (dbm-delete! *current-dbm* "a")))
+  (not (dbm-exists? *current-dbm* "a")))
+
 ;; does read-only work?
 (define (test:read-only)
   ;; if db is read-only, following procedures must throw an error.
@@ -179,7 +193,7 @@
 (define (clean-up)
   (define (remover f)
     (remove-files (list f (string-append f ".dir") (string-append f ".pag")
-                        (string-append f ".db"))))
+                        (string-append f ".db") (string-append f ".lock"))))
   (remover *test-dbm*)
   (remover *test2-dbm*))
 
@@ -216,6 +230,8 @@
      (test* (tag "get again") #t (test:get dataset))
      ;; does it work as read-only?
      (test* (tag "read-only") #t (test:read-only))
+     (test* (tag "read-only batch-put!") #t
+            (catch (dbm-batch-put! *current-dbm* '(("" . "")))))
      ;; close and open it again
      (test* (tag "close again") #t
             (begin
@@ -223,6 +239,8 @@
               (test:make class :write serializer)))
      ;; delete stuffs
      (test* (tag "delete") #t (test:delete dataset))
+     (test* (tag "batch-put!") #t (test:batch-put! dataset))
+     (test* (tag "transaction") #t (test:transaction))
      ;; close again
      (test* (tag "close again") #t (test:close))
      ;; copy
@@ -257,6 +275,45 @@
 (test-module 'dbm.fsdbm)
 (full-test <fsdbm>)
 
+(define-class <fsdbm-flat> (<fsdbm>) ((shard-levels :init-value 1)))
+(full-test <fsdbm-flat>)
+(define-class <fsdbm-log> (<fsdbm>) ((value-log :init-value #t)))
+(full-test <fsdbm-log>)
+
+(let ()
+  (define (journal) (build-path *test-dbm* "Journal"))
+  (define (contents db) (sort (dbm-map db (^[k v] #"~|k|=~|v|"))))
+  (test-section "fsdbm journal")
+  (dynamic-wind
+   clean-up
+   (^[]
+     (let ([db (dbm-open <fsdbm> :path *test-dbm* :rw-mode :create
+                         :value-log #t)]
+           [rd (dbm-open <fsdbm> :path *test-dbm* :rw-mode :read)])
+       (dotimes [i 10]
+         (dotimes [j 10] (dbm-put! db (x->string j) (x->string i))))
+       (dbm-delete! db "0")
+       (test* "other handle" '("1=9" "2=9") (take (contents rd) 2))
+       (test* "compact" #t
+              (let1 size (file-size (journal))
+                (fsdbm-compact! db)
+                (< (file-size (journal)) size)))
+       (test* "after compact" '("1=9" "2=9") (take (contents rd) 2))
+       (test* "put after compact" "x"
+              (begin (dbm-put! db "1" "x") (dbm-get rd "1")))
+       ;; a record cut by a crashed writer is ignored, then discarded
+       (with-output-to-file (journal) (cut display "+ 5 3\nab")
+         :if-exists :append)
+       (test* "incomplete record" "x" (dbm-get rd "1"))
+       (test* "discarded" '("1=y" "2=9")
+              (begin (dbm-put! db "1" "y") (take (contents rd) 2)))
+       (dbm-close rd)
+       (dbm-close db)
+       (test* "reopen" '("1=y" "2=9")
+              (let1 db (dbm-open <fsdbm> :path *test-dbm* :rw-mode :read)
+                (begin0 (take (contents db) 2) (dbm-close db))))))
+   clean-up))
+
 ;;
 ;; GDBM test
 ;;
@@ -275,4 +332,54 @@
 
 (test-if-exists "dbm--odbm" dbm.odbm <odbm>)
 
+;;
+;; MMDBM test
+;;
+
+(test-if-exists "dbm--mmdbm" dbm.mmdbm <mmdbm>)
+
+(define-macro (test-mmdbm-transaction)
+  (when (file-exists? (string-append "dbm--mmdbm." (gauche-dso-suffix)))
+    '(let ()
+       (define (count db) (dbm-fold db (^[k v n] (+ n 1)) 0))
+       (test-section "mmdbm transaction")
+       (dynamic-wind
+        clean-up
+        (^[]
+          (let ([db (dbm-open <mmdbm> :path *test-dbm* :rw-mode :create)]
+                [rd (dbm-open <mmdbm> :path *test-dbm* :rw-mode :read)])
+            (test* "commit" '(0 100 100)
+                   (let1 before #f
+                     (mmdbm-transaction
+                      db
+                      (^[]
+                        (dotimes [i 100] (dbm-put! db (x->string i) "x"))
+                        ;; other handles don't see it until commit
+                        (set! before (count rd))))
+                     (list before (count rd) (count db))))
+            (test* "abort" '(100 #f)
+                   (begin
+                     (guard (e [else #f])
+                       (mmdbm-transaction
+                        db
+                        (^[]
+                          (dbm-put! db "new" "y")
+                          (dbm-delete! db "0")
+                          (error "abort"))))
+                     (list (count rd) (dbm-get rd "new" #f))))
+            (test* "snapshot of a cursor" 100
+                   (dbm-fold rd (^[k v n]
+                                  (when (equal? k "5") (dbm-put! db "zz" "z"))
+                                  (+ n 1))
+                             0))
+            (test* "after commit" "z" (dbm-get rd "zz"))
+            (test* "large value" 100000
+                   (begin (dbm-put! db "big" (make-string 100000 #\a))
+                          (string-length (dbm-get rd "big"))))
+            (dbm-close rd)
+            (dbm-close db)))
+        clean-up))))
+
+(test-mmdbm-transaction)
+
 (test-end)
@@ -0,0 +1,213 @@
+/*
+ * crc32c.c - CRC-32C (Castagnoli)
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * CRC-32C uses the Castagnoli polynomial (0x1EDC6F41, reflected
+ * 0x82F63B78), as used in iSCSI (RFC 3720), SCTP, ext4 and others.
+ * The SSE4.2 and ARMv8 CRC32 instructions compute it directly; on
+ * other CPUs we use slicing-by-8 tables.
+ */
+
+#include "crc32c.h"
+#include <string.h>
+
+#define POLY 0x82F63B78U
+
+static uint32_t crc_table[8][256];
+
+static uint32_t crc_sw(uint32_t crc, const uint8_t *p, size_t len)
+{
+    for (; len > 0 && ((uintptr_t)p & 7) != 0; len--) {
+        crc = crc_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    for (; len >= 8; len -= 8, p += 8) {
+        uint32_t lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8)
+                             | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        uint32_t hi = (uint32_t)p[4] | ((uint32_t)p[5] << 8)
+            | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+        crc = crc_table[7][lo & 0xff] ^ crc_table[6][(lo >> 8) & 0xff]
+            ^ crc_table[5][(lo >> 16) & 0xff] ^ crc_table[4][lo >> 24]
+            ^ crc_table[3][hi & 0xff] ^ crc_table[2][(hi >> 8) & 0xff]
+            ^ crc_table[1][(hi >> 16) & 0xff] ^ crc_table[0][hi >> 24];
+    }
+    for (; len > 0; len--) {
+        crc = crc_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+static void init_table(void)
+{
+    uint32_t i, j, c;
+    for (i = 0; i < 256; i++) {
+        c = i;
+        for (j = 0; j < 8; j++) c = (c & 1) ? (c >> 1) ^ POLY : (c >> 1);
+        crc_table[0][i] = c;
+    }
+    for (i = 0; i < 256; i++) {
+        c = crc_table[0][i];
+        for (j = 1; j < 8; j++) {
+            c = crc_table[0][c & 0xff] ^ (c >> 8);
+            crc_table[j][i] = c;
+        }
+    }
+}
+
+/*===================================================================
+ * SSE4.2
+ */
+
+#if (defined(__x86_64__) || defined(__i386__))                          \
+    && ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 5)     \
+        || (defined(__clang__)                                          \
+            && (__clang_major__ > 3                                     \
+                || (__clang_major__ == 3 && __clang_minor__ >= 8))))
+#define CRC_HW_X86 1
+#include <nmmintrin.h>
+#include <cpuid.h>
+
+__attribute__((target("sse4.2")))
+static uint32_t crc_x86(uint32_t crc, const uint8_t *p, size_t len)
+{
+    for (; len > 0 && ((uintptr_t)p & 7) != 0; len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+#if defined(__x86_64__)
+    {
+        uint64_t c = crc, v;
+        for (; len >= 8; len -= 8, p += 8) {
+            memcpy(&v, p, 8);
+            c = _mm_crc32_u64(c, v);
+        }
+        crc = (uint32_t)c;
+    }
+#endif
+    for (; len >= 4; len -= 4, p += 4) {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        crc = _mm_crc32_u32(crc, v);
+    }
+    for (; len > 0; len--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+
+static int probe_x86(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return 0;
+    return (ecx & (1U<<20)) != 0;   /* SSE4.2 */
+}
+#endif /* x86 */
+
+/*===================================================================
+ * ARMv8 CRC32 extension
+ */
+
+#if defined(__aarch64__)                                                \
+    && (defined(__ARM_FEATURE_CRC32)                                    \
+        || (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 6))
+#define CRC_HW_ARM 1
+#include <arm_acle.h>
+#if defined(HAVE_SYS_AUXV_H) && defined(HAVE_GETAUXVAL)
+#include <sys/auxv.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+#define ARM_TARGET  /* empty */
+#else
+#define ARM_TARGET __attribute__((target("+crc")))
+#endif
+
+ARM_TARGET
+static uint32_t crc_arm(uint32_t crc, const uint8_t *p, size_t len)
+{
+    for (; len > 0 && ((uintptr_t)p & 7) != 0; len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    for (; len >= 8; len -= 8, p += 8) {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        crc = __crc32cd(crc, v);
+    }
+    for (; len > 0; len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+static int probe_arm(void)
+{
+#if defined(__APPLE__)
+    return 1;
+#elif defined(HAVE_SYS_AUXV_H) && defined(HAVE_GETAUXVAL) && defined(AT_HWCAP)
+    return (getauxval(AT_HWCAP) & (1UL<<7)) != 0;   /* HWCAP_CRC32 */
+#elif defined(__ARM_FEATURE_CRC32)
+    return 1;
+#else
+    return 0;
+#endif
+}
+#endif /* ARM */
+
+/*===================================================================
+ * Entry points
+ */
+
+static uint32_t (*crc_impl)(uint32_t, const uint8_t*, size_t) = crc_sw;
+
+const char *Scm__CRC32CInit(int enable)
+{
+    init_table();
+    crc_impl = crc_sw;
+    if (!enable) return NULL;
+#if CRC_HW_X86
+    if (probe_x86()) {
+        crc_impl = crc_x86;
+        return "sse4.2";
+    }
+#endif
+#if CRC_HW_ARM
+    if (probe_arm()) {
+        crc_impl = crc_arm;
+        return "armv8-crc";
+    }
+#endif
+    return NULL;
+}
+
+uint32_t Scm_CRC32C(uint32_t crc, const void *data, size_t len)
+{
+    return ~crc_impl(~crc, (const uint8_t*)data, len);
+}
@@ -0,0 +1,123 @@
+;;;
+;;; crc32c - CRC-32C (Castagnoli) checksum
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;;; Cf. RFC 3720 Internet Small Computer Systems Interface (iSCSI),
+;;;     Appendix B.4.  This is a checksum, not a cryptographic hash.
+
+(define-module rfc.crc32c
+  (use gauche.uvector)
+  (extend util.digest)
+  (export <crc32c> crc32c crc32c-digest crc32c-digest-string
+          crc32c-hardware-acceleration))
+(select-module rfc.crc32c)
+
+;;;
+;;;  High-level API
+;;;
+
+(define-constant *crc32c-unit-len* 65536)
+
+(define (%crc32c-port)
+  (let1 buf (make-u8vector *crc32c-unit-len*)
+    (let loop ([crc 0])
+      (let1 count (read-block! buf)
+        (cond [(eof-object? count) crc]
+              [(< count *crc32c-unit-len*)
+               (loop (crc32c (uvector-alias <u8vector> buf 0 count) crc))]
+              [else (loop (crc32c buf crc))])))))
+
+(define (crc32c-digest) (%crc->digest (%crc32c-port)))
+
+(define (crc32c-digest-string s) (with-input-from-string s crc32c-digest))
+
+;;;
+;;; Digest framework
+;;;
+
+(define-class <crc32c-meta> (<message-digest-algorithm-meta>) ())
+(define-class <crc32c> (<message-digest-algorithm>)
+  ((crc :init-value 0))
+  :metaclass <crc32c-meta>)
+
+(define-method digest-update! ((self <crc32c>) data)
+  (slot-set! self 'crc (crc32c data (slot-ref self 'crc))))
+(define-method digest-final! ((self <crc32c>))
+  (%crc->digest (slot-ref self 'crc)))
+(define-method digest ((class <crc32c-meta>))
+  (crc32c-digest))
+
+;;;
+;;; Low-level bindings
+;;;
+
+(inline-stub
+ "#include \"crc32c.h\""
+
+ "static const char *crc32c_hw_name = NULL;"
+
+ (initcode (set! crc32c_hw_name (Scm__CRC32CInit TRUE)))
+
+ ;; Updates CRC with DATA and returns the new value.  Any uvector is
+ ;; processed as its raw bytes, in the native byte order.
+ (define-cproc crc32c (data :optional (crc::<uint32> 0)) ::<uint32>
+   (cond
+    [(SCM_UVECTORP data)
+     (return (Scm_CRC32C crc (SCM_UVECTOR_ELEMENTS (SCM_UVECTOR data))
+                         (Scm_UVectorSizeInBytes (SCM_UVECTOR data))))]
+    [(SCM_STRINGP data)
+     (let* ([b::(const ScmStringBody*) (SCM_STRING_BODY data)])
+       (return (Scm_CRC32C crc (SCM_STRING_BODY_START b)
+                           (SCM_STRING_BODY_SIZE b))))]
+    [else (SCM_TYPE_ERROR data "uvector or string")
+          (return 0)]))
+
+ ;; The digest is the 4-octet big-endian representation of the CRC.
+ (define-cproc %crc->digest (crc::<uint32>)
+   (let* ([digest::(.array (unsigned char) [4])])
+     (set! (aref digest 0) (cast (unsigned char) (>> crc 24))
+           (aref digest 1) (cast (unsigned char) (>> crc 16))
+           (aref digest 2) (cast (unsigned char) (>> crc 8))
+           (aref digest 3) (cast (unsigned char) crc))
+     (return (Scm_MakeString (cast (const char*) digest) 4 4
+                             (logior SCM_STRING_INCOMPLETE
+                                     SCM_STRING_COPYING)))))
+
+ ;; Returns the name of the CPU extension in use, or #f.
+ (define-cproc crc32c-hardware-acceleration ()
+   (return (?: crc32c_hw_name (SCM_INTERN crc32c_hw_name) SCM_FALSE)))
+
+ ;; For testing; turns off the CPU extension if flag is #f.
+ (define-cproc %crc32c-hardware-acceleration-set! (flag::<boolean>)
+   (set! crc32c_hw_name (Scm__CRC32CInit flag))
+   (return (?: crc32c_hw_name (SCM_INTERN crc32c_hw_name) SCM_FALSE)))
+ )
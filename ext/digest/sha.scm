@@ -42,7 +42,10 @@
           <sha224> sha224-digest sha224-digest-string
           <sha256> sha256-digest sha256-digest-string
           <sha384> sha384-digest sha384-digest-string
-          <sha512> sha512-digest sha512-digest-string))
+          <sha512> sha512-digest sha512-digest-string
+          sha1-digest-multi sha224-digest-multi sha256-digest-multi
+          sha384-digest-multi sha512-digest-multi
+          sha-hardware-acceleration))
 (select-module rfc.sha)
 
 ;;;
@@ -121,6 +124,8 @@
  "#define SHA2_USE_INTTYPES_H" ; use uintXX_t
  "#include \"sha2.h\""
 
+ "#include \"sha_hw.h\""
+
  "#define LIBGAUCHE_EXT_BODY"
  "#include <gauche/extern.h>  /* fix SCM_EXTERN in SCM_CLASS_DECL */"
 
@@ -129,6 +134,10 @@
  " SHA_CTX ctx;"
  "} ScmShaContext;"
 
+ "static const char *sha_hw_name = NULL;"
+
+ (initcode (set! sha_hw_name (Scm__ShaHWInit TRUE)))
+
  (define-cclass <sha-context> :private
    ScmShaContext* "Scm_ShaContextClass" ()
    ()
@@ -192,6 +201,62 @@
    (common-final SHA384_Final ctx SHA384_DIGEST_LENGTH))
  (define-cproc %sha512-final (ctx::<sha-context>)
    (common-final SHA512_Final ctx SHA512_DIGEST_LENGTH))
+
+ ;; Returns the name of the CPU extension in use, or #f.
+ (define-cproc sha-hardware-acceleration ()
+   (return (?: sha_hw_name (SCM_INTERN sha_hw_name) SCM_FALSE)))
+
+ ;; For testing; turns off the CPU extension if flag is #f.
+ (define-cproc %sha-hardware-acceleration-set! (flag::<boolean>)
+   (set! sha_hw_name (Scm__ShaHWInit flag))
+   (return (?: sha_hw_name (SCM_INTERN sha_hw_name) SCM_FALSE)))
+
+ (define-cise-stmt common-multi
+   [(_ multi msgs size)
+    `(let* ([n::int (Scm_Length ,msgs)])
+       (when (< n 0) (SCM_TYPE_ERROR ,msgs "proper list"))
+       (let* ([data::(const unsigned char**)
+                     (SCM_NEW_ATOMIC_ARRAY (.type const unsigned char*) n)]
+              [lens::size_t* (SCM_NEW_ATOMIC_ARRAY (.type size_t) n)]
+              [digests::unsigned char*
+                        (SCM_NEW_ATOMIC2 (.type unsigned char*) (* n ,size))]
+              [i::int 0]
+              [h SCM_NIL] [t SCM_NIL])
+         (dolist [m ,msgs]
+           (cond
+            [(SCM_U8VECTORP m)
+             (set! (aref data i)
+                   (cast (const unsigned char*)
+                         (SCM_UVECTOR_ELEMENTS (SCM_U8VECTOR m)))
+                   (aref lens i) (SCM_U8VECTOR_SIZE (SCM_U8VECTOR m)))]
+            [(SCM_STRINGP m)
+             (let* ([b::(const ScmStringBody*) (SCM_STRING_BODY m)])
+               (set! (aref data i)
+                     (cast (const unsigned char*) (SCM_STRING_BODY_START b))
+                     (aref lens i) (SCM_STRING_BODY_SIZE b)))]
+            [else (SCM_TYPE_ERROR m "u8vector or string")])
+           (post++ i))
+         (,multi n data lens digests)
+         (dotimes [k n]
+           (SCM_APPEND1 h t (Scm_MakeString (cast (const char*)
+                                                  (+ digests (* k ,size)))
+                                            ,size ,size
+                                            (logior SCM_STRING_INCOMPLETE
+                                                    SCM_STRING_COPYING))))
+         (return h)))])
+
+ ;; Hash many independent messages at once.  With the CPU's SHA extension,
+ ;; SHA-1 and SHA-224/256 interleave two messages to keep the unit busy.
+ (define-cproc sha1-digest-multi (msgs::<list>)
+   (common-multi SHA1_Multi msgs SHA1_DIGEST_LENGTH))
+ (define-cproc sha224-digest-multi (msgs::<list>)
+   (common-multi SHA224_Multi msgs SHA224_DIGEST_LENGTH))
+ (define-cproc sha256-digest-multi (msgs::<list>)
+   (common-multi SHA256_Multi msgs SHA256_DIGEST_LENGTH))
+ (define-cproc sha384-digest-multi (msgs::<list>)
+   (common-multi SHA384_Multi msgs SHA384_DIGEST_LENGTH))
+ (define-cproc sha512-digest-multi (msgs::<list>)
+   (common-multi SHA512_Multi msgs SHA512_DIGEST_LENGTH))
  )
 
 
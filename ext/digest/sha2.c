@@ -237,6 +237,13 @@ void SHA512_Internal_Init(SHA_CTX*, const sha_word64*);
 void SHA512_Internal_Last(SHA_CTX*);
 void SHA512_Internal_Transform(SHA_CTX*, const sha_word64*);
 
+/*[SK] Block processing, dispatched to the CPU extension if available. */
+#include "sha_hw.h"
+
+static void SHA1_Internal_Blocks(SHA_CTX*, const sha_byte*, size_t);
+static void SHA256_Internal_Blocks(SHA_CTX*, const sha_byte*, size_t);
+/*[/SK]*/
+
 
 /*** SHA2 INITIAL HASH VALUES AND CONSTANTS ***************************/
 
@@ -639,6 +646,16 @@ void SHA1_Internal_Transform(SHA_CTX* context, const sha_word32* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+static void SHA1_Internal_Blocks(SHA_CTX* context, const sha_byte *data, size_t nblocks) {
+	if (Scm__SHA1HWBlocks) {
+		Scm__SHA1HWBlocks((uint32_t*)context->s1.state, data, nblocks);
+		return;
+	}
+	for (; nblocks > 0; nblocks--, data += 64) {
+		SHA1_Internal_Transform(context, (const sha_word32*)data);
+	}
+}
+
 void SHA1_Update(SHA_CTX* context, const sha_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 	if (len == 0) {
@@ -660,7 +677,7 @@ void SHA1_Update(SHA_CTX* context, const sha_byte *data, size_t len) {
 			context->s1.bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA1_Internal_Transform(context, (sha_word32*)context->s1.buffer);
+			SHA1_Internal_Blocks(context, context->s1.buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->s1.buffer[usedspace], data, len);
@@ -670,12 +687,13 @@ void SHA1_Update(SHA_CTX* context, const sha_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= 64) {
+	if (len >= 64) {
 		/* Process as many complete blocks as we can */
-		SHA1_Internal_Transform(context, (sha_word32*)data);
-		context->s1.bitcount += 512;
-		len -= 64;
-		data += 64;
+		size_t nblocks = len / 64;
+		SHA1_Internal_Blocks(context, data, nblocks);
+		context->s1.bitcount += (sha_word64)nblocks << 9;
+		len -= nblocks * 64;
+		data += nblocks * 64;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -721,7 +739,7 @@ void SHA1_Final(sha_byte digest[], SHA_CTX* context) {
 				MEMSET_BZERO(&context->s1.buffer[usedspace], 64 - usedspace);
 			}
 			/* Do second-to-last transform: */
-			SHA1_Internal_Transform(context, (sha_word32*)context->s1.buffer);
+			SHA1_Internal_Blocks(context, context->s1.buffer, 1);
 
 			/* And set-up for the last transform: */
 			MEMSET_BZERO(context->s1.buffer, 56);
@@ -737,7 +755,7 @@ void SHA1_Final(sha_byte digest[], SHA_CTX* context) {
 	*(sha_word64*)&context->s1.buffer[56] = context->s1.bitcount;
 
 	/* Final transform: */
-	SHA1_Internal_Transform(context, (sha_word32*)context->s1.buffer);
+	SHA1_Internal_Blocks(context, context->s1.buffer, 1);
 
 	/* Save the hash data for output: */
 #if BYTE_ORDER == LITTLE_ENDIAN
@@ -978,6 +996,16 @@ void SHA256_Internal_Transform(SHA_CTX* context, const sha_word32* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+static void SHA256_Internal_Blocks(SHA_CTX* context, const sha_byte *data, size_t nblocks) {
+	if (Scm__SHA256HWBlocks) {
+		Scm__SHA256HWBlocks((uint32_t*)context->s256.state, data, nblocks);
+		return;
+	}
+	for (; nblocks > 0; nblocks--, data += 64) {
+		SHA256_Internal_Transform(context, (const sha_word32*)data);
+	}
+}
+
 void SHA256_Update(SHA_CTX* context, const sha_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -1000,7 +1028,7 @@ void SHA256_Update(SHA_CTX* context, const sha_byte *data, size_t len) {
 			context->s256.bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA256_Internal_Transform(context, (sha_word32*)context->s256.buffer);
+			SHA256_Internal_Blocks(context, context->s256.buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->s256.buffer[usedspace], data, len);
@@ -1010,12 +1038,13 @@ void SHA256_Update(SHA_CTX* context, const sha_byte *data, size_t len) {
 			return;
 		}
 	}
-	while (len >= 64) {
+	if (len >= 64) {
 		/* Process as many complete blocks as we can */
-		SHA256_Internal_Transform(context, (sha_word32*)data);
-		context->s256.bitcount += 512;
-		len -= 64;
-		data += 64;
+		size_t nblocks = len / 64;
+		SHA256_Internal_Blocks(context, data, nblocks);
+		context->s256.bitcount += (sha_word64)nblocks << 9;
+		len -= nblocks * 64;
+		data += nblocks * 64;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -1046,7 +1075,7 @@ void SHA256_Internal_Last(SHA_CTX* context) {
 				MEMSET_BZERO(&context->s256.buffer[usedspace], 64 - usedspace);
 			}
 			/* Do second-to-last transform: */
-			SHA256_Internal_Transform(context, (sha_word32*)context->s256.buffer);
+			SHA256_Internal_Blocks(context, context->s256.buffer, 1);
 
 			/* And set-up for the last transform: */
 			MEMSET_BZERO(context->s256.buffer, 56);
@@ -1064,7 +1093,7 @@ void SHA256_Internal_Last(SHA_CTX* context) {
 	*(sha_word64*)&context->s256.buffer[56] = context->s256.bitcount;
 
 	/* Final transform: */
-	SHA256_Internal_Transform(context, (sha_word32*)context->s256.buffer);
+	SHA256_Internal_Blocks(context, context->s256.buffer, 1);
 }
 
 void SHA256_Final(sha_byte digest[], SHA_CTX* context) {
@@ -1606,3 +1635,85 @@ char* SHA384_Data(const sha_byte* data, size_t len, char digest[SHA384_DIGEST_ST
 	return SHA384_End(&context, digest);
 }
 
+
+/*** Multi-buffer interface: ******************************************/
+/*[SK]
+ * Hashes N independent messages DATA[i] of LEN[i] octets, and stores
+ * the digests consecutively in DIGESTS.  If the CPU extension is
+ * available, SHA-1 and SHA-224/256 process two messages in lockstep
+ * as long as both have complete blocks left, and finish each one
+ * separately.  SHA-384/512 simply hash the messages one by one.
+ */
+typedef void (*sha_init_fn)(SHA_CTX*);
+typedef void (*sha_update_fn)(SHA_CTX*, const sha_byte*, size_t);
+typedef void (*sha_final_fn)(sha_byte[], SHA_CTX*);
+
+static void sha_multi(size_t n, const sha_byte* data[], const size_t len[],
+		      sha_byte digests[], size_t dlen,
+		      ScmShaHWBlocks2 hw2, int sha1p,
+		      sha_init_fn init, sha_update_fn update,
+		      sha_final_fn final) {
+	SHA_CTX		c0, c1;
+	size_t		i = 0;
+
+	if (hw2) {
+		for (; i + 1 < n; i += 2) {
+			size_t	nblocks = (len[i] < len[i+1]? len[i] : len[i+1]) / 64;
+			size_t	done = nblocks * 64;
+
+			init(&c0);
+			init(&c1);
+			if (nblocks > 0) {
+				if (sha1p) {
+					hw2((uint32_t*)c0.s1.state, (uint32_t*)c1.s1.state,
+					    data[i], data[i+1], nblocks);
+					c0.s1.bitcount = c1.s1.bitcount = (sha_word64)done << 3;
+				} else {
+					hw2((uint32_t*)c0.s256.state, (uint32_t*)c1.s256.state,
+					    data[i], data[i+1], nblocks);
+					c0.s256.bitcount = c1.s256.bitcount = (sha_word64)done << 3;
+				}
+			}
+			update(&c0, data[i] + done, len[i] - done);
+			final(digests + i * dlen, &c0);
+			update(&c1, data[i+1] + done, len[i+1] - done);
+			final(digests + (i+1) * dlen, &c1);
+		}
+	}
+	for (; i < n; i++) {
+		init(&c0);
+		update(&c0, data[i], len[i]);
+		final(digests + i * dlen, &c0);
+	}
+}
+
+void SHA1_Multi(size_t n, const sha_byte* data[], const size_t len[], sha_byte digests[]) {
+	sha_multi(n, data, len, digests, SHA1_DIGEST_LENGTH,
+		  Scm__SHA1HWBlocks2, 1,
+		  SHA1_Init, SHA1_Update, SHA1_Final);
+}
+
+void SHA224_Multi(size_t n, const sha_byte* data[], const size_t len[], sha_byte digests[]) {
+	sha_multi(n, data, len, digests, SHA224_DIGEST_LENGTH,
+		  Scm__SHA256HWBlocks2, 0,
+		  SHA224_Init, SHA224_Update, SHA224_Final);
+}
+
+void SHA256_Multi(size_t n, const sha_byte* data[], const size_t len[], sha_byte digests[]) {
+	sha_multi(n, data, len, digests, SHA256_DIGEST_LENGTH,
+		  Scm__SHA256HWBlocks2, 0,
+		  SHA256_Init, SHA256_Update, SHA256_Final);
+}
+
+void SHA384_Multi(size_t n, const sha_byte* data[], const size_t len[], sha_byte digests[]) {
+	sha_multi(n, data, len, digests, SHA384_DIGEST_LENGTH,
+		  NULL, 0,
+		  SHA384_Init, SHA384_Update, SHA384_Final);
+}
+
+void SHA512_Multi(size_t n, const sha_byte* data[], const size_t len[], sha_byte digests[]) {
+	sha_multi(n, data, len, digests, SHA512_DIGEST_LENGTH,
+		  NULL, 0,
+		  SHA512_Init, SHA512_Update, SHA512_Final);
+}
+/*[/SK]*/
@@ -187,30 +187,35 @@ void SHA1_Update(SHA_CTX*, const uint8_t*, size_t);
 void SHA1_Final(uint8_t[SHA1_DIGEST_LENGTH], SHA_CTX*);
 char* SHA1_End(SHA_CTX*, char[SHA1_DIGEST_STRING_LENGTH]);
 char* SHA1_Data(const uint8_t*, size_t, char[SHA1_DIGEST_STRING_LENGTH]);
+void SHA1_Multi(size_t, const uint8_t*[], const size_t[], uint8_t[]);
 
 void SHA224_Init(SHA_CTX*);
 void SHA224_Update(SHA_CTX*, const uint8_t*, size_t);
 void SHA224_Final(uint8_t[SHA224_DIGEST_LENGTH], SHA_CTX*);
 char* SHA224_End(SHA_CTX*, char[SHA224_DIGEST_STRING_LENGTH]);
 char* SHA224_Data(const uint8_t*, size_t, char[SHA224_DIGEST_STRING_LENGTH]);
+void SHA224_Multi(size_t, const uint8_t*[], const size_t[], uint8_t[]);
 
 void SHA256_Init(SHA_CTX*);
 void SHA256_Update(SHA_CTX*, const uint8_t*, size_t);
 void SHA256_Final(uint8_t[SHA256_DIGEST_LENGTH], SHA_CTX*);
 char* SHA256_End(SHA_CTX*, char[SHA256_DIGEST_STRING_LENGTH]);
 char* SHA256_Data(const uint8_t*, size_t, char[SHA256_DIGEST_STRING_LENGTH]);
+void SHA256_Multi(size_t, const uint8_t*[], const size_t[], uint8_t[]);
 
 void SHA384_Init(SHA_CTX*);
 void SHA384_Update(SHA_CTX*, const uint8_t*, size_t);
 void SHA384_Final(uint8_t[SHA384_DIGEST_LENGTH], SHA_CTX*);
 char* SHA384_End(SHA_CTX*, char[SHA384_DIGEST_STRING_LENGTH]);
 char* SHA384_Data(const uint8_t*, size_t, char[SHA384_DIGEST_STRING_LENGTH]);
+void SHA384_Multi(size_t, const uint8_t*[], const size_t[], uint8_t[]);
 
 void SHA512_Init(SHA_CTX*);
 void SHA512_Update(SHA_CTX*, const uint8_t*, size_t);
 void SHA512_Final(uint8_t[SHA512_DIGEST_LENGTH], SHA_CTX*);
 char* SHA512_End(SHA_CTX*, char[SHA512_DIGEST_STRING_LENGTH]);
 char* SHA512_Data(const uint8_t*, size_t, char[SHA512_DIGEST_STRING_LENGTH]);
+void SHA512_Multi(size_t, const uint8_t*[], const size_t[], uint8_t[]);
 
 #else /* SHA2_USE_INTTYPES_H */
 
@@ -219,30 +224,35 @@ void SHA1_Update(SHA_CTX*, const u_int8_t*, size_t);
 void SHA1_Final(u_int8_t[SHA1_DIGEST_LENGTH], SHA_CTX*);
 char* SHA1_End(SHA_CTX*, char[SHA1_DIGEST_STRING_LENGTH]);
 char* SHA1_Data(const u_int8_t*, size_t, char[SHA1_DIGEST_STRING_LENGTH]);
+void SHA1_Multi(size_t, const u_int8_t*[], const size_t[], u_int8_t[]);
 
 void SHA224_Init(SHA_CTX*);
 void SHA224_Update(SHA_CTX*, const u_int8_t*, size_t);
 void SHA224_Final(u_int8_t[SHA224_DIGEST_LENGTH], SHA_CTX*);
 char* SHA224_End(SHA_CTX*, char[SHA224_DIGEST_STRING_LENGTH]);
 char* SHA224_Data(const u_int8_t*, size_t, char[SHA224_DIGEST_STRING_LENGTH]);
+void SHA224_Multi(size_t, const u_int8_t*[], const size_t[], u_int8_t[]);
 
 void SHA256_Init(SHA_CTX*);
 void SHA256_Update(SHA_CTX*, const u_int8_t*, size_t);
 void SHA256_Final(u_int8_t[SHA256_DIGEST_LENGTH], SHA_CTX*);
 char* SHA256_End(SHA_CTX*, char[SHA256_DIGEST_STRING_LENGTH]);
 char* SHA256_Data(const u_int8_t*, size_t, char[SHA256_DIGEST_STRING_LENGTH]);
+void SHA256_Multi(size_t, const u_int8_t*[], const size_t[], u_int8_t[]);
 
 void SHA384_Init(SHA_CTX*);
 void SHA384_Update(SHA_CTX*, const u_int8_t*, size_t);
 void SHA384_Final(u_int8_t[SHA384_DIGEST_LENGTH], SHA_CTX*);
 char* SHA384_End(SHA_CTX*, char[SHA384_DIGEST_STRING_LENGTH]);
 char* SHA384_Data(const u_int8_t*, size_t, char[SHA384_DIGEST_STRING_LENGTH]);
+void SHA384_Multi(size_t, const u_int8_t*[], const size_t[], u_int8_t[]);
 
 void SHA512_Init(SHA_CTX*);
 void SHA512_Update(SHA_CTX*, const u_int8_t*, size_t);
 void SHA512_Final(u_int8_t[SHA512_DIGEST_LENGTH], SHA_CTX*);
 char* SHA512_End(SHA_CTX*, char[SHA512_DIGEST_STRING_LENGTH]);
 char* SHA512_Data(const u_int8_t*, size_t, char[SHA512_DIGEST_STRING_LENGTH]);
+void SHA512_Multi(size_t, const u_int8_t*[], const size_t[], u_int8_t[]);
 
 #endif /* SHA2_USE_INTTYPES_H */
 
@@ -253,30 +263,35 @@ void SHA1_Update();
 void SHA1_Final();
 char* SHA1_End();
 char* SHA1_Data();
+void SHA1_Multi();
 
 void SHA224_Init();
 void SHA224_Update();
 void SHA224_Final();
 char* SHA224_End();
 char* SHA224_Data();
+void SHA224_Multi();
 
 void SHA256_Init();
 void SHA256_Update();
 void SHA256_Final();
 char* SHA256_End();
 char* SHA256_Data();
+void SHA256_Multi();
 
 void SHA384_Init();
 void SHA384_Update();
 void SHA384_Final();
 char* SHA384_End();
 char* SHA384_Data();
+void SHA384_Multi();
 
 void SHA512_Init();
 void SHA512_Update();
 void SHA512_Final();
 char* SHA512_End();
 char* SHA512_Data();
+void SHA512_Multi();
 
 #endif /* NOPROTO */
 
@@ -0,0 +1,518 @@
+/*
+ * sha_hw.c - SHA-1/SHA-256 using CPU extensions
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * We support the x86 SHA extensions (a.k.a. SHA-NI) and the ARMv8
+ * cryptography extensions.  The code is compiled with per-function
+ * target attributes, so the rest of the module doesn't need special
+ * compiler flags, and the instructions are only executed after we
+ * confirm the CPU has them.
+ */
+
+#include "sha_hw.h"
+
+ScmShaHWBlocks  Scm__SHA1HWBlocks = NULL;
+ScmShaHWBlocks2 Scm__SHA1HWBlocks2 = NULL;
+ScmShaHWBlocks  Scm__SHA256HWBlocks = NULL;
+ScmShaHWBlocks2 Scm__SHA256HWBlocks2 = NULL;
+
+#if (defined(__x86_64__) || defined(__i386__))                          \
+    && ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 5)     \
+        || (defined(__clang__)                                          \
+            && (__clang_major__ > 3                                     \
+                || (__clang_major__ == 3 && __clang_minor__ >= 8))))
+#define SHA_HW_X86 1
+#endif
+
+#if defined(__aarch64__)                                                \
+    && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)    \
+        || (defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 6))
+#define SHA_HW_ARM 1
+#endif
+
+#if SHA_HW_X86 || SHA_HW_ARM
+static const uint32_t K256[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+    0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+    0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+    0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+    0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+    0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+    0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+    0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+    0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+#endif
+
+/*===================================================================
+ * x86 SHA extensions
+ */
+
+#if SHA_HW_X86
+#include <immintrin.h>
+#include <cpuid.h>
+
+#define X86_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+
+/*
+ * SHA-1.  ABCD is kept in a register in reversed word order, and E
+ * is in the top word of E0/E1, which are swapped every four rounds.
+ * G is the group of four rounds (0..19); M[] is the circular buffer
+ * of the message schedule.
+ */
+#define SHA1_X86_LOAD(M, data, g)                                       \
+    do {                                                                \
+        if ((g) < 4) {                                                  \
+            M[g] = _mm_shuffle_epi8(                                    \
+                _mm_loadu_si128((const __m128i*)((data) + 16*(g))),     \
+                mask);                                                  \
+        }                                                               \
+    } while (0)
+
+#define SHA1_X86_GROUP(g, ABCD, Ecur, Enext, M, data)                   \
+    do {                                                                \
+        SHA1_X86_LOAD(M, data, g);                                      \
+        if ((g) == 0) Ecur = _mm_add_epi32(Ecur, M[0]);                 \
+        else Ecur = _mm_sha1nexte_epu32(Ecur, M[(g)&3]);                \
+        Enext = ABCD;                                                   \
+        if ((g) >= 3 && (g) <= 18)                                      \
+            M[((g)+1)&3] = _mm_sha1msg2_epu32(M[((g)+1)&3], M[(g)&3]);  \
+        ABCD = _mm_sha1rnds4_epu32(ABCD, Ecur, (g)/5);                  \
+        if ((g) >= 1 && (g) <= 16)                                      \
+            M[((g)-1)&3] = _mm_sha1msg1_epu32(M[((g)-1)&3], M[(g)&3]);  \
+        if ((g) >= 2 && (g) <= 17)                                      \
+            M[((g)-2)&3] = _mm_xor_si128(M[((g)-2)&3], M[(g)&3]);       \
+    } while (0)
+
+/* Apply OP to (g, ABCD, E-current, E-next) for all twenty groups. */
+#define SHA1_X86_ALL(OP)                                                \
+    OP(0, E0, E1);  OP(1, E1, E0);  OP(2, E0, E1);  OP(3, E1, E0);      \
+    OP(4, E0, E1);  OP(5, E1, E0);  OP(6, E0, E1);  OP(7, E1, E0);      \
+    OP(8, E0, E1);  OP(9, E1, E0);  OP(10, E0, E1); OP(11, E1, E0);     \
+    OP(12, E0, E1); OP(13, E1, E0); OP(14, E0, E1); OP(15, E1, E0);     \
+    OP(16, E0, E1); OP(17, E1, E0); OP(18, E0, E1); OP(19, E1, E0)
+
+#define SHA1_X86_MASK \
+    _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL)
+
+X86_TARGET
+static void sha1_x86(uint32_t *state, const uint8_t *data, size_t nblocks)
+{
+    const __m128i mask = SHA1_X86_MASK;
+    __m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1, M[4];
+
+    ABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0x1b);
+    E0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+    for (; nblocks > 0; nblocks--, data += 64) {
+        ABCD_SAVE = ABCD;
+        E0_SAVE = E0;
+#define OP(g, Ec, En)  SHA1_X86_GROUP(g, ABCD, Ec, En, M, data)
+        SHA1_X86_ALL(OP);
+#undef OP
+        E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+        ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
+    }
+
+    _mm_storeu_si128((__m128i*)state, _mm_shuffle_epi32(ABCD, 0x1b));
+    state[4] = (uint32_t)_mm_extract_epi32(E0, 3);
+}
+
+X86_TARGET
+static void sha1_x86_2(uint32_t *s0, uint32_t *s1,
+                       const uint8_t *d0, const uint8_t *d1, size_t nblocks)
+{
+    const __m128i mask = SHA1_X86_MASK;
+    __m128i aABCD, aABCD_SAVE, aE0, aE0_SAVE, aE1, aM[4];
+    __m128i bABCD, bABCD_SAVE, bE0, bE0_SAVE, bE1, bM[4];
+
+    aABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s0), 0x1b);
+    aE0 = _mm_set_epi32((int)s0[4], 0, 0, 0);
+    bABCD = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)s1), 0x1b);
+    bE0 = _mm_set_epi32((int)s1[4], 0, 0, 0);
+
+    for (; nblocks > 0; nblocks--, d0 += 64, d1 += 64) {
+        aABCD_SAVE = aABCD; aE0_SAVE = aE0;
+        bABCD_SAVE = bABCD; bE0_SAVE = bE0;
+#define OP(g, Ec, En)                                           \
+        SHA1_X86_GROUP(g, aABCD, a##Ec, a##En, aM, d0);         \
+        SHA1_X86_GROUP(g, bABCD, b##Ec, b##En, bM, d1)
+        SHA1_X86_ALL(OP);
+#undef OP
+        aE0 = _mm_sha1nexte_epu32(aE0, aE0_SAVE);
+        aABCD = _mm_add_epi32(aABCD, aABCD_SAVE);
+        bE0 = _mm_sha1nexte_epu32(bE0, bE0_SAVE);
+        bABCD = _mm_add_epi32(bABCD, bABCD_SAVE);
+    }
+
+    _mm_storeu_si128((__m128i*)s0, _mm_shuffle_epi32(aABCD, 0x1b));
+    s0[4] = (uint32_t)_mm_extract_epi32(aE0, 3);
+    _mm_storeu_si128((__m128i*)s1, _mm_shuffle_epi32(bABCD, 0x1b));
+    s1[4] = (uint32_t)_mm_extract_epi32(bE0, 3);
+}
+
+/*
+ * SHA-256.  The state is kept as ABEF and CDGH, as required by
+ * sha256rnds2.  G is the group of four rounds (0..15).
+ */
+#define SHA256_X86_GROUP(g, S0, S1, M, data)                            \
+    do {                                                                \
+        __m128i msg_, tmp_;                                             \
+        if ((g) < 4) {                                                  \
+            M[g] = _mm_shuffle_epi8(                                    \
+                _mm_loadu_si128((const __m128i*)((data) + 16*(g))),     \
+                mask);                                                  \
+        }                                                               \
+        msg_ = _mm_add_epi32(M[(g)&3],                                  \
+                        _mm_loadu_si128((const __m128i*)&K256[4*(g)])); \
+        S1 = _mm_sha256rnds2_epu32(S1, S0, msg_);                       \
+        if ((g) >= 3 && (g) <= 14) {                                    \
+            tmp_ = _mm_alignr_epi8(M[(g)&3], M[((g)-1)&3], 4);          \
+            M[((g)+1)&3] = _mm_add_epi32(M[((g)+1)&3], tmp_);           \
+            M[((g)+1)&3] = _mm_sha256msg2_epu32(M[((g)+1)&3], M[(g)&3]); \
+        }                                                               \
+        msg_ = _mm_shuffle_epi32(msg_, 0x0e);                           \
+        S0 = _mm_sha256rnds2_epu32(S0, S1, msg_);                       \
+        if ((g) >= 1 && (g) <= 12)                                      \
+            M[((g)-1)&3] = _mm_sha256msg1_epu32(M[((g)-1)&3], M[(g)&3]); \
+    } while (0)
+
+#define SHA256_X86_ALL(OP)                                      \
+    OP(0);  OP(1);  OP(2);  OP(3);  OP(4);  OP(5);  OP(6);  OP(7);  \
+    OP(8);  OP(9);  OP(10); OP(11); OP(12); OP(13); OP(14); OP(15)
+
+#define SHA256_X86_MASK \
+    _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL)
+
+/* state[] (ABCD EFGH) <-> ABEF CDGH */
+#define SHA256_X86_LOAD_STATE(state, S0, S1)                            \
+    do {                                                                \
+        __m128i t_ = _mm_shuffle_epi32(                                 \
+            _mm_loadu_si128((const __m128i*)&(state)[0]), 0xb1);        \
+        S1 = _mm_shuffle_epi32(                                         \
+            _mm_loadu_si128((const __m128i*)&(state)[4]), 0x1b);        \
+        S0 = _mm_alignr_epi8(t_, S1, 8);                                \
+        S1 = _mm_blend_epi16(S1, t_, 0xf0);                             \
+    } while (0)
+
+#define SHA256_X86_STORE_STATE(state, S0, S1)                           \
+    do {                                                                \
+        __m128i t_ = _mm_shuffle_epi32(S0, 0x1b);                       \
+        __m128i u_ = _mm_shuffle_epi32(S1, 0xb1);                       \
+        _mm_storeu_si128((__m128i*)&(state)[0],                         \
+                         _mm_blend_epi16(t_, u_, 0xf0));                \
+        _mm_storeu_si128((__m128i*)&(state)[4],                         \
+                         _mm_alignr_epi8(u_, t_, 8));                   \
+    } while (0)
+
+X86_TARGET
+static void sha256_x86(uint32_t *state, const uint8_t *data, size_t nblocks)
+{
+    const __m128i mask = SHA256_X86_MASK;
+    __m128i S0, S1, S0_SAVE, S1_SAVE, M[4];
+
+    SHA256_X86_LOAD_STATE(state, S0, S1);
+    for (; nblocks > 0; nblocks--, data += 64) {
+        S0_SAVE = S0;
+        S1_SAVE = S1;
+#define OP(g)  SHA256_X86_GROUP(g, S0, S1, M, data)
+        SHA256_X86_ALL(OP);
+#undef OP
+        S0 = _mm_add_epi32(S0, S0_SAVE);
+        S1 = _mm_add_epi32(S1, S1_SAVE);
+    }
+    SHA256_X86_STORE_STATE(state, S0, S1);
+}
+
+X86_TARGET
+static void sha256_x86_2(uint32_t *s0, uint32_t *s1,
+                         const uint8_t *d0, const uint8_t *d1, size_t nblocks)
+{
+    const __m128i mask = SHA256_X86_MASK;
+    __m128i aS0, aS1, aS0_SAVE, aS1_SAVE, aM[4];
+    __m128i bS0, bS1, bS0_SAVE, bS1_SAVE, bM[4];
+
+    SHA256_X86_LOAD_STATE(s0, aS0, aS1);
+    SHA256_X86_LOAD_STATE(s1, bS0, bS1);
+    for (; nblocks > 0; nblocks--, d0 += 64, d1 += 64) {
+        aS0_SAVE = aS0; aS1_SAVE = aS1;
+        bS0_SAVE = bS0; bS1_SAVE = bS1;
+#define OP(g)                                           \
+        SHA256_X86_GROUP(g, aS0, aS1, aM, d0);          \
+        SHA256_X86_GROUP(g, bS0, bS1, bM, d1)
+        SHA256_X86_ALL(OP);
+#undef OP
+        aS0 = _mm_add_epi32(aS0, aS0_SAVE); aS1 = _mm_add_epi32(aS1, aS1_SAVE);
+        bS0 = _mm_add_epi32(bS0, bS0_SAVE); bS1 = _mm_add_epi32(bS1, bS1_SAVE);
+    }
+    SHA256_X86_STORE_STATE(s0, aS0, aS1);
+    SHA256_X86_STORE_STATE(s1, bS0, bS1);
+}
+
+static const char *probe_x86(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid_max(0, NULL) < 7) return NULL;
+    __cpuid(1, eax, ebx, ecx, edx);
+    if (!(ecx & (1U<<9)) || !(ecx & (1U<<19))) return NULL; /* SSSE3, SSE4.1 */
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (!(ebx & (1U<<29))) return NULL;                     /* SHA */
+
+    Scm__SHA1HWBlocks = sha1_x86;
+    Scm__SHA1HWBlocks2 = sha1_x86_2;
+    Scm__SHA256HWBlocks = sha256_x86;
+    Scm__SHA256HWBlocks2 = sha256_x86_2;
+    return "x86-sha";
+}
+#endif /* SHA_HW_X86 */
+
+/*===================================================================
+ * ARMv8 cryptography extensions
+ */
+
+#if SHA_HW_ARM
+#include <arm_neon.h>
+#if defined(HAVE_SYS_AUXV_H) && defined(HAVE_GETAUXVAL)
+#include <sys/auxv.h>
+#endif
+
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)
+#define ARM_TARGET  /* empty */
+#else
+#define ARM_TARGET __attribute__((target("+crypto")))
+#endif
+
+#define ARM_LOAD(data, k) \
+    vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8((data) + 16*(k))))
+
+/*
+ * SHA-1.  G is the group of four rounds (0..19); E alternates between
+ * E0 and E1.  The message schedule for group g+4 is computed in group g.
+ */
+#define SHA1_ARM_GROUP(g, ABCD, Ecur, Enext, M)                         \
+    do {                                                                \
+        uint32x4_t t_ = vaddq_u32(M[(g)&3],                             \
+                                  vdupq_n_u32(sha1_k[(g)/5]));          \
+        Enext = vsha1h_u32(vgetq_lane_u32(ABCD, 0));                    \
+        if ((g)/5 == 0)      ABCD = vsha1cq_u32(ABCD, Ecur, t_);        \
+        else if ((g)/5 == 2) ABCD = vsha1mq_u32(ABCD, Ecur, t_);        \
+        else                 ABCD = vsha1pq_u32(ABCD, Ecur, t_);        \
+        if ((g) <= 15) {                                                \
+            M[(g)&3] = vsha1su1q_u32(vsha1su0q_u32(M[(g)&3],            \
+                                                   M[((g)+1)&3],        \
+                                                   M[((g)+2)&3]),       \
+                                     M[((g)+3)&3]);                     \
+        }                                                               \
+    } while (0)
+
+#define SHA1_ARM_ALL(OP)                                                \
+    OP(0, E0, E1);  OP(1, E1, E0);  OP(2, E0, E1);  OP(3, E1, E0);      \
+    OP(4, E0, E1);  OP(5, E1, E0);  OP(6, E0, E1);  OP(7, E1, E0);      \
+    OP(8, E0, E1);  OP(9, E1, E0);  OP(10, E0, E1); OP(11, E1, E0);     \
+    OP(12, E0, E1); OP(13, E1, E0); OP(14, E0, E1); OP(15, E1, E0);     \
+    OP(16, E0, E1); OP(17, E1, E0); OP(18, E0, E1); OP(19, E1, E0)
+
+static const uint32_t sha1_k[4] = {
+    0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6
+};
+
+ARM_TARGET
+static void sha1_arm(uint32_t *state, const uint8_t *data, size_t nblocks)
+{
+    uint32x4_t ABCD, ABCD_SAVE, M[4];
+    uint32_t E0, E0_SAVE, E1;
+
+    ABCD = vld1q_u32(state);
+    E0 = state[4];
+    for (; nblocks > 0; nblocks--, data += 64) {
+        ABCD_SAVE = ABCD;
+        E0_SAVE = E0;
+        M[0] = ARM_LOAD(data, 0); M[1] = ARM_LOAD(data, 1);
+        M[2] = ARM_LOAD(data, 2); M[3] = ARM_LOAD(data, 3);
+#define OP(g, Ec, En)  SHA1_ARM_GROUP(g, ABCD, Ec, En, M)
+        SHA1_ARM_ALL(OP);
+#undef OP
+        E0 += E0_SAVE;
+        ABCD = vaddq_u32(ABCD, ABCD_SAVE);
+    }
+    vst1q_u32(state, ABCD);
+    state[4] = E0;
+}
+
+ARM_TARGET
+static void sha1_arm_2(uint32_t *s0, uint32_t *s1,
+                       const uint8_t *d0, const uint8_t *d1, size_t nblocks)
+{
+    uint32x4_t aABCD, aABCD_SAVE, aM[4], bABCD, bABCD_SAVE, bM[4];
+    uint32_t aE0, aE0_SAVE, aE1, bE0, bE0_SAVE, bE1;
+
+    aABCD = vld1q_u32(s0); aE0 = s0[4];
+    bABCD = vld1q_u32(s1); bE0 = s1[4];
+    for (; nblocks > 0; nblocks--, d0 += 64, d1 += 64) {
+        aABCD_SAVE = aABCD; aE0_SAVE = aE0;
+        bABCD_SAVE = bABCD; bE0_SAVE = bE0;
+        aM[0] = ARM_LOAD(d0, 0); aM[1] = ARM_LOAD(d0, 1);
+        aM[2] = ARM_LOAD(d0, 2); aM[3] = ARM_LOAD(d0, 3);
+        bM[0] = ARM_LOAD(d1, 0); bM[1] = ARM_LOAD(d1, 1);
+        bM[2] = ARM_LOAD(d1, 2); bM[3] = ARM_LOAD(d1, 3);
+#define OP(g, Ec, En)                                   \
+        SHA1_ARM_GROUP(g, aABCD, a##Ec, a##En, aM);     \
+        SHA1_ARM_GROUP(g, bABCD, b##Ec, b##En, bM)
+        SHA1_ARM_ALL(OP);
+#undef OP
+        aE0 += aE0_SAVE; aABCD = vaddq_u32(aABCD, aABCD_SAVE);
+        bE0 += bE0_SAVE; bABCD = vaddq_u32(bABCD, bABCD_SAVE);
+    }
+    vst1q_u32(s0, aABCD); s0[4] = aE0;
+    vst1q_u32(s1, bABCD); s1[4] = bE0;
+}
+
+/*
+ * SHA-256.  G is the group of four rounds (0..15).
+ */
+#define SHA256_ARM_GROUP(g, S0, S1, M)                                  \
+    do {                                                                \
+        uint32x4_t t_ = vaddq_u32(M[(g)&3], vld1q_u32(&K256[4*(g)]));   \
+        uint32x4_t s_ = S0;                                             \
+        if ((g) < 12)                                                   \
+            M[(g)&3] = vsha256su0q_u32(M[(g)&3], M[((g)+1)&3]);         \
+        S0 = vsha256hq_u32(S0, S1, t_);                                 \
+        S1 = vsha256h2q_u32(S1, s_, t_);                                \
+        if ((g) < 12)                                                   \
+            M[(g)&3] = vsha256su1q_u32(M[(g)&3], M[((g)+2)&3],          \
+                                       M[((g)+3)&3]);                   \
+    } while (0)
+
+#define SHA256_ARM_ALL(OP)                                      \
+    OP(0);  OP(1);  OP(2);  OP(3);  OP(4);  OP(5);  OP(6);  OP(7);  \
+    OP(8);  OP(9);  OP(10); OP(11); OP(12); OP(13); OP(14); OP(15)
+
+ARM_TARGET
+static void sha256_arm(uint32_t *state, const uint8_t *data, size_t nblocks)
+{
+    uint32x4_t S0, S1, S0_SAVE, S1_SAVE, M[4];
+
+    S0 = vld1q_u32(&state[0]);
+    S1 = vld1q_u32(&state[4]);
+    for (; nblocks > 0; nblocks--, data += 64) {
+        S0_SAVE = S0;
+        S1_SAVE = S1;
+        M[0] = ARM_LOAD(data, 0); M[1] = ARM_LOAD(data, 1);
+        M[2] = ARM_LOAD(data, 2); M[3] = ARM_LOAD(data, 3);
+#define OP(g)  SHA256_ARM_GROUP(g, S0, S1, M)
+        SHA256_ARM_ALL(OP);
+#undef OP
+        S0 = vaddq_u32(S0, S0_SAVE);
+        S1 = vaddq_u32(S1, S1_SAVE);
+    }
+    vst1q_u32(&state[0], S0);
+    vst1q_u32(&state[4], S1);
+}
+
+ARM_TARGET
+static void sha256_arm_2(uint32_t *s0, uint32_t *s1,
+                         const uint8_t *d0, const uint8_t *d1, size_t nblocks)
+{
+    uint32x4_t aS0, aS1, aS0_SAVE, aS1_SAVE, aM[4];
+    uint32x4_t bS0, bS1, bS0_SAVE, bS1_SAVE, bM[4];
+
+    aS0 = vld1q_u32(&s0[0]); aS1 = vld1q_u32(&s0[4]);
+    bS0 = vld1q_u32(&s1[0]); bS1 = vld1q_u32(&s1[4]);
+    for (; nblocks > 0; nblocks--, d0 += 64, d1 += 64) {
+        aS0_SAVE = aS0; aS1_SAVE = aS1;
+        bS0_SAVE = bS0; bS1_SAVE = bS1;
+        aM[0] = ARM_LOAD(d0, 0); aM[1] = ARM_LOAD(d0, 1);
+        aM[2] = ARM_LOAD(d0, 2); aM[3] = ARM_LOAD(d0, 3);
+        bM[0] = ARM_LOAD(d1, 0); bM[1] = ARM_LOAD(d1, 1);
+        bM[2] = ARM_LOAD(d1, 2); bM[3] = ARM_LOAD(d1, 3);
+#define OP(g)                                   \
+        SHA256_ARM_GROUP(g, aS0, aS1, aM);      \
+        SHA256_ARM_GROUP(g, bS0, bS1, bM)
+        SHA256_ARM_ALL(OP);
+#undef OP
+        aS0 = vaddq_u32(aS0, aS0_SAVE); aS1 = vaddq_u32(aS1, aS1_SAVE);
+        bS0 = vaddq_u32(bS0, bS0_SAVE); bS1 = vaddq_u32(bS1, bS1_SAVE);
+    }
+    vst1q_u32(&s0[0], aS0); vst1q_u32(&s0[4], aS1);
+    vst1q_u32(&s1[0], bS0); vst1q_u32(&s1[4], bS1);
+}
+
+static const char *probe_arm(void)
+{
+    int sha1 = 0, sha2 = 0;
+#if defined(__APPLE__)
+    /* All Apple arm64 processors have the extensions. */
+    sha1 = sha2 = 1;
+#elif defined(HAVE_SYS_AUXV_H) && defined(HAVE_GETAUXVAL) && defined(AT_HWCAP)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    sha1 = (hwcap & (1UL<<5)) != 0;   /* HWCAP_SHA1 */
+    sha2 = (hwcap & (1UL<<6)) != 0;   /* HWCAP_SHA2 */
+#elif defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2)
+    /* We can't ask the OS, but we're compiled for a CPU that has them. */
+    sha1 = sha2 = 1;
+#endif
+    if (sha1) {
+        Scm__SHA1HWBlocks = sha1_arm;
+        Scm__SHA1HWBlocks2 = sha1_arm_2;
+    }
+    if (sha2) {
+        Scm__SHA256HWBlocks = sha256_arm;
+        Scm__SHA256HWBlocks2 = sha256_arm_2;
+    }
+    return (sha1 || sha2) ? "armv8-crypto" : NULL;
+}
+#endif /* SHA_HW_ARM */
+
+const char *Scm__ShaHWInit(int enable)
+{
+    Scm__SHA1HWBlocks = NULL;
+    Scm__SHA1HWBlocks2 = NULL;
+    Scm__SHA256HWBlocks = NULL;
+    Scm__SHA256HWBlocks2 = NULL;
+    if (!enable) return NULL;
+#if SHA_HW_X86
+    return probe_x86();
+#elif SHA_HW_ARM
+    return probe_arm();
+#else
+    return NULL;
+#endif
+}
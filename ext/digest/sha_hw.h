@@ -0,0 +1,75 @@
+/*
+ * sha_hw.h - hardware-assisted SHA-1/SHA-256 block functions
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * This is an internal interface between sha2.c and sha_hw.c.
+ * The block functions process NBLOCKS consecutive 64-byte blocks in
+ * DATA (in message byte order) and update STATE, which has the same
+ * layout as state[] in SHA_CTX.  The "2" variants hash two independent
+ * messages in lockstep, which hides the latency of the SHA instructions.
+ *
+ * The pointers are NULL if the CPU doesn't have the extension, or
+ * the compiler can't generate the code for it.  They are set up by
+ * Scm__ShaHWInit().
+ */
+
+#ifndef GAUCHE_SHA_HW_H
+#define GAUCHE_SHA_HW_H
+
+#include <gauche/config.h>
+#include <stddef.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+
+typedef void (*ScmShaHWBlocks)(uint32_t *state,
+                               const uint8_t *data, size_t nblocks);
+typedef void (*ScmShaHWBlocks2)(uint32_t *state0, uint32_t *state1,
+                                const uint8_t *data0, const uint8_t *data1,
+                                size_t nblocks);
+
+extern ScmShaHWBlocks  Scm__SHA1HWBlocks;
+extern ScmShaHWBlocks2 Scm__SHA1HWBlocks2;
+extern ScmShaHWBlocks  Scm__SHA256HWBlocks;
+extern ScmShaHWBlocks2 Scm__SHA256HWBlocks2;
+
+/* Probes the CPU and sets up the above pointers.  If ENABLE is false,
+   clears them so that the portable code is used.  Returns the name
+   of the extension in use, or NULL. */
+extern const char *Scm__ShaHWInit(int enable);
+
+#endif /* GAUCHE_SHA_HW_H */
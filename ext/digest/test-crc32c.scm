@@ -0,0 +1,60 @@
+;;
+;; test for crc32c module
+;;
+
+(test-section "crc32c")
+
+(use rfc.crc32c)
+(test-module 'rfc.crc32c)
+
+(define (crc32c-tests)
+  (for-each
+   (^[args]
+     (test* "crc32c" (car args) (crc32c (cadr args)))
+     (test* "crc32c-digest-string" (format "~8,'0x" (car args))
+            (digest-hexify (crc32c-digest-string (cadr args))))
+     (test* "digest-string" (format "~8,'0x" (car args))
+            (digest-hexify (digest-string <crc32c> (cadr args)))))
+   `((#x00000000 "")
+     (#xc1d04330 "a")
+     (#x364b3fb7 "abc")
+     (#xe3069283 "123456789")
+     (#x02bd79d0 "message digest")
+     (#x9ee6ef25 "abcdefghijklmnopqrstuvwxyz")
+     (#x477a6781 "12345678901234567890123456789012345678901234567890123456789012345678901234567890")
+     ;; RFC 3720 B.4
+     (#x8a9136aa ,(make-u8vector 32 0))
+     (#x62a8ab43 ,(make-u8vector 32 #xff))
+     (#x46dd794e ,(list->u8vector (iota 32)))
+     (#x113fdb5c ,(list->u8vector (iota 32 31 -1)))
+     (#x68c9c0ef ,(with-output-to-string
+                    (^[] (dotimes [i 1000]
+                           (write-char (integer->char (+ 97 (modulo i 26))))))))))
+
+  (test* "crc32c incremental" #xe3069283
+         (crc32c "6789" (crc32c "12345")))
+  (test* "crc32c digest-update!" "e3069283"
+         (let1 d (make <crc32c>)
+           (digest-update! d "1234")
+           (digest-update! d '#u8(53 54))
+           (digest-update! d "789")
+           (digest-hexify (digest-final! d))))
+  (test* "crc32c uvector" (crc32c (make-u8vector 12 7))
+         (crc32c (make-u32vector 3 #x07070707)))
+  (test* "crc32c unaligned" (crc32c (u8vector-copy (make-u8vector 100 9) 3))
+         (crc32c (uvector-alias <u8vector> (make-u8vector 100 9) 3)))
+  (test* "crc32c type error" (test-error)
+         (crc32c '(1 2 3))))
+
+(test* "crc32c-hardware-acceleration"
+       #t
+       (or (not (crc32c-hardware-acceleration))
+           (and (memq (crc32c-hardware-acceleration) '(sse4.2 armv8-crc)) #t)))
+
+(crc32c-tests)
+
+(when (crc32c-hardware-acceleration)
+  (test-section "crc32c (without CPU extension)")
+  ((with-module rfc.crc32c %crc32c-hardware-acceleration-set!) #f)
+  (crc32c-tests)
+  ((with-module rfc.crc32c %crc32c-hardware-acceleration-set!) #t))
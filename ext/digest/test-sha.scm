@@ -7,6 +7,7 @@
 (use srfi-42)
 (use file.util)
 (use util.match)
+(use gauche.uvector)
 
 (use rfc.sha1)
 (test-module 'rfc.sha1)
@@ -99,3 +100,53 @@
 
 (for-each test-from-file (glob "data/*.info"))
 
+(test-section "sha hardware acceleration and multi-buffer")
+
+(test* "sha-hardware-acceleration" #t
+       (and (memq (sha-hardware-acceleration)
+                  '(#f x86-sha armv8-crypto))
+            #t))
+
+;; Messages of various lengths, so that the paired messages run out of
+;; complete blocks at different points.
+(define *multi-messages*
+  (list-ec (: i 41)
+           (let1 len (modulo (* i 97) 1031)
+             (if (even? i)
+               (string-ec (: k len) (integer->char (+ 32 (modulo (+ i k) 90))))
+               (list->u8vector
+                (list-ec (: k len) (modulo (* (+ i 1) k) 256)))))))
+
+(define (multi-test name digest-multi digest-string)
+  (define (single m)
+    (digest-string (if (u8vector? m) (u8vector->string m) m)))
+  (test* #"~name-digest-multi" (map single *multi-messages*)
+         (digest-multi *multi-messages*))
+  (test* #"~name-digest-multi (single)" (list (single "abc"))
+         (digest-multi '("abc")))
+  (test* #"~name-digest-multi (empty)" '() (digest-multi '())))
+
+(define (multi-tests)
+  (multi-test "sha1" sha1-digest-multi sha1-digest-string)
+  (multi-test "sha224" sha224-digest-multi sha224-digest-string)
+  (multi-test "sha256" sha256-digest-multi sha256-digest-string)
+  (multi-test "sha384" sha384-digest-multi sha384-digest-string)
+  (multi-test "sha512" sha512-digest-multi sha512-digest-string))
+
+(multi-tests)
+
+(test* "sha256-digest-multi (bad argument)" (test-error)
+       (sha256-digest-multi '("abc" 123)))
+
+;; Run the same tests with the portable code, if we've been using
+;; the CPU extension.
+(when (sha-hardware-acceleration)
+  (let1 hw (sha-hardware-acceleration)
+    (test* "disable acceleration" #f
+           ((with-module rfc.sha %sha-hardware-acceleration-set!) #f))
+    (unwind-protect
+        (begin
+          (for-each test-from-file (glob "data/*.info"))
+          (multi-tests))
+      (test* "re-enable acceleration" hw
+             ((with-module rfc.sha %sha-hardware-acceleration-set!) #t)))))
@@ -0,0 +1,76 @@
+;;
+;; test for xxhash module
+;;
+
+(test-section "xxhash")
+
+(use rfc.xxhash)
+(test-module 'rfc.xxhash)
+
+(define *long-string*
+  (with-output-to-string
+    (^[] (dotimes [i 1000]
+           (write-char (integer->char (+ 97 (modulo i 26))))))))
+
+;; (input xxh64 xxh64/seed42 xxh3 xxh3/seed42)
+(for-each
+ (^[args]
+   (apply
+    (^[input h64 h64s h3 h3s]
+      (test* "xxhash64" h64 (xxhash64 input))
+      (test* "xxhash64 seed" h64s (xxhash64 input 42))
+      (test* "xxh3" h3 (xxh3 input))
+      (test* "xxh3 seed" h3s (xxh3 input 42))
+      (test* "xxhash64-digest-string" (format "~16,'0x" h64)
+             (digest-hexify (xxhash64-digest-string input)))
+      (test* "xxh3-digest-string" (format "~16,'0x" h3s)
+             (digest-hexify (xxh3-digest-string input 42)))
+      (test* "digest-string <xxhash64>" (format "~16,'0x" h64)
+             (digest-hexify (digest-string <xxhash64> input)))
+      (test* "digest-string <xxh3>" (format "~16,'0x" h3)
+             (digest-hexify (digest-string <xxh3> input))))
+    args))
+ `(("" #xef46db3751d8e999 #x98b1582b0977e704
+       #x2d06800538d394c2 #xb029411ff43d84d2)
+   ("a" #xd24ec4f1a98c6e5b #x88e4fe59adf7b0cc
+        #xe6c632b61e964e1f #x4c437dd47f0716f4)
+   ("abc" #x44bc2cf5ad770999 #x13c1d910702770e6
+          #x78af5f94892f3950 #xd8438def21bbdcc3)
+   ("message digest" #x066ed728fceeb3be #x85fea12f652e06e9
+                     #x160d8e9329be94f9 #x6d27094dba7a6019)
+   ("abcdefghijklmnopqrstuvwxyz" #xcfe1f278fa89835c #xd2adb2b633915fd4
+                                 #x810f9ca067fbb90c #xab54ab387a929d0e)
+   ("12345678901234567890123456789012345678901234567890123456789012345678901234567890"
+    #xe04a477f19ee145d #x5021173af538ae2d
+    #x7f58aa2520c681f9 #x518676908b5fa57a)
+   (,(string-copy *long-string* 0 200)
+    #x8ed60a67e753f8f1 #xa22c0d97bbb18eed
+    #xe12dae8ffe57bbc9 #x984a9ab3db697faa)
+   (,*long-string*
+    #x94b86db9a16d86a9 #x1af88ec9cd59077b
+    #xe153425558d7da5d #x3cc4d29d1e6ed4a2)))
+
+;; Feeding the data in pieces must give the same result, whichever
+;; way it is split.
+(define (split-update class seed chunk input)
+  (let ([d (make class :seed seed)]
+        [v (string->u8vector input)])
+    (let loop ([i 0])
+      (when (< i (u8vector-length v))
+        (digest-update! d (u8vector-copy v i (min (+ i chunk)
+                                                   (u8vector-length v))))
+        (loop (+ i chunk))))
+    (digest-hexify (digest-final! d))))
+
+(dolist [chunk '(1 7 32 63 64 65 300)]
+  (test* #"xxhash64 incremental (~chunk)" (format "~16,'0x" #x94b86db9a16d86a9)
+         (split-update <xxhash64> 0 chunk *long-string*))
+  (test* #"xxh3 incremental (~chunk)" (format "~16,'0x" #x3cc4d29d1e6ed4a2)
+         (split-update <xxh3> 42 chunk *long-string*)))
+
+(test* "xxh3 uvector" (xxh3 (make-u8vector 12 7))
+       (xxh3 (make-u32vector 3 #x07070707)))
+(test* "xxhash64 large seed" (xxhash64 "abc" (- (expt 2 64) 1))
+       (xxhash64 (string->u8vector "abc") #xffffffffffffffff))
+(test* "xxhash64 bad seed" (test-error) (xxhash64 "abc" -1))
+(test* "xxh3 type error" (test-error) (xxh3 'abc))
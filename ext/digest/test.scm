@@ -3,6 +3,8 @@
 
 (include "test-md5")
 (include "test-sha")
+(include "test-crc32c")
+(include "test-xxhash")
 (include "test-hmac")
 
 (test-end)
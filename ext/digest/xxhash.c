@@ -0,0 +1,620 @@
+/*
+ * xxhash.c - xxHash64 and XXH3 (64bit) hash functions
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "xxhash.h"
+#include <string.h>
+
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(_M_X64))
+#include <emmintrin.h>
+#define XXH3_USE_SSE2 1
+#endif
+
+/*===================================================================
+ * Utilities
+ */
+
+static inline uint64_t rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint32_t read32(const uint8_t *p)
+{
+#if WORDS_BIGENDIAN
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8)
+        | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+#else
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+#endif
+}
+
+static inline uint64_t read64(const uint8_t *p)
+{
+#if WORDS_BIGENDIAN
+    return (uint64_t)read32(p) | ((uint64_t)read32(p + 4) << 32);
+#else
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+#endif
+}
+
+static inline void write64(uint8_t *p, uint64_t v)
+{
+#if WORDS_BIGENDIAN
+    int i;
+    for (i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8*i));
+#else
+    memcpy(p, &v, sizeof(v));
+#endif
+}
+
+static inline uint64_t swap64(uint64_t x)
+{
+    return ((x << 56) & 0xff00000000000000ULL)
+        | ((x << 40) & 0x00ff000000000000ULL)
+        | ((x << 24) & 0x0000ff0000000000ULL)
+        | ((x << 8)  & 0x000000ff00000000ULL)
+        | ((x >> 8)  & 0x00000000ff000000ULL)
+        | ((x >> 24) & 0x0000000000ff0000ULL)
+        | ((x >> 40) & 0x000000000000ff00ULL)
+        | ((x >> 56) & 0x00000000000000ffULL);
+}
+
+static inline uint32_t swap32(uint32_t x)
+{
+    return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+/* 64x64->128 multiply, folded to 64 bits by xoring the halves. */
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 p = (unsigned __int128)a * b;
+    return (uint64_t)p ^ (uint64_t)(p >> 64);
+#else
+    uint64_t lo_lo = (a & 0xffffffff) * (b & 0xffffffff);
+    uint64_t hi_lo = (a >> 32)        * (b & 0xffffffff);
+    uint64_t lo_hi = (a & 0xffffffff) * (b >> 32);
+    uint64_t hi_hi = (a >> 32)        * (b >> 32);
+    uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xffffffff) + lo_hi;
+    uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    uint64_t lower = (cross << 32) | (lo_lo & 0xffffffff);
+    return lower ^ upper;
+#endif
+}
+
+#define PRIME32_1  0x9E3779B1U
+#define PRIME32_2  0x85EBCA77U
+#define PRIME32_3  0xC2B2AE3DU
+#define PRIME64_1  0x9E3779B185EBCA87ULL
+#define PRIME64_2  0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3  0x165667B19E3779F9ULL
+#define PRIME64_4  0x85EBCA77C2B2AE63ULL
+#define PRIME64_5  0x27D4EB2F165667C5ULL
+#define PRIME_MX1  0x165667919E3779F9ULL
+#define PRIME_MX2  0x9FB21C651E98DF25ULL
+
+/*===================================================================
+ * xxHash64
+ */
+
+static inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+/* Processes the remaining LEN (< 32) bytes and finalizes. */
+static uint64_t xxh64_finalize(uint64_t h, const uint8_t *p, size_t len)
+{
+    for (; len >= 8; len -= 8, p += 8) {
+        h ^= xxh64_round(0, read64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (len >= 4) {
+        h ^= (uint64_t)read32(p) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        len -= 4;
+        p += 4;
+    }
+    for (; len > 0; len--, p++) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+    return xxh64_avalanche(h);
+}
+
+static inline uint64_t xxh64_converge(const uint64_t v[4])
+{
+    uint64_t h = rotl64(v[0], 1) + rotl64(v[1], 7)
+        + rotl64(v[2], 12) + rotl64(v[3], 18);
+    h = xxh64_merge_round(h, v[0]);
+    h = xxh64_merge_round(h, v[1]);
+    h = xxh64_merge_round(h, v[2]);
+    h = xxh64_merge_round(h, v[3]);
+    return h;
+}
+
+/* Consumes as many 32-byte stripes as possible; returns the number
+   of bytes consumed. */
+static size_t xxh64_stripes(uint64_t v[4], const uint8_t *p, size_t len)
+{
+    const uint8_t *start = p;
+    uint64_t v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+    for (; len >= 32; len -= 32, p += 32) {
+        v0 = xxh64_round(v0, read64(p));
+        v1 = xxh64_round(v1, read64(p+8));
+        v2 = xxh64_round(v2, read64(p+16));
+        v3 = xxh64_round(v3, read64(p+24));
+    }
+    v[0] = v0; v[1] = v1; v[2] = v2; v[3] = v3;
+    return (size_t)(p - start);
+}
+
+static inline void xxh64_init_acc(uint64_t v[4], uint64_t seed)
+{
+    v[0] = seed + PRIME64_1 + PRIME64_2;
+    v[1] = seed + PRIME64_2;
+    v[2] = seed;
+    v[3] = seed - PRIME64_1;
+}
+
+uint64_t Scm_XXH64(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t*)data;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v[4];
+        size_t n;
+        xxh64_init_acc(v, seed);
+        n = xxh64_stripes(v, p, len);
+        h = xxh64_converge(v);
+        p += n;
+        h += len;
+        return xxh64_finalize(h, p, len - n);
+    }
+    h = seed + PRIME64_5 + len;
+    return xxh64_finalize(h, p, len);
+}
+
+void Scm_XXH64Init(ScmXXH64State *st, uint64_t seed)
+{
+    memset(st, 0, sizeof(*st));
+    xxh64_init_acc(st->v, seed);
+}
+
+void Scm_XXH64Update(ScmXXH64State *st, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t*)data;
+
+    st->totalLen += len;
+    if (st->memSize + len < 32) {
+        memcpy(st->mem + st->memSize, p, len);
+        st->memSize += (uint32_t)len;
+        return;
+    }
+    if (st->memSize > 0) {
+        size_t fill = 32 - st->memSize;
+        memcpy(st->mem + st->memSize, p, fill);
+        xxh64_stripes(st->v, st->mem, 32);
+        p += fill;
+        len -= fill;
+        st->memSize = 0;
+    }
+    if (len >= 32) {
+        size_t n = xxh64_stripes(st->v, p, len);
+        p += n;
+        len -= n;
+    }
+    if (len > 0) {
+        memcpy(st->mem, p, len);
+        st->memSize = (uint32_t)len;
+    }
+}
+
+uint64_t Scm_XXH64Digest(const ScmXXH64State *st)
+{
+    uint64_t h;
+    if (st->totalLen >= 32) {
+        h = xxh64_converge(st->v);
+    } else {
+        h = st->v[2] /* seed */ + PRIME64_5;
+    }
+    h += st->totalLen;
+    return xxh64_finalize(h, st->mem, st->memSize);
+}
+
+/*===================================================================
+ * XXH3 (64bit)
+ */
+
+/* The default secret. */
+static const uint8_t kSecret[SCM_XXH3_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+#define XXH3_MIDSIZE_MAX      240
+#define XXH3_SECRET_SIZE_MIN  136
+#define XXH3_STRIPE_LEN       64
+#define XXH3_CONSUME_RATE     8
+#define XXH3_SECRET_LIMIT     (SCM_XXH3_SECRET_SIZE - XXH3_STRIPE_LEN)
+#define XXH3_STRIPES_PER_BLOCK (XXH3_SECRET_LIMIT / XXH3_CONSUME_RATE)
+#define XXH3_BLOCK_LEN        (XXH3_STRIPE_LEN * XXH3_STRIPES_PER_BLOCK)
+#define XXH3_LASTACC_START    7
+#define XXH3_MERGEACCS_START  11
+
+static inline uint64_t xxh3_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static uint64_t xxh3_len_0to16(const uint8_t *p, size_t len,
+                               const uint8_t *secret, uint64_t seed)
+{
+    if (len > 8) {
+        uint64_t bitflip1 = (read64(secret+24) ^ read64(secret+32)) + seed;
+        uint64_t bitflip2 = (read64(secret+40) ^ read64(secret+48)) - seed;
+        uint64_t lo = read64(p) ^ bitflip1;
+        uint64_t hi = read64(p + len - 8) ^ bitflip2;
+        uint64_t acc = len + swap64(lo) + hi + mul128_fold64(lo, hi);
+        return xxh3_avalanche(acc);
+    }
+    if (len >= 4) {
+        uint64_t s = seed ^ ((uint64_t)swap32((uint32_t)seed) << 32);
+        uint32_t in1 = read32(p);
+        uint32_t in2 = read32(p + len - 4);
+        uint64_t bitflip = (read64(secret+8) ^ read64(secret+16)) - s;
+        uint64_t in64 = in2 + ((uint64_t)in1 << 32);
+        return xxh3_rrmxmx(in64 ^ bitflip, len);
+    }
+    if (len > 0) {
+        uint32_t combined = ((uint32_t)p[0] << 16) | ((uint32_t)p[len>>1] << 24)
+            | (uint32_t)p[len-1] | ((uint32_t)len << 8);
+        uint64_t bitflip = (read32(secret) ^ read32(secret+4)) + seed;
+        return xxh64_avalanche((uint64_t)combined ^ bitflip);
+    }
+    return xxh64_avalanche(seed ^ (read64(secret+56) ^ read64(secret+64)));
+}
+
+static inline uint64_t xxh3_mix16(const uint8_t *p, const uint8_t *secret,
+                                  uint64_t seed)
+{
+    return mul128_fold64(read64(p)   ^ (read64(secret)   + seed),
+                         read64(p+8) ^ (read64(secret+8) - seed));
+}
+
+static uint64_t xxh3_len_17to128(const uint8_t *p, size_t len,
+                                 const uint8_t *secret, uint64_t seed)
+{
+    uint64_t acc = len * PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += xxh3_mix16(p+48, secret+96, seed);
+                acc += xxh3_mix16(p+len-64, secret+112, seed);
+            }
+            acc += xxh3_mix16(p+32, secret+64, seed);
+            acc += xxh3_mix16(p+len-48, secret+80, seed);
+        }
+        acc += xxh3_mix16(p+16, secret+32, seed);
+        acc += xxh3_mix16(p+len-32, secret+48, seed);
+    }
+    acc += xxh3_mix16(p, secret, seed);
+    acc += xxh3_mix16(p+len-16, secret+16, seed);
+    return xxh3_avalanche(acc);
+}
+
+static uint64_t xxh3_len_129to240(const uint8_t *p, size_t len,
+                                  const uint8_t *secret, uint64_t seed)
+{
+    uint64_t acc = len * PRIME64_1, acc_end;
+    unsigned int nrounds = (unsigned int)len / 16, i;
+
+    for (i = 0; i < 8; i++) {
+        acc += xxh3_mix16(p + 16*i, secret + 16*i, seed);
+    }
+    acc_end = xxh3_mix16(p + len - 16, secret + XXH3_SECRET_SIZE_MIN - 17, seed);
+    acc = xxh3_avalanche(acc);
+    for (i = 8; i < nrounds; i++) {
+        acc_end += xxh3_mix16(p + 16*i, secret + 16*(i-8) + 3, seed);
+    }
+    return xxh3_avalanche(acc + acc_end);
+}
+
+/* Long input: accumulate 64-byte stripes into eight 64-bit lanes. */
+static inline void xxh3_accumulate_512(uint64_t *acc, const uint8_t *in,
+                                       const uint8_t *secret)
+{
+#if XXH3_USE_SSE2
+    int i;
+    for (i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + 2*i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(in + 16*i));
+        __m128i k = _mm_loadu_si128((const __m128i*)(secret + 16*i));
+        __m128i dk = _mm_xor_si128(d, k);
+        __m128i dk_hi = _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i prod = _mm_mul_epu32(dk, dk_hi);
+        __m128i dswap = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+        a = _mm_add_epi64(_mm_add_epi64(a, dswap), prod);
+        _mm_storeu_si128((__m128i*)(acc + 2*i), a);
+    }
+#else
+    int i;
+    for (i = 0; i < 8; i++) {
+        uint64_t d = read64(in + 8*i);
+        uint64_t dk = d ^ read64(secret + 8*i);
+        acc[i^1] += d;
+        acc[i] += (dk & 0xffffffff) * (dk >> 32);
+    }
+#endif
+}
+
+static inline void xxh3_scramble(uint64_t *acc, const uint8_t *secret)
+{
+#if XXH3_USE_SSE2
+    const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+    int i;
+    for (i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(acc + 2*i));
+        __m128i k = _mm_loadu_si128((const __m128i*)(secret + 16*i));
+        __m128i dk = _mm_xor_si128(_mm_xor_si128(a, _mm_srli_epi64(a, 47)), k);
+        __m128i dk_hi = _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1));
+        __m128i lo = _mm_mul_epu32(dk, prime);
+        __m128i hi = _mm_mul_epu32(dk_hi, prime);
+        _mm_storeu_si128((__m128i*)(acc + 2*i),
+                         _mm_add_epi64(lo, _mm_slli_epi64(hi, 32)));
+    }
+#else
+    int i;
+    for (i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read64(secret + 8*i);
+        acc[i] = a * PRIME32_1;
+    }
+#endif
+}
+
+static inline void xxh3_accumulate(uint64_t *acc, const uint8_t *in,
+                                   const uint8_t *secret, size_t nstripes)
+{
+    size_t n;
+    for (n = 0; n < nstripes; n++) {
+        xxh3_accumulate_512(acc, in + n*XXH3_STRIPE_LEN,
+                            secret + n*XXH3_CONSUME_RATE);
+    }
+}
+
+static inline void xxh3_init_acc(uint64_t acc[8])
+{
+    acc[0] = PRIME32_3; acc[1] = PRIME64_1;
+    acc[2] = PRIME64_2; acc[3] = PRIME64_3;
+    acc[4] = PRIME64_4; acc[5] = PRIME32_2;
+    acc[6] = PRIME64_5; acc[7] = PRIME32_1;
+}
+
+static uint64_t xxh3_merge_accs(const uint64_t acc[8], const uint8_t *secret,
+                                uint64_t start)
+{
+    uint64_t r = start;
+    int i;
+    for (i = 0; i < 4; i++) {
+        r += mul128_fold64(acc[2*i]   ^ read64(secret + 16*i),
+                           acc[2*i+1] ^ read64(secret + 16*i + 8));
+    }
+    return xxh3_avalanche(r);
+}
+
+static void xxh3_derive_secret(uint8_t secret[SCM_XXH3_SECRET_SIZE],
+                               uint64_t seed)
+{
+    int i;
+    for (i = 0; i < SCM_XXH3_SECRET_SIZE / 16; i++) {
+        write64(secret + 16*i,     read64(kSecret + 16*i)     + seed);
+        write64(secret + 16*i + 8, read64(kSecret + 16*i + 8) - seed);
+    }
+}
+
+static uint64_t xxh3_long(const uint8_t *p, size_t len, const uint8_t *secret)
+{
+    uint64_t acc[8];
+    size_t nblocks = (len - 1) / XXH3_BLOCK_LEN, n, nstripes;
+
+    xxh3_init_acc(acc);
+    for (n = 0; n < nblocks; n++) {
+        xxh3_accumulate(acc, p + n*XXH3_BLOCK_LEN, secret,
+                        XXH3_STRIPES_PER_BLOCK);
+        xxh3_scramble(acc, secret + XXH3_SECRET_LIMIT);
+    }
+    nstripes = ((len - 1) - XXH3_BLOCK_LEN*nblocks) / XXH3_STRIPE_LEN;
+    xxh3_accumulate(acc, p + nblocks*XXH3_BLOCK_LEN, secret, nstripes);
+    xxh3_accumulate_512(acc, p + len - XXH3_STRIPE_LEN,
+                        secret + XXH3_SECRET_LIMIT - XXH3_LASTACC_START);
+    return xxh3_merge_accs(acc, secret + XXH3_MERGEACCS_START,
+                           (uint64_t)len * PRIME64_1);
+}
+
+uint64_t Scm_XXH3(const void *data, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t*)data;
+
+    if (len <= 16)  return xxh3_len_0to16(p, len, kSecret, seed);
+    if (len <= 128) return xxh3_len_17to128(p, len, kSecret, seed);
+    if (len <= XXH3_MIDSIZE_MAX) return xxh3_len_129to240(p, len, kSecret, seed);
+    if (seed == 0) {
+        return xxh3_long(p, len, kSecret);
+    } else {
+        uint8_t secret[SCM_XXH3_SECRET_SIZE];
+        xxh3_derive_secret(secret, seed);
+        return xxh3_long(p, len, secret);
+    }
+}
+
+void Scm_XXH3Init(ScmXXH3State *st, uint64_t seed)
+{
+    memset(st, 0, sizeof(*st));
+    xxh3_init_acc(st->acc);
+    st->seed = seed;
+    if (seed == 0) memcpy(st->secret, kSecret, SCM_XXH3_SECRET_SIZE);
+    else xxh3_derive_secret(st->secret, seed);
+}
+
+/* Feeds NSTRIPES stripes from P, scrambling at block boundaries. */
+static void xxh3_consume_stripes(uint64_t *acc, uint32_t *sofar,
+                                 const uint8_t *p, size_t nstripes,
+                                 const uint8_t *secret)
+{
+    size_t this_time = XXH3_STRIPES_PER_BLOCK - *sofar;
+    while (nstripes >= this_time) {
+        xxh3_accumulate(acc, p, secret + *sofar * XXH3_CONSUME_RATE, this_time);
+        xxh3_scramble(acc, secret + XXH3_SECRET_LIMIT);
+        p += this_time * XXH3_STRIPE_LEN;
+        nstripes -= this_time;
+        *sofar = 0;
+        this_time = XXH3_STRIPES_PER_BLOCK;
+    }
+    if (nstripes > 0) {
+        xxh3_accumulate(acc, p, secret + *sofar * XXH3_CONSUME_RATE, nstripes);
+        *sofar += (uint32_t)nstripes;
+    }
+}
+
+/*
+ * We always keep some input in the buffer, since the last stripe
+ * is treated specially by the digest.  When we consume data directly
+ * from the input, we save its last stripe at the end of the buffer,
+ * for the digest may need it.
+ */
+void Scm_XXH3Update(ScmXXH3State *st, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t*)data, *end = p + len;
+
+    st->totalLen += len;
+    if (len <= SCM_XXH3_BUFFER_SIZE - st->bufferedSize) {
+        memcpy(st->buffer + st->bufferedSize, p, len);
+        st->bufferedSize += (uint32_t)len;
+        return;
+    }
+    if (st->bufferedSize > 0) {
+        size_t fill = SCM_XXH3_BUFFER_SIZE - st->bufferedSize;
+        memcpy(st->buffer + st->bufferedSize, p, fill);
+        p += fill;
+        xxh3_consume_stripes(st->acc, &st->nbStripesSoFar, st->buffer,
+                             SCM_XXH3_BUFFER_SIZE / XXH3_STRIPE_LEN,
+                             st->secret);
+        st->bufferedSize = 0;
+    }
+    if (end - p > SCM_XXH3_BUFFER_SIZE) {
+        size_t nstripes = (size_t)(end - 1 - p) / XXH3_STRIPE_LEN;
+        xxh3_consume_stripes(st->acc, &st->nbStripesSoFar, p, nstripes,
+                             st->secret);
+        p += nstripes * XXH3_STRIPE_LEN;
+        memcpy(st->buffer + SCM_XXH3_BUFFER_SIZE - XXH3_STRIPE_LEN,
+               p - XXH3_STRIPE_LEN, XXH3_STRIPE_LEN);
+    }
+    memcpy(st->buffer, p, (size_t)(end - p));
+    st->bufferedSize = (uint32_t)(end - p);
+}
+
+uint64_t Scm_XXH3Digest(const ScmXXH3State *st)
+{
+    uint64_t acc[8];
+    uint8_t last[XXH3_STRIPE_LEN];
+    const uint8_t *lastp;
+
+    if (st->totalLen <= XXH3_MIDSIZE_MAX) {
+        return Scm_XXH3(st->buffer, (size_t)st->totalLen, st->seed);
+    }
+
+    memcpy(acc, st->acc, sizeof(acc));
+    if (st->bufferedSize >= XXH3_STRIPE_LEN) {
+        size_t nstripes = (st->bufferedSize - 1) / XXH3_STRIPE_LEN;
+        uint32_t sofar = st->nbStripesSoFar;
+        xxh3_consume_stripes(acc, &sofar, st->buffer, nstripes, st->secret);
+        lastp = st->buffer + st->bufferedSize - XXH3_STRIPE_LEN;
+    } else {
+        /* Part of the last stripe is saved at the end of the buffer. */
+        size_t catchup = XXH3_STRIPE_LEN - st->bufferedSize;
+        memcpy(last, st->buffer + SCM_XXH3_BUFFER_SIZE - catchup, catchup);
+        memcpy(last + catchup, st->buffer, st->bufferedSize);
+        lastp = last;
+    }
+    xxh3_accumulate_512(acc, lastp,
+                        st->secret + XXH3_SECRET_LIMIT - XXH3_LASTACC_START);
+    return xxh3_merge_accs(acc, st->secret + XXH3_MERGEACCS_START,
+                           st->totalLen * PRIME64_1);
+}
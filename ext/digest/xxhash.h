@@ -0,0 +1,86 @@
+/*
+ * xxhash.h - xxHash64 and XXH3 (64bit) hash functions
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * An implementation of xxHash64 and the 64-bit variant of XXH3,
+ * compatible with the reference implementation (xxHash 0.8) by
+ * Yann Collet.  Both one-shot and incremental interfaces are provided.
+ * Digests are returned as 64-bit integers; the canonical byte
+ * representation is big-endian.
+ */
+
+#ifndef GAUCHE_XXHASH_H
+#define GAUCHE_XXHASH_H
+
+#include <gauche/config.h>
+#include <stddef.h>
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+#ifdef HAVE_INTTYPES_H
+#include <inttypes.h>
+#endif
+
+typedef struct ScmXXH64StateRec {
+    uint64_t v[4];
+    uint64_t totalLen;
+    uint8_t  mem[32];
+    uint32_t memSize;
+} ScmXXH64State;
+
+#define SCM_XXH3_SECRET_SIZE  192
+#define SCM_XXH3_BUFFER_SIZE  256
+
+typedef struct ScmXXH3StateRec {
+    uint64_t acc[8];
+    uint8_t  secret[SCM_XXH3_SECRET_SIZE];  /* derived from the seed */
+    uint8_t  buffer[SCM_XXH3_BUFFER_SIZE];
+    uint32_t bufferedSize;
+    uint32_t nbStripesSoFar;
+    uint64_t totalLen;
+    uint64_t seed;
+} ScmXXH3State;
+
+extern uint64_t Scm_XXH64(const void *data, size_t len, uint64_t seed);
+extern void     Scm_XXH64Init(ScmXXH64State *st, uint64_t seed);
+extern void     Scm_XXH64Update(ScmXXH64State *st,
+                                const void *data, size_t len);
+extern uint64_t Scm_XXH64Digest(const ScmXXH64State *st);
+
+extern uint64_t Scm_XXH3(const void *data, size_t len, uint64_t seed);
+extern void     Scm_XXH3Init(ScmXXH3State *st, uint64_t seed);
+extern void     Scm_XXH3Update(ScmXXH3State *st,
+                               const void *data, size_t len);
+extern uint64_t Scm_XXH3Digest(const ScmXXH3State *st);
+
+#endif /* GAUCHE_XXHASH_H */
@@ -0,0 +1,195 @@
+;;;
+;;; xxhash - xxHash64 and XXH3 non-cryptographic hash functions
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;;; Cf. https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+;;; These are fast checksums, not cryptographic hashes.
+
+(define-module rfc.xxhash
+  (use gauche.uvector)
+  (extend util.digest)
+  (export <xxhash64> xxhash64 xxhash64-digest xxhash64-digest-string
+          <xxh3> xxh3 xxh3-digest xxh3-digest-string))
+(select-module rfc.xxhash)
+
+;;;
+;;;  High-level API
+;;;
+
+(define-constant *xxhash-unit-len* 65536)
+
+(define (gen-digest init update end)
+  (^[:optional (seed 0)]
+    (let ([ctx (init seed)]
+          [buf (make-u8vector *xxhash-unit-len*)])
+      (generator-for-each
+       (^x (update ctx x))
+       (^[] (let1 count (read-block! buf)
+              (cond [(eof-object? count) count]
+                    [(< count *xxhash-unit-len*)
+                     (uvector-alias <u8vector> buf 0 count)]
+                    [else buf]))))
+      (end ctx))))
+
+(define xxhash64-digest (gen-digest %xxh64-init %xxh64-update %xxh64-final))
+(define xxh3-digest     (gen-digest %xxh3-init  %xxh3-update  %xxh3-final))
+
+(define (xxhash64-digest-string s :optional (seed 0))
+  (with-input-from-string s (cut xxhash64-digest seed)))
+(define (xxh3-digest-string s :optional (seed 0))
+  (with-input-from-string s (cut xxh3-digest seed)))
+
+;;;
+;;; Digest framework
+;;;
+
+(define-macro (define-framework name prefix)
+  (let ([meta   (string->symbol #"<~|name|-meta>")]
+        [cls    (string->symbol #"<~|name|>")]
+        [init   (string->symbol #"%~|prefix|-init")]
+        [update (string->symbol #"%~|prefix|-update")]
+        [final  (string->symbol #"%~|prefix|-final")]
+        [digest (string->symbol #"~|name|-digest")])
+    `(begin
+       (define-class ,meta (<message-digest-algorithm-meta>) ())
+       (define-class ,cls (<message-digest-algorithm>)
+         ((seed :init-keyword :seed :init-value 0)
+          (context))
+         :metaclass ,meta)
+       (define-method initialize ((self ,cls) initargs)
+         (next-method)
+         (slot-set! self 'context (,init (slot-ref self 'seed))))
+       (define-method digest-update! ((self ,cls) data)
+         (,update (slot-ref self 'context) data))
+       (define-method digest-final! ((self ,cls))
+         (,final (slot-ref self 'context)))
+       (define-method digest ((class ,meta))
+         (,digest)))))
+
+(define-framework xxhash64 xxh64)
+(define-framework xxh3     xxh3)
+
+;;;
+;;; Low-level bindings
+;;;
+
+(inline-stub
+ "#include <gauche/class.h>"
+ "#include \"xxhash.h\""
+
+ "#define LIBGAUCHE_EXT_BODY"
+ "#include <gauche/extern.h>  /* fix SCM_EXTERN in SCM_CLASS_DECL */"
+
+ "typedef struct ScmXXH64ContextRec {"
+ " SCM_HEADER;"
+ " ScmXXH64State st;"
+ "} ScmXXH64Context;"
+
+ "typedef struct ScmXXH3ContextRec {"
+ " SCM_HEADER;"
+ " ScmXXH3State st;"
+ "} ScmXXH3Context;"
+
+ ;; Any uvector is hashed as its raw bytes, in the native byte order.
+ (define-cfn get-bytes (data len::size_t*) ::(const void*) :static
+   (cond
+    [(SCM_UVECTORP data)
+     (set! (* len) (Scm_UVectorSizeInBytes (SCM_UVECTOR data)))
+     (return (SCM_UVECTOR_ELEMENTS (SCM_UVECTOR data)))]
+    [(SCM_STRINGP data)
+     (let* ([b::(const ScmStringBody*) (SCM_STRING_BODY data)])
+       (set! (* len) (SCM_STRING_BODY_SIZE b))
+       (return (SCM_STRING_BODY_START b)))]
+    [else (SCM_TYPE_ERROR data "uvector or string")
+          (return NULL)]))
+
+ (define-cfn make-digest (h::uint64_t) :static
+   (let* ([digest::(.array (unsigned char) [8])])
+     (dotimes [i 8]
+       (set! (aref digest (- 7 i)) (cast (unsigned char) (logand h #xff))
+             h (>> h 8)))
+     (return (Scm_MakeString (cast (const char*) digest) 8 8
+                             (logior SCM_STRING_INCOMPLETE
+                                     SCM_STRING_COPYING)))))
+
+ (define-cclass <xxh64-context> :private
+   ScmXXH64Context* "Scm_XXH64ContextClass" ()
+   ()
+   [allocator
+    (let* ([ctx::ScmXXH64Context* (SCM_NEW_INSTANCE ScmXXH64Context klass)])
+      (Scm_XXH64Init (& (-> ctx st)) 0)
+      (return (SCM_OBJ ctx)))])
+
+ (define-cclass <xxh3-context> :private
+   ScmXXH3Context* "Scm_XXH3ContextClass" ()
+   ()
+   [allocator
+    (let* ([ctx::ScmXXH3Context* (SCM_NEW_INSTANCE ScmXXH3Context klass)])
+      (Scm_XXH3Init (& (-> ctx st)) 0)
+      (return (SCM_OBJ ctx)))])
+
+ (define-cproc %xxh64-init (seed) ::<xxh64-context>
+   (let* ([ctx::ScmXXH64Context* (SCM_NEW ScmXXH64Context)])
+     (SCM_SET_CLASS ctx (& Scm_XXH64ContextClass))
+     (Scm_XXH64Init (& (-> ctx st))
+                    (Scm_GetIntegerU64Clamp seed SCM_CLAMP_ERROR NULL))
+     (return ctx)))
+ (define-cproc %xxh64-update (ctx::<xxh64-context> data) ::<void>
+   (let* ([len::size_t 0] [p::(const void*) (get-bytes data (& len))])
+     (Scm_XXH64Update (& (-> ctx st)) p len)))
+ (define-cproc %xxh64-final (ctx::<xxh64-context>)
+   (return (make-digest (Scm_XXH64Digest (& (-> ctx st))))))
+
+ (define-cproc %xxh3-init (seed) ::<xxh3-context>
+   (let* ([ctx::ScmXXH3Context* (SCM_NEW ScmXXH3Context)])
+     (SCM_SET_CLASS ctx (& Scm_XXH3ContextClass))
+     (Scm_XXH3Init (& (-> ctx st))
+                   (Scm_GetIntegerU64Clamp seed SCM_CLAMP_ERROR NULL))
+     (return ctx)))
+ (define-cproc %xxh3-update (ctx::<xxh3-context> data) ::<void>
+   (let* ([len::size_t 0] [p::(const void*) (get-bytes data (& len))])
+     (Scm_XXH3Update (& (-> ctx st)) p len)))
+ (define-cproc %xxh3-final (ctx::<xxh3-context>)
+   (return (make-digest (Scm_XXH3Digest (& (-> ctx st))))))
+
+ ;; One-shot hashing; returns the hash value as an exact integer.
+ (define-cproc xxhash64 (data :optional (seed 0))
+   (let* ([len::size_t 0] [p::(const void*) (get-bytes data (& len))])
+     (return (Scm_MakeIntegerU64
+              (Scm_XXH64 p len (Scm_GetIntegerU64Clamp seed SCM_CLAMP_ERROR
+                                                       NULL))))))
+ (define-cproc xxh3 (data :optional (seed 0))
+   (let* ([len::size_t 0] [p::(const void*) (get-bytes data (& len))])
+     (return (Scm_MakeIntegerU64
+              (Scm_XXH3 p len (Scm_GetIntegerU64Clamp seed SCM_CLAMP_ERROR
+                                                      NULL))))))
+ )
@@ -333,6 +333,28 @@
                                                     files))))))
        )
 
+(let ([read-all (^g (let loop ([r '()])
+                      (let1 e (g)
+                        (if (eof-object? e) r (loop (cons e r))))))])
+  (test* "directory-entry-generator"
+         (directory-list "test.out" :children? #t)
+         (sort (read-all (directory-entry-generator "test.out"))))
+  (test* "directory-entry-generator :with-type?" '(#t #t)
+         (let1 es (read-all (directory-entry-generator "test.out"
+                                                       :with-type? #t))
+           (list (boolean (memq (cdr (assoc "test.d" es)) '(directory #f)))
+                 (boolean (memq (cdr (assoc "test1.o" es)) '(regular #f))))))
+  (test* "directory-entry-generator (exhausted)" '(#t #t)
+         (let* ([g (directory-entry-generator "test.out")]
+                [es (read-all g)])
+           (list (pair? es) (eof-object? (g))))))
+
+(test* "directory-fold :folder"
+       (sort (directory-fold "test.out" cons '()))
+       (sort (directory-fold "test.out" cons '()
+                             :folder (^[proc seed lis]
+                                       (fold proc seed lis)))))
+
 (cmd-rmrf "test.out")
 
 ;;=====================================================================
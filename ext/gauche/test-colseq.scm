@@ -292,6 +292,60 @@
 (test* "partition-to (vector)" '(#(2 4 6) #(1 3 5 7))
        (values->list (partition-to <vector> even? '#(1 2 3 4 5 6 7))))
 
+(test-section "chunk iteration")
+
+;; A collection that only hands out its elements in chunks of three.
+(define-class <chunk-coll> (<collection>)
+  ((elements :init-keyword :elements)))
+
+(define-method call-with-chunk-iterator ((coll <chunk-coll>) proc
+                                         :allow-other-keys)
+  (let ([v (slot-ref coll 'elements)]
+        [buf (make-vector 3)]
+        [i 0])
+    (proc (^[] (let1 n (min 3 (- (vector-length v) i))
+                 (if (zero? n)
+                   (values #f 0 0)
+                   (begin (vector-copy! buf 0 v i (+ i n))
+                          (inc! i n)
+                          (values buf 0 n))))))))
+
+(define-method size-of ((coll <chunk-coll>))
+  (vector-length (slot-ref coll 'elements)))
+
+(define (cc . elts) (make <chunk-coll> :elements (list->vector elts)))
+
+(test* "fold (chunk)" '(7 6 5 4 3 2 1)
+       (fold cons '() (cc 1 2 3 4 5 6 7)))
+(test* "fold2 (chunk)" '(28 (7 6 5 4 3 2 1))
+       (values->list (fold2 (^[e s l] (values (+ e s) (cons e l)))
+                            0 '() (cc 1 2 3 4 5 6 7))))
+(test* "map (chunk)" '(2 4 6 8 10)
+       (map (cut * 2 <>) (cc 1 2 3 4 5)))
+(test* "map-to (chunk)" '#(2 4 6 8 10)
+       (map-to <vector> (cut * 2 <>) (cc 1 2 3 4 5)))
+(test* "for-each (chunk)" '(5 4 3 2 1)
+       (rlet1 r '() (for-each (^e (push! r e)) (cc 1 2 3 4 5))))
+(test* "find (chunk)" 5 (find (cut < 4 <>) (cc 1 2 3 4 5 6)))
+(test* "find (chunk)" #f (find (cut < 6 <>) (cc 1 2 3 4 5 6)))
+(test* "filter (chunk)" '(2 4 6) (filter even? (cc 1 2 3 4 5 6 7)))
+(test* "remove-to (chunk)" '#(1 3 5 7)
+       (remove-to <vector> even? (cc 1 2 3 4 5 6 7)))
+(test* "coerce-to (chunk)" "abcd" (coerce-to <string> (cc #\a #\b #\c #\d)))
+
+(let ([lis (iota 1000)]
+      [str (string-tabulate (^i (integer->char (+ 65 (modulo i 26)))) 1000)])
+  (test* "fold (long list)" (reverse lis)
+         (fold cons '() (coerce-to <vector> lis)))
+  (test* "map-to (long list)" (list->vector lis)
+         (map-to <vector> identity lis))
+  (test* "map-to (long string)" str
+         (map-to <string> char-upcase (string-downcase str)))
+  (test* "find (long string)" #\Z
+         (find (cut char=? #\Z <>) str))
+  (test* "coerce-to (long string)" (string->list str)
+         (vector->list (coerce-to <vector> str))))
+
 (test-section "miscellaneous")
 
 (test* "size-of (list)"   5 (size-of '(1 2 3 4 5)))
@@ -393,6 +447,12 @@
        (subseq '#(1 2 3 4 5) 2))
 (test* "subseq (vector)" '#(3 4)
        (subseq '#(1 2 3 4 5) 2 4))
+(test* "subseq (vector)" '#(2 3 4)
+       (subseq '#(1 2 3 4 5) 1 -1))
+(test* "subseq (string)" "cd"
+       (subseq "abcde" 2 4))
+(test* "subseq (string)" "bcd"
+       (subseq "abcde" 1 -1))
 (test* "subseq (vector)" '#(1 2 3 4)
        (subseq '#(1 2 3 4 5) 0 -1))
 (test* "subseq (string)" "345"
@@ -105,6 +105,37 @@
   (t file->line-generator '("ab" "cd" "ef") "ab\ncd\nef")
   (t file->byte-generator '(97 98 99 100 101) "abcde"))
 
+;; native sources
+(test* "uvector->generator" '(1 2 3 4 5)
+       (generator->list (uvector->generator '#u8(1 2 3 4 5))))
+(test* "uvector->generator (1,_)" '(2 3 4 5)
+       (generator->list (uvector->generator '#u8(1 2 3 4 5) 1)))
+(test* "uvector->generator (1,3)" '(-2 -3)
+       (generator->list (uvector->generator '#s16(-1 -2 -3 -4) 1 3)))
+(test* "uvector->generator (f64)" '(1.0 2.5 -0.5)
+       (generator->list (uvector->generator '#f64(1.0 2.5 -0.5))))
+(test* "giota (empty)" '() (generator->list (giota 0)))
+(test* "giota (bignum boundary)"
+       (list (greatest-fixnum) (+ (greatest-fixnum) 1))
+       (generator->list (giota 2 (greatest-fixnum))))
+(test* "grange (inexact end)" '(0 3 6 9)
+       (generator->list (grange 0 10.0 3)))
+(test* "grange (empty)" '() (generator->list (grange 5 3)))
+(test* "grange (negative step)" '(5 3 1)
+       (generator->list (grange 5 0 -2) 3))
+(test* "port->line-generator doesn't read ahead" '("a" "b" "c")
+       (let* ([p (open-input-string "a\nb\nc\n")]
+              [g (port->line-generator p)]
+              [a (g)])
+         (list a (read-line p) (g))))
+(test* "file->line-generator (many lines)" (map number->string (iota 200))
+       (unwind-protect
+           (begin
+             (with-output-to-file "test.o"
+               (^[] (dotimes [i 200] (print i))))
+             (generator->list (file->line-generator "test.o")))
+         (sys-unlink "test.o")))
+
 (test* "circular-generator" '(0 1 2 0 1 2 0 1 2 0)
        (generator->list (circular-generator 0 1 2) 10))
 
@@ -280,6 +311,51 @@
                 (cut slices <> 3 #t 'z)
                 '(1 2 3 4 5 6 7 8 9) '(1 2 3 4) '(1)  '())
 
+;; gpipeline should behave the same as the chained operations.
+(let ()
+  (define (t name expect thunk)
+    (test* (format "gpipeline ~a" name) expect (generator->list (thunk))))
+  (t "map/filter" '(1 9 25 49 81)
+     (^[] (gpipeline (giota 10) :map (^x (* x x)) :filter odd?)))
+  (t "filter/map" '(1 9 25 49 81)
+     (^[] (gpipeline (giota 10) :filter odd? :map (^x (* x x)))))
+  (t "remove/filter-map" '(b d)
+     (^[] (gpipeline '((1 . a) (2 . b) (3 . c) (4 . d) (5 . #f) (6 . #f))
+                     :remove (^p (odd? (car p)))
+                     :filter-map cdr)))
+  (t "take" '(0 2 4)
+     (^[] (gpipeline (giota) :filter even? :take 3)))
+  (t "take 0" '() (^[] (gpipeline (giota) :take 0)))
+  (t "drop/take" '(3 4 5)
+     (^[] (gpipeline (giota 10) :drop 3 :take 3)))
+  (t "take/drop" '(3 4)
+     (^[] (gpipeline (giota 10) :take 5 :drop 3)))
+  (t "take-while/drop-while" '(2 3 4)
+     (^[] (gpipeline (giota 10) :drop-while (cut < <> 2)
+                     :take-while (cut < <> 5))))
+  (t "drop-while only drops the prefix" '(3 0 1)
+     (^[] (gpipeline '(0 1 2 3 0 1) :drop-while (cut < <> 3))))
+  (t "no stages" '(a b c) (^[] (gpipeline '(a b c))))
+  (t "string source" '(#\A #\C)
+     (^[] (gpipeline "abc" :remove (cut char=? <> #\b) :map char-upcase)))
+  (t "many stages"
+     (generator->list ($ gtake (gfilter odd? (gmap (cut + <> 1)
+                                                   (gdrop (gmap (cut * <> 3)
+                                                                (giota 100))
+                                                          5)))
+                         4))
+     (^[] (gpipeline (giota 100) :map (cut * <> 3) :drop 5
+                     :map (cut + <> 1) :filter odd? :take 4)))
+  )
+
+(let ([n 0])
+  (test* "gpipeline doesn't pull after take is satisfied" '((0 1 2) 3)
+         (let* ([src (^[] (rlet1 v n (inc! n)))]
+                [g (gpipeline src :take 3)]
+                [r (generator->list g)])
+           (g)
+           (list r n))))
+
 (test* "gstate-filter"
        '(1 2 3 1 2 3 1 2 3)
        (generator->list
@@ -46,6 +46,13 @@
   (test-eager-lazy "lslices" lslices slices '(1 2 3 4 5 6 7) 2 #t 'z)
   )
 
+(test* "lpipeline" '(1 9 25)
+       (lpipeline (lrange 0) :map (^x (* x x)) :filter odd? :take 3))
+(test* "lpipeline (vector)" '(b c)
+       (lpipeline '#(a b c d) :drop 1 :take 2))
+(test* "lazyness - lpipeline" 0
+       (list-ref (lpipeline '(1 2 3 4 0) :map (^x (quotient 1 x))) 2))
+
 (test* "lazyness - coercion" '(1 2 3 4 5)
        (lmap identity '#(1 2 3 4 5)))
 (test* "lazyness - coercion" '(#\a #\b #\c #\d #\e)
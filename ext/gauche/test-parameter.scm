@@ -180,6 +180,42 @@
            (when (< (length r) 4) (cc cc))
            (reverse r))))
 
+;;-------------------------------------------------------------------
+(test-section "shallow binding")
+
+;; Parameters without filter and observers are parameterized by
+;; swapping the value directly.  Make sure it behaves the same.
+
+(test* "multiple values" '(1 2 3)
+       (let1 p (make-parameter 0)
+         (receive r (parameterize ([p 1]) (values (p) 2 3)) r)))
+
+(test* "same parameter twice" '(2 0)
+       (let1 p (make-parameter 0)
+         (let1 v (parameterize ([p 1] [p 2]) (p))
+           (list v (p)))))
+
+(test* "restored on error" '(0 0)
+       (let ([p (make-parameter 0)]
+             [q (make-parameter 0)])
+         (guard [e (else (list (p) (q)))]
+           (parameterize ([p 1] [q 2])
+             (error "boo")))))
+
+(test* "mixed with filtered parameter" '((1 "2") (0 "0"))
+       (let ([p (make-parameter 0)]
+             [q (make-parameter 0 x->string)])
+         (let1 v (parameterize ([p 1] [q 2]) (list (p) (q)))
+           (list v (list (p) (q))))))
+
+(test* "observers added later" '((post 0 1) (post 1 0) 0)
+       (let ([p (make-parameter 0)]
+             [r '()])
+         (parameterize ([p 5]) (p))
+         (parameter-observer-add! p (^[o v] (push! r `(post ,o ,v))) 'after)
+         (parameterize ([p 1]) (p))
+         (reverse (cons (p) r))))
+
 ;; Note: ext/threads has extra tests for parameter/thread cooperation.
 
 (test-end)
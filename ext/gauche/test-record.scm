@@ -331,5 +331,57 @@
 (pseudo-record-test <f32vector> f32vector)
 (pseudo-record-test <f64vector> f64vector)
 
+(test-section "packed record")
+
+(define-record-type particle #t #t
+  (id   particle-id   :type u8)
+  (mass particle-mass set-particle-mass! :type f64)
+  (n    particle-n    set-particle-n!    :type fixnum)
+  (s    particle-s    :type s16))
+
+(test* "packed-rtd?" #t (packed-rtd? particle))
+(test* "instance is a u8vector" '(#t 32)
+       (let1 p (make-particle 3 1.5 -7 -2)
+         (list (u8vector? p) (u8vector-length p))))
+(test* "accessors" '(3 1.5 -7 -2)
+       (let1 p (make-particle 3 1.5 -7 -2)
+         (list (particle-id p) (particle-mass p) (particle-n p)
+               (particle-s p))))
+(test* "mutators" '(2.25 100)
+       (let1 p (make-particle 3 1.5 -7 -2)
+         (set-particle-mass! p 2.25)
+         (set! (particle-n p) 100)
+         (list (particle-mass p) (particle-n p))))
+(test* "predicate" '(#t #f #f)
+       (list (particle? (make-particle 0 0.0 0 0))
+             (particle? (make-u8vector 8 0))
+             (particle? (make-vector 24 0))))
+(test* "wrong arity" (test-error)
+       (make-particle 1 2.0))
+(test* "untyped field" (test-error)
+       (eval '(define-record-type bad #t #t (x bad-x :type u8) (y bad-y))
+             (current-module)))
+
+(test* "record vector" '(10 (0 1.0 0) (9 10.0 -9))
+       (let1 rv (make-record-vector particle 10)
+         (dotimes [i 10]
+           (record-vector-set! rv i (make-particle i (+ i 1.0) (- i) 0)))
+         (list (record-vector-length rv)
+               (let1 p (record-vector-ref rv 0)
+                 (list (particle-id p) (particle-mass p) (particle-n p)))
+               (let1 p (record-vector-ref rv 9)
+                 (list (particle-id p) (particle-mass p) (particle-n p))))))
+(test* "record vector columns" '(#t 6.0 #f64(1.0 2.0 10.0))
+       (let ([rv (make-record-vector particle 3)]
+             [mass (rtd-column-accessor particle 'mass)])
+         (set! (mass rv 0) 1.0)
+         ((rtd-column-mutator particle 'mass) rv 1 2.0)
+         (set! (mass rv 2) 3.0)
+         (let1 col (record-vector-column rv 'mass)
+           (f64vector-set! col 2 10.0)
+           (list (f64vector? col) (+ (mass rv 0) (mass rv 1) 3.0) col))))
+(test* "immutable column" (test-error)
+       (rtd-column-mutator particle 'id))
+
 
 (test-end)
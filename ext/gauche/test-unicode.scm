@@ -235,4 +235,20 @@
 (test* "string-titlecase" "Stra\u00dfe" (string-titlecase "stra\u00dfe"))
 (test* "string-foldcase" "strasse" (string-foldcase "stra\u00dfe"))
 
+;; strings that don't change
+(test* "string-downcase (unchanged)" '("abc, def" #f)
+       (let* ([s (string-copy "abc, def")]
+              [r (string-downcase s)])
+         (list r (eq? r s))))
+(test* "string-upcase (unchanged)" "ABC"
+       (let* ([s (string-copy "ABC")]
+              [r (string-upcase s)])
+         (string-set! s 0 #\X)
+         r))
+(when (memq (gauche-character-encoding) '(utf-8 euc-jp sjis))
+  (test* "string-foldcase (unchanged)" "χαοσ" (string-foldcase "χαοσ"))
+  (test* "string-foldcase (final sigma)" "χαοσ" (string-foldcase "χαος"))
+  (test* "string-downcase (final sigma)" "χαος" (string-downcase "χαος"))
+  (test* "string-upcase (unchanged)" "ΧΑΟΣ" (string-upcase "ΧΑΟΣ")))
+
 (test-end)
@@ -876,6 +876,65 @@
        )))
 
  (define-enum SCM_CHAR_FULL_CASE_MAPPING_SIZE)
+
+ ;; Quick check.  Most strings passed to string-upcase etc. don't
+ ;; change at all (e.g. downcasing already lowercase text), so we scan
+ ;; the string first and return it as is in such case.
+ "#define CHAR_FOLDCASE 3"
+ (define-enum CHAR_FOLDCASE)
+
+ ;; Returns the result of a case mapping if it is a single character,
+ ;; -1 otherwise.
+ (define-cfn xcase-single (ucs::ScmChar full::(const ScmChar*) simple::int)
+   ::ScmChar :static
+   (cond [(== (aref full 0) -1) (return (+ ucs simple))]
+         [(== (aref full 1) -1) (return (aref full 0))]
+         [else (return -1)]))
+
+ (define-cfn xcase-identity-p (ucs::ScmChar kind::int) ::int :static
+   (let* ([cm::ScmCharCaseMap]
+          [pcm::(const ScmCharCaseMap*) (Scm__CharCaseMap ucs (& cm) TRUE)])
+     (case kind
+       [(CHAR_UPCASE)
+        (return (== (xcase-single ucs (-> pcm to_upper_full)
+                                  (-> pcm to_upper_simple))
+                    ucs))]
+       [(CHAR_DOWNCASE)
+        (return (== (xcase-single ucs (-> pcm to_lower_full)
+                                  (-> pcm to_lower_simple))
+                    ucs))]
+       [else                            ;CHAR_FOLDCASE
+        (let* ([u::ScmChar (xcase-single ucs (-> pcm to_upper_full)
+                                         (-> pcm to_upper_simple))]
+               [cm2::ScmCharCaseMap])
+          (when (< u 0) (return FALSE))
+          (set! pcm (Scm__CharCaseMap u (& cm2) TRUE))
+          (return (== (xcase-single u (-> pcm to_lower_full)
+                                    (-> pcm to_lower_simple))
+                      ucs)))])))
+
+ (define-cproc %string-xcase-identity? (str::<string> kind::<int>)
+   ::<boolean>
+   (let* ([b::(const ScmStringBody*) (SCM_STRING_BODY str)]
+          [p::(const char*) (SCM_STRING_BODY_START b)]
+          [e::(const char*) (+ p (SCM_STRING_BODY_SIZE b))])
+     (when (SCM_STRING_BODY_INCOMPLETE_P b) (return FALSE))
+     (while (< p e)
+       (let* ([u::u_char (cast u_char (aref p 0))])
+         (cond
+          [(< u #x80)
+           (if (== kind CHAR_UPCASE)
+             (when (and (<= #\a u) (<= u #\z)) (return FALSE))
+             (when (and (<= #\A u) (<= u #\Z)) (return FALSE)))
+           (post++ p)]
+          [else
+           (let* ([ch::ScmChar] [ucs::ScmChar])
+             (SCM_CHAR_GET p ch)
+             (+= p (+ (SCM_CHAR_NFOLLOWS u) 1))
+             (set! ucs (Scm_CharToUcs ch))
+             (when (and (>= ucs 0) (not (xcase-identity-p ucs kind)))
+               (return FALSE)))])))
+     (return TRUE)))
  )
 
 ;; Common args in the following routines
@@ -974,10 +1033,17 @@
     (get)))
 
 ;; APIs
-(define (string-upcase str)    (string-xcase str %upcase))
-(define (string-downcase str)  (string-xcase str %downcase))
+(define-syntax string-xcase/quick
+  (syntax-rules ()
+    [(_ str kind doer)
+     (if (%string-xcase-identity? str kind)
+       (string-copy str)              ;cheap; the body is shared
+       (string-xcase str doer))]))
+
+(define (string-upcase str)    (string-xcase/quick str CHAR_UPCASE %upcase))
+(define (string-downcase str)  (string-xcase/quick str CHAR_DOWNCASE %downcase))
 (define (string-titlecase str) (string-xcase str %titlecase))
-(define (string-foldcase str)  (string-xcase str %foldcase))
+(define (string-foldcase str)  (string-xcase/quick str CHAR_FOLDCASE %foldcase))
 
 (define (codepoints-upcase seq)    (codepoints-xcase seq %upcase))
 (define (codepoints-downcase seq)  (codepoints-xcase seq %downcase))
@@ -0,0 +1,368 @@
+/*
+ * gauche-lz4.c - lz4 compression for rfc.lz4
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "gauche-lz4.h"
+#include <gauche/class.h>
+
+#define DEFAULT_BUFFER_SIZE 65536
+#define MINIMUM_BUFFER_SIZE 1024
+
+/*================================================================
+ * Class stuff
+ */
+
+static ScmClass *port_cpl[] = {
+    SCM_CLASS_STATIC_PTR(Scm_PortClass),
+    SCM_CLASS_STATIC_PTR(Scm_TopClass),
+    NULL
+};
+
+SCM_DEFINE_BASE_CLASS(Scm_Lz4CompressingPortClass,
+                      ScmPort, /* instance type */
+                      NULL, NULL, NULL, NULL, port_cpl);
+
+SCM_DEFINE_BASE_CLASS(Scm_Lz4DecompressingPortClass,
+                      ScmPort, /* instance type */
+                      NULL, NULL, NULL, NULL, port_cpl);
+
+static ScmModule *lz4_module = NULL;
+
+/*================================================================
+ * Common
+ */
+
+/* Raises <lz4-error>, which is defined in lz4.scm. */
+static void lz4_error(const char *msg, ...)
+{
+    static ScmObj lz4_error_class = SCM_UNDEFINED;
+    va_list args;
+
+    SCM_BIND_PROC(lz4_error_class, "<lz4-error>", lz4_module);
+    ScmObj ostr = Scm_MakeOutputStringPort(TRUE);
+    va_start(args, msg);
+    Scm_Vprintf(SCM_PORT(ostr), msg, args, TRUE);
+    va_end(args);
+    Scm_RaiseCondition(lz4_error_class, SCM_RAISE_CONDITION_MESSAGE,
+                       "%A", Scm_GetOutputString(SCM_PORT(ostr), 0));
+}
+
+static void check_result(size_t r, const char *what)
+{
+    if (LZ4F_isError(r)) lz4_error("%s: %s", what, LZ4F_getErrorName(r));
+}
+
+static int fix_buffer_size(int siz)
+{
+    if (siz <= 0) return DEFAULT_BUFFER_SIZE;
+    if (siz <= MINIMUM_BUFFER_SIZE) return MINIMUM_BUFFER_SIZE;
+    return siz;
+}
+
+static ScmObj port_name(const char *type, ScmPort *source)
+{
+    ScmObj out = Scm_MakeOutputStringPort(TRUE);
+    Scm_Printf(SCM_PORT(out), "[%s %A]",
+               type, Scm_PortName(source));
+    return Scm_GetOutputStringUnsafe(SCM_PORT(out), 0);
+}
+
+static int lz4_fileno(ScmPort *port)
+{
+    return Scm_PortFileNo(SCM_PORT_LZ4_INFO(port)->remote);
+}
+
+static void init_prefs(LZ4F_preferences_t *prefs, int level)
+{
+    memset(prefs, 0, sizeof(LZ4F_preferences_t));
+    prefs->compressionLevel = level;
+    prefs->frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+}
+
+/*================================================================
+ * Compressing port
+ */
+
+/* Writes out the frame header if we haven't. */
+static void compress_begin(ScmLz4Info *info)
+{
+    if (info->started) return;
+    size_t r = LZ4F_compressBegin(info->cctx, info->buf, info->bufsiz,
+                                  &info->prefs);
+    check_result(r, "compression failed");
+    Scm_Putz(info->buf, r, info->remote);
+    info->started = TRUE;
+}
+
+static int compress_flusher(ScmPort *port, int cnt, int forcep)
+{
+    ScmLz4Info *info = SCM_PORT_LZ4_INFO(port);
+    int avail = SCM_PORT_BUFFER_AVAIL(port);
+
+    compress_begin(info);
+    /* The buffer is sized so that a buffer full of data always fits. */
+    size_t r = LZ4F_compressUpdate(info->cctx, info->buf, info->bufsiz,
+                                   port->src.buf.buffer, avail, NULL);
+    check_result(r, "compression failed");
+    if (r > 0) Scm_Putz(info->buf, r, info->remote);
+    if (forcep) {
+        r = LZ4F_flush(info->cctx, info->buf, info->bufsiz, NULL);
+        check_result(r, "compression failed");
+        if (r > 0) Scm_Putz(info->buf, r, info->remote);
+    }
+    return avail;
+}
+
+static void compress_closer(ScmPort *port)
+{
+    ScmLz4Info *info = SCM_PORT_LZ4_INFO(port);
+
+    if (info->cctx == NULL) return;
+    compress_begin(info);
+    size_t r = LZ4F_compressEnd(info->cctx, info->buf, info->bufsiz, NULL);
+    LZ4F_freeCompressionContext(info->cctx);
+    info->cctx = NULL;
+    check_result(r, "compression failed");
+    Scm_Putz(info->buf, r, info->remote);
+    Scm_Flush(info->remote);
+    if (info->ownerp) {
+        Scm_ClosePort(info->remote);
+    }
+}
+
+ScmObj Scm_MakeLz4CompressingPort(ScmPort *drain, int level,
+                                  int bufsiz, int ownerp)
+{
+    ScmLz4Info *info = SCM_NEW(ScmLz4Info);
+
+    bufsiz = fix_buffer_size(bufsiz);
+    size_t r = LZ4F_createCompressionContext(&info->cctx, LZ4F_VERSION);
+    check_result(r, "couldn't create a compression context");
+
+    init_prefs(&info->prefs, level);
+    info->remote = drain;
+    info->ownerp = ownerp;
+    info->dctx = NULL;
+    info->started = FALSE;
+    info->bufsiz = LZ4F_compressBound(bufsiz, &info->prefs)
+        + LZ4F_HEADER_SIZE_MAX;
+    info->buf = SCM_NEW_ATOMIC2(char*, info->bufsiz);
+    info->inpos = info->inlen = 0;
+    info->hint = 0;
+    info->stream_endp = FALSE;
+
+    ScmPortBuffer bufrec;
+    memset(&bufrec, 0, sizeof(bufrec));
+    bufrec.size = bufsiz;
+    bufrec.buffer = SCM_NEW_ATOMIC2(char *, bufsiz);
+    bufrec.mode = SCM_PORT_BUFFER_FULL;
+    bufrec.filler = NULL;
+    bufrec.flusher = compress_flusher;
+    bufrec.closer = compress_closer;
+    bufrec.ready = NULL;
+    bufrec.filenum = lz4_fileno;
+    bufrec.data = (void*)info;
+
+    ScmObj name = port_name("lz4 compressing", drain);
+    return Scm_MakeBufferedPort(SCM_CLASS_LZ4_COMPRESSING_PORT, name,
+                                SCM_PORT_OUTPUT, TRUE, &bufrec);
+}
+
+/*================================================================
+ * Decompressing port
+ */
+
+static int decompress_filler(ScmPort *port, int mincnt)
+{
+    ScmLz4Info *info = SCM_PORT_LZ4_INFO(port);
+    char *outbuf = port->src.buf.end;
+    size_t room = SCM_PORT_BUFFER_ROOM(port);
+    size_t outlen = 0;
+
+    while (outlen == 0) {
+        if (info->inpos == info->inlen) {
+            if (info->stream_endp) break;
+            int nread = Scm_Getz(info->buf, info->bufsiz, info->remote);
+            if (nread <= 0) {
+                /* input reached EOF */
+                info->stream_endp = TRUE;
+                if (info->hint != 0) {
+                    info->hint = 0;
+                    lz4_error("truncated input from %S", info->remote);
+                }
+                break;
+            }
+            info->inpos = 0;
+            info->inlen = nread;
+        }
+        size_t dsiz = room;
+        size_t ssiz = info->inlen - info->inpos;
+        size_t r = LZ4F_decompress(info->dctx, outbuf, &dsiz,
+                                   info->buf + info->inpos, &ssiz, NULL);
+        info->inpos += ssiz;
+        if (LZ4F_isError(r)) {
+            /* Don't try to recover. */
+            info->stream_endp = TRUE;
+            info->inpos = info->inlen;
+            info->hint = 0;
+            check_result(r, "decompression failed");
+        }
+        info->hint = r;
+        outlen = dsiz;
+    }
+    return outlen;
+}
+
+static void decompress_closer(ScmPort *port)
+{
+    ScmLz4Info *info = SCM_PORT_LZ4_INFO(port);
+    if (info->dctx) {
+        LZ4F_freeDecompressionContext(info->dctx);
+        info->dctx = NULL;
+    }
+    if (info->ownerp) {
+        Scm_ClosePort(info->remote);
+    }
+}
+
+static int decompress_ready(ScmPort *port)
+{
+    ScmLz4Info *info = SCM_PORT_LZ4_INFO(port);
+    if (info->inpos < info->inlen) return SCM_FD_READY;
+    return Scm_ByteReady(info->remote);
+}
+
+ScmObj Scm_MakeLz4DecompressingPort(ScmPort *source, int bufsiz, int ownerp)
+{
+    ScmLz4Info *info = SCM_NEW(ScmLz4Info);
+
+    bufsiz = fix_buffer_size(bufsiz);
+    size_t r = LZ4F_createDecompressionContext(&info->dctx, LZ4F_VERSION);
+    check_result(r, "couldn't create a decompression context");
+
+    info->remote = source;
+    info->ownerp = ownerp;
+    info->cctx = NULL;
+    info->started = FALSE;
+    info->bufsiz = bufsiz;
+    info->buf = SCM_NEW_ATOMIC2(char*, info->bufsiz);
+    info->inpos = info->inlen = 0;
+    info->hint = 0;
+    info->stream_endp = FALSE;
+
+    ScmPortBuffer bufrec;
+    memset(&bufrec, 0, sizeof(bufrec));
+    bufrec.size = bufsiz;
+    bufrec.buffer = SCM_NEW_ATOMIC2(char *, bufsiz);
+    bufrec.mode = SCM_PORT_BUFFER_FULL;
+    bufrec.filler = decompress_filler;
+    bufrec.flusher = NULL;
+    bufrec.closer = decompress_closer;
+    bufrec.ready = decompress_ready;
+    bufrec.filenum = lz4_fileno;
+    bufrec.data = (void*)info;
+
+    ScmObj name = port_name("lz4 decompressing", source);
+    return Scm_MakeBufferedPort(SCM_CLASS_LZ4_DECOMPRESSING_PORT, name,
+                                SCM_PORT_INPUT, TRUE, &bufrec);
+}
+
+/*================================================================
+ * One-shot compression
+ */
+
+ScmObj Scm_Lz4Compress(const unsigned char *src, size_t size, int level)
+{
+    LZ4F_preferences_t prefs;
+    init_prefs(&prefs, level);
+    prefs.frameInfo.contentSize = size;
+    size_t bound = LZ4F_compressFrameBound(size, &prefs);
+    unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*, bound);
+    size_t r = LZ4F_compressFrame(buf, bound, src, size, &prefs);
+    check_result(r, "compression failed");
+    return Scm_MakeU8VectorFromArrayShared(r, buf);
+}
+
+ScmObj Scm_Lz4Decompress(const unsigned char *src, size_t size)
+{
+    if (size == 0) return Scm_MakeU8Vector(0, 0);
+
+    LZ4F_dctx *d;
+    size_t r = LZ4F_createDecompressionContext(&d, LZ4F_VERSION);
+    check_result(r, "couldn't create a decompression context");
+
+    size_t bufsiz = (size < 64)? 256 : size * 4;
+    unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*, bufsiz);
+    size_t inpos = 0, outpos = 0;
+
+    for (;;) {
+        size_t dsiz = bufsiz - outpos;
+        size_t ssiz = size - inpos;
+        r = LZ4F_decompress(d, buf + outpos, &dsiz, src + inpos, &ssiz, NULL);
+        if (LZ4F_isError(r)) {
+            LZ4F_freeDecompressionContext(d);
+            check_result(r, "decompression failed");
+        }
+        inpos += ssiz;
+        outpos += dsiz;
+        if (inpos == size && (r == 0 || outpos < bufsiz)) break;
+        if (outpos == bufsiz) {
+            /* The decoder may have more output. */
+            if (bufsiz >= (size_t)SCM_SMALL_INT_MAX/2) {
+                LZ4F_freeDecompressionContext(d);
+                lz4_error("decompressed data too big");
+            }
+            unsigned char *nbuf = SCM_NEW_ATOMIC2(unsigned char*, bufsiz*2);
+            memcpy(nbuf, buf, outpos);
+            buf = nbuf;
+            bufsiz *= 2;
+        }
+    }
+    LZ4F_freeDecompressionContext(d);
+    if (r != 0) lz4_error("truncated input");
+    return Scm_MakeU8VectorFromArrayShared(outpos, buf);
+}
+
+/*
+ * Module initialization function.
+ */
+void Scm_Init_lz4(void)
+{
+    ScmModule *mod = SCM_MODULE(SCM_FIND_MODULE("rfc.lz4", TRUE));
+    lz4_module = mod;
+
+    Scm_InitStaticClass(&Scm_Lz4CompressingPortClass,
+                        "<lz4-compressing-port>", mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_Lz4DecompressingPortClass,
+                        "<lz4-decompressing-port>", mod, NULL, 0);
+}
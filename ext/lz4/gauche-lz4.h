@@ -0,0 +1,84 @@
+/*
+ * gauche-lz4.h - lz4 module
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_LZ4_H
+#define GAUCHE_LZ4_H
+
+#include <gauche.h>
+#include <gauche/extend.h>
+#include <lz4.h>
+#include <lz4frame.h>
+
+SCM_DECL_BEGIN
+
+typedef struct ScmLz4InfoRec {
+    ScmPort *remote;            /* source or drain port */
+    int ownerp;
+    LZ4F_cctx *cctx;            /* compressing port */
+    LZ4F_dctx *dctx;            /* decompressing port */
+    LZ4F_preferences_t prefs;
+    int started;                /* compressing: frame header written */
+    char *buf;                  /* compressed data */
+    size_t bufsiz;
+    size_t inpos;               /* decompressing: buf[inpos..inlen) is */
+    size_t inlen;               /*   the input not consumed yet. */
+    size_t hint;                /* nonzero while in the middle of a frame */
+    int stream_endp;
+} ScmLz4Info;
+
+#define SCM_PORT_LZ4_INFO(p) ((ScmLz4Info*)(p)->src.buf.data)
+
+SCM_CLASS_DECL(Scm_Lz4CompressingPortClass);
+#define SCM_CLASS_LZ4_COMPRESSING_PORT  (&Scm_Lz4CompressingPortClass)
+#define SCM_LZ4_COMPRESSING_PORT_P(obj) \
+    SCM_ISA(obj, SCM_CLASS_LZ4_COMPRESSING_PORT)
+SCM_CLASS_DECL(Scm_Lz4DecompressingPortClass);
+#define SCM_CLASS_LZ4_DECOMPRESSING_PORT  (&Scm_Lz4DecompressingPortClass)
+#define SCM_LZ4_DECOMPRESSING_PORT_P(obj) \
+    SCM_ISA(obj, SCM_CLASS_LZ4_DECOMPRESSING_PORT)
+
+extern ScmObj Scm_MakeLz4CompressingPort(ScmPort *drain, int level,
+                                         int bufsiz, int ownerp);
+extern ScmObj Scm_MakeLz4DecompressingPort(ScmPort *source,
+                                           int bufsiz, int ownerp);
+
+extern ScmObj Scm_Lz4Compress(const unsigned char *src, size_t size,
+                              int level);
+extern ScmObj Scm_Lz4Decompress(const unsigned char *src, size_t size);
+
+extern void Scm_Init_lz4(void);
+
+SCM_DECL_END
+
+#endif /* GAUCHE_LZ4_H */
@@ -0,0 +1,114 @@
+;;;
+;;; rfc.lz4 - lz4 compression
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+#!no-fold-case
+
+(define-module rfc.lz4
+  (use gauche.uvector)
+  (export lz4-version
+          <lz4-error>
+          <lz4-compressing-port> <lz4-decompressing-port>
+          open-lz4-compressing-port open-lz4-decompressing-port
+          lz4-compress lz4-decompress
+          lz4-compress-string lz4-decompress-string))
+(select-module rfc.lz4)
+
+(define-condition-type <lz4-error> <error> #f)
+
+(inline-stub
+ (declcode "#include \"gauche-lz4.h\"")
+ (initcode (Scm_Init_lz4))
+
+ (define-type <lz4-compressing-port> "ScmPort*" "lz4 compressing port"
+   "SCM_LZ4_COMPRESSING_PORT_P" "SCM_PORT")
+ (define-type <lz4-decompressing-port> "ScmPort*" "lz4 decompressing port"
+   "SCM_LZ4_DECOMPRESSING_PORT_P" "SCM_PORT")
+
+ ;; DATA can be a u8vector or a string; START and END select the region.
+ (define-cfn data_region (data::ScmObj start::ScmSmallInt end::ScmSmallInt
+                          pstart::(const unsigned char**) psiz::size_t*)
+   ::void :static
+   (cond [(SCM_U8VECTORP data)
+          (set! (* pstart) (SCM_UVECTOR_ELEMENTS (SCM_U8VECTOR data))
+                (* psiz)   (SCM_U8VECTOR_SIZE (SCM_U8VECTOR data)))]
+         [(SCM_STRINGP data)
+          (let* ([b::(const ScmStringBody*) (SCM_STRING_BODY data)])
+            (set! (* pstart) (cast (unsigned char*) (SCM_STRING_BODY_START b))
+                  (* psiz)   (SCM_STRING_BODY_SIZE b)))]
+         [else
+          (Scm_Error "u8vector or string required, but got: %S" data)])
+   (when (< end 0) (set! end (* psiz)))
+   (unless (and (<= 0 start) (<= start end) (<= end (* psiz)))
+     (Scm_Error "start/end out of range: (%ld %ld)" start end))
+   (set! (* pstart) (+ (* pstart) start)
+         (* psiz) (- end start)))
+
+ (define-cproc lz4-version ()
+   (return (SCM_MAKE_STR (LZ4_versionString))))
+
+ (define-cproc open-lz4-compressing-port (drain::<output-port>
+                                          :key (compression-level::<fixnum> 0)
+                                               (buffer-size::<fixnum> 0)
+                                               (owner? #f))
+   (return (Scm_MakeLz4CompressingPort drain compression-level buffer-size
+                                       (not (SCM_FALSEP owner?)))))
+
+ (define-cproc open-lz4-decompressing-port (source::<input-port>
+                                            :key (buffer-size::<fixnum> 0)
+                                                 (owner? #f))
+   (return (Scm_MakeLz4DecompressingPort source buffer-size
+                                         (not (SCM_FALSEP owner?)))))
+
+ (define-cproc lz4-compress (data :key (compression-level::<fixnum> 0)
+                                       (start::<fixnum> 0)
+                                       (end::<fixnum> -1))
+   (let* ([src::(const unsigned char*)]
+          [siz::size_t])
+     (data_region data start end (& src) (& siz))
+     (return (Scm_Lz4Compress src siz compression-level))))
+
+ (define-cproc lz4-decompress (data :key (start::<fixnum> 0)
+                                         (end::<fixnum> -1))
+   (let* ([src::(const unsigned char*)]
+          [siz::size_t])
+     (data_region data start end (& src) (& siz))
+     (return (Scm_Lz4Decompress src siz))))
+ )
+
+;; utility procedures
+(define (lz4-compress-string str . args)
+  (u8vector->string (apply lz4-compress str args)))
+
+(define (lz4-decompress-string str . args)
+  (u8vector->string (apply lz4-decompress str args)))
@@ -0,0 +1,128 @@
+;;;
+;;; Test lz4
+;;;
+
+#!no-fold-case
+
+(use gauche.test)
+(use gauche.uvector)
+(use gauche.process)
+(use file.util)
+
+(test-start "rfc.lz4")
+
+;; bail out if we aren't configured to build lz4
+(unless (file-exists? (string-append "lz4." (gauche-dso-suffix)))
+  (test-end)
+  (exit 0))
+
+(load "./lz4")
+(import rfc.lz4)
+(test-module 'rfc.lz4)
+
+(test* "lz4-version" #t (string? (lz4-version)))
+
+(define *data*
+  (with-output-to-string
+    (^[] (dotimes [i 20000] (write i) (write-char #\space)))))
+
+(define (compress-via-port data . args)
+  (call-with-output-string
+    (^p (let1 p2 (apply open-lz4-compressing-port p args)
+          (display data p2)
+          (close-output-port p2)))))
+
+(define (decompress-via-port data . args)
+  (port->string (apply open-lz4-decompressing-port
+                       (open-input-string data) args)))
+
+;;------------------------------------------------------------------
+(test-section "one-shot")
+
+(test* "lz4-compress / lz4-decompress" (string->u8vector *data*)
+       (lz4-decompress (lz4-compress *data*)))
+(test* "lz4-compress (smaller)" #t
+       (< (u8vector-length (lz4-compress *data*)) (string-size *data*)))
+(test* "lz4-compress (HC level)" (string->u8vector *data*)
+       (lz4-decompress (lz4-compress *data* :compression-level 9)))
+(test* "lz4-compress (start/end)" (string->u8vector *data* 10 100)
+       (lz4-decompress (lz4-compress (string->u8vector *data*)
+                                     :start 10 :end 100)))
+(test* "lz4-compress (range error)" (test-error)
+       (lz4-compress "abc" :end 4))
+(test* "lz4-compress (empty)" '#u8()
+       (lz4-decompress (lz4-compress "")))
+(test* "lz4-decompress (concatenated frames)" (string->u8vector "abcdef")
+       (lz4-decompress (u8vector-append (lz4-compress "abc")
+                                        (lz4-compress "def"))))
+(test* "lz4-decompress (truncated)" (test-error <lz4-error>)
+       (let1 v (lz4-compress *data*)
+         (lz4-decompress v :end (- (u8vector-length v) 5))))
+(test* "lz4-decompress (garbage)" (test-error <lz4-error>)
+       (lz4-decompress (make-u8vector 20 7)))
+(test* "lz4-compress-string / lz4-decompress-string" *data*
+       (lz4-decompress-string (lz4-compress-string *data*)))
+
+;;------------------------------------------------------------------
+(test-section "ports")
+
+(test* "<lz4-compressing-port>" <lz4-compressing-port>
+       (class-of (open-lz4-compressing-port (open-output-string))))
+(test* "<lz4-decompressing-port>" <lz4-decompressing-port>
+       (class-of (open-lz4-decompressing-port (open-input-string ""))))
+
+(test* "port round trip" *data*
+       (decompress-via-port (compress-via-port *data*)))
+(test* "port round trip (small buffer)" *data*
+       (decompress-via-port (compress-via-port *data* :buffer-size 1024)
+                            :buffer-size 1024))
+(test* "port -> one-shot" (string->u8vector *data*)
+       (lz4-decompress (compress-via-port *data* :compression-level 9)))
+(test* "one-shot -> port" *data*
+       (decompress-via-port (u8vector->string (lz4-compress *data*))))
+(test* "empty stream" ""
+       (decompress-via-port (compress-via-port "")))
+
+(test* "flush" '(#t "abcdef")
+       (let* ([out (open-output-string)]
+              [p (open-lz4-compressing-port out)])
+         (display "abc" p)
+         (flush p)
+         (let1 flushed? (> (string-size (get-output-string out)) 0)
+           (display "def" p)
+           (close-output-port p)
+           (list flushed? (decompress-via-port (get-output-string out))))))
+
+(test* "decompressing port (truncated)" (test-error <lz4-error>)
+       (let1 v (string->u8vector (compress-via-port *data*))
+         (decompress-via-port
+          (u8vector->string v 0 (- (u8vector-length v) 5)))))
+
+(test* "owner?" '(#t #f)
+       (map (^[owner?]
+              (let* ([out (open-output-string)]
+                     [p (open-lz4-compressing-port out :owner? owner?)])
+                (close-output-port p)
+                (port-closed? out)))
+            '(#t #f)))
+
+;;------------------------------------------------------------------
+(test-section "interoperability")
+
+(if (find-file-in-paths "lz4")
+  (begin
+    (test* "lz4 command decodes our output" *data*
+           (let1 f "test.o.lz4"
+             (call-with-output-file f
+               (^p (write-uvector (lz4-compress *data*) p)))
+             (begin0 (call-with-input-process `("lz4" "-dc" ,f) port->string)
+               (sys-unlink f))))
+    (test* "we decode lz4 command output" *data*
+           (let1 f "test.o"
+             (with-output-to-file f (^[] (display *data*)))
+             (begin0 (decompress-via-port
+                      (call-with-input-process `("lz4" "-c" ,f) port->string))
+               (sys-unlink f)))))
+  (test* "lz4 command not found; skipping" #t #t))
+
+(test-end)
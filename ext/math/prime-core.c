@@ -0,0 +1,391 @@
+/*
+ * prime-core.c - native support for math.prime
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gauche.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include <gauche/bits.h>
+#include <math.h>
+#include "prime-core.h"
+
+/*=====================================================
+ * Montgomery arithmetic
+ *
+ *  For an odd modulus N and R = 2^64, a number x is represented by
+ *  xR mod N.  REDC(T) = T R^-1 mod N is computed from T < NR with
+ *  N^-1 mod R, which we get by Newton's iteration (each step doubles
+ *  the number of correct low bits, and N itself is correct to 3 bits).
+ */
+
+typedef struct mont_rec {
+    ScmUInt64 n;
+    ScmUInt64 ninv;             /* N^-1 mod 2^64 */
+    ScmUInt64 one;              /* R mod N */
+    ScmUInt64 r2;               /* R^2 mod N */
+} mont;
+
+static inline void umul64(ScmUInt64 a, ScmUInt64 b,
+                          ScmUInt64 *hi, ScmUInt64 *lo)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (ScmUInt64)(r >> 64);
+    *lo = (ScmUInt64)r;
+#else
+    const ScmUInt64 m32 = 0xffffffffULL;
+    ScmUInt64 a1 = a >> 32, a0 = a & m32, b1 = b >> 32, b0 = b & m32;
+    ScmUInt64 p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+    ScmUInt64 mid = (p00 >> 32) + (p01 & m32) + (p10 & m32);
+    *lo = (mid << 32) | (p00 & m32);
+    *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+/* a + b mod n, for a, b < n */
+static inline ScmUInt64 addmod(ScmUInt64 a, ScmUInt64 b, ScmUInt64 n)
+{
+    return (a >= n - b)? a - (n - b) : a + b;
+}
+
+static void mont_init(mont *m, ScmUInt64 n)
+{
+    ScmUInt64 inv = n;
+    for (int i = 0; i < 5; i++) inv *= 2 - n * inv;
+    m->n = n;
+    m->ninv = inv;
+    m->one = (0 - n) % n;
+    ScmUInt64 x = m->one;
+    for (int i = 0; i < 64; i++) x = addmod(x, x, n);
+    m->r2 = x;
+}
+
+static inline ScmUInt64 mont_mul(const mont *m, ScmUInt64 a, ScmUInt64 b)
+{
+    ScmUInt64 hi, lo, mh, ml;
+    umul64(a, b, &hi, &lo);
+    umul64(lo * m->ninv, m->n, &mh, &ml);
+    return (hi < mh)? hi - mh + m->n : hi - mh;
+}
+
+static inline ScmUInt64 mont_from(const mont *m, ScmUInt64 a)
+{
+    return mont_mul(m, a % m->n, m->r2);
+}
+
+static ScmUInt64 mont_pow(const mont *m, ScmUInt64 b, ScmUInt64 e)
+{
+    ScmUInt64 r = m->one;
+    while (e) {
+        if (e & 1) r = mont_mul(m, r, b);
+        b = mont_mul(m, b, b);
+        e >>= 1;
+    }
+    return r;
+}
+
+static ScmUInt64 gcd64(ScmUInt64 a, ScmUInt64 b)
+{
+    while (b) {
+        ScmUInt64 t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/*=====================================================
+ * Primality
+ */
+
+static int mr_test(const mont *m, ScmUInt64 a)
+{
+    ScmUInt64 n = m->n, d = n - 1;
+    int s = 0;
+    while ((d & 1) == 0) { d >>= 1; s++; }
+
+    if (a % n == 0) return TRUE;
+    ScmUInt64 minus_one = n - m->one;
+    ScmUInt64 x = mont_pow(m, mont_from(m, a), d);
+    if (x == m->one || x == minus_one) return TRUE;
+    for (int i = 1; i < s; i++) {
+        x = mont_mul(m, x, x);
+        if (x == minus_one) return TRUE;
+        if (x == m->one) return FALSE;
+    }
+    return FALSE;
+}
+
+int Scm__MillerRabinU64(ScmUInt64 n, ScmUInt64 a)
+{
+    mont m;
+    mont_init(&m, n);
+    return mr_test(&m, a);
+}
+
+/* Jaeschke's bases for n < 4759123141, and Sinclair's set that covers
+   the whole 64 bit range. */
+static const ScmUInt64 bases32[] = { 2, 7, 61 };
+static const ScmUInt64 bases64[] = {
+    2, 325, 9375, 28178, 450775, 9780504, 1795265022
+};
+
+static const unsigned int small_primes[] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47
+};
+
+int Scm__PrimeU64P(ScmUInt64 n)
+{
+    for (size_t i = 0; i < sizeof(small_primes)/sizeof(small_primes[0]); i++) {
+        if (n == small_primes[i]) return TRUE;
+        if (n % small_primes[i] == 0) return FALSE;
+    }
+    if (n < 2) return FALSE;
+    if (n < 47*47) return TRUE;
+
+    mont m;
+    mont_init(&m, n);
+    const ScmUInt64 *bases = bases64;
+    size_t nbases = sizeof(bases64)/sizeof(bases64[0]);
+    if (n < 4759123141ULL) {
+        bases = bases32;
+        nbases = sizeof(bases32)/sizeof(bases32[0]);
+    }
+    for (size_t i = 0; i < nbases; i++) {
+        if (!mr_test(&m, bases[i])) return FALSE;
+    }
+    return TRUE;
+}
+
+/*=====================================================
+ * Factorization
+ *
+ *  R. P. Brent, An improved Monte Carlo factorization algorithm,
+ *  BIT 20 (1980), the same algorithm as mc-find-divisor-1 in
+ *  math/prime.scm.  Multiplying by R doesn't change the gcd with N,
+ *  so we can accumulate the product of differences in Montgomery form.
+ */
+
+#define RHO_STEP      128
+#define RHO_MAX_RANGE (1UL<<26)
+
+ScmUInt64 Scm__PollardRhoU64(ScmUInt64 n, ScmUInt64 x0, ScmUInt64 c)
+{
+    if ((n & 1) == 0) return 2;
+
+    mont m;
+    mont_init(&m, n);
+    ScmUInt64 cm = mont_from(&m, c);
+    ScmUInt64 x = 0, y = mont_from(&m, x0), ys = y, q = m.one, g = 1;
+    unsigned long r = 1;
+
+#define RHO_F(v)  addmod(mont_mul(&m, (v), (v)), cm, n)
+#define ABSDIFF(a, b)  (((a) > (b))? (a) - (b) : (b) - (a))
+
+    do {
+        x = y;
+        for (unsigned long i = 0; i < r; i++) y = RHO_F(y);
+        for (unsigned long k = 0; k < r && g == 1; k += RHO_STEP) {
+            ys = y;
+            unsigned long lim = (r - k < RHO_STEP)? r - k : RHO_STEP;
+            for (unsigned long i = 0; i < lim; i++) {
+                y = RHO_F(y);
+                q = mont_mul(&m, q, ABSDIFF(x, y));
+            }
+            g = gcd64(q, n);
+        }
+        r *= 2;
+    } while (g == 1 && r <= RHO_MAX_RANGE);
+
+    if (g == n) {
+        /* We've overshot; redo the last stride one by one. */
+        do {
+            ys = RHO_F(ys);
+            g = gcd64(ABSDIFF(x, ys), n);
+        } while (g == 1);
+    }
+#undef RHO_F
+#undef ABSDIFF
+    return (g == 1 || g == n)? 0 : g;
+}
+
+/*=====================================================
+ * Segmented sieve
+ *
+ *  A block covers SIEVE_BLOCK_BITS odd numbers, one bit each, so that
+ *  it fits in L1/L2 cache while we cross off the multiples of each
+ *  base prime.  The base primes (odd primes up to the square root of
+ *  the upper bound) are kept in a table shared by all threads, which
+ *  is extended on demand.  An extended table is a fresh array, so the
+ *  one a reader has fetched stays valid.
+ */
+
+#define SIEVE_BLOCK_BITS  (1<<18)       /* 32KB */
+
+static struct {
+    unsigned int *primes;       /* odd primes */
+    size_t count;
+    ScmUInt64 limit;            /* all primes <= limit are in the table */
+    ScmInternalMutex mutex;
+} base_primes;
+
+/* floor(sqrt(x)) */
+static ScmUInt64 isqrt64(ScmUInt64 x)
+{
+    ScmUInt64 r = (ScmUInt64)sqrt((double)x);
+    if (r > 0xffffffffULL) r = 0xffffffffULL;
+    while (r * r > x) r--;
+    while (r < 0xffffffffULL && (r+1) * (r+1) <= x) r++;
+    return r;
+}
+
+static void base_primes_get(ScmUInt64 limit, unsigned int **primes,
+                            size_t *count)
+{
+    SCM_INTERNAL_MUTEX_LOCK(base_primes.mutex);
+    if (base_primes.limit < limit) {
+        /* Grow at least twice, to amortize re-sieving. */
+        ScmUInt64 newlimit = base_primes.limit * 2;
+        if (newlimit < limit) newlimit = limit;
+        if (newlimit < 1024) newlimit = 1024;
+        if (newlimit > 0xffffffffULL) newlimit = 0xffffffffULL;
+
+        /* Plain sieve of the odd numbers 3, 5, ..., newlimit.  Bit i
+           is for 2i+3. */
+        ScmUInt64 nbits = (newlimit - 1) / 2;
+        ScmBits *bits = SCM_NEW_ATOMIC_ARRAY(ScmBits,
+                                             SCM_BITS_NUM_WORDS(nbits));
+        Scm_BitsFill(bits, 0, (int)nbits, 0);
+        for (ScmUInt64 i = 0; ; i++) {
+            ScmUInt64 p = 2*i + 3;
+            if (p * p > newlimit) break;
+            if (SCM_BITS_TEST(bits, i)) continue;
+            for (ScmUInt64 j = (p*p - 3)/2; j < nbits; j += p) {
+                SCM_BITS_SET(bits, j);
+            }
+        }
+        size_t cnt = (size_t)nbits - Scm_BitsCount1(bits, 0, (int)nbits);
+        unsigned int *v = SCM_NEW_ATOMIC_ARRAY(unsigned int, cnt);
+        size_t k = 0;
+        for (int i = Scm_BitsLowest0(bits, 0, (int)nbits); i >= 0;
+             i = Scm_BitsLowest0(bits, i+1, (int)nbits)) {
+            v[k++] = (unsigned int)(2*i + 3);
+        }
+        base_primes.primes = v;
+        base_primes.count = k;
+        base_primes.limit = newlimit;
+    }
+    *primes = base_primes.primes;
+    *count = base_primes.count;
+    SCM_INTERNAL_MUTEX_UNLOCK(base_primes.mutex);
+}
+
+ScmObj Scm__PrimesInRange(ScmObj lo_obj, ScmObj hi_obj)
+{
+    ScmUInt64 lo = Scm_GetIntegerU64Clamp(lo_obj, SCM_CLAMP_ERROR, NULL);
+    ScmUInt64 hi;
+    int hi_oor = FALSE;
+    hi = Scm_GetIntegerU64Clamp(hi_obj, SCM_CLAMP_HI, &hi_oor);
+    if (hi_oor) {
+        /* Only 2^64 itself is allowed beyond the range. */
+        if (!Scm_NumEq(hi_obj, Scm_Ash(SCM_MAKE_INT(1), 64))) {
+            Scm_Error("upper bound out of range: %S", hi_obj);
+        }
+        /* hi is now 2^64-1, which isn't a prime: inclusive is fine. */
+    }
+    if (hi <= lo) return Scm_MakeU64Vector(0, 0);
+
+    /* Collect the results in a growing buffer. */
+    size_t cap = 1024, cnt = 0;
+    ScmUInt64 *buf = SCM_NEW_ATOMIC_ARRAY(ScmUInt64, cap);
+#define PUSH(v)                                                 \
+    do {                                                        \
+        if (cnt == cap) {                                       \
+            ScmUInt64 *nb = SCM_NEW_ATOMIC_ARRAY(ScmUInt64, cap*2); \
+            memcpy(nb, buf, cap * sizeof(ScmUInt64));           \
+            buf = nb;                                           \
+            cap *= 2;                                           \
+        }                                                       \
+        buf[cnt++] = (v);                                       \
+    } while (0)
+
+    if (lo <= 2 && 2 < hi) PUSH(2);
+    if (lo < 3) lo = 3;
+    if ((lo & 1) == 0) lo++;
+    if (lo >= hi) goto done;
+
+    unsigned int *ps;
+    size_t nps;
+    base_primes_get(isqrt64(hi - 1), &ps, &nps);
+
+    ScmBits *bits = SCM_NEW_ATOMIC_ARRAY(ScmBits,
+                                         SCM_BITS_NUM_WORDS(SIEVE_BLOCK_BITS));
+    /* Each block is the odd numbers blo, blo+2, ..., < bhi */
+    for (ScmUInt64 blo = lo; blo < hi; ) {
+        ScmUInt64 room = (hi - blo + 1) / 2;
+        int nbits = (room < SIEVE_BLOCK_BITS)? (int)room : SIEVE_BLOCK_BITS;
+        ScmUInt64 blast = blo + 2*(ScmUInt64)(nbits - 1); /* last number */
+        Scm_BitsFill(bits, 0, nbits, 0);
+
+        for (size_t i = 0; i < nps; i++) {
+            ScmUInt64 p = ps[i];
+            if (p * p > blast) break;
+            ScmUInt64 off;
+            if (p * p >= blo) {
+                off = p * p - blo;
+            } else {
+                ScmUInt64 r = blo % p;
+                off = r? p - r : 0;
+                if (off & 1) off += p; /* skip even multiples */
+            }
+            for (ScmUInt64 j = off/2; j < (ScmUInt64)nbits; j += p) {
+                SCM_BITS_SET(bits, j);
+            }
+        }
+        for (int i = Scm_BitsLowest0(bits, 0, nbits); i >= 0;
+             i = Scm_BitsLowest0(bits, i+1, nbits)) {
+            PUSH(blo + 2*(ScmUInt64)i);
+        }
+        if (blast >= hi - 2) break; /* avoid overflow near 2^64 */
+        blo = blast + 2;
+    }
+#undef PUSH
+  done:
+    return Scm_MakeU64VectorFromArrayShared(cnt, buf);
+}
+
+void Scm__InitPrimeCore(ScmModule *mod)
+{
+    SCM_INTERNAL_MUTEX_INIT(base_primes.mutex);
+}
@@ -0,0 +1,62 @@
+/*
+ * prime-core.h - native support for math.prime
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_MATH_PRIME_CORE_H
+#define GAUCHE_MATH_PRIME_CORE_H
+
+/* Word-sized number theory behind math.prime.  The arithmetic modulo
+ * an odd N < 2^64 is done in Montgomery form, so that a modular
+ * multiplication takes two 64x64->128 bit multiplications and no
+ * division.  math.prime falls back to the generic bignum routines
+ * for larger inputs.
+ */
+
+/* Strong probable prime test of odd N > 2 to the base A. */
+extern int Scm__MillerRabinU64(ScmUInt64 n, ScmUInt64 a);
+
+/* Deterministic primality test for N < 2^64. */
+extern int Scm__PrimeU64P(ScmUInt64 n);
+
+/* Brent's variant of Pollard's rho on a composite N, with the
+   polynomial x^2+C from the seed X0.  Returns a nontrivial divisor,
+   or 0 if this choice of X0 and C failed. */
+extern ScmUInt64 Scm__PollardRhoU64(ScmUInt64 n, ScmUInt64 x0, ScmUInt64 c);
+
+/* Returns a u64vector of the primes in [LO, HI), using a segmented
+   sieve.  HI must be at most 2^64. */
+extern ScmObj Scm__PrimesInRange(ScmObj lo, ScmObj hi);
+
+extern void Scm__InitPrimeCore(ScmModule *mod);
+
+#endif /*GAUCHE_MATH_PRIME_CORE_H*/
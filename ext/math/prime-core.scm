@@ -0,0 +1,68 @@
+;;;
+;;; math.prime-core - native support for math.prime
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; Word-sized primality test, factorization and sieve, implemented in
+;; prime-core.c.  The user-level interface is math.prime.
+
+(define-module math.prime-core
+  (export %miller-rabin-u64 %prime-u64? %pollard-rho-u64 %primes-in-range))
+(select-module math.prime-core)
+
+(inline-stub
+ (declcode "#include \"prime-core.h\"")
+ (initcode "Scm__InitPrimeCore(Scm_CurrentModule());")
+
+ (define-cfn get-u64 (n) ::ScmUInt64 :static
+   (return (Scm_GetIntegerU64Clamp n SCM_CLAMP_ERROR NULL)))
+
+ ;; N must be an odd integer between 3 and 2^64-1.
+ (define-cproc %miller-rabin-u64 (n a) ::<boolean>
+   (let* ([nn::ScmUInt64 (get-u64 n)])
+     (when (or (< nn 3) (== (logand nn 1) 0))
+       (Scm_Error "odd integer greater than 2 required, but got: %S" n))
+     (return (Scm__MillerRabinU64 nn (get-u64 a)))))
+
+ (define-cproc %prime-u64? (n) ::<boolean>
+   (return (Scm__PrimeU64P (get-u64 n))))
+
+ ;; Returns a nontrivial divisor of composite N, or #f if it fails
+ ;; with the given X0 and C.
+ (define-cproc %pollard-rho-u64 (n x0 c)
+   (let* ([nn::ScmUInt64 (get-u64 n)])
+     (when (< nn 4)
+       (Scm_Error "composite integer required, but got: %S" n))
+     (let* ([d::ScmUInt64 (Scm__PollardRhoU64 nn (get-u64 x0) (get-u64 c))])
+       (return (?: (== d 0) SCM_FALSE (Scm_MakeIntegerU64 d))))))
+
+ (define-cproc %primes-in-range (lo hi) Scm__PrimesInRange)
+ )
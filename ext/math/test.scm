@@ -0,0 +1,40 @@
+;;
+;; testing math.* extensions
+;;
+
+(use gauche.test)
+(use gauche.uvector)
+
+(test-start "math.* extensions")
+
+;;-----------------------------------------------
+(test-section "math.prime-core")
+(use math.prime-core)
+(test-module 'math.prime-core)
+
+(test* "%prime-u64?" '(2 3 5 7 11 13 17 19 23 29 31 37 41 43 47)
+       (filter %prime-u64? (iota 50)))
+(test* "%prime-u64? (strong pseudoprimes)" '(#f #f #f #f)
+       (map %prime-u64? '(2047 3215031751 4759123141 3825123056546413051)))
+(test* "%prime-u64? (near 2^64)" '(#t #f)
+       (map %prime-u64? '(18446744073709551557 18446744073709551615)))
+(test* "%miller-rabin-u64" '(#t #f)
+       (list (%miller-rabin-u64 2047 2) (%miller-rabin-u64 2047 3)))
+
+(test* "%pollard-rho-u64" '(1000000007 1000000009)
+       (let loop ([c 1])
+         (if-let1 d (%pollard-rho-u64 1000000016000000063 2 c)
+           (sort (list d (quotient 1000000016000000063 d)))
+           (loop (+ c 1)))))
+
+(test* "%primes-in-range" '#u64(2 3 5 7 11 13 17 19 23 29)
+       (%primes-in-range 0 30))
+(test* "%primes-in-range (empty)" '#u64() (%primes-in-range 24 29))
+(test* "%primes-in-range (block boundary)" 78498
+       (uvector-length (%primes-in-range 0 1000000)))
+(test* "%primes-in-range (segment)" 4832
+       (uvector-length (%primes-in-range 1000000000 1000100000)))
+(test* "%primes-in-range (top)" '#u64(18446744073709551557)
+       (%primes-in-range 18446744073709551540 (expt 2 64)))
+
+(test-end)
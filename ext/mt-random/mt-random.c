@@ -132,52 +132,59 @@ void Scm_MTInitByArray(ScmMersenneTwister *mt,
     mt->mt[0] = 0x80000000UL; /* MSB is 1; assuring non-zero initial array */
 }
 
-/* generates a random number on [0,0xffffffff]-interval */
-unsigned long Scm_MTGenrandU32(ScmMersenneTwister *mt)
+/* generates N words at one time */
+static void genrand_refill(ScmMersenneTwister *mt)
 {
     unsigned long y;
-    int mti = mt->mti;
-    static unsigned long mag01[2]={0x0UL, MATRIX_A};
+    int kk;
+    static const unsigned long mag01[2]={0x0UL, MATRIX_A};
     /* mag01[x] = x * MATRIX_A  for x=0,1 */
 
-    if (mti >= N) { /* generate N words at one time */
-        int kk;
-
-        if (mti == N+1)   /* if Scm_MTInitByUI() has not been called, */
-            Scm_MTInitByUI(mt, 5489UL); /* a default initial seed is used */
-
-        for (kk=0;kk<N-M;kk++) {
-            y = (mt->mt[kk]&UPPER_MASK)|(mt->mt[kk+1]&LOWER_MASK);
-            mt->mt[kk] = mt->mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
-        }
-        for (;kk<N-1;kk++) {
-            y = (mt->mt[kk]&UPPER_MASK)|(mt->mt[kk+1]&LOWER_MASK);
-            mt->mt[kk] = mt->mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
-        }
-        y = (mt->mt[N-1]&UPPER_MASK)|(mt->mt[0]&LOWER_MASK);
-        mt->mt[N-1] = mt->mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
+    if (mt->mti == N+1)   /* if Scm_MTInitByUI() has not been called, */
+        Scm_MTInitByUI(mt, 5489UL); /* a default initial seed is used */
 
-        mti = 0;
+    for (kk=0;kk<N-M;kk++) {
+        y = (mt->mt[kk]&UPPER_MASK)|(mt->mt[kk+1]&LOWER_MASK);
+        mt->mt[kk] = mt->mt[kk+M] ^ (y >> 1) ^ mag01[y & 0x1UL];
+    }
+    for (;kk<N-1;kk++) {
+        y = (mt->mt[kk]&UPPER_MASK)|(mt->mt[kk+1]&LOWER_MASK);
+        mt->mt[kk] = mt->mt[kk+(M-N)] ^ (y >> 1) ^ mag01[y & 0x1UL];
     }
+    y = (mt->mt[N-1]&UPPER_MASK)|(mt->mt[0]&LOWER_MASK);
+    mt->mt[N-1] = mt->mt[M-1] ^ (y >> 1) ^ mag01[y & 0x1UL];
 
-    y = mt->mt[mti++];
+    mt->mti = 0;
+}
 
-    /* Tempering */
+/* Tempering */
+static inline unsigned long temper(unsigned long y)
+{
     y ^= (y >> 11);
     y ^= (y << 7) & 0x9d2c5680UL;
     y ^= (y << 15) & 0xefc60000UL;
     y ^= (y >> 18);
-
-    mt->mti = mti;
     return y;
 }
 
+static inline unsigned long genrand_u32(ScmMersenneTwister *mt)
+{
+    if (mt->mti >= N) genrand_refill(mt);
+    return temper(mt->mt[mt->mti++]);
+}
+
+/* generates a random number on [0,0xffffffff]-interval */
+unsigned long Scm_MTGenrandU32(ScmMersenneTwister *mt)
+{
+    return genrand_u32(mt);
+}
+
 /* generates a random number on (0,1) or [0,1) -real-interval */
 float Scm_MTGenrandF32(ScmMersenneTwister *mt, int exclude0)
 {
     float r;
     do {
-        r = (float)(Scm_MTGenrandU32(mt)*(1.0/4294967296.0));
+        r = (float)(genrand_u32(mt)*(1.0/4294967296.0));
         /* divided by 2^32 */
     } while (exclude0 && r == 0.0); /*if we get 0.0, try another one. */;
     return r;
@@ -189,13 +196,59 @@ double Scm_MTGenrandF64(ScmMersenneTwister *mt, int exclude0)
     double r;
     unsigned long a, b;
     do {
-        a = Scm_MTGenrandU32(mt)>>5;
-        b = Scm_MTGenrandU32(mt)>>6;
+        a = genrand_u32(mt)>>5;
+        b = genrand_u32(mt)>>6;
         r = (a*67108864.0+b)*(1.0/9007199254740992.0);
     } while (exclude0 && r == 0.0); /*if we get 0.0, try another one. */;
     return r;
 }
 
+/*
+ * Bulk generation.  We take the whole block of the state at once,
+ * so that the loop doesn't need to check the index per word.
+ */
+void Scm_MTFillU32(ScmMersenneTwister *mt, ScmUInt32 *p, long n)
+{
+    while (n > 0) {
+        if (mt->mti >= N) genrand_refill(mt);
+        long k = N - mt->mti;
+        if (k > n) k = n;
+        const unsigned long *q = mt->mt + mt->mti;
+        for (long i=0; i<k; i++) p[i] = (ScmUInt32)temper(q[i]);
+        mt->mti += (int)k;
+        p += k;
+        n -= k;
+    }
+}
+
+void Scm_MTFillF32(ScmMersenneTwister *mt, float *p, long n, int exclude0)
+{
+    for (long i=0; i<n; i++) p[i] = Scm_MTGenrandF32(mt, exclude0);
+}
+
+void Scm_MTFillF64(ScmMersenneTwister *mt, double *p, long n, int exclude0)
+{
+    for (long i=0; i<n; i++) p[i] = Scm_MTGenrandF64(mt, exclude0);
+}
+
+/*
+ * Derive a new generator from MT.  The new one is seeded by an array
+ * taken from MT's output, so it runs as an independent stream; MT19937
+ * doesn't have a cheap jump-ahead, but with the period of 2^19937-1
+ * the chance of overlap between streams is negligible.
+ */
+#define SPLIT_SEED_LENGTH 16
+
+ScmObj Scm_MTSplit(ScmMersenneTwister *mt)
+{
+    ScmInt32 key[SPLIT_SEED_LENGTH];
+    ScmMersenneTwister *r = SCM_NEW(ScmMersenneTwister);
+    SCM_SET_CLASS(r, &Scm_MersenneTwisterClass);
+    Scm_MTFillU32(mt, (ScmUInt32*)key, SPLIT_SEED_LENGTH);
+    Scm_MTInitByArray(r, key, SPLIT_SEED_LENGTH);
+    return SCM_OBJ(r);
+}
+
 /*
  * Generic integer routine for [0, n-1], 0 < n <= 2^32
  */
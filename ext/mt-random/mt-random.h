@@ -79,4 +79,9 @@ extern float         Scm_MTGenrandF32(ScmMersenneTwister *, int);
 extern double        Scm_MTGenrandF64(ScmMersenneTwister *, int);
 extern ScmObj        Scm_MTGenrandInt(ScmMersenneTwister *mt, ScmObj n);
 
+extern void          Scm_MTFillU32(ScmMersenneTwister *, ScmUInt32 *, long);
+extern void          Scm_MTFillF32(ScmMersenneTwister *, float *, long, int);
+extern void          Scm_MTFillF64(ScmMersenneTwister *, double *, long, int);
+extern ScmObj        Scm_MTSplit(ScmMersenneTwister *);
+
 extern void          Scm_Init_mt_random(void);
@@ -42,7 +42,8 @@
           mt-random-integer
           mt-random-fill-u32vector!
           mt-random-fill-f32vector!
-          mt-random-fill-f64vector!)
+          mt-random-fill-f64vector!
+          mt-random-split)
   )
 (select-module math.mt-random)
 
@@ -88,22 +89,19 @@
    Scm_MTGenrandU32)
 
  (define-cproc mt-random-fill-u32vector! (mt::<mersenne-twister> v::<u32vector>)
-   (let* ([p::ScmUInt32* (SCM_U32VECTOR_ELEMENTS v)])
-     (dotimes [i (SCM_U32VECTOR_SIZE v)]
-       (set! (* (post++ p)) (Scm_MTGenrandU32 mt)))
-     (return (SCM_OBJ v))))
+   (Scm_MTFillU32 mt (SCM_U32VECTOR_ELEMENTS v) (SCM_U32VECTOR_SIZE v))
+   (return (SCM_OBJ v)))
 
  (define-cproc mt-random-fill-f32vector! (mt::<mersenne-twister> v::<f32vector>)
-   (let* ([p::float* (SCM_F32VECTOR_ELEMENTS v)])
-     (dotimes [i (SCM_F32VECTOR_SIZE v)]
-       (set! (* (post++ p)) (Scm_MTGenrandF32 mt TRUE)))
-     (return (SCM_OBJ v))))
+   (Scm_MTFillF32 mt (SCM_F32VECTOR_ELEMENTS v) (SCM_F32VECTOR_SIZE v) TRUE)
+   (return (SCM_OBJ v)))
 
  (define-cproc mt-random-fill-f64vector! (mt::<mersenne-twister> v::<f64vector>)
-   (let* ([p::double* (SCM_F64VECTOR_ELEMENTS v)])
-     (dotimes [i (SCM_F64VECTOR_SIZE v)]
-       (set! (* (post++ p)) (Scm_MTGenrandF64 mt TRUE)))
-     (return (SCM_OBJ v))))
+   (Scm_MTFillF64 mt (SCM_F64VECTOR_ELEMENTS v) (SCM_F64VECTOR_SIZE v) TRUE)
+   (return (SCM_OBJ v)))
+
+ (define-cproc mt-random-split (mt::<mersenne-twister>)
+   Scm_MTSplit)
  )
 
 (define (%get-nword-random-int mt n)
@@ -102,6 +102,33 @@
                      (rlet1 v (make-f64vector 100 0)
                        (mt-random-fill-f64vector! m1 v))))))
 
+(test "u32vector (across state blocks)" #t
+      (^[] (let ([m0 (make <mersenne-twister> :seed 3)]
+                 [m1 (make <mersenne-twister> :seed 3)])
+             (mt-random-integer m0 10) ; shift the state index
+             (mt-random-integer m1 10)
+             (equal? (make-random-sequence <u32vector> 2000
+                                           (^[] (mt-random-integer m0 (expt 2 32))))
+                     (rlet1 v (make-u32vector 2000 0)
+                       (mt-random-fill-u32vector! m1 v))))))
+
+(test "split" #t
+      (^[] (let* ([m0 (make <mersenne-twister> :seed 5)]
+                  [m1 (make <mersenne-twister> :seed 5)]
+                  [s0 (mt-random-split m0)]
+                  [s1 (mt-random-split m1)])
+             (and (is-a? s0 <mersenne-twister>)
+                  ;; splitting is deterministic
+                  (equal? (make-random-sequence <list> 100
+                                                (^[] (mt-random-real s0)))
+                          (make-random-sequence <list> 100
+                                                (^[] (mt-random-real s1))))
+                  ;; and the child differs from the parent
+                  (not (equal? (make-random-sequence <list> 100
+                                                     (^[] (mt-random-real m0)))
+                               (make-random-sequence <list> 100
+                                                     (^[] (mt-random-real s0)))))))))
+
 (test "state" #t
       (^[] (let ([s  (mt-random-get-state m)]
                  [m2 (make <mersenne-twister> :seed 9324)])
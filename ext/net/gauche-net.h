@@ -43,6 +43,7 @@
 #include <netdb.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <sys/un.h>
 #include <sys/ioctl.h>
@@ -250,6 +251,13 @@ extern ScmObj Scm_SocketBind(ScmSocket *s, ScmSockAddr *addr);
 extern ScmObj Scm_SocketConnect(ScmSocket *s, ScmSockAddr *addr);
 extern ScmObj Scm_SocketListen(ScmSocket *s, int backlog);
 extern ScmObj Scm_SocketAccept(ScmSocket *s);
+extern ScmObj Scm_SocketAcceptWithFlags(ScmSocket *s, int flags);
+
+/* flags for Scm_SocketAcceptWithFlags */
+enum {
+    SCM_SOCKET_NONBLOCK = (1L<<0),
+    SCM_SOCKET_CLOEXEC  = (1L<<1)
+};
 
 extern ScmObj Scm_SocketGetSockName(ScmSocket *s);
 extern ScmObj Scm_SocketGetPeerName(ScmSocket *s);
@@ -257,9 +265,17 @@ extern ScmObj Scm_SocketGetPeerName(ScmSocket *s);
 extern ScmObj Scm_SocketSend(ScmSocket *s, ScmObj msg, int flags);
 extern ScmObj Scm_SocketSendTo(ScmSocket *s, ScmObj msg, ScmSockAddr *to, int flags);
 extern ScmObj Scm_SocketSendMsg(ScmSocket *s, ScmObj msg, int flags);
+extern ScmObj Scm_SocketSendFds(ScmSocket *s, ScmObj fds, ScmObj msg,
+                                int flags);
+extern ScmObj Scm_SocketRecvFds(ScmSocket *s, int bytes, int maxfds,
+                                int flags);
 extern ScmObj Scm_SocketRecv(ScmSocket *s, int bytes, int flags);
 extern ScmObj Scm_SocketRecvX(ScmSocket *s, ScmUVector *buf, int flags);
 extern ScmObj Scm_SocketRecvFrom(ScmSocket *s, int bytes, int flags);
+extern ScmObj Scm_SocketRecvMMsg(ScmSocket *s, ScmVector *bufs,
+                                 ScmVector *sizes, ScmObj addrs, int flags);
+extern ScmObj Scm_SocketSendMMsg(ScmSocket *s, ScmVector *msgs, ScmObj to,
+                                 int flags);
 extern ScmObj Scm_SocketRecvFromX(ScmSocket *s, ScmUVector *buf,
                                   ScmObj addrs, int flags);
 
@@ -31,6 +31,9 @@
  *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+/* accept4(), recvmmsg() and sendmmsg() are GNU extensions on glibc. */
+#define _GNU_SOURCE 1
+
 #include "gauche-net.h"
 #include <fcntl.h>
 #include <gauche/extend.h>
@@ -277,6 +280,37 @@ ScmObj Scm_SocketListen(ScmSocket *sock, int backlog)
 }
 
 ScmObj Scm_SocketAccept(ScmSocket *sock)
+{
+    return Scm_SocketAcceptWithFlags(sock, 0);
+}
+
+/* Sets the flags SCM_SOCKET_NONBLOCK and SCM_SOCKET_CLOEXEC on a
+   descriptor, for systems without accept4(). */
+#if !defined(HAVE_ACCEPT4)
+static void set_accepted_flags(Socket fd, int flags)
+{
+#if defined(GAUCHE_WINDOWS)
+    if (flags & SCM_SOCKET_NONBLOCK) {
+        u_long on = 1;
+        (void)ioctlsocket(fd, FIONBIO, &on);
+    }
+    /* close-on-exec doesn't apply */
+#else  /*!GAUCHE_WINDOWS*/
+    if (flags & SCM_SOCKET_NONBLOCK) {
+        int fl = fcntl(fd, F_GETFL, 0);
+        if (fl >= 0) (void)fcntl(fd, F_SETFL, fl|O_NONBLOCK);
+    }
+    if (flags & SCM_SOCKET_CLOEXEC) {
+        (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif /*!GAUCHE_WINDOWS*/
+}
+#endif /*!HAVE_ACCEPT4*/
+
+/* FLAGS is a logior of SCM_SOCKET_NONBLOCK and SCM_SOCKET_CLOEXEC, which
+   are set on the accepted socket.  If accept4() is available, they're
+   set atomically by the kernel without extra system calls. */
+ScmObj Scm_SocketAcceptWithFlags(ScmSocket *sock, int flags)
 {
     Socket newfd;
     struct sockaddr_storage addrbuf;
@@ -284,7 +318,14 @@ ScmObj Scm_SocketAccept(ScmSocket *sock)
     ScmClass *addrClass = Scm_ClassOf(SCM_OBJ(sock->address));
 
     CLOSE_CHECK(sock->fd, "accept from", sock);
+#if defined(HAVE_ACCEPT4)
+    int aflags = ((flags & SCM_SOCKET_NONBLOCK)? SOCK_NONBLOCK : 0)
+        | ((flags & SCM_SOCKET_CLOEXEC)? SOCK_CLOEXEC : 0);
+    SCM_SYSCALL(newfd, accept4(sock->fd, (struct sockaddr*)&addrbuf, &addrlen,
+                               aflags));
+#else  /*!HAVE_ACCEPT4*/
     SCM_SYSCALL(newfd, accept(sock->fd, (struct sockaddr*)&addrbuf, &addrlen));
+#endif /*!HAVE_ACCEPT4*/
     if (SOCKET_INVALID(newfd)) {
         if (errno == EAGAIN) {
             return SCM_FALSE;
@@ -292,6 +333,9 @@ ScmObj Scm_SocketAccept(ScmSocket *sock)
             Scm_SysError("accept(2) failed");
         }
     }
+#if !defined(HAVE_ACCEPT4)
+    if (flags) set_accepted_flags(newfd, flags);
+#endif /*!HAVE_ACCEPT4*/
     ScmSocket *newsock = make_socket(newfd, sock->type);
     newsock->address =
         SCM_SOCKADDR(Scm_MakeSockAddr(addrClass,
@@ -396,6 +440,122 @@ ScmObj Scm_SocketSendMsg(ScmSocket *sock, ScmObj msg, int flags)
 #endif /*GAUCHE_WINDOWS*/
 }
 
+/* Passing file descriptors over a unix-domain socket (SCM_RIGHTS).
+   Some platforms don't pass ancillary data without a payload, so we
+   send a NUL byte when MSG is empty. */
+#define SOCKET_MAX_FDS 64
+
+ScmObj Scm_SocketSendFds(ScmSocket *sock, ScmObj fds, ScmObj msg, int flags)
+{
+#if !GAUCHE_WINDOWS && defined(SCM_RIGHTS)
+    int r, nfds = 0, fdv[SOCKET_MAX_FDS];
+    u_int size;
+    char nul = 0;
+    ScmObj cp;
+
+    SCM_FOR_EACH(cp, fds) {
+        if (!SCM_INTP(SCM_CAR(cp)) || SCM_INT_VALUE(SCM_CAR(cp)) < 0) {
+            Scm_TypeError("file descriptor", "nonnegative fixnum", SCM_CAR(cp));
+        }
+        if (nfds >= SOCKET_MAX_FDS) {
+            Scm_Error("too many file descriptors (max %d): %S",
+                      SOCKET_MAX_FDS, fds);
+        }
+        fdv[nfds++] = (int)SCM_INT_VALUE(SCM_CAR(cp));
+    }
+    if (nfds == 0) Scm_Error("no file descriptors to send");
+    CLOSE_CHECK(sock->fd, "send to", sock);
+
+    const char *body = get_message_body(msg, &size);
+    struct iovec iov;
+    iov.iov_base = (void*)((size > 0)? body : &nul);
+    iov.iov_len = (size > 0)? size : 1;
+    union {
+        struct cmsghdr hdr;     /* for alignment */
+        char buf[CMSG_SPACE(sizeof(int)*SOCKET_MAX_FDS)];
+    } control;
+    struct msghdr m;
+    memset(&m, 0, sizeof(m));
+    memset(&control, 0, sizeof(control));
+    m.msg_iov = &iov;
+    m.msg_iovlen = 1;
+    m.msg_control = control.buf;
+    m.msg_controllen = CMSG_SPACE(sizeof(int)*nfds);
+    struct cmsghdr *c = CMSG_FIRSTHDR(&m);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int)*nfds);
+    memcpy(CMSG_DATA(c), fdv, sizeof(int)*nfds);
+    SCM_SYSCALL(r, sendmsg(sock->fd, &m, flags));
+    if (r < 0) Scm_SysError("sendmsg(2) failed");
+    return SCM_MAKE_INT(r);
+#else  /*GAUCHE_WINDOWS || !SCM_RIGHTS*/
+    Scm_Error("passing file descriptors is not supported on this platform.");
+    return SCM_UNDEFINED;       /* dummy */
+#endif /*GAUCHE_WINDOWS || !SCM_RIGHTS*/
+}
+
+/* Receives up to BYTES octets of payload and up to MAXFDS descriptors.
+   Returns the payload (an incomplete string) and a list of received
+   descriptors, which have close-on-exec flag set where supported. */
+ScmObj Scm_SocketRecvFds(ScmSocket *sock, int bytes, int maxfds, int flags)
+{
+#if !GAUCHE_WINDOWS && defined(SCM_RIGHTS)
+    int r;
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+
+    if (bytes <= 0) bytes = 1;
+    if (maxfds <= 0 || maxfds > SOCKET_MAX_FDS) {
+        Scm_Error("maxfds must be between 1 and %d, but got %d",
+                  SOCKET_MAX_FDS, maxfds);
+    }
+    CLOSE_CHECK(sock->fd, "recv from", sock);
+
+    char *buf = SCM_NEW_ATOMIC2(char*, bytes);
+    struct iovec iov;
+    iov.iov_base = buf;
+    iov.iov_len = bytes;
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(sizeof(int)*SOCKET_MAX_FDS)];
+    } control;
+    struct msghdr m;
+    memset(&m, 0, sizeof(m));
+    m.msg_iov = &iov;
+    m.msg_iovlen = 1;
+    m.msg_control = control.buf;
+    m.msg_controllen = CMSG_SPACE(sizeof(int)*maxfds);
+#if defined(MSG_CMSG_CLOEXEC)
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+    SCM_SYSCALL(r, recvmsg(sock->fd, &m, flags));
+    if (r < 0) Scm_SysError("recvmsg(2) failed");
+
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(&m); c != NULL;
+         c = CMSG_NXTHDR(&m, c)) {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS) continue;
+        int n = (int)((c->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        for (int i = 0; i < n; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(c) + i*sizeof(int), sizeof(int));
+#if !defined(MSG_CMSG_CLOEXEC)
+            (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+            SCM_APPEND1(h, t, SCM_MAKE_INT(fd));
+        }
+    }
+    if (m.msg_flags & MSG_CTRUNC) {
+        /* We don't leak descriptors we can't report. */
+        SCM_FOR_EACH(t, h) close(SCM_INT_VALUE(SCM_CAR(t)));
+        Scm_Error("received more than %d file descriptors", maxfds);
+    }
+    return Scm_Values2(Scm_MakeString(buf, r, r, SCM_STRING_INCOMPLETE), h);
+#else  /*GAUCHE_WINDOWS || !SCM_RIGHTS*/
+    Scm_Error("passing file descriptors is not supported on this platform.");
+    return SCM_UNDEFINED;       /* dummy */
+#endif /*GAUCHE_WINDOWS || !SCM_RIGHTS*/
+}
+
 ScmObj Scm_SocketRecv(ScmSocket *sock, int bytes, int flags)
 {
     int r;
@@ -486,6 +646,205 @@ ScmObj Scm_SocketRecvFromX(ScmSocket *sock, ScmUVector *buf,
     return Scm_Values2(Scm_MakeInteger(r), addr);
 }
 
+/* Batched datagram I/O.
+ *
+ *  Scm_SocketRecvMMsg fills the uvectors in BUFS with as many datagrams
+ *  as are available, up to the size of BUFS, waiting for at least one.
+ *  The sizes of received datagrams are stored in SIZES, and if ADDRS is
+ *  a vector, the sender addresses in it; an existing sockaddr of
+ *  the same family is overwritten to avoid allocation, otherwise
+ *  a new one is stored.  Returns the number of datagrams received,
+ *  which is 0 if SOCK is non-blocking and nothing is available.
+ *
+ *  Scm_SocketSendMMsg sends the messages in MSGS, each of which is
+ *  a uvector or a string.  TO is #f (SOCK is connected), a sockaddr to
+ *  send all messages to, or a vector of sockaddrs.  Returns the number
+ *  of messages sent, which may be less than the number of MSGS.
+ *
+ *  With recvmmsg(2)/sendmmsg(2) it takes one system call per batch.
+ *  Elsewhere we loop recvfrom/sendto; for receiving, messages after
+ *  the first one are taken with MSG_DONTWAIT, so the semantics is
+ *  the same.
+ */
+
+#define MMSG_MAX 1024           /* upper limit of the batch size */
+
+static ScmObj store_sockaddr(ScmObj old, struct sockaddr_storage *from,
+                             socklen_t fromlen)
+{
+    if (Scm_SockAddrP(old) && SCM_SOCKADDR_FAMILY(old) == from->ss_family) {
+        memcpy(&SCM_SOCKADDR(old)->addr, from, SCM_SOCKADDR(old)->addrlen);
+        return old;
+    }
+    return Scm_MakeSockAddr(NULL, (struct sockaddr*)from, fromlen);
+}
+
+ScmObj Scm_SocketRecvMMsg(ScmSocket *sock, ScmVector *bufs, ScmVector *sizes,
+                          ScmObj addrs, int flags)
+{
+    int n = SCM_VECTOR_SIZE(bufs), r;
+
+    CLOSE_CHECK(sock->fd, "recv from", sock);
+    if (n > MMSG_MAX) n = MMSG_MAX;
+    if (SCM_VECTOR_SIZE(sizes) < n) {
+        Scm_Error("size vector too short, must be at least %d: %S", n, sizes);
+    }
+    if (!SCM_FALSEP(addrs)) {
+        if (!SCM_VECTORP(addrs)) {
+            Scm_TypeError("addrs", "vector or #f", addrs);
+        }
+        if (SCM_VECTOR_SIZE(addrs) < n) {
+            Scm_Error("address vector too short, must be at least %d: %S",
+                      n, addrs);
+        }
+    }
+    if (n == 0) return SCM_MAKE_INT(0);
+
+    struct sockaddr_storage *from =
+        SCM_NEW_ATOMIC_ARRAY(struct sockaddr_storage, n);
+    int *len = SCM_NEW_ATOMIC_ARRAY(int, n);
+    socklen_t *fromlen = SCM_NEW_ATOMIC_ARRAY(socklen_t, n);
+
+#if defined(HAVE_RECVMMSG)
+    /* The buffers are kept alive by BUFS, so atomic allocation is ok. */
+    struct mmsghdr *hdrs = SCM_NEW_ATOMIC_ARRAY(struct mmsghdr, n);
+    struct iovec *iov = SCM_NEW_ATOMIC_ARRAY(struct iovec, n);
+    memset(hdrs, 0, sizeof(struct mmsghdr)*n);
+    for (int i=0; i<n; i++) {
+        ScmObj b = SCM_VECTOR_ELEMENT(bufs, i);
+        u_int size;
+        if (!SCM_UVECTORP(b)) Scm_TypeError("buffer", "uniform vector", b);
+        iov[i].iov_base = get_message_buffer(SCM_UVECTOR(b), &size);
+        iov[i].iov_len = size;
+        hdrs[i].msg_hdr.msg_iov = &iov[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+        if (!SCM_FALSEP(addrs)) {
+            hdrs[i].msg_hdr.msg_name = &from[i];
+            hdrs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+    }
+    SCM_SYSCALL(r, recvmmsg(sock->fd, hdrs, n, flags|MSG_WAITFORONE, NULL));
+    if (r < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return SCM_MAKE_INT(0);
+        Scm_SysError("recvmmsg(2) failed");
+    }
+    for (int i=0; i<r; i++) {
+        len[i] = (int)hdrs[i].msg_len;
+        fromlen[i] = hdrs[i].msg_hdr.msg_namelen;
+    }
+#else  /*!HAVE_RECVMMSG*/
+    int i;
+    for (i=0; i<n; i++) {
+        ScmObj b = SCM_VECTOR_ELEMENT(bufs, i);
+        u_int size;
+        int rr, fl = flags;
+        if (!SCM_UVECTORP(b)) Scm_TypeError("buffer", "uniform vector", b);
+        char *z = get_message_buffer(SCM_UVECTOR(b), &size);
+        if (i > 0) {
+#if defined(MSG_DONTWAIT)
+            fl |= MSG_DONTWAIT;
+#else
+            break;              /* we can't peek without blocking */
+#endif
+        }
+        fromlen[i] = sizeof(struct sockaddr_storage);
+        SCM_SYSCALL(rr, recvfrom(sock->fd, z, size, fl,
+                                 (struct sockaddr*)&from[i], &fromlen[i]));
+        if (rr < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (i > 0) break;   /* report what we've got */
+            Scm_SysError("recvfrom(2) failed");
+        }
+        len[i] = rr;
+    }
+    r = i;
+#endif /*!HAVE_RECVMMSG*/
+
+    for (int i=0; i<r; i++) {
+        SCM_VECTOR_ELEMENT(sizes, i) = SCM_MAKE_INT(len[i]);
+        if (!SCM_FALSEP(addrs)) {
+            SCM_VECTOR_ELEMENT(addrs, i) =
+                store_sockaddr(SCM_VECTOR_ELEMENT(addrs, i),
+                               &from[i], fromlen[i]);
+        }
+    }
+    return SCM_MAKE_INT(r);
+}
+
+ScmObj Scm_SocketSendMMsg(ScmSocket *sock, ScmVector *msgs, ScmObj to,
+                          int flags)
+{
+    int n = SCM_VECTOR_SIZE(msgs), r;
+
+    CLOSE_CHECK(sock->fd, "send to", sock);
+    if (n > MMSG_MAX) n = MMSG_MAX;
+    if (SCM_VECTORP(to)) {
+        if (SCM_VECTOR_SIZE(to) < n) {
+            Scm_Error("address vector too short, must be at least %d: %S",
+                      n, to);
+        }
+        for (int i=0; i<n; i++) {
+            if (!Scm_SockAddrP(SCM_VECTOR_ELEMENT(to, i))) {
+                Scm_TypeError("destination", "socket address",
+                              SCM_VECTOR_ELEMENT(to, i));
+            }
+        }
+    } else if (!SCM_FALSEP(to) && !Scm_SockAddrP(to)) {
+        Scm_TypeError("to", "socket address, vector of them, or #f", to);
+    }
+    if (n == 0) return SCM_MAKE_INT(0);
+
+#define MMSG_DEST(i) \
+    (SCM_VECTORP(to)? SCM_SOCKADDR(SCM_VECTOR_ELEMENT(to, i)) \
+     : SCM_FALSEP(to)? NULL : SCM_SOCKADDR(to))
+
+#if defined(HAVE_SENDMMSG)
+    struct mmsghdr *hdrs = SCM_NEW_ATOMIC_ARRAY(struct mmsghdr, n);
+    struct iovec *iov = SCM_NEW_ATOMIC_ARRAY(struct iovec, n);
+    memset(hdrs, 0, sizeof(struct mmsghdr)*n);
+    for (int i=0; i<n; i++) {
+        u_int size;
+        iov[i].iov_base = (void*)get_message_body(SCM_VECTOR_ELEMENT(msgs, i),
+                                                  &size);
+        iov[i].iov_len = size;
+        hdrs[i].msg_hdr.msg_iov = &iov[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+        ScmSockAddr *dest = MMSG_DEST(i);
+        if (dest) {
+            hdrs[i].msg_hdr.msg_name = &dest->addr;
+            hdrs[i].msg_hdr.msg_namelen = dest->addrlen;
+        }
+    }
+    SCM_SYSCALL(r, sendmmsg(sock->fd, hdrs, n, flags));
+    if (r < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return SCM_MAKE_INT(0);
+        Scm_SysError("sendmmsg(2) failed");
+    }
+#else  /*!HAVE_SENDMMSG*/
+    int i;
+    for (i=0; i<n; i++) {
+        u_int size;
+        int rr;
+        const char *cmsg = get_message_body(SCM_VECTOR_ELEMENT(msgs, i), &size);
+        ScmSockAddr *dest = MMSG_DEST(i);
+        if (dest) {
+            SCM_SYSCALL(rr, sendto(sock->fd, cmsg, size, flags,
+                                   &dest->addr, dest->addrlen));
+        } else {
+            SCM_SYSCALL(rr, send(sock->fd, cmsg, size, flags));
+        }
+        if (rr < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (i > 0) break;   /* report what we've sent */
+            Scm_SysError("sendto(2) failed");
+        }
+    }
+    r = i;
+#endif /*!HAVE_SENDMMSG*/
+#undef MMSG_DEST
+    return SCM_MAKE_INT(r);
+}
+
 /* Low level message builder */
 ScmObj Scm_SocketBuildMsg(ScmSockAddr *name, ScmVector *iov,
                           ScmObj control, int flags,
@@ -48,6 +48,7 @@
           socket-getsockname socket-getpeername socket-ioctl
           socket-send socket-sendto socket-sendmsg socket-buildmsg
           socket-recv socket-recv! socket-recvfrom socket-recvfrom!
+          socket-recvmmsg! socket-sendmmsg socket-send-fds socket-recv-fds
           <sockaddr> <sockaddr-in> <sockaddr-un> make-sockaddrs
           sockaddr-name sockaddr-family sockaddr-addr sockaddr-port
           make-client-socket make-server-socket make-server-sockets
@@ -74,6 +75,7 @@
  SO_RCVTIMEO SO_REUSEADDR SO_REUSEPORT SO_SNDBUF SO_SNDLOWAT
  SO_SNDTIMEO SO_TIMESTAMP SO_TYPE
  SOL_TCP TCP_NODELAY TCP_MAXSEG TCP_CORK
+ SOL_UDP UDP_SEGMENT UDP_GRO
  SOL_IP IP_OPTIONS
  IP_PKTINFO IP_RECVTOS IP_RECVTTL IP_RECVOPTS IP_TOS
  IP_TTL IP_HDRINCL IP_RECVERR IP_MTU_DISCOVER IP_MTU
@@ -134,6 +134,7 @@
          (error "unsupported protocol:" proto)]))
 
 (define (make-server-socket-from-addr addr :key (reuse-addr? #f)
+                                                (reuse-port? #f)
                                                 (sock-init #f)
                                                 (backlog DEFAULT_BACKLOG))
   (rlet1 socket (make-socket (address->protocol-family addr) SOCK_STREAM)
@@ -141,6 +142,14 @@
       (sock-init socket addr))
     (when reuse-addr?
       (socket-setsockopt socket SOL_SOCKET SO_REUSEADDR 1))
+    (when reuse-port?
+      ;; SO_REUSEPORT may not be defined on the platform
+      (let1 opt (global-variable-ref (find-module 'gauche.net)
+                                     'SO_REUSEPORT #f)
+        (unless opt
+          (socket-close socket)
+          (error "reuse-port? isn't supported on this platform"))
+        (socket-setsockopt socket SOL_SOCKET opt 1)))
     (socket-bind socket addr)
     (socket-listen socket backlog)))
 
@@ -172,6 +181,30 @@
 ;; open both (first v6, then v4) and if the latter fails to bind
 ;; we assume v6 socket listens both.
 (define (make-server-sockets host port . args)
+  (let1 shards (get-keyword :shards args #f)
+    (if shards
+      (make-sharded-server-sockets host port shards
+                                   (delete-keyword :shards args))
+      (apply make-server-sockets-1 host port args))))
+
+;; With :shards N, we make N sets of listening sockets on the same port
+;; with SO_REUSEPORT, so that each worker thread can run its own accept
+;; loop on its set and the kernel distributes incoming connections among
+;; them.  If PORT is 0, the actual port taken by the first set is used
+;; for the rest.
+(define (make-sharded-server-sockets host port shards args)
+  (unless (and (exact-integer? shards) (positive? shards))
+    (error "shards must be a positive exact integer, but got:" shards))
+  (let* ([args (list* :reuse-port? #t (delete-keyword :reuse-port? args))]
+         [first (apply make-server-sockets-1 host port args)]
+         [port (if (zero? port)
+                 (sockaddr-port (socket-address (car first)))
+                 port)])
+    (cons first
+          (list-tabulate (- shards 1)
+                         (^_ (apply make-server-sockets-1 host port args))))))
+
+(define (make-server-sockets-1 host port . args)
   (define (v4addrs ss)
     (filter (^s (eq? (sockaddr-family s) 'inet)) ss))
   (define (v6addrs ss)
@@ -219,8 +219,12 @@
 (define-cproc socket-listen (sock::<socket> backlog::<fixnum>)
   Scm_SocketListen)
 
-(define-cproc socket-accept (sock::<socket>)
-  Scm_SocketAccept)
+(define-cproc socket-accept (sock::<socket>
+                             :key (nonblocking::<boolean> #f)
+                                  (cloexec::<boolean> #f))
+  (return (Scm_SocketAcceptWithFlags
+           sock (logior (?: nonblocking SCM_SOCKET_NONBLOCK 0)
+                        (?: cloexec SCM_SOCKET_CLOEXEC 0)))))
 
 (define-cproc socket-connect (sock::<socket> addr::<socket-address>)
   Scm_SocketConnect)
@@ -242,6 +246,16 @@
 (define-cproc socket-sendmsg (sock::<socket> msg :optional (flags::<fixnum> 0))
   Scm_SocketSendMsg)
 
+;; file descriptor passing.  See the comment in net.c.
+(define-cproc socket-send-fds (sock::<socket> fds::<list>
+                               :optional (msg "") (flags::<fixnum> 0))
+  Scm_SocketSendFds)
+
+(define-cproc socket-recv-fds (sock::<socket> bytes::<fixnum>
+                               :optional (maxfds::<fixnum> 1)
+                                         (flags::<fixnum> 0))
+  Scm_SocketRecvFds)
+
 (define-cproc socket-recv (sock::<socket> bytes::<fixnum>
                            :optional (flags::<fixnum> 0))
   Scm_SocketRecv)
@@ -258,6 +272,15 @@
                                 :optional (flags::<fixnum> 0))
   Scm_SocketRecvFromX)
 
+;; Batched datagram I/O.  See the comment in net.c.
+(define-cproc socket-recvmmsg! (sock::<socket> bufs::<vector> sizes::<vector>
+                                :optional (addrs #f) (flags::<fixnum> 0))
+  Scm_SocketRecvMMsg)
+
+(define-cproc socket-sendmmsg (sock::<socket> msgs::<vector>
+                               :optional (to #f) (flags::<fixnum> 0))
+  Scm_SocketSendMMsg)
+
 ;; struct msghdr builder
 (define-cproc socket-buildmsg (name::<socket-address>?
                                iov::<vector>?
@@ -305,6 +328,10 @@
 (define-enum-conditionally TCP_MAXSEG)
 (define-enum-conditionally TCP_CORK)
 
+(define-enum-conditionally SOL_UDP)
+(define-enum-conditionally UDP_SEGMENT) ; Linux GSO
+(define-enum-conditionally UDP_GRO)     ; Linux GRO
+
 (define-enum-conditionally SOL_IP)
 (define-enum-conditionally IP_OPTIONS)
 (define-enum-conditionally IP_PKTINFO)
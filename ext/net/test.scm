@@ -415,6 +415,34 @@
            (receive (pid code) (sys-wait)
              (sys-wait-exit-status code)))))
 
+(cond-expand
+ [gauche.os.windows]
+ [else
+  (use gauche.fcntl)
+  (let* ([serv (make-server-socket 'inet 0 :reuse-addr? #t)]
+         [port (sockaddr-port (socket-address serv))]
+         [clnt (make-client-socket 'inet "localhost" port)])
+    (test* "socket-accept :nonblocking :cloexec" '(#t #t "hi")
+           (let1 s (socket-accept serv :nonblocking #t :cloexec #t)
+             (display "hi\n" (socket-output-port clnt))
+             (flush (socket-output-port clnt))
+             (begin0
+               (list (logtest (sys-fcntl (socket-fd s) F_GETFL) O_NONBLOCK)
+                     (logtest (sys-fcntl (socket-fd s) F_GETFD) FD_CLOEXEC)
+                     (read-line (socket-input-port s)))
+               (socket-close s))))
+    (socket-close clnt)
+    (socket-close serv))])
+
+(when (global-variable-bound? 'gauche.net 'SO_REUSEPORT)
+  (test* "make-server-sockets :shards" '(3 #t)
+         (let* ([shards (make-server-sockets #f 0 :shards 3)]
+                [ports (map (^s (sockaddr-port (socket-address s)))
+                            (concatenate shards))])
+           (begin0 (list (length shards)
+                         (every (cut = (car ports) <>) ports))
+             (for-each socket-close (concatenate shards))))))
+
 
 (cond-expand
  [gauche.net.ipv6
@@ -542,6 +570,29 @@
                 (list (eq? f-addr from)
                       (equal? buf data))))))))
 
+;; On Windows, the fallback of socket-recvmmsg! takes one datagram
+;; at a time.
+(cond-expand
+ [gauche.os.windows]
+ [else
+  (with-sr-udp
+   (^[s-sock s-addr r-sock r-addr]
+     (let ([bufs (vector-tabulate 4 (^_ (make-u8vector 16 0)))]
+           [sizes (make-vector 4 #f)]
+           [addrs (vector (make <sockaddr-in>) #f #f #f)])
+       (test* "udp socket-sendmmsg" 3
+              (socket-sendmmsg s-sock (vector "abc" "defg" '#u8(1 2 3 4 5))
+                               s-addr))
+       (test* "udp socket-recvmmsg!" '(3 #(3 4 5 #f) #t #t
+                                       ("abc" "defg" #u8(1 2 3 4 5)))
+              (let1 n (socket-recvmmsg! r-sock bufs sizes addrs)
+                (list n sizes
+                      (is-a? (vector-ref addrs 0) <sockaddr-in>)
+                      (is-a? (vector-ref addrs 2) <sockaddr-in>)
+                      (list (u8vector->string (vector-ref bufs 0) 0 3)
+                            (u8vector->string (vector-ref bufs 1) 0 4)
+                            (u8vector-copy (vector-ref bufs 2) 0 5))))))))])
+
 (cond-expand
  ;; NB: as of 0.9, sendmsg fails on cygwin.  We don't have time to track
  ;; it down yet.  For now, we skip the tests.
@@ -570,6 +621,26 @@
        (test* "udp sendmsg w/o sendbuf" '(#t #t) (xtest #f)))))]
  [else #f])
 
+(cond-expand
+ [gauche.os.windows #f]
+ [else
+  (sys-unlink "fds.o")
+  (test* "socket-send-fds/socket-recv-fds" '("ok" 1 "hello")
+         (let* ([srv (make-server-socket 'unix "fds.o")]
+                [clnt (make-client-socket 'unix "fds.o")]
+                [conn (socket-accept srv)])
+           (receive (in out) (sys-pipe)
+             (socket-send-fds clnt (list (port-file-number out)) "ok")
+             (close-output-port out)
+             (receive (msg fds) (socket-recv-fds conn 10)
+               (let1 p (open-output-fd-port (car fds) :owner? #t)
+                 (display "hello" p)
+                 (close-output-port p))
+               (begin0 (list (string-incomplete->complete msg) (length fds)
+                             (read-line in))
+                 (for-each socket-close (list clnt conn srv)))))))
+  (sys-unlink "fds.o")])
+
 ;;-----------------------------------------------------------------
 (test-section "srfi-106")
 
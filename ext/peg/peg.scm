@@ -60,7 +60,7 @@
           $sep-by $end-by $sep-end-by
           $count $between $followed-by
           $not $many-till $chain-left $chain-right
-          $lazy
+          $lazy $memo
 
           $s $c $y
           $string $string-ci
@@ -240,11 +240,19 @@
 ;; API
 ;;   Default driver.  Returns parsed value and next stream
 (define (peg-run-parser parser s)
-  (receive (r v s1) (parser s)
+  (receive (r v s1) (%run parser s)
     (if (parse-success? r)
       (values (rope-finalize v) s1)
       (raise (construct-peg-parser-error r v s s1)))))
 
+;; Memo tables of $memo parsers for the current run of a driver,
+;; keyed by each $memo parser.
+(define %memo-tables (make-parameter #f))
+
+(define (%run parser s)
+  (parameterize ([%memo-tables (make-hash-table 'eq?)])
+    (parser s)))
+
 ;; Coerce something to lseq.  accepts generator.
 ;; We check applicability of x->lseq first, since an object can be both
 ;; passed to x->lseq and applicable as a thunk, but x->lseq should take
@@ -275,7 +283,7 @@
   (let1 s (%->lseq src)
     (^[] (if (null? s)
            (eof-object)
-           (receive (r v s1) (parser s)
+           (receive (r v s1) (%run parser s)
              (cond [(not (parse-success? r))
                     (raise (construct-peg-parser-error r v s s1))]
                    [(eof-object? v) (set! s '()) v]
@@ -324,10 +332,12 @@
 ;; return a parser that tries PARSE.  On success, returns what it
 ;; returned.  On failure, returns 'fail-expect with MSG.
 (define ($expect parse msg)
-  (^s (receive (r v ss) (parse s)
-        (if (parse-success? r)
-          (values r v ss)
-          (return-failure/expect msg s)))))
+  (if-let1 info (%char-parser-info parse)
+    (%char-parser (vector-ref info 0) (vector-ref info 1) msg)
+    (^s (receive (r v ss) (parse s)
+          (if (parse-success? r)
+            (values r v ss)
+            (return-failure/expect msg s))))))
 
 ;; a parser that merely returns 'fail-unexpect with MSG.
 (define ($unexpect msg s) (^_ (return-failure/unexpect msg s)))
@@ -337,6 +347,109 @@
 ;; upper bound by #f.
 (define-inline (>=? count max) (and max (>= count max)))
 
+;;;============================================================
+;;; Character parsers
+;;;
+
+;; Parsers that match a single character are created by %char-parser,
+;; so that $seq, $or, $many and $skip-many can recognize them and
+;; run a loop over the input instead of calling them for each character.
+;;
+;; Such a parser returns its descriptor when it's given %probe.  We
+;; only do so after checking the parser's code, so other parsers never
+;; see %probe.  The descriptor is #(char-set pred expect fail):
+;; a character matches if it's in char-set, or satisfies pred when
+;; char-set is #f.  On mismatch the parser returns fail-expect with
+;; expect, or the result of (fail s) when fail isn't #f.
+
+(define %probe (list 'probe))
+
+(define (%char-parser cs pred expect :optional (fail #f))
+  (let1 info (vector cs pred expect fail)
+    (if cs
+      (^s (cond [(and (pair? s) (char-set-contains? cs (car s)))
+                 (return-result (car s) (cdr s))]
+                [(eq? s %probe) info]
+                [fail (fail s)]
+                [else (return-failure/expect expect s)]))
+      (^s (cond [(and (pair? s) (pred (car s)))
+                 (return-result (car s) (cdr s))]
+                [(eq? s %probe) info]
+                [fail (fail s)]
+                [else (return-failure/expect expect s)])))))
+
+(define %char-parser-codes
+  (list (closure-code (%char-parser #[] #f #f))
+        (closure-code (%char-parser #f values #f))))
+
+(define (%char-parser-info parse)
+  (and (closure? parse)
+       (memq (closure-code parse) %char-parser-codes)
+       (parse %probe)))
+
+;; Returns a list of descriptors if all of PARSERS are character parsers.
+(define (%char-parser-infos parsers)
+  (let loop ([ps parsers] [infos '()])
+    (cond [(null? ps) (reverse! infos)]
+          [(%char-parser-info (car ps)) => (^i (loop (cdr ps) (cons i infos)))]
+          [else #f])))
+
+(define-inline (%char-match? info c)
+  (if-let1 cs (vector-ref info 0)
+    (char-set-contains? cs c)
+    ((vector-ref info 1) c)))
+
+(define-inline (%char-fail info s)
+  (if-let1 fail (vector-ref info 3)
+    (fail s)
+    (return-failure/expect (vector-ref info 2) s)))
+
+;; Expands EXPR twice, with (MATCH? c) testing the char-set directly,
+;; and calling the predicate.
+(define-syntax %with-char-match
+  (syntax-rules ()
+    [(_ info match? expr)
+     (let ([cs (vector-ref info 0)] [pred (vector-ref info 1)])
+       (if cs
+         (let-syntax ([match? (syntax-rules ()
+                                [(_ c) (char-set-contains? cs c)])])
+           expr)
+         (let-syntax ([match? (syntax-rules () [(_ c) (pred c)])])
+           expr)))]))
+
+(define (%many-chars info min max)
+  (%with-char-match info match?
+    (^s (let loop ([vs '()] [s s] [count 0])
+          (cond [(>=? count max) (return-result (reverse! vs) s)]
+                [(and (pair? s) (match? (car s)))
+                 (loop (cons (car s) vs) (cdr s) (+ count 1))]
+                [(<= min count) (return-result (reverse! vs) s)]
+                [else (%char-fail info s)])))))
+
+(define (%skip-many-chars info min max)
+  (%with-char-match info match?
+    (^s (let loop ([s s] [count 0])
+          (cond [(>=? count max) (return-result #f s)]
+                [(and (pair? s) (match? (car s))) (loop (cdr s) (+ count 1))]
+                [(<= min count) (return-result #f s)]
+                [else (%char-fail info s)])))))
+
+(define (%seq-chars infos)
+  (^s (let loop ([s s] [infos infos] [v #f])
+        (cond [(null? infos) (return-result v s)]
+              [(and (pair? s) (%char-match? (car infos) (car s)))
+               (loop (cdr s) (cdr infos) (car s))]
+              [else (%char-fail (car infos) s)]))))
+
+;; The union of character parsers.  On failure, we let the original
+;; $or parser FALLBACK report the error, so that it's the same.
+(define (%or-chars infos fallback)
+  (if (every (cut vector-ref <> 0) infos)
+    (%char-parser (apply char-set-union (map (cut vector-ref <> 0) infos))
+                  #f #f fallback)
+    (%char-parser #f (^c (any (cut %char-match? <> c) infos))
+                  #f fallback)))
+
 ;;;============================================================
 ;;; Combinators
 ;;;
@@ -418,14 +531,18 @@
     [()  (^s (return-failure/message "empty $or" s))]
     [(p) p]
     [(ps ...)
-     (^s (let loop ([vs '()] [ps ps])
-           (if (null? ps)
-             (fail vs s)
-             (receive (r v s1) ((car ps) s)
-               (cond [(parse-success? r) (values r v s1)]
-                     [(eq? s s1) (loop (acons r v vs) (cdr ps))]
-                     [(null? vs) (values r v s1)]
-                     [else (fail (acons r v vs) s1)])))))]))
+     (let1 parse
+         (^s (let loop ([vs '()] [ps ps])
+               (if (null? ps)
+                 (fail vs s)
+                 (receive (r v s1) ((car ps) s)
+                   (cond [(parse-success? r) (values r v s1)]
+                         [(eq? s s1) (loop (acons r v vs) (cdr ps))]
+                         [(null? vs) (values r v s1)]
+                         [else (fail (acons r v vs) s1)])))))
+       (if-let1 infos (%char-parser-infos ps)
+         (%or-chars infos parse)
+         parse))]))
 
 ;; API
 ;; $fold-parsers proc seed parsers
@@ -463,7 +580,9 @@
 ;;   value of the last parser.
 ;;   To get all the results of p1, p2, ... in a list, use $lift* list p1 p2 ...
 (define ($seq . parsers)
-  ($fold-parsers (^[v s] v) #f parsers))
+  (if-let1 infos (and (length>=? parsers 2) (%char-parser-infos parsers))
+    (%seq-chars infos)
+    ($fold-parsers (^[v s] v) #f parsers)))
 
 ;; API
 ;; $try parser
@@ -486,6 +605,29 @@
      (let ((p (delay parse)))
        (lambda (s) ((force p) s)))]))
 
+;; API
+;; $memo p
+;;   Memoizes the result of P for each input position, so that P runs
+;;   only once at a position even if we backtrack and come back.  It
+;;   pays when a rule is tried repeatedly at the same position by
+;;   alternatives, as in packrat parsing.  The results are kept during
+;;   one run of a driver, e.g. peg-parse-string; when P is called
+;;   outside of a driver, it is not memoized.  The semantic value is
+;;   shared among the uses, so don't modify it destructively.
+(define ($memo parse)
+  (define key (list 'memo))             ;identifies this parser
+  (^s (if-let1 tables (%memo-tables)
+        (let* ([tab (or (hash-table-get tables key #f)
+                        (rlet1 t (make-hash-table 'eq?)
+                          (hash-table-put! tables key t)))]
+               [e (hash-table-get tab s #f)])
+          (if e
+            (values (vector-ref e 0) (vector-ref e 1) (vector-ref e 2))
+            (receive (r v s1) (parse s)
+              (hash-table-put! tab s (vector r v s1))
+              (values r v s1))))
+        (parse s))))
+
 ;; alternative $lazy possibility (need benchmark!)
 ;(define-syntax $lazy
 ;  (syntax-rules ()
@@ -516,22 +658,25 @@
 ;; API
 ;; $many p :optional min max
 ;; $many1 p :optional max
-(define-inline ($many parse :optional (min 0) (max #f))
+(define ($many parse :optional (min 0) (max #f))
   (%check-min-max min max)
-  (lambda (s)
-    (let loop ([vs '()] [s s] [count 0])
-      (if (>=? count max)
-        (return-result (reverse! vs) s)
-        (receive (r v s1) (parse s)
-          (cond [(parse-success? r) (loop (cons v vs) s1 (+ count 1))]
-                [(and (eq? s s1) (<= min count))
-                 (return-result (reverse! vs) s1)]
-                [else (values r v s1)]))))))
+  (if-let1 info (%char-parser-info parse)
+    (%many-chars info min max)
+    (lambda (s)
+      (let loop ([vs '()] [s s] [count 0])
+        (if (>=? count max)
+          (return-result (reverse! vs) s)
+          (receive (r v s1) (parse s)
+            (cond [(parse-success? r) (loop (cons v vs) s1 (+ count 1))]
+                  [(and (eq? s s1) (<= min count))
+                   (return-result (reverse! vs) s1)]
+                  [else (values r v s1)])))))))
 
 (define ($many1 parse :optional (max #f))
-  (if max
-    ($do [v parse] [vs ($many parse 0 (- max 1))] ($return (cons v vs)))
-    ($do [v parse] [vs ($many parse)] ($return (cons v vs)))))
+  (cond [(%char-parser-info parse) ($many parse 1 max)]
+        [max
+         ($do [v parse] [vs ($many parse 0 (- max 1))] ($return (cons v vs)))]
+        [else ($do [v parse] [vs ($many parse)] ($return (cons v vs)))]))
 
 ;; API
 ;; $skip-many p :optional min max
@@ -540,12 +685,14 @@
 ;;   This should be optimized; we don't need to retain intermediate values
 (define ($skip-many parse :optional (min 0) (max #f))
   (%check-min-max min max)
-  (if (= min 0)
-    ($do [($many parse min max)]
-         ($return #f))
-    ($do [($skip-count parse min)]
-         [($skip-many parse 0 (and max (- max min)))]
-         ($return #f))))
+  (cond [(%char-parser-info parse) => (cut %skip-many-chars <> min max)]
+        [(= min 0)
+         ($do [($many parse min max)]
+              ($return #f))]
+        [else
+         ($do [($skip-count parse min)]
+              [($skip-many parse 0 (and max (- max min)))]
+              ($return #f))]))
 
 (define ($skip-many1 parse :optional (max #f))
   (if max
@@ -745,15 +892,14 @@
             (expand char-ci=?))))
 
 (define ($char c)
-  ($satisfy (cut char=? c <>) c))
+  (%char-parser (char-set c) #f c))
 
 (define ($char-ci c)
-  ($satisfy (cut char-ci=? c <>)
-            (list->char-set c (char-upcase c) (char-downcase c))))
+  (let1 cs (list->char-set c (char-upcase c) (char-downcase c))
+    (%char-parser cs #f cs)))
 
 (define ($one-of charset)
-  ($satisfy (cut char-set-contains? charset <>)
-            charset))
+  (%char-parser charset #f charset))
 
 (define ($s x) ($string x))
 
@@ -762,7 +908,7 @@
 (define ($y x) ($lift ($ string->symbol $ rope->string $) ($s x)))
 
 ;; ($many-chars charset [min [max]]) == ($many ($one-of charset) [min [max]])
-;;   with possible optimization.
+;;   $many runs a loop over the input for a character parser.
 (define-syntax $many-chars
   (syntax-rules ()
     [(_ parser) ($many ($one-of parser))]
@@ -772,16 +918,13 @@
 (define ($none-of charset)
   ($one-of (char-set-complement charset)))
 
-(define (anychar s)
-  (if (pair? s)
-    (return-result (car s) (cdr s))
-    (return-failure/expect "character" s)))
+(define anychar (%char-parser #f (^_ #t) "character"))
 
 (define-syntax define-char-parser
   (syntax-rules ()
     ((_ proc charset expect)
      (define proc
-       ($expect ($one-of charset) expect)))))
+       (%char-parser charset #f expect)))))
 
 (define-char-parser upper    #[A-Z]         "upper case letter")
 (define-char-parser lower    #[a-z]         "lower case letter")
@@ -495,6 +495,82 @@
              "abc+efg")
   )
 
+;;;============================================================
+;;; Character parsers
+;;;
+(test-section "character parser loops")
+
+;; $seq, $or, $many etc. on character parsers run a loop over the input.
+;; The results must be the same as the ordinary combinators, which we
+;; get by hiding the parsers in closures.
+(let ()
+  (define (opaque p) (if (procedure? p) (^s (p s)) p))
+  (define (run p input)
+    (guard (e [(<parse-error> e)
+               (list 'error (ref e 'position) (ref e 'objects))])
+      (list 'ok (peg-parse-string p input))))
+  (define-syntax test-loop
+    (syntax-rules ()
+      [(_ label (combinator arg ...) inputs)
+       (dolist [input inputs]
+         (test* #"~label ~(write-to-string input)"
+                (run (combinator (opaque arg) ...) input)
+                (run (combinator arg ...) input)))]))
+  (define a ($char #\a))
+  (define b ($char-ci #\b))
+  (define d digit)
+  (define x ($satisfy (cut char=? #\x <>) "x"))   ;not a character parser
+
+  (test-loop "$many" ($many a) '("" "a" "aaab" "baa"))
+  (test-loop "$many minmax" ($many a 2 3) '("" "a" "aa" "aaaa" "ab"))
+  (test-loop "$many1" ($many1 d) '("" "1" "123x" "x1"))
+  (test-loop "$many1 max" ($many1 d 2) '("" "1" "123x"))
+  (test-loop "$skip-many" ($skip-many b 1 2) '("" "b" "BbB" "xb"))
+  (test-loop "$seq" ($seq a b d) '("" "a" "ab" "aB1" "aBx" "ab99"))
+  (test-loop "$or" ($or a b d) '("" "a" "B" "7" "x"))
+  (test-loop "$or pred" ($or a anychar) '("" "a" "z"))
+  (test-loop "$many $or" ($many ($or a b) 1) '("" "abab1" "1"))
+  (test-loop "$seq $or" ($seq ($or a d) ($or b d)) '("ab" "1b" "a2" "ax" "xa"))
+  (test-loop "$or mixed" ($or a x b) '("a" "x" "b" "c"))
+  (test-loop "$expect" ($expect ($or a b) "a or b") '("a" "b" "c"))
+  (test-loop "$many letter" ($many letter) '("foo bar" "" "123"))
+  )
+
+;;;============================================================
+;;; Memoization
+;;;
+(test-section "memoization")
+
+(let* ([count 0]
+       [word ($->string ($many1 letter))]
+       [counted ($lift (^[v] (inc! count) v) word)]
+       [m ($memo counted)]
+       [p ($or ($try ($seq m ($char #\!))) ($seq m ($char #\?)))])
+  (test* "$memo" '("abc" 1)
+         (begin (set! count 0)
+                (list (peg-parse-string ($seq p ($return "abc")) "abc?")
+                      count)))
+  (test* "without $memo" 2
+         (begin (set! count 0)
+                (peg-parse-string ($or ($try ($seq counted ($char #\!)))
+                                       ($seq counted ($char #\?)))
+                                  "abc?")
+                count))
+  (test* "$memo in each run" 2
+         (begin (set! count 0)
+                (peg-parse-string p "abc?")
+                (peg-parse-string p "abc?")
+                count))
+  (test* "$memo failure"
+         '(0 ((fail-expect . "letter") (fail-expect . "letter")))
+         (guard (e [(<parse-error> e)
+                    (list (ref e 'position) (ref e 'objects))])
+           (peg-parse-string ($or ($try ($seq m ($char #\!))) m) "123")))
+  (test* "$memo generator" '("ab" "cd")
+         (generator->list
+          (peg-parser->generator ($seq ($skip-many space) m) "ab cd")))
+  )
+
 ;;;============================================================
 ;;; Token Parsers
 ;;;
@@ -654,6 +730,7 @@
 
 (test-section "rfc.json")
 (use rfc.json)
+(use gauche.vport)
 (test-module 'rfc.json)
 
 (let ()
@@ -830,5 +907,101 @@
                                          "{\"b\":2,\"a\":1}")
        (construct-json-string (hash-table 'eq? '(a . 1) '(b . 2))))
 
+(test* "writing atoms"
+       "[1,-2,0.5,1.5,12345678901234567890,true,false,null,true,false]"
+       (construct-json-string
+        '#(1 -2 1/2 1.5 12345678901234567890 true false null #t #f)))
+(test* "writing strings"
+       "[\"a\\\"b\\\\c/\\b\\f\\n\\r\\t\\u0001\\u007f\"]"
+       (construct-json-string '#("a\"b\\c/\x08;\x0c;\n\r\t\x01;\x7f;")))
+(cond-expand
+ [gauche.ces.utf8
+  (test* "writing strings (non-ASCII)"
+         "[\"\\u00e9\\u3042\\ud83d\\ude00x\"]"
+         (construct-json-string '#("\xe9;\x3042;\x1f600;x")))]
+ [else])
+(test* "writing long strings"
+       (string-append "[\"" (make-string 10000 #\x) "\\n\"]")
+       (construct-json-string
+        (vector (string-append (make-string 10000 #\x) "\n"))))
+(test* "writing keys" "{\"a\":1,\"b\":2,\"3\":3}"
+       (construct-json-string '(("a" . 1) (b . 2) (3 . 3))))
+(test* "writing nested" "{\"a\":[{},[],{\"b\":[1,[2]]}],\"c\":[1,2,3]}"
+       (construct-json-string '(("a" . #(() #() (("b" . #(1 #(2))))))
+                                ("c" . #u8(1 2 3)))))
+(test* "writing deep nesting" 20000
+       (string-length
+        (construct-json-string
+         (let loop ([v #()] [n 1]) (if (= n 10000) v (loop (vector v) (+ n 1)))))))
+(test* "writing a hash table" "{\"a\":[1,2]}"
+       (construct-json-string (hash-table 'equal? '("a" . #(1 2)))))
+(test* "writer error (nested)" (test-error <json-construct-error>)
+       (construct-json-string '#(1 (("a" . #(+inf.0))))))
+(test* "construct-json-array" "[1,{\"a\":2},\"x\"]"
+       (call-with-output-string
+         (cut construct-json-array (list->generator '(1 (("a" . 2)) "x")) <>)))
+(test* "construct-json-array (empty)" "[]"
+       (call-with-output-string
+         (cut construct-json-array (list->generator '()) <>)))
+
+(test* "parse-json leaves the rest" '(#(1 2) #\x)
+       (with-input-from-string "[1, 2]  x"
+         (^[] (let1 v (parse-json) (list v (read-char))))))
+(test* "parse-json line count" '(#(1 2) 3)
+       (let1 p (open-input-string "[1,\n2]\n3")
+         (list (parse-json p) (port-current-line p))))
+(test* "parse-json eof" (eof-object) (parse-json-string "  "))
+
+(test* "parse error position" 6
+       (guard (e [(<json-parse-error> e) (~ e'position)])
+         (parse-json-string "[1, 2,]")))
+
+(test* "numbers" '#(12345678901234567890 -9007199254740993 1e23 1.5e-7 0.1)
+       (parse-json-string
+        "[12345678901234567890, -9007199254740993, 1e23, 15e-8, 0.1]"))
+
+(test* "deep nesting" 10000
+       (let loop ([v (parse-json-string
+                      (string-append (make-string 10000 #\[)
+                                     (make-string 10000 #\])))]
+                  [n 0])
+         (if (zero? (vector-length v)) (+ n 1) (loop (vector-ref v 0) (+ n 1)))))
+
+(test* "long strings" (make-string 100000 #\a)
+       (vector-ref (parse-json-string
+                    (string-append "[\"" (make-string 100000 #\a) "\"]"))
+                   0))
+
+(let ([str "{\"a\": [1, \"x\\ny\", {\"b\": null}], \"c\": 2.5} [true]"]
+      [val '(("a" . #(1 "x\ny" (("b" . null)))) ("c" . 2.5))])
+  ;; A port that doesn't allow peeking into its buffer
+  (define (bytewise-port)
+    (let1 p (open-input-string str)
+      (make <virtual-input-port> :getb (cut read-byte p))))
+  (test* "parse-json from a virtual port" `(,val #\[)
+         (let1 p (bytewise-port)
+           (list (parse-json p) (read-char p))))
+  (test* "parse-json* from a virtual port" `(,val #(true))
+         (parse-json* (bytewise-port)))
+  (test* "parse-json from a file" `(,val #\[)
+         (unwind-protect
+             (begin
+               (with-output-to-file "test.out" (cut display str))
+               (call-with-input-file "test.out"
+                 (^p (list (parse-json p) (read-char p)))
+                 :buffering :full))
+           (sys-unlink "test.out"))))
+
+(test* "json-event-generator"
+       '((start-object . #f) (key . "a") (start-array . #f)
+         (value . 1) (value . #t) (start-object . #f) (end-object . #f)
+         (end-array . #f) (end-object . #f) (value . "x"))
+       (parameterize ([json-special-handler (^y (eq? y 'true))])
+         (generator->list
+          (json-event-generator
+           (open-input-string "{\"a\": [1, true, {}]} \"x\"")))))
+(test* "json-event-generator error" (test-error <json-parse-error>)
+       (generator->list (json-event-generator (open-input-string "[1 2]"))))
+
 
 (test-end)
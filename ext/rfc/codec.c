@@ -0,0 +1,731 @@
+/*
+ * codec.c - base64 and quoted-printable codecs for rfc.codec
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Each codec works on a block of bytes at a time, and keeps its state
+ * between blocks in a small struct, so that the same code serves
+ * strings, u8vectors and ports.  The caller sizes the output buffer
+ * with the *_bound functions.
+ *
+ * Base64 encoding and decoding of the standard alphabet use AVX2 if
+ * the CPU has it.  As in ext/digest/sha_hw.c, those functions are
+ * compiled with per-function target attributes and selected at runtime,
+ * so no special compiler flags are needed.
+ */
+
+#include <gauche.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "codec.h"
+
+#if (defined(__x86_64__) || defined(__i386__))                          \
+    && ((defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 5)     \
+        || (defined(__clang__)                                          \
+            && (__clang_major__ > 3                                     \
+                || (__clang_major__ == 3 && __clang_minor__ >= 8))))
+#define CODEC_AVX2 1
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+#define CHUNK_SIZE 8192
+
+/*=====================================================
+ * Base64 encoder
+ */
+
+static const char b64_standard[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
+static const char b64_url_safe[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_=";
+
+typedef struct b64_encoder_rec {
+    const char *table;          /* 64 characters followed by the pad */
+    ScmSmallInt lineWidth;      /* 0 for no line breaks */
+    ScmSmallInt col;            /* current column */
+} b64_encoder;
+
+/* Encodes NGROUPS 3-byte groups of S into D, without line breaks. */
+static void b64_encode_groups_scalar(const char *table,
+                                     const unsigned char *s,
+                                     ScmSmallInt ngroups, char *d)
+{
+    for (; ngroups > 0; ngroups--, s += 3, d += 4) {
+        unsigned long v = ((unsigned long)s[0]<<16) | (s[1]<<8) | s[2];
+        d[0] = table[(v>>18)&63];
+        d[1] = table[(v>>12)&63];
+        d[2] = table[(v>>6)&63];
+        d[3] = table[v&63];
+    }
+}
+
+static void (*b64_encode_groups)(const char *, const unsigned char *,
+                                 ScmSmallInt, char *)
+    = b64_encode_groups_scalar;
+
+static void b64_encoder_init(b64_encoder *e, int lineWidth, int urlSafe)
+{
+    e->table = urlSafe ? b64_url_safe : b64_standard;
+    e->lineWidth = (lineWidth > 0) ? lineWidth : 0;
+    e->col = 0;
+}
+
+/* The maximum number of chars b64_encode writes for N bytes. */
+static ScmSmallInt b64_encode_bound(b64_encoder *e, ScmSmallInt n)
+{
+    ScmSmallInt nchars = (n + 2)/3*4;
+    if (e->lineWidth == 0) return nchars;
+    return nchars + (e->lineWidth - 1 + nchars)/e->lineWidth;
+}
+
+/* Encodes N bytes of S into D and returns the number of chars written.
+   N must be a multiple of 3 except at the end of input.  Lines are
+   broken after every lineWidth chars, including the last one, as
+   the Scheme version did. */
+static ScmSmallInt b64_encode(b64_encoder *e, const unsigned char *s,
+                              ScmSmallInt n, char *d)
+{
+    const char *table = e->table;
+    ScmSmallInt ngroups = n/3, rest = n%3;
+    ScmSmallInt nchars = ngroups*4 + (rest ? 4 : 0);
+    ScmSmallInt nlines = e->lineWidth ? (e->col + nchars)/e->lineWidth : 0;
+
+    /* We encode NLINES bytes ahead, then move the lines to the front,
+       inserting newlines.  The destination never overtakes the source. */
+    char *p = d + nlines;
+    b64_encode_groups(table, s, ngroups, p);
+    if (rest) {
+        const unsigned char *t = s + ngroups*3;
+        char *q = p + ngroups*4;
+        unsigned long v = (unsigned long)t[0] << 16;
+        if (rest == 2) v |= t[1] << 8;
+        q[0] = table[(v>>18)&63];
+        q[1] = table[(v>>12)&63];
+        q[2] = (rest == 2) ? table[(v>>6)&63] : table[64];
+        q[3] = table[64];
+    }
+    if (nlines == 0) {
+        if (e->lineWidth) e->col += nchars;
+        return nchars;
+    }
+
+    char *dst = d;
+    ScmSmallInt len = e->lineWidth - e->col, left = nchars;
+    for (ScmSmallInt i = 0; i < nlines; i++) {
+        memmove(dst, p, len);
+        dst += len;
+        p += len;
+        *dst++ = '\n';
+        left -= len;
+        len = e->lineWidth;
+    }
+    memmove(dst, p, left);
+    e->col = left;
+    return dst + left - d;
+}
+
+/*=====================================================
+ * Base64 decoder
+ */
+
+typedef struct b64_decoder_rec {
+    const signed char *table;   /* byte -> 6-bit value, or -1 */
+    int simd;                   /* TRUE if we can use b64_decode_blocks */
+    unsigned long acc;          /* bits of the incomplete group */
+    int nchars;                 /* # of chars in ACC (0..3) */
+    int done;                   /* TRUE once we see a pad character */
+} b64_decoder;
+
+static signed char b64_standard_decode[256];
+static signed char b64_url_safe_decode[256];
+
+/* Decodes 32-char blocks of [s, s+n) while they only contain chars of
+   the standard alphabet.  Returns the number of chars consumed (the
+   output is 3/4 of it, but up to 8 more bytes are clobbered).  If it
+   stops at a block with other chars, *BAD is set to the index of
+   the first of such char relative to the stop position; otherwise -1. */
+static ScmSmallInt (*b64_decode_blocks)(const unsigned char *, ScmSmallInt,
+                                        unsigned char *, ScmSmallInt *)
+    = NULL;
+
+static void b64_decoder_init(b64_decoder *dc, int urlSafe)
+{
+    dc->table = urlSafe ? b64_url_safe_decode : b64_standard_decode;
+    dc->simd = (!urlSafe && b64_decode_blocks != NULL);
+    dc->acc = 0;
+    dc->nchars = 0;
+    dc->done = FALSE;
+}
+
+/* The output size of b64_decode for N chars, including the room
+   b64_decode_blocks needs. */
+static ScmSmallInt b64_decode_bound(ScmSmallInt n)
+{
+    return n/4*3 + 3 + 32;
+}
+
+static unsigned char *b64_flush(b64_decoder *dc, unsigned char *d)
+{
+    switch (dc->nchars) {
+    case 2: *d++ = (unsigned char)(dc->acc >> 4); break;
+    case 3:
+        *d++ = (unsigned char)(dc->acc >> 10);
+        *d++ = (unsigned char)(dc->acc >> 2);
+        break;
+    }
+    dc->acc = 0;
+    dc->nchars = 0;
+    return d;
+}
+
+/* Decodes [s, s+n) into D and returns the number of bytes written.
+   Chars that aren't in the alphabet are ignored; the pad character
+   ends the input.  If FINAL, the incomplete group is flushed. */
+static ScmSmallInt b64_decode(b64_decoder *dc, const unsigned char *s,
+                              ScmSmallInt n, unsigned char *d, int final)
+{
+    const unsigned char *e = s + n, *nosimd = s;
+    unsigned char *d0 = d;
+    const signed char *table = dc->table;
+    unsigned long acc = dc->acc;
+    int k = dc->nchars;
+
+    if (dc->done) return 0;
+    while (s < e) {
+        if (k == 0 && dc->simd && s >= nosimd && e - s >= 32) {
+            ScmSmallInt bad;
+            ScmSmallInt m = b64_decode_blocks(s, e - s, d, &bad);
+            s += m;
+            d += m/4*3;
+            if (bad >= 0) nosimd = s + bad + 1;
+            if (s >= e) break;
+        }
+        int c = *s++;
+        int v = table[c];
+        if (v < 0) {
+            if (c == '=') { dc->done = TRUE; break; }
+            continue;
+        }
+        acc = (acc << 6) | v;
+        if (++k == 4) {
+            d[0] = (unsigned char)(acc >> 16);
+            d[1] = (unsigned char)(acc >> 8);
+            d[2] = (unsigned char)acc;
+            d += 3;
+            acc = 0;
+            k = 0;
+        }
+    }
+    dc->acc = acc;
+    dc->nchars = k;
+    if (final || dc->done) d = b64_flush(dc, d);
+    return d - d0;
+}
+
+/*=====================================================
+ * AVX2 base64
+ *
+ *  The algorithms are Wojciech Mula's: a vpshufb gathers the bytes of
+ *  each 3-byte group into a 32-bit lane, multiplications move the 6-bit
+ *  fields into place, and vpshufb on a small table maps the ranges
+ *  to ASCII.  Decoding classifies each char by its nibbles, which
+ *  rejects any block containing a char outside of the alphabet.
+ */
+
+#if CODEC_AVX2
+AVX2_TARGET
+static void b64_encode_groups_avx2(const char *table,
+                                   const unsigned char *s,
+                                   ScmSmallInt ngroups, char *d)
+{
+    int urlSafe = (table[62] == '-');
+    const __m256i shuf = _mm256_set_epi8(10, 11,  9, 10,  7,  8,  6,  7,
+                                          4,  5,  3,  4,  1,  2,  0,  1,
+                                         10, 11,  9, 10,  7,  8,  6,  7,
+                                          4,  5,  3,  4,  1,  2,  0,  1);
+    /* Offsets to add to the 6-bit value for A-Z, a-z, 0-9, 62 and 63. */
+    const char c62 = urlSafe ? '-' - 62 : '+' - 62;
+    const char c63 = urlSafe ? '_' - 63 : '/' - 63;
+    const __m256i lut = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4,
+                                         -4, -4, -4, -4, c62, c63, 0, 0,
+                                         65, 71, -4, -4, -4, -4, -4, -4,
+                                         -4, -4, -4, -4, c62, c63, 0, 0);
+
+    /* Each iteration reads 28 bytes, of which it consumes 24. */
+    while (ngroups >= 10) {
+        __m128i lo = _mm_loadu_si128((const __m128i*)s);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(s + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo),
+                                             hi, 1);
+        in = _mm256_shuffle_epi8(in, shuf);
+        __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i idx = _mm256_or_si256(t1, t3);
+
+        __m256i r = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        __m256i gt = _mm256_cmpgt_epi8(idx, _mm256_set1_epi8(25));
+        r = _mm256_sub_epi8(r, gt);
+        __m256i out = _mm256_add_epi8(idx, _mm256_shuffle_epi8(lut, r));
+        _mm256_storeu_si256((__m256i*)d, out);
+        s += 24;
+        d += 32;
+        ngroups -= 8;
+    }
+    b64_encode_groups_scalar(table, s, ngroups, d);
+}
+
+AVX2_TARGET
+static ScmSmallInt b64_decode_blocks_avx2(const unsigned char *s,
+                                          ScmSmallInt n,
+                                          unsigned char *d,
+                                          ScmSmallInt *bad)
+{
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+        0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+        0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0,  16,  19,   4, -65, -65, -71, -71,
+        0,   0,   0,   0,   0,   0,   0,   0,
+        0,  16,  19,   4, -65, -65, -71, -71,
+        0,   0,   0,   0,   0,   0,   0,   0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i pack = _mm256_setr_epi8(
+        2,  1,  0,  6,  5,  4, 10,  9,  8, 14, 13, 12, -1, -1, -1, -1,
+        2,  1,  0,  6,  5,  4, 10,  9,  8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+    ScmSmallInt i = 0;
+
+    *bad = -1;
+    for (; n - i >= 32; i += 32, d += 24) {
+        __m256i str = _mm256_loadu_si256((const __m256i*)(s + i));
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4),
+                                              mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        __m256i chk = _mm256_and_si256(lo, hi);
+        if (!_mm256_testz_si256(chk, chk)) {
+            unsigned int ok = (unsigned int)_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(chk, _mm256_setzero_si256()));
+            *bad = __builtin_ctz(~ok);
+            break;
+        }
+        __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll,
+                                           _mm256_add_epi8(eq_2f, hi_nibbles));
+        str = _mm256_add_epi8(str, roll);
+
+        __m256i ab_bc = _mm256_maddubs_epi16(str,
+                                             _mm256_set1_epi32(0x01400140));
+        __m256i out = _mm256_madd_epi16(ab_bc, _mm256_set1_epi32(0x00011000));
+        out = _mm256_shuffle_epi8(out, pack);
+        out = _mm256_permutevar8x32_epi32(out, perm);
+        _mm256_storeu_si256((__m256i*)d, out);
+    }
+    return i;
+}
+#endif /*CODEC_AVX2*/
+
+/*=====================================================
+ * Quoted-printable encoder
+ */
+
+typedef struct qp_encoder_rec {
+    ScmSmallInt limit;          /* soft break after this column, or 0 */
+    int binary;                 /* encode CR and LF */
+    int pendingCR;              /* the last block ended with CR */
+    ScmSmallInt lcnt;           /* current column */
+} qp_encoder;
+
+/* Bytes we pass through.  We escape '?' as well, for it interferes
+   the header field encoding defined in RFC2047. */
+static char qp_literal[256];
+
+static const char hexdigits[] = "0123456789ABCDEF";
+
+/* The minimum line width is 4, since one encoded octet and one soft
+   line break requires 4 characters. */
+static void qp_encoder_init(qp_encoder *q, int lineWidth, int binary)
+{
+    q->limit = (lineWidth >= 4) ? lineWidth - 3 : 0;
+    q->binary = binary;
+    q->pendingCR = FALSE;
+    q->lcnt = 0;
+}
+
+static ScmSmallInt qp_encode_bound(ScmSmallInt n)
+{
+    return n*6 + 8;
+}
+
+#define PUT_CRLF(p)  (*(p)++ = '\r', *(p)++ = '\n')
+
+/* Encodes [s, s+n) into D and returns the number of chars written.
+   A CR at the end of a block is held until we see the next byte,
+   unless FINAL. */
+static ScmSmallInt qp_encode(qp_encoder *q, const unsigned char *s,
+                             ScmSmallInt n, char *d, int final)
+{
+    const unsigned char *e = s + n;
+    char *p = d;
+    ScmSmallInt limit = q->limit, lcnt = q->lcnt;
+
+    if (q->pendingCR && (s < e || final)) {
+        PUT_CRLF(p);
+        lcnt = 0;
+        q->pendingCR = FALSE;
+        if (s < e && *s == 0x0a) s++;
+    }
+    while (s < e) {
+        if (limit && lcnt >= limit) {
+            *p++ = '=';
+            PUT_CRLF(p);
+            lcnt = 0;
+        }
+        /* Fast path for a run of literal bytes */
+        ScmSmallInt room = limit ? limit - lcnt : e - s;
+        const unsigned char *t = s;
+        if (room > e - s) room = e - s;
+        while (t < s + room && qp_literal[*t]) t++;
+        if (t > s) {
+            memcpy(p, s, t - s);
+            p += t - s;
+            lcnt += t - s;
+            s = t;
+            continue;
+        }
+
+        unsigned int c = *s++;
+        if (q->binary && (c == 0x0a || c == 0x0d)) {
+            *p++ = '='; *p++ = '0'; *p++ = hexdigits[c];
+            lcnt++;
+        } else if (c == 0x0d) {
+            if (s < e) {
+                if (*s == 0x0a) s++;
+            } else if (!final) {
+                q->pendingCR = TRUE;
+                break;
+            }
+            PUT_CRLF(p);
+            lcnt = 0;
+        } else if (c == 0x0a) {
+            PUT_CRLF(p);
+            lcnt = 0;
+        } else {
+            *p++ = '=';
+            *p++ = hexdigits[c >> 4];
+            *p++ = hexdigits[c & 0x0f];
+            lcnt += 3;
+        }
+    }
+    q->lcnt = lcnt;
+    return p - d;
+}
+
+/*=====================================================
+ * Quoted-printable decoder
+ */
+
+static inline int hexval(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+/* Decodes [s, s+n) into D, which needs N bytes, and returns the number
+   of bytes written.  Unless FINAL, we stop before a '=' whose meaning
+   depends on what follows the block; *CONSUMED is set to the number of
+   bytes we've taken.  Malformed sequences are passed through. */
+static ScmSmallInt qp_decode(const unsigned char *s, ScmSmallInt n,
+                             unsigned char *d, int final,
+                             ScmSmallInt *consumed)
+{
+    const unsigned char *s0 = s, *e = s + n;
+    unsigned char *p = d;
+
+    while (s < e) {
+        const unsigned char *z = memchr(s, '=', e - s);
+        if (z == NULL) {
+            memcpy(p, s, e - s);
+            p += e - s;
+            s = e;
+            break;
+        }
+        memcpy(p, s, z - s);
+        p += z - s;
+        s = z;
+
+        /* An incomplete sequence at the end of input is a soft newline,
+           except a hex digit, which we take literally. */
+        if (s + 1 >= e) { if (final) s = e; break; }
+        int c1 = s[1];
+        if (c1 == '\n') { s += 2; continue; }
+        if (c1 == '\r') {
+            if (s + 2 >= e) { if (final) s = e; break; }
+            s += (s[2] == '\n') ? 3 : 2;
+            continue;
+        }
+        if (c1 == ' ' || c1 == '\t') {
+            /* possibly a soft newline with trailing whitespaces */
+            const unsigned char *t = s + 2;
+            while (t < e && (*t == ' ' || *t == '\t')) t++;
+            if (t >= e) { if (final) s = e; break; }
+            if (*t == '\n') { s = t + 1; continue; }
+            if (*t == '\r') {
+                if (t + 1 >= e) { if (final) s = e; break; }
+                s = (t[1] == '\n') ? t + 2 : t + 1;
+                continue;
+            }
+            memcpy(p, s, t - s);
+            p += t - s;
+            s = t;
+            continue;
+        }
+        int h1 = hexval(c1);
+        if (h1 >= 0) {
+            if (s + 2 >= e) {
+                if (final) { *p++ = '='; *p++ = (unsigned char)c1; s = e; }
+                break;
+            }
+            int h2 = hexval(s[2]);
+            if (h2 >= 0) {
+                *p++ = (unsigned char)(h1*16 + h2);
+                s += 3;
+            } else {
+                *p++ = '=';
+                *p++ = (unsigned char)c1;
+                s += 2;
+            }
+            continue;
+        }
+        *p++ = '=';
+        s++;
+    }
+    *consumed = s - s0;
+    return p - d;
+}
+
+/*=====================================================
+ * Entry points
+ */
+
+static void get_bytes(ScmObj src, const unsigned char **s, ScmSmallInt *n)
+{
+    if (SCM_STRINGP(src)) {
+        const ScmStringBody *b = SCM_STRING_BODY(src);
+        *s = (const unsigned char*)SCM_STRING_BODY_START(b);
+        *n = SCM_STRING_BODY_SIZE(b);
+    } else if (SCM_U8VECTORP(src)) {
+        *s = SCM_U8VECTOR_ELEMENTS(src);
+        *n = SCM_U8VECTOR_SIZE(src);
+    } else {
+        Scm_TypeError("src", "string or u8vector", src);
+    }
+}
+
+static ScmObj make_result(unsigned char *buf, ScmSmallInt size, int toU8)
+{
+    if (toU8) return Scm_MakeU8VectorFromArrayShared(size, buf);
+    return Scm_MakeString((const char*)buf, size, -1, 0);
+}
+
+ScmObj Scm__Base64EncodeBytes(ScmObj src, int lineWidth, int urlSafe)
+{
+    const unsigned char *s = NULL;
+    ScmSmallInt n = 0;
+    b64_encoder e;
+
+    get_bytes(src, &s, &n);
+    b64_encoder_init(&e, lineWidth, urlSafe);
+    char *buf = SCM_NEW_ATOMIC2(char*, b64_encode_bound(&e, n) + 1);
+    ScmSmallInt m = b64_encode(&e, s, n, buf);
+    return Scm_MakeString(buf, m, m, 0);
+}
+
+ScmObj Scm__Base64DecodeBytes(ScmObj src, int urlSafe, int toU8)
+{
+    const unsigned char *s = NULL;
+    ScmSmallInt n = 0;
+    b64_decoder dc;
+
+    get_bytes(src, &s, &n);
+    b64_decoder_init(&dc, urlSafe);
+    unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*,
+                                         b64_decode_bound(n));
+    ScmSmallInt m = b64_decode(&dc, s, n, buf, TRUE);
+    return make_result(buf, m, toU8);
+}
+
+ScmObj Scm__QPEncodeBytes(ScmObj src, int lineWidth, int binary)
+{
+    const unsigned char *s = NULL;
+    ScmSmallInt n = 0;
+    qp_encoder q;
+
+    get_bytes(src, &s, &n);
+    qp_encoder_init(&q, lineWidth, binary);
+    char *buf = SCM_NEW_ATOMIC2(char*, qp_encode_bound(n));
+    ScmSmallInt m = qp_encode(&q, s, n, buf, TRUE);
+    return Scm_MakeString(buf, m, m, 0);
+}
+
+ScmObj Scm__QPDecodeBytes(ScmObj src, int toU8)
+{
+    const unsigned char *s = NULL;
+    ScmSmallInt n = 0, consumed;
+
+    get_bytes(src, &s, &n);
+    unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*, n + 1);
+    ScmSmallInt m = qp_decode(s, n, buf, TRUE, &consumed);
+    return make_result(buf, m, toU8);
+}
+
+void Scm__Base64EncodePort(ScmPort *in, ScmPort *out,
+                           int lineWidth, int urlSafe)
+{
+    b64_encoder e;
+    b64_encoder_init(&e, lineWidth, urlSafe);
+    unsigned char *ibuf = SCM_NEW_ATOMIC2(unsigned char*, CHUNK_SIZE);
+    char *obuf = SCM_NEW_ATOMIC2(char*, b64_encode_bound(&e, CHUNK_SIZE));
+    ScmSmallInt carry = 0;      /* bytes of an incomplete group */
+
+    for (;;) {
+        int r = Scm_Getz((char*)ibuf + carry, CHUNK_SIZE - carry, in);
+        if (r <= 0) {
+            ScmSmallInt m = b64_encode(&e, ibuf, carry, obuf);
+            if (m > 0) Scm_Putz(obuf, (int)m, out);
+            break;
+        }
+        ScmSmallInt n = carry + r;
+        carry = n % 3;
+        ScmSmallInt m = b64_encode(&e, ibuf, n - carry, obuf);
+        if (m > 0) Scm_Putz(obuf, (int)m, out);
+        memmove(ibuf, ibuf + n - carry, carry);
+    }
+}
+
+void Scm__Base64DecodePort(ScmPort *in, ScmPort *out, int urlSafe)
+{
+    b64_decoder dc;
+    b64_decoder_init(&dc, urlSafe);
+    unsigned char *ibuf = SCM_NEW_ATOMIC2(unsigned char*, CHUNK_SIZE);
+    unsigned char *obuf = SCM_NEW_ATOMIC2(unsigned char*,
+                                          b64_decode_bound(CHUNK_SIZE));
+
+    while (!dc.done) {
+        int r = Scm_Getz((char*)ibuf, CHUNK_SIZE, in);
+        ScmSmallInt m = b64_decode(&dc, ibuf, (r > 0) ? r : 0, obuf, r <= 0);
+        if (m > 0) Scm_Putz((char*)obuf, (int)m, out);
+        if (r <= 0) break;
+    }
+}
+
+void Scm__QPEncodePort(ScmPort *in, ScmPort *out, int lineWidth, int binary)
+{
+    qp_encoder q;
+    qp_encoder_init(&q, lineWidth, binary);
+    unsigned char *ibuf = SCM_NEW_ATOMIC2(unsigned char*, CHUNK_SIZE);
+    char *obuf = SCM_NEW_ATOMIC2(char*, qp_encode_bound(CHUNK_SIZE));
+
+    for (;;) {
+        int r = Scm_Getz((char*)ibuf, CHUNK_SIZE, in);
+        ScmSmallInt m = qp_encode(&q, ibuf, (r > 0) ? r : 0, obuf, r <= 0);
+        if (m > 0) Scm_Putz(obuf, (int)m, out);
+        if (r <= 0) break;
+    }
+}
+
+void Scm__QPDecodePort(ScmPort *in, ScmPort *out)
+{
+    ScmSmallInt size = CHUNK_SIZE, carry = 0, consumed;
+    unsigned char *ibuf = SCM_NEW_ATOMIC2(unsigned char*, size);
+    unsigned char *obuf = SCM_NEW_ATOMIC2(unsigned char*, size);
+
+    for (;;) {
+        if (carry == size) {
+            /* A long run of whitespaces after '='.  Rare, but legal. */
+            unsigned char *nbuf = SCM_NEW_ATOMIC2(unsigned char*, size*2);
+            memcpy(nbuf, ibuf, carry);
+            ibuf = nbuf;
+            size *= 2;
+            obuf = SCM_NEW_ATOMIC2(unsigned char*, size);
+        }
+        int r = Scm_Getz((char*)ibuf + carry, (int)(size - carry), in);
+        int final = (r <= 0);
+        ScmSmallInt n = carry + (final ? 0 : r);
+        ScmSmallInt m = qp_decode(ibuf, n, obuf, final, &consumed);
+        if (m > 0) Scm_Putz((char*)obuf, (int)m, out);
+        if (final) break;
+        carry = n - consumed;
+        memmove(ibuf, ibuf + consumed, carry);
+    }
+}
+
+/*=====================================================
+ * Initialization
+ */
+
+void Scm__InitCodec(void)
+{
+    memset(b64_standard_decode, -1, sizeof(b64_standard_decode));
+    memset(b64_url_safe_decode, -1, sizeof(b64_url_safe_decode));
+    for (int i = 0; i < 64; i++) {
+        b64_standard_decode[(unsigned char)b64_standard[i]] = (signed char)i;
+        b64_url_safe_decode[(unsigned char)b64_url_safe[i]] = (signed char)i;
+    }
+    for (int c = 0; c < 256; c++) {
+        qp_literal[c] = ((c > 0x20 && c < 0x3d) || c == 0x3e
+                         || (c > 0x3f && c < 0x7f));
+    }
+
+#if CODEC_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        b64_encode_groups = b64_encode_groups_avx2;
+        b64_decode_blocks = b64_decode_blocks_avx2;
+    }
+#endif
+}
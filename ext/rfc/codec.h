@@ -0,0 +1,59 @@
+/*
+ * codec.h - base64 and quoted-printable codecs for rfc.codec
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_RFC_CODEC_H
+#define GAUCHE_RFC_CODEC_H
+
+/* SRC is a string or a u8vector.  Encoders return a string; decoders
+ * return a u8vector if TOU8 is TRUE, or a string otherwise (which is
+ * incomplete if the result isn't valid in the native encoding).
+ * LINEWIDTH <= 0 means no line breaks.
+ */
+extern ScmObj Scm__Base64EncodeBytes(ScmObj src, int lineWidth, int urlSafe);
+extern ScmObj Scm__Base64DecodeBytes(ScmObj src, int urlSafe, int toU8);
+extern ScmObj Scm__QPEncodeBytes(ScmObj src, int lineWidth, int binary);
+extern ScmObj Scm__QPDecodeBytes(ScmObj src, int toU8);
+
+/* Streaming versions.  They read IN until EOF (or until the pad
+ * character, for base64 decoding) in blocks, and write to OUT.
+ */
+extern void Scm__Base64EncodePort(ScmPort *in, ScmPort *out,
+                                  int lineWidth, int urlSafe);
+extern void Scm__Base64DecodePort(ScmPort *in, ScmPort *out, int urlSafe);
+extern void Scm__QPEncodePort(ScmPort *in, ScmPort *out,
+                              int lineWidth, int binary);
+extern void Scm__QPDecodePort(ScmPort *in, ScmPort *out);
+
+extern void Scm__InitCodec(void);
+
+#endif /* GAUCHE_RFC_CODEC_H */
@@ -0,0 +1,79 @@
+;;;
+;;; rfc.codec - base64 and quoted-printable codecs
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; The codecs behind rfc.base64 and rfc.quoted-printable.  This module
+;; isn't meant to be used directly; the API may change.
+;;
+;; SRC is a string or a u8vector.  LINE-WIDTH is a fixnum; zero or
+;; negative means no line breaks.  The decoders return a u8vector if
+;; TO-U8 is true.
+
+(define-module rfc.codec
+  (export base64-encode-bytes base64-decode-bytes
+          base64-encode-port base64-decode-port
+          qp-encode-bytes qp-decode-bytes
+          qp-encode-port qp-decode-port))
+(select-module rfc.codec)
+
+(inline-stub
+ (declcode "#include \"codec.h\"")
+ (initcode "Scm__InitCodec();")
+
+ (define-cproc base64-encode-bytes (src line-width::<fixnum>
+                                    url-safe::<boolean>)
+   (return (Scm__Base64EncodeBytes src line-width url-safe)))
+ (define-cproc base64-decode-bytes (src url-safe::<boolean>
+                                    to-u8::<boolean>)
+   (return (Scm__Base64DecodeBytes src url-safe to-u8)))
+ (define-cproc base64-encode-port (in::<input-port> out::<output-port>
+                                   line-width::<fixnum>
+                                   url-safe::<boolean>)
+   ::<void>
+   (Scm__Base64EncodePort in out line-width url-safe))
+ (define-cproc base64-decode-port (in::<input-port> out::<output-port>
+                                   url-safe::<boolean>)
+   ::<void>
+   (Scm__Base64DecodePort in out url-safe))
+
+ (define-cproc qp-encode-bytes (src line-width::<fixnum> binary::<boolean>)
+   (return (Scm__QPEncodeBytes src line-width binary)))
+ (define-cproc qp-decode-bytes (src to-u8::<boolean>)
+   (return (Scm__QPDecodeBytes src to-u8)))
+ (define-cproc qp-encode-port (in::<input-port> out::<output-port>
+                               line-width::<fixnum> binary::<boolean>)
+   ::<void>
+   (Scm__QPEncodePort in out line-width binary))
+ (define-cproc qp-decode-port (in::<input-port> out::<output-port>)
+   ::<void>
+   (Scm__QPDecodePort in out))
+ )
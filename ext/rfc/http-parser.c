@@ -0,0 +1,243 @@
+/*
+ * http-parser.c - HTTP/1.1 message parser for rfc.http-parser
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <ctype.h>
+#include <string.h>
+#include "http-parser.h"
+
+/*=====================================================
+ * Request head
+ *
+ *  We parse the whole head at once, after the empty line that ends it
+ *  has arrived; a server calls us again as more data comes in, and
+ *  finding the end with memchr is cheap compared to parsing.
+ *  Following RFC7230 3.5, we accept a bare LF as a line terminator and
+ *  ignore empty lines before the request line.  Obsolete line folding
+ *  is unfolded the same way as rfc822-read-headers does, i.e. only
+ *  the line break is removed.
+ */
+
+#define MAX_HEADER_LINES 256
+
+/* tchar in RFC7230 */
+static int tcharp(unsigned char c)
+{
+    if (c >= 0x80 || c <= ' ') return FALSE;
+    return strchr("\"(),/:;<=>?@[\\]{}", c) == NULL && c != 0x7f;
+}
+
+/* Find the end of line starting at P.  Returns the index of LF, or -1.
+   *EOL is set to the end of the line content (excluding CR). */
+static ScmSmallInt find_eol(const unsigned char *buf,
+                            ScmSmallInt p, ScmSmallInt end, ScmSmallInt *eol)
+{
+    const unsigned char *lf = memchr(buf+p, '\n', end-p);
+    if (lf == NULL) return -1;
+    ScmSmallInt k = lf - buf;
+    *eol = (k > p && buf[k-1] == '\r')? k-1 : k;
+    return k;
+}
+
+static ScmObj make_str(const unsigned char *buf, ScmSmallInt s, ScmSmallInt e)
+{
+    return Scm_MakeString((const char*)buf+s, e-s, -1, SCM_STRING_COPYING);
+}
+
+static ScmObj make_downcased_str(const unsigned char *buf,
+                                 ScmSmallInt s, ScmSmallInt e)
+{
+    char *z = SCM_NEW_ATOMIC2(char*, e-s+1);
+    for (ScmSmallInt i = s; i < e; i++) {
+        unsigned char c = buf[i];
+        z[i-s] = (c >= 'A' && c <= 'Z')? c - 'A' + 'a' : c;
+    }
+    z[e-s] = '\0';
+    return Scm_MakeString(z, e-s, e-s, 0);
+}
+
+static void bad_request(const char *what, const unsigned char *buf,
+                        ScmSmallInt s, ScmSmallInt e)
+{
+    if (e - s > 64) e = s + 64;
+    Scm_Error("malformed HTTP %s: %S", what,
+              Scm_MakeString((const char*)buf+s, e-s, e-s,
+                             SCM_STRING_COPYING|SCM_STRING_INCOMPLETE));
+}
+
+static void parse_request_line(const unsigned char *buf,
+                               ScmSmallInt s, ScmSmallInt e,
+                               ScmHttpRequestHead *r)
+{
+    ScmSmallInt p = s;
+    while (p < e && tcharp(buf[p])) p++;
+    if (p == s || p >= e || buf[p] != ' ') goto bad;
+    r->method = make_str(buf, s, p);
+
+    ScmSmallInt t = ++p;
+    while (p < e && buf[p] > ' ' && buf[p] != 0x7f) p++;
+    if (p == t || p >= e || buf[p] != ' ') goto bad;
+    r->target = make_str(buf, t, p);
+
+    p++;
+    if (e - p != 8 || memcmp(buf+p, "HTTP/", 5) != 0
+        || !isdigit(buf[p+5]) || buf[p+6] != '.' || !isdigit(buf[p+7])) {
+        goto bad;
+    }
+    r->major = buf[p+5] - '0';
+    r->minor = buf[p+7] - '0';
+    return;
+ bad:
+    bad_request("request line", buf, s, e);
+}
+
+int Scm__HttpParseRequestHead(const unsigned char *buf,
+                              ScmSmallInt start, ScmSmallInt end,
+                              ScmHttpRequestHead *r)
+{
+    ScmSmallInt p = start, eol, lf;
+
+    /* skip leading empty lines */
+    for (;;) {
+        if (p >= end) return FALSE;
+        if (buf[p] == '\n') { p++; continue; }
+        if (buf[p] == '\r') {
+            if (p+1 >= end) return FALSE;
+            if (buf[p+1] == '\n') { p += 2; continue; }
+        }
+        break;
+    }
+
+    /* make sure we have the whole head before creating objects */
+    ScmSmallInt q = p;
+    for (;;) {
+        if ((lf = find_eol(buf, q, end, &eol)) < 0) return FALSE;
+        if (eol == q) break;
+        q = lf + 1;
+    }
+
+    lf = find_eol(buf, p, end, &eol);
+    parse_request_line(buf, p, eol, r);
+    p = lf + 1;
+
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    ScmObj last = SCM_FALSE;    /* (name value) of the last header */
+    int nlines = 0;
+    for (;;) {
+        lf = find_eol(buf, p, end, &eol);
+        SCM_ASSERT(lf >= 0);
+        if (eol == p) { p = lf + 1; break; }
+        if (++nlines > MAX_HEADER_LINES) {
+            Scm_Error("too many HTTP header lines");
+        }
+        if (buf[p] == ' ' || buf[p] == '\t') {
+            /* obs-fold */
+            if (SCM_FALSEP(last)) bad_request("header", buf, p, eol);
+            SCM_SET_CAR(SCM_CDR(last),
+                        Scm_StringAppend2(SCM_STRING(SCM_CADR(last)),
+                                          SCM_STRING(make_str(buf, p, eol))));
+        } else {
+            ScmSmallInt n = p;
+            while (n < eol && tcharp(buf[n])) n++;
+            if (n == p || n >= eol || buf[n] != ':') {
+                bad_request("header", buf, p, eol);
+            }
+            ScmSmallInt v = n + 1, ve = eol;
+            while (v < ve && (buf[v] == ' ' || buf[v] == '\t')) v++;
+            while (ve > v && (buf[ve-1] == ' ' || buf[ve-1] == '\t')) ve--;
+            last = SCM_LIST2(make_downcased_str(buf, p, n),
+                             make_str(buf, v, ve));
+            SCM_APPEND1(h, t, last);
+        }
+        p = lf + 1;
+    }
+    r->headers = h;
+    r->next = p;
+    return TRUE;
+}
+
+/*=====================================================
+ * Chunked transfer coding
+ */
+
+int Scm__HttpParseChunk(const unsigned char *buf,
+                        ScmSmallInt start, ScmSmallInt end,
+                        ScmSmallInt *data, ScmSmallInt *size,
+                        ScmSmallInt *next)
+{
+    ScmSmallInt eol, lf = find_eol(buf, start, end, &eol);
+    if (lf < 0) return FALSE;
+
+    ScmSmallInt p = start, n = 0;
+    while (p < eol && isxdigit(buf[p])) {
+        int d = buf[p];
+        d = isdigit(d)? d - '0' : (tolower(d) - 'a' + 10);
+        if (n > (SCM_SMALL_INT_MAX >> 4)) {
+            Scm_Error("HTTP chunk size too large");
+        }
+        n = n*16 + d;
+        p++;
+    }
+    if (p == start) bad_request("chunk size", buf, start, eol);
+    /* We ignore chunk extensions. */
+    while (p < eol && (buf[p] == ' ' || buf[p] == '\t')) p++;
+    if (p < eol && buf[p] != ';') bad_request("chunk size", buf, start, eol);
+
+    ScmSmallInt d = lf + 1;
+    if (n > 0) {
+        if (end - d < n + 1) return FALSE;
+        ScmSmallInt e = d + n;
+        if (buf[e] == '\r') {
+            if (end - e < 2) return FALSE;
+            if (buf[e+1] != '\n') bad_request("chunk", buf, e, e+2);
+            *next = e + 2;
+        } else if (buf[e] == '\n') {
+            *next = e + 1;
+        } else {
+            bad_request("chunk", buf, e, e+1);
+        }
+    } else {
+        /* last chunk; skip the trailer */
+        ScmSmallInt q = d;
+        for (;;) {
+            ScmSmallInt ls = q;
+            if ((lf = find_eol(buf, q, end, &eol)) < 0) return FALSE;
+            q = lf + 1;
+            if (eol == ls) break;   /* an empty line ends the trailer */
+        }
+        *next = q;
+    }
+    *data = d;
+    *size = n;
+    return TRUE;
+}
@@ -0,0 +1,65 @@
+/*
+ * http-parser.h - HTTP/1.1 message parser for rfc.http-parser
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_RFC_HTTP_PARSER_H
+#define GAUCHE_RFC_HTTP_PARSER_H
+
+/* Result of parsing a request head. */
+typedef struct ScmHttpRequestHeadRec {
+    ScmObj method;              /* string */
+    ScmObj target;              /* string, the request-target as is */
+    int major;                  /* HTTP version */
+    int minor;
+    ScmObj headers;             /* (("name" "value") ...), names downcased */
+    ScmSmallInt next;           /* index right after the head */
+} ScmHttpRequestHead;
+
+/* Parse a request head in BUF[START..END).  Return FALSE if the head
+   isn't complete yet.  Signal an error if it is malformed. */
+extern int Scm__HttpParseRequestHead(const unsigned char *buf,
+                                     ScmSmallInt start, ScmSmallInt end,
+                                     ScmHttpRequestHead *r);
+
+/* Parse one chunk of chunked transfer coding, including the data and
+   the CRLF following it, that begins at BUF[START].  Return FALSE if
+   the whole chunk isn't in BUF[START..END) yet.  Otherwise set *DATA
+   and *SIZE to the index and the size of the chunk data, and *NEXT
+   to the index after the chunk.  For the last chunk (*SIZE == 0), the
+   trailer is skipped as well.  Signal an error if malformed. */
+extern int Scm__HttpParseChunk(const unsigned char *buf,
+                               ScmSmallInt start, ScmSmallInt end,
+                               ScmSmallInt *data, ScmSmallInt *size,
+                               ScmSmallInt *next);
+
+#endif /*GAUCHE_RFC_HTTP_PARSER_H*/
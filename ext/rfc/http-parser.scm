@@ -0,0 +1,83 @@
+;;;
+;;; rfc.http-parser - HTTP/1.1 message parser
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; Incremental parsing of HTTP/1.1 requests from a byte buffer, for
+;; servers that read from non-blocking sockets.  The procedures look at
+;; the data between START and END of a u8vector and return #f if
+;; it isn't complete yet, so that the caller can read more and try again.
+
+(define-module rfc.http-parser
+  (use gauche.uvector)
+  (export http-parse-request-head http-parse-chunk))
+(select-module rfc.http-parser)
+
+(inline-stub
+ (declcode "#include \"http-parser.h\"")
+
+ (define-cfn check-range (buf::ScmU8Vector* start::ScmSmallInt
+                          end::ScmSmallInt)
+   ::ScmSmallInt :static
+   (let* ([size::ScmSmallInt (SCM_U8VECTOR_SIZE buf)])
+     (when (< end 0) (set! end size))
+     (unless (and (<= 0 start) (<= start end) (<= end size))
+       (Scm_Error "start/end out of range: (%ld %ld)" start end))
+     (return end)))
+
+ ;; Returns #f, or method, request-target, version ("1.1" etc.),
+ ;; headers and the index after the head.
+ (define-cproc http-parse-request-head (buf::<u8vector>
+                                        :optional (start::<fixnum> 0)
+                                                  (end::<fixnum> -1))
+   (let* ([r::ScmHttpRequestHead])
+     (set! end (check-range buf start end))
+     (if (Scm__HttpParseRequestHead (SCM_U8VECTOR_ELEMENTS buf) start end
+                                    (& r))
+       (return (Scm_Values5 (ref r method) (ref r target)
+                            (Scm_Sprintf "%d.%d" (ref r major) (ref r minor))
+                            (ref r headers)
+                            (SCM_MAKE_INT (ref r next))))
+       (return SCM_FALSE))))
+
+ ;; Returns #f, or the index and the size of the chunk data, and the
+ ;; index after the chunk.
+ (define-cproc http-parse-chunk (buf::<u8vector>
+                                 :optional (start::<fixnum> 0)
+                                           (end::<fixnum> -1))
+   (let* ([data::ScmSmallInt 0] [size::ScmSmallInt 0] [next::ScmSmallInt 0])
+     (set! end (check-range buf start end))
+     (if (Scm__HttpParseChunk (SCM_U8VECTOR_ELEMENTS buf) start end
+                              (& data) (& size) (& next))
+       (return (Scm_Values3 (SCM_MAKE_INT data) (SCM_MAKE_INT size)
+                            (SCM_MAKE_INT next)))
+       (return SCM_FALSE))))
+ )
@@ -0,0 +1,842 @@
+/*
+ * json-parser.c - JSON reader for rfc.json-parser
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <gauche/priv/portP.h>
+#include <string.h>
+#include <float.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "json-parser.h"
+
+/*=====================================================
+ * Input
+ *
+ *  The parser looks at a window of bytes [cur, end).  When it is
+ *  exhausted, fill() brings the next one.  For a string or a u8vector
+ *  the whole input is a single window.  For an input string port and
+ *  a buffered port, the window is the port's own buffer; we don't copy
+ *  bytes, and we write our position back to the port in sync_port().
+ *  Other ports are read one byte at a time (or a chunk at a time if
+ *  we're allowed to read ahead), so that we don't take more than
+ *  we need from the port.
+ *
+ *  A byte that isn't a part of ASCII never appears inside a
+ *  multibyte character in UTF-8 and EUC-JP, so we can scan the input
+ *  bytewise.  In Shift_JIS the second byte can be '\\', so we have to
+ *  skip multibyte characters in strings.
+ */
+
+enum {
+    SRC_MEM,                    /* string or u8vector */
+    SRC_ISTR,                   /* window to input string port */
+    SRC_FILE,                   /* window to buffered port */
+    SRC_BYTE,                   /* one byte taken from a port */
+    SRC_CHUNK                   /* read-ahead buffer */
+};
+
+#define CHUNK_SIZE 8192
+
+static ScmObj sym_false, sym_true, sym_null;
+
+static void count_lines(ScmPort *p, const unsigned char *s,
+                        const unsigned char *e)
+{
+    while (s < e) {
+        const unsigned char *nl = memchr(s, '\n', e - s);
+        if (nl == NULL) break;
+        p->line++;
+        s = nl + 1;
+    }
+}
+
+/* Write back our position to the port and forget the window, except
+   the read-ahead buffer, which is ours.  */
+static void sync_port(ScmJsonReader *r)
+{
+    if (r->mode == SRC_MEM || r->wstart == NULL) return;
+    ScmPort *p = SCM_PORT(r->src);
+    ScmSmallInt n = r->cur - r->wstart;
+    count_lines(p, r->wstart, r->cur);
+    r->offset += n;
+    switch (r->mode) {
+    case SRC_ISTR:
+        p->src.istr.current = (const char*)r->cur;
+        p->bytes += n;
+        break;
+    case SRC_FILE:
+        p->src.buf.current = (char*)r->cur;
+        p->bytes += n;
+        break;
+    case SRC_BYTE:
+        if (r->cur < r->end) Scm_Ungetb(*r->cur, p);
+        break;
+    case SRC_CHUNK:
+        r->wstart = r->cur;
+        return;
+    }
+    r->cur = r->end = r->wstart = NULL;
+}
+
+/* Make the window non-empty.  Returns FALSE at the end of input. */
+static int fill(ScmJsonReader *r)
+{
+    if (r->eof || r->mode == SRC_MEM) return FALSE;
+    sync_port(r);
+    if (r->cur < r->end) return TRUE;
+
+    ScmPort *p = SCM_PORT(r->src);
+    if (!SCM_PORT_CLOSED_P(p) && p->scrcnt == 0
+        && p->ungotten == SCM_CHAR_INVALID) {
+        if (SCM_PORT_TYPE(p) == SCM_PORT_ISTR) {
+            if (p->src.istr.current >= p->src.istr.end) {
+                r->eof = TRUE;
+                return FALSE;
+            }
+            r->mode = SRC_ISTR;
+            r->cur = r->wstart = (const unsigned char*)p->src.istr.current;
+            r->end = (const unsigned char*)p->src.istr.end;
+            return TRUE;
+        }
+        if (SCM_PORT_TYPE(p) == SCM_PORT_FILE) {
+            if (p->src.buf.current >= p->src.buf.end) {
+                /* Let the port fill its buffer, then put back the byte. */
+                if (Scm_Getb(p) == EOF) {
+                    r->eof = TRUE;
+                    return FALSE;
+                }
+                p->src.buf.current--;
+                p->bytes--;
+            }
+            r->mode = SRC_FILE;
+            r->cur = r->wstart = (const unsigned char*)p->src.buf.current;
+            r->end = (const unsigned char*)p->src.buf.end;
+            return TRUE;
+        }
+    }
+
+    if (r->consumeAll) {
+        if (r->chunk == NULL) r->chunk = SCM_NEW_ATOMIC2(unsigned char*,
+                                                         CHUNK_SIZE);
+        int n = Scm_Getz((char*)r->chunk, CHUNK_SIZE, p);
+        if (n <= 0) {
+            r->eof = TRUE;
+            return FALSE;
+        }
+        r->mode = SRC_CHUNK;
+        r->cur = r->wstart = r->chunk;
+        r->end = r->chunk + n;
+    } else {
+        int b = Scm_Getb(p);
+        if (b == EOF) {
+            r->eof = TRUE;
+            return FALSE;
+        }
+        r->mode = SRC_BYTE;
+        r->byte = (unsigned char)b;
+        r->cur = r->wstart = &r->byte;
+        r->end = r->cur + 1;
+    }
+    return TRUE;
+}
+
+static inline int peekb(ScmJsonReader *r)
+{
+    if (r->cur < r->end || fill(r)) return *r->cur;
+    return EOF;
+}
+
+static inline int getb(ScmJsonReader *r)
+{
+    if (r->cur < r->end || fill(r)) return *r->cur++;
+    return EOF;
+}
+
+static ScmSmallInt position(ScmJsonReader *r)
+{
+    return r->offset + (r->cur - r->wstart);
+}
+
+/* Raises <json-parse-error>, which is defined in rfc.json. */
+static void json_error(ScmJsonReader *r, ScmObj obj, const char *msg)
+{
+    static ScmObj json_error_class = SCM_UNDEFINED;
+    ScmSmallInt pos = position(r);
+
+    sync_port(r);
+    if (!SCM_CLASSP(json_error_class)) {
+        ScmModule *m = Scm_FindModule(SCM_SYMBOL(SCM_INTERN("rfc.json")),
+                                      SCM_FIND_MODULE_QUIET);
+        if (m != NULL) {
+            json_error_class =
+                Scm_GlobalVariableRef(m, SCM_SYMBOL(SCM_INTERN("<json-parse-error>")), 0);
+        }
+    }
+    Scm_RaiseCondition(json_error_class,
+                       "position", Scm_MakeInteger(pos),
+                       "objects", obj,
+                       SCM_RAISE_CONDITION_MESSAGE,
+                       "JSON parse error at %ld: %s%s%S", pos, msg,
+                       SCM_FALSEP(obj)? "" : ": ",
+                       SCM_FALSEP(obj)? SCM_MAKE_STR("") : obj);
+}
+
+static void unexpected(ScmJsonReader *r, int c, const char *what)
+{
+    if (c == EOF) json_error(r, SCM_EOF, "unexpected end of input");
+    json_error(r, SCM_MAKE_CHAR(c), what);
+}
+
+/*=====================================================
+ * Scanning
+ */
+
+#define WSP(c)  ((c) == ' ' || (c) == '\n' || (c) == '\r' || (c) == '\t')
+
+/* Skips whitespaces and returns the next byte, without consuming it. */
+static int skip_ws(ScmJsonReader *r)
+{
+    for (;;) {
+        while (r->cur < r->end) {
+            if (!WSP(*r->cur)) return *r->cur;
+            r->cur++;
+#if defined(__SSE2__) && defined(__GNUC__)
+            /* Long runs of whitespaces are typical in pretty-printed
+               input, for indentation. */
+            if (r->end - r->cur >= 16 && WSP(*r->cur)) {
+                const __m128i sp = _mm_set1_epi8(' ');
+                const __m128i nl = _mm_set1_epi8('\n');
+                const __m128i cr = _mm_set1_epi8('\r');
+                const __m128i tab = _mm_set1_epi8('\t');
+                do {
+                    __m128i v = _mm_loadu_si128((const __m128i*)r->cur);
+                    __m128i w = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(v, sp),
+                                     _mm_cmpeq_epi8(v, nl)),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, cr),
+                                     _mm_cmpeq_epi8(v, tab)));
+                    unsigned int m = ~_mm_movemask_epi8(w) & 0xffff;
+                    if (m) {
+                        r->cur += __builtin_ctz(m);
+                        return *r->cur;
+                    }
+                    r->cur += 16;
+                } while (r->end - r->cur >= 16);
+            }
+#endif
+        }
+        if (!fill(r)) return EOF;
+    }
+}
+
+/* Returns the first position of '"' or '\\' in [p, end), or end. */
+static const unsigned char *scan_string(const unsigned char *p,
+                                        const unsigned char *end)
+{
+#if defined(GAUCHE_CHAR_ENCODING_SJIS)
+    while (p < end) {
+        if (*p == '"' || *p == '\\') return p;
+        int n = SCM_CHAR_NFOLLOWS(*p);
+        if (end - p <= n) return end;
+        p += n + 1;
+    }
+    return end;
+#else  /* !GAUCHE_CHAR_ENCODING_SJIS */
+#if defined(__SSE2__) && defined(__GNUC__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        unsigned int m =
+            _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                           _mm_cmpeq_epi8(v, bslash)));
+        if (m) return p + __builtin_ctz(m);
+        p += 16;
+    }
+#elif SIZEOF_LONG == 8 && defined(__GNUC__)
+    /* Check 8 bytes at a time; see "Determine if a word has a byte equal
+       to n" in Bit Twiddling Hacks. */
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    while (end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        uint64_t q = w ^ (ones * '"');
+        uint64_t b = w ^ (ones * '\\');
+        uint64_t t = (((q - ones) & ~q) | ((b - ones) & ~b)) & highs;
+        if (t) break;           /* let the loop below find the position */
+        p += 8;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+#endif /* !GAUCHE_CHAR_ENCODING_SJIS */
+}
+
+/*=====================================================
+ * Tokens
+ */
+
+static int hexval(int c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int read_hex4(ScmJsonReader *r)
+{
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        int c = getb(r);
+        int h = (c == EOF)? -1 : hexval(c);
+        if (h < 0) unexpected(r, c, "invalid \\u escape");
+        v = v*16 + h;
+    }
+    return v;
+}
+
+static void read_unicode_escape(ScmJsonReader *r, ScmDString *ds)
+{
+    int c = read_hex4(r), ucs = c;
+    if (c >= 0xd800 && c <= 0xdbff) {
+        if (peekb(r) == '\\') {
+            r->cur++;
+            if (peekb(r) == 'u') {
+                r->cur++;
+                int c2 = read_hex4(r);
+                if (c2 >= 0xdc00 && c2 <= 0xdfff) {
+                    ucs = 0x10000 + ((c - 0xd800) << 10) + (c2 - 0xdc00);
+                    c = 0;
+                }
+            }
+        }
+        if (c) json_error(r, Scm_Sprintf("\\u%04x", c), "unpaired surrogate");
+    } else if (c >= 0xdc00 && c <= 0xdfff) {
+        json_error(r, Scm_Sprintf("\\u%04x", c), "unpaired surrogate");
+    }
+    ScmChar ch = Scm_UcsToChar(ucs);
+    if (ch == SCM_CHAR_INVALID) {
+        json_error(r, Scm_Sprintf("\\u%04x", ucs),
+                   "character not supported in the native encoding");
+    }
+    Scm_DStringPutc(ds, ch);
+}
+
+/* Called after the opening '"'. */
+static ScmObj read_string(ScmJsonReader *r)
+{
+    ScmDString ds;
+    const unsigned char *s = r->cur;
+    const unsigned char *e = scan_string(s, r->end);
+
+    /* Fast path: no escapes, and the whole string is in the window */
+    if (e < r->end && *e == '"') {
+        r->cur = e + 1;
+        return Scm_MakeString((const char*)s, e - s, -1, SCM_STRING_COPYING);
+    }
+
+    Scm_DStringInit(&ds);
+    for (;;) {
+        Scm_DStringPutz(&ds, (const char*)s, e - s);
+        r->cur = e;
+        if (e == r->end) {
+            if (!fill(r)) unexpected(r, EOF, NULL);
+        } else if (*e == '"') {
+            r->cur++;
+            break;
+        } else {
+            r->cur++;
+            int c = getb(r);
+            switch (c) {
+            case '"': case '\\': case '/': Scm_DStringPutb(&ds, c); break;
+            case 'b': Scm_DStringPutb(&ds, '\b'); break;
+            case 'f': Scm_DStringPutb(&ds, '\f'); break;
+            case 'n': Scm_DStringPutb(&ds, '\n'); break;
+            case 'r': Scm_DStringPutb(&ds, '\r'); break;
+            case 't': Scm_DStringPutb(&ds, '\t'); break;
+            case 'u': read_unicode_escape(r, &ds); break;
+            default: unexpected(r, c, "invalid escape in string");
+            }
+        }
+#if defined(GAUCHE_CHAR_ENCODING_SJIS)
+        /* A multibyte character may straddle the window boundary. */
+        if (r->cur < r->end && SCM_CHAR_NFOLLOWS(*r->cur) > 0) {
+            int n = SCM_CHAR_NFOLLOWS(*r->cur);
+            if (r->end - r->cur <= n) {
+                for (int i = 0; i <= n; i++) {
+                    int b = getb(r);
+                    if (b == EOF) unexpected(r, EOF, NULL);
+                    Scm_DStringPutb(&ds, b);
+                }
+            }
+        }
+#endif
+        s = r->cur;
+        e = scan_string(s, r->end);
+    }
+    return Scm_DStringGet(&ds, 0);
+}
+
+/* Exact powers of ten representable in double */
+static const double pow10tab[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+#define NUMBUF_SIZE 64
+
+/* Number syntax follows what the previous parser accepted, which is
+   a superset of RFC7159: [-+]?[0-9]+(\.[0-9]+)?([eE][-+]?[0-9]+)?
+   The first byte is already checked to be one of them. */
+static ScmObj read_number(ScmJsonReader *r)
+{
+    char buf[NUMBUF_SIZE];
+    ScmDString ds;
+    int n = 0, inexact = FALSE, neg = FALSE, c;
+    int ndigits = 0;            /* significant digits in mant */
+    int fracdigits = 0;         /* digits after the point in mant */
+    int exp = 0, expneg = FALSE, expdigits = 0;
+    uint64_t mant = 0;
+    int overflow = FALSE;       /* mant can't hold all the digits */
+
+    Scm_DStringInit(&ds);
+#define PUT(ch)                                                 \
+    do {                                                        \
+        if (n < NUMBUF_SIZE) buf[n++] = (ch);                   \
+        else {                                                  \
+            if (n == NUMBUF_SIZE) {                             \
+                Scm_DStringPutz(&ds, buf, NUMBUF_SIZE); n++;    \
+            }                                                   \
+            Scm_DStringPutb(&ds, (ch));                         \
+        }                                                       \
+    } while (0)
+#define DIGIT(ch)                                               \
+    do {                                                        \
+        if (mant == 0 && (ch) == '0') break;                    \
+        if (ndigits < 19) mant = mant*10 + ((ch) - '0');        \
+        else overflow = TRUE;                                   \
+        ndigits++;                                              \
+    } while (0)
+
+    c = getb(r);
+    if (c == '-' || c == '+') {
+        neg = (c == '-');
+        PUT(c);
+        c = getb(r);
+    }
+    if (c == EOF || c < '0' || c > '9') unexpected(r, c, "digit expected");
+    while (c >= '0' && c <= '9') {
+        PUT(c);
+        DIGIT(c);
+        c = peekb(r);
+        if (c >= '0' && c <= '9') r->cur++;
+    }
+    if (c == '.') {
+        r->cur++;
+        PUT('.');
+        inexact = TRUE;
+        c = getb(r);
+        if (c == EOF || c < '0' || c > '9') unexpected(r, c, "digit expected");
+        while (c >= '0' && c <= '9') {
+            PUT(c);
+            if (mant != 0 || c != '0') {
+                if (ndigits >= 19) { overflow = TRUE; }
+                else { mant = mant*10 + (c - '0'); fracdigits++; }
+                ndigits++;
+            } else {
+                fracdigits++;
+            }
+            c = peekb(r);
+            if (c >= '0' && c <= '9') r->cur++;
+        }
+    }
+    if (c == 'e' || c == 'E') {
+        r->cur++;
+        PUT(c);
+        inexact = TRUE;
+        c = getb(r);
+        if (c == '-' || c == '+') {
+            expneg = (c == '-');
+            PUT(c);
+            c = getb(r);
+        }
+        if (c == EOF || c < '0' || c > '9') unexpected(r, c, "digit expected");
+        while (c >= '0' && c <= '9') {
+            PUT(c);
+            if (exp < 100000) exp = exp*10 + (c - '0');
+            expdigits++;
+            c = peekb(r);
+            if (c >= '0' && c <= '9') r->cur++;
+        }
+    }
+#undef DIGIT
+
+    if (!overflow) {
+        if (!inexact) {
+            if (ndigits <= 18) {
+                ScmInt64 v = (ScmInt64)mant;
+                return Scm_MakeInteger64(neg? -v : v);
+            }
+        } else {
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0
+            /* If both the mantissa and the power of ten are exact in
+               double, the result of one multiplication or division is
+               correctly rounded. */
+            int e10 = (expneg? -exp : exp) - fracdigits;
+            if (mant < ((uint64_t)1 << 53) && e10 >= -22 && e10 <= 22) {
+                double d = (double)mant;
+                d = (e10 < 0)? d / pow10tab[-e10] : d * pow10tab[e10];
+                return Scm_MakeFlonum(neg? -d : d);
+            }
+#endif
+        }
+    }
+
+    ScmObj s = (n <= NUMBUF_SIZE)
+        ? Scm_MakeString(buf, n, n, SCM_STRING_COPYING)
+        : Scm_DStringGet(&ds, 0);
+#undef PUT
+    ScmObj z = Scm_StringToNumber(SCM_STRING(s), 10, 0);
+    if (SCM_FALSEP(z)) json_error(r, s, "invalid number");
+    return z;
+}
+
+static ScmObj read_word(ScmJsonReader *r, const char *word, ScmObj sym)
+{
+    for (const char *w = word; *w; w++) {
+        int c = getb(r);
+        if (c != *w) unexpected(r, c, "invalid literal");
+    }
+    return sym;
+}
+
+/*=====================================================
+ * Events
+ */
+
+enum {
+    ST_TOP,                     /* between top-level values */
+    ST_VALUE,                   /* after ':' or ',' in an array */
+    ST_ARRAY_FIRST,             /* after '[' */
+    ST_OBJECT_FIRST,            /* after '{' */
+    ST_KEY,                     /* after ',' in an object */
+    ST_COLON,                   /* after a key */
+    ST_AFTER                    /* after a value in a container */
+};
+
+static void push(ScmJsonReader *r, char kind)
+{
+    if (r->depth >= r->stackSize) {
+        ScmSmallInt nsize = r->stackSize? r->stackSize*2 : 32;
+        char *nstack = SCM_NEW_ATOMIC2(char*, nsize);
+        if (r->depth > 0) memcpy(nstack, r->stack, r->depth);
+        r->stack = nstack;
+        r->stackSize = nsize;
+    }
+    r->stack[r->depth++] = kind;
+}
+
+static int after_value(ScmJsonReader *r, int event)
+{
+    r->state = (r->depth == 0)? ST_TOP : ST_AFTER;
+    return event;
+}
+
+static int read_value_start(ScmJsonReader *r, int c, ScmObj *payload)
+{
+    switch (c) {
+    case '{':
+        r->cur++;
+        push(r, '{');
+        r->state = ST_OBJECT_FIRST;
+        return SCM_JSON_START_OBJECT;
+    case '[':
+        r->cur++;
+        push(r, '[');
+        r->state = ST_ARRAY_FIRST;
+        return SCM_JSON_START_ARRAY;
+    case '"':
+        r->cur++;
+        *payload = read_string(r);
+        break;
+    case '-': case '+':
+    case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        *payload = read_number(r);
+        break;
+    case 't': *payload = read_word(r, "true", sym_true); break;
+    case 'f': *payload = read_word(r, "false", sym_false); break;
+    case 'n': *payload = read_word(r, "null", sym_null); break;
+    default:
+        unexpected(r, c, "value expected");
+    }
+    return after_value(r, SCM_JSON_VALUE);
+}
+
+int Scm__JsonReadEvent(ScmJsonReader *r, ScmObj *payload)
+{
+    *payload = SCM_FALSE;
+    for (;;) {
+        int c = skip_ws(r);
+        switch (r->state) {
+        case ST_TOP:
+            if (c == EOF) return SCM_JSON_EOF;
+            return read_value_start(r, c, payload);
+        case ST_VALUE:
+            return read_value_start(r, c, payload);
+        case ST_ARRAY_FIRST:
+            if (c == ']') {
+                r->cur++;
+                r->depth--;
+                return after_value(r, SCM_JSON_END_ARRAY);
+            }
+            return read_value_start(r, c, payload);
+        case ST_OBJECT_FIRST:
+            if (c == '}') {
+                r->cur++;
+                r->depth--;
+                return after_value(r, SCM_JSON_END_OBJECT);
+            }
+            /* FALLTHROUGH */
+        case ST_KEY:
+            if (c != '"') unexpected(r, c, "object key expected");
+            r->cur++;
+            *payload = read_string(r);
+            r->state = ST_COLON;
+            return SCM_JSON_KEY;
+        case ST_COLON:
+            if (c != ':') unexpected(r, c, "':' expected");
+            r->cur++;
+            r->state = ST_VALUE;
+            break;
+        case ST_AFTER: {
+            char kind = r->stack[r->depth-1];
+            if (c == ',') {
+                r->cur++;
+                r->state = (kind == '[')? ST_VALUE : ST_KEY;
+                break;
+            }
+            if (kind == '[' && c == ']') {
+                r->cur++;
+                r->depth--;
+                return after_value(r, SCM_JSON_END_ARRAY);
+            }
+            if (kind == '{' && c == '}') {
+                r->cur++;
+                r->depth--;
+                return after_value(r, SCM_JSON_END_OBJECT);
+            }
+            unexpected(r, c, (kind == '[')? "',' or ']' expected"
+                                          : "',' or '}' expected");
+        }
+        }
+    }
+}
+
+/*=====================================================
+ * Building values
+ *
+ *  We keep the elements of all open containers in a single stack,
+ *  so that nesting depth is limited only by memory.  For an object,
+ *  the key waits on the stack until its value comes.
+ */
+
+typedef struct {
+    ScmObj *vals;
+    ScmSmallInt nvals, valsSize;
+    ScmSmallInt *starts;            /* index in vals for each open container */
+    ScmSmallInt depth, startsSize;
+} Builder;
+
+static void bpush(Builder *b, ScmObj v)
+{
+    if (b->nvals >= b->valsSize) {
+        ScmSmallInt nsize = b->valsSize * 2;
+        ScmObj *nvals = SCM_NEW_ARRAY(ScmObj, nsize);
+        memcpy(nvals, b->vals, b->nvals * sizeof(ScmObj));
+        b->vals = nvals;
+        b->valsSize = nsize;
+    }
+    b->vals[b->nvals++] = v;
+}
+
+static void bopen(Builder *b)
+{
+    if (b->depth >= b->startsSize) {
+        ScmSmallInt nsize = b->startsSize * 2;
+        ScmSmallInt *nstarts = SCM_NEW_ATOMIC_ARRAY(ScmSmallInt, nsize);
+        memcpy(nstarts, b->starts, b->depth * sizeof(ScmSmallInt));
+        b->starts = nstarts;
+        b->startsSize = nsize;
+    }
+    b->starts[b->depth++] = b->nvals;
+}
+
+/* Pops the elements of the innermost container into a list. */
+static ScmObj bclose_list(Builder *b)
+{
+    ScmSmallInt start = b->starts[--b->depth];
+    ScmObj h = SCM_NIL;
+    for (ScmSmallInt i = b->nvals; i > start; i--) h = Scm_Cons(b->vals[i-1], h);
+    b->nvals = start;
+    return h;
+}
+
+static ScmObj bclose_vector(Builder *b)
+{
+    ScmSmallInt start = b->starts[--b->depth];
+    ScmObj v = Scm_MakeVector(b->nvals - start, SCM_UNDEFINED);
+    memcpy(SCM_VECTOR_ELEMENTS(v), b->vals + start,
+           (b->nvals - start) * sizeof(ScmObj));
+    b->nvals = start;
+    return v;
+}
+
+/* Calls a handler.  The handler may use the port, so we make the port
+   state consistent first. */
+static ScmObj call_handler(ScmJsonReader *r, ScmObj handler, ScmObj arg)
+{
+    sync_port(r);
+    return Scm_ApplyRec1(handler, arg);
+}
+
+ScmObj Scm__JsonReadValue(ScmJsonReader *r, ScmObj arrayHandler,
+                          ScmObj objectHandler, ScmObj specialHandler)
+{
+    ScmObj vals0[32];
+    ScmSmallInt starts0[16];
+    Builder b;
+    b.vals = vals0;   b.nvals = 0; b.valsSize = 32;
+    b.starts = starts0; b.depth = 0; b.startsSize = 16;
+
+    if (r->state != ST_TOP) {
+        Scm_Error("JSON reader is in the middle of a value: %S", SCM_OBJ(r));
+    }
+
+    for (;;) {
+        ScmObj v = SCM_FALSE;
+        int ev = Scm__JsonReadEvent(r, &v);
+        switch (ev) {
+        case SCM_JSON_EOF:
+            sync_port(r);
+            return SCM_EOF;
+        case SCM_JSON_START_OBJECT:
+        case SCM_JSON_START_ARRAY:
+            bopen(&b);
+            continue;
+        case SCM_JSON_KEY:
+            bpush(&b, v);
+            continue;
+        case SCM_JSON_END_ARRAY:
+            if (SCM_FALSEP(arrayHandler)) v = bclose_vector(&b);
+            else v = call_handler(r, arrayHandler, bclose_list(&b));
+            break;
+        case SCM_JSON_END_OBJECT:
+            v = bclose_list(&b);
+            if (!SCM_FALSEP(objectHandler)) v = call_handler(r, objectHandler, v);
+            break;
+        case SCM_JSON_VALUE:
+            if (!SCM_FALSEP(specialHandler) && SCM_SYMBOLP(v)) {
+                v = call_handler(r, specialHandler, v);
+            }
+            break;
+        }
+        /* We have a complete value V. */
+        if (b.depth == 0) {
+            skip_ws(r);
+            sync_port(r);
+            return v;
+        }
+        if (r->stack[r->depth-1] == '{') {
+            ScmObj key = b.vals[--b.nvals];
+            bpush(&b, Scm_Cons(key, v));
+        } else {
+            bpush(&b, v);
+        }
+    }
+}
+
+/*=====================================================
+ * Reader object
+ */
+
+static void reader_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<json-reader %S>", SCM_JSON_READER(obj)->src);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_JsonReaderClass, reader_print);
+
+ScmObj Scm__MakeJsonReader(ScmObj src, int consumeAll)
+{
+    ScmJsonReader *r = SCM_NEW(ScmJsonReader);
+    SCM_SET_CLASS(r, SCM_CLASS_JSON_READER);
+    r->src = src;
+    r->consumeAll = consumeAll;
+    r->eof = FALSE;
+    r->chunk = NULL;
+    r->offset = 0;
+    r->state = ST_TOP;
+    r->stack = NULL;
+    r->depth = r->stackSize = 0;
+    if (SCM_STRINGP(src)) {
+        const ScmStringBody *b = SCM_STRING_BODY(src);
+        r->mode = SRC_MEM;
+        r->cur = r->wstart = (const unsigned char*)SCM_STRING_BODY_START(b);
+        r->end = r->cur + SCM_STRING_BODY_SIZE(b);
+    } else if (SCM_U8VECTORP(src)) {
+        r->mode = SRC_MEM;
+        r->cur = r->wstart = SCM_U8VECTOR_ELEMENTS(src);
+        r->end = r->cur + SCM_U8VECTOR_SIZE(src);
+    } else if (SCM_IPORTP(src)) {
+        r->mode = SRC_BYTE;     /* determined by fill() */
+        r->cur = r->end = r->wstart = NULL;
+    } else {
+        Scm_TypeError("src", "string, u8vector or input port", src);
+    }
+    return SCM_OBJ(r);
+}
+
+void Scm__InitJsonParser(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_JsonReaderClass, "<json-reader>", mod, NULL, 0);
+    sym_false = SCM_INTERN("false");
+    sym_true  = SCM_INTERN("true");
+    sym_null  = SCM_INTERN("null");
+}
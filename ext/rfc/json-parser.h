@@ -0,0 +1,101 @@
+/*
+ * json-parser.h - JSON reader for rfc.json-parser
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_RFC_JSON_PARSER_H
+#define GAUCHE_RFC_JSON_PARSER_H
+
+/* Reader state.  It reads from a string or an u8vector in memory,
+ * or from an input port.  For input string ports and buffered ports
+ * it scans the port's buffer directly; for other ports it reads one
+ * byte at a time, unless CONSUME_ALL is given, in which case it may
+ * read ahead in chunks.  The port's position is brought up to date
+ * whenever the reader returns, so that the port can be used for other
+ * purposes (except in the read-ahead case).
+ */
+typedef struct ScmJsonReaderRec {
+    SCM_HEADER;
+    ScmObj src;                 /* string, u8vector or input port */
+    const unsigned char *cur;   /* next byte to look at */
+    const unsigned char *end;   /* end of the current window */
+    const unsigned char *wstart; /* part of the window before this is
+                                    already accounted for */
+    int mode;                   /* how the current window is obtained */
+    int consumeAll;             /* may read ahead */
+    int eof;                    /* hit the end of input */
+    unsigned char byte;         /* one-byte window, when reading bytewise */
+    unsigned char *chunk;       /* read-ahead buffer, when CONSUME_ALL */
+    ScmSmallInt offset;         /* input offset at wstart */
+    /* event state */
+    int state;
+    char *stack;                /* '[' or '{' for each open container */
+    ScmSmallInt depth;
+    ScmSmallInt stackSize;
+} ScmJsonReader;
+
+SCM_CLASS_DECL(Scm_JsonReaderClass);
+#define SCM_CLASS_JSON_READER   (&Scm_JsonReaderClass)
+#define SCM_JSON_READER(obj)    ((ScmJsonReader*)(obj))
+#define SCM_JSON_READER_P(obj)  SCM_XTYPEP(obj, SCM_CLASS_JSON_READER)
+
+/* Events */
+enum {
+    SCM_JSON_EOF,
+    SCM_JSON_START_OBJECT,
+    SCM_JSON_END_OBJECT,
+    SCM_JSON_START_ARRAY,
+    SCM_JSON_END_ARRAY,
+    SCM_JSON_KEY,               /* payload is the key string */
+    SCM_JSON_VALUE              /* payload is a string, a number, or
+                                   one of symbols false, true and null */
+};
+
+extern ScmObj Scm__MakeJsonReader(ScmObj src, int consumeAll);
+
+/* Returns the next event, and sets *PAYLOAD for SCM_JSON_KEY and
+   SCM_JSON_VALUE.  At the top level, any number of values may follow
+   each other; SCM_JSON_EOF is returned at the end of input. */
+extern int Scm__JsonReadEvent(ScmJsonReader *r, ScmObj *payload);
+
+/* Reads one whole value and returns it, or EOF at the end of input.
+   The handlers are procedures to be applied on the list of elements
+   of each array, the list of (key . value) of each object, and each
+   special symbol, respectively.  #f means the default, i.e. making
+   a vector, the list itself and the symbol itself.  Whitespaces after
+   the value are consumed. */
+extern ScmObj Scm__JsonReadValue(ScmJsonReader *r, ScmObj arrayHandler,
+                                 ScmObj objectHandler, ScmObj specialHandler);
+
+/* Called once at initialization. */
+extern void Scm__InitJsonParser(ScmModule *mod);
+
+#endif /* GAUCHE_RFC_JSON_PARSER_H */
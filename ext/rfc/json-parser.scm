@@ -0,0 +1,73 @@
+;;;
+;;; rfc.json-parser - JSON reader
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; The reader behind parse-json and friends in rfc.json.  This module
+;; isn't meant to be used directly; the API may change.
+
+(define-module rfc.json-parser
+  (export make-json-reader json-reader-read json-reader-next-event))
+(select-module rfc.json-parser)
+
+(inline-stub
+ (declcode "#include \"json-parser.h\"")
+ (initcode "Scm__InitJsonParser(Scm_CurrentModule());")
+
+ (define-type <json-reader> "ScmJsonReader*" "json reader"
+   "SCM_JSON_READER_P" "SCM_JSON_READER")
+
+ ;; SRC is a string, an u8vector or an input port.  If CONSUME-ALL is
+ ;; true, the reader may read ahead from the port past the value.
+ (define-cproc make-json-reader (src :optional (consume-all::<boolean> #f))
+   (return (Scm__MakeJsonReader src consume-all)))
+
+ ;; Returns the next value, or EOF.  Handlers are #f to get the default.
+ (define-cproc json-reader-read (r::<json-reader>
+                                 :optional (array-handler #f)
+                                           (object-handler #f)
+                                           (special-handler #f))
+   (return (Scm__JsonReadValue r array-handler object-handler
+                               special-handler)))
+
+ ;; Returns (EVENT . PAYLOAD), or EOF.
+ (define-cproc json-reader-next-event (r::<json-reader>)
+   (let* ([payload SCM_FALSE]
+          [ev::int (Scm__JsonReadEvent r (& payload))])
+     (case ev
+       [(SCM_JSON_EOF)          (return SCM_EOF)]
+       [(SCM_JSON_START_OBJECT) (return (Scm_Cons 'start-object payload))]
+       [(SCM_JSON_END_OBJECT)   (return (Scm_Cons 'end-object payload))]
+       [(SCM_JSON_START_ARRAY)  (return (Scm_Cons 'start-array payload))]
+       [(SCM_JSON_END_ARRAY)    (return (Scm_Cons 'end-array payload))]
+       [(SCM_JSON_KEY)          (return (Scm_Cons 'key payload))]
+       [else                    (return (Scm_Cons 'value payload))])))
+ )
@@ -0,0 +1,402 @@
+/*
+ * json-writer.c - JSON writer for rfc.json-writer
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <gauche.h>
+#include <string.h>
+#include <math.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "json-writer.h"
+
+/*=====================================================
+ * Output
+ *
+ *  We accumulate the output in a buffer on the C stack and pass it
+ *  to the port with Scm_Putz when it fills up, instead of going
+ *  through the port for every character.  The buffer is flushed before
+ *  calling anything that writes to the port by itself.
+ */
+
+#define OUTBUF_SIZE 4096
+
+typedef struct OutRec {
+    ScmPort *port;
+    int n;
+    char buf[OUTBUF_SIZE];
+} Out;
+
+static void flush(Out *o)
+{
+    if (o->n > 0) {
+        Scm_Putz(o->buf, o->n, o->port);
+        o->n = 0;
+    }
+}
+
+/* Makes sure we have room for N bytes.  N <= OUTBUF_SIZE. */
+static inline char *room(Out *o, int n)
+{
+    if (o->n + n > OUTBUF_SIZE) flush(o);
+    return o->buf + o->n;
+}
+
+static inline void putb(Out *o, char c)
+{
+    *room(o, 1) = c;
+    o->n++;
+}
+
+static void putz(Out *o, const char *s, ScmSmallInt n)
+{
+    while (n > 0) {
+        int k = (n < OUTBUF_SIZE)? (int)n : OUTBUF_SIZE;
+        memcpy(room(o, k), s, k);
+        o->n += k;
+        s += k;
+        n -= k;
+    }
+}
+
+/*=====================================================
+ * Atoms
+ */
+
+static const char hexdigits[] = "0123456789abcdef";
+
+static void put_u_escape(Out *o, int code)
+{
+    char *p = room(o, 6);
+    p[0] = '\\'; p[1] = 'u';
+    p[2] = hexdigits[(code >> 12) & 0xf];
+    p[3] = hexdigits[(code >> 8) & 0xf];
+    p[4] = hexdigits[(code >> 4) & 0xf];
+    p[5] = hexdigits[code & 0xf];
+    o->n += 6;
+}
+
+/* True if the byte can be written as is: printable ASCII except
+   '"' and '\\'.  Note that we escape all non-ASCII characters. */
+#define PLAIN(b)  ((b) >= 0x20 && (b) < 0x7f && (b) != '"' && (b) != '\\')
+
+/* Returns the first byte in [p, end) that isn't PLAIN, or end. */
+static const unsigned char *scan_plain(const unsigned char *p,
+                                       const unsigned char *end)
+{
+#if defined(__SSE2__) && defined(__GNUC__)
+    /* Bytes >= 0x80 are negative as signed, so they're caught by the
+       comparison with 0x20 as well as control characters. */
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i m = _mm_or_si128(
+            _mm_or_si128(_mm_cmplt_epi8(v, space), _mm_cmpeq_epi8(v, del)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)));
+        unsigned int bits = _mm_movemask_epi8(m);
+        if (bits) return p + __builtin_ctz(bits);
+        p += 16;
+    }
+#endif
+    while (p < end && PLAIN(*p)) p++;
+    return p;
+}
+
+static void put_string(Out *o, ScmString *s)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(s);
+    const unsigned char *p = (const unsigned char*)SCM_STRING_BODY_START(b);
+    const unsigned char *end = p + SCM_STRING_BODY_SIZE(b);
+
+    putb(o, '"');
+    while (p < end) {
+        /* We always start at a character boundary here, and a PLAIN
+           byte at a character boundary is an ASCII character in all
+           supported encodings. */
+        const unsigned char *q = scan_plain(p, end);
+        putz(o, (const char*)p, q - p);
+        if (q == end) break;
+        p = q;
+        switch (*p) {
+        case '"':  putz(o, "\\\"", 2); p++; continue;
+        case '\\': putz(o, "\\\\", 2); p++; continue;
+        case '\b': putz(o, "\\b", 2); p++; continue;
+        case '\f': putz(o, "\\f", 2); p++; continue;
+        case '\n': putz(o, "\\n", 2); p++; continue;
+        case '\r': putz(o, "\\r", 2); p++; continue;
+        case '\t': putz(o, "\\t", 2); p++; continue;
+        }
+        if (*p < 0x80) {
+            put_u_escape(o, *p++);
+            continue;
+        }
+        int nf = SCM_CHAR_NFOLLOWS(*p);
+        if (nf < 0 || end - p <= nf) {
+            /* Shouldn't happen in a complete string. */
+            Scm_Error("broken string: %S", SCM_OBJ(s));
+        }
+        ScmChar ch;
+        SCM_CHAR_GET(p, ch);
+        int code = Scm_CharToUcs(ch);
+        if (code < 0) {
+            Scm_Error("character %S can't be represented in JSON",
+                      SCM_MAKE_CHAR(ch));
+        }
+        if (code >= 0x10000) {
+            code -= 0x10000;
+            put_u_escape(o, 0xd800 + (code >> 10));
+            put_u_escape(o, 0xdc00 + (code & 0x3ff));
+        } else {
+            put_u_escape(o, code);
+        }
+        p += nf + 1;
+    }
+    putb(o, '"');
+}
+
+static void put_fixnum(Out *o, long v)
+{
+    char tmp[24];
+    int i = sizeof(tmp);
+    unsigned long u = (v < 0)? -(unsigned long)v : (unsigned long)v;
+    do {
+        tmp[--i] = '0' + (u % 10);
+        u /= 10;
+    } while (u > 0);
+    if (v < 0) tmp[--i] = '-';
+    putz(o, tmp + i, sizeof(tmp) - i);
+}
+
+/* Writes an atom and returns TRUE, or returns FALSE if OBJ isn't
+   something we handle here. */
+static int put_atom(Out *o, ScmObj obj)
+{
+    static ScmObj sym_false = SCM_UNDEFINED, sym_true, sym_null;
+    if (SCM_UNDEFINEDP(sym_false)) {
+        sym_true = SCM_INTERN("true");
+        sym_null = SCM_INTERN("null");
+        sym_false = SCM_INTERN("false");
+    }
+
+    if (SCM_INTP(obj)) {
+        put_fixnum(o, SCM_INT_VALUE(obj));
+    } else if (SCM_FALSEP(obj) || SCM_EQ(obj, sym_false)) {
+        putz(o, "false", 5);
+    } else if (SCM_TRUEP(obj) || SCM_EQ(obj, sym_true)) {
+        putz(o, "true", 4);
+    } else if (SCM_EQ(obj, sym_null)) {
+        putz(o, "null", 4);
+    } else if (SCM_STRINGP(obj)
+               && !SCM_STRING_INCOMPLETE_P(SCM_STRING(obj))) {
+        put_string(o, SCM_STRING(obj));
+    } else if (SCM_FLONUMP(obj) && isfinite(SCM_FLONUM_VALUE(obj))) {
+        flush(o);
+        Scm_PrintDouble(o->port, SCM_FLONUM_VALUE(obj), NULL);
+    } else if (SCM_BIGNUMP(obj)) {
+        flush(o);
+        Scm_PrintNumber(o->port, obj, NULL);
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/*=====================================================
+ * Containers
+ *
+ *  Nested containers are handled with an explicit stack, so that
+ *  a deeply nested structure doesn't overflow the C stack.
+ */
+
+enum {
+    F_VECTOR,                   /* vector; index is the next element */
+    F_ALIST,                    /* list of pairs; rest is the next one */
+    F_HASH                      /* hash table; iter */
+};
+
+typedef struct FrameRec {
+    int type;
+    int first;
+    ScmObj obj;
+    ScmObj rest;
+    ScmSmallInt index;
+    ScmHashIter iter;
+} Frame;
+
+typedef struct StackRec {
+    Frame *frames;
+    ScmSmallInt depth;
+    ScmSmallInt size;
+} Stack;
+
+static Frame *push(Stack *s, int type, ScmObj obj)
+{
+    if (s->depth >= s->size) {
+        ScmSmallInt nsize = s->size * 2;
+        Frame *nframes = SCM_NEW_ARRAY(Frame, nsize);
+        memcpy(nframes, s->frames, s->depth * sizeof(Frame));
+        s->frames = nframes;
+        s->size = nsize;
+    }
+    Frame *f = &s->frames[s->depth++];
+    f->type = type;
+    f->first = TRUE;
+    f->obj = obj;
+    return f;
+}
+
+/* A proper list whose elements are all pairs. */
+static int alistp(ScmObj obj)
+{
+    ScmObj slow = obj;
+    for (;;) {
+        if (SCM_NULLP(obj)) return TRUE;
+        if (!SCM_PAIRP(obj) || !SCM_PAIRP(SCM_CAR(obj))) return FALSE;
+        obj = SCM_CDR(obj);
+        if (SCM_NULLP(obj)) return TRUE;
+        if (!SCM_PAIRP(obj) || !SCM_PAIRP(SCM_CAR(obj))) return FALSE;
+        obj = SCM_CDR(obj);
+        slow = SCM_CDR(slow);
+        if (SCM_EQ(obj, slow)) return FALSE; /* circular */
+    }
+}
+
+static void put_key(Out *o, ScmObj key, ScmObj keyproc)
+{
+    if (SCM_SYMBOLP(key)) key = SCM_OBJ(SCM_SYMBOL_NAME(key));
+    if (!SCM_STRINGP(key)) {
+        flush(o);
+        key = Scm_ApplyRec1(keyproc, key);
+        if (!SCM_STRINGP(key)) {
+            Scm_Error("string required for a JSON object key, but got %S",
+                      key);
+        }
+    }
+    if (SCM_STRING_INCOMPLETE_P(SCM_STRING(key))) {
+        Scm_Error("incomplete string can't be a JSON object key: %S", key);
+    }
+    put_string(o, SCM_STRING(key));
+    putb(o, ':');
+}
+
+void Scm__JsonWrite(ScmObj obj, ScmPort *port, ScmObj fallback,
+                    ScmObj keyproc)
+{
+    Out out;
+    Frame frames0[16];
+    Stack stack;
+
+    out.port = port;
+    out.n = 0;
+    stack.frames = frames0;
+    stack.depth = 0;
+    stack.size = 16;
+
+    for (;;) {
+        /* Write OBJ, or open it. */
+        if (put_atom(&out, obj)) {
+            /* done */
+        } else if (SCM_PAIRP(obj) && alistp(obj)) {
+            putb(&out, '{');
+            push(&stack, F_ALIST, obj)->rest = obj;
+        } else if (SCM_NULLP(obj)) {
+            putz(&out, "{}", 2);
+        } else if (SCM_VECTORP(obj)) {
+            putb(&out, '[');
+            push(&stack, F_VECTOR, obj)->index = 0;
+        } else if (SCM_HASH_TABLE_P(obj)) {
+            putb(&out, '{');
+            Frame *f = push(&stack, F_HASH, obj);
+            Scm_HashIterInit(&f->iter, SCM_HASH_TABLE_CORE(obj));
+        } else {
+            flush(&out);
+            Scm_ApplyRec1(fallback, obj);
+        }
+
+        /* Find the next thing to write. */
+        for (;;) {
+            if (stack.depth == 0) {
+                flush(&out);
+                return;
+            }
+            Frame *f = &stack.frames[stack.depth-1];
+            int more = FALSE;
+            switch (f->type) {
+            case F_VECTOR:
+                if (f->index < SCM_VECTOR_SIZE(f->obj)) {
+                    if (!f->first) putb(&out, ',');
+                    obj = SCM_VECTOR_ELEMENT(f->obj, f->index++);
+                    more = TRUE;
+                } else {
+                    putb(&out, ']');
+                }
+                break;
+            case F_ALIST:
+                if (SCM_PAIRP(f->rest)) {
+                    ScmObj kv = SCM_CAR(f->rest);
+                    f->rest = SCM_CDR(f->rest);
+                    if (!f->first) putb(&out, ',');
+                    put_key(&out, SCM_CAR(kv), keyproc);
+                    obj = SCM_CDR(kv);
+                    more = TRUE;
+                } else {
+                    putb(&out, '}');
+                }
+                break;
+            case F_HASH: {
+                ScmDictEntry *e = Scm_HashIterNext(&f->iter);
+                if (e != NULL) {
+                    if (!f->first) putb(&out, ',');
+                    put_key(&out, SCM_DICT_KEY(e), keyproc);
+                    obj = SCM_DICT_VALUE(e);
+                    more = TRUE;
+                } else {
+                    putb(&out, '}');
+                }
+                break;
+            }
+            }
+            if (more) {
+                f->first = FALSE;
+                break;
+            }
+            stack.depth--;
+        }
+    }
+}
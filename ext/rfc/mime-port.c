@@ -0,0 +1,377 @@
+/*
+ * mime-port.c - MIME boundary scanner for rfc.mime-port
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <gauche/priv/portP.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "mime-port.h"
+
+/*=====================================================
+ * Input
+ *
+ *  The scanner looks at a window of bytes.  If the source is an input
+ *  string port or a buffered port (including another mime port, for
+ *  nested multiparts), the window is the port's own buffer, and we
+ *  advance the port's position as we consume bytes.  Otherwise, or
+ *  when the end of the window may be a part of a delimiter, we keep
+ *  the bytes in our own buffer and read more into it.
+ *
+ *  The delimiter is "--boundary" at the beginning of a line.  The line
+ *  break before it belongs to the delimiter; so the part ends right
+ *  before LF or CR LF.  The first delimiter may appear at the very
+ *  beginning of the message, so we start with a virtual LF in our
+ *  buffer.
+ */
+
+#define BUF_SIZE  8192
+
+enum { WIN_NONE, WIN_BUF, WIN_ISTR, WIN_FILE };
+
+static int direct_p(ScmPort *p)
+{
+    return (!SCM_PORT_CLOSED_P(p) && p->scrcnt == 0
+            && p->ungotten == SCM_CHAR_INVALID
+            && (SCM_PORT_TYPE(p) == SCM_PORT_ISTR
+                || SCM_PORT_TYPE(p) == SCM_PORT_FILE));
+}
+
+static void read_more(ScmMimeScanner *sc)
+{
+    if (sc->bufStart > 0) {
+        memmove(sc->buf, sc->buf + sc->bufStart, sc->bufEnd - sc->bufStart);
+        sc->bufEnd -= sc->bufStart;
+        sc->bufStart = 0;
+    }
+    int n = Scm_Getz((char*)sc->buf + sc->bufEnd,
+                     (int)(sc->bufSize - sc->bufEnd), sc->src);
+    if (n <= 0) sc->srcEof = TRUE;
+    else        sc->bufEnd += n;
+    sc->needMore = FALSE;
+}
+
+/* Sets the next window to [*w, *w + *n) and returns its kind, or
+   WIN_NONE at the end of input. */
+static int get_window(ScmMimeScanner *sc, const unsigned char **w,
+                      ScmSmallInt *n)
+{
+    for (;;) {
+        if (sc->bufStart < sc->bufEnd && (!sc->needMore || sc->srcEof)) {
+            *w = sc->buf + sc->bufStart;
+            *n = sc->bufEnd - sc->bufStart;
+            return WIN_BUF;
+        }
+        if (sc->srcEof) return WIN_NONE;
+        if (sc->bufStart == sc->bufEnd && direct_p(sc->src)) {
+            ScmPort *p = sc->src;
+            if (SCM_PORT_TYPE(p) == SCM_PORT_ISTR) {
+                if (p->src.istr.current >= p->src.istr.end) {
+                    sc->srcEof = TRUE;
+                    return WIN_NONE;
+                }
+                *w = (const unsigned char*)p->src.istr.current;
+                *n = p->src.istr.end - p->src.istr.current;
+                return WIN_ISTR;
+            } else {
+                if (p->src.buf.current >= p->src.buf.end) {
+                    /* Let the port fill its buffer, then put back the
+                       byte. */
+                    if (Scm_Getb(p) == EOF) {
+                        sc->srcEof = TRUE;
+                        return WIN_NONE;
+                    }
+                    p->src.buf.current--;
+                    p->bytes--;
+                }
+                *w = (const unsigned char*)p->src.buf.current;
+                *n = p->src.buf.end - p->src.buf.current;
+                return WIN_FILE;
+            }
+        }
+        read_more(sc);
+    }
+}
+
+static void consume(ScmMimeScanner *sc, int win, ScmSmallInt k)
+{
+    ScmPort *p = sc->src;
+    switch (win) {
+    case WIN_BUF:
+        sc->bufStart += k;
+        if (sc->bufStart == sc->bufEnd) sc->bufStart = sc->bufEnd = 0;
+        break;
+    case WIN_ISTR:
+        p->src.istr.current += k;
+        p->bytes += k;
+        break;
+    case WIN_FILE:
+        p->src.buf.current += k;
+        p->bytes += k;
+        break;
+    }
+}
+
+/* The undecided tail [w, w+n) of the window has to wait for more input.
+   If the window is the port's buffer, we move it to our buffer (which
+   is empty then). */
+static void stash(ScmMimeScanner *sc, int win, const unsigned char *w,
+                  ScmSmallInt n)
+{
+    if (win != WIN_BUF) {
+        memcpy(sc->buf, w, n);
+        sc->bufStart = 0;
+        sc->bufEnd = n;
+        consume(sc, win, n);
+    }
+    sc->needMore = TRUE;
+}
+
+static void skip_epilogue(ScmMimeScanner *sc)
+{
+    sc->bufStart = sc->bufEnd = 0;
+    sc->needMore = FALSE;
+    while (!sc->srcEof) {
+        if (Scm_Getz((char*)sc->buf, (int)sc->bufSize, sc->src) <= 0) {
+            sc->srcEof = TRUE;
+        }
+    }
+}
+
+/*=====================================================
+ * Scanning
+ */
+
+enum { SCAN_DATA, SCAN_BOUNDARY, SCAN_CLOSE };
+
+/* Looks for a delimiter in S[0..N) with Horspool's algorithm.
+   If there's none, returns SCAN_DATA and sets *BODY to the number of
+   bytes that surely belong to the part; the rest may be the beginning
+   of a delimiter, unless FINAL is true.  Otherwise, sets *BODY to the
+   length of the part before the delimiter and *NEXT to the index
+   right after the boundary line.
+
+   A delimiter followed by anything other than LF, CR or "--" is just
+   a part of the data, as is one at the end of input. */
+static int scan(ScmMimeScanner *sc, const unsigned char *s, ScmSmallInt n,
+                int final, ScmSmallInt *body, ScmSmallInt *next)
+{
+    const unsigned char *d = sc->delim;
+    ScmSmallInt dlen = sc->dlen;
+    ScmSmallInt i = 0, hold = n;
+
+    while (i + dlen <= n) {
+        unsigned char last = s[i + dlen - 1];
+        if (last == d[dlen - 1] && s[i] == '\n'
+            && memcmp(s + i + 1, d + 1, dlen - 2) == 0) {
+            ScmSmallInt e = i + dlen;
+            int kind = -1;      /* -1: not a boundary, -2: undecided */
+            if (e == n) {
+                if (!final) kind = -2;
+            } else if (s[e] == '\n') {
+                kind = SCAN_BOUNDARY; e++;
+            } else if (s[e] == '\r') {
+                if (e + 1 < n) {
+                    kind = SCAN_BOUNDARY; e += (s[e+1] == '\n') ? 2 : 1;
+                } else if (final) {
+                    kind = SCAN_BOUNDARY; e++;
+                } else {
+                    kind = -2;
+                }
+            } else if (s[e] == '-') {
+                if (e + 1 < n) {
+                    if (s[e+1] == '-') { kind = SCAN_CLOSE; e += 2; }
+                } else if (!final) {
+                    kind = -2;
+                }
+            }
+            if (kind >= 0) {
+                *body = (i > 0 && s[i-1] == '\r') ? i - 1 : i;
+                *next = e;
+                return kind;
+            }
+            if (kind == -2) { hold = i; break; }
+            i++;
+            continue;
+        }
+        i += sc->skip[last];
+    }
+
+    if (final) {
+        *body = n;
+        return SCAN_DATA;
+    }
+    if (hold == n) {
+        /* A partial delimiter at the end? */
+        for (ScmSmallInt j = i; j < n; j++) {
+            const unsigned char *p = memchr(s + j, '\n', n - j);
+            if (p == NULL) break;
+            j = p - s;
+            if (memcmp(s + j, d, n - j) == 0) { hold = j; break; }
+        }
+    }
+    /* A CR right before the undecided part may belong to the delimiter. */
+    if (hold > 0 && s[hold-1] == '\r') hold--;
+    *body = hold;
+    return SCAN_DATA;
+}
+
+/* Delivers the bytes of the current part into VEC, up to LEN bytes,
+   until we hit a boundary or the end of input.  If VEC is NULL, the
+   bytes are discarded. */
+static ScmSmallInt deliver(ScmMimeScanner *sc, unsigned char *vec,
+                           ScmSmallInt len)
+{
+    ScmSmallInt filled = 0;
+
+    while (vec == NULL || filled < len) {
+        const unsigned char *w;
+        ScmSmallInt n, body = 0, next = 0;
+        int win = get_window(sc, &w, &n);
+        if (win == WIN_NONE) {
+            sc->state = SCM_MIME_EOF;
+            break;
+        }
+        int r = scan(sc, w, n, (win == WIN_BUF && sc->srcEof), &body, &next);
+        if (vec != NULL) {
+            ScmSmallInt k = body;
+            if (k > len - filled) k = len - filled;
+            memcpy(vec + filled, w, k);
+            filled += k;
+            if (k < body) {     /* VEC is full */
+                consume(sc, win, k);
+                break;
+            }
+        }
+        switch (r) {
+        case SCAN_DATA:
+            consume(sc, win, body);
+            if (body < n) stash(sc, win, w + body, n - body);
+            break;
+        case SCAN_BOUNDARY:
+            consume(sc, win, next);
+            sc->state = SCM_MIME_BOUNDARY;
+            return filled;
+        case SCAN_CLOSE:
+            consume(sc, win, next);
+            skip_epilogue(sc);
+            sc->state = SCM_MIME_EOF;
+            return filled;
+        }
+    }
+    return filled;
+}
+
+ScmSmallInt Scm__MimeScannerFill(ScmMimeScanner *sc, unsigned char *buf,
+                                 ScmSmallInt len)
+{
+    if (sc->state == SCM_MIME_PROLOGUE) {
+        deliver(sc, NULL, 0);
+        if (sc->state != SCM_MIME_BOUNDARY) return 0;
+        sc->state = SCM_MIME_BODY;
+    }
+    if (sc->state != SCM_MIME_BODY) return 0;
+    return deliver(sc, buf, len);
+}
+
+/*=====================================================
+ * Scanner object
+ */
+
+static ScmObj sym_prologue, sym_body, sym_boundary, sym_eof;
+
+static void scanner_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<mime-scanner %S>", SCM_MIME_SCANNER(obj)->src);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_MimeScannerClass, scanner_print);
+
+ScmObj Scm__MakeMimeScanner(ScmString *boundary, ScmPort *src)
+{
+    u_int size;
+    const char *b = Scm_GetStringContent(boundary, &size, NULL, NULL);
+    ScmMimeScanner *sc = SCM_NEW(ScmMimeScanner);
+
+    SCM_SET_CLASS(sc, SCM_CLASS_MIME_SCANNER);
+    sc->src = src;
+    sc->dlen = size + 3;
+    sc->delim = SCM_NEW_ATOMIC2(unsigned char*, sc->dlen);
+    memcpy(sc->delim, "\n--", 3);
+    memcpy(sc->delim + 3, b, size);
+    for (int c = 0; c < 256; c++) sc->skip[c] = sc->dlen;
+    for (ScmSmallInt j = 0; j < sc->dlen - 1; j++) {
+        sc->skip[sc->delim[j]] = sc->dlen - 1 - j;
+    }
+    sc->state = SCM_MIME_PROLOGUE;
+    sc->srcEof = FALSE;
+    /* Room for an undecided tail, which is at most the delimiter plus
+       a CR before and a byte after it. */
+    sc->bufSize = BUF_SIZE + sc->dlen + 2;
+    sc->buf = SCM_NEW_ATOMIC2(unsigned char*, sc->bufSize);
+    sc->buf[0] = '\n';
+    sc->bufStart = 0;
+    sc->bufEnd = 1;
+    sc->needMore = TRUE;
+    return SCM_OBJ(sc);
+}
+
+ScmObj Scm__MimeScannerState(ScmMimeScanner *sc)
+{
+    switch (sc->state) {
+    case SCM_MIME_PROLOGUE: return sym_prologue;
+    case SCM_MIME_BODY:     return sym_body;
+    case SCM_MIME_BOUNDARY: return sym_boundary;
+    default:                return sym_eof;
+    }
+}
+
+void Scm__MimeScannerStateSet(ScmMimeScanner *sc, ScmObj state)
+{
+    if (SCM_EQ(state, sym_prologue))      sc->state = SCM_MIME_PROLOGUE;
+    else if (SCM_EQ(state, sym_body))     sc->state = SCM_MIME_BODY;
+    else if (SCM_EQ(state, sym_boundary)) sc->state = SCM_MIME_BOUNDARY;
+    else if (SCM_EQ(state, sym_eof))      sc->state = SCM_MIME_EOF;
+    else Scm_Error("bad mime scanner state: %S", state);
+}
+
+void Scm__InitMimePort(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_MimeScannerClass, "<mime-scanner>", mod,
+                        NULL, 0);
+    sym_prologue = SCM_INTERN("prologue");
+    sym_body     = SCM_INTERN("body");
+    sym_boundary = SCM_INTERN("boundary");
+    sym_eof      = SCM_INTERN("eof");
+}
@@ -0,0 +1,88 @@
+/*
+ * mime-port.h - MIME boundary scanner for rfc.mime-port
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_RFC_MIME_PORT_H
+#define GAUCHE_RFC_MIME_PORT_H
+
+/* Scanner state.  It reads from SRC and delivers the bytes up to the
+ * next boundary.  If SRC is an input string port or a buffered port,
+ * the scanner looks into the port's buffer directly; bytes are only
+ * copied into our own buffer when a boundary may straddle the end of
+ * the port's buffer, or when SRC is some other kind of port.
+ */
+typedef struct ScmMimeScannerRec {
+    SCM_HEADER;
+    ScmPort *src;
+    unsigned char *delim;       /* "\n--" + boundary */
+    ScmSmallInt dlen;
+    ScmSmallInt skip[256];      /* Horspool shift table for delim */
+    int state;
+    int srcEof;                 /* SRC reached EOF */
+    int needMore;               /* buf holds an undecided tail */
+    unsigned char *buf;         /* own buffer */
+    ScmSmallInt bufStart;       /* unread bytes are [bufStart, bufEnd) */
+    ScmSmallInt bufEnd;
+    ScmSmallInt bufSize;
+} ScmMimeScanner;
+
+SCM_CLASS_DECL(Scm_MimeScannerClass);
+#define SCM_CLASS_MIME_SCANNER  (&Scm_MimeScannerClass)
+#define SCM_MIME_SCANNER(obj)   ((ScmMimeScanner*)(obj))
+#define SCM_MIME_SCANNER_P(obj) SCM_XTYPEP(obj, SCM_CLASS_MIME_SCANNER)
+
+/* States.  PROLOGUE -> BODY <-> BOUNDARY, and any of them -> EOF.
+   The scanner stays at BOUNDARY, delivering nothing, until the
+   caller sets the state back to BODY. */
+enum {
+    SCM_MIME_PROLOGUE,
+    SCM_MIME_BODY,
+    SCM_MIME_BOUNDARY,
+    SCM_MIME_EOF
+};
+
+extern ScmObj Scm__MakeMimeScanner(ScmString *boundary, ScmPort *src);
+
+/* Stores up to LEN bytes of the current part into BUF, and returns the
+   number of bytes stored.  Returns 0 when we're not in BODY state
+   (after skipping the prologue, if we're at the beginning). */
+extern ScmSmallInt Scm__MimeScannerFill(ScmMimeScanner *sc,
+                                        unsigned char *buf,
+                                        ScmSmallInt len);
+
+extern ScmObj Scm__MimeScannerState(ScmMimeScanner *sc);
+extern void   Scm__MimeScannerStateSet(ScmMimeScanner *sc, ScmObj state);
+
+/* Called once at initialization. */
+extern void Scm__InitMimePort(ScmModule *mod);
+
+#endif /* GAUCHE_RFC_MIME_PORT_H */
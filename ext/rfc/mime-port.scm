@@ -0,0 +1,88 @@
+;;;
+;;; mime-port.scm - submodule to read from mime part body
+;;;
+;;;   Copyright (c) 2000-2015  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; This module is autoloaded from rfc.mime.  You don't need to "use" this
+;; directly.
+(define-module rfc.mime-port
+  (use gauche.vport)
+  (export make-mime-port))
+(select-module rfc.mime-port)
+
+;;===============================================================
+;; Virtual port to recognize mime boundary
+;;
+
+;; The boundary scanning is done in C (mime-port.c).  It looks at the
+;; source port's buffer directly when it can, and stores the bytes of
+;; the current part into our port buffer.
+
+(inline-stub
+ (declcode "#include \"mime-port.h\"")
+ (initcode "Scm__InitMimePort(Scm_CurrentModule());")
+
+ (define-type <mime-scanner> "ScmMimeScanner*" "mime scanner"
+   "SCM_MIME_SCANNER_P" "SCM_MIME_SCANNER")
+
+ (define-cproc make-mime-scanner (boundary::<string> src::<input-port>)
+   (return (Scm__MakeMimeScanner boundary src)))
+
+ ;; Fills BUF with the bytes of the current part.  Returns 0 at the
+ ;; boundary or at the end of input.
+ (define-cproc mime-scanner-fill! (sc::<mime-scanner> buf::<u8vector>)
+   ::<fixnum>
+   (return (Scm__MimeScannerFill sc (SCM_U8VECTOR_ELEMENTS buf)
+                                 (SCM_U8VECTOR_SIZE buf))))
+
+ (define-cproc mime-scanner-state (sc::<mime-scanner>)
+   (return (Scm__MimeScannerState sc)))
+
+ (define-cproc mime-scanner-state-set! (sc::<mime-scanner> state::<symbol>)
+   ::<void>
+   (Scm__MimeScannerStateSet sc (SCM_OBJ state)))
+ )
+
+(define-class <mime-port> (<buffered-input-port>)
+  ((scanner :init-keyword :scanner)
+   (state :allocation :virtual
+          :slot-ref (^o (mime-scanner-state (slot-ref o 'scanner)))
+          :slot-set! (^[o v] (mime-scanner-state-set! (slot-ref o 'scanner) v)))
+   ;; prologue -> boundary <-> body -> eof
+   ))
+
+;; Creates a procedural port, which reads from SRCPORT until it reaches
+;; either EOF or MIME boundary.
+(define (make-mime-port boundary srcport)
+  (let* ([sc (make-mime-scanner boundary srcport)]
+         [port (make <mime-port> :scanner sc)])
+    (set! (ref port 'fill) (cut mime-scanner-fill! sc <>))
+    port))
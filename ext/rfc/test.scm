@@ -451,5 +451,166 @@ Content-Length: 4349
               #f)))))
                      
 (dotimes (n 8) (mime-roundtrip-tester n))
+
+;; Boundary detection straddling the buffers, with different sources.
+(use gauche.vport)
+(let* ([body (with-output-to-string
+               (^[] (dotimes [i 3000]
+                      (format #t "line ~d --b\r\n--bo-\r" i))))]
+       [msg (string-append "prologue\r\n--bound\r\n\r\n" body
+                           "\r\n--bound\r\n\r\nsecond\n--bound--\r\nx")])
+  (define (parts src)
+    (let1 p (make-mime-port "bound" src)
+      (let loop ([r '()])
+        (let1 s (port->string p)
+          (if (eq? (ref p 'state) 'boundary)
+            (begin (set! (ref p 'state) 'body) (loop (cons s r)))
+            (reverse (cons s r)))))))
+  (test* "mime-port (string port)" `(,#"\r\n~body" "\r\nsecond")
+         (parts (open-input-string msg)))
+  (test* "mime-port (unbuffered port)" `(,#"\r\n~body" "\r\nsecond")
+         (parts (let1 in (open-input-string msg)
+                  (make <virtual-input-port>
+                    :getb (^[] (read-byte in))))))
+  (test* "mime-port (no boundary)" '("")
+         (parts (open-input-string "abc\r\n--boundary\r\n")))
+  )
     
+;;--------------------------------------------------------------------
+(test-section "rfc.http-parser")
+(use rfc.http-parser)
+(use gauche.uvector)
+(test-module 'rfc.http-parser)
+
+(let ()
+  (define (parse-head str . args)
+    (receive r (apply http-parse-request-head (string->u8vector str) args)
+      r))
+  (define (parse-chunk str . args)
+    (receive r (apply http-parse-chunk (string->u8vector str) args)
+      r))
+
+  (test* "request head" '("GET" "/a?b=c" "1.1"
+                          (("host" "example.com") ("x-foo" "bar baz"))
+                          60)
+         (parse-head "GET /a?b=c HTTP/1.1\r\nHost: example.com\r\n\
+                      X-Foo:  bar baz \r\n\r\nrest"))
+  (test* "request head (LF, leading empty line, folding)"
+         '("POST" "/" "1.0" (("content-length" "3") ("x-fold" "a\tb")) 50)
+         (parse-head "\r\nPOST / HTTP/1.0\nContent-Length: 3\n\
+                      X-Fold: a\n\tb\n\nabc"))
+  (test* "request head (start)" '("GET" "/" "1.1" () 21)
+         (parse-head "xxxGET / HTTP/1.1\r\n\r\n" 3))
+  (test* "request head (incomplete)" '(#f)
+         (parse-head "GET / HTTP/1.1\r\nHost: x\r\n\r"))
+  (test* "request head (incomplete, end)" '(#f)
+         (parse-head "GET / HTTP/1.1\r\n\r\n" 0 17))
+  (test* "request head (bad request line)" (test-error)
+         (parse-head "GET /  HTTP/1.1\r\n\r\n"))
+  (test* "request head (bad version)" (test-error)
+         (parse-head "GET / HTP/1.1\r\n\r\n"))
+  (test* "request head (bad header)" (test-error)
+         (parse-head "GET / HTTP/1.1\r\nBad Header: x\r\n\r\n"))
+
+  (test* "chunk" '(3 5 10) (parse-chunk "5\r\nhello\r\n0\r\n"))
+  (test* "chunk (extension)" '(9 10 21)
+         (parse-chunk "a;ext=1\r\nabcdefghij\r\n"))
+  (test* "chunk (end)" '(#f)
+         (parse-chunk "a;ext=1\r\nabcdefghij\r\n" 0 20))
+  (test* "chunk (incomplete)" '(#f) (parse-chunk "5;ext=1\r\nhel"))
+  (test* "chunk (last)" '(3 0 5) (parse-chunk "0\r\n\r\n"))
+  (test* "chunk (trailer)" '(3 0 17)
+         (parse-chunk "0\r\nTrailer: x\r\n\r\nnext"))
+  (test* "chunk (incomplete trailer)" '(#f)
+         (parse-chunk "0\r\nTrailer: x\r\n"))
+  (test* "chunk (bad size)" (test-error) (parse-chunk "zz\r\n"))
+  (test* "chunk (missing CRLF)" (test-error) (parse-chunk "5\r\nhelloXX"))
+  )
+
+;;--------------------------------------------------------------------
+(test-section "rfc.json-parser")
+;; More tests are in ext/peg, with rfc.json.
+(use rfc.json-parser)
+(test-module 'rfc.json-parser)
+
+(let ()
+  (define (read-all src . handlers)
+    (let1 r (make-json-reader src #t)
+      (let loop ([vs '()])
+        (let1 v (apply json-reader-read r handlers)
+          (if (eof-object? v) (reverse vs) (loop (cons v vs)))))))
+  (define src "{\"a\": [1, -2.5, \"\\u3042\"]} [] true")
+
+  (test* "json-reader-read (string)" '((("a" . #(1 -2.5 "\u3042"))) #() true)
+         (read-all src))
+  (test* "json-reader-read (u8vector)" '((("a" . #(1 -2.5 "\u3042"))) #() true)
+         (read-all (string->u8vector src)))
+  (test* "json-reader-read (port)" '((("a" . #(1 -2.5 "\u3042"))) #() true)
+         (read-all (open-input-string src)))
+  (test* "json-reader-read (handlers)"
+         '((object ("a" array 1 -2.5 "\u3042")) (array) #t)
+         (read-all src (cut cons 'array <>) (cut cons 'object <>)
+                   (cut eq? <> 'true)))
+  (test* "json-reader-next-event"
+         '((start-object . #f) (key . "a") (start-array . #f) (value . 1)
+           (value . -2.5) (value . "\u3042") (end-array . #f)
+           (end-object . #f) (start-array . #f) (end-array . #f)
+           (value . true))
+         (let1 r (make-json-reader src)
+           (let loop ([es '()])
+             (let1 e (json-reader-next-event r)
+               (if (eof-object? e) (reverse es) (loop (cons e es)))))))
+  (test* "json-reader-read in the middle" (test-error)
+         (let1 r (make-json-reader src)
+           (json-reader-next-event r)
+           (json-reader-read r)))
+  (test* "make-json-reader (bad source)" (test-error)
+         (make-json-reader 'foo))
+  )
+
+;;--------------------------------------------------------------------
+(test-section "rfc.json-writer")
+;; More tests are in ext/peg, with rfc.json.
+(use rfc.json-writer)
+(test-module 'rfc.json-writer)
+
+(let ()
+  (define (w obj)
+    (call-with-output-string
+      (^p (json-write-value obj p
+                            (^x (display "?" p))
+                            (^k (format "<~a>" k))))))
+  (test* "json-write-value" "{\"a\":[1,2.5,\"x\\n\",true,null],\"b\":false}"
+         (w '(("a" . #(1 2.5 "x\n" #t null)) (b . #f))))
+  (test* "json-write-value (fallback)" "[?,{\"<1>\":?}]"
+         (w '#(#u8(1) ((1 . 1/2)))))
+  )
+
+;;--------------------------------------------------------------------
+(test-section "rfc.codec")
+;; More tests are in test/rfc.scm, with rfc.base64 and rfc.quoted-printable.
+(use rfc.codec)
+(test-module 'rfc.codec)
+
+(let ([bv (list->u8vector (list-tabulate 1000 (^i (modulo (* i 31) 256))))])
+  (test* "base64 round trip (u8vector)" bv
+         (base64-decode-bytes (base64-encode-bytes bv 0 #f) #f #t))
+  (test* "base64 round trip (url-safe)" bv
+         (base64-decode-bytes (base64-encode-bytes bv 76 #t) #t #t))
+  (test* "base64 decode (noise)" '#u8(1 2 3 4 5 6)
+         (base64-decode-bytes "AQ\r\nI*DBA  UG" #f #t))
+  (test* "base64 port" (base64-encode-bytes bv 76 #f)
+         (call-with-output-string
+           (cut base64-encode-port (open-input-uvector bv) <> 76 #f)))
+  (test* "qp round trip (u8vector)" bv
+         (qp-decode-bytes (qp-encode-bytes bv 76 #t) #t))
+  (test* "qp port" (qp-encode-bytes bv 20 #t)
+         (call-with-output-string
+           (cut qp-encode-port (open-input-uvector bv) <> 20 #t)))
+  (test* "qp decode port" bv
+         (let1 out (open-output-uvector)
+           (qp-decode-port (open-input-string (qp-encode-bytes bv 76 #t)) out)
+           (get-output-uvector out)))
+  )
+
 (test-end)
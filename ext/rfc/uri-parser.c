@@ -0,0 +1,408 @@
+/*
+ * uri-parser.c - URI parser for rfc.uri-parser
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "uri-parser.h"
+
+/*=====================================================
+ * Splitting
+ *
+ *  These follow the regexps that used to be in rfc.uri, so that
+ *  the results are the same for any input, valid or not.  Delimiters
+ *  are all ASCII, so we can look at bytes, except that in Shift_JIS
+ *  the second byte of a character can be '@', '[' or ']'; NEXT()
+ *  skips over a whole character.
+ */
+
+#if defined(GAUCHE_CHAR_ENCODING_SJIS)
+#define NEXT(s, i)  ((i) += 1 + SCM_CHAR_NFOLLOWS((unsigned char)(s)[i]))
+#else
+#define NEXT(s, i)  ((i)++)
+#endif
+
+#define ALPHA_P(c)  (((c) >= 'A' && (c) <= 'Z') || ((c) >= 'a' && (c) <= 'z'))
+#define DIGIT_P(c)  ((c) >= '0' && (c) <= '9')
+#define XDIGIT_P(c) (DIGIT_P(c) || ((c) >= 'A' && (c) <= 'F')        \
+                     || ((c) >= 'a' && (c) <= 'f'))
+
+static inline void set_part(ScmUriParts *p, int part,
+                            ScmSmallInt start, ScmSmallInt end)
+{
+    p->start[part] = start;
+    p->end[part] = end;
+}
+
+/* ^([A-Za-z][A-Za-z0-9+.-]*): */
+void Scm__UriSplitScheme(const char *s, ScmSmallInt start, ScmSmallInt end,
+                         ScmUriParts *p)
+{
+    ScmSmallInt i = start;
+    if (i < end && ALPHA_P(s[i])) {
+        for (i++; i < end; i++) {
+            char c = s[i];
+            if (!(ALPHA_P(c) || DIGIT_P(c) || c == '+' || c == '.'
+                  || c == '-')) break;
+        }
+        if (i < end && s[i] == ':') {
+            set_part(p, SCM_URI_SCHEME, start, i);
+            set_part(p, SCM_URI_SPECIFIC, i+1, end);
+            return;
+        }
+    }
+    set_part(p, SCM_URI_SCHEME, -1, -1);
+    set_part(p, SCM_URI_SPECIFIC, start, end);
+}
+
+/* ^(?://([^/?#]*))?([^?#]+)?(?:\?([^#]*))?(?:#(.*))?$ */
+void Scm__UriSplitHierarchical(const char *s, ScmSmallInt start,
+                               ScmSmallInt end, ScmUriParts *p)
+{
+    ScmSmallInt i = start, j;
+
+    set_part(p, SCM_URI_AUTHORITY, -1, -1);
+    set_part(p, SCM_URI_PATH, -1, -1);
+    set_part(p, SCM_URI_QUERY, -1, -1);
+    set_part(p, SCM_URI_FRAGMENT, -1, -1);
+
+    if (end - i >= 2 && s[i] == '/' && s[i+1] == '/') {
+        for (j = i + 2; j < end; NEXT(s, j)) {
+            char c = s[j];
+            if (c == '/' || c == '?' || c == '#') break;
+        }
+        set_part(p, SCM_URI_AUTHORITY, i + 2, j);
+        i = j;
+    }
+    for (j = i; j < end; NEXT(s, j)) {
+        if (s[j] == '?' || s[j] == '#') break;
+    }
+    if (j > i) set_part(p, SCM_URI_PATH, i, j);
+    i = j;
+    if (i < end && s[i] == '?') {
+        for (j = i + 1; j < end; NEXT(s, j)) {
+            if (s[j] == '#') break;
+        }
+        set_part(p, SCM_URI_QUERY, i + 1, j);
+        i = j;
+    }
+    if (i < end) {              /* s[i] == '#' */
+        set_part(p, SCM_URI_FRAGMENT, i + 1, end);
+    }
+}
+
+/* Matches (?:([^:]*)|\[([a-fA-F\d:]+)\])(?::(\d*))?$ against S[START..END),
+   trying the alternatives in this order. */
+static int split_hostport(const char *s, ScmSmallInt start, ScmSmallInt end,
+                          ScmUriParts *p)
+{
+    ScmSmallInt i, colon = -1;
+
+    for (i = start; i < end; NEXT(s, i)) {
+        if (s[i] == ':') { colon = i; break; }
+    }
+    if (colon < 0) {
+        set_part(p, SCM_URI_HOST, start, end);
+        set_part(p, SCM_URI_PORT, -1, -1);
+        return TRUE;
+    }
+    for (i = colon + 1; i < end && DIGIT_P(s[i]); i++)
+        ;
+    if (i == end) {
+        set_part(p, SCM_URI_HOST, start, colon);
+        set_part(p, SCM_URI_PORT, colon + 1, end);
+        return TRUE;
+    }
+
+    if (s[start] != '[') return FALSE;
+    for (i = start + 1; i < end && (XDIGIT_P(s[i]) || s[i] == ':'); i++)
+        ;
+    if (i == start + 1 || i == end || s[i] != ']') return FALSE;
+    set_part(p, SCM_URI_HOST, start + 1, i);
+    if (++i == end) {
+        set_part(p, SCM_URI_PORT, -1, -1);
+        return TRUE;
+    }
+    if (s[i] != ':') return FALSE;
+    ScmSmallInt port = i + 1;
+    for (i = port; i < end && DIGIT_P(s[i]); i++)
+        ;
+    if (i != end) return FALSE;
+    set_part(p, SCM_URI_PORT, port, end);
+    return TRUE;
+}
+
+/* ^(?:(.*?)@)?<hostport>$ */
+int Scm__UriSplitAuthority(const char *s, ScmSmallInt start, ScmSmallInt end,
+                           ScmUriParts *p)
+{
+    for (ScmSmallInt i = start; i < end; NEXT(s, i)) {
+        if (s[i] == '@' && split_hostport(s, i + 1, end, p)) {
+            set_part(p, SCM_URI_USERINFO, start, i);
+            return TRUE;
+        }
+    }
+    set_part(p, SCM_URI_USERINFO, -1, -1);
+    if (split_hostport(s, start, end, p)) return TRUE;
+    set_part(p, SCM_URI_HOST, -1, -1);
+    set_part(p, SCM_URI_PORT, -1, -1);
+    return FALSE;
+}
+
+ScmObj Scm__UriPart(ScmString *src, const ScmUriParts *p, int part)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(src);
+    ScmSmallInt start = p->start[part];
+    if (start < 0) return SCM_FALSE;
+    int flags = SCM_STRING_BODY_INCOMPLETE_P(b) ? SCM_STRING_INCOMPLETE : 0;
+    /* The result shares the body of SRC, which never changes. */
+    return Scm_MakeString(SCM_STRING_BODY_START(b) + start,
+                          p->end[part] - start, -1, flags);
+}
+
+static ScmObj scheme_part(ScmString *src, const ScmUriParts *p)
+{
+    ScmSmallInt start = p->start[SCM_URI_SCHEME];
+    if (start < 0) return SCM_FALSE;
+    ScmSmallInt size = p->end[SCM_URI_SCHEME] - start;
+    const char *s = SCM_STRING_BODY_START(SCM_STRING_BODY(src)) + start;
+    char *buf = SCM_NEW_ATOMIC2(char*, size + 1);
+    for (ScmSmallInt i = 0; i < size; i++) {
+        buf[i] = (s[i] >= 'A' && s[i] <= 'Z') ? s[i] - 'A' + 'a' : s[i];
+    }
+    buf[size] = '\0';
+    return Scm_MakeString(buf, size, size, 0);
+}
+
+#define BODY_RANGE(str, s, size)                                \
+    do {                                                        \
+        const ScmStringBody *b_ = SCM_STRING_BODY(str);         \
+        s = SCM_STRING_BODY_START(b_);                          \
+        size = SCM_STRING_BODY_SIZE(b_);                        \
+    } while (0)
+
+ScmObj Scm__UriSchemeSpecific(ScmString *uri)
+{
+    ScmUriParts p;
+    const char *s;
+    ScmSmallInt size;
+
+    BODY_RANGE(uri, s, size);
+    Scm__UriSplitScheme(s, 0, size, &p);
+    if (p.start[SCM_URI_SCHEME] < 0) {
+        return Scm_Values2(SCM_FALSE, SCM_OBJ(uri));
+    }
+    return Scm_Values2(scheme_part(uri, &p),
+                       Scm__UriPart(uri, &p, SCM_URI_SPECIFIC));
+}
+
+ScmObj Scm__UriDecomposeHierarchical(ScmObj specific)
+{
+    ScmUriParts p;
+    const char *s;
+    ScmSmallInt size;
+
+    if (!SCM_STRINGP(specific)) {
+        return Scm_Values4(SCM_FALSE, SCM_FALSE, SCM_FALSE, SCM_FALSE);
+    }
+    BODY_RANGE(SCM_STRING(specific), s, size);
+    Scm__UriSplitHierarchical(s, 0, size, &p);
+    ScmString *u = SCM_STRING(specific);
+    return Scm_Values4(Scm__UriPart(u, &p, SCM_URI_AUTHORITY),
+                       Scm__UriPart(u, &p, SCM_URI_PATH),
+                       Scm__UriPart(u, &p, SCM_URI_QUERY),
+                       Scm__UriPart(u, &p, SCM_URI_FRAGMENT));
+}
+
+ScmObj Scm__UriDecomposeAuthority(ScmObj authority)
+{
+    ScmUriParts p;
+    const char *s;
+    ScmSmallInt size;
+
+    if (!SCM_STRINGP(authority)) {
+        return Scm_Values3(SCM_FALSE, SCM_FALSE, SCM_FALSE);
+    }
+    BODY_RANGE(SCM_STRING(authority), s, size);
+    if (!Scm__UriSplitAuthority(s, 0, size, &p)) {
+        return Scm_Values3(SCM_FALSE, SCM_FALSE, SCM_FALSE);
+    }
+    ScmString *u = SCM_STRING(authority);
+    return Scm_Values3(Scm__UriPart(u, &p, SCM_URI_USERINFO),
+                       Scm__UriPart(u, &p, SCM_URI_HOST),
+                       Scm__UriPart(u, &p, SCM_URI_PORT));
+}
+
+/* Scheme, userinfo, host, port, path, query and fragment.  An empty
+   host is #f, and the port is converted to a number. */
+ScmObj Scm__UriParse(ScmString *uri)
+{
+    ScmUriParts p;
+    const char *s;
+    ScmSmallInt size;
+    ScmObj userinfo = SCM_FALSE, host = SCM_FALSE, port = SCM_FALSE;
+
+    BODY_RANGE(uri, s, size);
+    Scm__UriSplitScheme(s, 0, size, &p);
+    Scm__UriSplitHierarchical(s, p.start[SCM_URI_SPECIFIC], size, &p);
+    if (p.start[SCM_URI_AUTHORITY] >= 0
+        && Scm__UriSplitAuthority(s, p.start[SCM_URI_AUTHORITY],
+                                  p.end[SCM_URI_AUTHORITY], &p)) {
+        userinfo = Scm__UriPart(uri, &p, SCM_URI_USERINFO);
+        if (p.start[SCM_URI_HOST] < p.end[SCM_URI_HOST]) {
+            host = Scm__UriPart(uri, &p, SCM_URI_HOST);
+        }
+        if (p.start[SCM_URI_PORT] >= 0) {
+            port = Scm_StringToNumber(SCM_STRING(Scm__UriPart(uri, &p,
+                                                              SCM_URI_PORT)),
+                                      10, 0);
+        }
+    }
+    ScmObj vals[7];
+    vals[0] = scheme_part(uri, &p);
+    vals[1] = userinfo;
+    vals[2] = host;
+    vals[3] = port;
+    vals[4] = Scm__UriPart(uri, &p, SCM_URI_PATH);
+    vals[5] = Scm__UriPart(uri, &p, SCM_URI_QUERY);
+    vals[6] = Scm__UriPart(uri, &p, SCM_URI_FRAGMENT);
+    return Scm_Values(Scm_ArrayToList(vals, 7));
+}
+
+/*=====================================================
+ * Percent encoding
+ */
+
+static void get_bytes(ScmObj src, const unsigned char **s, ScmSmallInt *n)
+{
+    if (SCM_STRINGP(src)) {
+        const ScmStringBody *b = SCM_STRING_BODY(src);
+        *s = (const unsigned char*)SCM_STRING_BODY_START(b);
+        *n = SCM_STRING_BODY_SIZE(b);
+    } else if (SCM_U8VECTORP(src)) {
+        *s = SCM_U8VECTOR_ELEMENTS(src);
+        *n = SCM_U8VECTOR_SIZE(src);
+    } else {
+        Scm_TypeError("src", "string or u8vector", src);
+    }
+}
+
+static const char hexdigits[] = "0123456789ABCDEF";
+
+static inline int hexval(unsigned char c)
+{
+    if (DIGIT_P(c)) return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+ScmObj Scm__UriEncode(ScmObj src, ScmCharSet *noescape)
+{
+    const unsigned char *s = NULL;
+    ScmSmallInt n = 0, size = 0;
+    char pass[0x80];
+
+    get_bytes(src, &s, &n);
+    for (int c = 0; c < 0x80; c++) {
+        pass[c] = Scm_CharSetContains(noescape, c) ? 1 : 0;
+    }
+    for (ScmSmallInt i = 0; i < n; i++) {
+        size += (s[i] < 0x80 && pass[s[i]]) ? 1 : 3;
+    }
+    /* Nothing to escape; the result can share the body. */
+    if (size == n && SCM_STRINGP(src)) return Scm_CopyString(SCM_STRING(src));
+
+    char *buf = SCM_NEW_ATOMIC2(char*, size + 1), *d = buf;
+    for (ScmSmallInt i = 0; i < n; i++) {
+        unsigned char b = s[i];
+        if (b < 0x80 && pass[b]) {
+            *d++ = b;
+        } else {
+            *d++ = '%';
+            *d++ = hexdigits[b >> 4];
+            *d++ = hexdigits[b & 0x0f];
+        }
+    }
+    *d = '\0';
+    return Scm_MakeString(buf, size, size, 0);
+}
+
+/* A '%' not followed by two hex digits is taken literally. */
+ScmObj Scm__UriDecode(ScmObj src, int cgiDecode, int final,
+                      ScmSmallInt *consumed)
+{
+    const unsigned char *s = NULL;
+    ScmSmallInt n = 0, i = 0;
+
+    get_bytes(src, &s, &n);
+    if (SCM_STRINGP(src) && memchr(s, '%', n) == NULL
+        && !(cgiDecode && memchr(s, '+', n) != NULL)) {
+        *consumed = n;
+        return Scm_CopyString(SCM_STRING(src));
+    }
+    unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*, n + 1), *d = buf;
+    while (i < n) {
+        const unsigned char *p = memchr(s + i, '%', n - i);
+        ScmSmallInt k = (p ? p - s : n);
+        if (cgiDecode) {
+            for (; i < k; i++) *d++ = (s[i] == '+') ? ' ' : s[i];
+        } else {
+            memcpy(d, s + i, k - i);
+            d += k - i;
+            i = k;
+        }
+        if (i == n) break;
+        /* s[i] == '%' */
+        if (!final && (i + 1 == n || (i + 2 == n && hexval(s[i+1]) >= 0))) {
+            break;
+        }
+        int h1 = (i + 1 < n) ? hexval(s[i+1]) : -1;
+        int h2 = (h1 >= 0 && i + 2 < n) ? hexval(s[i+2]) : -1;
+        if (h2 >= 0) {
+            *d++ = (unsigned char)(h1 * 16 + h2);
+            i += 3;
+        } else {
+            *d++ = '%';
+            i++;
+        }
+    }
+    *consumed = i;
+    *d = '\0';
+    if (SCM_U8VECTORP(src)) {
+        return Scm_MakeU8VectorFromArrayShared(d - buf, buf);
+    }
+    return Scm_MakeString((const char*)buf, d - buf, -1, 0);
+}
@@ -0,0 +1,94 @@
+/*
+ * uri-parser.h - URI parser for rfc.uri-parser
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_RFC_URI_PARSER_H
+#define GAUCHE_RFC_URI_PARSER_H
+
+/* Components of a URI, as byte offsets into the source.  The start
+   offset of a missing component is -1. */
+enum {
+    SCM_URI_SCHEME,
+    SCM_URI_SPECIFIC,
+    SCM_URI_AUTHORITY,
+    SCM_URI_PATH,
+    SCM_URI_QUERY,
+    SCM_URI_FRAGMENT,
+    SCM_URI_USERINFO,
+    SCM_URI_HOST,
+    SCM_URI_PORT,
+    SCM_URI_NUM_PARTS
+};
+
+typedef struct ScmUriPartsRec {
+    ScmSmallInt start[SCM_URI_NUM_PARTS];
+    ScmSmallInt end[SCM_URI_NUM_PARTS];
+} ScmUriParts;
+
+/* Each function looks at S[START..END) and fills the slots of the
+   components it recognizes.  Scm__UriSplitScheme sets the scheme
+   and the scheme specific part; Scm__UriSplitHierarchical sets the
+   authority, path, query and fragment; Scm__UriSplitAuthority sets
+   the userinfo, host and port, and returns FALSE if S isn't a valid
+   authority. */
+extern void Scm__UriSplitScheme(const char *s, ScmSmallInt start,
+                                ScmSmallInt end, ScmUriParts *p);
+extern void Scm__UriSplitHierarchical(const char *s, ScmSmallInt start,
+                                      ScmSmallInt end, ScmUriParts *p);
+extern int  Scm__UriSplitAuthority(const char *s, ScmSmallInt start,
+                                   ScmSmallInt end, ScmUriParts *p);
+
+/* Returns the component PART of SRC as a string sharing SRC's body,
+   or #f if it's missing. */
+extern ScmObj Scm__UriPart(ScmString *src, const ScmUriParts *p, int part);
+
+/* These return multiple values, the same as the procedures in rfc.uri
+   of the same name: uri-scheme&specific, uri-decompose-hierarchical,
+   uri-decompose-authority and uri-parse.  The second and the third
+   take #f as well, in which case all the values are #f. */
+extern ScmObj Scm__UriSchemeSpecific(ScmString *uri);
+extern ScmObj Scm__UriDecomposeHierarchical(ScmObj specific);
+extern ScmObj Scm__UriDecomposeAuthority(ScmObj authority);
+extern ScmObj Scm__UriParse(ScmString *uri);
+
+/* Percent-encodes SRC (a string or a u8vector).  Bytes below 0x80 that
+   are in NOESCAPE are passed through. */
+extern ScmObj Scm__UriEncode(ScmObj src, ScmCharSet *noescape);
+
+/* Decodes percent-encoded SRC (a string or a u8vector) and returns the
+   result of the same type.  If FINAL is false, stops before a '%'
+   sequence at the end that may be completed by more input.  *CONSUMED
+   is set to the number of bytes taken from SRC. */
+extern ScmObj Scm__UriDecode(ScmObj src, int cgiDecode, int final,
+                             ScmSmallInt *consumed);
+
+#endif /* GAUCHE_RFC_URI_PARSER_H */
@@ -0,0 +1,67 @@
+;;;
+;;; rfc.uri-parser - URI parser and percent-encoding
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; The parser and the percent-encoding codec behind rfc.uri.  This module
+;; isn't meant to be used directly; the API may change.
+;;
+;; The components returned by the parser share the body of the given
+;; string, so no bytes are copied.  SRC of the codec is a string or a
+;; u8vector.
+
+(define-module rfc.uri-parser
+  (export uri-split-scheme uri-split-hierarchical uri-split-authority
+          uri-split uri-encode-bytes uri-decode-bytes))
+(select-module rfc.uri-parser)
+
+(inline-stub
+ (declcode "#include \"uri-parser.h\"")
+
+ (define-cproc uri-split-scheme (uri::<string>)
+   (return (Scm__UriSchemeSpecific uri)))
+ (define-cproc uri-split-hierarchical (specific)
+   (return (Scm__UriDecomposeHierarchical specific)))
+ (define-cproc uri-split-authority (authority)
+   (return (Scm__UriDecomposeAuthority authority)))
+ (define-cproc uri-split (uri::<string>)
+   (return (Scm__UriParse uri)))
+
+ (define-cproc uri-encode-bytes (src noescape::<char-set>)
+   (return (Scm__UriEncode src noescape)))
+ ;; Returns the decoded string or u8vector, and the number of bytes
+ ;; consumed.  See uri-parser.h about FINAL.
+ (define-cproc uri-decode-bytes (src cgi-decode::<boolean> final::<boolean>)
+   (let* ([consumed::ScmSmallInt 0]
+          [r (Scm__UriDecode src cgi-decode final (& consumed))])
+     (return (Scm_Values2 r (SCM_MAKE_INT consumed)))))
+ )
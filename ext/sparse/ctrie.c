@@ -412,6 +412,211 @@ void CompactTrieCopy(CompactTrie *dst, const CompactTrie *src,
     dst->numEntries = src->numEntries;
 }
 
+/*
+ * Persistent update
+ */
+
+CompactTrieEdit *MakeCompactTrieEdit(void)
+{
+    CompactTrieEdit *e = SCM_NEW(CompactTrieEdit);
+    Scm_HashCoreInitSimple(&e->owned, SCM_HASH_WORD, 0, NULL);
+    return e;
+}
+
+int CompactTrieEditOwns(CompactTrieEdit *edit, void *p)
+{
+    if (edit == NULL) return FALSE;
+    return (Scm_HashCoreSearch(&edit->owned, (intptr_t)p, SCM_DICT_GET)
+            != NULL);
+}
+
+static void *edit_claim(CompactTrieEdit *edit, void *p)
+{
+    if (edit) (void)Scm_HashCoreSearch(&edit->owned, (intptr_t)p,
+                                       SCM_DICT_CREATE);
+    return p;
+}
+
+static Node *pnode_make(int nentry, CompactTrieEdit *edit)
+{
+    return (Node*)edit_claim(edit, make_node(nentry));
+}
+
+/* Returns a node we can modify: N itself if it's owned by EDIT, or
+   a fresh copy of N otherwise. */
+static Node *pnode_dup(Node *n, CompactTrieEdit *edit)
+{
+    if (CompactTrieEditOwns(edit, n)) return n;
+    int size = NODE_NCHILDREN(n);
+    Node *d = pnode_make(size, edit);
+    d->emap = n->emap;
+    d->lmap = n->lmap;
+    for (int i=0; i<size; i++) NODE_ENTRY(d, i) = NODE_ENTRY(n, i);
+    return d;
+}
+
+static Node *pnode_insert(Node *n, u_long ind, void *entry, int leafp,
+                          CompactTrieEdit *edit)
+{
+    if (CompactTrieEditOwns(edit, n)) {
+        return (Node*)edit_claim(edit, node_insert(n, ind, entry, leafp));
+    }
+    int size = NODE_NCHILDREN(n);
+    int insertpoint = NODE_INDEX2OFF(n, ind);
+    Node *d = pnode_make(size+1, edit);
+    d->emap = n->emap;
+    d->lmap = n->lmap;
+    NODE_ARC_SET(d, ind);
+    if (leafp) NODE_LEAF_SET(d, ind);
+    int i = 0;
+    for (; i<insertpoint; i++) NODE_ENTRY(d, i) = NODE_ENTRY(n, i);
+    NODE_ENTRY(d, insertpoint) = entry;
+    for (; i<size; i++) NODE_ENTRY(d, i+1) = NODE_ENTRY(n, i);
+    return d;
+}
+
+/* Creates a subtree at LEVEL that holds two leaves with different keys. */
+static Node *pnode_split(Leaf *l0, Leaf *l1, int level, CompactTrieEdit *edit)
+{
+    u_long i0 = KEY2INDEX(leaf_key(l0), level);
+    u_long i1 = KEY2INDEX(leaf_key(l1), level);
+    Node *m = pnode_make(NODE_SIZE_INCR, edit);
+
+    NODE_ARC_SET(m, i0);
+    if (i0 == i1) {
+        NODE_ENTRY(m, 0) = pnode_split(l0, l1, level+1, edit);
+    } else {
+        NODE_ARC_SET(m, i1);
+        NODE_LEAF_SET(m, i0);
+        NODE_LEAF_SET(m, i1);
+        NODE_ENTRY(m, (i0 < i1)? 0 : 1) = l0;
+        NODE_ENTRY(m, (i0 < i1)? 1 : 0) = l1;
+    }
+    return m;
+}
+
+typedef struct PUpdateRec {
+    Leaf *(*updater)(Leaf*, void*);
+    void *data;
+    CompactTrieEdit *edit;
+    Leaf *result;
+    int delta;                  /* change of the number of leaves */
+} PUpdate;
+
+static Leaf *pupd_leaf(Leaf *l0, u_long key, PUpdate *u)
+{
+    Leaf *l = u->updater(l0, u->data);
+    u->result = l;
+    if (l != NULL && l != l0) {
+        u_long data = leaf_data(l); /* leaf_key_set clears data bits */
+        leaf_key_set(l, key);
+        leaf_data_set(l, data);
+        edit_claim(u->edit, l);
+    }
+    return l;
+}
+
+/* Returns the entry to replace N in its parent.  It is N itself if
+   nothing is changed (or N is modified in place), a new node, or
+   a leaf (*leafp is set to TRUE) when N is eliminated because it's left
+   with a single leaf, in the same way as del_rec. */
+static void *pupd_rec(Node *n, u_long key, int level, PUpdate *u, int *leafp)
+{
+    u_long ind = KEY2INDEX(key, level);
+    *leafp = FALSE;
+
+    if (!NODE_HAS_ARC(n, ind)) {
+        Leaf *l = pupd_leaf(NULL, key, u);
+        if (l == NULL) return n;
+        u->delta = 1;
+        return pnode_insert(n, ind, l, TRUE, u->edit);
+    }
+
+    u_long off = NODE_INDEX2OFF(n, ind);
+    if (!NODE_ARC_IS_LEAF(n, ind)) {
+        Node *c = (Node*)NODE_ENTRY(n, off);
+        int cleaf;
+        void *m = pupd_rec(c, key, level+1, u, &cleaf);
+        if (m == (void*)c) return n;
+        if (cleaf && NODE_NCHILDREN(n) == 1 && level > 0) {
+            *leafp = TRUE;
+            return m;
+        }
+        Node *d = pnode_dup(n, u->edit);
+        NODE_ENTRY(d, off) = m;
+        if (cleaf) NODE_LEAF_SET(d, ind);
+        return d;
+    }
+
+    Leaf *l0 = (Leaf*)NODE_ENTRY(n, off);
+    if (leaf_key(l0) != key) {
+        Leaf *l = pupd_leaf(NULL, key, u);
+        if (l == NULL) return n;
+        u->delta = 1;
+        Node *s = pnode_split(l0, l, level+1, u->edit);
+        Node *d = pnode_dup(n, u->edit);
+        NODE_ENTRY(d, off) = s;
+        NODE_LEAF_RESET(d, ind);
+        return d;
+    }
+
+    Leaf *l = pupd_leaf(l0, key, u);
+    if (l == l0) return n;
+    if (l != NULL) {
+        Node *d = pnode_dup(n, u->edit);
+        NODE_ENTRY(d, off) = l;
+        return d;
+    }
+
+    /* Deleting L0. */
+    u->delta = -1;
+    int nc = NODE_NCHILDREN(n) - 1;
+    if (nc == 0) {
+        /* this only happens when N is root. */
+        SCM_ASSERT(level == 0);
+        return NULL;
+    }
+    if (nc == 1 && level > 0 && (n->lmap & ~(1UL<<ind)) != 0) {
+        /* the remaining child is a leaf; tell the parent to skip N. */
+        *leafp = TRUE;
+        return NODE_ENTRY(n, (off == 0)? 1 : 0);
+    }
+    Node *d = pnode_dup(n, u->edit);
+    node_delete(d, ind);
+    return d;
+}
+
+Leaf *CompactTrieUpdate(CompactTrie *ct, u_long key,
+                        Leaf *(*updater)(Leaf*, void*), void *data,
+                        CompactTrieEdit *edit)
+{
+    PUpdate u;
+    u.updater = updater;
+    u.data = data;
+    u.edit = edit;
+    u.result = NULL;
+    u.delta = 0;
+
+    KEY_MASK(key);
+    if (ct->root == NULL) {
+        Leaf *l = pupd_leaf(NULL, key, &u);
+        if (l != NULL) {
+            Node *r = pnode_make(NODE_SIZE_INCR, edit);
+            NODE_ARC_SET(r, key&TRIE_MASK);
+            NODE_LEAF_SET(r, key&TRIE_MASK);
+            NODE_ENTRY(r, 0) = l;
+            ct->root = r;
+            ct->numEntries = 1;
+        }
+        return l;
+    } else {
+        int leafp;
+        ct->root = (Node*)pupd_rec(ct->root, key, 0, &u, &leafp);
+        ct->numEntries += u.delta;
+        return u.result;
+    }
+}
+
 /*
  * Iterator
  */
@@ -166,6 +166,32 @@ extern void  CompactTrieCopy(CompactTrie *dst,
                              const CompactTrie *src,
                              Leaf *(*copy)(Leaf*, void*), void *data);
 
+/* Persistent update.
+ * CompactTrieUpdate never modifies reachable nodes; it copies the nodes
+ * on the path to KEY and installs the new path in CT.  Other tries
+ * sharing the old root keep seeing the old contents.
+ * UPDATER is called with the leaf for KEY, or NULL if there's none, and
+ * returns the leaf to be stored; NULL removes the leaf, and returning
+ * the given leaf leaves the trie intact.  The returned leaf must not be
+ * shared with other tries.  UPDATER is called before any node is
+ * allocated, so an error raised in it leaves the trie unchanged.
+ *
+ * If EDIT is not NULL, nodes and leaves created in the same edit session
+ * are modified in place instead of being copied (transient mode).
+ * A trie updated with an edit session must not be shared until the
+ * session is abandoned.
+ */
+typedef struct CompactTrieEditRec {
+    ScmHashCore owned;          /* nodes and leaves created in the session */
+} CompactTrieEdit;
+
+extern CompactTrieEdit *MakeCompactTrieEdit(void);
+extern int   CompactTrieEditOwns(CompactTrieEdit *edit, void *p);
+
+extern Leaf *CompactTrieUpdate(CompactTrie *ct, u_long key,
+                               Leaf *(*updater)(Leaf*, void*), void *data,
+                               CompactTrieEdit *edit);
+
 extern Leaf *CompactTrieFirstLeaf(CompactTrie *ct);
 extern Leaf *CompactTrieLastLeaf(CompactTrie *ct);
 extern Leaf *CompactTrieNextLeaf(CompactTrie *ct, u_long key);
@@ -0,0 +1,396 @@
+/*
+ * ptab.c - Persistent hashtable
+ *
+ *   Copyright (c) 2015  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "ptab.h"
+#include "sptab.h"
+
+/*===================================================================
+ * Leaf node manipulation
+ */
+
+/* Unlike the sparse table, a leaf of a persistent table may be shared
+   by multiple tables.  We never modify a leaf unless it is created in
+   the current edit session, and we never modify the chain alist, even
+   in that case, since the pairs may still be shared. */
+typedef struct PLeafRec {
+    Leaf hdr;                   /* data bit 0 indicates if key is chained */
+    ScmObj key;                 /* alist ((key . value) ...) if chained */
+    ScmObj value;               /* unused if chained */
+} PLeaf;
+
+static inline int pleaf_is_chained(PLeaf *leaf)
+{
+    return leaf_data(LEAF(leaf))&1;
+}
+
+static inline void pleaf_mark_chained(PLeaf *leaf)
+{
+    leaf_data_bit_set(LEAF(leaf), 0);
+}
+
+static inline void pleaf_mark_unchained(PLeaf *leaf)
+{
+    leaf_data_bit_reset(LEAF(leaf), 0);
+}
+
+static PLeaf *pleaf_new(ScmObj key, ScmObj value)
+{
+    PLeaf *z = SCM_NEW(PLeaf);
+    z->key = key;
+    z->value = value;
+    return z;
+}
+
+/* Returns a leaf we can modify. */
+static PLeaf *pleaf_writable(PLeaf *z, CompactTrieEdit *edit)
+{
+    if (CompactTrieEditOwns(edit, z)) return z;
+    PLeaf *d = SCM_NEW(PLeaf);
+    *d = *z;
+    return d;
+}
+
+/*===================================================================
+ * Constructor
+ */
+
+ScmObj MakePersistentTable(ScmHashType type, ScmComparator *comparator)
+{
+    PersistentTable *v = SCM_NEW(PersistentTable);
+    SCM_SET_CLASS(v, SCM_CLASS_PERSISTENT_TABLE);
+    CompactTrieInit(&v->trie);
+    v->numEntries = 0;
+    v->comparator = comparator;
+    v->edit = NULL;
+    if (type == SCM_HASH_GENERAL) SCM_ASSERT(comparator != NULL);
+    SparseTableHashFunctions(type, &v->hashfn, &v->cmpfn);
+    return SCM_OBJ(v);
+}
+
+SCM_DEFINE_BUILTIN_CLASS(Scm_PersistentTableClass,
+                         NULL, NULL, NULL, NULL,
+                         SCM_CLASS_DICTIONARY_CPL);
+SCM_DEFINE_BUILTIN_CLASS(Scm_TransientTableClass,
+                         NULL, NULL, NULL, NULL,
+                         SCM_CLASS_DICTIONARY_CPL);
+
+static PersistentTable *ptab_clone(PersistentTable *src, ScmClass *klass,
+                                   CompactTrieEdit *edit)
+{
+    PersistentTable *d = SCM_NEW(PersistentTable);
+    memcpy(d, src, sizeof(PersistentTable));
+    SCM_SET_CLASS(d, klass);
+    d->edit = edit;
+    return d;
+}
+
+static u_long ptab_hash(PersistentTable *pt, ScmObj key)
+{
+    if (pt->hashfn) return pt->hashfn(key);
+    ScmObj h = pt->comparator->hashFn;
+    ScmObj r = Scm_ApplyRec1(h, key);
+    if (!SCM_INTEGERP(r)) {
+        Scm_Error("hash function %S returns non-integer: %S", h, r);
+    }
+    return Scm_GetIntegerU(r);
+}
+
+static int ptab_eq(PersistentTable *pt, ScmObj a, ScmObj b)
+{
+    if (pt->cmpfn) return pt->cmpfn(a, b);
+    ScmObj e = pt->comparator->eqFn;
+    ScmObj r = Scm_ApplyRec2(e, a, b);
+    return !SCM_FALSEP(r);
+}
+
+/*===================================================================
+ * Lookup
+ */
+
+ScmObj PersistentTableRef(PersistentTable *pt, ScmObj key, ScmObj fallback)
+{
+    u_long hv = ptab_hash(pt, key);
+    PLeaf *z = (PLeaf*)CompactTrieGet(&pt->trie, hv);
+
+    if (z != NULL) {
+        if (!pleaf_is_chained(z)) {
+            if (ptab_eq(pt, key, z->key)) return z->value;
+        } else {
+            ScmObj cp;
+            SCM_FOR_EACH(cp, z->key) {
+                ScmObj p = SCM_CAR(cp);
+                if (ptab_eq(pt, key, SCM_CAR(p))) return SCM_CDR(p);
+            }
+        }
+    }
+    return fallback;
+}
+
+/*===================================================================
+ * Update
+ */
+
+typedef struct PUpdArgRec {
+    PersistentTable *pt;
+    ScmObj key;
+    ScmObj value;               /* SCM_UNBOUND to delete the entry */
+    int delta;                  /* change of the number of entries */
+} PUpdArg;
+
+/* Updater for CompactTrieUpdate.  Returns Z itself if there's nothing
+   to change. */
+static Leaf *pleaf_update(Leaf *leaf, void *data)
+{
+    PUpdArg *a = (PUpdArg*)data;
+    PersistentTable *pt = a->pt;
+    PLeaf *z = (PLeaf*)leaf;
+    int deletep = SCM_UNBOUNDP(a->value);
+
+    if (z == NULL) {
+        if (deletep) return NULL;
+        a->delta = 1;
+        return LEAF(pleaf_new(a->key, a->value));
+    }
+
+    if (!pleaf_is_chained(z)) {
+        if (ptab_eq(pt, a->key, z->key)) {
+            if (deletep) {
+                a->delta = -1;
+                return NULL;
+            }
+            if (SCM_EQ(z->value, a->value)) return leaf;
+            PLeaf *d = pleaf_writable(z, pt->edit);
+            d->value = a->value;
+            return LEAF(d);
+        }
+        if (deletep) return leaf;
+        /* hash collision; make the leaf chained */
+        ScmObj chain = SCM_LIST2(Scm_Cons(a->key, a->value),
+                                 Scm_Cons(z->key, z->value));
+        PLeaf *d = pleaf_writable(z, pt->edit);
+        pleaf_mark_chained(d);
+        d->key = chain;
+        d->value = SCM_NIL;
+        a->delta = 1;
+        return LEAF(d);
+    }
+
+    /* Chained leaf.  We copy the alist up to the entry with KEY. */
+    ScmObj h = SCM_NIL, t = SCM_NIL, cp;
+    SCM_FOR_EACH(cp, z->key) {
+        if (ptab_eq(pt, a->key, SCM_CAAR(cp))) break;
+        SCM_APPEND1(h, t, SCM_CAR(cp));
+    }
+    ScmObj rest;
+    if (SCM_NULLP(cp)) {
+        if (deletep) return leaf;
+        a->delta = 1;
+        rest = Scm_Cons(Scm_Cons(a->key, a->value), z->key);
+        h = SCM_NIL;
+    } else if (deletep) {
+        a->delta = -1;
+        rest = SCM_CDR(cp);
+    } else {
+        if (SCM_EQ(SCM_CDAR(cp), a->value)) return leaf;
+        rest = Scm_Cons(Scm_Cons(a->key, a->value), SCM_CDR(cp));
+    }
+    if (SCM_NULLP(h)) h = rest;
+    else SCM_SET_CDR(t, rest);
+
+    PLeaf *d = pleaf_writable(z, pt->edit);
+    if (SCM_NULLP(SCM_CDR(h))) {
+        /* make sure we have more than one entry in a chained leaf */
+        pleaf_mark_unchained(d);
+        d->key = SCM_CAAR(h);
+        d->value = SCM_CDAR(h);
+    } else {
+        d->key = h;
+    }
+    return LEAF(d);
+}
+
+/* Updates TRIE, which must be PT's trie or a copy of it.  TRIE must not
+   be shared unless PT has an edit session.  Returns the change of the
+   number of entries. */
+static int ptab_update(PersistentTable *pt, CompactTrie *trie,
+                       ScmObj key, ScmObj value)
+{
+    PUpdArg a;
+    a.pt = pt;
+    a.key = key;
+    a.value = value;
+    a.delta = 0;
+    CompactTrieUpdate(trie, ptab_hash(pt, key), pleaf_update, &a, pt->edit);
+    return a.delta;
+}
+
+/* Returns PT itself if nothing is changed.  Without an edit session,
+   any change creates a new root. */
+ScmObj PersistentTablePut(PersistentTable *pt, ScmObj key, ScmObj value)
+{
+    CompactTrie trie = pt->trie;
+
+    SCM_ASSERT(pt->edit == NULL);
+    int delta = ptab_update(pt, &trie, key, value);
+    if (trie.root == pt->trie.root) return SCM_OBJ(pt);
+    PersistentTable *d = ptab_clone(pt, SCM_CLASS_PERSISTENT_TABLE, NULL);
+    d->trie = trie;
+    d->numEntries += delta;
+    return SCM_OBJ(d);
+}
+
+/* Returns PT itself if it doesn't have KEY. */
+ScmObj PersistentTableDelete(PersistentTable *pt, ScmObj key)
+{
+    return PersistentTablePut(pt, key, SCM_UNBOUND);
+}
+
+/*===================================================================
+ * Transient table
+ */
+
+ScmObj PersistentTableTransient(PersistentTable *pt)
+{
+    return SCM_OBJ(ptab_clone(pt, SCM_CLASS_TRANSIENT_TABLE,
+                              MakeCompactTrieEdit()));
+}
+
+static void check_transient(PersistentTable *tt)
+{
+    if (tt->edit == NULL) {
+        Scm_Error("transient table has already been made persistent: %S",
+                  SCM_OBJ(tt));
+    }
+}
+
+ScmObj TransientTablePut(PersistentTable *tt, ScmObj key, ScmObj value)
+{
+    check_transient(tt);
+    tt->numEntries += ptab_update(tt, &tt->trie, key, value);
+    return value;
+}
+
+/* Returns TRUE if an entry is actually deleted. */
+int TransientTableDelete(PersistentTable *tt, ScmObj key)
+{
+    check_transient(tt);
+    int delta = ptab_update(tt, &tt->trie, key, SCM_UNBOUND);
+    tt->numEntries += delta;
+    return (delta != 0);
+}
+
+/* Returns a persistent table with the current content of TT, and
+   invalidates TT. */
+ScmObj TransientTablePersistent(PersistentTable *tt)
+{
+    check_transient(tt);
+    PersistentTable *d = ptab_clone(tt, SCM_CLASS_PERSISTENT_TABLE, NULL);
+    tt->edit = NULL;
+    return SCM_OBJ(d);
+}
+
+/*===================================================================
+ * Iterators
+ */
+
+void PersistentTableIterInit(PersistentTableIter *it, PersistentTable *pt)
+{
+    it->pt = pt;
+    CompactTrieIterInit(&it->ctit, &pt->trie);
+    it->chain = SCM_NIL;
+    it->end = FALSE;
+}
+
+/* returns (key . value) or #f */
+ScmObj PersistentTableIterNext(PersistentTableIter *it)
+{
+    if (it->end) return SCM_FALSE;
+    if (SCM_PAIRP(it->chain)) {
+        ScmObj p = SCM_CAR(it->chain);
+        it->chain = SCM_CDR(it->chain);
+        return p;
+    } else {
+        PLeaf *z = (PLeaf*)CompactTrieIterNext(&it->ctit);
+        if (z == NULL) { it->end = TRUE; return SCM_FALSE; }
+        if (!pleaf_is_chained(z)) {
+            return Scm_Cons(z->key, z->value);
+        }
+        it->chain = SCM_CDR(z->key);
+        return SCM_CAR(z->key);
+    }
+}
+
+/*===================================================================
+ * Miscellaneous
+ */
+
+static void leaf_dump(ScmPort *out, Leaf *leaf, int indent, void *data)
+{
+    PLeaf *z = (PLeaf*)leaf;
+
+    if (pleaf_is_chained(z)) {
+        Scm_Printf(out, "(chained)");
+        ScmObj cp;
+        SCM_FOR_EACH(cp, z->key) {
+            ScmObj p = SCM_CAR(cp);
+            SCM_ASSERT(SCM_PAIRP(p));
+            Scm_Printf(out, "\n  %*s%S => %25.1S", indent, "",
+                       SCM_CAR(p), SCM_CDR(p));
+        }
+    } else {
+        Scm_Printf(out, "\n  %*s%S => %25.1S", indent, "",
+                   z->key, z->value);
+    }
+}
+
+void PersistentTableDump(PersistentTable *pt)
+{
+    CompactTrieDump(SCM_CUROUT, &pt->trie, leaf_dump, NULL);
+}
+
+void PersistentTableCheck(PersistentTable *pt)
+{
+    CompactTrieCheck(&pt->trie, SCM_OBJ(pt), NULL);
+}
+
+/*===================================================================
+ * Initialization
+ */
+
+void Scm_Init_ptab(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_PersistentTableClass, "<persistent-table>",
+                        mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_TransientTableClass, "<transient-table>",
+                        mod, NULL, 0);
+}
@@ -0,0 +1,107 @@
+/*
+ * ptab.h - Persistent hashtable
+ *
+ *   Copyright (c) 2015  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_PTAB_H
+#define GAUCHE_PTAB_H
+
+#include <gauche.h>
+#include <gauche/extend.h>
+
+#if defined(EXTSPARSE_EXPORTS)
+#define LIBGAUCHE_EXT_BODY
+#endif
+#include <gauche/extern.h>      /* redefine SCM_EXTERN */
+
+#include "ctrie.h"
+
+/* Persistent table is an immutable hash table that shares structure
+ * with the table it is derived from.  Updating it returns a new table
+ * in O(log32 n), copying only the path to the updated leaf.
+ *
+ * Transient table is a mutable version of persistent table, for batch
+ * updates.  It shares the structure with the persistent table it is
+ * created from, and modifies the nodes it has created in place.
+ * Once it is made persistent again, it can no longer be modified.
+ *
+ * Both share the same C structure; EDIT is NULL for persistent tables,
+ * and for transient tables that are already made persistent.
+ */
+typedef struct PersistentTableRec {
+    SCM_HEADER;
+    CompactTrie trie;
+    u_long      numEntries;
+    u_long      (*hashfn)(ScmObj key);
+    int         (*cmpfn)(ScmObj a, ScmObj b);
+    ScmComparator *comparator;
+    CompactTrieEdit *edit;      /* only used for transient table */
+} PersistentTable;
+
+SCM_CLASS_DECL(Scm_PersistentTableClass);
+#define SCM_CLASS_PERSISTENT_TABLE  (&Scm_PersistentTableClass)
+#define PERSISTENT_TABLE(obj)       ((PersistentTable*)(obj))
+#define PERSISTENT_TABLE_P(obj)     SCM_XTYPEP(obj, SCM_CLASS_PERSISTENT_TABLE)
+
+SCM_CLASS_DECL(Scm_TransientTableClass);
+#define SCM_CLASS_TRANSIENT_TABLE   (&Scm_TransientTableClass)
+#define TRANSIENT_TABLE_P(obj)      SCM_XTYPEP(obj, SCM_CLASS_TRANSIENT_TABLE)
+
+extern ScmObj MakePersistentTable(ScmHashType type, ScmComparator *data);
+extern ScmObj PersistentTableRef(PersistentTable *pt, ScmObj key,
+                                 ScmObj fallback);
+extern ScmObj PersistentTablePut(PersistentTable *pt, ScmObj key,
+                                 ScmObj value);
+extern ScmObj PersistentTableDelete(PersistentTable *pt, ScmObj key);
+
+extern ScmObj PersistentTableTransient(PersistentTable *pt);
+extern ScmObj TransientTablePut(PersistentTable *tt, ScmObj key, ScmObj value);
+extern int    TransientTableDelete(PersistentTable *tt, ScmObj key);
+extern ScmObj TransientTablePersistent(PersistentTable *tt);
+
+extern void   PersistentTableDump(PersistentTable *pt);
+extern void   PersistentTableCheck(PersistentTable *pt);
+
+/* Iterator */
+typedef struct PersistentTableIterRec {
+    PersistentTable *pt;
+    CompactTrieIter ctit;
+    ScmObj chain;
+    int end;
+} PersistentTableIter;
+
+extern void   PersistentTableIterInit(PersistentTableIter *it,
+                                      PersistentTable *pt);
+extern ScmObj PersistentTableIterNext(PersistentTableIter *it);
+
+extern void   Scm_Init_ptab(ScmModule *mod);
+
+#endif /*GAUCHE_PTAB_H*/
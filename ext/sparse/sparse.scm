@@ -43,6 +43,23 @@
           sparse-table-keys sparse-table-values sparse-table-comparator
           %sparse-table-dump %sparse-table-check
 
+          <persistent-table> make-persistent-table alist->persistent-table
+          persistent-table-num-entries persistent-table-comparator
+          persistent-table-ref persistent-table-exists?
+          persistent-table-put persistent-table-delete persistent-table-update
+          persistent-table-fold persistent-table-map persistent-table-for-each
+          persistent-table-keys persistent-table-values
+          persistent-table->alist
+          persistent-table-transient
+          <transient-table> transient-table-num-entries
+          transient-table-ref transient-table-exists?
+          transient-table-put! transient-table-delete!
+          transient-table-update! transient-table-push! transient-table-pop!
+          transient-table-fold transient-table-map transient-table-for-each
+          transient-table-keys transient-table-values
+          transient-table-comparator transient-table-persistent!
+          %persistent-table-dump %persistent-table-check
+
           <sparse-vector-base> <sparse-vector> <sparse-s8vector>
           <sparse-u8vector> <sparse-s16vector> <sparse-u16vector>
           <sparse-s32vector> <sparse-u32vector> <sparse-s64vector>
@@ -56,6 +73,9 @@
           sparse-vector-push! sparse-vector-pop!
           sparse-vector-fold sparse-vector-map sparse-vector-for-each
           sparse-vector-keys sparse-vector-values
+          sparse-vector-dot sparse-vector-scale! sparse-vector-add!
+          sparse-vector->dense uvector->sparse-vector
+          sparse-vector-batch-generator
           %sparse-vector-dump
 
           <sparse-matrix-base> <sparse-matrix> <sparse-s8matrix>
@@ -78,19 +98,17 @@
  (declcode "#include \"ctrie.h\""
            "#include \"spvec.h\""
            "#include \"sptab.h\""
+           "#include \"ptab.h\""
            "#include <gauche/bits_inline.h>")
  )
 
-(define-macro (define-stuff type class iter ref set)
+;; Read-only operations, shared by persistent tables.
+(define-macro (define-read-stuff type class iter ref)
   (let ([x-fold     (string->symbol #"~|type|-fold")]
         [x-map      (string->symbol #"~|type|-map")]
         [x-for-each (string->symbol #"~|type|-for-each")]
         [x-keys     (string->symbol #"~|type|-keys")]
-        [x-values   (string->symbol #"~|type|-values")]
-        [x-update!  (string->symbol #"~|type|-update!")]
-        [x-push!    (string->symbol #"~|type|-push!")]
-        [x-pop!     (string->symbol #"~|type|-pop!")]
-        [x-pop!-aux (string->symbol #"%~|type|-pop!-aux")])
+        [x-values   (string->symbol #"~|type|-values")])
     `(begin
        (define (,x-fold st proc seed)
          (let ([iter (,iter st)]
@@ -109,6 +127,25 @@
        (define (,x-values st)
          (,x-fold st (^[k v s] (cons v s)) '()))
 
+       (define-method ref ((s ,class) key . maybe-fallback)
+         (apply ,ref s key maybe-fallback))
+       (define-method call-with-iterator ((s ,class) proc)
+         (let ([iter (,iter s)]
+               [sentinel (list #f)])
+           (define (next) (receive (k v) (iter sentinel) (cons k v)))
+           (define cache (next))
+           (proc (^[] (eq? (car cache) sentinel))
+                 (^[] (rlet1 v cache (set! cache (next)))))))
+       )))
+
+(define-macro (define-stuff type class iter ref set)
+  (let ([x-update!  (string->symbol #"~|type|-update!")]
+        [x-push!    (string->symbol #"~|type|-push!")]
+        [x-pop!     (string->symbol #"~|type|-pop!")]
+        [x-pop!-aux (string->symbol #"%~|type|-pop!-aux")])
+    `(begin
+       (define-read-stuff ,type ,class ,iter ,ref)
+
        ;; TODO: rewrite these more efficiently
        (define (,x-update! sv k proc . fallback)
          (rlet1 tmp (proc (apply ,ref sv k fallback))
@@ -131,17 +168,8 @@
          (car p))
 
        ;; basic generic operations
-       (define-method ref ((s ,class) key . maybe-fallback)
-         (apply ,ref s key maybe-fallback))
        (define-method (setter ref) ((s ,class) key v)
          (,set s key v))
-       (define-method call-with-iterator ((s ,class) proc)
-         (let ([iter (,iter s)]
-               [sentinel (list #f)])
-           (define (next) (receive (k v) (iter sentinel) (cons k v)))
-           (define cache (next))
-           (proc (^[] (eq? (car cache) sentinel))
-                 (^[] (rlet1 v cache (set! cache (next)))))))
        )))
 
 ;;===============================================================
@@ -220,20 +248,23 @@
     (equal? . ,equal-comparator)
     (string=? . ,string-comparator)))
 
-(define (make-sparse-table comparator)
+(define (canonical-comparator who comparator)
   (define (bad)
-    (error "make-sparse-table needs a comparator or one of the symbols eq?, \
-            eqv?, equal? or string=?, as an argument, but got:" comparator))
-  (receive (type cmpr)
-      (cond [(symbol? comparator)
-             (if-let1 cmpr (assq-ref *shortcut-comparators* comparator)
-               (values comparator cmpr)
-               (bad))]
-            [(comparator? comparator)
-             (if-let1 type (rassq-ref *shortcut-comparators* comparator)
-               (values type comparator)
-               (values #f comparator))]
-            [else (bad)])
+    (errorf "~a needs a comparator or one of the symbols eq?, \
+             eqv?, equal? or string=?, as an argument, but got: ~s"
+            who comparator))
+  (cond [(symbol? comparator)
+         (if-let1 cmpr (assq-ref *shortcut-comparators* comparator)
+           (values comparator cmpr)
+           (bad))]
+        [(comparator? comparator)
+         (if-let1 type (rassq-ref *shortcut-comparators* comparator)
+           (values type comparator)
+           (values #f comparator))]
+        [else (bad)]))
+
+(define (make-sparse-table comparator)
+  (receive (type cmpr) (canonical-comparator 'make-sparse-table comparator)
     (%make-sparse-table type cmpr)))
 
 (define (sparse-table-push! sptab key val)
@@ -243,13 +274,143 @@
 (define-stuff sparse-table <sparse-table> %sparse-table-iter
   sparse-table-ref sparse-table-set!)
 
+;;===============================================================
+;; Persistent tables
+;;
+
+(inline-stub
+ (initcode "Scm_Init_ptab(Scm_CurrentModule());")
+
+ (define-type <persistent-table> "PersistentTable*" "persistent table"
+   "PERSISTENT_TABLE_P" "PERSISTENT_TABLE")
+ (define-type <transient-table> "PersistentTable*" "transient table"
+   "TRANSIENT_TABLE_P" "PERSISTENT_TABLE")
+
+ (define-cproc %make-persistent-table (type cmpr::<comparator>)
+   (let* ([t::ScmHashType SCM_HASH_EQ])
+     (cond
+      [(SCM_EQ type 'eq?)      (set! t SCM_HASH_EQ)]
+      [(SCM_EQ type 'eqv?)     (set! t SCM_HASH_EQV)]
+      [(SCM_EQ type 'equal?)   (set! t SCM_HASH_EQUAL)]
+      [(SCM_EQ type 'string=?) (set! t SCM_HASH_STRING)]
+      [else                    (set! t SCM_HASH_GENERAL)])
+     (return (MakePersistentTable t cmpr))))
+
+ (define-cproc persistent-table-comparator (pt::<persistent-table>)
+   (return (SCM_OBJ (-> pt comparator))))
+
+ (define-cproc persistent-table-num-entries (pt::<persistent-table>) ::<ulong>
+   (return (-> pt numEntries)))
+
+ (define-cproc persistent-table-ref (pt::<persistent-table> key
+                                                            :optional fallback)
+   (let* ([r (PersistentTableRef pt key fallback)])
+     (when (SCM_UNBOUNDP r)
+       (Scm_Error "%S doesn't have an entry for key %S" (SCM_OBJ pt) key))
+     (return r)))
+
+ (define-cproc persistent-table-exists? (pt::<persistent-table> key)
+   ::<boolean>
+   (let* ([r (PersistentTableRef pt key SCM_UNBOUND)])
+     (return (not (SCM_UNBOUNDP r)))))
+
+ (define-cproc persistent-table-put (pt::<persistent-table> key value)
+   PersistentTablePut)
+
+ (define-cproc persistent-table-delete (pt::<persistent-table> key)
+   PersistentTableDelete)
+
+ (define-cproc persistent-table-transient (pt::<persistent-table>)
+   PersistentTableTransient)
+
+ (define-cproc transient-table-comparator (tt::<transient-table>)
+   (return (SCM_OBJ (-> tt comparator))))
+
+ (define-cproc transient-table-num-entries (tt::<transient-table>) ::<ulong>
+   (return (-> tt numEntries)))
+
+ (define-cproc transient-table-put! (tt::<transient-table> key value) ::<void>
+   TransientTablePut)
+
+ (define-cproc transient-table-ref (tt::<transient-table> key
+                                                          :optional fallback)
+   (setter transient-table-put!)
+   (let* ([r (PersistentTableRef tt key fallback)])
+     (when (SCM_UNBOUNDP r)
+       (Scm_Error "%S doesn't have an entry for key %S" (SCM_OBJ tt) key))
+     (return r)))
+
+ (define-cproc transient-table-exists? (tt::<transient-table> key)
+   ::<boolean>
+   (let* ([r (PersistentTableRef tt key SCM_UNBOUND)])
+     (return (not (SCM_UNBOUNDP r)))))
+
+ (define-cproc transient-table-delete! (tt::<transient-table> key) ::<boolean>
+   TransientTableDelete)
+
+ (define-cproc transient-table-persistent! (tt::<transient-table>)
+   TransientTablePersistent)
+
+ (define-cfn persistent-table-iter (args::ScmObj* nargs::int data::void*)
+   :static
+   (let* ([iter::PersistentTableIter* (cast PersistentTableIter* data)]
+          [r (PersistentTableIterNext iter)]
+          [eofval (aref args 0)])
+     (if (SCM_FALSEP r)
+       (return (values eofval eofval))
+       (return (values (SCM_CAR r) (SCM_CDR r))))))
+
+ (define-cfn make-persistent-table-iter (pt::PersistentTable*) :static
+   (let* ([iter::PersistentTableIter* (SCM_NEW PersistentTableIter)])
+     (PersistentTableIterInit iter pt)
+     (return (Scm_MakeSubr persistent-table-iter iter 1 0
+                           '"persistent-table-iterator"))))
+
+ (define-cproc %persistent-table-iter (pt::<persistent-table>)
+   (return (make-persistent-table-iter pt)))
+
+ (define-cproc %transient-table-iter (tt::<transient-table>)
+   (return (make-persistent-table-iter tt)))
+
+ (define-cproc %persistent-table-dump (pt::<persistent-table>) ::<void>
+   PersistentTableDump)
+
+ (define-cproc %persistent-table-check (pt::<persistent-table>) ::<void>
+   PersistentTableCheck)
+ )
+
+(define (make-persistent-table comparator)
+  (receive (type cmpr) (canonical-comparator 'make-persistent-table comparator)
+    (%make-persistent-table type cmpr)))
+
+(define (alist->persistent-table alist comparator)
+  (let1 tt (persistent-table-transient (make-persistent-table comparator))
+    (dolist [p alist] (transient-table-put! tt (car p) (cdr p)))
+    (transient-table-persistent! tt)))
+
+(define (persistent-table-update pt key proc . fallback)
+  (persistent-table-put pt key (proc (apply persistent-table-ref pt key
+                                            fallback))))
+
+(define (persistent-table->alist pt)
+  (persistent-table-map pt cons))
+
+(define-read-stuff persistent-table <persistent-table> %persistent-table-iter
+  persistent-table-ref)
+
+(define (transient-table-push! tt key val)
+  (transient-table-put! tt key (cons val (transient-table-ref tt key '()))))
+
+(define-stuff transient-table <transient-table> %transient-table-iter
+  transient-table-ref transient-table-put!)
+
 ;;===============================================================
 ;; Sparse vectors
 ;;
 
 (define (make-sparse-vector :optional (type #f)
-                            :key (flags 0) default)
-  (%make-sparse-vector type default flags))
+                            :key (flags 0) default (concurrent #f))
+  (%make-sparse-vector type default flags concurrent))
 
 (inline-stub
  (initcode "Scm_Init_spvec(Scm_CurrentModule());")
@@ -257,7 +418,8 @@
  (define-type <sparse-vector> "SparseVector*" "sparse vector"
    "SPARSE_VECTOR_BASE_P" "SPARSE_VECTOR")
 
- (define-cproc %make-sparse-vector (type default-value flags::<ulong>)
+ (define-cproc %make-sparse-vector (type default-value flags::<ulong>
+                                     :optional (concurrent::<boolean> #f))
    (let* ([klass::ScmClass* NULL])
      (cond [(SCM_CLASSP type)  (set! klass (SCM_CLASS type))]
            [(SCM_FALSEP type)  (set! klass SCM_CLASS_SPARSE_VECTOR)]
@@ -277,7 +439,9 @@
                                  one of symbols s8, u8, s16, u16, s32, u32, \
                                  s64, u64, f16, f32, f64"
                                 type)])
-     (return (MakeSparseVector klass default-value 0))))
+     (when concurrent
+       (set! flags (logior flags SPARSE_VECTOR_CONCURRENT)))
+     (return (MakeSparseVector klass default-value flags))))
 
  (define-cproc sparse-vector-max-index-bits () ::<int>
    (return SPARSE_VECTOR_MAX_INDEX_BITS))
@@ -346,8 +510,54 @@
 
  (define-cproc %sparse-vector-dump (sv::<sparse-vector>) ::<void>
    SparseVectorDump)
+
+ ;; Bulk operations
+ (define-cproc sparse-vector-dot (a::<sparse-vector> b) SparseVectorDot)
+
+ (define-cproc sparse-vector-scale! (sv::<sparse-vector> k::<number>)
+   (SparseVectorScale sv k)
+   (return (SCM_OBJ sv)))
+
+ (define-cproc sparse-vector-add! (dst::<sparse-vector> src
+                                   :optional (k::<number> 1))
+   (SparseVectorAdd dst src k)
+   (return (SCM_OBJ dst)))
+
+ (define-cproc sparse-vector->dense (sv::<sparse-vector>
+                                     :optional (size::<fixnum> -1))
+   (return (SparseVectorToDense sv size)))
+
+ (define-cproc %uvector->sparse-vector (uv::<uvector> default)
+   (return (UVectorToSparseVector uv default)))
+
+ (define-cfn sparse-vector-batch-iter (args::ScmObj* nargs::int data::void*)
+   :static
+   (let* ([iter::SparseVectorIter* (cast SparseVectorIter* data)]
+          [n (aref args 0)])
+     (unless (SCM_INTP n)
+       (Scm_TypeError "batch size" "fixnum" n))
+     (let* ([r (SparseVectorIterNextBatch iter (SCM_INT_VALUE n))])
+       (return (?: (SCM_FALSEP r) SCM_EOF r)))))
+
+ (define-cproc %sparse-vector-batch-iter (sv::<sparse-vector>)
+   (let* ([iter::SparseVectorIter* (SCM_NEW SparseVectorIter)])
+     (SparseVectorIterInit iter sv)
+     (return
+      (Scm_MakeSubr sparse-vector-batch-iter iter 1 0
+                    '"sparse-vector-batch-iterator"))))
  )
 
+(define (uvector->sparse-vector uv :key default)
+  (%uvector->sparse-vector uv default))
+
+;; Returns a generator that yields a pair of a u64vector of indices and
+;; a vector of the corresponding values, up to N entries at a time.
+(define (sparse-vector-batch-generator spvec n)
+  (unless (and (exact-integer? n) (positive? n))
+    (error "batch size must be a positive exact integer, but got:" n))
+  (let1 iter (%sparse-vector-batch-iter spvec)
+    (^[] (iter n))))
+
 (define (sparse-vector-push! spvec key val)
   ;; Can be optimized
   (if (undefined? (sparse-vector-default-value spvec))
@@ -444,7 +654,7 @@
   )
 
 (define (make-sparse-matrix :optional (type #f)
-                            :key (flags 0) default)
+                            :key (flags 0) default (concurrent #f))
   (let1 class
       (case type
         [(#f)  <sparse-matrix>]
@@ -466,7 +676,7 @@
                         <sparse-matrix-base>, #f, or one of \
                         s8, u8, s16, u16, s32, u32, s64, u64, \
                         f16, f32 or f64, but got:" type))])
-    (%make-sparse-vector class default flags)))
+    (%make-sparse-vector class default flags concurrent)))
 
 (define-cproc sparse-matrix-num-entries (sv::<sparse-matrix>) ::<ulong>
   (return (-> sv numEntries)))
@@ -613,6 +823,31 @@
   :update!   sparse-table-update!
   :comparator sparse-table-comparator)
 
+(define-dict-interface <persistent-table>
+  :get       persistent-table-ref
+  :exists?   persistent-table-exists?
+  :fold      persistent-table-fold
+  :for-each  persistent-table-for-each
+  :map       persistent-table-map
+  :keys      persistent-table-keys
+  :values    persistent-table-values
+  :comparator persistent-table-comparator)
+
+(define-dict-interface <transient-table>
+  :get       transient-table-ref
+  :put!      transient-table-put!
+  :delete!   transient-table-delete!
+  :exists?   transient-table-exists?
+  :fold      transient-table-fold
+  :for-each  transient-table-for-each
+  :map       transient-table-map
+  :keys      transient-table-keys
+  :values    transient-table-values
+  :pop!      transient-table-pop!
+  :push!     transient-table-push!
+  :update!   transient-table-update!
+  :comparator transient-table-comparator)
+
 (define-dict-interface <sparse-vector-base>
   :get       sparse-vector-ref
   :put!      sparse-vector-set!
@@ -96,40 +96,49 @@ static int string_cmp(ScmObj a, ScmObj b)
     return Scm_StringEqual(SCM_STRING(a), SCM_STRING(b));
 }
 
-ScmObj MakeSparseTable(ScmHashType type, ScmComparator *comparator,
-                       u_long flags)
+/* Sets up hash and comparison functions for the hash type.  For
+   SCM_HASH_GENERAL, both are set to NULL, and the caller should use
+   the comparator.  Shared with persistent tables. */
+void SparseTableHashFunctions(ScmHashType type,
+                              u_long (**hashfn)(ScmObj),
+                              int (**cmpfn)(ScmObj, ScmObj))
 {
-    SparseTable *v = SCM_NEW(SparseTable);
-    SCM_SET_CLASS(v, SCM_CLASS_SPARSE_TABLE);
-    CompactTrieInit(&v->trie);
-    v->numEntries = 0;
-    v->comparator = comparator;
-
     switch (type) {
     case SCM_HASH_EQ:
-        v->hashfn = Scm_EqHash;
-        v->cmpfn = Scm_EqP;
+        *hashfn = Scm_EqHash;
+        *cmpfn = Scm_EqP;
         break;
     case SCM_HASH_EQV:
-        v->hashfn = Scm_EqvHash;
-        v->cmpfn = Scm_EqvP;
+        *hashfn = Scm_EqvHash;
+        *cmpfn = Scm_EqvP;
         break;
     case SCM_HASH_EQUAL:
-        v->hashfn = Scm_Hash;
-        v->cmpfn = Scm_EqualP;
+        *hashfn = Scm_Hash;
+        *cmpfn = Scm_EqualP;
         break;
     case SCM_HASH_STRING:
-        v->hashfn = string_hash;
-        v->cmpfn = string_cmp;
+        *hashfn = string_hash;
+        *cmpfn = string_cmp;
         break;
     case SCM_HASH_GENERAL:
-        SCM_ASSERT(comparator != NULL);
-        v->hashfn = NULL;
-        v->cmpfn = NULL;
+        *hashfn = NULL;
+        *cmpfn = NULL;
         break;
     default:
         Scm_Error("invalid hash type (%d) for a sparse hash table", type);
     }
+}
+
+ScmObj MakeSparseTable(ScmHashType type, ScmComparator *comparator,
+                       u_long flags)
+{
+    SparseTable *v = SCM_NEW(SparseTable);
+    SCM_SET_CLASS(v, SCM_CLASS_SPARSE_TABLE);
+    CompactTrieInit(&v->trie);
+    v->numEntries = 0;
+    v->comparator = comparator;
+    if (type == SCM_HASH_GENERAL) SCM_ASSERT(comparator != NULL);
+    SparseTableHashFunctions(type, &v->hashfn, &v->cmpfn);
     return SCM_OBJ(v);
 }
 
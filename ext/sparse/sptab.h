@@ -67,6 +67,10 @@ extern ScmObj SparseTableDelete(SparseTable *st, ScmObj key);
 extern void   SparseTableClear(SparseTable *st);
 extern ScmObj SparseTableCopy(const SparseTable *st);
 
+extern void   SparseTableHashFunctions(ScmHashType type,
+                                       u_long (**hashfn)(ScmObj),
+                                       int (**cmpfn)(ScmObj, ScmObj));
+
 extern void   SparseTableDump(SparseTable *sv);
 extern void   SparseTableCheck(SparseTable *sv);
 
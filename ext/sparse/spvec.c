@@ -65,7 +65,20 @@ SCM_DEFINE_BUILTIN_CLASS(Scm_SparseMatrixBaseClass,
                          NULL, NULL, NULL, NULL,
                          spmat_cpl+1);
 
-ScmObj SparseVectorRef(SparseVector *sv, u_long index, ScmObj fallback)
+/* Concurrent sparse vectors serialize the access to the trie with
+   the per-vector lock, so that threads sharing a vector don't have to
+   wrap every access with a mutex of their own.  Storing a value into
+   a uniform vector may raise an error, hence these operations are
+   protected by SCM_UNWIND_PROTECT.  Non-concurrent vectors pay only
+   for the flag test. */
+#define CONCURRENT_P(sv)  ((sv)->flags & SPARSE_VECTOR_CONCURRENT)
+
+#define LOCK(sv) \
+    do { if (CONCURRENT_P(sv)) SCM_INTERNAL_MUTEX_LOCK((sv)->lock); } while (0)
+#define UNLOCK(sv) \
+    do { if (CONCURRENT_P(sv)) SCM_INTERNAL_MUTEX_UNLOCK((sv)->lock); } while (0)
+
+static ScmObj spvec_ref(SparseVector *sv, u_long index, ScmObj fallback)
 {
     INDEX_CHECK(index);
     Leaf *leaf = CompactTrieGet(&sv->trie, index >> sv->desc->shift);
@@ -75,7 +88,16 @@ ScmObj SparseVectorRef(SparseVector *sv, u_long index, ScmObj fallback)
     else return v;
 }
 
-void SparseVectorSet(SparseVector *sv, u_long index, ScmObj value)
+ScmObj SparseVectorRef(SparseVector *sv, u_long index, ScmObj fallback)
+{
+    if (!CONCURRENT_P(sv)) return spvec_ref(sv, index, fallback);
+    SCM_INTERNAL_MUTEX_LOCK(sv->lock);
+    ScmObj r = spvec_ref(sv, index, fallback);
+    SCM_INTERNAL_MUTEX_UNLOCK(sv->lock);
+    return r;
+}
+
+static void spvec_set(SparseVector *sv, u_long index, ScmObj value)
 {
     INDEX_CHECK(index);
     Leaf *leaf = CompactTrieAdd(&sv->trie, index >> sv->desc->shift,
@@ -84,21 +106,45 @@ void SparseVectorSet(SparseVector *sv, u_long index, ScmObj value)
     if (sv->desc->set(leaf, index, value)) sv->numEntries++;
 }
 
+void SparseVectorSet(SparseVector *sv, u_long index, ScmObj value)
+{
+    if (!CONCURRENT_P(sv)) {
+        spvec_set(sv, index, value);
+        return;
+    }
+    SCM_INTERNAL_MUTEX_LOCK(sv->lock);
+    SCM_UNWIND_PROTECT {
+        spvec_set(sv, index, value);
+    }
+    SCM_WHEN_ERROR {
+        SCM_INTERNAL_MUTEX_UNLOCK(sv->lock);
+        SCM_NEXT_HANDLER;
+    }
+    SCM_END_PROTECT;
+    SCM_INTERNAL_MUTEX_UNLOCK(sv->lock);
+}
+
 /* returns value of the deleted entry, or SCM_UNBOUND if there's no entry */
 ScmObj SparseVectorDelete(SparseVector *sv, u_long index)
 {
     INDEX_CHECK(index);
+    ScmObj r = SCM_UNBOUND;
+    LOCK(sv);
     Leaf *leaf = CompactTrieGet(&sv->trie, index >> sv->desc->shift);
-    if (leaf == NULL) return SCM_UNBOUND;
-    ScmObj r = sv->desc->delete(leaf, index);
-    if (!SCM_UNBOUNDP(r)) sv->numEntries--;
+    if (leaf != NULL) {
+        r = sv->desc->delete(leaf, index);
+        if (!SCM_UNBOUNDP(r)) sv->numEntries--;
+    }
+    UNLOCK(sv);
     return r;
 }
 
 void SparseVectorClear(SparseVector *sv)
 {
+    LOCK(sv);
     sv->numEntries = 0;
     CompactTrieClear(&sv->trie, sv->desc->clear, sv->desc);
+    UNLOCK(sv);
 }
 
 ScmObj SparseVectorCopy(const SparseVector *src)
@@ -107,8 +153,10 @@ ScmObj SparseVectorCopy(const SparseVector *src)
         (SparseVector*)MakeSparseVector(Scm_ClassOf(SCM_OBJ(src)),
                                         src->defaultValue,
                                         src->flags);
+    LOCK((SparseVector*)src);
     CompactTrieCopy(&dst->trie, &src->trie, src->desc->copy, src->desc);
     dst->numEntries = src->numEntries;
+    UNLOCK((SparseVector*)src);
     return SCM_OBJ(dst);
 }
 
@@ -120,52 +168,84 @@ void SparseVectorIterInit(SparseVectorIter *iter, SparseVector *sv)
     iter->leafIndex = -1;
 }
 
-ScmObj SparseVectorIterNext(SparseVectorIter *iter)
+/* NB: For a concurrent vector, each step is atomic but the iteration
+   as a whole isn't; entries added or deleted by other threads during
+   iteration may or may not be seen. */
+static ScmObj spvec_iter_next(SparseVectorIter *iter, u_long *ind)
 {
     ScmObj (*iterproc)(Leaf*,int*) = iter->sv->desc->iter;
     for (;;) {
         if (iter->leaf) {
             ScmObj r = iterproc(iter->leaf, &iter->leafIndex);
             if (!SCM_UNBOUNDP(r)) {
-                u_long ind = ((leaf_key(iter->leaf) << iter->sv->desc->shift)
-                              + iter->leafIndex);
-                return Scm_Cons(Scm_MakeIntegerU(ind), r);
+                *ind = ((leaf_key(iter->leaf) << iter->sv->desc->shift)
+                        + iter->leafIndex);
+                return r;
             }
         }
         iter->leaf = CompactTrieIterNext(&iter->citer);
-        if (iter->leaf == NULL) return SCM_FALSE; /* we're at the end */
+        if (iter->leaf == NULL) return SCM_UNBOUND; /* we're at the end */
         iter->leafIndex = -1;
     }
 }
 
+ScmObj SparseVectorIterNext(SparseVectorIter *iter)
+{
+    u_long ind = 0;
+    LOCK(iter->sv);
+    ScmObj r = spvec_iter_next(iter, &ind);
+    UNLOCK(iter->sv);
+    if (SCM_UNBOUNDP(r)) return SCM_FALSE;
+    return Scm_Cons(Scm_MakeIntegerU(ind), r);
+}
+
 /* special routine for uniform numeric sparse vectors */
 /* TODO: Allow clamp arg */
-ScmObj SparseVectorInc(SparseVector *sv, u_long index,
-                       ScmObj delta,    /* number */
-                       ScmObj fallback) /* number or unbound */
+static ScmObj spvec_inc(SparseVector *sv, u_long index,
+                        ScmObj delta, ScmObj fallback)
 {
-    if (!SCM_NUMBERP(fallback)) {
-        if (SCM_NUMBERP(sv->defaultValue)) {
-            fallback = sv->defaultValue;
-        } else {
-            fallback = SCM_MAKE_INT(0);
-        }
-    }
     INDEX_CHECK(index);
     Leaf *leaf = CompactTrieGet(&sv->trie, index >> sv->desc->shift);
     if (leaf == NULL) {
         ScmObj v = Scm_Add(fallback, delta);
-        SparseVectorSet(sv, index, v);
+        spvec_set(sv, index, v);
         return v;
     } else {
         ScmObj v = sv->desc->ref(leaf, index);
         if (SCM_UNBOUNDP(v)) v = fallback;
         v = Scm_Add(v, delta);
-        sv->desc->set(leaf, index, v);
+        if (sv->desc->set(leaf, index, v)) sv->numEntries++;
         return v;
     }
 }
 
+ScmObj SparseVectorInc(SparseVector *sv, u_long index,
+                       ScmObj delta,    /* number */
+                       ScmObj fallback) /* number or unbound */
+{
+    if (!SCM_NUMBERP(fallback)) {
+        if (SCM_NUMBERP(sv->defaultValue)) {
+            fallback = sv->defaultValue;
+        } else {
+            fallback = SCM_MAKE_INT(0);
+        }
+    }
+    if (!CONCURRENT_P(sv)) return spvec_inc(sv, index, delta, fallback);
+
+    ScmObj r = SCM_UNDEFINED;
+    SCM_INTERNAL_MUTEX_LOCK(sv->lock);
+    SCM_UNWIND_PROTECT {
+        r = spvec_inc(sv, index, delta, fallback);
+    }
+    SCM_WHEN_ERROR {
+        SCM_INTERNAL_MUTEX_UNLOCK(sv->lock);
+        SCM_NEXT_HANDLER;
+    }
+    SCM_END_PROTECT;
+    SCM_INTERNAL_MUTEX_UNLOCK(sv->lock);
+    return r;
+}
+
 void SparseVectorDump(SparseVector *sv)
 {
     CompactTrieDump(SCM_CUROUT, &sv->trie, sv->desc->dump, sv->desc);
@@ -604,9 +684,553 @@ ScmObj MakeSparseVector(ScmClass *klass, ScmObj defaultValue, u_long flags)
     v->desc = desc;
     v->flags = flags;
     v->defaultValue = defaultValue;
+    if (flags & SPARSE_VECTOR_CONCURRENT) {
+        (void)SCM_INTERNAL_MUTEX_INIT(v->lock);
+    }
     return SCM_OBJ(v);
 }
 
+/*===================================================================
+ * Bulk operations
+ *
+ *   These walk the leaves of the tries directly, so that dot products,
+ *   additions and conversions don't need to go through the per-element
+ *   Scheme-level iteration.  The f64 vectors, which are the common case
+ *   in numeric code, have specialized loops that avoid boxing.
+ *   Entries that don't exist are regarded as zero, regardless of the
+ *   default value.
+ */
+
+/* Uniform sparse vector descriptors, indexed by ScmUVectorType */
+static SparseVectorDescriptor *uv_descs[] = {
+    &s8_desc, &u8_desc, &s16_desc, &u16_desc, &s32_desc, &u32_desc,
+    &s64_desc, &u64_desc, &f16_desc, &f32_desc, &f64_desc
+};
+
+static ScmClass *uv_spvec_classes[] = {
+    SCM_CLASS_SPARSE_S8VECTOR, SCM_CLASS_SPARSE_U8VECTOR,
+    SCM_CLASS_SPARSE_S16VECTOR, SCM_CLASS_SPARSE_U16VECTOR,
+    SCM_CLASS_SPARSE_S32VECTOR, SCM_CLASS_SPARSE_U32VECTOR,
+    SCM_CLASS_SPARSE_S64VECTOR, SCM_CLASS_SPARSE_U64VECTOR,
+    SCM_CLASS_SPARSE_F16VECTOR, SCM_CLASS_SPARSE_F32VECTOR,
+    SCM_CLASS_SPARSE_F64VECTOR
+};
+
+static ScmClass *uv_classes[] = {
+    SCM_CLASS_S8VECTOR, SCM_CLASS_U8VECTOR,
+    SCM_CLASS_S16VECTOR, SCM_CLASS_U16VECTOR,
+    SCM_CLASS_S32VECTOR, SCM_CLASS_U32VECTOR,
+    SCM_CLASS_S64VECTOR, SCM_CLASS_U64VECTOR,
+    SCM_CLASS_F16VECTOR, SCM_CLASS_F32VECTOR,
+    SCM_CLASS_F64VECTOR
+};
+
+/* Returns ScmUVectorType corresponding to the sparse vector, or
+   SCM_UVECTOR_INVALID for a general sparse vector. */
+static int spvec_uvtype(const SparseVector *sv)
+{
+    for (int i=0; i<=SCM_UVECTOR_F64; i++) {
+        if (sv->desc == uv_descs[i]) return i;
+    }
+    return SCM_UVECTOR_INVALID;
+}
+
+/* Raw pointer to the I-th element (intra-leaf index) of a uniform leaf */
+#define U_ELT(leaf, i, esize) \
+    ((void*)((char*)ULEAF(leaf)->dummy + (i)*(esize)))
+
+static int raw_zerop(const void *p, int esize)
+{
+    const unsigned char *q = (const unsigned char*)p;
+    for (int i=0; i<esize; i++) if (q[i]) return FALSE;
+    return TRUE;
+}
+
+/* Number of entries in a leaf */
+#define LEAF_MASK(sv)  ((1UL<<(sv)->desc->shift)-1)
+
+/* Lock one or two concurrent vectors and call FN.  Locks are taken
+   in the order of addresses to avoid deadlock. */
+static ScmObj call_locked(SparseVector *a, SparseVector *b,
+                          ScmObj (*fn)(void**), void **data)
+{
+    SparseVector *l1 = CONCURRENT_P(a) ? a : NULL;
+    SparseVector *l2 = (b && b != a && CONCURRENT_P(b)) ? b : NULL;
+    if (l1 == NULL && l2 == NULL) return fn(data);
+    if (l1 == NULL || (l2 && l2 < l1)) {
+        SparseVector *t = l1; l1 = l2; l2 = t;
+    }
+    ScmObj r = SCM_UNDEFINED;
+    if (l1) SCM_INTERNAL_MUTEX_LOCK(l1->lock);
+    if (l2) SCM_INTERNAL_MUTEX_LOCK(l2->lock);
+    SCM_UNWIND_PROTECT {
+        r = fn(data);
+    }
+    SCM_WHEN_ERROR {
+        if (l2) SCM_INTERNAL_MUTEX_UNLOCK(l2->lock);
+        if (l1) SCM_INTERNAL_MUTEX_UNLOCK(l1->lock);
+        SCM_NEXT_HANDLER;
+    }
+    SCM_END_PROTECT;
+    if (l2) SCM_INTERNAL_MUTEX_UNLOCK(l2->lock);
+    if (l1) SCM_INTERNAL_MUTEX_UNLOCK(l1->lock);
+    return r;
+}
+
+/* Dense vector access.  D is either a uvector or a vector. */
+static ScmSmallInt dense_size(ScmObj d)
+{
+    if (SCM_UVECTORP(d)) return SCM_UVECTOR_SIZE(d);
+    if (SCM_VECTORP(d))  return SCM_VECTOR_SIZE(d);
+    Scm_TypeError("dense vector", "uniform vector or vector", d);
+    return 0;                   /* dummy */
+}
+
+static ScmObj dense_ref(ScmObj d, int uvtype, ScmSmallInt i)
+{
+    if (uvtype == SCM_UVECTOR_INVALID) return SCM_VECTOR_ELEMENT(d, i);
+    ScmObj v = Scm_VMUVectorRef(SCM_UVECTOR(d), uvtype, i, SCM_UNBOUND);
+    SCM_FLONUM_ENSURE_MEM(v);
+    return v;
+}
+
+static void dense_range_error(ScmObj d, u_long ind)
+{
+    Scm_Error("sparse vector has an entry at %lu, which is out of range "
+              "of the dense vector %S", ind, d);
+}
+
+/*
+ * Dot product
+ */
+static ScmObj spvec_dot(void **data)
+{
+    SparseVector *a = (SparseVector*)data[0];
+    SparseVector *b = (SparseVector*)data[1];
+    CompactTrieIter citer;
+    Leaf *la;
+
+    /* Walk the one with fewer entries */
+    if (a->numEntries > b->numEntries) {
+        SparseVector *t = a; a = b; b = t;
+    }
+    CompactTrieIterInit(&citer, &a->trie);
+
+    if (a->desc == &f64_desc && b->desc == &f64_desc) {
+        double sum = 0.0;
+        while ((la = CompactTrieIterNext(&citer)) != NULL) {
+            Leaf *lb = CompactTrieGet(&b->trie, leaf_key(la));
+            if (lb == NULL) continue;
+            for (u_long i=0; i<=MASK64; i++) {
+                if (U_HAS_ENTRY(la, i, MASK64) && U_HAS_ENTRY(lb, i, MASK64)) {
+                    sum += ULEAF(la)->f64[i] * ULEAF(lb)->f64[i];
+                }
+            }
+        }
+        return Scm_MakeFlonum(sum);
+    }
+
+    ScmObj sum = SCM_MAKE_INT(0);
+    int aligned = (a->desc->shift == b->desc->shift);
+    while ((la = CompactTrieIterNext(&citer)) != NULL) {
+        u_long base = leaf_key(la) << a->desc->shift;
+        Leaf *lb = NULL;
+        if (aligned) {
+            lb = CompactTrieGet(&b->trie, leaf_key(la));
+            if (lb == NULL) continue;
+        }
+        int i = -1;
+        for (;;) {
+            ScmObj x = a->desc->iter(la, &i);
+            if (SCM_UNBOUNDP(x)) break;
+            ScmObj y = aligned
+                ? b->desc->ref(lb, base + i)
+                : spvec_ref(b, base + i, SCM_UNBOUND);
+            if (SCM_UNBOUNDP(y)) continue;
+            SCM_FLONUM_ENSURE_MEM(x);
+            SCM_FLONUM_ENSURE_MEM(y);
+            sum = Scm_Add(sum, Scm_Mul(x, y));
+        }
+    }
+    return sum;
+}
+
+static ScmObj spvec_dot_dense(void **data)
+{
+    SparseVector *a = (SparseVector*)data[0];
+    ScmObj d = SCM_OBJ(data[1]);
+    ScmSmallInt size = dense_size(d);
+    int dtype = SCM_UVECTORP(d)
+        ? Scm_UVectorType(SCM_CLASS_OF(d)) : SCM_UVECTOR_INVALID;
+    CompactTrieIter citer;
+    Leaf *la;
+
+    CompactTrieIterInit(&citer, &a->trie);
+    if (a->desc == &f64_desc && dtype == SCM_UVECTOR_F64) {
+        const double *dp = SCM_F64VECTOR_ELEMENTS(d);
+        double sum = 0.0;
+        while ((la = CompactTrieIterNext(&citer)) != NULL) {
+            u_long base = leaf_key(la) << SHIFT64;
+            for (u_long i=0; i<=MASK64; i++) {
+                if (!U_HAS_ENTRY(la, i, MASK64)) continue;
+                if (base + i >= (u_long)size) dense_range_error(d, base + i);
+                sum += ULEAF(la)->f64[i] * dp[base + i];
+            }
+        }
+        return Scm_MakeFlonum(sum);
+    }
+
+    ScmObj sum = SCM_MAKE_INT(0);
+    while ((la = CompactTrieIterNext(&citer)) != NULL) {
+        u_long base = leaf_key(la) << a->desc->shift;
+        int i = -1;
+        for (;;) {
+            ScmObj x = a->desc->iter(la, &i);
+            if (SCM_UNBOUNDP(x)) break;
+            if (base + i >= (u_long)size) dense_range_error(d, base + i);
+            SCM_FLONUM_ENSURE_MEM(x);
+            sum = Scm_Add(sum, Scm_Mul(x, dense_ref(d, dtype, base + i)));
+        }
+    }
+    return sum;
+}
+
+/* B may be a sparse vector, a uvector or a vector */
+ScmObj SparseVectorDot(SparseVector *a, ScmObj b)
+{
+    void *data[2];
+    data[0] = a;
+    data[1] = b;
+    if (SPARSE_VECTOR_BASE_P(b)) {
+        return call_locked(a, SPARSE_VECTOR(b), spvec_dot, data);
+    } else {
+        return call_locked(a, NULL, spvec_dot_dense, data);
+    }
+}
+
+/*
+ * Scaling
+ */
+static ScmObj spvec_scale(void **data)
+{
+    SparseVector *sv = (SparseVector*)data[0];
+    ScmObj k = SCM_OBJ(data[1]);
+    CompactTrieIter citer;
+    Leaf *leaf;
+
+    CompactTrieIterInit(&citer, &sv->trie);
+    if (sv->desc == &f64_desc) {
+        double dk = Scm_GetDouble(k);
+        while ((leaf = CompactTrieIterNext(&citer)) != NULL) {
+            for (u_long i=0; i<=MASK64; i++) {
+                ULEAF(leaf)->f64[i] *= dk; /* unused slots don't matter */
+            }
+        }
+        return SCM_UNDEFINED;
+    }
+    while ((leaf = CompactTrieIterNext(&citer)) != NULL) {
+        u_long base = leaf_key(leaf) << sv->desc->shift;
+        int i = -1;
+        for (;;) {
+            ScmObj x = sv->desc->iter(leaf, &i);
+            if (SCM_UNBOUNDP(x)) break;
+            SCM_FLONUM_ENSURE_MEM(x);
+            sv->desc->set(leaf, base + i, Scm_Mul(x, k));
+        }
+    }
+    return SCM_UNDEFINED;
+}
+
+void SparseVectorScale(SparseVector *sv, ScmObj k)
+{
+    void *data[2];
+    data[0] = sv;
+    data[1] = k;
+    call_locked(sv, NULL, spvec_scale, data);
+}
+
+/*
+ * Addition: DST += K * SRC
+ */
+static void spvec_add_elt(SparseVector *dst, u_long ind, ScmObj k, ScmObj v)
+{
+    ScmObj cur = spvec_ref(dst, ind, SCM_UNBOUND);
+    SCM_FLONUM_ENSURE_MEM(cur);
+    SCM_FLONUM_ENSURE_MEM(v);
+    if (SCM_UNBOUNDP(cur)) {
+        cur = SCM_NUMBERP(dst->defaultValue)
+            ? dst->defaultValue : SCM_MAKE_INT(0);
+    }
+    spvec_set(dst, ind, Scm_Add(cur, SCM_EQ(k, SCM_MAKE_INT(1))
+                                ? v : Scm_Mul(k, v)));
+}
+
+static ScmObj spvec_add(void **data)
+{
+    SparseVector *dst = (SparseVector*)data[0];
+    SparseVector *src = (SparseVector*)data[1];
+    ScmObj k = SCM_OBJ(data[2]);
+    CompactTrieIter citer;
+    Leaf *ls;
+
+    CompactTrieIterInit(&citer, &src->trie);
+    if (dst->desc == &f64_desc && src->desc == &f64_desc
+        && !SCM_FLONUMP(dst->defaultValue)) {
+        double dk = Scm_GetDouble(k);
+        while ((ls = CompactTrieIterNext(&citer)) != NULL) {
+            Leaf *ld = CompactTrieAdd(&dst->trie, leaf_key(ls),
+                                      dst->desc->allocate, dst);
+            for (u_long i=0; i<=MASK64; i++) {
+                if (!U_HAS_ENTRY(ls, i, MASK64)) continue;
+                if (!U_HAS_ENTRY(ld, i, MASK64)) {
+                    U_SET_ENTRY(ld, i, MASK64);
+                    ULEAF(ld)->f64[i] = 0.0;
+                    dst->numEntries++;
+                }
+                ULEAF(ld)->f64[i] += dk * ULEAF(ls)->f64[i];
+            }
+        }
+        return SCM_UNDEFINED;
+    }
+
+    while ((ls = CompactTrieIterNext(&citer)) != NULL) {
+        u_long base = leaf_key(ls) << src->desc->shift;
+        int i = -1;
+        for (;;) {
+            ScmObj v = src->desc->iter(ls, &i);
+            if (SCM_UNBOUNDP(v)) break;
+            spvec_add_elt(dst, base + i, k, v);
+        }
+    }
+    return SCM_UNDEFINED;
+}
+
+static ScmObj spvec_add_dense(void **data)
+{
+    SparseVector *dst = (SparseVector*)data[0];
+    ScmObj d = SCM_OBJ(data[1]);
+    ScmObj k = SCM_OBJ(data[2]);
+    ScmSmallInt size = dense_size(d);
+    int dtype = SCM_UVECTORP(d)
+        ? Scm_UVectorType(SCM_CLASS_OF(d)) : SCM_UVECTOR_INVALID;
+
+    if (dst->desc == &f64_desc && dtype == SCM_UVECTOR_F64
+        && !SCM_FLONUMP(dst->defaultValue)) {
+        const double *dp = SCM_F64VECTOR_ELEMENTS(d);
+        double dk = Scm_GetDouble(k);
+        for (ScmSmallInt j=0; j<size; j++) {
+            if (dp[j] == 0.0) continue;
+            Leaf *ld = CompactTrieAdd(&dst->trie, j >> SHIFT64,
+                                      dst->desc->allocate, dst);
+            if (!U_HAS_ENTRY(ld, j, MASK64)) {
+                U_SET_ENTRY(ld, j, MASK64);
+                ULEAF(ld)->f64[j&MASK64] = 0.0;
+                dst->numEntries++;
+            }
+            ULEAF(ld)->f64[j&MASK64] += dk * dp[j];
+        }
+        return SCM_UNDEFINED;
+    }
+
+    int esize = (dtype == SCM_UVECTOR_INVALID)
+        ? 0 : Scm_UVectorElementSize(SCM_CLASS_OF(d));
+    for (ScmSmallInt j=0; j<size; j++) {
+        if (esize) {
+            if (raw_zerop((char*)SCM_UVECTOR_ELEMENTS(d) + j*esize, esize)) {
+                continue;
+            }
+        } else if (SCM_EQ(SCM_VECTOR_ELEMENT(d, j), SCM_MAKE_INT(0))) {
+            continue;
+        }
+        spvec_add_elt(dst, j, k, dense_ref(d, dtype, j));
+    }
+    return SCM_UNDEFINED;
+}
+
+/* SRC may be a sparse vector, a uvector or a vector */
+void SparseVectorAdd(SparseVector *dst, ScmObj src, ScmObj k)
+{
+    void *data[3];
+    data[0] = dst;
+    data[1] = src;
+    data[2] = k;
+    if (SPARSE_VECTOR_BASE_P(src)) {
+        call_locked(dst, SPARSE_VECTOR(src), spvec_add, data);
+    } else {
+        call_locked(dst, NULL, spvec_add_dense, data);
+    }
+}
+
+/*
+ * Conversion from/to dense vectors
+ */
+
+/* Returns max index + 1 */
+static u_long spvec_extent(SparseVector *sv)
+{
+    CompactTrieIter citer;
+    Leaf *leaf;
+    u_long ext = 0;
+    CompactTrieIterInit(&citer, &sv->trie);
+    while ((leaf = CompactTrieIterNext(&citer)) != NULL) {
+        u_long base = leaf_key(leaf) << sv->desc->shift;
+        int i = -1, last = -1;
+        for (;;) {
+            if (SCM_UNBOUNDP(sv->desc->iter(leaf, &i))) break;
+            last = i;
+        }
+        if (last >= 0 && base + last + 1 > ext) ext = base + last + 1;
+    }
+    return ext;
+}
+
+static ScmObj spvec_to_dense(void **data)
+{
+    SparseVector *sv = (SparseVector*)data[0];
+    long size = (long)(intptr_t)data[1];
+    int uvtype = spvec_uvtype(sv);
+    ScmObj fill = SCM_NUMBERP(sv->defaultValue)
+        ? sv->defaultValue : SCM_MAKE_INT(0);
+    CompactTrieIter citer;
+    Leaf *leaf;
+
+    if (size < 0) size = (long)spvec_extent(sv);
+
+    if (uvtype == SCM_UVECTOR_INVALID) {
+        ScmObj v = Scm_MakeVector(size, SCM_UNDEFINEDP(sv->defaultValue)
+                                  ? SCM_MAKE_INT(0) : sv->defaultValue);
+        CompactTrieIterInit(&citer, &sv->trie);
+        while ((leaf = CompactTrieIterNext(&citer)) != NULL) {
+            u_long base = leaf_key(leaf) << sv->desc->shift;
+            int i = -1;
+            for (;;) {
+                ScmObj x = sv->desc->iter(leaf, &i);
+                if (SCM_UNBOUNDP(x)) break;
+                if (base + i < (u_long)size) SCM_VECTOR_ELEMENT(v, base+i) = x;
+            }
+        }
+        return v;
+    }
+
+    ScmClass *klass = uv_classes[uvtype];
+    int esize = Scm_UVectorElementSize(klass);
+    ScmObj v = Scm_MakeUVector(klass, size, NULL);
+    char *p = (char*)SCM_UVECTOR_ELEMENTS(v);
+
+    /* Convert the fill value using the leaf setter */
+    Leaf *tmp = sv->desc->allocate(sv);
+    sv->desc->set(tmp, 0, fill);
+    for (long j=0; j<size; j++) memcpy(p + j*esize, U_ELT(tmp, 0, esize), esize);
+
+    u_long mask = LEAF_MASK(sv);
+    CompactTrieIterInit(&citer, &sv->trie);
+    while ((leaf = CompactTrieIterNext(&citer)) != NULL) {
+        u_long base = leaf_key(leaf) << sv->desc->shift;
+        if (base >= (u_long)size) continue;
+        for (u_long i=0; i<=mask; i++) {
+            if (!U_HAS_ENTRY(leaf, i, mask) || base + i >= (u_long)size) {
+                continue;
+            }
+            memcpy(p + (base+i)*esize, U_ELT(leaf, i, esize), esize);
+        }
+    }
+    return v;
+}
+
+/* Returns a uvector of the same element type as SV, or a vector if SV
+   is a general sparse vector.  If SIZE is negative, the result is
+   just long enough to contain all the entries. */
+ScmObj SparseVectorToDense(SparseVector *sv, long size)
+{
+    void *data[2];
+    data[0] = sv;
+    data[1] = (void*)(intptr_t)size;
+    return call_locked(sv, NULL, spvec_to_dense, data);
+}
+
+/* Creates a uniform sparse vector from a uvector.  Zero elements
+   are not stored. */
+ScmObj UVectorToSparseVector(ScmUVector *uv, ScmObj defaultValue)
+{
+    int uvtype = Scm_UVectorType(SCM_CLASS_OF(uv));
+    if (uvtype < 0) {
+        Scm_TypeError("uvector", "uniform vector", SCM_OBJ(uv));
+    }
+    SparseVector *sv =
+        SPARSE_VECTOR(MakeSparseVector(uv_spvec_classes[uvtype],
+                                       defaultValue, 0));
+    int esize = Scm_UVectorElementSize(SCM_CLASS_OF(uv));
+    int shift = sv->desc->shift;
+    u_long mask = LEAF_MASK(sv);
+    const char *p = (const char*)SCM_UVECTOR_ELEMENTS(uv);
+    ScmSmallInt size = SCM_UVECTOR_SIZE(uv);
+
+    for (ScmSmallInt j=0; j<size; j++) {
+        if (raw_zerop(p + j*esize, esize)) continue;
+        Leaf *leaf = CompactTrieAdd(&sv->trie, j >> shift,
+                                    sv->desc->allocate, sv);
+        memcpy(U_ELT(leaf, j&mask, esize), p + j*esize, esize);
+        U_SET_ENTRY(leaf, j, mask);
+        sv->numEntries++;
+    }
+    return SCM_OBJ(sv);
+}
+
+/*
+ * Batch iteration.  Fills up to N entries into an index u64vector and
+ * a value vector (a uvector of the same type for uniform sparse vectors).
+ * Returns a pair of them, or SCM_FALSE if there's no more entries.
+ */
+static ScmObj spvec_iter_batch(void **data)
+{
+    SparseVectorIter *iter = (SparseVectorIter*)data[0];
+    long n = (long)(intptr_t)data[1];
+    SparseVector *sv = iter->sv;
+    int uvtype = spvec_uvtype(sv);
+    int esize = (uvtype == SCM_UVECTOR_INVALID)
+        ? 0 : Scm_UVectorElementSize(uv_classes[uvtype]);
+    ScmUInt64 *ibuf = SCM_NEW_ATOMIC_ARRAY(ScmUInt64, n);
+    void *vbuf = esize
+        ? SCM_NEW_ATOMIC2(void*, n*esize) : (void*)SCM_NEW_ARRAY(ScmObj, n);
+    long cnt = 0;
+
+    while (cnt < n) {
+        u_long ind;
+        ScmObj r = spvec_iter_next(iter, &ind);
+        if (SCM_UNBOUNDP(r)) break;
+        ibuf[cnt] = ind;
+        if (esize) {
+            memcpy((char*)vbuf + cnt*esize,
+                   U_ELT(iter->leaf, iter->leafIndex, esize), esize);
+        } else {
+            ((ScmObj*)vbuf)[cnt] = r;
+        }
+        cnt++;
+    }
+    if (cnt == 0) return SCM_FALSE;
+
+    ScmObj indices = Scm_MakeUVector(SCM_CLASS_U64VECTOR, cnt, ibuf);
+    ScmObj values;
+    if (esize) {
+        values = Scm_MakeUVector(uv_classes[uvtype], cnt, vbuf);
+    } else {
+        values = Scm_MakeVector(cnt, SCM_FALSE);
+        for (long j=0; j<cnt; j++) {
+            SCM_VECTOR_ELEMENT(values, j) = ((ScmObj*)vbuf)[j];
+        }
+    }
+    return Scm_Cons(indices, values);
+}
+
+ScmObj SparseVectorIterNextBatch(SparseVectorIter *iter, long n)
+{
+    void *data[2];
+    if (n <= 0) Scm_Error("batch size must be positive, but got %ld", n);
+    data[0] = iter;
+    data[1] = (void*)(intptr_t)n;
+    return call_locked(iter->sv, NULL, spvec_iter_batch, data);
+}
+
 /*===================================================================
  * Initialization
  */
@@ -58,8 +58,9 @@ typedef struct SparseVectorRec {
     SparseVectorDescriptor *desc;
     CompactTrie trie;
     u_long      numEntries;
-    u_long      flags;          /* reserved */
+    u_long      flags;
     ScmObj      defaultValue;
+    ScmInternalMutex lock;      /* used if SPARSE_VECTOR_CONCURRENT */
 } SparseVector;
 
 /* Iterator. */
@@ -105,9 +106,10 @@ struct SparseVectorDescriptorRec {
    as much as we like; current limitation is only for simplicity. */
 #define SPARSE_VECTOR_MAX_INDEX_BITS  (SIZEOF_LONG*8)
 
-/* Flags for constructors (currently unused) */
+/* Flags for constructors */
 enum {
-    SPARSE_VECTOR_ORDERED = (1L<<0)
+    SPARSE_VECTOR_ORDERED = (1L<<0),   /* currently unused */
+    SPARSE_VECTOR_CONCURRENT = (1L<<1) /* serialize access by own lock */
 };
 
 /* Generic API. */
@@ -121,8 +123,16 @@ extern ScmObj SparseVectorInc(SparseVector *sv, u_long index, ScmObj delta,
                               ScmObj fallback);
 extern void   SparseVectorDump(SparseVector *sv);
 
+/* Bulk operations */
+extern ScmObj SparseVectorDot(SparseVector *a, ScmObj b);
+extern void   SparseVectorScale(SparseVector *sv, ScmObj k);
+extern void   SparseVectorAdd(SparseVector *dst, ScmObj src, ScmObj k);
+extern ScmObj SparseVectorToDense(SparseVector *sv, long size);
+extern ScmObj UVectorToSparseVector(ScmUVector *uv, ScmObj defaultValue);
+
 extern void   SparseVectorIterInit(SparseVectorIter *iter, SparseVector *sv);
 extern ScmObj SparseVectorIterNext(SparseVectorIter *iter);
+extern ScmObj SparseVectorIterNextBatch(SparseVectorIter *iter, long n);
 
 extern void   Scm_Init_spvec(ScmModule *mod);
 
@@ -8,6 +8,7 @@
 (use util.match)
 (use srfi-1)
 (use srfi-27)
+(use gauche.uvector)
 
 (test-start "data.sparse")
 (use data.sparse)
@@ -182,6 +183,41 @@
 (spvec-heavy 'f32 (^x (exact->inexact (logand x #xfffff))))
 (spvec-heavy 'f64 exact->inexact)
 
+(define (spvec-heavy/concurrent tag valgen)
+  (heavy-test #"concurrent sparse-~(or tag \"\")vector"
+              (make-sparse-vector tag :concurrent #t)
+              sparse-vector-ref sparse-vector-set!
+              sparse-vector-num-entries sparse-vector-clear!
+              sparse-vector-keys sparse-vector-values sparse-vector-delete!
+              sparse-vector-copy #f
+              values valgen))
+
+(spvec-heavy/concurrent #f values)
+(spvec-heavy/concurrent 'u8 (^x (logand x #xff)))
+(spvec-heavy/concurrent 'f64 exact->inexact)
+
+(test* "concurrent sparse vector lock is released on error" '(1 2)
+       (let1 v (make-sparse-vector 'u8 :concurrent #t)
+         (sparse-vector-set! v 0 1)
+         (guard (e [else #f]) (sparse-vector-set! v 1 1000))
+         (sparse-vector-set! v 1 2)
+         (list (sparse-vector-ref v 0) (sparse-vector-ref v 1))))
+
+(cond-expand
+ [gauche.sys.threads
+  (use gauche.threads)
+  (test* "concurrent sparse vector with threads" '(40000 1000)
+         (let* ([v (make-sparse-vector #f :concurrent #t)]
+                [ts (map (^k (make-thread
+                              (^[] (dotimes [j 10000]
+                                     (sparse-vector-inc! v (modulo j 1000) 1)))))
+                         (iota 4))])
+           (for-each thread-start! ts)
+           (for-each thread-join! ts)
+           (list (apply + (sparse-vector-values v))
+                 (sparse-vector-num-entries v))))]
+ [else])
+
 
 ;; sparse table----------------------------------------------------
 (test-section "sparse-table")
@@ -288,6 +324,220 @@
            (sparse-vector-ref y 1)))
   )
 
+;; Bulk operations
+(let ()
+  (define (make-spvec type alist)
+    (rlet1 v (make-sparse-vector type)
+      (dolist [p alist] (sparse-vector-set! v (car p) (cdr p)))))
+  (define a-alist '((0 . 1) (3 . 2) (10 . 3) (1000 . 4)))
+  (define b-alist '((3 . 5) (10 . 6) (11 . 7) (100000 . 8)))
+  (define (alist-of v)
+    (sort (sparse-vector-fold v acons '()) < car))
+
+  (dolist [ta '(#f s32 f64)]
+    (dolist [tb '(#f u8 f64)]
+      (test* #"sparse-vector-dot (~ta, ~tb)" 28
+             (round->exact
+              (sparse-vector-dot (make-spvec ta a-alist)
+                                 (make-spvec tb b-alist))))))
+
+  (test* "sparse-vector-dot with dense vector" 28.0
+         (sparse-vector-dot (make-spvec 'f64 (take b-alist 3))
+                            (rlet1 d (make-f64vector 20 0.0)
+                              (f64vector-set! d 3 2.0)
+                              (f64vector-set! d 10 3.0))))
+  (test* "sparse-vector-dot with dense vector" 28
+         (sparse-vector-dot (make-spvec #f (take b-alist 3))
+                            (rlet1 d (make-vector 20 0)
+                              (vector-set! d 3 2)
+                              (vector-set! d 10 3))))
+  (test* "sparse-vector-dot out of range" (test-error)
+         (sparse-vector-dot (make-spvec 'f64 b-alist) (make-f64vector 20 1.0)))
+
+  (dolist [t '(#f s32 f64)]
+    (test* #"sparse-vector-scale! (~t)" '((0 . 3) (3 . 6) (10 . 9) (1000 . 12))
+           (map (^p (cons (car p) (round->exact (cdr p))))
+                (alist-of (sparse-vector-scale! (make-spvec t a-alist) 3)))))
+
+  (dolist [t '(#f s32 f64)]
+    (test* #"sparse-vector-add! (~t)"
+           '((0 . 1) (3 . 12) (10 . 15) (11 . 14) (1000 . 4) (100000 . 16))
+           (let1 v (make-spvec t a-alist)
+             (sparse-vector-add! v (make-spvec t b-alist) 2)
+             (map (^p (cons (car p) (round->exact (cdr p))))
+                  (alist-of v))))
+    (test* #"sparse-vector-add! num-entries (~t)" 6
+           (let1 v (make-spvec t a-alist)
+             (sparse-vector-add! v (make-spvec t b-alist))
+             (sparse-vector-num-entries v))))
+
+  (test* "sparse-vector-add! dense" '((0 . 1.0) (2 . 0.5) (3 . 2.0))
+         (let1 v (make-spvec 'f64 '((0 . 1.0) (3 . 1.0)))
+           (sparse-vector-add! v '#f64(0.0 0.0 1.0 2.0) 0.5)
+           (alist-of v)))
+
+  (test* "sparse-vector->dense" '#f64(1.0 0.0 0.0 2.0)
+         (sparse-vector->dense (make-spvec 'f64 '((0 . 1.0) (3 . 2.0)))))
+  (test* "sparse-vector->dense (size)" '#u8(7 7 5)
+         (sparse-vector->dense
+          (rlet1 v (make-sparse-vector 'u8 :default 7)
+            (sparse-vector-set! v 2 5)
+            (sparse-vector-set! v 10 1))
+          3))
+  (test* "sparse-vector->dense (general)" '#(a 0 b)
+         (sparse-vector->dense (make-spvec #f '((0 . a) (2 . b)))))
+  (test* "uvector->sparse-vector" '(<sparse-s16vector> 2 ((1 . -3) (4 . 5)))
+         (let1 v (uvector->sparse-vector '#s16(0 -3 0 0 5))
+           (list (class-name (class-of v))
+                 (sparse-vector-num-entries v)
+                 (alist-of v))))
+  (test* "uvector->sparse-vector roundtrip" '#f32(0.0 1.5 0.0 -2.5)
+         (sparse-vector->dense (uvector->sparse-vector '#f32(0.0 1.5 0.0 -2.5))))
+
+  (test* "sparse-vector-batch-generator"
+         '((3 1) ((0 . 1.0) (3 . 2.0) (10 . 3.0) (1000 . 4.0)))
+         (let1 g (sparse-vector-batch-generator
+                  (make-spvec 'f64 a-alist) 3)
+           (let loop ([sizes '()] [r '()])
+             (let1 b (g)
+               (if (eof-object? b)
+                 (list (reverse sizes) (sort r < car))
+                 (loop (cons (u64vector-length (car b)) sizes)
+                       (append (map cons
+                                    (u64vector->list (car b))
+                                    (f64vector->list (cdr b)))
+                               r)))))))
+  (test* "sparse-vector-batch-generator (general)" 2
+         (let1 g (sparse-vector-batch-generator (make-spvec #f a-alist) 2)
+           (vector-length (cdr (g)))))
+  )
+
+;; persistent table------------------------------------------------
+(test-section "persistent-table")
+
+(let ()
+  (define (ptab-simple type key1 key2)
+    (simple-test #"transient-table (~type)"
+                 (persistent-table-transient (make-persistent-table type))
+                 transient-table-ref transient-table-put!
+                 transient-table-exists? transient-table-fold
+                 key1 key2))
+
+  (ptab-simple 'eq?     (const 'a) (const 'b))
+  (ptab-simple 'eqv?    (cut / 3) (cut / 2))
+  (ptab-simple 'equal?  (cut list 1) (cut list 2))
+  (ptab-simple 'string=? (cut string #\a) (cut string #\b)))
+
+(define (ptab-heavy type keygen)
+  (define name #"persistent-table (~type)")
+  (define (all-match? pt pred)
+    (hash-table-fold *data-set*
+                     (^[k v s]
+                       (and s (pred (persistent-table-ref pt (keygen k) #f)
+                                    v)))
+                     #t))
+  (let* ([p0 (make-persistent-table type)]
+         [p1 (hash-table-fold *data-set*
+                              (^[k v pt] (persistent-table-put pt (keygen k) v))
+                              p0)]
+         [p2 (hash-table-fold *data-set*
+                              (^[k v pt]
+                                (persistent-table-put pt (keygen k) (- v)))
+                              p1)])
+    (test* #"~name put" `(0 ,*data-set-size* ,*data-set-size*)
+           (map persistent-table-num-entries (list p0 p1 p2)))
+    (test* #"~name ref" '(#t #t)
+           (list (all-match? p1 eqv?)
+                 (all-match? p2 (^[x v] (eqv? x (- v))))))
+    (test* #"~name check" #t
+           (begin (%persistent-table-check p1)
+                  (%persistent-table-check p2)
+                  #t))
+    (test* #"~name unchanged" #t
+           (let1 k (car (persistent-table-keys p1))
+             (eq? p1 (persistent-table-put p1 k
+                                           (persistent-table-ref p1 k)))))
+    (test* #"~name delete" `(0 #t ,*data-set-size*)
+           (let1 p3 (hash-table-fold *data-set*
+                                     (^[k v pt]
+                                       (persistent-table-delete pt (keygen k)))
+                                     p2)
+             (list (persistent-table-num-entries p3)
+                   (eq? p3 (persistent-table-delete p3 (keygen 0)))
+                   (persistent-table-num-entries p2))))
+    (test* #"~name transient" '(#t #t 0)
+           (let1 tt (persistent-table-transient p1)
+             (hash-table-for-each *data-set*
+                                  (^[k v]
+                                    (transient-table-put! tt (keygen k) (- v))))
+             (let1 p4 (transient-table-persistent! tt)
+               (%persistent-table-check p4)
+               (list (all-match? p4 (^[x v] (eqv? x (- v))))
+                     (all-match? p1 eqv?)
+                     (begin
+                       (hash-table-for-each
+                        *data-set*
+                        (^[k v]
+                          (set! p4 (persistent-table-delete p4 (keygen k)))))
+                       (persistent-table-num-entries p4))))))
+    ))
+
+(ptab-heavy 'eqv? values)
+(ptab-heavy 'equal? (^k (list k k)))
+(ptab-heavy 'string=? (^k (number->string k 36)))
+
+(let* ([keys '((0 . 5) (1 . 0) #(0 5) #(1 0))]
+       [p (fold (^[k v pt] (persistent-table-put pt k v))
+                (make-persistent-table 'equal?) keys '(a b c d))])
+  (define (vals tab) (map (cut persistent-table-ref tab <> #f) keys))
+
+  (test* "persistent key conflicts / ref" '(a b c d) (vals p))
+  (test* "persistent key conflicts / update" '(((z . a) (z . b) (z . c) (z . d))
+                                               (a b c d))
+         (let1 q (fold (^[k pt] (persistent-table-update pt k (cut cons 'z <>)))
+                       p keys)
+           (list (vals q) (vals p))))
+  (test* "persistent key conflicts / delete"
+         '((#f b c d) (#f b #f d) (#f b #f #f) (#f #f #f #f) (a b c d))
+         (let loop ([q p] [ks keys] [r '()])
+           (if (null? ks)
+             (reverse (cons (vals p) r))
+             (let1 q (persistent-table-delete q (car ks))
+               (loop q (cdr ks) (cons (vals q) r))))))
+  (test* "persistent key conflicts / delete order" '(#f b #f d)
+         (vals (persistent-table-delete (persistent-table-delete p '#(0 5))
+                                        '(0 . 5)))))
+
+(let* ([p (alist->persistent-table '((a . 1) (b . 2) (c . 3)) 'eq?)]
+       [t (persistent-table-transient p)])
+  (test* "alist->persistent-table" '((a . 1) (b . 2) (c . 3))
+         (sort-by (persistent-table->alist p) car))
+  (test* "persistent-table dict-get" '(2 none)
+         (list (dict-get p 'b) (dict-get p 'z 'none)))
+  (test* "persistent-table dict-put!" (test-error)
+         (dict-put! p 'd 4))
+  (test* "transient-table dict protocol" '((a . 1) (b . 20) (d 4))
+         (begin (dict-put! t 'b 20)
+                (dict-push! t 'd 4)
+                (dict-delete! t 'c)
+                (sort-by (dict->alist t) car)))
+  (test* "transient-table-persistent!" '((a . 1) (b . 20) (d 4))
+         (sort-by (persistent-table->alist (transient-table-persistent! t)) car))
+  (test* "transient-table after persistent!" (test-error)
+         (transient-table-put! t 'e 5))
+  (test* "original" '((a . 1) (b . 2) (c . 3))
+         (sort-by (persistent-table->alist p) car)))
+
+(let ()
+  (define c (make-comparator #t (^[a b] (= (modulo a 3) (modulo b 3))) #f
+                             (^x (modulo x 3))))
+  (define p (fold (^[x pt] (persistent-table-put pt x (+ x 100)))
+                  (make-persistent-table c) (iota 10)))
+  (test* "persistent-table custom comparator" '((0 . 109) (1 . 107) (2 . 108))
+         (sort-by (persistent-table-map p cons) car))
+  (test* "persistent-table-comparator" c
+         (persistent-table-comparator p)))
+
 ;; sparse matrix----------------------------------------------------
 (test-section "sparse-matrix")
 
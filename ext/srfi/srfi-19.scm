@@ -446,8 +446,20 @@
 
 ;; Offset of local timezone in seconds.
 ;; System-dependent.
+;; The offset is computed at most once per second; it is used as the
+;; default argument of every time->date conversion.
+
+(define tm:local-tz-offset-cache (cons #f 0)) ; (sys-time . offset)
 
 (define (tm:local-tz-offset)
+  (let ([now (sys-time)]
+        [cache tm:local-tz-offset-cache])
+    (if (eqv? (car cache) now)
+      (cdr cache)
+      (rlet1 offset (tm:compute-local-tz-offset now)
+        (set! tm:local-tz-offset-cache (cons now offset))))))
+
+(define (tm:compute-local-tz-offset now)
   (define (tm->seconds-in-year tm)
     (+ (cond [(assv (+ (slot-ref tm 'mon) 1) tm:month-assoc)
               => (^p (* (+ (cdr p)
@@ -459,8 +471,7 @@
              [else (error "something wrong")])
        (* (slot-ref tm 'hour) 3600)
        (* (slot-ref tm 'min) 60)))
-  (let* ([now   (sys-time)]
-         [local (sys-localtime now)]
+  (let* ([local (sys-localtime now)]
          [local-sec (tm->seconds-in-year local)]
          [local-yr  (slot-ref local 'year)]
          [gm    (sys-gmtime now)]
@@ -486,6 +497,38 @@
         seconds tz-offset tm:sihd)
      tm:sid))
 
+;; Decoding local seconds (utc seconds + tz offset) since the epoch
+;; into seconds-of-day, day, month and year.  This is called for every
+;; time->date conversion, so the common case of fixnum seconds is done
+;; in C, avoiding rational arithmetic of tm:time->julian-day-number.
+;; The C routine is the same calculation as tm:decode-julian-day-number.
+(inline-stub
+ (define-cproc %local-seconds->date-fields (secs::<fixnum>)
+   ::(<fixnum> <fixnum> <fixnum> <fixnum>)
+   (let* ([days::ScmSmallInt (/ secs 86400)]
+          [sod::ScmSmallInt (- secs (* days 86400))])
+     (when (< sod 0) (+= sod 86400) (pre-- days))
+     (let* ([a::ScmSmallInt (+ days 2440588 32044)]
+            [b::ScmSmallInt (/ (+ (* 4 a) 3) 146097)]
+            [c::ScmSmallInt (- a (/ (* 146097 b) 4))]
+            [d::ScmSmallInt (/ (+ (* 4 c) 3) 1461)]
+            [e::ScmSmallInt (- c (/ (* 1461 d) 4))]
+            [m::ScmSmallInt (/ (+ (* 5 e) 2) 153)]
+            [y::ScmSmallInt (+ (* 100 b) d -4800 (/ m 10))])
+       (return sod
+               (+ e (- (/ (+ (* 153 m) 2) 5)) 1)
+               (+ m 3 (* -12 (/ m 10)))
+               (?: (>= 0 y) (- y 1) y)))))
+ )
+
+;; The C version works as far as the julian day number is nonnegative.
+(define-constant tm:jdn-zero-in-seconds (- (* (+ tm:tai-epoch-in-jd 1/2) tm:sid)))
+
+(define (tm:decode-local-seconds secs)
+  (if (and (fixnum? secs) (>= secs tm:jdn-zero-in-seconds))
+    (%local-seconds->date-fields secs)
+    (tm:decode-julian-day-number (tm:time->julian-day-number secs 0))))
+
 (define (tm:leap-second? second)
   (and (assoc second tm:leap-second-table) #t))
 
@@ -494,8 +537,8 @@
   (let1 is-leap-second (tm:leap-second? (+ offset (time-second time)))
     (receive (secs date month year)
         (if is-leap-second
-          (tm:decode-julian-day-number (tm:time->julian-day-number (- (time-second time) 1) offset))
-          (tm:decode-julian-day-number (tm:time->julian-day-number (time-second time) offset)))
+          (tm:decode-local-seconds (+ (time-second time) offset -1))
+          (tm:decode-local-seconds (+ (time-second time) offset)))
       (let* ([hours    (quotient secs (* 60 60))]
              [rem      (remainder secs (* 60 60))]
              [minutes  (quotient rem 60)]
@@ -515,8 +558,8 @@
          [is-leap-second (tm:leap-second? (+ offset seconds))])
     (receive (secs date month year)
         (if is-leap-second
-          (tm:decode-julian-day-number (tm:time->julian-day-number (- seconds 1) offset))
-          (tm:decode-julian-day-number (tm:time->julian-day-number seconds offset)))
+          (tm:decode-local-seconds (+ seconds offset -1))
+          (tm:decode-local-seconds (+ seconds offset)))
       ;; adjust for leap seconds if necessary ...
       (let* ([hours    (quotient secs (* 60 60))]
              [rem      (remainder secs (* 60 60))]
@@ -538,8 +581,8 @@
          [is-leap-second (tm:leap-second? (+ offset seconds))])
     (receive (secs date month year)
         (if is-leap-second
-          (tm:decode-julian-day-number (tm:time->julian-day-number (- seconds 1) offset))
-          (tm:decode-julian-day-number (tm:time->julian-day-number seconds offset)))
+          (tm:decode-local-seconds (+ seconds offset -1))
+          (tm:decode-local-seconds (+ seconds offset)))
       ;; adjust for leap seconds if necessary ...
       (let* ([hours    (quotient secs (* 60 60))]
              [rem      (remainder secs (* 60 60))]
@@ -759,9 +802,10 @@
 ;; if string is longer than LENGTH, it's as if number->string was used.
 
 (define (tm:padding n pad-with length)
-  (if pad-with
-    (format #f "~v,vd" length pad-with n)
-    (number->string n)))
+  (let1 s (number->string n)
+    (if (and pad-with (< (string-length s) length))
+      (string-append (make-string (- length (string-length s)) pad-with) s)
+      s)))
 
 (define (tm:last-n-digits i n)
   (abs (remainder i (expt 10 n))))
@@ -800,154 +844,219 @@
 (define (tm:locale-am/pm hr)
   (if (> hr 11) tm:locale-pm tm:locale-am))
 
-(define (tm:tz-printer offset)
-  (cond [(= offset 0) (display "Z")]
-        [(negative? offset) (display "-")]
-        [else (display "+")])
-  (unless (zero? offset)
+(define (tm:tz-string offset)
+  (if (zero? offset)
+    "Z"
     (let ([hours   (abs (quotient offset (* 60 60)))]
           [minutes (abs (quotient (remainder offset (* 60 60)) 60))])
-      (format #t "~2,'0d~2,'0d" hours minutes))))
+      (string-append (if (negative? offset) "-" "+")
+                     (tm:padding hours #\0 2)
+                     (tm:padding minutes #\0 2)))))
 
 ;; A table of output formatting directives.
 ;; the first time is the format char.
-;; the second is a procedure that takes the date, a padding character
-;; (which might be #f), and the output port.
+;; the second is a procedure that takes the date and a padding character
+;; (which might be #f), and returns the formatted string.
 ;;
 (define tm:directives
-  `((#\~ . ,(^[date pad-with] (display #\~)))
+  `((#\~ . ,(^[date pad-with] "~"))
     (#\a . ,(^[date pad-with]
-              (display (tm:locale-abbr-weekday (date-week-day date)))))
+              (tm:locale-abbr-weekday (date-week-day date))))
     (#\A . ,(^[date pad-with]
-              (display (tm:locale-long-weekday (date-week-day date)))))
+              (tm:locale-long-weekday (date-week-day date))))
     (#\b . ,(^[date pad-with]
-              (display (tm:locale-abbr-month (date-month date)))))
+              (tm:locale-abbr-month (date-month date))))
     (#\B . ,(^[date pad-with]
-              (display (tm:locale-long-month (date-month date)))))
+              (tm:locale-long-month (date-month date))))
     (#\c . ,(^[date pad-with]
-              (display (date->string date tm:locale-date-time-format))))
+              (date->string date tm:locale-date-time-format)))
     (#\d . ,(^[date pad-with]
-              (format #t "~2,'0d" (date-day date))))
+              (tm:padding (date-day date) #\0 2)))
     (#\D . ,(^[date pad-with]
-              (display (date->string date "~m/~d/~y"))))
+              (date->string date "~m/~d/~y")))
     (#\e . ,(^[date pad-with]
-              (format #t "~2,' d" (date-day date))))
+              (tm:padding (date-day date) #\space 2)))
     (#\f . ,(^[date pad-with]
-              (display (tm:padding (date-second date) pad-with 2))
-              (display tm:locale-number-separator)
-              (let1 nanostr (number->string (/. (date-nanosecond date) tm:nano/i))
-                (cond [(string-index nanostr #\.)
-                       => (^i (display (string-drop nanostr (+ i 1))))]))))
+              (string-append
+               (tm:padding (date-second date) pad-with 2)
+               tm:locale-number-separator
+               (let1 nanostr (number->string (/. (date-nanosecond date) tm:nano/i))
+                 (cond [(string-index nanostr #\.)
+                        => (^i (string-drop nanostr (+ i 1)))]
+                       [else ""])))))
     (#\h . ,(^[date pad-with]
-              (display (date->string date "~b"))))
+              (date->string date "~b")))
     (#\H . ,(^[date pad-with]
-              (display (tm:padding (date-hour date) pad-with 2))))
+              (tm:padding (date-hour date) pad-with 2)))
     (#\I . ,(^[date pad-with]
               (let1 hr (date-hour date)
                 (if (> hr 12)
-                  (display (tm:padding (- hr 12) pad-with 2))
-                  (display (tm:padding hr pad-with 2))))))
+                  (tm:padding (- hr 12) pad-with 2)
+                  (tm:padding hr pad-with 2)))))
     (#\j . ,(^[date pad-with]
-              (display (tm:padding (date-year-day date) pad-with 3))))
+              (tm:padding (date-year-day date) pad-with 3)))
     (#\k . ,(^[date pad-with]
-              (format #t "~2,' d" (date-hour date))))
+              (tm:padding (date-hour date) #\space 2)))
     (#\l . ,(^[date pad-with]
               (let1 hr (if (> (date-hour date) 12)
                          (- (date-hour date) 12)
                          (date-hour date))
-                (format #t "~2,' d" hr))))
+                (tm:padding hr #\space 2))))
     (#\m . ,(^[date pad-with]
-              (display (tm:padding (date-month date) pad-with 2))))
+              (tm:padding (date-month date) pad-with 2)))
     (#\M . ,(^[date pad-with]
-              (display (tm:padding (date-minute date) pad-with 2))))
-    (#\n . ,(^[date pad-with] (newline)))
+              (tm:padding (date-minute date) pad-with 2)))
+    (#\n . ,(^[date pad-with] "\n"))
     (#\N . ,(^[date pad-with]
-              (display (tm:padding (date-nanosecond date) pad-with 9))))
+              (tm:padding (date-nanosecond date) pad-with 9)))
     (#\p . ,(^[date pad-with]
-              (display (tm:locale-am/pm (date-hour date)))))
+              (tm:locale-am/pm (date-hour date))))
     (#\r . ,(^[date pad-with]
-              (display (date->string date "~I:~M:~S ~p"))))
+              (date->string date "~I:~M:~S ~p")))
     (#\s . ,(^[date pad-with]
-              (display (time-second (date->time-utc date)))))
+              (number->string (time-second (date->time-utc date)))))
     (#\S . ,(^[date pad-with]
-              (display (tm:padding (date-second date) pad-with 2))))
-    (#\t . ,(^[date pad-with]
-              (display #\tab)))
+              (tm:padding (date-second date) pad-with 2)))
+    (#\t . ,(^[date pad-with] "\t"))
     (#\T . ,(^[date pad-with]
-              (display (date->string date "~H:~M:~S"))))
+              (date->string date "~H:~M:~S")))
     (#\U . ,(^[date pad-with]
-              (format #t "~2,'0d"
-                      (if (> (tm:days-before-first-week date 0) 0)
-                        (+ (date-week-number date 0) 1)
-                        (date-week-number date 0)))))
+              (tm:padding (if (> (tm:days-before-first-week date 0) 0)
+                            (+ (date-week-number date 0) 1)
+                            (date-week-number date 0))
+                          #\0 2)))
     (#\V . ,(^[date pad-with]
-              (format #t "~2,'0d" (date-week-number date 1))))
+              (tm:padding (date-week-number date 1) #\0 2)))
     (#\w . ,(^[date pad-with]
-              (display (date-week-day date))))
+              (number->string (date-week-day date))))
     (#\x . ,(^[date pad-with]
-              (display (date->string date tm:locale-short-date-format))))
+              (date->string date tm:locale-short-date-format)))
     (#\X . ,(^[date pad-with]
-              (display (date->string date tm:locale-time-format))))
+              (date->string date tm:locale-time-format)))
     (#\W . ,(^[date pad-with]
-              (format #t "~2,'0d"
-                      (if (> (tm:days-before-first-week date 1) 0)
-                        (+ (date-week-number date 1) 1)
-                        (date-week-number date 1)))))
+              (tm:padding (if (> (tm:days-before-first-week date 1) 0)
+                            (+ (date-week-number date 1) 1)
+                            (date-week-number date 1))
+                          #\0 2)))
     (#\y . ,(^[date pad-with]
-              (display (tm:padding (tm:last-n-digits (date-year date) 2) pad-with 2))))
+              (tm:padding (tm:last-n-digits (date-year date) 2) pad-with 2)))
     (#\Y . ,(^[date pad-with]
-              (display (date-year date))))
+              (number->string (date-year date))))
     (#\z . ,(^[date pad-with]
-              (tm:tz-printer (date-zone-offset date))))
+              (tm:tz-string (date-zone-offset date))))
     (#\Z . ,(^[date pad-with]
-              (tm:locale-print-time-zone date)))
+              (tm:locale-print-time-zone date)
+              ""))
     (#\1 . ,(^[date pad-with]
-              (display (date->string date "~Y-~m-~d"))))
+              (date->string date "~Y-~m-~d")))
     (#\2 . ,(^[date pad-with]
-              (display (date->string date "~H:~M:~S~z"))))
+              (date->string date "~H:~M:~S~z")))
     (#\3 . ,(^[date pad-with]
-              (display (date->string date "~H:~M:~S"))))
+              (date->string date "~H:~M:~S")))
     (#\4 . ,(^[date pad-with]
-              (display (date->string date "~Y-~m-~dT~H:~M:~S~z"))))
+              (date->string date "~Y-~m-~dT~H:~M:~S~z")))
     (#\5 . ,(^[date pad-with]
-              (display (date->string date "~Y-~m-~dT~H:~M:~S"))))
+              (date->string date "~Y-~m-~dT~H:~M:~S")))
     ))
 
+;; Compiled templates.
+;; A format string is parsed once into a list of items, each of which is
+;; either a literal string or (directive-procedure . pad-with).  Compiled
+;; templates of recently used format strings are kept in a small alist,
+;; which is replaced as a whole on update so that concurrent callers
+;; only see a consistent one.
+(define-constant tm:template-cache-size 16)
+
+(define (tm:cached-template cache-getter cache-setter! format-string compile)
+  (if-let1 p (assoc format-string (cache-getter))
+    (cdr p)
+    (rlet1 t (compile format-string)
+      (let1 c (cache-getter)
+        (cache-setter! (acons (string-copy format-string) t
+                              (if (>= (length c) tm:template-cache-size)
+                                (take c (- tm:template-cache-size 1))
+                                c)))))))
+
+;; A compiled output template is #(items memo-ok? memo).  If the result
+;; doesn't depend on nanoseconds (memo-ok?), the last result is kept in
+;; memo as (#(year month day hour minute second zone-offset) . string),
+;; so that formatting timestamps in the same second again, as in logging,
+;; won't redo the work.
+(define (tm:bad-format-string who format-string i)
+  (errorf "~a: bad date format string: \"~a >>>~a<<< ~a\"" who
+          (string-take format-string i)
+          (substring format-string i (+ i 1))
+          (string-drop format-string (+ i 1))))
+
+(define (tm:compile-date-format format-string)
+  (define len (string-length format-string))
+  (define (bad i) (tm:bad-format-string 'date->string format-string i))
+  (define (directive ch pad ind)
+    (if-let1 fn (and (< ind len) (assv ch tm:directives))
+      (cons (cdr fn) pad)
+      (bad (min ind (- len 1)))))
+  (let loop ([i 0] [start 0] [items '()] [memo-ok #t])
+    (define (add-literal items)
+      (if (< start i) (cons (substring format-string start i) items) items))
+    (cond
+     [(>= i len)
+      (vector (reverse! (add-literal items)) memo-ok #f)]
+     [(not (char=? (string-ref format-string i) #\~))
+      (loop (+ i 1) start items memo-ok)]
+     [(= i (- len 1))                   ;trailing '~' is taken literally
+      (loop len start items memo-ok)]
+     [else
+      ;; Gauche extension: ~@x calls the directive 'x' with locale
+      ;; set to C, so the caller can guarantee the output.  Currently
+      ;; the library only supports the default locale, so we can simply
+      ;; ignore '@'.
+      (let* ([ch  (string-ref format-string (+ i 1))]
+             [at? (char=? ch #\@)]
+             [ind (if at? (+ i 2) (+ i 1))]
+             [ch  (if (and at? (< ind len)) (string-ref format-string ind) ch)]
+             [item (directive ch (if at? #f #\0) ind)])
+        (loop (+ ind 1) (+ ind 1) (cons item (add-literal items))
+              (and memo-ok (not (memv ch '(#\f #\N))))))])))
+
+(define tm:date-format-cache '())
+
+(define (tm:date-format format-string)
+  (tm:cached-template (^[] tm:date-format-cache)
+                      (^[c] (set! tm:date-format-cache c))
+                      format-string
+                      tm:compile-date-format))
+
+(define (tm:memo-hit? key date)
+  (and (eqv? (vector-ref key 0) (date-year date))
+       (eqv? (vector-ref key 1) (date-month date))
+       (eqv? (vector-ref key 2) (date-day date))
+       (eqv? (vector-ref key 3) (date-hour date))
+       (eqv? (vector-ref key 4) (date-minute date))
+       (eqv? (vector-ref key 5) (date-second date))
+       (eqv? (vector-ref key 6) (date-zone-offset date))))
+
+(define (tm:format-date date template)
+  (define (run)
+    (let loop ([items (vector-ref template 0)] [r '()])
+      (cond [(null? items) (string-concatenate-reverse r)]
+            [(string? (car items)) (loop (cdr items) (cons (car items) r))]
+            [else (loop (cdr items)
+                        (cons ((caar items) date (cdar items)) r))])))
+  (if (not (vector-ref template 1))
+    (run)
+    (let1 memo (vector-ref template 2)
+      (if (and memo (tm:memo-hit? (car memo) date))
+        (string-copy (cdr memo))
+        (rlet1 s (run)
+          (vector-set! template 2
+                       (cons (vector (date-year date) (date-month date)
+                                     (date-day date) (date-hour date)
+                                     (date-minute date) (date-second date)
+                                     (date-zone-offset date))
+                             (string-copy s))))))))
+
 (define (date->string date . maybe-fmtstr)
-  (let1 format-string (get-optional maybe-fmtstr "~c")
-    (with-input-from-string format-string
-      (^[]
-        (define (bad i)
-          (errorf "date->string: bad date format string: \"~a >>>~a<<< ~a\""
-                  (string-take format-string i)
-                  (substring format-string i (+ i 1))
-                  (string-drop format-string (+ i 1))))
-
-        (define (call-formatter ch pad ind)
-          (if-let1 fn (assv ch tm:directives)
-            (begin ((cdr fn) date pad) (rec (read-char) (+ ind 1)))
-            (bad ind)))
-
-        (define (rec ch ind)
-          (cond
-           [(eof-object? ch)]
-           [(not (char=? ch #\~))
-            (write-char ch) (rec (read-char) (+ ind 1))]
-           [else
-            (let1 ch2 (read-char)
-              (cond
-               [(eof-object? ch2) (write-char ch)]
-               ;; Gauche extension: ~@x calls the directive 'x' with locale
-               ;; set to C, so the caller can guarantee the output.  Currently
-               ;; the library only supports the default locale, so we can simply
-               ;; ignore '@'.  In future we'll add locale-sensitive stuff.
-               [(char=? ch2 #\@)
-                (call-formatter (read-char) #f (+ ind 2))]
-               [else (call-formatter ch2 #\0 (+ ind 1))]))]))
-
-        ;; body
-        (with-output-to-string
-          (cut rec (read-char) 0))))))
+  (tm:format-date date (tm:date-format (get-optional maybe-fmtstr "~c"))))
 
 (define (tm:char->int ch)
   (or (digit->integer ch)
@@ -1115,40 +1224,52 @@
          tm:zone-reader (^[val object] (slot-set! object 'zone-offset val)))
    )))
 
-(define (tm:string->date date index format-string str-len port template-string)
-  (define (bad)
-    (errorf "string->date: bad date format string: \"~a >>>~a<<< ~a\""
-            (string-take template-string index)
-            (substring template-string index (+ index 1))
-            (string-drop template-string (+ index 1))))
-  (define (skip-until port skipper)
+;; A compiled input template is a list of (index . char) for literal
+;; characters and (index . read-directive) for directives, where index
+;; is the position in the template string, used for error messages.
+(define (tm:compile-read-template template-string)
+  (define len (string-length template-string))
+  (let loop ([i 0] [items '()])
+    (cond
+     [(>= i len) (reverse! items)]
+     [(not (char=? (string-ref template-string i) #\~))
+      (loop (+ i 1) (acons i (string-ref template-string i) items))]
+     [(and (< (+ i 1) len)
+           (assv (string-ref template-string (+ i 1)) tm:read-directives))
+      => (^[info] (loop (+ i 2) (acons i info items)))]
+     [else (tm:bad-format-string 'string->date template-string i)])))
+
+(define tm:read-template-cache '())
+
+(define (tm:read-template template-string)
+  (tm:cached-template (^[] tm:read-template-cache)
+                      (^[c] (set! tm:read-template-cache c))
+                      template-string
+                      tm:compile-read-template))
+
+(define (tm:string->date date items port template-string)
+  (define (bad index)
+    (tm:bad-format-string 'string->date template-string index))
+  (define (skip-until index skipper)
     (let1 ch (peek-char port)
-      (when (eof-object? port) (bad))
+      (when (eof-object? ch) (bad index))
       (unless (skipper ch)
-        (read-char port) (skip-until port skipper))))
-  (if (>= index str-len)
-    (values)
-    (let1 current-char (string-ref format-string index)
-      (if (not (char=? current-char #\~))
+        (read-char port) (skip-until index skipper))))
+  (dolist [item items]
+    (let ([index (car item)]
+          [x (cdr item)])
+      (if (char? x)
         (let1 port-char (read-char port)
           (when (or (eof-object? port-char)
-                  (not (char=? current-char port-char)))
-            (bad))
-          (tm:string->date date (+ index 1) format-string str-len port template-string))
-        ;; otherwise, it's an escape, we hope
-        (if (> (+ index 1) str-len)
-          (bad)
-          (let* ([format-char (string-ref format-string (+ index 1))]
-                 [format-info (assoc format-char tm:read-directives)])
-            (when (not format-info) (bad))
-            (let ([skipper (cadr format-info)]
-                  [reader  (caddr format-info)]
-                  [actor   (cadddr format-info)])
-              (skip-until port skipper)
-              (let1 val (reader port)
-                (when (eof-object? val) (bad))
-                (actor val date))
-              (tm:string->date date (+ index 2) format-string  str-len port template-string))))))))
+                    (not (char=? x port-char)))
+            (bad index)))
+        (let ([skipper (cadr x)]
+              [reader  (caddr x)]
+              [actor   (cadddr x)])
+          (skip-until index skipper)
+          (let1 val (reader port)
+            (when (eof-object? val) (bad index))
+            (actor val date)))))))
 
 (define (string->date input-string template-string)
   (define (tm:date-ok? date)
@@ -1162,9 +1283,7 @@
          (date-zone-offset date)))
   (let1 newdate (make-date 0 0 0 0 #f #f #f (tm:local-tz-offset))
     (tm:string->date newdate
-                     0
-                     template-string
-                     (string-length template-string)
+                     (tm:read-template template-string)
                      (open-input-string input-string)
                      template-string)
     (if (tm:date-ok? newdate)
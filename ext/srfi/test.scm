@@ -255,6 +255,12 @@
 (test* "string-pad-right" "325~~" (string-pad-right "325" 5 #\~))
 (test* "string-pad-right" "25~~~" (string-pad-right "325" 5 #\~ 1))
 (test* "string-pad-right" "2~~~~" (string-pad-right "325" 5 #\~ 1 2))
+(test* "string-pad (multibyte)" "\u3042\u3042ab"
+       (string-pad "ab" 4 #\u3042))
+(test* "string-pad-right (multibyte)" "\u3044\u3046-"
+       (string-pad-right "\u3042\u3044\u3046" 3 #\- 1))
+(test* "string-pad (multibyte)" "\u3044\u3046"
+       (string-pad "\u3042\u3044\u3046" 2))
 
 (test* "string-trim"  "a b c d  \r\n"
        (string-trim "  \t  a b c d  \r\n"))
@@ -276,6 +282,13 @@
        (string-trim-both "  \t  a b c d  \r\n" #[\r\n]))
 (test* "string-trim-both"  "a b c d"
        (string-trim-both "349853a b c d03490" #[\d]))
+(test* "string-trim-both"  "" (string-trim-both "  \t "))
+(test* "string-trim-both"  "bcb" (string-trim-both "aabcbaa" #\a))
+(test* "string-trim-both"  "bcb" (string-trim-both "aabcbaa" #\a 1 5))
+(test* "string-trim-both"  "c" (string-trim-both "aabcbaa" (^c (memv c '(#\a #\b)))))
+(test* "string-trim (multibyte)" '("\u3044 \u3046  " "  \u3044 \u3046" "\u3044 \u3046")
+       (let1 s "  \u3044 \u3046  "
+         (list (string-trim s) (string-trim-right s) (string-trim-both s))))
 
 ;; string-fill - in string.scm
 
@@ -336,6 +349,16 @@
        (string-index "abcd:efgh;ijkl" #[\d]))
 (test* "string-index" 9
        (string-index "abcd:efgh:ijkl" #\: 5))
+(test* "string-index" 9
+       (string-index "abcd:efgh;ijkl" #[\W] 5))
+(test* "string-index" #f
+       (string-index "abcd:efgh;ijkl" #[\W] 5 9))
+(test* "string-skip" 4
+       (string-skip "abcd:efgh;ijkl" #[a-z]))
+(test* "string-skip" 9
+       (string-skip "abcd:efgh;ijkl" #[a-z] 5))
+(test* "string-skip" #f
+       (string-skip "abcd:efgh;ijkl" #[a-z:] 0 9))
 (test* "string-index-right" 4
        (string-index-right "abcd:efgh;ijkl" #\:))
 (test* "string-index-right" 9
@@ -344,6 +367,32 @@
        (string-index-right "abcd:efgh;ijkl" #[\d]))
 (test* "string-index-right" 4
        (string-index-right "abcd:efgh;ijkl" #[\W] 2 5))
+(test* "string-index-right" 9
+       (string-index-right "abcd:efgh:ijkl" #\:))
+(test* "string-index-right" 4
+       (string-index-right "abcd:efgh:ijkl" #\: 0 9))
+(test* "string-skip" 2
+       (string-skip "  abc  " #\space))
+(test* "string-skip-right" 4
+       (string-skip-right "  abc  " #\space))
+(test* "string-skip-right" #f
+       (string-skip-right "abcd:efgh:ijkl" #[a-z:]))
+(test* "string-index (predicate)" 4
+       (string-index "abcd:efgh;ijkl" (^c (memv c '(#\: #\;)))))
+(test* "string-index-right (predicate)" 9
+       (string-index-right "abcd:efgh;ijkl" (^c (memv c '(#\: #\;)))))
+(test* "string-index (multibyte)" '(3 6 #f 1)
+       (let1 s "\u3042\u3044\u3046:\u3048\u304a:\u304b"
+         (list (string-index s #\:)
+               (string-index-right s #\:)
+               (string-index s #\u304c)
+               (string-skip s #\u3042))))
+(test* "string-index (multibyte, char-set)" '(2 4 4 5)
+       (let1 s "ab\u3042c\u3044d"
+         (list (string-index s #[^a-z])
+               (string-index-right s #[^a-z])
+               (string-skip s #[a-z\u3042] 1)
+               (string-skip-right s #[^a-z]))))
 
 (test* "string-count" 2
        (string-count "abc def\tghi jkl" #\space))
@@ -365,6 +414,17 @@
        (string-contains "eek -- what a geek." "ee" 12 18))
 (test* "string-contains-ci" 15
        (string-contains-ci "Eek -- what a geek." "EE" 12 18))
+;; long needles and haystacks exercise other search algorithms
+(let* ([needle (string-append (make-string 300 #\a) "b")]
+       [hay (string-append (make-string 1000 #\a) needle "a")])
+  (test* "string-contains (long needle)" 1000
+         (string-contains hay needle))
+  (test* "string-contains (long needle)" #f
+         (string-contains hay (string-append needle "b")))
+  (test* "string-contains (short haystack)" 3
+         (string-contains "abcabd" "abd"))
+  (test* "string-contains (multibyte)" 2
+         (string-contains "\u3042\u3044\u3046\u3048" "\u3046\u3048")))
 
 (test* "string-titlecase" "--Capitalize This Sentence."
        (string-titlecase "--capitalize tHIS sentence."))
@@ -599,6 +659,12 @@
 (test* "string-tokenize" '("elp" "make" "programs" "run" "run")
        (string-tokenize "Help make programs run, run, RUN!"
                         #[a-z]))
+(test* "string-tokenize" '("make" "prog")
+       (string-tokenize "Help make programs run, run, RUN!"
+                        #[a-z] 5 14))
+(test* "string-tokenize" '() (string-tokenize "   "))
+(test* "string-tokenize (multibyte)" '("\u3042\u3044" "\u3046" "x")
+       (string-tokenize " \u3042\u3044  \u3046 x "))
 
 (test* "string-filter" "rrrr"
        (string-filter #\r "Help make programs run, run, RUN!"))
@@ -803,6 +869,43 @@
          (map (cut slot-ref d <>)
               '(year month day hour minute second zone-offset))))
 
+(test* "date->string (same second, cached result)"
+       '("2002-05-15 01:23:34 -1000" "2002-05-15 01:23:34 -1000"
+         "2002-05-15 01:23:35 -1000" "2002-05-15 01:23:34 Z")
+       (let* ([fmt "~Y-~m-~d ~H:~M:~S ~z"]
+              [d (make-date 1 34 23 1 15 5 2002 -36000)]
+              [s0 (date->string d fmt)])
+         (string-set! s0 0 #\X)        ;must not affect the cached result
+         (list (date->string d fmt)
+               (date->string (make-date 999 34 23 1 15 5 2002 -36000) fmt)
+               (begin (slot-set! d 'second 35) (date->string d fmt))
+               (date->string (make-date 1 34 23 1 15 5 2002 0) fmt))))
+(test* "date->string (nanoseconds aren't cached)"
+       '("34.000000001" "34.000000999")
+       (list (date->string (make-date 1 34 23 1 15 5 2002 0) "~S.~N")
+             (date->string (make-date 999 34 23 1 15 5 2002 0) "~S.~N")))
+(test* "date->string (literals and nested formats)"
+       "[~]x 01:23:34 2002-05-15 1:23~"
+       (date->string (make-date 0 34 23 1 15 5 2002 0)
+                     "[~~]x ~T ~1 ~@H:~M~"))
+(test* "date->string (bad format)" (test-error)
+       (date->string (make-date 0 34 23 1 15 5 2002 0) "~Y~Q"))
+(test* "string->date (bad format)" (test-error)
+       (string->date "2002" "~Y~Q"))
+
+(test* "time-utc->date (before epoch)"
+       '(1969 12 30 23 59 59)
+       (let1 d (time-utc->date (make-time time-utc 0 -86401) 0)
+         (map (cut slot-ref d <>) '(year month day hour minute second))))
+(test* "time-utc->date (ancient dates)"
+       '((1 1 1 0 0 0) (-1 12 31 23 59 59) (-4000 3 1 12 0 0))
+       (map (^[d] (let1 d (time-utc->date (date->time-utc d) 0)
+                    (map (cut slot-ref d <>)
+                         '(year month day hour minute second))))
+            (list (make-date 0 0 0 0 1 1 1 0)
+                  (make-date 0 59 59 23 31 12 -1 0)
+                  (make-date 0 0 0 12 1 3 -4000 0))))
+
 ;;
 ;; testing srfi-43
 ;;
@@ -1398,4 +1501,61 @@
 (chibi-test
  (include "vectors-test.scm"))
 
+;; C kernels for single vector cases.  Check both the subr path and
+;; the closure path.
+(let ([v '#(3 1 4 1 5 9 2 6)])
+  (test* "vector-map (subr)" '#(#t #t #f #t #t #t #f #f)
+         (vector-map even? (vector-map (cut + 1 <>) v)))
+  (test* "vector-map (closure)" '#(6 2 8 2 10 18 4 12)
+         (vector-map (^x (* x 2)) v))
+  (test* "vector-map (empty)" '#() (vector-map (^x x) '#()))
+  (test* "vector-map!" '#(4 2 5 2 6 10 3 7)
+         (rlet1 w (vector-copy v) (vector-map! (^x (+ x 1)) w)))
+  (test* "vector-for-each" '(6 2 9 5 1 4 1 3)
+         (rlet1 r '() (vector-for-each (^x (push! r x)) v)))
+  (test* "vector-fold" '(6 2 9 5 1 4 1 3)
+         (vector-fold (^[s x] (cons x s)) '() v))
+  (test* "vector-fold (subr)" '(3 . 1)
+         (vector-fold cons 3 '#(1)))
+  (test* "vector-fold-right" '(3 1 4 1 5 9 2 6)
+         (vector-fold-right (^[s x] (cons x s)) '() v))
+  (test* "vector-count (subr)" 3 (vector-count even? v))
+  (test* "vector-count (closure)" 3 (vector-count (^x (> x 4)) v))
+  (test* "vector-index (subr)" 2 (vector-index even? v))
+  (test* "vector-index (closure)" 5 (vector-index (^x (> x 8)) v))
+  (test* "vector-index (none)" #f (vector-index (^x (> x 10)) v))
+  (test* "vector-index-right" 7 (vector-index-right even? v))
+  (test* "vector-index-right (closure)" 3 (vector-index-right (^x (= x 1)) v))
+  (test* "vector-skip" 2 (vector-skip odd? v))
+  (test* "vector-skip (closure)" 0 (vector-skip (^x (> x 3)) v))
+  (test* "vector-skip-right" 6 (vector-skip-right (^x (> x 5)) v))
+  (test* "vector-skip-right (none)" #f (vector-skip-right number? v)))
+
+(let1 v (list->vector (iota 100 0 3))
+  (test* "vector-binary-search (compare)" '(0 33 99 #f #f #f)
+         (map (cut vector-binary-search v <> compare) '(0 99 297 1 -1 300)))
+  (test* "vector-binary-search (subr)" '(0 33 99 #f #f)
+         (map (cut vector-binary-search v <> -) '(0 99 297 1 300)))
+  (test* "vector-binary-search (closure)" '(0 33 99 #f #f)
+         (map (cut vector-binary-search v <> (^[a b] (- a b)))
+              '(0 99 297 1 300)))
+  (test* "vector-binary-search (flonum result)" 10
+         (vector-binary-search v 30 (^[a b] (inexact (- a b)))))
+  (test* "vector-binary-search (range)" '(#f 20 #f)
+         (map (^x (vector-binary-search v x compare 10 30)) '(27 60 90)))
+  (test* "vector-binary-search (empty)" #f
+         (vector-binary-search '#() 1 compare)))
+
+(test* "vector-map and continuation" '((#(1 2 3)) (#(1 20 3)))
+       (let ([k #f] [rs '()])
+         (let1 r (vector-map (^x (if (= x 2) (call/cc (^c (set! k c) x)) x))
+                             '#(1 2 3))
+           (push! rs (list r))
+           (if (= (length rs) 1)
+             (k 20)
+             (reverse (map (^e (list (vector-copy (car e)))) rs))))))
+(test* "vector-fold and error" 'caught
+       (guard (e [(<error> e) 'caught])
+         (vector-fold + 0 '#(1 2 a 4))))
+
 (test-end)
@@ -0,0 +1,297 @@
+/*
+ * ssax-lexer.c - native lexing primitives for sxml.ssax
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <gauche/priv/portP.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "ssax-lexer.h"
+
+/*=====================================================
+ * Input
+ *
+ *  Like rfc.json-parser, we look at a window of bytes [cur, end) of
+ *  an input string port or a buffered port, and write our position
+ *  back to the port in sync_port().  Other ports, and a character
+ *  that straddles the end of the buffer, are read in characters
+ *  through the port API.
+ *
+ *  Multibyte characters are skipped as a whole while we look for
+ *  ASCII delimiters, so it also works for Shift_JIS, whose second
+ *  byte may look like an ASCII character.
+ */
+
+enum {
+    SRC_ISTR,                   /* window to input string port */
+    SRC_FILE,                   /* window to buffered port */
+    SRC_CHAR                    /* read characters from the port */
+};
+
+typedef struct {
+    ScmPort *port;
+    const unsigned char *cur;
+    const unsigned char *end;
+    const unsigned char *wstart;
+    int mode;
+    int eof;
+} lex_in;
+
+static void in_init(lex_in *in, ScmPort *port)
+{
+    in->port = port;
+    in->cur = in->end = in->wstart = NULL;
+    in->mode = SRC_CHAR;
+    in->eof = FALSE;
+}
+
+static void count_lines(ScmPort *p, const unsigned char *s,
+                        const unsigned char *e)
+{
+    while (s < e) {
+        const unsigned char *nl = memchr(s, '\n', e - s);
+        if (nl == NULL) break;
+        p->line++;
+        s = nl + 1;
+    }
+}
+
+static void sync_port(lex_in *in)
+{
+    if (in->wstart == NULL) return;
+    ScmPort *p = in->port;
+    count_lines(p, in->wstart, in->cur);
+    p->bytes += in->cur - in->wstart;
+    if (in->mode == SRC_ISTR) {
+        p->src.istr.current = (const char*)in->cur;
+    } else {
+        p->src.buf.current = (char*)in->cur;
+    }
+    in->cur = in->end = in->wstart = NULL;
+}
+
+/* Tries to make the window non-empty.  Returns FALSE at the end of
+   input, or if the port has to be read in characters. */
+static int fill(lex_in *in)
+{
+    if (in->eof) return FALSE;
+    sync_port(in);
+
+    ScmPort *p = in->port;
+    in->mode = SRC_CHAR;
+    if (SCM_PORT_CLOSED_P(p) || p->scrcnt != 0
+        || p->ungotten != SCM_CHAR_INVALID) {
+        return FALSE;
+    }
+    if (SCM_PORT_TYPE(p) == SCM_PORT_ISTR) {
+        if (p->src.istr.current >= p->src.istr.end) {
+            in->eof = TRUE;
+            return FALSE;
+        }
+        in->mode = SRC_ISTR;
+        in->cur = in->wstart = (const unsigned char*)p->src.istr.current;
+        in->end = (const unsigned char*)p->src.istr.end;
+        return TRUE;
+    }
+    if (SCM_PORT_TYPE(p) == SCM_PORT_FILE) {
+        if (p->src.buf.current >= p->src.buf.end) {
+            /* Let the port fill its buffer, then put back the byte. */
+            if (Scm_Getb(p) == EOF) {
+                in->eof = TRUE;
+                return FALSE;
+            }
+            p->src.buf.current--;
+            p->bytes--;
+        }
+        in->mode = SRC_FILE;
+        in->cur = in->wstart = (const unsigned char*)p->src.buf.current;
+        in->end = (const unsigned char*)p->src.buf.end;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* Returns the next character, or EOF.  *NB is set to the number of
+   bytes it occupies in the window, or 0 if it is taken from the port. */
+static ScmChar peekc(lex_in *in, int *nb)
+{
+    if (in->cur < in->end || fill(in)) {
+        int b = *in->cur;
+        if (b < 0x80) {
+            *nb = 1;
+            return b;
+        }
+        int n = SCM_CHAR_NFOLLOWS(b);
+        if (in->end - in->cur > n) {
+            ScmChar ch;
+            SCM_CHAR_GET(in->cur, ch);
+            *nb = n + 1;
+            return ch;
+        }
+        sync_port(in);          /* the character straddles the buffer */
+    }
+    *nb = 0;
+    if (in->eof) return EOF;
+    return Scm_Peekc(in->port);
+}
+
+static inline void skipc(lex_in *in, int nb)
+{
+    if (nb > 0) in->cur += nb;
+    else Scm_Getc(in->port);
+}
+
+/*=====================================================
+ * Lexemes
+ */
+
+#define XML_S(c)  ((c) == ' ' || (c) == '\n' || (c) == '\t' || (c) == '\r')
+
+#define ASCII_ALPHA(c) \
+    (((c) >= 'a' && (c) <= 'z') || ((c) >= 'A' && (c) <= 'Z'))
+#define ASCII_NAME_CHAR(c)                                      \
+    (ASCII_ALPHA(c) || ((c) >= '0' && (c) <= '9')               \
+     || (c) == '.' || (c) == '-' || (c) == '_')
+
+/* ssax:ncname-starting-char? */
+static inline int name_start_p(ScmChar ch)
+{
+    if (ch == EOF) return FALSE;
+    if (ch < 0x80) return ASCII_ALPHA(ch) || ch == '_';
+    return Scm_CharAlphabeticP(ch);
+}
+
+/* The constituents of NCName in ssax:read-NCName.  Only ASCII digits
+   are allowed, as in the original. */
+static inline int name_char_p(ScmChar ch)
+{
+    if (ch == EOF) return FALSE;
+    if (ch < 0x80) return ASCII_NAME_CHAR(ch);
+    return Scm_CharAlphabeticP(ch);
+}
+
+ScmObj Scm__SsaxSkipS(ScmPort *port)
+{
+    lex_in in;
+    in_init(&in, port);
+    ScmChar ch;
+    for (;;) {
+        while (in.cur < in.end && XML_S(*in.cur)) in.cur++;
+        int nb;
+        ch = peekc(&in, &nb);
+        if (!XML_S(ch)) break;
+        skipc(&in, nb);
+    }
+    sync_port(&in);
+    return (ch == EOF)? SCM_EOF : SCM_MAKE_CHAR(ch);
+}
+
+ScmObj Scm__SsaxReadNCName(ScmPort *port)
+{
+    lex_in in;
+    in_init(&in, port);
+    int nb;
+    if (!name_start_p(peekc(&in, &nb))) {
+        sync_port(&in);
+        return SCM_FALSE;
+    }
+
+    ScmDString ds;
+    Scm_DStringInit(&ds);
+    for (;;) {
+        if (in.cur < in.end) {
+            const unsigned char *s = in.cur;
+            while (in.cur < in.end && ASCII_NAME_CHAR(*in.cur)) in.cur++;
+            if (in.cur > s) Scm_DStringPutz(&ds, (const char*)s, in.cur - s);
+            if (in.cur < in.end && *in.cur < 0x80) break;
+        }
+        ScmChar ch = peekc(&in, &nb);
+        if (!name_char_p(ch)) break;
+        Scm_DStringPutc(&ds, ch);
+        skipc(&in, nb);
+    }
+    sync_port(&in);
+    return Scm_Intern(SCM_STRING(Scm_DStringGet(&ds, SCM_STRING_IMMUTABLE)));
+}
+
+ScmObj Scm__SsaxNextToken(ScmPort *port, ScmString *delims, int eof_ok)
+{
+    /* bitmap of delimiters */
+    unsigned char dmap[128];
+    memset(dmap, 0, sizeof(dmap));
+    u_int size;
+    const unsigned char *d =
+        (const unsigned char*)Scm_GetStringContent(delims, &size, NULL, NULL);
+    for (u_int i = 0; i < size; i++) {
+        if (d[i] >= 0x80) {
+            Scm_Error("delimiters must be ASCII characters: %S", delims);
+        }
+        dmap[d[i]] = 1;
+    }
+
+    lex_in in;
+    in_init(&in, port);
+    ScmDString ds;
+    Scm_DStringInit(&ds);
+    for (;;) {
+        if (in.cur < in.end) {
+            const unsigned char *s = in.cur, *e = in.end, *q = s;
+            while (q < e) {
+                if (*q < 0x80) {
+                    if (dmap[*q]) break;
+                    q++;
+                } else {
+                    int n = SCM_CHAR_NFOLLOWS(*q);
+                    if (e - q <= n) break;
+                    q += n + 1;
+                }
+            }
+            if (q > s) Scm_DStringPutz(&ds, (const char*)s, q - s);
+            in.cur = q;
+            if (q < e && *q < 0x80) break; /* found a delimiter */
+        }
+        int nb;
+        ScmChar ch = peekc(&in, &nb);
+        if (ch == EOF) {
+            if (eof_ok) break;
+            sync_port(&in);
+            return SCM_FALSE;
+        }
+        if (ch < 0x80 && dmap[ch]) break;
+        Scm_DStringPutc(&ds, ch);
+        skipc(&in, nb);
+    }
+    sync_port(&in);
+    return Scm_DStringGet(&ds, 0);
+}
@@ -0,0 +1,52 @@
+/*
+ * ssax-lexer.h - native lexing primitives for sxml.ssax
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_SXML_SSAX_LEXER_H
+#define GAUCHE_SXML_SSAX_LEXER_H
+
+/* Skips XML whitespaces (#x20, #x9, #xD and #xA) and returns the
+   next character, which is left in PORT, or EOF.  */
+extern ScmObj Scm__SsaxSkipS(ScmPort *port);
+
+/* Reads an NCName and returns it as a symbol.  If PORT doesn't
+   start with a name character, nothing is read and #f is returned.  */
+extern ScmObj Scm__SsaxReadNCName(ScmPort *port);
+
+/* Reads characters up to one of DELIMS, which must consist of ASCII
+   characters, and returns them as a string.  The delimiter is left
+   in PORT.  If EOF comes first, returns what is read when EOF_OK is
+   true, or #f otherwise.  */
+extern ScmObj Scm__SsaxNextToken(ScmPort *port, ScmString *delims,
+                                 int eof_ok);
+
+#endif /* GAUCHE_SXML_SSAX_LEXER_H */
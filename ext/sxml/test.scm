@@ -23,6 +23,44 @@
   (test* "ns-trans" '((rss:title "foo"))
          ((sxpath "//my:title" ns-alist) sxml)))
 
+;; compiled paths must give the same result as the generic sxpath
+(let ((doc '(*TOP* (*PI* xml "version='1.0'")
+                   (doc (@ (id "d"))
+                        (head (title "T") (meta (@ (name "a"))))
+                        (body (p (@ (class "x")) "one" (b "two"))
+                              (p "three" (p "nested" (b "four")))
+                              (ns:p "ns")
+                              (*COMMENT* "c")))))
+      (generic (with-module sxml.sxpath %sxpath-generic)))
+  (for-each
+   (lambda (path)
+     (test* `(compiled ,path) ((generic path) doc) ((sxpath path) doc))
+     (test* `(compiled nodeset ,path)
+            ((generic path) (list doc '(p (b "x"))))
+            ((sxpath path) (list doc '(p (b "x")))))
+     (test* `(car-sxpath ,path)
+            (let1 r ((generic path) doc) (if (null? r) '() (car r)))
+            ((car-sxpath path) doc)))
+   '((doc) (doc body p) (doc body p b) (doc @ id) (* * *) (*any*)
+     (doc body p *text*) (doc body *) (doc body *any*)
+     (//) (// p) (// p b) (// @) (// *text*) (doc // p) (doc // b *text*)
+     (// p // b) (// //) (doc body (or@ p ns:p)) (doc body (not@ p))
+     (doc body (ns-id:* "ns")) (doc body (ns-id:* #f))
+     (doc (equal? (head (title "T") (meta (@ (name "a"))))) title)
+     (nothing) (// nothing)))
+  (test* "if-car-sxpath" #f ((if-car-sxpath '(// nothing)) doc))
+  (test* "if-sxpath" #f ((if-sxpath '(// nothing)) doc))
+  (test* "if-sxpath" '((b "two") (b "four")) ((if-sxpath '(// b)) doc))
+  (test* "cached" #t (eq? (sxpath '(doc body p)) (sxpath '(doc body p))))
+  (test* "cache key is copied" '((title "T"))
+         (let1 path (list 'doc 'head 'title)
+           (sxpath path)
+           (set-car! (cddr path) 'meta)
+           ((sxpath '(doc head title)) doc)))
+  (test* "non-compiled path" '("two")
+         ((sxpath '(doc body (p 1) b *text*)) doc))
+  )
+
 (test-end)
 
 ;; sxml.serializer test
@@ -46,3 +84,71 @@
 
 (test-end)
 
+
+;; native lexers of sxml.ssax
+
+(test-start "ssax lexer")
+(use sxml.ssax)
+
+(let ()
+  ;; returns the result and the rest of the input
+  (define (lex proc str)
+    (call-with-input-string str
+      (^p (let1 r (proc p) (list r (port->string p))))))
+  (define (token delims eof-ok?)
+    (cut %ssax-next-token <> delims eof-ok?))
+
+  (test* "skip-S" '(#\x "x ") (lex ssax:skip-S " \t\r\n x "))
+  (test* "skip-S eof" `(,(eof-object) "") (lex ssax:skip-S " \n "))
+  (test* "skip-S line count" 3
+         (call-with-input-string "\n\r\n  x"
+           (^p (ssax:skip-S p) (port-current-line p))))
+  (test* "skip-S after peek-char" '(#\x "x")
+         (call-with-input-string "  x"
+           (^p (peek-char p) (list (ssax:skip-S p) (port->string p)))))
+  (test* "read-NCName" '(_a.b-1 ":c") (lex ssax:read-NCName "_a.b-1:c"))
+  (test* "read-NCName bad start" '(#f "1ab") (lex %ssax-read-NCName "1ab"))
+  (test* "read-NCName error" (test-error) (lex ssax:read-NCName "1ab"))
+  (test* "next-token" '("ab" "<c") (lex (token "<&\r" #f) "ab<c"))
+  (test* "next-token eof" '(#f "") (lex (token "<&\r" #f) "abc"))
+  (test* "next-token eof-ok" '("abc" "") (lex (token "<&\r" #t) "abc"))
+  (test* "next-token non-ascii delimiter" (test-error)
+         (lex (token "\u00e9" #t) "abc"))
+  (cond-expand
+   [gauche.ces.utf8
+    (test* "read-NCName multibyte" `(,(string->symbol "\u00e9t\u00e9") " x")
+           (lex ssax:read-NCName "\u00e9t\u00e9 x"))
+    (test* "next-token multibyte" '("caf\u00e9 \u3042" "&x")
+           (lex (token "<&" #f) "caf\u00e9 \u3042&x"))
+    (test* "xml->sxml multibyte"
+           `(*TOP* (,(string->symbol "\u00e9l") (@ (a "\u00e9t\u00e9"))
+                    "caf\u00e9 \u3042"))
+           (call-with-input-string
+               "<\u00e9l a='\u00e9t\u00e9'>caf\u00e9 \u3042</\u00e9l>"
+             (cut ssax:xml->sxml <> '())))]
+   [else])
+  )
+
+;; A document larger than the port buffer
+(let ()
+  (define n 2000)
+  (define doc
+    (with-output-to-string
+      (^[] (display "<root>\r\n")
+           (dotimes [i n]
+             (format #t "<item n='~a &amp;\tx'>text ~a &lt; more\r\n</item>\n"
+                     i i))
+           (display "<![CDATA[a]]b\r\n]]></root>"))))
+  (define expected
+    `(*TOP* (root ,@(map (^i `(item (@ (n ,#"~i & x")) ,#"text ~i < more\n"))
+                         (iota n))
+                  "\na]]b\n")))
+
+  (test* "xml->sxml (string)" expected
+         (call-with-input-string doc (cut ssax:xml->sxml <> '())))
+  (with-output-to-file "test.o" (cut display doc))
+  (test* "xml->sxml (file)" expected
+         (call-with-input-file "test.o" (cut ssax:xml->sxml <> '())))
+  (sys-unlink "test.o"))
+
+(test-end)
@@ -36,6 +36,17 @@
     ((define (fold ...) ...))
     ;; We have constant definition instead.
     ((define ssax:S-chars ...))
+    ;; These lexers are replaced by native ones in sxml-ssax.scm.in.
+    ((define (ssax:skip-S ...) ...))
+    ((define (ssax:read-NCName ...) ...))
+    ((define ssax:read-char-data ...))
+    ((define ssax:read-cdata-body ...))
+    ((define ssax:read-attributes ...))
+    ;; These are replaced in sxml-sxpath.scm.in, so that the path is
+    ;; compiled only once.
+    ((define (if-sxpath ...) ...))
+    ((define (if-car-sxpath ...) ...))
+    ((define (car-sxpath ...) ...))
     ;; These forms are in sxml-tools.
     ;; We have Gauche-specific versions for them
     ((define-macro (sxml:find-name-separator ...) ...))
@@ -0,0 +1,704 @@
+/*
+ * csv-parser.c - CSV tokenizer for text.csv-parser
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <gauche/priv/portP.h>
+#include <string.h>
+#include <ctype.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "csv-parser.h"
+
+/*=====================================================
+ * Input
+ *
+ *  Like rfc.json-parser, we look at a window of bytes [cur, end).
+ *  For an input string port and a buffered port, the window is the
+ *  port's own buffer and we write our position back in sync_port().
+ *  Other ports are read one byte at a time, for we must not take
+ *  anything after the record from the port.
+ *
+ *  Separators, quotes and newlines are found bytewise.  That's safe
+ *  as far as they are ASCII in UTF-8 and EUC-JP, but in Shift_JIS
+ *  the second byte of a multibyte character can be 0x40 or above;
+ *  see Scm__CsvNativeCharP.
+ */
+
+enum {
+    SRC_ISTR,                   /* window to input string port */
+    SRC_FILE,                   /* window to buffered port */
+    SRC_BYTE                    /* one byte taken from a port */
+};
+
+#define FIELD_BUFSIZ 256
+
+typedef struct {
+    ScmPort *port;
+    const unsigned char *cur;
+    const unsigned char *end;
+    const unsigned char *wstart;
+    int mode;
+    int eof;
+    unsigned char byte;
+    int sep;                    /* separator byte */
+    int quo;                    /* quote byte, or -1 */
+    ScmSmallInt records;        /* # of records read, for messages */
+    /* the current field */
+    unsigned char *buf;
+    ScmSmallInt len;
+    ScmSmallInt cap;
+    unsigned char buf0[FIELD_BUFSIZ];
+} csv_in;
+
+static void in_init(csv_in *in, ScmPort *port, ScmObj sep, ScmObj quo)
+{
+    if (!Scm__CsvNativeCharP(sep)) {
+        Scm_Error("bad separator: %S", sep);
+    }
+    if (!SCM_FALSEP(quo) && !Scm__CsvNativeCharP(quo)) {
+        Scm_Error("bad quote character: %S", quo);
+    }
+    in->port = port;
+    in->cur = in->end = in->wstart = NULL;
+    in->mode = SRC_BYTE;
+    in->eof = FALSE;
+    in->sep = SCM_CHAR_VALUE(sep);
+    in->quo = SCM_FALSEP(quo)? -1 : SCM_CHAR_VALUE(quo);
+    in->records = 0;
+    in->buf = in->buf0;
+    in->len = 0;
+    in->cap = FIELD_BUFSIZ;
+}
+
+static void count_lines(ScmPort *p, const unsigned char *s,
+                        const unsigned char *e)
+{
+    while (s < e) {
+        const unsigned char *nl = memchr(s, '\n', e - s);
+        if (nl == NULL) break;
+        p->line++;
+        s = nl + 1;
+    }
+}
+
+static void sync_port(csv_in *in)
+{
+    if (in->wstart == NULL) return;
+    ScmPort *p = in->port;
+    ScmSmallInt n = in->cur - in->wstart;
+    switch (in->mode) {
+    case SRC_ISTR:
+        count_lines(p, in->wstart, in->cur);
+        p->src.istr.current = (const char*)in->cur;
+        p->bytes += n;
+        break;
+    case SRC_FILE:
+        count_lines(p, in->wstart, in->cur);
+        p->src.buf.current = (char*)in->cur;
+        p->bytes += n;
+        break;
+    case SRC_BYTE:
+        if (in->cur < in->end) Scm_Ungetb(*in->cur, p);
+        break;
+    }
+    in->cur = in->end = in->wstart = NULL;
+}
+
+/* Make the window non-empty.  Returns FALSE at the end of input. */
+static int fill(csv_in *in)
+{
+    if (in->eof) return FALSE;
+    sync_port(in);
+
+    ScmPort *p = in->port;
+    if (!SCM_PORT_CLOSED_P(p) && p->scrcnt == 0
+        && p->ungotten == SCM_CHAR_INVALID) {
+        if (SCM_PORT_TYPE(p) == SCM_PORT_ISTR) {
+            if (p->src.istr.current >= p->src.istr.end) {
+                in->eof = TRUE;
+                return FALSE;
+            }
+            in->mode = SRC_ISTR;
+            in->cur = in->wstart = (const unsigned char*)p->src.istr.current;
+            in->end = (const unsigned char*)p->src.istr.end;
+            return TRUE;
+        }
+        if (SCM_PORT_TYPE(p) == SCM_PORT_FILE) {
+            if (p->src.buf.current >= p->src.buf.end) {
+                /* Let the port fill its buffer, then put back the byte. */
+                if (Scm_Getb(p) == EOF) {
+                    in->eof = TRUE;
+                    return FALSE;
+                }
+                p->src.buf.current--;
+                p->bytes--;
+            }
+            in->mode = SRC_FILE;
+            in->cur = in->wstart = (const unsigned char*)p->src.buf.current;
+            in->end = (const unsigned char*)p->src.buf.end;
+            return TRUE;
+        }
+    }
+
+    int b = Scm_Getb(p);
+    if (b == EOF) {
+        in->eof = TRUE;
+        return FALSE;
+    }
+    in->mode = SRC_BYTE;
+    in->byte = (unsigned char)b;
+    in->cur = in->wstart = &in->byte;
+    in->end = in->cur + 1;
+    return TRUE;
+}
+
+static inline int peekb(csv_in *in)
+{
+    if (in->cur < in->end || fill(in)) return *in->cur;
+    return EOF;
+}
+
+static inline int getb(csv_in *in)
+{
+    if (in->cur < in->end || fill(in)) return *in->cur++;
+    return EOF;
+}
+
+static void put_bytes(csv_in *in, const unsigned char *s, ScmSmallInt n)
+{
+    if (in->len + n > in->cap) {
+        ScmSmallInt cap = in->cap * 2;
+        while (cap < in->len + n) cap *= 2;
+        unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*, cap);
+        memcpy(buf, in->buf, in->len);
+        in->buf = buf;
+        in->cap = cap;
+    }
+    memcpy(in->buf + in->len, s, n);
+    in->len += n;
+}
+
+static inline void put_byte(csv_in *in, unsigned char b)
+{
+    if (in->len < in->cap) in->buf[in->len++] = b;
+    else put_bytes(in, &b, 1);
+}
+
+/*=====================================================
+ * Tokenizer
+ *
+ *  This follows csv-reader in text.csv exactly: whitespaces are
+ *  char-whitespace?, and they're trimmed around unquoted fields;
+ *  a quote char only matters at the beginning of a field; and
+ *  anything between the closing quote and the next separator is
+ *  ignored.
+ */
+
+enum {
+    TERM_SEP,                   /* the field is followed by a separator */
+    TERM_EOR                    /* the field ends the record */
+};
+
+#define ASCII_WSP(b)  ((b) == ' ' || ((b) >= '\t' && (b) <= '\r'))
+
+/* B is the first byte of a multibyte character.  Stores the character
+   into the field and returns it. */
+static ScmChar get_mbchar(csv_in *in, int b)
+{
+    int n = SCM_CHAR_NFOLLOWS(b);
+    ScmSmallInt start = in->len;
+    put_byte(in, (unsigned char)b);
+    for (int i = 0; i < n; i++) {
+        int c = getb(in);
+        if (c == EOF) return SCM_CHAR_INVALID;
+        put_byte(in, (unsigned char)c);
+    }
+    ScmChar ch;
+    SCM_CHAR_GET(in->buf + start, ch);
+    return ch;
+}
+
+/* Returns the first byte in [s, e) that can end a run of plain bytes
+   in an unquoted field, i.e. the separator, a control character or a
+   whitespace, and a byte that isn't ASCII. */
+static inline const unsigned char *scan_unquoted(const unsigned char *s,
+                                                 const unsigned char *e,
+                                                 int sep)
+{
+#if defined(__SSE2__) && defined(__GNUC__)
+    const __m128i vsep = _mm_set1_epi8((char)sep);
+    const __m128i vlim = _mm_set1_epi8(0x21);
+    while (e - s >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)s);
+        /* signed comparison; bytes >= 0x80 are negative */
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, vsep),
+                                 _mm_cmplt_epi8(v, vlim));
+        int bits = _mm_movemask_epi8(m);
+        if (bits) return s + __builtin_ctz(bits);
+        s += 16;
+    }
+#endif
+    while (s < e && *s != sep && *s > 0x20 && *s < 0x80) s++;
+    return s;
+}
+
+static int read_quoted_tail(csv_in *in)
+{
+    for (;;) {
+        int b = getb(in);
+        if (b == EOF || b == '\n') return TERM_EOR;
+        if (b == in->sep) return TERM_SEP;
+    }
+}
+
+static int read_quoted(csv_in *in)
+{
+    for (;;) {
+        if (in->cur >= in->end && !fill(in)) {
+            sync_port(in);
+            Scm_Error("unterminated quoted field");
+        }
+        const unsigned char *q = memchr(in->cur, in->quo, in->end - in->cur);
+        if (q == NULL) {
+            put_bytes(in, in->cur, in->end - in->cur);
+            in->cur = in->end;
+            continue;
+        }
+        put_bytes(in, in->cur, q - in->cur);
+        in->cur = q + 1;
+        if (peekb(in) != in->quo) return read_quoted_tail(in);
+        put_byte(in, (unsigned char)in->quo);
+        in->cur++;
+    }
+}
+
+static int read_unquoted(csv_in *in)
+{
+    ScmSmallInt last = in->len; /* the field without trailing spaces */
+    int term;
+    for (;;) {
+        if (in->cur >= in->end && !fill(in)) {
+            term = TERM_EOR;
+            break;
+        }
+        const unsigned char *s = in->cur;
+        const unsigned char *e = scan_unquoted(s, in->end, in->sep);
+        if (e > s) {
+            put_bytes(in, s, e - s);
+            last = in->len;
+            in->cur = e;
+            if (e == in->end) continue;
+        }
+        int b = *in->cur++;
+        if (b == '\n') { term = TERM_EOR; break; }
+        if (b == in->sep) { term = TERM_SEP; break; }
+        if (b < 0x80) {
+            put_byte(in, (unsigned char)b);
+            if (!ASCII_WSP(b)) last = in->len;
+        } else {
+            ScmChar ch = get_mbchar(in, b);
+            if (!SCM_CHAR_EXTRA_WHITESPACE(ch)) last = in->len;
+        }
+    }
+    in->len = last;
+    return term;
+}
+
+/* Reads one field into in->buf. */
+static int read_field(csv_in *in)
+{
+    in->len = 0;
+    for (;;) {
+        int b = getb(in);
+        if (b == EOF || b == '\n') return TERM_EOR;
+        if (b == in->sep) return TERM_SEP;
+        if (b == in->quo) return read_quoted(in);
+        if (b < 0x80) {
+            if (ASCII_WSP(b)) continue;
+            put_byte(in, (unsigned char)b);
+            break;
+        }
+        ScmChar ch = get_mbchar(in, b);
+        if (!SCM_CHAR_EXTRA_WHITESPACE(ch)) break;
+        in->len = 0;
+    }
+    return read_unquoted(in);
+}
+
+int Scm__CsvNativeCharP(ScmObj ch)
+{
+    if (!SCM_CHARP(ch)) return FALSE;
+#if defined(GAUCHE_CHAR_ENCODING_SJIS)
+    return SCM_CHAR_VALUE(ch) < 0x40;
+#else
+    return SCM_CHAR_VALUE(ch) < 0x80;
+#endif
+}
+
+/*=====================================================
+ * String pool
+ */
+
+#define POOL_MAX_FIELD 64       /* longer fields aren't pooled */
+#define POOL_MAX_COUNT 65536    /* the pool doesn't grow beyond this */
+
+static void pool_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<csv-string-pool %ld>",
+               SCM_CSV_STRING_POOL(obj)->count);
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_CsvStringPoolClass, pool_print);
+
+ScmObj Scm__MakeCsvStringPool(void)
+{
+    ScmCsvStringPool *pool = SCM_NEW(ScmCsvStringPool);
+    SCM_SET_CLASS(pool, SCM_CLASS_CSV_STRING_POOL);
+    pool->size = 64;
+    pool->count = 0;
+    pool->entries = SCM_NEW_ARRAY(ScmObj, pool->size);
+    for (ScmSmallInt i = 0; i < pool->size; i++) pool->entries[i] = SCM_FALSE;
+    return SCM_OBJ(pool);
+}
+
+static u_long pool_hash(const unsigned char *s, ScmSmallInt n)
+{
+    u_long h = 2166136261UL;
+    for (ScmSmallInt i = 0; i < n; i++) h = (h ^ s[i]) * 16777619UL;
+    return h;
+}
+
+static ScmObj *pool_slot(ScmObj *entries, ScmSmallInt size, u_long h,
+                         const unsigned char *s, ScmSmallInt n)
+{
+    for (ScmSmallInt i = h & (size-1);; i = (i+1) & (size-1)) {
+        if (SCM_FALSEP(entries[i])) return &entries[i];
+        u_int siz;
+        const char *c = Scm_GetStringContent(SCM_STRING(entries[i]),
+                                             &siz, NULL, NULL);
+        if (siz == n && memcmp(c, s, n) == 0) return &entries[i];
+    }
+}
+
+static void pool_grow(ScmCsvStringPool *pool)
+{
+    ScmSmallInt size = pool->size * 2;
+    ScmObj *entries = SCM_NEW_ARRAY(ScmObj, size);
+    for (ScmSmallInt i = 0; i < size; i++) entries[i] = SCM_FALSE;
+    for (ScmSmallInt i = 0; i < pool->size; i++) {
+        ScmObj e = pool->entries[i];
+        if (SCM_FALSEP(e)) continue;
+        u_int siz;
+        const char *c = Scm_GetStringContent(SCM_STRING(e), &siz, NULL, NULL);
+        *pool_slot(entries, size, pool_hash((const unsigned char*)c, siz),
+                   (const unsigned char*)c, siz) = e;
+    }
+    pool->entries = entries;
+    pool->size = size;
+}
+
+static ScmObj pool_intern(ScmCsvStringPool *pool,
+                          const unsigned char *s, ScmSmallInt n)
+{
+    if (n > POOL_MAX_FIELD) {
+        return Scm_MakeString((const char*)s, n, -1, SCM_STRING_COPYING);
+    }
+    ScmObj *slot = pool_slot(pool->entries, pool->size, pool_hash(s, n), s, n);
+    if (!SCM_FALSEP(*slot)) return *slot;
+    ScmObj str = Scm_MakeString((const char*)s, n, -1,
+                                SCM_STRING_COPYING|SCM_STRING_IMMUTABLE);
+    if (pool->count < POOL_MAX_COUNT) {
+        *slot = str;
+        if (++pool->count * 2 > pool->size) pool_grow(pool);
+    }
+    return str;
+}
+
+static ScmObj field_string(csv_in *in, ScmObj pool)
+{
+    if (SCM_CSV_STRING_POOL_P(pool)) {
+        return pool_intern(SCM_CSV_STRING_POOL(pool), in->buf, in->len);
+    }
+    return Scm_MakeString((const char*)in->buf, in->len, -1,
+                          SCM_STRING_COPYING);
+}
+
+/*=====================================================
+ * Records
+ */
+
+ScmObj Scm__CsvReadRecord(ScmPort *port, ScmObj sep, ScmObj quo,
+                          ScmObj pool)
+{
+    csv_in in;
+    in_init(&in, port, sep, quo);
+    if (peekb(&in) == EOF) {
+        sync_port(&in);
+        return SCM_EOF;
+    }
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    for (;;) {
+        int term = read_field(&in);
+        SCM_APPEND1(h, t, field_string(&in, pool));
+        if (term == TERM_EOR) break;
+    }
+    sync_port(&in);
+    return h;
+}
+
+/*=====================================================
+ * Columns
+ *
+ *  Each column is accumulated in a growing array, which becomes
+ *  the body of the resulting vector or uvector.
+ */
+
+enum {
+    COL_SKIP,
+    COL_STRING,                 /* vector of strings, through a pool */
+    COL_SYMBOL,                 /* vector of symbols */
+    COL_NUMBER,                 /* vector of numbers or #f */
+    COL_UVECTOR                 /* uvector */
+};
+
+typedef struct {
+    int kind;
+    ScmClass *klass;            /* for COL_UVECTOR */
+    int utype;
+    int eltsize;
+    char *data;
+    ScmSmallInt count;
+    ScmSmallInt cap;
+    ScmObj pool;
+} csv_column;
+
+static void column_init(csv_column *col, ScmObj spec)
+{
+    col->kind = COL_SKIP;
+    col->klass = NULL;
+    col->utype = SCM_UVECTOR_INVALID;
+    col->eltsize = sizeof(ScmObj);
+    col->data = NULL;
+    col->count = col->cap = 0;
+    col->pool = SCM_FALSE;
+
+    if (SCM_FALSEP(spec)) return;
+    if (SCM_EQ(spec, SCM_OBJ(SCM_CLASS_STRING))) {
+        col->kind = COL_STRING;
+        col->pool = Scm__MakeCsvStringPool();
+    } else if (SCM_EQ(spec, SCM_OBJ(SCM_CLASS_SYMBOL))) {
+        col->kind = COL_SYMBOL;
+    } else if (SCM_EQ(spec, SCM_OBJ(SCM_CLASS_NUMBER))) {
+        col->kind = COL_NUMBER;
+    } else if (SCM_CLASSP(spec)
+               && Scm_UVectorType(SCM_CLASS(spec)) != SCM_UVECTOR_INVALID) {
+        col->kind = COL_UVECTOR;
+        col->klass = SCM_CLASS(spec);
+        col->utype = Scm_UVectorType(col->klass);
+        col->eltsize = Scm_UVectorElementSize(col->klass);
+    } else {
+        Scm_Error("bad column spec: must be #f, <string>, <symbol>, "
+                  "<number> or a uvector class, but got: %S", spec);
+    }
+}
+
+static void *column_push(csv_column *col)
+{
+    if (col->count >= col->cap) {
+        ScmSmallInt cap = col->cap? col->cap * 2 : 1024;
+        char *data = (col->kind == COL_UVECTOR)
+            ? SCM_NEW_ATOMIC2(char*, cap * col->eltsize)
+            : SCM_NEW2(char*, cap * col->eltsize);
+        if (col->count > 0) memcpy(data, col->data, col->count * col->eltsize);
+        col->data = data;
+        col->cap = cap;
+    }
+    return col->data + (col->count++) * col->eltsize;
+}
+
+static ScmObj column_result(csv_column *col)
+{
+    if (col->kind == COL_UVECTOR) {
+        void *data = col->data;
+        if (data == NULL) data = SCM_NEW_ATOMIC2(void*, col->eltsize);
+        return Scm_MakeUVector(col->klass, col->count, data);
+    }
+    ScmObj v = Scm_MakeVector(col->count, SCM_FALSE);
+    if (col->count > 0) {
+        memcpy(SCM_VECTOR_ELEMENTS(v), col->data,
+               col->count * sizeof(ScmObj));
+    }
+    return v;
+}
+
+static ScmObj field_number(csv_in *in)
+{
+    ScmObj n = Scm__ParseDecimalNumber((const char*)in->buf, (int)in->len);
+    if (!SCM_UNBOUNDP(n)) return n;
+    ScmObj s = Scm_MakeString((const char*)in->buf, in->len, -1,
+                              SCM_STRING_COPYING);
+    return Scm_StringToNumber(SCM_STRING(s), 10, 0);
+}
+
+static void bad_value(csv_in *in, csv_column *col, int k, const char *what)
+{
+    ScmObj s = Scm_MakeString((const char*)in->buf, in->len, -1,
+                              SCM_STRING_COPYING);
+    sync_port(in);
+    Scm_Error("%s for %s column %d in record %ld: %S", what,
+              Scm_UVectorTypeName(col->utype), k, in->records, s);
+}
+
+static void store_uvector(csv_in *in, csv_column *col, int k)
+{
+    ScmObj n = field_number(in);
+    if (!SCM_REALP(n)) bad_value(in, col, k, "invalid value");
+
+    void *p = column_push(col);
+    int oor = FALSE;
+    switch (col->utype) {
+    case SCM_UVECTOR_F16:
+        *(ScmHalfFloat*)p = Scm_DoubleToHalf(Scm_GetDouble(n)); return;
+    case SCM_UVECTOR_F32:
+        *(float*)p = (float)Scm_GetDouble(n); return;
+    case SCM_UVECTOR_F64:
+        *(double*)p = Scm_GetDouble(n); return;
+    }
+    if (!SCM_INTEGERP(n)) {
+        col->count--;
+        bad_value(in, col, k, "invalid value");
+    }
+    switch (col->utype) {
+    case SCM_UVECTOR_S8:
+        *(int8_t*)p = (int8_t)Scm_GetInteger8Clamp(n, SCM_CLAMP_NONE, &oor);
+        break;
+    case SCM_UVECTOR_U8:
+        *(uint8_t*)p = (uint8_t)Scm_GetIntegerU8Clamp(n, SCM_CLAMP_NONE, &oor);
+        break;
+    case SCM_UVECTOR_S16:
+        *(int16_t*)p = (int16_t)Scm_GetInteger16Clamp(n, SCM_CLAMP_NONE, &oor);
+        break;
+    case SCM_UVECTOR_U16:
+        *(uint16_t*)p = (uint16_t)Scm_GetIntegerU16Clamp(n, SCM_CLAMP_NONE,
+                                                         &oor);
+        break;
+    case SCM_UVECTOR_S32:
+        *(ScmInt32*)p = Scm_GetInteger32Clamp(n, SCM_CLAMP_NONE, &oor);
+        break;
+    case SCM_UVECTOR_U32:
+        *(ScmUInt32*)p = Scm_GetIntegerU32Clamp(n, SCM_CLAMP_NONE, &oor);
+        break;
+    case SCM_UVECTOR_S64:
+        *(ScmInt64*)p = Scm_GetInteger64Clamp(n, SCM_CLAMP_NONE, &oor);
+        break;
+    case SCM_UVECTOR_U64:
+        *(ScmUInt64*)p = Scm_GetIntegerU64Clamp(n, SCM_CLAMP_NONE, &oor);
+        break;
+    }
+    if (oor) {
+        col->count--;
+        bad_value(in, col, k, "value out of range");
+    }
+}
+
+static void store_field(csv_in *in, csv_column *col, int k)
+{
+    switch (col->kind) {
+    case COL_SKIP:
+        break;
+    case COL_STRING:
+        *(ScmObj*)column_push(col) = field_string(in, col->pool);
+        break;
+    case COL_SYMBOL:
+        *(ScmObj*)column_push(col) =
+            Scm_Intern(SCM_STRING(field_string(in, SCM_FALSE)));
+        break;
+    case COL_NUMBER:
+        *(ScmObj*)column_push(col) = field_number(in);
+        break;
+    case COL_UVECTOR:
+        store_uvector(in, col, k);
+        break;
+    }
+}
+
+ScmObj Scm__CsvReadColumns(ScmPort *port, ScmObj sep, ScmObj quo,
+                           ScmObj specs)
+{
+    ScmSmallInt ncols = Scm_Length(specs);
+    if (ncols < 0) Scm_Error("proper list required, but got: %S", specs);
+
+    csv_column *cols = SCM_NEW_ARRAY(csv_column, ncols);
+    int needed = 0;             /* # of fields required in each record */
+    ScmObj cp;
+    int k = 0;
+    SCM_FOR_EACH(cp, specs) {
+        column_init(&cols[k], SCM_CAR(cp));
+        if (cols[k].kind != COL_SKIP) needed = k+1;
+        k++;
+    }
+
+    csv_in in;
+    in_init(&in, port, sep, quo);
+    while (peekb(&in) != EOF) {
+        in.records++;
+        for (k = 0;; k++) {
+            int term = read_field(&in);
+            if (k < ncols) store_field(&in, &cols[k], k);
+            if (term == TERM_EOR) break;
+        }
+        if (k+1 < needed) {
+            sync_port(&in);
+            Scm_Error("record %ld has only %d field(s), but %d expected",
+                      in.records, k+1, needed);
+        }
+    }
+    sync_port(&in);
+
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    for (k = 0; k < ncols; k++) {
+        if (cols[k].kind == COL_SKIP) continue;
+        SCM_APPEND1(h, t, column_result(&cols[k]));
+    }
+    return h;
+}
+
+void Scm__InitCsvParser(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_CsvStringPoolClass, "<csv-string-pool>",
+                        mod, NULL, 0);
+}
@@ -0,0 +1,76 @@
+/*
+ * csv-parser.h - CSV tokenizer for text.csv-parser
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_TEXT_CSV_PARSER_H
+#define GAUCHE_TEXT_CSV_PARSER_H
+
+/* String pool.  Fields with the same content read through the same
+ * pool share one immutable string, which saves memory for columns
+ * with a small set of values.  Long fields are not pooled, and the
+ * pool stops growing at a certain size.
+ */
+typedef struct ScmCsvStringPoolRec {
+    SCM_HEADER;
+    ScmObj *entries;            /* open addressing table of strings */
+    ScmSmallInt size;           /* # of slots, power of 2 */
+    ScmSmallInt count;          /* # of strings */
+} ScmCsvStringPool;
+
+SCM_CLASS_DECL(Scm_CsvStringPoolClass);
+#define SCM_CLASS_CSV_STRING_POOL   (&Scm_CsvStringPoolClass)
+#define SCM_CSV_STRING_POOL(obj)    ((ScmCsvStringPool*)(obj))
+#define SCM_CSV_STRING_POOL_P(obj)  SCM_XTYPEP(obj, SCM_CLASS_CSV_STRING_POOL)
+
+extern ScmObj Scm__MakeCsvStringPool(void);
+
+/* Returns TRUE if CH can be a separator or a quote character for
+   the native reader.  It must be a single byte character that never
+   appears inside a multibyte character.  */
+extern int Scm__CsvNativeCharP(ScmObj ch);
+
+/* Reads one record from PORT and returns a list of fields, or EOF.
+   QUO may be #f for no quoting.  POOL is #f or a string pool.
+   Nothing after the newline that ends the record is consumed.  */
+extern ScmObj Scm__CsvReadRecord(ScmPort *port, ScmObj sep, ScmObj quo,
+                                 ScmObj pool);
+
+/* Reads all the records from PORT and returns a list of columns.
+   SPECS specifies how to store each field; see csv-read-columns
+   in text.csv. */
+extern ScmObj Scm__CsvReadColumns(ScmPort *port, ScmObj sep, ScmObj quo,
+                                  ScmObj specs);
+
+/* Called once at initialization. */
+extern void Scm__InitCsvParser(ScmModule *mod);
+
+#endif /* GAUCHE_TEXT_CSV_PARSER_H */
@@ -0,0 +1,63 @@
+;;;
+;;; text.csv-parser - CSV tokenizer
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; The native reader behind text.csv.  This module isn't meant to be
+;; used directly; the API may change.
+
+(define-module text.csv-parser
+  (export csv-native-char? make-csv-string-pool
+          csv-parse-record csv-parse-columns))
+(select-module text.csv-parser)
+
+(inline-stub
+ (declcode "#include \"csv-parser.h\"")
+ (initcode "Scm__InitCsvParser(Scm_CurrentModule());")
+
+ ;; Returns #t if CH can be a separator or a quote character of
+ ;; csv-parse-record and csv-parse-columns.
+ (define-cproc csv-native-char? (ch) ::<boolean>
+   (return (Scm__CsvNativeCharP ch)))
+
+ (define-cproc make-csv-string-pool ()
+   (return (Scm__MakeCsvStringPool)))
+
+ ;; Returns a list of fields, or EOF.  QUO can be #f.  POOL is #f or
+ ;; a string pool.
+ (define-cproc csv-parse-record (port::<input-port> sep quo
+                                 :optional (pool #f))
+   (return (Scm__CsvReadRecord port sep quo pool)))
+
+ ;; Reads records until EOF and returns a list of columns.
+ (define-cproc csv-parse-columns (port::<input-port> sep quo specs)
+   (return (Scm__CsvReadColumns port sep quo specs)))
+ )
@@ -0,0 +1,228 @@
+/*
+ * affinity.c - thread CPU affinity
+ *
+ *   Copyright (c) 2000-2015  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* We need _GNU_SOURCE for cpu_set_t and pthread_setaffinity_np on glibc.
+   It has to come before any system header, so we keep this stuff in its
+   own file instead of threads.c. */
+#define _GNU_SOURCE 1
+
+#include <gauche.h>
+#include <gauche/vm.h>
+#include "threads.h"
+
+#if defined(HAVE_SCHED_H)
+#include <sched.h>
+#endif
+
+/*=====================================================
+ * CPU affinity
+ *
+ *  An affinity is represented as a list of CPU numbers on the Scheme side.
+ *  For a thread that hasn't started, the requested set is kept in
+ *  vm->affinity and applied by the thread itself when it starts running
+ *  (Scm__ThreadApplyAffinity, called from thread_entry).  For a running
+ *  thread, it is applied immediately.
+ *
+ *  On platforms without the means, setting is silently ignored and
+ *  querying returns #f, since affinity is merely a hint to the scheduler.
+ */
+
+#if defined(GAUCHE_USE_PTHREADS) && defined(HAVE_PTHREAD_SETAFFINITY_NP)
+#define AFFINITY_PTHREADS 1
+#define AFFINITY_MAX_CPU  CPU_SETSIZE
+#elif defined(GAUCHE_USE_WTHREADS)
+#define AFFINITY_WTHREADS 1
+#define AFFINITY_MAX_CPU  ((int)(sizeof(DWORD_PTR)*8))
+#else
+#define AFFINITY_MAX_CPU  0
+#endif
+
+static void check_cpu_list(ScmObj cpus)
+{
+    ScmObj cp;
+    if (SCM_FALSEP(cpus)) return;
+    if (!SCM_PAIRP(cpus)) goto bad;
+    SCM_FOR_EACH(cp, cpus) {
+        ScmObj c = SCM_CAR(cp);
+        if (!SCM_INTP(c) || SCM_INT_VALUE(c) < 0) goto bad;
+    }
+    if (!SCM_NULLP(cp)) goto bad;
+    return;
+  bad:
+    Scm_Error("list of non-negative fixnums or #f required for CPU set, "
+              "but got: %S", cpus);
+}
+
+#if defined(AFFINITY_PTHREADS)
+/* If CPUS is #f, all CPUs are included. */
+static void list_to_cpuset(ScmObj cpus, cpu_set_t *set)
+{
+    CPU_ZERO(set);
+    if (SCM_FALSEP(cpus)) {
+        for (int i=0; i<CPU_SETSIZE; i++) CPU_SET(i, set);
+    } else {
+        ScmObj cp;
+        SCM_FOR_EACH(cp, cpus) {
+            long c = SCM_INT_VALUE(SCM_CAR(cp));
+            if (c < AFFINITY_MAX_CPU) CPU_SET(c, set);
+        }
+    }
+}
+
+static int set_affinity(pthread_t th, ScmObj cpus)
+{
+    cpu_set_t set;
+    list_to_cpuset(cpus, &set);
+    return pthread_setaffinity_np(th, sizeof(set), &set);
+}
+
+static ScmObj get_affinity(pthread_t th)
+{
+    cpu_set_t set;
+    if (pthread_getaffinity_np(th, sizeof(set), &set) != 0) return SCM_FALSE;
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    for (int i=0; i<CPU_SETSIZE; i++) {
+        if (CPU_ISSET(i, &set)) SCM_APPEND1(h, t, SCM_MAKE_INT(i));
+    }
+    return h;
+}
+#elif defined(AFFINITY_WTHREADS)
+static DWORD_PTR list_to_mask(ScmObj cpus)
+{
+    if (SCM_FALSEP(cpus)) {
+        DWORD_PTR pmask, smask;
+        if (GetProcessAffinityMask(GetCurrentProcess(), &pmask, &smask)) {
+            return pmask;
+        }
+        return ~(DWORD_PTR)0;
+    } else {
+        DWORD_PTR mask = 0;
+        ScmObj cp;
+        SCM_FOR_EACH(cp, cpus) {
+            long c = SCM_INT_VALUE(SCM_CAR(cp));
+            if (c < AFFINITY_MAX_CPU) mask |= ((DWORD_PTR)1) << c;
+        }
+        return mask;
+    }
+}
+
+static int set_affinity(HANDLE th, ScmObj cpus)
+{
+    return (SetThreadAffinityMask(th, list_to_mask(cpus)) == 0)? -1 : 0;
+}
+
+static ScmObj get_affinity(HANDLE th)
+{
+    /* Windows has no direct query; SetThreadAffinityMask returns the
+       previous mask, so we set it to the same value twice. */
+    DWORD_PTR pmask, smask;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &pmask, &smask)) {
+        return SCM_FALSE;
+    }
+    DWORD_PTR mask = SetThreadAffinityMask(th, pmask);
+    if (mask == 0) return SCM_FALSE;
+    SetThreadAffinityMask(th, mask);
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    for (int i=0; i<AFFINITY_MAX_CPU; i++) {
+        if (mask & (((DWORD_PTR)1) << i)) SCM_APPEND1(h, t, SCM_MAKE_INT(i));
+    }
+    return h;
+}
+#endif /*AFFINITY_WTHREADS*/
+
+/* CPUS is a list of CPU numbers, or #f to allow all CPUs. */
+ScmObj Scm_ThreadSetAffinity(ScmVM *vm, ScmObj cpus)
+{
+    int err_state = FALSE, err_set = FALSE;
+    check_cpu_list(cpus);
+    (void)SCM_INTERNAL_MUTEX_LOCK(vm->vmlock);
+    switch (vm->state) {
+    case SCM_VM_NEW:
+        vm->affinity = cpus;
+        break;
+    case SCM_VM_RUNNABLE:
+    case SCM_VM_STOPPED:
+        vm->affinity = cpus;
+#if defined(AFFINITY_PTHREADS) || defined(AFFINITY_WTHREADS)
+        if (set_affinity(vm->thread, cpus) != 0) err_set = TRUE;
+#endif
+        break;
+    default:
+        err_state = TRUE;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(vm->vmlock);
+    if (err_state) Scm_Error("thread already terminated: %S", vm);
+    if (err_set) Scm_SysError("setting CPU affinity of %S to %S failed",
+                              vm, cpus);
+    return SCM_UNDEFINED;
+}
+
+/* Returns the list of CPUs the thread can run on.  For a thread that
+   hasn't started, returns the requested set (#f if none is requested).
+   Returns #f if the information isn't available. */
+ScmObj Scm_ThreadAffinity(ScmVM *vm)
+{
+    ScmObj r = SCM_FALSE;
+    (void)SCM_INTERNAL_MUTEX_LOCK(vm->vmlock);
+    switch (vm->state) {
+    case SCM_VM_NEW:
+        r = vm->affinity;
+        break;
+    case SCM_VM_RUNNABLE:
+    case SCM_VM_STOPPED:
+#if defined(AFFINITY_PTHREADS) || defined(AFFINITY_WTHREADS)
+        r = get_affinity(vm->thread);
+#endif
+        break;
+    default:
+        break;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(vm->vmlock);
+    return r;
+}
+
+/* Called by the new thread itself before it runs the thunk.  A failure
+   here isn't fatal; the thread just runs wherever the OS puts it. */
+void Scm__ThreadApplyAffinity(ScmVM *vm)
+{
+    if (SCM_FALSEP(vm->affinity)) return;
+#if defined(AFFINITY_PTHREADS)
+    if (set_affinity(pthread_self(), vm->affinity) != 0) {
+        Scm_Warn("couldn't set CPU affinity of %S to %S", vm, vm->affinity);
+    }
+#elif defined(AFFINITY_WTHREADS)
+    if (set_affinity(GetCurrentThread(), vm->affinity) != 0) {
+        Scm_Warn("couldn't set CPU affinity of %S to %S", vm, vm->affinity);
+    }
+#endif
+}
@@ -0,0 +1,294 @@
+/*
+ * chash.c - concurrent hash table
+ *
+ *   Copyright (c) 2000-2015  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <gauche/class.h>
+#include <gauche/collection.h>
+#include "threads.h"
+
+/*=====================================================
+ * Concurrent hash table
+ *
+ *  The table is split into a power-of-two number of stripes, each of
+ *  which is an ordinary ScmHashCore guarded by its own internal mutex.
+ *  A key is assigned to a stripe by the upper bits of its hash value,
+ *  so threads accessing different keys rarely contend.
+ *
+ *  For eq?, eqv? and string=? tables no Scheme code runs while a stripe
+ *  is locked.  An equal? table may call object-equal? or object-hash
+ *  methods in a critical section; we install an unwind handler to
+ *  release the lock on errors in that case.  Those methods must not
+ *  access the same table, or they deadlock.
+ *
+ *  Operations that span the whole table (counting, listing, clearing)
+ *  visit the stripes one at a time, so they are not atomic with respect
+ *  to concurrent updates.
+ */
+
+static void chash_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx);
+
+SCM_DEFINE_BUILTIN_CLASS(Scm_ConcurrentHashTableClass,
+                         chash_print, NULL, NULL, NULL,
+                         SCM_CLASS_DICTIONARY_CPL);
+
+#define DEFAULT_NUM_STRIPES  16
+#define MAX_NUM_STRIPES      4096
+
+static void chash_finalize(ScmObj obj, void *data)
+{
+    ScmConcurrentHashTable *ht = SCM_CONCURRENT_HASH_TABLE(obj);
+    for (int i=0; i<ht->numStripes; i++) {
+        SCM_INTERNAL_MUTEX_DESTROY(ht->stripes[i].mutex);
+    }
+}
+
+ScmObj Scm_MakeConcurrentHashTable(ScmHashType type, int numStripes)
+{
+    ScmHashProc *hashfn;
+    ScmHashCompareProc *cmpfn;
+
+    if (type == SCM_HASH_GENERAL
+        || !Scm_HashCoreTypeToProcs(type, &hashfn, &cmpfn)) {
+        Scm_Error("[internal error] Scm_MakeConcurrentHashTable: "
+                  "unsupported type: %d", type);
+    }
+    if (numStripes <= 0) numStripes = DEFAULT_NUM_STRIPES;
+    if (numStripes > MAX_NUM_STRIPES) numStripes = MAX_NUM_STRIPES;
+
+    int log2 = 0;
+    while ((1 << log2) < numStripes) log2++;
+    numStripes = 1 << log2;
+
+    ScmConcurrentHashTable *ht = SCM_NEW(ScmConcurrentHashTable);
+    SCM_SET_CLASS(ht, SCM_CLASS_CONCURRENT_HASH_TABLE);
+    ht->type = type;
+    ht->hashfn = hashfn;
+    ht->numStripes = numStripes;
+    ht->numStripesLog2 = log2;
+    ht->stripes = SCM_NEW_ARRAY(ScmConcurrentHashStripe, numStripes);
+    for (int i=0; i<numStripes; i++) {
+        SCM_INTERNAL_MUTEX_INIT(ht->stripes[i].mutex);
+        Scm_HashCoreInitSimple(&ht->stripes[i].core, type, 0, NULL);
+    }
+    Scm_RegisterFinalizer(SCM_OBJ(ht), chash_finalize, NULL);
+    return SCM_OBJ(ht);
+}
+
+static ScmConcurrentHashStripe *chash_stripe(ScmConcurrentHashTable *ht,
+                                             ScmObj key)
+{
+    if (ht->type == SCM_HASH_STRING && !SCM_STRINGP(key)) {
+        /* Check it here, for the core would raise an error while we
+           hold the lock. */
+        Scm_Error("Got non-string key %S to the string hashtable.", key);
+    }
+    if (ht->numStripes == 1) return ht->stripes;
+    /* Fibonacci hashing; uses the upper bits of the product. */
+    uint32_t h = (uint32_t)ht->hashfn(&ht->stripes[0].core, (intptr_t)key);
+    h *= 0x9e3779b9U;
+    return &ht->stripes[h >> (32 - ht->numStripesLog2)];
+}
+
+enum {
+    CHASH_GET,
+    CHASH_PUT,
+    CHASH_DELETE,
+    CHASH_SWAP
+};
+
+typedef struct {
+    int op;
+    ScmObj key;
+    ScmObj value;
+    ScmObj expected;            /* CHASH_SWAP */
+    ScmObj absent;              /* CHASH_SWAP */
+    ScmObj result;
+} chash_request;
+
+/* Called with the stripe locked. */
+static void chash_run(ScmHashCore *core, chash_request *r)
+{
+    ScmDictEntry *e;
+
+    switch (r->op) {
+    case CHASH_GET:
+        e = Scm_HashCoreSearch(core, (intptr_t)r->key, SCM_DICT_GET);
+        r->result = e ? SCM_DICT_VALUE(e) : SCM_UNBOUND;
+        break;
+    case CHASH_PUT:
+        e = Scm_HashCoreSearch(core, (intptr_t)r->key, SCM_DICT_CREATE);
+        (void)SCM_DICT_SET_VALUE(e, r->value);
+        r->result = r->value;
+        break;
+    case CHASH_DELETE:
+        e = Scm_HashCoreSearch(core, (intptr_t)r->key, SCM_DICT_DELETE);
+        r->result = SCM_MAKE_BOOL(e != NULL);
+        break;
+    case CHASH_SWAP:
+        e = Scm_HashCoreSearch(core, (intptr_t)r->key, SCM_DICT_GET);
+        if ((e ? SCM_DICT_VALUE(e) : r->absent) != r->expected) {
+            r->result = SCM_FALSE;
+            break;
+        }
+        if (!e) e = Scm_HashCoreSearch(core, (intptr_t)r->key,
+                                       SCM_DICT_CREATE);
+        (void)SCM_DICT_SET_VALUE(e, r->value);
+        r->result = SCM_TRUE;
+        break;
+    }
+}
+
+static ScmObj chash_access(ScmConcurrentHashTable *ht, chash_request *r)
+{
+    ScmConcurrentHashStripe *s = chash_stripe(ht, r->key);
+
+    if (ht->type == SCM_HASH_EQUAL) {
+        (void)SCM_INTERNAL_MUTEX_LOCK(s->mutex);
+        SCM_UNWIND_PROTECT {
+            chash_run(&s->core, r);
+        }
+        SCM_WHEN_ERROR {
+            (void)SCM_INTERNAL_MUTEX_UNLOCK(s->mutex);
+            SCM_NEXT_HANDLER;
+        }
+        SCM_END_PROTECT;
+        (void)SCM_INTERNAL_MUTEX_UNLOCK(s->mutex);
+    } else {
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(s->mutex);
+        chash_run(&s->core, r);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    }
+    return r->result;
+}
+
+ScmObj Scm_ConcurrentHashTableRef(ScmConcurrentHashTable *ht,
+                                  ScmObj key, ScmObj fallback)
+{
+    chash_request r = { CHASH_GET, key, SCM_UNDEFINED,
+                        SCM_UNDEFINED, SCM_UNDEFINED, SCM_UNDEFINED };
+    ScmObj v = chash_access(ht, &r);
+    return SCM_UNBOUNDP(v) ? fallback : v;
+}
+
+ScmObj Scm_ConcurrentHashTableSet(ScmConcurrentHashTable *ht,
+                                  ScmObj key, ScmObj value)
+{
+    chash_request r = { CHASH_PUT, key, value,
+                        SCM_UNDEFINED, SCM_UNDEFINED, SCM_UNDEFINED };
+    return chash_access(ht, &r);
+}
+
+int Scm_ConcurrentHashTableDelete(ScmConcurrentHashTable *ht, ScmObj key)
+{
+    chash_request r = { CHASH_DELETE, key, SCM_UNDEFINED,
+                        SCM_UNDEFINED, SCM_UNDEFINED, SCM_UNDEFINED };
+    return !SCM_FALSEP(chash_access(ht, &r));
+}
+
+/* Atomically replaces the value of KEY with VALUE, if the current value
+   is EXPECTED (eq?).  If EXPECTED is ABSENT, the key must not be in the
+   table.  Returns TRUE if replaced. */
+int Scm_ConcurrentHashTableSwap(ScmConcurrentHashTable *ht, ScmObj key,
+                                ScmObj expected, ScmObj value, ScmObj absent)
+{
+    chash_request r = { CHASH_SWAP, key, value,
+                        expected, absent, SCM_UNDEFINED };
+    return !SCM_FALSEP(chash_access(ht, &r));
+}
+
+/* The following ones lock one stripe at a time.  They don't compare
+   keys, so no Scheme code runs in the critical section. */
+
+int Scm_ConcurrentHashTableNumEntries(ScmConcurrentHashTable *ht)
+{
+    int n = 0;
+    for (int i=0; i<ht->numStripes; i++) {
+        ScmConcurrentHashStripe *s = &ht->stripes[i];
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(s->mutex);
+        n += Scm_HashCoreNumEntries(&s->core);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    }
+    return n;
+}
+
+void Scm_ConcurrentHashTableClear(ScmConcurrentHashTable *ht)
+{
+    for (int i=0; i<ht->numStripes; i++) {
+        ScmConcurrentHashStripe *s = &ht->stripes[i];
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(s->mutex);
+        Scm_HashCoreClear(&s->core);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    }
+}
+
+/* Returns an alist of a snapshot of each stripe. */
+ScmObj Scm_ConcurrentHashTableToAlist(ScmConcurrentHashTable *ht)
+{
+    ScmObj r = SCM_NIL;
+    for (int i=0; i<ht->numStripes; i++) {
+        ScmConcurrentHashStripe *s = &ht->stripes[i];
+        ScmHashIter iter;
+        ScmDictEntry *e;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(s->mutex);
+        Scm_HashIterInit(&iter, &s->core);
+        while ((e = Scm_HashIterNext(&iter)) != NULL) {
+            r = Scm_Acons(SCM_DICT_KEY(e), SCM_DICT_VALUE(e), r);
+        }
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    }
+    return r;
+}
+
+static void chash_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    ScmConcurrentHashTable *ht = SCM_CONCURRENT_HASH_TABLE(obj);
+    const char *type = "?";
+    switch (ht->type) {
+    case SCM_HASH_EQ:     type = "eq?"; break;
+    case SCM_HASH_EQV:    type = "eqv?"; break;
+    case SCM_HASH_EQUAL:  type = "equal?"; break;
+    case SCM_HASH_STRING: type = "string=?"; break;
+    default: break;
+    }
+    Scm_Printf(port, "#<concurrent-hash-table %s %p>", type, ht);
+}
+
+/*
+ * Initialization
+ */
+
+void Scm_Init_chash(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_ConcurrentHashTableClass,
+                        "<concurrent-hash-table>", mod, NULL, 0);
+}
@@ -35,6 +35,7 @@
 #include <gauche.h>
 #include <gauche/class.h>
 #include <gauche/exception.h>
+#include <gauche/prof.h>
 #include "threads.h"
 
 /*=====================================================
@@ -69,6 +70,8 @@ static ScmObj mutex_allocate(ScmClass *klass, ScmObj initargs)
     mutex->specific = SCM_UNDEFINED;
     mutex->locked = FALSE;
     mutex->owner = NULL;
+    mutex->numWaiters = 0;
+    mutex->spinMax = mutex->spinAvg = 0;
     mutex->locker_proc = mutex->unlocker_proc = SCM_FALSE;
     return SCM_OBJ(mutex);
 }
@@ -162,6 +165,88 @@ ScmObj Scm_MakeMutex(ScmObj name)
     return m;
 }
 
+/*
+ * Spinning
+ *
+ *   Sleeping on the condition variable and being woken up costs a couple
+ *   of system calls and context switches, which is far more than
+ *   a critical section that only updates a few fields.  If spinMax > 0,
+ *   a locker that finds the mutex locked busy-waits for a while, hoping
+ *   the owner releases it soon, before it goes to sleep.
+ *
+ *   How long to spin is adapted to the actual hold time, as glibc's
+ *   PTHREAD_MUTEX_ADAPTIVE_NP does: we keep a running average of the
+ *   spins it took to see the mutex released, and spin at most twice
+ *   that (plus a bit), capped by spinMax.  If the mutex tends to be
+ *   held long, the average grows up to the cap and stays there; so
+ *   the cap should be small enough to not waste much CPU.
+ */
+
+#define MUTEX_DEFAULT_SPIN 100
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define CPU_RELAX()  __asm__ __volatile__("pause" ::: "memory")
+#else
+#define CPU_RELAX()  /*empty*/
+#endif
+
+void Scm_MutexSetSpin(ScmMutex *mutex, int spinMax)
+{
+    if (spinMax < 0) spinMax = MUTEX_DEFAULT_SPIN;
+    mutex->spinMax = spinMax;
+    mutex->spinAvg = 0;
+}
+
+/* Called without holding mutex->mutex.  We only peek the flag; the real
+   acquisition is done under mutex->mutex by the caller.  The update of
+   spinAvg is racy, which is harmless since it's only a hint. */
+static void mutex_spin(ScmMutex *mutex)
+{
+    int limit = mutex->spinAvg * 2 + 10;
+    if (limit > mutex->spinMax) limit = mutex->spinMax;
+    int n = 0;
+    while (n < limit && mutex->locked) {
+        CPU_RELAX();
+        n++;
+    }
+    mutex->spinAvg += (n - mutex->spinAvg) / 8;
+}
+
+/*
+ * Process-wide statistics of contended locking.  Only the lockers that
+ * find the mutex locked pay for the bookkeeping.
+ */
+
+static struct {
+    ScmInternalMutex mutex;
+    u_long   waits;             /* # of Scm_MutexLock that had to wait */
+    ScmInt64 waitTime;          /* cumulated waiting time, in ns */
+} mutex_stats;
+
+#ifdef GAUCHE_HAS_THREADS
+static void mutex_record_wait(ScmInt64 start)
+{
+    ScmInt64 t = Scm_MonotonicNanoseconds() - start;
+    (void)SCM_INTERNAL_MUTEX_LOCK(mutex_stats.mutex);
+    mutex_stats.waits++;
+    mutex_stats.waitTime += t;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(mutex_stats.mutex);
+}
+#endif /*GAUCHE_HAS_THREADS*/
+
+/* Returns ((:waits <count>) (:wait-time <seconds>)) */
+ScmObj Scm_MutexWaitStats(void)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(mutex_stats.mutex);
+    u_long waits = mutex_stats.waits;
+    ScmInt64 t = mutex_stats.waitTime;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(mutex_stats.mutex);
+    return SCM_LIST2(SCM_LIST2(SCM_MAKE_KEYWORD("waits"),
+                               Scm_MakeIntegerU(waits)),
+                     SCM_LIST2(SCM_MAKE_KEYWORD("wait-time"),
+                               Scm_MakeFlonum((double)t/1.0e9)));
+}
+
 /*
  * Lock and unlock mutex
  */
@@ -173,8 +258,17 @@ ScmObj Scm_MutexLock(ScmMutex *mutex, ScmObj timeout, ScmVM *owner)
     ScmObj r = SCM_TRUE;
     ScmVM *abandoned = NULL;
     int intr = FALSE;
+    ScmInt64 wait_start = 0, prof_start = 0;
 
     ScmTimeSpec *pts = Scm_GetTimeSpec(timeout, &ts);
+    if (mutex->locked) {
+        wait_start = Scm_MonotonicNanoseconds();
+        if (Scm__LockProfiling) {
+            Scm__LockProfilerWait(SCM_OBJ(mutex));
+            prof_start = wait_start;
+        }
+    }
+    if (mutex->spinMax > 0 && mutex->locked) mutex_spin(mutex);
     SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(mutex->mutex);
     while (mutex->locked) {
         if (mutex->owner && mutex->owner->state == SCM_VM_TERMINATED) {
@@ -182,12 +276,15 @@ ScmObj Scm_MutexLock(ScmMutex *mutex, ScmObj timeout, ScmVM *owner)
             mutex->locked = FALSE;
             break;
         }
+        mutex->numWaiters++;
         if (pts) {
             int tr = SCM_INTERNAL_COND_TIMEDWAIT(mutex->cv, mutex->mutex, pts);
+            mutex->numWaiters--;
             if (tr == SCM_INTERNAL_COND_TIMEDOUT) { r = SCM_FALSE; break; }
             else if (tr == SCM_INTERNAL_COND_INTR) { intr = TRUE; break; }
         } else {
             SCM_INTERNAL_COND_WAIT(mutex->cv, mutex->mutex);
+            mutex->numWaiters--;
         }
     }
     if (SCM_TRUEP(r)) {
@@ -195,6 +292,10 @@ ScmObj Scm_MutexLock(ScmMutex *mutex, ScmObj timeout, ScmVM *owner)
         mutex->owner = owner;
     }
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    if (wait_start) mutex_record_wait(wait_start);
+    if (prof_start || Scm__LockProfiling) {
+        Scm__LockProfilerAcquired(SCM_OBJ(mutex), prof_start, SCM_TRUEP(r));
+    }
     if (intr) Scm_SigCheck(Scm_VM());
     if (abandoned) {
         ScmObj exc = Scm_MakeThreadException(SCM_CLASS_ABANDONED_MUTEX_EXCEPTION, abandoned);
@@ -215,10 +316,12 @@ ScmObj Scm_MutexUnlock(ScmMutex *mutex, ScmConditionVariable *cv, ScmObj timeout
     int intr = FALSE;
 
     ScmTimeSpec *pts = Scm_GetTimeSpec(timeout, &ts);
+    /* Must be before releasing, or we may see the next holder's record. */
+    if (Scm__LockProfiling) Scm__LockProfilerReleased(SCM_OBJ(mutex));
     SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(mutex->mutex);
     mutex->locked = FALSE;
     mutex->owner = NULL;
-    SCM_INTERNAL_COND_SIGNAL(mutex->cv);
+    if (mutex->numWaiters > 0) SCM_INTERNAL_COND_SIGNAL(mutex->cv);
     if (cv) {
         if (pts) {
             int tr = SCM_INTERNAL_COND_TIMEDWAIT(cv->cv, mutex->mutex, pts);
@@ -354,6 +457,188 @@ ScmObj Scm_ConditionVariableBroadcast(ScmConditionVariable *cond)
     return SCM_UNDEFINED;
 }
 
+/*=====================================================
+ * Reader/writer lock
+ */
+
+static ScmObj rwlock_allocate(ScmClass *klass, ScmObj initargs);
+static void   rwlock_print(ScmObj rw, ScmPort *port, ScmWriteContext *ctx);
+
+SCM_DEFINE_BASE_CLASS(Scm_RWLockClass, ScmRWLock,
+                      rwlock_print, NULL, NULL, rwlock_allocate,
+                      default_cpl);
+
+static void rwlock_finalize(ScmObj obj, void *data)
+{
+    ScmRWLock *rw = SCM_RWLOCK(obj);
+    SCM_INTERNAL_MUTEX_DESTROY(rw->mutex);
+    SCM_INTERNAL_COND_DESTROY(rw->cond);
+}
+
+static ScmObj rwlock_allocate(ScmClass *klass, ScmObj initargs)
+{
+    ScmRWLock *rw = SCM_NEW_INSTANCE(ScmRWLock, klass);
+    SCM_INTERNAL_MUTEX_INIT(rw->mutex);
+    SCM_INTERNAL_COND_INIT(rw->cond);
+    Scm_RegisterFinalizer(SCM_OBJ(rw), rwlock_finalize, NULL);
+    rw->name = SCM_FALSE;
+    rw->specific = SCM_UNDEFINED;
+    rw->numReader = rw->numWriter = rw->numWaitingWriter = 0;
+    rw->writer = NULL;
+    return SCM_OBJ(rw);
+}
+
+static void rwlock_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    ScmRWLock *rw = SCM_RWLOCK(obj);
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(rw->mutex);
+    int nreaders = rw->numReader;
+    ScmVM *writer = rw->numWriter? rw->writer : NULL;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(rw->mutex);
+
+    if (SCM_FALSEP(rw->name)) Scm_Printf(port, "#<rwlock %p ", rw);
+    else                      Scm_Printf(port, "#<rwlock %S ", rw->name);
+    if (writer)              Scm_Printf(port, "write-locked by %S>", writer);
+    else if (nreaders > 0)   Scm_Printf(port, "read-locked (%d)>", nreaders);
+    else                     Scm_Printf(port, "unlocked>");
+}
+
+static ScmObj rwlock_name_get(ScmRWLock *rw)
+{
+    return rw->name;
+}
+
+static void rwlock_name_set(ScmRWLock *rw, ScmObj name)
+{
+    rw->name = name;
+}
+
+static ScmObj rwlock_specific_get(ScmRWLock *rw)
+{
+    return rw->specific;
+}
+
+static void rwlock_specific_set(ScmRWLock *rw, ScmObj value)
+{
+    rw->specific = value;
+}
+
+static ScmClassStaticSlotSpec rwlock_slots[] = {
+    SCM_CLASS_SLOT_SPEC("name", rwlock_name_get, rwlock_name_set),
+    SCM_CLASS_SLOT_SPEC("specific", rwlock_specific_get, rwlock_specific_set),
+    SCM_CLASS_SLOT_SPEC_END()
+};
+
+ScmObj Scm_MakeRWLock(ScmObj name)
+{
+    ScmObj rw = rwlock_allocate(SCM_CLASS_RWLOCK, SCM_NIL);
+    SCM_RWLOCK(rw)->name = name;
+    return rw;
+}
+
+/* Readers and writers share one condition variable.  A waiting writer
+   blocks new readers, so that a steady stream of readers can't starve
+   writers.  The flip side is that the lock isn't reentrant: a reader
+   that takes the read lock again while a writer is waiting deadlocks.
+
+   Returns #t if the lock is acquired, #f on timeout. */
+ScmObj Scm_RWLockReadLock(ScmRWLock *rw, ScmObj timeout)
+{
+    ScmObj r = SCM_TRUE;
+#ifdef GAUCHE_HAS_THREADS
+    ScmTimeSpec ts;
+
+    ScmTimeSpec *pts = Scm_GetTimeSpec(timeout, &ts);
+    for (;;) {
+        int intr = FALSE;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(rw->mutex);
+        while (rw->numWriter > 0 || rw->numWaitingWriter > 0) {
+            if (pts) {
+                int tr = SCM_INTERNAL_COND_TIMEDWAIT(rw->cond, rw->mutex, pts);
+                if (tr == SCM_INTERNAL_COND_TIMEDOUT) { r = SCM_FALSE; break; }
+                else if (tr == SCM_INTERNAL_COND_INTR) { intr = TRUE; break; }
+            } else {
+                SCM_INTERNAL_COND_WAIT(rw->cond, rw->mutex);
+            }
+        }
+        if (SCM_TRUEP(r) && !intr) rw->numReader++;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        if (!intr) break;
+        Scm_SigCheck(Scm_VM());
+    }
+#endif /* GAUCHE_HAS_THREADS */
+    return r;
+}
+
+void Scm_RWLockReadUnlock(ScmRWLock *rw)
+{
+#ifdef GAUCHE_HAS_THREADS
+    int bad = FALSE;
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(rw->mutex);
+    if (rw->numReader <= 0) {
+        bad = TRUE;
+    } else if (--rw->numReader == 0 && rw->numWaitingWriter > 0) {
+        SCM_INTERNAL_COND_BROADCAST(rw->cond);
+    }
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    if (bad) Scm_Error("rwlock is not read-locked: %S", SCM_OBJ(rw));
+#endif /* GAUCHE_HAS_THREADS */
+}
+
+ScmObj Scm_RWLockWriteLock(ScmRWLock *rw, ScmObj timeout)
+{
+    ScmObj r = SCM_TRUE;
+#ifdef GAUCHE_HAS_THREADS
+    ScmTimeSpec ts;
+
+    ScmTimeSpec *pts = Scm_GetTimeSpec(timeout, &ts);
+    for (;;) {
+        int intr = FALSE;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(rw->mutex);
+        rw->numWaitingWriter++;
+        while (rw->numWriter > 0 || rw->numReader > 0) {
+            if (pts) {
+                int tr = SCM_INTERNAL_COND_TIMEDWAIT(rw->cond, rw->mutex, pts);
+                if (tr == SCM_INTERNAL_COND_TIMEDOUT) { r = SCM_FALSE; break; }
+                else if (tr == SCM_INTERNAL_COND_INTR) { intr = TRUE; break; }
+            } else {
+                SCM_INTERNAL_COND_WAIT(rw->cond, rw->mutex);
+            }
+        }
+        rw->numWaitingWriter--;
+        if (SCM_TRUEP(r) && !intr) {
+            rw->numWriter = 1;
+            rw->writer = Scm_VM();
+        } else if (rw->numWaitingWriter == 0) {
+            /* Readers may have been held back only by us. */
+            SCM_INTERNAL_COND_BROADCAST(rw->cond);
+        }
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        if (!intr) break;
+        Scm_SigCheck(Scm_VM());
+    }
+#endif /* GAUCHE_HAS_THREADS */
+    return r;
+}
+
+void Scm_RWLockWriteUnlock(ScmRWLock *rw)
+{
+#ifdef GAUCHE_HAS_THREADS
+    int bad = FALSE;
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(rw->mutex);
+    if (rw->numWriter == 0) {
+        bad = TRUE;
+    } else {
+        rw->numWriter = 0;
+        rw->writer = NULL;
+        SCM_INTERNAL_COND_BROADCAST(rw->cond);
+    }
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    if (bad) Scm_Error("rwlock is not write-locked: %S", SCM_OBJ(rw));
+#endif /* GAUCHE_HAS_THREADS */
+}
+
 /*
  * Initialization
  */
@@ -363,6 +648,8 @@ void Scm_Init_mutex(ScmModule *mod)
     sym_not_owned     = SCM_INTERN("not-owned");
     sym_abandoned     = SCM_INTERN("abandoned");
     sym_not_abandoned = SCM_INTERN("not-abandoned");
+    SCM_INTERNAL_MUTEX_INIT(mutex_stats.mutex);
     Scm_InitStaticClass(&Scm_MutexClass, "<mutex>", mod, mutex_slots, 0);
     Scm_InitStaticClass(&Scm_ConditionVariableClass, "<condition-variable>", mod, cv_slots, 0);
+    Scm_InitStaticClass(&Scm_RWLockClass, "<rwlock>", mod, rwlock_slots, 0);
 }
@@ -75,6 +75,9 @@
                                    (make-time time-duration #e2e7 0)))
   )
 
+(test* "time-nanoseconds" #t
+       (>= (time-nanoseconds (thread-sleep! 0.02)) #e1.9e7))
+
 ;; thread stop and cont
 (let1 t1 (make-thread (^[] (while #t (sys-nanosleep #e5e8))))
   (test* "thread-status" 'new (thread-state t1))
@@ -112,6 +115,52 @@
          (thread-terminate! t1)
          (thread-state t1)))
 
+(test* "thread starts with a small stack" '(#t 10000)
+       (thread-join!
+        (thread-start!
+         (make-thread
+          (^[] (define (stack-size) (hash-table-get (vm-stats) 'stack-size))
+               (let1 s0 (stack-size)
+                 (let loop ([n 100000])
+                   (if (= n 0) 0 (+ 1 (loop (- n 1)))))
+                 (list (< s0 10000) (stack-size))))))))
+
+(test* "thread-recycle!" '(#f 1 #t #t 2 #f)
+       (let1 t (make-thread (^[] 1) 'old)
+         (thread-specific-set! t 'x)
+         (thread-start! t)
+         (let* ([r0 (thread-recycle! (make-thread (^[] 0)))] ;not started
+                [v (thread-join! t)]
+                [r1 (thread-recycle! t)]
+                [t2 (make-thread (^[] 2) 'new)])
+           (list r0 v r1 (eq? t t2)
+                 (thread-join! (thread-start! t2))
+                 (thread-specific t2)))))
+
+(test* "thread-recycle! repeatedly" (iota 100)
+       (map (^i (let1 t (thread-start! (make-thread (^[] i)))
+                  (begin0 (thread-join! t)
+                    (thread-recycle! t))))
+            (iota 100)))
+
+;; Affinity is a hint; on platforms that lack it thread-affinity returns #f
+;; for a running thread.
+(test* "thread-affinity (new thread)" '((0) #f)
+       (let ([t1 (make-thread (^[] #t) #f :affinity '(0))]
+             [t2 (make-thread (^[] #t))])
+         (list (thread-affinity t1) (thread-affinity t2))))
+
+(test* "thread-affinity (running thread)" #t
+       (let* ([cpus (thread-affinity (current-thread))]
+              [cpu (if cpus (car cpus) 0)]
+              [t (make-thread (^[] (thread-affinity (current-thread)))
+                              #f :affinity (list cpu))]
+              [r (thread-join! (thread-start! t))])
+         (or (not r) (equal? r (list cpu)))))
+
+(test* "thread-set-affinity! bad arg" (test-error)
+       (thread-set-affinity! (make-thread (^[] #t)) '(a b)))
+
 ;;---------------------------------------------------------------------
 (test-section "thread and error")
 
@@ -246,6 +295,114 @@
               (list r0 r1 (mutex-state m)))))
         ))
 
+(test* "spinning mutex" 4000
+       (let ([m (make-mutex 'spin #t)] [n 0] [ts '()])
+         (dotimes [k 4]
+           (push! ts (thread-start!
+                      (make-thread
+                       (^[] (dotimes [j 1000]
+                              (mutex-lock! m)
+                              (inc! n)
+                              (mutex-unlock! m)))))))
+         (for-each thread-join! ts)
+         n))
+
+(test* "spinning mutex timeout" #f
+       (let1 m (make-mutex 'spin 50)
+         (mutex-lock! m)
+         (thread-join! (thread-start!
+                        (make-thread (^[] (mutex-lock! m 0.01)))))))
+
+(test* "make-mutex bad spin" (test-error) (make-mutex 'spin 'x))
+
+(test* "mutex-wait-stats" '(#t #t)
+       (let* ([m (make-mutex)]
+              [s0 (mutex-wait-stats)])
+         (mutex-lock! m)
+         (let1 t (thread-start! (make-thread (^[] (mutex-lock! m)
+                                                  (mutex-unlock! m))))
+           (sys-nanosleep 10000000)
+           (mutex-unlock! m)
+           (thread-join! t))
+         (let1 s1 (mutex-wait-stats)
+           (define (delta key) (- (cadr (assq key s1)) (cadr (assq key s0))))
+           (list (> (delta :waits) 0) (> (delta :wait-time) 0)))))
+
+(test* "lock profiler" '(#t #t #t #t)
+       (let1 m (make-mutex 'lockprof)
+         (lock-profiler-reset)
+         (lock-profiler-start)
+         (mutex-lock! m)
+         (let1 t (thread-start! (make-thread (^[] (mutex-lock! m)
+                                                  (mutex-unlock! m))))
+           (sys-nanosleep 10000000)
+           (mutex-unlock! m)
+           (thread-join! t))
+         (lock-profiler-stop)
+         (let1 es (filter (^e (eq? (car e) m)) (lock-profiler-get-result))
+           (lock-profiler-reset)
+           (list (= (fold (^[e s] (+ (list-ref e 2) s)) 0 es) 2)
+                 (= (fold (^[e s] (+ (list-ref e 3) s)) 0 es) 1)
+                 (any (^e (> (list-ref e 4) 0)) es)
+                 (any (^e (> (list-ref e 6) 0)) es)))))
+
+(test* "lock profiler (stopped)" '()
+       (let1 m (make-mutex)
+         (mutex-lock! m)
+         (mutex-unlock! m)
+         (filter (^e (eq? (car e) m)) (lock-profiler-get-result))))
+
+;;---------------------------------------------------------------------
+(test-section "reader/writer locks")
+
+(test* "make-rwlock" '(#t foo)
+       (let1 rw (make-rwlock 'foo)
+         (list (rwlock? rw) (rwlock-name rw))))
+
+(test* "readers share the lock" '(#t #t)
+       (let1 rw (make-rwlock)
+         (rwlock-read-lock! rw)
+         (begin0
+          (list (thread-join!
+                 (thread-start!
+                  (make-thread (^[] (begin0 (rwlock-read-lock! rw 0.1)
+                                      (rwlock-read-unlock! rw))))))
+                (rwlock-read-lock! rw 0.1))
+          (rwlock-read-unlock! rw)
+          (rwlock-read-unlock! rw))))
+
+(test* "writer excludes others" '(#f #f)
+       (let1 rw (make-rwlock)
+         (rwlock-write-lock! rw)
+         (begin0
+          (thread-join!
+           (thread-start!
+            (make-thread (^[] (list (rwlock-read-lock! rw 0.01)
+                                    (rwlock-write-lock! rw 0.01))))))
+          (rwlock-write-unlock! rw))))
+
+(test* "unlocking unlocked rwlock" (test-error)
+       (rwlock-read-unlock! (make-rwlock)))
+(test* "unlocking unlocked rwlock" (test-error)
+       (rwlock-write-unlock! (make-rwlock)))
+
+(test* "readers and writers" '(0 2000)
+       (let ([rw (make-rwlock)] [a 0] [b 0] [bad 0] [ts '()])
+         (dotimes [k 4]
+           (push! ts (thread-start!
+                      (make-thread
+                       (^[] (dotimes [j 1000]
+                              (with-read-lock rw
+                                (^[] (unless (= a b) (inc! bad)))))))))
+           (when (even? k)
+             (push! ts (thread-start!
+                        (make-thread
+                         (^[] (dotimes [j 1000]
+                                (with-write-lock rw
+                                  (^[] (inc! a) (thread-yield!) (inc! b))))))))))
+         (for-each thread-join! ts)
+         (list bad a)))
+
 ;;---------------------------------------------------------------------
 (test-section "condition variables")
 
@@ -300,6 +457,24 @@
            (thread-join! tc)
            (reverse log))))
 
+;;---------------------------------------------------------------------
+(test-section "symbol interning")
+
+;; Many threads intern overlapping sets of fresh names at once.  Enough
+;; names are interned to make the symbol table grow in the middle.
+(test* "concurrent intern" #t
+       (let* ([names (map (^i (format "thread-test-sym-~a" i)) (iota 20000))]
+              [ts (map (^k (thread-start!
+                            (make-thread
+                             (^[] (if (even? k)
+                                    (map string->symbol names)
+                                    (reverse
+                                     (map string->symbol (reverse names))))))))
+                       (iota 8))]
+              [rs (map thread-join! ts)])
+         (and (every (^r (every eq? (car rs) r)) (cdr rs))
+              (every (^[s n] (eq? s (string->symbol n))) (car rs) names))))
+
 ;;---------------------------------------------------------------------
 (test-section "port access serialization")
 
@@ -504,6 +679,234 @@
          (for-each thread-join! ts)
          (atom-ref a)))
 
+;;---------------------------------------------------------------------
+(test-section "atomic boxes")
+
+(test* "atomic-box basic" '(#t #f a a b b c (c . c))
+       (let1 b (make-atomic-box 'a)
+         (list (atomic-box? b)
+               (atomic-fxbox? b)
+               (atomic-box-ref b)
+               (atomic-box-swap! b 'b)
+               (atomic-box-ref b)
+               (atomic-box-compare-and-swap! b 'b 'c)
+               (atomic-box-ref b)
+               (cons (atomic-box-compare-and-swap! b 'x 'y)
+                     (atomic-box-ref b)))))
+
+(test* "atomic-fxbox basic" '(#t 10 13 13 6 6 2 2 6 5 5 9)
+       (let1 b (make-atomic-fxbox 10)
+         (list (atomic-fxbox? b)
+               (atomic-fxbox+/fetch! b 3)
+               (atomic-fxbox-ref b)
+               (atomic-fxbox-/fetch! b 7)
+               (atomic-fxbox-ref b)
+               (atomic-fxbox-and/fetch! b 3)
+               (atomic-fxbox-ref b)
+               (atomic-fxbox-ior/fetch! b 4)
+               (atomic-fxbox-xor/fetch! b 3)
+               (atomic-fxbox-ref b)
+               (atomic-fxbox-compare-and-swap! b 5 9)
+               (atomic-fxbox-ref b))))
+
+(test* "atomic-fxbox negative" '(-5 -1)
+       (let1 b (make-atomic-fxbox -5)
+         (list (atomic-fxbox+/fetch! b 4) (atomic-fxbox-ref b))))
+
+(test* "atomic-fxbox type check" (test-error)
+       (atomic-fxbox-set! (make-atomic-fxbox 0) 'a))
+
+(test* "atomic-fxbox concurrent counting" 30000
+       (let ([b (make-atomic-fxbox 0)] [ts '()])
+         (dotimes [n 30]
+           (push! ts
+                  (thread-start!
+                   (make-thread
+                    (^[] (dotimes [m 1000] (atomic-fxbox+/fetch! b 1)))))))
+         (for-each thread-join! ts)
+         (atomic-fxbox-ref b)))
+
+(test* "atomic-box concurrent CAS push" (iota 3000)
+       (let ([b (make-atomic-box '())] [ts '()])
+         (dotimes [n 30]
+           (push! ts
+                  (thread-start!
+                   (make-thread
+                    (^[] (dotimes [m 100]
+                           (let1 v (+ (* n 100) m)
+                             (let loop ()
+                               (let1 old (atomic-box-ref b)
+                                 (unless (eq? (atomic-box-compare-and-swap!
+                                               b old (cons v old))
+                                              old)
+                                   (loop)))))))))))
+         (for-each thread-join! ts)
+         (sort (atomic-box-ref b))))
+
+;;---------------------------------------------------------------------
+(test-section "concurrent hash table")
+
+(use gauche.dictionary)
+
+(let ()
+  (define (basic type k1 k2)
+    (let1 ht (make-concurrent-hash-table type)
+      (concurrent-hash-table-put! ht k1 1)
+      (concurrent-hash-table-put! ht k2 2)
+      (list (concurrent-hash-table-get ht k1)
+            (concurrent-hash-table-get ht k2 #f)
+            (concurrent-hash-table-get ht 'nokey 'none)
+            (concurrent-hash-table-exists? ht k1)
+            (concurrent-hash-table-delete! ht k1)
+            (concurrent-hash-table-delete! ht k1)
+            (concurrent-hash-table-num-entries ht))))
+  (test* "eq?" '(1 2 none #t #t #f 1) (basic 'eq? 'a 'b))
+  (test* "eqv?" '(1 2 none #t #t #f 1)
+         (basic 'eqv? (expt 2 100) 1.5))
+  (test* "equal?" '(1 2 none #t #t #f 1)
+         (basic equal-comparator (list 1 2) (vector 3)))
+  (test* "string=?" '(1 2 none #t #t #f 1)
+         (basic 'string=? (string #\a) "b"))
+  )
+
+(test* "string=? key check" (test-error)
+       (concurrent-hash-table-put! (make-concurrent-hash-table 'string=?)
+                                   'a 1))
+(test* "missing key" (test-error)
+       (concurrent-hash-table-get (make-concurrent-hash-table) 'a))
+
+(test* "swap!" '(#t #f #t #f 3)
+       (let1 ht (make-concurrent-hash-table 'eqv? 4)
+         (list (concurrent-hash-table-swap! ht 1 1)
+               (concurrent-hash-table-swap! ht 1 2)
+               (concurrent-hash-table-swap! ht 1 3 1)
+               (concurrent-hash-table-swap! ht 1 4 1)
+               (concurrent-hash-table-get ht 1))))
+
+(test* "dictionary interface" '((a . 1) (b . 2) (c . 3))
+       (let1 ht (make-concurrent-hash-table)
+         (dict-put! ht 'a 1)
+         (dict-put! ht 'b 2)
+         (dict-put! ht 'c 2)
+         (dict-update! ht 'c (cut + <> 1))
+         (sort-by (dict->alist ht) car (^[a b] (string<? (x->string a)
+                                                         (x->string b))))))
+
+(test* "concurrent updates" '(4000 100)
+       (let ([ht (make-concurrent-hash-table 'eqv?)]
+             [ts '()])
+         (dotimes [n 4]
+           (push! ts
+                  (thread-start!
+                   (make-thread
+                    (^[] (dotimes [m 1000]
+                           (concurrent-hash-table-update!
+                            ht (modulo m 100) (pa$ + 1) 0)))))))
+         (for-each thread-join! ts)
+         (list (apply + (concurrent-hash-table-values ht))
+               (concurrent-hash-table-num-entries ht))))
+
+(test* "concurrent put! and delete!" 0
+       (let ([ht (make-concurrent-hash-table 'string=?)]
+             [ts '()])
+         (dotimes [n 4]
+           (push! ts
+                  (thread-start!
+                   (make-thread
+                    (^[] (dotimes [m 500]
+                           (let1 k (format "~a-~a" n m)
+                             (concurrent-hash-table-put! ht k m)
+                             (unless (eqv? (concurrent-hash-table-get ht k) m)
+                               (error "lost entry:" k))
+                             (concurrent-hash-table-delete! ht k))))))))
+         (for-each thread-join! ts)
+         (concurrent-hash-table-num-entries ht)))
+
+(test* "clear!" '(0 ())
+       (let1 ht (make-concurrent-hash-table)
+         (dotimes [n 100] (concurrent-hash-table-put! ht n n))
+         (concurrent-hash-table-clear! ht)
+         (list (concurrent-hash-table-num-entries ht)
+               (concurrent-hash-table-keys ht))))
+
+;;---------------------------------------------------------------------
+(test-section "work-stealing queue")
+
+(test* "non-worker push/take" '(#f a b #f)
+       (let1 q (make-work-stealing-queue 2)
+         (list (work-stealing-queue-worker-index q)
+               (begin (work-stealing-queue-push! q 'a)
+                      (work-stealing-queue-push! q 'b)
+                      (work-stealing-queue-try-take! q))
+               (work-stealing-queue-try-take! q)
+               (work-stealing-queue-try-take! q))))
+
+(test* "worker deque is LIFO" '(0 3 c b a #f)
+       (let1 q (make-work-stealing-queue 1)
+         (thread-join!
+          (thread-start!
+           (make-thread
+            (^[] (let1 i (work-stealing-queue-attach! q)
+                   (for-each (cut work-stealing-queue-push! q <>) '(a b c))
+                   (list i
+                         (work-stealing-queue-length q)
+                         (work-stealing-queue-try-take! q)
+                         (work-stealing-queue-try-take! q)
+                         (work-stealing-queue-try-take! q)
+                         (work-stealing-queue-try-take! q)))))))))
+
+(test* "stealing is FIFO" '(a b)
+       (let1 q (make-work-stealing-queue 2)
+         (thread-join!
+          (thread-start!
+           (make-thread
+            (^[] (work-stealing-queue-attach! q)
+                 (for-each (cut work-stealing-queue-push! q <>) '(a b c))))))
+         ;; the main thread isn't a worker; it steals from the top.
+         (list (work-stealing-queue-try-take! q)
+               (work-stealing-queue-try-take! q))))
+
+(test* "too many workers" (test-error)
+       (let1 q (make-work-stealing-queue 1)
+         (work-stealing-queue-attach! q)
+         (thread-join!
+          (thread-start!
+           (make-thread (^[] (work-stealing-queue-attach! q)))))))
+
+(test* "close and drain" '(#f (x y) 0 #t)
+       (let1 q (make-work-stealing-queue 2)
+         (work-stealing-queue-push! q 'x)
+         (work-stealing-queue-push! q 'y)
+         (work-stealing-queue-close! q)
+         (list (work-stealing-queue-push! q 'z)
+               (work-stealing-queue-drain! q)
+               (work-stealing-queue-length q)
+               (eof-object? (work-stealing-queue-take! q)))))
+
+(test* "recursive spawning" (- (expt 2 13) 1)
+       (let ([q (make-work-stealing-queue 4)]
+             [count (atom 0)])
+         (define (worker)
+           (work-stealing-queue-attach! q)
+           (let loop ()
+             (let1 d (work-stealing-queue-take! q)
+               (unless (eof-object? d)
+                 (atomic-update! count (cut + <> 1))
+                 (when (> d 0)
+                   (work-stealing-queue-push! q (- d 1))
+                   (work-stealing-queue-push! q (- d 1)))
+                 (loop)))))
+         (let1 ts (map (^_ (thread-start! (make-thread worker))) (iota 4))
+           (work-stealing-queue-push! q 12)
+           (let wait ()
+             (unless (and (zero? (work-stealing-queue-length q))
+                          (= (atom-ref count) (- (expt 2 13) 1)))
+               (sys-nanosleep #e1e7)
+               (wait)))
+           (work-stealing-queue-close! q)
+           (for-each thread-join! ts)
+           (atom-ref count))))
+
 ;;---------------------------------------------------------------------
 (test-section "threads and promise")
 
@@ -596,8 +999,57 @@
                         (make-mtqueue :max-length 0)
                         100 3)
 
+(test-producer-consumer "(lock-free, unbound queue length)"
+                        (make-mtqueue :lock-free #t)
+                        100 3)
+
+(test-producer-consumer "(lock-free, bound queue length)"
+                        (make-mtqueue :max-length 5 :lock-free #t)
+                        100 3)
+
+(test-producer-consumer "(lock-free, queue length 1)"
+                        (make-mtqueue :max-length 1 :lock-free #t)
+                        100 3)
+
+(test* "lock-free mtqueue, many producers and consumers" (iota 4000)
+       (let* ([q (make-mtqueue :max-length 16 :lock-free #t)]
+              [r (make-mtqueue :lock-free #t)]
+              [ps (map (^k (thread-start!
+                            (make-thread
+                             (^[] (dotimes [i 1000]
+                                    (enqueue/wait! q (+ (* k 1000) i)))))))
+                       (iota 4))]
+              [cs (map (^_ (thread-start!
+                            (make-thread
+                             (^[] (let loop ([x (dequeue/wait! q)])
+                                    (when x
+                                      (enqueue/wait! r x)
+                                      (loop (dequeue/wait! q))))))))
+                       (iota 4))])
+         (for-each thread-join! ps)
+         (dotimes [_ 4] (enqueue/wait! q #f))
+         (for-each thread-join! cs)
+         (sort (dequeue-all! r))))
+
+(test* "lock-free mtqueue waiting readers" 1
+       (let* ([q (make-mtqueue :lock-free #t)]
+              [t (thread-start! (make-thread (^[] (dequeue/wait! q))))])
+         (let loop ()
+           (when (zero? (mtqueue-num-waiting-readers q))
+             (sys-nanosleep #e1e6)
+             (loop)))
+         (begin0 (mtqueue-num-waiting-readers q)
+           (enqueue! q 'x)
+           (thread-join! t))))
+
 (test* "dequeue/wait! timeout" "timed out!"
        (dequeue/wait! (make-mtqueue) 0.01 "timed out!"))
+(test* "dequeue/wait! timeout (lock-free)" "timed out!"
+       (dequeue/wait! (make-mtqueue :lock-free #t) 0.01 "timed out!"))
+(test* "enqueue/wait! timeout (lock-free)" "timed out!"
+       (let1 q (make-mtqueue :max-length 1 :lock-free #t)
+         (enqueue! q 'a)
+         (enqueue/wait! q 'b 0.01 "timed out!")))
 (test* "enqueue/wait! timeout" "timed out!"
        (let1 q (make-mtqueue :max-length 1)
          (enqueue! q 'a)
@@ -650,5 +1102,68 @@
            (let1 r (list (dequeue/wait! qq) (dequeue/wait! qq))
              (list* r0 r1 r)))))
 
+;;---------------------------------------------------------------------
+(test-section "asynchronous logging")
+
+;; gauche.logger's async drain relies on threads and lock-free mtqueue.
+
+(use gauche.logger)
+
+(define (read-log-lines file)
+  (begin0 (call-with-input-file file port->string-list)
+    (sys-unlink file)))
+
+(when (file-exists? "test.o") (sys-unlink "test.o"))
+
+(test* "async log drain" (map (cut format "message ~a" <>) (iota 200))
+       (let1 d (make <async-log-drain> :path "test.o" :prefix ""
+                     :buffer-size 16)
+         (dotimes [i 200] (log-format d "message ~a" i))
+         (log-drain-flush d)
+         (begin0 (read-log-lines "test.o")
+           (log-drain-close d))))
+
+(test* "async log drain (drop)" 1000
+       (let1 d (make <async-log-drain> :path "test.o" :prefix ""
+                     :buffer-size 1 :overflow 'drop)
+         (dotimes [i 1000] (log-format d "message ~a" i))
+         (log-drain-close d)
+         (+ (length (read-log-lines "test.o"))
+            (log-drain-dropped-count d))))
+
+(test* "async log drain (after close)" '("a" "b")
+       (let1 d (make <async-log-drain> :path "test.o" :prefix "")
+         (log-format d "a")
+         (log-drain-close d)
+         (log-format d "b")
+         (read-log-lines "test.o")))
+
+(test* "async log drain (bad overflow)" (test-error)
+       (make <async-log-drain> :overflow 'wait))
+
+;;---------------------------------------------------------------------
+(test-section "profiling all threads")
+
+;; profiler isn't supported on Windows
+(cond-expand
+ [gauche.os.windows]
+ [else
+  (use gauche.vm.profiler)
+  (define (prof-work n) (if (= n 0) 0 (+ 1 (prof-work (- n 1)))))
+  (test* "profiler-start :all-threads" #t
+         (begin
+           (profiler-reset)
+           (profiler-start :all-threads #t :stack-depth 4)
+           (let1 ts (map (^i (thread-start!
+                              (make-thread
+                               (^[] (dotimes [j 100] (prof-work 1000))))))
+                         (iota 2))
+             (for-each thread-join! ts)
+             (profiler-stop)
+             (rlet1 r (let1 rs (profiler-get-thread-results)
+                        (every (^t (boolean (assq t rs))) ts))
+               (profiler-reset)))))
+  (test* "profiler after reset" #f (profiler-get-result))])
+
 (test-end)
 
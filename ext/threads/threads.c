@@ -83,14 +83,17 @@ static void thread_cleanup_inner(ScmVM *vm)
 }
 
 /* Called by pthread_cleanup mechanism.   After this, Scm_VM() won't return
-   a valid VM pointer.  */
+   a valid VM pointer.
+   We detach the VM before marking it terminated, so that once thread-join!
+   returns, this thread no longer touches the VM and it can be recycled
+   (see Scm_VMRecycle). */
 static void thread_cleanup(void *data)
 {
     ScmVM *vm = SCM_VM(data);
+    Scm_DetachVM(vm);
     SCM_INTERNAL_MUTEX_LOCK(vm->vmlock);
     thread_cleanup_inner(vm);
     SCM_INTERNAL_MUTEX_UNLOCK(vm->vmlock);
-    Scm_DetachVM(vm);
 }
 
 #if defined(GAUCHE_HAS_THREADS)
@@ -104,6 +107,7 @@ static SCM_INTERNAL_THREAD_PROC_RETTYPE thread_entry(void *data)
         thread_cleanup(vm);
     } else {
         SCM_INTERNAL_THREAD_CLEANUP_PUSH(thread_cleanup, vm);
+        Scm__ThreadApplyAffinity(vm);
         SCM_UNWIND_PROTECT {
             vm->result = Scm_ApplyRec(SCM_OBJ(vm->thunk), SCM_NIL);
         } SCM_WHEN_ERROR {
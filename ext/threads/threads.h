@@ -50,6 +50,9 @@ extern ScmObj Scm_ThreadStop(ScmVM *vm, ScmObj timeout, ScmObj timeoutval);
 extern ScmObj Scm_ThreadCont(ScmVM *vm);
 extern ScmObj Scm_ThreadSleep(ScmObj timeout);
 extern ScmObj Scm_ThreadTerminate(ScmVM *vm);
+extern ScmObj Scm_ThreadSetAffinity(ScmVM *vm, ScmObj cpus);
+extern ScmObj Scm_ThreadAffinity(ScmVM *vm);
+extern void   Scm__ThreadApplyAffinity(ScmVM *vm);
 
 /*---------------------------------------------------------
  * SYNCHRONIZATION DEVICES
@@ -84,6 +87,9 @@ ScmObj Scm_ConditionVariableBroadcast(ScmConditionVariable *cond);
  *    locked=TRUE   owner=NULL           locked/not-owned
  *    locked=TRUE   owner=active vm      locked/owned
  *    locked=TRUE   owner=terminated vm  unlocked/abandoned
+ *
+ *  If spinMax > 0, a thread that finds the mutex locked spins for
+ *  a while before sleeping on cv.  See mutex.c.
  */
 typedef struct ScmMutexRec {
     SCM_INSTANCE_HEADER;
@@ -91,8 +97,11 @@ typedef struct ScmMutexRec {
     ScmInternalCond  cv;
     ScmObj name;
     ScmObj specific;
-    int   locked;
+    volatile int locked;
     ScmVM *owner;              /* the thread who owns this lock; may be NULL */
+    int numWaiters;            /* # of threads sleeping on cv */
+    int spinMax;               /* upper bound of spinning; 0 to disable */
+    int spinAvg;               /* adaptive estimate of spins needed */
     ScmObj locker_proc;        /* subr thunk to lock this mutex */
     ScmObj unlocker_proc;      /* subr thunk to unlock this mutex */
 } ScmMutex;
@@ -103,22 +112,28 @@ SCM_CLASS_DECL(Scm_MutexClass);
 #define SCM_MUTEXP(obj)        SCM_XTYPEP(obj, SCM_CLASS_MUTEX)
 
 ScmObj Scm_MakeMutex(ScmObj name);
+void   Scm_MutexSetSpin(ScmMutex *mutex, int spinMax);
 ScmObj Scm_MutexLock(ScmMutex *mutex, ScmObj timeout, ScmVM *owner);
 ScmObj Scm_MutexUnlock(ScmMutex *mutex, ScmConditionVariable *cv, ScmObj timeout);
 ScmObj Scm_MutexLocker(ScmMutex *mutex);
 ScmObj Scm_MutexUnlocker(ScmMutex *mutex);
+ScmObj Scm_MutexWaitStats(void);
 
 /*
  * Scheme reader/writer lock.
+ *    Any number of readers, or one writer, can hold the lock.
+ *    Waiting writers have priority over new readers.
  */
 typedef struct ScmRWLockRec {
-    SCM_HEADER;
+    SCM_INSTANCE_HEADER;
     ScmInternalMutex mutex;
     ScmInternalCond cond;
     ScmObj name;
     ScmObj specific;
-    int numReader;
-    int numWriter;
+    int numReader;              /* # of readers holding the lock */
+    int numWriter;              /* 1 if a writer holds the lock */
+    int numWaitingWriter;       /* # of writers waiting for the lock */
+    ScmVM *writer;              /* the writer holding the lock */
 } ScmRWLock;
 
 SCM_CLASS_DECL(Scm_RWLockClass);
@@ -127,6 +142,94 @@ SCM_CLASS_DECL(Scm_RWLockClass);
 #define SCM_RWLOCKP(obj)       SCM_XTYPEP(obj, SCM_CLASS_RWLOCK)
 
 ScmObj Scm_MakeRWLock(ScmObj name);
+ScmObj Scm_RWLockReadLock(ScmRWLock *rw, ScmObj timeout);
+void   Scm_RWLockReadUnlock(ScmRWLock *rw);
+ScmObj Scm_RWLockWriteLock(ScmRWLock *rw, ScmObj timeout);
+void   Scm_RWLockWriteUnlock(ScmRWLock *rw);
+
+/*---------------------------------------------------------
+ * CONCURRENT HASH TABLE
+ *
+ *  A hash table that can be shared among threads without external
+ *  locking.  See chash.c for the details.
+ */
+
+typedef struct ScmConcurrentHashStripeRec {
+    ScmInternalMutex mutex;
+    ScmHashCore core;
+} ScmConcurrentHashStripe;
+
+typedef struct ScmConcurrentHashTableRec {
+    SCM_HEADER;
+    ScmHashType type;
+    ScmHashProc *hashfn;        /* to choose a stripe */
+    int numStripes;             /* power of 2 */
+    int numStripesLog2;
+    ScmConcurrentHashStripe *stripes;
+} ScmConcurrentHashTable;
+
+SCM_CLASS_DECL(Scm_ConcurrentHashTableClass);
+#define SCM_CLASS_CONCURRENT_HASH_TABLE  (&Scm_ConcurrentHashTableClass)
+#define SCM_CONCURRENT_HASH_TABLE(obj)   ((ScmConcurrentHashTable*)obj)
+#define SCM_CONCURRENT_HASH_TABLE_P(obj) \
+    SCM_XTYPEP(obj, SCM_CLASS_CONCURRENT_HASH_TABLE)
+
+ScmObj Scm_MakeConcurrentHashTable(ScmHashType type, int numStripes);
+ScmObj Scm_ConcurrentHashTableRef(ScmConcurrentHashTable *ht,
+                                  ScmObj key, ScmObj fallback);
+ScmObj Scm_ConcurrentHashTableSet(ScmConcurrentHashTable *ht,
+                                  ScmObj key, ScmObj value);
+int    Scm_ConcurrentHashTableDelete(ScmConcurrentHashTable *ht, ScmObj key);
+int    Scm_ConcurrentHashTableSwap(ScmConcurrentHashTable *ht, ScmObj key,
+                                   ScmObj expected, ScmObj value,
+                                   ScmObj absent);
+int    Scm_ConcurrentHashTableNumEntries(ScmConcurrentHashTable *ht);
+void   Scm_ConcurrentHashTableClear(ScmConcurrentHashTable *ht);
+ScmObj Scm_ConcurrentHashTableToAlist(ScmConcurrentHashTable *ht);
+
+/*---------------------------------------------------------
+ * WORK-STEALING QUEUE
+ *
+ *  A set of per-worker deques for a thread pool.  See wsqueue.c
+ *  for the details.
+ */
+
+typedef struct ScmWorkDequeRec {
+    ScmInternalMutex mutex;
+    ScmObj *buf;                /* ring buffer */
+    u_long mask;                /* capacity - 1; capacity is power of 2 */
+    u_long top;                 /* thieves take from here */
+    u_long bottom;              /* the owner pushes and pops here */
+    ScmVM *owner;               /* worker thread, or NULL */
+} ScmWorkDeque;
+
+typedef struct ScmWorkStealingQueueRec {
+    SCM_HEADER;
+    int numDeques;
+    ScmWorkDeque *deques;
+    ScmInternalMutex mutex;     /* protects the rest */
+    ScmInternalCond cv;         /* idle workers wait on this */
+    ScmObj head;                /* jobs pushed from non-worker threads */
+    ScmObj tail;
+    int numIdle;
+    int closed;
+    u_long stealHint;           /* where to start looking for a victim */
+} ScmWorkStealingQueue;
+
+SCM_CLASS_DECL(Scm_WorkStealingQueueClass);
+#define SCM_CLASS_WORK_STEALING_QUEUE  (&Scm_WorkStealingQueueClass)
+#define SCM_WORK_STEALING_QUEUE(obj)   ((ScmWorkStealingQueue*)obj)
+#define SCM_WORK_STEALING_QUEUE_P(obj) \
+    SCM_XTYPEP(obj, SCM_CLASS_WORK_STEALING_QUEUE)
+
+ScmObj Scm_MakeWorkStealingQueue(int numWorkers);
+int    Scm_WorkStealingQueueAttach(ScmWorkStealingQueue *q);
+int    Scm_WorkStealingQueueWorkerIndex(ScmWorkStealingQueue *q);
+int    Scm_WorkStealingQueuePush(ScmWorkStealingQueue *q, ScmObj job);
+ScmObj Scm_WorkStealingQueueTake(ScmWorkStealingQueue *q, int block);
+void   Scm_WorkStealingQueueClose(ScmWorkStealingQueue *q);
+int    Scm_WorkStealingQueueLength(ScmWorkStealingQueue *q);
+ScmObj Scm_WorkStealingQueueDrain(ScmWorkStealingQueue *q);
 
 
 #endif /*GAUCHE_THREADS_H*/
@@ -33,17 +33,25 @@
 
 (define-module gauche.threads
   (use gauche.record)
+  (use gauche.dictionary)
   (export gauche-thread-type
           current-thread                ;re-exporting the builtin
 
           thread? make-thread thread-name thread-specific-set! thread-specific
           thread-state thread-start! thread-yield! thread-sleep!
           thread-join! thread-terminate! thread-stop! thread-cont!
+          thread-recycle! thread-set-affinity! thread-affinity
 
           mutex? make-mutex mutex-name mutex-state
           mutex-specific-set! mutex-specific
           with-locking-mutex mutex-lock! mutex-unlock!
-          mutex-locker mutex-unlocker
+          mutex-locker mutex-unlocker mutex-wait-stats
+
+          <rwlock> rwlock? make-rwlock rwlock-name
+          rwlock-specific rwlock-specific-set!
+          rwlock-read-lock! rwlock-read-unlock!
+          rwlock-write-lock! rwlock-write-unlock!
+          with-read-lock with-write-lock
 
           condition-variable? make-condition-variable condition-variable-name
           condition-variable-specific condition-variable-specific-set!
@@ -53,7 +61,24 @@
           terminated-thread-exception? uncaught-exception?
           uncaught-exception-reason
 
-          atom atom? atom-ref atomic atomic-update!))
+          atom atom? atom-ref atomic atomic-update!
+
+          <concurrent-hash-table> make-concurrent-hash-table
+          concurrent-hash-table? concurrent-hash-table-type
+          concurrent-hash-table-comparator
+          concurrent-hash-table-get concurrent-hash-table-put!
+          concurrent-hash-table-exists? concurrent-hash-table-delete!
+          concurrent-hash-table-update! concurrent-hash-table-swap!
+          concurrent-hash-table-num-entries concurrent-hash-table-clear!
+          concurrent-hash-table-fold concurrent-hash-table-for-each
+          concurrent-hash-table-map concurrent-hash-table-keys
+          concurrent-hash-table-values concurrent-hash-table->alist
+
+          <work-stealing-queue> make-work-stealing-queue work-stealing-queue?
+          work-stealing-queue-attach! work-stealing-queue-worker-index
+          work-stealing-queue-push! work-stealing-queue-take!
+          work-stealing-queue-try-take! work-stealing-queue-close!
+          work-stealing-queue-length work-stealing-queue-drain!))
 (select-module gauche.threads)
 
 (inline-stub
@@ -61,11 +86,15 @@
 
  (declcode
   "extern void Scm_Init_mutex(ScmModule*);"
+  "extern void Scm_Init_chash(ScmModule*);"
+  "extern void Scm_Init_wsqueue(ScmModule*);"
   "extern void Scm_Init_threads(ScmModule*);")
 
  (initcode
   "Scm_Init_threads(Scm_CurrentModule());"
-  "Scm_Init_mutex(Scm_CurrentModule());"))
+  "Scm_Init_mutex(Scm_CurrentModule());"
+  "Scm_Init_chash(Scm_CurrentModule());"
+  "Scm_Init_wsqueue(Scm_CurrentModule());"))
 
 ;;===============================================================
 ;; System query
@@ -100,8 +129,9 @@
      (slot-ref thread 'specific))
    thread-specific-set!))
 
-(define (make-thread thunk :optional (name #f))
+(define (make-thread thunk :optional (name #f) :key (affinity #f))
   (rlet1 t (%make-thread thunk name)
+    (when affinity (thread-set-affinity! t affinity))
     ((with-module gauche.internal %vm-custom-error-reporter-set!) t (^e #f))))
 
 (inline-stub
@@ -132,6 +162,15 @@
    Scm_ThreadStop)
 
  (define-cproc thread-cont! (target::<thread>) Scm_ThreadCont)
+
+ ;; Gives a terminated thread's VM back for reuse by the next make-thread.
+ ;; The caller must not use THREAD afterwards.  See Scm_VMRecycle in vm.c.
+ (define-cproc thread-recycle! (target::<thread>) ::<boolean> Scm_VMRecycle)
+
+ ;; CPUS is a list of CPU numbers, or #f to allow any.  See affinity.c.
+ (define-cproc thread-set-affinity! (target::<thread> cpus) ::<void>
+   (Scm_ThreadSetAffinity target cpus))
+ (define-cproc thread-affinity (target::<thread>) Scm_ThreadAffinity)
  )
 
 ;;===============================================================
@@ -166,7 +205,17 @@
       (mutex-unlocker mutex)))
 
 (inline-stub
- (define-cproc make-mutex (:optional (name #f)) Scm_MakeMutex)
+ ;; SPIN is #f (sleep immediately when the mutex is locked), #t (spin
+ ;; adaptively with the default limit), or the maximum number of spins.
+ (define-cproc make-mutex (:optional (name #f) (spin #f))
+   (let* ([m (Scm_MakeMutex name)])
+     (cond [(SCM_TRUEP spin) (Scm_MutexSetSpin (SCM_MUTEX m) -1)]
+           [(and (SCM_INTP spin) (>= (SCM_INT_VALUE spin) 0))
+            (Scm_MutexSetSpin (SCM_MUTEX m)
+                              (cast int (SCM_INT_VALUE spin)))]
+           [(not (SCM_FALSEP spin))
+            (SCM_TYPE_ERROR spin "boolean or nonnegative fixnum")])
+     (return m)))
 
  (define-cise-stmt with-mutex
    [(_ mutex . form)
@@ -190,8 +239,57 @@
 
  (define-cproc mutex-locker (mutex::<mutex>) Scm_MutexLocker)
  (define-cproc mutex-unlocker (mutex::<mutex>) Scm_MutexUnlocker)
+ (define-cproc mutex-wait-stats () Scm_MutexWaitStats)
+ )
+
+;;===============================================================
+;; Reader/writer lock
+;;
+
+(define (rwlock? obj) (is-a? obj <rwlock>))
+
+(define (rwlock-name rw)
+  (check-arg rwlock? rw)
+  (slot-ref rw 'name))
+
+(define (rwlock-specific-set! rw value)
+  (check-arg rwlock? rw)
+  (slot-set! rw 'specific value))
+
+(define rwlock-specific
+  (getter-with-setter
+   (^[rw]
+     (check-arg rwlock? rw)
+     (slot-ref rw 'specific))
+   rwlock-specific-set!))
+
+(inline-stub
+ (define-type <rwlock> "ScmRWLock*" "rwlock" "SCM_RWLOCKP" "SCM_RWLOCK")
+
+ (define-cproc make-rwlock (:optional (name #f)) Scm_MakeRWLock)
+
+ (define-cproc rwlock-read-lock! (rw::<rwlock> :optional (timeout #f))
+   Scm_RWLockReadLock)
+ (define-cproc rwlock-read-unlock! (rw::<rwlock>) ::<void>
+   Scm_RWLockReadUnlock)
+ (define-cproc rwlock-write-lock! (rw::<rwlock> :optional (timeout #f))
+   Scm_RWLockWriteLock)
+ (define-cproc rwlock-write-unlock! (rw::<rwlock>) ::<void>
+   Scm_RWLockWriteUnlock)
  )
 
+(define-inline (with-read-lock rw thunk)
+  (dynamic-wind
+      (^[] (rwlock-read-lock! rw))
+      thunk
+      (^[] (rwlock-read-unlock! rw))))
+
+(define-inline (with-write-lock rw thunk)
+  (dynamic-wind
+      (^[] (rwlock-write-lock! rw))
+      thunk
+      (^[] (rwlock-write-unlock! rw))))
+
 ;;===============================================================
 ;; Condition variable
 ;;
@@ -290,3 +388,187 @@
 (define (atom-ref atom :optional (index 0) (timeout #f) (timeout-val #f))
   (unless (atom? atom) (error "atom required, but got:" atom))
   ((atom-applier atom) (^ xs (list-ref xs index)) timeout timeout-val))
+
+;;===============================================================
+;; Concurrent hash table
+;;
+
+(inline-stub
+ (define-type <concurrent-hash-table> "ScmConcurrentHashTable*"
+   "concurrent-hash-table"
+   "SCM_CONCURRENT_HASH_TABLE_P" "SCM_CONCURRENT_HASH_TABLE")
+
+ (define-cproc %make-concurrent-hash-table (type num-stripes::<fixnum>)
+   (let* ([t::ScmHashType SCM_HASH_EQ])
+     (cond [(SCM_EQ type 'eq?)      (set! t SCM_HASH_EQ)]
+           [(SCM_EQ type 'eqv?)     (set! t SCM_HASH_EQV)]
+           [(SCM_EQ type 'equal?)   (set! t SCM_HASH_EQUAL)]
+           [(SCM_EQ type 'string=?) (set! t SCM_HASH_STRING)]
+           [else (Scm_Error "unsupported concurrent hash table type: %S"
+                            type)])
+     (return (Scm_MakeConcurrentHashTable t num-stripes))))
+
+ (define-cproc concurrent-hash-table? (obj) ::<boolean>
+   SCM_CONCURRENT_HASH_TABLE_P)
+
+ (define-cproc concurrent-hash-table-type (ht::<concurrent-hash-table>)
+   (case (-> ht type)
+     [(SCM_HASH_EQ)     (return 'eq?)]
+     [(SCM_HASH_EQV)    (return 'eqv?)]
+     [(SCM_HASH_EQUAL)  (return 'equal?)]
+     [(SCM_HASH_STRING) (return 'string=?)]
+     [else (return '#f)]))
+
+ (define-cproc concurrent-hash-table-get (ht::<concurrent-hash-table> key
+                                          :optional fallback)
+   (let* ([v (Scm_ConcurrentHashTableRef ht key fallback)])
+     (when (SCM_UNBOUNDP v)
+       (Scm_Error "%S doesn't have an entry for key %S" ht key))
+     (return v)))
+
+ (define-cproc concurrent-hash-table-put! (ht::<concurrent-hash-table>
+                                           key value) ::<void>
+   (Scm_ConcurrentHashTableSet ht key value))
+
+ (define-cproc concurrent-hash-table-exists? (ht::<concurrent-hash-table> key)
+   ::<boolean>
+   (return (not (SCM_UNBOUNDP
+                 (Scm_ConcurrentHashTableRef ht key SCM_UNBOUND)))))
+
+ (define-cproc concurrent-hash-table-delete! (ht::<concurrent-hash-table> key)
+   ::<boolean> Scm_ConcurrentHashTableDelete)
+
+ (define-cproc %concurrent-hash-table-swap! (ht::<concurrent-hash-table>
+                                             key expected value absent)
+   ::<boolean> Scm_ConcurrentHashTableSwap)
+
+ (define-cproc concurrent-hash-table-num-entries (ht::<concurrent-hash-table>)
+   ::<int> Scm_ConcurrentHashTableNumEntries)
+
+ (define-cproc concurrent-hash-table-clear! (ht::<concurrent-hash-table>)
+   ::<void> Scm_ConcurrentHashTableClear)
+
+ (define-cproc concurrent-hash-table->alist (ht::<concurrent-hash-table>)
+   Scm_ConcurrentHashTableToAlist)
+ )
+
+;; The comparator argument can be one of the symbols eq?, eqv?, equal?
+;; or string=?, or the corresponding predefined comparator.
+(define (make-concurrent-hash-table :optional (comparator 'eq?)
+                                              (num-stripes 0))
+  (%make-concurrent-hash-table
+   (cond [(memq comparator '(eq? eqv? equal? string=?)) comparator]
+         [(eq? comparator eq-comparator) 'eq?]
+         [(eq? comparator eqv-comparator) 'eqv?]
+         [(eq? comparator equal-comparator) 'equal?]
+         [(eq? comparator string-comparator) 'string=?]
+         [else (error "make-concurrent-hash-table requires one of the \
+                       symbols eq?, eqv?, equal? or string=?, or the \
+                       corresponding comparator, but got:" comparator)])
+   num-stripes))
+
+(define (concurrent-hash-table-comparator ht)
+  (case (concurrent-hash-table-type ht)
+    [(eq?) eq-comparator]
+    [(eqv?) eqv-comparator]
+    [(equal?) equal-comparator]
+    [(string=?) string-comparator]))
+
+(define %absent (list 'absent))
+
+;; Sets the value of KEY to VALUE only if the current value is eq? to
+;; EXPECTED.  If EXPECTED is omitted, KEY must not be in the table.
+(define (concurrent-hash-table-swap! ht key value :optional (expected %absent))
+  (%concurrent-hash-table-swap! ht key expected value %absent))
+
+;; PROC is called without holding the lock, hence it may be called more
+;; than once if other threads update the same entry.  It must be free
+;; of side effects.
+(define (concurrent-hash-table-update! ht key proc :optional (fallback %absent))
+  (let loop ()
+    (let* ([cur (concurrent-hash-table-get ht key %absent)]
+           [new (proc (cond [(not (eq? cur %absent)) cur]
+                            [(not (eq? fallback %absent)) fallback]
+                            [else (errorf "~s doesn't have an entry for key ~s"
+                                          ht key)]))])
+      (if (%concurrent-hash-table-swap! ht key cur new %absent)
+        new
+        (loop)))))
+
+;; Iterators work on a snapshot, so PROC may modify the table.
+(define (concurrent-hash-table-fold ht kons knil)
+  (fold (^[kv seed] (kons (car kv) (cdr kv) seed))
+        knil (concurrent-hash-table->alist ht)))
+
+(define (concurrent-hash-table-for-each ht proc)
+  (for-each (^[kv] (proc (car kv) (cdr kv)))
+            (concurrent-hash-table->alist ht)))
+
+(define (concurrent-hash-table-map ht proc)
+  (map (^[kv] (proc (car kv) (cdr kv)))
+       (concurrent-hash-table->alist ht)))
+
+(define (concurrent-hash-table-keys ht)
+  (map car (concurrent-hash-table->alist ht)))
+
+(define (concurrent-hash-table-values ht)
+  (map cdr (concurrent-hash-table->alist ht)))
+
+(define-dict-interface <concurrent-hash-table>
+  :get        concurrent-hash-table-get
+  :put!       concurrent-hash-table-put!
+  :delete!    concurrent-hash-table-delete!
+  :clear!     concurrent-hash-table-clear!
+  :exists?    concurrent-hash-table-exists?
+  :fold       concurrent-hash-table-fold
+  :for-each   concurrent-hash-table-for-each
+  :map        concurrent-hash-table-map
+  :keys       concurrent-hash-table-keys
+  :values     concurrent-hash-table-values
+  :update!    concurrent-hash-table-update!
+  :->alist    concurrent-hash-table->alist
+  :comparator concurrent-hash-table-comparator)
+
+;;===============================================================
+;; Work-stealing queue
+;;
+
+;; This is a low-level scheduler used by control.thread-pool.  Each
+;; worker thread attaches itself to the queue to own a deque.
+(inline-stub
+ (define-type <work-stealing-queue> "ScmWorkStealingQueue*"
+   "work-stealing-queue"
+   "SCM_WORK_STEALING_QUEUE_P" "SCM_WORK_STEALING_QUEUE")
+
+ (define-cproc make-work-stealing-queue (num-workers::<fixnum>)
+   (return (Scm_MakeWorkStealingQueue num-workers)))
+
+ (define-cproc work-stealing-queue? (obj) ::<boolean>
+   SCM_WORK_STEALING_QUEUE_P)
+
+ (define-cproc work-stealing-queue-attach! (q::<work-stealing-queue>)
+   ::<int> Scm_WorkStealingQueueAttach)
+
+ ;; Returns #f if the calling thread isn't a worker of Q.
+ (define-cproc work-stealing-queue-worker-index (q::<work-stealing-queue>)
+   (let* ([i::int (Scm_WorkStealingQueueWorkerIndex q)])
+     (return (?: (< i 0) SCM_FALSE (SCM_MAKE_INT i)))))
+
+ (define-cproc work-stealing-queue-push! (q::<work-stealing-queue> job)
+   ::<boolean> Scm_WorkStealingQueuePush)
+
+ (define-cproc work-stealing-queue-take! (q::<work-stealing-queue>)
+   (return (Scm_WorkStealingQueueTake q TRUE)))
+
+ (define-cproc work-stealing-queue-try-take! (q::<work-stealing-queue>)
+   (return (Scm_WorkStealingQueueTake q FALSE)))
+
+ (define-cproc work-stealing-queue-close! (q::<work-stealing-queue>)
+   ::<void> Scm_WorkStealingQueueClose)
+
+ (define-cproc work-stealing-queue-length (q::<work-stealing-queue>)
+   ::<int> Scm_WorkStealingQueueLength)
+
+ (define-cproc work-stealing-queue-drain! (q::<work-stealing-queue>)
+   Scm_WorkStealingQueueDrain)
+ )
@@ -0,0 +1,382 @@
+/*
+ * wsqueue.c - work-stealing queue
+ *
+ *   Copyright (c) 2000-2015  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <gauche/class.h>
+#include "threads.h"
+
+/*=====================================================
+ * Work-stealing queue
+ *
+ *  This is the scheduler of control.thread-pool's work-stealing pool.
+ *  Each worker thread owns a deque.  A job pushed by a worker goes to
+ *  the bottom of its own deque, and the worker takes jobs from the
+ *  bottom (LIFO), so that a recursive computation runs depth-first
+ *  and its data stays in the cache.  When its deque is empty, the
+ *  worker takes a job from the shared queue of jobs pushed from
+ *  non-worker threads, and then tries to steal from the top (the
+ *  oldest end) of other workers' deques.
+ *
+ *  Each deque is guarded by its own mutex; the owner and a thief
+ *  contend only when the thief actually steals from the deque.  The
+ *  queue-wide mutex is only used for the shared queue and for idle
+ *  workers to sleep.
+ *
+ *  A worker going idle increments numIdle and then rescans all the
+ *  deques while holding the queue-wide mutex.  A worker pushing a job
+ *  reads numIdle within the deque's critical section, and wakes up an
+ *  idle worker if it is positive.  Since either the pusher's critical
+ *  section comes after the scanner's, and thus it sees the updated
+ *  numIdle, or the scanner sees the pushed job, no wakeup is lost.
+ *  Lock order is always the queue-wide mutex, then a deque's.
+ *
+ *  Once the queue is closed, non-worker threads can no longer push,
+ *  but workers still can, so that a job being run can fork and join
+ *  subjobs.  A worker gets EOF only after the queue is closed and
+ *  no jobs are left.
+ */
+
+static void wsq_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx);
+
+SCM_DEFINE_BUILTIN_CLASS(Scm_WorkStealingQueueClass,
+                         wsq_print, NULL, NULL, NULL,
+                         SCM_CLASS_DEFAULT_CPL);
+
+#define INITIAL_DEQUE_SIZE  64
+#define MAX_NUM_WORKERS     1024
+
+static void wsq_finalize(ScmObj obj, void *data)
+{
+    ScmWorkStealingQueue *q = SCM_WORK_STEALING_QUEUE(obj);
+    for (int i=0; i<q->numDeques; i++) {
+        SCM_INTERNAL_MUTEX_DESTROY(q->deques[i].mutex);
+    }
+    SCM_INTERNAL_MUTEX_DESTROY(q->mutex);
+    SCM_INTERNAL_COND_DESTROY(q->cv);
+}
+
+ScmObj Scm_MakeWorkStealingQueue(int numWorkers)
+{
+    if (numWorkers <= 0 || numWorkers > MAX_NUM_WORKERS) {
+        Scm_Error("number of workers out of range: %d", numWorkers);
+    }
+    ScmWorkStealingQueue *q = SCM_NEW(ScmWorkStealingQueue);
+    SCM_SET_CLASS(q, SCM_CLASS_WORK_STEALING_QUEUE);
+    q->numDeques = numWorkers;
+    q->deques = SCM_NEW_ARRAY(ScmWorkDeque, numWorkers);
+    for (int i=0; i<numWorkers; i++) {
+        ScmWorkDeque *d = &q->deques[i];
+        SCM_INTERNAL_MUTEX_INIT(d->mutex);
+        d->buf = SCM_NEW_ARRAY(ScmObj, INITIAL_DEQUE_SIZE);
+        d->mask = INITIAL_DEQUE_SIZE - 1;
+        d->top = d->bottom = 0;
+        d->owner = NULL;
+    }
+    SCM_INTERNAL_MUTEX_INIT(q->mutex);
+    SCM_INTERNAL_COND_INIT(q->cv);
+    q->head = q->tail = SCM_NIL;
+    q->numIdle = 0;
+    q->closed = FALSE;
+    q->stealHint = 0;
+    Scm_RegisterFinalizer(SCM_OBJ(q), wsq_finalize, NULL);
+    return SCM_OBJ(q);
+}
+
+/*
+ * Deque operations.  They must be called with the deque locked.
+ */
+
+static void deque_push(ScmWorkDeque *d, ScmObj job)
+{
+    u_long size = d->bottom - d->top;
+    if (size > d->mask) {
+        /* full; double the buffer */
+        u_long newcap = (d->mask + 1) * 2;
+        ScmObj *nbuf = SCM_NEW_ARRAY(ScmObj, newcap);
+        for (u_long i=0; i<size; i++) {
+            nbuf[i] = d->buf[(d->top + i) & d->mask];
+        }
+        d->buf = nbuf;
+        d->mask = newcap - 1;
+        d->top = 0;
+        d->bottom = size;
+    }
+    d->buf[d->bottom & d->mask] = job;
+    d->bottom++;
+}
+
+static ScmObj deque_pop(ScmWorkDeque *d)
+{
+    if (d->bottom == d->top) return SCM_FALSE;
+    d->bottom--;
+    ScmObj job = d->buf[d->bottom & d->mask];
+    d->buf[d->bottom & d->mask] = SCM_FALSE; /* for GC */
+    return job;
+}
+
+static ScmObj deque_steal(ScmWorkDeque *d)
+{
+    if (d->bottom == d->top) return SCM_FALSE;
+    ScmObj job = d->buf[d->top & d->mask];
+    d->buf[d->top & d->mask] = SCM_FALSE; /* for GC */
+    d->top++;
+    return job;
+}
+
+/* Registers the calling thread as a worker, and returns the index of
+   its deque. */
+int Scm_WorkStealingQueueAttach(ScmWorkStealingQueue *q)
+{
+    ScmVM *vm = Scm_VM();
+    int index = -1;
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+    for (int i=0; i<q->numDeques; i++) {
+        if (q->deques[i].owner == vm) { index = i; break; }
+        if (q->deques[i].owner == NULL && index < 0) index = i;
+    }
+    if (index >= 0) q->deques[index].owner = vm;
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    if (index < 0) {
+        Scm_Error("all the deques of %S are already taken", SCM_OBJ(q));
+    }
+    return index;
+}
+
+/* Returns the deque index of the calling thread, or -1 if it isn't
+   a worker.  Owner fields are only written once by Attach, so we
+   don't need a lock. */
+int Scm_WorkStealingQueueWorkerIndex(ScmWorkStealingQueue *q)
+{
+    ScmVM *vm = Scm_VM();
+    for (int i=0; i<q->numDeques; i++) {
+        if (q->deques[i].owner == vm) return i;
+    }
+    return -1;
+}
+
+/* Returns FALSE if the queue is closed and the caller isn't a worker.
+   We use #f to indicate an empty deque, so JOB can't be #f. */
+int Scm_WorkStealingQueuePush(ScmWorkStealingQueue *q, ScmObj job)
+{
+    int w = Scm_WorkStealingQueueWorkerIndex(q);
+    int rejected = FALSE;
+
+    if (SCM_FALSEP(job)) Scm_Error("can't push #f to %S", SCM_OBJ(q));
+
+    if (w >= 0) {
+        ScmWorkDeque *d = &q->deques[w];
+        int idle;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(d->mutex);
+        deque_push(d, job);
+        idle = q->numIdle;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        if (idle > 0) {
+            SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+            SCM_INTERNAL_COND_SIGNAL(q->cv);
+            SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        }
+    } else {
+        ScmObj cell = Scm_Cons(job, SCM_NIL);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+        if (q->closed) {
+            rejected = TRUE;
+        } else {
+            if (SCM_NULLP(q->head)) {
+                q->head = q->tail = cell;
+            } else {
+                SCM_SET_CDR(q->tail, cell);
+                q->tail = cell;
+            }
+            if (q->numIdle > 0) SCM_INTERNAL_COND_SIGNAL(q->cv);
+        }
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    }
+    return !rejected;
+}
+
+/* Must be called with q->mutex locked. */
+static ScmObj shared_pop(ScmWorkStealingQueue *q)
+{
+    if (SCM_NULLP(q->head)) return SCM_FALSE;
+    ScmObj job = SCM_CAR(q->head);
+    q->head = SCM_CDR(q->head);
+    if (SCM_NULLP(q->head)) q->tail = SCM_NIL;
+    return job;
+}
+
+/* Try to get a job without waiting.  W is the caller's deque index, or
+   -1.  Returns #f if there's no job. */
+static ScmObj wsq_try_take(ScmWorkStealingQueue *q, int w)
+{
+    ScmObj job = SCM_FALSE;
+
+    if (w >= 0) {
+        ScmWorkDeque *d = &q->deques[w];
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(d->mutex);
+        job = deque_pop(d);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        if (!SCM_FALSEP(job)) return job;
+    }
+
+    if (!SCM_NULLP(q->head)) {  /* racy check to avoid locking */
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+        job = shared_pop(q);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        if (!SCM_FALSEP(job)) return job;
+    }
+
+    /* Steal.  We start from different victims each time to spread
+       the thieves.  The hint is updated without lock; it's just a
+       hint. */
+    int n = q->numDeques;
+    u_long start = q->stealHint++;
+    for (int k=0; k<n; k++) {
+        int v = (int)((start + k) % n);
+        if (v == w) continue;
+        ScmWorkDeque *d = &q->deques[v];
+        if (d->bottom == d->top) continue;  /* racy check */
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(d->mutex);
+        job = deque_steal(d);
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        if (!SCM_FALSEP(job)) return job;
+    }
+    return SCM_FALSE;
+}
+
+/* Must be called with q->mutex locked. */
+static int wsq_empty_p(ScmWorkStealingQueue *q)
+{
+    if (!SCM_NULLP(q->head)) return FALSE;
+    for (int i=0; i<q->numDeques; i++) {
+        ScmWorkDeque *d = &q->deques[i];
+        int empty;
+        (void)SCM_INTERNAL_MUTEX_LOCK(d->mutex);
+        empty = (d->bottom == d->top);
+        (void)SCM_INTERNAL_MUTEX_UNLOCK(d->mutex);
+        if (!empty) return FALSE;
+    }
+    return TRUE;
+}
+
+/* Returns a job.  If there's none and BLOCK is true, waits until one
+   becomes available, or returns EOF if the queue is closed.  If BLOCK
+   is false, returns #f when there's no job. */
+ScmObj Scm_WorkStealingQueueTake(ScmWorkStealingQueue *q, int block)
+{
+    int w = Scm_WorkStealingQueueWorkerIndex(q);
+
+    for (;;) {
+        ScmObj job = wsq_try_take(q, w);
+        if (!SCM_FALSEP(job)) return job;
+        if (!block) return SCM_FALSE;
+#if defined(GAUCHE_HAS_THREADS)
+        int finished = FALSE;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+        q->numIdle++;
+        for (;;) {
+            if (!wsq_empty_p(q)) break;
+            if (q->closed) { finished = TRUE; break; }
+            SCM_INTERNAL_COND_WAIT(q->cv, q->mutex);
+        }
+        q->numIdle--;
+        SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+        if (finished) return SCM_EOF;
+#else  /*!GAUCHE_HAS_THREADS*/
+        /* Nobody else can push a job. */
+        return SCM_EOF;
+#endif /*!GAUCHE_HAS_THREADS*/
+    }
+}
+
+void Scm_WorkStealingQueueClose(ScmWorkStealingQueue *q)
+{
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+    q->closed = TRUE;
+    SCM_INTERNAL_COND_BROADCAST(q->cv);
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+}
+
+/* The number of jobs waiting to be taken.  Deques are visited one by
+   one, so it's a snapshot only when no other thread pushes. */
+int Scm_WorkStealingQueueLength(ScmWorkStealingQueue *q)
+{
+    int n;
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+    n = Scm_Length(q->head);
+    for (int i=0; i<q->numDeques; i++) {
+        ScmWorkDeque *d = &q->deques[i];
+        (void)SCM_INTERNAL_MUTEX_LOCK(d->mutex);
+        n += (int)(d->bottom - d->top);
+        (void)SCM_INTERNAL_MUTEX_UNLOCK(d->mutex);
+    }
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    return n;
+}
+
+/* Removes all the waiting jobs and returns them as a list. */
+ScmObj Scm_WorkStealingQueueDrain(ScmWorkStealingQueue *q)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(q->mutex);
+    ScmObj job;
+    while (!SCM_FALSEP(job = shared_pop(q))) {
+        SCM_APPEND1(h, t, job);
+    }
+    for (int i=0; i<q->numDeques; i++) {
+        ScmWorkDeque *d = &q->deques[i];
+        (void)SCM_INTERNAL_MUTEX_LOCK(d->mutex);
+        while (!SCM_FALSEP(job = deque_steal(d))) {
+            SCM_APPEND1(h, t, job);
+        }
+        (void)SCM_INTERNAL_MUTEX_UNLOCK(d->mutex);
+    }
+    SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
+    return h;
+}
+
+static void wsq_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    ScmWorkStealingQueue *q = SCM_WORK_STEALING_QUEUE(obj);
+    Scm_Printf(port, "#<work-stealing-queue %d%s %p>", q->numDeques,
+               (q->closed ? " closed" : ""), q);
+}
+
+/*
+ * Initialization
+ */
+
+void Scm_Init_wsqueue(ScmModule *mod)
+{
+    Scm_InitStaticClass(&Scm_WorkStealingQueueClass,
+                        "<work-stealing-queue>", mod, NULL, 0);
+}
@@ -44,6 +44,10 @@
 #if defined(GAUCHE_USE_AXTLS)
 #include "axTLS/ssl/ssl.h"
 #else /*!GAUCHE_USE_AXTLS*/
+#if defined(GAUCHE_USE_OPENSSL)
+#include <openssl/ssl.h>
+#endif /*GAUCHE_USE_OPENSSL*/
+/* We keep axTLS option values as our API, even with OpenSSL. */
 #define SSL_CLIENT_AUTHENTICATION               0x00010000
 #define SSL_SERVER_VERIFY_LATER                 0x00020000
 #define SSL_NO_DEFAULT_KEY                      0x00040000
@@ -61,13 +65,22 @@
 
 SCM_DECL_BEGIN
 
+/* Both axTLS and OpenSSL name their context and connection types
+   SSL_CTX and SSL. */
+#if defined(GAUCHE_USE_AXTLS) || defined(GAUCHE_USE_OPENSSL)
+#define GAUCHE_TLS_ENABLED 1
+#endif
+
 typedef struct ScmTLSRec {
   SCM_HEADER;
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
   SSL_CTX* ctx;
   SSL* conn;
   ScmPort* in_port, * out_port;
-#endif /*GAUCHE_USE_AXTLS*/
+  uint32_t options;
+  ScmObj session;               /* <tls-session> to resume, or #f */
+  ScmObj server_name;           /* host name for SNI, or #f */
+#endif /*GAUCHE_TLS_ENABLED*/
 } ScmTLS;
 
 SCM_CLASS_DECL(Scm_TLSClass);
@@ -76,6 +89,23 @@ SCM_CLASS_DECL(Scm_TLSClass);
 #define SCM_TLS(obj)    ((ScmTLS*)obj)
 #define SCM_TLSP(obj)   SCM_XTYPEP(obj, SCM_CLASS_TLS)
 
+/* A session saved from a client connection, to be resumed by a later
+   connection to the same server.  Only the OpenSSL backend supports it;
+   axTLS keeps the session's master secret in the context, which we
+   don't share between connections. */
+typedef struct ScmTLSSessionRec {
+  SCM_HEADER;
+#if defined(GAUCHE_USE_OPENSSL)
+  SSL_SESSION* session;
+#endif /*GAUCHE_USE_OPENSSL*/
+} ScmTLSSession;
+
+SCM_CLASS_DECL(Scm_TLSSessionClass);
+
+#define SCM_CLASS_TLS_SESSION   (&Scm_TLSSessionClass)
+#define SCM_TLS_SESSION(obj)    ((ScmTLSSession*)obj)
+#define SCM_TLS_SESSION_P(obj)  SCM_XTYPEP(obj, SCM_CLASS_TLS_SESSION)
+
 extern ScmObj Scm_MakeTLS(uint32_t options, int num_sessions);
 extern ScmObj Scm_TLSDestroy(ScmTLS* t);
 extern ScmObj Scm_TLSLoadObject(ScmTLS* t, ScmObj obj_type,
@@ -85,6 +115,11 @@ extern ScmObj Scm_TLSConnect(ScmTLS* t, int fd);
 extern ScmObj Scm_TLSAccept(ScmTLS* t, int fd);
 extern ScmObj Scm_TLSClose(ScmTLS* t);
 
+/* Client connection parameters; must be set before Scm_TLSConnect. */
+extern void   Scm_TLSSetServerName(ScmTLS* t, ScmObj name);
+extern void   Scm_TLSSetSession(ScmTLS* t, ScmObj session);
+extern ScmObj Scm_TLSGetSession(ScmTLS* t);
+
 /*
    KZ: presumably due to block sizes imposed by the crypto algorithms
    used, TLSRead() doesn't take a desired size and instead returns
@@ -43,6 +43,55 @@
                        :output "ssltest.log"
                        :wait #t)))
   ]
+ [(and gauche.net.tls.openssl gauche.sys.threads)
+  (use gauche.threads)
+  (use gauche.net)
+  ;; We need openssl command to create a certificate for the server.
+  (define openssl-cmd
+    (and-let1 m (any #/S\["OPENSSL"\]=\"(.+)\"/
+                     (file->string-list "../../config.status"))
+      (m 1)))
+
+  (when openssl-cmd
+    (run-process `(,openssl-cmd req -x509 -newkey rsa:2048 -nodes
+                                -keyout "test-key.o" -out "test-cert.o"
+                                -days 1 -subj "/CN=localhost")
+                 :output :null :error :null :wait #t)
+    (let* ([server (make-server-socket 'inet 0 :reuse-addr? #t)]
+           [port (sockaddr-port (socket-address server))]
+           [th (thread-start!
+                (make-thread
+                 (^[]
+                   (dotimes [i 2]
+                     (let ([s (socket-accept server)]
+                           [tls (make-tls SSL_SERVER_VERIFY_LATER)])
+                       (tls-load-object tls SSL_OBJ_X509_CERT "test-cert.o")
+                       (tls-load-object tls SSL_OBJ_RSA_KEY "test-key.o")
+                       (tls-accept tls (socket-fd s))
+                       (display (read-line (tls-input-port tls))
+                                (tls-output-port tls))
+                       (tls-close tls)
+                       (tls-destroy tls)
+                       (socket-close s))))))])
+      (define (talk msg session)
+        (let ([s (make-client-socket 'inet "127.0.0.1" port)]
+              [tls (make-tls)])
+          (tls-connect tls (socket-fd s)
+                       :server-name "localhost" :session session)
+          (display #"~|msg|\n" (tls-output-port tls))
+          (begin0 (list (port->string (tls-input-port tls))
+                        (tls-session tls))
+            (tls-close tls)
+            (tls-destroy tls)
+            (socket-close s))))
+
+      (let1 r (talk "hello" #f)
+        (test* "connect" "hello" (car r))
+        (test* "session" #t (is-a? (cadr r) <tls-session>))
+        (test* "resume" "again" (car (talk "again" (cadr r)))))
+      (thread-join! th)
+      (socket-close server)))
+  ]
  [else])
 
 (test-end)
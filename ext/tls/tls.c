@@ -34,9 +34,15 @@
 #include "gauche-tls.h"
 #include <gauche/extend.h>
 
+#if defined(GAUCHE_USE_OPENSSL)
+#include <openssl/err.h>
+#include <openssl/pkcs12.h>
+#endif /*GAUCHE_USE_OPENSSL*/
+
 static void tls_print(ScmObj obj, ScmPort* port, ScmWriteContext* ctx);
 
 SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_TLSClass, tls_print);
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_TLSSessionClass, NULL);
 
 static void tls_print(ScmObj obj, ScmPort* port, ScmWriteContext* ctx)
 {
@@ -46,6 +52,19 @@ static void tls_print(ScmObj obj, ScmPort* port, ScmWriteContext* ctx)
     Scm_Printf(port, ">");
 }
 
+#if defined(GAUCHE_USE_OPENSSL)
+/* Raise an error with the reason OpenSSL reports. */
+static void ssl_error(const char *msg)
+{
+    unsigned long e = ERR_get_error();
+    char buf[256];
+    if (e == 0) Scm_SysError("%s", msg);
+    ERR_error_string_n(e, buf, sizeof(buf));
+    ERR_clear_error();
+    Scm_Error("%s: %s", msg, buf);
+}
+#endif /*GAUCHE_USE_OPENSSL*/
+
 static void tls_finalize(ScmObj obj, void* data)
 {
     ScmTLS* t = SCM_TLS(obj);
@@ -55,21 +74,27 @@ static void tls_finalize(ScmObj obj, void* data)
         ssl_ctx_free(t->ctx);
         t->ctx = NULL;
     }
-#endif /*GAUCHE_USE_AXTLS*/
+#elif defined(GAUCHE_USE_OPENSSL)
+    if (t->ctx) {
+        Scm_TLSClose(t);
+        SSL_CTX_free(t->ctx);
+        t->ctx = NULL;
+    }
+#endif
 }
 
 static void context_check(ScmTLS* tls, const char* op)
 {
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
     if (!tls->ctx) Scm_Error("attempt to %s destroyed TLS: %S", op, tls);
-#endif /*GAUCHE_USE_AXTLS*/
+#endif /*GAUCHE_TLS_ENABLED*/
 }
 
 static void close_check(ScmTLS* tls, const char* op)
 {
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
     if (!tls->conn) Scm_Error("attempt to %s closed TLS: %S", op, tls);
-#endif /*GAUCHE_USE_AXTLS*/
+#endif /*GAUCHE_TLS_ENABLED*/
 }
 
 ScmObj Scm_MakeTLS(uint32_t options, int num_sessions)
@@ -78,9 +103,31 @@ ScmObj Scm_MakeTLS(uint32_t options, int num_sessions)
     SCM_SET_CLASS(t, SCM_CLASS_TLS);
 #if defined(GAUCHE_USE_AXTLS)
     t->ctx = ssl_ctx_new(options, num_sessions);
+#elif defined(GAUCHE_USE_OPENSSL)
+    t->ctx = SSL_CTX_new(TLS_method());
+    if (!t->ctx) ssl_error("SSL_CTX_new failed");
+    if (options & SSL_SERVER_VERIFY_LATER) {
+        SSL_CTX_set_verify(t->ctx, SSL_VERIFY_NONE, NULL);
+    } else {
+        int mode = SSL_VERIFY_PEER;
+        if (options & SSL_CLIENT_AUTHENTICATION) {
+            mode |= SSL_VERIFY_FAIL_IF_NO_PEER_CERT;
+        }
+        SSL_CTX_set_verify(t->ctx, mode, NULL);
+        SSL_CTX_set_default_verify_paths(t->ctx);
+    }
+    /* Servers cache sessions by default; num_sessions only limits it. */
+    if (num_sessions > 0) {
+        SSL_CTX_sess_set_cache_size(t->ctx, num_sessions);
+    }
+#endif
+#if defined(GAUCHE_TLS_ENABLED)
     t->conn = NULL;
     t->in_port = t->out_port = 0;
-#endif /*GAUCHE_USE_AXTLS*/
+    t->options = options;
+    t->session = SCM_FALSE;
+    t->server_name = SCM_FALSE;
+#endif /*GAUCHE_TLS_ENABLED*/
     Scm_RegisterFinalizer(SCM_OBJ(t), tls_finalize, NULL);
     return SCM_OBJ(t);
 }
@@ -90,9 +137,9 @@ ScmObj Scm_MakeTLS(uint32_t options, int num_sessions)
    up all fds, so explicit destruction is recommended whenever possible. */
 ScmObj Scm_TLSDestroy(ScmTLS* t)
 {
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
     tls_finalize(SCM_OBJ(t), NULL);
-#endif /*GAUCHE_USE_AXTLS*/
+#endif /*GAUCHE_TLS_ENABLED*/
     return SCM_TRUE;
 }
 
@@ -104,10 +151,48 @@ ScmObj Scm_TLSClose(ScmTLS* t)
         t->conn = 0;
         t->in_port = t->out_port = 0;
     }
-#endif /*GAUCHE_USE_AXTLS*/
+#elif defined(GAUCHE_USE_OPENSSL)
+    if (t->ctx && t->conn) {
+        SSL_shutdown(t->conn);
+        SSL_free(t->conn);
+        t->conn = 0;
+        t->in_port = t->out_port = 0;
+    }
+#endif
     return SCM_TRUE;
 }
 
+#if defined(GAUCHE_USE_OPENSSL)
+/* axTLS figures out PEM or DER by itself; we try both. */
+static int use_file(SSL_CTX *ctx, const char *filename,
+                    int (*proc)(SSL_CTX*, const char*, int))
+{
+    if (proc(ctx, filename, SSL_FILETYPE_PEM) == 1) return TRUE;
+    ERR_clear_error();
+    return proc(ctx, filename, SSL_FILETYPE_ASN1) == 1;
+}
+
+static int use_pkcs12(SSL_CTX *ctx, const char *filename,
+                      const char *password)
+{
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) return FALSE;
+    PKCS12 *p12 = d2i_PKCS12_fp(fp, NULL);
+    fclose(fp);
+    if (p12 == NULL) return FALSE;
+
+    EVP_PKEY *key = NULL;
+    X509 *cert = NULL;
+    int r = PKCS12_parse(p12, password, &key, &cert, NULL)
+        && SSL_CTX_use_certificate(ctx, cert) == 1
+        && SSL_CTX_use_PrivateKey(ctx, key) == 1;
+    EVP_PKEY_free(key);
+    X509_free(cert);
+    PKCS12_free(p12);
+    return r;
+}
+#endif /*GAUCHE_USE_OPENSSL*/
+
 ScmObj Scm_TLSLoadObject(ScmTLS* t, ScmObj obj_type,
                          const char *filename, const char *password)
 {
@@ -115,10 +200,53 @@ ScmObj Scm_TLSLoadObject(ScmTLS* t, ScmObj obj_type,
     uint32_t type = Scm_GetIntegerU32Clamp(obj_type, SCM_CLAMP_ERROR, NULL);
     if (ssl_obj_load(t->ctx, type, filename, password) == SSL_OK)
         return SCM_TRUE;
-#endif /*GAUCHE_USE_AXTLS*/
+#elif defined(GAUCHE_USE_OPENSSL)
+    uint32_t type = Scm_GetIntegerU32Clamp(obj_type, SCM_CLAMP_ERROR, NULL);
+    int r = FALSE;
+    context_check(t, "load object into");
+    SSL_CTX_set_default_passwd_cb_userdata(t->ctx, (void*)password);
+    switch (type) {
+    case SSL_OBJ_X509_CERT:
+        r = use_file(t->ctx, filename, SSL_CTX_use_certificate_file);
+        break;
+    case SSL_OBJ_X509_CACERT:
+        r = SSL_CTX_load_verify_locations(t->ctx, filename, NULL) == 1;
+        break;
+    case SSL_OBJ_RSA_KEY:
+    case SSL_OBJ_PKCS8:
+        r = use_file(t->ctx, filename, SSL_CTX_use_PrivateKey_file);
+        break;
+    case SSL_OBJ_PKCS12:
+        r = use_pkcs12(t->ctx, filename, password);
+        break;
+    }
+    SSL_CTX_set_default_passwd_cb_userdata(t->ctx, NULL);
+    ERR_clear_error();
+    if (r) return SCM_TRUE;
+#endif
     return SCM_FALSE;
 }
 
+void Scm_TLSSetServerName(ScmTLS* t, ScmObj name)
+{
+    if (!SCM_FALSEP(name) && !SCM_STRINGP(name)) {
+        Scm_TypeError("server name", "string or #f", name);
+    }
+#if defined(GAUCHE_TLS_ENABLED)
+    t->server_name = name;
+#endif /*GAUCHE_TLS_ENABLED*/
+}
+
+void Scm_TLSSetSession(ScmTLS* t, ScmObj session)
+{
+    if (!SCM_FALSEP(session) && !SCM_TLS_SESSION_P(session)) {
+        Scm_TypeError("session", "<tls-session> or #f", session);
+    }
+#if defined(GAUCHE_TLS_ENABLED)
+    t->session = session;
+#endif /*GAUCHE_TLS_ENABLED*/
+}
+
 ScmObj Scm_TLSConnect(ScmTLS* t, int fd)
 {
 #if defined(GAUCHE_USE_AXTLS)
@@ -129,7 +257,25 @@ ScmObj Scm_TLSConnect(ScmTLS* t, int fd)
     if (r != SSL_OK) {
         Scm_Error("TLS handshake failed: %d", r);
     }
-#endif /*GAUCHE_USE_AXTLS*/
+#elif defined(GAUCHE_USE_OPENSSL)
+    context_check(t, "connect");
+    if (t->conn) Scm_SysError("attempt to connect already-connected TLS %S", t);
+    SSL *conn = SSL_new(t->ctx);
+    if (!conn) ssl_error("SSL_new failed");
+    SSL_set_fd(conn, fd);
+    if (SCM_STRINGP(t->server_name)) {
+        SSL_set_tlsext_host_name(conn,
+                                 Scm_GetStringConst(SCM_STRING(t->server_name)));
+    }
+    if (SCM_TLS_SESSION_P(t->session)) {
+        SSL_set_session(conn, SCM_TLS_SESSION(t->session)->session);
+    }
+    if (SSL_connect(conn) != 1) {
+        SSL_free(conn);
+        ssl_error("TLS handshake failed");
+    }
+    t->conn = conn;
+#endif
     return SCM_OBJ(t);
 }
 
@@ -139,10 +285,60 @@ ScmObj Scm_TLSAccept(ScmTLS* t, int fd)
     context_check(t, "accept");
     if (t->conn) Scm_SysError("attempt to connect already-connected TLS %S", t);
     t->conn = ssl_server_new(t->ctx, fd);
-#endif /*GAUCHE_USE_AXTLS*/
+#elif defined(GAUCHE_USE_OPENSSL)
+    context_check(t, "accept");
+    if (t->conn) Scm_SysError("attempt to connect already-connected TLS %S", t);
+    SSL *conn = SSL_new(t->ctx);
+    if (!conn) ssl_error("SSL_new failed");
+    SSL_set_fd(conn, fd);
+    if (SSL_accept(conn) != 1) {
+        SSL_free(conn);
+        ssl_error("TLS handshake failed");
+    }
+    t->conn = conn;
+#endif
     return SCM_OBJ(t);
 }
 
+#if defined(GAUCHE_USE_OPENSSL)
+static void session_finalize(ScmObj obj, void* data)
+{
+    ScmTLSSession* s = SCM_TLS_SESSION(obj);
+    if (s->session) {
+        SSL_SESSION_free(s->session);
+        s->session = NULL;
+    }
+}
+#endif /*GAUCHE_USE_OPENSSL*/
+
+/* Returns the session of the client connection that can be resumed, or
+   #f.  With TLS 1.3 the server sends session tickets after the handshake,
+   so it's better to call this after some data has been read. */
+ScmObj Scm_TLSGetSession(ScmTLS* t)
+{
+#if defined(GAUCHE_USE_OPENSSL)
+    context_check(t, "get session of");
+    close_check(t, "get session of");
+    SSL_SESSION *s = SSL_get1_session(t->conn);
+    if (s == NULL) return SCM_FALSE;
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L
+    if (!SSL_SESSION_is_resumable(s)) {
+        SSL_SESSION_free(s);
+        return SCM_FALSE;
+    }
+#endif
+    ScmTLSSession* z = SCM_NEW(ScmTLSSession);
+    SCM_SET_CLASS(z, SCM_CLASS_TLS_SESSION);
+    z->session = s;
+    Scm_RegisterFinalizer(SCM_OBJ(z), session_finalize, NULL);
+    return SCM_OBJ(z);
+#else  /*!GAUCHE_USE_OPENSSL*/
+    return SCM_FALSE;
+#endif /*!GAUCHE_USE_OPENSSL*/
+}
+
+/* Returns whatever we can read at once as an incomplete string, or
+   an empty string at the end of the stream. */
 ScmObj Scm_TLSRead(ScmTLS* t)
 {
 #if defined(GAUCHE_USE_AXTLS)
@@ -152,12 +348,36 @@ ScmObj Scm_TLSRead(ScmTLS* t)
     while ((r = ssl_read(t->conn, &buf)) == SSL_OK);
     if (r < 0) Scm_SysError("ssl_read() failed");
     return Scm_MakeString((char*) buf, r, r, SCM_STRING_INCOMPLETE);
-#else  /*!GAUCHE_USE_AXTLS*/
+#elif defined(GAUCHE_USE_OPENSSL)
+    context_check(t, "read");
+    close_check(t, "read");
+    char buf[16384];            /* max TLS record size */
+    errno = 0;
+    int r = SSL_read(t->conn, buf, sizeof(buf));
+    if (r <= 0) {
+        switch (SSL_get_error(t->conn, r)) {
+        case SSL_ERROR_ZERO_RETURN:
+            r = 0;
+            break;
+        case SSL_ERROR_SYSCALL:
+            /* Many servers just close the connection without
+               close_notify; we take it as the end of the stream. */
+            if (ERR_peek_error() == 0 && errno == 0) {
+                r = 0;
+                break;
+            }
+            /* FALLTHROUGH */
+        default:
+            ssl_error("SSL_read() failed");
+        }
+    }
+    return Scm_MakeString(buf, r, r, SCM_STRING_INCOMPLETE|SCM_STRING_COPYING);
+#else  /*!GAUCHE_TLS_ENABLED*/
     return SCM_FALSE;
-#endif /*!GAUCHE_USE_AXTLS*/
+#endif /*!GAUCHE_TLS_ENABLED*/
 }
 
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
 static const uint8_t* get_message_body(ScmObj msg, u_int *size)
 {
     if (SCM_UVECTORP(msg)) {
@@ -171,7 +391,7 @@ static const uint8_t* get_message_body(ScmObj msg, u_int *size)
         return 0;
     }
 }
-#endif /*GAUCHE_USE_AXTLS*/
+#endif /*GAUCHE_TLS_ENABLED*/
 
 ScmObj Scm_TLSWrite(ScmTLS* t, ScmObj msg)
 {
@@ -185,42 +405,62 @@ ScmObj Scm_TLSWrite(ScmTLS* t, ScmObj msg)
         Scm_SysError("ssl_write() failed");
     }
     return SCM_MAKE_INT(r);
-#else  /*!GAUCHE_USE_AXTLS*/
+#elif defined(GAUCHE_USE_OPENSSL)
+    context_check(t, "write");
+    close_check(t, "write");
+    int r = 0;
+    u_int size;
+    const uint8_t* cmsg = get_message_body(msg, &size);
+    /* SSL_write doesn't return until everything is written on a
+       blocking socket, unless SSL_MODE_ENABLE_PARTIAL_WRITE is set. */
+    if (size > 0 && (r = SSL_write(t->conn, cmsg, size)) <= 0) {
+        ssl_error("SSL_write() failed");
+    }
+    return SCM_MAKE_INT(r);
+#else  /*!GAUCHE_TLS_ENABLED*/
     return SCM_FALSE;
-#endif /*!GAUCHE_USE_AXTLS*/
+#endif /*!GAUCHE_TLS_ENABLED*/
 }
 
 ScmObj Scm_TLSInputPort(ScmTLS* t)
 {
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
     return SCM_OBJ(t->in_port);
-#endif /*GAUCHE_USE_AXTLS*/
+#else  /*!GAUCHE_TLS_ENABLED*/
+    return SCM_FALSE;
+#endif /*!GAUCHE_TLS_ENABLED*/
 }
 
 ScmObj Scm_TLSOutputPort(ScmTLS* t)
 {
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
     return SCM_OBJ(t->out_port);
-#endif /*GAUCHE_USE_AXTLS*/
+#else  /*!GAUCHE_TLS_ENABLED*/
+    return SCM_FALSE;
+#endif /*!GAUCHE_TLS_ENABLED*/
 }
 
 ScmObj Scm_TLSInputPortSet(ScmTLS* t, ScmObj port)
 {
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
     t->in_port = SCM_PORT(port);
-#endif /*GAUCHE_USE_AXTLS*/
+#endif /*GAUCHE_TLS_ENABLED*/
     return port;
 }
 
 ScmObj Scm_TLSOutputPortSet(ScmTLS* t, ScmObj port)
 {
-#if defined(GAUCHE_USE_AXTLS)
+#if defined(GAUCHE_TLS_ENABLED)
     t->out_port = SCM_PORT(port);
-#endif /*GAUCHE_USE_AXTLS*/
+#endif /*GAUCHE_TLS_ENABLED*/
     return port;
 }
 
 void Scm_Init_tls(ScmModule *mod)
 {
+#if defined(GAUCHE_USE_OPENSSL)
+    OPENSSL_init_ssl(0, NULL);
+#endif /*GAUCHE_USE_OPENSSL*/
     Scm_InitStaticClass(&Scm_TLSClass, "<tls>", mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_TLSSessionClass, "<tls-session>", mod, NULL, 0);
 }
@@ -38,6 +38,7 @@
   (export <tls> make-tls tls-destroy tls-connect tls-accept tls-close
           tls-load-object tls-read tls-write
           tls-input-port tls-output-port
+          <tls-session> tls-session
 
           SSL_SERVER_VERIFY_LATER SSL_CLIENT_AUTHENTICATION
           SSL_DISPLAY_BYTES SSL_DISPLAY_STATES SSL_DISPLAY_CERTS
@@ -78,6 +79,11 @@
                                            :optional (password::<const-cstring>? #f)) Scm_TLSLoadObject)
  (define-cproc tls-destroy (tls::<tls>) Scm_TLSDestroy)
  (define-cproc %tls-connect (tls::<tls> fd::<long>) Scm_TLSConnect)
+ (define-cproc %tls-server-name-set! (tls::<tls> name) ::<void>
+   Scm_TLSSetServerName)
+ (define-cproc %tls-session-set! (tls::<tls> session) ::<void>
+   Scm_TLSSetSession)
+ (define-cproc tls-session (tls::<tls>) Scm_TLSGetSession)
  (define-cproc %tls-accept (tls::<tls> fd::<long>) Scm_TLSAccept)
  (define-cproc %tls-close (tls::<tls>) Scm_TLSClose)
  (define-cproc tls-read (tls::<tls>) Scm_TLSRead)
@@ -93,7 +99,13 @@
  )
 
 ;; API
-(define (tls-connect tls fd)
+;;  SERVER-NAME is sent to the server (SNI).  SESSION is what tls-session
+;;  returned for a previous connection to the same server; the server
+;;  may resume it and skip the full handshake.  Both are ignored with
+;;  axTLS.
+(define (tls-connect tls fd :key (server-name #f) (session #f))
+  (%tls-server-name-set! tls server-name)
+  (%tls-session-set! tls session)
   (%tls-connect tls fd) ;; done before ports in case of connect failure.
   (tls-input-port-set! tls (make-tls-input-port tls))
   (tls-output-port-set! tls (make-tls-output-port tls))
@@ -123,11 +135,15 @@
                 (rlet1 r (string-byte-ref buf pos)
                   (set! pos (+ pos 1))
                   (when (= pos size) (set! buf #f)))
-                (begin
-                  (set! buf (tls-read tls))
-                  (set! size (string-size buf))
-                  (set! pos 1)
-                  (string-byte-ref buf 0))))))))
+                (let1 s (tls-read tls) ; empty string at EOF
+                  (if (zero? (string-size s))
+                    (eof-object)
+                    (begin
+                      (when (> (string-size s) 1)
+                        (set! buf s)
+                        (set! size (string-size s))
+                        (set! pos 1))
+                      (string-byte-ref s 0))))))))))
 
 (define (make-tls-output-port tls)
   (rlet1 op (make <virtual-output-port>)
@@ -0,0 +1,330 @@
+/*
+ * lcs-core.c - native core of util.lcs
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <limits.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "lcs-core.h"
+
+/*=====================================================
+ * Matching
+ *
+ *  The sequences are given as int arrays of element ids, so that the
+ *  inner loops only compare integers.  Matched pairs are stored in
+ *  MA/MB in increasing order.
+ *
+ *  The default is Myers's O(ND) algorithm with the linear space
+ *  refinement (Myers 1986, section 4b): we find the middle snake of
+ *  the optimal edit path by running the greedy search from both ends
+ *  at once, then recurse to the both sides of it.  It only needs two
+ *  vectors of diagonals, whose size is N+M+3.
+ *
+ *  Patience diff first matches elements that appear exactly once in
+ *  each side, taking the longest increasing sequence of them, then
+ *  recurses into the gaps between them.  A gap without such elements
+ *  falls back to Myers.  The result isn't necessarily the longest,
+ *  but tends to align with the structure of the text.
+ */
+
+typedef struct {
+    const int *a;
+    const int *b;
+    int *fd;                    /* forward furthest x, by diagonal */
+    int *bd;                    /* backward furthest x, by diagonal */
+    int *ma;                    /* matched positions */
+    int *mb;
+    int nmatch;
+    int *cnta;                  /* patience: occurrences by id */
+    int *cntb;
+    int *posb;                  /* patience: position in b by id */
+} lcs_ctx;
+
+/* Patience diff recursing deeper than this uses Myers for the rest,
+   to keep the C stack bounded for pathological input. */
+#define PATIENCE_MAX_DEPTH 256
+
+static inline void emit(lcs_ctx *ctx, int x, int y)
+{
+    ctx->ma[ctx->nmatch] = x;
+    ctx->mb[ctx->nmatch] = y;
+    ctx->nmatch++;
+}
+
+/* Emits the common prefix of [*xoff,*xlim) and [*yoff,*ylim), and strips
+   the common suffix.  Returns the length of the suffix, which the caller
+   has to emit after the inner part. */
+static int trim(lcs_ctx *ctx, int *xoff, int *xlim, int *yoff, int *ylim)
+{
+    const int *a = ctx->a, *b = ctx->b;
+    int n = 0;
+    while (*xoff < *xlim && *yoff < *ylim && a[*xoff] == b[*yoff]) {
+        emit(ctx, (*xoff)++, (*yoff)++);
+    }
+    while (*xoff < *xlim && *yoff < *ylim && a[*xlim-1] == b[*ylim-1]) {
+        (*xlim)--; (*ylim)--; n++;
+    }
+    return n;
+}
+
+static void emit_suffix(lcs_ctx *ctx, int xlim, int ylim, int n)
+{
+    for (int i = 0; i < n; i++) emit(ctx, xlim+i, ylim+i);
+}
+
+/* Finds the middle snake.  Both ranges must be non-empty, and must not
+   have a common prefix nor suffix.  Diagonal k is x - y; FD and BD are
+   indexed by k directly. */
+static void middle_snake(lcs_ctx *ctx, int xoff, int xlim, int yoff, int ylim,
+                         int *xmid, int *ymid)
+{
+    const int *a = ctx->a, *b = ctx->b;
+    int *fd = ctx->fd, *bd = ctx->bd;
+    int dmin = xoff - ylim, dmax = xlim - yoff;
+    int fmid = xoff - yoff, bmid = xlim - ylim;
+    int fmin = fmid, fmax = fmid, bmin = bmid, bmax = bmid;
+    int odd = (fmid - bmid) & 1;
+
+    fd[fmid] = xoff;
+    bd[bmid] = xlim;
+    for (;;) {
+        int d;
+        if (fmin > dmin) fd[--fmin - 1] = -1; else ++fmin;
+        if (fmax < dmax) fd[++fmax + 1] = -1; else --fmax;
+        for (d = fmax; d >= fmin; d -= 2) {
+            int lo = fd[d-1], hi = fd[d+1];
+            int x = (lo < hi) ? hi : lo + 1, y = x - d;
+            while (x < xlim && y < ylim && a[x] == b[y]) { x++; y++; }
+            fd[d] = x;
+            if (odd && bmin <= d && d <= bmax && bd[d] <= x) {
+                *xmid = x; *ymid = y;
+                return;
+            }
+        }
+        if (bmin > dmin) bd[--bmin - 1] = INT_MAX; else ++bmin;
+        if (bmax < dmax) bd[++bmax + 1] = INT_MAX; else --bmax;
+        for (d = bmin; d <= bmax; d += 2) {
+            int lo = bd[d-1], hi = bd[d+1];
+            int x = (lo < hi) ? lo : hi - 1, y = x - d;
+            while (xoff < x && yoff < y && a[x-1] == b[y-1]) { x--; y--; }
+            bd[d] = x;
+            if (!odd && fmin <= d && d <= fmax && x <= fd[d]) {
+                *xmid = x; *ymid = y;
+                return;
+            }
+        }
+    }
+}
+
+static void myers(lcs_ctx *ctx, int xoff, int xlim, int yoff, int ylim)
+{
+    int n = trim(ctx, &xoff, &xlim, &yoff, &ylim);
+    if (xoff < xlim && yoff < ylim) {
+        int xmid, ymid;
+        middle_snake(ctx, xoff, xlim, yoff, ylim, &xmid, &ymid);
+        myers(ctx, xoff, xmid, yoff, ymid);
+        myers(ctx, xmid, xlim, ymid, ylim);
+    }
+    emit_suffix(ctx, xlim, ylim, n);
+}
+
+static void patience(lcs_ctx *ctx, int xoff, int xlim, int yoff, int ylim,
+                     int depth)
+{
+    const int *a = ctx->a, *b = ctx->b;
+    int *cnta = ctx->cnta, *cntb = ctx->cntb, *posb = ctx->posb;
+    int n = trim(ctx, &xoff, &xlim, &yoff, &ylim), i, k;
+
+    if (xoff < xlim && yoff < ylim) {
+        int ncand = 0;
+        if (depth < PATIENCE_MAX_DEPTH) {
+            for (i = xoff; i < xlim; i++) cnta[a[i]]++;
+            for (i = yoff; i < ylim; i++) { cntb[b[i]]++; posb[b[i]] = i; }
+            for (i = xoff; i < xlim; i++) {
+                if (cnta[a[i]] == 1 && cntb[a[i]] == 1) ncand++;
+            }
+        }
+        if (ncand == 0) {
+            if (depth < PATIENCE_MAX_DEPTH) {
+                for (i = xoff; i < xlim; i++) cnta[a[i]] = 0;
+                for (i = yoff; i < ylim; i++) cntb[b[i]] = 0;
+            }
+            myers(ctx, xoff, xlim, yoff, ylim);
+        } else {
+            /* CX/CY: candidates in the order of x.  TAILS[l] is the
+               candidate ending the best increasing run of length l+1
+               found so far, and PREV chains the runs. */
+            int *cx = SCM_NEW_ATOMIC_ARRAY(int, ncand);
+            int *cy = SCM_NEW_ATOMIC_ARRAY(int, ncand);
+            int *tails = SCM_NEW_ATOMIC_ARRAY(int, ncand);
+            int *prev = SCM_NEW_ATOMIC_ARRAY(int, ncand);
+            int len = 0, px = xoff, py = yoff;
+
+            for (i = xoff, k = 0; i < xlim; i++) {
+                if (cnta[a[i]] == 1 && cntb[a[i]] == 1) {
+                    cx[k] = i; cy[k] = posb[a[i]]; k++;
+                }
+            }
+            for (i = xoff; i < xlim; i++) cnta[a[i]] = 0;
+            for (i = yoff; i < ylim; i++) cntb[b[i]] = 0;
+
+            for (k = 0; k < ncand; k++) {
+                int lo = 0, hi = len;
+                while (lo < hi) {
+                    int m = (lo + hi) / 2;
+                    if (cy[tails[m]] < cy[k]) lo = m + 1;
+                    else hi = m;
+                }
+                prev[k] = (lo > 0) ? tails[lo-1] : -1;
+                tails[lo] = k;
+                if (lo == len) len++;
+            }
+            /* Reuse TAILS to hold the anchors in increasing order. */
+            for (i = len-1, k = tails[len-1]; i >= 0; i--, k = prev[k]) {
+                tails[i] = k;
+            }
+            for (i = 0; i < len; i++) {
+                k = tails[i];
+                patience(ctx, px, cx[k], py, cy[k], depth+1);
+                emit(ctx, cx[k], cy[k]);
+                px = cx[k] + 1;
+                py = cy[k] + 1;
+            }
+            patience(ctx, px, xlim, py, ylim, depth+1);
+        }
+    }
+    emit_suffix(ctx, xlim, ylim, n);
+}
+
+/* Converts a vector of ids to an int array.  Returns the max id. */
+static int ids_to_array(ScmVector *v, int *r)
+{
+    int maxid = -1;
+    for (ScmSmallInt i = 0; i < SCM_VECTOR_SIZE(v); i++) {
+        ScmObj e = SCM_VECTOR_ELEMENT(v, i);
+        if (!SCM_INTP(e) || SCM_INT_VALUE(e) < 0
+            || SCM_INT_VALUE(e) > INT_MAX) {
+            Scm_Error("non-negative fixnum required as an element id, "
+                      "but got: %S", e);
+        }
+        r[i] = (int)SCM_INT_VALUE(e);
+        if (r[i] > maxid) maxid = r[i];
+    }
+    return maxid;
+}
+
+/* Elements that appear only in one side can never match.  We drop
+   them before running the algorithm, as GNU diff does; it cuts the
+   cost a lot when many lines are rewritten.  V is compacted, keeping
+   the original positions in XS, and the new length is returned. */
+static int discard_unmatchable(int *v, int len, const char *seen, int *xs)
+{
+    int k = 0;
+    for (int i = 0; i < len; i++) {
+        if (seen[v[i]]) { xs[k] = i; v[k] = v[i]; k++; }
+    }
+    return k;
+}
+
+ScmObj Scm__LcsMatches(ScmVector *a, ScmVector *b, int patiencep)
+{
+    ScmSmallInt n = SCM_VECTOR_SIZE(a), m = SCM_VECTOR_SIZE(b);
+    if (n + m + 3 > INT_MAX) {
+        Scm_Error("sequences too long: %ld and %ld", n, m);
+    }
+    int *av = SCM_NEW_ATOMIC_ARRAY(int, n+1);
+    int *bv = SCM_NEW_ATOMIC_ARRAY(int, m+1);
+    int maxa = ids_to_array(a, av);
+    int maxb = ids_to_array(b, bv);
+    int nids = ((maxa > maxb) ? maxa : maxb) + 1;
+    int pre = 0, suf = 0;
+
+    /* The common prefix and suffix are taken before discarding, so
+       that they are matched as they are. */
+    while (pre < n && pre < m && av[pre] == bv[pre]) pre++;
+    while (suf < n-pre && suf < m-pre && av[n-1-suf] == bv[m-1-suf]) suf++;
+
+    int an = (int)n - pre - suf, bn = (int)m - pre - suf;
+    int *ap = av + pre, *bp = bv + pre;
+    char *ina = SCM_NEW_ATOMIC_ARRAY(char, nids+1);
+    char *inb = SCM_NEW_ATOMIC_ARRAY(char, nids+1);
+    int *xa = SCM_NEW_ATOMIC_ARRAY(int, an+1);
+    int *xb = SCM_NEW_ATOMIC_ARRAY(int, bn+1);
+
+    memset(ina, 0, nids);
+    memset(inb, 0, nids);
+    for (int i = 0; i < an; i++) ina[ap[i]] = 1;
+    for (int i = 0; i < bn; i++) inb[bp[i]] = 1;
+    an = discard_unmatchable(ap, an, inb, xa);
+    bn = discard_unmatchable(bp, bn, ina, xb);
+
+    lcs_ctx ctx;
+    int *diags = SCM_NEW_ATOMIC_ARRAY(int, 2*(an+bn+3));
+    int nmax = (an < bn) ? an : bn;
+
+    ctx.a = ap;
+    ctx.b = bp;
+    /* Diagonals range from -bn-1 to an+1. */
+    ctx.fd = diags + bn + 1;
+    ctx.bd = diags + (an + bn + 3) + bn + 1;
+    ctx.ma = SCM_NEW_ATOMIC_ARRAY(int, nmax+1);
+    ctx.mb = SCM_NEW_ATOMIC_ARRAY(int, nmax+1);
+    ctx.nmatch = 0;
+    if (patiencep) {
+        ctx.cnta = SCM_NEW_ATOMIC_ARRAY(int, nids);
+        ctx.cntb = SCM_NEW_ATOMIC_ARRAY(int, nids);
+        ctx.posb = SCM_NEW_ATOMIC_ARRAY(int, nids);
+        memset(ctx.cnta, 0, sizeof(int)*nids);
+        memset(ctx.cntb, 0, sizeof(int)*nids);
+        patience(&ctx, 0, an, 0, bn, 0);
+    } else {
+        myers(&ctx, 0, an, 0, bn);
+    }
+
+    /* Build the result from the end. */
+    ScmObj r = SCM_NIL;
+    for (int i = suf; i > 0; i--) {
+        r = Scm_Cons(Scm_Cons(SCM_MAKE_INT(n-i), SCM_MAKE_INT(m-i)), r);
+    }
+    for (int i = ctx.nmatch-1; i >= 0; i--) {
+        r = Scm_Cons(Scm_Cons(SCM_MAKE_INT(pre + xa[ctx.ma[i]]),
+                              SCM_MAKE_INT(pre + xb[ctx.mb[i]])),
+                     r);
+    }
+    for (int i = pre-1; i >= 0; i--) {
+        r = Scm_Cons(Scm_Cons(SCM_MAKE_INT(i), SCM_MAKE_INT(i)), r);
+    }
+    return r;
+}
@@ -0,0 +1,273 @@
+/*
+ * levenshtein-core.c - native core of util.levenshtein
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gauche.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LIBGAUCHE_EXT_BODY
+#include <gauche/extern.h>
+#include "levenshtein-core.h"
+
+/*=====================================================
+ * Bit-parallel Levenshtein distance
+ *
+ *  Myers, "A fast bit-vector algorithm for approximate string matching
+ *  based on dynamic programming", JACM 46(3), 1999, in the formulation
+ *  of Hyyroe, "A bit-vector algorithm for computing Levenshtein and
+ *  Damerau edit distances", Nordic Journal of Computing 10, 2003.
+ *
+ *  Each column of the DP matrix (one per element of the text B) is
+ *  represented by vertical deltas of +1/-1 packed in bit vectors Pv/Mv,
+ *  one bit per element of the pattern A, and the next column is
+ *  computed with a handful of word operations.  A pattern longer than
+ *  a word is split into blocks, and the horizontal delta is carried
+ *  from a block to the next.  It takes O(ceil(M/64) N) time.
+ *
+ *  The pattern is preprocessed once into PEQ, the bit masks of
+ *  positions for each distinct element, and reused for all the texts.
+ */
+
+typedef uint64_t word_t;
+#define WORD_BITS    64
+#define WORD_HIGH    ((word_t)1 << (WORD_BITS-1))
+
+typedef struct {
+    int m;                      /* pattern length */
+    int nwords;                 /* # of blocks */
+    word_t *peq;                /* bit masks, NWORDS per row.  Row 0 is
+                                   all zero, for elements not in A. */
+    int small[256];             /* code -> row, for small codes */
+    int *keys;                  /* open addressing table code -> row */
+    int *rows;                  /*   for other codes; 0 for empty */
+    unsigned int mask;          /* size of keys/rows - 1 */
+    word_t *pv;                 /* work area for multiple blocks */
+    word_t *mv;
+} lpattern;
+
+static inline unsigned int code_hash(int code, unsigned int mask)
+{
+    return ((unsigned int)code * 2654435761u) & mask;
+}
+
+static inline int lookup_row(const lpattern *p, int code)
+{
+    if (code < 256) return p->small[code];
+    unsigned int h = code_hash(code, p->mask);
+    while (p->rows[h] != 0) {
+        if (p->keys[h] == code) return p->rows[h];
+        h = (h + 1) & p->mask;
+    }
+    return 0;
+}
+
+static void prepare_pattern(lpattern *p, const int *a, int m)
+{
+    int nrows = 1;
+    unsigned int size = 16;
+
+    while (size < (unsigned int)m * 2) size <<= 1;
+    p->m = m;
+    p->nwords = (m + WORD_BITS - 1) / WORD_BITS;
+    p->peq = SCM_NEW_ATOMIC_ARRAY(word_t, (m+1) * p->nwords);
+    memset(p->peq, 0, sizeof(word_t) * (m+1) * p->nwords);
+    memset(p->small, 0, sizeof(p->small));
+    p->keys = SCM_NEW_ATOMIC_ARRAY(int, size);
+    p->rows = SCM_NEW_ATOMIC_ARRAY(int, size);
+    memset(p->rows, 0, sizeof(int) * size);
+    p->mask = size - 1;
+    p->pv = SCM_NEW_ATOMIC_ARRAY(word_t, p->nwords);
+    p->mv = SCM_NEW_ATOMIC_ARRAY(word_t, p->nwords);
+
+    for (int i = 0; i < m; i++) {
+        int r = lookup_row(p, a[i]);
+        if (r == 0) {
+            r = nrows++;
+            if (a[i] < 256) {
+                p->small[a[i]] = r;
+            } else {
+                unsigned int h = code_hash(a[i], p->mask);
+                while (p->rows[h] != 0) h = (h + 1) & p->mask;
+                p->keys[h] = a[i];
+                p->rows[h] = r;
+            }
+        }
+        p->peq[r * p->nwords + i / WORD_BITS] |= (word_t)1 << (i % WORD_BITS);
+    }
+}
+
+/* Advances one block by one column.  HIN is the horizontal delta coming
+   from the block above (+1, 0 or -1).  Returns the delta at HBIT. */
+static inline int advance_block(word_t *pv, word_t *mv, word_t eq, int hin,
+                                word_t hbit)
+{
+    word_t Pv = *pv, Mv = *mv;
+    word_t hneg = (hin < 0) ? 1 : 0;
+    word_t Xv = eq | Mv;
+    word_t Xh, Ph, Mh;
+    int hout = 0;
+
+    eq |= hneg;
+    Xh = (((eq & Pv) + Pv) ^ Pv) | eq;
+    Ph = Mv | ~(Xh | Pv);
+    Mh = Pv & Xh;
+    if (Ph & hbit) hout = 1;
+    else if (Mh & hbit) hout = -1;
+    Ph = (Ph << 1) | ((hin > 0) ? 1 : 0);
+    Mh = (Mh << 1) | hneg;
+    *pv = Mh | ~(Xv | Ph);
+    *mv = Ph & Xv;
+    return hout;
+}
+
+/* Returns the distance between the pattern and T, or -1 if it exceeds
+   K.  K < 0 means no limit.  Since the last row can decrease at most by
+   one per column, we give up as soon as the current score minus the
+   number of remaining columns exceeds K. */
+static long pattern_distance(lpattern *p, const int *t, int n, long k)
+{
+    int m = p->m;
+    long score = m;
+
+    if (k >= 0 && labs((long)m - n) > k) return -1;
+    if (m == 0) return n;
+
+    if (p->nwords == 1) {
+        word_t Pv = ~(word_t)0, Mv = 0;
+        word_t hbit = (word_t)1 << (m - 1);
+        for (int j = 0; j < n; j++) {
+            word_t eq = p->peq[lookup_row(p, t[j])];
+            word_t Xv = eq | Mv;
+            word_t Xh = (((eq & Pv) + Pv) ^ Pv) | eq;
+            word_t Ph = Mv | ~(Xh | Pv);
+            word_t Mh = Pv & Xh;
+            if (Ph & hbit) score++;
+            else if (Mh & hbit) score--;
+            Ph = (Ph << 1) | 1;
+            Mh <<= 1;
+            Pv = Mh | ~(Xv | Ph);
+            Mv = Ph & Xv;
+            if (k >= 0 && score - (n - j - 1) > k) return -1;
+        }
+    } else {
+        int w = p->nwords;
+        word_t lastbit = (word_t)1 << ((m - 1) % WORD_BITS);
+        for (int b = 0; b < w; b++) { p->pv[b] = ~(word_t)0; p->mv[b] = 0; }
+        for (int j = 0; j < n; j++) {
+            const word_t *eq = p->peq + lookup_row(p, t[j]) * w;
+            int h = 1;
+            for (int b = 0; b < w-1; b++) {
+                h = advance_block(&p->pv[b], &p->mv[b], eq[b], h, WORD_HIGH);
+            }
+            score += advance_block(&p->pv[w-1], &p->mv[w-1], eq[w-1], h,
+                                   lastbit);
+            if (k >= 0 && score - (n - j - 1) > k) return -1;
+        }
+    }
+    return score;
+}
+
+/* Converts a string or a vector of ids to an int array in *BUF, which
+   is extended as needed.  Returns the length. */
+static int seq_to_codes(ScmObj s, int **buf, int *cap)
+{
+    ScmSmallInt len;
+
+    if (SCM_STRINGP(s)) {
+        const ScmStringBody *body = SCM_STRING_BODY(s);
+        len = SCM_STRING_BODY_LENGTH(body);
+        if (SCM_STRING_BODY_INCOMPLETE_P(body)) len = SCM_STRING_BODY_SIZE(body);
+    } else if (SCM_VECTORP(s)) {
+        len = SCM_VECTOR_SIZE(s);
+    } else {
+        Scm_TypeError("sequence", "string or vector of element ids", s);
+        return 0;               /* dummy */
+    }
+    if (len > INT_MAX / 2) Scm_Error("sequence too long: %S", s);
+    if (len > *cap) {
+        *cap = (int)len;
+        *buf = SCM_NEW_ATOMIC_ARRAY(int, *cap);
+    }
+
+    int *r = *buf;
+    if (SCM_STRINGP(s)) {
+        const ScmStringBody *body = SCM_STRING_BODY(s);
+        const char *p = SCM_STRING_BODY_START(body);
+        if (SCM_STRING_BODY_INCOMPLETE_P(body)) {
+            for (ScmSmallInt i = 0; i < len; i++) r[i] = (unsigned char)p[i];
+        } else {
+            for (ScmSmallInt i = 0; i < len; i++) {
+                ScmChar ch;
+                SCM_CHAR_GET(p, ch);
+                p += SCM_CHAR_NFOLLOWS(*p) + 1;
+                r[i] = (int)ch;
+            }
+        }
+    } else {
+        for (ScmSmallInt i = 0; i < len; i++) {
+            ScmObj e = SCM_VECTOR_ELEMENT(s, i);
+            if (!SCM_INTP(e) || SCM_INT_VALUE(e) < 0
+                || SCM_INT_VALUE(e) > INT_MAX) {
+                Scm_Error("non-negative fixnum required as an element id, "
+                          "but got: %S", e);
+            }
+            r[i] = (int)SCM_INT_VALUE(e);
+        }
+    }
+    return (int)len;
+}
+
+ScmObj Scm__LevenshteinDistances(ScmObj a, ScmObj bs, ScmObj cutoff)
+{
+    long k = -1;
+    int cap = 0, *buf = NULL;
+    lpattern pat;
+    ScmObj h = SCM_NIL, t = SCM_NIL, cp;
+
+    if (SCM_INTP(cutoff) && SCM_INT_VALUE(cutoff) >= 0) {
+        k = SCM_INT_VALUE(cutoff);
+    } else if (!SCM_FALSEP(cutoff)) {
+        Scm_TypeError("cutoff", "#f or non-negative fixnum", cutoff);
+    }
+
+    int m = seq_to_codes(a, &buf, &cap);
+    prepare_pattern(&pat, buf, m);
+
+    SCM_FOR_EACH(cp, bs) {
+        int n = seq_to_codes(SCM_CAR(cp), &buf, &cap);
+        long d = pattern_distance(&pat, buf, n, k);
+        SCM_APPEND1(h, t, (d < 0) ? SCM_FALSE : SCM_MAKE_INT(d));
+    }
+    return h;
+}
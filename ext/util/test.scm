@@ -299,6 +299,46 @@
 (test* "failure continuation #2" (test-error)
        (test-match 1))
 
+;;--------------------------------------------------------------
+
+;; Clauses dispatching on a literal are compiled into 'case'.  Make sure
+;; clause order and fall-through are preserved.
+
+(define (test-dispatch x)
+  (match x
+    [('add a b) (list 'add a b)]
+    [('sub a) (list 'neg a)]
+    [('sub a b) (list 'sub a b)]
+    [('add . r) (list 'add* r)]
+    [('mul a b) (=> next) (if (number? a) (list 'mul a b) (next))]
+    [(1 a) (list 'one a)]
+    [(#\a . _) 'char]
+    [(op . args) (list 'other op args)]
+    ['add 'add-symbol]
+    ['sub 'sub-symbol]
+    [3 'three]
+    [#f 'false]
+    [_ 'else]))
+
+(test* "literal dispatch"
+       '((add 1 2) (neg 1) (sub 1 2) (add* (1 2 3)) (add* ())
+         (mul 2 3) (other mul (x 3)) (one 9) (other 1 (2 3)) char
+         (other div (1 2)) add-symbol sub-symbol three false else else)
+       (map test-dispatch
+            '((add 1 2) (sub 1) (sub 1 2) (add 1 2 3) (add)
+              (mul 2 3) (mul x 3) (1 9) (1 2 3) (#\a #\b)
+              (div 1 2) add sub 3 #f #t ())))
+
+(test* "literal dispatch (duplicate keys)" '(a1 b a2 a3 none)
+       (map (^[x]
+              (match x
+                ['a (=> next) (if (eq? x 'a) 'a1 (next))]
+                ['b 'b]
+                [#\a 'a2]
+                [(? char?) 'a3]
+                [_ 'none]))
+            '(a b #\a #\b "a")))
+
 
 ;;--------------------------------------------------------------
 
@@ -314,4 +354,18 @@
 
 (test* "match in hygienic macro" 1 (gen-match))
 
+;;--------------------------------------------------------------
+(test-section "util.lcs-core")
+(use util.lcs-core)
+(test-module 'util.lcs-core)
+
+(test* "%lcs-matches" '((0 . 0) (2 . 1) (3 . 3))
+       (%lcs-matches '#(0 1 2 3) '#(0 2 4 3)))
+(test* "%lcs-matches (patience)" '((1 . 0) (2 . 1))
+       (%lcs-matches '#(0 1 2) '#(1 2 0) #t))
+(test* "%lcs-matches (empty)" '()
+       (%lcs-matches '#() '#(0 1)))
+(test* "%lcs-matches (bad id)" (test-error)
+       (%lcs-matches '#(a) '#(0)))
+
 (test-end)
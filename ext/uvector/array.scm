@@ -41,7 +41,7 @@
           make-f16array make-f32array make-f64array
           array-concatenate array-transpose array-rotate-90 array-flip array-flip!
           identity-array array-inverse determinant determinant! array-mul array-expt
-          array-div-left array-div-right array-add-elements array-add-elements!
+          array-mul-threads array-div-left array-div-right array-add-elements array-add-elements!
           array-sub-elements array-sub-elements! array-mul-elements array-mul-elements!
           array-div-elements array-div-elements! pretty-print-array
           ))
@@ -50,7 +50,7 @@
 (autoload "gauche/matrix"
   array-concatenate array-transpose array-rotate-90 array-flip array-flip!
   identity-array array-inverse determinant determinant! array-mul array-expt
-  array-div-left array-div-right array-add-elements array-add-elements!
+  array-mul-threads array-div-left array-div-right array-add-elements array-add-elements!
   array-sub-elements array-sub-elements! array-mul-elements array-mul-elements!
   array-div-elements array-div-elements! pretty-print-array)
 
@@ -55,6 +55,10 @@
         c))))
 
 (define (array-transpose a :optional (dim1 0) (dim2 1))
+  (or (and (not (= dim1 dim2)) (flonum-array-transpose a))
+      (generic-array-transpose a dim1 dim2)))
+
+(define (generic-array-transpose a dim1 dim2)
   (let* ([sh (copy-object (array-shape a))]
          [rank (array-rank a)]
          [tmp0 (array-ref sh dim1 0)]
@@ -199,6 +203,11 @@
             (array-set! a i j (/ (array-ref a i j) divisor))))))))
 
 (define (array-inverse a)
+  (if-let1 fast (flonum-array-inverse a)
+    (car fast)
+    (generic-array-inverse a)))
+
+(define (generic-array-inverse a)
   (let* ([start (start-vector-of a)]
          [end (end-vector-of a)]
          [rank (s32vector-length start)]
@@ -250,6 +259,10 @@
 ;; matrix arithmetic
 
 (define (array-mul a b) ; NxM * MxP => NxP
+  (or (flonum-array-mul a b)
+      (generic-array-mul a b)))
+
+(define (generic-array-mul a b)
   (let ([a-start (start-vector-of a)]
         [a-end (end-vector-of a)]
         [b-start (start-vector-of b)]
@@ -281,14 +294,16 @@
             (array-set! res (- i a-start-row) (- k b-start-col) tmp)))))))
 
 (define (array-div-left a b)
-  (if-let1 b-1 (array-inverse b)
-    (array-mul b-1 a)
-    (error "Matrix is not regular:" b)))
+  (or (flonum-array-div-left a b)
+      (if-let1 b-1 (array-inverse b)
+        (array-mul b-1 a)
+        (error "Matrix is not regular:" b))))
 
 (define (array-div-right a b)
-  (if-let1 b-1 (array-inverse b)
-    (array-mul a b-1)
-    (error "Matrix is not regular:" b)))
+  (or (flonum-array-div-right a b)
+      (if-let1 b-1 (array-inverse b)
+        (array-mul a b-1)
+        (error "Matrix is not regular:" b))))
 
 (define (array-expt ar pow)
   (let loop ([a ar] [n pow])
@@ -304,6 +319,125 @@
            (array-mul res a)
            res))])))
 
+;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
+;; native kernels for f32/f64 matrices
+;;
+;; The procedures above have fast paths for rank-2 <f32array> and
+;; <f64array>, which call the C kernels in gauche.uvector.  They return
+;; #f when the fast path doesn't apply, and the callers fall back to
+;; the generic code.
+
+;; Number of threads array-mul may use on f32/f64 matrices.
+(define array-mul-threads (make-parameter 1))
+
+;; If A is a nonempty rank-2 f32 or f64 array, returns a list
+;; (storage offset row-stride col-stride rows cols), which tells where
+;; its elements are in the backing storage.  The mapper of an array is
+;; always affine, so three probes determine it.  Otherwise returns #f.
+(define (flonum-matrix-layout a)
+  (and (memq (class-of a) (list <f32array> <f64array>))
+       (= (array-rank a) 2)
+       (let ([r0 (array-start a 0)] [rows (array-length a 0)]
+             [c0 (array-start a 1)] [cols (array-length a 1)]
+             [mapper (mapper-of a)])
+         (and (> rows 0) (> cols 0)
+              (let1 off (mapper (list r0 c0))
+                (list (backing-storage-of a) off
+                      (if (> rows 1) (- (mapper (list (+ r0 1) c0)) off) 0)
+                      (if (> cols 1) (- (mapper (list r0 (+ c0 1))) off) 0)
+                      rows cols))))))
+
+(define (transposed-layout layout)
+  (let-values ([(s off rs cs rows cols) (apply values layout)])
+    (list s off cs rs cols rows)))
+
+(define (flonum-kernel class f32-proc f64-proc)
+  (if (eq? class <f32array>) f32-proc f64-proc))
+
+;; Returns a rows x cols array of CLASS with dense row-major STORAGE.
+(define (make-flonum-matrix class Vb Ve storage)
+  (make class
+    :start-vector Vb
+    :end-vector   Ve
+    :mapper (generate-amap Vb Ve)
+    :backing-storage storage))
+
+(define (flonum-array-mul a b)
+  (and-let* ([ (eq? (class-of a) (class-of b)) ]
+             [la (flonum-matrix-layout a)]
+             [lb (flonum-matrix-layout b)])
+    (let-values ([(sa oa ra ca n m)  (apply values la)]
+                 [(sb ob rb cb m2 p) (apply values lb)])
+      (and (= m m2)
+           (make-flonum-matrix
+            (class-of a) (s32vector 0 0) (s32vector n p)
+            ((flonum-kernel (class-of a) %f32matrix-mul %f64matrix-mul)
+             sa oa ra ca sb ob rb cb n m p (array-mul-threads)))))))
+
+(define (flonum-array-transpose a)
+  (and-let* ([l (flonum-matrix-layout a)])
+    (let-values ([(s off rs cs rows cols) (apply values (transposed-layout l))])
+      (make-flonum-matrix
+       (class-of a)
+       (s32vector (array-start a 1) (array-start a 0))
+       (s32vector (array-end a 1) (array-end a 0))
+       ((flonum-kernel (class-of a) %f32matrix-pack %f64matrix-pack)
+        s off rs cs rows cols)))))
+
+;; Solves A X = B, where A and B are given by their layouts.  Returns
+;; the storage of X, or #f if A is singular.
+(define (flonum-matrix-solve class la lb)
+  (let-values ([(sa oa ra ca n n2) (apply values la)]
+               [(sb ob rb cb m p)  (apply values lb)])
+    ((flonum-kernel class %f32matrix-solve %f64matrix-solve)
+     sa oa ra ca sb ob rb cb n p)))
+
+(define (flonum-square-layout? l)
+  (= (list-ref l 4) (list-ref l 5)))
+
+;; Returns (X) where X is the inverse of A, or (#f) if A is singular,
+;; so that we can tell it from the case the fast path isn't taken.
+(define (flonum-array-inverse a)
+  (and-let* ([l (flonum-matrix-layout a)]
+             [ (flonum-square-layout? l) ])
+    (let* ([class (class-of a)]
+           [n (list-ref l 4)]
+           [id ((flonum-kernel class make-f32vector make-f64vector) (* n n) 0)])
+      (dotimes [i n] (uvector-set! id (* i (+ n 1)) 1))
+      (list (and-let* ([x (flonum-matrix-solve class l (list id 0 n 1 n n))])
+              (make-flonum-matrix class (s32vector 0 0) (s32vector n n) x))))))
+
+;; B^-1 A is the X such that B X = A.
+(define (flonum-array-div-left a b)
+  (and-let* ([ (eq? (class-of a) (class-of b)) ]
+             [la (flonum-matrix-layout a)]
+             [lb (flonum-matrix-layout b)]
+             [ (flonum-square-layout? lb) ]
+             [ (= (list-ref la 4) (list-ref lb 4)) ])
+    (let1 class (class-of a)
+      (if-let1 x (flonum-matrix-solve class lb la)
+        (make-flonum-matrix class (s32vector 0 0)
+                            (s32vector (list-ref la 4) (list-ref la 5)) x)
+        (error "Matrix is not regular:" b)))))
+
+;; A B^-1 is the X such that X B = A, that is, B^T X^T = A^T.
+(define (flonum-array-div-right a b)
+  (and-let* ([ (eq? (class-of a) (class-of b)) ]
+             [la (flonum-matrix-layout a)]
+             [lb (flonum-matrix-layout b)]
+             [ (flonum-square-layout? lb) ]
+             [ (= (list-ref la 5) (list-ref lb 4)) ])
+    (let ([class (class-of a)]
+          [rows (list-ref la 4)]
+          [cols (list-ref la 5)])
+      (if-let1 xt (flonum-matrix-solve class (transposed-layout lb)
+                                       (transposed-layout la))
+        (make-flonum-matrix class (s32vector 0 0) (s32vector rows cols)
+                            ((flonum-kernel class
+                                            %f32matrix-pack %f64matrix-pack)
+                             xt 0 1 rows rows cols))
+        (error "Matrix is not regular:" b)))))
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;; element-wise operations (advantage over a direct array-map! is
 ;; ability to intermingle scalars)
@@ -287,7 +287,8 @@
                   (every = x y))
              (equal? (list-> x) (list-> y))))))
 
-(for-each (cut uvcomp-tester <> '(() (0) (1) (0 0) (0 1)))
+(for-each (cut uvcomp-tester <> '(() (0) (1) (0 0) (0 1)
+                                  (1 2 3 4 5 6 7 8 9) (1 2 3 4 5 6 7 8 0)))
           (list list->s8vector list->u8vector
                 list->s16vector list->u16vector
                 list->s32vector list->u32vector
@@ -295,7 +296,8 @@
 
 (for-each (cut uvcomp-tester <> '(() (0) (1) (0 0) (0 1)
                                   (+inf.0) (-inf.0) (+nan.0)
-                                  (0 +inf.0) (0 -inf.0) (0 +nan.0)))
+                                  (0 +inf.0) (0 -inf.0) (0 +nan.0)
+                                  (-0.0) (0 -0.0)))
           (list list->f16vector
                 list->f32vector
                 list->f64vector))
@@ -474,6 +476,63 @@
 (uv-append-test "f64vector-append" f64vector f64vector-append)
 
 ;;-------------------------------------------------------------------
+(test-section "sorting")
+
+(let ()
+  (define (lcg n seed)                  ; deterministic pseudo random list
+    (let loop ([i 0] [r seed] [acc '()])
+      (if (= i n)
+        acc
+        (loop (+ i 1) (modulo (+ (* r 1103515245) 12345) 2147483648)
+              (cons r acc)))))
+  (define (check name list->uv uv->list xs)
+    (let1 expected (sort xs <)
+      (test* #"uvector-sort ~name" expected (uv->list (uvector-sort (list->uv xs))))
+      (test* #"uvector-sort! ~name" expected
+             (let1 v (list->uv xs) (uvector-sort! v) (uv->list v)))
+      (test* #"sort ~name" expected (uv->list (sort (list->uv xs))))
+      (test* #"sort! ~name" expected
+             (uv->list (sort! (list->uv xs) default-comparator)))))
+  ;; small ones go through insertion sort, large ones through radix sort
+  (dolist [n '(0 1 10 1000)]
+    (let1 rs (lcg n 1)
+      (check #"s8 ~n" list->s8vector s8vector->list
+             (map (^r (- (modulo r 256) 128)) rs))
+      (check #"u8 ~n" list->u8vector u8vector->list (map (cut modulo <> 256) rs))
+      (check #"s16 ~n" list->s16vector s16vector->list
+             (map (^r (- (modulo r 65536) 32768)) rs))
+      (check #"u16 ~n" list->u16vector u16vector->list
+             (map (cut modulo <> 65536) rs))
+      (check #"s32 ~n" list->s32vector s32vector->list
+             (map (^r (- r 1073741824)) rs))
+      (check #"u32 ~n" list->u32vector u32vector->list rs)
+      (check #"s64 ~n" list->s64vector s64vector->list
+             (map (^r (* (- r 1073741824) 1000000007)) rs))
+      (check #"u64 ~n" list->u64vector u64vector->list
+             (map (^r (* r 4294967296)) rs))
+      (check #"f16 ~n" list->f16vector f16vector->list
+             (map (^r (/ (- (modulo r 2000) 1000) 8.0)) rs))
+      (check #"f32 ~n" list->f32vector f32vector->list
+             (map (^r (/ (- (modulo r 2000000) 1000000) 64.0)) rs))
+      (check #"f64 ~n" list->f64vector f64vector->list
+             (map (^r (* (- r 1073741824) 1.5e100)) rs))))
+  )
+
+(test* "uvector-sort (range)" '#s32(5 2 3 4 1)
+       (rlet1 v (s32vector 5 4 3 2 1) (uvector-sort! v 1 4)))
+(test* "uvector-sort (range copy)" '#u8(2 3 4)
+       (uvector-sort '#u8(5 4 3 2 1) 1 4))
+(test* "uvector-sort (signed zero)" '(-1.0 -0.0 0.0 1.0)
+       (f64vector->list (uvector-sort '#f64(0.0 1.0 -0.0 -1.0))))
+(test* "sort with non-default cmp" '#u8(3 2 1)
+       (sort '#u8(1 3 2) >))
+
+(let ([a (u8vector 0 0 0 0 0 0)])
+  (test* "%uvector-merge!" '#u8(1 2 3 4 5 6)
+         (begin (%uvector-merge! a '#u8(2 4 6 1 3 5) 0 3 6) a))
+  (test* "%uvector-merge! (type mismatch)" (test-error)
+         (%uvector-merge! a '#s8(2 4 6 1 3 5) 0 3 6)))
+
 (test-section "swapping bytes")
 
 (test* "swapb s16"
@@ -780,6 +839,77 @@
 (flonum-arith-test-generate f32)
 (flonum-arith-test-generate f64)
 
+;; Long uvectors of the same type go through the fast path kernels,
+;; which work on blocks of elements.  Compare the results with the
+;; generic path, which we get by passing the second operand as a vector.
+(define-macro (long-arith-test-generate tag)
+  `(long-arith-test ',tag ,(tag->min tag) ,(tag->max tag)
+                    ,(string->symbol #"list->~|tag|vector")
+                    ,(string->symbol #"~|tag|vector-add")
+                    ,(string->symbol #"~|tag|vector-sub")
+                    ,(string->symbol #"~|tag|vector-mul")
+                    ,(string->symbol #"~|tag|vector-dot")
+                    ,(string->symbol #"~|tag|vector-range-check")
+                    ,(string->symbol #"~|tag|vector-clamp")))
+
+(define (long-arith-test tag lo hi make add sub mul dot range-check clamp)
+  (define n 1000)
+  (define (full k)  ; wraps around the range
+    (make (map (^i (+ lo (modulo (* i k) (+ (- hi lo) 1)))) (iota n))))
+  (define (tiny k)
+    (make (map (^i (modulo (* i k) 7)) (iota n))))
+  (define (small k) ; like tiny, but has hi at index 700
+    (make (map (^i (if (= i 700) hi (modulo (* i k) 7))) (iota n))))
+  (define (generic op x y clamp)
+    (op x (coerce-to <vector> y) clamp))
+  (dolist [op (list add sub mul)]
+    (test* (format #f "~avector long" tag)
+           (generic op (full 7) (full 13) 'both)
+           (op (full 7) (full 13) 'both))
+    (test* (format #f "~avector long, late overflow" tag)
+           (generic op (small 3) (small 5) 'both)
+           (op (small 3) (small 5) 'both)))
+  (test* (format #f "~avector long, no overflow" tag)
+         (generic add (tiny 3) (tiny 5) #f)
+         (add (tiny 3) (tiny 5)))
+  (test* (format #f "~avector long, late overflow error" tag)
+         (test-error)
+         (add (small 3) (small 5)))
+  (test* (format #f "~avector long dot" tag)
+         (fold (^[a b s] (+ s (* a b))) 0
+               (coerce-to <list> (full 7)) (coerce-to <list> (full 13)))
+         (dot (full 7) (full 13)))
+  (test* (format #f "~avector long range-check" tag)
+         700
+         (range-check (small 3) 0 6))
+  (test* (format #f "~avector long clamp" tag)
+         (make (map (^i (if (= i 700) 6 (max 2 (modulo (* i 3) 7)))) (iota n)))
+         (clamp (small 3) 2 6)))
+
+(long-arith-test-generate s8)
+(long-arith-test-generate u8)
+(long-arith-test-generate s16)
+(long-arith-test-generate u16)
+(long-arith-test-generate s32)
+(long-arith-test-generate u32)
+
+(let ([x (list->f64vector (map (^i (/ i 7.0)) (iota 1000)))]
+      [y (list->f64vector (map (^i (- 500.0 i)) (iota 1000)))]
+      [fx (list->f32vector (map (^i (/ i 7.0)) (iota 1000)))]
+      [fy (list->f32vector (map (^i (- 500.0 i)) (iota 1000)))])
+  (test* "f64vector long add" (f64vector-add x (coerce-to <vector> y))
+         (f64vector-add x y))
+  (test* "f64vector long div" (f64vector-div x (coerce-to <vector> y))
+         (f64vector-div x y))
+  (test* "f64vector long mul by constant"
+         (list->f64vector (map (^i (* (/ i 7.0) 0.1)) (iota 1000)))
+         (f64vector-mul x 0.1))
+  (test* "f32vector long sub" (f32vector-sub fx (coerce-to <vector> fy))
+         (f32vector-sub fx fy))
+  (test* "f32vector long add constant"
+         (f32vector-add fx (make-vector 1000 0.1))
+         (f32vector-add fx 0.1)))
+
 ;;-------------------------------------------------------------------
 (test-section "bitwise operations")
 
@@ -1329,6 +1459,201 @@
 (clamp-test-generate u64 #u64(127 0 4 200 255)
                      #u64(3 3 3 3 3) #u64(199 199 199 199 199))
 
+;;-------------------------------------------------------------------
+(test-section "reductions")
+
+(define-macro (reduction-test-generate tag)
+  `(reduction-test ',tag ,(tag->min tag) ,(tag->max tag)
+                   ,(string->symbol #"list->~|tag|vector")
+                   ,@(map (^[op] (string->symbol #"~|tag|vector-~|op|"))
+                          '(sum min max argmin argmax histogram))))
+
+(define (reduction-test tag lo hi make vsum vmin vmax vargmin vargmax
+                        histogram)
+  (define n 1000)
+  (define (elt i) (+ lo (modulo (* i 37) (+ (- hi lo) 1))))
+  (define elts (map elt (iota n)))
+  (define v (make elts))
+  (define (first-index-of x lis)
+    (list-index (cut = x <>) lis))
+  (test* (format #f "~avector-sum" tag) (apply + elts) (vsum v))
+  (test* (format #f "~avector-sum (start/end)" tag)
+         (apply + (take (drop elts 10) 500))
+         (vsum v 10 510))
+  (test* (format #f "~avector-sum (empty)" tag) 0 (vsum v 3 3))
+  (test* (format #f "~avector-sum (extremes)" tag)
+         (* 500 (+ lo hi))
+         (vsum (make (map (^i (if (even? i) lo hi)) (iota 1000)))))
+  (test* (format #f "~avector-min" tag) (apply min elts) (vmin v))
+  (test* (format #f "~avector-max" tag) (apply max elts) (vmax v))
+  (test* (format #f "~avector-min (start/end)" tag)
+         (apply min (take (drop elts 5) 3))
+         (vmin v 5 8))
+  (test* (format #f "~avector-argmin" tag)
+         (first-index-of (apply min elts) elts)
+         (vargmin v))
+  (test* (format #f "~avector-argmax" tag)
+         (first-index-of (apply max elts) elts)
+         (vargmax v))
+  (test* (format #f "~avector-argmax (start/end)" tag)
+         (+ 100 (first-index-of (apply max (drop elts 100)) (drop elts 100)))
+         (vargmax v 100))
+  (test* (format #f "~avector-min/max (empty)" tag)
+         '(#f #f #f #f)
+         (list (vmin v 0 0) (vmax v 0 0) (vargmin v 0 0) (vargmax v 0 0)))
+  (test* (format #f "~avector-histogram" tag)
+         (let1 h (make-vector 4 0)
+           (dolist [x elts]
+             (let1 k (floor->exact (/ (* 4 (- x lo)) (+ (- hi lo) 1)))
+               (inc! (vector-ref h k))))
+           (vector->u32vector h))
+         (histogram v 4 lo (+ hi 1)))
+  (test* (format #f "~avector-histogram (out of range)" tag)
+         #u32(1 1 0)
+         (histogram (make '(0 1 2 3 4 5 6)) 3 2 5 1 4))
+  )
+
+(reduction-test-generate s8)
+(reduction-test-generate u8)
+(reduction-test-generate s16)
+(reduction-test-generate u16)
+(reduction-test-generate s32)
+(reduction-test-generate u32)
+(reduction-test-generate s64)
+(reduction-test-generate u64)
+
+(test* "s64vector-sum (overflow)"
+       (* 3 (- (expt 2 63) 1))
+       (s64vector-sum (s64vector (- (expt 2 63) 1) (- (expt 2 63) 1)
+                                 (- (expt 2 63) 1))))
+(test* "u64vector-sum (overflow)"
+       (* 3 (- (expt 2 64) 1))
+       (u64vector-sum (u64vector (- (expt 2 64) 1) (- (expt 2 64) 1)
+                                 (- (expt 2 64) 1))))
+
+(let ([x (list->f64vector (map (^i (/ i 7.0)) (iota 1000)))]
+      [y (f32vector 1.5 -2.0 +inf.0 0.25)]
+      [z (f64vector 1.0 +nan.0 -3.0 +nan.0)])
+  (test* "f64vector-sum" (fold + 0 (f64vector->list x)) (f64vector-sum x))
+  (test* "f64vector-sum (empty)" 0.0 (f64vector-sum x 10 10))
+  (test* "f32vector-sum" +inf.0 (f32vector-sum y))
+  (test* "f32vector-sum (start/end)" -0.5 (f32vector-sum y 0 2))
+  (test* "f16vector-sum" 0.75 (f16vector-sum (f16vector 0.5 0.25)))
+  (test* "f64vector-min" 0.0 (f64vector-min x))
+  (test* "f64vector-argmax" 999 (f64vector-argmax x))
+  (test* "f32vector-min/max" '(-2.0 +inf.0) (list (f32vector-min y)
+                                                 (f32vector-max y)))
+  (test* "f64vector-min (nan)" #t (nan? (f64vector-min z)))
+  (test* "f64vector-argmin (nan)" 1 (f64vector-argmin z))
+  (test* "f64vector-argmax (nan)" 3 (f64vector-argmax z 2))
+  (test* "f64vector-histogram" #u32(7 7 7 7 7)
+         (f64vector-histogram x 5 0.0 5.0))
+  (test* "f64vector-histogram (nan)" #u32(0 1)
+         (f64vector-histogram z 2 0.0 2.0))
+  (test* "f64vector-histogram (bad nbins)" (test-error)
+         (f64vector-histogram x 0 0.0 1.0))
+  (test* "f64vector-histogram (bad range)" (test-error)
+         (f64vector-histogram x 3 1.0 1.0)))
+
+;;-------------------------------------------------------------------
+(test-section "uvector view")
+
+(let* ([base (s16vector 0 1 2 3 4 5 6 7 8 9)]
+       [odd  (uvector-view base 1 2)]
+       [rev  (uvector-view base 9 -1)])
+  (test* "uvector-view?" '(#t #f) (list (uvector-view? odd)
+                                        (uvector-view? base)))
+  (test* "uvector-view (length)" '(5 10 3 0)
+         (list (uvector-view-length odd)
+               (uvector-view-length rev)
+               (uvector-view-length (uvector-view base 2 0 3))
+               (uvector-view-length (uvector-view base 10))))
+  (test* "uvector-view->uvector" '(#s16(1 3 5 7 9) #s16(9 8 7 6 5 4 3 2 1 0))
+         (list (uvector-view->uvector odd)
+               (uvector-view->uvector rev)))
+  (test* "uvector-view->uvector (start/end)" #s16(3 5 7)
+         (uvector-view->uvector odd 1 4))
+  (test* "uvector-view of view" #s16(8 6 4 2 0)
+         (uvector-view->uvector (uvector-view rev 1 2)))
+  (test* "uvector-view of view (base)" #t
+         (eq? base (slot-ref (uvector-view rev 1 2) 'base)))
+  (test* "uvector-view-ref" '(7 9 fallback)
+         (list (uvector-view-ref odd 3)
+               (uvector-view-ref rev 0)
+               (uvector-view-ref odd 5 'fallback)))
+  (test* "uvector-view-ref (out of range)" (test-error)
+         (uvector-view-ref odd 5))
+  (test* "uvector-view (out of range)" (test-error)
+         (uvector-view base 1 3 4))
+  (test* "uvector-view (negative stride, out of range)" (test-error)
+         (uvector-view base 5 -2 4))
+  (test* "uvector-view (zero stride without length)" (test-error)
+         (uvector-view base 0 0))
+  (test* "uvector-view (not a uvector)" (test-error)
+         (uvector-view '#(1 2 3)))
+  (test* "uvector-view-set!" #s16(0 -1 2 3 4 5 6 7 8 -9)
+         (let1 b (s16vector-copy base)
+           (uvector-view-set! (uvector-view b 1 2) 0 -1)
+           (set! (uvector-view-ref (uvector-view b 9 -1) 0) -9)
+           b))
+  (test* "uvector-view-set! (clamp)" #s16(32767 1 2)
+         (let1 b (s16vector 0 1 2)
+           (uvector-view-set! (uvector-view b) 0 100000 'both)
+           b))
+  (test* "uvector-view-set! (immutable)" (test-error)
+         (uvector-view-set! (uvector-view '#s16(0 1 2)) 0 1))
+  (test* "collection interface" '(25 (1 3 5 7 9) #(9 8 7 6 5 4 3 2 1 0))
+         (list (fold + 0 odd)
+               (coerce-to <list> odd)
+               (coerce-to <vector> rev)))
+  (test* "sequence interface" '(7 #s16(8 7 6))
+         (list (ref odd 3) (subseq rev 1 4)))
+  )
+
+(let ([m (f64vector 0 1 2 3 4 5)])     ;; 2x3 matrix in row-major order
+  (test* "uvector-view column" #f64(1.0 4.0)
+         (uvector-view->uvector (uvector-view m 1 3)))
+  (test* "uvector-view as operand" #f64(10.0 40.0)
+         (f64vector-mul #f64(10.0 10.0) (uvector-view m 1 3)))
+  (test* "uvector-view as operand (dot)" 17.0
+         (f64vector-dot #f64(1.0 4.0) (uvector-view m 1 3)))
+  (test* "uvector-view as operand (size mismatch)" (test-error)
+         (f64vector-add #f64(1.0 2.0 3.0) (uvector-view m 1 3))))
+
+(let1 copy! (^[dst dstart src . args]
+              (apply uvector-view-copy! dst dstart src args)
+              dst)
+  (test* "uvector-view-copy! uvector -> view" #u8(1 0 2 0 3 0)
+         (let1 d (make-u8vector 6 0)
+           (copy! (uvector-view d 0 2) 0 #u8(1 2 3))
+           d))
+  (test* "uvector-view-copy! view -> uvector" #u8(5 3 1 0)
+         (copy! (make-u8vector 4 0) 0 (uvector-view #u8(1 2 3 4 5) 4 -2)))
+  (test* "uvector-view-copy! (truncate)" #u8(0 0 1 2)
+         (copy! (make-u8vector 4 0) 2 #u8(1 2 3)))
+  (test* "uvector-view-copy! (overlap)" #u8(5 4 3 2 1)
+         (let1 v (u8vector 1 2 3 4 5)
+           (uvector-view-copy! v 0 (uvector-view v 4 -1))
+           v))
+  (test* "uvector-view-copy! (type mismatch)" (test-error)
+         (copy! (make-u8vector 4 0) 0 (uvector-view #s8(1 2 3)))))
+
+(let1 v (u16vector #x0102 #x0304 #x0506 #x0708)
+  (test* "write-uvector view" #u8(1 2 5 6)
+         (string->u8vector
+          (call-with-output-string
+            (cut write-uvector (uvector-view v 0 2) <> 0 -1 'big-endian))))
+  (test* "write-uvector view (stride 1)" #u8(4 3 6 5)
+         (string->u8vector
+          (call-with-output-string
+            (cut write-uvector (uvector-view v 1 1 2) <> 0 -1 'little-endian))))
+  (test* "write-uvector view (long)" 10000
+         (let1 big (make-u8vector 20000 7)
+           (u8vector-length
+            (string->u8vector
+             (call-with-output-string
+               (cut write-uvector (uvector-view big 0 2) <>)))))))
+
 ;;-------------------------------------------------------------------
 (test-section "block i/o")
 
@@ -1663,6 +1988,119 @@
               [dst (uvector-alias <u8vector> src)])
          (u8vector-set! dst 0 1)))
 
+;;-------------------------------------------------------------------
+(test-section "mapped uvector")
+
+(cond-expand
+ [gauche.os.windows]
+ [else
+  (let ([file "test.mapped"])
+    (define (cleanup) (when (file-exists? file) (sys-unlink file)))
+    (test* "anonymous" '(#t 0.0 3.0 6.0)
+           (let1 v (make-mapped-uvector <f64vector> 1000)
+             (f64vector-set! v 999 3.0)
+             (f64vector-mul! v 2.0)
+             (list (f64vector? v) (f64vector-ref v 0) (/ (f64vector-ref v 999) 2)
+                   (f64vector-ref v 999))))
+    (test* "anonymous alias" '#u8(1 0 0 0)
+           (let* ([v (make-mapped-uvector <u32vector> 4)]
+                  [a (uvector-alias <u8vector> v 0 1)])
+             (set! v #f)
+             (gc)
+             (u8vector-set! a 0 1)
+             a))
+    (test* "empty" 0 (uvector-length (make-mapped-uvector <u8vector> 0)))
+    (cleanup)
+    (with-output-to-file file
+      (cut write-uvector (u8vector-copy '#u8(0 1 2 3 4 5 6 7 8 9))))
+    (test* "file (read)" '#u8(0 1 2 3 4 5 6 7 8 9)
+           (make-mapped-uvector <u8vector> #f :file file))
+    (test* "file (read, offset)" '#u8(3 4 5)
+           (make-mapped-uvector <u8vector> 3 :file file :offset 3))
+    (test* "file (read, immutable)" (test-error)
+           (u8vector-set! (make-mapped-uvector <u8vector> #f :file file) 0 1))
+    (test* "file (read, too short)" (test-error)
+           (make-mapped-uvector <u8vector> 11 :file file))
+    (test* "file (private)" '(#u8(99 1 2) #u8(0 1 2))
+           (let1 v (make-mapped-uvector <u8vector> 3 :file file :mode :private)
+             (u8vector-set! v 0 99)
+             (list v (make-mapped-uvector <u8vector> 3 :file file))))
+    (test* "file (write)" '#u8(99 1 2 3 4 5 6 7 8 9 0 0)
+           (let1 v (make-mapped-uvector <u8vector> 12 :file file :mode :write)
+             (u8vector-set! v 0 99)
+             (make-mapped-uvector <u8vector> #f :file file)))
+    (test* "file (u16, size from file)" 6
+           (uvector-length (make-mapped-uvector <u16vector> #f :file file)))
+    (test* "bad mode" (test-error)
+           (make-mapped-uvector <u8vector> 3 :file file :mode :bogus))
+    (test* "size required" (test-error)
+           (make-mapped-uvector <u8vector> #f))
+    (test* "fd" '#u8(99 1 2 3 4 5 6 7 8 9 0 0)
+           (call-with-input-file file
+             (^p (make-mapped-uvector <u8vector> #f
+                                      :fd (port-file-number p)))))
+    (test* "file and fd" (test-error)
+           (make-mapped-uvector <u8vector> #f :file file :fd 0))
+    (cleanup))
+
+  (test* "shared" '(#t #f 0 #u32(7 0 0 8))
+         (let* ([v (make-shared-uvector <u32vector> 4)]
+                [w (make-mapped-uvector <u32vector> #f
+                                        :fd (shared-uvector-fd v)
+                                        :mode :write)])
+           (u32vector-set! v 0 7)
+           (u32vector-set! w 3 8)
+           (list (integer? (shared-uvector-fd v))
+                 (shared-uvector-fd (make-u32vector 4))
+                 (u32vector-ref v 1)
+                 w)))
+  (test* "shared alias" #t
+         (let1 v (make-shared-uvector <u8vector> 8)
+           (eqv? (shared-uvector-fd v)
+                 (shared-uvector-fd (uvector-alias <u32vector> v)))))
+  (test* "shared across fork" '(1 2 3)
+         (let1 v (make-shared-uvector <s64vector> 3)
+           (flush)
+           (let1 pid (sys-fork)
+             (when (zero? pid)
+               (s64vector-set! v 0 1)
+               (uvector-atomic-add! v 1 2)
+               (sys-exit 0))
+             (sys-waitpid pid)
+             (s64vector-set! v 2 3)
+             (s64vector->list v))))
+  ])
+
+(test-section "uvector atomic operations")
+
+(test* "atomic ref/set!" '(0 -5 -5)
+       (let1 v (make-s32vector 2)
+         (list (uvector-atomic-ref v 0)
+               (begin (uvector-atomic-set! v 1 -5) (uvector-atomic-ref v 1))
+               (s32vector-ref v 1))))
+(test* "atomic add!" '(10 13 #u32(11 4294967295))
+       (let1 v (u32vector 10 0)
+         (list (uvector-atomic-add! v 0 3)
+               (uvector-atomic-add! v 0 -2)
+               (begin (uvector-atomic-add! v 1 -1) v))))
+(test* "atomic add! (64bit)" '(#xffffffffffffffff #u64(0))
+       (let1 v (u64vector #xffffffffffffffff)
+         (list (uvector-atomic-add! v 0 1) v)))
+(test* "atomic compare-and-swap!" '(1 #s64(2) 2 #s64(2))
+       (let1 v (s64vector 1)
+         (list (uvector-atomic-compare-and-swap! v 0 1 2)
+               (s64vector-copy v)
+               (uvector-atomic-compare-and-swap! v 0 1 3)
+               v)))
+(test* "atomic, unsupported type" (test-error)
+       (uvector-atomic-ref (make-u8vector 4) 0))
+(test* "atomic, out of range" (test-error)
+       (uvector-atomic-ref (make-u32vector 4) 4))
+(test* "atomic, out of element range" (test-error)
+       (uvector-atomic-set! (make-u32vector 4) 0 -1))
+(test* "atomic, immutable" (test-error)
+       (uvector-atomic-add! #u32(1 2) 0 1))
+
 ;;-------------------------------------------------------------------
 ; (use gauche.array)
 (test-section "gauche.array")
@@ -2347,6 +2785,61 @@
       #,(<s16array> (0 1 0 1) 204))
      )))
 
+;; f32 and f64 matrices go through the native kernels.  Compare them
+;; with the results of the naive algorithm.
+(let ()
+  (define (rand-array class r0 rows c0 cols seed)
+    (rlet1 a ((if (eq? class <f64array>) make-f64array make-f32array)
+              (shape r0 (+ r0 rows) c0 (+ c0 cols)))
+      (array-retabulate! a (^[i j] (- (modulo (* (+ seed i) (+ 3 j) 37) 19) 9)))))
+  (define (naive-mul a b)
+    (let ([n (array-length a 0)] [m (array-length a 1)] [p (array-length b 1)]
+          [a0 (array-start a 0)] [a1 (array-start a 1)]
+          [b0 (array-start b 0)] [b1 (array-start b 1)])
+      (rlet1 c (make-array (shape 0 n 0 p))
+        (dotimes [i n]
+          (dotimes [k p]
+            (array-set! c i k
+                        (fold (^[j s] (+ s (* (array-ref a (+ a0 i) (+ a1 j))
+                                              (array-ref b (+ b0 j) (+ b1 k)))))
+                              0 (iota m))))))))
+  (define (transposed a)
+    (share-array a (shape (array-start a 1) (array-end a 1)
+                          (array-start a 0) (array-end a 0))
+                 (^[i j] (values j i))))
+
+  (dolist [class (list <f64array> <f32array>)]
+    (let ([a (rand-array class 0 37 0 53 1)]
+          [b (rand-array class 3 53 2 29 2)]
+          [bt (rand-array class 0 29 0 53 3)])
+      (test* #"array-mul ~(class-name class)" (naive-mul a b)
+             (array-mul a b) array-approx-equal?)
+      (test* #"array-mul ~(class-name class) class" class
+             (class-of (array-mul a b)))
+      (test* #"array-mul ~(class-name class) (shared)"
+             (naive-mul a (transposed bt))
+             (array-mul a (transposed bt)) array-approx-equal?)
+      (test* #"array-mul ~(class-name class) (threads)" (naive-mul a b)
+             (parameterize ([array-mul-threads 3]) (array-mul a b))
+             array-approx-equal?)
+      (test* #"array-transpose ~(class-name class)" (transposed b)
+             (array-transpose b) array-approx-equal?)))
+
+  (let ([a #,(<f64array> (0 3 0 3) 1 5 2 1 1 7 0 -3 4)]
+        [b #,(<f64array> (0 3 0 2) 1 2 3 4 5 6)]
+        [c #,(<f64array> (0 2 0 3) 1 2 3 4 5 6)])
+    (test* "array-inverse f64array"
+           #,(<array> (0 3 0 3) -25 26 -33 4 -4 5 3 -3 4)
+           (array-inverse a) array-approx-equal?)
+    (test* "array-inverse f64array (singular)" #f
+           (array-inverse #,(<f64array> (0 2 0 2) 1 2 3 6)))
+    (test* "array-div-left f64array" b
+           (array-mul a (array-div-left b a)) array-approx-equal?)
+    (test* "array-div-right f64array" c
+           (array-mul (array-div-right c a) a) array-approx-equal?)
+    (test* "array-div-left f64array (singular)" (test-error)
+           (array-div-left b #,(<f64array> (0 3 0 3) 1 2 3 2 4 6 0 0 1)))))
+
 
 ;;-------------------------------------------------------------------
 ;; NB: copy-port uses read-block! and write-block for block copy,
@@ -129,6 +129,111 @@
    Scm_UVectorAlias)
  )
 
+;; strided view
+(inline-stub
+ (define-type <uvector-view> "ScmUVectorView*" "uvector view"
+   "SCM_UVECTOR_VIEW_P" "SCM_UVECTOR_VIEW" "SCM_OBJ")
+
+ (define-cclass <uvector-view> "ScmUVectorView*" "Scm_UVectorViewClass"
+   ("Scm_SequenceClass" "Scm_CollectionClass")
+   ((base   :type <uvector> :setter #f)
+    (offset :type <fixnum> :setter #f)
+    (stride :type <fixnum> :setter #f)
+    (length :type <fixnum> :setter #f))
+   (printer
+    (let* ([v::ScmUVectorView* (SCM_UVECTOR_VIEW obj)])
+      (Scm_Printf port "#<%s-view %ld @%p>"
+                  (Scm_UVectorTypeName
+                   (Scm_UVectorType (Scm_ClassOf (SCM_OBJ (-> v base)))))
+                  (-> v length) obj))))
+
+ (define-cproc uvector-view (v :optional (offset::<fixnum> 0)
+                                         (stride::<fixnum> 1)
+                                         (length::<fixnum> -1))
+   Scm_MakeUVectorView)
+
+ (define-cproc uvector-view? (obj) ::<boolean> SCM_UVECTOR_VIEW_P)
+
+ (define-cproc uvector-view-length (v::<uvector-view>) ::<fixnum>
+   (return (-> v length)))
+
+ (define-cproc uvector-view-set! (v::<uvector-view> k::<fixnum> val
+                                  :optional clamp) ::<void> :fast-flonum
+   (Scm_UVectorViewSet v k val (clamp-arg clamp)))
+
+ (define-cproc uvector-view-ref (v::<uvector-view> k::<fixnum>
+                                 :optional fallback) :fast-flonum
+   (setter uvector-view-set!)
+   (return (Scm_UVectorViewRef v k fallback)))
+
+ (define-cproc uvector-view->uvector (v::<uvector-view>
+                                      :optional (start::<fixnum> 0)
+                                                (end::<fixnum> -1))
+   Scm_UVectorViewToUVector)
+
+ ;; Either side can be a uvector or a view of the same element type.
+ (define-cproc uvector-view-copy! (dest dstart::<fixnum> src
+                                   :optional (sstart::<fixnum> 0)
+                                             (send::<fixnum> -1))
+   ::<void> Scm_UVectorViewCopyX)
+ )
+
+;; memory-mapped uvector
+(inline-stub
+ (define-cproc make-mapped-uvector (klass::<class> size
+                                    :key (file #f) (fd #f) (offset 0) (mode #f))
+   (let* ([path::ScmString* NULL]
+          [sz::ScmSmallInt -1]
+          [m::int SCM_UVECTOR_MAP_PRIVATE]
+          [from-file::int (or (SCM_STRINGP file) (not (SCM_FALSEP fd)))])
+     (cond [(SCM_STRINGP file) (set! path (SCM_STRING file))]
+           [(not (SCM_FALSEP file))
+            (SCM_TYPE_ERROR file "string or #f")])
+     (cond [(SCM_FALSEP fd)]
+           [(not (SCM_INTP fd)) (SCM_TYPE_ERROR fd "fixnum or #f")]
+           [(!= path NULL) (Scm_Error "file and fd can't be given together")])
+     (cond [(and (SCM_INTP size) (>= (SCM_INT_VALUE size) 0))
+            (set! sz (SCM_INT_VALUE size))]
+           [(not (and (SCM_FALSEP size) from-file))
+            (Scm_Error "size must be a nonnegative fixnum, or #f with file: %S"
+                       size)])
+     (cond [(SCM_FALSEP mode)
+            (set! m (?: from-file
+                        SCM_UVECTOR_MAP_READ
+                        SCM_UVECTOR_MAP_PRIVATE))]
+           [(SCM_EQ mode ':read)    (set! m SCM_UVECTOR_MAP_READ)]
+           [(SCM_EQ mode ':write)   (set! m SCM_UVECTOR_MAP_WRITE)]
+           [(SCM_EQ mode ':private) (set! m SCM_UVECTOR_MAP_PRIVATE)]
+           [else (SCM_TYPE_ERROR mode ":read, :write, :private or #f")])
+     (if (SCM_INTP fd)
+       (return (Scm_MakeMappedUVectorFd klass sz (SCM_INT_VALUE fd)
+                                        (Scm_IntegerToOffset offset) m))
+       (return (Scm_MakeMappedUVector klass sz path
+                                      (Scm_IntegerToOffset offset) m)))))
+
+ ;; Shared memory segment, inherited by forked processes, and mappable
+ ;; by others through its file descriptor.
+ (define-cproc make-shared-uvector (klass::<class> size::<fixnum>)
+   Scm_MakeSharedUVector)
+
+ (define-cproc shared-uvector-fd (v::<uvector>)
+   (let* ([fd::int (Scm_SharedUVectorFd v)])
+     (return (?: (< fd 0) SCM_FALSE (SCM_MAKE_INT fd)))))
+ )
+
+;; atomic element operations (s32, u32, s64 and u64vector)
+(inline-stub
+ (define-cproc uvector-atomic-ref (v::<uvector> k::<fixnum>)
+   Scm_UVectorAtomicRef)
+ (define-cproc uvector-atomic-set! (v::<uvector> k::<fixnum> val) ::<void>
+   Scm_UVectorAtomicSet)
+ (define-cproc uvector-atomic-add! (v::<uvector> k::<fixnum> delta)
+   Scm_UVectorAtomicAdd)
+ (define-cproc uvector-atomic-compare-and-swap! (v::<uvector> k::<fixnum>
+                                                 expected desired)
+   Scm_UVectorAtomicCompareAndSwap)
+ )
+
 ;; byte swapping
 (inline-stub
  (define-cise-stmt swap-bytes-common
@@ -264,12 +369,18 @@
              (return (Scm_UVectorAlias klass v 0 n))
              (return (SCM_OBJ v))))))))
 
- (define-cproc write-uvector (v::<uvector>
+ (define-cproc write-uvector (v
                               :optional (port::<output-port> (current-output-port))
                                         (start::<fixnum> 0)
                                         (end::<fixnum> -1)
                                         (endian::<symbol>? #f))
-   Scm_WriteBlock)
+   (cond [(SCM_UVECTORP v)
+          (return (Scm_WriteBlock (SCM_UVECTOR v) port start end endian))]
+         [(SCM_UVECTOR_VIEW_P v)
+          (return (Scm_WriteUVectorView (SCM_UVECTOR_VIEW v) port
+                                        start end endian))]
+         [else (SCM_TYPE_ERROR v "uvector or uvector view")
+               (return SCM_UNDEFINED)]))
  )
 
 ;; copy
@@ -290,6 +401,26 @@
               size)))
  )
 
+;; sorting
+(inline-stub
+ (define-cproc uvector-sort! (v::<uvector>
+                              :optional (start::<fixnum> 0) (end::<fixnum> -1))
+   ::<void>
+   (SCM_CHECK_START_END start end (SCM_UVECTOR_SIZE v))
+   (Scm_UVectorSortX v start end))
+
+ ;; Merges sorted [start, mid) and [mid, end) of SRC into DST.
+ ;; Used by parallel-sort in control.parallel.
+ (define-cproc %uvector-merge! (dst::<uvector> src::<uvector>
+                                start::<fixnum> mid::<fixnum> end::<fixnum>)
+   ::<void>
+   Scm_UVectorMergeX)
+ )
+
+(define (uvector-sort v :optional (start 0) (end -1))
+  (rlet1 r (uvector-copy v start end)
+    (uvector-sort! r)))
+
 ;; String operations
 (inline-stub
  ;; A common operation to extract range of char* from the input string S.
@@ -575,6 +706,21 @@
 (%define-srfi-4-collection-interface f32)
 (%define-srfi-4-collection-interface f64)
 
+;; views
+(define-method call-with-iterator ((v <uvector-view>) proc :key (start #f))
+  (let* ([len (uvector-view-length v)] [i (or start 0)])
+    (proc (^[] (>= i len))
+          (^[] (rlet1 r (uvector-view-ref v i) (inc! i))))))
+(define-method referencer ((v <uvector-view>)) uvector-view-ref)
+(define-method modifier   ((v <uvector-view>)) uvector-view-set!)
+(define-method size-of ((v <uvector-view>)) (uvector-view-length v))
+(define-method coerce-to ((c <list-meta>) (v <uvector-view>))
+  (coerce-to <list> (uvector-view->uvector v)))
+(define-method coerce-to ((c <vector-meta>) (v <uvector-view>))
+  (coerce-to <vector> (uvector-view->uvector v)))
+(define-method subseq ((v <uvector-view>) . args)
+  (apply uvector-view->uvector v args))
+
 ;; some special cases
 (define-method coerce-to ((dst <string-meta>) (src <u8vector>))
   (u8vector->string src))
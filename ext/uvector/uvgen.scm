@@ -305,23 +305,48 @@
 ;; Uvector opertaion generator
 ;;
 
+;; Element types that have fast path kernels (*_fast) in the prologue.
+(define *fast-kernel-tags* '("s8" "u8" "s16" "u16" "s32" "u32" "f32" "f64"))
+
+(define (fast-kernel? rule)
+  (member (getval rule 't) *fast-kernel-tags*))
+
+;; C expr to access the element array of uvector V.
+(define (elements rule v)
+  #"SCM_~(getval rule 'T)VECTOR_ELEMENTS(~|v|)")
+
 (define (generate-numop)
+  (define (gen opname Opname Sopname rule)
+    (define tag (getval rule 't))
+    ;; Returns the number of elements the kernel handled.
+    (define (FASTOP d s0 s1 size)
+      (if (fast-kernel? rule)
+        (string-append
+         #"(SCM_~(getval rule 'T)VECTORP(~|s1|)? "
+         #"~|tag|vector_~|opname|_fast(~(elements rule d), "
+         #"~(elements rule s0), ~(elements rule s1), ~|size|) : 0)")
+        "0"))
+    (define (FASTOPC d s0 v1 size oor)
+      (if (member tag '("f32" "f64"))
+        (string-append
+         #"(!~|oor|? ~|tag|vector_~|opname|_fastc(~(elements rule d), "
+         #"~(elements rule s0), ~|v1|, ~|size|) : 0)")
+        "0"))
+    (for-each (cute substitute <> `((opname  ,opname)
+                                    (Opname  ,Opname)
+                                    (Sopname ,Sopname)
+                                    (FASTOP  ,FASTOP)
+                                    (FASTOPC ,FASTOPC)
+                                    ,@rule))
+              *tmpl-numop*))
   (for-each (^[opname Opname Sopname]
               (dolist [rule (make-rules)]
-                (for-each (cute substitute <> `((opname  ,opname)
-                                                (Opname  ,Opname)
-                                                (Sopname ,Sopname)
-                                                ,@rule))
-                          *tmpl-numop*)))
+                (gen opname Opname Sopname rule)))
             '("add" "sub" "mul")
             '("Add" "Sub" "Mul")
             '("Add" "Sub" "Mul"))
   (dolist [rule (make-flonum-rules)]
-    (for-each (cute substitute <> `((opname  "div")
-                                    (Opname  "Div")
-                                    (Sopname  "Div")
-                                    ,@rule))
-              *tmpl-numop*)))
+    (gen "div" "Div" "Div" rule)))
 
 (define (generate-bitop)
   (dolist [rule (make-integer-rules)]
@@ -355,7 +380,14 @@
         (case tag
           [(s64 u64) #"SCM_SET_INT64_ZERO(~r)"]
           [else #"~r = 0"]))
-      (for-each (cute substitute <> `((ZERO  ,ZERO) ,@rule))
+      (define (FASTDOT x y size rr)
+        (if (memq tag '(s8 u8 s16 u16))
+          (string-append
+           #"(SCM_~(getval rule 'T)VECTORP(~|y|) && "
+           #"~|tag|vector_dot_fast(~(elements rule x), "
+           #"~(elements rule y), ~|size|, &~|rr|))")
+          "FALSE"))
+      (for-each (cute substitute <> `((ZERO  ,ZERO) (FASTDOT ,FASTDOT) ,@rule))
                 *tmpl-dotop*))))
 
 (define (generate-rangeop)
@@ -387,6 +419,19 @@
         (case tag
           [(s64 u64) #"INT64LT(~|a|, ~|b|)"]
           [else      #"(~a < ~b)"]))
+      ;; Returns the C expr that runs the fast kernel for OPNAME.
+      (define (FASTRANGE opname)
+        (^[x lo hi size]
+          (cond [(not (fast-kernel? rule)) "0"]
+                [(equal? opname "range-check")
+                 (string-append
+                  #"~|tag|vector_range_check_fast(~(elements rule x), "
+                  #"~|lo|, ~|hi|, ~|size|)")]
+                [else
+                 (let1 d (if (equal? opname "clamp") "d" x)
+                   (string-append
+                    #"~|tag|vector_clamp_fast(~(elements rule d), "
+                    #"~(elements rule x), ~|lo|, ~|hi|, ~|size|)"))])))
       (dolist [ops `(("range-check" "RangeCheck"
                       ""
                       "return Scm_MakeInteger(i)"
@@ -403,6 +448,7 @@
         (for-each (cute substitute <> `((GETLIM  ,GETLIM)
                                         (ZERO  ,ZERO)
                                         (LT  ,LT)
+                                        (FASTRANGE ,(FASTRANGE (ref ops 0)))
                                         (opname   ,(ref ops 0))
                                         (Opname   ,(ref ops 1))
                                         (dstdecl  ,(ref ops 2))
@@ -411,6 +457,39 @@
                                         ,@rule))
                   *tmpl-rangeop*)))))
 
+(define (generate-reduceop)
+  (dolist [rule (make-rules)]
+    (let1 tag (string->symbol (getval rule 't))
+      (define (LT a b)
+        (case tag
+          [(s64 u64) #"INT64LT(~|a|, ~|b|)"]
+          [else      #"(~a < ~b)"]))
+      (define (NANCHECK v i)
+        (case tag
+          [(f16 f32 f64) #"if (UV_IS_NAN(~|v|)) return ~|i|"]
+          [else "/* no NaN */"]))
+      (define (TODOUBLE x)
+        (case tag
+          [(s64) #"INT64_TO_DOUBLE(~|x|)"]
+          [(u64) #"UINT64_TO_DOUBLE(~|x|)"]
+          [else  #"((double)~|x|)"]))
+      (for-each (cute substitute <> `((LT ,LT)
+                                      (NANCHECK ,NANCHECK)
+                                      (TODOUBLE ,TODOUBLE)
+                                      ,@rule))
+                *tmpl-reduceop*))))
+
+(define (generate-matrixop)
+  (dolist [rule (make-flonum-rules)]
+    (let1 tag (getval rule 't)
+      (unless (equal? tag "f16")
+        (for-each (cute substitute <>
+                        `((GEMM ,(if (equal? tag "f32")
+                                   "cblas_sgemm"
+                                   "cblas_dgemm"))
+                          ,@rule))
+                  *tmpl-matrixop*)))))
+
 (define (generate-swapb)
   (dolist [rule (make-rules)]
     (let1 tag (string->symbol (getval rule 't))
@@ -230,6 +230,31 @@
            (list a b s c)))
   )
 
+;; The filler gets the room after the unread data, not the whole buffer.
+(let* ([src (string->u8vector "aあbいcうdえeお")]
+       [pos 0]
+       [p (make <buffered-input-port>
+            :fill (^[buf]
+                    (if (= pos (u8vector-length src))
+                      0
+                      (begin (u8vector-set! buf 0 (u8vector-ref src pos))
+                             (inc! pos)
+                             1))))])
+  (test* "buffered-input-port with byte-by-byte filler"
+         "aあbいcうdえeお" (port->string p)))
+
+;; The buffer view is reused.
+(let* ([views '()]
+       [p (make <buffered-input-port>
+            :buffer-size 16
+            :fill (^[buf] (push! views buf) (u8vector-fill! buf 1)
+                    (u8vector-length buf)))])
+  (test* "buffered-input-port reuses buffer view" '(48 #t)
+         (list (let loop ([n 0])
+                 (if (= n 48) n (begin (read-byte p) (loop (+ n 1)))))
+               (and (>= (length views) 3)
+                    (every (cut eq? (car views) <>) views)))))
+
 ;;-----------------------------------------------------------
 (test-section "buffered-output-port")
 
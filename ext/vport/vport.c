@@ -93,7 +93,7 @@ static int vport_getb(ScmPort *p)
         char buf[SCM_CHAR_MAX_BYTES];
 
         if (SCM_FALSEP(data->getc_proc)) return EOF;
-        ScmObj ch = Scm_ApplyRec(data->getc_proc, SCM_NIL);
+        ScmObj ch = Scm_ApplyRec0(data->getc_proc);
         if (!SCM_CHARP(ch)) return EOF;
 
         ScmChar c = SCM_CHAR_VALUE(ch);
@@ -108,7 +108,7 @@ static int vport_getb(ScmPort *p)
         }
         return (unsigned char)buf[0];
     } else {
-        ScmObj b = Scm_ApplyRec(data->getb_proc, SCM_NIL);
+        ScmObj b = Scm_ApplyRec0(data->getb_proc);
         if (!SCM_INTP(b)) return EOF;
         return (SCM_INT_VALUE(b) & 0xff);
     }
@@ -127,12 +127,12 @@ static int vport_getc(ScmPort *p)
         char buf[SCM_CHAR_MAX_BYTES];
 
         if (SCM_FALSEP(data->getb_proc)) return EOF;
-        ScmObj b = Scm_ApplyRec(data->getb_proc, SCM_NIL);
+        ScmObj b = Scm_ApplyRec0(data->getb_proc);
         if (!SCM_INTP(b)) return EOF;
         buf[0] = (char)SCM_INT_VALUE(b);
         int n = SCM_CHAR_NFOLLOWS(p->scratch[0]);
         for (int i=0; i<n; i++) {
-            b = Scm_ApplyRec(data->getb_proc, SCM_NIL);
+            b = Scm_ApplyRec0(data->getb_proc);
             if (!SCM_INTP(b)) {
                 /* TODO: should raise an exception? */
                 return EOF;
@@ -143,7 +143,7 @@ static int vport_getc(ScmPort *p)
         SCM_CHAR_GET(buf, ch);
         return ch;
     } else {
-        ScmObj ch = Scm_ApplyRec(data->getc_proc, SCM_NIL);
+        ScmObj ch = Scm_ApplyRec0(data->getc_proc);
         if (!SCM_CHARP(ch)) return EOF;
         return SCM_CHAR_VALUE(ch);
     }
@@ -159,8 +159,7 @@ static int vport_getz(char *buf, int buflen, ScmPort *p)
 
     if (!SCM_FALSEP(data->gets_proc)) {
         u_int size;
-        ScmObj s = Scm_ApplyRec(data->gets_proc,
-                                SCM_LIST1(SCM_MAKE_INT(buflen)));
+        ScmObj s = Scm_ApplyRec1(data->gets_proc, SCM_MAKE_INT(buflen));
         if (!SCM_STRINGP(s)) return EOF;
         const char *start = Scm_GetStringContent(SCM_STRING(s), &size,
                                                  NULL, NULL);
@@ -193,8 +192,7 @@ static int vport_ready(ScmPort *p, int charp)
     SCM_ASSERT(data != NULL);
 
     if (!SCM_FALSEP(data->ready_proc)) {
-        ScmObj s = Scm_ApplyRec(data->ready_proc,
-                                SCM_LIST1(SCM_MAKE_BOOL(charp)));
+        ScmObj s = Scm_ApplyRec1(data->ready_proc, SCM_MAKE_BOOL(charp));
         return !SCM_FALSEP(s);
     } else {
         /* if no method is given, always return #t */
@@ -214,7 +212,7 @@ static void vport_putb(ScmByte b, ScmPort *p)
         if (!SCM_FALSEP(data->putc_proc)
             && SCM_CHAR_NFOLLOWS(b) == 0) {
             /* This byte is a single-byte character, so we can use putc. */
-            Scm_ApplyRec(data->putc_proc, SCM_LIST1(SCM_MAKE_CHAR(b)));
+            Scm_ApplyRec1(data->putc_proc, SCM_MAKE_CHAR(b));
         } else {
             /* Given byte is a part of multibyte sequence.  We don't
                handle it for the time being. */
@@ -222,7 +220,7 @@ static void vport_putb(ScmByte b, ScmPort *p)
                           "cannot perform binary output to the port %S", p);
         }
     } else {
-        Scm_ApplyRec(data->putb_proc, SCM_LIST1(SCM_MAKE_INT(b)));
+        Scm_ApplyRec1(data->putb_proc, SCM_MAKE_INT(b));
     }
 }
 
@@ -243,11 +241,11 @@ static void vport_putc(ScmChar c, ScmPort *p)
             int n = SCM_CHAR_NBYTES(c);
             SCM_CHAR_PUT(buf, c);
             for (int i=0; i<n; i++) {
-                Scm_ApplyRec(data->putb_proc, SCM_LIST1(SCM_MAKE_INT(buf[i])));
+                Scm_ApplyRec1(data->putb_proc, SCM_MAKE_INT(buf[i]));
             }
         }
     } else {
-        Scm_ApplyRec(data->putc_proc, SCM_LIST1(SCM_MAKE_CHAR(c)));
+        Scm_ApplyRec1(data->putc_proc, SCM_MAKE_CHAR(c));
     }
 }
 
@@ -260,13 +258,12 @@ static void vport_putz(const char *buf, int size, ScmPort *p)
     SCM_ASSERT(data != NULL);
 
     if (!SCM_FALSEP(data->puts_proc)) {
-        Scm_ApplyRec(data->puts_proc,
-                     SCM_LIST1(Scm_MakeString(buf, size, -1,
-                                              SCM_STRING_COPYING)));
+        Scm_ApplyRec1(data->puts_proc,
+                      Scm_MakeString(buf, size, -1, SCM_STRING_COPYING));
     } else if (!SCM_FALSEP(data->putb_proc)) {
         for (int i=0; i<size; i++) {
             unsigned char b = buf[i];
-            Scm_ApplyRec(data->putb_proc, SCM_LIST1(SCM_MAKE_INT(b)));
+            Scm_ApplyRec1(data->putb_proc, SCM_MAKE_INT(b));
         }
     } else {
         Scm_PortError(p, SCM_PORT_ERROR_UNIT,
@@ -284,7 +281,7 @@ static void vport_puts(ScmString *s, ScmPort *p)
     SCM_ASSERT(data != NULL);
 
     if (!SCM_FALSEP(data->puts_proc)) {
-        Scm_ApplyRec(data->puts_proc, SCM_LIST1(SCM_OBJ(s)));
+        Scm_ApplyRec1(data->puts_proc, SCM_OBJ(s));
     } else if (SCM_STRING_BODY_INCOMPLETE_P(b)
                || (SCM_FALSEP(data->putc_proc)
                    && !SCM_FALSEP(data->putb_proc))) {
@@ -296,7 +293,7 @@ static void vport_puts(ScmString *s, ScmPort *p)
             ScmChar c;
             SCM_CHAR_GET(cp, c);
             cp += SCM_CHAR_NFOLLOWS(*cp)+1;
-            Scm_ApplyRec(data->putc_proc, SCM_LIST1(SCM_MAKE_CHAR(c)));
+            Scm_ApplyRec1(data->putc_proc, SCM_MAKE_CHAR(c));
         }
     } else {
         Scm_PortError(p, SCM_PORT_ERROR_OTHER,
@@ -312,7 +309,7 @@ static void vport_flush(ScmPort *p)
     vport *data = (vport*)p->src.vt.data;
     SCM_ASSERT(data != NULL);
     if (!SCM_FALSEP(data->flush_proc)) {
-        Scm_ApplyRec(data->flush_proc, SCM_NIL);
+        Scm_ApplyRec0(data->flush_proc);
     }
 }
 
@@ -324,7 +321,7 @@ static void vport_close(ScmPort *p)
     vport *data = (vport*)p->src.vt.data;
     SCM_ASSERT(data != NULL);
     if (!SCM_FALSEP(data->close_proc)) {
-        Scm_ApplyRec(data->close_proc, SCM_NIL);
+        Scm_ApplyRec0(data->close_proc);
     }
 }
 
@@ -336,9 +333,9 @@ static off_t vport_seek(ScmPort *p, off_t off, int whence)
     vport *data = (vport*)p->src.vt.data;
     SCM_ASSERT(data != NULL);
     if (!SCM_FALSEP(data->seek_proc)) {
-        ScmObj r = Scm_ApplyRec(data->seek_proc,
-                                SCM_LIST2(Scm_OffsetToInteger(off),
-                                          Scm_MakeInteger(whence)));
+        ScmObj r = Scm_ApplyRec2(data->seek_proc,
+                                 Scm_OffsetToInteger(off),
+                                 Scm_MakeInteger(whence));
         if (SCM_INTEGERP(r)) {
             return Scm_IntegerToOffset(r);
         }
@@ -494,8 +491,26 @@ typedef struct bport_rec {
     ScmObj ready_proc;          /* () -> Bool */
     ScmObj filenum_proc;        /* () -> Maybe Int */
     ScmObj seek_proc;           /* (Offset, Whence) -> Offset */
+    ScmObj view;                /* u8vector last passed to fill/flush */
 } bport;
 
+/* Returns a u8vector sharing CNT bytes from PTR of the port buffer.
+   The filler and the flusher are mostly called with the same region
+   (the whole buffer), so we keep the last view and reuse it when it
+   matches, instead of allocating one for every call. */
+static ScmObj bport_view(bport *data, char *ptr, int cnt)
+{
+    ScmObj v = data->view;
+    if (SCM_U8VECTORP(v)
+        && SCM_UVECTOR_ELEMENTS(v) == (void*)ptr
+        && SCM_UVECTOR_SIZE(v) == cnt) {
+        return v;
+    }
+    v = Scm_MakeU8VectorFromArrayShared(cnt, (unsigned char*)ptr);
+    data->view = v;
+    return v;
+}
+
 /*------------------------------------------------------------
  * Bport fill
  */
@@ -506,9 +521,10 @@ static int bport_fill(ScmPort *p, int cnt)
     if (SCM_FALSEP(data->fill_proc)) {
         return 0;               /* indicates EOF */
     }
-    ScmObj vec = Scm_MakeU8VectorFromArrayShared(
-        cnt, (unsigned char*)p->src.buf.buffer);
-    ScmObj r = Scm_ApplyRec(data->fill_proc, SCM_LIST1(vec));
+    /* The filler reads into the room after the valid data, which
+       may not be at the beginning of the buffer. */
+    ScmObj vec = bport_view(data, p->src.buf.end, cnt);
+    ScmObj r = Scm_ApplyRec1(data->fill_proc, vec);
     if (SCM_INTP(r)) return SCM_INT_VALUE(r);
     else if (SCM_EOFP(r)) return 0;
     else return -1;
@@ -524,10 +540,9 @@ static int bport_flush(ScmPort *p, int cnt, int forcep)
     if (SCM_FALSEP(data->flush_proc)) {
         return cnt;             /* blackhole */
     }
-    ScmObj vec = Scm_MakeU8VectorFromArrayShared(
-        cnt, (unsigned char*)p->src.buf.buffer);
-    ScmObj r = Scm_ApplyRec(data->flush_proc,
-                            SCM_LIST2(vec, SCM_MAKE_BOOL(forcep)));
+    ScmObj vec = bport_view(data, p->src.buf.buffer, cnt);
+    ScmObj r = Scm_ApplyRec2(data->flush_proc,
+                            vec, SCM_MAKE_BOOL(forcep));
     if (SCM_INTP(r)) return SCM_INT_VALUE(r);
     else if (SCM_EOFP(r)) return 0;
     else return -1;
@@ -541,7 +556,7 @@ static void bport_close(ScmPort *p)
     bport *data = (bport*)p->src.buf.data;
     SCM_ASSERT(data != NULL);
     if (!SCM_FALSEP(data->close_proc)) {
-        Scm_ApplyRec(data->close_proc, SCM_NIL);
+        Scm_ApplyRec0(data->close_proc);
     }
 }
 
@@ -554,7 +569,7 @@ static int bport_ready(ScmPort *p)
     SCM_ASSERT(data != NULL);
 
     if (!SCM_FALSEP(data->ready_proc)) {
-        ScmObj s = Scm_ApplyRec(data->ready_proc, SCM_NIL);
+        ScmObj s = Scm_ApplyRec0(data->ready_proc);
         return SCM_FALSEP(s)? SCM_FD_WOULDBLOCK:SCM_FD_READY;
     } else {
         /* if no method is given, always return #t */
@@ -573,7 +588,7 @@ static int bport_filenum(ScmPort *p)
     if (SCM_FALSEP(data->filenum_proc)) {
         return -1;
     } else {
-        ScmObj s = Scm_ApplyRec(data->filenum_proc, SCM_NIL);
+        ScmObj s = Scm_ApplyRec0(data->filenum_proc);
         if (SCM_INTP(s)) return SCM_INT_VALUE(s);
         else return -1;
     }
@@ -587,9 +602,9 @@ static off_t bport_seek(ScmPort *p, off_t off, int whence)
     bport *data = (bport*)p->src.buf.data;
     SCM_ASSERT(data != NULL);
     if (!SCM_FALSEP(data->seek_proc)) {
-        ScmObj r = Scm_ApplyRec(data->seek_proc,
-                                SCM_LIST2(Scm_OffsetToInteger(off),
-                                          Scm_MakeInteger(whence)));
+        ScmObj r = Scm_ApplyRec2(data->seek_proc,
+                                 Scm_OffsetToInteger(off),
+                                 Scm_MakeInteger(whence));
         if (SCM_INTEGERP(r)) {
             return Scm_IntegerToOffset(r);
         }
@@ -613,6 +628,7 @@ static ScmObj bport_allocate(ScmClass *klass, ScmObj initargs)
     data->ready_proc = SCM_FALSE;
     data->filenum_proc = SCM_FALSE;
     data->seek_proc  = SCM_FALSE;
+    data->view       = SCM_FALSE;
 
     ScmPortBuffer buf;
     if (bufsize > 0) {
@@ -57,6 +57,10 @@ SCM_DEFINE_BASE_CLASS(Scm_InflatingPortClass,
                       ScmPort, /* instance type */
                       NULL, NULL, NULL, NULL, port_cpl);
 
+SCM_DEFINE_BASE_CLASS(Scm_ParallelDeflatingPortClass,
+                      ScmPort, /* instance type */
+                      NULL, NULL, NULL, NULL, port_cpl);
+
 /*================================================================
  * Conditions
  */
@@ -360,6 +364,411 @@ ScmObj Scm_MakeDeflatingPort(ScmPort *source, int level,
                                 SCM_PORT_OUTPUT, TRUE, &bufrec);
 }
 
+/*================================================================
+ * Parallel deflating port
+ *
+ *   The input is cut into blocks of the port's buffer size.  Each block
+ *   is compressed independently as a raw deflate stream, preset with the
+ *   last 32KB of the preceding input as the dictionary, and ends with a
+ *   sync flush (the last block with Z_FINISH), so that the compressed
+ *   blocks can simply be concatenated.  The blocks are compressed by
+ *   worker threads and written out in the order of submission, wrapped
+ *   with a gzip header and trailer.  The crc of the whole input is
+ *   computed by combining the crcs of the blocks.
+ *
+ *   Worker threads don't touch Scheme objects; jobs and their buffers
+ *   are malloc'ed and owned by the port.  Without pthreads, or when
+ *   the number of workers is 0, blocks are compressed in the caller.
+ */
+
+#define PDEFLATE_DEFAULT_BLOCK_SIZE (128*1024)
+#define PDEFLATE_WINDOW_SIZE        32768
+#define PDEFLATE_MAX_WORKERS        256
+
+struct ScmParallelDeflateJobRec {
+    ScmParallelDeflateJob *onext; /* next in output order */
+    ScmParallelDeflateJob *wnext; /* next in work queue */
+    unsigned char *in;          /* dictionary followed by the input */
+    int dictlen;
+    int inlen;
+    int last;                   /* the last block of the stream */
+    unsigned char *out;
+    size_t outsize;             /* allocated size of out */
+    size_t outlen;              /* compressed size */
+    uLong crc;                  /* of the input */
+    int error;                  /* zlib error code if failed */
+    int done;
+};
+
+#if defined(GAUCHE_USE_PTHREADS)
+#define PDEFLATE_LOCK(info)     SCM_INTERNAL_MUTEX_LOCK((info)->mutex)
+#define PDEFLATE_UNLOCK(info)   SCM_INTERNAL_MUTEX_UNLOCK((info)->mutex)
+#else  /*!GAUCHE_USE_PTHREADS*/
+#define PDEFLATE_LOCK(info)     /*empty*/
+#define PDEFLATE_UNLOCK(info)   /*empty*/
+#endif /*!GAUCHE_USE_PTHREADS*/
+
+static int pdeflate_init_stream(z_streamp strm, int level, int strategy)
+{
+    memset(strm, 0, sizeof(z_stream));
+    return deflateInit2(strm, level, Z_DEFLATED, -MAX_WBITS, 8, strategy);
+}
+
+static void pdeflate_free_job(ScmParallelDeflateJob *job)
+{
+    free(job->in);
+    free(job->out);
+    free(job);
+}
+
+/* Compress one block.  May run in a worker thread. */
+static void pdeflate_compress(z_streamp strm, ScmParallelDeflateJob *job)
+{
+    unsigned char *in = job->in + job->dictlen;
+    job->crc = crc32(crc32(0L, Z_NULL, 0), in, job->inlen);
+
+    int r = deflateReset(strm);
+    if (r == Z_OK && job->dictlen > 0) {
+        r = deflateSetDictionary(strm, job->in, job->dictlen);
+    }
+    if (r != Z_OK) {
+        job->error = r;
+        return;
+    }
+    /* deflateBound doesn't count the sync flush marker. */
+    job->outsize = deflateBound(strm, job->inlen) + 16;
+    job->out = (unsigned char*)malloc(job->outsize);
+    if (job->out == NULL) {
+        job->error = Z_MEM_ERROR;
+        return;
+    }
+    strm->next_in = in;
+    strm->avail_in = job->inlen;
+    strm->next_out = job->out;
+    strm->avail_out = job->outsize;
+
+    int flush = job->last ? Z_FINISH : Z_SYNC_FLUSH;
+    for (;;) {
+        r = deflate(strm, flush);
+        if (r == Z_STREAM_END) break;
+        if (r != Z_OK) {
+            job->error = r;
+            return;
+        }
+        if (strm->avail_out != 0 && !job->last) break;
+        size_t used = strm->next_out - job->out;
+        unsigned char *p = (unsigned char*)realloc(job->out, job->outsize*2);
+        if (p == NULL) {
+            job->error = Z_MEM_ERROR;
+            return;
+        }
+        job->out = p;
+        job->outsize *= 2;
+        strm->next_out = p + used;
+        strm->avail_out = job->outsize - used;
+    }
+    job->outlen = strm->next_out - job->out;
+}
+
+#if defined(GAUCHE_USE_PTHREADS)
+static void *pdeflate_worker(void *data)
+{
+    ScmParallelDeflateInfo *info = (ScmParallelDeflateInfo*)data;
+    z_stream strm;
+    int initerr = pdeflate_init_stream(&strm, info->level, info->strategy);
+
+    for (;;) {
+        PDEFLATE_LOCK(info);
+        while (info->whead == NULL && !info->shutdown) {
+            SCM_INTERNAL_COND_WAIT(info->work_cond, info->mutex);
+        }
+        ScmParallelDeflateJob *job = info->whead;
+        if (job == NULL) {
+            PDEFLATE_UNLOCK(info);
+            break;
+        }
+        info->whead = job->wnext;
+        if (info->whead == NULL) info->wtail = NULL;
+        PDEFLATE_UNLOCK(info);
+
+        if (initerr != Z_OK) job->error = initerr;
+        else pdeflate_compress(&strm, job);
+
+        PDEFLATE_LOCK(info);
+        job->done = TRUE;
+        SCM_INTERNAL_COND_BROADCAST(info->done_cond);
+        PDEFLATE_UNLOCK(info);
+    }
+    if (initerr == Z_OK) deflateEnd(&strm);
+    return NULL;
+}
+
+static void pdeflate_start_workers(ScmParallelDeflateInfo *info)
+{
+    sigset_t set, oset;
+
+    info->workers = SCM_NEW_ATOMIC2(pthread_t*,
+                                    info->nworkers * sizeof(pthread_t));
+    /* Workers never run Scheme code; keep signals away from them. */
+    sigfillset(&set);
+    pthread_sigmask(SIG_SETMASK, &set, &oset);
+    int i;
+    for (i=0; i<info->nworkers; i++) {
+        if (pthread_create(&info->workers[i], NULL, pdeflate_worker,
+                           info) != 0) {
+            break;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &oset, NULL);
+    info->nworkers = i;         /* fall back to fewer threads */
+}
+#endif /*GAUCHE_USE_PTHREADS*/
+
+/* Queue the data as a new block. */
+static void pdeflate_submit(ScmParallelDeflateInfo *info,
+                            const unsigned char *buf, int len, int last)
+{
+    ScmParallelDeflateJob *job =
+        (ScmParallelDeflateJob*)calloc(1, sizeof(ScmParallelDeflateJob));
+    if (job == NULL) Scm_ZlibError(Z_MEM_ERROR, "out of memory");
+    job->in = (unsigned char*)malloc(info->dictlen + len + 1);
+    if (job->in == NULL) {
+        free(job);
+        Scm_ZlibError(Z_MEM_ERROR, "out of memory");
+    }
+    memcpy(job->in, info->dict, info->dictlen);
+    memcpy(job->in + info->dictlen, buf, len);
+    job->dictlen = info->dictlen;
+    job->inlen = len;
+    job->last = last;
+
+    /* The tail of this block and the previous dictionary becomes the
+       dictionary of the next block. */
+    int total = info->dictlen + len;
+    info->dictlen = (total < PDEFLATE_WINDOW_SIZE)? total : PDEFLATE_WINDOW_SIZE;
+    memcpy(info->dict, job->in + total - info->dictlen, info->dictlen);
+
+    if (info->nworkers == 0) {
+        pdeflate_compress(info->strm, job);
+        job->done = TRUE;
+    }
+
+    PDEFLATE_LOCK(info);
+    if (info->otail) info->otail->onext = job;
+    else info->ohead = job;
+    info->otail = job;
+    info->npending++;
+#if defined(GAUCHE_USE_PTHREADS)
+    if (info->nworkers > 0) {
+        if (info->wtail) info->wtail->wnext = job;
+        else info->whead = job;
+        info->wtail = job;
+        SCM_INTERNAL_COND_SIGNAL(info->work_cond);
+    }
+#endif /*GAUCHE_USE_PTHREADS*/
+    PDEFLATE_UNLOCK(info);
+}
+
+/* Stop the workers and release everything except the info itself.
+   May be called more than once. */
+static void pdeflate_cleanup(ScmParallelDeflateInfo *info)
+{
+#if defined(GAUCHE_USE_PTHREADS)
+    if (info->workers) {
+        PDEFLATE_LOCK(info);
+        info->shutdown = TRUE;
+        SCM_INTERNAL_COND_BROADCAST(info->work_cond);
+        PDEFLATE_UNLOCK(info);
+        for (int i=0; i<info->nworkers; i++) {
+            pthread_join(info->workers[i], NULL);
+        }
+        info->workers = NULL;
+        info->nworkers = 0;
+    }
+#endif /*GAUCHE_USE_PTHREADS*/
+    while (info->ohead) {
+        ScmParallelDeflateJob *job = info->ohead;
+        info->ohead = job->onext;
+        pdeflate_free_job(job);
+    }
+    info->otail = info->whead = info->wtail = NULL;
+    info->npending = 0;
+    if (info->dict) {
+        free(info->dict);
+        info->dict = NULL;
+        info->dictlen = 0;
+    }
+    if (info->strm) {
+        deflateEnd(info->strm);
+        info->strm = NULL;
+    }
+}
+
+static void pdeflate_put_u32le(unsigned char *p, uLong v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static void pdeflate_output(ScmPort *port, ScmParallelDeflateInfo *info,
+                            ScmParallelDeflateJob *job)
+{
+    if (job->error != Z_OK) {
+        int r = job->error;
+        pdeflate_free_job(job);
+        info->failed = TRUE;
+        pdeflate_cleanup(info);
+        Scm_ZlibError(r, "compressing a block failed: %s", zError(r));
+    }
+    if (!info->header_written) {
+        unsigned char hdr[10] = { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0,
+                                  3 /* Unix */ };
+        if (info->level == 9) hdr[8] = 2;
+        else if (info->level == 1) hdr[8] = 4;
+        Scm_Putz((char*)hdr, sizeof(hdr), info->remote);
+        info->header_written = TRUE;
+    }
+    Scm_Putz((char*)job->out, job->outlen, info->remote);
+    info->crc = crc32_combine(info->crc, job->crc, job->inlen);
+    info->isize += job->inlen;
+    pdeflate_free_job(job);
+}
+
+/* Write out the finished blocks in order.  Waits for the blocks being
+   compressed while more than MAXPENDING blocks are outstanding. */
+static void pdeflate_drain(ScmPort *port, ScmParallelDeflateInfo *info,
+                           int maxpending)
+{
+    for (;;) {
+        ScmParallelDeflateJob *job = NULL;
+        PDEFLATE_LOCK(info);
+#if defined(GAUCHE_USE_PTHREADS)
+        while (info->ohead && !info->ohead->done
+               && info->npending > maxpending) {
+            SCM_INTERNAL_COND_WAIT(info->done_cond, info->mutex);
+        }
+#endif /*GAUCHE_USE_PTHREADS*/
+        if (info->ohead && info->ohead->done) {
+            job = info->ohead;
+            info->ohead = job->onext;
+            if (info->ohead == NULL) info->otail = NULL;
+            info->npending--;
+        }
+        PDEFLATE_UNLOCK(info);
+        if (job == NULL) break;
+        pdeflate_output(port, info, job);
+    }
+}
+
+static int pdeflate_flusher(ScmPort *port, int cnt, int forcep)
+{
+    ScmParallelDeflateInfo *info = SCM_PORT_PDEFLATE_INFO(port);
+    int avail = SCM_PORT_BUFFER_AVAIL(port);
+
+    if (info->failed) {
+        Scm_ZlibError(Z_STREAM_ERROR,
+                      "parallel deflating port is unusable after an error");
+    }
+    if (avail > 0) {
+        pdeflate_submit(info, (unsigned char*)port->src.buf.buffer,
+                        avail, FALSE);
+    }
+    pdeflate_drain(port, info, forcep? 0 : 2*info->nworkers);
+    return avail;
+}
+
+static void pdeflate_closer(ScmPort *port)
+{
+    ScmParallelDeflateInfo *info = SCM_PORT_PDEFLATE_INFO(port);
+
+    if (!info->failed) {
+        pdeflate_submit(info, (unsigned char*)port->src.buf.buffer,
+                        SCM_PORT_BUFFER_AVAIL(port), TRUE);
+        pdeflate_drain(port, info, 0);
+        unsigned char trailer[8];
+        pdeflate_put_u32le(trailer, info->crc);
+        pdeflate_put_u32le(trailer+4, info->isize);
+        Scm_Putz((char*)trailer, sizeof(trailer), info->remote);
+    }
+    pdeflate_cleanup(info);
+    Scm_Flush(info->remote);
+    if (info->ownerp) {
+        Scm_ClosePort(info->remote);
+    }
+}
+
+static int pdeflate_fileno(ScmPort *port)
+{
+    return Scm_PortFileNo(SCM_PORT_PDEFLATE_INFO(port)->remote);
+}
+
+ScmObj Scm_MakeParallelDeflatingPort(ScmPort *sink, int level,
+                                     int strategy, int block_size,
+                                     int nworkers, int ownerp)
+{
+    ScmParallelDeflateInfo *info = SCM_NEW(ScmParallelDeflateInfo);
+    z_streamp strm = SCM_NEW_ATOMIC2(z_streamp, sizeof(z_stream));
+
+    if (block_size <= 0) block_size = PDEFLATE_DEFAULT_BLOCK_SIZE;
+    if (block_size < MINIMUM_BUFFER_SIZE) block_size = MINIMUM_BUFFER_SIZE;
+
+    /* This also validates level and strategy before we spawn workers. */
+    int r = pdeflate_init_stream(strm, level, strategy);
+    if (r != Z_OK) {
+        Scm_ZlibError(r, "deflateInit2 error: %s", strm->msg);
+    }
+    info->dict = (unsigned char*)malloc(PDEFLATE_WINDOW_SIZE);
+    if (info->dict == NULL) {
+        deflateEnd(strm);
+        Scm_ZlibError(Z_MEM_ERROR, "out of memory");
+    }
+
+    info->remote = sink;
+    info->ownerp = ownerp;
+    info->level = level;
+    info->strategy = strategy;
+    info->failed = FALSE;
+    info->header_written = FALSE;
+    info->crc = crc32(0L, Z_NULL, 0);
+    info->isize = 0;
+    info->dictlen = 0;
+    info->strm = strm;
+    info->npending = 0;
+    info->ohead = info->otail = NULL;
+    info->whead = info->wtail = NULL;
+    info->shutdown = FALSE;
+#if defined(GAUCHE_USE_PTHREADS)
+    if (nworkers < 0) nworkers = Scm_AvailableProcessors();
+    if (nworkers > PDEFLATE_MAX_WORKERS) nworkers = PDEFLATE_MAX_WORKERS;
+    info->nworkers = nworkers;
+    info->workers = NULL;
+    SCM_INTERNAL_MUTEX_INIT(info->mutex);
+    SCM_INTERNAL_COND_INIT(info->work_cond);
+    SCM_INTERNAL_COND_INIT(info->done_cond);
+    if (nworkers > 0) pdeflate_start_workers(info);
+#else  /*!GAUCHE_USE_PTHREADS*/
+    info->nworkers = 0;
+#endif /*!GAUCHE_USE_PTHREADS*/
+
+    ScmPortBuffer bufrec;
+    memset(&bufrec, 0, sizeof(bufrec));
+    bufrec.size = block_size;
+    bufrec.buffer = SCM_NEW_ATOMIC2(char *, block_size);
+    bufrec.mode = SCM_PORT_BUFFER_FULL;
+    bufrec.filler = NULL;
+    bufrec.flusher = pdeflate_flusher;
+    bufrec.closer = pdeflate_closer;
+    bufrec.ready = NULL;
+    bufrec.filenum = pdeflate_fileno;
+    bufrec.data = (void*)info;
+
+    ScmObj name = port_name("parallel deflating", sink);
+    return Scm_MakeBufferedPort(SCM_CLASS_PARALLEL_DEFLATING_PORT, name,
+                                SCM_PORT_OUTPUT, TRUE, &bufrec);
+}
+
 /*================================================================
  * Inflating port
  */
@@ -551,6 +960,221 @@ ScmObj Scm_InflateSync(ScmPort *port)
     return Scm_MakeIntegerU(strm->total_in - curr_in);
 }
 
+/*================================================================
+ * One-shot compression
+ *
+ *   These work directly on memory buffers, bypassing the port layer.
+ *   Initialized z_streams are kept in a small pool keyed by their
+ *   parameters, so that compressing many small messages doesn't pay
+ *   for deflateInit2/inflateInit2 every time.
+ */
+
+#define ZPOOL_MAX 16
+
+typedef struct ZPoolEntryRec {
+    struct ZPoolEntryRec *next;
+    z_stream strm;
+    int inflatep;
+    int level;
+    int window_bits;
+    int memlevel;
+    int strategy;
+} ZPoolEntry;
+
+static struct {
+    ZPoolEntry *entries;
+    int count;
+    ScmInternalMutex mutex;
+} zpool = { NULL, 0, SCM_INTERNAL_MUTEX_INITIALIZER };
+
+/* Returns a z_stream ready to use, or NULL with *err set. */
+static ZPoolEntry *zpool_get(int inflatep, int level, int window_bits,
+                             int memlevel, int strategy, int *err)
+{
+    ZPoolEntry *e = NULL, **pe;
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(zpool.mutex);
+    for (pe = &zpool.entries; *pe; pe = &(*pe)->next) {
+        ZPoolEntry *z = *pe;
+        if (z->inflatep == inflatep && z->window_bits == window_bits
+            && (inflatep || (z->level == level && z->memlevel == memlevel
+                             && z->strategy == strategy))) {
+            *pe = z->next;
+            zpool.count--;
+            e = z;
+            break;
+        }
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(zpool.mutex);
+
+    if (e) {
+        *err = inflatep? inflateReset(&e->strm) : deflateReset(&e->strm);
+        if (*err == Z_OK) return e;
+        /* shouldn't happen, but start afresh */
+        if (inflatep) inflateEnd(&e->strm);
+        else deflateEnd(&e->strm);
+        free(e);
+    }
+
+    e = (ZPoolEntry*)calloc(1, sizeof(ZPoolEntry));
+    if (e == NULL) {
+        *err = Z_MEM_ERROR;
+        return NULL;
+    }
+    e->inflatep = inflatep;
+    e->level = level;
+    e->window_bits = window_bits;
+    e->memlevel = memlevel;
+    e->strategy = strategy;
+    if (inflatep) {
+        *err = inflateInit2(&e->strm, window_bits);
+    } else {
+        *err = deflateInit2(&e->strm, level, Z_DEFLATED, window_bits,
+                            memlevel, strategy);
+    }
+    if (*err != Z_OK) {
+        free(e);
+        return NULL;
+    }
+    return e;
+}
+
+static void zpool_put(ZPoolEntry *e)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(zpool.mutex);
+    if (zpool.count < ZPOOL_MAX) {
+        e->next = zpool.entries;
+        zpool.entries = e;
+        zpool.count++;
+        e = NULL;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(zpool.mutex);
+    if (e) {
+        if (e->inflatep) inflateEnd(&e->strm);
+        else deflateEnd(&e->strm);
+        free(e);
+    }
+}
+
+/* Calls Scm_ZlibError after returning the stream to the pool. */
+static void zpool_error(ZPoolEntry *e, int r, const char *what)
+{
+    char msg[128];
+    const char *zmsg = (e && e->strm.msg)? e->strm.msg : zError(r);
+    snprintf(msg, sizeof(msg), "%s", zmsg);
+    if (e) zpool_put(e);
+    Scm_ZlibError(r, "%s failed: %s", what, msg);
+}
+
+/* Returns the upper bound of the compressed size of SIZE bytes. */
+int Scm_DeflateBound(int size, int level, int window_bits,
+                     int memlevel, int strategy)
+{
+    int r;
+    ZPoolEntry *e = zpool_get(FALSE, level, window_bits, memlevel,
+                              strategy, &r);
+    if (e == NULL) zpool_error(NULL, r, "deflateInit2");
+    uLong bound = deflateBound(&e->strm, size);
+    zpool_put(e);
+    if (bound > INT_MAX) Scm_Error("size too big: %d", size);
+    return (int)bound;
+}
+
+/* Compresses SRC into DST.  Returns the number of bytes stored, or -1
+   if DST isn't big enough.  Scm_DeflateBound gives the safe size. */
+int Scm_DeflateBuffer(unsigned char *dst, int dstsize,
+                      const unsigned char *src, int srcsize,
+                      int level, int window_bits, int memlevel, int strategy)
+{
+    int r;
+    ZPoolEntry *e = zpool_get(FALSE, level, window_bits, memlevel,
+                              strategy, &r);
+    if (e == NULL) zpool_error(NULL, r, "deflateInit2");
+
+    e->strm.next_in = (unsigned char*)src;
+    e->strm.avail_in = srcsize;
+    e->strm.next_out = dst;
+    e->strm.avail_out = dstsize;
+    r = deflate(&e->strm, Z_FINISH);
+    int written = dstsize - e->strm.avail_out;
+    if (r == Z_OK || r == Z_BUF_ERROR) {
+        zpool_put(e);           /* ran out of the output room */
+        return -1;
+    }
+    if (r != Z_STREAM_END) zpool_error(e, r, "deflate");
+    zpool_put(e);
+    return written;
+}
+
+/* Uncompress SRC into DST.  Returns the number of bytes stored, or -1
+   if DST isn't big enough. */
+int Scm_InflateBuffer(unsigned char *dst, int dstsize,
+                      const unsigned char *src, int srcsize,
+                      int window_bits)
+{
+    int r;
+    ZPoolEntry *e = zpool_get(TRUE, 0, window_bits, 0, 0, &r);
+    if (e == NULL) zpool_error(NULL, r, "inflateInit2");
+
+    e->strm.next_in = (unsigned char*)src;
+    e->strm.avail_in = srcsize;
+    e->strm.next_out = dst;
+    e->strm.avail_out = dstsize;
+    r = inflate(&e->strm, Z_FINISH);
+    int written = dstsize - e->strm.avail_out;
+    if (r == Z_STREAM_END) {
+        zpool_put(e);
+        return written;
+    }
+    if (r == Z_OK || r == Z_BUF_ERROR) {
+        if (e->strm.avail_out == 0) {
+            zpool_put(e);
+            return -1;
+        }
+        zpool_error(e, Z_DATA_ERROR, "inflate (truncated input)");
+    }
+    zpool_error(e, r, "inflate");
+    return -1;                  /* dummy */
+}
+
+/* Uncompress SRC into a fresh u8vector of the exact size. */
+ScmObj Scm_InflateToU8Vector(const unsigned char *src, int srcsize,
+                             int window_bits)
+{
+    int r;
+    ZPoolEntry *e = zpool_get(TRUE, 0, window_bits, 0, 0, &r);
+    if (e == NULL) zpool_error(NULL, r, "inflateInit2");
+
+    size_t bufsiz = (srcsize < 64)? 256 : (size_t)srcsize * 4;
+    unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*, bufsiz);
+
+    e->strm.next_in = (unsigned char*)src;
+    e->strm.avail_in = srcsize;
+    e->strm.next_out = buf;
+    e->strm.avail_out = bufsiz;
+    for (;;) {
+        r = inflate(&e->strm, Z_FINISH);
+        if (r == Z_STREAM_END) break;
+        if (r != Z_OK && r != Z_BUF_ERROR) zpool_error(e, r, "inflate");
+        if (e->strm.avail_out != 0) {
+            zpool_error(e, Z_DATA_ERROR, "inflate (truncated input)");
+        }
+        if (bufsiz >= INT_MAX/2) {
+            zpool_put(e);
+            Scm_Error("inflated data too big");
+        }
+        unsigned char *nbuf = SCM_NEW_ATOMIC2(unsigned char*, bufsiz*2);
+        memcpy(nbuf, buf, bufsiz);
+        e->strm.next_out = nbuf + bufsiz;
+        e->strm.avail_out = bufsiz;
+        buf = nbuf;
+        bufsiz *= 2;
+    }
+    int len = bufsiz - e->strm.avail_out;
+    zpool_put(e);
+    return Scm_MakeU8VectorFromArrayShared(len, buf);
+}
+
 /*
  * Module initialization function.
  */
@@ -559,10 +1183,14 @@ void Scm_Init_zlib(void)
     /* Create the module if it doesn't exist yet. */
     ScmModule *mod = SCM_MODULE(SCM_FIND_MODULE("rfc.zlib", TRUE));
 
+    (void)SCM_INTERNAL_MUTEX_INIT(zpool.mutex);
+
     Scm_InitStaticClass(&Scm_DeflatingPortClass, "<deflating-port>",
                         mod, NULL, 0);
     Scm_InitStaticClass(&Scm_InflatingPortClass, "<inflating-port>",
                         mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_ParallelDeflatingPortClass,
+                        "<parallel-deflating-port>", mod, NULL, 0);
 
     ScmClass *cond_meta = Scm_ClassOf(SCM_OBJ(SCM_CLASS_CONDITION));
     Scm_InitStaticClassWithMeta(SCM_CLASS_ZLIB_ERROR,
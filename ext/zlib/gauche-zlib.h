@@ -81,6 +81,59 @@ extern ScmObj Scm_MakeInflatingPort(ScmPort *sink, int bufsiz,
                                     int window_bits, ScmObj dict,
                                     int ownerp);
 
+/* Parallel deflating port.  Blocks of input are compressed by worker
+   threads and written out in order as a gzip stream. */
+typedef struct ScmParallelDeflateJobRec ScmParallelDeflateJob;
+
+typedef struct ScmParallelDeflateInfoRec {
+    ScmPort *remote;            /* drain port */
+    int ownerp;
+    int level;
+    int strategy;
+    int nworkers;               /* 0 if we compress in the caller */
+    int failed;                 /* a block failed to compress */
+    int header_written;
+    uLong crc;                  /* of the input written out so far */
+    uLong isize;                /* ditto, size mod 2^32 */
+    unsigned char *dict;        /* last 32KB of the input so far */
+    int dictlen;
+    z_streamp strm;             /* used when nworkers == 0 */
+    int npending;               /* # of jobs not written out yet */
+    ScmParallelDeflateJob *ohead, *otail; /* jobs in output order */
+    ScmParallelDeflateJob *whead, *wtail; /* jobs to be compressed */
+    int shutdown;
+#if defined(GAUCHE_USE_PTHREADS)
+    ScmInternalMutex mutex;
+    ScmInternalCond  work_cond; /* a job is queued, or shutdown */
+    ScmInternalCond  done_cond; /* a job is done */
+    pthread_t *workers;
+#endif /*GAUCHE_USE_PTHREADS*/
+} ScmParallelDeflateInfo;
+
+#define SCM_PORT_PDEFLATE_INFO(p) ((ScmParallelDeflateInfo*)(p)->src.buf.data)
+
+SCM_CLASS_DECL(Scm_ParallelDeflatingPortClass);
+#define SCM_CLASS_PARALLEL_DEFLATING_PORT  (&Scm_ParallelDeflatingPortClass)
+#define SCM_PARALLEL_DEFLATING_PORT_P(obj) \
+    SCM_ISA(obj, SCM_CLASS_PARALLEL_DEFLATING_PORT)
+
+extern ScmObj Scm_MakeParallelDeflatingPort(ScmPort *sink, int level,
+                                            int strategy, int block_size,
+                                            int nworkers, int ownerp);
+
+/* One-shot compression on memory buffers */
+extern int Scm_DeflateBound(int size, int level, int window_bits,
+                            int memlevel, int strategy);
+extern int Scm_DeflateBuffer(unsigned char *dst, int dstsize,
+                             const unsigned char *src, int srcsize,
+                             int level, int window_bits, int memlevel,
+                             int strategy);
+extern int Scm_InflateBuffer(unsigned char *dst, int dstsize,
+                             const unsigned char *src, int srcsize,
+                             int window_bits);
+extern ScmObj Scm_InflateToU8Vector(const unsigned char *src, int srcsize,
+                                    int window_bits);
+
 /*================================================================
  * Conditions
  */
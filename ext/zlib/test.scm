@@ -18,6 +18,17 @@
 
 (load "./zlib")
 (import rfc.zlib)
+
+(define (zlib-dso-loaded?)
+  (boolean
+   (any (^d (and (#/rfc--zlib/ (~ d'path)) (~ d'loaded?)))
+        ((with-module gauche.internal %loaded-dlobjs)))))
+
+(test* "DSO is loaded lazily" '(#f #t)
+       (let1 before (zlib-dso-loaded?)
+         (zlib-version)
+         (list before (zlib-dso-loaded?))))
+
 (test-module 'rfc.zlib)
 
 (test* "zlib-version" #t (string? (zlib-version)))
@@ -219,6 +230,112 @@
          (close-output-port p)
          (zstream-data-type p)))
 
+;;------------------------------------------------------------------
+(test-section "parallel deflating port")
+
+(define (pdeflate-string str . args)
+  (call-with-output-string
+    (^p (let1 p2 (apply open-parallel-deflating-port p args)
+          (display str p2)
+          (close-output-port p2)))))
+
+(let1 data (with-output-to-string
+             (^[] (dotimes [i 20000] (write i) (write-char #\space))))
+  (define (tst workers block-size)
+    (test* #"parallel deflate (workers ~workers, block-size ~block-size)"
+           data
+           (gzip-decode-string
+            (pdeflate-string data :workers workers :block-size block-size))))
+  (tst 0 0)
+  (tst 1 1024)
+  (tst 4 1024)
+  (tst 4 5000)
+  (tst #f 0)
+  ;; the output doesn't depend on the number of workers
+  (test* "parallel deflate (deterministic)" #t
+         (equal? (pdeflate-string data :workers 0 :block-size 4096)
+                 (pdeflate-string data :workers 3 :block-size 4096))))
+
+(test* "parallel deflate (empty)" ""
+       (gzip-decode-string (pdeflate-string "")))
+
+(test* "parallel deflate (flush)" "abcdef"
+       (let* ([out (open-output-string)]
+              [p (open-parallel-deflating-port out :workers 2)])
+         (display "abc" p)
+         (flush p)
+         (display "def" p)
+         (close-output-port p)
+         (gzip-decode-string (get-output-string out))))
+
+(test* "<parallel-deflating-port>" <parallel-deflating-port>
+       (class-of (open-parallel-deflating-port (open-output-string))))
+
+(test* "parallel deflate owner?" '(#t #f)
+       (map (^[owner?]
+              (let* ([out (open-output-string)]
+                     [p (open-parallel-deflating-port out :owner? owner?)])
+                (close-output-port p)
+                (port-closed? out)))
+            '(#t #f)))
+
+(test* "parallel deflate (bad level)" (test-error <zlib-error>)
+       (open-parallel-deflating-port (open-output-string)
+                                     :compression-level 42))
+
+;;------------------------------------------------------------------
+(test-section "one-shot compression")
+
+(let* ([data (string->u8vector
+              (with-output-to-string
+                (^[] (dotimes [i 3000] (write i) (write-char #\space)))))]
+       [size (u8vector-length data)])
+  (test* "deflate-u8vector / inflate-u8vector" data
+         (inflate-u8vector (deflate-u8vector data)))
+  (test* "deflate-u8vector (interoperability)" (u8vector->string data)
+         (inflate-string (u8vector->string (deflate-u8vector data))))
+  (test* "inflate-u8vector (interoperability)" data
+         (inflate-u8vector (deflate-string (u8vector->string data))))
+  (test* "deflate-u8vector (gzip)" (u8vector->string data)
+         (gzip-decode-string
+          (u8vector->string (deflate-u8vector data :window-bits (+ 15 16)))))
+  (test* "deflate-u8vector (start/end)" (u8vector-copy data 10 100)
+         (inflate-u8vector (deflate-u8vector data :start 10 :end 100)))
+  (test* "deflate-u8vector (string)" data
+         (inflate-u8vector (deflate-u8vector (u8vector->string data))))
+  (test* "deflate-u8vector (range error)" (test-error)
+         (deflate-u8vector data :start 10 :end (+ size 1)))
+
+  (let* ([buf (make-u8vector (+ (deflate-bound size) 5) 0)]
+         [n (deflate-u8vector! buf data :dst-start 5)]
+         [out (make-u8vector (+ size 3) 0)])
+    (test* "deflate-u8vector!" #t (and (integer? n) (<= n (deflate-bound size))))
+    (test* "inflate-u8vector!" size
+           (inflate-u8vector! out buf :start 5 :end (+ n 5) :dst-start 3))
+    (test* "inflate-u8vector! content" data (u8vector-copy out 3))
+    (test* "inflate-u8vector! (no room)" #f
+           (inflate-u8vector! (make-u8vector 10) buf :start 5))
+    (test* "deflate-u8vector! (no room)" #f
+           (deflate-u8vector! (make-u8vector 4) data)))
+
+  (test* "inflate-u8vector (truncated)" (test-error <zlib-data-error>)
+         (let1 v (deflate-u8vector data)
+           (inflate-u8vector v :end (quotient (u8vector-length v) 2))))
+  (test* "inflate-u8vector (bad data)" (test-error <zlib-data-error>)
+         (inflate-u8vector (make-u8vector 10 1)))
+  (test* "inflate-u8vector (empty)" '#u8()
+         (inflate-u8vector (deflate-u8vector '#u8())))
+  ;; The z_stream pool must not mix up parameters
+  (test* "deflate-u8vector (different parameters)"
+         (list data data data)
+         (list (inflate-u8vector (deflate-u8vector data
+                                                   :compression-level 1))
+               (inflate-u8vector (deflate-u8vector data
+                                                   :window-bits (+ 15 16))
+                                 :window-bits (+ 15 16))
+               (inflate-u8vector (deflate-u8vector data :window-bits 9)
+                                 :window-bits 9))))
+
 ;;------------------------------------------------------------------
 (test-section "inflate port")
 
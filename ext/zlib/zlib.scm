@@ -42,6 +42,7 @@
           <zlib-stream-error> <zlib-data-error>
           <zlib-memory-error> <zlib-version-error>
           <deflating-port> <inflating-port>
+          open-parallel-deflating-port <parallel-deflating-port>
           deflating-port-full-flush
           zstream-total-in zstream-total-out
           zstream-params-set!
@@ -49,6 +50,8 @@
           zstream-data-type
           zstream-dictionary-adler32
           gzip-encode-string gzip-decode-string
+          deflate-u8vector deflate-u8vector! deflate-bound
+          inflate-u8vector inflate-u8vector!
           inflate-sync
           Z_NO_COMPRESSION Z_BEST_SPEED
           Z_BEST_COMPRESSION Z_DEFAULT_COMPRESSION
@@ -127,6 +130,16 @@
                                   memory-level strategy dictionary
                                   buffer-size (not (SCM_FALSEP owner?)))))
 
+ (define-cproc %open-parallel-deflating-port (sink::<output-port>
+                                             compression-level::<fixnum>
+                                             strategy::<fixnum>
+                                             block-size::<fixnum>
+                                             workers::<fixnum>
+                                             owner?)
+   (return (Scm_MakeParallelDeflatingPort sink compression-level strategy
+                                          block-size workers
+                                          (not (SCM_FALSEP owner?)))))
+
  (define-cproc open-inflating-port (sink::<input-port>
                                     :key (buffer-size::<fixnum> 0)
                                     (window-bits::<fixnum> 15)
@@ -174,6 +187,94 @@
    (return (-> (SCM_PORT_ZLIB_INFO port) dict_adler)))
 
  (define-cproc inflate-sync (port::<inflating-port>) Scm_InflateSync)
+
+ ;; One-shot compression.  DATA can be a u8vector or a string; START and
+ ;; END select the region of it.
+ (define-cfn data_region (data::ScmObj start::ScmSmallInt end::ScmSmallInt
+                          pstart::(const unsigned char**) psiz::int*)
+   ::void :static
+   (data_element data pstart psiz)
+   (when (< end 0) (set! end (* psiz)))
+   (unless (and (<= 0 start) (<= start end) (<= end (* psiz)))
+     (Scm_Error "start/end out of range: (%ld %ld)" start end))
+   (set! (* pstart) (+ (* pstart) start)
+         (* psiz) (- end start)))
+
+ (define-cproc deflate-bound (size::<fixnum>
+                              :key (compression-level::<fixnum> -1)
+                                   (window-bits::<fixnum> 15)
+                                   (memory-level::<fixnum> 8)
+                                   (strategy::<fixnum> 0))
+   ::<int>
+   (return (Scm_DeflateBound size compression-level window-bits
+                             memory-level strategy)))
+
+ (define-cproc deflate-u8vector (data
+                                 :key (compression-level::<fixnum> -1)
+                                      (window-bits::<fixnum> 15)
+                                      (memory-level::<fixnum> 8)
+                                      (strategy::<fixnum> 0)
+                                      (start::<fixnum> 0)
+                                      (end::<fixnum> -1))
+   (let* ([src::(const unsigned char*)]
+          [siz::int])
+     (data_region data start end (& src) (& siz))
+     (let* ([bound::int (Scm_DeflateBound siz compression-level window-bits
+                                          memory-level strategy)]
+            [buf::(unsigned char*) (SCM_NEW_ATOMIC2 (unsigned char*) bound)]
+            [n::int (Scm_DeflateBuffer buf bound src siz compression-level
+                                       window-bits memory-level strategy)])
+       (SCM_ASSERT (>= n 0))
+       (return (Scm_MakeU8VectorFromArrayShared n buf)))))
+
+ (define-cproc deflate-u8vector! (dst::<u8vector> data
+                                  :key (compression-level::<fixnum> -1)
+                                       (window-bits::<fixnum> 15)
+                                       (memory-level::<fixnum> 8)
+                                       (strategy::<fixnum> 0)
+                                       (start::<fixnum> 0)
+                                       (end::<fixnum> -1)
+                                       (dst-start::<fixnum> 0))
+   (let* ([src::(const unsigned char*)]
+          [siz::int]
+          [dsiz::int (SCM_U8VECTOR_SIZE dst)])
+     (SCM_UVECTOR_CHECK_MUTABLE dst)
+     (unless (and (<= 0 dst-start) (<= dst-start dsiz))
+       (Scm_Error "dst-start out of range: %ld" dst-start))
+     (data_region data start end (& src) (& siz))
+     (let* ([n::int (Scm_DeflateBuffer (+ (SCM_U8VECTOR_ELEMENTS dst)
+                                          dst-start)
+                                       (- dsiz dst-start) src siz
+                                       compression-level window-bits
+                                       memory-level strategy)])
+       (return (?: (< n 0) SCM_FALSE (SCM_MAKE_INT n))))))
+
+ (define-cproc inflate-u8vector (data
+                                 :key (window-bits::<fixnum> 15)
+                                      (start::<fixnum> 0)
+                                      (end::<fixnum> -1))
+   (let* ([src::(const unsigned char*)]
+          [siz::int])
+     (data_region data start end (& src) (& siz))
+     (return (Scm_InflateToU8Vector src siz window-bits))))
+
+ (define-cproc inflate-u8vector! (dst::<u8vector> data
+                                  :key (window-bits::<fixnum> 15)
+                                       (start::<fixnum> 0)
+                                       (end::<fixnum> -1)
+                                       (dst-start::<fixnum> 0))
+   (let* ([src::(const unsigned char*)]
+          [siz::int]
+          [dsiz::int (SCM_U8VECTOR_SIZE dst)])
+     (SCM_UVECTOR_CHECK_MUTABLE dst)
+     (unless (and (<= 0 dst-start) (<= dst-start dsiz))
+       (Scm_Error "dst-start out of range: %ld" dst-start))
+     (data_region data start end (& src) (& siz))
+     (let* ([n::int (Scm_InflateBuffer (+ (SCM_U8VECTOR_ELEMENTS dst)
+                                          dst-start)
+                                       (- dsiz dst-start) src siz
+                                       window-bits)])
+       (return (?: (< n 0) SCM_FALSE (SCM_MAKE_INT n))))))
  )
  
 
@@ -193,6 +294,16 @@
                         strategy dictionary
                         buffer-size owner?))
 
+;; The output is a gzip stream; workers #f means one per processor.
+(define (open-parallel-deflating-port sink
+                                      :key (compression-level Z_DEFAULT_COMPRESSION)
+                                           (strategy Z_DEFAULT_STRATEGY)
+                                           (block-size 0)
+                                           (workers #f)
+                                           (owner? #f))
+  (%open-parallel-deflating-port sink compression-level strategy
+                                 block-size (or workers -1) owner?))
+
 ;; utility procedures
 (define (deflate-string str . args)
   (call-with-output-string
@@ -0,0 +1,530 @@
+/*
+ * gauche-zstd.c - zstd compression for rfc.zstd
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "gauche-zstd.h"
+#include <gauche/class.h>
+#include <zdict.h>
+
+#define DEFAULT_BUFFER_SIZE 8192
+#define MINIMUM_BUFFER_SIZE 1024
+
+/*================================================================
+ * Class stuff
+ */
+
+static ScmClass *port_cpl[] = {
+    SCM_CLASS_STATIC_PTR(Scm_PortClass),
+    SCM_CLASS_STATIC_PTR(Scm_TopClass),
+    NULL
+};
+
+SCM_DEFINE_BASE_CLASS(Scm_ZstdCompressingPortClass,
+                      ScmPort, /* instance type */
+                      NULL, NULL, NULL, NULL, port_cpl);
+
+SCM_DEFINE_BASE_CLASS(Scm_ZstdDecompressingPortClass,
+                      ScmPort, /* instance type */
+                      NULL, NULL, NULL, NULL, port_cpl);
+
+static ScmModule *zstd_module = NULL;
+
+/*================================================================
+ * Common
+ */
+
+/* Raises <zstd-error>, which is defined in zstd.scm. */
+static void zstd_error(const char *msg, ...)
+{
+    static ScmObj zstd_error_class = SCM_UNDEFINED;
+    va_list args;
+
+    SCM_BIND_PROC(zstd_error_class, "<zstd-error>", zstd_module);
+    ScmObj ostr = Scm_MakeOutputStringPort(TRUE);
+    va_start(args, msg);
+    Scm_Vprintf(SCM_PORT(ostr), msg, args, TRUE);
+    va_end(args);
+    Scm_RaiseCondition(zstd_error_class, SCM_RAISE_CONDITION_MESSAGE,
+                       "%A", Scm_GetOutputString(SCM_PORT(ostr), 0));
+}
+
+static void check_result(size_t r, const char *what)
+{
+    if (ZSTD_isError(r)) zstd_error("%s: %s", what, ZSTD_getErrorName(r));
+}
+
+/* Get the content of a u8vector or a string. */
+static void data_element(ScmObj data, const void **start, size_t *size)
+{
+    if (SCM_U8VECTORP(data)) {
+        *start = SCM_U8VECTOR_ELEMENTS(data);
+        *size = SCM_U8VECTOR_SIZE(data);
+    } else if (SCM_STRINGP(data)) {
+        const ScmStringBody *b = SCM_STRING_BODY(data);
+        *start = SCM_STRING_BODY_START(b);
+        *size = SCM_STRING_BODY_SIZE(b);
+    } else {
+        Scm_Error("u8vector or string required, but got: %S", data);
+    }
+}
+
+static int fix_buffer_size(int siz)
+{
+    if (siz <= 0) return DEFAULT_BUFFER_SIZE;
+    if (siz <= MINIMUM_BUFFER_SIZE) return MINIMUM_BUFFER_SIZE;
+    return siz;
+}
+
+static ScmObj port_name(const char *type, ScmPort *source)
+{
+    ScmObj out = Scm_MakeOutputStringPort(TRUE);
+    Scm_Printf(SCM_PORT(out), "[%s %A]",
+               type, Scm_PortName(source));
+    return Scm_GetOutputStringUnsafe(SCM_PORT(out), 0);
+}
+
+static int zstd_fileno(ScmPort *port)
+{
+    return Scm_PortFileNo(SCM_PORT_ZSTD_INFO(port)->remote);
+}
+
+/*
+ * Contexts are expensive to create compared to compressing a small
+ * message, so the one-shot procedures pool them.
+ */
+#define CTX_POOL_MAX 8
+
+static struct {
+    ZSTD_CCtx *cctx[CTX_POOL_MAX];
+    int ncctx;
+    ZSTD_DCtx *dctx[CTX_POOL_MAX];
+    int ndctx;
+    ScmInternalMutex mutex;
+} ctx_pool;
+
+static ZSTD_CCtx *get_cctx(void)
+{
+    ZSTD_CCtx *c = NULL;
+    (void)SCM_INTERNAL_MUTEX_LOCK(ctx_pool.mutex);
+    if (ctx_pool.ncctx > 0) c = ctx_pool.cctx[--ctx_pool.ncctx];
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(ctx_pool.mutex);
+    if (c == NULL) {
+        c = ZSTD_createCCtx();
+        if (c == NULL) zstd_error("couldn't create a compression context");
+    } else {
+        ZSTD_CCtx_reset(c, ZSTD_reset_session_and_parameters);
+    }
+    return c;
+}
+
+static void put_cctx(ZSTD_CCtx *c)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(ctx_pool.mutex);
+    if (ctx_pool.ncctx < CTX_POOL_MAX) {
+        ctx_pool.cctx[ctx_pool.ncctx++] = c;
+        c = NULL;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(ctx_pool.mutex);
+    if (c) ZSTD_freeCCtx(c);
+}
+
+static ZSTD_DCtx *get_dctx(void)
+{
+    ZSTD_DCtx *d = NULL;
+    (void)SCM_INTERNAL_MUTEX_LOCK(ctx_pool.mutex);
+    if (ctx_pool.ndctx > 0) d = ctx_pool.dctx[--ctx_pool.ndctx];
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(ctx_pool.mutex);
+    if (d == NULL) {
+        d = ZSTD_createDCtx();
+        if (d == NULL) zstd_error("couldn't create a decompression context");
+    } else {
+        ZSTD_DCtx_reset(d, ZSTD_reset_session_and_parameters);
+    }
+    return d;
+}
+
+static void put_dctx(ZSTD_DCtx *d)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(ctx_pool.mutex);
+    if (ctx_pool.ndctx < CTX_POOL_MAX) {
+        ctx_pool.dctx[ctx_pool.ndctx++] = d;
+        d = NULL;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(ctx_pool.mutex);
+    if (d) ZSTD_freeDCtx(d);
+}
+
+/* Set up compression parameters.  Returns NULL on success, or
+   the name of the failed step. */
+static const char *setup_cctx(ZSTD_CCtx *c, int level, int nworkers,
+                              ScmObj dict, size_t *err)
+{
+    size_t r = ZSTD_CCtx_setParameter(c, ZSTD_c_compressionLevel, level);
+    if (ZSTD_isError(r)) { *err = r; return "setting compression level"; }
+    r = ZSTD_CCtx_setParameter(c, ZSTD_c_checksumFlag, 1);
+    if (ZSTD_isError(r)) { *err = r; return "setting checksum flag"; }
+    if (nworkers > 0) {
+        r = ZSTD_CCtx_setParameter(c, ZSTD_c_nbWorkers, nworkers);
+        if (ZSTD_isError(r)) { *err = r; return "setting number of workers"; }
+    }
+    if (!SCM_FALSEP(dict)) {
+        const void *d; size_t dsiz;
+        data_element(dict, &d, &dsiz);
+        r = ZSTD_CCtx_loadDictionary(c, d, dsiz);
+        if (ZSTD_isError(r)) { *err = r; return "loading dictionary"; }
+    }
+    return NULL;
+}
+
+static const char *setup_dctx(ZSTD_DCtx *d, ScmObj dict, size_t *err)
+{
+    if (!SCM_FALSEP(dict)) {
+        const void *p; size_t dsiz;
+        data_element(dict, &p, &dsiz);
+        size_t r = ZSTD_DCtx_loadDictionary(d, p, dsiz);
+        if (ZSTD_isError(r)) { *err = r; return "loading dictionary"; }
+    }
+    return NULL;
+}
+
+/*================================================================
+ * Compressing port
+ */
+
+static int compress_flusher(ScmPort *port, int cnt, int forcep)
+{
+    ScmZstdInfo *info = SCM_PORT_ZSTD_INFO(port);
+    ZSTD_inBuffer in = { port->src.buf.buffer, SCM_PORT_BUFFER_AVAIL(port), 0 };
+    ZSTD_EndDirective mode = forcep? ZSTD_e_flush : ZSTD_e_continue;
+
+    for (;;) {
+        ZSTD_outBuffer out = { info->buf, info->bufsiz, 0 };
+        size_t r = ZSTD_compressStream2(info->cctx, &out, &in, mode);
+        check_result(r, "compression failed");
+        if (out.pos > 0) Scm_Putz(info->buf, out.pos, info->remote);
+        if (forcep? (r == 0) : (in.pos == in.size)) break;
+    }
+    return in.pos;
+}
+
+static void compress_closer(ScmPort *port)
+{
+    ScmZstdInfo *info = SCM_PORT_ZSTD_INFO(port);
+    ZSTD_inBuffer in = { port->src.buf.buffer, SCM_PORT_BUFFER_AVAIL(port), 0 };
+
+    if (info->cctx == NULL) return;
+    for (;;) {
+        ZSTD_outBuffer out = { info->buf, info->bufsiz, 0 };
+        size_t r = ZSTD_compressStream2(info->cctx, &out, &in, ZSTD_e_end);
+        if (ZSTD_isError(r)) {
+            ZSTD_freeCCtx(info->cctx);
+            info->cctx = NULL;
+            check_result(r, "compression failed");
+        }
+        if (out.pos > 0) Scm_Putz(info->buf, out.pos, info->remote);
+        if (r == 0) break;
+    }
+    ZSTD_freeCCtx(info->cctx);
+    info->cctx = NULL;
+    Scm_Flush(info->remote);
+    if (info->ownerp) {
+        Scm_ClosePort(info->remote);
+    }
+}
+
+ScmObj Scm_MakeZstdCompressingPort(ScmPort *drain, int level, int nworkers,
+                                   ScmObj dict, int bufsiz, int ownerp)
+{
+    ScmZstdInfo *info = SCM_NEW(ScmZstdInfo);
+
+    bufsiz = fix_buffer_size(bufsiz);
+    info->cctx = ZSTD_createCCtx();
+    if (info->cctx == NULL) {
+        zstd_error("couldn't create a compression context");
+    }
+    size_t err = 0;
+    const char *what = setup_cctx(info->cctx, level, nworkers, dict, &err);
+    if (what) {
+        ZSTD_freeCCtx(info->cctx);
+        zstd_error("%s failed: %s", what, ZSTD_getErrorName(err));
+    }
+    info->remote = drain;
+    info->ownerp = ownerp;
+    info->dctx = NULL;
+    info->bufsiz = ZSTD_CStreamOutSize();
+    info->buf = SCM_NEW_ATOMIC2(char*, info->bufsiz);
+    info->inpos = info->inlen = 0;
+    info->hint = 0;
+    info->stream_endp = FALSE;
+
+    ScmPortBuffer bufrec;
+    memset(&bufrec, 0, sizeof(bufrec));
+    bufrec.size = bufsiz;
+    bufrec.buffer = SCM_NEW_ATOMIC2(char *, bufsiz);
+    bufrec.mode = SCM_PORT_BUFFER_FULL;
+    bufrec.filler = NULL;
+    bufrec.flusher = compress_flusher;
+    bufrec.closer = compress_closer;
+    bufrec.ready = NULL;
+    bufrec.filenum = zstd_fileno;
+    bufrec.data = (void*)info;
+
+    ScmObj name = port_name("zstd compressing", drain);
+    return Scm_MakeBufferedPort(SCM_CLASS_ZSTD_COMPRESSING_PORT, name,
+                                SCM_PORT_OUTPUT, TRUE, &bufrec);
+}
+
+/*================================================================
+ * Decompressing port
+ */
+
+static int decompress_filler(ScmPort *port, int mincnt)
+{
+    ScmZstdInfo *info = SCM_PORT_ZSTD_INFO(port);
+    ZSTD_outBuffer out = { port->src.buf.end, SCM_PORT_BUFFER_ROOM(port), 0 };
+
+    while (out.pos == 0) {
+        if (info->inpos == info->inlen) {
+            if (info->stream_endp) break;
+            int nread = Scm_Getz(info->buf, info->bufsiz, info->remote);
+            if (nread <= 0) {
+                /* input reached EOF */
+                info->stream_endp = TRUE;
+                if (info->hint != 0) {
+                    info->hint = 0;
+                    zstd_error("truncated input from %S", info->remote);
+                }
+                break;
+            }
+            info->inpos = 0;
+            info->inlen = nread;
+        }
+        ZSTD_inBuffer in = { info->buf, info->inlen, info->inpos };
+        size_t r = ZSTD_decompressStream(info->dctx, &out, &in);
+        info->inpos = in.pos;
+        if (ZSTD_isError(r)) {
+            /* Don't try to recover. */
+            info->stream_endp = TRUE;
+            info->inpos = info->inlen;
+            info->hint = 0;
+            check_result(r, "decompression failed");
+        }
+        info->hint = r;
+    }
+    return out.pos;
+}
+
+static void decompress_closer(ScmPort *port)
+{
+    ScmZstdInfo *info = SCM_PORT_ZSTD_INFO(port);
+    if (info->dctx) {
+        ZSTD_freeDCtx(info->dctx);
+        info->dctx = NULL;
+    }
+    if (info->ownerp) {
+        Scm_ClosePort(info->remote);
+    }
+}
+
+static int decompress_ready(ScmPort *port)
+{
+    ScmZstdInfo *info = SCM_PORT_ZSTD_INFO(port);
+    if (info->inpos < info->inlen) return SCM_FD_READY;
+    return Scm_ByteReady(info->remote);
+}
+
+ScmObj Scm_MakeZstdDecompressingPort(ScmPort *source, ScmObj dict,
+                                     int bufsiz, int ownerp)
+{
+    ScmZstdInfo *info = SCM_NEW(ScmZstdInfo);
+
+    bufsiz = fix_buffer_size(bufsiz);
+    info->dctx = ZSTD_createDCtx();
+    if (info->dctx == NULL) {
+        zstd_error("couldn't create a decompression context");
+    }
+    size_t err = 0;
+    const char *what = setup_dctx(info->dctx, dict, &err);
+    if (what) {
+        ZSTD_freeDCtx(info->dctx);
+        zstd_error("%s failed: %s", what, ZSTD_getErrorName(err));
+    }
+    info->remote = source;
+    info->ownerp = ownerp;
+    info->cctx = NULL;
+    info->bufsiz = ZSTD_DStreamInSize();
+    info->buf = SCM_NEW_ATOMIC2(char*, info->bufsiz);
+    info->inpos = info->inlen = 0;
+    info->hint = 0;
+    info->stream_endp = FALSE;
+
+    ScmPortBuffer bufrec;
+    memset(&bufrec, 0, sizeof(bufrec));
+    bufrec.size = bufsiz;
+    bufrec.buffer = SCM_NEW_ATOMIC2(char *, bufsiz);
+    bufrec.mode = SCM_PORT_BUFFER_FULL;
+    bufrec.filler = decompress_filler;
+    bufrec.flusher = NULL;
+    bufrec.closer = decompress_closer;
+    bufrec.ready = decompress_ready;
+    bufrec.filenum = zstd_fileno;
+    bufrec.data = (void*)info;
+
+    ScmObj name = port_name("zstd decompressing", source);
+    return Scm_MakeBufferedPort(SCM_CLASS_ZSTD_DECOMPRESSING_PORT, name,
+                                SCM_PORT_INPUT, TRUE, &bufrec);
+}
+
+/*================================================================
+ * One-shot compression
+ */
+
+ScmObj Scm_ZstdCompress(const unsigned char *src, size_t size,
+                        int level, ScmObj dict)
+{
+    ZSTD_CCtx *c = get_cctx();
+    size_t err = 0;
+    const char *what = setup_cctx(c, level, 0, dict, &err);
+    if (what) {
+        put_cctx(c);
+        zstd_error("%s failed: %s", what, ZSTD_getErrorName(err));
+    }
+    size_t bound = ZSTD_compressBound(size);
+    unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*, bound);
+    size_t r = ZSTD_compress2(c, buf, bound, src, size);
+    put_cctx(c);
+    check_result(r, "compression failed");
+    return Scm_MakeU8VectorFromArrayShared(r, buf);
+}
+
+ScmObj Scm_ZstdDecompress(const unsigned char *src, size_t size,
+                          ScmObj dict)
+{
+    if (size == 0) return Scm_MakeU8Vector(0, 0);
+
+    ZSTD_DCtx *d = get_dctx();
+    size_t err = 0;
+    const char *what = setup_dctx(d, dict, &err);
+    if (what) {
+        put_dctx(d);
+        zstd_error("%s failed: %s", what, ZSTD_getErrorName(err));
+    }
+
+    /* The frame header usually tells the size; it's exact if there's
+       only one frame in SRC. */
+    unsigned long long csize = ZSTD_getFrameContentSize(src, size);
+    size_t bufsiz;
+    if (csize == ZSTD_CONTENTSIZE_ERROR || csize == ZSTD_CONTENTSIZE_UNKNOWN
+        || csize > (unsigned long long)SCM_SMALL_INT_MAX/2) {
+        bufsiz = (size < 64)? 256 : size * 4;
+    } else {
+        bufsiz = (csize == 0)? 1 : csize;
+    }
+    unsigned char *buf = SCM_NEW_ATOMIC2(unsigned char*, bufsiz);
+    ZSTD_inBuffer in = { src, size, 0 };
+    ZSTD_outBuffer out = { buf, bufsiz, 0 };
+    size_t r = 0;
+
+    for (;;) {
+        r = ZSTD_decompressStream(d, &out, &in);
+        if (ZSTD_isError(r)) {
+            put_dctx(d);
+            check_result(r, "decompression failed");
+        }
+        if (in.pos == in.size && (r == 0 || out.pos < out.size)) break;
+        if (out.pos == out.size) {
+            /* The decoder may have more output. */
+            if (out.size >= (size_t)SCM_SMALL_INT_MAX/2) {
+                put_dctx(d);
+                zstd_error("decompressed data too big");
+            }
+            unsigned char *nbuf = SCM_NEW_ATOMIC2(unsigned char*, out.size*2);
+            memcpy(nbuf, buf, out.pos);
+            buf = nbuf;
+            out.dst = nbuf;
+            out.size *= 2;
+        }
+    }
+    put_dctx(d);
+    if (r != 0) zstd_error("truncated input");
+    return Scm_MakeU8VectorFromArrayShared(out.pos, buf);
+}
+
+ScmObj Scm_ZstdTrainDictionary(ScmObj samples, int dictsize)
+{
+    int nsamples = Scm_Length(samples);
+    if (nsamples <= 0) Scm_Error("list of samples required, but got %S",
+                                 samples);
+    if (dictsize <= 0) Scm_Error("dictionary size must be positive: %d",
+                                 dictsize);
+    size_t *sizes = SCM_NEW_ATOMIC2(size_t*, nsamples * sizeof(size_t));
+    size_t total = 0;
+    int i = 0;
+    ScmObj cp;
+    SCM_FOR_EACH(cp, samples) {
+        const void *p; size_t siz;
+        data_element(SCM_CAR(cp), &p, &siz);
+        sizes[i++] = siz;
+        total += siz;
+    }
+    char *all = SCM_NEW_ATOMIC2(char*, total + 1);
+    char *q = all;
+    SCM_FOR_EACH(cp, samples) {
+        const void *p; size_t siz;
+        data_element(SCM_CAR(cp), &p, &siz);
+        memcpy(q, p, siz);
+        q += siz;
+    }
+
+    unsigned char *dict = SCM_NEW_ATOMIC2(unsigned char*, dictsize);
+    size_t r = ZDICT_trainFromBuffer(dict, dictsize, all, sizes, nsamples);
+    if (ZDICT_isError(r)) {
+        zstd_error("dictionary training failed: %s", ZDICT_getErrorName(r));
+    }
+    return Scm_MakeU8VectorFromArrayShared(r, dict);
+}
+
+/*
+ * Module initialization function.
+ */
+void Scm_Init_zstd(void)
+{
+    ScmModule *mod = SCM_MODULE(SCM_FIND_MODULE("rfc.zstd", TRUE));
+    zstd_module = mod;
+    (void)SCM_INTERNAL_MUTEX_INIT(ctx_pool.mutex);
+
+    Scm_InitStaticClass(&Scm_ZstdCompressingPortClass,
+                        "<zstd-compressing-port>", mod, NULL, 0);
+    Scm_InitStaticClass(&Scm_ZstdDecompressingPortClass,
+                        "<zstd-decompressing-port>", mod, NULL, 0);
+}
@@ -0,0 +1,84 @@
+/*
+ * gauche-zstd.h - zstd module
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GAUCHE_ZSTD_H
+#define GAUCHE_ZSTD_H
+
+#include <gauche.h>
+#include <gauche/extend.h>
+#include <zstd.h>
+
+SCM_DECL_BEGIN
+
+typedef struct ScmZstdInfoRec {
+    ScmPort *remote;            /* source or drain port */
+    int ownerp;
+    ZSTD_CCtx *cctx;            /* compressing port */
+    ZSTD_DCtx *dctx;            /* decompressing port */
+    char *buf;                  /* compressed data */
+    size_t bufsiz;
+    size_t inpos;               /* decompressing: buf[inpos..inlen) is */
+    size_t inlen;               /*   the input not consumed yet. */
+    size_t hint;                /* nonzero while in the middle of a frame */
+    int stream_endp;
+} ScmZstdInfo;
+
+#define SCM_PORT_ZSTD_INFO(p) ((ScmZstdInfo*)(p)->src.buf.data)
+
+SCM_CLASS_DECL(Scm_ZstdCompressingPortClass);
+#define SCM_CLASS_ZSTD_COMPRESSING_PORT  (&Scm_ZstdCompressingPortClass)
+#define SCM_ZSTD_COMPRESSING_PORT_P(obj) \
+    SCM_ISA(obj, SCM_CLASS_ZSTD_COMPRESSING_PORT)
+SCM_CLASS_DECL(Scm_ZstdDecompressingPortClass);
+#define SCM_CLASS_ZSTD_DECOMPRESSING_PORT  (&Scm_ZstdDecompressingPortClass)
+#define SCM_ZSTD_DECOMPRESSING_PORT_P(obj) \
+    SCM_ISA(obj, SCM_CLASS_ZSTD_DECOMPRESSING_PORT)
+
+extern ScmObj Scm_MakeZstdCompressingPort(ScmPort *drain, int level,
+                                          int nworkers, ScmObj dict,
+                                          int bufsiz, int ownerp);
+extern ScmObj Scm_MakeZstdDecompressingPort(ScmPort *source, ScmObj dict,
+                                            int bufsiz, int ownerp);
+
+extern ScmObj Scm_ZstdCompress(const unsigned char *src, size_t size,
+                               int level, ScmObj dict);
+extern ScmObj Scm_ZstdDecompress(const unsigned char *src, size_t size,
+                                 ScmObj dict);
+extern ScmObj Scm_ZstdTrainDictionary(ScmObj samples, int dictsize);
+
+extern void Scm_Init_zstd(void);
+
+SCM_DECL_END
+
+#endif /* GAUCHE_ZSTD_H */
@@ -0,0 +1,154 @@
+;;;
+;;; Test zstd
+;;;
+
+#!no-fold-case
+
+(use gauche.test)
+(use gauche.uvector)
+(use gauche.process)
+(use file.util)
+
+(test-start "rfc.zstd")
+
+;; bail out if we aren't configured to build zstd
+(unless (file-exists? (string-append "zstd." (gauche-dso-suffix)))
+  (test-end)
+  (exit 0))
+
+(load "./zstd")
+(import rfc.zstd)
+(test-module 'rfc.zstd)
+
+(test* "zstd-version" #t (string? (zstd-version)))
+(test* "zstd-max-compression-level" #t (>= (zstd-max-compression-level) 19))
+
+(define *data*
+  (with-output-to-string
+    (^[] (dotimes [i 20000] (write i) (write-char #\space)))))
+
+(define (compress-via-port data . args)
+  (call-with-output-string
+    (^p (let1 p2 (apply open-zstd-compressing-port p args)
+          (display data p2)
+          (close-output-port p2)))))
+
+(define (decompress-via-port data . args)
+  (port->string (apply open-zstd-decompressing-port
+                       (open-input-string data) args)))
+
+;;------------------------------------------------------------------
+(test-section "one-shot")
+
+(test* "zstd-compress / zstd-decompress" (string->u8vector *data*)
+       (zstd-decompress (zstd-compress *data*)))
+(test* "zstd-compress (smaller)" #t
+       (< (u8vector-length (zstd-compress *data*)) (string-size *data*)))
+(test* "zstd-compress (level)" (string->u8vector *data*)
+       (zstd-decompress (zstd-compress *data* :compression-level 1)))
+(test* "zstd-compress (start/end)" (string->u8vector *data* 10 100)
+       (zstd-decompress (zstd-compress (string->u8vector *data*)
+                                       :start 10 :end 100)))
+(test* "zstd-compress (range error)" (test-error)
+       (zstd-compress "abc" :end 4))
+(test* "zstd-compress (empty)" '#u8()
+       (zstd-decompress (zstd-compress "")))
+(test* "zstd-decompress (empty input)" '#u8()
+       (zstd-decompress '#u8()))
+(test* "zstd-decompress (concatenated frames)" (string->u8vector "abcdef")
+       (zstd-decompress (u8vector-append (zstd-compress "abc")
+                                         (zstd-compress "def"))))
+(test* "zstd-decompress (truncated)" (test-error <zstd-error>)
+       (let1 v (zstd-compress *data*)
+         (zstd-decompress v :end (- (u8vector-length v) 5))))
+(test* "zstd-decompress (garbage)" (test-error <zstd-error>)
+       (zstd-decompress (make-u8vector 20 7)))
+(test* "zstd-compress-string / zstd-decompress-string" *data*
+       (zstd-decompress-string (zstd-compress-string *data*)))
+
+;;------------------------------------------------------------------
+(test-section "dictionary")
+
+(let* ([samples (map (^i (format "{\"id\":~d,\"name\":\"user~d\",\"active\":~a}"
+                                 i i (if (odd? i) "true" "false")))
+                     (iota 2000))]
+       [dict (zstd-train-dictionary samples 4096)]
+       [msg (list-ref samples 1234)])
+  (test* "zstd-train-dictionary" #t
+         (and (u8vector? dict) (<= (u8vector-length dict) 4096)))
+  (test* "compress with dictionary" (string->u8vector msg)
+         (zstd-decompress (zstd-compress msg :dictionary dict)
+                          :dictionary dict))
+  (test* "dictionary improves ratio" #t
+         (< (u8vector-length (zstd-compress msg :dictionary dict))
+            (u8vector-length (zstd-compress msg))))
+  (test* "decompress without dictionary" (test-error <zstd-error>)
+         (zstd-decompress (zstd-compress msg :dictionary dict)))
+  (test* "ports with dictionary" msg
+         (decompress-via-port (compress-via-port msg :dictionary dict)
+                              :dictionary dict)))
+
+;;------------------------------------------------------------------
+(test-section "ports")
+
+(test* "<zstd-compressing-port>" <zstd-compressing-port>
+       (class-of (open-zstd-compressing-port (open-output-string))))
+(test* "<zstd-decompressing-port>" <zstd-decompressing-port>
+       (class-of (open-zstd-decompressing-port (open-input-string ""))))
+
+(test* "port round trip" *data*
+       (decompress-via-port (compress-via-port *data*)))
+(test* "port round trip (small buffer)" *data*
+       (decompress-via-port (compress-via-port *data* :buffer-size 1024)
+                            :buffer-size 1024))
+(test* "port -> one-shot" (string->u8vector *data*)
+       (zstd-decompress (compress-via-port *data* :compression-level 9)))
+(test* "one-shot -> port" *data*
+       (decompress-via-port (u8vector->string (zstd-compress *data*))))
+(test* "port (workers)" *data*
+       (guard (e [(<zstd-error> e) *data*]) ; libzstd may lack MT support
+         (decompress-via-port (compress-via-port *data* :workers 2))))
+
+(test* "flush" '(#t "abcdef")
+       (let* ([out (open-output-string)]
+              [p (open-zstd-compressing-port out)])
+         (display "abc" p)
+         (flush p)
+         (let1 flushed? (> (string-size (get-output-string out)) 0)
+           (display "def" p)
+           (close-output-port p)
+           (list flushed? (decompress-via-port (get-output-string out))))))
+
+(test* "decompressing port (truncated)" (test-error <zstd-error>)
+       (let1 v (string->u8vector (compress-via-port *data*))
+         (decompress-via-port
+          (u8vector->string v 0 (- (u8vector-length v) 5)))))
+
+(test* "owner?" '(#t #f)
+       (map (^[owner?]
+              (let* ([out (open-output-string)]
+                     [p (open-zstd-compressing-port out :owner? owner?)])
+                (close-output-port p)
+                (port-closed? out)))
+            '(#t #f)))
+
+;;------------------------------------------------------------------
+(test-section "interoperability")
+
+(if (find-file-in-paths "zstd")
+  (begin
+    (test* "zstd command decodes our output" *data*
+           (let1 f "test.o.zst"
+             (call-with-output-file f
+               (^p (write-uvector (zstd-compress *data*) p)))
+             (begin0 (call-with-input-process `("zstd" "-dc" ,f) port->string)
+               (sys-unlink f))))
+    (test* "we decode zstd command output" *data*
+           (let1 f "test.o"
+             (with-output-to-file f (^[] (display *data*)))
+             (begin0 (decompress-via-port
+                      (call-with-input-process `("zstd" "-c" ,f) port->string))
+               (sys-unlink f)))))
+  (test* "zstd command not found; skipping" #t #t))
+
+(test-end)
@@ -0,0 +1,135 @@
+;;;
+;;; rfc.zstd - zstd compression
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+#!no-fold-case
+
+(define-module rfc.zstd
+  (use gauche.uvector)
+  (export zstd-version zstd-max-compression-level
+          <zstd-error>
+          <zstd-compressing-port> <zstd-decompressing-port>
+          open-zstd-compressing-port open-zstd-decompressing-port
+          zstd-compress zstd-decompress zstd-train-dictionary
+          zstd-compress-string zstd-decompress-string))
+(select-module rfc.zstd)
+
+(define-condition-type <zstd-error> <error> #f)
+
+(inline-stub
+ (declcode "#include \"gauche-zstd.h\"")
+ (initcode (Scm_Init_zstd))
+
+ (define-type <zstd-compressing-port> "ScmPort*" "zstd compressing port"
+   "SCM_ZSTD_COMPRESSING_PORT_P" "SCM_PORT")
+ (define-type <zstd-decompressing-port> "ScmPort*" "zstd decompressing port"
+   "SCM_ZSTD_DECOMPRESSING_PORT_P" "SCM_PORT")
+
+ ;; DATA can be a u8vector or a string; START and END select the region.
+ (define-cfn data_region (data::ScmObj start::ScmSmallInt end::ScmSmallInt
+                          pstart::(const unsigned char**) psiz::size_t*)
+   ::void :static
+   (cond [(SCM_U8VECTORP data)
+          (set! (* pstart) (SCM_UVECTOR_ELEMENTS (SCM_U8VECTOR data))
+                (* psiz)   (SCM_U8VECTOR_SIZE (SCM_U8VECTOR data)))]
+         [(SCM_STRINGP data)
+          (let* ([b::(const ScmStringBody*) (SCM_STRING_BODY data)])
+            (set! (* pstart) (cast (unsigned char*) (SCM_STRING_BODY_START b))
+                  (* psiz)   (SCM_STRING_BODY_SIZE b)))]
+         [else
+          (Scm_Error "u8vector or string required, but got: %S" data)])
+   (when (< end 0) (set! end (* psiz)))
+   (unless (and (<= 0 start) (<= start end) (<= end (* psiz)))
+     (Scm_Error "start/end out of range: (%ld %ld)" start end))
+   (set! (* pstart) (+ (* pstart) start)
+         (* psiz) (- end start)))
+
+ (define-cproc zstd-version ()
+   (return (SCM_MAKE_STR (ZSTD_versionString))))
+
+ (define-cproc zstd-max-compression-level () ::<int> ZSTD_maxCLevel)
+
+ (define-cproc %open-zstd-compressing-port (drain::<output-port>
+                                            compression-level::<fixnum>
+                                            workers::<fixnum>
+                                            dictionary
+                                            buffer-size::<fixnum>
+                                            owner?)
+   (return (Scm_MakeZstdCompressingPort drain compression-level workers
+                                        dictionary buffer-size
+                                        (not (SCM_FALSEP owner?)))))
+
+ (define-cproc open-zstd-decompressing-port (source::<input-port>
+                                             :key (dictionary #f)
+                                                  (buffer-size::<fixnum> 0)
+                                                  (owner? #f))
+   (return (Scm_MakeZstdDecompressingPort source dictionary buffer-size
+                                          (not (SCM_FALSEP owner?)))))
+
+ (define-cproc zstd-compress (data :key (compression-level::<fixnum> 3)
+                                        (dictionary #f)
+                                        (start::<fixnum> 0)
+                                        (end::<fixnum> -1))
+   (let* ([src::(const unsigned char*)]
+          [siz::size_t])
+     (data_region data start end (& src) (& siz))
+     (return (Scm_ZstdCompress src siz compression-level dictionary))))
+
+ (define-cproc zstd-decompress (data :key (dictionary #f)
+                                          (start::<fixnum> 0)
+                                          (end::<fixnum> -1))
+   (let* ([src::(const unsigned char*)]
+          [siz::size_t])
+     (data_region data start end (& src) (& siz))
+     (return (Scm_ZstdDecompress src siz dictionary))))
+
+ (define-cproc zstd-train-dictionary (samples::<list>
+                                      :optional (size::<fixnum> 112640))
+   (return (Scm_ZstdTrainDictionary samples size)))
+ )
+
+(define (open-zstd-compressing-port drain
+                                    :key (compression-level 3)
+                                         (workers 0)
+                                         (dictionary #f)
+                                         (buffer-size 0)
+                                         (owner? #f))
+  (%open-zstd-compressing-port drain compression-level workers
+                               dictionary buffer-size owner?))
+
+;; utility procedures
+(define (zstd-compress-string str . args)
+  (u8vector->string (apply zstd-compress str args)))
+
+(define (zstd-decompress-string str . args)
+  (u8vector->string (apply zstd-decompress str args)))
@@ -338,6 +338,27 @@ GC_INLINE void GC_notify_full_gc(void)
     }
 }
 
+STATIC GC_on_collection_event_proc GC_on_collection_event = 0;
+
+GC_API void GC_CALL GC_set_on_collection_event(GC_on_collection_event_proc fn)
+{
+    /* fn may be 0 (means no event notifier). */
+    DCL_LOCK_STATE;
+    LOCK();
+    GC_on_collection_event = fn;
+    UNLOCK();
+}
+
+GC_API GC_on_collection_event_proc GC_CALL GC_get_on_collection_event(void)
+{
+    GC_on_collection_event_proc fn;
+    DCL_LOCK_STATE;
+    LOCK();
+    fn = GC_on_collection_event;
+    UNLOCK();
+    return fn;
+}
+
 STATIC GC_bool GC_is_full_gc = FALSE;
 
 STATIC GC_bool GC_stopped_mark(GC_stop_func stop_func);
@@ -425,6 +446,8 @@ GC_INNER GC_bool GC_try_to_collect_inner(GC_stop_func stop_func)
             GC_collect_a_little_inner(1);
         }
     }
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_START);
     GC_notify_full_gc();
 #   ifndef SMALL_CONFIG
       if (GC_print_stats) {
@@ -472,6 +495,8 @@ GC_INNER GC_bool GC_try_to_collect_inner(GC_stop_func stop_func)
                       MS_TIME_DIFF(current_time,start_time));
       }
 #   endif
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_END);
     return(TRUE);
 }
 
@@ -603,7 +628,11 @@ STATIC GC_bool GC_stopped_mark(GC_stop_func stop_func)
         GET_TIME(start_time);
 #   endif
 
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_PRE_STOP_WORLD);
     STOP_WORLD();
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_POST_STOP_WORLD);
 #   ifdef THREAD_LOCAL_ALLOC
       GC_world_stopped = TRUE;
 #   endif
@@ -618,6 +647,8 @@ STATIC GC_bool GC_stopped_mark(GC_stop_func stop_func)
 #   endif
 
     /* Mark from all roots.  */
+        if (GC_on_collection_event)
+          GC_on_collection_event(GC_EVENT_MARK_START);
         /* Minimize junk left in my registers and on the stack */
             GC_clear_a_few_frames();
             GC_noop6(0,0,0,0,0,0);
@@ -631,13 +662,19 @@ STATIC GC_bool GC_stopped_mark(GC_stop_func stop_func)
 #           ifdef THREAD_LOCAL_ALLOC
               GC_world_stopped = FALSE;
 #           endif
+            if (GC_on_collection_event)
+              GC_on_collection_event(GC_EVENT_PRE_START_WORLD);
             START_WORLD();
+            if (GC_on_collection_event)
+              GC_on_collection_event(GC_EVENT_POST_START_WORLD);
             return(FALSE);
           }
           if (GC_mark_some(GC_approx_sp())) break;
         }
 
     GC_gc_no++;
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_MARK_END);
     GC_DBGLOG_PRINTF("GC #%lu freed %ld bytes, heap %lu KiB"
                      IF_USE_MUNMAP(" (+ %lu KiB unmapped)") "\n",
                      (unsigned long)GC_gc_no, (long)GC_bytes_found,
@@ -652,7 +689,11 @@ STATIC GC_bool GC_stopped_mark(GC_stop_func stop_func)
 #   ifdef THREAD_LOCAL_ALLOC
       GC_world_stopped = FALSE;
 #   endif
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_PRE_START_WORLD);
     START_WORLD();
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_POST_START_WORLD);
 #   ifndef SMALL_CONFIG
       if (GC_PRINT_STATS_FLAG) {
         unsigned long time_diff;
@@ -914,7 +955,11 @@ STATIC void GC_finish_collection(void)
                           (long)GC_bytes_found);
 
     /* Reconstruct free lists to contain everything not marked */
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_RECLAIM_START);
     GC_start_reclaim(FALSE);
+    if (GC_on_collection_event)
+      GC_on_collection_event(GC_EVENT_RECLAIM_END);
     GC_DBGLOG_PRINTF("In-use heap: %d%% (%lu KiB pointers + %lu KiB other)\n",
                      GC_compute_heap_usage_percent(),
                      TO_KiB_UL(GC_composite_in_use),
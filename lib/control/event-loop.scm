@@ -0,0 +1,136 @@
+;;;
+;;; control.event-loop - single-threaded tasks waiting on I/O
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+;; Tasks are thunks run under a reset.  When a task has to wait for
+;; a port, it captures the rest of itself by shift, registers it to
+;; the selector, and returns to the loop; the selector puts it back
+;; to the run queue once the port is ready.  Thus a task suspends
+;; only at the waiting procedures below (wait-readable etc.), not
+;; inside the port operations; it should make sure the port is ready
+;; before reading or writing.
+
+(define-module control.event-loop
+  (use data.queue)
+  (use gauche.partcont)
+  (use gauche.selector)
+  (use gauche.uvector)
+  (export <event-loop> make-event-loop current-event-loop
+          event-loop-spawn! event-loop-run! event-loop-yield!
+          wait-readable wait-writable
+          async-read-uvector async-write-uvector))
+(select-module control.event-loop)
+
+(define-class <event-loop> ()
+  ((selector :init-form (make <selector>))
+   (runq     :init-form (make-queue)) ; thunks ready to run
+   (nwaiting :init-value 0)           ; # of tasks waiting on ports
+   ))
+
+(define (make-event-loop) (make <event-loop>))
+
+;; The loop that is running the current task, or #f outside of tasks.
+(define current-event-loop (make-parameter #f))
+
+(define (event-loop-spawn! loop thunk)
+  (check-arg procedure? thunk)
+  (enqueue! (slot-ref loop 'runq) thunk)
+  (undefined))
+
+;; Runs tasks until all of them finish.  The tasks queued when we look
+;; at the queue are run before we poll the ports again, so a task that
+;; keeps yielding won't starve the ones waiting on I/O.
+(define (event-loop-run! loop)
+  (let ([q (slot-ref loop 'runq)]
+        [sel (slot-ref loop 'selector)])
+    (parameterize ([current-event-loop loop])
+      (let lp ()
+        (dotimes [_ (queue-length q)]
+          (reset ((dequeue! q))))
+        (cond [(> (slot-ref loop 'nwaiting) 0)
+               (selector-select sel (if (queue-empty? q) #f 0))
+               (lp)]
+              [(not (queue-empty? q)) (lp)])))
+    (undefined)))
+
+(define (event-loop-yield!)
+  (and-let1 loop (current-event-loop)
+    (shift k (enqueue! (slot-ref loop 'runq) (^[] (k #t))))))
+
+;; Only one task can wait on the same port for the same direction
+;; at a time.
+(define (%wait port-or-fd flag)
+  (if-let1 loop (current-event-loop)
+    (shift k
+      (let1 sel (slot-ref loop 'selector)
+        (define (resume pf fl)
+          (selector-delete! sel port-or-fd resume (list flag))
+          (dec! (slot-ref loop 'nwaiting))
+          (enqueue! (slot-ref loop 'runq) (^[] (k #t))))
+        (inc! (slot-ref loop 'nwaiting))
+        (selector-add! sel port-or-fd resume (list flag))))
+    ;; Outside of tasks we just block.
+    (let1 fds (sys-fdset port-or-fd)
+      (if (eq? flag 'r)
+        (sys-select! fds #f #f)
+        (sys-select! #f fds #f))
+      (undefined))))
+
+;; A port may have data in its buffer that the selector can't see.
+(define (wait-readable port-or-fd)
+  (unless (and (input-port? port-or-fd) (byte-ready? port-or-fd))
+    (%wait port-or-fd 'r)))
+
+(define (wait-writable port-or-fd)
+  (%wait port-or-fd 'w))
+
+;; Reads what's available, up to SIZE elements, once PORT gets ready.
+;; PORT shouldn't be fully buffered; otherwise read-uvector keeps
+;; reading until it gets SIZE elements.
+(define (async-read-uvector class size :optional (port (current-input-port)))
+  (wait-readable port)
+  (read-uvector class size port))
+
+;; Writes UV in small chunks, waiting for PORT before each, so that
+;; a slow peer doesn't block other tasks.
+(define (async-write-uvector uv :optional (port (current-output-port)))
+  (let* ([len (uvector-length uv)]
+         [eltsize (if (zero? len) 1 (quotient (uvector-size uv) len))]
+         [chunk (max 1 (quotient 4096 eltsize))])
+    (let lp ([start 0])
+      (when (< start len)
+        (let1 end (min len (+ start chunk))
+          (wait-writable port)
+          (write-uvector uv port start end)
+          (flush port)
+          (lp end))))))
@@ -0,0 +1,385 @@
+;;;
+;;; control.fiber - lightweight threads over a few OS threads
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+
+;; A fiber is a thunk run under a reset by a processor, an OS thread
+;; that multiplexes the fibers pinned to it.  Like control.event-loop,
+;; a fiber suspends itself with shift at the waiting procedures below;
+;; the captured continuation is handed to whoever will wake it up
+;; (the selector, a timer, a fiber mutex or a finishing fiber), which
+;; puts it back to the run queue of the fiber's processor.
+;;
+;; A continuation can only be resumed in the thread that captured it,
+;; so a fiber stays on one processor for its lifetime.  Fibers spawned
+;; from outside are distributed round-robin; ones spawned by a fiber
+;; go to the same processor.
+;;
+;; Other threads may put entries to a processor's run queue, so it is
+;; guarded by the processor's lock.  A processor blocked in select is
+;; woken up through its pipe; the 'sleeping' flag keeps us from writing
+;; more than one byte per wait.  Lock order is scheduler, then processor.
+
+(define-module control.fiber
+  (use data.heap)
+  (use data.queue)
+  (use gauche.partcont)
+  (use gauche.selector)
+  (use gauche.threads)
+  (use gauche.uvector)
+  (export <fiber-scheduler> make-fiber-scheduler fiber-scheduler-shutdown!
+          current-fiber-scheduler
+          <fiber> fiber? current-fiber fiber-name fiber-done?
+          fiber-spawn! fiber-join! fiber-yield! fiber-sleep!
+          fiber-wait-readable fiber-wait-writable
+          fiber-read-uvector fiber-write-uvector
+          <fiber-mutex> make-fiber-mutex fiber-mutex?
+          fiber-mutex-lock! fiber-mutex-unlock! with-fiber-mutex))
+(select-module control.fiber)
+
+(define-class <fiber-scheduler> ()
+  ((processors :init-value '#())
+   (lock       :init-form (make-mutex))
+   (next       :init-value 0)         ; round-robin index; guarded by lock
+   (shutdown   :init-value #f)        ; guarded by lock
+   ))
+
+(define-class <fiber-processor> ()
+  ((scheduler :init-keyword :scheduler)
+   (thread    :init-value #f)
+   (lock      :init-form (make-mutex))
+   (runq      :init-form (make-queue)) ; (fiber . thunk); guarded by lock
+   (nfibers   :init-value 0)           ; # of live fibers; guarded by lock
+   (sleeping  :init-value #f)          ; blocked in select; guarded by lock
+   (stopping  :init-value #f)          ; guarded by lock
+   (current   :init-value #f)          ; the running fiber
+   (selector  :init-form (make <selector>))
+   (timers    :init-form (make-binary-heap :key car)) ; (time . wake)
+   (wake-in   :init-keyword :wake-in)
+   (wake-out  :init-keyword :wake-out)
+   ))
+
+(define-class <fiber> ()
+  ((name      :init-keyword :name)
+   (thunk     :init-keyword :thunk)
+   (processor :init-keyword :processor)
+   (lock      :init-form (make-mutex))
+   (done      :init-value #f)         ; following slots are guarded by lock
+   (result    :init-value '())        ; list of values
+   (exception :init-value #f)
+   (waiters   :init-value '())        ; wake procedures of joiners
+   ))
+
+(define-method write-object ((f <fiber>) port)
+  (format port "#<fiber ~s~a>" (~ f'name) (if (~ f'done) " done" "")))
+
+(define (fiber? obj) (is-a? obj <fiber>))
+(define (fiber-name f) (~ f'name))
+(define (fiber-done? f) (~ f'done))
+
+;;;
+;;; Scheduler
+;;;
+
+(define (make-fiber-scheduler :optional (num-threads 1))
+  (unless (and (exact-integer? num-threads) (positive? num-threads))
+    (error "num-threads must be a positive exact integer, but got:"
+           num-threads))
+  (rlet1 sched (make <fiber-scheduler>)
+    (let1 ps (list->vector
+              (list-tabulate num-threads (^_ (%make-processor sched))))
+      (set! (~ sched'processors) ps)
+      (vector-for-each (^p (thread-start! (~ p'thread))) ps))))
+
+(define (%make-processor sched)
+  (receive (in out) (sys-pipe :buffering :none)
+    (rlet1 p (make <fiber-processor>
+               :scheduler sched :wake-in in :wake-out out)
+      (set! (~ p'thread) (make-thread (^[] (%run p)) 'fiber-processor))
+      (selector-add! (~ p'selector) in
+                     (^[_ _] (let lp ()
+                               (when (byte-ready? in) (read-byte in) (lp))))
+                     '(r)))))
+
+;; Running fibers keep running after shutdown, and can spawn more fibers;
+;; each processor exits once all of its fibers finish.
+(define (fiber-scheduler-shutdown! sched)
+  (when (eq? (current-fiber-scheduler) sched)
+    (error "can't shut down the fiber scheduler from its own fiber:" sched))
+  (with-locking-mutex (~ sched'lock)
+    (^[]
+      (set! (~ sched'shutdown) #t)
+      (vector-for-each
+       (^p (with-locking-mutex (~ p'lock)
+             (^[] (set! (~ p'stopping) #t) (%wake-processor p))))
+       (~ sched'processors))))
+  (vector-for-each (^p (thread-join! (~ p'thread))) (~ sched'processors))
+  (undefined))
+
+;; The processor that runs the current thread, or #f.  Threads inherit
+;; parameters, so we need to check the thread as well.
+(define %processor (make-parameter #f))
+(define (%current-processor)
+  (and-let1 p (%processor)
+    (and (eq? (~ p'thread) (current-thread)) p)))
+
+(define (current-fiber)
+  (and-let1 p (%current-processor) (~ p'current)))
+(define (current-fiber-scheduler)
+  (and-let1 p (%current-processor) (~ p'scheduler)))
+
+;; Must be called with the processor's lock held.
+(define (%wake-processor p)
+  (when (~ p'sleeping)
+    (set! (~ p'sleeping) #f)
+    (write-byte 0 (~ p'wake-out))))
+
+(define (%schedule! f thunk)
+  (let1 p (~ f'processor)
+    (with-locking-mutex (~ p'lock)
+      (^[]
+        (enqueue! (~ p'runq) (cons f thunk))
+        (%wake-processor p)))))
+
+(define (%now) (time->seconds (current-time)))
+
+(define (%run p)
+  (define runq (~ p'runq))
+  (define timers (~ p'timers))
+  (define (fire-timers!)
+    (let1 now (%now)
+      (let lp ()
+        (when (and (not (binary-heap-empty? timers))
+                   (<= (car (binary-heap-find-min timers)) now))
+          ((cdr (binary-heap-pop-min! timers)))
+          (lp)))))
+  (define (timeout)
+    (if (binary-heap-empty? timers)
+      #f
+      (max 0 (exact (ceiling (* (- (car (binary-heap-find-min timers))
+                                   (%now))
+                                1e6))))))
+  (parameterize ([%processor p])
+    (let loop ()
+      (dolist [e (with-locking-mutex (~ p'lock) (^[] (dequeue-all! runq)))]
+        (%step p (car e) (cdr e)))
+      (fire-timers!)
+      ;; Returns the select timeout, or 'exit.
+      (let1 t (with-locking-mutex (~ p'lock)
+                (^[]
+                  (cond [(not (queue-empty? runq)) 0]
+                        [(and (~ p'stopping) (zero? (~ p'nfibers))) 'exit]
+                        [else (set! (~ p'sleeping) #t) (timeout)])))
+        (unless (eq? t 'exit)
+          (selector-select (~ p'selector) t)
+          (with-locking-mutex (~ p'lock) (^[] (set! (~ p'sleeping) #f)))
+          (loop)))))
+  (close-port (~ p'wake-in))
+  (close-port (~ p'wake-out)))
+
+;; Runs a fiber until it finishes or suspends.  An error escaping from
+;; the fiber finishes it.
+(define (%step p f thunk)
+  (set! (~ p'current) f)
+  (guard (e [else (%finish! f '() e)])
+    (reset (thunk)))
+  (set! (~ p'current) #f))
+
+(define (%finish! f result exception)
+  (let1 waiters (with-locking-mutex (~ f'lock)
+                  (^[]
+                    (set! (~ f'done) #t)
+                    (set! (~ f'result) result)
+                    (set! (~ f'exception) exception)
+                    (begin0 (reverse (~ f'waiters))
+                      (set! (~ f'waiters) '()))))
+    (for-each (^w (w)) waiters))
+  (let1 p (~ f'processor)
+    (with-locking-mutex (~ p'lock) (^[] (dec! (~ p'nfibers))))))
+
+;; Suspends the current fiber, or blocks the current thread outside of
+;; fibers, until the procedure passed to REGISTER is called.
+;; REGISTER is called in the current thread; the wake procedure can be
+;; called from any thread, just once.
+(define (%park register)
+  (if-let1 f (current-fiber)
+    (shift k (register (^[] (%schedule! f (^[] (k #t))))))
+    (let1 q (make-mtqueue)
+      (register (^[] (enqueue! q #t)))
+      (dequeue/wait! q)))
+  (undefined))
+
+;;;
+;;; Fibers
+;;;
+
+(define (fiber-spawn! sched thunk :key (name #f))
+  (define (add! p)
+    (let1 f (make <fiber> :name name :thunk thunk :processor p)
+      (with-locking-mutex (~ p'lock) (^[] (inc! (~ p'nfibers))))
+      (%schedule! f (^[] (receive r (thunk) (%finish! f r #f))))
+      f))
+  (check-arg procedure? thunk)
+  (if (eq? (current-fiber-scheduler) sched)
+    (add! (%current-processor))
+    (with-locking-mutex (~ sched'lock)
+      (^[]
+        (when (~ sched'shutdown)
+          (error "fiber scheduler is already shut down:" sched))
+        (let* ([ps (~ sched'processors)]
+               [i (~ sched'next)])
+          (set! (~ sched'next) (modulo (+ i 1) (vector-length ps)))
+          (add! (vector-ref ps i)))))))
+
+;; Returns the values of the fiber's thunk, or reraises the condition
+;; it raised.
+(define (fiber-join! f)
+  (when (eq? f (current-fiber))
+    (error "a fiber can't join itself:" f))
+  (unless (~ f'done)
+    (%park (^[wake]
+             (when (with-locking-mutex (~ f'lock)
+                     (^[] (or (~ f'done)
+                              (begin (push! (~ f'waiters) wake) #f))))
+               (wake)))))
+  (if-let1 e (~ f'exception)
+    (raise e)
+    (apply values (~ f'result))))
+
+(define (fiber-yield!)
+  (when (current-fiber)
+    (%park (^[wake] (wake)))))
+
+(define (fiber-sleep! seconds)
+  (if-let1 p (%current-processor)
+    (%park (^[wake]
+             (binary-heap-push! (~ p'timers) (cons (+ (%now) seconds) wake))))
+    (thread-sleep! seconds)))
+
+;; Only one fiber can wait on the same port for the same direction
+;; at a time.
+(define (%wait port-or-fd flag)
+  (if-let1 p (%current-processor)
+    (let1 sel (~ p'selector)
+      (%park (^[wake]
+               (define (handler pf fl)
+                 (selector-delete! sel port-or-fd handler (list flag))
+                 (wake))
+               (selector-add! sel port-or-fd handler (list flag)))))
+    (let1 fds (sys-fdset port-or-fd)
+      (if (eq? flag 'r)
+        (sys-select! fds #f #f)
+        (sys-select! #f fds #f))
+      (undefined))))
+
+(define (fiber-wait-readable port-or-fd)
+  (unless (and (input-port? port-or-fd) (byte-ready? port-or-fd))
+    (%wait port-or-fd 'r)))
+
+(define (fiber-wait-writable port-or-fd)
+  (%wait port-or-fd 'w))
+
+;; Same as async-read-uvector and async-write-uvector in control.event-loop.
+(define (fiber-read-uvector class size :optional (port (current-input-port)))
+  (fiber-wait-readable port)
+  (read-uvector class size port))
+
+(define (fiber-write-uvector uv :optional (port (current-output-port)))
+  (let* ([len (uvector-length uv)]
+         [eltsize (if (zero? len) 1 (quotient (uvector-size uv) len))]
+         [chunk (max 1 (quotient 4096 eltsize))])
+    (let lp ([start 0])
+      (when (< start len)
+        (let1 end (min len (+ start chunk))
+          (fiber-wait-writable port)
+          (write-uvector uv port start end)
+          (flush port)
+          (lp end))))))
+
+;;;
+;;; Fiber mutex
+;;;
+
+;; A mutex that suspends the fiber, instead of the whole processor,
+;; while waiting.  It can be used from ordinary threads as well; the
+;; owner is the current fiber or, outside of fibers, the current thread.
+(define-class <fiber-mutex> ()
+  ((name    :init-keyword :name)
+   (lock    :init-form (make-mutex))
+   (owner   :init-value #f)           ; guarded by lock
+   (waiters :init-form (make-queue))  ; (owner . wake); guarded by lock
+   ))
+
+(define (make-fiber-mutex :optional (name #f)) (make <fiber-mutex> :name name))
+(define (fiber-mutex? obj) (is-a? obj <fiber-mutex>))
+
+(define (%self) (or (current-fiber) (current-thread)))
+
+(define (fiber-mutex-lock! m)
+  (let1 self (%self)
+    (case (with-locking-mutex (~ m'lock)
+            (^[] (cond [(eq? (~ m'owner) self) 'recursive]
+                       [(~ m'owner) 'wait]
+                       [else (set! (~ m'owner) self) 'locked])))
+      [(recursive) (error "fiber mutex is already locked by the caller:" m)]
+      [(wait)
+       (%park (^[wake]
+                (when (with-locking-mutex (~ m'lock)
+                        (^[] (if (~ m'owner)
+                               (begin (enqueue! (~ m'waiters) (cons self wake))
+                                      #f)
+                               (begin (set! (~ m'owner) self) #t))))
+                  (wake))))])
+    (undefined)))
+
+;; Ownership is handed to the first waiter directly, so a fiber that
+;; unlocks and locks again right away can't starve the waiters.
+(define (fiber-mutex-unlock! m)
+  (let* ([self (%self)]
+         [wake (with-locking-mutex (~ m'lock)
+                 (^[]
+                   (cond [(not (eq? (~ m'owner) self)) 'not-owner]
+                         [(queue-empty? (~ m'waiters))
+                          (set! (~ m'owner) #f) #f]
+                         [else
+                          (let1 w (dequeue! (~ m'waiters))
+                            (set! (~ m'owner) (car w))
+                            (cdr w))])))])
+    (cond [(eq? wake 'not-owner)
+           (error "fiber mutex isn't locked by the caller:" m)]
+          [wake (wake)])
+    (undefined)))
+
+(define (with-fiber-mutex m thunk)
+  (fiber-mutex-lock! m)
+  (unwind-protect (thunk) (fiber-mutex-unlock! m)))
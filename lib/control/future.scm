@@ -0,0 +1,92 @@
+;;;
+;;; control.future - futures on a thread pool
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+
+;; A future is a job forked to a work-stealing thread pool.  Touching
+;; a future from a job in the same pool runs other jobs while waiting
+;; (see thread-pool-join!), so futures can be nested without using up
+;; the workers.
+
+(define-module control.future
+  (use control.job)
+  (use control.thread-pool)
+  (use gauche.threads)
+  (export <future> future make-future future? future-done? touch
+          current-future-pool default-future-pool))
+(select-module control.future)
+
+(define-class <future> ()
+  ((pool :init-keyword :pool)
+   (job  :init-keyword :job)))
+
+(define (future? obj) (is-a? obj <future>))
+
+;; The pool used by futures unless specified.  #f means the default pool.
+(define current-future-pool (make-parameter #f))
+
+;; Created on demand, with one worker per processor.
+(define %default-pool #f)
+(define %default-pool-lock (make-mutex))
+
+(define (default-future-pool)
+  (or %default-pool
+      (with-locking-mutex %default-pool-lock
+        (^[]
+          (unless %default-pool
+            (set! %default-pool
+                  (make-thread-pool (max 1 (sys-available-processors))
+                                    :work-stealing #t)))
+          %default-pool))))
+
+;; Futures created in a future go to the same pool.
+(define (make-future thunk :optional (pool #f))
+  (let1 pool (or pool (current-future-pool) (default-future-pool))
+    (make <future> :pool pool
+          :job (thread-pool-fork! pool
+                                  (^[] (parameterize ([current-future-pool pool])
+                                         (thunk)))))))
+
+(define-syntax future
+  (syntax-rules ()
+    [(_ expr ...) (make-future (^[] expr ...))]))
+
+(define (future-done? f)
+  (boolean (memq (job-status (~ f'job)) '(done error killed))))
+
+;; Returns the value of the future, waiting for it if necessary.
+;; A condition raised in the future is reraised.
+(define (touch f)
+  (if (future? f)
+    (thread-pool-join! (~ f'pool) (~ f'job))
+    f))
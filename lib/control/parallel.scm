@@ -0,0 +1,269 @@
+;;;
+;;; control.parallel - parallel map and fold
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+
+
+;; The input is split into contiguous chunks, and each chunk is run as
+;; a future.  By default we make about four chunks per worker, so that
+;; the work is balanced even if elements take different time, but never
+;; make chunks smaller than MIN-CHUNK.  An input that fits in one chunk
+;; is processed sequentially in the calling thread.
+
+(define-module control.parallel
+  (use control.future)
+  (use control.thread-pool)
+  (use gauche.uvector)
+  (use file.util)
+  (export parallel-map parallel-for-each parallel-fold
+          parallel-sort parallel-sort!
+          parallel-directory-fold))
+(select-module control.parallel)
+
+(define-constant *chunks-per-worker* 4)
+(define-constant *default-min-chunk* 16)
+(define-constant *default-sort-min-chunk* 65536)
+
+;; Returns the length and the accessor of SEQ.  A list is copied to
+;; a vector, for we need random access.
+(define (%accessor seq)
+  (cond [(vector? seq) (values (vector-length seq) (cut vector-ref seq <>))]
+        [(uvector? seq) (values (uvector-length seq) (cut uvector-ref seq <>))]
+        [(list? seq) (let1 v (list->vector seq)
+                       (values (vector-length v) (cut vector-ref v <>)))]
+        [else (error "list, vector or uvector required, but got:" seq)]))
+
+;; Calls (PROC START END) on each chunk of [0, LEN) in parallel, and
+;; returns the list of the results in order.
+(define (%run-chunks proc len pool chunk-size min-chunk)
+  (let* ([pool (or pool (current-future-pool) (default-future-pool))]
+         [nchunks (* *chunks-per-worker* (~ pool'size))]
+         [size (or chunk-size
+                   (max min-chunk (quotient (+ len nchunks -1) nchunks)))])
+    (if (<= len size)
+      (list (proc 0 len))
+      (map touch
+           (let loop ([start 0] [r '()])
+             (if (>= start len)
+               (reverse! r)
+               (let1 end (min len (+ start size))
+                 (loop end (cons (make-future (^[] (proc start end)) pool)
+                                 r)))))))))
+
+(define (%check-chunk-size chunk-size)
+  (unless (or (not chunk-size)
+              (and (exact-integer? chunk-size) (positive? chunk-size)))
+    (error "chunk-size must be a positive exact integer or #f, but got:"
+           chunk-size)))
+
+;; Returns a list if SEQ is a list, or a vector otherwise.
+(define (parallel-map proc seq :key (pool #f) (chunk-size #f)
+                                    (min-chunk *default-min-chunk*))
+  (%check-chunk-size chunk-size)
+  (receive (len ref) (%accessor seq)
+    (let1 result (make-vector len)
+      (%run-chunks (^[start end]
+                     (do ([i start (+ i 1)])
+                         [(= i end)]
+                       (vector-set! result i (proc (ref i)))))
+                   len pool chunk-size min-chunk)
+      (if (list? seq) (vector->list result) result))))
+
+(define (parallel-for-each proc seq :key (pool #f) (chunk-size #f)
+                                         (min-chunk *default-min-chunk*))
+  (%check-chunk-size chunk-size)
+  (receive (len ref) (%accessor seq)
+    (%run-chunks (^[start end]
+                   (do ([i start (+ i 1)])
+                       [(= i end)]
+                     (proc (ref i))))
+                 len pool chunk-size min-chunk)
+    (undefined)))
+
+;; Each chunk is folded from KNIL by (KONS elt acc), then the partial
+;; results are merged from left to right by (COMBINE left right).
+;; KNIL must be an identity of COMBINE.
+(define (parallel-fold kons combine knil seq
+                       :key (pool #f) (chunk-size #f)
+                            (min-chunk *default-min-chunk*))
+  (%check-chunk-size chunk-size)
+  (receive (len ref) (%accessor seq)
+    (let1 partials (%run-chunks (^[start end]
+                                  (do ([i start (+ i 1)]
+                                       [acc knil (kons (ref i) acc)])
+                                      [(= i end) acc]))
+                                len pool chunk-size min-chunk)
+      (fold-left combine (car partials) (cdr partials)))))
+
+;;;
+;;; Parallel sort
+;;;
+
+;; Merge sort.  Chunks of [0, LEN) are sorted in parallel by
+;; (SORT-RANGE! SEQ START END), then adjacent runs are merged pairwise by
+;; (MERGE! DST SRC START MID END), a round at a time, going back and
+;; forth between SEQ and the scratch sequence TMP.  COPY! has the
+;; signature of vector-copy!.  Unlike %run-chunks, we make one chunk
+;; per worker; merging costs more with more runs.
+(define (%parallel-merge-sort! seq tmp len sort-range! merge! copy!
+                               pool chunk-size min-chunk)
+  (define nworkers (~ pool'size))
+  (define size (or chunk-size
+                   (max min-chunk (quotient (+ len nworkers -1) nworkers))))
+  (define (run thunks)
+    (for-each touch (map (cut make-future <> pool) thunks)))
+  ;; Merges runs delimited by BOUNDS from SRC to DST.  Returns the
+  ;; bounds of the merged runs.
+  (define (merge-round bounds src dst)
+    (let loop ([b bounds] [thunks '()] [r '()])
+      (cond [(null? (cdr b))
+             (run thunks)
+             (reverse! (cons (car b) r))]
+            [(null? (cddr b))           ;the last run has no partner
+             (let ([s (car b)] [e (cadr b)])
+               (loop (cdr b) (cons (^[] (copy! dst s src s e)) thunks)
+                     (cons s r)))]
+            [else
+             (let ([s (car b)] [m (cadr b)] [e (caddr b)])
+               (loop (cddr b) (cons (^[] (merge! dst src s m e)) thunks)
+                     (cons s r)))])))
+
+  (if (<= len size)
+    (sort-range! seq 0 len)
+    (let1 bounds (append (iota (quotient (+ len size -1) size) 0 size)
+                         (list len))
+      (run (map (^[s e] (^[] (sort-range! seq s e))) bounds (cdr bounds)))
+      (let loop ([bounds bounds] [src seq] [dst tmp])
+        (if (null? (cddr bounds))
+          (unless (eq? src seq) (copy! seq 0 src 0 len))
+          (loop (merge-round bounds src dst) dst src))))))
+
+(define (%vector-merger less?)
+  (^[dst src start mid end]
+    (let loop ([i start] [j mid] [k start])
+      (cond [(= i mid) (vector-copy! dst k src j end)]
+            [(= j end) (vector-copy! dst k src i mid)]
+            [(less? (vector-ref src j) (vector-ref src i))
+             (vector-set! dst k (vector-ref src j))
+             (loop i (+ j 1) (+ k 1))]
+            [else
+             (vector-set! dst k (vector-ref src i))
+             (loop (+ i 1) j (+ k 1))]))))
+
+(define (%parallel-sort-vector! vec cmp pool chunk-size min-chunk)
+  (define less?
+    (cond [(not cmp) (^[a b] (< (compare a b) 0))]
+          [(comparator? cmp) (^[a b] (<? cmp a b))]
+          [else cmp]))
+  (define (sort-range! v start end)
+    (let1 c (vector-copy v start end)
+      (stable-sort! c (or cmp default-comparator))
+      (vector-copy! v start c)))
+  (let1 len (vector-length vec)
+    (%parallel-merge-sort! vec (make-vector len) len
+                           sort-range! (%vector-merger less?) vector-copy!
+                           pool chunk-size min-chunk)))
+
+;; Sorts a vector or a uvector in place.  Uvectors in the default order
+;; are radix-sorted by chunks and merged in C.
+(define (parallel-sort! seq :optional (cmp #f)
+                        :key (pool #f) (chunk-size #f)
+                             (min-chunk *default-sort-min-chunk*))
+  (%check-chunk-size chunk-size)
+  (let1 pool (or pool (current-future-pool) (default-future-pool))
+    (cond [(vector? seq)
+           (%parallel-sort-vector! seq cmp pool chunk-size min-chunk)]
+          [(and (uvector? seq) (or (not cmp) (eq? cmp default-comparator)))
+           (let1 len (uvector-length seq)
+             (%parallel-merge-sort! seq (make-uvector (class-of seq) len) len
+                                    uvector-sort! %uvector-merge! uvector-copy!
+                                    pool chunk-size min-chunk))]
+          [(uvector? seq)
+           (let* ([len (uvector-length seq)]
+                  [vec (vector-tabulate (cut uvector-ref seq <>) len)])
+             (%parallel-sort-vector! vec cmp pool chunk-size min-chunk)
+             (dotimes [i len] (uvector-set! seq i (vector-ref vec i))))]
+          [else (error "vector or uvector required, but got:" seq)])
+    seq))
+
+;; Returns a sorted copy of SEQ, which can also be a list.
+(define (parallel-sort seq :optional (cmp #f) :rest opts)
+  (cond [(list? seq)
+         (vector->list (apply parallel-sort! (list->vector seq) cmp opts))]
+        [(vector? seq) (apply parallel-sort! (vector-copy seq) cmp opts)]
+        [(uvector? seq) (apply parallel-sort! (uvector-copy seq) cmp opts)]
+        [else (error "list, vector or uvector required, but got:" seq)]))
+
+;;;
+;;; Parallel directory walk
+;;;
+
+;; Each subdirectory is walked as a future.  Runs of files between
+;; subdirectories are folded from KNIL by (PROC path acc), and the
+;; partial results are merged by (COMBINE left right) in name order, so
+;; for an associative COMBINE with the identity KNIL the result is the
+;; same as directory-fold.  A directory is closed before its
+;; subdirectories are walked, so the number of open descriptors is
+;; bounded by the number of workers, not by the depth of the tree.
+(define (parallel-directory-fold dir proc combine knil
+                                 :key (pool #f) (follow-link? #t))
+  (define (stat-dir? path follow?)
+    (and-let* ([s (guard (e [(<system-error> e) #f])
+                    ((if follow? sys-stat sys-lstat) path))])
+      (eq? (~ s'type) 'directory)))
+  (define (dir? path type)
+    (case type
+      [(directory) #t]
+      [(symlink) (and follow-link? (stat-dir? path #t))]
+      [(#f) (stat-dir? path follow-link?)]
+      [else #f]))
+  (define (entries path)
+    (let1 g (directory-entry-generator path :with-type? #t)
+      (let loop ([r '()])
+        (let1 e (g)
+          (if (eof-object? e)
+            (sort! r string<? car)
+            (loop (cons e r)))))))
+  ;; PARTS is a reversed list of partial results and futures.
+  (define (walk path)
+    (let loop ([es (entries path)] [acc knil] [parts '()])
+      (if (null? es)
+        (let1 parts (map touch (reverse! (cons acc parts)))
+          (fold-left combine (car parts) (cdr parts)))
+        (let1 p (build-path path (caar es))
+          (if (dir? p (cdar es))
+            (loop (cdr es) knil
+                  (list* (make-future (^[] (walk p)) pool) acc parts))
+            (loop (cdr es) (proc p acc) parts))))))
+  (if (stat-dir? dir follow-link?)
+    (walk dir)
+    (proc dir knil)))
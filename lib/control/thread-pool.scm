@@ -47,7 +47,8 @@
   (export <thread-pool>
           <thread-pool-shut-down>
           make-thread-pool thread-pool-results thread-pool-shut-down?
-          add-job! wait-all terminate-all!))
+          add-job! wait-all terminate-all!
+          thread-pool-fork! thread-pool-join!))
 (select-module control.thread-pool)
 
 ;; - Thread job is queued in job queue.
@@ -55,6 +56,9 @@
 ;; - optionally, the client can ask to queue the finished job to result-queue.
 ;; - while exeuting the job, thread keeps job record in its 'specific' slot.
 ;; - graceful termination is requested by 'over in the job queue.
+;; - a work-stealing pool uses <work-stealing-queue> instead of job-queue.
+;;   Each worker has its own deque, and jobs added or forked by a worker
+;;   go to it.  Graceful termination is requested by closing the queue.
 
 (define-class <thread-pool> ()
   ((result-queue :init-form (make-mtqueue)) ; Queue Job
@@ -65,19 +69,49 @@
    (max-backlog  :allocation :propagated
                  :propagate '(job-queue max-length)
                  :init-keyword :max-backlog)
+   (ws-queue     :init-value #f)       ; <work-stealing-queue> or #f
    (shut-down    :init-value #f)       ; #t if the pool is shut down
    )
   :metaclass <propagate-meta>)
 
-(define (make-thread-pool size :key (max-backlog #f))
-  (make <thread-pool> :size size :max-backlog max-backlog))
+(define (make-thread-pool size :key (max-backlog #f) (work-stealing #f)
+                          (pin-workers #f))
+  (when (and work-stealing max-backlog)
+    (error "max-backlog can't be used with a work-stealing thread pool"))
+  (make <thread-pool> :size size :max-backlog max-backlog
+        :work-stealing work-stealing :pin-workers pin-workers))
+
+;; Returns a list of SIZE cpu sets (or #f's) for the workers.
+;; PIN is #f (don't pin), #t (one CPU per worker, round robin over the
+;; CPUs the current thread may run on), or a list of CPU sets, each
+;; of which is a CPU number or a list of them, used round robin.
+(define (%worker-affinities pin size)
+  (define (cycle sets)
+    (list-tabulate size (^i (list-ref sets (modulo i (length sets))))))
+  (cond [(not pin) (make-list size #f)]
+        [(eq? pin #t)
+         (let1 cpus (or (thread-affinity (current-thread))
+                        (iota (sys-available-processors)))
+           (cycle (map list cpus)))]
+        [(and (pair? pin) (list? pin))
+         (cycle (map (^s (if (integer? s) (list s) s)) pin))]
+        [else (error "pin-workers must be a boolean or a list of CPU sets, \
+                      but got:" pin)]))
 
 (define-method initialize ((pool <thread-pool>) initargs)
   (next-method)
+  (when (get-keyword :work-stealing initargs #f)
+    (set! (~ pool'ws-queue) (make-work-stealing-queue (~ pool'size))))
   (set! (~ pool'pool)
-        (list-tabulate (~ pool'size)
-                       (lambda (_)
-                         (thread-start! (make-thread (cut worker pool)))))))
+        (map (lambda (cpus)
+               (thread-start!
+                (make-thread (if (~ pool'ws-queue)
+                               (cut ws-worker pool)
+                               (cut worker pool))
+                             #f
+                             :affinity cpus)))
+             (%worker-affinities (get-keyword :pin-workers initargs #f)
+                                 (~ pool'size)))))
 
 (define (thread-pool-results pool)    (~ pool'result-queue))
 (define (thread-pool-shut-down? pool) (~ pool'shut-down))
@@ -89,25 +123,78 @@
   (error <thread-pool-shut-down> :pool pool "Thread pool has shut down"))
 
 (define (worker pool)
-  (define self (current-thread))
   (match (dequeue/wait! (~ pool'job-queue))
-    [(need-result . job)
-     (thread-specific-set! self job)
-     (job-run! job)                     ; captures errors
-     (when need-result (enqueue! (~ pool'result-queue) job))
-     (thread-specific-set! self #f)
-     (worker pool)]
+    [(? pair? entry) (run-job pool entry) (worker pool)]
     [_ #t]))                            ; no more jobs
 
+(define (ws-worker pool)
+  (define q (~ pool'ws-queue))
+  (work-stealing-queue-attach! q)
+  (let loop ()
+    (let1 entry (work-stealing-queue-take! q)
+      (unless (eof-object? entry)       ; closed and no more jobs
+        (run-job pool entry)
+        (loop)))))
+
+;; A job may be run while another job is waiting in thread-pool-join!,
+;; so we restore the thread-specific slot afterwards.
+(define (run-job pool entry)
+  (define self (current-thread))
+  (define outer (thread-specific self))
+  (match-let1 (need-result . job) entry
+    (thread-specific-set! self job)
+    (job-run! job)                      ; captures errors
+    (when need-result (enqueue! (~ pool'result-queue) job))
+    (thread-specific-set! self outer)))
+
 ;; Returns job if queued, #f if job queue is full
 (define (add-job! pool thunk :optional (need-result #f) (timeout #f))
   (when (~ pool'shut-down) (%shut-down pool))
   (let1 job (make-job thunk :cancellable #t)
     (job-acknowledge! job)
-    (and (enqueue/wait! (~ pool'job-queue) (cons need-result job) timeout #f)
-         (if (~ pool'shut-down)
-           (%shut-down pool)
-           job))))
+    (if-let1 q (~ pool'ws-queue)
+      (if (work-stealing-queue-push! q (cons need-result job))
+        job
+        (%shut-down pool))
+      (and (enqueue/wait! (~ pool'job-queue) (cons need-result job) timeout #f)
+           (if (~ pool'shut-down)
+             (%shut-down pool)
+             job)))))
+
+;; Fork/join on a work-stealing pool.  A job forked by a worker goes to
+;; the worker's own deque, and is likely to be run by the same worker
+;; unless an idle worker steals it.  A worker joining a job keeps running
+;; other jobs until the joined job finishes, so recursive computation
+;; doesn't run out of workers.  Forking from a job is allowed while
+;; the pool is shutting down, so that running jobs can complete.
+(define (thread-pool-fork! pool thunk)
+  (define q (~ pool'ws-queue))
+  (unless q (error "thread-pool-fork! requires a work-stealing pool:" pool))
+  (when (and (~ pool'shut-down) (not (work-stealing-queue-worker-index q)))
+    (%shut-down pool))
+  (let1 job (make-job thunk :waitable #t)
+    (job-acknowledge! job)
+    (unless (work-stealing-queue-push! q (cons #f job))
+      (%shut-down pool))
+    job))
+
+;; Returns the result of JOB.  If the job raised a condition, it is
+;; reraised.
+(define (thread-pool-join! pool job)
+  (define q (~ pool'ws-queue))
+  (define (finished?) (memq (job-status job) '(done error killed)))
+  (when (and q (work-stealing-queue-worker-index q))
+    (let loop ()
+      (unless (finished?)
+        (if-let1 entry (work-stealing-queue-try-take! q)
+          (run-job pool entry)
+          (job-wait job 0.001))       ; the job is run by another worker
+        (loop))))
+  (job-wait job)
+  (case (job-status job)
+    [(done) (job-result job)]
+    [(error) (raise (job-result job))]
+    [else (errorf "job ~s has been killed: ~a" job (job-result job))]))
 
 ;; Note: The signature has been changed from 0.9.1, in which wait-all
 ;; only takes check-interval optional argument.  It is impossible to detect
@@ -131,7 +218,9 @@
           [else (error "timeout must be either a real number, a <time> object, \
                         or #f, but got:" timeout)]))
   (let loop ([now (and abstime (current-time))])
-    (cond [(and (queue-empty? (~ pool'job-queue))
+    (cond [(and (if-let1 q (~ pool'ws-queue)
+                  (zero? (work-stealing-queue-length q))
+                  (queue-empty? (~ pool'job-queue)))
                 (every (^t (not (thread-specific t))) (~ pool'pool)))]
           [(and abstime (time>=? now abstime)) #f] ;timeout
           [else (sys-nanosleep check-interval)
@@ -154,13 +243,17 @@
 
   ;; If requested, cancel jobs already queued but not being executing.
   (when cancel-queued-jobs
-    (dolist [job (dequeue-all! (~ pool'job-queue))]
+    (dolist [job (if-let1 q (~ pool'ws-queue)
+                   (work-stealing-queue-drain! q)
+                   (dequeue-all! (~ pool'job-queue)))]
       (job-mark-killed! (cdr job) "thread pool has shut down")
       (enqueue! (~ pool'result-queue) (cdr job))))
 
   ;; Sends threads termination message
-  (dotimes [count size]
-    (enqueue/wait! (~ pool'job-queue) 'over))
+  (if-let1 q (~ pool'ws-queue)
+    (work-stealing-queue-close! q)
+    (dotimes [count size]
+      (enqueue/wait! (~ pool'job-queue) 'over)))
 
   ;; Wait for termination of threads.
   (dolist [t (~ pool'pool)]
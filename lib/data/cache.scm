@@ -81,6 +81,7 @@
   (use gauche.dictionary)
   (use data.queue)
   (use data.heap)
+  (use data.cache-core)
   (use srfi-114)
   (export <cache>
           ;; Protocol
@@ -98,6 +99,8 @@
           make-ttl-cache
           make-ttlr-cache
           make-lru-cache
+          make-lfu-cache
+          make-tinylfu-cache
           make-counting-cache cache-stats))
 (select-module data.cache)
 
@@ -274,9 +277,16 @@
 ;;    we touch the entry on read operaion as well.
 (define-class <lru-cache> (<fifo-cache>) ())
 
-(define (make-lru-cache capacity :key (storage #f) (comparator #f))
-  (make <lru-cache> :storage storage :comparator comparator
-        :capacity capacity))
+(define (make-lru-cache capacity :key (storage #f) (comparator #f)
+                                      (native #f) (shards #f))
+  (cond [(or native shards)
+         (when storage
+           (error "native lru cache can't take storage:" storage))
+         (make <native-cache> :policy 'lru :comparator comparator
+               :capacity capacity :shards shards)]
+        [else
+         (make <lru-cache> :storage storage :comparator comparator
+               :capacity capacity)]))
 
 (define-method cache-check! ((cache <lru-cache>) key)
   (and-let* ([nv (dict-get (cache-storage cache) key #f)]
@@ -405,3 +415,101 @@
 
 (define-method cache-stats ((cache <counting-cache>))
   `(:hits ,(~ cache'hits) :misses ,(~ cache'misses)))
+
+;; Native caches
+;; - The storage is a <cache-core>, which keeps the entries and their
+;;   order of eviction in C, so that every operation is O(1) and
+;;   doesn't allocate except for a new entry.
+;; - The key must be compared with one of the builtin hash types.
+;; - If shards is given, the table is split into that many partitions
+;;   by the hash value of the key, each with its own lock and
+;;   capacity/shards entries.  Such a cache can be shared by threads.
+;;   Without shards, it must be used by one thread at a time, like
+;;   other caches.
+
+(define-class <native-cache> (<cache>)
+  ([capacity :init-keyword :capacity]
+   [policy   :init-keyword :policy]
+   [shards   :init-keyword :shards :init-value #f]))
+
+(define (%native-key-type cmpr)
+  (cond [(or (eq? cmpr default-comparator) (eq? cmpr equal-comparator))
+         'equal?]
+        [(eq? cmpr eq-comparator) 'eq?]
+        [(eq? cmpr eqv-comparator) 'eqv?]
+        [(eq? cmpr string-comparator) 'string=?]
+        [else (error "native cache requires one of default-comparator, \
+                      eq-comparator, eqv-comparator, equal-comparator or \
+                      string-comparator, but got:" cmpr)]))
+
+(define-method initialize ((c <native-cache>) initargs)
+  (let1 cmpr (or (get-keyword :comparator initargs #f) default-comparator)
+    (next-method c
+                 (list* :comparator cmpr
+                        :storage (make-cache-core
+                                  (get-keyword :policy initargs)
+                                  (get-keyword :capacity initargs)
+                                  :type (%native-key-type cmpr)
+                                  :shards (get-keyword :shards initargs #f))
+                        initargs))))
+
+(define (make-lfu-cache capacity :key (comparator #f) (shards #f))
+  (make <native-cache> :policy 'lfu :comparator comparator
+        :capacity capacity :shards shards))
+
+(define (make-tinylfu-cache capacity :key (comparator #f) (shards #f))
+  (make <native-cache> :policy 'tinylfu :comparator comparator
+        :capacity capacity :shards shards))
+
+(define-method cache-check! ((cache <native-cache>) key)
+  (cache-core-check (cache-storage cache) key))
+
+;; NB: TinyLFU may decline to keep the entry, but we return it anyway;
+;; it's just as if it were evicted immediately.
+(define-method cache-register! ((cache <native-cache>) key value)
+  (cache-core-put! (cache-storage cache) key value)
+  (cons key value))
+
+(define-method cache-write! ((cache <native-cache>) key value)
+  (cache-core-put! (cache-storage cache) key value)
+  (undefined))
+
+(define-method cache-evict! ((cache <native-cache>) key)
+  (cache-core-delete! (cache-storage cache) key)
+  (undefined))
+
+(define-method cache-clear! ((cache <native-cache>))
+  (cache-core-clear! (cache-storage cache)))
+
+(define-method cache-stats ((cache <native-cache>))
+  (apply (^[h m e r]
+           `(:hits ,h :misses ,m :evictions ,e :rejections ,r))
+         (cache-core-stats (cache-storage cache))))
+
+;; The storage can be examined as a dictionary.  Reading it doesn't
+;; change the order of eviction nor the statistics.
+(define (%core-get core key . default)
+  (let1 v (cache-core-peek core key %unique)
+    (cond [(not (eq? v %unique)) v]
+          [(pair? default) (car default)]
+          [else (errorf "cache storage ~s doesn't have an entry for key ~s"
+                        core key)])))
+
+(define (%core-exists? core key)
+  (not (eq? (cache-core-peek core key %unique) %unique)))
+
+(define (%core-fold core proc seed)
+  (fold (^[kv s] (proc (car kv) (cdr kv) s)) seed (cache-core->alist core)))
+
+(define %unique (list #f))
+
+(define-dict-interface <cache-core>
+  :get     %core-get
+  :put!    cache-core-put!
+  :delete! cache-core-delete!
+  :clear!  cache-core-clear!
+  :exists? %core-exists?
+  :fold    %core-fold
+  :->alist cache-core->alist)
+
+(define-method size-of ((core <cache-core>)) (cache-core-count core))
@@ -35,6 +35,7 @@
   (use gauche.sequence)
   (use gauche.uvector)
   (use srfi-1)
+  (use data.heap-core)
   (export <binary-heap>
           make-binary-heap build-binary-heap
           binary-heap-comparator binary-heap-key-procedure
@@ -46,6 +47,17 @@
           binary-heap-pop-min! binary-heap-pop-max!
           binary-heap-swap-min! binary-heap-swap-max!
           binary-heap-find binary-heap-remove! binary-heap-delete!
+
+          ;; indexed heap, from data.heap-core
+          <indexed-heap> <heap-handle>
+          make-indexed-heap build-indexed-heap indexed-heap?
+          indexed-heap-num-entries indexed-heap-empty?
+          indexed-heap-push! indexed-heap-push-all!
+          indexed-heap-find-min indexed-heap-pop-min!
+          indexed-heap-update-key! indexed-heap-decrease-key!
+          indexed-heap-delete! indexed-heap-clear!
+          heap-handle? heap-handle-key heap-handle-value
+          heap-handle-value-set! heap-handle-active?
           ))
 (select-module data.heap)
 
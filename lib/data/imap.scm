@@ -31,16 +31,13 @@
 ;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ;;;
 
-;; This implements functional red-black tree
-;; as described in Chris Okasaki's Purely Functional Data Structures.
+;; The tree is implemented in C (data.imap-core) as a weight-balanced
+;; tree with path copying.  <imap> wraps it as an immutable dictionary.
 
 (define-module data.imap
   (use gauche.sequence)
   (use gauche.dictionary)
-  (use gauche.record)
-  (use data.queue)
-  (use util.match)
-  (use srfi-114)
+  (use data.imap-core)
   (export <imap> <imap-meta>
           make-imap alist->imap tree-map->imap
           imap? imap-empty?
@@ -50,75 +47,6 @@
   )
 (select-module data.imap)
 
-;;
-;; Internal implementation
-;;
-
-(define-record-type (T (pseudo-rtd <vector>)) #t #t color left elem right)
-;; NB: We just use #f as E node.
-(define (E? x) (not x))
-
-(define balance
-  (match-lambda*
-    [(or ('B #('R #('R a x b) y c) z d)
-         ('B #('R a x #('R b y c)) z d)
-         ('B a x #('R #('R b y c) z d))
-         ('B a x #('R b y #('R c z d))))
-     (make-T 'R (make-T 'B a x b) y (make-T 'B c z d))]
-    [(color a x b)
-     (make-T color a x b)]))
-
-(define (get key tree cmpr)
-  (and (T? tree)
-       (match-let1 #(_ a p b) tree
-         (if3 (comparator-compare cmpr key (car p))
-              (get key a cmpr)
-              p
-              (get key b cmpr)))))
-
-(define (insert key val tree cmpr)
-  (define (ins tree)
-    (if (E? tree)
-      (make-T 'R #f (cons key val) #f)
-      (match-let1 #(color a p b) tree
-        (if3 (comparator-compare cmpr key (car p))
-             (balance color (ins a) p b)
-             (make-T color a (cons key val) b)
-             (balance color a p (ins b))))))
-  (match-let1 #(_ a p b) (ins tree)
-    (make-T 'B a p b)))
-
-(define (populate tree alist cmpr)
-  ((rec (f tree alist)
-     (if (null? alist)
-       tree
-       (f (insert (caar alist) (cdar alist) tree cmpr) (cdr alist))))
-   tree alist))
-
-(define (delete key tree cmpr)
-  (define (del-min tree)
-    (match tree
-      [#(color #f p #f) (values p #f)]
-      [#(color #f p b)  (values p b)]
-      [#(color a p b)   (receive (min-p a.) (del-min a)
-                          (values min-p (balance color a. p b)))]))
-  (define (del tree)
-    (if (E? tree)
-      tree
-      (match-let1 #(color a p b) tree
-        (if3 (comparator-compare cmpr key (car p))
-             (balance color (del a) p b)
-             (if a
-               (if b
-                 (receive (min-p b.) (del-min b)
-                   (balance color a min-p b.))
-                 a)
-               b)
-             (balance color a p (del b))))))
-  (match (del tree)
-    [#f  #f] ;empty
-    [#(_ a p b) (make-T 'B a p b)]))
-
 ;; aux fn
 (define (%key-proc->comparator key=? key<?)
   (make-comparator #t key=? key<? #f))
@@ -128,11 +56,15 @@
 ;;
 (define-class <imap-meta> (<class>) ())
 
+;; The tree slot keeps <imap-tree>, which has the same comparator.
 (define-class <imap> (<ordered-dictionary>)
   ((comparator :init-keyword :comparator)
-   (tree :init-keyword :tree :init-form #f))
+   (tree :init-keyword :tree))
   :metaclass <imap-meta>)
 
+(define (%make-imap tree)
+  (make <imap> :comparator (imap-tree-comparator tree) :tree tree))
+
 ;; API
 (define (imap? x) (is-a? x <imap>))
 
@@ -143,18 +75,19 @@
     [(cmpr)
      (unless (comparator? cmpr)
        (error "comparator required, but got:" cmpr))
-     (make <imap> :comparator cmpr)]
+     (%make-imap (make-imap-tree cmpr))]
     [(key=? key<?) (make-imap (%key-proc->comparator key=? key<?))])) 
 
 ;; API
+;; If ALIST is sorted by the keys (in either direction), the imap is
+;; built in linear time.
 (define alist->imap
   (case-lambda
     [(alist) (alist->imap alist default-comparator)]
     [(alist cmpr)
      (unless (comparator? cmpr)
        (error "comparator required, but got:" cmpr))
-     (make <imap>
-       :comparator cmpr :tree (populate #f alist cmpr))]
+     (%make-imap (alist->imap-tree cmpr alist))]
     [(alist key=? key<?)
      (alist->imap alist (%key-proc->comparator key=? key<?))]))
 
@@ -164,15 +97,15 @@
                         (tree-map-comparator tree-map)))
 
 ;; API
-(define (imap-empty? immap) (E? (~ immap'tree)))
+(define (imap-empty? immap) (zero? (imap-tree-size (~ immap'tree))))
 
 ;; API
 (define (imap-exists? immap key)
-  (boolean (get key (~ immap'tree) (~ immap'comparator))))
+  (boolean (imap-tree-lookup (~ immap'tree) key)))
 
 ;; API
 (define (imap-get immap key :optional default)
-  (if-let1 p (get key (~ immap'tree) (~ immap'comparator))
+  (if-let1 p (imap-tree-lookup (~ immap'tree) key)
     (cdr p)
     (if (undefined? default)
       (errorf "No such key in a imap ~s: ~s" immap key)
@@ -180,65 +113,26 @@
 
 ;; API
 (define (imap-put immap key val)
-  (make <imap>
-    :comparator (~ immap'comparator)
-    :tree (insert key val (~ immap'tree) (~ immap'comparator))))
+  (%make-imap (imap-tree-put (~ immap'tree) key val)))
 
 ;; API
 (define (imap-delete immap key)
-  (make <imap>
-    :comparator (~ immap'comparator)
-    :tree (delete key (~ immap'tree) (~ immap'comparator))))
+  (let* ([t (~ immap'tree)]
+         [t2 (imap-tree-delete t key)])
+    (if (eq? t t2) immap (%make-imap t2))))
 
 ;; API
-(define (imap-min immap)
-  (define (descend tree)
-    (match-let1 #(_ a p b) tree
-      (if (E? a) p (descend a))))
-  (let1 t (~ immap'tree)
-    (and (not (E? t)) (descend t))))
+(define (imap-min immap) (imap-tree-min (~ immap'tree)))
 
 ;; API
-(define (imap-max immap)
-  (define (descend tree)
-    (match-let1 #(_ a p b) tree
-      (if (E? b) p (descend b))))
-  (let1 t (~ immap'tree)
-    (and (not (E? t)) (descend t))))
-
-;; Fundamental iterators
-(define (%imap-fold immap proc seed)
-  (define (rec tree seed)
-    (if (E? tree)
-      seed
-      (match-let1 #(_ a p b) tree
-        (rec b (proc p (rec a seed))))))
-  (rec (~ immap'tree) seed))
-
-(define (%imap-fold-right immap proc seed)
-  (define (rec tree seed)
-    (if (E? tree)
-      seed
-      (match-let1 #(_ a p b) tree
-        (rec a (proc p (rec b seed))))))
-  (rec (~ immap'tree) seed))
+(define (imap-max immap) (imap-tree-max (~ immap'tree)))
 
 ;; Collection framework
 (define-method call-with-iterator ((coll <imap>) proc :allow-other-keys)
-  (if (imap-empty? coll)
-    (proc (^[] #t) (^[] #t))
-    (let1 q (make-queue)  ; only contains T
-      (enqueue! q (~ coll'tree))
-      (proc (^[] (queue-empty? q))
-            (rec (next)
-              (match-let1 #(c a p b) (dequeue! q)
-                (if (E? a)
-                  (if (E? b)
-                    p
-                    (begin (queue-push! q b) p))
-                  (begin (queue-push! q (make-T c #f p b))
-                         (queue-push! q a)
-                         (next)))))))))
+  (let* ([next (imap-tree-iterator (~ coll'tree))]
+         [p (next)])
+    (proc (^[] (eof-object? p))
+          (^[] (begin0 p (set! p (next)))))))
 
 (define-method call-with-builder ((class <imap-meta>) proc
                                   :key (comparator default-comparator)
@@ -253,6 +147,9 @@
 (define-method coerce-to ((c <imap-meta>) (src <tree-map>))
   (tree-map->imap src))
 
+(define-method size-of ((immap <imap>))
+  (imap-tree-size (~ immap'tree)))
+
 ;; Dictionary interface
 ;; As a dictionary, it behaves as immutable dictionary.
 (define-method dict-get ((immap <imap>) key :optional default)
@@ -265,7 +162,8 @@
   (~ immap'comparator))
 
 (define-method dict-fold ((immap <imap>) proc seed)
-  (%imap-fold immap (^[p s] (proc (car p) (cdr p) s)) seed))
+  (imap-tree-fold (~ immap'tree) (^[p s] (proc (car p) (cdr p) s)) seed))
 
 (define-method dict-fold-right ((immap <imap>) proc seed)
-  (%imap-fold-right immap (^[p s] (proc (car p) (cdr p) s)) seed))
+  (imap-tree-fold-right (~ immap'tree) (^[p s] (proc (car p) (cdr p) s))
+                        seed))
@@ -44,7 +44,13 @@
           ring-buffer-front ring-buffer-back
           ring-buffer-add-front! ring-buffer-add-back!
           ring-buffer-remove-front! ring-buffer-remove-back!
-          ring-buffer-ref ring-buffer-set!))
+          ring-buffer-ref ring-buffer-set!
+          ring-buffer-add-back-vector! ring-buffer-remove-front-into!
+
+          make-spsc-ring-buffer spsc-ring-buffer?
+          spsc-ring-buffer-capacity spsc-ring-buffer-num-entries
+          spsc-ring-buffer-push! spsc-ring-buffer-pop!
+          spsc-ring-buffer-write! spsc-ring-buffer-read!))
 (select-module data.ring-buffer)
 
 ;;
@@ -209,14 +215,42 @@
          (let1 s (ring-buffer-storage rb)
            (%rb-head-inc! rb (%dprocs s) s 1))
          (dec! (ring-buffer-num-entries rb))]
-        [else
-         (unless (or (vector? v) (uvector? v))
-           (error "Ring buffer overflow handler returned invalid object:" v))
-         (%rb-copy-contents! rb v (ring-buffer-storage rb))
-         (ring-buffer-head-set! rb 0)
-         (ring-buffer-tail-set! rb (ring-buffer-num-entries rb))
-         (ring-buffer-capacity-set! rb (size-of v))
-         (ring-buffer-storage-set! rb v)]))))
+        [else (%rb-replace-storage! rb v)]))))
+
+(define (%rb-replace-storage! rb v)
+  (unless (or (vector? v) (uvector? v))
+    (error "Ring buffer overflow handler returned invalid object:" v))
+  (%rb-copy-contents! rb v (ring-buffer-storage rb))
+  (ring-buffer-head-set! rb 0)
+  (ring-buffer-tail-set! rb (ring-buffer-num-entries rb))
+  (ring-buffer-capacity-set! rb (size-of v))
+  (ring-buffer-storage-set! rb v))
+
+;; Bulk version of %ensure-room!.  Makes room for N more elements,
+;; and returns the number of leading elements among the N that
+;; can't be stored at all; it is nonzero only when the buffer is in
+;; overwrite mode and N exceeds the capacity.
+(define (%ensure-room-for! rb n)
+  (let loop ()
+    (let ([c (ring-buffer-capacity rb)]
+          [k (ring-buffer-num-entries rb)])
+      (if (<= (+ k n) c)
+        0
+        (let1 v ((ring-buffer-overflow-handler rb) rb (ring-buffer-storage rb))
+          (case v
+            [(error) (error "Ring buffer overflow:" rb)]
+            [(overwrite)
+             (let1 drop (min k (- (+ k n) c))
+               (let1 s (ring-buffer-storage rb)
+                 (%rb-head-inc! rb (%dprocs s) s drop))
+               (ring-buffer-num-entries-set! rb (- k drop))
+               (max 0 (- n c)))]
+            [else
+             (unless (> (size-of v) c)
+               (error "Ring buffer overflow handler didn't extend the storage:"
+                      v))
+             (%rb-replace-storage! rb v)
+             (loop)]))))))
 
 ;; API
 (define (ring-buffer-front rb)
@@ -287,3 +321,153 @@
     (%rb-set! dprocs s (%rb-mod-index dprocs s (+ (ring-buffer-head rb) n))
               val)))
 
+;; Bulk transfer
+;;  These move a range of elements with at most two block copies
+;;  (vector-copy! or uvector-copy!, the latter being a memcpy), one for
+;;  each side of the wraparound point.  The source/destination vector
+;;  must be of the same type as the backing storage.
+
+;; API
+(define (ring-buffer-add-back-vector! rb src :optional (start 0)
+                                      (end (size-of src)))
+  (unless (<= 0 start end (size-of src))
+    (errorf "start/end out of range (~s, ~s) for ~s" start end src))
+  (let* ([skip (%ensure-room-for! rb (- end start))]
+         [start (+ start skip)]
+         [n (- end start)]
+         [s (ring-buffer-storage rb)]
+         [dprocs (%dprocs s)]
+         [c (ring-buffer-capacity rb)]
+         [t (ring-buffer-tail rb)]
+         [n1 (min n (- c t))])
+    (%rb-copy! dprocs s t src start (+ start n1))
+    (when (< n1 n)
+      (%rb-copy! dprocs s 0 src (+ start n1) end))
+    (%rb-tail-inc! rb dprocs s n)
+    (ring-buffer-num-entries-set! rb (+ (ring-buffer-num-entries rb) n))
+    (undefined)))
+
+;; API
+;;  Returns the number of elements removed.
+(define (ring-buffer-remove-front-into! rb dest :optional (start 0)
+                                        (end (size-of dest)))
+  (unless (<= 0 start end (size-of dest))
+    (errorf "start/end out of range (~s, ~s) for ~s" start end dest))
+  (let* ([n (min (- end start) (ring-buffer-num-entries rb))]
+         [s (ring-buffer-storage rb)]
+         [dprocs (%dprocs s)]
+         [c (ring-buffer-capacity rb)]
+         [h (ring-buffer-head rb)]
+         [n1 (min n (- c h))])
+    (%rb-copy! dprocs dest start s h (+ h n1))
+    (when (< n1 n)
+      (%rb-copy! dprocs dest (+ start n1) s 0 (- n n1)))
+    (%rb-head-inc! rb dprocs s n)
+    (ring-buffer-num-entries-set! rb (- (ring-buffer-num-entries rb) n))
+    n))
+
+;;
+;; Single-producer/single-consumer ring buffer
+;;
+;;  A fixed-capacity FIFO that one thread can add to while another
+;;  thread removes from, without locking.  The producer owns TAIL and
+;;  the consumer owns HEAD; each is kept in an atomic fxbox, so storing
+;;  the updated index publishes (release) the element copies preceding
+;;  it, and loading the other party's index (acquire) makes its copies
+;;  visible.  Indices run modulo 2*capacity so that a full buffer can be
+;;  told from an empty one without a shared counter.
+;;
+
+(define-record-type spsc-ring-buffer %make-spsc-ring-buffer spsc-ring-buffer?
+  (storage)
+  (dprocs)
+  (capacity)
+  (head)                                ;atomic-fxbox, written by consumer
+  (tail))                               ;atomic-fxbox, written by producer
+
+;; API
+(define (make-spsc-ring-buffer storage)
+  (unless (or (vector? storage) (uvector? storage))
+    (error "Ring buffer storage must be a vector-like object, but got:" storage))
+  (when (zero? (size-of storage))
+    (error "Ring buffer storage must not be empty:" storage))
+  (%make-spsc-ring-buffer storage (%dprocs storage) (size-of storage)
+                          (make-atomic-fxbox 0) (make-atomic-fxbox 0)))
+
+(define-inline (%spsc-count c h t)
+  (let1 d (- t h) (if (< d 0) (+ d c c) d)))
+(define-inline (%spsc-index c i)
+  (if (>= i c) (- i c) i))
+(define-inline (%spsc-advance c i n)
+  (let1 j (+ i n) (if (>= j (+ c c)) (- j c c) j)))
+
+;; API
+(define (spsc-ring-buffer-num-entries rb)  ; only a snapshot
+  (%spsc-count (spsc-ring-buffer-capacity rb)
+               (atomic-fxbox-ref (spsc-ring-buffer-head rb))
+               (atomic-fxbox-ref (spsc-ring-buffer-tail rb))))
+
+;; API - producer side.  Returns #f if the buffer is full.
+(define (spsc-ring-buffer-push! rb elt)
+  (let* ([c (spsc-ring-buffer-capacity rb)]
+         [h (atomic-fxbox-ref (spsc-ring-buffer-head rb))]
+         [t (atomic-fxbox-ref (spsc-ring-buffer-tail rb))])
+    (and (< (%spsc-count c h t) c)
+         (begin
+           (%rb-set! (spsc-ring-buffer-dprocs rb) (spsc-ring-buffer-storage rb)
+                     (%spsc-index c t) elt)
+           (atomic-fxbox-set! (spsc-ring-buffer-tail rb) (%spsc-advance c t 1))
+           #t))))
+
+;; API - consumer side.
+(define (spsc-ring-buffer-pop! rb :optional fallback)
+  (let* ([c (spsc-ring-buffer-capacity rb)]
+         [t (atomic-fxbox-ref (spsc-ring-buffer-tail rb))]
+         [h (atomic-fxbox-ref (spsc-ring-buffer-head rb))])
+    (if (zero? (%spsc-count c h t))
+      (if (undefined? fallback)
+        (error "Ring buffer is empty:" rb)
+        fallback)
+      (rlet1 v (%rb-ref (spsc-ring-buffer-dprocs rb)
+                        (spsc-ring-buffer-storage rb) (%spsc-index c h))
+        (atomic-fxbox-set! (spsc-ring-buffer-head rb) (%spsc-advance c h 1))))))
+
+;; API - producer side.  Copies as many elements of SRC as fit, and
+;; returns the number of elements copied.
+(define (spsc-ring-buffer-write! rb src :optional (start 0) (end (size-of src)))
+  (unless (<= 0 start end (size-of src))
+    (errorf "start/end out of range (~s, ~s) for ~s" start end src))
+  (let* ([c (spsc-ring-buffer-capacity rb)]
+         [h (atomic-fxbox-ref (spsc-ring-buffer-head rb))]
+         [t (atomic-fxbox-ref (spsc-ring-buffer-tail rb))]
+         [n (min (- end start) (- c (%spsc-count c h t)))]
+         [s (spsc-ring-buffer-storage rb)]
+         [dprocs (spsc-ring-buffer-dprocs rb)]
+         [ti (%spsc-index c t)]
+         [n1 (min n (- c ti))])
+    (when (> n 0)
+      (%rb-copy! dprocs s ti src start (+ start n1))
+      (when (< n1 n)
+        (%rb-copy! dprocs s 0 src (+ start n1) (+ start n)))
+      (atomic-fxbox-set! (spsc-ring-buffer-tail rb) (%spsc-advance c t n)))
+    n))
+
+;; API - consumer side.  Moves up to (- end start) elements into DEST,
+;; and returns the number of elements moved.
+(define (spsc-ring-buffer-read! rb dest :optional (start 0) (end (size-of dest)))
+  (unless (<= 0 start end (size-of dest))
+    (errorf "start/end out of range (~s, ~s) for ~s" start end dest))
+  (let* ([c (spsc-ring-buffer-capacity rb)]
+         [t (atomic-fxbox-ref (spsc-ring-buffer-tail rb))]
+         [h (atomic-fxbox-ref (spsc-ring-buffer-head rb))]
+         [n (min (- end start) (%spsc-count c h t))]
+         [s (spsc-ring-buffer-storage rb)]
+         [dprocs (spsc-ring-buffer-dprocs rb)]
+         [hi (%spsc-index c h)]
+         [n1 (min n (- c hi))])
+    (when (> n 0)
+      (%rb-copy! dprocs dest start s hi (+ hi n1))
+      (when (< n1 n)
+        (%rb-copy! dprocs dest (+ start n1) s 0 (- n n1)))
+      (atomic-fxbox-set! (spsc-ring-buffer-head rb) (%spsc-advance c h n)))
+    n))
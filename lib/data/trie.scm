@@ -41,6 +41,7 @@
   (use gauche.sequence)
   (use gauche.generator)
   (use gauche.dictionary)
+  (use data.trie-core)
   (export <trie>
           make-trie trie trie-with-keys
           trie? trie-num-entries trie-exists? trie-partial-key?
@@ -56,6 +57,18 @@
           trie-keys trie-values trie-fold trie-map trie-for-each
           call-with-iterator call-with-builder size-of lazy-size-of
           alist->trie
+
+          ;; radix trie, from data.trie-core
+          <radix-trie>
+          make-radix-trie radix-trie? radix-trie-num-entries
+          radix-trie-exists? radix-trie-partial-key?
+          radix-trie-get radix-trie-put! radix-trie-update!
+          radix-trie-delete! radix-trie-clear!
+          radix-trie-longest-match
+          radix-trie-common-prefix radix-trie-common-prefix-keys
+          radix-trie-common-prefix-values radix-trie-common-prefix-fold
+          radix-trie->list radix-trie-keys radix-trie-values
+          radix-trie-fold radix-trie-for-each alist->radix-trie
           ))
 
 (select-module data.trie)
@@ -429,3 +442,26 @@
 (define-method dict-comparator ((trie <trie>))
   (error "Comparator is not defined for trie:" trie))
 
+;;;===========================================================
+;;; Radix trie
+;;;
+
+;; <radix-trie> is implemented in data.trie-core.  It only takes strings
+;; and u8vectors as keys, but doesn't allocate nodes per element, and
+;; compares keys by bytes.
+
+(define-dict-interface <radix-trie>
+  :get      radix-trie-get
+  :put!     radix-trie-put!
+  :delete!  radix-trie-delete!
+  :clear!   radix-trie-clear!
+  :exists?  radix-trie-exists?
+  :fold     radix-trie-fold
+  :for-each radix-trie-for-each
+  :keys     radix-trie-keys
+  :values   radix-trie-values
+  :update!  radix-trie-update!
+  :->alist  radix-trie->list)
+
+(define-method size-of ((t <radix-trie>))
+  (radix-trie-num-entries t))
@@ -38,11 +38,17 @@
   (use srfi-1)
   (use srfi-13)
   (use util.match)
+  (use gauche.threads)
   (extend util.relation)
   (export <dbi-error> <dbi-nonexistent-driver-error>
           <dbi-unsupported-error> <dbi-parameter-error>
+          <dbi-pool-timeout-error>
           <dbi-driver> <dbi-connection> <dbi-query>
           dbi-connect dbi-close dbi-prepare dbi-execute dbi-do
+          dbi-prepare-cached dbi-clear-statement-cache
+          <dbi-connection-pool> make-dbi-connection-pool
+          dbi-pool-acquire dbi-pool-release call-with-dbi-connection
+          dbi-pool-close dbi-pool-stats
           dbi-open? dbi-parse-dsn dbi-make-driver
           dbi-prepare-sql dbi-escape-sql dbi-list-drivers
           dbi-make-connection dbi-execute-using-connection
@@ -68,6 +74,10 @@
 ;; Parameter mismatch between a prepared query and its execution.
 (define-condition-type <dbi-parameter-error> <dbi-error> #f)
 
+;; No connection became available in the pool within the timeout.
+(define-condition-type <dbi-pool-timeout-error> <dbi-error> #f
+  (pool))
+
 
 ;;;==============================================================
 ;;; DBI object definitions
@@ -90,6 +100,8 @@
 (define-class <dbi-connection> ()
   ((open :init-value #t) ;; this slot is for backward compatibility.
                          ;; do not count on this.  will be removed.
+   (statement-cache :init-value #f) ;; see dbi-prepare-cached
+   (statement-cache-tick :init-value 0)
    ))
 
 ;; <dbi-query> : represents a prepared query.
@@ -134,6 +146,44 @@
                    (dbi-prepare-sql c sql))
     (make <dbi-query> :connection c :prepared prepared)))
 
+;; Like dbi-prepare, but returns the same query for the same SQL text
+;; and options on the same connection, as long as the query is open.
+;; The cache is per connection and not guarded by a lock, for a
+;; connection shouldn't be shared by threads simultaneously anyway.
+;; It holds up to dbi-statement-cache-size queries; when it overflows,
+;; the least recently used one is dropped.
+(define dbi-statement-cache-size 100)
+
+(define (dbi-prepare-cached c sql . options)
+  (let ([cache (or (slot-ref c 'statement-cache)
+                   (rlet1 ht (make-hash-table 'equal?)
+                     (slot-set! c 'statement-cache ht)))]
+        [key (cons sql options)]
+        [tick (inc! (slot-ref c 'statement-cache-tick))])
+    (match (hash-table-get cache key #f)
+      [((? dbi-open? q) . _)
+       (hash-table-put! cache key (cons q tick))
+       q]
+      [_
+       (let1 q (apply dbi-prepare c sql options)
+         (when (>= (hash-table-num-entries cache) dbi-statement-cache-size)
+           (statement-cache-evict! cache))
+         (hash-table-put! cache key (cons q tick))
+         q)])))
+
+;; Drops the least recently used entry.
+(define (statement-cache-evict! cache)
+  (let1 lru (hash-table-fold cache
+                             (^[k v lru]
+                               (if (or (not lru) (< (cdr v) (cddr lru)))
+                                 (cons k v)
+                                 lru))
+                             #f)
+    (when lru (hash-table-delete! cache (car lru)))))
+
+(define (dbi-clear-statement-cache c)
+  (slot-set! c 'statement-cache #f))
+
 (define-method dbi-execute ((q <dbi-query>) . params)
   (dbi-execute-using-connection (ref q 'connection) q params))
 
@@ -164,6 +214,112 @@
 (define (dbi-list-drivers)
   (library-map 'dbd.* (^[m p] m)))
 
+;;;==============================================================
+;;; Connection pool
+;;;
+
+;; A pool keeps up to max-connections connections to the same data
+;; source.  Idle connections are checked by health-check when they're
+;; handed out again; the ones failing the check are closed and replaced
+;; by fresh connections.  health-check can be a procedure that takes
+;; a connection and returns a true value if it's usable, or an SQL
+;; string which is regarded successful when it runs without an error.
+
+(define-class <dbi-connection-pool> ()
+  ((dsn             :init-keyword :dsn)
+   (connect-args    :init-keyword :connect-args)
+   (max-connections :init-keyword :max-connections)
+   (health-check    :init-keyword :health-check)
+   (mutex           :init-form (make-mutex))
+   (cv              :init-form (make-condition-variable))
+   (idle            :init-value '())   ; list of idle connections
+   (in-use          :init-value 0)     ; # of connections handed out
+   (closed          :init-value #f)))
+
+(define (make-dbi-connection-pool dsn :key (max-connections 8)
+                                           (health-check dbi-open?)
+                                  :allow-other-keys connect-args)
+  (unless (and (exact-integer? max-connections) (positive? max-connections))
+    (error "max-connections must be a positive exact integer, but got:"
+           max-connections))
+  (make <dbi-connection-pool>
+    :dsn dsn :connect-args connect-args
+    :max-connections max-connections
+    :health-check (cond [(string? health-check)
+                         (^c (guard (e [else #f]) (dbi-do c health-check) #t))]
+                        [(not health-check) (^_ #t)]
+                        [else health-check])))
+
+(define-syntax with-pool-lock
+  (syntax-rules ()
+    [(_ pool body ...) (with-locking-mutex (~ pool'mutex) (^[] body ...))]))
+
+;; Returns a usable connection, waiting for at most TIMEOUT seconds
+;; if all the connections are in use.  TIMEOUT #f means to wait forever.
+(define (dbi-pool-acquire pool :optional (timeout #f))
+  (define deadline
+    (and timeout (seconds->time (+ (time->seconds (current-time)) timeout))))
+  (define (take!)                       ; returns conn, 'new or #f
+    (let loop ()
+      (cond [(~ pool'closed) (error <dbi-error> "connection pool is closed:" pool)]
+            [(pair? (~ pool'idle))
+             (inc! (~ pool'in-use))
+             (pop! (~ pool'idle))]
+            [(< (~ pool'in-use) (~ pool'max-connections))
+             (inc! (~ pool'in-use))
+             'new]
+            [(mutex-unlock! (~ pool'mutex) (~ pool'cv) deadline)
+             (mutex-lock! (~ pool'mutex))
+             (loop)]
+            [else (mutex-lock! (~ pool'mutex)) #f])))
+  (define (give-up!)
+    (with-pool-lock pool
+      (dec! (~ pool'in-use))
+      (condition-variable-signal! (~ pool'cv))))
+  (let retry ()
+    (match (with-pool-lock pool (take!))
+      [#f (error <dbi-pool-timeout-error> :pool pool
+                 "timed out waiting for a connection from pool:" pool)]
+      ['new
+       (guard (e [else (give-up!) (raise e)])
+         (apply dbi-connect (~ pool'dsn) (~ pool'connect-args)))]
+      [conn
+       (if (guard (e [else #f]) ((~ pool'health-check) conn))
+         conn
+         (begin (guard (e [else #f]) (dbi-close conn))
+                (give-up!)
+                (retry)))])))
+
+;; Returns CONN to the pool.  If the pool has been closed, or CONN
+;; has already been closed, it is just discarded.
+(define (dbi-pool-release pool conn)
+  (let1 keep? (with-pool-lock pool
+                (dec! (~ pool'in-use))
+                (condition-variable-signal! (~ pool'cv))
+                (rlet1 keep? (and (not (~ pool'closed)) (dbi-open? conn))
+                  (when keep? (push! (~ pool'idle) conn))))
+    (unless keep? (guard (e [else #f]) (dbi-close conn)))))
+
+(define (call-with-dbi-connection pool proc :optional (timeout #f))
+  (let1 conn (dbi-pool-acquire pool timeout)
+    (unwind-protect (proc conn)
+      (dbi-pool-release pool conn))))
+
+;; Closes idle connections.  Connections in use are closed when
+;; they are released.
+(define (dbi-pool-close pool)
+  (let1 idle (with-pool-lock pool
+               (set! (~ pool'closed) #t)
+               (condition-variable-broadcast! (~ pool'cv))
+               (begin0 (~ pool'idle) (set! (~ pool'idle) '())))
+    (dolist [c idle] (guard (e [else #f]) (dbi-close c)))))
+
+(define (dbi-pool-stats pool)
+  (with-pool-lock pool
+    `((idle . ,(length (~ pool'idle)))
+      (in-use . ,(~ pool'in-use))
+      (max-connections . ,(~ pool'max-connections)))))
+
 ;;;==============================================================
 ;;; DBD-level APIs
 ;;;
@@ -39,6 +39,7 @@
           dbm-open    dbm-close   dbm-closed? dbm-get
           dbm-put!    dbm-delete! dbm-exists?
           dbm-fold    dbm-for-each  dbm-map
+          dbm-batch-put! dbm-begin! dbm-commit! dbm-abort! dbm-transaction
           dbm-db-exists? dbm-db-remove dbm-db-copy dbm-db-move dbm-db-rename
           dbm-type->class)
   )
@@ -54,7 +55,9 @@
    (key-convert   :init-keyword :key-convert :initform #f)
    (value-convert :init-keyword :value-convert :initform #f)
    ;; internal.  set up by dbm-open
-   k2s s2k v2s s2v)
+   k2s s2k v2s s2v
+   ;; internal.  nesting level of dbm-transaction
+   (transaction-depth :initform 0))
   :metaclass <dbm-meta>)
 
 ;; Macros & procedures that can be used by implementation modules
@@ -74,6 +77,11 @@
   (syntax-rules ()
     ((_ self key) ((slot-ref self 's2v) key))))
 
+(define (%dbm-check-writable dbm who)
+  (when (dbm-closed? dbm) (errorf "~a: dbm already closed: ~s" who dbm))
+  (when (eqv? (slot-ref dbm 'rw-mode) :read)
+    (errorf "~a: dbm is read only: ~s" who dbm)))
+
 ;; Utilities to copy/rename two files (esp. *.dir and *.pag file of
 ;; traditional dbm).  Makes some effort to take care of rollback on failure.
 ;; Also check if two files are hard-linked (gdbm_compat does that).
@@ -130,9 +138,7 @@
 ;;
 
 (define-method dbm-put! ((dbm <dbm>) key value)
-  (when (dbm-closed? dbm) (errorf "dbm-put!: dbm already closed: ~s" dbm))
-  (when (eqv? (slot-ref dbm 'rw-mode) :read)
-    (errorf "dbm-put!: dbm is read only: ~s" dbm)))
+  (%dbm-check-writable dbm "dbm-put!"))
 
 (define-method dbm-get ((dbm <dbm>) key . args)
   (when (dbm-closed? dbm) (errorf "dbm-get: dbm already closed: ~s" dbm)))
@@ -141,9 +147,7 @@
   (when (dbm-closed? dbm) (errorf "dbm-exists?: dbm already closed: ~s" dbm)))
 
 (define-method dbm-delete! ((dbm <dbm>) key)
-  (when (dbm-closed? dbm) (errorf "dbm-delete!: dbm already closed: ~s" dbm))
-  (when (eqv? (slot-ref dbm 'rw-mode) :read)
-    (errorf "dbm-delete!: dbm is read only: ~s" dbm)))
+  (%dbm-check-writable dbm "dbm-delete!"))
 
 (define-method dbm-fold ((dbm <dbm>) proc knil) #f)
 
@@ -165,6 +169,46 @@
   (reverse
    (dbm-fold dbm (^[key value r] (cons (proc key value) r)) '())))
 
+;;
+;; Transactions and batch updates
+;;
+;;  A backend that can group updates overrides dbm-begin!, dbm-commit!
+;;  and dbm-abort!.  The default ones don't group anything; dbm-abort!
+;;  can't undo the updates, so it just commits them.  Code that uses
+;;  dbm-transaction and dbm-batch-put! works with any backend, and gets
+;;  faster with the ones that support them.
+;;
+
+(define-method dbm-begin! ((dbm <dbm>))
+  (%dbm-check-writable dbm "dbm-begin!"))
+
+(define-method dbm-commit! ((dbm <dbm>)) #f)
+
+(define-method dbm-abort! ((dbm <dbm>)) (dbm-commit! dbm))
+
+;; Nested calls are merged into the outermost one.
+(define-method dbm-transaction ((dbm <dbm>) thunk)
+  (if (positive? (slot-ref dbm 'transaction-depth))
+    (thunk)
+    (let1 committed #f
+      (dynamic-wind
+          (^[] (dbm-begin! dbm)
+               (slot-set! dbm 'transaction-depth 1))
+          (^[] (begin0 (thunk)
+                 (slot-set! dbm 'transaction-depth 0)
+                 (dbm-commit! dbm)
+                 (set! committed #t)))
+          (^[] (unless committed
+                 (slot-set! dbm 'transaction-depth 0)
+                 (dbm-abort! dbm)))))))
+
+;; KVS is a list of (key . value).  Backends may store them at once
+;; without going through dbm-put! for each.
+(define-method dbm-batch-put! ((dbm <dbm>) kvs)
+  (%dbm-check-writable dbm "dbm-batch-put!")
+  (dbm-transaction dbm
+                   (^[] (dolist [kv kvs] (dbm-put! dbm (car kv) (cdr kv))))))
+
 ;;
 ;; Collection framework
 ;;
@@ -37,10 +37,11 @@
   (use file.util)
   (use srfi-1)
   (use srfi-13)
-  (export <fsdbm>)
+  (export <fsdbm> fsdbm-compact!)
   )
 (select-module dbm.fsdbm)
 
+
 ;;; fsdbm uses a filesystem to store dbm-type database.
 ;;; A key is filename, and its value is the content of the file.
 ;;; Obviously, it is not suitable for the database that has
@@ -51,7 +52,10 @@
 ;;;
 ;;; Fsdbm pathname is used for a directory that stores the data.
 ;;; The top-level directory has 37 data directories (z[0-9a-z_]),
-;;; 'Incoming' directory, and a version file (FSDBM).
+;;; 'Incoming' directory, and a version file (FSDBM).  In the version
+;;; 2.0 format, each data directory is split again into 37
+;;; subdirectories by default (shard-levels is 2), and the top-level
+;;; directory also has a journal file (Journal).
 ;;;
 ;;; When a new entry is added to the database, it first creates
 ;;; the file whose name is the key under Incoming directory, and
@@ -71,10 +75,32 @@
 ;;; read/write.  It is naturally taken care of by the file system.
 ;;; It uses fcntl advisory lock to prevent race conditions that involve
 ;;; more than one entries, whenever available.
+;;;
+;;; The journal records additions and deletions of keys, so that
+;;; the set of keys can be known without walking the directories.
+;;; Each record is either
+;;;
+;;;    "+ KEY-SIZE\n" KEY "\n"     ; key is added
+;;;    "- KEY-SIZE\n" KEY "\n"     ; key is deleted
+;;;
+;;; Writers append to it while holding the fcntl lock on it.  Readers
+;;; don't lock; they replay the records appended since they last
+;;; looked, ignoring an incomplete record at the end.  The replayed
+;;; journal is kept in memory as the key index.  It is loaded only
+;;; when it is needed, i.e. by dbm-fold and by writers.
+;;;
+;;; If the database is created with value-log, the values are also
+;;; kept in the journal instead of the data files, with the record
+;;;
+;;;    "+ KEY-SIZE VALUE-SIZE\n" KEY VALUE "\n"
+;;;
+;;; and the index maps each key to the position of its value.
+;;; fsdbm-compact! rewrites the journal with only the live records.
 
-(define-constant *fsdbm-version*   "1.0")
+(define-constant *fsdbm-version*   "2.0")
 (define-constant *version-file*    "Fsdbm")
 (define-constant *incoming-dir*    "Incoming")
+(define-constant *journal-file*    "Journal")
 (define-constant *file-name-limit* 200)
 
 (define-constant *hash-chars*
@@ -86,7 +112,18 @@
   ())
 
 (define-class <fsdbm> (<dbm>)
-  ((closed? :init-value #f))
+  ((closed? :init-value #f)
+   ;; The layout of a new database.  When an existing database is
+   ;; opened, they're set to the ones of the database.
+   (shard-levels :init-keyword :shard-levels :init-value 2)
+   (value-log    :init-keyword :value-log    :init-value #f)
+   ;; internal
+   (version      :init-value #f)
+   (journal-in   :init-value #f)        ;input port of the journal
+   (journal-ino  :init-value #f)        ;inode of the journal we read
+   (journal-pos  :init-value 0)         ;end of the last record we read
+   (journal-out  :init-value #f)        ;output port to append records
+   (index        :init-value #f))       ;key -> #t or (offset . size)
   :metaclass <fsdbm-meta>)
 
 (define-method dbm-open ((self <fsdbm>))
@@ -102,13 +139,24 @@
          (errorf "dbm-open: no fsdbm database ~a" path))]
       [(:write)
        (unless (fsdbm-directory? path)
-         (fsdbm-create path fmode))]
+         (fsdbm-create path fmode
+                       (ref self 'shard-levels) (ref self 'value-log)))]
       [(:create)
-       (fsdbm-create path fmode)]
+       (fsdbm-create path fmode
+                     (ref self 'shard-levels) (ref self 'value-log))]
       )
+    (receive (version opts) (read-version path)
+      (set! (ref self 'version) version)
+      (set! (ref self 'shard-levels) (assq-ref opts 'shard-levels 1))
+      (set! (ref self 'value-log) (assq-ref opts 'value-log #f)))
     self))
 
 (define-method dbm-close ((self <fsdbm>))
+  (and-let1 out (ref self 'journal-out) (close-output-port out))
+  (and-let1 in (ref self 'journal-in) (close-input-port in))
+  (set! (ref self 'journal-out) #f)
+  (set! (ref self 'journal-in) #f)
+  (set! (ref self 'index) #f)
   (set! (ref self 'closed?) #t)
   #t)
 
@@ -121,55 +169,94 @@
 (define-method dbm-put! ((self <fsdbm>) key value)
   (next-method)
   (let* ((k (%dbm-k2s self key))
-         (inpath (build-path (ref self 'path) *incoming-dir* (key->path k)))
-         (path   (value-file-path k (ref self 'path))))
-    (make-directory* (sys-dirname path) (dir-perm (ref self 'file-mode)))
-    (make-directory* (sys-dirname inpath) (dir-perm (ref self 'file-mode)))
-    (with-output-to-file inpath
-      (lambda () (display (%dbm-v2s self value)))
-      :if-exists :error) ;; should it be error?
-    (sys-rename inpath path)))
+         (v (%dbm-v2s self value)))
+    (if (ref self 'value-log)
+      (with-journal-lock self (cut append-record! self "+" k v))
+      (let ((inpath (build-path (ref self 'path) *incoming-dir* (key->path k)))
+            (path   (value-file-path self k)))
+        (make-directory* (sys-dirname path) (dir-perm (ref self 'file-mode)))
+        (make-directory* (sys-dirname inpath) (dir-perm (ref self 'file-mode)))
+        (with-output-to-file inpath
+          (lambda () (display v))
+          :if-exists :error) ;; should it be error?
+        (if (journal? self)
+          (with-journal-lock self
+            (lambda ()
+              (sys-rename inpath path)
+              (unless (hash-table-exists? (ref self 'index) k)
+                (append-record! self "+" k #f))))
+          (sys-rename inpath path))))))
 
 (define-method dbm-get ((self <fsdbm>) key . args)
   (next-method)
-  (let ((path (value-file-path (%dbm-k2s self key) (ref self 'path))))
-    (cond ((call-with-input-file path
-             (^p (and p (%dbm-s2v self (read-chunk p))))
-             :if-does-not-exist #f))
+  (let1 k (%dbm-k2s self key)
+    (cond ((if (ref self 'value-log)
+             (log-value self k)
+             (call-with-input-file (value-file-path self k)
+               (^p (and p (read-chunk p)))
+               :if-does-not-exist #f))
+           => (cut %dbm-s2v self <>))
           ((pair? args) (car args))
           (else (errorf "fsdbm: no data for key ~s in database ~s"
                         key self)))))
 
 (define-method dbm-exists? ((self <fsdbm>) key)
   (next-method)
-  (file-exists? (value-file-path (%dbm-k2s self key) (ref self 'path))))
+  (let1 k (%dbm-k2s self key)
+    (if (ref self 'value-log)
+      (begin (refresh-index! self)
+             (hash-table-exists? (ref self 'index) k))
+      (file-exists? (value-file-path self k)))))
 
 (define-method dbm-delete! ((self <fsdbm>) key)
   (next-method)
-  (sys-unlink (value-file-path (%dbm-k2s self key) (ref self 'path))))
+  (let1 k (%dbm-k2s self key)
+    (cond [(ref self 'value-log)
+           (with-journal-lock self
+             (lambda ()
+               (when (hash-table-exists? (ref self 'index) k)
+                 (append-record! self "-" k #f))))]
+          [(journal? self)
+           (with-journal-lock self
+             (lambda ()
+               (sys-unlink (value-file-path self k))
+               (when (hash-table-exists? (ref self 'index) k)
+                 (append-record! self "-" k #f))))]
+          [else
+           (sys-unlink (value-file-path self k))])))
 
+;; With the journal, we enumerate the keys in the index instead of
+;; walking the directories.  We take a snapshot of the index, since
+;; PROC may modify the database.
 (define-method dbm-fold ((self <fsdbm>) proc seed)
-  (define prefix-len
-    (string-length (build-path (ref self 'path) "a/")))
-  (define (apply-kv path seed)
-    (if (file-is-directory? path)
-      (fold apply-kv seed
-            (directory-list path :add-path? #t :children? #t))
-      (let ((k (path->key (string-drop path prefix-len))))
-        (if k
-          (proc (%dbm-s2k self k)
-                (call-with-input-file path
-                  (^p (%dbm-s2v self (read-chunk p))))
-                seed)
-          seed))))
+  (define (read-file k)
+    (call-with-input-file (value-file-path self k) read-chunk
+      :if-does-not-exist #f))
   (next-method)
-  (fold (lambda (c seed)
-          (let1 p (build-path (ref self 'path) c)
-            (if (file-exists? p)
-              (fold apply-kv seed
-                    (directory-list p :add-path? #t :children? #t))
-              seed)))
-        seed *hash-dirs*))
+  (cond [(ref self 'value-log)
+         (refresh-index! self)
+         (let1 in (ref self 'journal-in)
+           (fold (^[kv seed]
+                   (proc (%dbm-s2k self (car kv))
+                         (%dbm-s2v self (read-value-at in (cadr kv) (cddr kv)))
+                         seed))
+                 seed (hash-table->alist (ref self 'index))))]
+        [(journal? self)
+         (refresh-index! self)
+         (fold (^[k seed]
+                 ;; the file may have been deleted after we read the index
+                 (if-let1 v (read-file k)
+                   (proc (%dbm-s2k self k) (%dbm-s2v self v) seed)
+                   seed))
+               seed (hash-table-keys (ref self 'index)))]
+        [else
+         (walk-fold self
+                    (^[k path seed]
+                      (proc (%dbm-s2k self k)
+                            (call-with-input-file path
+                              (^p (%dbm-s2v self (read-chunk p))))
+                            seed))
+                    seed)]))
 
 (define-method dbm-db-exists? ((class <fsdbm-meta>) name)
   (fsdbm-directory? name))
@@ -191,6 +278,171 @@
   (copy-directory* from to)
   (remove-directory* from))
 
+;; Rewrites the journal with only the live records.  Without value-log,
+;; the keys are taken from the data directories, so it also recovers
+;; a lost or damaged journal.
+(define (fsdbm-compact! self)
+  (%dbm-check-writable self "fsdbm-compact!")
+  (unless (journal? self)
+    (errorf "fsdbm-compact!: database ~a is in version ~a format, \
+             which doesn't have a journal"
+            (ref self 'path) (ref self 'version)))
+  (let* ((jpath (journal-path self))
+         (tmp   (string-append jpath ".tmp")))
+    (with-journal-lock self
+      (lambda ()
+        (call-with-output-file tmp
+          (lambda (out)
+            (if (ref self 'value-log)
+              (let1 in (ref self 'journal-in)
+                (hash-table-for-each
+                 (ref self 'index)
+                 (^[k v] (write-record out "+" k
+                                       (read-value-at in (car v) (cdr v))))))
+              (walk-fold self
+                         (^[k path _] (write-record out "+" k #f))
+                         #f))))
+        (sys-rename tmp jpath)))
+    ;; The lock was on the old journal.  Let the next access reopen it.
+    (close-output-port (ref self 'journal-out))
+    (set! (ref self 'journal-out) #f)
+    (set! (ref self 'journal-in) #f)
+    (undefined)))
+
+;;
+;; Journal
+;;
+
+(define (journal? self) (not (equal? (ref self 'version) "1.0")))
+
+(define (journal-path self) (build-path (ref self 'path) *journal-file*))
+
+;; Brings the index up to date with the journal.  If the journal is
+;; replaced by fsdbm-compact!, we read the new one from the beginning.
+;; We don't close the old port, for a fold over the value log may
+;; still be reading from it; it is closed when it's collected.
+(define (refresh-index! self)
+  (let* ((jpath (journal-path self))
+         (st (if (ref self 'journal-in)
+               (sys-stat jpath)
+               (begin
+                 (set! (ref self 'journal-in) (open-input-file jpath))
+                 (sys-fstat (ref self 'journal-in))))))
+    (unless (eqv? (~ st'ino) (ref self 'journal-ino))
+      (unless (eqv? (~ (sys-fstat (ref self 'journal-in))'ino) (~ st'ino))
+        (set! (ref self 'journal-in) (open-input-file jpath)))
+      (set! (ref self 'journal-ino) (~ st'ino))
+      (set! (ref self 'journal-pos) 0)
+      (set! (ref self 'index) (make-hash-table 'equal?)))
+    (when (> (~ st'size) (ref self 'journal-pos))
+      (read-journal! self (~ st'size)))))
+
+;; Replays the records from journal-pos up to LIMIT bytes.
+(define (read-journal! self limit)
+  (define in  (ref self 'journal-in))
+  (define idx (ref self 'index))
+  (define (corrupted)
+    (errorf "fsdbm: corrupted journal in ~a" (ref self 'path)))
+  (port-seek in (ref self 'journal-pos) SEEK_SET)
+  (let loop ((pos (ref self 'journal-pos)))
+    (set! (ref self 'journal-pos) pos)
+    (let1 header (read-line in)
+      (unless (eof-object? header)
+        (rxmatch-case header
+          (#/^([-+]) (\d+)(?: (\d+))?$/ (_ tag ksize vsize)
+           (let* ((ksize (string->number ksize))
+                  (vsize (if vsize (string->number vsize) 0))
+                  (kpos  (+ pos (string-size header) 1))
+                  (end   (+ kpos ksize vsize 1)))
+             (when (<= end limit) ;; otherwise, it's still being written
+               (let1 k (read-bytes ksize in)
+                 (if (< vsize 1024)
+                   (read-bytes vsize in)
+                   (port-seek in vsize SEEK_CUR))
+                 (read-byte in)
+                 (if (equal? tag "+")
+                   (hash-table-put! idx k (if (ref self 'value-log)
+                                            (cons (+ kpos ksize) vsize)
+                                            #t))
+                   (hash-table-delete! idx k))
+                 (loop end)))))
+          (else
+           ;; an incomplete header at the end is fine
+           (when (<= (+ pos (string-size header) 1) limit)
+             (corrupted))))))))
+
+;; VALUE is #f unless for the value log.
+(define (record-header tag key value)
+  (if value
+    (format "~a ~d ~d\n" tag (string-size key) (string-size value))
+    (format "~a ~d\n" tag (string-size key))))
+
+(define (write-record out tag key value)
+  (display (record-header tag key value) out)
+  (display key out)
+  (when value (display value out))
+  (newline out))
+
+;; Must be called within with-journal-lock.
+(define (append-record! self tag key value)
+  (let* ((vpos (+ (ref self 'journal-pos)
+                  (string-size (record-header tag key value))
+                  (string-size key)))
+         (vsize (if value (string-size value) 0)))
+    (write-record (ref self 'journal-out) tag key value)
+    (flush (ref self 'journal-out))
+    (set! (ref self 'journal-pos) (+ vpos vsize 1))
+    (if (equal? tag "+")
+      (hash-table-put! (ref self 'index) key (if value (cons vpos vsize) #t))
+      (hash-table-delete! (ref self 'index) key))))
+
+;; Calls THUNK while holding the write lock of the journal, with the
+;; index up to date.  If the journal has been replaced while we're
+;; waiting the lock, we retry with the new one.  An incomplete record
+;; at the end, left by a crashed writer, is discarded.
+(define (with-journal-lock self thunk)
+  (define (lock out lock?)
+    (cond-expand
+     [gauche.sys.fcntl
+      (sys-fcntl out F_SETLKW
+                 (make <sys-flock> :type (if lock? F_WRLCK F_UNLCK)
+                       :whence 0))]
+     [else #t]))
+  (let loop ()
+    (unless (ref self 'journal-out)
+      (set! (ref self 'journal-out)
+            (open-output-file (journal-path self) :if-exists :append)))
+    (let1 out (ref self 'journal-out)
+      (lock out #t)
+      (if (not (eqv? (~ (sys-fstat out)'ino)
+                     (~ (sys-stat (journal-path self))'ino)))
+        (begin (close-output-port out)
+               (set! (ref self 'journal-out) #f)
+               (loop))
+        (unwind-protect
+            (begin
+              (refresh-index! self)
+              (when (> (~ (sys-fstat out)'size) (ref self 'journal-pos))
+                (sys-ftruncate out (ref self 'journal-pos)))
+              (thunk))
+          (lock out #f))))))
+
+;; Returns the value of key K in the value log, or #f.
+(define (log-value self k)
+  (refresh-index! self)
+  (and-let1 v (hash-table-get (ref self 'index) k #f)
+    (read-value-at (ref self 'journal-in) (car v) (cdr v))))
+
+(define (read-value-at in offset size)
+  (port-seek in offset SEEK_SET)
+  (read-bytes size in))
+
+(define (read-bytes size in)
+  (if (zero? size)
+    ""
+    (let1 s (read-block size in)
+      (or (string-incomplete->complete s) s))))
+
 ;;
 ;; Internal utilities
 ;;
@@ -199,12 +451,30 @@
   (and (file-is-directory? path)
        (file-exists? (build-path path *version-file*))))
 
-(define (fsdbm-create path mode)
+(define (fsdbm-create path mode shard-levels value-log)
+  (unless (memv shard-levels '(1 2))
+    (error "fsdbm: shard-levels must be 1 or 2, but got:" shard-levels))
   (when (file-exists? path) (remove-directory* path))
   (sys-mkdir path (dir-perm mode))
   (with-output-to-file (build-path path *version-file*)
-    (lambda () (display *fsdbm-version*)))
-  (sys-mkdir (build-path path *incoming-dir*) (dir-perm mode)))
+    (lambda ()
+      (display *fsdbm-version*) (newline)
+      (write `((shard-levels . ,shard-levels)
+               (value-log . ,(and value-log #t))))
+      (newline)))
+  (sys-mkdir (build-path path *incoming-dir*) (dir-perm mode))
+  (with-output-to-file (build-path path *journal-file*) (lambda () #f)))
+
+;; Returns the version string and the alist of options.  Version 1.0
+;; file only has the version string.
+(define (read-version path)
+  (call-with-input-file (build-path path *version-file*)
+    (lambda (p)
+      (let* ((version (read-line p))
+             (opts    (read p)))
+        (unless (member version '("1.0" "2.0"))
+          (errorf "fsdbm: unsupported version ~s in ~a" version path))
+        (values version (if (eof-object? opts) '() opts))))))
 
 ;; read everything from the port and returns potentially incomplete string
 (define (read-chunk port)
@@ -220,6 +490,34 @@
   ;; database is also searchable.
   (logior file-perm (ash (logand file-perm #o444) -2)))
 
+;; Walks the data directories and calls (PROC key path seed) on
+;; each data file.
+(define (walk-fold self proc seed)
+  (define levels (ref self 'shard-levels))
+  (define prefix-len
+    (+ (string-length (apply build-path (ref self 'path)
+                             (make-list levels "a")))
+       1))
+  (define (apply-kv path seed)
+    (if (file-is-directory? path)
+      (fold apply-kv seed
+            (directory-list path :add-path? #t :children? #t))
+      (let ((k (path->key (string-drop path prefix-len))))
+        (if k
+          (proc k path seed)
+          seed))))
+  (fold (lambda (c seed)
+          (let1 p (build-path (ref self 'path) c)
+            (if (file-exists? p)
+              (fold apply-kv seed
+                    (directory-list p :add-path? #t :children? #t))
+              seed)))
+        seed
+        (if (= levels 1)
+          *hash-dirs*
+          (append-map (^d (map (cut build-path d <>) *hash-dirs*))
+                      *hash-dirs*))))
+
 (define (key->path key)
   (with-string-io key
     (lambda ()
@@ -260,22 +558,24 @@
                  [else
                   (write-char c) (loop (read-char))])))))))
 
-(define (path->hash path)
+;; Returns the list of the data directory names, LEVELS deep.
+(define (path->hash path levels)
   ;; NB: we use our own hash fn to keep backward compatibility.
+  ;; The first level is the same as version 1.0.
   (define mask (- (expt 2 32) 1))
-  (define (shash hval mod)
+  (define (shash hval)
     (let1 b (read-byte)
       (if (eof-object? b)
-        (modulo hval mod)
-        (shash (logand (+ hval (ash hval 3) b) mask) mod))))
-  (string (string-ref *hash-chars*
-                      (with-input-from-string path
-                        (cut shash 0 *hash-range*)))))
+        hval
+        (shash (logand (+ hval (ash hval 3) b) mask)))))
+  (define (hash-dir h) (string (string-ref *hash-chars* h)))
+  (let1 hval (with-input-from-string path (cut shash 0))
+    (if (= levels 1)
+      (list (hash-dir (modulo hval *hash-range*)))
+      (list (hash-dir (modulo hval *hash-range*))
+            (hash-dir (modulo (quotient hval *hash-range*) *hash-range*))))))
 
-(define (value-file-path key :optional (dir #f))
+(define (value-file-path self key)
   (let1 p (key->path key)
-    (if dir
-	(build-path dir (path->hash p) p)
-	(build-path (path->hash p) p))))
-
-
+    (apply build-path (ref self 'path)
+           (append (path->hash p (ref self 'shard-levels)) (list p)))))
@@ -65,7 +65,7 @@
     (define jumps
       '(JUMP LOCAL-ENV-JUMP))
     (define returns
-      '(RET VALUES-RET LREF-RET CONST-RET CONSTF-RET CONSTU-RET
+      '(RET VALUES-RET LREF-RET CONST-RET CONSTF-RET CONSTU-RET CONSTT-RET
         TAIL-CALL LOCAL-ENV-TAIL-CALL GREF-TAIL-CALL PUSH-GREF-TAIL-CALL
         LREF0-PUSH-GREF-TAIL-CALL VALUES-APPLY TAIL-APPLY))
     (define branches
@@ -150,6 +150,29 @@
 ;;      which isn't exported) are not included in the output.  But sometimes
 ;;      hygienic public macros expands to a call of private macros, and
 ;;      gauche.cgen.precomp cannot detect such dependencies yet.
+;;
+;; jobs : (cgen-precompile-multi only) If more than 1, source files that
+;;      don't depend on each other are compiled concurrently in up to
+;;      this many child processes.  Ignored on platforms without fork.
+;;
+;; cache-dir : (cgen-precompile-multi only) If given, the outputs are
+;;      cached in this directory, keyed by the content of the sources and
+;;      the precompiler options, and reused if nothing has changed.
+;;      Changes in the modules outside of the given sources (e.g. macros
+;;      defined in an installed library) aren't tracked; use a fresh
+;;      directory if you update them.
+;;
+;; inline-hints : A file written by profiler-write-inline-hints.  Small
+;;      procedures listed in it are compiled with guarded inliners, so
+;;      that calls to them from other modules can be inlined.
+;;
+;; lazy-dso : If true, the dynamic-load form in the SCI output is given
+;;      :lazy argument, so that the DSO is loaded and initialized
+;;      when one of the exported bindings is first referenced, instead of
+;;      when the module is loaded.  It should only be used when all the
+;;      exported procedures and variables are defined by the DSO,
+;;      and its initialization has no side effects other than defining
+;;      them.
 
 (define (cgen-precompile src . keys)
   (with-tmodule-recording
@@ -174,29 +197,147 @@
                                     ((:dso-name dso) #f)
                                     (predef-syms '())
                                     (macros-to-keep '())
-                                    (extra-optimization #f))
+                                    (extra-optimization #f)
+                                    (lazy-dso #f)
+                                    (inline-hints #f)
+                                    (jobs 1)
+                                    (cache-dir #f))
   (match srcs
     [() #f]
     [(main . subs)
+     (define dso-name (or dso (basename-sans-extension main)))
+     (define (compile-group files)
+       (with-tmodule-recording
+        <ptmodule>
+        (dolist [src (order-files-by-dependency files)]
+          (let* ([out.c ($ xlate-cfilename
+                           $ strip-prefix (path-swap-extension src "c") prefix)]
+                 [initname (string-tr (path-sans-extension out.c) "-+." "___")])
+            (%cgen-precompile src
+                              :out.c out.c
+                              :dso-name dso-name
+                              :predef-syms predef-syms
+                              :strip-prefix prefix
+                              :macros-to-keep macros-to-keep
+                              :extra-optimization extra-optimization
+                              :lazy-dso lazy-dso
+                              :inline-hints inline-hints
+                              :ext-initializer (and (equal? src main)
+                                                    ext-initializer)
+                              :initializer-name #"Scm_Init_~initname")))))
+     (define (compile-group/cache files)
+       (if cache-dir
+         (with-output-cache cache-dir files prefix
+                            (list dso-name predef-syms macros-to-keep
+                                  extra-optimization lazy-dso
+                                  (and inline-hints
+                                       (file->string inline-hints))
+                                  (and (member main files) ext-initializer))
+                            (cut compile-group files))
+         (compile-group files)))
      (clean-output-files srcs prefix)
-     (with-tmodule-recording
-      <ptmodule>
-      (dolist [src (order-files-by-dependency srcs)]
-        (let* ([out.c ($ xlate-cfilename
-                         $ strip-prefix (path-swap-extension src "c") prefix)]
-               [initname (string-tr (path-sans-extension out.c) "-+." "___")])
-          (%cgen-precompile src
-                            :out.c out.c
-                            :dso-name (or dso (basename-sans-extension main))
-                            :predef-syms predef-syms
-                            :strip-prefix prefix
-                            :macros-to-keep macros-to-keep
-                            :extra-optimization extra-optimization
-                            :ext-initializer (and (equal? src main)
-                                                  ext-initializer)
-                            :initializer-name #"Scm_Init_~initname"))))]
+     (if (or (> jobs 1) cache-dir)
+       (run-groups compile-group/cache (independent-groups srcs) jobs)
+       (compile-group srcs))]
     ))
 
+;; Partition SRCS into groups so that no file depends on a file in other
+;; groups.  If there's a file without define-module, we can't tell
+;; its dependency, so we give up and return a single group.
+(define (independent-groups srcs)
+  (let1 deps (map get-module-dependency srcs)
+    (if (memq #f deps)
+      (list srcs)
+      (let* ([mod->src (map (^.[(m s _) (cons m s)]) deps)]
+             [group (make-hash-table 'string=?)]) ; src -> representative
+        (define (root-of s)
+          (let1 p (hash-table-get group s s)
+            (if (equal? p s) s (root-of p))))
+        (define (union! a b)
+          (let ([ra (root-of a)] [rb (root-of b)])
+            (unless (equal? ra rb) (hash-table-put! group ra rb))))
+        (dolist [d deps]
+          (match-let1 (_ s uses) d
+            (dolist [u uses]
+              (cond [(assq u mod->src) => (^p (union! s (cdr p)))]))))
+        ;; keep the original order within and among groups
+        (let loop ([srcs srcs] [r '()])
+          (match srcs
+            [() (reverse (map reverse r))]
+            [(s . rest)
+             (let1 root (root-of s)
+               (if-let1 g (find (^g (equal? (root-of (car g)) root)) r)
+                 (begin (set-cdr! g (cons (car g) (cdr g)))
+                        (set-car! g s)
+                        (loop rest r))
+                 (loop rest (cons (list s) r))))]))))))
+
+;; Call COMPILE on each group, in up to JOBS child processes at a time.
+(define (run-groups compile groups jobs)
+  (define can-fork? (cond-expand [gauche.os.windows #f] [else #t]))
+  (if (or (<= jobs 1) (not can-fork?) (null? (cdr groups)))
+    (for-each compile groups)
+    (let loop ([groups groups] [running 0] [failed #f])
+      (define (wait-one)
+        (receive (pid status) (sys-wait)
+          (loop groups (- running 1)
+                (or failed (not (zero? (sys-wait-exit-status status)))))))
+      (cond [(and (null? groups) (zero? running))
+             (when failed (error "precompilation failed"))]
+            [(or (null? groups) (>= running jobs) failed)
+             (if (zero? running)
+               (loop '() 0 failed)
+               (wait-one))]
+            [else
+             (flush (current-output-port))
+             (flush (current-error-port))
+             (let1 pid (sys-fork)
+               (when (zero? pid)
+                 (let1 code (guard (e [else (report-error e) 1])
+                              (compile (car groups))
+                              0)
+                   (flush (current-output-port))
+                   (flush (current-error-port))
+                   (sys-exit code)))
+               (loop (cdr groups) (+ running 1) failed))]))))
+
+;; Output cache.  Each entry is a directory named by the digest of
+;; the inputs, containing the output files and a manifest that maps
+;; them to the output paths.
+(autoload rfc.sha sha1-digest-string)
+(autoload util.digest digest-hexify)
+
+(define (with-output-cache cache-dir srcs prefix options thunk)
+  (define (outputs src)
+    (cons ($ xlate-cfilename
+             $ strip-prefix (path-swap-extension src "c") prefix)
+          (if (check-first-form-is-define-module src)
+            (list (strip-prefix (path-swap-extension src "sci") prefix))
+            '())))
+  (define key
+    ($ digest-hexify $ sha1-digest-string
+       $ write-to-string
+       (list (gauche-version) options
+             (map (^s (cons s (file->string s))) srcs))))
+  (define dir (build-path cache-dir key))
+  (define manifest (build-path dir "manifest"))
+  (define files (append-map outputs srcs))
+  (if (file-exists? manifest)
+    (let1 cached (with-input-from-file manifest read)
+      (for-each (^[f i]
+                  (make-directory* (sys-dirname f))
+                  (copy-file (build-path dir (x->string i)) f
+                             :if-exists :supersede))
+                cached (liota (length cached))))
+    (begin
+      (thunk)
+      (let1 produced (filter file-exists? files)
+        (make-directory* dir)
+        (for-each (^[f i] (copy-file f (build-path dir (x->string i))
+                                     :if-exists :supersede))
+                  produced (liota (length produced)))
+        (with-output-to-file manifest (cut write produced))))))
+
 ;; Common stuff -- process single source
 (define (%cgen-precompile src
                           :key (out.c #f)
@@ -208,7 +349,11 @@
                                (sub-initializers '())
                                (predef-syms '())
                                (macros-to-keep '())
-                               (extra-optimization #f))
+                               (extra-optimization #f)
+                               (lazy-dso #f)
+                               (inline-hints #f))
+  (when inline-hints
+    (set-inline-hints! inline-hints))
   (let ([out.c   (or out.c (path-swap-extension (sys-basename src) "c"))]
         [out.sci (or out.sci
                      (and (check-first-form-is-define-module src)
@@ -224,7 +369,8 @@
                               initializer-name)]
                    [vm-eval-situation SCM_VM_COMPILING]
                    [private-macros-to-keep macros-to-keep]
-                   [run-extra-optimization-passes extra-optimization])
+                   [run-extra-optimization-passes extra-optimization]
+                   [lazy-dso-loading lazy-dso])
       (select-tmodule 'gauche)
       (cond [out.sci
              (make-directory* (sys-dirname out.sci))
@@ -268,6 +414,10 @@
 ;; of the initializer function.
 (define dso-name (make-parameter #f))
 
+;; If true, the dynamic-load form in the .sci file is lazy.
+;; (--lazy-dso)
+(define lazy-dso-loading (make-parameter #f))
+
 ;; keep the list of exported bindings (or #t if export-all)
 (define compile-module-exports (make-parameter '()))
 
@@ -290,6 +440,17 @@
 ;; Experimental: Run extra optimization during AOT compilation.
 (define run-extra-optimization-passes (make-parameter #f))
 
+;; Profile-guided inlining (--inline-hints=file).  The hints are kept
+;; in the compiler, so they're effective for the rest of the process.
+;; NB: The host gosh may be older than the target, so we look up the
+;; compiler entry at runtime.
+(define (set-inline-hints! file)
+  (if-let1 setter (global-variable-ref (find-module 'gauche.internal)
+                                       '%set-auto-inline-hints! #f)
+    (setter file)
+    (warn "This version of gosh doesn't support inline hints; ~a ignored.\n"
+          file)))
+
 ;;================================================================
 ;; Bridge to the internal stuff
 ;;
@@ -383,6 +544,16 @@
 (define (write-ext-module form)
   (cond [(ext-module-file) => (^_ (write form _) (newline _))]))
 
+;; LAZY is #f, #t or a quoted list of symbols; see dynamic-load.
+(define (write-dynamic-load lazy)
+  (define lazy-arg (if lazy `(:lazy ,lazy) '()))
+  (match (dso-name)
+    [(name . #f)
+     (write-ext-module `(dynamic-load ,name ,@lazy-arg))]
+    [(name . initfn)
+     (write-ext-module `(dynamic-load ,name :init-function ,initfn ,@lazy-arg))]
+    [_ #f]))
+
 (define (setup ext-init? subinits)
   (cgen-decl "#include <gauche/code.h>")
   (cond [(and ext-init? (ext-module-file))
@@ -474,12 +645,7 @@
          (fold compile-toplevel-form seed body))]
       [((? =select-module?) mod)
        (write-ext-module form)
-       (match (dso-name)
-         [(name . #f)
-          (write-ext-module `(dynamic-load ,name))]
-         [(name . initfn)
-          (write-ext-module `(dynamic-load ,name :init-function ,initfn))]
-         [_ #f])
+       (write-dynamic-load (lazy-dso-loading))
        (select-tmodule mod)
        seed]
       [((? =use?) mod)
@@ -499,7 +665,16 @@
                     (cgen-cexpr exp-specs)))))
        seed]
       [((? =export-all?)) (compile-module-exports #t)]
-      [((? =export-if-defined?) . _) (write-ext-module form) seed]
+      [((? =export-if-defined?) . syms)
+       ;; With lazy DSO loading, we can't tell whether the DSO defines
+       ;; the symbols until it's loaded.  We export them anyway; the ones
+       ;; the DSO doesn't define become unbound when the autoload is
+       ;; resolved.
+       (cond [(lazy-dso-loading)
+              (write-ext-module `(export ,@syms))
+              (write-dynamic-load `',syms)]
+             [else (write-ext-module form)])
+       seed]
       [((? =provide?) arg) (write-ext-module form) seed]
       ;; Finally, ordinary expressions.
       [else
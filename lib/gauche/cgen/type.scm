@@ -234,6 +234,7 @@
    (<char-set> "ScmCharSet*" "char-set" "SCM_CHARSETP" "SCM_CHARSET")
    (<regexp> "ScmRegexp*" "regexp" "SCM_REGEXPP" "SCM_REGEXP")
    (<regmatch> "ScmRegMatch*" "regmatch" "SCM_REGMATCHP" "SCM_REGMATCH")
+   (<regexp-set> "ScmRegexpSet*" "regexp-set" "SCM_REGEXP_SET_P" "SCM_REGEXP_SET")
    (<port> "ScmPort*" "port" "SCM_PORTP" "SCM_PORT")
    (<input-port> "ScmPort*" "input port" "SCM_IPORTP" "SCM_PORT")
    (<output-port> "ScmPort*" "output port" "SCM_OPORTP" "SCM_PORT")
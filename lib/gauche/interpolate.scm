@@ -32,10 +32,19 @@
 ;;;
 
 ;; Legacy syntax:
-;;  #`"The value is ,(foo)." => (string-append "The value is " (foo) ".")
+;;  #`"The value is ,(foo)." => (%string-interpolate-concat "The value is "
+;;                                                         (foo) ".")
 ;;
 ;; New syntax:
-;;  #"The value is ~(foo)." => (string-append "The value is " (foo) ".")
+;;  #"The value is ~(foo)." => (%string-interpolate-concat "The value is "
+;;                                                        (foo) ".")
+;;
+;; %string-interpolate-concat is the same as string-append after applying
+;; x->string to each argument, but it writes strings, characters, symbols
+;; and numbers directly into a single buffer (Scm_StringInterpolateConcat
+;; in src/string.c).  display-interpolated expands into
+;; %string-interpolate-write, which writes the pieces to a port without
+;; building the whole string.
 ;;
 ;; We use 'read' to get expression after reading an unquote character
 ;; (#\, for the legacy syntax, #\~ for the new syntax.)  This presents
@@ -57,16 +66,36 @@
 ;; for free.  We don't know yet, though.
 
 (define-module gauche.interpolate
-  (export string-interpolate)
+  (export string-interpolate display-interpolated)
   )
 (select-module gauche.interpolate)
 
 (define (string-interpolate str :optional (legacy? #f))
   (if (string? str)
-    (%string-interpolate str (if legacy? #\, #\~))
+    (let1 frags (%interpolate-fragments str (if legacy? #\, #\~))
+      (cond [(null? frags) ""]
+            [(null? (cdr frags))
+             (if (string? (car frags))
+               (car frags)
+               `(x->string ,(caar frags)))]
+            [else `(%string-interpolate-concat ,@(map %fragment->arg frags))]))
     (errorf "malformed string-interpolate: ~s" (list 'string-interpolate str))))
 
-(define (%string-interpolate str unquote-char)
+;; (display-interpolated "..." [port])
+;;  Same as (display #"..." port), but writes each piece directly to port.
+(define-macro (display-interpolated str :optional (port '(current-output-port)))
+  (if (string? str)
+    `(%string-interpolate-write ,port
+                                ,@(map %fragment->arg
+                                       (%interpolate-fragments str #\~)))
+    (errorf "malformed display-interpolated: ~s"
+            (list 'display-interpolated str))))
+
+;; A fragment is either a literal string, or a list (expr) for an
+;; embedded expression.
+(define (%fragment->arg frag) (if (string? frag) frag (car frag)))
+
+(define (%interpolate-fragments str unquote-char)
   (define (accum c acc)
     (cond [(eof-object? c)
            (let1 r (get-output-string acc)
@@ -88,9 +117,6 @@
                             (errorf "unmatched parenthesis in interpolating string: ~s" str)])
                    (read))]
            [rest (accum (read-char) (open-output-string))])
-      (cons `(x->string ,item) rest)))
-  (let1 args (with-input-from-string str
-               (^[] (accum (read-char) (open-output-string))))
-    (cond [(null? args) ""]
-          [(null? (cdr args)) (car args)]
-          [else (cons 'string-append args)])))
+      (cons (list item) rest)))
+  (with-input-from-string str
+    (^[] (accum (read-char) (open-output-string)))))
@@ -42,7 +42,7 @@
   (use gauche.generator)
   (export x->lseq lunfold lmap lmap-accum lappend lappend-map lconcatenate
           linterweave lfilter lfilter-map lstate-filter
-          ltake ltake-while lrxmatch lslices))
+          ltake ltake-while lrxmatch lslices lpipeline))
 (select-module gauche.lazy)
 
 ;; Universal coercer.
@@ -58,6 +58,18 @@
              (generator->lseq g)
              (error "cannot coerce the argument to a lazy sequence" obj)))]))
 
+;; (lpipeline seq stage ...)
+;; A lazy-sequence version of gpipeline; the stages are fused into one
+;; generator that feeds the resulting lseq.
+(define-syntax lpipeline
+  (syntax-rules ()
+    [(_ seq stage ...)
+     (generator->lseq (gpipeline (%lseq->generator seq) stage ...))]))
+
+(define (%lseq->generator obj)
+  (let1 s (x->lseq obj)
+    (^[] (if (null? s) (eof-object) (pop! s)))))
+
 (define (lunfold p f g seed :optional (tail #f))
   ($ generator->lseq
      $ gunfold p f g seed (if tail (^s (list->generator (tail s))) #f)))
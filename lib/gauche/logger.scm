@@ -38,15 +38,20 @@
   (use srfi-13)
   (use gauche.fcntl)
   (use gauche.parameter)
-  (export <log-drain>
+  (export <log-drain> <async-log-drain>
           log-open
           log-format
-          log-default-drain)
+          log-default-drain
+          log-drain-flush log-drain-close log-drain-dropped-count)
   )
 (select-module gauche.logger)
 
 (autoload gauche.syslog sys-openlog sys-syslog LOG_PID LOG_INFO LOG_USER)
 (autoload file.util file-mtime<?)
+(autoload data.queue make-mtqueue mtqueue? enqueue! enqueue/wait!
+                     dequeue/wait! dequeue-all!)
+(autoload gauche.threads make-thread thread-start! thread-join!
+                         atom atom-ref atomic-update!)
 
 ;; <log-drain> class
 (define-class <log-drain> ()
@@ -241,10 +246,100 @@
                                   (list* prefix data "\n" rest)))
                               '()
                  $ string-split (apply format #f fmt args) #\newline)])
-    (with-log-output drain (^p (display str p)))))
+    (log-write drain str)))
 
-;; log-open path &keyword :program-name :prefix
+(define-method log-write ((drain <log-drain>) str)
+  (with-log-output drain (^p (display str p))))
+
+;; Asynchronous drain
+;;   Log-format on <async-log-drain> formats the message, including
+;;   the prefix, on the calling thread, and puts the string into a bounded
+;;   lock-free queue.  A background thread takes out whatever is queued
+;;   and writes them at once, opening and locking the file once
+;;   per batch.  When the queue is full, the caller waits if the
+;;   overflow policy is 'block (default), or the message is discarded
+;;   and counted if it is 'drop.
+;;   The queue also carries control messages; a queue to reply to
+;;   for log-drain-flush, and a symbol 'close for log-drain-close.
+;;   Without thread support, it works just like <log-drain>.
+
+(define-class <async-log-drain> (<log-drain>)
+  ((buffer-size :init-keyword :buffer-size :initform 1024)
+   (overflow    :init-keyword :overflow :initform 'block)
+   (queue       :initform #f)   ;lock-free mtqueue while the writer runs
+   (writer      :initform #f)   ;writer thread
+   (dropped     :initform #f))) ;atom of the count of dropped messages
+
+(define-method initialize ((self <async-log-drain>) initargs)
+  (next-method)
+  (unless (memq (slot-ref self 'overflow) '(block drop))
+    (error "overflow policy must be either block or drop, but got:"
+           (slot-ref self 'overflow)))
+  (cond-expand
+   [gauche.sys.threads
+    (slot-set! self 'dropped (atom 0))
+    (slot-set! self 'queue (make-mtqueue :max-length (slot-ref self 'buffer-size)
+                                         :lock-free #t))
+    (slot-set! self 'writer
+               (thread-start! (make-thread (^[] (async-writer self))
+                                           'log-drain)))]
+   [else]))
+
+(define (async-writer drain)
+  (define q (slot-ref drain 'queue))
+  (define (write-batch msgs)
+    (guard (e [else (report-error e)])
+      (cond [(null? msgs)]
+            [(eq? (slot-ref drain 'path) 'syslog)
+             (dolist [m msgs] (with-log-output drain (^p (display m p))))]
+            [else
+             (with-log-output drain (^p (dolist [m msgs] (display m p))))])))
+  (let loop ()
+    (let* ([xs (cons (dequeue/wait! q) (dequeue-all! q))]
+           [ctls (remove string? xs)])
+      (write-batch (filter string? xs))
+      (dolist [c ctls] (when (mtqueue? c) (enqueue! c #t)))
+      (unless (memq 'close ctls) (loop)))))
+
+(define-method log-write ((drain <async-log-drain>) str)
+  (if-let1 q (slot-ref drain 'queue)
+    (if (eq? (slot-ref drain 'overflow) 'drop)
+      (unless (enqueue/wait! q str 0 #f)
+        (atomic-update! (slot-ref drain 'dropped) (cut + <> 1)))
+      (enqueue/wait! q str))
+    (next-method)))
+
+;; Waits until the messages queued so far are written out.
+(define (log-drain-flush :optional (drain (log-default-drain)))
+  (and-let* ([ (is-a? drain <async-log-drain>) ]
+             [q (slot-ref drain 'queue)])
+    (let1 reply (make-mtqueue)
+      (enqueue/wait! q reply)
+      (dequeue/wait! reply)))
+  (undefined))
+
+;; Writes out the queued messages and stops the writer thread.
+;; Messages logged afterwards are written synchronously.
+(define (log-drain-close :optional (drain (log-default-drain)))
+  (and-let* ([ (is-a? drain <async-log-drain>) ]
+             [q (slot-ref drain 'queue)])
+    (slot-set! drain 'queue #f)
+    (enqueue/wait! q 'close)
+    (thread-join! (slot-ref drain 'writer)))
+  (undefined))
+
+(define (log-drain-dropped-count :optional (drain (log-default-drain)))
+  (if-let1 a (and (is-a? drain <async-log-drain>) (slot-ref drain 'dropped))
+    (atom-ref a)
+    0))
+
+;; log-open path &keyword :program-name :prefix :async
+;;                        :buffer-size :overflow
 
 (define (log-open path . args)
-  (log-default-drain (apply make <log-drain> :path path args)))
+  (let1 async (get-keyword :async args #f)
+    (log-drain-close (log-default-drain))
+    (log-default-drain (apply make
+                              (if async <async-log-drain> <log-drain>)
+                              :path path (delete-keyword :async args)))))
 
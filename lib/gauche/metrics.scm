@@ -0,0 +1,235 @@
+;;;
+;;; gauche/metrics.scm - runtime metrics
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; Exposes the runtime statistics of the process as metrics, and
+;; optionally serves them in Prometheus text format over HTTP.
+
+(define-module gauche.metrics
+  (use gauche.threads)
+  (use gauche.net)
+  (export runtime-metrics write-metrics-prometheus
+          <metrics-server> start-metrics-server stop-metrics-server
+          metrics-server-port)
+  )
+(select-module gauche.metrics)
+
+;; A metric is (name type help samples), where name is a symbol, type is
+;; one of gauge or counter, and samples is a list of (labels . value),
+;; labels being an alist of strings.
+
+(define (metric name type help . samples) (list name type help samples))
+
+;; Allocation rate is computed from the previous call.
+(define *alloc-mutex* (make-mutex))
+(define *last-alloc* #f)                ;(nanoseconds . total-bytes)
+
+(define (allocation-rate total)
+  (let1 now (monotonic-nanoseconds)
+    (with-locking-mutex *alloc-mutex*
+      (^[]
+        (begin0 (if-let1 last *last-alloc*
+                  (let1 dt (- now (car last))
+                    (if (> dt 0)
+                      (/. (- total (cdr last)) (/ dt 1.0e9))
+                      0))
+                  0)
+          (set! *last-alloc* (cons now total)))))))
+
+(define (gc-metrics)
+  (let ([st (gc-stat)])
+    (define (g key) (cadr (assq key st)))
+    (list
+     (metric 'gauche_gc_heap_bytes 'gauge "Size of the GC heap."
+             (cons '() (g :total-heap-size)))
+     (metric 'gauche_gc_free_bytes 'gauge "Free bytes in the GC heap."
+             (cons '() (g :free-bytes)))
+     (metric 'gauche_gc_allocated_bytes_total 'counter
+             "Total bytes allocated."
+             (cons '() (g :total-bytes)))
+     (metric 'gauche_gc_allocation_rate_bytes 'gauge
+             "Bytes allocated per second since the previous sample."
+             (cons '() (allocation-rate (g :total-bytes))))
+     (metric 'gauche_gc_collections_total 'counter "Number of collections."
+             (cons '() (g :gc-count)))
+     (metric 'gauche_gc_pauses_total 'counter "Number of GC pauses."
+             (cons '() (g :pause-count)))
+     (metric 'gauche_gc_max_pause_seconds 'gauge "Longest GC pause."
+             (cons '() (/. (g :max-pause) 1.0e6))))))
+
+(define (vm-metrics)
+  (let* ([vms ((with-module gauche.internal %vm-all-vms))]
+         [labels (map (^[vm] `(("thread" . ,(x->string (~ vm'vmid)))
+                               ("name" . ,(x->string (or (thread-name vm) "")))))
+                      vms)]
+         [stats (map vm-stats vms)])
+    (define (per-vm key)
+      (map (^[l s] (cons l (hash-table-get s key 0))) labels stats))
+    (list
+     (apply metric 'gauche_threads 'gauge "Number of threads by state."
+            (map (^[state] (cons `(("state" . ,(x->string state)))
+                                 (count (^[vm] (eq? (thread-state vm) state))
+                                        vms)))
+                 '(new runnable stopped terminated)))
+     (apply metric 'gauche_thread_state 'gauge
+            "State of each thread; the value is always 1."
+            (map (^[l vm] (cons `(,@l ("state" . ,(x->string (thread-state vm))))
+                                1))
+                 labels vms))
+     (apply metric 'gauche_vm_stack_overflows_total 'counter
+            "Number of VM stack overflows, that spill the stack to the heap."
+            (per-vm 'stack-overflows))
+     (apply metric 'gauche_vm_stack_overflow_seconds_total 'counter
+            "Time spent to handle VM stack overflows."
+            (per-vm 'stack-overflow-time))
+     (apply metric 'gauche_vm_continuation_captures_total 'counter
+            "Number of continuation captures."
+            (per-vm 'continuation-captures)))))
+
+(define (misc-metrics)
+  (let1 mws (mutex-wait-stats)
+    (list
+     (metric 'gauche_buffered_output_ports 'gauge
+             "Number of open buffered output ports."
+             (cons '() ((with-module gauche.internal
+                          %active-buffered-port-count))))
+     (metric 'gauche_mutex_waits_total 'counter
+             "Number of mutex locks that had to wait."
+             (cons '() (cadr (assq :waits mws))))
+     (metric 'gauche_mutex_wait_seconds_total 'counter
+             "Time spent waiting for mutexes."
+             (cons '() (cadr (assq :wait-time mws))))
+     (metric 'gauche_modules 'gauge "Number of modules."
+             (cons '() (length (all-modules)))))))
+
+;; API
+(define (runtime-metrics)
+  (append (gc-metrics) (vm-metrics) (misc-metrics)))
+
+;; API
+;; Writes METRICS in Prometheus text exposition format (version 0.0.4).
+(define (write-metrics-prometheus :optional (metrics (runtime-metrics))
+                                            (port (current-output-port)))
+  (define (escape s)
+    (regexp-replace-all #/[\\"\n]/ s
+                        (^m (case (string-ref (m 0) 0)
+                              [(#\newline) "\\n"]
+                              [else #"\\~(m 0)"]))))
+  (define (value->string v)
+    (cond [(exact? v) (number->string v)]
+          [(nan? v) "NaN"]
+          [(infinite? v) (if (> v 0) "+Inf" "-Inf")]
+          [else (number->string v)]))
+  (dolist [m metrics]
+    (let ([name (car m)] [type (cadr m)] [help (caddr m)])
+      (format port "# HELP ~a ~a\n# TYPE ~a ~a\n"
+              name (regexp-replace-all #/[\\\n]/ help
+                                       (^m (if (equal? (m 0) "\n") "\\n" "\\\\")))
+              name type)
+      (dolist [s (cadddr m)]
+        (display name port)
+        (unless (null? (car s))
+          (format port "{~a}"
+                  (string-join (map (^p #"~(car p)=\"~(escape (cdr p))\"")
+                                    (car s))
+                               ",")))
+        (format port " ~a\n" (value->string (cdr s)))))))
+
+;;;
+;;; HTTP listener
+;;;
+
+(define-class <metrics-server> ()
+  ((socket :init-keyword :socket)
+   (thread :init-value #f)))
+
+;; API
+(define (metrics-server-port server)
+  (sockaddr-port (socket-address (~ server'socket))))
+
+(define (serve-metrics client)
+  (let ([in (socket-input-port client)]
+        [out (socket-output-port client)])
+    (let* ([request (read-line in)]
+           [path (and (string? request)
+                      (rxmatch-case request
+                        [#/^(GET|HEAD) ([^ ?]*)/ (_ _ path) path]
+                        [else #f]))])
+      ;; skip headers
+      (let loop ()
+        (let1 line (read-line in)
+          (unless (or (eof-object? line) (equal? line "") (equal? line "\r"))
+            (loop))))
+      (if (member path '("/" "/metrics"))
+        (let1 body (with-output-to-string write-metrics-prometheus)
+          (format out "HTTP/1.0 200 OK\r\n\
+                       Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n\
+                       Content-Length: ~d\r\nConnection: close\r\n\r\n"
+                  (string-size body))
+          (unless (#/^HEAD/ request)
+            (display body out)))
+        (format out "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\
+                     Connection: close\r\n\r\n"))
+      (flush out))))
+
+;; API
+;; Starts a thread that serves the runtime metrics at /metrics on PORT.
+;; HOST is the address to listen on; #f to listen on all interfaces.
+;; PORT 0 picks an available port; see metrics-server-port.
+(define (start-metrics-server :key (port 9100) (host "127.0.0.1"))
+  (let* ([sock (if host
+                 (make-server-socket (make <sockaddr-in> :host host :port port)
+                                     :reuse-addr? #t)
+                 (make-server-socket 'inet port :reuse-addr? #t))]
+         [server (make <metrics-server> :socket sock)])
+    (set! (~ server'thread)
+          (thread-start!
+           (make-thread
+            (^[]
+              (let loop ()
+                (and-let* ([client (guard (e [else #f]) (socket-accept sock))])
+                  (guard (e [else #f]) (serve-metrics client))
+                  (socket-close client)
+                  (loop))))
+            'metrics-server)))
+    server))
+
+;; API
+(define (stop-metrics-server server)
+  (let ([sock (~ server'socket)]
+        [thread (~ server'thread)])
+    (guard (e [else #f]) (socket-shutdown sock))
+    (socket-close sock)
+    (when thread
+      (when (eq? (thread-join! thread 1 'timeout) 'timeout)
+        (thread-terminate! thread))
+      (set! (~ server'thread) #f))))
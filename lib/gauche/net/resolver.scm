@@ -0,0 +1,199 @@
+;;;
+;;; gauche.net.resolver - caching name resolver
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; getaddrinfo(3) doesn't tell us the TTL of the DNS records, so
+;; a resolver keeps each result for a fixed time (ttl), and a failure
+;; for a shorter time (negative-ttl).
+;;
+;; An asynchronous lookup runs getaddrinfo in its own thread.  Lookups
+;; of the same name in flight are merged into one.  If a selector is
+;; given, the callback is queued and run by selector-select in the
+;; selector's thread; the worker wakes up the selector by a pipe.
+
+(define-module gauche.net.resolver
+  (use gauche.net)
+  (use gauche.threads)
+  (use gauche.selector)
+  (use data.queue)
+  (use util.match)
+  (export <resolver> make-resolver current-resolver
+          resolver-lookup resolver-lookup-async resolver-connect
+          resolver-flush!))
+(select-module gauche.net.resolver)
+
+(define-class <resolver> ()
+  ((ttl          :init-keyword :ttl          :init-value 60)
+   (negative-ttl :init-keyword :negative-ttl :init-value 5)
+   (max-entries  :init-keyword :max-entries  :init-value 1024)
+   (mutex        :init-form (make-mutex))
+   ;; (host port proto) -> (expiration-time . result), where result
+   ;; is a list of <sockaddr>s or a condition.
+   (cache        :init-form (make-hash-table 'equal?))
+   ;; (host port proto) -> list of (proc . channel) waiting for it
+   (pending      :init-form (make-hash-table 'equal?))
+   ;; (selector . channel)
+   (channels     :init-value '())))
+
+;; A channel delivers results to callbacks in a selector's thread.
+(define-class <channel> ()
+  ((queue :init-form (make-mtqueue))
+   (in    :init-keyword :in)
+   (out   :init-keyword :out)))
+
+;; API
+(define (make-resolver . args) (apply make <resolver> args))
+
+;; API
+(define current-resolver (make-parameter (make-resolver)))
+
+(define (now) (time->seconds (current-time)))
+
+(define (resolve key)
+  (guard (e [(<error> e) e])
+    (apply make-sockaddrs key)))
+
+;; The following two must be called with the mutex locked.
+(define (cache-ref resolver key)
+  (and-let1 e (hash-table-get (~ resolver'cache) key #f)
+    (if (< (car e) (now))
+      (begin (hash-table-delete! (~ resolver'cache) key) #f)
+      (cdr e))))
+
+(define (cache-put! resolver key result)
+  (let ([ttl (if (condition? result)
+               (~ resolver'negative-ttl)
+               (~ resolver'ttl))]
+        [tab (~ resolver'cache)])
+    (when (> ttl 0)
+      (when (>= (hash-table-num-entries tab) (~ resolver'max-entries))
+        (let1 t (now)
+          (dolist [k (hash-table-keys tab)]
+            (when (< (car (hash-table-get tab k)) t)
+              (hash-table-delete! tab k))))
+        (when (>= (hash-table-num-entries tab) (~ resolver'max-entries))
+          (hash-table-clear! tab)))
+      (hash-table-put! tab key (cons (+ (now) ttl) result)))))
+
+(define (with-resolver-lock resolver thunk)
+  (with-locking-mutex (~ resolver'mutex) thunk))
+
+(define (result->value result)
+  (if (condition? result) (raise result) result))
+
+;; API
+;;  Returns a list of <sockaddr>s, as make-sockaddrs.
+(define (resolver-lookup resolver host port :optional (proto 'tcp))
+  (define key (list host port proto))
+  (result->value
+   (or (with-resolver-lock resolver (cut cache-ref resolver key))
+       (rlet1 result (resolve key)
+         (with-resolver-lock resolver (cut cache-put! resolver key result))))))
+
+;; API
+;;  PROC is called with a list of <sockaddr>s, or a condition if the
+;;  lookup failed.  Without SELECTOR, PROC is called in an arbitrary
+;;  thread, possibly before this procedure returns.
+(define (resolver-lookup-async resolver host port proc
+                               :key (proto 'tcp) (selector #f))
+  (define key (list host port proto))
+  (define waiter (cons proc (and selector (selector-channel resolver selector))))
+  (match (with-resolver-lock resolver
+           (^[]
+             (cond [(cache-ref resolver key) => (cut cons 'hit <>)]
+                   [(hash-table-get (~ resolver'pending) key #f)
+                    => (^[ws] (hash-table-put! (~ resolver'pending) key
+                                               (cons waiter ws))
+                         '(wait))]
+                   [else (hash-table-put! (~ resolver'pending) key
+                                          (list waiter))
+                         '(start)])))
+    [('hit . result) (notify waiter result)]
+    [('wait) #f]
+    [('start) (run-async (^[] (lookup-done resolver key (resolve key))))])
+  (undefined))
+
+(define (lookup-done resolver key result)
+  (let1 waiters (with-resolver-lock resolver
+                  (^[]
+                    (cache-put! resolver key result)
+                    (begin0 (hash-table-get (~ resolver'pending) key '())
+                      (hash-table-delete! (~ resolver'pending) key))))
+    (dolist [w (reverse waiters)] (notify w result))))
+
+(define (run-async thunk)
+  (cond-expand
+   [gauche.sys.threads (thread-start! (make-thread thunk))]
+   [else (thunk)]))
+
+(define (notify waiter result)
+  (match waiter
+    [(proc . #f) (proc result)]
+    [(proc . ch)
+     (enqueue! (~ ch'queue) (cons proc result))
+     (write-byte 0 (~ ch'out))]))
+
+(define (selector-channel resolver selector)
+  (with-resolver-lock resolver
+    (^[]
+      (or (assq-ref (~ resolver'channels) selector)
+          (receive (in out) (sys-pipe :buffering :none)
+            (rlet1 ch (make <channel> :in in :out out)
+              (selector-add! selector in
+                             (^[port flag]
+                               (read-byte port)
+                               (dolist [p (dequeue-all! (~ ch'queue))]
+                                 ((car p) (cdr p))))
+                             '(r))
+              (push! (~ resolver'channels) (cons selector ch))))))))
+
+;; API
+;;  Connects to one of the addresses of HOST.  If none of them accepts
+;;  the connection, the cached addresses are dropped.
+(define (resolver-connect resolver host port)
+  (let1 err #f
+    (define (try-connect addr)
+      (guard (e [else (set! err e) #f])
+        (make-client-socket addr)))
+    (or (any try-connect (resolver-lookup resolver host port 'tcp))
+        (begin (resolver-flush! resolver host)
+               (raise err)))))
+
+;; API
+(define (resolver-flush! resolver :optional (host #f))
+  (with-resolver-lock resolver
+    (^[]
+      (if host
+        (dolist [k (hash-table-keys (~ resolver'cache))]
+          (when (equal? (car k) host)
+            (hash-table-delete! (~ resolver'cache) k)))
+        (hash-table-clear! (~ resolver'cache))))))
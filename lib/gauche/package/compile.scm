@@ -89,7 +89,42 @@
                       (or cppflags "") (or cflags "")))))))
 
 (define (do-compile cc cfile ofile cppflags cflags)
-  (run #"~cc -c ~cppflags ~(INCDIR) ~cflags ~CFLAGS -o '~ofile' '~cfile'"))
+  (run (compile-command cc cfile ofile cppflags cflags)))
+
+(define (compile-command cc cfile ofile cppflags cflags)
+  #"~cc -c ~cppflags ~(INCDIR) ~cflags ~CFLAGS -o '~ofile' '~cfile'")
+
+;; Compile the sources that need to be rebuilt, running up to JOBS
+;; compilers concurrently.  The C files from stubs are generated
+;; beforehand and removed afterwards.
+(define (compile-parallel files jobs :key (cppflags #f)
+                                         (cflags #f)
+                                         (cc #f)
+                                         (gauche-builddir #f)
+                                    :allow-other-keys)
+  (parameterize ([in-place-dir gauche-builddir])
+    (let* ([srcs (filter (^[src]
+                           (and (not (equal? (path-extension src) OBJEXT))
+                                (let1 ofile (sys-basename
+                                             (path-swap-extension src OBJEXT))
+                                  (not (and (file-exists? ofile)
+                                            (file-mtime>? ofile src))))))
+                         files)]
+           [stubs (filter (^f (equal? (path-extension f) "stub")) srcs)]
+           [cfiles (map (^f (if (member f stubs) (path-swap-extension f "c") f))
+                        srcs)])
+      (unwind-protect
+          (begin
+            (for-each cgen-genstub stubs)
+            (run-parallel
+             (map (^[src cfile]
+                    (compile-command (or cc CC) cfile
+                                     (sys-basename
+                                      (path-swap-extension src OBJEXT))
+                                     (or cppflags "") (or cflags "")))
+                  srcs cfiles)
+             :jobs jobs))
+        (for-each (^f (sys-unlink (path-swap-extension f "c"))) stubs)))))
 
 (define (gauche-package-link sofile ofiles :key (ldflags #f)
                                                 (libs #f)
@@ -110,12 +145,16 @@
         (run #"~(or ld CC) ~(or ldflags \"\") ~(LIBDIR) ~LDFLAGS ~sofile ~all-ofiles ~LIBS ~(or libs \"\")")))))
 
 (define (gauche-package-compile-and-link module-name files . args)
-  (let1 sofile (or (get-keyword :output args #f)
-                   #"~|module-name|.~|SOEXT|")
+  (let ([sofile (or (get-keyword :output args #f)
+                    #"~|module-name|.~|SOEXT|")]
+        [jobs (get-keyword :jobs args 1)]
+        [args (delete-keyword :jobs args)])
     (parameterize ([dry-run (get-keyword :dry-run args #f)]
                    [verbose-run (get-keyword :verbose args #f)])
       (guard (e [else (sys-unlink sofile)
                       (raise e)])
+        (when (and (> jobs 1) (not (dry-run)))
+          (apply compile-parallel files jobs args))
         (let1 objs (map (lambda (src)
                           (cond
                            [(equal? (path-extension src) OBJEXT) src]
@@ -41,22 +41,25 @@
   (use file.util)
   (use srfi-13)
   (use srfi-14)
-  (export run dry-run verbose-run get-password
+  (export run run-parallel dry-run verbose-run get-password
           find-package-name-and-version))
 (select-module gauche.package.util)
 
 (define dry-run     (make-parameter #f))
 (define verbose-run (make-parameter #f))
 
+(define (spawn cmdline input)
+  (run-process (cond-expand
+                [gauche.os.windows (win-break-cmdargs cmdline)]
+                [else `("/bin/sh" "-c" ,cmdline)])
+               :input input
+               :wait #f))
+
 (define (run cmdline :key (stdin-string #f))
   (when (or (dry-run) (verbose-run))
     (print cmdline))
   (unless (dry-run)
-    (let1 p (run-process (cond-expand
-                          [gauche.os.windows (win-break-cmdargs cmdline)]
-                          [else `("/bin/sh" "-c" ,cmdline)])
-                         :input (if stdin-string :pipe :null)
-                         :wait #f)
+    (let1 p (spawn cmdline (if stdin-string :pipe :null))
       (when stdin-string
         (let1 pi (process-input p)
           (display stdin-string pi)
@@ -66,6 +69,28 @@
       (unless (zero? (process-exit-status p))
         (errorf "command execution failed: ~a" cmdline)))))
 
+;; Run CMDLINES, up to JOBS of them at a time.  Once a command fails,
+;; no more commands are started; we wait for the running ones and
+;; then raise an error.
+(define (run-parallel cmdlines :key (jobs 1))
+  (if (or (<= jobs 1) (dry-run))
+    (for-each run cmdlines)
+    (let loop ([cmds cmdlines] [running '()] [failed #f])
+      (cond
+       [(and (pair? cmds) (not failed) (< (length running) jobs))
+        (when (verbose-run) (print (car cmds)))
+        (loop (cdr cmds) (acons (spawn (car cmds) :null) (car cmds) running)
+              failed)]
+       [(pair? running)
+        (let* ([p (process-wait-any)]
+               [e (assq p running)])
+          (if e
+            (loop cmds (delete e running eq?)
+                  (or failed
+                      (and (not (zero? (process-exit-status p))) (cdr e))))
+            (loop cmds running failed)))]
+       [failed (errorf "command execution failed: ~a" failed)]))))
+
 ;; A kludge to parse unix-style command line to break into list of
 ;; arguments.  We pass the list to run-process, which eventually
 ;; calls sys-exec, which takes care of proper escaping for CreateProcess
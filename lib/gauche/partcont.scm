@@ -10,8 +10,9 @@
     [(reset expr ...)
      (%reset (^[] expr ...))]))
 
-(define (call/pc proc)
-  (%call/pc (^k (proc (^ args (reset (apply k args)))))))
+;; NB: %call/pc passes PROC a procedure that runs the partial continuation
+;; under a new reset, so we don't need to wrap it here.
+(define (call/pc proc) (%call/pc proc))
 
 (define-syntax shift
   (syntax-rules ()
@@ -106,10 +106,18 @@
                   (begin (write-block buf dst 0 nr)
                          (loop (+ count nr))))))))))))
 
+(define %copy-file-port (with-module gauche.internal %copy-file-port))
+
 (define (copy-port src dst :key (unit 4096) (size -1))
   (check-arg input-port? src)
   (check-arg output-port? dst)
-  (cond [(eq? unit 'byte)
+  (cond [(and (or (eq? unit 'byte) (integer? unit))
+              ;; Both are file ports; let the kernel move the data.
+              (%copy-file-port src dst
+                               (if (and (integer? size) (not (negative? size)))
+                                 size
+                                 -1)))]
+        [(eq? unit 'byte)
          (if (and (integer? size) (not (negative? size)))
            (%do-copy/limit1 (read-byte src) (write-byte data dst) size)
            (%do-copy (read-byte src) (write-byte data dst) (+ count 1)))]
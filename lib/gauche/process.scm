@@ -167,7 +167,8 @@
                        (redirects '())
                        (wait   #f) (fork   #t)
                        (host   #f)    ;remote execution
-                       (sigmask #f) (directory #f) (detached #f))
+                       (sigmask #f) (directory #f) (detached #f)
+                       (spawn #t))
     (let* ([redirs (%canon-redirects redirects input output error)]
            [argv (map x->string command)]
            [proc (make <process> :command (car argv))]
@@ -184,7 +185,8 @@
           (let1 pid (sys-fork-and-exec (car argv) argv
                                        :iomap iomap :directory dir
                                        :sigmask (%ensure-mask sigmask)
-                                       :detached detached)
+                                       :detached detached
+                                       :spawn spawn)
             (push! (ref proc 'processes) proc)
             (set!  (ref proc 'pid) pid)
             (dolist [p toclose]
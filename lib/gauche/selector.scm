@@ -34,10 +34,23 @@
 
 (define-module gauche.selector
   (use srfi-1)
-  (export <selector> selector-add! selector-delete! selector-select)
+  (export <selector> selector-add! selector-delete! selector-select
+          selector-add-signals!)
   )
 (select-module gauche.selector)
 
+;; If the system has <sys-poller>, we keep the handlers in a table
+;; indexed by file descriptors as well, and wait on them with the poller.
+;; It isn't limited by FD_SETSIZE, and dispatching costs in proportion to
+;; the number of ready descriptors instead of the registered ones.
+;; The fdsets are kept #f then.
+;;
+;; With the :edge-triggered initarg, a ready descriptor is reported once
+;; per transition; the handler must consume all available input (or fill
+;; the output until EAGAIN), or it won't be called again.  It requires
+;; a poller backend other than poll(2); selectors on systems without
+;; a poller reject it.
+
 (define-class <selector> ()
   ((rfds :init-form #f)
    (wfds :init-form #f)
@@ -45,8 +58,22 @@
    (rhandlers :init-form '())  ; list of (port-or-fd . proc)
    (whandlers :init-form '())  ; ditto
    (xhandlers :init-form '())  ; ditto
+   (poller :init-value #f)
+   (edge-triggered :init-keyword :edge-triggered :init-value #f)
+   (fdtab :init-form (make-hash-table 'eqv?)) ; fd -> ((flag port-or-fd . proc) ...)
   ))
 
+(define-method initialize ((selector <selector>) initargs)
+  (next-method)
+  (cond-expand
+   [gauche.sys.poller
+    (slot-set! selector 'poller
+               (make-sys-poller
+                :edge-triggered (slot-ref selector 'edge-triggered)))]
+   [else
+    (when (slot-ref selector 'edge-triggered)
+      (error "edge-triggered selector isn't supported on this platform"))]))
+
 (define (canon-flag flag)
   (case flag
     [(r read) 'r]
@@ -62,19 +89,62 @@
   (case flag
     [(r) 'rhandlers] [(w) 'whandlers] [(x) 'xhandlers]))
 
+(define (port-or-fd->fd port-or-fd)
+  (if (port? port-or-fd) (port-file-number port-or-fd) port-or-fd))
+
+;; Updates the poller to wait on FD for ENTRIES.
+(define (poller-set! selector fd entries)
+  (let ([poller (slot-ref selector 'poller)]
+        [tab (slot-ref selector 'fdtab)])
+    (cond-expand
+     [gauche.sys.poller
+      (if (null? entries)
+        (begin (hash-table-delete! tab fd)
+               (sys-poller-set! poller fd '()))
+        (begin (hash-table-put! tab fd entries)
+               (sys-poller-set! poller fd
+                                (delete-duplicates (map car entries)))))]
+     [else #f])))
+
+(define (poller-add! selector port-or-fd proc flag)
+  (and-let* ([fd (port-or-fd->fd port-or-fd)])
+    (poller-set! selector fd
+                 (cons (list* flag port-or-fd proc)
+                       (remove (^e (and (eq? (car e) flag)
+                                        (eqv? (cadr e) port-or-fd)))
+                               (hash-table-get (slot-ref selector 'fdtab)
+                                               fd '()))))))
+
+(define (poller-delete! selector port-or-fd proc flags)
+  (define tab (slot-ref selector 'fdtab))
+  (define (drop! fd)
+    (poller-set! selector fd
+                 (remove (^e (and (memq (car e) flags)
+                                  (or (not port-or-fd)
+                                      (eqv? (cadr e) port-or-fd))
+                                  (or (not proc) (eq? (cddr e) proc))))
+                         (hash-table-get tab fd '()))))
+  (if port-or-fd
+    (and-let* ([fd (port-or-fd->fd port-or-fd)]) (drop! fd))
+    (for-each drop! (hash-table-keys tab))))
+
 (define-method selector-add! ((selector <selector>) port-or-fd proc flags)
   (check-arg procedure? proc)
   (check-arg list? flags)
   (dolist [flag (map canon-flag flags)]
-    (let* ([slot (flag->fd-slot flag)]
-           [fds (or (slot-ref selector slot)
-                    (rlet1 f (make <sys-fdset>)
-                      (slot-set! selector slot f)))])
-      (set! (sys-fdset-ref fds port-or-fd) #t))
+    (if (slot-ref selector 'poller)
+      (poller-add! selector port-or-fd proc flag)
+      (let* ([slot (flag->fd-slot flag)]
+             [fds (or (slot-ref selector slot)
+                      (rlet1 f (make <sys-fdset>)
+                        (slot-set! selector slot f)))])
+        (set! (sys-fdset-ref fds port-or-fd) #t)))
     (slot-push! selector (flag->handler-slot flag) (cons port-or-fd proc))))
 
 (define-method selector-delete! ((selector <selector>) port-or-fd proc flags)
   (let1 flags (if flags (map canon-flag flags) '(r w x))
+    (when (slot-ref selector 'poller)
+      (poller-delete! selector port-or-fd proc flags))
     (for-each (^[fds handlers]
                 (cond
                  [port-or-fd
@@ -101,8 +171,21 @@
               (map flag->fd-slot flags)
               (map flag->handler-slot flags))))
 
+;; Delivers SIGNALS through a signal fd watched by SELECTOR; PROC is
+;; called with each signal number.  Returns the fd, which can be passed
+;; to selector-delete! and sys-close-signal-fd.
+(define (selector-add-signals! selector signals proc)
+  (rlet1 fd (sys-signal-fd signals)
+    (selector-add! selector fd
+                   (^[fd flag] (for-each proc (sys-read-signal-fd fd)))
+                   '(r))))
+
 (define-method selector-select ((selector <selector>) :optional (timeout #f))
+  (if (slot-ref selector 'poller)
+    (poller-select selector timeout)
+    (fdset-select selector timeout)))
 
+(define (fdset-select selector timeout)
   (define (pick-handlers fds handlers flag)
     (fold (^[entry tail]
             (let1 fd (car entry)
@@ -124,3 +207,22 @@
                  (pick-handlers wfds (slot-ref selector 'whandlers) 'w)
                  (pick-handlers xfds (slot-ref selector 'xhandlers) 'x))))
     nfds))
+
+(define (poller-select selector timeout)
+  (cond-expand
+   [gauche.sys.poller
+    (let* ([tab (slot-ref selector 'fdtab)]
+           [ready (sys-poller-wait (slot-ref selector 'poller) timeout)])
+      ;; NB: A port may have been closed and its descriptor reused since
+      ;; it's registered; we skip the entry if the descriptor doesn't
+      ;; match any longer.
+      (for-each (^h (apply (car h) (cdr h)))
+                (append-map
+                 (^[r] (filter-map
+                        (^e (and (memq (car e) (cdr r))
+                                 (eqv? (port-or-fd->fd (cadr e)) (car r))
+                                 (list (cddr e) (cadr e) (car e))))
+                        (hash-table-get tab (car r) '())))
+                 ready))
+      (length ready))]
+   [else 0]))
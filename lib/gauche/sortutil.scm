@@ -4,7 +4,8 @@
 ;;; sorted?, merge, merge!, sort, sort!, stable-sort and stable-sort!
 ;;; are written by Richard A. O'Keefe (based on Prolog code by D.H.D.Warren).
 ;;; See sort.orig.scm for the original public domain code, with long
-;;; explanatory comments.
+;;; explanatory comments.  Lists and vectors are now sorted by the C
+;;; routines (src/compare.c) instead of O'Keefe's merge sort.
 ;;;
 ;;; sort-by family is addition by SK.
 ;;;
@@ -23,6 +24,8 @@
 (autoload gauche.generic-sortutil
           %generic-sorted? %generic-sort %generic-sort!)
 
+(autoload gauche.uvector uvector-sort uvector-sort!)
+
 (define %sort  (with-module gauche.internal %sort))
 (define %sort! (with-module gauche.internal %sort!))
 
@@ -36,6 +39,24 @@
              [else (errorf "~a requires a comparator or a procedure that \
                             takes two-arguments, but got: ~s" this cmp)]))]))
 
+;; The C routines compare elements by themselves if we sort in the
+;; default order; returns #f in that case.  If CMP is a comparator whose
+;; order is the same as 'compare' (e.g. string-comparator), we pass the
+;; comparator itself; the C routine type-checks the elements once and
+;; compares them natively.  Otherwise returns LESS?.
+;; NB: This file may be loaded by an older gosh during build, which
+;; lacks %comparator-native-compare?.
+(define native-compare?
+  (if (global-variable-bound? (find-module 'gauche.internal)
+                              '%comparator-native-compare?)
+    (with-module gauche.internal %comparator-native-compare?)
+    (^_ #f)))
+
+(define (native-less cmp less?)
+  (cond [(or (not cmp) (eq? cmp default-comparator)) #f]
+        [(and (comparator? cmp) (native-compare? cmp)) cmp]
+        [else less?]))
+
 ;;; (sorted? sequence :optional less? key)
 
 (define (sorted? seq :optional (cmp #f) (key identity))
@@ -132,10 +153,10 @@
                a)))]))
 
 ;;; (sort! sequence :optional less? key)
-;;; sorts the list or vector sequence destructively.  It uses a version
-;;; of merge-sort invented, to the best of my knowledge, by David H. D.
-;;; Warren, and first used in the DEC-10 Prolog system.  R. A. O'Keefe
-;;; adapted it to work destructively in Scheme.
+;;; sorts the list or vector sequence destructively.  Lists and vectors
+;;; are sorted by the C routines in libcmp.scm; pattern-defeating
+;;; quicksort if neither less? nor key is given, TimSort otherwise.
+;;; Uvectors in the default order are radix-sorted by gauche.uvector.
 
 (define (sort! seq . args)
   (if (and (or (pair? seq) (vector? seq)) (null? args))
@@ -145,37 +166,13 @@
 (define (stable-sort! seq :optional (cmp #f) (key identity))
   (define-less? less? cmp 'sort!)
   (if (memq key `(,identity ,values))
-    (letrec ([step (^n (cond [(> n 2) (let* ([j (ash n -1)]
-                                             [a (step j)]
-                                             [k (- n j)]
-                                             [b (step k)])
-                                        (merge! a b less?))]
-                             [(= n 2) (let ([x (car seq)]
-                                            [y (cadr seq)]
-                                            [p seq])
-                                        (set! seq (cddr seq))
-                                        (when (less? y x)
-                                          (set-car! p y)
-                                          (set-car! (cdr p) x))
-                                        (set-cdr! (cdr p) '())
-                                        p)]
-                             [(= n 1) (let ([p seq])
-                                        (set! seq (cdr seq))
-                                        (set-cdr! p '())
-                                        p)]
-                             [else '()]))])
-      (cond [(null? seq) seq]
-            [(pair? seq) (step (length seq))]
-            [(vector? seq)
-             (let ([n (vector-length seq)]
-                   [vector seq])
-               (set! seq (vector->list seq))
-               (do ([p (step n) (cdr p)]
-                    [i 0 (+ i 1)])
-                   [(null? p) vector]
-                 (vector-set! vector i (car p))))]
-            [(is-a? seq <sequence>) (%generic-sort! seq less?)]
-            [else (error "sequence required, but got:" seq)]))
+    (cond [(null? seq) seq]
+          [(or (pair? seq) (vector? seq))
+           (%sort! seq (native-less cmp less?) #t)]
+          [(and (uvector? seq) (not (native-less cmp less?)))
+           (uvector-sort! seq) seq]
+          [(is-a? seq <sequence>) (%generic-sort! seq less?)]
+          [else (error "sequence required, but got:" seq)])
     ;; Avoid making intermediate structure, for the point of stable-sort!
     ;; is to avoid allocation.
     (letrec ([kless? (^[a b] (less? (cdr a) (cdr b)))])
@@ -216,8 +213,10 @@
   (define-less? less? cmp 'sort)
   (if (memq key `(,identity ,values))
     (cond [(null? seq) seq]
-          [(pair? seq) (stable-sort! (list-copy seq) less?)]
-          [(vector? seq) (list->vector (sort! (vector->list seq) less?))]
+          [(or (pair? seq) (vector? seq))
+           (%sort seq (native-less cmp less?) #t)]
+          [(and (uvector? seq) (not (native-less cmp less?)))
+           (uvector-sort seq)]
           [(is-a? seq <sequence>) (%generic-sort seq less?)]
           [else (error "sequence required, but got:" seq)])
     (cond [(null? seq) seq]
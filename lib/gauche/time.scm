@@ -37,6 +37,9 @@
   (use gauche.record)
   (use util.match)
   (export time time-this time-these report-time-results time-these/report
+          time-nanoseconds
+          run-benchmark-suite write-benchmark-results read-benchmark-results
+          compare-benchmark-results report-benchmark-comparison
           <time-result> time-result+ time-result-
           <time-counter> <real-time-counter> <user-time-counter>
           <system-time-counter> <process-time-counter>
@@ -63,12 +66,11 @@
      (begin
        (gc)
        (let*-values ([(stimes) (sys-times)]
-                     [(sreal-sec sreal-msec) (sys-gettimeofday)]
+                     [(sreal) (monotonic-nanoseconds)]
                      [r (begin expr . exprs)]
-                     [(etimes) (sys-times)]
-                     [(ereal-sec ereal-msec) (sys-gettimeofday)])
-         (let ([real (- (+ ereal-sec (/. ereal-msec 1000000))
-                        (+ sreal-sec (/. sreal-msec 1000000)))]
+                     [(ereal) (monotonic-nanoseconds)]
+                     [(etimes) (sys-times)])
+         (let ([real (/. (- ereal sreal) 1e9)]
                [user (/. (- (list-ref etimes 0) (list-ref stimes 0))
                          (list-ref stimes 4))]
                [sys  (/. (- (list-ref etimes 1) (list-ref stimes 1))
@@ -90,6 +92,16 @@
     [(_)
      (syntax-error "usage: (time expr expr2 ...); or you meant sys-time?")]))
 
+;; Elapsed nanoseconds of evaluating EXPRs, by the monotonic clock.
+;; Nothing is allocated for timing on 64-bit platforms, so it can be
+;; left in latency-sensitive code.
+(define-syntax time-nanoseconds
+  (syntax-rules ()
+    [(_ expr . exprs)
+     (let1 start (monotonic-nanoseconds)
+       (begin expr . exprs)
+       (- (monotonic-nanoseconds) start))]))
+
 ;; Benchmarking ---------------------------------------
 
 (define-record-type <time-result> make-time-result time-result?
@@ -231,6 +243,106 @@
     [((? integer?) . (? valid-alist? alist))     (show)]
     [(('cpu (? real?)) . (? valid-alist? alist)) (show)]
     [else (error "the argument doesn't seem like a time-these result:" result)]))
+;; Benchmark suites ---------------------------------
+
+;; A suite is the same alist as time-these takes.  run-benchmark-suite
+;; runs it with progress on PROGRESS port (#f to be quiet) and returns
+;; the result in the same format as time-these.  If ONLY is given, it
+;; is a predicate on keys to select samples.
+(define (run-benchmark-suite config samples :key (only #f)
+                             (progress (current-error-port)))
+  (cons config
+        (filter-map (^s (and (or (not only) (only (car s)))
+                             (begin
+                               (when progress
+                                 (format progress "~a..." (car s))
+                                 (flush progress))
+                               (rlet1 r (cons (car s)
+                                              (time-this config (cdr s)))
+                                 (when progress
+                                   (format progress " ~a/s\n"
+                                           (%format-ratio (%rate (cdr r)) 2)))))))
+                    samples)))
+
+(define (%rate tr)
+  (let1 cpu (+ (time-result-user tr) (time-result-sys tr))
+    (if (zero? cpu) +inf.0 (/. (time-result-count tr) cpu))))
+
+;; Rates and ratios can be infinite if the cpu time is too small to count.
+(define (%format-ratio val digs)
+  (if (finite? val) (format-flonum val 0 digs) (x->string val)))
+
+;; Machine-readable form of a result of time-these or run-benchmark-suite.
+;; We write an S-expression so that the baseline can be read back with
+;; 'read', and other tools can parse it easily.
+;;   (benchmark-results (version <string>) (platform <string>)
+;;                      (timestamp <integer>) (config <config>)
+;;                      (results (<key> (count <n>) (real <x>) (user <x>)
+;;                                      (sys <x>) (rate <x>)) ...))
+(define (write-benchmark-results result :optional (port (current-output-port)))
+  (match-let1 (config . alist) result
+    (format port "(benchmark-results\n (version ~s)\n (platform ~s)\n"
+            (gauche-version) (gauche-architecture))
+    (format port " (timestamp ~s)\n (config ~s)\n (results" (sys-time) config)
+    (dolist [s alist]
+      (let1 t (cdr s)
+        (format port "\n  (~s (count ~s) (real ~s) (user ~s) (sys ~s) (rate ~s))"
+                (car s) (time-result-count t) (time-result-real t)
+                (time-result-user t) (time-result-sys t) (%rate t))))
+    (format port "))\n")))
+
+;; Reads back what write-benchmark-results wrote.  Returns the result
+;; in the same format as time-these.
+(define (read-benchmark-results :optional (port (current-input-port)))
+  (match (read port)
+    [('benchmark-results . props)
+     (let ([config  (cond [(assq 'config props) => cadr] [else #f])]
+           [results (cond [(assq 'results props) => cdr] [else '()])])
+       (define (get key r) (cond [(assq key r) => cadr] [else 0]))
+       (cons config
+             (map (^r (cons (car r)
+                            (make-time-result (get 'count (cdr r))
+                                              (get 'real (cdr r))
+                                              (get 'user (cdr r))
+                                              (get 'sys (cdr r)))))
+                  results)))]
+    [x (error "malformed benchmark results:" x)]))
+
+;; Compare CURRENT against BASELINE, both in the format of time-these.
+;; Returns a list of (key status ratio), where ratio is current rate
+;; divided by the baseline rate, and status is one of regressed, improved
+;; or same according to TOLERANCE; or (key new #f) / (key missing #f)
+;; for samples only in one of them.
+(define (compare-benchmark-results baseline current :key (tolerance 0.1))
+  (define (status ratio)
+    (cond [(< ratio (- 1 tolerance)) 'regressed]
+          [(> ratio (+ 1 tolerance)) 'improved]
+          [else 'same]))
+  (let ([base (cdr baseline)]
+        [curr (cdr current)])
+    (append
+     (map (^s (if-let1 b (assoc (car s) base)
+                (let1 ratio (/ (%rate (cdr s)) (%rate (cdr b)))
+                  (list (car s) (status ratio) ratio))
+                (list (car s) 'new #f)))
+          curr)
+     (filter-map (^b (and (not (assoc (car b) curr))
+                          (list (car b) 'missing #f)))
+                 base))))
+
+;; Show the result of compare-benchmark-results.  Returns the number of
+;; regressed samples, so that the caller can use it for exit status.
+(define (report-benchmark-comparison comparison
+                                     :optional (port (current-output-port)))
+  (let1 kw (apply max 0 (map (^c (string-length (x->string (car c))))
+                             comparison))
+    (dolist [c comparison]
+      (match-let1 (key status ratio) c
+        (format port "  ~v@a: ~a~a\n" kw key
+                (if ratio (format "~6@a " (%format-ratio ratio 3)) "")
+                status)))
+    (count (^c (eq? (cadr c) 'regressed)) comparison)))
+
 ;; Timers ---------------------------------------------
 
 (define-class <time-counter> ()
@@ -297,13 +409,10 @@
   ())
 
 (define-method time-counter-get-current-time ((self <real-time-counter>))
-  (receive r (sys-gettimeofday) r))
+  (monotonic-nanoseconds))
 
 (define-method time-counter-get-delta ((self <real-time-counter>))
-  (receive (sec usec) (sys-gettimeofday)
-    (+ (- sec (car (slot-ref self 'start)))
-       (/. (- usec (cadr (slot-ref self 'start)))
-           1000000))))
+  (/. (- (monotonic-nanoseconds) (slot-ref self 'start)) 1e9))
 
 ;; 'user' time counter
 (define-class <user-time-counter> (<time-counter>)
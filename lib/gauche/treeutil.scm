@@ -32,7 +32,7 @@
 ;;;
 
 (define-module gauche.treeutil
-  (export make-tree-map tree-map-empty?
+  (export make-tree-map make-tree-map/btree tree-map-empty?
           tree-map-min tree-map-max tree-map-pop-min! tree-map-pop-max!
           tree-map-fold tree-map-fold-right
           tree-map-map tree-map-for-each
@@ -41,17 +41,24 @@
   )
 (select-module gauche.treeutil)
 
-(define make-tree-map
+(define %tree-map-comparator
   (case-lambda
-    [() (%make-tree-map default-comparator)]
+    [() default-comparator]
     [(cmp)
      (if (comparator? cmp)
        (begin
          (unless (comparator-ordered? cmp)
            (error "make-tree-map needs an ordered comparator, but got:" cmp))
-         (%make-tree-map cmp))
-       (%make-tree-map (make-comparator/compare #t #t cmp #f)))]
-    [(=? <?) (%make-tree-map (make-comparator #t =? <? #f))]))
+         cmp)
+       (make-comparator/compare #t #t cmp #f))]
+    [(=? <?) (make-comparator #t =? <? #f)]))
+
+(define (make-tree-map . args)
+  (%make-tree-map (apply %tree-map-comparator args)))
+
+;; Same as make-tree-map, but uses B+-tree instead of red-black tree.
+(define (make-tree-map/btree . args)
+  (%make-tree-map (apply %tree-map-comparator args) 'btree))
 
 (define (tree-map-empty? tm) (zero? (tree-map-num-entries tm)))
 
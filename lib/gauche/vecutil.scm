@@ -59,11 +59,32 @@
 (define-inline (%vector-update! vec len proc)
   (dotimes [i len] (vector-set! vec i (proc i))))
 
+;; Single-vector cases are handled by C kernels in libvec.scm.
+;; NB: This file may be loaded by an older gosh during build, which
+;; lacks them.
+(define-syntax define-vector-kernel
+  (syntax-rules ()
+    [(_ name fallback)
+     (define name
+       (if (global-variable-bound? (find-module 'gauche.internal) 'name)
+         (global-variable-ref (find-module 'gauche.internal) 'name)
+         fallback))]))
+
+(define-vector-kernel %vector-map1
+  (^[proc vec]
+    (vector-tabulate (vector-length vec) (^i (proc (vector-ref vec i))))))
+(define-vector-kernel %vector-map1!
+  (^[proc vec]
+    (%vector-update! vec (vector-length vec) (^i (proc (vector-ref vec i))))))
+(define-vector-kernel %vector-for-each1
+  (^[proc vec]
+    (dotimes [i (vector-length vec)] (proc (vector-ref vec i)))))
+
 ;; R7RS vector-map
 (define (vector-map proc vec . more)
   (check-arg vector? vec)
   (if (null? more)
-    (vector-tabulate (vector-length vec) (^i (proc (vector-ref vec i))))
+    (%vector-map1 proc vec)
     (let1 vecs (cons vec more)
       (vector-tabulate (apply min (map vector-length vecs))
                        (^i (apply proc (map (^v (vector-ref v i)) vecs)))))))
@@ -71,7 +92,7 @@
 (define (vector-map! proc vec . more)
   (check-arg vector? vec)
   (if (null? more)
-    (%vector-update! vec (vector-length vec) (^i (proc (vector-ref vec i))))
+    (%vector-map1! proc vec)
     (let1 vecs (cons vec more)
       (%vector-update! vec (apply min (map vector-length vecs))
                        (^i (apply proc (map (^v (vector-ref v i)) vecs)))))))
@@ -99,7 +120,7 @@
 (define (vector-for-each proc vec . more)
   (check-arg vector? vec)
   (if (null? more)
-    (dotimes [i (vector-length vec)] (proc (vector-ref vec i)))
+    (%vector-for-each1 proc vec)
     (let1 vecs (cons vec more)
       (dotimes [i (apply min (map vector-length vecs))]
         (apply proc (map (^v (vector-ref v i)) vecs))))))
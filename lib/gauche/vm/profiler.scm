@@ -34,9 +34,13 @@
 (define-module gauche.vm.profiler
   (use srfi-13)
   (use util.match)
+  (use gauche.threads)
   (extend gauche.internal)
-  (export profiler-show profiler-get-result
-          profiler-show-load-stats with-profiler)
+  (export profiler-show profiler-get-result profiler-get-stacks
+          profiler-get-thread-results profiler-get-allocation-result
+          profiler-write-folded profiler-write-pprof
+          profiler-show-load-stats with-profiler
+          lock-profiler-get-result lock-profiler-show with-lock-profiler)
   )
 (select-module gauche.vm.profiler)
 
@@ -48,11 +52,137 @@
 ;; Returns a portable representation of the current profiler result
 ;;
 (define (profiler-get-result)
-  ;; NB: this part depends on the result object of profiler-raw-result,
-  ;; which may be changed later.  Keep this in sync with src/prof.c.
-  (if-let1 r (profiler-raw-result)
-    (hash-table-map r (^(k v) (cons (entry-name k) v)))
-    #f))
+  ;; If the profiler has run on multiple threads, their results are merged.
+  (match (profiler-raw-result-all-threads)
+    [() #f]
+    [((_ r _)) (result-of r)]
+    [rs (merge-results (map (^e (result-of (cadr e))) rs))]))
+
+;;
+;; Returns allocation samples, recorded when the profiler is started
+;; with :allocation-interval.  Each entry is (<name> <calls> . <bytes>).
+;;
+(define (profiler-get-allocation-result)
+  (match (profiler-raw-result-all-threads)
+    [() #f]
+    [rs (merge-results (map (^e (alloc-result-of (cadr e) (cadddr e))) rs))]))
+
+;;
+;; Returns a list of (<thread> . <result>), where <result> is like the
+;; one returned by profiler-get-result but only for the thread.
+;;
+(define (profiler-get-thread-results)
+  (map (^e (cons (car e) (result-of (cadr e))))
+       (profiler-raw-result-all-threads)))
+
+;;
+;; Returns aggregated stack samples, recorded when the profiler is
+;; started with :stack-depth.  Each entry is (<stack> . <count>), where
+;; <stack> is a list of entry names, outermost frame first.
+;; If PER-THREAD is true, each stack begins with the name of the thread.
+;;
+(define (profiler-get-stacks :optional (per-thread #f))
+  (match (profiler-raw-result-all-threads)
+    [() #f]
+    [rs (let1 ht (make-hash-table 'equal?)
+          (dolist [e rs]
+            (let1 root (and per-thread (thread-label (car e)))
+              (dolist [s (caddr e)]
+                (let1 names (map entry-name s)
+                  (hash-table-update! ht (if root (cons root names) names)
+                                      (cut + <> 1) 0)))))
+          (hash-table->alist ht))]))
+
+;;
+;; Write stack samples in the 'folded' format, one stack per line,
+;; which can be fed to flamegraph tools.
+;; STACKS is a result of profiler-get-stacks; if omitted, the current
+;; result is used.
+;;
+(define (profiler-write-folded :optional (port (current-output-port))
+                                         (stacks #f))
+  (dolist [p (or stacks (profiler-get-stacks) '())]
+    (format port "~a ~d\n"
+            (string-join (map (^n (regexp-replace-all #/[;\n]/ (frame-label n) "_"))
+                              (car p))
+                         ";")
+            (cdr p))))
+
+;;
+;; Write stack samples in the pprof protobuf format (uncompressed).
+;; PORT should be a binary port.
+;;
+(define (profiler-write-pprof :optional (port (current-output-port))
+                                        (stacks #f))
+  (let ([strtab (make-hash-table 'equal?)]
+        [strs '()]
+        [funcs (make-hash-table 'equal?)]
+        [fns '()])                      ;[(<id> . <name-index>)]
+    (define (string-index s)
+      (or (hash-table-get strtab s #f)
+          (rlet1 i (hash-table-num-entries strtab)
+            (hash-table-put! strtab s i)
+            (push! strs s))))
+    (define (function-id name)
+      (or (hash-table-get funcs name #f)
+          (rlet1 i (+ (hash-table-num-entries funcs) 1)
+            (hash-table-put! funcs name i)
+            (push! fns (cons i (string-index (frame-label name)))))))
+    (define (value-type type unit)
+      (^o (pb-uint 1 (string-index type) o) (pb-uint 2 (string-index unit) o)))
+
+    (string-index "")                   ;index 0 must be an empty string
+    (pb-message 1 (value-type "samples" "count") port)
+    (pb-message 1 (value-type "cpu" "nanoseconds") port)
+    (dolist [p (or stacks (profiler-get-stacks) '())]
+      ;; pprof wants the leaf first
+      (let1 ids (map function-id (reverse (car p)))
+        (pb-message 2 (^o (pb-packed 1 ids o)
+                          (pb-packed 2 `(,(cdr p) ,(* (cdr p) *period-ns*)) o))
+                    port)))
+    (dolist [f (reverse fns)]
+      (pb-message 4 (^o (pb-uint 1 (car f) o)
+                        (pb-message 4 (^o (pb-uint 1 (car f) o)) o))
+                  port)
+      (pb-message 5 (^o (pb-uint 1 (car f) o)
+                        (pb-uint 2 (cdr f) o)
+                        (pb-uint 3 (cdr f) o))
+                  port))
+    (pb-message 11 (value-type "cpu" "nanoseconds") port)
+    (pb-uint 12 *period-ns* port)
+    ;; string table must be the last, for value-type may add entries.
+    (dolist [s (reverse strs)] (pb-bytes 6 s port))))
+
+;;
+;; Write a list of hot procedures, to be given to the compiler for
+;; profile-guided inlining (precomp --inline-hints, or the environment
+;; variable GAUCHE_INLINE_HINTS).  A closure bound globally and called
+;; at least MIN-CALLS times is written as (<module-name> <name> <calls>),
+;; one per line, hottest first.  The compiler decides which of them
+;; are small enough to be inlined.
+;;
+(define (profiler-write-inline-hints :optional (port (current-output-port))
+                                     :key (min-calls 1000))
+  (let ([calls (make-hash-table 'eq?)]
+        [hints '()])
+    (dolist [e (profiler-raw-result-all-threads)]
+      (hash-table-for-each
+       (cadr e)
+       (^[k v] (when (is-a? k <compiled-code>)
+                 (hash-table-update! calls k (cut + <> (car v)) 0)))))
+    (dolist [m (all-modules)]
+      (hash-table-for-each
+       (module-table m)
+       (^[name _]
+         (and-let* ([ (symbol? name) ]
+                    [v (global-variable-ref m name #f)]
+                    [ (closure? v) ]
+                    [n (hash-table-get calls (closure-code v) #f)]
+                    [ (>= n min-calls) ])
+           (push! hints (list (module-name m) name n))))))
+    (dolist [h (sort hints > caddr)]
+      (write h port)
+      (newline port))))
 
 ;;
 ;; Show the profiler result.
@@ -62,62 +192,138 @@
 ;;               If not given, the current result is used.
 ;;    :sort-by - either one of 'time, 'count, or 'time-per-call
 ;;    :max-rows - # of rows to be shown.  #f to show everything.
+;;    :allocation - if true, show the allocation samples instead of
+;;               time.  Sort-by time means bytes in this case.
 ;;
-(define (profiler-show :key (results #f) (sort-by 'time) (max-rows 50))
-  (if (not results)
+(define (profiler-show :key (results #f) (sort-by 'time) (max-rows 50)
+                            (allocation #f))
+  (cond
+   [allocation
+    (if-let1 r (if results
+                 (merge-results results)
+                 (profiler-get-allocation-result))
+      (show-alloc-stats r sort-by max-rows)
+      (print "No profiling data has been gathered."))]
+   [(not results)
     ;; use the current result
     (if-let1 r (profiler-get-result)
       (show-stats r sort-by max-rows)
-      (print "No profiling data has been gathered."))
+      (print "No profiling data has been gathered."))]
+   [else
     ;; gather all the results
-    (let1 ht (make-hash-table 'equal?)
-      ;; gather stats
-      (dolist (r results)
-        (dolist (e r)
-          (let1 p (hash-table-get ht (car e) '(0 . 0))
-            (hash-table-put! ht (car e)
-                             (cons (+ (cadr e) (car p))
-                                   (+ (cddr e) (cdr p)))))))
-      ;; show 'em.
-      (show-stats (hash-table-map ht cons) sort-by max-rows))))
+    (show-stats (merge-results results) sort-by max-rows)]))
 
 ;; *EXPERIMENTAL*
 ;; Show the load statistics.
 ;; Called from the cleanup routine of main.c.  Passed STATS is a list of
-;; accumulated load stats info; see load.c for th exact format.
-;; This routine should be in sync of it.
+;; accumulated load stats events in reverse order; see Scm__RecordLoadStat
+;; in load.c for the exact format.  This routine should be in sync of it.
+;;
+;; We show two tables.  The first one lists each loaded file with
+;; the time spent in reading, compiling, executing and initializing DSOs
+;; it dynamic-loads, as well as the bytes allocated, excluding the
+;; nested loads.  The second one shows nesting of loads, that is,
+;; which file pulled in which, with inclusive time and allocation.
 (define (profiler-show-load-stats stats)
-  (let1 results '() ; [(<filename> . <time>)]
-    (let/cc return
-      (define (start stats)
-        (match stats
-          [()  (show-results)]
-          [((f . t) . more)
-           (receive (_ rest) (cumulate f t 0 more) (start rest))]
-          [(_ . more) (start more)] ;; this can't happen, but tolerate
-          ))
-      ;; cumulate :: String, Integer, Integer, [Stat] -> Integer, [Stat]
-      (define (cumulate filename start-time exclude stats)
-        (match stats
-          [() (show-results)]  ;; premature stats data; we discard current fn.
-          [((f . t) . more)
-           (receive (time-spent rest) (cumulate f t 0 more)
-             (cumulate filename start-time (+ exclude time-spent) rest))]
-          [(t . more)
-           (set! results (cons (cons filename (- t start-time exclude)) results))
-           (values (- t start-time) more)]))
-      (define (show-results)
-        (print "Load statistics:")
-        (print "Time(us)    File")
-        (print "--------+-------------------------------------------------------------------")
-        (let1 total (fold (^[p sum]
-                            (format #t "~8d ~a\n" (cdr p) (car p))
-                            (+ sum (cdr p)))
-                          0 (sort-by results cdr >))
-          (print "--------+-------------------------------------------------------------------")
-          (format #t "~8d Total\n" total))
-        (return #f))
-      (start (reverse stats)))))
+  ;; node: (kind name start-event end-event children)
+  (define (ev-ref e k) (vector-ref e k))
+  (define (build events)
+    ;; returns list of toplevel nodes
+    (let loop ([evs events] [stack '()] [tops '()])
+      (define (close ev stack tops)
+        (match-let1 ((kind name start kids) . rest) stack
+          (let1 node (list kind name start ev (reverse kids))
+            (match rest
+              [() (values rest (cons node tops))]
+              [((k n s ks) . rest2)
+               (values (cons (list k n s (cons node ks)) rest2) tops)]))))
+      (match evs
+        [()
+         ;; premature stats; close unfinished loads at the last event.
+         (if (null? stack)
+           (reverse tops)
+           (receive (stack tops) (close (last events) stack tops)
+             (loop '() stack tops)))]
+        [(ev . more)
+         (if (eq? (ev-ref ev 0) 'end)
+           (if (null? stack)
+             (loop more stack tops)   ; can't happen, but tolerate
+             (receive (stack tops) (close ev stack tops)
+               (loop more stack tops)))
+           (loop more
+                 (cons (list (ev-ref ev 0) (ev-ref ev 1) ev '()) stack)
+                 tops))])))
+
+  (define (node-kind n) (car n))
+  (define (node-name n) (cadr n))
+  (define (node-kids n) (list-ref n 4))
+  (define (delta n k) (- (ev-ref (list-ref n 3) k) (ev-ref (list-ref n 2) k)))
+  (define (total n) (delta n 2))
+  (define (bytes n) (delta n 3))
+  (define (self n k)
+    (- (delta n k) (fold (^[c s] (+ s (delta c k))) 0 (node-kids n))))
+  (define (us ns) (quotient ns 1000))
+  (define (kb b) (quotient b 1024))
+
+  ;; Rows of the first table: (name total read compile exec dso bytes)
+  ;; DSO initialization is attributed to the file that loads it.
+  (define (rows nodes)
+    (append-map
+     (^n (let* ([dsos (filter (^c (eq? (node-kind c) 'dso)) (node-kids n))]
+                [sub (append-map node-kids dsos)]
+                [dso (fold (^[c s] (+ s (self c 2))) 0 dsos)]
+                [rd (self n 4)]
+                [cm (self n 5)]
+                [row (if (eq? (node-kind n) 'dso)
+                       (list (node-name n) (self n 2) 0 0 0 (self n 2)
+                             (self n 3))
+                       (list (node-name n) (+ (self n 2) dso) rd cm
+                             (- (self n 2) rd cm) dso
+                             (+ (self n 3)
+                                (fold (^[c s] (+ s (self c 3))) 0 dsos))))])
+           (cons row
+                 (rows (append (remove (^c (eq? (node-kind c) 'dso))
+                                       (node-kids n))
+                               sub)))))
+     nodes))
+
+  (define (show-table nodes)
+    (define rule
+      "--------+--------+--------+--------+--------+--------+-----------------------")
+    (print "Load statistics (exclusive of nested loads):")
+    (print "Time(us)    Read Compile    Exec     DSO Alloc(K) File")
+    (print rule)
+    (let1 rs (sort-by (rows nodes) cadr >)
+      (for-each (^r (match-let1 (name t rd cm ex dso b) r
+                      (format #t "~8d ~7d ~7d ~7d ~7d ~8d ~a\n"
+                              (us t) (us rd) (us cm) (us ex) (us dso) (kb b)
+                              name)))
+                rs)
+      (print rule)
+      (format #t "~8d ~7d ~7d ~7d ~7d ~8d Total\n"
+              (us (fold (^[r s] (+ s (list-ref r 1))) 0 rs))
+              (us (fold (^[r s] (+ s (list-ref r 2))) 0 rs))
+              (us (fold (^[r s] (+ s (list-ref r 3))) 0 rs))
+              (us (fold (^[r s] (+ s (list-ref r 4))) 0 rs))
+              (us (fold (^[r s] (+ s (list-ref r 5))) 0 rs))
+              (kb (fold (^[r s] (+ s (list-ref r 6))) 0 rs)))))
+
+  (define (show-tree nodes)
+    (print "Load tree (inclusive):")
+    (print "Time(us) Alloc(K) File")
+    (let walk ([nodes nodes] [depth 0])
+      (dolist [n nodes]
+        (format #t "~8d ~8d ~a~a~a\n" (us (total n)) (kb (bytes n))
+                (make-string (* depth 2) #\space)
+                (if (eq? (node-kind n) 'dso) "[dso] " "")
+                (node-name n))
+        (walk (node-kids n) (+ depth 1)))))
+
+  (let1 nodes (build (reverse stats))
+    (unless (null? nodes)
+      (show-table nodes)
+      (newline)
+      (show-tree nodes))))
 
 ;; Convenience API
 (define (with-profiler thunk)
@@ -129,6 +335,69 @@
     (profiler-reset)
     (apply values vals)))
 
+;;
+;; Lock contention profiler
+;;
+
+;; Returns a list of
+;;   (<lock> <site> <acquired> <contended> <wait-time> <max-wait>
+;;    <hold-time> <max-hold> <max-waiters>)
+;; for each pair of a lock (a mutex or a port) and a site, that is,
+;; the procedure that acquired it.  Times are in seconds.  Sorted by
+;; the total wait time, longest first.
+(define (lock-profiler-get-result)
+  (define (sec ns) (/. ns 1e9))
+  (sort (map (match-lambda
+               [(lock site acq cont wait max-wait hold max-hold waiters)
+                (list lock (and site (entry-name site))
+                      acq cont (sec wait) (sec max-wait)
+                      (sec hold) (sec max-hold) waiters)])
+             (lock-profiler-raw-result))
+        > (cut list-ref <> 4)))
+
+;; Shows the locks that contended most.
+;;  :sort-by - one of 'wait (total wait time), 'contended (# of
+;;             contended acquisitions), 'max-wait or 'hold
+;;  :max-rows - # of rows to be shown.  #f to show everything.
+(define (lock-profiler-show :key (sort-by 'wait) (max-rows 20))
+  (define key
+    (case sort-by
+      [(wait) (cut list-ref <> 4)]
+      [(contended) (cut list-ref <> 3)]
+      [(max-wait) (cut list-ref <> 5)]
+      [(hold) (cut list-ref <> 6)]
+      [else (error "lock-profiler-show: sort-by argument must be either one of wait, contended, max-wait or hold, but got:" sort-by)]))
+  (define (ms sec)
+    (receive (q r) (quotient&remainder (round->exact (* sec 1e6)) 1000)
+      (format "~d.~3,'0d" q r)))
+  (define (label obj width)
+    (let1 s (if (string? obj) obj (write-to-string obj))
+      (if (> (string-length s) width) (string-take s width) s)))
+  (let1 r (filter (^e (> (list-ref e 3) 0)) (lock-profiler-get-result))
+    (if (null? r)
+      (print "No lock contention has been recorded.")
+      (begin
+        (print "Lock contention statistics (times in ms)")
+        (format #t "~25a ~29a ~8@a ~8@a ~10@a ~8@a ~10@a ~7@a\n"
+                "Lock" "Site" "acquired" "waited" "wait" "max-wait" "hold"
+                "waiters")
+        (print (make-string 112 #\-))
+        (dolist [e (let1 s (sort r > key)
+                     (if (integer? max-rows) (take* s max-rows) s))]
+          (match-let1 (lock site acq cont wait max-wait hold _ waiters) e
+            (format #t "~25a ~29a ~8d ~8d ~10@a ~8@a ~10@a ~7d\n"
+                    (label lock 25) (label (or site "-") 29)
+                    acq cont (ms wait) (ms max-wait) (ms hold) waiters)))))))
+
+(define (with-lock-profiler thunk)
+  (receive vals (dynamic-wind
+                  lock-profiler-start
+                  thunk
+                  lock-profiler-stop)
+    (lock-profiler-show)
+    (lock-profiler-reset)
+    (apply values vals)))
+
 ;;;==========================================================
 ;;; Internal routines
 ;;;
@@ -167,6 +436,32 @@
     ))
 
 
+;; Show allocation samples.  Code that isn't counted by the call counter
+;; (e.g. toplevel forms) can have zero calls.
+(define (show-alloc-stats stat sort-by max-rows)
+  (let* ([total (fold (^(entry sum) (+ (cddr entry) sum)) 0 stat)]
+         [per-call (^e (if (zero? (cadr e)) (cddr e) (quotient (cddr e) (cadr e))))]
+         [key (case sort-by
+                [(time) cddr]
+                [(count) cadr]
+                [(time-per-call) per-call]
+                [else
+                 (error "profiler-show: sort-by argument must be either one of time, count, or time-per-call, but got:" sort-by)])]
+         [sorted (sort stat (^(a b) (> (key a) (key b))))])
+
+    (print "Allocation statistics (total about "total" bytes)")
+    (print "                                                    num    bytes/   total")
+    (print "Name                                                calls  call     bytes")
+    (print "---------------------------------------------------+------+-------+-----------")
+    (dolist [e (if (integer? max-rows) (take* sorted max-rows) sorted)]
+      (match-let1 (name ncalls . bytes) e
+        (format #t "~50a ~7d ~7d ~10d(~3d%)\n"
+                name ncalls (per-call e) bytes
+                (if (zero? total)
+                  0
+                  (exact (round (* 100 (/ bytes total))))))))
+    ))
+
 ;; Get a fixed-decimal notation of time/call (in us)
 ;; If the time is under 100ms:  ##.####
 ;; If the time is under 10^6ms: ###.### - ######.
@@ -178,6 +473,63 @@
         (receive (q r) (quotient&remainder val 10000)
           (format "~2d.~4,'0d" q r))))))
 
+;; NB: this part depends on the result object of profiler-raw-result,
+;; which may be changed later.  Keep this in sync with src/prof.c.
+(define (result-of stat-hash)
+  (hash-table-map stat-hash (^(k v) (cons (entry-name k) v))))
+
+(define (alloc-result-of stat-hash alloc-hash)
+  (hash-table-map alloc-hash
+                  (^(k v) (list* (entry-name k)
+                                 (car (hash-table-get stat-hash k '(0 . 0)))
+                                 v))))
+
+;; Merge results of profiler-get-result
+(define (merge-results results)
+  (let1 ht (make-hash-table 'equal?)
+    (dolist (r results)
+      (dolist (e r)
+        (let1 p (hash-table-get ht (car e) '(0 . 0))
+          (hash-table-put! ht (car e)
+                           (cons (+ (cadr e) (car p))
+                                 (+ (cddr e) (cdr p)))))))
+    (hash-table-map ht cons)))
+
+(define (thread-label thread)
+  (let1 name (thread-name thread)
+    (if (string? name) name (write-to-string thread))))
+
+;; Sampling period (see SAMPLING_PERIOD in src/prof.c)
+(define-constant *period-ns* 10000000)
+
+;; Stack frame label for folded/pprof output
+(define (frame-label name)
+  (if (string? name) name (write-to-string name)))
+
+;; Minimal protobuf encoder for pprof output.
+;; Length-delimited fields are built in string ports; we only deal
+;; with bytes, so it doesn't matter if the strings are incomplete.
+(define (pb-varint n out)
+  (if (< n #x80)
+    (write-byte n out)
+    (begin (write-byte (logior (logand n #x7f) #x80) out)
+           (pb-varint (ash n -7) out))))
+(define (pb-key field wire-type out)
+  (pb-varint (logior (ash field 3) wire-type) out))
+(define (pb-uint field n out)
+  (pb-key field 0 out)
+  (pb-varint n out))
+(define (pb-bytes field str out)
+  (pb-key field 2 out)
+  (pb-varint (string-size str) out)
+  (let1 in (open-input-string str)
+    (let loop ([b (read-byte in)])
+      (unless (eof-object? b) (write-byte b out) (loop (read-byte in))))))
+(define (pb-message field writer out)
+  (pb-bytes field (call-with-output-string writer) out))
+(define (pb-packed field ns out)
+  (pb-message field (^o (dolist [n ns] (pb-varint n o))) out))
+
 ;; Return a 'printable' notation of sampled code location
 (define (entry-name obj)
   (cond
@@ -40,11 +40,12 @@
   (use gauche.sequence)
   (use gauche.threads)
   (use data.sparse)
-  (use util.match)
-  (export primes *primes* reset-primes
+  (use control.parallel)
+  (use math.prime-core)
+  (export primes *primes* reset-primes primes-in-range
           small-prime? *small-prime-bound*
           miller-rabin-prime? bpsw-prime?
-          naive-factorize mc-factorize
+          naive-factorize mc-factorize parallel-factorize
           jacobi totient))
 (select-module math.prime)
 
@@ -52,77 +53,36 @@
 ;;; Infinite sequence of prime numbers
 ;;;
 
-;; This section of code is based on the segment sieve prime number generator
-;; written by @cddddr.  Optimized by SK.  As of 0.9.4_pre2, it can generate
-;; first 10^7 primes in 14sec on 2.4GHz Core2 machine.
-
-(define (take-first-term a0 d lower-bound)
-  (if (<= lower-bound a0)
-      a0
-      (+ a0 (* d (quotient (- lower-bound a0 (- d) 1) d)))))
-(define (->odd x)  (if (odd? x) x (+ x 1)))
-(define (->even x) (if (even? x) x (+ x 1)))
-(define-inline (integer->index x) (ash x -1))
-
-(define-constant *segment-size* (->even #e5e4))
-(define-constant *first-segment-start*
-  (->odd (ceiling->exact (expt *segment-size* 0.6))))
-(define-constant *sieve-vec-size* (/ *segment-size* 2))
-(define-constant *sieve-filler* '#u8(0))
-
-;; sieve is a bytevector, representing a range of odd numbers.
-;; given odd number N in the range [start, end] (where start and end
-;; are both odd), (vector-ref bytevec (/ (- N start) 2)) is 0 if N
-;; is composite, 1 if not.
-(define (segment-sieve! bytevec start primes)
-  (let ([root (floor->exact (sqrt (+ start *segment-size* -1)))]
-        [start-index (integer->index start)])
-    (let sieve! ([ps (cdr primes)])
-      (match-let1 (p . qs) ps
-        (when (<= p root)
-          (let1 i (- (take-first-term (integer->index (* p p)) p start-index)
-                     start-index)
-            (u8vector-multi-copy! bytevec i p *sieve-filler*))
-          (sieve! qs))))))
-
-(define (bytevec->generator bytevec start)
-  (let1 i 0
-    (^[] (let loop ([j i])
-           (cond [(>= j *sieve-vec-size*) (set! i j) (eof-object)]
-                 [(not (zero? (u8vector-ref bytevec j)))
-                  (set! i (+ j 1))
-                  (+ (* j 2) start)]
-                 [else (loop (+ j 1))])))))
-
-(define (segment-prime-generator start primes)
-  (let1 bytevec (make-u8vector *sieve-vec-size* 1)
-    (segment-sieve! bytevec start primes)
-    (bytevec->generator bytevec start)))
-
-;; Head of prime sequence.  We don't make it a generator,
-;; for we only need to calculate them once and it won't
-;; take long.  We just wrap it with delay so that it won't
-;; tax loading time.
-(define *small-primes*
-  (delay (list-ec (:range n 2 *first-segment-start*)
-                  (if (every?-ec (:range j 2 (+ 1 (floor->exact (sqrt n))))
-                                 (< 0 (mod n j))))
-                  n)))
+;; The primes are generated a segment at a time by %primes-in-range,
+;; a segmented sieve in prime-core.c.  Each segment is sieved in
+;; cache-sized blocks over a bit vector.
+
+(define-constant *segment-size* (expt 2 20))
+(define-constant *u64-limit* (expt 2 64))
 
 ;; API
 (define (primes)
-  (define start *first-segment-start*)
-  (define gen (list->generator (force *small-primes*)))
+  (define start 0)
+  (define gen (^[] (eof-object)))
   (define (gen-primes)
     (let loop ([v (gen)])
       (if (eof-object? v)
-        (begin
-          (set! gen (segment-prime-generator start prime-lseq))
-          (inc! start *segment-size*)
+        (let1 end (min (+ start *segment-size*) *u64-limit*)
+          (when (= start end)
+            (error "primes: can't go beyond 2^64"))
+          (set! gen (uvector->generator (%primes-in-range start end)))
+          (set! start end)
           (loop (gen)))
         v)))
-  (define prime-lseq (generator->lseq gen-primes))
-  prime-lseq)
+  (generator->lseq gen-primes))
+
+;; API
+(define (primes-in-range lo hi)
+  (unless (and (exact-integer? lo) (exact-integer? hi))
+    (error "exact integers required, but got:" lo hi))
+  (if (<= hi (max lo 0))
+    (make-u64vector 0)
+    (%primes-in-range (max lo 0) hi)))
 
 ;; API
 (define *primes* (primes))
@@ -140,6 +100,11 @@
 ;; n is the number to be tested, a is the chosen base.
 ;; returns #f if n is composite.
 (define (miller-rabin-test a n)
+  (if (< n *u64-limit*)
+    (%miller-rabin-u64 n a)
+    (miller-rabin-test-generic a n)))
+
+(define (miller-rabin-test-generic a n)
   (let* ([n-1 (- n 1)]
          [s (twos-exponent-factor n-1)]
          [d (ash n-1 (- s))]
@@ -166,17 +131,15 @@
 (define *small-prime-bound*
   (car (last *deterministic-witnesses*)))
 
-(define (deterministic-miller-rabin n witnesses)
-  (every?-ec (: a witnesses) (miller-rabin-test a n)))
-
 ;; If n is below *small-prime-bound*, returns deterministic
 ;; answer.  If n is over, always return #f.
+;; The native %prime-u64? is actually deterministic in the whole 64bit
+;; range (with Sinclair's witnesses above 4759123141), but we keep the
+;; documented bound.
 (define (small-prime? n)
-  (if (<= n 100)
-    (boolean (memv n (take *primes* 25))) ; we have 25 primes below 100.
-    (and-let* ([ (odd? n) ]
-               [p (find (^p (< n (car p))) *deterministic-witnesses*)])
-      (deterministic-miller-rabin n (cdr p)))))
+  (and (exact-integer? n)
+       (< 1 n *small-prime-bound*)
+       (%prime-u64? n)))
 
 (define *miller-rabin-random-source*
   (rlet1 s (make-random-source)
@@ -287,6 +250,7 @@
   (cond [(< n 2) #f]
         [(= n 2) #t]
         [(even? n) #f]
+        [(< n *u64-limit*) (%prime-u64? n)] ; deterministic in this range
         [else
          (let1 fs (naive-factorize n 1000)
            (cond
@@ -396,28 +360,38 @@
 ;; Try MC factorization.  Returns (divisor . quotient).
 ;; Note: This will loop forever if N is a prime.  The caller should
 ;; exclude primes.  Unfortunately, we don't have a deterministic primality
-;; test > 2^64 yet.  
-(define (mc-try-factorize n)
-  (let loop ()
-    (if-let1 d (mc-find-divisor-1 n (random-integer n))
-      (cons d (quotient n d))
-      (loop))))
+;; test > 2^64 yet.
+;; RANDOM-INTEGER is a thunk that returns a random integer generator;
+;; we only need one for bignums, for the native routine on 64bit numbers
+;; just tries different polynomials.
+(define (mc-try-factorize n random-integer)
+  (if (< n *u64-limit*)
+    (let loop ([c 1])
+      (if-let1 d (%pollard-rho-u64 n 2 c)
+        (cons d (quotient n d))
+        (loop (+ c 1))))
+    (let1 rand (random-integer)
+      (let loop ()
+        (if-let1 d (mc-find-divisor-1 n (rand n))
+          (cons d (quotient n d))
+          (loop))))))
 
 ;; API
 (define (mc-factorize n)
+  (%mc-factorize n (^[] random-integer)))
+
+(define (%mc-factorize n random-integer)
   ;; Break up n.  We first exclude primes if possible.
   ;; The worst case scenario is that n contains a factor
   ;; greater than 2^64---in which case we'll take forever.
   (define (smash n)
     (if (definite-prime? n)
       `(,n)
-      (let1 d (mc-try-factorize n)
+      (let1 d (mc-try-factorize n random-integer)
         (append (smash (car d)) (smash (cdr d))))))
 
   (define (definite-prime? n)
-    (cond [(< n *small-prime-bound*) (small-prime? n)]
-          [(< n 18446744073709551616) (bpsw-prime? n)]; (expt 2 64)
-          [else #f]))
+    (and (< n *u64-limit*) (%prime-u64? n)))
 
   (define try-prime-limit 1000)
 
@@ -431,6 +405,17 @@
           ps  ; n is unbreakable, so the original factorization was fine.
           (sort (append nf (drop-right ps 1))))))))
 
+;; API
+;; Factorizes each integer in SEQ in parallel, using control.parallel.
+;; The default random source of srfi-27 isn't meant to be shared among
+;; threads, so each task that needs one makes its own.
+(define (parallel-factorize seq :key (pool #f))
+  (define (random-integer)
+    (random-source-make-integers
+     (rlet1 s (make-random-source)
+       (random-source-randomize! s))))
+  (parallel-map (cut %mc-factorize <> random-integer) seq :pool pool))
+
 ;;;
 ;;; Fun stuff
 ;;;
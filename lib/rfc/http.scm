@@ -50,14 +50,18 @@
   (use rfc.uri)
   (use rfc.base64)
   (use gauche.net)
+  (use gauche.net.resolver)
   (use gauche.parameter)
   (use gauche.charconv)
   (use gauche.sequence)
   (use gauche.uvector)
+  (use gauche.threads)
   (use util.match)
   (use text.tree)
   (export <http-error>
           http-user-agent make-http-connection reset-http-connection
+          make-http-connection-pool http-connection-pool
+          http-connection-pool-clear!
           http-compose-query http-compose-form-data
           http-status-code->description
 
@@ -83,7 +87,8 @@
           mime-compose-parameters
           mime-parse-content-type)
 (autoload rfc.tls
-          make-tls tls-destroy tls-connect tls-input-port tls-output-port tls-close)
+          make-tls tls-destroy tls-connect tls-input-port tls-output-port tls-close
+          tls-session)
 
 (autoload file.util file-size find-file-in-paths null-device)
 
@@ -105,6 +110,10 @@
 ;; argument.
 (define http-proxy (make-parameter #f))
 
+;; global connection pool.  can be overridden by :pool keyword
+;; argument.  #f means each one-shot request uses a fresh connection.
+(define http-connection-pool (make-parameter #f))
+
 ;; The default redirect handler
 ;;
 (define http-default-redirect-handler
@@ -214,6 +223,10 @@
 ;;             returns without attempting retrying.
 ;;             This is provided for the backward compatibility; newer code
 ;;             should use :redirect-handler #f
+;;   pool    - An <http-connection-pool>, or #f.  If SERVER is a string
+;;             and a pool is given, a kept-alive connection to the same
+;;             server is taken from the pool, and returned to it after
+;;             the response is read if the server allows it.
 ;;
 ;; Other unrecognized options are passed as request headers.
 
@@ -231,10 +244,22 @@
                            (receiver (http-string-receiver))
                            (sender #f)
                            ((:request-encoding enc) (gauche-character-encoding))
+                           (pool (http-connection-pool))
                       :allow-other-keys opts)
 
-  (define conn (ensure-connection server auth-handler auth-user auth-password
-                                  proxy secure extra-headers))
+  (define pooled? (and pool (string? server)))
+  (define reused? #f)
+  (define conn
+    (ensure-connection (if pooled?
+                         (or (and-let* ([c (pool-checkout! pool server
+                                                           secure proxy)])
+                               (set! reused? #t)
+                               c)
+                             (make-http-connection server))
+                         server)
+                       auth-handler auth-user auth-password
+                       proxy secure extra-headers))
+  (define reusable? #f)
   (define redirector (if no-redirect
                        #f
                        (case redirect-handler
@@ -271,46 +296,68 @@
   ;;   (reply <code> <headers> <body>)
   ;;   (redirect-to <method> <location>)
   (define (request-response in out method uri host sender)
+    (set! reusable? #f)
     (send-request out method uri sender (req-headers host) enc)
     (receive (code rep-headers) (receive-header in)
-      (if-let1 consider-redirect (and (string-prefix? "3" code) redirector)
-        ;; we retrieve body as string, not using caller-provided receiver
-        (let* ([body (get-body in method code rep-headers
-                               (http-string-receiver))]
-               [verdict (consider-redirect method code rep-headers body)])
-          (if verdict
-            `(redirect-to ,(car verdict) ,(cdr verdict))
-            (let1 hdrs (redirect-headers body rep-headers)
-              `(reply ,code ,hdrs
-                      ,(and body
-                            (receive-body (open-input-string body) code
-                                          hdrs receiver))))))
-        ;; no redirection
-        `(reply ,code ,rep-headers
-                ,(get-body in method code rep-headers receiver)))))
+      (begin0
+        (if-let1 consider-redirect (and (string-prefix? "3" code) redirector)
+          ;; we retrieve body as string, not using caller-provided receiver
+          (let* ([body (get-body in method code rep-headers
+                                 (http-string-receiver))]
+                 [verdict (consider-redirect method code rep-headers body)])
+            (if verdict
+              `(redirect-to ,(car verdict) ,(cdr verdict))
+              (let1 hdrs (redirect-headers body rep-headers)
+                `(reply ,code ,hdrs
+                        ,(and body
+                              (receive-body (open-input-string body) code
+                                            hdrs receiver))))))
+          ;; no redirection
+          `(reply ,code ,rep-headers
+                  ,(get-body in method code rep-headers receiver)))
+        ;; we reach here only if the whole body has been consumed.
+        (set! reusable? (keep-alive-response? method code rep-headers)))))
+
+  ;; A connection taken from the pool may have been closed by the server
+  ;; after we checked it.  For idempotent requests we retry once with
+  ;; a fresh connection.
+  (define (exchange method uri host)
+    (define (run)
+      (with-connection conn
+                       (^[i o] (request-response i o method uri host sender))))
+    (if (and reused? (memq method '(GET HEAD)))
+      (begin0 (guard (e [(or (<system-error> e) (<http-error> e))
+                         (set! reused? #f)
+                         (reset-http-connection conn)
+                         (run)])
+                (run))
+        (set! reused? #f))
+      (run)))
 
   ;; main loop
-  (let loop ([history '()]
-             [host host]
-             [method method]
-             [request-uri (ensure-request-uri request-uri enc)])
-    (receive (host uri)
-        (consider-proxy conn (or host (~ conn'server)) request-uri)
-      (let1 result
-          (with-connection
-           conn
-           (^[i o] (request-response i o method uri host sender)))
-        (match result
-          [('reply code rep-headers body) (values code rep-headers body)]
-          [('redirect-to method location)
-           (receive (uri proto new-server path*)
-               (canonical-uri conn location (ref conn'server))
-             (when (or (member uri history)
-                       (> (length history) 20))
-               (errorf <http-error> "redirection is looping via ~a" uri))
-             (loop (cons uri history)
-                   (~ (redirect-connection! conn proto new-server)'server)
-                   method path*))])))))
+  (unwind-protect
+      (let loop ([history '()]
+                 [host host]
+                 [method method]
+                 [request-uri (ensure-request-uri request-uri enc)])
+        (receive (host uri)
+            (consider-proxy conn (or host (~ conn'server)) request-uri)
+          (let1 result (exchange method uri host)
+            (match result
+              [('reply code rep-headers body) (values code rep-headers body)]
+              [('redirect-to method location)
+               (receive (uri proto new-server path*)
+                   (canonical-uri conn location (ref conn'server))
+                 (when (or (member uri history)
+                           (> (length history) 20))
+                   (errorf <http-error> "redirection is looping via ~a" uri))
+                 (loop (cons uri history)
+                       (~ (redirect-connection! conn proto new-server)'server)
+                       method path*))]))))
+    (when pooled?
+      (if reusable?
+        (pool-checkin! pool conn)
+        (reset-http-connection conn)))))
 ;;
 ;; Pre-defined receivers
 ;;
@@ -531,6 +578,107 @@
       (set! (~ conn'secure) (equal? proto "https"))))
   conn)
 
+;;==============================================================
+;; HTTP connection pool
+;;
+
+;; A pool keeps idle persistent connections keyed by the server, the
+;; security and the proxy, so that one-shot requests such as http-get
+;; can skip TCP and TLS setup.  A connection is owned exclusively by
+;; one request while it is checked out; the pool's table is guarded
+;; by a mutex, so a pool can be shared among threads.
+
+(define-class <http-connection-pool> ()
+  ;; All slots are private.
+  ((mutex        :init-form (make-mutex))
+   (idle         :init-form (make-hash-table 'equal?))
+                                        ; key -> ((conn . last-used) ...),
+                                        ; most recently used first.
+   (max-per-host :init-keyword :max-per-host)
+   (idle-timeout :init-keyword :idle-timeout) ; seconds
+   ))
+
+(define (make-http-connection-pool :key (max-per-host 8) (idle-timeout 30))
+  (make <http-connection-pool>
+    :max-per-host max-per-host
+    :idle-timeout idle-timeout))
+
+(define (pool-key server secure proxy) (list server (boolean secure) proxy))
+
+;; Returns an idle connection or #f.  Expired connections and the ones
+;; the server has already closed are discarded.
+(define (pool-checkout! pool server secure proxy)
+  (define key (pool-key server secure proxy))
+  (define now (sys-time))
+  (receive (conn stale)
+      (with-locking-mutex (~ pool'mutex)
+        (^[]
+          (let loop ([es (hash-table-get (~ pool'idle) key '())]
+                     [stale '()])
+            (cond [(null? es)
+                   (hash-table-delete! (~ pool'idle) key)
+                   (values #f stale)]
+                  [(> (- now (cdar es)) (~ pool'idle-timeout))
+                   (loop (cdr es) (cons (caar es) stale))]
+                  [else
+                   (hash-table-put! (~ pool'idle) key (cdr es))
+                   (values (caar es) stale)]))))
+    (for-each reset-http-connection stale)
+    (cond [(not conn) #f]
+          [(connection-idle? conn) conn]
+          [else (reset-http-connection conn)
+                (pool-checkout! pool server secure proxy)])))
+
+(define (pool-checkin! pool conn)
+  (define key (pool-key (~ conn'server) (~ conn'secure) (~ conn'proxy)))
+  (define now (sys-time))
+  (define discarded
+    (with-locking-mutex (~ pool'mutex)
+      (^[]
+        (receive (live expired)
+            (partition (^e (<= (- now (cdr e)) (~ pool'idle-timeout)))
+                       (acons conn now (hash-table-get (~ pool'idle) key '())))
+          (let1 n (min (length live) (~ pool'max-per-host))
+            (if (zero? n)
+              (hash-table-delete! (~ pool'idle) key)
+              (hash-table-put! (~ pool'idle) key (take live n)))
+            (map car (append (drop live n) expired)))))))
+  (for-each reset-http-connection discarded))
+
+(define (http-connection-pool-clear! pool)
+  (define conns
+    (with-locking-mutex (~ pool'mutex)
+      (^[]
+        (begin0 (append-map (cut map car <>)
+                            (hash-table-values (~ pool'idle)))
+          (hash-table-clear! (~ pool'idle))))))
+  (for-each reset-http-connection conns))
+
+;; An idle connection shouldn't have anything to read; if it has, the
+;; server has closed it (or sent garbage), and we can't use it.
+(define (connection-idle? conn)
+  (and-let* ([s (~ conn'socket)])
+    (cond-expand
+     [gauche.sys.select
+      (let1 fds (make <sys-fdset>)
+        (sys-fdset-set! fds (socket-fd s) #t)
+        (receive (n r w e) (sys-select! fds #f #f 0)
+          (zero? n)))]
+     [else #t])))
+
+;; Whether the server lets us send another request on the same connection
+;; after this response.  The body must be delimited by something other
+;; than the connection close.
+(define (keep-alive-response? method code headers)
+  (and (not (and-let* ([c (rfc822-header-ref headers "connection")])
+              (#/\bclose\b/i c)))
+       (or (eq? method 'HEAD)
+           (member code '("204" "304"))
+           (rfc822-header-ref headers "content-length")
+           (equal? (rfc822-header-ref headers "transfer-encoding")
+                   "chunked"))
+       #t))
+
 ;;==============================================================
 ;; query and request body composition
 ;;
@@ -713,9 +861,10 @@
     (set! (~ conn'socket)
           (if path
             (make-client-socket 'unix path)
-            (make-client-socket host (if port
-                                       (x->integer port)
-                                       (if (~ conn'secure) 443 80)))))))
+            (resolver-connect (current-resolver) host
+                              (if port
+                                (x->integer port)
+                                (if (~ conn'secure) 443 80)))))))
 
 (define (shutdown-socket-connection conn)
   (when (~ conn'socket)
@@ -725,9 +874,9 @@
     (set! (~ conn'socket) #f)))
 
 (define (with-connection conn proc)
-  (unless (~ conn'persistent)
-    (unless (~ conn'socket) (start-socket-connection conn))
-    (when (~ conn'secure) (start-secure-agent conn)))
+  (unless (~ conn'socket) (start-socket-connection conn))
+  (when (and (~ conn'secure) (not (~ conn'secure-agent)))
+    (start-secure-agent conn))
   (unwind-protect
       (apply proc (if (~ conn'secure)
                     `(,(tls-input-port (~ conn'secure-agent))
@@ -865,6 +1014,7 @@
 
 (define (shutdown-secure-agent conn)
   (when (~ conn'secure-agent)
+    (save-tls-session! (~ conn'server) (~ conn'secure-agent))
     (tls-close (~ conn'secure-agent))
     (tls-destroy (~ conn'secure-agent))
     (set! (~ conn'secure-agent) #f)))
@@ -874,9 +1024,40 @@
     (error "Secure connection is not available on this platform"))
   (when (~ conn'secure-agent) (shutdown-secure-agent conn))
   (let1 tls (make-tls)
-    (tls-connect tls (socket-fd (~ conn'socket)))
+    (tls-connect tls (socket-fd (~ conn'socket))
+                 :server-name (sni-host-name (~ conn'server))
+                 :session (saved-tls-session (~ conn'server)))
     (set! (~ conn'secure-agent) tls)))
 
+;; The host name we send by SNI; it must not be an IP address.
+(define (sni-host-name server)
+  (and-let* ([ (string? server) ]
+             [m (#/^([^:\[]+)(?::\d+)?$/ server)]
+             [ (not (#/^[\d.]+$/ (m 1))) ])
+    (m 1)))
+
+;; We keep the last TLS session per server, so that the next connection
+;; to the same server can resume it instead of going through the full
+;; handshake.  Only the OpenSSL backend gives us sessions.
+(define *tls-sessions* (make-hash-table 'equal?))
+(define *tls-sessions-mutex* (make-mutex))
+(define-constant *tls-sessions-max* 256)
+
+(define (saved-tls-session server)
+  (with-locking-mutex *tls-sessions-mutex*
+    (^[] (hash-table-get *tls-sessions* server #f))))
+
+(define (save-tls-session! server tls)
+  (and-let* ([ (string? server) ]
+             [session (guard (e [else #f]) (tls-session tls))])
+    (with-locking-mutex *tls-sessions-mutex*
+      (^[]
+        (when (and (>= (hash-table-num-entries *tls-sessions*)
+                       *tls-sessions-max*)
+                   (not (hash-table-exists? *tls-sessions* server)))
+          (hash-table-clear! *tls-sessions*))
+        (hash-table-put! *tls-sessions* server session)))))
+
 ;; for external api
 (define (http-secure-connection-available?)
   (cond-expand
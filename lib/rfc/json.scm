@@ -33,15 +33,19 @@
 
 ;;; http://www.ietf.org/rfc/rfc7159.txt
 
-;; NOTE: This module depends on parser.peg, whose API is not officially
-;; fixed.  Hence do not take this code as an example of parser.peg;
-;; this will likely to be rewritten once parser.peg's API is changed.
+;; NOTE: parse-json and friends use the reader written in C
+;; (rfc.json-parser).  The parser.peg version is kept as json-parser.
+;; Since parser.peg's API is not officially fixed, do not take this code
+;; as an example of parser.peg; this will likely to be rewritten once
+;; parser.peg's API is changed.
 
 (define-module rfc.json
   (use gauche.parameter)
   (use gauche.sequence)
   (use gauche.generator)
   (use parser.peg)
+  (use rfc.json-parser)
+  (use rfc.json-writer)
   (use gauche.unicode)
   (use srfi-13)
   (use srfi-14)
@@ -49,7 +53,9 @@
   (export <json-parse-error> <json-construct-error>
           parse-json parse-json-string
           parse-json*
+          json-event-generator
           construct-json construct-json-string
+          construct-json-array
 
           json-array-handler json-object-handler json-special-handler
 
@@ -178,34 +184,53 @@
 (define json-parser ($seq %ws ($or eof %value)))
 
 ;; entry point
+
+;; Handlers to pass to json-reader-read; #f for the default ones, so that
+;; the reader can skip calling them.
+(define (reader-handlers)
+  (define (h param default) (let1 p (param) (if (eq? p default) #f p)))
+  (values (h json-array-handler list->vector)
+          (h json-object-handler identity)
+          (h json-special-handler identity)))
+
 (define (parse-json :optional (port (current-input-port)))
-  (guard (e [(<parse-error> e)
-             ;; not to expose parser.peg's <parse-error>.
-             (error <json-parse-error>
-                    :position (~ e'position) :objects (~ e'objects)
-                    :message (~ e'message))])
-    (peg-parse-port json-parser port)))
+  (receive (ah oh sh) (reader-handlers)
+    (json-reader-read (make-json-reader port) ah oh sh)))
 
 (define (parse-json-string str)
-  (call-with-input-string str (cut parse-json <>)))
+  (receive (ah oh sh) (reader-handlers)
+    (json-reader-read (make-json-reader str) ah oh sh)))
 
 (define (parse-json* :optional (port (current-input-port)))
-  (guard (e [(<parse-error> e)
-             ;; not to expose parser.peg's <parse-error>.
-             (error <json-parse-error>
-                    :position (~ e'position) :objects (~ e'objects)
-                    :message (~ e'message))])
-    (generator->list (peg-parser->generator json-parser port))))
+  (receive (ah oh sh) (reader-handlers)
+    (let1 r (make-json-reader port #t)
+      (let loop ([vs '()])
+        (let1 v (json-reader-read r ah oh sh)
+          (if (eof-object? v)
+            (reverse! vs)
+            (loop (cons v vs))))))))
+
+;; Returns a generator of parse events, (EVENT . PAYLOAD), where EVENT
+;; is one of start-object, end-object, start-array, end-array, key and
+;; value.  The payload is the key string or the value, or #f.
+(define (json-event-generator :optional (port (current-input-port)))
+  (let ([r (make-json-reader port #t)]
+        [special (json-special-handler)])
+    (^[] (let1 e (json-reader-next-event r)
+           (if (and (pair? e) (eq? (car e) 'value) (symbol? (cdr e)))
+             (cons 'value (special (cdr e)))
+             e)))))
 
 ;;;============================================================
 ;;; Writer
 ;;;
 
 (define (print-value obj)
-  (cond [(or (eq? obj 'false) (eq? obj #f)) (display "false")]
-        [(or (eq? obj 'true) (eq? obj #t))  (display "true")]
-        [(eq? obj 'null)  (display "null")]
-        [(list? obj)      (print-object obj)]
+  (json-write-value obj (current-output-port) print-other x->string))
+
+;; Called back from json-write-value for what it doesn't handle by itself.
+(define (print-other obj)
+  (cond [(list? obj)      (print-object obj)]
         [(string? obj)    (print-string obj)]
         [(number? obj)    (print-number obj)]
         [(is-a? obj <dictionary>) (print-object obj)]
@@ -266,8 +291,9 @@
 (define (construct-json x :optional (oport (current-output-port)))
   (with-output-to-port oport
     (^()
-      (cond [(or (list? x) (is-a? x <dictionary>)) (print-object x)]
-            [(and (is-a? x <sequence>) (not (string? x))) (print-array x)]
+      (cond [(or (list? x) (is-a? x <dictionary>)
+                 (and (is-a? x <sequence>) (not (string? x))))
+             (print-value x)]
             [else (error <json-construct-error> :object x
                          "construct-json expects a list or a vector, \
                           but got" x)]))))
@@ -275,3 +301,16 @@
 (define (construct-json-string x)
   (call-with-output-string (cut construct-json x <>)))
 
+;; Writes a JSON array of the values GEN generates, without having all
+;; of them in memory.
+(define (construct-json-array gen :optional (oport (current-output-port)))
+  (with-output-to-port oport
+    (^()
+      (display "[")
+      (let loop ([v (gen)] [first #t])
+        (unless (eof-object? v)
+          (unless first (display ","))
+          (print-value v)
+          (loop (gen) #f)))
+      (display "]"))))
+
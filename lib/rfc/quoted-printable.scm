@@ -34,82 +34,44 @@
 
 ;; Ref: RFC2045 section 6.7  <http://www.rfc-editor.org/rfc/rfc2045.txt>
 
+;; The codec itself is in rfc.codec (ext/rfc/codec.c).
+
 (define-module rfc.quoted-printable
+  (use rfc.codec)
   (export quoted-printable-encode quoted-printable-encode-string
-          quoted-printable-decode quoted-printable-decode-string)
+          quoted-printable-encode-bytevector
+          quoted-printable-decode quoted-printable-decode-string
+          quoted-printable-decode-bytevector)
   )
 (select-module rfc.quoted-printable)
 
 ;; The minimum line width is 4, since one encoded octed and one soft
-;; line break requires 4 characters.
+;; line break requires 4 characters; a smaller LINE-WIDTH means no
+;; soft line breaks.
 ;; If binary is #f, we encode CR and LF.  See RFC2045 for this consideration.
+(define (%line-width w) (or w 0))
+
 (define (quoted-printable-encode :key (line-width 76) (binary #f))
-  (let1 limit (if (and line-width (>= line-width 4)) (- line-width 3) #f)
-    (let loop ([c (read-byte)]
-               [lcnt 0])
-      (cond [(eof-object? c)]
-            [(and limit (>= lcnt limit)) (display "=\r\n") (loop c 0)]
-            [(and limit (>= lcnt limit) (or (= c #x20) (= c #x09)))
-             ;; space or tab at the end of line
-             (write-byte c) (display "=\r\n") (loop (read-byte) 0)]
-            [(and binary (or (= c #x0a) (= c #x0d)))
-             (format #t "=0~X" c) (loop (read-byte) (+ lcnt 1))]
-            [(= c #x0d)
-             (let1 c1 (read-byte)
-               (cond ((= c1 #x0a) (display "\r\n") (loop (read-byte) 0))
-                     (else (display "\r\n") (loop c1 0))))]
-            [(= c #x0a)
-             (display "\r\n") (loop (read-byte) 0)]
-            ;; NB: we escape '?' as well, for it interferes the header
-            ;; field encoding defined in RFC2047.
-            [(or (< #x20 c #x3d) (= c #x3e) (< #x3f c #x7f))
-             (write-byte c) (loop (read-byte) (+ lcnt 1))]
-            [else
-             (format #t "=~2,'0X" c) (loop (read-byte) (+ lcnt 3))]))
-    ))
+  (qp-encode-port (current-input-port) (current-output-port)
+                  (%line-width line-width) binary))
+
+(define (quoted-printable-encode-string string :key (line-width 76)
+                                                    (binary #f))
+  (check-arg string? string)
+  (qp-encode-bytes string (%line-width line-width) binary))
 
-(define (quoted-printable-encode-string string . args)
-  (with-string-io string (cut apply quoted-printable-encode args)))
+(define (quoted-printable-encode-bytevector bv :key (line-width 76)
+                                                    (binary #f))
+  (check-arg u8vector? bv)
+  (qp-encode-bytes bv (%line-width line-width) binary))
 
 (define (quoted-printable-decode)
-  (let loop ([c (read-char)])
-    (cond [(eof-object? c)]
-          [(char=? c #\=)
-           (let1 c1 (read-char)
-             (cond
-              [(eof-object? c1)] ; illegal, but we recognize it as a soft newline
-              [(char=? c1 #\newline) (loop (read-char))] ; soft newline
-              [(char=? c1 #\return)      ; soft newline
-               (let1 c2 (read-char)
-                 (if (char=? c2 #\newline) (loop (read-char)) (loop c2)))]
-              [(memv c1 '(#\tab #\space)) ; possibly soft newline
-               (let loop2 ([c2 (read-char)]
-                           [r (list c1 c)])
-                 (cond [(eof-object? c2)]
-                       [(char=? c2 #\newline) (loop (read-char))]
-                       [(char=? c2 #\return)
-                        (let1 c3 (read-char)
-                          (if (char=? c3 #\newline)
-                            (loop (read-char))
-                            (loop c3)))]
-                       [(memv c2 '(#\tab #\space))
-                        (loop2 (read-char) (cons c2 r))]
-                       [else
-                        (for-each write-char (reverse r))
-                        (loop c2)]))]
-              [(digit->integer c1 16)
-               => (^[num1]
-                    (let1 c2 (read-char)
-                      (cond [(eof-object? c2) (write-char c) (write-char c1)]
-                            [(digit->integer c2 16)
-                             => (^[num2]
-                                  (write-byte (+ (* num1 16) num2))
-                                  (loop (read-char)))]
-                            [else (write-char c) (write-char c1) (loop c2)])))]
-              [else (write-char c) (loop c1)]))]
-          [else (write-char c) (loop (read-char))])
-    ))
+  (qp-decode-port (current-input-port) (current-output-port)))
 
 (define (quoted-printable-decode-string string)
-  (with-string-io string quoted-printable-decode))
+  (check-arg string? string)
+  (qp-decode-bytes string #f))
 
+(define (quoted-printable-decode-bytevector string)
+  (check-arg string? string)
+  (qp-decode-bytes string #t))
@@ -51,6 +51,7 @@
   (use gauche.regexp)
   (use gauche.charconv)
   (use gauche.uvector)
+  (use rfc.uri-parser)
   (export uri-scheme&specific uri-decompose-hierarchical
           uri-decompose-authority uri-parse uri-ref
           uri-merge uri-compose
@@ -72,46 +73,28 @@
 ;; as a relative URI and #f is returned for the scheme.
 ;; The escaped characters of the scheme specific part is not unescaped;
 ;; their interpretation is dependent on the scheme.
+;;
+;; The actual parsing is done in rfc.uri-parser.  It follows these
+;; regexps:
+;;
+;;  scheme&specific:  ^([A-Za-z][A-Za-z0-9+.-]*):
+;;  hierarchical:     ^(?://([^/?#]*))?([^?#]+)?(?:\?([^#]*))?(?:#(.*))?$
+;;  authority:        ^(?:(?<userinfo>.*?)@)?
+;;                     (?:(?<host>[^:]*)|(?:\[(?<v6host>[a-fA-F\d:]+)\]))
+;;                     (?::(?<port>\d*))?$
 
-(define (uri-scheme&specific uri)
-  (cond [(#/^([A-Za-z][A-Za-z0-9+.-]*):/ uri)
-         => (^m (values (string-downcase (m 1)) (m 'after)))]
-        [else (values #f uri)]))
+(define (uri-scheme&specific uri) (uri-split-scheme uri))
 
 (define (uri-decompose-hierarchical specific)
-  (cond
-   [(and (string? specific)
-         (#/^(?:\/\/([^\/?#]*))?([^?#]+)?(?:\?([^#]*))?(?:#(.*))?$/ specific))
-    => (^m (values (m 1) (m 2) (m 3) (m 4)))]
-   [else (values #f #f #f #f)]))
+  (uri-split-hierarchical specific))
 
 (define (uri-decompose-authority authority)
-  (cond
-   [(and (string? authority)
-         (#/^(?:(?<userinfo>.*?)@)?(?:(?<host>[^:]*)|(?:\[(?<v6host>[a-fA-F\d:]+)\]))(?::(?<port>\d*))?$/ authority))
-    => (^m (values (m 'userinfo) (or (m 'v6host) (m 'host)) (m 'port)))]
-   [else (values #f #f #f)]))
+  (uri-split-authority authority))
 
 ;; A common cliche (suggested by Kouhei Sutou)
 ;; Returns: scheme, user-info, host, port, path, query, fragment
-(define (uri-parse uri)
-  (define (filter-non-empty-string str)
-    (and (string? str)
-         (not (string-null? str))
-         str))
-  (receive (scheme specific)
-      (uri-scheme&specific uri)
-    (receive (authority path query fragment)
-        (uri-decompose-hierarchical specific)
-      (receive (user-info host port)
-          (uri-decompose-authority authority)
-        (values scheme
-                user-info
-                (filter-non-empty-string host)
-                (and port (string->number port))
-                (filter-non-empty-string path)
-                query
-                fragment)))))
+;; Empty host and path are returned as #f.
+(define (uri-parse uri) (uri-split uri))
 
 ;; Convenience utility
 ;;  (uri-ref "http://foo:8080/baz?q" 'host) => "foo"
@@ -277,39 +260,37 @@
 ;;  the semantics of specific URI scheme.
 ;;  These procedures provides basic building components.
 
+;; A '%' that isn't followed by two hex digits is passed through; we're
+;; just permissive.  The input is read in chunks; a '%' sequence at the
+;; end of a chunk is carried over to the next one.
 (define (uri-decode :key (cgi-decode #f))
-  (let loop ([c (read-char)])
-    (cond [(eof-object? c)]
-          [(char=? c #\%)
-           (let1 c1 (read-char)
-             (cond
-              [(eof-object? c1) (write-char c)] ;; just be permissive
-              [(digit->integer c1 16)
-               => (^[i1]
-                    (let1 c2 (read-char)
-                      (cond [(eof-object? c2) (write-char c) (write-char c1)]
-                            [(digit->integer c2 16)
-                             => (^[i2]
-                                  (write-byte (+ (* i1 16) i2))
-                                  (loop (read-char)))]
-                            [else (write-char c) (write-char c1) (loop c2)])))]
-                   [else (write-char c) (loop c1)]))]
-          [(char=? c #\+)
-           (if cgi-decode (write-char #\space) (write-char #\+))
-           (loop (read-char))]
-          [else (write-char c) (loop (read-char))])))
+  (let loop ([pending #f])
+    (let* ([chunk (read-uvector <u8vector> 4096)]
+           [final (eof-object? chunk)]
+           [src (cond [final (or pending '#u8())]
+                      [pending (u8vector-append pending chunk)]
+                      [else chunk])])
+      (receive (r consumed) (uri-decode-bytes src cgi-decode final)
+        (write-uvector r)
+        (unless final
+          (loop (and (< consumed (u8vector-length src))
+                     (u8vector-copy src consumed))))))))
 
 (define (uri-decode-string string :key (encoding (gauche-character-encoding))
                            :allow-other-keys args)
   (define (wrap out)
     (wrap-with-output-conversion out (gauche-character-encoding)
                                  :from-code encoding))
-  (call-with-string-io string
-    (^[in out]
-      (with-ports in (wrap out) (current-error-port)
-        (^[]
-          (apply uri-decode args)
-          (close-output-port (current-output-port)))))))
+  (check-arg string? string)
+  (if (ces-equivalent? encoding (gauche-character-encoding))
+    (values-ref (uri-decode-bytes string (get-keyword :cgi-decode args #f) #t)
+                0)
+    (call-with-string-io string
+      (^[in out]
+        (with-ports in (wrap out) (current-error-port)
+          (^[]
+            (apply uri-decode args)
+            (close-output-port (current-output-port))))))))
 
 ;; Default set of characters that can be passed without escaping.
 ;; See 2.3 "Unreserved Characters" of RFC 2396.  It is slightly
@@ -322,23 +303,26 @@
 ;; 'noescape' char-set is only valid in ASCII range.  All bytes
 ;; larger than #x80 are encoded unconditionally.
 (define (uri-encode :key ((:noescape echars) *rfc3986-unreserved-char-set*))
-  (let loop ([b (read-byte)])
-    (unless (eof-object? b)
-      (if (and (< b #x80)
-               (char-set-contains? echars (integer->char b)))
-        (write-byte b)
-        (format #t "%~2,'0X" b))
-      (loop (read-byte)))))
+  (let loop ()
+    (let1 chunk (read-uvector <u8vector> 4096)
+      (unless (eof-object? chunk)
+        (display (uri-encode-bytes chunk echars))
+        (loop)))))
 
 (define (uri-encode-string string :key (encoding (gauche-character-encoding))
                            :allow-other-keys args)
   (define (wrap in)
     (wrap-with-input-conversion in (gauche-character-encoding)
                                 :to-code encoding))
-  (call-with-string-io string
-    (^[in out]
-      (with-ports (wrap in) out (current-error-port)
-        (cut apply uri-encode args)))))
+  (check-arg string? string)
+  (if (ces-equivalent? encoding (gauche-character-encoding))
+    (uri-encode-bytes string
+                      (get-keyword :noescape args
+                                   *rfc3986-unreserved-char-set*))
+    (call-with-string-io string
+      (^[in out]
+        (with-ports (wrap in) out (current-error-port)
+          (cut apply uri-encode args))))))
 
 ;;==============================================================
 ;; Data uri scheme (rfc2397)
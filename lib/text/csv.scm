@@ -38,7 +38,9 @@
   (use srfi-14)
   (use srfi-42)
   (use gauche.sequence)
+  (use text.csv-parser)
   (export make-csv-reader
+          csv-read-columns
           make-csv-writer
           make-csv-header-parser
           make-csv-record-parser
@@ -51,9 +53,36 @@
 ;;;
 
 ;; API
-(define (make-csv-reader separator :optional (quote-char #\"))
-  (^[:optional (port (current-input-port))]
-    (csv-reader separator quote-char port)))
+(define (make-csv-reader separator :optional (quote-char #\") (pool? #f))
+  (if (native-chars? separator quote-char)
+    (let1 pool (and pool? (make-csv-string-pool))
+      (^[:optional (port (current-input-port))]
+        (csv-parse-record port separator quote-char pool)))
+    (^[:optional (port (current-input-port))]
+      (csv-reader separator quote-char port))))
+
+;; The native reader handles ASCII separator and quote char; in
+;; Shift_JIS, they should be below #x40.  Other cases are
+;; handled by csv-reader below.
+(define (native-chars? sep quo)
+  (and (csv-native-char? sep)
+       (or (not quo) (csv-native-char? quo))))
+
+;; API
+;; Reads all the records from port, and returns a list of columns.
+;; Specs is a list of column specs, one for each field:
+;;   #f            - the field is ignored
+;;   <string>      - a vector of strings, sharing ones with the same content
+;;   <symbol>      - a vector of symbols
+;;   <number>      - a vector of numbers, or #f if not a number
+;;   uvector class - a uvector; an error is raised if the field isn't
+;;                   a number that fits in the element type
+(define (csv-read-columns separator specs :optional (port (current-input-port))
+                                                    (quote-char #\"))
+  (unless (native-chars? separator quote-char)
+    (error "csv-read-columns: unsupported separator or quote-char:"
+           separator quote-char))
+  (csv-parse-columns port separator quote-char specs))
 
 (define (csv-reader sep quo port)
   (define (eor? ch) (or (eqv? ch #\newline) (eof-object? ch)))
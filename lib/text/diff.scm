@@ -6,7 +6,7 @@
 
 (define-module text.diff
   (use util.lcs)
-  (export diff diff-report)
+  (export diff diff-report diff-hunk-generator write-diff-hunk)
   )
 (select-module text.diff)
 
@@ -18,10 +18,10 @@
                     [else (error "don't know how to diff from:" src)])))
 
 ;; lcs on text.  Returns edit-list (as defined in lcs-edit-list).
-(define (diff a b :key (reader read-line) (equal equal?))
+(define (diff a b :key (reader read-line) (equal equal?) (algorithm 'myers))
   (lcs-edit-list (source->list a reader)
                  (source->list b reader)
-                 equal))
+                 equal algorithm))
 
 (define (write-line-diff line type)
   (case type
@@ -30,12 +30,94 @@
     [else (format #t "  ~A\n" line)]))
 
 (define (diff-report a b :key (writer write-line-diff)
-                              (reader read-line) (equal equal?))
+                              (reader read-line) (equal equal?)
+                              (algorithm 'myers))
   (lcs-fold (^[line _] [writer line '-])
             (^[line _] (writer line '+))
             (^[line _] (writer line #f))
             #f
             (source->list a reader)
             (source->list b reader)
-            equal))
+            equal algorithm))
+
+;; Hunks, as in unified diff.  A hunk is
+;;   (a-start a-count b-start b-count (type . line) ...)
+;; where starts are 0-based and type is -, + or #f for a context line.
+;; The generator yields hunks one at a time, so that the caller doesn't
+;; need to keep the whole edit list.
+
+(define (diff-hunk-generator a b :key (reader read-line) (equal equal?)
+                                      (algorithm 'myers) (context 3))
+  (let* ([A (list->vector (source->list a reader))]
+         [B (list->vector (source->list b reader))]
+         [N (vector-length A)]
+         [M (vector-length B)]
+         [matches (lcs-matches A B equal algorithm)]
+         [px 0] [py 0]                  ;next position after the last match
+         [last-xe 0])                   ;end of the last change in A
+    ;; Returns the next change region (xs xe ys ye), or #f.
+    (define (next-change)
+      (if (null? matches)
+        (and (or (< px N) (< py M))
+             (begin0 (list px N py M) (set! px N) (set! py M)))
+        (let ([x (caar matches)] [y (cdar matches)]
+              [xs px] [ys py])
+          (pop! matches)
+          (set! px (+ x 1))
+          (set! py (+ y 1))
+          (if (or (< xs x) (< ys y))
+            (list xs x ys y)
+            (next-change)))))
+    (define (common-lines from to)
+      (map (^i (cons #f (vector-ref A i))) (iota (- to from) from)))
+    (define (make-hunk changes following)
+      (let* ([c0 (car changes)]
+             [cn (car (last-pair changes))]
+             [pre (min context (- (car c0) last-xe))]
+             [post (min context (- (if following (car following) N)
+                                   (cadr cn)))]
+             [as (- (car c0) pre)]
+             [bs (- (caddr c0) pre)])
+        (set! last-xe (cadr cn))
+        (list* as (- (+ (cadr cn) post) as)
+               bs (- (+ (cadddr cn) post) bs)
+               (apply append
+                      (common-lines as (car c0))
+                      (map (^[c next]
+                             (append
+                              (map (^i (cons '- (vector-ref A i)))
+                                   (iota (- (cadr c) (car c)) (car c)))
+                              (map (^j (cons '+ (vector-ref B j)))
+                                   (iota (- (cadddr c) (caddr c)) (caddr c)))
+                              (common-lines (cadr c)
+                                            (if next
+                                              (car next)
+                                              (+ (cadr c) post)))))
+                           changes
+                           (append (cdr changes) '(#f)))))))
+    (define pending (next-change))
+    (^[]
+      (if (not pending)
+        (eof-object)
+        (let loop ([changes (list pending)])
+          (let1 c (next-change)
+            (if (and c (<= (- (car c) (cadr (car changes))) (* 2 context)))
+              (loop (cons c changes))
+              (begin0 (make-hunk (reverse changes) c)
+                      (set! pending c)))))))))
+
+;; Writes a hunk in the unified diff format.
+(define (write-diff-hunk hunk :optional (port (current-output-port)))
+  (define (range start count)
+    (case count
+      [(0) (format "~d,0" start)]
+      [(1) (format "~d" (+ start 1))]
+      [else (format "~d,~d" (+ start 1) count)]))
+  (format port "@@ -~a +~a @@\n"
+          (range (car hunk) (cadr hunk))
+          (range (caddr hunk) (cadddr hunk)))
+  (dolist [l (cddddr hunk)]
+    (format port "~a~a\n"
+            (case (car l) [(-) "-"] [(+) "+"] [else " "])
+            (cdr l))))
 
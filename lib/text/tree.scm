@@ -6,18 +6,27 @@
 
 (define-module text.tree
   (export write-tree
-          tree->string)
+          tree->string
+          tree-size)
   )
 (select-module text.tree)
 
 (define-method write-tree (tree)
   (write-tree tree (current-output-port)))
 
+;; The native walker gathers string and symbol leaves and writes them
+;; in batches.  The host gosh that runs cgen while building may not
+;; have it, so we fall back to the plain traversal.
+(define %native-write-tree
+  (global-variable-ref (find-module 'gauche.internal) '%write-tree #f))
+
 (define-method write-tree ((tree <list>) out)
-  (let loop ((tree tree))
-    (cond ((null? tree))
-          ((pair? tree) (write-tree (car tree) out) (loop (cdr tree)))
-          (else (write-tree tree out)))))
+  (if %native-write-tree
+    (%native-write-tree tree out write-tree)
+    (let loop ((tree tree))
+      (cond ((null? tree))
+            ((pair? tree) (write-tree (car tree) out) (loop (cdr tree)))
+            (else (write-tree tree out))))))
 
 (define-method write-tree ((tree <top>) out)
   (display tree out))
@@ -25,3 +34,15 @@
 (define (tree->string tree)
   (with-output-to-string (lambda () (write-tree tree))))
 
+
+;; Returns the number of bytes write-tree would emit, e.g. for
+;; Content-Length.  Only leaves other than strings and symbols are
+;; actually rendered.
+(define (tree-size tree)
+  (let loop ((tree tree) (size 0))
+    (cond ((null? tree) size)
+          ((pair? tree) (loop (cdr tree) (loop (car tree) size)))
+          ((string? tree) (+ size (string-size tree)))
+          ((and (symbol? tree) (not (keyword? tree)))
+           (+ size (string-size (symbol->string tree))))
+          (else (+ size (string-size (tree->string tree)))))))
@@ -38,15 +38,63 @@
 ;;; Modified by Shiro Kawai
 ;;;  - added lcs-fold and rewrote lcs-edit-list using lcs-fold
 ;;;  - replaced base algorithm from DP to Myers'
+;;;  - use native linear-space Myers and patience diff in util.lcs-core
 
 (define-module util.lcs
   (use gauche.sequence)
   (use srfi-1)
   (use srfi-11)
-  (export lcs lcs-with-positions lcs-fold lcs-edit-list))
+  (use util.lcs-core)
+  (export lcs lcs-with-positions lcs-matches lcs-fold lcs-edit-list))
 (select-module util.lcs)
 
-;; The base algorithm.   This code implements
+;; If the equality is one of those hash tables understand, each element
+;; is mapped to an integer id and the native routine in util.lcs-core
+;; does the job.  It runs Myers's algorithm with the linear space
+;; refinement, in O((M+N)D) time and O(M+N) space, or patience diff.
+;; Otherwise we fall back to the Scheme implementation below.
+
+(define (%id-table eq)
+  (cond [(eq? eq equal?)   (make-hash-table 'equal?)]
+        [(eq? eq eqv?)     (make-hash-table 'eqv?)]
+        [(eq? eq eq?)      (make-hash-table 'eq?)]
+        [(eq? eq string=?) (make-hash-table 'string=?)]
+        [(and (comparator? eq) (comparator-hashable? eq))
+         (make-hash-table eq)]
+        [else #f]))
+
+(define (%elements->ids vec tab)
+  (vector-map (^e (or (hash-table-get tab e #f)
+                      (rlet1 id (hash-table-num-entries tab)
+                        (hash-table-put! tab e id))))
+              vec))
+
+(define (%patience? algorithm)
+  (case algorithm
+    [(myers) #f]
+    [(patience) #t]
+    [else (error "lcs algorithm must be either myers or patience, but got:"
+                 algorithm)]))
+
+;; Returns a list of (a-pos . b-pos) of the matched elements.
+(define (lcs-matches a b :optional (eq equal?) (algorithm 'myers))
+  (let ([A (if (vector? a) a (list->vector a))]
+        [B (if (vector? b) b (list->vector b))]
+        [patience? (%patience? algorithm)])
+    (if-let1 tab (%id-table eq)
+      (%lcs-matches (%elements->ids A tab) (%elements->ids B tab) patience?)
+      (begin
+        (when patience?
+          (error "patience algorithm requires an equality predicate \
+                  that can be hashed, but got:" eq))
+        (map (^e (cons (cadr e) (caddr e)))
+             (cadr (%lcs-with-positions-generic
+                    (vector->list A) (vector->list B)
+                    (if (comparator? eq)
+                      (comparator-equality-predicate eq)
+                      eq))))))))
+
+;; The fallback algorithm.   This code implements
 ;; Eugene Myers, "An O(ND) Difference Algorithm and Its Variations",
 ;; Algorithmica Vol. 1 No. 2, 1986, pp. 251-266.
 ;; It takes O((M+N)D) time and O((M+N)L) space, where
@@ -57,8 +105,10 @@
 ;; The worst case where a and b totally differ is O((M+N)^2).
 ;; The Myers's paper gives refinement of the algorithm
 ;; that improves worst case behavior, but I don't implement it yet. --[SK]
+;; (The native one in util.lcs-core does.  This one is only used for
+;; equality predicates we can't hash.)
 
-(define (lcs-with-positions a-ls b-ls :optional (eq equal?))
+(define (%lcs-with-positions-generic a-ls b-ls eq)
   (let* ((A  (list->vector a-ls))
          (B  (list->vector b-ls))
          (N  (vector-length A))
@@ -122,14 +172,22 @@
             )))
       )))
 
+;; Returns (length ((elt a-pos b-pos) ...)).
+(define (lcs-with-positions a b :optional (eq equal?) (algorithm 'myers))
+  (let* ([A (if (vector? a) a (list->vector a))]
+         [ms (lcs-matches A b eq algorithm)])
+    (list (length ms)
+          (map (^m (list (vector-ref A (car m)) (car m) (cdr m))) ms))))
+
 ;; Just returns the LCS
-(define (lcs a b :optional (eq equal?))
-  (map car (cadr (lcs-with-positions a b eq))))
+(define (lcs a b :optional (eq equal?) (algorithm 'myers))
+  (map car (cadr (lcs-with-positions a b eq algorithm))))
 
 ;; Fundamental iterator to deal with editlist.
 ;;   Similar to Perl's Algorith::Diff's traverse_sequence.
-(define (lcs-fold a-only b-only both seed a b :optional (eq equal?))
-  (let1 common (cadr (lcs-with-positions a b eq))
+(define (lcs-fold a-only b-only both seed a b
+                  :optional (eq equal?) (algorithm 'myers))
+  (let1 common (cadr (lcs-with-positions a b eq algorithm))
     ;; Calculates edit-list from the LCS.
     ;; Loop parameters:
     ;;   common - list of common elements
@@ -163,12 +221,12 @@
 ;; The return value is a list of hunks, where each hunk is a
 ;; list of edit commands, (<command> <index> <element>).
 
-(define (lcs-edit-list a b . opt-eq)
+(define (lcs-edit-list a b :optional (eq equal?) (algorithm 'myers))
   (define a-pos -1)  ;; we use pre-increment, so begin from -1.
   (define b-pos -1)  ;; ditto
   (define hunks '())
   (let1 last
-      (apply lcs-fold
+      (lcs-fold
              (lambda (elt hunk)  ;; a-only - remove
                (inc! a-pos) `((- ,a-pos ,elt) ,@hunk))
              (lambda (elt hunk)  ;; b-only - add
@@ -178,7 +236,7 @@
                (unless (null? hunk) (push! hunks (reverse! hunk)))
                '())
              '()
-             a b opt-eq)
+             a b eq algorithm)
     (unless (null? last) (push! hunks (reverse! last))))
   (reverse! hunks))
 
@@ -36,6 +36,7 @@
   (use srfi-133)
   (use gauche.array)
   (use gauche.sequence)
+  (use util.levenshtein-core)
   (export l-distance l-distances
           re-distance re-distances
           dl-distance dl-distances))
@@ -146,11 +147,45 @@
 
     (map f Bs)))
       
+
+;; Native Levenshtein
+;;
+;; util.levenshtein-core implements the bit-parallel algorithm of Myers
+;; (JACM 46(3), 1999), which computes a whole column of the matrix with
+;; a few word operations per 64 elements of A.  It works on integer
+;; codes, so we can use it if A and Bs are strings compared by character
+;; equality, or the elements can be mapped to integer ids with a hash
+;; table.  The preprocessed A is shared among all Bs.  L-base is the
+;; fallback for other equality predicates.
+
+(define (l-native A Bs elt= cutoff)
+  (define (ids seq tab)
+    (vector-map (^e (or (hash-table-get tab e #f)
+                        (rlet1 id (hash-table-num-entries tab)
+                          (hash-table-put! tab e id))))
+                (coerce-to <vector> seq)))
+  (define table-type
+    (cond [(eq? elt= eqv?) 'eqv?]
+          [(eq? elt= eq?) 'eq?]
+          [(eq? elt= equal?) 'equal?]
+          [else #f]))
+  (cond
+   [(and cutoff (not (and (fixnum? cutoff) (>= cutoff 0)))) #f]
+   [(and (or table-type (eq? elt= char=?))
+         (string? A) (every string? Bs))
+    (%l-distances A Bs cutoff)]
+   [table-type
+    (let1 tab (make-hash-table table-type)
+      (%l-distances (ids A tab) (map (cut ids <> tab) Bs) cutoff))]
+   [else #f]))
+
 (define (l-distance A B :key (elt= eqv?) (cutoff #f))
-  (car (l-base A (list B) elt= cutoff)))
+  (car (or (l-native A (list B) elt= cutoff)
+           (l-base A (list B) elt= cutoff))))
 
 (define (l-distances A Bs  :key (elt= eqv?) (cutoff #f))
-  (l-base A Bs elt= cutoff))
+  (or (l-native A Bs elt= cutoff)
+      (l-base A Bs elt= cutoff)))
 
 ;; Restricted Edit distance
 ;;
@@ -0,0 +1,339 @@
+;;;
+;;; www.cgi.server - run CGI handlers as a FastCGI/SCGI application
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; The web server talks to us over a socket; each request it forwards
+;; carries the CGI metavariables and the request body.  We run cgi-main
+;; for each request with cgi-metavariables, the current input port and
+;; the current output port rebound, so the same handler works either
+;; as a plain CGI script or in a long-lived process.
+;;
+;; FastCGI records are read in order and only one request is handled
+;; per connection at a time (we report FCGI_MPXS_CONNS = 0); the web
+;; server may keep the connection for subsequent requests.  SCGI closes
+;; the connection after each response.
+
+(define-module www.cgi.server
+  (use gauche.net)
+  (use gauche.threads)
+  (use gauche.uvector)
+  (use gauche.vport)
+  (use binary.io)
+  (use control.thread-pool)
+  (use www.cgi)
+  (export cgi-server-main))
+(select-module www.cgi.server)
+
+;;----------------------------------------------------------------
+;; API: cgi-server-main proc &keyword protocol port path host
+;;                                    workers max-requests
+;;                                    and cgi-main keywords
+(define (cgi-server-main proc :key (protocol 'fastcgi)
+                                   (port #f) (path #f) (host #f)
+                                   (workers 0) (max-requests #f)
+                         :allow-other-keys cgi-main-options)
+  (define serve
+    (case protocol
+      [(fastcgi) fcgi-serve-connection]
+      [(scgi) scgi-serve-connection]
+      [else (error "protocol must be either fastcgi or scgi, but got:"
+                   protocol)]))
+  (define listeners
+    (cond [path (list (make-server-socket 'unix path))]
+          [port (make-server-sockets host port :reuse-addr? #t)]
+          [else (error "cgi-server-main requires either :port or :path")]))
+  (define pool (and (> workers 0) (make-thread-pool workers)))
+  (define counter (make-request-counter max-requests))
+
+  (define (handle-request env input output)
+    (parameterize ([cgi-metavariables env]
+                   [cgi-temporary-files '()])
+      (with-ports input output (current-error-port)
+        (^[] (apply cgi-main proc cgi-main-options)))))
+
+  (define (handle-client client)
+    (guard (e [else (unless (<system-error> e) (report-error e))])
+      (serve client handle-request counter))
+    (socket-close client))
+
+  (define (accept-from listener)
+    (let1 client (socket-accept listener)
+      (if pool
+        (add-job! pool (cut handle-client client))
+        (handle-client client))))
+
+  (unwind-protect
+      (let loop ()
+        (unless (counter 'done?)
+          ;; Wake up periodically so that we notice the request limit
+          ;; reached in a worker thread.
+          (receive (nfds rfds . _)
+              (sys-select (apply sys-fdset (map socket-fd listeners))
+                          #f #f 1000000)
+            (when (> nfds 0)
+              (dolist [s listeners]
+                (when (sys-fdset-ref rfds (socket-fd s))
+                  (accept-from s)))))
+          (loop)))
+    (begin
+      (when pool (terminate-all! pool))
+      (for-each socket-close listeners)
+      (when (and path (file-exists? path)) (sys-unlink path))))
+  0)
+
+;; Counts handled requests against the limit (#f for no limit).
+;; Called from worker threads as well.
+(define (make-request-counter limit)
+  (let ([mutex (make-mutex)]
+        [count 0])
+    (^[msg]
+      (with-locking-mutex mutex
+        (^[] (case msg
+               [(done?) (and limit (>= count limit))]
+               [(count!) (inc! count) (and limit (>= count limit))]))))))
+
+;; Read exactly N octets, or raise an error on premature EOF.
+(define (read-octets n in)
+  (rlet1 buf (make-u8vector n)
+    (let loop ([pos 0])
+      (when (< pos n)
+        (let1 r (read-uvector! buf in pos)
+          (when (eof-object? r)
+            (error "unexpected EOF from the web server"))
+          (loop (+ pos r)))))))
+
+;;----------------------------------------------------------------
+;; FastCGI
+;;
+
+(define-constant FCGI_VERSION_1           1)
+(define-constant FCGI_BEGIN_REQUEST       1)
+(define-constant FCGI_ABORT_REQUEST       2)
+(define-constant FCGI_END_REQUEST         3)
+(define-constant FCGI_PARAMS              4)
+(define-constant FCGI_STDIN               5)
+(define-constant FCGI_STDOUT              6)
+(define-constant FCGI_GET_VALUES          9)
+(define-constant FCGI_GET_VALUES_RESULT  10)
+(define-constant FCGI_UNKNOWN_TYPE       11)
+
+(define-constant FCGI_RESPONDER           1)
+(define-constant FCGI_KEEP_CONN           1)
+
+(define-constant FCGI_REQUEST_COMPLETE    0)
+(define-constant FCGI_CANT_MPX_CONN       1)
+(define-constant FCGI_UNKNOWN_ROLE        3)
+
+;; Max content length of a record we write.
+(define-constant FCGI_CHUNK_SIZE      32768)
+
+;; Returns type, request id and content, or #f at EOF.
+(define (fcgi-read-record in)
+  (let1 version (read-u8 in)
+    (if (eof-object? version)
+      (values #f #f #f)
+      (let* ([hdr (read-octets 7 in)]
+             [clen (get-u16be hdr 3)]
+             [content (read-octets clen in)])
+        (unless (= version FCGI_VERSION_1)
+          (errorf "unsupported FastCGI protocol version: ~a" version))
+        (read-octets (u8vector-ref hdr 5) in) ; padding
+        (values (u8vector-ref hdr 0) (get-u16be hdr 1) content)))))
+
+(define (fcgi-write-record out type id content
+                           :optional (start 0) (end (u8vector-length content)))
+  (let* ([len (- end start)]
+         [pad (logand (- len) 7)]
+         [hdr (make-u8vector 8 0)])
+    (u8vector-set! hdr 0 FCGI_VERSION_1)
+    (u8vector-set! hdr 1 type)
+    (put-u16be! hdr 2 id)
+    (put-u16be! hdr 4 len)
+    (u8vector-set! hdr 6 pad)
+    (write-uvector hdr out)
+    (write-uvector content out start end)
+    (write-uvector (make-u8vector pad 0) out)))
+
+(define (fcgi-write-stream out type id data)
+  (let1 len (u8vector-length data)
+    (let loop ([pos 0])
+      (when (< pos len)
+        (let1 end (min len (+ pos FCGI_CHUNK_SIZE))
+          (fcgi-write-record out type id data pos end)
+          (loop end))))))
+
+(define (fcgi-end-request out id protocol-status)
+  (let1 body (make-u8vector 8 0)
+    (u8vector-set! body 4 protocol-status)
+    (fcgi-write-record out FCGI_END_REQUEST id body)
+    (flush out)))
+
+;; Name-value pairs.  Each length is either one octet, or four octets
+;; with the high bit set.
+(define (fcgi-decode-params v)
+  (define len (u8vector-length v))
+  (define (length-at pos)
+    (let1 b (u8vector-ref v pos)
+      (if (< b 128)
+        (values b (+ pos 1))
+        (values (logand (get-u32be v pos) #x7fffffff) (+ pos 4)))))
+  (let loop ([pos 0] [r '()])
+    (if (>= pos len)
+      (reverse! r)
+      (receive (nlen pos) (length-at pos)
+        (receive (vlen pos) (length-at pos)
+          (let ([vpos (+ pos nlen)]
+                [end  (+ pos nlen vlen)])
+            (loop end
+                  (cons (list (u8vector->string v pos vpos)
+                              (u8vector->string v vpos end))
+                        r))))))))
+
+(define (fcgi-encode-params params)
+  (define (encode-length n)
+    (if (< n 128)
+      (u8vector n)
+      (rlet1 v (make-u8vector 4)
+        (put-u32be! v 0 (logior n #x80000000)))))
+  (apply u8vector-append
+         (map (^p (let ([n (string->u8vector (car p))]
+                        [v (string->u8vector (cadr p))])
+                    (u8vector-append (encode-length (u8vector-length n))
+                                     (encode-length (u8vector-length v))
+                                     n v)))
+              params)))
+
+;; Answers FCGI_GET_VALUES.  Variables we don't know are omitted,
+;; as the spec says.
+(define (fcgi-get-values out content)
+  (define known '(("FCGI_MPXS_CONNS" "0")))
+  (fcgi-write-record out FCGI_GET_VALUES_RESULT 0
+                     (fcgi-encode-params
+                      (filter-map (^p (assoc (car p) known))
+                                  (fcgi-decode-params content))))
+  (flush out))
+
+;; An output port that sends whatever the handler writes as
+;; FCGI_STDOUT records.
+(define (fcgi-stdout-port out id)
+  (make <buffered-output-port>
+    :flush (^[buf _]
+             (fcgi-write-stream out FCGI_STDOUT id buf)
+             (u8vector-length buf))))
+
+(define (fcgi-serve-connection client handle-request counter)
+  (define in  (socket-input-port client :buffering :full))
+  (define out (socket-output-port client :buffering :full))
+
+  (define (respond id params stdin)
+    (let1 port (fcgi-stdout-port out id)
+      (handle-request (fcgi-decode-params (apply u8vector-append params))
+                      (open-input-uvector (apply u8vector-append stdin))
+                      port)
+      (close-output-port port)
+      (fcgi-write-record out FCGI_STDOUT id (u8vector))
+      (fcgi-end-request out id FCGI_REQUEST_COMPLETE)))
+
+  ;; Between requests, REQ is #f.  Otherwise it is a list of
+  ;; (id keep-conn? params stdin), the latter two being reversed lists
+  ;; of the content received so far.
+  (let loop ([req #f])
+    (receive (type id content) (fcgi-read-record in)
+      (cond
+       [(not type)]                     ;EOF
+       [(zero? id)                      ;management record
+        (if (eqv? type FCGI_GET_VALUES)
+          (fcgi-get-values out content)
+          (let1 body (make-u8vector 8 0)
+            (u8vector-set! body 0 type)
+            (fcgi-write-record out FCGI_UNKNOWN_TYPE 0 body)
+            (flush out)))
+        (loop req)]
+       [(eqv? type FCGI_BEGIN_REQUEST)
+        (cond [req (fcgi-end-request out id FCGI_CANT_MPX_CONN) (loop req)]
+              [(= (get-u16be content 0) FCGI_RESPONDER)
+               (loop (list id
+                           (logtest (u8vector-ref content 2) FCGI_KEEP_CONN)
+                           '() '()))]
+              [else (fcgi-end-request out id FCGI_UNKNOWN_ROLE) (loop req)])]
+       [(not (and req (= id (car req)))) (loop req)] ;stale; ignore
+       [else
+        (let ([keep? (cadr req)] [params (caddr req)] [stdin (cadddr req)])
+          (cond
+           [(eqv? type FCGI_PARAMS)
+            (loop (list id keep? (cons content params) stdin))]
+           [(and (eqv? type FCGI_STDIN) (positive? (u8vector-length content)))
+            (loop (list id keep? params (cons content stdin)))]
+           [(eqv? type FCGI_STDIN)      ;end of stdin; run the handler
+            (respond id (reverse! params) (reverse! stdin))
+            (let1 done? (counter 'count!)
+              (when (and keep? (not done?))
+                (loop #f)))]
+           [(eqv? type FCGI_ABORT_REQUEST)
+            (fcgi-end-request out id FCGI_REQUEST_COMPLETE)
+            (when keep? (loop #f))]
+           [else (loop req)]))]))))
+
+;;----------------------------------------------------------------
+;; SCGI
+;;
+;; The request starts with a netstring of NUL-terminated header names
+;; and values, CONTENT_LENGTH being the first, followed by the body.
+
+(define (scgi-read-headers in)
+  (define len
+    (let loop ([n 0])
+      (let1 c (read-u8 in)
+        (cond [(eof-object? c) (and (zero? n) c)]
+              [(<= 48 c 57) (loop (+ (* n 10) (- c 48)))]
+              [(= c 58) n]              ; #\:
+              [else (error "malformed SCGI request")]))))
+  (cond
+   [(eof-object? len) #f]
+   [else
+    (let* ([v (read-octets len in)]
+           [strs (string-split (u8vector->string v) #\null)])
+      (unless (eqv? (read-u8 in) 44)    ; #\,
+        (error "malformed SCGI request"))
+      ;; The netstring ends with NUL, so the last element is empty.
+      (let loop ([strs strs] [r '()])
+        (if (or (null? strs) (null? (cdr strs)))
+          (reverse! r)
+          (loop (cddr strs) (cons (list (car strs) (cadr strs)) r)))))]))
+
+(define (scgi-serve-connection client handle-request counter)
+  (let* ([in  (socket-input-port client :buffering :full)]
+         [out (socket-output-port client :buffering :full)])
+    (and-let1 env (scgi-read-headers in)
+      (handle-request env in out)
+      (flush out)
+      (counter 'count!))))
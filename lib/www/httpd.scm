@@ -0,0 +1,466 @@
+;;;
+;;; www.httpd - event-driven HTTP/1.1 server
+;;;
+;;;   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+;;;
+;;;   Redistribution and use in source and binary forms, with or without
+;;;   modification, are permitted provided that the following conditions
+;;;   are met:
+;;;
+;;;   1. Redistributions of source code must retain the above copyright
+;;;      notice, this list of conditions and the following disclaimer.
+;;;
+;;;   2. Redistributions in binary form must reproduce the above copyright
+;;;      notice, this list of conditions and the following disclaimer in the
+;;;      documentation and/or other materials provided with the distribution.
+;;;
+;;;   3. Neither the name of the authors nor the names of its contributors
+;;;      may be used to endorse or promote products derived from this
+;;;      software without specific prior written permission.
+;;;
+;;;   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+;;;   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+;;;   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+;;;   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+;;;   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+;;;   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+;;;   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+;;;   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+;;;   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+;;;   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+;;;   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+;;;
+
+;; A single thread runs the selector loop; it accepts connections,
+;; reads requests from non-blocking sockets, and parses them with
+;; rfc.http-parser.  Once a request is complete, the connection
+;; leaves the selector while the handler runs and writes the response,
+;; either in the loop thread or, with :workers, in a thread pool.
+;; In the latter case the worker hands the connection back through
+;; a queue and wakes up the loop by a pipe.  Requests pipelined by the
+;; client are simply found in the buffer after the previous one.
+;;
+;; Writes block (waiting on the socket with select) until the whole
+;; response is sent, so with no workers a slow client holds up the
+;; loop while its response is going out.
+
+(define-module www.httpd
+  (use gauche.net)
+  (use gauche.selector)
+  (use gauche.threads)
+  (use gauche.uvector)
+  (use data.queue)
+  (use control.thread-pool)
+  (use rfc.822)
+  (use rfc.http)
+  (use rfc.http-parser)
+  (use text.tree)
+  (use util.match)
+  (export <httpd> make-httpd httpd-listen! httpd-start! httpd-stop!
+          httpd-port
+
+          <httpd-request> httpd-request-method httpd-request-target
+          httpd-request-path httpd-request-query httpd-request-version
+          httpd-request-headers httpd-request-header-ref
+          httpd-request-body httpd-request-remote-address))
+(select-module www.httpd)
+
+;;==============================================================
+;; Server
+;;
+
+(define-class <httpd> ()
+  ;; All slots are private.
+  ((handler       :init-keyword :handler)
+   (host          :init-keyword :host)
+   (port          :init-keyword :port)
+   (workers       :init-keyword :workers)
+   (keep-alive-timeout :init-keyword :keep-alive-timeout) ; seconds
+   (send-timeout  :init-keyword :send-timeout)       ; seconds
+   (max-head-size :init-keyword :max-head-size)      ; bytes
+   (max-body-size :init-keyword :max-body-size)      ; bytes
+   (sockets       :init-value '())       ; listening sockets
+   (selector      :init-value #f)
+   (pool          :init-value #f)        ; <thread-pool> if workers > 0
+   (finished      :init-form (make-mtqueue)) ; (conn . keep?) from workers
+   (wakeup        :init-value #f)        ; (in . out) of a pipe
+   (conns         :init-form (make-hash-table 'eqv?)) ; fd -> conn
+   (stopping      :init-value #f)
+   ))
+
+(define (make-httpd handler :key (host #f) (port 8080) (workers 0)
+                    (keep-alive-timeout 15) (send-timeout 60)
+                    (max-head-size 65536) (max-body-size 10485760))
+  (make <httpd> :handler handler :host host :port port :workers workers
+        :keep-alive-timeout keep-alive-timeout :send-timeout send-timeout
+        :max-head-size max-head-size :max-body-size max-body-size))
+
+;; Binds the listening sockets, if not yet.  Separated from httpd-start!
+;; so that the caller can find the port when it passed 0.
+(define (httpd-listen! httpd)
+  (when (null? (~ httpd'sockets))
+    (set! (~ httpd'sockets)
+          (make-server-sockets (~ httpd'host) (~ httpd'port)
+                               :reuse-addr? #t)))
+  httpd)
+
+(define (httpd-port httpd)
+  (and-let* ([ (pair? (~ httpd'sockets)) ]
+             [a (socket-address (car (~ httpd'sockets)))]
+             [ (memq (sockaddr-family a) '(inet inet6)) ])
+    (sockaddr-port a)))
+
+;; Runs the loop until httpd-stop! is called.
+(define (httpd-start! httpd)
+  (httpd-listen! httpd)
+  (let ([sel (make <selector>)]
+        [n (~ httpd'workers)])
+    (set! (~ httpd'selector) sel)
+    (set! (~ httpd'stopping) #f)
+    (when (> n 0)
+      (set! (~ httpd'pool) (make-thread-pool n)))
+    (receive (in out) (sys-pipe)
+      (set! (~ httpd'wakeup) (cons in out))
+      (selector-add! sel in (^[p flag] (drain-finished! httpd)) '(r)))
+    (dolist [s (~ httpd'sockets)]
+      (selector-add! sel (socket-fd s) (^[fd flag] (accept! httpd s)) '(r)))
+    (unwind-protect
+        (let loop ()
+          (unless (~ httpd'stopping)
+            (selector-select sel 1000000)
+            (sweep-idle! httpd)
+            (loop)))
+      (shutdown! httpd))))
+
+;; Can be called from any thread, including handlers.
+(define (httpd-stop! httpd)
+  (set! (~ httpd'stopping) #t)
+  (wakeup! httpd))
+
+(define (wakeup! httpd)
+  (and-let* ([p (~ httpd'wakeup)])
+    (write-byte 0 (cdr p))
+    (flush (cdr p))))
+
+(define (shutdown! httpd)
+  (when (~ httpd'pool)
+    (terminate-all! (~ httpd'pool))
+    (set! (~ httpd'pool) #f))
+  (for-each (cut close-conn! httpd <>) (hash-table-values (~ httpd'conns)))
+  (dolist [s (~ httpd'sockets)] (socket-close s))
+  (set! (~ httpd'sockets) '())
+  (and-let* ([p (~ httpd'wakeup)])
+    (close-port (car p))
+    (close-port (cdr p))
+    (set! (~ httpd'wakeup) #f))
+  (set! (~ httpd'selector) #f))
+
+;;==============================================================
+;; Connections
+;;
+
+(define-record-type conn %make-conn #t
+  (socket)                              ; client <socket>
+  (fd)
+  (addr)                                ; peer <sockaddr>
+  (buf)                                 ; u8vector of received data
+  (fill)                                ; # of bytes in buf
+  (watching)                            ; #t while in the selector
+  (continued)                           ; #t if we've sent 100 Continue
+  (last-active))                        ; sys-time
+
+(define-constant +read-size+ 16384)
+
+(define (would-block? e)
+  (and (<system-error> e)
+       (memv (~ e'errno) `(,EAGAIN ,EWOULDBLOCK))))
+
+(define (accept! httpd sock)
+  (and-let* ([s (guard (e [(<system-error> e) #f])
+                  (socket-accept sock :nonblocking #t :cloexec #t))])
+    (let1 c (%make-conn s (socket-fd s) (socket-address s)
+                        (make-u8vector +read-size+) 0 #f #f (sys-time))
+      (hash-table-put! (~ httpd'conns) (conn-fd c) c)
+      (watch! httpd c))))
+
+(define (watch! httpd c)
+  (unless (conn-watching c)
+    (conn-watching-set! c #t)
+    (selector-add! (~ httpd'selector) (conn-fd c)
+                   (^[fd flag] (on-readable! httpd c)) '(r))))
+
+(define (unwatch! httpd c)
+  (when (conn-watching c)
+    (conn-watching-set! c #f)
+    (selector-delete! (~ httpd'selector) (conn-fd c) #f '(r))))
+
+(define (close-conn! httpd c)
+  (unwatch! httpd c)
+  (hash-table-delete! (~ httpd'conns) (conn-fd c))
+  (guard (e [(<system-error> e) #f])
+    (socket-shutdown (conn-socket c)))
+  (socket-close (conn-socket c)))
+
+;; Connections being served aren't watched, and aren't subject to
+;; the timeout.
+(define (sweep-idle! httpd)
+  (let1 limit (- (sys-time) (~ httpd'keep-alive-timeout))
+    (dolist [c (hash-table-values (~ httpd'conns))]
+      (when (and (conn-watching c) (< (conn-last-active c) limit))
+        (close-conn! httpd c)))))
+
+(define (on-readable! httpd c)
+  (let* ([buf (ensure-room! c +read-size+)]
+         [n (guard (e [(would-block? e) #f]
+                      [(<system-error> e) 0])
+              (socket-recv! (conn-socket c)
+                            (uvector-alias <u8vector> buf (conn-fill c))))])
+    (cond [(not n)]
+          [(zero? n) (close-conn! httpd c)]
+          [else (conn-fill-set! c (+ (conn-fill c) n))
+                (conn-last-active-set! c (sys-time))
+                (process-input! httpd c)])))
+
+(define (ensure-room! c size)
+  (let ([buf (conn-buf c)]
+        [fill (conn-fill c)])
+    (if (<= (+ fill size) (u8vector-length buf))
+      buf
+      (rlet1 new (make-u8vector (max (* 2 (u8vector-length buf))
+                                     (+ fill size)))
+        (u8vector-copy! new 0 buf 0 fill)
+        (conn-buf-set! c new)))))
+
+;; Drops the first K bytes of the buffer, keeping what follows (the next
+;; pipelined request, if any).
+(define (consume! c k)
+  (let ([buf (conn-buf c)]
+        [rest (- (conn-fill c) k)])
+    (if (and (> (u8vector-length buf) (* 4 +read-size+)) (< rest +read-size+))
+      (rlet1 new (make-u8vector +read-size+)
+        (u8vector-copy! new 0 buf k (conn-fill c))
+        (conn-buf-set! c new))
+      (u8vector-copy! buf 0 buf k (conn-fill c)))
+    (conn-fill-set! c rest)
+    (conn-continued-set! c #f)))
+
+(define (process-input! httpd c)
+  (match (guard (e [(<error> e) 400]) (parse-request httpd c))
+    [#f (watch! httpd c)]
+    [(? integer? status)
+     (unwatch! httpd c)
+     (guard (e [(<system-error> e) #f])
+       (send-response httpd (conn-socket c) #f status '()
+                      #"~(status-reason status)\n"))
+     (close-conn! httpd c)]
+    [req
+     (unwatch! httpd c)
+     (dispatch! httpd c req)]))
+
+(define (dispatch! httpd c req)
+  (if-let1 pool (~ httpd'pool)
+    (add-job! pool (^[]
+                     (let1 keep? (serve httpd c req)
+                       (enqueue! (~ httpd'finished) (cons c keep?))
+                       (wakeup! httpd))))
+    (resume! httpd c (serve httpd c req))))
+
+(define (resume! httpd c keep?)
+  (cond [(not keep?) (close-conn! httpd c)]
+        [else (conn-last-active-set! c (sys-time))
+              (process-input! httpd c)]))
+
+(define (drain-finished! httpd)
+  (let1 in (car (~ httpd'wakeup))
+    (let loop ()
+      (when (byte-ready? in) (read-byte in) (loop))))
+  (dolist [e (dequeue-all! (~ httpd'finished))]
+    (resume! httpd (car e) (cdr e))))
+
+;;==============================================================
+;; Requests
+;;
+
+(define-class <httpd-request> ()
+  ((method  :init-keyword :method  :getter httpd-request-method)  ; "GET" etc.
+   (target  :init-keyword :target  :getter httpd-request-target)  ; as sent
+   (path    :init-keyword :path    :getter httpd-request-path)
+   (query   :init-keyword :query   :getter httpd-request-query)   ; or #f
+   (version :init-keyword :version :getter httpd-request-version) ; "1.1" etc.
+   (headers :init-keyword :headers :getter httpd-request-headers)
+   (body    :init-keyword :body    :getter httpd-request-body)    ; u8vector/#f
+   (remote-address :init-keyword :remote-address
+                   :getter httpd-request-remote-address)
+   ))
+
+(define (httpd-request-header-ref req name :optional (default #f))
+  (rfc822-header-ref (httpd-request-headers req) name default))
+
+;; Returns #f if we need more data, an integer status code if we
+;; should reject the request, or an <httpd-request>.
+(define (parse-request httpd c)
+  (define buf (conn-buf c))
+  (define fill (conn-fill c))
+  (define max-body (~ httpd'max-body-size))
+
+  (define (make-request method target version headers body end)
+    (consume! c end)
+    (receive (path query) (string-scan target #\? 'both)
+      (make <httpd-request>
+        :method method :target target
+        :path (or path target) :query query
+        :version version :headers headers :body body
+        :remote-address (conn-addr c))))
+
+  ;; The data has been checked until the previous call, but we don't keep
+  ;; the parser state; scanning chunk headers again is cheap.
+  (define (chunked-body start)
+    (let loop ([pos start] [chunks '()] [total 0])
+      (match (receive r (http-parse-chunk buf pos fill) r)
+        [(#f) (values #f #f)]
+        [(_ 0 next) (values (concat-chunks (reverse chunks) total) next)]
+        [(data size next)
+         (if (> (+ total size) max-body)
+           (values 413 #f)
+           (loop next (acons data size chunks) (+ total size)))])))
+
+  (define (concat-chunks chunks total)
+    (rlet1 v (make-u8vector total)
+      (let loop ([chunks chunks] [k 0])
+        (match chunks
+          [() #t]
+          [((data . size) . rest)
+           (u8vector-copy! v k buf data (+ data size))
+           (loop rest (+ k size))]))))
+
+  (define (maybe-continue headers)
+    (when (and (not (conn-continued c))
+               (equal? (rfc822-header-ref headers "expect") "100-continue"))
+      (conn-continued-set! c #t)
+      (send-all httpd (conn-socket c) "HTTP/1.1 100 Continue\r\n\r\n"))
+    #f)
+
+  (match (receive r (http-parse-request-head buf 0 fill) r)
+    [(#f) (and (> fill (~ httpd'max-head-size)) 431)]
+    [(method target version headers next)
+     (let ([te (rfc822-header-ref headers "transfer-encoding")]
+           [cl (rfc822-header-ref headers "content-length")])
+       (cond
+        [(and te (not (string-ci=? te "chunked"))) 501]
+        [te (receive (body end) (chunked-body next)
+              (cond [(not body) (maybe-continue headers)]
+                    [(integer? body) body]
+                    [else (make-request method target version headers
+                                        body end)]))]
+        [cl (let1 len (and (#/^\d+$/ cl) (string->number cl))
+              (cond [(not len) 400]
+                    [(> len max-body) 413]
+                    [(<= (+ next len) fill)
+                     (make-request method target version headers
+                                   (u8vector-copy buf next (+ next len))
+                                   (+ next len))]
+                    [else (maybe-continue headers)]))]
+        [else (make-request method target version headers #f next)]))]))
+
+(define (keep-alive-request? req)
+  (let1 conn (and-let* ([v (httpd-request-header-ref req "connection")])
+               (string-downcase v))
+    (if (equal? (httpd-request-version req) "1.0")
+      (and conn (#/\bkeep-alive\b/ conn) #t)
+      (not (and conn (#/\bclose\b/ conn))))))
+
+;;==============================================================
+;; Responses
+;;
+
+;; The handler returns status, headers and body.  Headers are in the
+;; same format as httpd-request-headers.  Body may be #f, a string,
+;; a u8vector, or a procedure that takes a procedure to send a chunk;
+;; in the last case the response is sent in chunked encoding as the
+;; procedure generates it.
+;; Returns true if the connection can be kept.
+(define (serve httpd c req)
+  (match (guard (e [else (report-error e) '(500)])
+           (receive r ((~ httpd'handler) req) r))
+    [(status . opts)
+     (let-optionals* opts ([headers '()] [body #f])
+       ;; If we fail in the middle of the response, all we can do is
+       ;; to drop the connection.
+       (guard (e [else (unless (<system-error> e) (report-error e)) #f])
+         (send-response httpd (conn-socket c) req status headers body)))]))
+
+(define (send-response httpd sock req status headers body)
+  (define http/1.0? (and req (equal? (httpd-request-version req) "1.0")))
+  (define keep? (and req
+                     (keep-alive-request? req)
+                     (not (and-let* ([v (rfc822-header-ref headers
+                                                           "connection")])
+                            (#/\bclose\b/i v)))
+                     (not (and (procedure? body) http/1.0?))))
+  (define body-allowed? (not (memv status '(204 304))))
+  (define (head extra)
+    (tree->string
+     `(,#"HTTP/1.1 ~status ~(status-reason status)\r\n"
+       ,@(map (^h `(,(x->string (car h)) ": " ,(x->string (cadr h)) "\r\n"))
+              (remove (^h (string-ci=? (x->string (car h)) "connection"))
+                      headers))
+       ,@(map (^h `(,(car h) ": " ,(cadr h) "\r\n")) extra)
+       ,(cond [(not keep?) "Connection: close\r\n"]
+              [http/1.0? "Connection: keep-alive\r\n"]
+              [else ""])
+       "\r\n")))
+  (define send-body? (and body-allowed?
+                          (not (and req
+                                    (equal? (httpd-request-method req)
+                                            "HEAD")))))
+  (cond
+   [(procedure? body)
+    (send-all httpd sock (head (cond [(not body-allowed?) '()]
+                                     [http/1.0? '()]
+                                     [else '(("transfer-encoding"
+                                              "chunked"))])))
+    (when send-body?
+      (body (^[data]
+              (let1 v (->u8vector data)
+                (cond [(zero? (u8vector-length v))]
+                      [http/1.0? (send-all httpd sock v)]
+                      [else (send-all httpd sock
+                                      (format "~x\r\n" (u8vector-length v)))
+                            (send-all httpd sock v)
+                            (send-all httpd sock "\r\n")]))))
+      (unless http/1.0? (send-all httpd sock "0\r\n\r\n")))]
+   [else
+    (let* ([v (and body (->u8vector body))]
+           [h (string->u8vector
+               (head (if body-allowed?
+                       `(("content-length"
+                          ,(number->string (if v (u8vector-length v) 0))))
+                       '())))])
+      (send-all httpd sock (if (and v send-body?) (u8vector-append h v) h)))])
+  keep?)
+
+(define (status-reason status)
+  (or (http-status-code->description status)
+      (case status
+        [(431) "Request Header Fields Too Large"]
+        [else ""])))
+
+(define (->u8vector data)
+  (cond [(u8vector? data) data]
+        [(string? data) (string->u8vector data)]
+        [else (error "response body must be a string or a u8vector, \
+                      but got:" data)]))
+
+;; SOCK is non-blocking.
+(define (send-all httpd sock data)
+  (define timeout (* (~ httpd'send-timeout) 1000000))
+  (let loop ([v (->u8vector data)])
+    (let1 n (guard (e [(would-block? e) 0]) (socket-send sock v))
+      (unless (= n (u8vector-length v))
+        (when (zero? n)
+          (let1 fds (sys-fdset (socket-fd sock))
+            (receive (nfds . _) (sys-select! #f fds #f timeout)
+              (when (zero? nfds)
+                (error "timed out sending response to"
+                       (socket-address sock))))))
+        (loop (uvector-alias <u8vector> v n))))))
@@ -44,6 +44,7 @@
   (use util.match)
   (use gauche.parameter)
   (export current-directory directory-list directory-list2 directory-fold
+          directory-entry-generator
           home-directory temporary-directory
           make-directory* create-directory* remove-directory* delete-directory*
           copy-directory*
@@ -160,26 +161,76 @@
       (partition selector (map (cut build-path dir <>) entries))
       (partition (^e (selector (build-path dir e))) entries))))
 
+;; Generates entry names of DIR except "." and "..", in the order the
+;; system returns.  With WITH-TYPE?, generates (name . type), where type
+;; is the file type as in file-type without following symlinks, or #f if
+;; the system doesn't tell it without stat.
+(define (directory-entry-generator dir :key (with-type? #f))
+  (let1 d (sys-opendir dir)
+    (rec (gen)
+      (if (not d)
+        (eof-object)
+        (receive (name type) (sys-readdir-entry d)
+          (cond [(eof-object? name) (sys-closedir d) (set! d #f) name]
+                [(member name '("." "..")) (gen)]
+                [with-type? (cons name type)]
+                [else name]))))))
+
+;; Reads all entries of an open <sys-dir> D, and returns a list of
+;; (name . directory?) sorted by name.  We only stat the entries whose
+;; type isn't given by readdir, or symlinks when we follow them.
+(define (%directory-entries d follow-link?)
+  (define (stat-dir? name follow?)
+    (guard (e [(and (<system-error> e) (eq? (ref e 'errno) ENOENT)) #f])
+      (eq? (slot-ref (sys-dir-stat d name follow?) 'type) 'directory)))
+  (let loop ([r '()])
+    (receive (name type) (sys-readdir-entry d)
+      (cond [(eof-object? name) (sort! r string<? car)]
+            [(member name '("." "..")) (loop r)]
+            [else
+             (loop (acons name
+                          (case type
+                            [(directory) #t]
+                            [(symlink) (and follow-link? (stat-dir? name #t))]
+                            [(#f) (stat-dir? name follow-link?)]
+                            [else #f])
+                          r))]))))
+
 ;; directory-fold DIR PROC KNIL &keyword LISTER FOLDER FOLLOW-LINK?
 (define (directory-fold dir proc knil
-                        :key (lister (lambda (path knil)
-                                       (values (directory-list path
-                                                               :add-path? #t
-                                                               :children? #t)
-                                               knil)))
+                        :key (lister #f)
                              (folder fold)
                              (follow-link? #t))
   (define (selector e)
     (and (file-exists? e)
          (eq? (slot-ref (%stat e follow-link?) 'type) 'directory)))
+  (define lister*
+    (or lister
+        (lambda (path knil)
+          (values (directory-list path :add-path? #t :children? #t) knil))))
   (define (rec path knil)
     (if (selector path)
       ;; [TODO]: For the backward compatibiliy, we allow LISTER to return
       ;; only a single value.  Should be removed, probably in 0.9.
-      (receive res (lister path knil)
+      (receive res (lister* path knil)
         (folder rec (get-optional (cdr res) knil) (car res)))
       (proc path knil)))
-  (rec dir knil))
+  ;; With the default lister and folder, we walk the tree with directory
+  ;; streams.  Subdirectories are opened relative to the parent stream,
+  ;; and we don't need to stat entries whose type readdir tells.
+  (define (walk d path knil)
+    (fold (^[e knil]
+            (let1 p (build-path path (car e))
+              (if (cdr e)
+                (let1 sub (sys-opendir (car e) d)
+                  (unwind-protect (walk sub p knil) (sys-closedir sub)))
+                (proc p knil))))
+          knil (%directory-entries d follow-link?)))
+  (cond [(or lister (not (eq? folder fold))) (rec dir knil)]
+        [(selector dir)
+         (let1 d (sys-opendir dir)
+           (unwind-protect (walk d dir knil) (sys-closedir d)))]
+        [else (proc dir knil)]))
 
 ;; mkdir -p
 (define (make-directory* dir :optional (mode #o755))
@@ -37,6 +37,7 @@
 (define-module gauche.collection
   (use srfi-1)
   (export call-with-iterator with-iterator call-with-iterators
+          call-with-chunk-iterator
           call-with-builder  with-builder
           fold fold2 fold3 map map-to map-accum for-each
           fold$ fold2$ fold3$ map$ for-each$
@@ -126,6 +127,85 @@
       (with-iterator ((car colls) end? next)
         (loop (cdr colls) (cons end? eprocs) (cons next nprocs))))))
 
+;;-------------------------------------------------
+;; Call-with-chunk-iterator - bulk iteration
+;;
+
+;; Besides call-with-iterator, a collection class may define a method of
+;; call-with-chunk-iterator to hand out its elements in chunks.  PROC is called with a thunk,
+;; which returns a vector and the start and end indexes of the next
+;; elements in it, or #f, 0 and 0 if no elements are left.  The vector
+;; may be reused for the next chunk.  If the collection has the method,
+;; the single-collection cases of the derived operations below walk the
+;; chunks instead of calling end? and next for every element.
+
+(define-generic call-with-chunk-iterator)
+
+(define-method call-with-chunk-iterator ((coll <vector>) proc
+                                         :key (start 0) :allow-other-keys)
+  (let1 done #f
+    (proc (^[] (if done
+                 (values #f 0 0)
+                 (begin (set! done #t)
+                        (values coll start (vector-length coll))))))))
+
+(define-constant *chunk-size* 256)
+
+(define-method call-with-chunk-iterator ((coll <list>) proc
+                                         :key (start #f) :allow-other-keys)
+  (let ([p (if start (list-tail coll start) coll)]
+        [buf (make-vector *chunk-size*)])
+    (proc (^[] (let loop ([i 0])
+                 (if (or (= i *chunk-size*) (null? p))
+                   (values (and (> i 0) buf) 0 i)
+                   (begin (vector-set! buf i (pop! p))
+                          (loop (+ i 1)))))))))
+
+(define-method call-with-chunk-iterator ((coll <string>) proc
+                                         :key (start #f) :allow-other-keys)
+  (let ([s (open-input-string (if start (string-copy coll start) coll))]
+        [buf (make-vector *chunk-size*)])
+    (proc (^[] (let loop ([i 0])
+                 (let1 ch (if (= i *chunk-size*) (eof-object) (read-char s))
+                   (if (eof-object? ch)
+                     (values (and (> i 0) buf) 0 i)
+                     (begin (vector-set! buf i ch)
+                            (loop (+ i 1))))))))))
+
+(define (%chunked? coll)
+  (applicable? call-with-chunk-iterator (class-of coll) <procedure>))
+
+(define (%chunk-for-each proc coll)
+  (call-with-chunk-iterator coll
+    (^[next-chunk]
+      (let loop ()
+        (receive (v s e) (next-chunk)
+          (when v
+            (do ([i s (+ i 1)]) [(= i e)] (proc (vector-ref v i)))
+            (loop)))))))
+
+(define (%chunk-fold kons knil coll)
+  (call-with-chunk-iterator coll
+    (^[next-chunk]
+      (let loop ([seed knil])
+        (receive (v s e) (next-chunk)
+          (if v
+            (do ([i s (+ i 1)]
+                 [seed seed (kons (vector-ref v i) seed)])
+                [(= i e) (loop seed)])
+            seed))))))
+
+(define (%chunk-find pred coll)
+  (call-with-chunk-iterator coll
+    (^[next-chunk]
+      (let loop ()
+        (receive (v s e) (next-chunk)
+          (and v
+               (let inner ([i s])
+                 (cond [(= i e) (loop)]
+                       [(pred (vector-ref v i)) (vector-ref v i)]
+                       [else (inner (+ i 1))]))))))))
+
 ;;-------------------------------------------------
 ;; Call-with-builder - the fundamental constructor
 ;;
@@ -234,13 +314,8 @@
   (syntax-rules ()
     [(gen-fold-k name (seed ...))
      (define-method name (proc seed ... (coll <collection>) . more)
-       (if (null? more)
-         (with-iterator (coll end? next)
-           (let loop ((seed seed) ...)
-             (if (end?)
-               (values seed ...)
-               (receive (seed ...) (proc (next) seed ...)
-                 (loop seed ...)))))
+       (cond
+        [(not (null? more))
          (call-with-iterators
           (cons coll more)
           (^[ends? nexts]
@@ -251,8 +326,26 @@
                     (apply proc (fold-right (^[p r] (cons (p) r))
                                             (list seed ...)
                                             nexts))
-                  (loop seed ...))))))
-         ))]))
+                  (loop seed ...))))))]
+        [(%chunked? coll)
+         (call-with-chunk-iterator coll
+           (^[next-chunk]
+             (let loop ((seed seed) ...)
+               (receive (v s e) (next-chunk)
+                 (if v
+                   (let inner ((i s) (seed seed) ...)
+                     (if (= i e)
+                       (loop seed ...)
+                       (receive (seed ...) (proc (vector-ref v i) seed ...)
+                         (inner (+ i 1) seed ...))))
+                   (values seed ...))))))]
+        [else
+         (with-iterator (coll end? next)
+           (let loop ((seed seed) ...)
+             (if (end?)
+               (values seed ...)
+               (receive (seed ...) (proc (next) seed ...)
+                 (loop seed ...)))))]))]))
 
 ;; generic way.   This shadows builtin fold.
 (define-fold-k fold (knil))
@@ -284,20 +377,25 @@
 
 ;; generic way.  this shadows builtin map.
 (define-method map (proc (coll <collection>) . more)
-  (if (null? more)
+  (cond
+   [(not (null? more)) (%map-n proc coll more)]
+   [(%chunked? coll)
+    (reverse! (%chunk-fold (^[e r] (cons (proc e) r)) '() coll))]
+   [else
     (with-iterator (coll end? next)
       (do ([q (make-queue)])
           [(end?) (queue->list q)]
-        (enqueue! q (proc (next)))))
-    (let1 %map (with-module gauche map)
-      (call-with-iterators
-       (cons coll more)
-       (^[ends? nexts]
-         (do ([q (make-queue)])
-             [(any (cut <>) ends?)
-              (queue->list q)]
-           (enqueue! q (apply proc (%map (cut <>) nexts))))))
-      )))
+        (enqueue! q (proc (next)))))]))
+
+(define (%map-n proc coll more)
+  (let1 %map (with-module gauche map)
+    (call-with-iterators
+     (cons coll more)
+     (^[ends? nexts]
+       (do ([q (make-queue)])
+           [(any (cut <>) ends?)
+            (queue->list q)]
+         (enqueue! q (apply proc (%map (cut <>) nexts))))))))
 
 ;; for list arguments, built-in map is much faster.
 (define-method map (proc (coll <list>) . more)
@@ -315,19 +413,27 @@
 
 ;; generic way.
 (define-method map-to ((class <class>) proc (coll <collection>) . more)
-  (if (null? more)
+  (cond
+   [(not (null? more)) (%map-to-n class proc coll more)]
+   [(%chunked? coll)
+    (with-builder (class add! get :size (size-of coll))
+      (%chunk-for-each (^e (add! (proc e))) coll)
+      (get))]
+   [else
     (with-builder (class add! get :size (size-of coll))
       (with-iterator (coll end? next)
         (do ()
             [(end?) (get)]
-          (add! (proc (next))))))
-    (with-builder (class add! get :size (maybe-minimum-size coll more))
-      (call-with-iterators
-       (cons coll more)
-       (^[ends? nexts]
-         (do ()
-             [(any (cut <>) ends?) (get)]
-           (add! (apply proc (map (cut <>) nexts)))))))))
+          (add! (proc (next))))))]))
+
+(define (%map-to-n class proc coll more)
+  (with-builder (class add! get :size (maybe-minimum-size coll more))
+    (call-with-iterators
+     (cons coll more)
+     (^[ends? nexts]
+       (do ()
+           [(any (cut <>) ends?) (get)]
+         (add! (apply proc (map (cut <>) nexts))))))))
 
 ;; map-to <list> is equivalent to map.
 (define-method map-to ((class <list-meta>) proc coll . more)
@@ -363,15 +469,20 @@
 
 ;; generic way.  this shadows builtin for-each.
 (define-method for-each (proc (coll <collection>) . more)
-  (if (null? more)
+  (cond
+   [(not (null? more)) (%for-each-n proc coll more)]
+   [(%chunked? coll) (%chunk-for-each proc coll)]
+   [else
     (with-iterator (coll end? next)
-      (until (end?) (proc (next))))
-    (let1 %map (with-module gauche map)
-      (call-with-iterators
-       (cons coll more)
-       (^[ends? nexts]
-         (until (any (cut <>) ends?)
-           (apply proc (%map (cut <>) nexts))))))))
+      (until (end?) (proc (next))))]))
+
+(define (%for-each-n proc coll more)
+  (let1 %map (with-module gauche map)
+    (call-with-iterators
+     (cons coll more)
+     (^[ends? nexts]
+       (until (any (cut <>) ends?)
+         (apply proc (%map (cut <>) nexts)))))))
 
 ;; for list arguments, built-in for-each is much faster.
 (define-method for-each (proc (coll <list>) . more)
@@ -410,12 +521,14 @@
 
 ;; generic way
 (define-method find (pred (coll <collection>))
-  (with-iterator (coll end? next)
-    (let loop ()
-      (if (end?)
-        #f
-        (let1 e (next)
-          (if (pred e) e (loop)))))))
+  (if (%chunked? coll)
+    (%chunk-find pred coll)
+    (with-iterator (coll end? next)
+      (let loop ()
+        (if (end?)
+          #f
+          (let1 e (next)
+            (if (pred e) e (loop))))))))
 
 ;; shortcut
 (define-method find (pred (coll <list>))
@@ -476,17 +589,22 @@
 
 ;; generic way
 (define-method filter (pred (coll <collection>))
-  (let1 q (make-queue)
-    (with-iterator (coll end? next)
-      (until (end?) (let1 e (next) (when (pred e) (enqueue! q e))))
-      (queue->list q))))
+  (if (%chunked? coll)
+    (reverse! (%chunk-fold (^[e r] (if (pred e) (cons e r) r)) '() coll))
+    (let1 q (make-queue)
+      (with-iterator (coll end? next)
+        (until (end?) (let1 e (next) (when (pred e) (enqueue! q e))))
+        (queue->list q)))))
 
 (define-method filter-to ((class <class>) pred (coll <collection>))
   (with-builder (class add! get)
-    (with-iterator (coll end? next)
-      (do ()
-          [(end?) (get)]
-        (let1 e (next) (when (pred e) (add! e)))))))
+    (if (%chunked? coll)
+      (begin (%chunk-for-each (^e (when (pred e) (add! e))) coll)
+             (get))
+      (with-iterator (coll end? next)
+        (do ()
+            [(end?) (get)]
+          (let1 e (next) (when (pred e) (add! e))))))))
 
 ;; shortcut
 (define-method filter (pred (coll <list>))
@@ -499,17 +617,22 @@
 
 ;; generic way
 (define-method remove (pred (coll <collection>))
-  (let1 q (make-queue)
-    (with-iterator (coll end? next)
-      (until (end?) (let1 e (next) (unless (pred e) (enqueue! q e))))
-      (queue->list q))))
+  (if (%chunked? coll)
+    (reverse! (%chunk-fold (^[e r] (if (pred e) r (cons e r))) '() coll))
+    (let1 q (make-queue)
+      (with-iterator (coll end? next)
+        (until (end?) (let1 e (next) (unless (pred e) (enqueue! q e))))
+        (queue->list q)))))
 
 (define-method remove-to ((class <class>) pred (coll <collection>))
   (with-builder (class add! get)
-    (with-iterator (coll end? next)
-      (do ()
-          [(end?) (get)]
-        (let1 e (next) (unless (pred e) (add! e)))))))
+    (if (%chunked? coll)
+      (begin (%chunk-for-each (^e (unless (pred e) (add! e))) coll)
+             (get))
+      (with-iterator (coll end? next)
+        (do ()
+            [(end?) (get)]
+          (let1 e (next) (unless (pred e) (add! e))))))))
 
 ;; shortcut
 (define-method remove (pred (coll <list>))
@@ -551,10 +674,13 @@
 
 (define-method coerce-to ((class <class>) (coll <collection>))
   (with-builder (class add! get :size (size-of coll))
-    (with-iterator (coll end? next)
-      (do ()
-          [(end?) (get)]
-        (add! (next))))))
+    (if (%chunked? coll)
+      (begin (%chunk-for-each add! coll)
+             (get))
+      (with-iterator (coll end? next)
+        (do ()
+            [(end?) (get)]
+          (add! (next)))))))
 
 ;; shortcut
 (define-method coerce-to ((class <list-meta>) (coll <list>))
@@ -567,6 +693,14 @@
   (list->vector coll))
 (define-method coerce-to ((class <string-meta>) (coll <list>))
   (list->string coll))
+(define-method coerce-to ((class <vector-meta>) (coll <vector>))
+  (vector-copy coll))
+(define-method coerce-to ((class <vector-meta>) (coll <string>))
+  (string->vector coll))
+(define-method coerce-to ((class <string-meta>) (coll <string>))
+  (string-copy coll))
+(define-method coerce-to ((class <string-meta>) (coll <vector>))
+  (vector->string coll))
 
 ;; group-collection---------------------------------------
 ;;  gather elements with the same key value.
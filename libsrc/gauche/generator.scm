@@ -56,6 +56,7 @@
           gmap gmap-accum gfilter gremove gdelete gdelete-neighbor-dups
           gfilter-map gstate-filter gbuffer-filter
           gtake gtake* gdrop gtake-while gdrop-while grxmatch gslices
+          gpipeline
           glet* glet1 do-generator
 
           ;; srfi-121 compatibility
@@ -88,6 +89,101 @@
 ;;; Converters and constructors
 ;;;
 
+;; Native sources.  These are the heads of most pipelines, so we make
+;; them C closures instead of Scheme closures; each call yields an item
+;; without running VM code.
+(inline-stub
+ ;; Arithmetic progression of fixnums.  The caller guarantees that
+ ;; START + STEP * COUNT fits in a fixnum.
+ "typedef struct fixnum_gen_rec {
+    ScmSmallInt cur;
+    ScmSmallInt step;
+    ScmSmallInt count;
+ } fixnum_gen;"
+
+ (define-cfn fixnum-gen-next (args::ScmObj* nargs::int data::void*) :static
+   (let* ([g::fixnum_gen* (cast fixnum_gen* data)])
+     (when (<= (-> g count) 0) (return SCM_EOF))
+     (let* ([v::ScmSmallInt (-> g cur)])
+       (pre-- (-> g count))
+       (+= (-> g cur) (-> g step))
+       (return (SCM_MAKE_INT v)))))
+
+ (define-cproc %fixnum-generator (start::<fixnum> step::<fixnum>
+                                  count::<fixnum>)
+   (let* ([g::fixnum_gen* (SCM_NEW_ATOMIC fixnum_gen)])
+     (set! (-> g cur) start
+           (-> g step) step
+           (-> g count) count)
+     (return (Scm_MakeSubr fixnum_gen_next g 0 0 '"fixnum-generator"))))
+
+ "typedef struct uvector_gen_rec {
+    ScmUVector *v;
+    int type;
+    ScmSmallInt i;
+    ScmSmallInt end;
+ } uvector_gen;"
+
+ (define-cfn uvector-gen-next (args::ScmObj* nargs::int data::void*) :static
+   (let* ([g::uvector_gen* (cast uvector_gen* data)])
+     (when (>= (-> g i) (-> g end)) (return SCM_EOF))
+     (return (Scm_VMUVectorRef (-> g v) (-> g type) (post++ (-> g i))
+                               SCM_UNBOUND))))
+
+ ;; Returns #f if V's element type isn't handled natively, so that the
+ ;; caller can fall back to uvector-ref.
+ (define-cproc %uvector-generator (v::<uvector>
+                                   :optional (start::<fixnum> 0)
+                                             (end::<fixnum> -1))
+   (let* ([t::int (Scm_UVectorType (SCM_CLASS_OF v))]
+          [size::ScmSmallInt (SCM_UVECTOR_SIZE v)])
+     (when (< t 0) (return SCM_FALSE))
+     (SCM_CHECK_START_END start end size)
+     (let* ([g::uvector_gen* (SCM_NEW uvector_gen)])
+       (set! (-> g v) v
+             (-> g type) t
+             (-> g i) start
+             (-> g end) end)
+       (return (Scm_MakeSubr uvector_gen_next g 0 0 '"uvector-generator")))))
+
+ ;; Line reader.  If BATCH is true, the port belongs to the generator
+ ;; (file->line-generator), so we can read ahead LINE_GEN_BATCH lines
+ ;; with a single port lock, and close the port at EOF.  Otherwise others
+ ;; may read from the port as well, and we read one line at a time.
+ "#define LINE_GEN_BATCH 64
+  typedef struct line_gen_rec {
+    ScmPort *port;
+    int batch;
+    ScmSmallInt i;
+    ScmSmallInt n;
+    ScmObj buf[LINE_GEN_BATCH];
+ } line_gen;"
+
+ (define-cfn line-gen-next (args::ScmObj* nargs::int data::void*) :static
+   (let* ([g::line_gen* (cast line_gen* data)])
+     (when (== (-> g port) NULL) (return SCM_EOF))
+     (unless (-> g batch) (return (Scm_ReadLine (-> g port))))
+     (when (>= (-> g i) (-> g n))
+       (set! (-> g n) (Scm_ReadLines (-> g port) (-> g buf) LINE_GEN_BATCH)
+             (-> g i) 0)
+       (when (== (-> g n) 0)
+         (Scm_ClosePort (-> g port))
+         (set! (-> g port) NULL)
+         (return SCM_EOF)))
+     (let* ([line (aref (-> g buf) (-> g i))])
+       (set! (aref (-> g buf) (-> g i)) SCM_FALSE) ; let GC reclaim it
+       (pre++ (-> g i))
+       (return line))))
+
+ (define-cproc %line-generator (port::<input-port> batch::<boolean>)
+   (let* ([g::line_gen* (SCM_NEW line_gen)])
+     (set! (-> g port) port
+           (-> g batch) batch
+           (-> g i) 0
+           (-> g n) 0)
+     (return (Scm_MakeSubr line_gen_next g 0 0 '"line-generator"))))
+ )
+
 ;; Some useful converters
 (define (list->generator lis :optional (start #f) (end #f))
   (let1 start (or start 0)
@@ -113,9 +209,13 @@
     (^[] (read-char p))))
 
 (define (uvector->generator uvec :optional (start #f) (end #f))
-  (let ([i (or start 0)]
-        [len (or end (uvector-length uvec))])
-    (^[] (if (>= i len) (eof-object) (%begin0 (uvector-ref uvec i) (inc! i))))))
+  (or (and (uvector? uvec)
+           (%uvector-generator uvec (or start 0) (or end -1)))
+      (let ([i (or start 0)]
+            [len (or end (uvector-length uvec))])
+        (^[] (if (>= i len)
+               (eof-object)
+               (%begin0 (uvector-ref uvec i) (inc! i)))))))
 
 (define (bits->generator n :optional (start #f) (end #f))
   (let* ([limit (or end (integer-length n))]
@@ -143,13 +243,15 @@
 (define (file->char-generator filename . open-args)
   (apply file->generator filename read-char open-args))
 (define (file->line-generator filename . open-args)
-  (apply file->generator filename read-line open-args))
+  (if-let1 p (apply open-input-file filename open-args)
+    (%line-generator p #t)
+    null-generator))
 (define (file->byte-generator filename . open-args)
   (apply file->generator filename read-byte open-args))
 
 ;; simple, but useful
 (define (port->sexp-generator port) (cut read port))
-(define (port->line-generator port) (cut read-line port))
+(define (port->line-generator port) (%line-generator port #f))
 (define (port->char-generator port) (cut read-char port))
 (define (port->byte-generator port) (cut read-byte port))
 
@@ -215,7 +317,10 @@
                [else (%begin0 (f seed) (set! seed (g seed)))]))))
 
 (define (giota :optional (count +inf.0) (start 0) (step 1))
-  (if (and (exact? start) (exact? step))
+  (cond
+   [(%fixnum-progression? start step count)
+    (%fixnum-generator start step count)]
+   [(and (exact? start) (exact? step))
     (let1 val start
       ;; NB: We allow count < 0 to mean "infinite", for the consistentcy
       ;; of stream-iota.
@@ -223,27 +328,39 @@
         (^[] (%begin0 val (inc! val step)))
         (^[] (if (<= count 0)
                (eof-object)
-               (%begin0 val (inc! val step) (dec! count))))))
+               (%begin0 val (inc! val step) (dec! count))))))]
+   [else
     (let ([val (inexact start)]
           [k   0])
       (if (or (infinite? count) (< count 0))
         (^[] (%begin0 (+ val (* k step)) (inc! k)))
         (^[] (if (<= count 0)
                (eof-object)
-               (%begin0 (+ val (* k step)) (inc! k) (dec! count))))))))
+               (%begin0 (+ val (* k step)) (inc! k) (dec! count))))))]))
 
 (define (grange :optional (start 0) (end +inf.0) (step 1))
-  (if (and (exact? start) (exact? step))
+  (cond
+   [(and (fixnum? start) (fixnum? step) (> step 0) (real? end) (finite? end)
+         (let1 count (max 0 (exact (ceiling (/ (- end start) step))))
+           (and (%fixnum-progression? start step count) count)))
+    => (cut %fixnum-generator start step <>)]
+   [(and (exact? start) (exact? step))
     (let1 val start
       (^[] (if (>= val end)
              (eof-object)
-             (%begin0 val (inc! val step)))))
+             (%begin0 val (inc! val step)))))]
+   [else
     (let ([val (inexact start)]
           [k   0])
       (^[] (let1 v (+ val (* k step))
              (if (>= v end)
                (eof-object)
-               (begin (inc! k) v)))))))
+               (begin (inc! k) v)))))]))
+
+;; Whether giota/grange can use the native fixnum generator.
+(define (%fixnum-progression? start step count)
+  (and (fixnum? start) (fixnum? step) (fixnum? count) (>= count 0)
+       (fixnum? (+ start (* step count)))))
 
 ;;;
 ;;; Generator operations
@@ -513,6 +630,88 @@
                  (loop)
                  (begin (set! found? #t) v))))))))
 
+;; gpipeline :: (Generator a, stage ...) -> Generator b
+;;   stage : :map proc | :filter pred | :remove pred | :filter-map proc
+;;         | :take n | :drop n | :take-while pred | :drop-while pred
+;;
+;; Chaining gmap, gfilter etc. costs one closure call per item per stage,
+;; and each stage checks EOF again.  gpipeline expands the whole chain into
+;; a single closure with a single loop; the stage procedures are called
+;; directly (and inlined if they're literal lambdas), and the source is
+;; called at most once per item it yields.
+;; The stage procedure and count expressions are evaluated once, when
+;; the pipeline is created.
+(define-syntax gpipeline
+  (syntax-rules ()
+    [(_ src stage ...)
+     (%gpipeline-stages (g done v loop) src (stage ...) () ())]))
+
+;; Walks stages to collect state bindings and the operations to emit.
+(define-syntax %gpipeline-stages
+  (syntax-rules (:map :filter :remove :filter-map
+                 :take :drop :take-while :drop-while)
+    [(_ (g done v loop) src () (b ...) ops)
+     (let* ([g (%->gen src)] [done #f] b ...)
+       (^[] (let loop ()
+              (if done
+                (eof-object)
+                (let1 v (g)
+                  (if (eof-object? v)
+                    (begin (set! done #t) v)
+                    (%gpipeline-chain (v loop done) ops)))))))]
+    [(_ ids src (:map f . rest) (b ...) (o ...))
+     (%gpipeline-stages ids src rest (b ... [p f]) (o ... (:map p)))]
+    [(_ ids src (:filter f . rest) (b ...) (o ...))
+     (%gpipeline-stages ids src rest (b ... [p f]) (o ... (:filter p)))]
+    [(_ ids src (:remove f . rest) (b ...) (o ...))
+     (%gpipeline-stages ids src rest (b ... [p f]) (o ... (:remove p)))]
+    [(_ ids src (:filter-map f . rest) (b ...) (o ...))
+     (%gpipeline-stages ids src rest (b ... [p f]) (o ... (:filter-map p)))]
+    [(_ (g done v loop) src (:take n . rest) (b ...) (o ...))
+     (%gpipeline-stages (g done v loop) src rest
+                        (b ... [k (rlet1 k n (when (<= k 0) (set! done #t)))])
+                        (o ... (:take k)))]
+    [(_ ids src (:drop n . rest) (b ...) (o ...))
+     (%gpipeline-stages ids src rest (b ... [k n]) (o ... (:drop k)))]
+    [(_ ids src (:take-while f . rest) (b ...) (o ...))
+     (%gpipeline-stages ids src rest (b ... [p f]) (o ... (:take-while p)))]
+    [(_ ids src (:drop-while f . rest) (b ...) (o ...))
+     (%gpipeline-stages ids src rest (b ... [p f] [dropping #t])
+                        (o ... (:drop-while p dropping)))]
+    [(_ ids src (stage . rest) b o)
+     (syntax-error "Unknown gpipeline stage:" stage)]))
+
+;; Emits the body that processes one item V taken from the source.
+;; Calling (loop) skips the item.
+(define-syntax %gpipeline-chain
+  (syntax-rules (:map :filter :remove :filter-map
+                 :take :drop :take-while :drop-while)
+    [(_ (v loop done) ()) v]
+    [(_ (v loop done) ((:map p) . rest))
+     (let1 v (p v) (%gpipeline-chain (v loop done) rest))]
+    [(_ (v loop done) ((:filter p) . rest))
+     (if (p v) (%gpipeline-chain (v loop done) rest) (loop))]
+    [(_ (v loop done) ((:remove p) . rest))
+     (if (p v) (loop) (%gpipeline-chain (v loop done) rest))]
+    [(_ (v loop done) ((:filter-map p) . rest))
+     (let1 v (p v) (if v (%gpipeline-chain (v loop done) rest) (loop)))]
+    [(_ (v loop done) ((:take k) . rest))
+     (begin (dec! k)
+            (when (<= k 0) (set! done #t))
+            (%gpipeline-chain (v loop done) rest))]
+    [(_ (v loop done) ((:drop k) . rest))
+     (if (> k 0)
+       (begin (dec! k) (loop))
+       (%gpipeline-chain (v loop done) rest))]
+    [(_ (v loop done) ((:take-while p) . rest))
+     (if (p v)
+       (%gpipeline-chain (v loop done) rest)
+       (begin (set! done #t) (eof-object)))]
+    [(_ (v loop done) ((:drop-while p dropping) . rest))
+     (if (and dropping (p v))
+       (loop)
+       (begin (set! dropping #f) (%gpipeline-chain (v loop done) rest)))]))
+
 ;; generate :: ((a -> ()) -> ()) -> Generator a
 (define (generate proc)
   (define (cont)
@@ -50,6 +50,7 @@
    (setter)
    (getter)
    (restorer)                           ;used to restore previous value
+   (fast-loc)                           ;(index . init-value) or #f
    (pre-observers)
    (post-observers)
    ))
@@ -65,6 +66,9 @@
          [%ref  (with-module gauche.internal %vm-parameter-ref)]
          [%set! (with-module gauche.internal %vm-parameter-set!)])
     (slot-set! self 'getter (^() (%ref index init-value)))
+    ;; If a parameter has neither filter nor hooks, parameterize can
+    ;; swap the value in the VM's parameter table directly.
+    (slot-set! self 'fast-loc (and (not filter) (cons index init-value)))
     (slot-set! self 'setter
                (if filter
                  (^(val) (let1 new (filter val)
@@ -84,6 +88,7 @@
     (let-syntax ([hook-ref
                   (syntax-rules ()
                     [(_ var) (^() (or var (rlet1 h (make-hook 2)
+                                            (slot-set! self 'fast-loc #f)
                                             (set! var h))))])])
       (slot-set! self 'pre-observers (hook-ref pre-hook))
       (slot-set! self 'post-observers (hook-ref post-hook)))
@@ -115,29 +120,49 @@
   (syntax-rules ()
     [(_ () . body) (begin . body)]
     [(_ ((param val)) . body)
-     (let ([P param] [V val] [restarted #f])
-       (dynamic-wind
-         (^[] (if restarted
-                (set! V (%restore-parameter P V))
-                (set! V (P V))))
-         (^[] . body)
-         (^[] (set! restarted #t)
-              (set! V (%restore-parameter P V)))))]
+     (let ([P param] [V val])
+       (%parameterize1 P V (^[] . body)))]
     [(_ ((param val) ...) . body)
-     (let ([P (list param ...)]
-           [S '()]                      ;saved values
-           [restarted #f])
-       (dynamic-wind
-         (^[] (if restarted
-                (set! S (map (^[p v] (%restore-parameter p v)) P S))
-                (set! S (map (^[p] (p)) P))))
-         (^[] (unless restarted
-                (set! S (map (^[p v] (p v)) P (list val ...))))
-           . body)
-         (^[] (set! restarted #t)
-              (set! S (map (^[p v] (%restore-parameter p v)) P S)))))]
+     (%parameterize (list param ...) (list val ...) (^[] . body))]
     [(_ . x) (syntax-rules "Invalid parameterize form:" (parameterize . x))]))
 
+;; Returns a list of (index . init-value) if all of PARAMS can be
+;; parameterized by shallow binding; #f otherwise.
+(define (%fast-locs params)
+  (let loop ([ps params] [r '()])
+    (if (null? ps)
+      (reverse! r)
+      (and-let* ([ (is-a? (car ps) <parameter>) ]
+                 [loc (slot-ref (car ps) 'fast-loc)])
+        (loop (cdr ps) (cons loc r))))))
+
+(define (%parameterize1 P V thunk)
+  (if-let1 loc (and (is-a? P <parameter>) (slot-ref P 'fast-loc))
+    ((with-module gauche.internal %vm-parameterize) (list loc) (list V) thunk)
+    (let1 restarted #f
+      (dynamic-wind
+        (^[] (if restarted
+               (set! V (%restore-parameter P V))
+               (set! V (P V))))
+        thunk
+        (^[] (set! restarted #t)
+             (set! V (%restore-parameter P V)))))))
+
+(define (%parameterize P vals thunk)
+  (if-let1 locs (%fast-locs P)
+    ((with-module gauche.internal %vm-parameterize) locs vals thunk)
+    (let ([S '()]                       ;saved values
+          [restarted #f])
+      (dynamic-wind
+        (^[] (if restarted
+               (set! S (map (^[p v] (%restore-parameter p v)) P S))
+               (set! S (map (^[p] (p)) P))))
+        (^[] (unless restarted
+               (set! S (map (^[p v] (p v)) P vals)))
+          (thunk))
+        (^[] (set! restarted #t)
+             (set! S (map (^[p v] (%restore-parameter p v)) P S)))))))
+
 ;; hooks
 
 (define-method parameter-pre-observers ((self <parameter>))
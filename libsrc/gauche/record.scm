@@ -41,6 +41,11 @@
           record? record-rtd rtd-name rtd-parent
           rtd-field-names rtd-all-field-names rtd-field-mutable?
           make-rtd rtd? rtd-constructor rtd-predicate rtd-accessor rtd-mutator
+          <packed-record-meta> <packed-record> make-packed-rtd packed-rtd?
+          <record-vector> make-record-vector record-vector?
+          record-vector-length record-vector-rtd record-vector-ref
+          record-vector-set! record-vector-column
+          rtd-column-accessor rtd-column-mutator
           define-record-type)
   )
 (select-module gauche.record)
@@ -355,15 +360,212 @@
 (define (rtd-accessor rtd field) (%rtd-accessor rtd field))
 (define (rtd-mutator rtd field) (%rtd-mutator rtd field))
 
+;;;
+;;; Packed records
+;;;
+
+;; A packed record is a pseudo record whose fields are all declared with
+;; a numeric type.  An instance is a u8vector that holds the field values
+;; unboxed, laid out like a C struct with natural alignment.  A record
+;; vector keeps N packed records in columns, one uniform vector per field.
+
+(autoload binary.io
+          get-u8 get-s8 get-u16 get-s16 get-u32 get-s32 get-u64 get-s64
+          get-f16 get-f32 get-f64
+          put-u8! put-s8! put-u16! put-s16! put-u32! put-s32! put-u64!
+          put-s64! put-f16! put-f32! put-f64!)
+
+(define-class <packed-record-meta> (<pseudo-record-meta>)
+  ((field-types :init-keyword :field-types :init-value '())
+   (size        :init-keyword :size :init-value 0))) ; bytes of an instance
+(define-class <packed-record> () () :metaclass <packed-record-meta>)
+
+(define *packed-endian* (native-endian))
+
+;; fixnum is stored as s64, which covers the fixnum range on any platform.
+(define (%packed-type-size type)
+  (case type
+    [(u8 s8) 1]
+    [(u16 s16 f16) 2]
+    [(u32 s32 f32) 4]
+    [(u64 s64 f64 fixnum flonum) 8]
+    [else (error "invalid packed record field type:" type)]))
+
+;; Returns getter and putter on the instance, and the class, referencer
+;; and mutator of the column in a record vector.
+(define (%packed-type-procs type)
+  (case type
+    [(u8)  (values get-u8  put-u8!  <u8vector>  u8vector-ref  u8vector-set!)]
+    [(s8)  (values get-s8  put-s8!  <s8vector>  s8vector-ref  s8vector-set!)]
+    [(u16) (values get-u16 put-u16! <u16vector> u16vector-ref u16vector-set!)]
+    [(s16) (values get-s16 put-s16! <s16vector> s16vector-ref s16vector-set!)]
+    [(u32) (values get-u32 put-u32! <u32vector> u32vector-ref u32vector-set!)]
+    [(s32) (values get-s32 put-s32! <s32vector> s32vector-ref s32vector-set!)]
+    [(u64) (values get-u64 put-u64! <u64vector> u64vector-ref u64vector-set!)]
+    [(s64 fixnum)
+     (values get-s64 put-s64! <s64vector> s64vector-ref s64vector-set!)]
+    [(f16) (values get-f16 put-f16! <f16vector> f16vector-ref f16vector-set!)]
+    [(f32) (values get-f32 put-f32! <f32vector> f32vector-ref f32vector-set!)]
+    [(f64 flonum)
+     (values get-f64 put-f64! <f64vector> f64vector-ref f64vector-set!)]
+    [else (error "invalid packed record field type:" type)]))
+
+;; Returns a list of offsets and the size of the instance.
+(define (%packed-layout types)
+  (define (align n a) (* (quotient (+ n a -1) a) a))
+  (let loop ([types types] [off 0] [maxalign 1] [offsets '()])
+    (if (null? types)
+      (values (reverse offsets) (align off maxalign))
+      (let* ([size (%packed-type-size (car types))]
+             [off  (align off size)])
+        (loop (cdr types) (+ off size) (max size maxalign)
+              (cons off offsets))))))
+
+(define (make-packed-rtd name fieldspecs types)
+  (%valid-fieldspecs? fieldspecs #t)
+  (unless (= (vector-length fieldspecs) (length types))
+    (error "make-packed-rtd: field types don't match the fields:" types))
+  (receive (offsets size) (%packed-layout types)
+    (make <packed-record-meta>
+      :name name :field-specs fieldspecs :metaclass <packed-record-meta>
+      :supers (list <packed-record>)
+      :instance-class <u8vector> :field-types types :size size
+      :slots (map (^[slot off type] `(,@slot :offset ,off :type ,type))
+                  (fieldspecs->slotspecs fieldspecs 0) offsets types))))
+
+(define (packed-rtd? obj) (is-a? obj <packed-record-meta>))
+
+;; returns (offset type immutable?)
+(define (%get-packed-field rtd field)
+  (%check-rtd rtd)
+  (if-let1 s (assq field (class-slots rtd))
+    (values (slot-definition-option s :offset)
+            (slot-definition-option s :type)
+            (slot-definition-option s :immutable #f))
+    (errorf "record ~s does not have a slot named ~s" rtd field)))
+
+(define-method %rtd-predicate ((rtd <packed-record-meta>))
+  (let1 size (slot-ref rtd 'size)
+    (^o (and (u8vector? o) (>= (u8vector-length o) size)))))
+
+(define-method %rtd-constructor ((rtd <packed-record-meta>) . rest)
+  (let* ([fields (if (null? rest) (rtd-all-field-names rtd) (car rest))]
+         [nargs  (vector-length fields)]
+         [size   (slot-ref rtd 'size)]
+         [puts   (map (^f (receive (off type imm) (%get-packed-field rtd f)
+                            (receive (get put . _) (%packed-type-procs type)
+                              (^[v x] (put v off x *packed-endian*)))))
+                      (vector->list fields))])
+    (^ args
+      (unless (= (length args) nargs)
+        (errorf "wrong number of arguments to the constructor of ~s: ~s"
+                rtd args))
+      (rlet1 v (make-u8vector size 0)
+        (for-each (^[put x] (put v x)) puts args)))))
+
+(define-method %rtd-accessor ((rtd <packed-record-meta>) field)
+  (receive (off type immutable?) (%get-packed-field rtd field)
+    (receive (get put . _) (%packed-type-procs type)
+      (if immutable?
+        (^o (get o off *packed-endian*))
+        (getter-with-setter
+         (^o (get o off *packed-endian*))
+         (^[o v] (put o off v *packed-endian*)))))))
+
+(define-method %rtd-mutator ((rtd <packed-record-meta>) field)
+  (receive (off type immutable?) (%get-packed-field rtd field)
+    (when immutable?
+      (errorf "slot ~a of record ~s is immutable" field rtd))
+    (receive (get put . _) (%packed-type-procs type)
+      (^[o v] (put o off v *packed-endian*)))))
+
+;; Record vector
+
+(define-class <record-vector> ()
+  ((rtd     :init-keyword :rtd)
+   (length  :init-keyword :length)
+   (columns :init-keyword :columns)))   ; vector of uvectors, in slot order
+
+(define (make-record-vector rtd len)
+  (unless (packed-rtd? rtd)
+    (error "make-record-vector requires a packed record type, but got" rtd))
+  (make <record-vector> :rtd rtd :length len
+        :columns (map-to <vector>
+                         (^t (receive (get put class . _) (%packed-type-procs t)
+                               (make-uvector class len)))
+                         (slot-ref rtd 'field-types))))
+
+(define (record-vector? obj) (is-a? obj <record-vector>))
+(define (record-vector-length rv) (slot-ref rv 'length))
+(define (record-vector-rtd rv) (slot-ref rv 'rtd))
+
+(define (record-vector-column rv field)
+  (receive (k _) (%get-slot-index (slot-ref rv 'rtd) field #f)
+    (vector-ref (slot-ref rv 'columns) k)))
+
+(define (rtd-column-accessor rtd field)
+  (receive (k immutable?) (%get-slot-index rtd field #f)
+    (receive (off type imm) (%get-packed-field rtd field)
+      (receive (get put class ref set) (%packed-type-procs type)
+        (if immutable?
+          (^[rv i] (ref (vector-ref (slot-ref rv 'columns) k) i))
+          (getter-with-setter
+           (^[rv i] (ref (vector-ref (slot-ref rv 'columns) k) i))
+           (^[rv i v] (set (vector-ref (slot-ref rv 'columns) k) i v))))))))
+
+(define (rtd-column-mutator rtd field)
+  (receive (k immutable?) (%get-slot-index rtd field #t)
+    (when immutable?
+      (errorf "slot ~a of record ~s is immutable" field rtd))
+    (receive (off type imm) (%get-packed-field rtd field)
+      (receive (get put class ref set) (%packed-type-procs type)
+        (^[rv i v] (set (vector-ref (slot-ref rv 'columns) k) i v))))))
+
+;; Returns a fresh packed record instance holding the I-th element.
+(define (record-vector-ref rv i)
+  (let1 rtd (slot-ref rv 'rtd)
+    (rlet1 v (make-u8vector (slot-ref rtd 'size) 0)
+      (for-each (^[s col]
+                  (receive (off type imm)
+                      (%get-packed-field rtd (slot-definition-name s))
+                    (receive (get put class ref set) (%packed-type-procs type)
+                      (put v off (ref col i) *packed-endian*))))
+                (class-slots rtd)
+                (vector->list (slot-ref rv 'columns))))))
+
+(define (record-vector-set! rv i rec)
+  (let1 rtd (slot-ref rv 'rtd)
+    (for-each (^[s col]
+                (receive (off type imm)
+                    (%get-packed-field rtd (slot-definition-name s))
+                  (receive (get put class ref set) (%packed-type-procs type)
+                    (set col i (get rec off *packed-endian*)))))
+              (class-slots rtd)
+              (vector->list (slot-ref rv 'columns)))))
+
 ;;;
 ;;; Syntactic layer
 ;;;
 
-(define-macro (define-record-type type-spec ctor-spec pred-spec . field-specs)
+(define-macro (define-record-type type-spec ctor-spec pred-spec . typed-specs)
   (define (->id x) ((with-module gauche.internal make-identifier) x
                     (find-module 'gauche.record) '()))
   (define (id? x)  (or (symbol? x) (identifier? x)))
+  ;; A field spec may end with ':type <type>' to make a packed record.
+  (define (split-type spec)
+    (if (pair? spec)
+      (let* ([opts (or (find-tail (^x (eq? (unwrap-syntax x) :type)) spec)
+                       '())]
+             [core (take spec (- (length spec) (length opts)))])
+        (match opts
+          [() (cons core #f)]
+          [(_ type) (cons core (unwrap-syntax type))]
+          [_ (error "invalid field spec:" spec)]))
+      (cons spec #f)))
+  (define field-specs (map (^s (car (split-type s))) typed-specs))
+  (define field-types (map (^s (cdr (split-type s))) typed-specs))
   (define %make (->id 'make-rtd))
+  (define %make-packed (->id 'make-packed-rtd))
   (define %ctor (->id 'rtd-constructor))
   (define %pred (->id 'rtd-predicate))
   (define %asor (->id 'rtd-accessor))
@@ -379,8 +581,16 @@
                        [x (error "invalid field spec:" x)])
             field-specs))
   (define (build-def typename parent)
-    `(,%define-inline ,typename
-       (,%make ',typename ',(build-field-spec) ,@(if parent `(,parent) '()))))
+    (cond
+     [(every not field-types)
+      `(,%define-inline ,typename
+         (,%make ',typename ',(build-field-spec) ,@(if parent `(,parent) '())))]
+     [parent (error "packed record type can't have a parent:" type-spec)]
+     [(memq #f field-types)
+      (error "every field of a packed record needs a type:" typed-specs)]
+     [else
+      `(,%define-inline ,typename
+         (,%make-packed ',typename ',(build-field-spec) ',field-types))]))
   (define (build-ctor typename)
     (match ctor-spec
       [#f '()]
@@ -108,6 +108,19 @@
       (with-iterator (seq end? next :start start)
         (dotimes [i size (get)] (add! (next)))))))
 
+;; shortcut
+(define-method subseq ((seq <vector>) start end)
+  (vector-copy seq start (if (< end 0) (modulo end (vector-length seq)) end)))
+
+(define-method subseq ((seq <string>) start end)
+  (substring seq start (if (< end 0) (modulo end (string-length seq)) end)))
+
+(define-method subseq ((seq <list>) start end)
+  (let1 end (if (< end 0) (modulo end (length seq)) end)
+    (when (> start end)
+      (errorf "start ~a must be smaller than or equal to end ~a" start end))
+    (take (list-tail seq start) (- end start))))
+
 (define-method (setter subseq) ((seq <sequence>) start vals)
   (with-iterator (vals end? next)
     (do ([index start (+ index 1)])
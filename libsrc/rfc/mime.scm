@@ -61,6 +61,7 @@
 (select-module rfc.mime)
 
 (autoload rfc.quoted-printable quoted-printable-decode-string
+          quoted-printable-decode
           quoted-printable-encode quoted-printable-encode-string)
 (autoload rfc.base64 base64-decode-string base64-decode
           base64-encode-string base64-encode)
@@ -390,52 +391,20 @@
 ;;
 
 (define (mime-retrieve-body packet inp outp)
-
-  (define (read-line/nl)
-    (let loop ([c (read-char inp)]
-               [chars '()])
-      (cond [(eof-object? c)
-             (if (null? chars) c  (list->string (reverse! chars)))]
-            [(char=? c #\newline) (list->string (reverse! (cons c chars)))]
-            [(char=? c #\return)
-             (let1 c (peek-char inp)
-               (if (char=? c #\newline)
-                 (list->string (reverse! (list* (read-char inp)
-                                                #\return
-                                                chars)))
-                 (list->string (reverse! (cons #\return chars)))))]
-            [else (loop (read-char inp) (cons c chars))])))
-
-  (define (read-text decoder)
-    (let loop ([line (read-line/nl)])
-      (unless (eof-object? line)
-        (display (decoder line) outp)
-        (loop (read-line/nl)))))
-
-  (define (read-base64)
-    (define (base64-output string out)
-      (with-input-from-string string
-        (cut with-port-locking (current-input-port)
-             (cut with-output-to-port out base64-decode))))
-    (let1 buf (open-output-string :private? #t)
-      (let loop ([line (read-line inp)])
-        (unless (eof-object? line)
-          (display line buf)
-          (loop (read-line inp))))
-      (base64-output (get-output-string buf) outp))
-    )
+  ;; The decoders read from the port in chunks, so we don't need to
+  ;; split the body into lines.
+  (define (decode decoder)
+    (with-input-from-port inp
+      (cut with-output-to-port outp decoder)))
 
   (with-port-locking inp
     (^[] (let1 enc (ref packet 'transfer-encoding)
            (cond
-            [(string-ci=? enc "base64") (read-base64)]
+            [(string-ci=? enc "base64") (decode base64-decode)]
             [(string-ci=? enc "quoted-printable")
-             (read-text quoted-printable-decode-string)]
+             (decode quoted-printable-decode)]
             [(member enc '("7bit" "8bit" "binary"))
-             (let loop ((b (read-byte inp)))
-               (unless (eof-object? b)
-                 (write-byte b outp)
-                 (loop (read-byte inp))))]
+             (copy-port inp outp)]
             ))))
   )
 
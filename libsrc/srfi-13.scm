@@ -92,9 +92,17 @@
 
 (define (%char-pred/pred c/s/p x) (c/s/p x))
 
+;; Chars and char-sets are searched natively by %string-find; only
+;; predicates need to go through the Scheme loop.
+(define-inline (%native-c/s? c/s/p)
+  (or (char? c/s/p) (char-set? c/s/p)))
+(define %string-find (with-module gauche.internal %string-find))
+
 (define %maybe-substring (with-module gauche.internal %maybe-substring))
 (define %hash-string (with-module gauche.internal %hash-string))
 (define %string-replace-body! (with-module gauche.internal %string-replace-body!))
+(define %string-pad (with-module gauche.internal %string-pad))
+(define %string-tokenize (with-module gauche.internal %string-tokenize))
 ;;;
 ;;; Predicates
 ;;;
@@ -157,25 +165,13 @@
                                                        (+ tstart slen)
                                                        tlen))))))
 
-(define (string-pad s len :optional (char #\space) start end)
+(define (string-pad s len :optional (char #\space) (start 0) (end -1))
   (check-arg char? char)
-  (let* ((str (%maybe-substring s start end))
-         (slen (string-length str)))
-    (cond ((< slen len)
-           (string-append (make-string (- len slen) char) str))
-          ((> slen len)
-           (string-take-right str len))
-          (else str))))
-
-(define (string-pad-right s len :optional (char #\space) start end)
+  (%string-pad s len char #f start end))
+
+(define (string-pad-right s len :optional (char #\space) (start 0) (end -1))
   (check-arg char? char)
-  (let* ((str (%maybe-substring s start end))
-         (slen (string-length str)))
-    (cond ((< slen len)
-           (string-append str (make-string (- len slen) char)))
-          ((> slen len)
-           (string-take str len))
-          (else str))))
+  (%string-pad s len char #t start end))
 
 (define (string-take s nchars)
   (check-arg string? s)
@@ -203,6 +199,13 @@
 
 (define (string-trim s :optional (c/s/p #[\s]) start end)
   (check-arg string? s)
+  (if (%native-c/s? c/s/p)
+    (let* ((str (%maybe-substring s start end))
+           (i (%string-find str c/s/p #t #f)))
+      (if i (%maybe-substring str i) ""))
+    (%string-trim-pred s c/s/p start end)))
+
+(define (%string-trim-pred s c/s/p start end)
   (let ((pred (%get-char-pred c/s/p))
         (sp (make-string-pointer (%maybe-substring s start end))))
     (let loop ((ch (string-pointer-next! sp)))
@@ -214,6 +217,13 @@
 
 (define (string-trim-right s :optional (c/s/p #[\s]) start end)
   (check-arg string? s)
+  (if (%native-c/s? c/s/p)
+    (let* ((str (%maybe-substring s start end))
+           (i (%string-find str c/s/p #t #t)))
+      (if i (%maybe-substring str 0 (+ i 1)) ""))
+    (%string-trim-right-pred s c/s/p start end)))
+
+(define (%string-trim-right-pred s c/s/p start end)
   (let ((pred (%get-char-pred c/s/p))
         (sp (make-string-pointer (%maybe-substring s start end) -1)))
     (let loop ((ch (string-pointer-prev! sp)))
@@ -225,6 +235,15 @@
 
 (define (string-trim-both s :optional (c/s/p #[\s]) start end)
   (check-arg string? s)
+  (if (%native-c/s? c/s/p)
+    (let* ((str (%maybe-substring s start end))
+           (i (%string-find str c/s/p #t #f)))
+      (if i
+        (%maybe-substring str i (+ (%string-find str c/s/p #t #t i) 1))
+        ""))
+    (%string-trim-both-pred s c/s/p start end)))
+
+(define (%string-trim-both-pred s c/s/p start end)
   (let ((pred (%get-char-pred c/s/p))
         (sp (make-string-pointer (%maybe-substring s start end))))
     (let loop ((ch (string-pointer-next! sp)))
@@ -472,43 +491,51 @@
 
 (define (string-index s c/s/p . args)
   (check-arg string? s)
-  (let ((pred (%get-char-pred c/s/p))
-        (offset (if (pair? args) (car args) 0))
-        (sp (apply make-string-pointer s 0 args)))
-    (let loop ((ch (string-pointer-next! sp)))
-      (cond ((eof-object? ch) #f)
-            ((pred c/s/p ch) (+ offset (- (string-pointer-index sp) 1)))
-            (else (loop (string-pointer-next! sp)))))))
+  (if (%native-c/s? c/s/p)
+    (apply %string-find s c/s/p #f #f args)
+    (let ((pred (%get-char-pred c/s/p))
+          (offset (if (pair? args) (car args) 0))
+          (sp (apply make-string-pointer s 0 args)))
+      (let loop ((ch (string-pointer-next! sp)))
+        (cond ((eof-object? ch) #f)
+              ((pred c/s/p ch) (+ offset (- (string-pointer-index sp) 1)))
+              (else (loop (string-pointer-next! sp))))))))
 
 (define (string-index-right s c/s/p . args)
   (check-arg string? s)
-  (let ((pred (%get-char-pred c/s/p))
-        (offset (if (pair? args) (car args) 0))
-        (sp (apply make-string-pointer s -1 args)))
-    (let loop ((ch (string-pointer-prev! sp)))
-      (cond ((eof-object? ch) #f)
-            ((pred c/s/p ch) (+ offset (string-pointer-index sp)))
-            (else (loop (string-pointer-prev! sp)))))))
+  (if (%native-c/s? c/s/p)
+    (apply %string-find s c/s/p #f #t args)
+    (let ((pred (%get-char-pred c/s/p))
+          (offset (if (pair? args) (car args) 0))
+          (sp (apply make-string-pointer s -1 args)))
+      (let loop ((ch (string-pointer-prev! sp)))
+        (cond ((eof-object? ch) #f)
+              ((pred c/s/p ch) (+ offset (string-pointer-index sp)))
+              (else (loop (string-pointer-prev! sp))))))))
 
 (define (string-skip s c/s/p . args)
   (check-arg string? s)
-  (let ((pred (%get-char-pred c/s/p))
-        (offset (if (pair? args) (car args) 0))
-        (sp (apply make-string-pointer s 0 args)))
-    (let loop ((ch (string-pointer-next! sp)))
-      (cond ((eof-object? ch) #f)
-            ((pred c/s/p ch) (loop (string-pointer-next! sp)))
-            (else (+ offset (- (string-pointer-index sp) 1)))))))
+  (if (%native-c/s? c/s/p)
+    (apply %string-find s c/s/p #t #f args)
+    (let ((pred (%get-char-pred c/s/p))
+          (offset (if (pair? args) (car args) 0))
+          (sp (apply make-string-pointer s 0 args)))
+      (let loop ((ch (string-pointer-next! sp)))
+        (cond ((eof-object? ch) #f)
+              ((pred c/s/p ch) (loop (string-pointer-next! sp)))
+              (else (+ offset (- (string-pointer-index sp) 1))))))))
 
 (define (string-skip-right s c/s/p . args)
   (check-arg string? s)
-  (let ((pred (%get-char-pred c/s/p))
-        (offset (if (pair? args) (car args) 0))
-        (sp (apply make-string-pointer s -1 args)))
-    (let loop ((ch (string-pointer-prev! sp)))
-      (cond ((eof-object? ch) #f)
-            ((pred c/s/p ch) (loop (string-pointer-prev! sp)))
-            (else (+ offset (string-pointer-index sp)))))))
+  (if (%native-c/s? c/s/p)
+    (apply %string-find s c/s/p #t #t args)
+    (let ((pred (%get-char-pred c/s/p))
+          (offset (if (pair? args) (car args) 0))
+          (sp (apply make-string-pointer s -1 args)))
+      (let loop ((ch (string-pointer-prev! sp)))
+        (cond ((eof-object? ch) #f)
+              ((pred c/s/p ch) (loop (string-pointer-prev! sp)))
+              (else (+ offset (string-pointer-index sp))))))))
 
 (define (string-count s c/s/p . args)
   (check-arg string? s)
@@ -783,27 +810,9 @@
                  (apply %maybe-substring s2 args)
                  (substring s1 end1 (string-length s1))))
 
-(define (string-tokenize s :optional (token-set #[\S]) start end)
+(define (string-tokenize s :optional (token-set #[\S]) (start 0) (end -1))
   (check-arg string? s)
-  (letrec ([src (open-input-string (%maybe-substring s start end))]
-           [in-word (^[ch dst r]
-                      (cond [(eof-object? ch)
-                             (reverse! (cons (get-output-string dst) r))]
-                            [(char-set-contains? token-set ch)
-                             (write-char ch dst)
-                             (in-word (read-char src) dst r)]
-                            [else
-                             (out-word (read-char src)
-                                       (cons (get-output-string dst) r))]))]
-           [out-word (^[ch r]
-                       (cond [(eof-object? ch) (reverse! r)]
-                             [(char-set-contains? token-set ch)
-                              (let ((dst (open-output-string)))
-                                (write-char ch dst)
-                                (in-word (read-char src) dst r))]
-                             [else
-                              (out-word (read-char src) r)]))])
-    (out-word (read-char src) '())))
+  (%string-tokenize s token-set start end))
 
 ;;;
 ;;; Filter
@@ -99,6 +99,188 @@
 ;; eventually we'll check immutable vectors here.
 (define-inline (%ensure-mutable v) (values))
 
+;; C kernels of the single-vector cases of the iteration and search
+;; procedures.  If the procedure is a subr that Scm_ApplyRec calls
+;; directly, we loop in C.  Otherwise we call it through continuation
+;; frames, without re-entering the VM per element.  The arguments are
+;; checked by the callers.
+(inline-stub
+ (declcode
+  "#define VEC_SEARCH_RIGHT 1  /* scan from the end */"
+  "#define VEC_SEARCH_SKIP  2  /* find an element that fails pred */"
+  "static ScmObj compare_proc = SCM_UNDEFINED;")
+
+ (define-cfn idx->data (i::ScmSmallInt) ::void* :static :inline
+   (return (cast void* (cast intptr_t i))))
+ (define-cfn data->idx (p::void*) ::ScmSmallInt :static :inline
+   (return (cast ScmSmallInt (cast intptr_t p))))
+
+ ;; vector-fold, vector-fold-right
+ ;; data[0] proc, [1] vector, [2] index, [3] step (1 or -1)
+ (define-cfn vector-fold1-cc (seed data::void**) :static
+   (let* ([proc (SCM_OBJ (aref data 0))]
+          [v (SCM_OBJ (aref data 1))]
+          [step::ScmSmallInt (data->idx (aref data 3))]
+          [i::ScmSmallInt (+ (data->idx (aref data 2)) step)])
+     (when (or (< i 0) (>= i (SCM_VECTOR_SIZE v))) (return seed))
+     (set! (aref data 2) (idx->data i))
+     (Scm_VMPushCC vector-fold1-cc data 4)
+     (return (Scm_VMApply2 proc seed (SCM_VECTOR_ELEMENT v i)))))
+
+ (define-cproc %vector-fold1 (proc seed v::<vector> right?::<boolean>)
+   (let* ([len::ScmSmallInt (SCM_VECTOR_SIZE v)]
+          [step::ScmSmallInt (?: right? -1 1)]
+          [i::ScmSmallInt (?: right? (- len 1) 0)])
+     (when (== len 0) (return seed))
+     (when (SCM_SUBR_IMMEDIATE_P proc)
+       (for [() (and (<= 0 i) (< i len)) (+= i step)]
+            (set! seed (Scm_ApplyRec2 proc seed (SCM_VECTOR_ELEMENT v i))))
+       (return seed))
+     (let* ([data::(.array void* [4])])
+       (set! (aref data 0) proc
+             (aref data 1) v
+             (aref data 2) (idx->data i)
+             (aref data 3) (idx->data step))
+       (Scm_VMPushCC vector-fold1-cc data 4)
+       (return (Scm_VMApply2 proc seed (SCM_VECTOR_ELEMENT v i))))))
+
+ ;; vector-count
+ ;; data[0] pred, [1] vector, [2] index, [3] count
+ (define-cfn vector-count1-cc (r data::void**) :static
+   (let* ([pred (SCM_OBJ (aref data 0))]
+          [v (SCM_OBJ (aref data 1))]
+          [i::ScmSmallInt (+ (data->idx (aref data 2)) 1)]
+          [cnt::ScmSmallInt (data->idx (aref data 3))])
+     (unless (SCM_FALSEP r) (pre++ cnt))
+     (when (>= i (SCM_VECTOR_SIZE v)) (return (SCM_MAKE_INT cnt)))
+     (set! (aref data 2) (idx->data i)
+           (aref data 3) (idx->data cnt))
+     (Scm_VMPushCC vector-count1-cc data 4)
+     (return (Scm_VMApply1 pred (SCM_VECTOR_ELEMENT v i)))))
+
+ (define-cproc %vector-count1 (pred v::<vector>)
+   (let* ([len::ScmSmallInt (SCM_VECTOR_SIZE v)])
+     (when (== len 0) (return (SCM_MAKE_INT 0)))
+     (when (SCM_SUBR_IMMEDIATE_P pred)
+       (let* ([cnt::ScmSmallInt 0] [i::ScmSmallInt 0])
+         (for [() (< i len) (pre++ i)]
+              (unless (SCM_FALSEP (Scm_ApplyRec1 pred (SCM_VECTOR_ELEMENT v i)))
+                (pre++ cnt)))
+         (return (SCM_MAKE_INT cnt))))
+     (let* ([data::(.array void* [4])])
+       (set! (aref data 0) pred
+             (aref data 1) v
+             (aref data 2) (idx->data 0)
+             (aref data 3) (idx->data 0))
+       (Scm_VMPushCC vector-count1-cc data 4)
+       (return (Scm_VMApply1 pred (SCM_VECTOR_ELEMENT v 0))))))
+
+ ;; vector-index, vector-index-right, vector-skip, vector-skip-right
+ ;; data[0] pred, [1] vector, [2] index, [3] mode
+ (define-cfn vector-search1-cc (r data::void**) :static
+   (let* ([pred (SCM_OBJ (aref data 0))]
+          [v (SCM_OBJ (aref data 1))]
+          [i::ScmSmallInt (data->idx (aref data 2))]
+          [mode::int (cast int (data->idx (aref data 3)))]
+          [skip::int (!= (logand mode VEC_SEARCH_SKIP) 0)])
+     (unless (== (SCM_FALSEP r) skip)
+       (return (SCM_MAKE_INT i)))
+     (if (logand mode VEC_SEARCH_RIGHT) (pre-- i) (pre++ i))
+     (when (or (< i 0) (>= i (SCM_VECTOR_SIZE v))) (return SCM_FALSE))
+     (set! (aref data 2) (idx->data i))
+     (Scm_VMPushCC vector-search1-cc data 4)
+     (return (Scm_VMApply1 pred (SCM_VECTOR_ELEMENT v i)))))
+
+ (define-cproc %vector-search1 (pred v::<vector> right?::<boolean>
+                                     skip?::<boolean>)
+   (let* ([len::ScmSmallInt (SCM_VECTOR_SIZE v)]
+          [step::ScmSmallInt (?: right? -1 1)]
+          [i::ScmSmallInt (?: right? (- len 1) 0)])
+     (when (== len 0) (return SCM_FALSE))
+     (when (SCM_SUBR_IMMEDIATE_P pred)
+       (for [() (and (<= 0 i) (< i len)) (+= i step)]
+            (unless (== (SCM_FALSEP (Scm_ApplyRec1 pred
+                                                   (SCM_VECTOR_ELEMENT v i)))
+                        skip?)
+              (return (SCM_MAKE_INT i))))
+       (return SCM_FALSE))
+     (let* ([data::(.array void* [4])])
+       (set! (aref data 0) pred
+             (aref data 1) v
+             (aref data 2) (idx->data i)
+             (aref data 3) (idx->data (logior (?: right? VEC_SEARCH_RIGHT 0)
+                                              (?: skip? VEC_SEARCH_SKIP 0))))
+       (Scm_VMPushCC vector-search1-cc data 4)
+       (return (Scm_VMApply1 pred (SCM_VECTOR_ELEMENT v i))))))
+
+ ;; vector-binary-search
+ ;; data[0] cmp, [1] vector, [2] value, [3] lo, [4] hi, [5] mid
+ (define-cfn binary-search-sign (r) ::int :static
+   (if (SCM_INTP r)
+     (return (?: (< (SCM_INT_VALUE r) 0) -1 (?: (> (SCM_INT_VALUE r) 0) 1 0)))
+     (return (Scm_Sign r))))
+
+ (define-cfn binary-search-cc (r data::void**) :static
+   (let* ([cmp (SCM_OBJ (aref data 0))]
+          [v (SCM_OBJ (aref data 1))]
+          [value (SCM_OBJ (aref data 2))]
+          [lo::ScmSmallInt (data->idx (aref data 3))]
+          [hi::ScmSmallInt (data->idx (aref data 4))]
+          [mid::ScmSmallInt (data->idx (aref data 5))]
+          [sign::int (binary-search-sign r)])
+     (cond [(== sign 0) (return (SCM_MAKE_INT mid))]
+           [(== lo mid) (return SCM_FALSE)]
+           [(< sign 0) (set! lo mid)]
+           [else (set! hi mid)])
+     (set! mid (>> (+ lo hi) 1))
+     (set! (aref data 3) (idx->data lo)
+           (aref data 4) (idx->data hi)
+           (aref data 5) (idx->data mid))
+     (Scm_VMPushCC binary-search-cc data 6)
+     (return (Scm_VMApply2 cmp (SCM_VECTOR_ELEMENT v mid) value))))
+
+ ;; START and END are already validated.  If CMP is 'compare', we compare
+ ;; the elements with Scm_Compare without calling back.
+ (define-cproc %vector-binary-search (v::<vector> value cmp
+                                      start::<fixnum> end::<fixnum>)
+   (let* ([lo::ScmSmallInt start] [hi::ScmSmallInt end]
+          [mid::ScmSmallInt (>> (+ lo hi) 1)])
+     (when (== lo hi) (return SCM_FALSE))
+     (SCM_BIND_PROC compare_proc "compare" (Scm_GaucheModule))
+     (when (or (SCM_EQ cmp compare_proc) (SCM_SUBR_IMMEDIATE_P cmp))
+       (let* ([native::int (SCM_EQ cmp compare_proc)])
+         (loop
+          (let* ([sign::int
+                  (?: native
+                      (Scm_Compare (SCM_VECTOR_ELEMENT v mid) value)
+                      (binary-search-sign
+                       (Scm_ApplyRec2 cmp (SCM_VECTOR_ELEMENT v mid) value)))])
+            (cond [(== sign 0) (return (SCM_MAKE_INT mid))]
+                  [(== lo mid) (return SCM_FALSE)]
+                  [(< sign 0) (set! lo mid)]
+                  [else (set! hi mid)])
+            (set! mid (>> (+ lo hi) 1))))))
+     (let* ([data::(.array void* [6])])
+       (set! (aref data 0) cmp
+             (aref data 1) v
+             (aref data 2) value
+             (aref data 3) (idx->data lo)
+             (aref data 4) (idx->data hi)
+             (aref data 5) (idx->data mid))
+       (Scm_VMPushCC binary-search-cc data 6)
+       (return (Scm_VMApply2 cmp (SCM_VECTOR_ELEMENT v mid) value)))))
+
+ ;; Copies SOURCE[SSTART,SEND) reversed into TARGET from TSTART.
+ ;; Assumes the arguments are all valid.
+ (define-cproc %vector-reverse-copy! (target::<vector> tstart::<fixnum>
+                                      source::<vector>
+                                      sstart::<fixnum> send::<fixnum>)
+   ::<void>
+   (let* ([i::ScmSmallInt tstart] [j::ScmSmallInt (- send 1)])
+     (for [() (>= j sstart) (begin (post++ i) (post-- j))]
+          (set! (SCM_VECTOR_ELEMENT target i) (SCM_VECTOR_ELEMENT source j)))))
+ )
+
 (define %vector-unfold!
   (case-lambda
     [(f rvec s e)
@@ -169,13 +351,6 @@
       (errorf "start index (~s) is greater than end index (~s)" s e))
     (apply %vector-unfold-right! f rvec s e seeds)))
 
-(define (%vector-reverse-copy! target tstart source sstart send)
-  ;; assumes args are all valid
-  (do ([i tstart (+ i 1)]
-       [j (- send 1) (- j 1)])
-      [(< j sstart)]
-    (vector-set! target i (vector-ref source j))))
-
 (define (vector-reverse-copy vec :optional (start 0) (end -1))
   (receive (s e) (%vector-check-start+end vec start end #t)
     (rlet1 rvec (make-vector (- e s))
@@ -249,9 +424,7 @@
   (case-lambda
     ([proc seed v] ; fast path
      (check-arg vector? v)
-     (let1 len (vector-length v)
-       (let loop ([i 0] [seed seed])
-         (if (= i len) seed (loop (+ i 1) (proc seed (vector-ref v i)))))))
+     (%vector-fold1 proc seed v #f))
     ([proc seed v . vs]
      (let* ([vs (cons v vs)]
             [len (fold (^[v len]
@@ -267,9 +440,7 @@
   (case-lambda
     ([proc seed v] ; fast path
      (check-arg vector? v)
-     (let1 len (vector-length v)
-       (let loop ([i (- len 1)] [seed seed])
-         (if (= i -1) seed (loop (- i 1) (proc seed (vector-ref v i)))))))
+     (%vector-fold1 proc seed v #t))
     ([proc seed v . vs]
      (let* ([vs (cons v vs)]
             [len (fold (^[v len]
@@ -284,7 +455,8 @@
 (define vector-count
   (case-lambda
     ([pred v] ; fast path
-     (vector-fold (^[c e] (if (pred e) (+ 1 c) c)) 0 v))
+     (check-arg vector? v)
+     (%vector-count1 pred v))
     ([pred v . vs]
      (apply vector-fold (^[c . es] (if (apply pred es) (+ 1 c) c)) 0 v vs))))
 
@@ -302,9 +474,7 @@
   (case-lambda
     ([pred v] ; fast path
      (check-arg vector? v)
-     (let1 len (vector-length v)
-       (let lp ([i 0])
-         (cond [(= i len) #f] [(pred (vector-ref v i)) i] [else (lp (+ i 1))]))))
+     (%vector-search1 pred v #f #f))
     ([pred v . vs]
      (let* ([vs (cons v vs)]
             [len (fold (^[v len]
@@ -322,9 +492,7 @@
   (case-lambda
     ([pred v] ; fast path
      (check-arg vector? v)
-     (let1 len (vector-length v)
-       (let lp ([i (- len 1)])
-         (cond [(= i -1) #f] [(pred (vector-ref v i)) i] [else (lp (- i 1))]))))
+     (%vector-search1 pred v #t #f))
     ([pred v . vs]
      (let* ([vs (cons v vs)]
             [len (fold (^[v len]
@@ -338,24 +506,27 @@
                [(apply pred (map (cut vector-ref <> i) vs)) i]
                [else (lp (- i 1))]))))))
 
-(define (vector-skip pred v . vs)
-  (apply vector-index (complement pred) v vs))
+(define vector-skip
+  (case-lambda
+    ([pred v] ; fast path
+     (check-arg vector? v)
+     (%vector-search1 pred v #f #t))
+    ([pred v . vs]
+     (apply vector-index (complement pred) v vs))))
 
-(define (vector-skip-right pred v . vs)
-  (apply vector-index-right (complement pred) v vs))
+(define vector-skip-right
+  (case-lambda
+    ([pred v] ; fast path
+     (check-arg vector? v)
+     (%vector-search1 pred v #t #t))
+    ([pred v . vs]
+     (apply vector-index-right (complement pred) v vs))))
 
 (define (vector-binary-search vec value cmp :optional (start 0) (end -1))
   (check-arg vector? vec)
   (receive (s e) (%vector-check-start+end vec start end #t)
-    (and (not (= s e))
-         (let rec ([lo s] [hi e])
-           (let* ([mid (ash (+ lo hi) -1)]
-                  [r (cmp (vector-ref vec mid) value)])
-             (cond [(zero? r) mid]
-                   [(= lo mid) #f]
-                   [(< r 0) (rec mid hi)]
-                   [else (rec lo mid)]))))))
-     
+    (%vector-binary-search vec value cmp s e)))
+
 (define vector-any
   (case-lambda
     ([pred v]
@@ -612,7 +612,103 @@
          '()
          (lambda (p a) (list p (reverse a) pred-bodies))))
 
+;; Entry point of the code generator.  If the leading clauses of PLIST
+;; all dispatch on a literal, either the whole pattern or the car of a
+;; pair pattern, we test the key once with 'case' and only try the clauses
+;; that can match in each branch.  Otherwise we generate the usual
+;; sequential tests, which come back here when a clause fails.
 (define (gen x sf plist erract eta)
+  (let ((run (dispatch-run plist)))
+    (if run
+      (gen-dispatch x sf plist run erract eta)
+      (gen-clauses x sf plist erract eta))))
+
+;; If P can be compared with eqv? against a constant, returns a list of
+;; the constant.  We don't include strings, for they're compared by equal?.
+(define (dispatch-key p)
+  (cond
+   ((and (pair? p)
+         (equal? 'quote (car p))
+         (pair? (cdr p))
+         (null? (cddr p))
+         (symid? (cadr p)))
+    (list (symbolize (cadr p))))
+   ((or (boolean? p) (char? p) (exact-integer? p)) (list p))
+   (else #f)))
+
+;; Returns 'self if pattern P is a literal, 'car if P is a pair pattern
+;; whose car is a literal, or #f.
+(define (dispatch-position p)
+  (cond
+   ((dispatch-key p) 'self)
+   ((and (pair? p)
+         (dispatch-key (car p))
+         (not (and (pair? (cdr p)) (dot-dot-k? (cadr p)))))
+    'car)
+   (else #f)))
+
+(define (dispatch-literal p pos)
+  (if (eq? pos 'self) p (car p)))
+
+;; Returns (pos (datum clause ...) ...) for the longest run of leading
+;; clauses that dispatch at the same position, grouped by the key datum
+;; in the order of appearance.  Returns #f unless there are at least
+;; two distinct keys.
+(define (dispatch-run plist)
+  (and (pair? plist)
+       (let ((pos (dispatch-position (caar plist))))
+         (and pos
+              (let loop ((ps plist) (groups '()))
+                (if (and (pair? ps)
+                         (eq? (dispatch-position (caar ps)) pos))
+                  (let* ((d (car (dispatch-key
+                                  (dispatch-literal (caar ps) pos))))
+                         (g (assv d groups)))
+                    (if g
+                      (begin (set-cdr! g (cons (car ps) (cdr g)))
+                             (loop (cdr ps) groups))
+                      (loop (cdr ps) (cons (list d (car ps)) groups))))
+                  (and (pair? groups)
+                       (pair? (cdr groups))
+                       (cons pos
+                             (reverse
+                              (map (lambda (g) (cons (car g) (reverse (cdr g))))
+                                   groups))))))))))
+
+;; Each branch of the generated 'case' tries the clauses of its group
+;; followed by the clauses after the run; the knowledge that the key
+;; equals (or doesn't equal) the literals lets the generic code skip
+;; the tests already done.
+(define (gen-dispatch x sf plist run erract eta)
+  (let* ((pos (car run))
+         (groups (cdr run))
+         (rest (list-tail plist (apply + (map (lambda (g) (length (cdr g)))
+                                              groups))))
+         (key (if (eq? pos 'self) x (add-a x)))
+         (facts (lambda (g)
+                  (map (lambda (c)
+                         `(equal? ,key ,(dispatch-literal (car c) pos)))
+                       (cdr g))))
+         (dispatch
+          (lambda (sf)
+            `(case ,key
+               ,@(map (lambda (g)
+                        `((,(car g))
+                          ,(gen x (append (facts g) sf) (append (cdr g) rest)
+                                erract eta)))
+                      groups)
+               (else
+                ,(gen x (append (map (lambda (t) `(not ,t))
+                                     (apply append (map facts groups)))
+                                sf)
+                      rest erract eta))))))
+    (if (eq? pos 'self)
+      (dispatch sf)
+      (emit `(pair? ,x) sf
+            (lambda (sf) (gen x sf rest erract eta))
+            dispatch))))
+
+(define (gen-clauses x sf plist erract eta)
   (if (null? plist)
     (erract x)
     (let* ((v '())
@@ -141,7 +141,11 @@
           debug-print-pre debug-print-post debug-funcall-pre)
 
 (autoload gauche.vm.profiler
-          profiler-show profiler-show-load-stats with-profiler)
+          profiler-show profiler-show-load-stats with-profiler
+          profiler-get-stacks profiler-get-thread-results
+          profiler-get-allocation-result
+          profiler-write-folded profiler-write-pprof
+          lock-profiler-get-result lock-profiler-show with-lock-profiler)
 
 (autoload srfi-0  (:macro cond-expand))
 (autoload srfi-7  (:macro program))
@@ -149,7 +153,8 @@
 (autoload srfi-31 (:macro rec))
 (autoload srfi-55 (:macro require-extension))
 
-(autoload gauche.interpolate string-interpolate)
+(autoload gauche.interpolate string-interpolate
+          (:macro display-interpolated))
 
 (autoload "gauche/sysutil"
           sys-realpath sys-fdset list->sys-fdset sys-fdset->list)
@@ -190,7 +195,8 @@
                           string-hash string-ci-hash
                           symbol-hash number-hash hash-bound)
 
-(autoload gauche.treeutil make-tree-map tree-map-empty?
+(autoload gauche.treeutil make-tree-map make-tree-map/btree
+                          tree-map-empty?
                           tree-map-min tree-map-max
                           tree-map-pop-min! tree-map-pop-max!
                           tree-map-fold tree-map-fold-right
@@ -85,6 +85,20 @@ char *alloca ();
 #include "gauche/bits_inline.h"
 #include "gauche/bignum.h"
 
+/* If configured with --with-gmp, we use GMP's low-level mpn functions
+   for multiplication, division and gcd.  An mpn number is an array of
+   limbs, least significant first, which is exactly our values[] as
+   long as a limb is an unsigned long.  So we can pass our arrays
+   directly without conversion. */
+#if defined(HAVE_GMP)
+#include <gmp.h>
+#if GMP_LIMB_BITS == SIZEOF_LONG*8 && GMP_NAIL_BITS == 0
+#define USE_GMP 1
+#define LIMBS(p)   ((mp_limb_t*)(p))
+#define CLIMBS(p)  ((const mp_limb_t*)(p))
+#endif
+#endif
+
 #undef min
 #define min(x, y)   (((x) < (y))? (x) : (y))
 #undef max
@@ -838,12 +852,322 @@ static ScmBignum *bignum_mul_word(ScmBignum *br, const ScmBignum *bx,
     return br;
 }
 
+/* Subquadratic multiplication.
+ *
+ * These routines work on raw little-endian arrays of words rather than
+ * ScmBignums, so that we can operate on slices without copying.  The
+ * numbers are unsigned.  The result area must not overlap the operands.
+ *
+ * Above KARATSUBA_THRESHOLD words we use Karatsuba's method, and above
+ * TOOM3_THRESHOLD words Toom-Cook 3-way with Bodrato's evaluation points
+ * (0, 1, -1, -2, inf) and interpolation sequence (Marco Bodrato, "Towards
+ * Optimal Toom-Cook Multiplication for Univariate and Multivariate
+ * Polynomials in Characteristic 2 and 0", WAIFI 2007).  The thresholds
+ * were chosen by timing on x86_64; they're not critical.
+ */
+#define KARATSUBA_THRESHOLD  32
+#define TOOM3_THRESHOLD      160
+
+static void words_mul(u_long *r, const u_long *a, int an,
+                      const u_long *b, int bn);
+
+static u_long *words_alloc(int n)
+{
+    return SCM_NEW_ATOMIC_ARRAY(u_long, n);
+}
+
+/* r[0..n) += a[0..an), where an <= n.  Returns the carry. */
+static u_long words_add(u_long *r, int n, const u_long *a, int an)
+{
+    u_long c = 0, r1;
+    int i;
+    for (i=0; i<an; i++) {
+        UADD(r1, c, r[i], a[i]);
+        r[i] = r1;
+    }
+    for (; c && i<n; i++) {
+        UADD(r1, c, r[i], 0);
+        r[i] = r1;
+    }
+    return c;
+}
+
+/* r[0..n) -= a[0..an), where an <= n.  Returns the borrow. */
+static u_long words_sub(u_long *r, int n, const u_long *a, int an)
+{
+    u_long c = 0, r1;
+    int i;
+    for (i=0; i<an; i++) {
+        USUB(r1, c, r[i], a[i]);
+        r[i] = r1;
+    }
+    for (; c && i<n; i++) {
+        USUB(r1, c, r[i], 0);
+        r[i] = r1;
+    }
+    return c;
+}
+
+/* r[0..n) = a[0..an) + b[0..bn), where an, bn <= n. */
+static void words_add3(u_long *r, int n,
+                       const u_long *a, int an, const u_long *b, int bn)
+{
+    for (int i=0; i<n; i++) r[i] = (i < an)? a[i] : 0;
+    words_add(r, n, b, bn);
+}
+
+/* Compares a[0..n) and b[0..n). */
+static int words_cmp(const u_long *a, const u_long *b, int n)
+{
+    for (int i=n-1; i>=0; i--) {
+        if (a[i] < b[i]) return -1;
+        if (a[i] > b[i]) return 1;
+    }
+    return 0;
+}
+
+/* Signed addition on sign-magnitude numbers of n words:
+   r = sa*a + sb*b, where the magnitude goes to r and the sign is
+   returned.  r may be the same as a or b. */
+static int words_signed_add(u_long *r, const u_long *a, int sa,
+                            const u_long *b, int sb, int n)
+{
+    u_long c = 0, r1;
+    if (sa == sb) {
+        for (int i=0; i<n; i++) {
+            UADD(r1, c, a[i], b[i]);
+            r[i] = r1;
+        }
+        return sa;
+    }
+    if (words_cmp(a, b, n) < 0) {
+        const u_long *t = a; a = b; b = t;
+        sa = sb;
+    }
+    for (int i=0; i<n; i++) {
+        USUB(r1, c, a[i], b[i]);
+        r[i] = r1;
+    }
+    return sa;
+}
+
+/* r[0..n) <<= bits, where 0 < bits < WORD_BITS */
+static void words_lshift(u_long *r, int n, int bits)
+{
+    for (int i=n-1; i>0; i--) {
+        r[i] = (r[i] << bits) | (r[i-1] >> (WORD_BITS-bits));
+    }
+    r[0] <<= bits;
+}
+
+/* r[0..n) >>= bits, where 0 < bits < WORD_BITS */
+static void words_rshift(u_long *r, int n, int bits)
+{
+    for (int i=0; i<n-1; i++) {
+        r[i] = (r[i] >> bits) | (r[i+1] << (WORD_BITS-bits));
+    }
+    r[n-1] >>= bits;
+}
+
+/* r[0..n) >>= 1 */
+static void words_rshift1(u_long *r, int n)
+{
+    for (int i=0; i<n-1; i++) {
+        r[i] = (r[i] >> 1) | (r[i+1] << (WORD_BITS-1));
+    }
+    r[n-1] >>= 1;
+}
+
+/* r[0..n) /= 3, assuming the division is exact. */
+static void words_divexact3(u_long *r, int n)
+{
+    u_long rem = 0;
+    for (int i=n-1; i>=0; i--) {
+        /* (rem:r[i]) / 3, where rem < 3 */
+        u_long hi = (rem << HALF_BITS) | HI(r[i]);
+        u_long qh = hi / 3;
+        u_long lo = ((hi % 3) << HALF_BITS) | LO(r[i]);
+        u_long ql = lo / 3;
+        rem = lo % 3;
+        r[i] = (qh << HALF_BITS) | ql;
+    }
+}
+
+/* Adds a[0..an) << (off words) into r[0..rn).  The caller guarantees
+   the sum fits in rn words. */
+static void words_add_at(u_long *r, int rn, int off,
+                         const u_long *a, int an)
+{
+    while (an > 0 && a[an-1] == 0) an--;
+    if (an > rn - off) an = rn - off;
+    if (an > 0) words_add(r+off, rn-off, a, an);
+}
+
+/* Schoolbook multiplication.  r[0..an+bn) = a * b */
+static void words_mul_basecase(u_long *r, const u_long *a, int an,
+                               const u_long *b, int bn)
+{
+    for (int i=0; i<an+bn; i++) r[i] = 0;
+    for (int j=0; j<bn; j++) {
+        u_long y = b[j], c = 0;
+        if (y == 0) continue;
+        for (int i=0; i<an; i++) {
+            u_long hi, lo, r1, r2, c1 = 0, c2 = 0;
+            UMUL(hi, lo, a[i], y);
+            UADD(r1, c1, r[i+j], lo);
+            UADD(r2, c2, r1, c);
+            r[i+j] = r2;
+            c = hi + c1 + c2;   /* never overflows */
+        }
+        r[an+j] = c;
+    }
+}
+
+/* Karatsuba.  Requires an >= bn > h, where h = ceil(an/2).
+   a = a1*B^h + a0,  b = b1*B^h + b0,
+   a*b = z2*B^2h + ((a0+a1)(b0+b1) - z0 - z2)*B^h + z0 */
+static void words_karatsuba(u_long *r, const u_long *a, int an,
+                            const u_long *b, int bn)
+{
+    int h = (an+1)/2;
+    int n = an + bn;
+    u_long *sa = words_alloc(4*h + 4);
+    u_long *sb = sa + h + 1;
+    u_long *m = sb + h + 1;
+
+    words_add3(sa, h+1, a, h, a+h, an-h);
+    words_add3(sb, h+1, b, h, b+h, bn-h);
+    words_mul(m, sa, h+1, sb, h+1);
+    words_mul(r, a, h, b, h);                   /* z0 */
+    words_mul(r+2*h, a+h, an-h, b+h, bn-h);     /* z2 */
+    words_sub(m, 2*h+2, r, 2*h);
+    words_sub(m, 2*h+2, r+2*h, n-2*h);
+    words_add_at(r, n, h, m, 2*h+2);
+}
+
+/* Evaluates x0 + x1*t + x2*t^2 at t = 1, -1, -2, stores the results
+   in v1, vm1, vm2, each of k+1 words, and returns the signs of
+   vm1 and vm2 in *sm1 and *sm2. */
+static void toom3_eval(const u_long *x, int xn, int k,
+                       u_long *v1, u_long *vm1, int *sm1,
+                       u_long *vm2, int *sm2)
+{
+    const u_long *x0 = x, *x1 = x + k, *x2 = x + 2*k;
+    int x2n = xn - 2*k;
+    u_long *p = words_alloc(k+1);
+    u_long *t = words_alloc(k+1);
+
+    words_add3(p, k+1, x0, k, x2, x2n);         /* p = x0 + x2 */
+    words_add3(v1, k+1, p, k+1, x1, k);         /* v1 = p + x1 */
+    for (int i=0; i<=k; i++) t[i] = (i < k)? x1[i] : 0;
+    *sm1 = words_signed_add(vm1, p, 1, t, -1, k+1); /* vm1 = p - x1 */
+    /* vm2 = (x0 + 4*x2) - 2*x1 */
+    for (int i=0; i<=k; i++) p[i] = (i < x2n)? x2[i] : 0;
+    words_lshift(p, k+1, 2);
+    words_add(p, k+1, x0, k);
+    words_lshift(t, k+1, 1);
+    *sm2 = words_signed_add(vm2, p, 1, t, -1, k+1);
+}
+
+/* Toom-3.  Requires an >= bn > 2k, where k = ceil(an/3). */
+static void words_toom3(u_long *r, const u_long *a, int an,
+                        const u_long *b, int bn)
+{
+    int k = (an+2)/3;
+    int n = an + bn;
+    int L = 2*k + 2;            /* size of pointwise products */
+    int sam1, sam2, sbm1, sbm2;
+    u_long *ev = words_alloc(6*(k+1));
+    u_long *a1 = ev, *am1 = a1+k+1, *am2 = am1+k+1;
+    u_long *b1 = am2+k+1, *bm1 = b1+k+1, *bm2 = bm1+k+1;
+    u_long *w = words_alloc(3*L);
+    u_long *w1 = w, *wm1 = w1+L, *wm2 = wm1+L;
+
+    toom3_eval(a, an, k, a1, am1, &sam1, am2, &sam2);
+    toom3_eval(b, bn, k, b1, bm1, &sbm1, bm2, &sbm2);
+
+    words_mul(w1, a1, k+1, b1, k+1);
+    words_mul(wm1, am1, k+1, bm1, k+1);
+    words_mul(wm2, am2, k+1, bm2, k+1);
+    int sm1 = sam1*sbm1, sm2 = sam2*sbm2;
+
+    /* w0 and winf go directly to the result */
+    for (int i=0; i<n; i++) r[i] = 0;
+    words_mul(r, a, k, b, k);                       /* w0 */
+    words_mul(r+4*k, a+2*k, an-2*k, b+2*k, bn-2*k); /* winf */
+
+    u_long *w0 = words_alloc(L), *winf = words_alloc(L);
+    for (int i=0; i<L; i++) w0[i] = (i < 2*k)? r[i] : 0;
+    for (int i=0; i<L; i++) winf[i] = (i < n-4*k)? r[4*k+i] : 0;
+    for (int i=0; i<2*k; i++) r[i] = 0;
+    for (int i=4*k; i<n; i++) r[i] = 0;
+
+    /* Interpolation.  The comments show Bodrato's sequence. */
+    /* w3 = (wm2 - w1)/3 */
+    int s3 = words_signed_add(wm2, wm2, sm2, w1, -1, L);
+    words_divexact3(wm2, L);
+    u_long *w3 = wm2;
+    /* w1 = (w1 - wm1)/2 */
+    words_signed_add(w1, w1, 1, wm1, -sm1, L);
+    words_rshift1(w1, L);
+    /* w2 = wm1 - w0 */
+    int s2 = words_signed_add(wm1, wm1, sm1, w0, -1, L);
+    u_long *w2 = wm1;
+    /* w3 = (w2 - w3)/2 + 2*winf */
+    s3 = words_signed_add(w3, w2, s2, w3, -s3, L);
+    words_rshift1(w3, L);
+    s3 = words_signed_add(w3, w3, s3, winf, 1, L);
+    s3 = words_signed_add(w3, w3, s3, winf, 1, L);
+    /* w2 = w2 + w1 - winf */
+    s2 = words_signed_add(w2, w2, s2, w1, 1, L);
+    s2 = words_signed_add(w2, w2, s2, winf, -1, L);
+    /* w1 = w1 - w3 */
+    words_signed_add(w1, w1, 1, w3, -s3, L);
+
+    /* Recomposition */
+    words_add_at(r, n, 0, w0, L);
+    words_add_at(r, n, k, w1, L);
+    words_add_at(r, n, 2*k, w2, L);
+    words_add_at(r, n, 3*k, w3, L);
+    words_add_at(r, n, 4*k, winf, L);
+}
+
+/* r[0..an+bn) = a * b.  Requires an >= bn. */
+static void words_mul(u_long *r, const u_long *a, int an,
+                      const u_long *b, int bn)
+{
+#if USE_GMP
+    if (a == b && an == bn) mpn_sqr(LIMBS(r), CLIMBS(a), an);
+    else                    mpn_mul(LIMBS(r), CLIMBS(a), an, CLIMBS(b), bn);
+    return;
+#endif
+    if (bn < KARATSUBA_THRESHOLD) {
+        words_mul_basecase(r, a, an, b, bn);
+    } else if (2*bn <= an + 1) {
+        /* Unbalanced.  Multiply b by bn-word slices of a. */
+        u_long *t = words_alloc(2*bn);
+        for (int i=0; i<an+bn; i++) r[i] = 0;
+        for (int off=0; off<an; off+=bn) {
+            int sn = min(bn, an - off);
+            if (sn == bn) words_mul(t, a+off, sn, b, bn);
+            else          words_mul(t, b, bn, a+off, sn);
+            words_add_at(r, an+bn, off, t, sn+bn);
+        }
+    } else if (bn < TOOM3_THRESHOLD || 3*bn <= 2*an + 6) {
+        words_karatsuba(r, a, an, b, bn);
+    } else {
+        words_toom3(r, a, an, b, bn);
+    }
+}
+
 /* returns bx * by.  not normalized */
 static ScmBignum *bignum_mul(const ScmBignum *bx, const ScmBignum *by)
 {
     ScmBignum *br = make_bignum(bx->size + by->size);
-    for (u_int i=0; i<by->size; i++) {
-        bignum_mul_word(br, bx, by->values[i], i);
+    if (bx->size >= by->size) {
+        words_mul(br->values, bx->values, bx->size, by->values, by->size);
+    } else {
+        words_mul(br->values, by->values, by->size, bx->values, bx->size);
     }
     br->sign = bx->sign * by->sign;
     return br;
@@ -999,6 +1323,150 @@ static ScmBignum *bignum_gdiv(const ScmBignum *dividend,
     return u;
 }
 
+/* Recursive division (Christoph Burnikel and Joachim Ziegler, "Fast
+ * Recursive Division", MPI-I-98-1-022, 1998).
+ *
+ * Like the multiplication routines, these work on raw word arrays.  The
+ * divisor must be normalized, i.e. its MSB is set.  The recursion bottoms
+ * out to bignum_gdiv.  Combined with Karatsuba/Toom-3 multiplication,
+ * the cost becomes a small multiple of multiplication instead of O(n^2).
+ */
+#define BZ_THRESHOLD  100
+
+/* q[0..an-bn) and r[0..bn) <- a[0..an) / b[0..bn), where the quotient
+   is known to fit in an-bn words. */
+static void words_div_basecase(u_long *q, u_long *r,
+                               const u_long *a, int an,
+                               const u_long *b, int bn)
+{
+    ScmBignum *u = make_bignum(an);
+    ScmBignum *v = make_bignum(bn);
+    ScmBignum *qq = make_bignum(an - bn + 1);
+    for (int i=0; i<an; i++) u->values[i] = a[i];
+    for (int i=0; i<bn; i++) v->values[i] = b[i];
+    ScmBignum *rr = bignum_gdiv(u, v, qq);
+    for (int i=0; i<an-bn; i++) q[i] = qq->values[i];
+    for (int i=0; i<bn; i++) r[i] = rr->values[i];
+}
+
+static void words_div_3n2n(u_long *q, u_long *r, const u_long *a,
+                           const u_long *b, int h);
+
+/* q[0..n), r[0..n) <- a[0..2n) / b[0..n), where a < b*B^n. */
+static void words_div_2n1n(u_long *q, u_long *r, const u_long *a,
+                           const u_long *b, int n)
+{
+    if (n%2 || n < BZ_THRESHOLD) {
+        words_div_basecase(q, r, a, 2*n, b, n);
+        return;
+    }
+    int h = n/2;
+    u_long *t = words_alloc(3*h);
+    /* [a3 a2 a1] / b -> q1, [r1 r2] */
+    words_div_3n2n(q+h, t+h, a+h, b, h);
+    /* [r1 r2 a0] / b -> q0, r */
+    for (int i=0; i<h; i++) t[i] = a[i];
+    words_div_3n2n(q, r, t, b, h);
+}
+
+/* q[0..h), r[0..2h) <- a[0..3h) / b[0..2h), where a < b*B^h. */
+static void words_div_3n2n(u_long *q, u_long *r, const u_long *a,
+                           const u_long *b, int h)
+{
+    const u_long *a1 = a+2*h, *b1 = b+h;
+    int n = 2*h;
+    u_long *t = words_alloc(n+1);   /* r1*B^h + a3, with a carry word */
+    u_long *d = words_alloc(n+1);
+
+    for (int i=0; i<h; i++) t[i] = a[i];
+    if (words_cmp(a1, b1, h) < 0) {
+        words_div_2n1n(q, t+h, a+h, b1, h);
+        t[n] = 0;
+    } else {
+        /* q = B^h - 1, r1 = [a1 a2] - q*b1 = [a1 a2] - [b1 0] + b1 */
+        for (int i=0; i<h; i++) q[i] = ~0UL;
+        for (int i=0; i<h; i++) t[h+i] = a[h+i];
+        t[n] = words_add(t+h, h, b1, h);
+        /* a1 - b1 is zero here, since a < b*B^h */
+    }
+    /* r = [r1 a3] - q*b2; adjust while it's negative */
+    words_mul(d, q, h, b, h);
+    d[n] = 0;
+    u_long one = 1;
+    while (words_cmp(t, d, n+1) < 0) {
+        t[n] += words_add(t, n, b, n);
+        words_sub(q, h, &one, 1);
+    }
+    words_sub(t, n+1, d, n+1);
+    for (int i=0; i<n; i++) r[i] = t[i];
+}
+
+/* q[0..an-bn+1), r[0..bn) <- a[0..an) / b[0..bn), where an >= bn and
+   b[bn-1] != 0. */
+static void words_divrem(u_long *q, u_long *r, const u_long *a, int an,
+                         const u_long *b, int bn)
+{
+    /* Choose the block size n >= bn so that n = m*2^k where m <
+       BZ_THRESHOLD, and pad the divisor with zero words to fill it.
+       Then normalize the divisor. */
+    int k = 0;
+    while ((BZ_THRESHOLD << k) < bn) k++;
+    int m = (bn + (1<<k) - 1) >> k;
+    int n = m << k;
+    int pad = n - bn;
+    int shift = div_normalization_factor(b[bn-1]);
+
+    u_long *bb = words_alloc(n);
+    for (int i=0; i<pad; i++) bb[i] = 0;
+    for (int i=0; i<bn; i++) bb[pad+i] = b[i];
+    if (shift) words_lshift(bb, n, shift);
+
+    /* Dividend is split into t blocks of n words.  The top block must
+       be less than the divisor, which is guaranteed if its MSB is 0. */
+    int L = an + pad + 1;
+    int t = L/n + 1;
+    u_long *aa = words_alloc(t*n);
+    for (int i=0; i<t*n; i++) aa[i] = 0;
+    for (int i=0; i<an; i++) aa[pad+i] = a[i];
+    if (shift) words_lshift(aa, t*n, shift);
+
+    u_long *qq = words_alloc((t-1)*n);
+    u_long *z = words_alloc(2*n);
+    for (int i=0; i<2*n; i++) z[i] = aa[(t-2)*n + i];
+    for (int i=t-2; i>=0; i--) {
+        words_div_2n1n(qq + i*n, z+n, z, bb, n);
+        if (i > 0) {
+            for (int j=0; j<n; j++) z[j] = aa[(i-1)*n + j];
+        }
+    }
+    /* z[n..2n) has the remainder, scaled. */
+    if (shift) words_rshift(z+n, n, shift);
+    for (int i=0; i<bn; i++) r[i] = z[n+pad+i];
+    for (int i=0; i<an-bn+1; i++) q[i] = (i < (t-1)*n)? qq[i] : 0;
+}
+
+/* Dispatches to bignum_gdiv or words_divrem, depending on the size.
+   Same protocol as bignum_gdiv. */
+static ScmBignum *bignum_divrem(const ScmBignum *dividend,
+                                const ScmBignum *divisor,
+                                ScmBignum *quotient)
+{
+    int an = dividend->size, bn = divisor->size;
+#if USE_GMP
+    ScmBignum *rem = make_bignum(bn);
+    mpn_tdiv_qr(LIMBS(quotient->values), LIMBS(rem->values), 0,
+                CLIMBS(dividend->values), an, CLIMBS(divisor->values), bn);
+    return rem;
+#endif
+    if (bn < 2*BZ_THRESHOLD || an - bn < 2*BZ_THRESHOLD) {
+        return bignum_gdiv(dividend, divisor, quotient);
+    }
+    ScmBignum *r = make_bignum(bn);
+    words_divrem(quotient->values, r->values, dividend->values, an,
+                 divisor->values, bn);
+    return r;
+}
+
 /* Fast path if divisor fits in a half word.  Quotient remains in the
    dividend's memory.   Remainder returned.  Quotient not normalized. */
 static u_long bignum_sdiv(ScmBignum *dividend, u_long divisor)
@@ -1096,13 +1564,70 @@ ScmObj Scm_BignumDivRem(const ScmBignum *dividend, const ScmBignum *divisor)
     }
 
     ScmBignum *q = make_bignum(dividend->size - divisor->size + 1);
-    ScmBignum *r = bignum_gdiv(dividend, divisor, q);
+    ScmBignum *r = bignum_divrem(dividend, divisor, q);
     q->sign = dividend->sign * divisor->sign;
     r->sign = dividend->sign;
 
     return Scm_Cons(Scm_NormalizeBignum(q), Scm_NormalizeBignum(r));
 }
 
+#if USE_GMP
+/* Returns a fresh copy of a[0..*n) >> sh, and sets its trimmed
+   size to *n. */
+static u_long *words_shift_down(const u_long *a, int *n, int sh)
+{
+    int wo = sh / WORD_BITS, bits = sh % WORD_BITS;
+    int m = *n - wo;
+    u_long *t = words_alloc(m + 1);
+    for (int i=0; i<m; i++) t[i] = a[wo+i];
+    t[m] = 0;
+    if (bits) words_rshift(t, m, bits);
+    while (m > 1 && t[m-1] == 0) m--;
+    *n = m;
+    return t;
+}
+
+static int words_lowest_bit(const u_long *a)
+{
+    int i = 0;
+    while (a[i] == 0) i++;
+    return i*WORD_BITS + Scm__LowestBitNumber(a[i]);
+}
+#endif /*USE_GMP*/
+
+/* Returns gcd(|x|, |y|), both x and y being normalized bignums. */
+ScmObj Scm_BignumGcd(const ScmBignum *x, const ScmBignum *y)
+{
+#if USE_GMP
+    /* mpn_gcd requires one of the operands to be odd.  We divide out
+       the powers of 2 first, and multiply the common one back. */
+    int zx = words_lowest_bit(x->values), zy = words_lowest_bit(y->values);
+    int un = x->size, vn = y->size;
+    u_long *u = words_shift_down(x->values, &un, zx);
+    u_long *v = words_shift_down(y->values, &vn, zy);
+    if (un < vn) {
+        u_long *t = u; u = v; v = t;
+        int tn = un; un = vn; vn = tn;
+    }
+    u_long *g = words_alloc(vn);
+    int gn = (int)mpn_gcd(LIMBS(g), LIMBS(u), un, LIMBS(v), vn);
+    ScmObj r = Scm_NormalizeBignum(SCM_BIGNUM(Scm_MakeBignumFromUIArray(1, g, gn)));
+    return Scm_Ash(r, min(zx, zy));
+#else  /*!USE_GMP*/
+    /* We could use Algorithm L in Knuth's TAOCP 4.5.2, but we assume this
+       path is rarely executed, so we don't bother for now. */
+    ScmObj u = Scm_Abs(SCM_OBJ(x)), v = Scm_Abs(SCM_OBJ(y));
+    if (Scm_NumCmp(u, v) < 0) {ScmObj t = u; u = v; v = t;}
+
+    while (!SCM_EXACT_ZERO_P(v)) {
+        ScmObj r = Scm_Modulo(u, v, TRUE);
+        u = v;
+        v = r;
+    }
+    return u;
+#endif /*!USE_GMP*/
+}
+
 /*-----------------------------------------------------------------------
  * Logical (bitwise) opertaions
  */
@@ -1277,24 +1802,107 @@ int Scm_BignumLogCount(const ScmBignum *b)
  * Printing
  */
 
+/* Radix conversion.
+ *
+ * Small bignums are converted by repeatedly dividing by the largest power
+ * of the radix that fits in a half word.  For larger ones we use divide
+ * and conquer (cf. Brent & Zimmermann, "Modern Computer Arithmetic",
+ * 1.7): given the table of radix^(d*2^i), we divide the number by one
+ * close to its square root, and convert the quotient and the remainder
+ * recursively.  With subquadratic division, it beats quadratic loop.
+ */
+#define RADIX_DC_THRESHOLD  40  /* in words */
+
+/* Writes out the digits of Q (destroyed) backward, ending at END,
+   padded with '0' to at least PAD digits.  Returns the start. */
+static char *bignum_to_digits_simple(ScmBignum *q, int radix,
+                                     const char *tab, char *end, int pad)
+{
+    u_long chunk = radix;
+    int cd = 1;
+    while (chunk * radix < (u_long)HALF_WORD) { chunk *= radix; cd++; }
+
+    char *p = end;
+    while (q->size > 0) {
+        u_long rem = bignum_sdiv(q, chunk);
+        for (; q->size > 0 && q->values[q->size-1] == 0; q->size--)
+            ;
+        for (int i=0; i<cd; i++) {
+            *--p = tab[rem % radix];
+            rem /= radix;
+            if (q->size == 0 && rem == 0) break;
+        }
+    }
+    while (end - p < pad) *--p = '0';
+    return p;
+}
+
+/* X is a nonnegative integer.  POWS[i] is radix^PDIGS[i]. */
+static char *bignum_to_digits(ScmObj x, int radix, const char *tab,
+                              ScmObj *pows, int *pdigs, int i,
+                              char *end, int pad)
+{
+    if (SCM_INTP(x)) {
+        ScmBignum *q = SCM_BIGNUM(Scm_MakeBignumFromSI(SCM_INT_VALUE(x)));
+        return bignum_to_digits_simple(q, radix, tab, end, pad);
+    }
+    if (i < 0 || SCM_BIGNUM_SIZE(x) < RADIX_DC_THRESHOLD) {
+        ScmBignum *q = SCM_BIGNUM(Scm_BignumCopy(SCM_BIGNUM(x)));
+        return bignum_to_digits_simple(q, radix, tab, end, pad);
+    }
+    if (Scm_NumCmp(x, pows[i]) < 0) {
+        return bignum_to_digits(x, radix, tab, pows, pdigs, i-1, end, pad);
+    }
+    ScmObj r;
+    ScmObj q = Scm_Quotient(x, pows[i], &r);
+    char *p = bignum_to_digits(r, radix, tab, pows, pdigs, i-1, end, pdigs[i]);
+    return bignum_to_digits(q, radix, tab, pows, pdigs, i-1, p,
+                            max(pad - pdigs[i], 0));
+}
+
 ScmObj Scm_BignumToString(const ScmBignum *b, int radix, int use_upper)
 {
     static const char ltab[] = "0123456789abcdefghijklmnopqrstuvwxyz";
     static const char utab[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
     const char *tab = use_upper? utab : ltab;
-    ScmObj h = SCM_NIL, t = SCM_NIL;
     if (radix < 2 || radix > 36)
         Scm_Error("radix out of range: %d", radix);
-    ScmBignum *q = SCM_BIGNUM(Scm_BignumCopy(b));
-    for (;q->size > 0;) {
-        long rem = bignum_sdiv(q, radix);
-        SCM_ASSERT(rem >= 0 && rem < radix);
-        SCM_APPEND1(h, t, SCM_MAKE_CHAR(tab[rem]));
-        for (; q->values[q->size-1] == 0 && q->size > 0; q->size--)
-            ;
+
+    /* Upper bound of the number of digits. */
+    int log2r = 0;
+    while ((2 << log2r) <= radix) log2r++;
+    int maxdigits = (b->size * WORD_BITS + log2r - 1) / log2r + 1;
+    char *buf = SCM_NEW_ATOMIC2(char*, maxdigits + 2);
+    char *end = buf + maxdigits + 1;
+    *end = '\0';
+
+    ScmBignum *a = SCM_BIGNUM(Scm_BignumCopy(b));
+    a->sign = 1;
+    char *p;
+    if (a->size < RADIX_DC_THRESHOLD) {
+        p = bignum_to_digits_simple(a, radix, tab, end, 0);
+    } else {
+        /* pows[i] = radix^(d*2^i), where radix^d is the largest power
+           that fits in a fixnum. */
+        ScmObj pows[64];
+        int pdigs[64];
+        u_long n = radix;
+        int d = 1;
+        while (n <= (u_long)SCM_SMALL_INT_MAX / radix) { n *= radix; d++; }
+        pows[0] = Scm_MakeIntegerU(n);
+        pdigs[0] = d;
+        int k;
+        for (k = 0; k < 63; k++) {
+            if (!SCM_INTP(pows[k]) && SCM_BIGNUM_SIZE(pows[k])*2 > a->size)
+                break;
+            pows[k+1] = Scm_Mul(pows[k], pows[k]);
+            pdigs[k+1] = pdigs[k]*2;
+        }
+        p = bignum_to_digits(Scm_NormalizeBignum(a), radix, tab,
+                             pows, pdigs, k, end, 0);
     }
-    if (q->sign < 0) SCM_APPEND1(h, t, SCM_MAKE_CHAR('-'));
-    return Scm_ListToString(Scm_ReverseX(h));
+    if (b->sign < 0) *--p = '-';
+    return Scm_MakeString(p, end - p, end - p, SCM_STRING_COPYING);
 }
 
 int Scm_DumpBignum(const ScmBignum *b, ScmPort *out)
@@ -231,7 +231,7 @@ int Scm_BitsLowest1(const ScmBits *bits, int start, int end)
     } else {
         u_long w = bits[sw] & SCM_BITS_MASK(sb, 0);
         if (w) return lowest(w) + sw*SCM_WORD_BITS;
-        for (;sw < ew; sw++) {
+        for (sw++; sw < ew; sw++) {
             if (bits[sw]) return lowest(bits[sw])+sw*SCM_WORD_BITS;
         }
         w = bits[ew] & SCM_BITS_MASK(0, eb);
@@ -255,7 +255,7 @@ int Scm_BitsLowest0(const ScmBits *bits, int start, int end)
     } else {
         u_long w = ~bits[sw] & SCM_BITS_MASK(sb, 0);
         if (w) return lowest(w) + sw*SCM_WORD_BITS;
-        for (;sw < ew; sw++) {
+        for (sw++; sw < ew; sw++) {
             if (~bits[sw]) return lowest(~bits[sw])+sw*SCM_WORD_BITS;
         }
         w = ~bits[ew] & SCM_BITS_MASK(0, eb);
@@ -71,15 +71,18 @@ int Scm_EqvP(ScmObj x, ScmObj y)
 }
 
 /* Equal? needs to deal with circuler structures.
-   We adopt the algorithm in Adams&Dybvig's "Efficient Nondestructive
+   We adopt the idea of Adams&Dybvig's "Efficient Nondestructive
    Equality Checking for Trees and Graphs",
    Proceedings of ICFP 08, pp. 179-188.
 
-   It is much easier to write the algorithm in Scheme, but we don't want
-   the overhead of crossing C-Scheme boundary for trivial cases.
-   So we cover a simple cases (non-aggregates, user-defined objects and
-   flat lists/vectors) in C, and fall back to Scheme routine if we encounter
-   more complex structures.
+   We traverse aggregates (pairs and vectors) iteratively with an explicit
+   stack, so that deeply nested structures don't overflow the C stack.
+   Initially we compare without any bookkeeping.  If we visit more than
+   EQUAL_FAST_LIMIT aggregates, the structure is either big or circular;
+   from that point on, we record every pair of aggregates we compare in
+   a union-find table, and when we see a pair that's already known to be
+   in the same equivalence class we regard it as equal.  That guarantees
+   termination on circular structures.
 
    Caveat: The cycle may involve user-defined objects.  To detect such
    cycle, we need to pass down the context info to ScmClass.compare
@@ -88,77 +91,68 @@ int Scm_EqvP(ScmObj x, ScmObj y)
    For now, let such cyclic structures explode.
 */
 
-int Scm_EqualP(ScmObj x, ScmObj y)
+#define EQUAL_FAST_LIMIT  10000
+#define EQUAL_STACK_INIT  32
+
+typedef struct equal_frame_rec {
+    ScmObj x;
+    ScmObj y;
+    ScmSmallInt i;              /* next index of vectors; -1 for pairs */
+} equal_frame;
+
+/* Union-find node */
+typedef struct equal_uf_rec {
+    struct equal_uf_rec *parent; /* NULL if root */
+    ScmSmallInt size;
+} equal_uf;
+
+static equal_uf *equal_uf_find(equal_uf *n)
 {
-#define CHECK_AGGREGATE(a, b)                   \
-    do {                                        \
-        if (SCM_PAIRP(a)) {                     \
-            if (SCM_PAIRP(b)) goto fallback;    \
-            return FALSE;                       \
-        }                                       \
-        if (SCM_VECTORP(a)) {                   \
-            if (SCM_VECTORP(b)) goto fallback;  \
-            return FALSE;                       \
-        }                                       \
-        if (!Scm_EqualP(a, b)) return FALSE;    \
-    } while (0)                                 \
+    while (n->parent) {
+        if (n->parent->parent) n->parent = n->parent->parent;
+        n = n->parent;
+    }
+    return n;
+}
 
+/* Returns TRUE if X and Y are already in the same class; otherwise,
+   merges their classes and returns FALSE. */
+static int equal_uf_unite(ScmHashCore *ht, ScmObj x, ScmObj y)
+{
+    ScmDictEntry *ex = Scm_HashCoreSearch(ht, (intptr_t)x, SCM_DICT_CREATE);
+    ScmDictEntry *ey = Scm_HashCoreSearch(ht, (intptr_t)y, SCM_DICT_CREATE);
+    equal_uf *nx = ex->value? equal_uf_find((equal_uf*)ex->value) : NULL;
+    equal_uf *ny = ey->value? equal_uf_find((equal_uf*)ey->value) : NULL;
+
+    if (nx == NULL && ny == NULL) {
+        equal_uf *n = SCM_NEW(equal_uf);
+        n->parent = NULL;
+        n->size = 1;
+        ex->value = ey->value = (intptr_t)n;
+        return FALSE;
+    }
+    if (nx == NULL) { ex->value = (intptr_t)ny; return FALSE; }
+    if (ny == NULL) { ey->value = (intptr_t)nx; return FALSE; }
+    if (nx == ny) return TRUE;
+    if (nx->size > ny->size) {
+        ny->parent = nx;
+        nx->size += ny->size;
+    } else {
+        nx->parent = ny;
+        ny->size += nx->size;
+    }
+    return FALSE;
+}
+
+/* Compare non-aggregate objects. */
+static int equal_atom(ScmObj x, ScmObj y)
+{
     if (SCM_EQ(x, y)) return TRUE;
 
     if (SCM_NUMBERP(x)) {
         if (!SCM_NUMBERP(y)) return FALSE;
         return Scm_EqvP(x, y);
     }
-    if (SCM_PAIRP(x)) {
-        if (!SCM_PAIRP(y)) return FALSE;
-        /* We loop on "spine" of lists, so that the typical long flat list
-           can be compared quickly.  If we find nested lists/vectors, we
-           jump to Scheme routine.  We adopt hare and tortoise to detect
-           loop in the CDR side. */
-        ScmObj xslow = x; ScmObj yslow = y;
-        int xcirc = FALSE; int ycirc = FALSE;
-        for (;;) {
-            ScmObj carx = SCM_CAR(x);
-            ScmObj cary = SCM_CAR(y);
-            CHECK_AGGREGATE(carx, cary);
-
-            x = SCM_CDR(x); y = SCM_CDR(y);
-            if (!SCM_PAIRP(x) || !SCM_PAIRP(y)) return Scm_EqualP(x, y);
-            carx = SCM_CAR(x); cary = SCM_CAR(y);
-
-            CHECK_AGGREGATE(carx, cary);
-
-            if (xslow == x) {
-                if (ycirc) return TRUE;
-                xcirc = TRUE;
-            }
-            if (yslow == y) {
-                if (xcirc) return TRUE;
-                ycirc = TRUE;
-            }
-
-            x = SCM_CDR(x); y = SCM_CDR(y);
-            if (!SCM_PAIRP(x) || !SCM_PAIRP(y)) return Scm_EqualP(x, y);
-            xslow = SCM_CDR(xslow); yslow = SCM_CDR(yslow);
-        }
-    }
-    if (SCM_VECTORP(x)) {
-        if (!SCM_VECTORP(y)) return FALSE;
-        ScmWord i = 0, len = SCM_VECTOR_SIZE(x);
-        if (SCM_VECTOR_SIZE(y) != len) return FALSE;
-        for (; i < len; i++) {
-            ScmObj xx = SCM_VECTOR_ELEMENT(x, i);
-            ScmObj yy = SCM_VECTOR_ELEMENT(y, i);
-            /* NB: If we detect nested structure in middle of vectors,
-               we run Scheme routine for the entire vector; so we'll test
-               equality of elements before the current one again.  If
-               they are simple objects that's negligible, but there may
-               be objects of user-defined datatypes, for which object-equal?
-               could be expensive; we'll fix it in future. */
-            CHECK_AGGREGATE(xx, yy);
-        }
-        return TRUE;
-    }
     if (SCM_STRINGP(x)) {
         if (!SCM_STRINGP(y)) return FALSE;
         return Scm_StringEqual(SCM_STRING(x), SCM_STRING(y));
@@ -189,16 +183,87 @@ int Scm_EqualP(ScmObj x, ScmObj y)
     ScmClass *cy = Scm_ClassOf(y);
     if (cx == cy && cx->compare) return (cx->compare(x, y, TRUE) == 0);
     else                         return FALSE;
+}
 
- fallback: 
-    {
-        /* Fall back to Scheme version. */
-        static ScmObj equal_interleave_proc = SCM_UNDEFINED;
-        SCM_BIND_PROC(equal_interleave_proc, "%interleave-equal?",
-                      Scm_GaucheInternalModule());
-        return !SCM_FALSEP(Scm_ApplyRec2(equal_interleave_proc, x, y));
+/* Called whenever we descend into a pair of aggregates.  Returns TRUE
+   if we've already compared them or their equivalents. */
+static inline int equal_seen(long *budget, ScmHashCore *ht,
+                             ScmObj x, ScmObj y)
+{
+    if (*budget > 0) {
+        (*budget)--;
+        return FALSE;
+    }
+    if (*budget == 0) {
+        Scm_HashCoreInitSimple(ht, SCM_HASH_EQ, 0, NULL);
+        (*budget)--;
     }
-#undef CHECK_AGGREGATE
+    return equal_uf_unite(ht, x, y);
+}
+
+static int equal_aggregate(ScmObj x, ScmObj y)
+{
+    equal_frame stack0[EQUAL_STACK_INIT];
+    equal_frame *stack = stack0;
+    ScmSmallInt stack_size = EQUAL_STACK_INIT, sp = 0;
+    long budget = EQUAL_FAST_LIMIT;
+    ScmHashCore ht;             /* union-find table, used after budget */
+
+#define PUSH(xx, yy, ii)                                                \
+    do {                                                                \
+        if (sp == stack_size) {                                         \
+            equal_frame *s = SCM_NEW_ARRAY(equal_frame, stack_size*2);  \
+            memcpy(s, stack, sizeof(equal_frame)*stack_size);           \
+            stack = s;                                                  \
+            stack_size *= 2;                                            \
+        }                                                               \
+        stack[sp].x = (xx); stack[sp].y = (yy); stack[sp].i = (ii);     \
+        sp++;                                                           \
+    } while (0)
+
+    for (;;) {
+        if (SCM_EQ(x, y)) {
+            /* fallthrough to pop */
+        } else if (SCM_PAIRP(x)) {
+            if (!SCM_PAIRP(y)) return FALSE;
+            if (!equal_seen(&budget, &ht, x, y)) {
+                PUSH(SCM_CDR(x), SCM_CDR(y), -1);
+                x = SCM_CAR(x); y = SCM_CAR(y);
+                continue;
+            }
+        } else if (SCM_VECTORP(x)) {
+            if (!SCM_VECTORP(y)) return FALSE;
+            ScmSmallInt len = SCM_VECTOR_SIZE(x);
+            if (SCM_VECTOR_SIZE(y) != len) return FALSE;
+            if (len > 0 && !equal_seen(&budget, &ht, x, y)) {
+                if (len > 1) PUSH(x, y, 1);
+                x = SCM_VECTOR_ELEMENT(x, 0); y = SCM_VECTOR_ELEMENT(y, 0);
+                continue;
+            }
+        } else if (!equal_atom(x, y)) {
+            return FALSE;
+        }
+
+        /* Pop the next pair to compare */
+        if (sp == 0) return TRUE;
+        equal_frame *f = &stack[sp-1];
+        if (f->i < 0) {
+            x = f->x; y = f->y;
+            sp--;
+        } else {
+            x = SCM_VECTOR_ELEMENT(f->x, f->i);
+            y = SCM_VECTOR_ELEMENT(f->y, f->i);
+            if (++f->i == SCM_VECTOR_SIZE(f->x)) sp--;
+        }
+    }
+#undef PUSH
+}
+
+int Scm_EqualP(ScmObj x, ScmObj y)
+{
+    if (SCM_EQ(x, y)) return TRUE;
+    if (SCM_PAIRP(x) || SCM_VECTORP(x)) return equal_aggregate(x, y);
+    return equal_atom(x, y);
 }
 
 int Scm_EqualM(ScmObj x, ScmObj y, int mode)
@@ -93,3 +93,144 @@ ScmBox *Scm_MakeBox(ScmObj value)
     SCM_BOX_SET(b, value);
     return b;
 }
+
+/* Boxes for mutable local variables are created by the BOX instruction
+ * as ScmLocalBox, which carries a flonum cell after the ordinary box.
+ * When a flonum is stored into the variable (BOX or LSET), we copy the
+ * double into the cell and let the box point to the cell, instead of
+ * allocating a fresh flonum.  So the flonum accumulator updated by set!
+ * in a loop no longer allocates on every iteration.
+ *
+ * This is safe as long as the cell never escapes, since it is overwritten
+ * by the next assignment.  Local boxes are only visible to BOX, LSET and
+ * UNBOX instructions, and UNBOX returns a copy of the cell on the VM's
+ * flonum register (which is moved to the heap if it needs to be retained,
+ * as any other FLONUM_REG).
+ */
+ScmObj Scm__MakeLocalBox(ScmObj value)
+{
+    ScmLocalBox *b = SCM_NEW(ScmLocalBox);
+    SCM_SET_CLASS(b, &Scm_BoxClass);
+    SCM_LOCAL_BOX_SET(b, value);
+    return SCM_OBJ(b);
+}
+
+/*
+ * Atomic boxes
+ *
+ *  An atomic box holds one Scheme value, which is read and updated with
+ *  atomic operations, so that it can be shared among threads without
+ *  a mutex.  An atomic fxbox is the same, except that it holds a fixnum
+ *  and supports arithmetic and bitwise fetch-and-modify operations.
+ *
+ *  The value is kept as a tagged ScmObj word in AO_t.  Since ScmObj is
+ *  compared by eq?, compare-and-swap works on any value.  For fxboxes,
+ *  adding (delta << 2) to the tagged word keeps the fixnum tag intact,
+ *  so fetch-add is a single AO_fetch_and_add; and/ior on two tagged
+ *  fixnums keep the tag as well, and xor with an untagged mask does.
+ *  Overflow wraps around within the fixnum range.
+ *
+ *  Memory ordering: ref is an acquire load, set! is a release store,
+ *  and read-modify-write operations are full barriers.  That's enough
+ *  to publish an object constructed by one thread through a box to
+ *  others.
+ */
+
+/* Some ARM and SH variants need pthread emulation; see lazy.c */
+#if defined(__SH4__) || defined(__ARMEL__)
+#define AO_USE_PTHREAD_DEFS 1
+#endif
+#include "atomic_ops.h"
+
+struct ScmAtomicBoxRec {
+    SCM_HEADER;
+    volatile AO_t value;
+};
+
+static void abox_print(ScmObj obj, ScmPort *port,
+                       ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<%s %S>",
+               (SCM_ATOMIC_FXBOXP(obj)? "atomic-fxbox" : "atomic-box"),
+               Scm_AtomicBoxRef(SCM_ATOMIC_BOX(obj)));
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_AtomicBoxClass, abox_print);
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_AtomicFxboxClass, abox_print);
+
+ScmObj Scm_MakeAtomicBox(ScmObj value)
+{
+    ScmAtomicBox *b = SCM_NEW(ScmAtomicBox);
+    SCM_SET_CLASS(b, SCM_CLASS_ATOMIC_BOX);
+    AO_store_release(&b->value, (AO_t)SCM_WORD(value));
+    return SCM_OBJ(b);
+}
+
+ScmObj Scm_MakeAtomicFxbox(ScmSmallInt value)
+{
+    ScmAtomicBox *b = SCM_NEW(ScmAtomicBox);
+    SCM_SET_CLASS(b, SCM_CLASS_ATOMIC_FXBOX);
+    AO_store_release(&b->value, (AO_t)SCM_WORD(SCM_MAKE_INT(value)));
+    return SCM_OBJ(b);
+}
+
+ScmObj Scm_AtomicBoxRef(ScmAtomicBox *b)
+{
+    return SCM_OBJ(AO_load_acquire(&b->value));
+}
+
+void Scm_AtomicBoxSet(ScmAtomicBox *b, ScmObj value)
+{
+    AO_store_release(&b->value, (AO_t)SCM_WORD(value));
+}
+
+/* Returns the value the box had before the operation.  The swap took
+   place iff the returned value is eq? to EXPECTED. */
+ScmObj Scm_AtomicBoxCompareAndSwap(ScmAtomicBox *b,
+                                   ScmObj expected, ScmObj desired)
+{
+    for (;;) {
+        AO_t old = AO_load_full(&b->value);
+        if (old != (AO_t)SCM_WORD(expected)) return SCM_OBJ(old);
+        if (AO_compare_and_swap_full(&b->value, old,
+                                     (AO_t)SCM_WORD(desired))) {
+            return SCM_OBJ(old);
+        }
+    }
+}
+
+ScmObj Scm_AtomicBoxSwap(ScmAtomicBox *b, ScmObj value)
+{
+    for (;;) {
+        AO_t old = AO_load_full(&b->value);
+        if (AO_compare_and_swap_full(&b->value, old,
+                                     (AO_t)SCM_WORD(value))) {
+            return SCM_OBJ(old);
+        }
+    }
+}
+
+/* Fetch-and-modify on fxboxes.  Both return the old value. */
+ScmObj Scm_AtomicFxboxFetchAdd(ScmAtomicBox *b, ScmSmallInt delta)
+{
+    return SCM_OBJ(AO_fetch_and_add_full(&b->value,
+                                         (AO_t)((u_long)delta << 2)));
+}
+
+ScmObj Scm_AtomicFxboxFetchLogop(ScmAtomicBox *b, int op, ScmSmallInt mask)
+{
+    AO_t tmask = (AO_t)SCM_WORD(SCM_MAKE_INT(mask));
+    for (;;) {
+        AO_t old = AO_load_full(&b->value), nv;
+        switch (op) {
+        case SCM_ATOMIC_AND: nv = old & tmask; break;
+        case SCM_ATOMIC_IOR: nv = old | tmask; break;
+        case SCM_ATOMIC_XOR: nv = old ^ (tmask & ~(AO_t)3); break;
+        default: Scm_Error("[internal] bad atomic opcode %d", op);
+            nv = old;           /* dummy */
+        }
+        if (AO_compare_and_swap_full(&b->value, old, nv)) {
+            return SCM_OBJ(old);
+        }
+    }
+}
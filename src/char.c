@@ -494,6 +494,187 @@ int Scm_CharSetContains(ScmCharSet *cs, ScmChar c)
     }
 }
 
+/* Scanning.
+ *   When we look for a char in a string, most of the chars are small
+ *   ones, for which we inline the bitmap test.  For large chars, the
+ *   run of chars nearby is likely to fall in the same range, so we
+ *   remember the last range found in the treemap (in or out of the set)
+ *   and only consult the treemap when the char is outside of it.
+ */
+typedef struct charset_scan_cache_rec {
+    ScmChar lo, hi;             /* the cached range, inclusive */
+    int in;                     /* TRUE if [lo,hi] is in the set */
+} charset_scan_cache;
+
+static int charset_contains_cached(ScmCharSet *cs, ScmChar c,
+                                   charset_scan_cache *cache)
+{
+    if (c >= cache->lo && c <= cache->hi) return cache->in;
+
+    ScmDictEntry *e, *l, *h;
+    e = Scm_TreeCoreClosestEntries(&cs->large, (int)c, &l, &h);
+    if (e) {
+        cache->lo = (ScmChar)e->key;
+        cache->hi = (ScmChar)e->value;
+        cache->in = TRUE;
+    } else if (l && l->value >= c) {
+        cache->lo = (ScmChar)l->key;
+        cache->hi = (ScmChar)l->value;
+        cache->in = TRUE;
+    } else {
+        cache->lo = l? (ScmChar)l->value+1 : SCM_CHAR_SET_SMALL_CHARS;
+        cache->hi = h? (ScmChar)h->key-1 : SCM_CHAR_MAX;
+        cache->in = FALSE;
+    }
+    return cache->in;
+}
+
+/* Returns the index of the first character in [start, end) of STR that
+   is in CS (or not in CS, if NEGATE is TRUE), or -1 if there's none.
+   END < 0 means the end of the string.  An incomplete string is scanned
+   bytewise. */
+ScmSmallInt Scm_StringIndexCharSet(ScmString *str, ScmCharSet *cs,
+                                   int negate,
+                                   ScmSmallInt start, ScmSmallInt end)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    ScmSmallInt len = SCM_STRING_BODY_LENGTH(b);
+    SCM_CHECK_START_END(start, end, len);
+
+    int bytewise = (SCM_STRING_BODY_INCOMPLETE_P(b)
+                    || SCM_STRING_BODY_SINGLE_BYTE_P(b));
+    const char *p = (bytewise
+                     ? SCM_STRING_BODY_START(b) + start
+                     : Scm_StringBodyPosition(b, start));
+    charset_scan_cache cache = { 1, 0, FALSE }; /* empty range */
+    int want = !negate;
+
+    for (ScmSmallInt i = start; i < end; i++) {
+        unsigned char u = (unsigned char)*p;
+        if (u < SCM_CHAR_SET_SMALL_CHARS) {
+            if ((MASK_ISSET(cs, u) != 0) == want) return i;
+            p++;
+            continue;
+        }
+        ScmChar c;
+        if (bytewise) {
+            c = u;
+            p++;
+        } else {
+            SCM_CHAR_GET(p, c);
+            p += SCM_CHAR_NFOLLOWS(u) + 1;
+        }
+        if (charset_contains_cached(cs, c, &cache) == want) return i;
+    }
+    return -1;
+}
+
+/* SJIS trailing bytes may fall in the ASCII range, so we can't tell
+   an ASCII character just by looking at the byte before the current
+   position. */
+#if defined(GAUCHE_CHAR_ENCODING_SJIS)
+#define ASCII_BACKWARD_SAFE 0
+#else
+#define ASCII_BACKWARD_SAFE 1
+#endif
+
+/* Like Scm_StringIndexCharSet, but returns the index of the last
+   character that satisfies the condition. */
+ScmSmallInt Scm_StringIndexCharSetRight(ScmString *str, ScmCharSet *cs,
+                                        int negate,
+                                        ScmSmallInt start, ScmSmallInt end)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    ScmSmallInt len = SCM_STRING_BODY_LENGTH(b);
+    SCM_CHECK_START_END(start, end, len);
+
+    int bytewise = (SCM_STRING_BODY_INCOMPLETE_P(b)
+                    || SCM_STRING_BODY_SINGLE_BYTE_P(b));
+    const char *s, *p;
+    if (bytewise) {
+        s = SCM_STRING_BODY_START(b) + start;
+        p = SCM_STRING_BODY_START(b) + end;
+    } else {
+        s = Scm_StringBodyPosition(b, start);
+        p = Scm_StringBodyPosition(b, end);
+    }
+    charset_scan_cache cache = { 1, 0, FALSE }; /* empty range */
+    int want = !negate;
+
+    for (ScmSmallInt i = end-1; i >= start; i--) {
+        unsigned char u = (unsigned char)p[-1];
+        if (u < SCM_CHAR_SET_SMALL_CHARS && (bytewise || ASCII_BACKWARD_SAFE)) {
+            if ((MASK_ISSET(cs, u) != 0) == want) return i;
+            p--;
+            continue;
+        }
+        ScmChar c;
+        if (bytewise) {
+            c = u;
+            p--;
+        } else {
+            const char *q;
+            SCM_CHAR_BACKWARD(p, s, q);
+            if (q == NULL) break;
+            SCM_CHAR_GET(q, c);
+            p = q;
+        }
+        if (charset_contains_cached(cs, c, &cache) == want) return i;
+    }
+    return -1;
+}
+
+/* Returns a list of maximal substrings of [start, end) of STR that
+   consist of characters in CS.  This is srfi-13's string-tokenize.
+   The substrings share the content with STR. */
+ScmObj Scm_StringTokenize(ScmString *str, ScmCharSet *cs,
+                          ScmSmallInt start, ScmSmallInt end)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    ScmSmallInt len = SCM_STRING_BODY_LENGTH(b);
+    SCM_CHECK_START_END(start, end, len);
+
+    int bytewise = (SCM_STRING_BODY_INCOMPLETE_P(b)
+                    || SCM_STRING_BODY_SINGLE_BYTE_P(b));
+    int flags = SCM_STRING_BODY_INCOMPLETE_P(b) ? SCM_STRING_INCOMPLETE : 0;
+    const char *p = (bytewise
+                     ? SCM_STRING_BODY_START(b) + start
+                     : Scm_StringBodyPosition(b, start));
+    const char *tok = NULL;     /* beginning of the current token */
+    ScmSmallInt toklen = 0;
+    charset_scan_cache cache = { 1, 0, FALSE }; /* empty range */
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+
+    for (ScmSmallInt i = start; i < end; i++) {
+        unsigned char u = (unsigned char)*p;
+        int nb = 1, in;
+        if (u < SCM_CHAR_SET_SMALL_CHARS) {
+            in = (MASK_ISSET(cs, u) != 0);
+        } else if (bytewise) {
+            in = charset_contains_cached(cs, u, &cache);
+        } else {
+            ScmChar c;
+            SCM_CHAR_GET(p, c);
+            nb = SCM_CHAR_NFOLLOWS(u) + 1;
+            in = charset_contains_cached(cs, c, &cache);
+        }
+        if (in) {
+            if (tok == NULL) { tok = p; toklen = 0; }
+            toklen++;
+        } else if (tok) {
+            SCM_APPEND1(h, t, Scm_MakeString(tok, p - tok, toklen, flags));
+            tok = NULL;
+        }
+        p += nb;
+    }
+    if (tok) {
+        SCM_APPEND1(h, t, Scm_MakeString(tok, p - tok, toklen, flags));
+    }
+    return h;
+}
+
+#undef ASCII_BACKWARD_SAFE
+
 /*-----------------------------------------------------------------
  * Inspection
  */
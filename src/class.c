@@ -652,6 +652,7 @@ static void class_cpl_set(ScmClass *klass, ScmObj val)
     klass->cpl = Scm_CopyList(val);
     /* find correct allocation method */
     find_core_allocator(klass);
+    Scm__InvalidateDispatchCaches();
     return;
   err:
     Scm_Error("class precedence list must be a proper list of class "
@@ -711,6 +712,8 @@ static void class_slots_set(ScmClass *klass, ScmObj val)
     klass->slots = val;
 }
 
+static void slot_cache_flush(void);
+
 static ScmObj class_accessors(ScmClass *klass)
 {
     return klass->accessors;
@@ -727,6 +730,7 @@ static void class_accessors_set(ScmClass *klass, ScmObj val)
                       SCM_CAR(vp));
     }
     klass->accessors = val;
+    slot_cache_flush();
 }
 
 static ScmObj class_numislots(ScmClass *klass)
@@ -1032,6 +1036,7 @@ void Scm_CommitClassRedefinition(ScmClass *klass, ScmObj newklass)
         (void)SCM_INTERNAL_COND_BROADCAST(klass->cv);
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(klass->mutex);
+    Scm__InvalidateDispatchCaches();
 
     /* Decrement the recursive global lock. */
     unlock_class_redefinition(vm);
@@ -1347,6 +1352,39 @@ ScmObj Scm_VMSlotInitializeUsingAccessor(ScmObj obj,
     Scm_VMApply(SCM_OBJ(&Scm_GenericSlotMissing),       \
                 SCM_LIST4(SCM_OBJ(klass), obj, slot, val))
 
+/* Slot accessor cache
+ *
+ *   Every slot-ref/slot-set! by name looks up the accessor.  Instead of
+ *   scanning the class's accessor alist each time, we keep a small
+ *   direct-mapped cache keyed by (class, slot name).
+ *
+ *   An entry is never modified once created, and installed by a single
+ *   pointer store, so a reader in other thread sees either the old or
+ *   the new entry.  The entry keeps the class alive, so the address
+ *   can't be reused by a different class while it is cached.  Class
+ *   redefinition creates a new class, and the callers check the
+ *   'redefined' flag of the old one before the lookup.  The only other
+ *   way to change the accessors is (setter accessors) of a malleable
+ *   class, which flushes the cache.
+ */
+typedef struct slot_cache_entry_rec {
+    ScmClass *klass;
+    ScmObj slot;
+    ScmSlotAccessor *sa;
+} slot_cache_entry;
+
+#define SLOT_CACHE_SIZE  256
+
+static slot_cache_entry *volatile slot_cache[SLOT_CACHE_SIZE];
+
+#define SLOT_CACHE_INDEX(klass, slot)                                  \
+    (((SCM_WORD(klass) >> 4) ^ (SCM_WORD(slot) >> 3)) & (SLOT_CACHE_SIZE-1))
+
+static void slot_cache_flush(void)
+{
+    for (int i=0; i<SLOT_CACHE_SIZE; i++) slot_cache[i] = NULL;
+}
+
 /* GET-SLOT-ACCESSOR
  *
  * (define (get-slot-accessor class slot)
@@ -1355,12 +1393,22 @@ ScmObj Scm_VMSlotInitializeUsingAccessor(ScmObj obj,
  */
 ScmSlotAccessor *Scm_GetSlotAccessor(ScmClass *klass, ScmObj slot)
 {
+    u_long index = SLOT_CACHE_INDEX(klass, slot);
+    slot_cache_entry *e = slot_cache[index];
+    if (e && e->klass == klass && SCM_EQ(e->slot, slot)) return e->sa;
+
     ScmObj p = Scm_Assq(slot, klass->accessors);
     if (!SCM_PAIRP(p)) return NULL;
     if (!SCM_XTYPEP(SCM_CDR(p), SCM_CLASS_SLOT_ACCESSOR))
         Scm_Error("slot accessor information of class %S, slot %S is screwed up.",
                   SCM_OBJ(klass), slot);
-    return SCM_SLOT_ACCESSOR(SCM_CDR(p));
+
+    e = SCM_NEW(slot_cache_entry);
+    e->klass = klass;
+    e->slot = slot;
+    e->sa = SCM_SLOT_ACCESSOR(SCM_CDR(p));
+    slot_cache[index] = e;
+    return e->sa;
 }
 
 /* (internal) slot-ref-using-accessor
@@ -2001,6 +2049,7 @@ static ScmObj generic_allocate(ScmClass *klass, ScmObj initargs)
     gf->fallback = Scm_NoNextMethod;
     gf->data = NULL;
     gf->maxReqargs = 0;
+    gf->dispatchCache = NULL;
     (void)SCM_INTERNAL_MUTEX_INIT(gf->lock);
     return SCM_OBJ(gf);
 }
@@ -2056,6 +2105,7 @@ static void generic_methods_set(ScmGeneric *gf, ScmObj val)
     gf->methods = val;
     gf->maxReqargs = reqs;
     (void)SCM_INTERNAL_MUTEX_UNLOCK(gf->lock);
+    Scm__InvalidateDispatchCaches();
 }
 
 /* Make base generic function from C */
@@ -2279,6 +2329,230 @@ ScmObj Scm_SortMethods(ScmObj methods, ScmObj *argv, int argc)
     return Scm_ArrayToList(array, len);
 }
 
+/*
+ * Dispatch cache
+ *
+ *  For the application of a pure generic function, the VM calls
+ *  Scm__ComputeSortedApplicableMethods, which looks up the per-gf
+ *  cache keyed by the number of arguments and the classes of the
+ *  first maxReqargs arguments.  If it hits, we can skip both
+ *  compute-applicable-methods and sort-methods, since the result only
+ *  depends on those.
+ *
+ *  A cache is never modified once it is set to gf->dispatchCache;
+ *  we create a new one to add an entry.  So the readers don't need
+ *  to lock.
+ *
+ *  Anything that can change the result of dispatch---adding or
+ *  deleting methods, modifying specializers, and class redefinition---
+ *  increments the global dispatch_epoch, which invalidates all caches
+ *  at once.  Those operations are rare compared to generic function
+ *  calls, and mostly happen at load time.
+ */
+
+#define DISPATCH_CACHE_ENTRIES  8 /* # of entries per gf */
+#define DISPATCH_CACHE_MAX_ARGS 4 /* we don't use cache if gf->maxReqargs
+                                     is larger than this */
+
+typedef struct dispatch_entry_rec {
+    int argc;
+    int nsel;                   /* # of valid entries in classes[] */
+    ScmClass *classes[DISPATCH_CACHE_MAX_ARGS];
+    ScmObj methods;             /* sorted applicable methods */
+} dispatch_entry;
+
+typedef struct dispatch_cache_rec {
+    u_long epoch;
+    int numEntries;
+    dispatch_entry entries[DISPATCH_CACHE_ENTRIES];
+} dispatch_cache;
+
+static volatile u_long dispatch_epoch = 0;
+static ScmInternalMutex dispatch_epoch_mutex;
+
+void Scm__InvalidateDispatchCaches(void)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(dispatch_epoch_mutex);
+    dispatch_epoch++;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(dispatch_epoch_mutex);
+}
+
+/* Returns a sorted list of applicable methods, just like calling
+   Scm_ComputeApplicableMethods and then Scm_SortMethods.  The
+   arguments must be already unfolded (i.e. no applyargs). */
+ScmObj Scm__ComputeSortedApplicableMethods(ScmGeneric *gf,
+                                           ScmObj *argv, int argc)
+{
+    u_long epoch = dispatch_epoch;
+    dispatch_cache *c = (dispatch_cache*)gf->dispatchCache;
+    int nsel = (argc < gf->maxReqargs)? argc : gf->maxReqargs;
+    ScmClass *typev[DISPATCH_CACHE_MAX_ARGS];
+
+    if (nsel > DISPATCH_CACHE_MAX_ARGS) {
+        ScmObj mm = Scm_ComputeApplicableMethods(gf, argv, argc, FALSE);
+        if (SCM_NULLP(mm)) return mm;
+        return Scm_SortMethods(mm, argv, argc);
+    }
+
+    for (int i=0; i<nsel; i++) typev[i] = Scm_ClassOf(argv[i]);
+
+    if (c != NULL && c->epoch == epoch) {
+        for (int i=0; i<c->numEntries; i++) {
+            dispatch_entry *e = &c->entries[i];
+            if (e->argc != argc || e->nsel != nsel) continue;
+            int j = 0;
+            for (; j<nsel; j++) {
+                if (e->classes[j] != typev[j]) break;
+            }
+            if (j == nsel) return e->methods;
+        }
+    }
+
+    ScmObj mm = Scm_ComputeApplicableMethods(gf, argv, argc, FALSE);
+    if (SCM_NULLP(mm)) return mm;
+    mm = Scm_SortMethods(mm, argv, argc);
+
+    /* Create a new cache with the new entry in front.  If the old entries
+       are from the same epoch, we carry over them, dropping the oldest
+       one if the cache is full.  We don't lock gf; if other thread
+       updates the cache simultaneously, one of the updates is lost, but
+       that doesn't harm. */
+    dispatch_cache *nc = SCM_NEW(dispatch_cache);
+    nc->epoch = epoch;
+    nc->entries[0].argc = argc;
+    nc->entries[0].nsel = nsel;
+    for (int i=0; i<nsel; i++) nc->entries[0].classes[i] = typev[i];
+    nc->entries[0].methods = mm;
+    nc->numEntries = 1;
+    if (c != NULL && c->epoch == epoch) {
+        for (int i=0; i<c->numEntries && i<DISPATCH_CACHE_ENTRIES-1; i++) {
+            nc->entries[i+1] = c->entries[i];
+            nc->numEntries++;
+        }
+    }
+    gf->dispatchCache = nc;
+    return mm;
+}
+
+/*
+ * Fast path of make
+ *
+ *  (make class initargs ...) calls allocate-instance and initialize
+ *  generic functions, and (initialize <object>) walks the slot
+ *  accessors through the continuation chain.  If neither of those
+ *  generics has a method applicable to the class except the default
+ *  one, we can allocate the instance and set its slots directly.
+ *  Scm__VMMakeFast does it, or returns #f if the class isn't eligible.
+ *
+ *  Eligibility only depends on the methods of the two generics and
+ *  the class, so we cache it per class with dispatch_epoch, just like
+ *  the dispatch cache.  Entries are immutable and installed by a
+ *  single pointer store.
+ */
+
+typedef struct make_cache_entry_rec {
+    ScmClass *klass;
+    u_long epoch;
+    int fast;
+} make_cache_entry;
+
+#define MAKE_CACHE_SIZE  64
+
+static make_cache_entry *volatile make_cache[MAKE_CACHE_SIZE];
+
+#define MAKE_CACHE_INDEX(klass) \
+    ((SCM_WORD(klass) >> 4) & (MAKE_CACHE_SIZE-1))
+
+static int make_fast_eligible(ScmClass *klass)
+{
+    if (klass->allocate != instance_allocate) return FALSE;
+
+    ScmObj mp;
+    SCM_FOR_EACH(mp, Scm_GenericInitialize.methods) {
+        ScmMethod *m = SCM_METHOD(SCM_CAR(mp));
+        if (m == &object_initialize_rec) continue;
+        if (Scm_SubtypeP(klass, m->specializers[0])) return FALSE;
+    }
+    ScmClass *meta = Scm_ClassOf(SCM_OBJ(klass));
+    SCM_FOR_EACH(mp, Scm_GenericAllocate.methods) {
+        ScmMethod *m = SCM_METHOD(SCM_CAR(mp));
+        if (m == &class_allocate_rec) continue;
+        if (Scm_SubtypeP(meta, m->specializers[0])) return FALSE;
+    }
+    return TRUE;
+}
+
+static int make_fast_p(ScmClass *klass)
+{
+    u_long epoch = dispatch_epoch;
+    u_long index = MAKE_CACHE_INDEX(klass);
+    make_cache_entry *e = make_cache[index];
+    if (e && e->klass == klass && e->epoch == epoch) return e->fast;
+
+    e = SCM_NEW(make_cache_entry);
+    e->klass = klass;
+    e->epoch = epoch;
+    e->fast = make_fast_eligible(klass);
+    make_cache[index] = e;
+    return e->fast;
+}
+
+/* Same as object_initialize1, except that we only handle instance slots
+   and use the continuation only for init-thunks. */
+static ScmObj make_fast_init(ScmObj obj, ScmObj accs, ScmObj initargs);
+
+static ScmObj make_fast_init_cc(ScmObj result, void **data)
+{
+    ScmObj obj = SCM_OBJ(data[0]);
+    ScmObj accs = SCM_OBJ(data[1]);
+    ScmObj initargs = SCM_OBJ(data[2]);
+    scheme_slot_set(obj, SCM_SLOT_ACCESSOR(SCM_CDAR(accs))->slotNumber,
+                    result);
+    return make_fast_init(obj, SCM_CDR(accs), initargs);
+}
+
+static ScmObj make_fast_init(ScmObj obj, ScmObj accs, ScmObj initargs)
+{
+    for (; SCM_PAIRP(accs); accs = SCM_CDR(accs)) {
+        ScmSlotAccessor *sa = SCM_SLOT_ACCESSOR(SCM_CDAR(accs));
+        if (SCM_PAIRP(initargs) && SCM_KEYWORDP(sa->initKeyword)) {
+            ScmObj v = Scm_GetKeyword(sa->initKeyword, initargs,
+                                      SCM_UNDEFINED);
+            if (!SCM_UNDEFINEDP(v)) {
+                scheme_slot_set(obj, sa->slotNumber, v);
+                continue;
+            }
+        }
+        if (!sa->initializable) continue;
+        if (!SCM_UNBOUNDP(sa->initValue)) {
+            scheme_slot_set(obj, sa->slotNumber, sa->initValue);
+        } else if (SCM_PROCEDUREP(sa->initThunk)) {
+            void *data[3];
+            data[0] = obj;
+            data[1] = accs;
+            data[2] = initargs;
+            Scm_VMPushCC(make_fast_init_cc, data, 3);
+            return Scm_VMApply(sa->initThunk, SCM_NIL);
+        }
+    }
+    return obj;
+}
+
+ScmObj Scm__VMMakeFast(ScmClass *klass, ScmObj initargs)
+{
+    if (!SCM_FALSEP(klass->redefined)) return SCM_FALSE;
+    if (!make_fast_p(klass)) return SCM_FALSE;
+
+    /* All slots must be plain instance slots. */
+    ScmObj ap;
+    SCM_FOR_EACH(ap, klass->accessors) {
+        ScmSlotAccessor *sa = SCM_SLOT_ACCESSOR(SCM_CDAR(ap));
+        if (sa->setter || sa->slotNumber < 0) return SCM_FALSE;
+    }
+    ScmObj obj = instance_allocate(klass, initargs);
+    return make_fast_init(obj, klass->accessors, initargs);
+}
+
 /*=====================================================================
  * Method
  */
@@ -2426,6 +2700,7 @@ static void method_specializers_set(ScmMethod *m, ScmObj val)
         m->specializers = NULL;
     else
         m->specializers = class_list_to_array(val, len);
+    Scm__InvalidateDispatchCaches();
 }
 
 /* update-direct-method! method old-class new-class
@@ -2450,6 +2725,7 @@ ScmObj Scm_UpdateDirectMethod(ScmMethod *m, ScmClass *old, ScmClass *newc)
     for (int i=0; i<rec; i++) {
         if (sp[i] == old) sp[i] = newc;
     }
+    Scm__InvalidateDispatchCaches();
     if (SCM_FALSEP(Scm_Memq(SCM_OBJ(m), newc->directMethods))) {
         newc->directMethods = Scm_Cons(SCM_OBJ(m), newc->directMethods);
     }
@@ -2527,6 +2803,7 @@ ScmObj Scm_AddMethod(ScmGeneric *gf, ScmMethod *method)
         gf->maxReqargs = reqs;
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(gf->lock);
+    Scm__InvalidateDispatchCaches();
 
     if (method_locked != NULL) {
         Scm_Error("Attempt to replace a locked method %S",
@@ -2581,6 +2858,7 @@ ScmObj Scm_DeleteMethod(ScmGeneric *gf, ScmMethod *method)
         }
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(gf->lock);
+    Scm__InvalidateDispatchCaches();
     return SCM_UNDEFINED;
 }
 
@@ -3202,6 +3480,7 @@ void Scm__InitClass(void)
 
     (void)SCM_INTERNAL_MUTEX_INIT(class_redefinition_lock.mutex);
     (void)SCM_INTERNAL_COND_INIT(class_redefinition_lock.cv);
+    (void)SCM_INTERNAL_MUTEX_INIT(dispatch_epoch_mutex);
 
     /* booting class metaobject */
     Scm_TopClass.cpa = nullcpa;
@@ -3214,6 +3493,8 @@ void Scm__InitClass(void)
 
     /* box.c */
     CINIT(SCM_CLASS_BOX,    "<%box>");
+    CINIT(SCM_CLASS_ATOMIC_BOX,   "<atomic-box>");
+    CINIT(SCM_CLASS_ATOMIC_FXBOX, "<atomic-fxbox>");
 
     /* class.c */
     BINIT(SCM_CLASS_CLASS,  "<class>", class_slots);
@@ -3291,6 +3572,7 @@ void Scm__InitClass(void)
     /* regexp.c */
     CINIT(SCM_CLASS_REGEXP,           "<regexp>");
     CINIT(SCM_CLASS_REGMATCH,         "<regmatch>");
+    CINIT(SCM_CLASS_REGEXP_SET,       "<regexp-set>");
 
     /* string.c */
     CINIT(SCM_CLASS_STRING,           "<string>");
@@ -782,6 +782,14 @@ void Scm_CompiledCodeEmit(ScmCompiledCode *cc,
             code = SCM_VM_CONSTF;
         } else if (SCM_UNDEFINEDP(operand)) {
             code = SCM_VM_CONSTU;
+        } else if (SCM_TRUEP(operand)) {
+            code = SCM_VM_CONSTT;
+        } else if (SCM_CHARP(operand)) {
+            ScmChar ch = SCM_CHAR_VALUE(operand);
+            if (SCM_VM_INSN_ARG_FITS(ch)) {
+                code = SCM_VM_CONSTC;
+                arg0 = ch;
+            }
         } else if (SCM_INTP(operand)) {
             long v = SCM_INT_VALUE(operand);
             if (SCM_VM_INSN_ARG_FITS(v)) {
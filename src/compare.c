@@ -32,6 +32,8 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #define LIBGAUCHE_BODY
 #include "gauche.h"
 #include "gauche/class.h"
@@ -103,6 +105,22 @@ ScmObj Scm_ComparatorHashFunction(ScmComparator *cmpr)
     }
 }
 
+/* Returns TRUE iff OBJ passes the type test of CMPR.  Recognized
+   type tests are handled without calling back to Scheme. */
+int Scm_ComparatorTestType(ScmComparator *cmpr, ScmObj obj)
+{
+    if (cmpr->flags & SCM_COMPARATOR_ANY_TYPE) return TRUE;
+    switch (SCM_COMPARATOR_TYPE_TAG(cmpr)) {
+    case SCM_COMPARATOR_TYPE_STRING:  return SCM_STRINGP(obj);
+    case SCM_COMPARATOR_TYPE_SYMBOL:  return SCM_SYMBOLP(obj);
+    case SCM_COMPARATOR_TYPE_CHAR:    return SCM_CHARP(obj);
+    case SCM_COMPARATOR_TYPE_BOOLEAN: return SCM_BOOLP(obj);
+    case SCM_COMPARATOR_TYPE_EXACT_INTEGER: return SCM_INTEGERP(obj);
+    default:
+        return !SCM_FALSEP(Scm_ApplyRec1(cmpr->typeFn, obj));
+    }
+}
+
 
 /*
  * Generic compare.
@@ -259,127 +277,227 @@ int Scm_Compare(ScmObj x, ScmObj y)
     else return 1;
 }
 
-/* NB: It turns out that calling back Scheme funtion from sort routine
-   is very inefficient and runs much slower than Scheme version, if
-   a Scheme comarison function is given.
-   So, as of 0.7.2, the C function is only used when a comparison
-   function is omitted. */
-
 /*
  * Basic function for sort family.  An array pointed by elts will be
  * destructively sorted.  Cmpfn can be either an applicable Scheme
  * object or #f.  If it's an applicable object, two arguments x and y
- * will be passed to it, and it must return an integer or a boolean
- * value, such that:
+ * will be passed to it.  If SCM_SORT_PREDICATE is given in flags, it
+ * must return true iff x strictly precedes y.  Otherwise, it must
+ * return an integer or a boolean value, such that:
  *
  *  if (x < y), it may return a negative integer or #t.
  *  if (x == y), it may return 0 or #f.
  *  if (x > y), it may return a positive integer or #f.
  *
- * If cmpfn is #f, the first object's default compare method is used.
+ * If cmpfn is #f, the default compare (Scm_Compare) is used.
  *
  * Some notes:
  *  - We can't use libc's qsort, since it doesn't pass closure to cmpfn.
- *  - The naive Quicksort behaves too badly in the worst case.
- *  - The comparison operation is far more costly than exchange.
+ *  - The comparison operation is far more costly than exchange,
+ *    especially when we call back Scheme.
  *
- * The current implementation is hybrid of Quicksort and Heapsort.  First
- * the algorithm proceeds by Quicksort, but when it detects the recursion
- * is too deep, it switches to Heapsort.  See Knuth, The Art of Computer
- * Programming Second Edition, Section 5.2.2, p.122.
+ * SCM_SORT_STABLE selects TimSort, which finds the existing runs, so
+ * presorted or nearly sorted input takes O(n) comparisons.  Otherwise
+ * we use pattern-defeating quicksort, which falls back to heapsort on
+ * bad inputs and notices sorted partitions.  The algorithms are in
+ * sortimpl.c, expanded for each kind of comparison.  With the default
+ * compare, an array consisting only of fixnums, flonums (no NaNs) or
+ * strings is sorted with unboxed comparison.
  */
 
-/* Heap sort */
-static inline void shift_up(ScmObj *elts, int root, int nelts,
-                            int (*cmp)(ScmObj, ScmObj, ScmObj), ScmObj data)
+#define SORT_CAT_(a, b)  a##_##b
+#define SORT_CAT(a, b)   SORT_CAT_(a, b)
+#define SORT_SWAP(a, i, j)                      \
+    do {                                        \
+        ScmObj t__ = (a)[i];                    \
+        (a)[i] = (a)[j];                        \
+        (a)[j] = t__;                           \
+    } while (0)
+
+#define PDQ_INSERTION_THRESHOLD      24
+#define PDQ_NINTHER_THRESHOLD        128
+#define PDQ_PARTIAL_INSERTION_LIMIT  8
+
+#define TIMSORT_MIN_MERGE            32
+#define TIMSORT_MAX_RUNS             85 /* enough for 2^64 elements */
+
+typedef struct sort_run_rec {
+    ScmSmallInt base;
+    ScmSmallInt len;
+} sort_run;
+
+typedef struct timsort_state_rec {
+    ScmObj *a;                  /* array being sorted */
+    ScmObj *tmp;                /* merge buffer of n/2+1 elements */
+    void *data;
+    int nruns;
+    sort_run runs[TIMSORT_MAX_RUNS];
+    /* merge cursors */
+    ScmSmallInt dest;           /* next place to fill in a */
+    ScmSmallInt i;              /* next element in tmp */
+    ScmSmallInt tmpend;
+    ScmSmallInt j;              /* next element of the run left in a */
+} timsort_state;
+
+/* Minimum run length; n/minrun is a power of 2 or slightly less. */
+static ScmSmallInt timsort_minrun(ScmSmallInt n)
 {
-    int l = root+1, maxchild;
-    while (l*2 <= nelts) {
-        if (l*2 == nelts) {
-            maxchild = nelts-1;
-        } else if (cmp(elts[l*2-1], elts[l*2], data) < 0) {
-            maxchild = l*2;
-        } else {
-            maxchild = l*2-1;
-        }
-        if (cmp(elts[l-1], elts[maxchild], data) < 0) {
-            ScmObj tmp = elts[maxchild];
-            elts[maxchild] = elts[l-1];
-            elts[l-1] = tmp;
-            l = maxchild+1;
-        } else {
-            break;
-        }
+    ScmSmallInt r = 0;
+    while (n >= TIMSORT_MIN_MERGE) {
+        r |= (n & 1);
+        n >>= 1;
     }
+    return n + r;
 }
 
-static void sort_h(ScmObj *elts, int nelts,
-                   int (*cmp)(ScmObj, ScmObj, ScmObj), ScmObj data)
+/* Puts back the elements remaining in the merge buffer.  It is either
+   the end of merging, or an error is escaping; in both cases the hole
+   in the array is exactly as large as the rest of the buffer. */
+static void timsort_flush(timsort_state *ts, int lo_first)
 {
-    for (int l=nelts/2-1; l>=0; l--) {
-        shift_up(elts, l, nelts, cmp, data);
-    }
-    for (int r=nelts-1; r>=1; r--) {
-        ScmObj tmp = elts[r];
-        elts[r] = elts[0];
-        elts[0] = tmp;
-        shift_up(elts, 0, r, cmp, data);
+    if (lo_first) {
+        memcpy(ts->a + ts->dest, ts->tmp + ts->i,
+               (ts->tmpend - ts->i)*sizeof(ScmObj));
+    } else {
+        memcpy(ts->a + ts->dest - ts->i, ts->tmp, ts->i*sizeof(ScmObj));
     }
 }
 
-/* Quick sort */
-static void sort_q(ScmObj *elts, int lo, int hi, int depth, int limit,
-                   int (*cmp)(ScmObj, ScmObj, ScmObj), ScmObj data)
+/* Default compare on fixnums */
+#define SORT_SUFFIX  fixnum
+#define SORT_LT(x, y)  (SCM_INT_VALUE(x) < SCM_INT_VALUE(y))
+#include "sortimpl.c"
+#undef SORT_SUFFIX
+#undef SORT_LT
+
+/* Default compare on flonums other than NaN */
+#define SORT_SUFFIX  flonum
+#define SORT_LT(x, y)  (SCM_FLONUM_VALUE(x) < SCM_FLONUM_VALUE(y))
+#include "sortimpl.c"
+#undef SORT_SUFFIX
+#undef SORT_LT
+
+/* Default compare on strings */
+#define SORT_SUFFIX  string
+#define SORT_LT(x, y)  (Scm_StringCmp(SCM_STRING(x), SCM_STRING(y)) < 0)
+#include "sortimpl.c"
+#undef SORT_SUFFIX
+#undef SORT_LT
+
+/* Default compare on anything */
+#define SORT_SUFFIX  generic
+#define SORT_LT(x, y)  (Scm_Compare(x, y) < 0)
+#define SORT_MAY_RAISE
+#include "sortimpl.c"
+#undef SORT_SUFFIX
+#undef SORT_LT
+#undef SORT_MAY_RAISE
+
+/* Scheme procedure */
+typedef struct sort_proc_rec {
+    ScmObj proc;
+    int predicate;              /* see SCM_SORT_PREDICATE */
+} sort_proc;
+
+static inline int sort_call(ScmObj x, ScmObj y, void *data)
 {
-    while (lo < hi) {
-        if (depth >= limit) {
-            sort_h(elts+lo, (hi-lo+1), cmp, data);
-            break;
-        } else {
-            int l = lo, r = hi;
-            ScmObj pivot = elts[lo];
-            while (l <= r) {
-                while (l <= r && cmp(elts[l], pivot, data) < 0) l++;
-                while (l <= r && cmp(pivot, elts[r], data) < 0) r--;
-                if (l > r) break;
-                ScmObj tmp = elts[l]; elts[l] = elts[r]; elts[r] = tmp;
-                l++;
-                r--;
-            }
-            if (lo < r) sort_q(elts, lo, r, depth+1, limit, cmp, data);
-            /* tail call to
-               sort_q(elts, l, hi, depth+1, limit, cmp, data); */
-            lo = l;
-            depth++;
-        }
-    }
+    sort_proc *p = (sort_proc*)data;
+    ScmObj r = Scm_ApplyRec2(p->proc, x, y);
+    if (p->predicate) return !SCM_FALSEP(r);
+    return (SCM_TRUEP(r) || (SCM_INTP(r) && SCM_INT_VALUE(r) < 0));
 }
 
-static int cmp_scm(ScmObj x, ScmObj y, ScmObj fn)
+#define SORT_SUFFIX  proc
+#define SORT_LT(x, y)  sort_call(x, y, data)
+#define SORT_MAY_RAISE
+#include "sortimpl.c"
+#undef SORT_SUFFIX
+#undef SORT_LT
+#undef SORT_MAY_RAISE
+
+enum {
+    SORT_KIND_GENERIC,
+    SORT_KIND_FIXNUM,
+    SORT_KIND_FLONUM,
+    SORT_KIND_STRING
+};
+
+/* Finds out if we can compare elements without Scm_Compare. */
+static int sort_kind(ScmObj *elts, ScmSmallInt nelts)
 {
-    ScmObj r = Scm_ApplyRec(fn, SCM_LIST2(x, y));
-    if (SCM_TRUEP(r) || (SCM_INTP(r) && SCM_INT_VALUE(r) < 0))
-        return -1;
-    else
-        return 1;
+    ScmObj e = elts[0];
+    if (SCM_INTP(e)) {
+        for (ScmSmallInt i=1; i<nelts; i++) {
+            if (!SCM_INTP(elts[i])) return SORT_KIND_GENERIC;
+        }
+        return SORT_KIND_FIXNUM;
+    }
+    if (SCM_FLONUMP(e)) {
+        for (ScmSmallInt i=0; i<nelts; i++) {
+            if (!SCM_FLONUMP(elts[i]) || isnan(SCM_FLONUM_VALUE(elts[i])))
+                return SORT_KIND_GENERIC;
+        }
+        return SORT_KIND_FLONUM;
+    }
+    if (SCM_STRINGP(e)) {
+        for (ScmSmallInt i=1; i<nelts; i++) {
+            if (!SCM_STRINGP(elts[i])) return SORT_KIND_GENERIC;
+        }
+        return SORT_KIND_STRING;
+    }
+    return SORT_KIND_GENERIC;
 }
 
-static int cmp_int(ScmObj x, ScmObj y, ScmObj dummy)
+#define SORT_DISPATCH(suffix, data)                                     \
+    do {                                                                \
+        if (flags & SCM_SORT_STABLE) {                                  \
+            SORT_CAT(timsort, suffix)(elts, nelts, data);               \
+        } else {                                                        \
+            SORT_CAT(pdqsort, suffix)(elts, nelts, data);               \
+        }                                                               \
+    } while (0)
+
+void Scm_SortArrayFull(ScmObj *elts, ScmSmallInt nelts, ScmObj cmpfn,
+                       u_long flags)
 {
-    return Scm_Compare(x, y);
+    if (nelts <= 1) return;
+    if (SCM_COMPARATORP(cmpfn)) {
+        /* We check the types once beforehand.  If the comparator orders
+           objects as Scm_Compare does, we can then sort natively;
+           otherwise we call back its ordering predicate. */
+        ScmComparator *c = SCM_COMPARATOR(cmpfn);
+        for (ScmSmallInt i=0; i<nelts; i++) {
+            if (!Scm_ComparatorTestType(c, elts[i])) {
+                Scm_Error("Comparator %S cannot accept object %S",
+                          c, elts[i]);
+            }
+        }
+        if (c->flags & SCM_COMPARATOR_NATIVE_COMPARE) {
+            cmpfn = SCM_FALSE;
+        } else {
+            cmpfn = Scm_ComparatorOrderingPredicate(c);
+            flags |= SCM_SORT_PREDICATE;
+        }
+    }
+    if (!SCM_FALSEP(cmpfn)) {
+        sort_proc p;
+        p.proc = cmpfn;
+        p.predicate = (flags & SCM_SORT_PREDICATE)? TRUE : FALSE;
+        SORT_DISPATCH(proc, &p);
+        return;
+    }
+    switch (sort_kind(elts, nelts)) {
+    case SORT_KIND_FIXNUM: SORT_DISPATCH(fixnum, NULL); break;
+    case SORT_KIND_FLONUM: SORT_DISPATCH(flonum, NULL); break;
+    case SORT_KIND_STRING: SORT_DISPATCH(string, NULL); break;
+    default:               SORT_DISPATCH(generic, NULL); break;
+    }
 }
 
 void Scm_SortArray(ScmObj *elts, int nelts, ScmObj cmpfn)
 {
-    int limit, i;
-    if (nelts <= 1) return;
-    /* approximate 2*log2(nelts) */
-    for (i=nelts,limit=1; i > 0; limit++) {i>>=1;}
-    if (SCM_PROCEDUREP(cmpfn)) {
-        sort_q(elts, 0, nelts-1, 0, limit, cmp_scm, cmpfn);
-    } else {
-        sort_q(elts, 0, nelts-1, 0, limit, cmp_int, NULL);
-    }
+    Scm_SortArrayFull(elts, nelts,
+                      SCM_PROCEDUREP(cmpfn)? cmpfn : SCM_FALSE, 0);
 }
 
 /*
@@ -388,13 +506,13 @@ void Scm_SortArray(ScmObj *elts, int nelts, ScmObj cmpfn)
 
 #define STATIC_SIZE 32
 
-static ScmObj sort_list_int(ScmObj objs, ScmObj fn, int destructive)
+ScmObj Scm_SortListFull(ScmObj objs, ScmObj fn, u_long flags)
 {
     ScmObj starray[STATIC_SIZE];
     int len = STATIC_SIZE;
     ScmObj *array = Scm_ListToArray(objs, &len, starray, TRUE);
-    Scm_SortArray(array, len, fn);
-    if (destructive) {
+    Scm_SortArrayFull(array, len, fn, flags);
+    if (flags & SCM_SORT_DESTRUCTIVE) {
         ScmObj cp = objs;
         for (int i=0; i<len; i++, cp = SCM_CDR(cp)) {
             SCM_SET_CAR(cp, array[i]);
@@ -407,12 +525,13 @@ static ScmObj sort_list_int(ScmObj objs, ScmObj fn, int destructive)
 
 ScmObj Scm_SortList(ScmObj objs, ScmObj fn)
 {
-    return sort_list_int(objs, fn, FALSE);
+    return Scm_SortListFull(objs, SCM_PROCEDUREP(fn)? fn : SCM_FALSE, 0);
 }
 
 ScmObj Scm_SortListX(ScmObj objs, ScmObj fn)
 {
-    return sort_list_int(objs, fn, TRUE);
+    return Scm_SortListFull(objs, SCM_PROCEDUREP(fn)? fn : SCM_FALSE,
+                            SCM_SORT_DESTRUCTIVE);
 }
 
 /*
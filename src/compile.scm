@@ -87,6 +87,9 @@
 ;;;     - Eliminates redundant $LET and $SEQs introduced by constant folding.
 ;;;     - Look into $CALL nodes for further optimization; the above
 ;;;       optimizations may allow further inlining.
+;;;     - Finally, find loop variables that are always nonnegative fixnums
+;;;       and specialize arithmetic and vector access on them
+;;;       (see pass3/specialize-fixnum).
 ;;;
 ;;;   Pass 4 (Lambda lifting)
 ;;;     - At this point, remaining $LAMBDA nodes are the ones we absolutely
@@ -1541,6 +1544,8 @@
            (call-syntax-handler gval program cenv)]
           [(inline)
            (pass1/expand-inliner id gval)]
+          [(guarded-inline)
+           (pass1/expand-guarded-inliner id gval)]
           )
         (pass1/call program ($gref id) (cdr program) cenv))))
 
@@ -1577,6 +1582,33 @@
             (pass1/call program ($gref name) (cdr program) cenv)
             form))])))
 
+  ;; Expand a call to the procedure with a guarded inliner
+  ;; (see pass1/auto-inline).  The arguments are evaluated once
+  ;; before the guard is checked; literal arguments are passed as they
+  ;; are, so that the inlined body can still fold them.
+  (define (pass1/expand-guarded-inliner name proc)
+    (let* ([inliner (%procedure-inliner proc)]
+           [info (guarded-inliner-info inliner)]
+           [gmod (find-module (cadr info))]
+           [iform (unpack-iform inliner)]
+           [args (cdr program)])
+      (if (not (and gmod
+                    (argcount-ok? args ($lambda-reqargs iform)
+                                  (> ($lambda-optarg iform) 0))))
+        (pass1/call program ($gref name) args cenv)
+        (let* ([iargs (imap (cut pass1 <> cenv) args)]
+               [slots (map (^a (if ($const? a) a (make-lvar 'arg))) iargs)]
+               [lvars (filter (^s (lvar? s)) slots)]
+               [inits (remove (^a ($const? a)) iargs)]
+               [refs (^[] (map (^s (if (lvar? s) ($lref s) s)) slots))])
+          (for-each lvar-initval-set! lvars inits)
+          ($let program 'let lvars inits
+                ($if program
+                     ($eq? program ($gref name)
+                           ($gref (make-identifier (cddr info) gmod '())))
+                     (expand-inlined-procedure program iform (refs))
+                     ($call program ($gref name) (refs))))))))
+
   ;; main body of pass1
   (cond
    [(pair? program)                    ; (op . args)
@@ -1784,12 +1816,51 @@
 ;; The nodes within IFORM will be reused in the resulting $LET structure,
 ;; so be careful not to share substructures of IFORM accidentally.
 (define (expand-inlined-procedure src iform iargs)
+  (or (expand-keyword-core src iform iargs)
+      (expand-inlined-procedure-normal src iform iargs)))
+
+(define (expand-inlined-procedure-normal src iform iargs)
   (let ([lvars ($lambda-lvars iform)]
         [args  (adjust-arglist ($lambda-reqargs iform) ($lambda-optarg iform)
                                iargs ($lambda-name iform))])
     (for-each (^[lv a] (lvar-initval-set! lv a)) lvars args)
     ($let src 'let lvars args ($lambda-body iform))))
 
+;; If IFORM is a keyword-argument wrapper (see define-inline) and every
+;; keyword in IARGS is a literal the procedure knows, expand the call into
+;; the keyword core directly.  The argument expressions are still evaluated
+;; in the order they appear; the last one wins for duplicated keywords.
+;; Returns #f if the call doesn't qualify.
+(define (expand-keyword-core src iform iargs)
+  (and-let* ([core (keyword-core-of iform)]
+             [keys (cdr ($lambda-name core))]
+             [nreqs ($lambda-reqargs iform)]
+             [ (>= (length iargs) nreqs) ])
+    (receive (reqargs kvs) (split-at iargs nreqs)
+      (let loop ([kvs kvs] [vlvars '()] [vals '()] [alist '()])
+        (cond
+         [(null? kvs)
+          (let* ([vlvars (reverse vlvars)]
+                 [vals (reverse vals)]
+                 [cargs (map (^k (if-let1 p (assq k alist)
+                                   ($lref (cdr p))
+                                   ($const (undefined))))
+                             keys)]
+                 [rlvars (take ($lambda-lvars iform) nreqs)])
+            (for-each lvar-initval-set! rlvars reqargs)
+            (for-each lvar-initval-set! vlvars vals)
+            ($let src 'let rlvars reqargs
+                  ($let src 'let vlvars vals
+                        (expand-inlined-procedure-normal src core cargs))))]
+         [(null? (cdr kvs)) #f]
+         [(and ($const? (car kvs))
+               (keyword? ($const-value (car kvs)))
+               (memq ($const-value (car kvs)) keys))
+          (let1 lv (make-lvar (gensym))
+            (loop (cddr kvs) (cons lv vlvars) (cons (cadr kvs) vals)
+                  (acons ($const-value (car kvs)) lv alist)))]
+         [else #f])))))
+
 ;; Adjust argument list according to reqargs and optarg count.
 ;; Used in procedure inlining and local call optimization.
 (define (adjust-arglist reqargs optarg iargs name)
@@ -1899,15 +1970,101 @@
        ;; other code except the code generated in the same macro expansion.
        ;; A trick - we directly modify the identifier, so that other forms
        ;; referring to the same (eq?) identifier can keep referring it.
-       (let1 id (if (identifier? name)
-                  (%rename-toplevel-identifier! name)
-                  (make-identifier name module '()))
-         ($define oform flags id (pass1 expr cenv))))]
+       (let ([id (if (identifier? name)
+                   (%rename-toplevel-identifier! name)
+                   (make-identifier name module '()))]
+             [iform (pass1 expr cenv)])
+         (or (and (null? flags)
+                  (symbol? name)
+                  (pass1/auto-inline oform id iform module))
+             ($define oform flags id iform))))]
     [_ (error "syntax-error:" oform)]))
 
 (define (%rename-toplevel-identifier! identifier)
   (slot-set! identifier 'name (gensym #"~(identifier->symbol identifier)."))
   identifier)
+;; Profile-guided inlining
+;;   The profiler can write a list of hot procedures
+;;   (profiler-write-inline-hints).  If such a hint file is given to
+;;   the compiler (precomp --inline-hints, or the environment variable
+;;   GAUCHE_INLINE_HINTS), a toplevel definition of a listed procedure
+;;   is compiled with a 'guarded inliner', as far as the procedure is
+;;   a small closure.
+;;
+;;   Unlike define-inline, the binding isn't marked inlinable, since we
+;;   can't assume the procedure is never redefined.  Instead we define
+;;   an auxiliary binding, the guard, that keeps the closure as defined
+;;   here.  The last element of the packed IForm is
+;;   (guarded-inline <module-name> . <guard-name>), and a call site in
+;;   other compilation units is expanded as
+;;
+;;     (let ((t arg) ...)
+;;       (if (eq? NAME <guard>) <inlined body> (NAME t ...)))
+;;
+;;   so that redefinition or set! of NAME falls back to the ordinary call.
+;;   The guard name includes a hash of the definition, so that the call
+;;   sites compiled with an old definition never pass the check after
+;;   the changed definition is loaded.
+
+;; Hash table of name -> (module-name ...), #f if no hints are given,
+;; or 'unset if we haven't looked at GAUCHE_INLINE_HINTS yet.
+(define *auto-inline-hints* 'unset)
+
+;; HINTS may be a list of (module-name proc-name . _), a file name
+;; that contains such entries, or #f to disable auto inlining.
+(define (%set-auto-inline-hints! hints)
+  (define (read-hints file)
+    (call-with-input-file file
+      (^p (let loop ([r '()])
+            (let1 x (read p)
+              (if (eof-object? x) (reverse r) (loop (cons x r))))))))
+  (set! *auto-inline-hints*
+        (and hints
+             (rlet1 tab (make-hash-table 'eq?)
+               (dolist [e (if (string? hints) (read-hints hints) hints)]
+                 (match e
+                   [((? symbol? mod) (? symbol? name) . _)
+                    (hash-table-push! tab name mod)]
+                   [_ (error "bad inline hint entry:" e)]))))))
+
+(define (auto-inline-hinted? module name)
+  (when (eq? *auto-inline-hints* 'unset)
+    (%set-auto-inline-hints!
+     (and-let* ([f (sys-getenv "GAUCHE_INLINE_HINTS")]
+                [ (file-exists? f) ])
+       f)))
+  (and *auto-inline-hints*
+       (memq (module-name module)
+             (hash-table-get *auto-inline-hints* name '()))
+       #t))
+
+;; Returns IForm for the definition of ID with a guarded inliner, or #f if
+;; the definition doesn't qualify.
+(define (pass1/auto-inline form id iform module)
+  (and (has-tag? iform $LAMBDA)
+       (auto-inline-hinted? module (identifier-name id))
+       (< (iform-count-size-upto iform SMALL_LAMBDA_SIZE) SMALL_LAMBDA_SIZE)
+       (let* ([tag (portable-hash (write-to-string (unwrap-syntax form)) 0)]
+              [gname (string->symbol
+                      #"~(identifier-name id)$inline.~(number->string tag 36)")]
+              [guard (make-identifier gname module '())]
+              [info (list* 'guarded-inline (module-name module) gname)])
+         ($lambda-flag-set! iform
+                            (list->vector
+                             (append (vector->list (pack-iform iform))
+                                     (list info))))
+         ;; The last $const keeps the value of the define form.
+         ($seq (list ($define form '() id iform)
+                     ($define form '() guard ($gref id))
+                     ($const (identifier-name id)))))))
+
+;; If the inliner of a procedure is a guarded one, returns
+;; (guarded-inline <module-name> . <guard-name>).
+(define (guarded-inliner-info inliner)
+  (and (vector? inliner)
+       (> (vector-length inliner) 1)
+       (let1 info (vector-ref inliner (- (vector-length inliner) 1))
+         (and (pair? info) (eq? (car info) 'guarded-inline) info))))
 
 ;; Inlinable procedure.
 ;;   Inlinable procedure has both properties of a macro and a procedure.
@@ -1945,15 +2102,96 @@
   (check-toplevel form cenv)
   (match form
     [(_ (name . args) . body)
-     (pass1/define-inline form name `(,lambda. ,args ,@body) cenv)]
+     (if-let1 keys&expr (pass1/define-inline-keyword-lambda args body)
+       (pass1/define-inline form name (cdr keys&expr) cenv (car keys&expr))
+       (pass1/define-inline form name `(,lambda. ,args ,@body) cenv))]
     [(_ name expr)
      (unless (variable? name) (error "syntax-error:" form))
      (pass1/define-inline form name expr cenv)]
     [_ (error "syntax-error: malformed define-inline:" form)]))
 
-(define (pass1/define-inline form name expr cenv)
+;; Keyword-argument specialization
+;;   If an inlinable procedure takes only required and :key arguments,
+;;   we split it into a wrapper that parses the keywords at runtime and
+;;   a 'keyword core' that takes the keyword values positionally:
+;;
+;;     (lambda (a b . g)
+;;       (let ((%keyword-core (lambda (t1 t2)
+;;                              (let* ((x (if (undefined? t1) <dx> t1))
+;;                                     (y (if (undefined? t2) <dy> t2)))
+;;                                body ...))))
+;;         (let-keywords* g ((t1 :x (undefined)) (t2 :y (undefined)))
+;;           (%keyword-core t1 t2))))
+;;
+;;   The wrapper behaves just like (lambda (a b :key (x dx) (y dy)) ...).
+;;   When a call site passes only literal keywords, expand-inlined-procedure
+;;   bypasses the let-keywords* scan and calls the core directly, so the
+;;   defaults of the missing keywords are folded away.  The core is marked
+;;   by its $lambda-name, (%keyword-core key ...), after pass 1.
+;;   Returns (keys . expr), or #f if ARGS doesn't qualify.
+(define (pass1/define-inline-keyword-lambda args body)
+  (define (keyword-spec spec)
+    (match spec
+      [(? variable? o) (list o (make-keyword (unwrap-syntax o)) (undefined))]
+      [(((? keyword? key) (? variable? o)) init) (list o key init)]
+      [((? variable? o) init) (list o (make-keyword (unwrap-syntax o)) init)]
+      [_ #f]))
+  (and-let* ([ (list? args) ]
+             [rest (find-tail keyword-like? args)]
+             [reqs (take args (- (length args) (length rest)))]
+             [ (eq? (unwrap-syntax (car rest)) :key) ]
+             [ (every variable? reqs) ]
+             [ (pair? (cdr rest)) ]
+             [ (not (any keyword-like? (cdr rest))) ]
+             [specs (map keyword-spec (cdr rest))]
+             [ (every identity specs) ]
+             [tmps (map (^_ (gensym)) specs)]
+             [garg (gensym)])
+    (cons (map cadr specs)
+          `(,lambda. (,@reqs . ,garg)
+             (,(global-id 'let)
+              ((%keyword-core
+                (,lambda. ,tmps
+                  (,(global-id 'let*)
+                   ,(map (^[spec t]
+                           `(,(car spec)
+                             (,(global-id 'if)
+                              (,(global-id 'undefined?) ,t)
+                              ,(caddr spec)
+                              ,t)))
+                         specs tmps)
+                   ,@body))))
+              (,(global-id 'let-keywords*) ,garg
+               ,(map (^[spec t] `(,t ,(cadr spec) (,(global-id 'undefined))))
+                     specs tmps)
+               (%keyword-core ,@tmps)))))))
+
+;; Find the keyword core in the wrapper generated above and set its name.
+(define (pass1/mark-keyword-core! closure keys)
+  (let1 body ($lambda-body closure)
+    (when (and (has-tag? body $LET)
+               (length=? ($let-lvars body) 1)
+               (has-tag? (car ($let-inits body)) $LAMBDA))
+      ($lambda-name-set! (car ($let-inits body)) `(%keyword-core ,@keys)))))
+
+;; If IFORM is a wrapper whose core is marked by pass1/mark-keyword-core!,
+;; returns the core $lambda node.
+(define (keyword-core-of iform)
+  (and (eqv? ($lambda-optarg iform) 1)
+       (let1 body ($lambda-body iform)
+         (and (has-tag? body $LET)
+              (length=? ($let-lvars body) 1)
+              (let1 core (car ($let-inits body))
+                (and (has-tag? core $LAMBDA)
+                     (pair? ($lambda-name core))
+                     (eq? (car ($lambda-name core)) '%keyword-core)
+                     core))))))
+
+(define (pass1/define-inline form name expr cenv :optional (keys #f))
   (let1 iform (pass1 expr (cenv-add-name cenv (variable-name name)))
     (receive (closure closed) (pass1/check-inlinable-lambda iform)
+      (when (and keys closure)
+        (pass1/mark-keyword-core! closure keys))
       (cond
        [(and (not closure) (not closed)) ; too complex to inline
         (pass1/make-inlinable-binding form name iform cenv)]
@@ -3907,7 +4145,7 @@
              [iform. (pass3/rec (reset-lvars iform) label-dic)])
         (if (label-dic-info label-dic)
           (loop iform. (+ count 1))
-          iform.)))))
+          (pass3/specialize-fixnum iform.))))))
 
 (define (pass3-dump iform count)
   (format #t "~78,,,'=a\n" #"pass3 #~count ")
@@ -4237,6 +4475,253 @@
 ;; Dispatch table.
 (define *pass3-dispatch-table* (generate-dispatch-table pass3))
 
+;;---------------------------------------------------------------
+;; Fixnum specialization
+;;
+
+;; After pass 3 converges, we make a simple range analysis on the
+;; loops pass 2 embedded (the ones whose recursive calls became jumps),
+;; and replace some generic arithmetic and vector access with
+;; instructions that don't check types and ranges.
+;;
+;; A loop variable I is a nonnegative fixnum if it is never set!,
+;; its initial value is a nonnegative fixnum constant, and every jump
+;; back to the loop passes either I itself or (+ I 1) that is
+;; guarded by a test showing I < B, where B is a fixnum constant or
+;; (vector-length V) of an immutable V.  A test (= I B) also works on
+;; its false branch, if all the increments are guarded by the same B
+;; bound outside of the loop and the initial value does not exceed B;
+;; then I <= B always holds.
+;;
+;; For such I, (+ I 1) under the guard becomes FXADDI, and
+;; (vector-ref V I) and (vector-set! V I x) under the guard that
+;; shows I < (vector-length V) become VEC-REF-NC and VEC-SET-NC.
+;;
+;; A fact is (<lvar> <rel> <bound>), where <rel> is either lt or ne,
+;; and <bound> is (const . <fixnum>) or (vlen . <lvar>).  Facts we
+;; know at a node are passed down as a list.  We don't carry facts
+;; into $LAMBDA nor shared $LABEL nodes, which may be reached from
+;; elsewhere.
+
+(define-simple-struct fxspec #f make-fxspec
+  (labels     ; label-dic
+   bounds     ; hash table: let-bound lvar -> bound
+   indices    ; hash table: proven lvar -> #t or invariant bound
+   (target #f); while collecting jumps, the $CALL node of the loop
+   (jumps '()); collected ((<jump-call> . <facts>) ...)
+   (inner '()); lvars bound inside the loop
+   ))
+
+(define (pass3/specialize-fixnum iform)
+  (fxspec/rec iform '() (make-fxspec (make-label-dic #f)
+                                     (make-hash-table 'eq?)
+                                     (make-hash-table 'eq?)))
+  iform)
+
+(define (fxspec/bind! lvars ctx)
+  (when (fxspec-target ctx)
+    (fxspec-inner-set! ctx (append lvars (fxspec-inner ctx)))))
+
+(define (fxspec/bound iform ctx)
+  (cond [($const? iform)
+         (let1 v ($const-value iform) (and (fixnum? v) `(const . ,v)))]
+        [($lref? iform)
+         (hash-table-get (fxspec-bounds ctx) ($lref-lvar iform) #f)]
+        [(and (has-tag? iform $ASM)
+              (eqv? (car ($asm-insn iform)) VEC-LEN))
+         (let1 v (car ($asm-args iform))
+           (and ($lref? v)
+                (lvar-immutable? ($lref-lvar v))
+                `(vlen . ,($lref-lvar v))))]
+        [else #f]))
+
+(define (fxspec/bound=? a b)
+  (and (eq? (car a) (car b)) (eqv? (cdr a) (cdr b))))
+
+;; Returns facts that hold in then and else branch of TEST.
+(define (fxspec/test-facts test ctx)
+  (define (fact x b rel)
+    (or (and-let* ([ ($lref? x) ]
+                   [lv ($lref-lvar x)]
+                   [ (lvar-immutable? lv) ]
+                   [bd (fxspec/bound b ctx)])
+          `((,lv ,rel ,bd)))
+        '()))
+  (if (and (has-tag? test $ASM) (= (length ($asm-args test)) 2))
+    (let ([x (car ($asm-args test))] [y (cadr ($asm-args test))])
+      (case/unquote
+       (car ($asm-insn test))
+       [(NUMLT2) (values (fact x y 'lt) '())]
+       [(NUMGT2) (values (fact y x 'lt) '())]
+       [(NUMGE2) (values '() (fact x y 'lt))]
+       [(NUMLE2) (values '() (fact y x 'lt))]
+       [(NUMEQ2) (values '() (append (fact x y 'ne) (fact y x 'ne)))]
+       [else (values '() '())]))
+    (values '() '())))
+
+;; If IFORM is (+ I 1), returns I.
+(define (fxspec/increment-of iform)
+  (define (one? x) (and ($const? x) (eqv? ($const-value x) 1)))
+  (and (has-tag? iform $ASM)
+       (let ([insn ($asm-insn iform)] [args ($asm-args iform)])
+         (cond [(and (eqv? (car insn) NUMADD2)
+                     (= (length args) 2))
+                (cond [(and ($lref? (car args)) (one? (cadr args)))
+                       ($lref-lvar (car args))]
+                      [(and (one? (car args)) ($lref? (cadr args)))
+                       ($lref-lvar (cadr args))]
+                      [else #f])]
+               [(and (equal? insn `(,FXADDI 1)) ($lref? (car args)))
+                ($lref-lvar (car args))]
+               [else #f]))))
+
+;; Do FACTS show LV < B for some fixnum B?  INV is LV's invariant bound
+;; or #f.  If KIND and V are given, B must be (KIND . V).
+(define (fxspec/below? lv facts inv :optional (kind #f) (v #f))
+  (any (^f (and (eq? (car f) lv)
+                (or (not kind)
+                    (and (eq? (car (caddr f)) kind) (eq? (cdr (caddr f)) v)))
+                (or (eq? (cadr f) 'lt)
+                    (and inv (fxspec/bound=? (caddr f) inv)))))
+       facts))
+
+;; Called on an embedded loop CALL.  Find out the loop variables that are
+;; nonnegative fixnums, and register them to the indices table.
+(define (fxspec/loop call facts ctx)
+  (let* ([lam ($call-proc call)]
+         [lvars ($lambda-lvars lam)]
+         [inits ($call-args call)])
+    (when (and (zero? ($lambda-optarg lam))
+               (= (length lvars) (length inits))
+               (any (^[lv init] (and (lvar-immutable? lv) ($const? init)))
+                    lvars inits))
+      (let1 c (make-fxspec (make-label-dic #f) (fxspec-bounds ctx)
+                           (fxspec-indices ctx) call '() lvars)
+        (fxspec/rec ($lambda-body lam) facts c)
+        (let loop ([lvars lvars] [inits inits] [k 0])
+          (unless (null? lvars)
+            (and-let* ([lv (car lvars)]
+                       [ (lvar-immutable? lv) ]
+                       [ ($const? (car inits)) ]
+                       [init ($const-value (car inits))]
+                       [ (fixnum? init) ]
+                       [ (>= init 0) ]
+                       [inv (fxspec/loop-invariant lv init k c)])
+              (hash-table-put! (fxspec-indices ctx) lv inv))
+            (loop (cdr lvars) (cdr inits) (+ k 1))))))))
+
+;; Returns #t if every jump keeps LV or increments it under LV < B;
+;; returns B if increments are guarded by LV < B or LV != B and LV never
+;; exceeds B; #f otherwise.
+(define (fxspec/loop-invariant lv init k c)
+  (define (fixed-bound? b)
+    (case (car b)
+      [(const) (>= (cdr b) init)]
+      [(vlen)  (and (= init 0) (not (memq (cdr b) (fxspec-inner c))))]
+      [else #f]))
+  (let loop ([jumps (fxspec-jumps c)] [incs '()])
+    (match jumps
+      [()
+       (cond [(every (^[fs] (fxspec/below? lv fs #f)) incs) #t]
+             [(find (^b (and (fixed-bound? b)
+                             (every (^[fs] (fxspec/below? lv fs b)) incs)))
+                    (filter-map (^f (and (eq? (car f) lv) (caddr f)))
+                                (car incs)))]
+             [else #f])]
+      [((j . fs) . rest)
+       (let1 arg (list-ref ($call-args j) k)
+         (cond [(and ($lref? arg) (eq? ($lref-lvar arg) lv))
+                (loop rest incs)]
+               [(eq? (fxspec/increment-of arg) lv)
+                (loop rest (cons fs incs))]
+               [else #f]))])))
+
+(define (fxspec/rewrite-asm! iform facts ctx)
+  (define (index? x)
+    (and ($lref? x) (hash-table-get (fxspec-indices ctx) ($lref-lvar x) #f)))
+  (define (inv-of x) (let1 i (index? x) (and (pair? i) i)))
+  (let ([insn ($asm-insn iform)] [args ($asm-args iform)])
+    (cond
+     [(fxspec/increment-of iform)
+      => (^[lv]
+           (and-let* ([i (hash-table-get (fxspec-indices ctx) lv #f)]
+                      [ (fxspec/below? lv facts (and (pair? i) i)) ])
+             ($asm-insn-set! iform `(,FXADDI 1))
+             ($asm-args-set! iform (if ($lref? (car args))
+                                     (list (car args))
+                                     (list (cadr args))))))]
+     [(and (memv (car insn) `(,VEC-REF ,VEC-SET))
+           (= (length args) (if (eqv? (car insn) VEC-REF) 2 3))
+           ($lref? (car args))
+           (lvar-immutable? ($lref-lvar (car args)))
+           (index? (cadr args))
+           (fxspec/below? ($lref-lvar (cadr args)) facts (inv-of (cadr args))
+                          'vlen ($lref-lvar (car args))))
+      ($asm-insn-set! iform (if (eqv? (car insn) VEC-REF)
+                              `(,VEC-REF-NC)
+                              `(,VEC-SET-NC)))]
+     [else #f])))
+
+(define/case (fxspec/rec iform facts ctx)
+  (iform-tag iform)
+  [($DEFINE) (fxspec/rec ($define-expr iform) facts ctx)]
+  [($LSET)   (fxspec/rec ($lset-expr iform) facts ctx)]
+  [($GSET)   (fxspec/rec ($gset-expr iform) facts ctx)]
+  [($IF)     (fxspec/rec ($if-test iform) facts ctx)
+             (receive (tfacts efacts) (fxspec/test-facts ($if-test iform) ctx)
+               (fxspec/rec ($if-then iform) (append tfacts facts) ctx)
+               (fxspec/rec ($if-else iform) (append efacts facts) ctx))]
+  [($LET)    (fxspec/bind! ($let-lvars iform) ctx)
+             (dolist [init ($let-inits iform)] (fxspec/rec init facts ctx))
+             (when (eq? ($let-type iform) 'let)
+               (for-each (^[lv init]
+                           (and-let* ([ (lvar-immutable? lv) ]
+                                      [b (fxspec/bound init ctx)])
+                             (hash-table-put! (fxspec-bounds ctx) lv b)))
+                         ($let-lvars iform) ($let-inits iform)))
+             (fxspec/rec ($let-body iform) facts ctx)]
+  [($RECEIVE)(fxspec/bind! ($receive-lvars iform) ctx)
+             (fxspec/rec ($receive-expr iform) facts ctx)
+             (fxspec/rec ($receive-body iform) facts ctx)]
+  [($LAMBDA) (unless (eq? ($lambda-flag iform) 'dissolved)
+               (fxspec/bind! ($lambda-lvars iform) ctx)
+               (fxspec/rec ($lambda-body iform) '() ctx))]
+  [($LABEL)  (unless (label-seen? (fxspec-labels ctx) iform)
+               (label-push! (fxspec-labels ctx) iform)
+               (fxspec/rec ($label-body iform) '() ctx))]
+  [($SEQ)    (dolist [x ($seq-body iform)] (fxspec/rec x facts ctx))]
+  [($CALL)   (dolist [x ($call-args iform)] (fxspec/rec x facts ctx))
+             (case ($call-flag iform)
+               [(jump)
+                (when (eq? ($call-proc iform) (fxspec-target ctx))
+                  (fxspec-jumps-set! ctx (acons iform facts
+                                                (fxspec-jumps ctx))))]
+               [(embed)
+                (let* ([lam ($call-proc iform)]
+                       [body ($lambda-body lam)])
+                  (fxspec/bind! ($lambda-lvars lam) ctx)
+                  (unless (fxspec-target ctx)
+                    (fxspec/loop iform facts ctx))
+                  ;; The body is reached only from this call and the jumps
+                  ;; inside, so the facts here still hold.
+                  (if (has-tag? body $LABEL)
+                    (unless (label-seen? (fxspec-labels ctx) body)
+                      (label-push! (fxspec-labels ctx) body)
+                      (fxspec/rec ($label-body body) facts ctx))
+                    (fxspec/rec body facts ctx)))]
+               [else (fxspec/rec ($call-proc iform) facts ctx)])]
+  [($ASM)    (dolist [x ($asm-args iform)] (fxspec/rec x facts ctx))
+             (unless (fxspec-target ctx)
+               (fxspec/rewrite-asm! iform facts ctx))]
+  [($PROMISE)(fxspec/rec ($promise-expr iform) facts ctx)]
+  [($CONS $APPEND $MEMV $EQ? $EQV?)
+             (fxspec/rec ($*-arg0 iform) facts ctx)
+             (fxspec/rec ($*-arg1 iform) facts ctx)]
+  [($VECTOR $LIST $LIST*)
+             (dolist [x ($*-args iform)] (fxspec/rec x facts ctx))]
+  [($LIST->VECTOR) (fxspec/rec ($*-arg0 iform) facts ctx)]
+  [else #f])
+
 ;;===============================================================
 ;; Pass 4.  Lambda lifting
 ;;
@@ -6009,6 +6494,67 @@
                       ))))))]
       [_ (undefined)])))
 
+;; for-each and map with a literal lambda of one argument and a single list.
+;; We expand them into a local loop, so that pass2 can inline the lambda
+;; into the loop body.  Without this, the lambda becomes a closure that
+;; captures the current environment, forcing it to be saved to the heap,
+;; only to be thrown away when for-each returns.
+;; The expansion follows the definitions in liblist.scm.
+(define (gen-inliner-list-loop name accumulate?)
+  (define error. (global-id 'error))
+  (^[form cenv]
+    (match form
+      [(_ proc lis)
+       (let1 p (pass1 proc (cenv-sans-name cenv))
+         (if (not (and (has-tag? p $LAMBDA)
+                       (= ($lambda-reqargs p) 1)
+                       (= ($lambda-optarg p) 0)))
+           (undefined)
+           (let* ([pv (make-lvar 'proc)]
+                  [lv (make-lvar 'lis)]
+                  [loop (make-lvar 'loop)]
+                  [xs (make-lvar 'xs)]
+                  [r  (make-lvar 'r)]
+                  [l (pass1 lis (cenv-sans-name cenv))]
+                  [app ($call form ($lref pv)
+                              (list ($asm #f `(,CAR) (list ($lref xs)))))]
+                  [next ($asm #f `(,CDR) (list ($lref xs)))]
+                  [err ($call #f ($gref error.)
+                              (list ($const "improper list not allowed:")
+                                    ($lref lv)))]
+                  [lmda ($lambda form name (if accumulate? 2 1) 0
+                                 (if accumulate? (list xs r) (list xs))
+                                 ($if #f ($asm #f `(,PAIRP) (list ($lref xs)))
+                                      (if accumulate?
+                                        ($call #f ($lref loop)
+                                               (list next
+                                                     ($asm #f `(,CONS)
+                                                           (list app
+                                                                 ($lref r)))))
+                                        ($seq (list app
+                                                    ($call #f ($lref loop)
+                                                           (list next)))))
+                                      ($if #f ($asm #f `(,NULLP)
+                                                    (list ($lref xs)))
+                                           (if accumulate?
+                                             ($asm #f `(,REVERSE)
+                                                   (list ($lref r)))
+                                             ($const-undef))
+                                           err)))])
+             (lvar-initval-set! pv p)
+             (lvar-initval-set! lv l)
+             (lvar-initval-set! loop lmda)
+             ($let form 'let (list pv lv) (list p l)
+                   ($let #f 'rec (list loop) (list lmda)
+                         ($call #f ($lref loop)
+                                (if accumulate?
+                                  (list ($lref lv) ($const-nil))
+                                  (list ($lref lv)))))))))]
+      [_ (undefined)])))
+
+(define-builtin-inliner for-each (gen-inliner-list-loop 'for-each #f))
+(define-builtin-inliner map      (gen-inliner-list-loop 'map #t))
+
 ;;--------------------------------------------------------
 ;; Customizable inliner interface
 ;;
@@ -6218,6 +6764,13 @@
       "stdmods[1] = Scm_SchemeModule();"
       "stdmods[2] = Scm_GaucheModule();")))
 
+ (define-cfn guarded-inliner-p (inliner) ::int :static
+   (unless (and (SCM_VECTORP inliner) (> (SCM_VECTOR_SIZE inliner) 1))
+     (return FALSE))
+   (let* ([info (SCM_VECTOR_ELEMENT inliner (- (SCM_VECTOR_SIZE inliner) 1))])
+     (return (and (SCM_PAIRP info)
+                  (SCM_EQ (SCM_CAR info) 'guarded-inline)))))
+
  (define-cproc global-call-type (id cenv) ::(<top> <top>)
    (let* ([mod::ScmModule* (-> (SCM_IDENTIFIER id) module)]
           [gloc::ScmGloc* (Scm_IdentifierGlobalBinding (SCM_IDENTIFIER id))])
@@ -6235,6 +6788,15 @@
                      (not (SCM_VM_COMPILER_FLAG_IS_SET
                            (Scm_VM) SCM_COMPILE_NOINLINE_GLOBALS)))
                 (set! SCM_RESULT0 gval SCM_RESULT1 'inline)]
+               ;; Guarded inliner set by profile-guided inlining
+               ;; (see pass1/auto-inline).  The binding may not be
+               ;; inlinable; the call site checks the guard at runtime.
+               [(and (SCM_PROCEDUREP gval)
+                     (SCM_PROCEDURE_INLINER gval)
+                     (guarded-inliner-p (SCM_PROCEDURE_INLINER gval))
+                     (not (SCM_VM_COMPILER_FLAG_IS_SET
+                           (Scm_VM) SCM_COMPILE_NOINLINE_GLOBALS)))
+                (set! SCM_RESULT0 gval SCM_RESULT1 'guarded-inline)]
                [else (goto normal)])
          (.if "defined(RECORD_DEPENDED_MODULES)"
               (begin
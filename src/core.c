@@ -33,8 +33,11 @@
 
 #define LIBGAUCHE_BODY
 #include "gauche.h"
+#include "gauche/bignum.h"
 #include "gauche/paths.h"
+#include "gauche/prof.h"
 #include "gauche/priv/builtin-syms.h"
+#include "gauche/priv/probeP.h"
 
 /* GC_print_static_roots() is declared in private/gc_priv.h.  It is too much
    hassle to include it with other GC internal baggages, so we just declare
@@ -59,6 +62,14 @@ static struct {
     ScmInternalMutex mutex;
 } cond_features = { SCM_NIL };
 
+/*
+ * Allocation hooks.  See "Allocation hooks" below.
+ */
+static struct {
+    int arenaUsers;             /* # of arenas entered in all threads */
+    ScmInternalMutex mutex;
+} alloc_hooks = { 0 };
+
 /*=============================================================
  * Program initialization
  */
@@ -82,6 +93,7 @@ extern void Scm__InitRead(void);
 extern void Scm__InitSignal(void);
 extern void Scm__InitSystem(void);
 extern void Scm__InitVM(void);
+extern void Scm__InitProf(void);
 extern void Scm__InitAutoloads(void);
 extern void Scm__InitCollection(void);
 extern void Scm__InitComparator(void);
@@ -113,6 +125,7 @@ extern void Scm_Init_compile(void);
 extern void Scm_Init_libomega(void);
 
 static void finalizable(void);
+static void GC_CALLBACK gc_event(GC_EventType ev);
 static void init_cond_features(void);
 
 #ifdef GAUCHE_USE_PTHREADS
@@ -146,13 +159,16 @@ void Scm_Init(const char *signature)
     GC_oom_fn = oom_handler;
     GC_finalize_on_demand = TRUE;
     GC_finalizer_notifier = finalizable;
+    GC_set_on_collection_event(gc_event);
 
     (void)SCM_INTERNAL_MUTEX_INIT(cond_features.mutex);
+    (void)SCM_INTERNAL_MUTEX_INIT(alloc_hooks.mutex);
 
     /* Initialize components.  The order is important, for some components
        rely on the other components to be initialized. */
     Scm__InitParameter();
     Scm__InitVM();
+    Scm__InitProf();
     Scm__InitHash();
     Scm__InitSymbol();
     Scm__InitModule();
@@ -235,6 +251,489 @@ void Scm_PrintStaticRoots()
     GC_print_static_roots();
 }
 
+/*
+ * GC tuning.  Negative values in PARAMS leave the corresponding
+ * parameter unchanged.  The setters of Boehm GC are unsynchronized,
+ * so we change them with the allocation lock held.
+ */
+static void *gc_configure(void *data)
+{
+    const ScmGCParameters *p = (const ScmGCParameters*)data;
+    if (p->freeSpaceDivisor > 0) GC_set_free_space_divisor(p->freeSpaceDivisor);
+    if (p->fullFrequency >= 0)   GC_set_full_freq((int)p->fullFrequency);
+    if (p->maxHeapSize >= 0)     GC_set_max_heap_size(p->maxHeapSize);
+    if (p->timeLimit >= 0)       GC_set_time_limit(p->timeLimit);
+    return NULL;
+}
+
+void Scm_GCConfigure(const ScmGCParameters *params)
+{
+    /* Incremental mode can't be turned off once enabled. */
+    if (params->incremental > 0) GC_enable_incremental();
+    (void)GC_call_with_alloc_lock(gc_configure, (void*)params);
+}
+
+/*
+ * GC pause recording.
+ *
+ * We hook the collection events of Boehm GC to measure the time the
+ * world is stopped.  Every stop-the-world pause is counted in a
+ * histogram of log2 buckets in microseconds, and each collection is
+ * recorded in a ring buffer along with the heap size after it.
+ * A full collection makes one record summing up its pauses; a pause
+ * outside of a full collection (i.e. a step of incremental collection)
+ * makes a record by itself.
+ *
+ * The event hook is called with the allocation lock held and possibly
+ * with the world stopped, so it must not allocate nor block.  The
+ * readers take the allocation lock to get a consistent snapshot.
+ */
+#define GC_PAUSE_HISTOGRAM_SIZE  32
+#define GC_PAUSE_LOG_SIZE        256
+
+typedef struct gc_pause_entry_rec {
+    u_long gcNo;
+    int    full;
+    double timestamp;           /* start time (monotonic), in seconds */
+    u_long pause;               /* world-stopped time, in usec */
+    u_long duration;            /* whole collection time, in usec */
+    u_long heapSize;            /* after the collection */
+    u_long freeBytes;           /* ditto */
+} gc_pause_entry;
+
+typedef struct gc_pause_stats_rec {
+    int    inFullGC;
+    double fullStart;
+    double stopStart;
+    u_long fullPause;
+    u_long numPauses;
+    u_long maxPause;
+    u_long histogram[GC_PAUSE_HISTOGRAM_SIZE];
+    u_long numEntries;          /* total number of records ever made */
+    gc_pause_entry log[GC_PAUSE_LOG_SIZE];
+} gc_pause_stats;
+
+static gc_pause_stats gc_pauses;
+
+static double gc_clock(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    ScmTimeSpec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
+        return (double)ts.tv_sec + (double)ts.tv_nsec/1.0e9;
+    }
+#endif
+    u_long sec, usec;
+    Scm_GetTimeOfDay(&sec, &usec);
+    return (double)sec + (double)usec/1.0e6;
+}
+
+static u_long gc_usec_since(double from)
+{
+    double d = (gc_clock() - from) * 1.0e6;
+    if (d < 0) return 0;
+    if (d >= (double)ULONG_MAX) return ULONG_MAX;
+    return (u_long)d;
+}
+
+static void gc_pause_record(int full, double start, u_long pause,
+                            u_long duration)
+{
+    struct GC_prof_stats_s st;
+    gc_pause_entry *e = &gc_pauses.log[gc_pauses.numEntries%GC_PAUSE_LOG_SIZE];
+
+    /* We already hold the allocation lock. */
+#if defined(GC_THREADS)
+    GC_get_prof_stats_unsafe(&st, sizeof(st));
+#else
+    GC_get_prof_stats(&st, sizeof(st));
+#endif
+    e->gcNo = (u_long)st.gc_no;
+    e->full = full;
+    e->timestamp = start;
+    e->pause = pause;
+    e->duration = duration;
+    e->heapSize = (u_long)(st.heapsize_full - st.unmapped_bytes);
+    e->freeBytes = (u_long)(st.free_bytes_full - st.unmapped_bytes);
+    gc_pauses.numEntries++;
+}
+
+static void GC_CALLBACK gc_event(GC_EventType ev)
+{
+    switch (ev) {
+    case GC_EVENT_START:
+        SCM_PROBE0(gc__start);
+        gc_pauses.inFullGC = TRUE;
+        gc_pauses.fullStart = gc_clock();
+        gc_pauses.fullPause = 0;
+        break;
+    case GC_EVENT_PRE_STOP_WORLD:
+        gc_pauses.stopStart = gc_clock();
+        break;
+    case GC_EVENT_POST_START_WORLD: {
+        u_long us = gc_usec_since(gc_pauses.stopStart);
+        int i = 0;
+        while (i < GC_PAUSE_HISTOGRAM_SIZE-1 && (us >> i) != 0) i++;
+        gc_pauses.histogram[i]++;
+        gc_pauses.numPauses++;
+        if (us > gc_pauses.maxPause) gc_pauses.maxPause = us;
+        if (gc_pauses.inFullGC) {
+            gc_pauses.fullPause += us;
+        } else {
+            gc_pause_record(FALSE, gc_pauses.stopStart, us, us);
+        }
+        break;
+    }
+    case GC_EVENT_END:
+        /* An aborted full collection doesn't emit GC_EVENT_END; it is
+           finished incrementally, and we count its pauses as such. */
+        SCM_PROBE0(gc__done);
+        if (gc_pauses.inFullGC) {
+            gc_pause_record(TRUE, gc_pauses.fullStart, gc_pauses.fullPause,
+                            gc_usec_since(gc_pauses.fullStart));
+            gc_pauses.inFullGC = FALSE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void *gc_pause_snapshot(void *data)
+{
+    memcpy(data, &gc_pauses, sizeof(gc_pause_stats));
+    return NULL;
+}
+
+static void *gc_pause_clear(void *data)
+{
+    gc_pauses.numPauses = 0;
+    gc_pauses.maxPause = 0;
+    memset(gc_pauses.histogram, 0, sizeof(gc_pauses.histogram));
+    gc_pauses.numEntries = 0;
+    return data;
+}
+
+static gc_pause_stats *gc_pause_get(void)
+{
+    gc_pause_stats *st = SCM_NEW_ATOMIC(gc_pause_stats);
+    (void)GC_call_with_alloc_lock(gc_pause_snapshot, st);
+    return st;
+}
+
+/* Returns ((<bound> . <count>) ...), where each <count> is the number of
+   pauses shorter than <bound> microseconds but not shorter than the
+   previous <bound>.  The list ends at the bucket of the longest pause. */
+ScmObj Scm_GCPauseHistogram(void)
+{
+    gc_pause_stats *st = gc_pause_get();
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    int i, last = -1;
+    for (i=0; i<GC_PAUSE_HISTOGRAM_SIZE; i++) {
+        if (st->histogram[i]) last = i;
+    }
+    for (i=0; i<=last; i++) {
+        SCM_APPEND1(h, t, Scm_Cons(Scm_MakeIntegerU(1UL<<i),
+                                   Scm_MakeIntegerU(st->histogram[i])));
+    }
+    return h;
+}
+
+/* Returns the records of recent collections, oldest first.  Each record
+   is a list of keywords and values. */
+ScmObj Scm_GCPauseLog(void)
+{
+    gc_pause_stats *st = gc_pause_get();
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    u_long i = 0;
+    if (st->numEntries > GC_PAUSE_LOG_SIZE) {
+        i = st->numEntries - GC_PAUSE_LOG_SIZE;
+    }
+    for (; i < st->numEntries; i++) {
+        gc_pause_entry *e = &st->log[i%GC_PAUSE_LOG_SIZE];
+        SCM_APPEND1(h, t,
+                    Scm_List(SCM_MAKE_KEYWORD("gc-count"),
+                             Scm_MakeIntegerU(e->gcNo),
+                             SCM_MAKE_KEYWORD("full"),
+                             SCM_MAKE_BOOL(e->full),
+                             SCM_MAKE_KEYWORD("timestamp"),
+                             Scm_MakeFlonum(e->timestamp),
+                             SCM_MAKE_KEYWORD("pause"),
+                             Scm_MakeIntegerU(e->pause),
+                             SCM_MAKE_KEYWORD("duration"),
+                             Scm_MakeIntegerU(e->duration),
+                             SCM_MAKE_KEYWORD("heap-size"),
+                             Scm_MakeIntegerU(e->heapSize),
+                             SCM_MAKE_KEYWORD("free-bytes"),
+                             Scm_MakeIntegerU(e->freeBytes),
+                             NULL));
+    }
+    return h;
+}
+
+/* Returns (<number of pauses> . <longest pause in usec>) */
+ScmObj Scm_GCPauseSummary(void)
+{
+    gc_pause_stats *st = gc_pause_get();
+    return Scm_Cons(Scm_MakeIntegerU(st->numPauses),
+                    Scm_MakeIntegerU(st->maxPause));
+}
+
+void Scm_GCPauseReset(void)
+{
+    (void)GC_call_with_alloc_lock(gc_pause_clear, NULL);
+}
+
+/*
+ * Allocation hooks.
+ *
+ * SCM_MALLOC and SCM_MALLOC_ATOMIC check Scm__AllocHooks, and if it is
+ * nonzero, call Scm__HookedMalloc.  The bits are set while the allocation
+ * profiler runs (prof.c) and while any thread is in an allocation arena.
+ */
+int Scm__AllocHooks = 0;
+
+static void *arena_alloc(size_t size);
+
+void *Scm__HookedMalloc(size_t size, int atomic)
+{
+    if (Scm__AllocHooks & SCM_ALLOC_HOOK_PROFILER) Scm__ProfCountAlloc(size);
+    if (atomic && (Scm__AllocHooks & SCM_ALLOC_HOOK_ARENA)) {
+        void *p = arena_alloc(size);
+        if (p) return p;
+    }
+    return atomic ? GC_MALLOC_ATOMIC(size) : GC_MALLOC(size);
+}
+
+void Scm__SetAllocHook(int hook, int on)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(alloc_hooks.mutex);
+    if (on) Scm__AllocHooks |= hook;
+    else    Scm__AllocHooks &= ~hook;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(alloc_hooks.mutex);
+}
+
+/*
+ * Allocation arena.
+ *
+ * While a thread is in an arena, the atomic objects it allocates
+ * (string contents, uvector elements, flonums, bignums, ...) are
+ * bump-allocated from large chunks instead of one by one.  A chunk
+ * is an ordinary atomic object of GC, and since GC recognizes interior
+ * pointers, an object in the chunk stays valid as long as someone
+ * refers to it---there's no dangling pointer even if an arena object
+ * escapes from the scope.  When the arena is left, it drops the chunks,
+ * and a chunk that no longer has live objects is reclaimed by the next
+ * collection as a whole, instead of finding and freeing each small
+ * object in it.
+ *
+ * A surviving object keeps its entire chunk, though.  To avoid it,
+ * Scm_AllocArenaCopyOut copies the arena-allocated parts of the result
+ * of the scope to the normal heap.
+ *
+ * Large requests are served by GC as usual.  Non-atomic objects aren't
+ * placed in the arena, since GC needs to scan them.  While any arena is
+ * in use, allocations in other threads take the slow path of
+ * Scm__HookedMalloc as well, but they're served by GC.
+ */
+#define ARENA_ALIGN             16
+#define ARENA_MIN_CHUNK_SIZE    4096
+
+struct ScmAllocArenaRec {
+    SCM_HEADER;
+    ScmAllocArena *prev;        /* enclosing arena; valid while entered */
+    ScmVM *vm;                  /* the VM that entered this, or NULL */
+    size_t chunkSize;
+    char *cur;                  /* free area of the current chunk */
+    char *end;
+    char **chunks;              /* all the chunks we've allocated */
+    int numChunks;
+    int maxChunks;
+    u_long objects;             /* # of objects allocated */
+    u_long bytes;               /* total bytes allocated */
+};
+
+ScmAllocArena *Scm_MakeAllocArena(size_t chunkSize)
+{
+    ScmAllocArena *a = SCM_NEW(ScmAllocArena);
+    SCM_SET_CLASS(a, SCM_CLASS_ALLOCATION_ARENA);
+    if (chunkSize < ARENA_MIN_CHUNK_SIZE) chunkSize = ARENA_MIN_CHUNK_SIZE;
+    a->prev = NULL;
+    a->vm = NULL;
+    a->chunkSize = (chunkSize + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    a->cur = a->end = NULL;
+    a->chunks = NULL;
+    a->numChunks = a->maxChunks = 0;
+    a->objects = a->bytes = 0;
+    return a;
+}
+
+static void *arena_alloc(size_t size)
+{
+    ScmVM *vm = Scm_VM();
+    if (vm == NULL) return NULL;
+    ScmAllocArena *a = vm->allocArena;
+    if (a == NULL || size > a->chunkSize/4) return NULL;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if ((size_t)(a->end - a->cur) < size) {
+        /* NB: We're in the arena; allocate the bookkeeping stuff directly
+           from GC. */
+        char *chunk = GC_MALLOC_ATOMIC(a->chunkSize);
+        if (a->numChunks == a->maxChunks) {
+            int n = a->maxChunks ? a->maxChunks*2 : 8;
+            char **v = GC_MALLOC(n * sizeof(char*));
+            if (a->numChunks > 0) {
+                memcpy(v, a->chunks, a->numChunks * sizeof(char*));
+            }
+            a->chunks = v;
+            a->maxChunks = n;
+        }
+        a->chunks[a->numChunks++] = chunk;
+        a->cur = chunk;
+        a->end = chunk + a->chunkSize;
+    }
+    void *p = a->cur;
+    a->cur += size;
+    a->objects++;
+    a->bytes += size;
+    return p;
+}
+
+/* Make ARENA the innermost arena of the current thread.  An arena can be
+   entered again after it's left (e.g. by re-entering the scope with
+   a continuation), but it can't be entered by more than one thread
+   at a time. */
+void Scm_AllocArenaEnter(ScmAllocArena *arena)
+{
+    ScmVM *vm = Scm_VM();
+    if (arena->vm != NULL) {
+        Scm_Error("allocation arena is already in use: %p", arena);
+    }
+    arena->vm = vm;
+    arena->prev = vm->allocArena;
+    vm->allocArena = arena;
+    (void)SCM_INTERNAL_MUTEX_LOCK(alloc_hooks.mutex);
+    if (alloc_hooks.arenaUsers++ == 0) Scm__AllocHooks |= SCM_ALLOC_HOOK_ARENA;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(alloc_hooks.mutex);
+}
+
+/* Leave ARENA.  It's usually the innermost one, but if continuations
+   are used to jump around, it may be somewhere in the chain. */
+void Scm_AllocArenaLeave(ScmAllocArena *arena)
+{
+    ScmVM *vm = arena->vm;
+    if (vm == NULL) return;     /* not entered */
+    ScmAllocArena **pa = &vm->allocArena;
+    while (*pa != NULL && *pa != arena) pa = &(*pa)->prev;
+    if (*pa == arena) *pa = arena->prev;
+    arena->prev = NULL;
+    arena->vm = NULL;
+    /* Further allocations start from a fresh chunk. */
+    arena->cur = arena->end = NULL;
+    (void)SCM_INTERNAL_MUTEX_LOCK(alloc_hooks.mutex);
+    if (--alloc_hooks.arenaUsers == 0) Scm__AllocHooks &= ~SCM_ALLOC_HOOK_ARENA;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(alloc_hooks.mutex);
+}
+
+int Scm_AllocArenaContains(ScmAllocArena *arena, const void *p)
+{
+    const char *cp = (const char*)p;
+    for (int i=arena->numChunks-1; i>=0; i--) {
+        if (arena->chunks[i] <= cp && cp < arena->chunks[i] + arena->chunkSize)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/* If OBJ is an atomic object in ARENA, returns a copy of it in the heap.
+   A string is fixed in place, so that it keeps its identity. */
+static ScmObj arena_copy_leaf(ScmAllocArena *a, ScmObj obj)
+{
+    if (SCM_FLONUMP(obj)) {
+        if (SCM_FLONUM_MEM_P(obj)
+            && Scm_AllocArenaContains(a, SCM_FLONUM(obj))) {
+            return Scm_MakeFlonum(SCM_FLONUM_VALUE(obj));
+        }
+    } else if (!SCM_HPTRP(obj)) {
+        return obj;
+    } else if (SCM_STRINGP(obj)) {
+        if (!SCM_STRING_ROPE_P(obj)) {
+            ScmStringBody *b = (ScmStringBody*)SCM_STRING_BODY_RAW(obj);
+            if (Scm_AllocArenaContains(a, b->start)) {
+                char *p = SCM_NEW_ATOMIC2(char*, b->size + 1);
+                memcpy(p, b->start, b->size);
+                p[b->size] = '\0';
+                b->start = p;
+            }
+        }
+    } else if (SCM_BIGNUMP(obj)) {
+        if (Scm_AllocArenaContains(a, obj)) {
+            return Scm_BignumCopy(SCM_BIGNUM(obj));
+        }
+    } else if (SCM_COMPNUMP(obj)) {
+        if (Scm_AllocArenaContains(a, obj)) {
+            return Scm_MakeCompnum(SCM_COMPNUM_REAL(obj),
+                                   SCM_COMPNUM_IMAG(obj));
+        }
+    }
+    return obj;
+}
+
+/* Copy the arena-allocated parts of OBJ to the heap.  Lists and vectors
+   are traversed and their elements are replaced in place.  Other
+   containers aren't looked into; arena objects in them just keep their
+   chunks alive.  Uvector elements are left in the arena as well, since
+   other uvectors may share them.  Returns OBJ or its copy. */
+ScmObj Scm_AllocArenaCopyOut(ScmAllocArena *arena, ScmObj obj)
+{
+    ScmVM *vm = Scm_VM();
+    ScmAllocArena *save = vm->allocArena;
+    vm->allocArena = NULL;      /* copies must go to the heap */
+
+    ScmObj r = arena_copy_leaf(arena, obj);
+    if (SCM_PAIRP(r) || SCM_VECTORP(r)) {
+        ScmHashCore visited;
+        Scm_HashCoreInitSimple(&visited, SCM_HASH_EQ, 0, NULL);
+        ScmObj stack = SCM_LIST1(r);
+        while (!SCM_NULLP(stack)) {
+            ScmObj c = SCM_CAR(stack);
+            stack = SCM_CDR(stack);
+            ScmDictEntry *e = Scm_HashCoreSearch(&visited, (intptr_t)c,
+                                                 SCM_DICT_CREATE);
+            if (e->value) continue;
+            (void)SCM_DICT_SET_VALUE(e, SCM_TRUE);
+#define COPY_OUT_ELT(get, set)                                          \
+            do {                                                        \
+                ScmObj x_ = get, y_ = arena_copy_leaf(arena, x_);       \
+                if (!SCM_EQ(x_, y_)) set;                               \
+                if (SCM_PAIRP(y_) || SCM_VECTORP(y_)) {                 \
+                    stack = Scm_Cons(y_, stack);                        \
+                }                                                       \
+            } while (0)
+            if (SCM_PAIRP(c)) {
+                COPY_OUT_ELT(SCM_CAR(c), SCM_SET_CAR(c, y_));
+                COPY_OUT_ELT(SCM_CDR(c), SCM_SET_CDR(c, y_));
+            } else {
+                for (ScmSmallInt i=0; i<SCM_VECTOR_SIZE(c); i++) {
+                    COPY_OUT_ELT(SCM_VECTOR_ELEMENT(c, i),
+                                 SCM_VECTOR_ELEMENT(c, i) = y_);
+                }
+            }
+#undef COPY_OUT_ELT
+        }
+    }
+    vm->allocArena = save;
+    return r;
+}
+
+/* Returns (<chunks> <objects> <bytes>) */
+ScmObj Scm_AllocArenaStats(ScmAllocArena *arena)
+{
+    return SCM_LIST3(SCM_MAKE_INT(arena->numChunks),
+                     Scm_MakeIntegerU(arena->objects),
+                     Scm_MakeIntegerU(arena->bytes));
+}
+
 /*
  * External API to register root set in dynamically loaded library.
  * Boehm GC doesn't do this automatically on some platforms.
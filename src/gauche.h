@@ -469,9 +469,23 @@ typedef struct ScmInstanceRec {
 #define SCM_INSTANCE(obj)        ((ScmInstance*)(obj))
 #define SCM_INSTANCE_SLOTS(obj)  (SCM_INSTANCE(obj)->slots)
 
-/* Fundamental allocators */
-#define SCM_MALLOC(size)          GC_MALLOC(size)
-#define SCM_MALLOC_ATOMIC(size)   GC_MALLOC_ATOMIC(size)
+/* Fundamental allocators.
+   While the allocation profiler is running, or any thread is in an
+   allocation arena, Scm__AllocHooks is nonzero and allocations are
+   routed through Scm__HookedMalloc.  See prof.c and core.c. */
+#define SCM_ALLOC_HOOK_PROFILER  1
+#define SCM_ALLOC_HOOK_ARENA     2
+
+SCM_EXTERN int   Scm__AllocHooks;
+SCM_EXTERN void *Scm__HookedMalloc(size_t size, int atomic);
+SCM_EXTERN void  Scm__SetAllocHook(int hook, int on);
+
+#define SCM_MALLOC(size)                                        \
+    (Scm__AllocHooks                                            \
+     ? Scm__HookedMalloc(size, FALSE) : GC_MALLOC(size))
+#define SCM_MALLOC_ATOMIC(size)                                 \
+    (Scm__AllocHooks                                            \
+     ? Scm__HookedMalloc(size, TRUE) : GC_MALLOC_ATOMIC(size))
 #define SCM_STRDUP(s)             GC_STRDUP(s)
 #define SCM_STRDUP_PARTIAL(s, n)  Scm_StrdupPartial(s, n)
 
@@ -491,6 +505,7 @@ SCM_EXTERN void Scm_UnregisterFinalizer(ScmObj z);
 #define SCM_OBJ_SAFE(obj)     ((obj)?SCM_OBJ(obj):SCM_UNDEFINED)
 
 typedef struct ScmVMRec        ScmVM;
+typedef struct ScmAllocArenaRec ScmAllocArena;
 typedef struct ScmPairRec      ScmPair;
 typedef struct ScmExtendedPairRec ScmExtendedPair;
 typedef struct ScmLazyPairRec  ScmLazyPair;
@@ -518,6 +533,7 @@ typedef struct ScmMacroRec     ScmMacro;
 typedef struct ScmPromiseRec   ScmPromise;
 typedef struct ScmRegexpRec    ScmRegexp;
 typedef struct ScmRegMatchRec  ScmRegMatch;
+typedef struct ScmRegexpSetRec ScmRegexpSet;
 typedef struct ScmWriteControlsRec  ScmWriteControls;  /* see writer.h */
 typedef struct ScmWriteContextRec   ScmWriteContext;   /* see writerP.h */
 typedef struct ScmWriteStateRec     ScmWriteState;     /* see wrtierP.h */
@@ -640,6 +656,60 @@ SCM_CLASS_DECL(Scm_BoxClass);
 
 SCM_EXTERN ScmBox *Scm_MakeBox(ScmObj value);
 
+/* A local box is what the VM allocates for a mutable local variable.
+   It has its own flonum cell, so that assigning a flonum to the variable
+   doesn't allocate.  See box.c for the details. */
+typedef struct ScmLocalBoxRec {
+    ScmBox box;
+    ScmFlonum fcell;
+} ScmLocalBox;
+
+#define SCM_LOCAL_BOX(obj)       ((ScmLocalBox*)(obj))
+#define SCM_LOCAL_BOX_CELL(obj)  SCM_MAKE_FLONUM_MEM(&SCM_LOCAL_BOX(obj)->fcell)
+#define SCM_LOCAL_BOX_SET(obj, value)                                   \
+    do {                                                                \
+        ScmObj b__ = SCM_OBJ(obj), v__ = (value);                       \
+        if (SCM_FLONUMP(v__)) {                                         \
+            SCM_LOCAL_BOX(b__)->fcell.val = SCM_FLONUM_VALUE(v__);      \
+            SCM_BOX_SET(b__, SCM_LOCAL_BOX_CELL(b__));                  \
+        } else {                                                        \
+            SCM_BOX_SET(b__, v__);                                      \
+        }                                                               \
+    } while (0)
+
+SCM_EXTERN ScmObj Scm__MakeLocalBox(ScmObj value);
+
+/* Atomic boxes hold a value that is read and updated atomically, for
+   sharing among threads without locking.  An atomic fxbox holds
+   a fixnum.  The structure is opaque; see box.c. */
+typedef struct ScmAtomicBoxRec ScmAtomicBox;
+
+SCM_CLASS_DECL(Scm_AtomicBoxClass);
+SCM_CLASS_DECL(Scm_AtomicFxboxClass);
+#define SCM_CLASS_ATOMIC_BOX     (&Scm_AtomicBoxClass)
+#define SCM_CLASS_ATOMIC_FXBOX   (&Scm_AtomicFxboxClass)
+#define SCM_ATOMIC_BOX(obj)      ((ScmAtomicBox*)(obj))
+#define SCM_ATOMIC_BOXP(obj)     (SCM_XTYPEP(obj, SCM_CLASS_ATOMIC_BOX))
+#define SCM_ATOMIC_FXBOXP(obj)   (SCM_XTYPEP(obj, SCM_CLASS_ATOMIC_FXBOX))
+
+enum {
+    SCM_ATOMIC_AND,
+    SCM_ATOMIC_IOR,
+    SCM_ATOMIC_XOR
+};
+
+SCM_EXTERN ScmObj Scm_MakeAtomicBox(ScmObj value);
+SCM_EXTERN ScmObj Scm_MakeAtomicFxbox(ScmSmallInt value);
+SCM_EXTERN ScmObj Scm_AtomicBoxRef(ScmAtomicBox *b);
+SCM_EXTERN void   Scm_AtomicBoxSet(ScmAtomicBox *b, ScmObj value);
+SCM_EXTERN ScmObj Scm_AtomicBoxSwap(ScmAtomicBox *b, ScmObj value);
+SCM_EXTERN ScmObj Scm_AtomicBoxCompareAndSwap(ScmAtomicBox *b,
+                                              ScmObj expected,
+                                              ScmObj desired);
+SCM_EXTERN ScmObj Scm_AtomicFxboxFetchAdd(ScmAtomicBox *b, ScmSmallInt delta);
+SCM_EXTERN ScmObj Scm_AtomicFxboxFetchLogop(ScmAtomicBox *b, int op,
+                                            ScmSmallInt mask);
+
 /*---------------------------------------------------------
  * CLASS
  */
@@ -1424,7 +1494,17 @@ struct ScmSubrRec {
                                            can safely pass the register flonums
                                            to the subr.  This is added when
                                            the :fast-flonum flag is given to
-                                           define-cproc. */
+                                           define-cproc.  Scm_ApplyRec calls
+                                           such a subr directly without
+                                           entering the VM, so it must not
+                                           use Scm_VMApply, Scm_VMPushCC
+                                           and the like. */
+
+/* True if OBJ is a subr that Scm_ApplyRec calls directly.  C routines
+   that call back a procedure per element can use it to decide between
+   a plain C loop with Scm_ApplyRec and Scm_VMPushCC continuations. */
+#define SCM_SUBR_IMMEDIATE_P(obj) \
+    (SCM_SUBRP(obj) && (SCM_SUBR_FLAGS(obj) & SCM_SUBR_IMMEDIATE_ARG))
 
 #define SCM__DEFINE_SUBR_INT(cvar, req, opt, cst, inf, flags, func, inliner, data) \
     ScmSubr cvar = {                                                        \
@@ -1463,6 +1543,8 @@ struct ScmGenericRec {
     ScmObj (*fallback)(ScmObj *argv, int argc, ScmGeneric *gf);
     void *data;
     ScmInternalMutex lock;
+    void *dispatchCache;        /* cache of sorted applicable methods.
+                                   see class.c */
 };
 
 SCM_CLASS_DECL(Scm_GenericClass);
@@ -1625,6 +1707,8 @@ SCM_CLASS_DECL(Scm_LazyPairClass);
 #define SCM_LAZY_PAIR_P(obj)       SCM_XTYPEP(obj, SCM_CLASS_LAZY_PAIR)
 
 SCM_EXTERN ScmObj Scm_MakeLazyPair(ScmObj item, ScmObj generator);
+SCM_EXTERN ScmObj Scm_MakeChunkedLazyPair(ScmObj item, ScmObj generator,
+                                          ScmSmallInt chunk, ScmObj policy);
 SCM_EXTERN int    Scm_DecomposeLazyPair(ScmObj obj, ScmObj *item, ScmObj *generator);
 SCM_EXTERN ScmObj Scm_ForceLazyPair(volatile ScmLazyPair *lp);
 SCM_EXTERN int Scm_PairP(ScmObj x);
@@ -1720,8 +1804,14 @@ SCM_CLASS_DECL(Scm_RegexpClass);
 
 SCM_EXTERN ScmObj Scm_RegComp(ScmString *pattern, int flags);
 SCM_EXTERN ScmObj Scm_RegCompFromAST(ScmObj ast);
+SCM_EXTERN ScmObj Scm_RegCompCached(ScmString *pattern, int flags);
+SCM_EXTERN ScmObj Scm_RegCompCacheStats(void);
 SCM_EXTERN ScmObj Scm_RegOptimizeAST(ScmObj ast);
 SCM_EXTERN ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *input);
+SCM_EXTERN ScmObj Scm_RegExecRange(ScmRegexp *rx, ScmString *input,
+                                   ScmSmallInt start, ScmSmallInt end);
+SCM_EXTERN ScmObj Scm_RegExecBytes(ScmRegexp *rx, ScmObj bytes,
+                                   ScmSmallInt start, ScmSmallInt end);
 SCM_EXTERN void Scm_RegDump(ScmRegexp *rx);
 
 SCM_CLASS_DECL(Scm_RegMatchClass);
@@ -1736,6 +1826,14 @@ SCM_EXTERN ScmObj Scm_RegMatchAfter(ScmRegMatch *rm, ScmObj obj);
 SCM_EXTERN ScmObj Scm_RegMatchBefore(ScmRegMatch *rm, ScmObj obj);
 SCM_EXTERN void Scm_RegMatchDump(ScmRegMatch *match);
 
+SCM_CLASS_DECL(Scm_RegexpSetClass);
+#define SCM_CLASS_REGEXP_SET      (&Scm_RegexpSetClass)
+#define SCM_REGEXP_SET(obj)       ((ScmRegexpSet*)obj)
+#define SCM_REGEXP_SET_P(obj)     SCM_XTYPEP(obj, SCM_CLASS_REGEXP_SET)
+
+SCM_EXTERN ScmObj Scm_MakeRegexpSet(ScmObj regexps);
+SCM_EXTERN ScmObj Scm_RegexpSetMatches(ScmRegexpSet *set, ScmString *input);
+
 /*-------------------------------------------------------
  * STUB MACROS
  */
@@ -1778,6 +1876,9 @@ SCM_EXTERN sigset_t Scm_GetMasterSigmask(void);
 SCM_EXTERN void   Scm_SetMasterSigmask(sigset_t *set);
 SCM_EXTERN ScmObj Scm_SignalName(int signum);
 SCM_EXTERN void   Scm_ResetSignalHandlers(sigset_t *mask);
+SCM_EXTERN int    Scm_MakeSignalFd(ScmSysSigset *mask);
+SCM_EXTERN ScmObj Scm_ReadSignalFd(int fd);
+SCM_EXTERN void   Scm_CloseSignalFd(int fd);
 
 SCM_EXTERN void   Scm_GetSigmask(sigset_t *mask);
 SCM_EXTERN void   Scm_SetSigmask(sigset_t *mask);
@@ -1799,9 +1900,16 @@ SCM_EXTERN void   Scm_SetSigmask(sigset_t *mask);
  */
 
 SCM_EXTERN void   Scm_ProfilerStart(void);
+SCM_EXTERN void   Scm_ProfilerStartWithStack(int depth);
+SCM_EXTERN void   Scm_ProfilerStartAllThreads(int depth);
+SCM_EXTERN void   Scm_ProfilerSetAllocationInterval(long bytes);
 SCM_EXTERN int    Scm_ProfilerStop(void);
 SCM_EXTERN void   Scm_ProfilerReset(void);
 
+SCM_EXTERN void   Scm_LockProfilerStart(void);
+SCM_EXTERN void   Scm_LockProfilerStop(void);
+SCM_EXTERN void   Scm_LockProfilerReset(void);
+
 /*---------------------------------------------------
  * UTILITY STUFF
  */
@@ -1821,10 +1929,38 @@ SCM_EXTERN void Scm_SimpleMain(int argc, const char *argv[],
 
 SCM_EXTERN void Scm_GC(void);
 SCM_EXTERN void Scm_PrintStaticRoots(void);
+
+/* GC parameters to change.  Negative value means unchanged. */
+typedef struct ScmGCParametersRec {
+    int  incremental;           /* >0 : enable incremental mode */
+    long freeSpaceDivisor;
+    long fullFrequency;
+    long maxHeapSize;           /* 0 : unlimited */
+    long timeLimit;             /* in msec */
+} ScmGCParameters;
+
+SCM_EXTERN void   Scm_GCConfigure(const ScmGCParameters *params);
+SCM_EXTERN ScmObj Scm_GCPauseHistogram(void);
+SCM_EXTERN ScmObj Scm_GCPauseLog(void);
+SCM_EXTERN ScmObj Scm_GCPauseSummary(void);
+SCM_EXTERN void   Scm_GCPauseReset(void);
 SCM_EXTERN void Scm_RegisterDL(void *data_start, void *data_end,
                                void *bss_start, void *bss_end);
 SCM_EXTERN void Scm_GCSentinel(void *obj, const char *name);
 
+/* Allocation arena.  See core.c */
+SCM_CLASS_DECL(Scm_AllocArenaClass);
+#define SCM_CLASS_ALLOCATION_ARENA   (&Scm_AllocArenaClass)
+#define SCM_ALLOCATION_ARENA(obj)    ((ScmAllocArena*)(obj))
+#define SCM_ALLOCATION_ARENAP(obj)   SCM_XTYPEP(obj, SCM_CLASS_ALLOCATION_ARENA)
+
+SCM_EXTERN ScmAllocArena *Scm_MakeAllocArena(size_t chunkSize);
+SCM_EXTERN void   Scm_AllocArenaEnter(ScmAllocArena *arena);
+SCM_EXTERN void   Scm_AllocArenaLeave(ScmAllocArena *arena);
+SCM_EXTERN int    Scm_AllocArenaContains(ScmAllocArena *arena, const void *p);
+SCM_EXTERN ScmObj Scm_AllocArenaCopyOut(ScmAllocArena *arena, ScmObj obj);
+SCM_EXTERN ScmObj Scm_AllocArenaStats(ScmAllocArena *arena);
+
 SCM_EXTERN ScmObj Scm_GetFeatures(void);
 SCM_EXTERN void   Scm_AddFeature(const char *feature, const char *mod);
 
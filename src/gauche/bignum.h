@@ -75,6 +75,7 @@ SCM_EXTERN ScmObj Scm_BignumMulSI(const ScmBignum *bx, long y);
 SCM_EXTERN ScmObj Scm_BignumDivSI(const ScmBignum *bx, long y, long *r);
 SCM_EXTERN ScmObj Scm_BignumDivRem(const ScmBignum *bx, const ScmBignum *by);
 SCM_EXTERN long   Scm_BignumRemSI(const ScmBignum *bx, long y);
+SCM_EXTERN ScmObj Scm_BignumGcd(const ScmBignum *bx, const ScmBignum *by);
 
 SCM_EXTERN ScmObj Scm_BignumLogAnd(const ScmBignum *bx, const ScmBignum *by);
 SCM_EXTERN ScmObj Scm_BignumLogIor(const ScmBignum *bx, const ScmBignum *by);
@@ -84,6 +84,17 @@ SCM_EXTERN ScmObj Scm_CharSetRead(ScmPort *input, int *complement_p,
 
 SCM_EXTERN int    Scm_CharSetContains(ScmCharSet *cs, ScmChar c);
 SCM_EXTERN void   Scm_CharSetDump(ScmCharSet *cs, ScmPort *port);
+SCM_EXTERN ScmSmallInt Scm_StringIndexCharSet(ScmString *str,
+                                              ScmCharSet *cs, int negate,
+                                              ScmSmallInt start,
+                                              ScmSmallInt end);
+SCM_EXTERN ScmSmallInt Scm_StringIndexCharSetRight(ScmString *str,
+                                                   ScmCharSet *cs,
+                                                   int negate,
+                                                   ScmSmallInt start,
+                                                   ScmSmallInt end);
+SCM_EXTERN ScmObj Scm_StringTokenize(ScmString *str, ScmCharSet *cs,
+                                     ScmSmallInt start, ScmSmallInt end);
 
 /* predefined character set API */
 enum {
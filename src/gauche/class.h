@@ -144,6 +144,11 @@ SCM_EXTERN ScmObj Scm_ComputeApplicableMethods(ScmGeneric *gf,
                                                int argc,
                                                int applyargs);
 SCM_EXTERN ScmObj Scm_SortMethods(ScmObj methods, ScmObj *argv, int argc);
+SCM_EXTERN ScmObj Scm__ComputeSortedApplicableMethods(ScmGeneric *gf,
+                                                      ScmObj *argv,
+                                                      int argc);
+SCM_EXTERN void   Scm__InvalidateDispatchCaches(void);
+SCM_EXTERN ScmObj Scm__VMMakeFast(ScmClass *klass, ScmObj initargs);
 SCM_EXTERN ScmObj Scm_MakeNextMethod(ScmGeneric *gf, ScmObj methods,
                                      ScmObj *argv, int argc,
                                      int copyargs, int applyargs);
@@ -78,13 +78,63 @@ struct ScmComparatorRec {
 
    SCM_COMPARATOR_SRFI_128 - Indicates this is srfi-128-style comparator,
      so using orderFn is preferred to compareFn.
+
+   SCM_COMPARATOR_NATIVE_COMPARE - The order of the comparator coincides
+     with Scm_Compare on the objects that pass the type test (e.g. the
+     comparison procedure is 'compare', or the comparator is srfi-128 style
+     with string? and string<?).  Sort and tree-map can call Scm_Compare
+     directly instead of calling back to Scheme.
+
+   Besides the boolean flags, the constructor records native "tags" of
+   the type test, equality predicate and hash function when they are
+   recognized as built-in procedures, so that C routines can bypass
+   VM calls.  Use SCM_COMPARATOR_TYPE_TAG etc. to retrieve them; 0
+   means the procedure isn't known and has to be called.
 */
 enum ScmComparatorFlags {
     SCM_COMPARATOR_NO_ORDER = (1L<<0), /* 'compare' proc unavailable */
     SCM_COMPARATOR_NO_HASH  = (1L<<1), /* 'hash' proc unavailable */
     SCM_COMPARATOR_ANY_TYPE = (1L<<2), /* type-test always returns #t */
     SCM_COMPARATOR_USE_COMPARISON = (1L<<3), /* equality use comarison */
-    SCM_COMPARATOR_SRFI_128 = (1L<<4)  /* srfi-128 style comparator */
+    SCM_COMPARATOR_SRFI_128 = (1L<<4), /* srfi-128 style comparator */
+    SCM_COMPARATOR_NATIVE_COMPARE = (1L<<5) /* order is Scm_Compare */
+};
+
+/* Native tags, embedded in the flags */
+#define SCM_COMPARATOR_TYPE_SHIFT   8
+#define SCM_COMPARATOR_EQUIV_SHIFT  12
+#define SCM_COMPARATOR_HASH_SHIFT   16
+#define SCM_COMPARATOR_TAG_MASK     0x0fL
+
+#define SCM_COMPARATOR_TYPE_TAG(c) \
+    (((c)->flags >> SCM_COMPARATOR_TYPE_SHIFT) & SCM_COMPARATOR_TAG_MASK)
+#define SCM_COMPARATOR_EQUIV_TAG(c) \
+    (((c)->flags >> SCM_COMPARATOR_EQUIV_SHIFT) & SCM_COMPARATOR_TAG_MASK)
+#define SCM_COMPARATOR_HASH_TAG(c) \
+    (((c)->flags >> SCM_COMPARATOR_HASH_SHIFT) & SCM_COMPARATOR_TAG_MASK)
+
+enum {                          /* type test */
+    SCM_COMPARATOR_TYPE_UNKNOWN,
+    SCM_COMPARATOR_TYPE_STRING,         /* string? */
+    SCM_COMPARATOR_TYPE_SYMBOL,         /* symbol? */
+    SCM_COMPARATOR_TYPE_CHAR,           /* char? */
+    SCM_COMPARATOR_TYPE_BOOLEAN,        /* boolean? */
+    SCM_COMPARATOR_TYPE_EXACT_INTEGER   /* exact-integer? */
+};
+
+enum {                          /* equality predicate */
+    SCM_COMPARATOR_EQUIV_UNKNOWN,
+    SCM_COMPARATOR_EQUIV_EQ,            /* eq? */
+    SCM_COMPARATOR_EQUIV_EQV,           /* eqv? */
+    SCM_COMPARATOR_EQUIV_EQUAL,         /* equal? */
+    SCM_COMPARATOR_EQUIV_STRING         /* string=? */
+};
+
+enum {                          /* hash function */
+    SCM_COMPARATOR_HASH_UNKNOWN,
+    SCM_COMPARATOR_HASH_EQ,             /* eq-hash */
+    SCM_COMPARATOR_HASH_EQV,            /* eqv-hash */
+    SCM_COMPARATOR_HASH_DEFAULT         /* default-hash */
 };
 
 SCM_CLASS_DECL(Scm_ComparatorClass);
@@ -98,6 +148,7 @@ SCM_EXTERN ScmObj Scm_MakeComparator(ScmObj type, ScmObj eq,
 SCM_EXTERN ScmObj Scm_ComparatorComparisonProcedure(ScmComparator *);
 SCM_EXTERN ScmObj Scm_ComparatorOrderingPredicate(ScmComparator *);
 SCM_EXTERN ScmObj Scm_ComparatorHashFunction(ScmComparator *);
+SCM_EXTERN int    Scm_ComparatorTestType(ScmComparator *, ScmObj);
 
 /* Other genreic utilities */
 SCM_EXTERN int    Scm_Compare(ScmObj x, ScmObj y);
@@ -105,6 +156,20 @@ SCM_EXTERN void   Scm_SortArray(ScmObj *elts, int nelts, ScmObj cmpfn);
 SCM_EXTERN ScmObj Scm_SortList(ScmObj objs, ScmObj fn);
 SCM_EXTERN ScmObj Scm_SortListX(ScmObj objs, ScmObj fn);
 
+/* Flags for Scm_SortArrayFull and Scm_SortListFull.
+   CMPFN of these can also be a comparator; if its order coincides with
+   Scm_Compare (SCM_COMPARATOR_NATIVE_COMPARE), elements are compared
+   without calling back to Scheme. */
+enum {
+    SCM_SORT_STABLE = (1L<<0),      /* use a stable algorithm */
+    SCM_SORT_PREDICATE = (1L<<1),   /* cmpfn is a less-than predicate */
+    SCM_SORT_DESTRUCTIVE = (1L<<2)  /* reuse the cells (list only) */
+};
+
+SCM_EXTERN void   Scm_SortArrayFull(ScmObj *elts, ScmSmallInt nelts,
+                                    ScmObj cmpfn, u_long flags);
+SCM_EXTERN ScmObj Scm_SortListFull(ScmObj objs, ScmObj fn, u_long flags);
+
 
 SCM_DECL_END
 
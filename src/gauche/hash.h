@@ -72,6 +72,13 @@ struct ScmHashCoreRec {
     ScmHashProc          *hashfn;
     ScmHashCompareProc   *cmpfn;
     void *data;
+    /* The chained core grows incrementally.  While growing, the entries
+       in the old buckets at or above migrateIndex are yet to be moved
+       to buckets.  oldBuckets is NULL otherwise. */
+    void **oldBuckets;
+    int numOldBuckets;
+    int numOldBucketsLog2;
+    int migrateIndex;
 };
 
 SCM_EXTERN void Scm_HashCoreInitSimple(ScmHashCore *core,
@@ -85,6 +92,39 @@ SCM_EXTERN void Scm_HashCoreInitGeneral(ScmHashCore *core,
                                         unsigned int initSize,
                                         void *data);
 
+/* Implementation of the core.  The chained core is a bucket array with
+   linked entries.  The open addressing core probes a flat array with
+   per-slot control bytes, which is faster for cheap keys.
+   SCM_HASH_CORE_DEFAULT chooses open addressing for SCM_HASH_EQ,
+   SCM_HASH_EQV, SCM_HASH_STRING and SCM_HASH_WORD, and chaining for
+   the others.  With open addressing, hashfn and cmpfn must not modify
+   the table being accessed. */
+typedef enum {
+    SCM_HASH_CORE_DEFAULT,
+    SCM_HASH_CORE_CHAINED,
+    SCM_HASH_CORE_OPEN
+} ScmHashCoreKind;
+
+#define SCM_HASH_CORE_KIND_MASK  0x0f
+
+/* Flag to be ORed to ScmHashCoreKind.  Uses a fast hash function
+   instead of SipHash for string keys, in SCM_HASH_STRING and
+   SCM_HASH_EQUAL cores.  It is not resistant to hash flooding attacks,
+   so use it only if the keys are trusted. */
+#define SCM_HASH_CORE_FAST_HASH  0x10
+
+/* TYPE other than SCM_HASH_GENERAL ignores HASHFN and CMPFN.
+   FLAGS is ScmHashCoreKind, optionally ORed with SCM_HASH_CORE_FAST_HASH. */
+SCM_EXTERN void Scm_HashCoreInitFull(ScmHashCore *core,
+                                     ScmHashType type,
+                                     ScmHashProc *hashfn,
+                                     ScmHashCompareProc *cmpfn,
+                                     unsigned int initSize,
+                                     void *data,
+                                     int flags);
+
+SCM_EXTERN ScmHashCoreKind Scm_HashCoreKind(const ScmHashCore *core);
+
 SCM_EXTERN int  Scm_HashCoreTypeToProcs(ScmHashType type,
                                         ScmHashProc **hashfn,
                                         ScmHashCompareProc **cmpfn);
@@ -99,6 +139,18 @@ SCM_EXTERN int  Scm_HashCoreNumEntries(ScmHashCore *core);
 
 SCM_EXTERN void Scm_HashCoreClear(ScmHashCore *core);
 
+SCM_EXTERN int  Scm_HashCoreSweep(ScmHashCore *core,
+                                  int (*pred)(const ScmDictEntry *e,
+                                              void *data),
+                                  void *data);
+
+/* Make CORE hold at least NUMENTRIES entries without growing.
+   Scm_HashCoreCapacity returns the number of entries CORE can hold
+   without growing. */
+SCM_EXTERN void Scm_HashCoreReserve(ScmHashCore *core,
+                                    unsigned int numEntries);
+SCM_EXTERN int  Scm_HashCoreCapacity(const ScmHashCore *core);
+
 struct ScmHashIterRec {
     ScmHashCore *core;
     int   bucket;
@@ -145,6 +197,8 @@ SCM_CLASS_DECL(Scm_HashTableClass);
 
 SCM_EXTERN ScmObj Scm_MakeHashTableSimple(ScmHashType type,
                                           unsigned int initSize);
+SCM_EXTERN ScmObj Scm_MakeTrustedHashTable(ScmHashType type,
+                                           unsigned int initSize);
 SCM_EXTERN ScmObj Scm_MakeHashTableFull(ScmHashProc *hashfn,
                                         ScmHashCompareProc *cmpfn,
                                         unsigned int initSize,
@@ -87,6 +87,8 @@ SCM_EXTERN ScmObj Scm_CurrentLoadNext(void);
 SCM_EXTERN ScmObj Scm_CurrentLoadPort(void);
 SCM_EXTERN ScmObj Scm_LoadMainScript(void);
 
+SCM_EXTERN void   Scm__RecordLoadStat(ScmObj kind, ScmObj name);
+
 /*=================================================================
  * Load path management
  */
@@ -95,6 +97,8 @@ SCM_EXTERN ScmObj Scm_GetLoadPath(void);
 SCM_EXTERN ScmObj Scm_AddLoadPath(const char *cpath, int afterp);
 SCM_EXTERN void   Scm_AddLoadPathHook(ScmObj proc, int afterp);
 SCM_EXTERN void   Scm_DeleteLoadPathHook(ScmObj proc);
+SCM_EXTERN ScmObj Scm_LoadPathDirListing(ScmString *dir);
+SCM_EXTERN void   Scm_LoadPathDirCacheClear(void);
 
 /*=================================================================
  * Dynamic Loading
@@ -130,6 +134,10 @@ struct ScmAutoloadRec {
     ScmSymbol *import_from;     /* module to be imported after loading */
     ScmModule *import_to;       /* module to where import_from should be
                                    imported */
+    ScmObj dso_initfn;          /* If not #f, PATH names a DSO and the
+                                   autoload is resolved by dynamic-loading
+                                   it.  The value is the name of the
+                                   initfn, or #t to use the default one. */
                                 /* The fields above will be set up when
                                    the autoload object is created, and never
                                    be modified. */
@@ -155,6 +163,8 @@ SCM_EXTERN ScmObj Scm_MakeAutoload(ScmModule *where,
                                    ScmSymbol *import_from);
 SCM_EXTERN void   Scm_DefineAutoload(ScmModule *where, ScmObj file_or_module,
                                      ScmObj list);
+SCM_EXTERN void   Scm_DefineDSOAutoload(ScmModule *where, ScmString *dsoname,
+                                        ScmObj initfn, ScmObj list);
 SCM_EXTERN ScmObj Scm_ResolveAutoload(ScmAutoload *autoload, int flags);
 
 #endif /* GAUCHE_LOAD_H */
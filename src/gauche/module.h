@@ -69,6 +69,12 @@ struct ScmModuleRec {
     ScmObj info;                /* alist of metainfo; e.g.
                                    (source-info . <string>) */
     int    sealed;              /* if true, no modification is allowed */
+    ScmHashTable *resolved;     /* Symbol -> GLoc or #f, caching the result
+                                   of searching imported and inherited
+                                   modules.  Valid only while
+                                   resolvedVersion matches the global
+                                   binding version.  See module.c */
+    u_long resolvedVersion;
 };
 
 #define SCM_MODULE(obj)       ((ScmModule*)(obj))
@@ -355,6 +355,7 @@ SCM_EXTERN size_t Scm_PrintDouble(ScmPort *port, double d, ScmNumberFormat *f);
 /* Higher-level convenience routines */
 SCM_EXTERN ScmObj Scm_NumberToString(ScmObj num, int radix, u_long flags);
 SCM_EXTERN ScmObj Scm_StringToNumber(ScmString *str, int radix, u_long flags);
+SCM_EXTERN ScmObj Scm__ParseDecimalNumber(const char *str, int len);
 
 /* This is here, for we need to check double endianness on ARM. */
 SCM_EXTERN ScmObj Scm_NativeEndian(void);
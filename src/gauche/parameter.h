@@ -82,5 +82,7 @@ typedef struct ScmVMParameterTableRec {
 
 SCM_EXTERN void Scm__VMParameterTableInit(ScmVMParameterTable *table,
                                           ScmVM *base);
+SCM_EXTERN ScmObj Scm__VMParameterize(int num, ScmParameterLoc *locs,
+                                      ScmObj *vals, ScmObj thunk);
 
 #endif /*GAUCHE_PARAMETER_H*/
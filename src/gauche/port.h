@@ -167,6 +167,9 @@ struct ScmPortRec {
             const char *start;
             const char *current;
             const char *end;
+            void *owner;        /* if not NULL, the region [start, end)
+                                   is a file mapping kept alive by this
+                                   object; see Scm_OpenMappedFilePort */
         } istr;                 /* input string port */
         ScmDString ostr;        /* output string port */
         ScmPortVTable vt;       /* virtual port */
@@ -227,8 +230,10 @@ enum ScmPortFlags {
                                    of two-pass writing. */
     SCM_PORT_PRIVATE = (1L<<2), /* this port is for 'private' use within
                                    a thread, so never need to be locked. */
-    SCM_PORT_CASE_FOLD = (1L<<3) /* read from or write to this port should
+    SCM_PORT_CASE_FOLD = (1L<<3), /* read from or write to this port should
                                     be case folding. */
+    SCM_PORT_CORKED = (1L<<4)   /* output is held in the buffer until
+                                   uncorked.  See Scm_PortCork. */
 };
 
 #if 0 /* not implemented */
@@ -259,6 +264,8 @@ enum ScmPortICPolicy {
 #define SCM_PORT_ICPOLICY(obj)  (SCM_PORT(obj)->icpolicy)
 
 #define SCM_PORT_CASE_FOLDING(obj) (SCM_PORT_FLAGS(obj)&SCM_PORT_CASE_FOLD)
+#define SCM_PORT_PRIVATE_P(obj)    (SCM_PORT_FLAGS(obj)&SCM_PORT_PRIVATE)
+#define SCM_PORT_CORKED_P(obj)     (SCM_PORT_FLAGS(obj)&SCM_PORT_CORKED)
 
 #define SCM_PORT_CLOSED_P(obj)  (SCM_PORT(obj)->closed)
 #define SCM_PORT_OWNER_P(obj)   (SCM_PORT(obj)->ownerp)
@@ -311,6 +318,9 @@ SCM_EXTERN int    Scm_GetPortBufferSigpipeSensitive(ScmPort *port);
 SCM_EXTERN void   Scm_SetPortBufferSigpipeSensitive(ScmPort *port, int sensitive);
 SCM_EXTERN int    Scm_GetPortCaseFolding(ScmPort *port);
 SCM_EXTERN void   Scm_SetPortCaseFolding(ScmPort *port, int flag);
+SCM_EXTERN void   Scm_PortMakePrivate(ScmPort *port);
+SCM_EXTERN void   Scm_PortCork(ScmPort *port);
+SCM_EXTERN void   Scm_PortUncork(ScmPort *port);
 SCM_EXTERN ScmObj Scm_GetPortReaderLexicalMode(ScmPort *port);
 SCM_EXTERN void   Scm_SetPortReaderLexicalMode(ScmPort *port, ScmObj obj);
 
@@ -346,16 +356,24 @@ SCM_EXTERN ScmObj Scm_PortAttrDeleteUnsafe(ScmPort *port, ScmObj key);
 SCM_EXTERN ScmObj Scm_PortAttrs(ScmPort *port);
 SCM_EXTERN ScmObj Scm_PortAttrsUnsafe(ScmPort *port);
 
+/* A chunk of bytes for gathered output; see Scm_Putzv. */
+typedef struct ScmIOVecRec {
+    const char *base;
+    ScmSmallInt len;
+} ScmIOVec;
+
 SCM_EXTERN void   Scm_Putb(ScmByte b, ScmPort *port);
 SCM_EXTERN void   Scm_Putc(ScmChar c, ScmPort *port);
 SCM_EXTERN void   Scm_Puts(ScmString *s, ScmPort *port);
 SCM_EXTERN void   Scm_Putz(const char *s, int len, ScmPort *port);
+SCM_EXTERN void   Scm_Putzv(const ScmIOVec *v, int n, ScmPort *port);
 SCM_EXTERN void   Scm_Flush(ScmPort *port);
 
 SCM_EXTERN void   Scm_PutbUnsafe(ScmByte b, ScmPort *port);
 SCM_EXTERN void   Scm_PutcUnsafe(ScmChar c, ScmPort *port);
 SCM_EXTERN void   Scm_PutsUnsafe(ScmString *s, ScmPort *port);
 SCM_EXTERN void   Scm_PutzUnsafe(const char *s, int len, ScmPort *port);
+SCM_EXTERN void   Scm_PutzvUnsafe(const ScmIOVec *v, int n, ScmPort *port);
 SCM_EXTERN void   Scm_FlushUnsafe(ScmPort *port);
 
 SCM_EXTERN void   Scm_Ungetc(ScmChar ch, ScmPort *port);
@@ -380,6 +398,15 @@ SCM_EXTERN ScmObj Scm_UngottenBytesUnsafe(ScmPort *port);
 
 SCM_EXTERN ScmObj Scm_ReadLine(ScmPort *port);
 SCM_EXTERN ScmObj Scm_ReadLineUnsafe(ScmPort *port);
+SCM_EXTERN ScmSmallInt Scm_ReadLineBytes(ScmPort *port, char *buf,
+                                         ScmSmallInt buflen, int *completep);
+SCM_EXTERN ScmSmallInt Scm_ReadLineBytesUnsafe(ScmPort *port, char *buf,
+                                               ScmSmallInt buflen,
+                                               int *completep);
+SCM_EXTERN ScmSmallInt Scm_ReadLines(ScmPort *port, ScmObj *dst,
+                                     ScmSmallInt n);
+SCM_EXTERN ScmSmallInt Scm_ReadLinesUnsafe(ScmPort *port, ScmObj *dst,
+                                           ScmSmallInt n);
 
 #if 0
 #define SCM_PORT_CURIN  (1<<0)
@@ -396,6 +423,11 @@ SCM_EXTERN ScmObj Scm_WithPort(ScmPort *port[], ScmObj thunk,
 
 SCM_EXTERN ScmObj Scm_OpenFilePort(const char *path, int flags,
                                    int buffering, int perm);
+SCM_EXTERN ScmObj Scm_OpenMappedFilePort(const char *path);
+SCM_EXTERN ScmSmallInt Scm_CopyFilePort(ScmPort *src, ScmPort *dst,
+                                        ScmSmallInt limit);
+SCM_EXTERN ScmSmallInt Scm_CopyFilePortUnsafe(ScmPort *src, ScmPort *dst,
+                                              ScmSmallInt limit);
 
 SCM_EXTERN ScmObj Scm_Stdin(void);
 SCM_EXTERN ScmObj Scm_Stdout(void);
@@ -419,10 +451,15 @@ SCM_EXTERN ScmObj Scm_SetCurrentErrorPort(ScmPort *port);
 
 SCM_EXTERN ScmObj Scm_MakeInputStringPort(ScmString *str, int privatep);
 SCM_EXTERN ScmObj Scm_MakeOutputStringPort(int privatep);
+SCM_EXTERN ScmObj Scm_MakeOutputStringPortWithCapacity(int capacity,
+                                                       int privatep);
 
 SCM_EXTERN ScmObj Scm_GetOutputString(ScmPort *port, int flags);
 SCM_EXTERN ScmObj Scm_GetOutputStringUnsafe(ScmPort *port, int flags);
+SCM_EXTERN void   Scm_ResetOutputString(ScmPort *port, int recycle);
+SCM_EXTERN ScmObj Scm_TakeOutputString(ScmPort *port, int flags);
 SCM_EXTERN ScmObj Scm_GetRemainingInputString(ScmPort *port, int flags);
+SCM_EXTERN ScmObj Scm_GetRemainingInputBytes(ScmPort *port);
 
 /*================================================================
  * Other type of ports
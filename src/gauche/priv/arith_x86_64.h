@@ -17,7 +17,7 @@
 
 /* x or y can be immediate, in that case we can't use it directly
    in subq.  hence movq to rax/rdx. */
-#define UADD(r, v, x, y)                        \
+#define UADD(r, c, x, y)                        \
     asm("movq %2, %%rax;"                       \
         "movq %3, %%rdx;"                       \
         "cmpq $1, %1;"                          \
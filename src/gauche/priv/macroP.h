@@ -60,6 +60,11 @@ typedef struct ScmSyntaxRuleBranchRec {
     ScmObj templat;             /* template to be expanded */
     int numPvars;               /* # of pattern variables */
     int maxLevel;               /* maximum # of nested subpatterns */
+    int minLength;              /* minimum # of args the form must have */
+    int maxLength;              /* maximum # of args, or -1 if unbounded */
+    int dotted;                 /* TRUE if the pattern has a dotted tail */
+    int numTvars;               /* # of identifiers inserted by template */
+    ScmObj *tvars;              /* identifiers inserted by template */
 } ScmSyntaxRuleBranch;
 
 typedef struct ScmSyntaxRules {
@@ -35,12 +35,15 @@
 #define GAUCHE_PRIV_PORTP_H
 
 #include "gauche/priv/writerP.h"
+#include "gauche/prof.h"
 
 /*================================================================
  * Some private APIs
  */
 
 SCM_EXTERN void Scm__InstallCodingAwarePortHook(ScmPort *(*)(ScmPort*, const char*));
+SCM_EXTERN void Scm__WriteTree(ScmObj tree, ScmPort *port, ScmObj fallback);
+SCM_EXTERN int  Scm__ActiveBufferedPortCount(void);
 
 /* Windows-specific initialization */
 #if defined(GAUCHE_WINDOWS)
@@ -96,10 +99,13 @@ void Scm__SetupPortsForWindows(int has_console);
  *  atomic.  We would need to get system-level lock in PORT_UNLOCK as well.
  */
 
-/* Lock a port P.  Can perform recursive lock. */
+/* Lock a port P.  Can perform recursive lock.
+   While the lock contention profiler is running, reports acquisition
+   and release of the lock to it (see prof.c). */
 #define PORT_LOCK(p, vm)                                        \
     do {                                                        \
       if (p->lockOwner != vm) {                                 \
+          ScmInt64 wait__ = 0;                                  \
           for (;;) {                                            \
               ScmVM* owner__;                                   \
               (void)SCM_INTERNAL_FASTLOCK_LOCK(p->lock);        \
@@ -111,8 +117,15 @@ void Scm__SetupPortsForWindows(int has_console);
               }                                                 \
               (void)SCM_INTERNAL_FASTLOCK_UNLOCK(p->lock);      \
               if (p->lockOwner == vm) break;                    \
+              if (wait__ == 0 && Scm__LockProfiling) {          \
+                  wait__ = Scm_MonotonicNanoseconds();          \
+                  Scm__LockProfilerWait(SCM_OBJ(p));            \
+              }                                                 \
               Scm_YieldCPU();                                   \
           }                                                     \
+          if (wait__ || Scm__LockProfiling) {                   \
+              Scm__LockProfilerAcquired(SCM_OBJ(p), wait__, TRUE); \
+          }                                                     \
       } else {                                                  \
           p->lockCount++;                                       \
       }                                                         \
@@ -122,6 +135,9 @@ void Scm__SetupPortsForWindows(int has_console);
 #define PORT_UNLOCK(p)                                  \
     do {                                                \
         if (--p->lockCount <= 0) {                      \
+            if (Scm__LockProfiling) {                   \
+                Scm__LockProfilerReleased(SCM_OBJ(p));  \
+            }                                           \
             SCM_INTERNAL_SYNC();                        \
             p->lockOwner = NULL;                        \
         } \
@@ -149,13 +165,30 @@ void Scm__SetupPortsForWindows(int has_console);
 
 /* Should be used in the constructor of private ports.
    Mark the port locked by vm, so that it can be used exclusively by
-   the vm. */
+   the vm.  The lock is never released.  The port APIs see the
+   SCM_PORT_PRIVATE flag and go to the unsafe version directly,
+   without even looking up the current vm. */
 
 #define PORT_PRELOCK(p, vm)                     \
    do {                                         \
      p->lockOwner = vm;                         \
      p->lockCount = 1;                          \
+     p->flags |= SCM_PORT_PRIVATE;              \
+   } while (0)
+
+/* Nobody checks if a private port is used only by its owner, unless
+   compiled with PARANOIA. */
+#ifdef PARANOIA
+#define PORT_PRIVATE_CHECK(p)                                           \
+   do {                                                                 \
+     if (!PORT_LOCK_OWNER_P(p, Scm_VM())) {                             \
+       Scm_Error("private port %S is used by a thread other than "      \
+                 "its owner", p);                                       \
+     }                                                                  \
    } while (0)
+#else
+#define PORT_PRIVATE_CHECK(p)  /*empty*/
+#endif
 
 
 #endif /*GAUCHE_PRIV_PORTP_H*/
@@ -0,0 +1,78 @@
+/*
+ * probeP.h - Static tracepoints
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GAUCHE_PRIV_PROBEP_H
+#define GAUCHE_PRIV_PROBEP_H
+
+/*
+ * Static tracepoints (USDT probes) at the VM hot points.
+ *
+ * If configured with --with-dtrace, each SCM_PROBE* expands to an
+ * sdt probe of provider 'gauche', which is a single nop until a tracer
+ * (DTrace, SystemTap, bpftrace) attaches to it.  Otherwise they expand
+ * to nothing.  The arguments are evaluated only when the probes are
+ * compiled in, so keep them cheap and side-effect free.
+ *
+ *   procedure__entry      (ScmVM *vm, ScmObj proc, int argc)
+ *   procedure__return     (ScmVM *vm, ScmObj val0)
+ *   gc__start             ()
+ *   gc__done              ()
+ *   exception__raise      (ScmVM *vm, ScmObj condition)
+ *   continuation__capture (ScmVM *vm, int partial)
+ *   port__fill            (ScmPort *port, int nbytes)
+ *   port__flush           (ScmPort *port, int nbytes)
+ *   thread__start         (ScmVM *vm, long vmid)
+ *   thread__stop          (ScmVM *vm, long vmid)
+ *   load__start           (const char *path, int len)
+ *   load__done            ()
+ *
+ * Pointers to Scheme objects are passed as is; a tracer can decode
+ * them with the help of gauche.h layouts if needed.  The path of
+ * load__start isn't NUL-terminated.  Loading of DSOs is reported
+ * only while load statistics are being collected (gosh -pload).
+ */
+
+#if defined(HAVE_SDT)
+#include <sys/sdt.h>
+#define SCM_PROBE0(name)           DTRACE_PROBE(gauche, name)
+#define SCM_PROBE1(name, a)        DTRACE_PROBE1(gauche, name, a)
+#define SCM_PROBE2(name, a, b)     DTRACE_PROBE2(gauche, name, a, b)
+#define SCM_PROBE3(name, a, b, c)  DTRACE_PROBE3(gauche, name, a, b, c)
+#else  /*!HAVE_SDT*/
+#define SCM_PROBE0(name)           /*empty*/
+#define SCM_PROBE1(name, a)        /*empty*/
+#define SCM_PROBE2(name, a, b)     /*empty*/
+#define SCM_PROBE3(name, a, b, c)  /*empty*/
+#endif /*!HAVE_SDT*/
+
+#endif /*GAUCHE_PRIV_PROBEP_H*/
@@ -41,7 +41,9 @@
 /* We have two types of profilers, a statistic sampler and call-counter.
  *
  * The statistic sampler uses ITIMER_PROF and records the current code
- * base and PC for every SIGPROF.
+ * base and PC for every SIGPROF.  If the stack depth is given to
+ * the profiler, it also records the code bases of the continuation
+ * frames up to the depth.
  * (NB: in order for this to work, VM's PC must always be saved
  * in VM structure; in another word, vm.c must be compiled with
  * SMALL_REGS == 0).
@@ -50,8 +52,9 @@
  * execution on the thread.   Each entry just records the address of
  * the called object.
  *
- * TODO: It is not known if sampling profiler works when more than one
- * thread requests profiling.  Should be considrered later.
+ * By default, the sampler only samples the thread that started it.
+ * In the process-wide mode, every thread with a VM is sampled, each
+ * into its own buffer.  See prof.c for the details.
  *
  * When the on-memory buffer of the call counter gets full, it is collected
  * to a hash table.  When the statistic sampling buffer gets full, it
@@ -90,6 +93,15 @@ typedef struct ScmProfSampleRec {
 /* # of on-memory samples for the statistic sampler. */
 #define SCM_PROF_SAMPLES_IN_BUFFER  6000
 
+/* Stack samples are kept in a separate word buffer.  Each sample
+   occupies (1 + n) words; a fixnum n, followed by n code bases,
+   innermost first.  Like the statistic samples, the buffer is flushed
+   to a temporary file when it gets full. */
+#define SCM_PROF_STACK_BUFFER_SIZE  32768
+
+/* Maximum depth of stack samples. */
+#define SCM_PROF_MAX_STACK_DEPTH    256
+
 /* A record of call counter */
 typedef struct ScmProfCountRec {
     ScmObj func;                /* Called Function */
@@ -112,12 +124,45 @@ struct ScmVMProfilerRec {
     ScmHashTable* statHash;     /* hashtable for collected data.
                                    value is a pair of integers,
                                    (<call-count> . <sample-hits>) */
+    int stackDepth;             /* max # of frames to record per sample.
+                                   0 to disable stack sampling. */
+    int stackFd;                /* temporary file for stack samples */
+    int currentStack;           /* index to the stack buffer */
+    ScmObj stacks;              /* collected stack samples; list of
+                                   lists of code, outermost first */
+    int threadRequest;          /* request from the process-wide profiler
+                                   to be processed by the VM's thread */
+    int threadAttached;         /* TRUE if this thread receives samples
+                                   from the process-wide profiler */
+    int sigprofBlocked;         /* TRUE if SIGPROF was blocked before
+                                   attached */
+    ScmHashTable *allocHash;    /* code -> sampled allocation bytes */
+    int allocSampling;          /* TRUE while updating allocHash */
 
     ScmProfSample samples[SCM_PROF_SAMPLES_IN_BUFFER];
     ScmProfCount  counts[SCM_PROF_COUNTER_IN_BUFFER];
+    ScmObj stackBuf[SCM_PROF_STACK_BUFFER_SIZE];
 };
 
 SCM_EXTERN ScmObj Scm_ProfilerRawResult(void);
+SCM_EXTERN ScmObj Scm_ProfilerRawStacks(void);
+SCM_EXTERN ScmObj Scm_ProfilerRawResultAllThreads(void);
+
+/* Hooks for the process-wide profiler.  Internal. */
+SCM_EXTERN void Scm__ProfilerVMAttached(ScmVM *vm);
+SCM_EXTERN void Scm__ProfilerVMDetached(ScmVM *vm);
+SCM_EXTERN void Scm__ProfilerThreadRequest(ScmVM *vm);
+SCM_EXTERN void Scm__ProfCountAlloc(size_t size);
+
+/* Lock contention profiler.  Lock implementations call the
+   Scm__LockProfiler* hooks while Scm__LockProfiling is TRUE;
+   see prof.c. */
+SCM_EXTERN int  Scm__LockProfiling;
+SCM_EXTERN ScmObj Scm_LockProfilerRawResult(void);
+SCM_EXTERN void Scm__LockProfilerWait(ScmObj lock);
+SCM_EXTERN void Scm__LockProfilerAcquired(ScmObj lock, ScmInt64 wait_start,
+                                          int acquired);
+SCM_EXTERN void Scm__LockProfilerReleased(ScmObj lock);
 
 /* Call Counter API */
 
@@ -92,6 +92,7 @@ SCM_EXTERN ScmObj Scm_ReadListWithContext(ScmObj port, ScmChar closer,
                                           ScmReadContext *ctx);
 SCM_EXTERN ScmObj Scm_ReadFromString(ScmString *string);
 SCM_EXTERN ScmObj Scm_ReadFromCString(const char *string);
+SCM_EXTERN ScmObj Scm_ReadSerialized(ScmPort *port);
 
 SCM_EXTERN void   Scm_ReadError(ScmPort *port, const char *fmt, ...);
 
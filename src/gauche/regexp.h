@@ -48,25 +48,32 @@ struct ScmRegexpRec {
     ScmObj grpNames;     /* list of names for named groups. */
     int numSets;         /* # of charsets in sets */
     int flags;           /* internal; CASE_FOLD, BOL_ANCHORED etc. */
-    ScmString *mustMatch;
+    ScmString *mustMatch; /* A literal every match contains, or NULL. */
+    const unsigned char *mustSkip; /* Shift table to search mustMatch. */
     ScmObj laset;        /* lookahead set (char-set) or #f.
                             If not #f, it represents the condition that can
                             match at the beginning of the regexp.  It can be
                             used to skip input start position when regexp
                             isn't BOL_ANCHORED. */
+    struct ScmRegDFARec *dfa; /* Lazy DFA to find the match region, or NULL
+                                 if the regexp isn't regular.
+                                 See regexp.c */
 };
 
 struct ScmRegMatchRec {
     SCM_HEADER;
     const char *input;
-    int inputSize;
-    int inputLen;
+    ScmSmallInt inputSize;
+    ScmSmallInt inputLen;
     int numMatches;
     ScmObj grpNames;
+    ScmObj bytes;        /* If the input is taken from a u8vector, the
+                            vector.  Positions are in bytes then, and
+                            substrings are copied.  #f for a string. */
     struct ScmRegMatchSub {
-        int start;
-        int length;
-        int after;
+        ScmSmallInt start;
+        ScmSmallInt length;
+        ScmSmallInt after;
         const char *startp;
         const char *endp;
     } **matches;
@@ -75,6 +82,25 @@ struct ScmRegMatchRec {
 #define SCM_REG_MATCH_SINGLE_BYTE_P(rm) \
     ((rm)->inputSize == (rm)->inputLen)
 
+/* A set of regexps matched together.  The mustMatch literals of the
+   regexps are compiled into an Aho-Corasick automaton, so that one scan
+   of the input tells which regexps can possibly match. */
+struct ScmRegexpSetRec {
+    SCM_HEADER;
+    int numRegexps;
+    ScmRegexp **regexps;
+    int numNodes;        /* # of automaton states.  0 is the root. */
+    int numClasses;      /* # of byte classes.  0 is for the bytes that
+                            don't appear in any literal. */
+    unsigned char byteClass[256];
+    int *delta;          /* transition table, numNodes * numClasses */
+    int *output;         /* index of the regexp whose literal ends at
+                            each state, or -1 */
+    int *outputLink;     /* the next state in the failure chain that has
+                            an output, or -1 */
+    int *sameLiteral;    /* next regexp with the same literal, or -1 */
+};
+
 /* Note: The structure of ScmRegexp is changed on 0.9.1.  Shuold be safe,
    for it should never be statically allocated. */
 
@@ -70,13 +70,30 @@
    and a compound ones that has cord-like structure.
    We'll defer having >2G strings by then.
 */
+/* A string made by appending long strings may have a rope body.
+   Its start field points to a node that holds the two bodies
+   appended, instead of the characters.  Such a body never escapes
+   string.c; SCM_STRING_BODY flattens the string first, replacing its
+   body with a flat one, as a mutation does.  So the code outside of
+   string.c always sees flat bodies.  Use SCM_STRING_BODY_RAW only
+   if you know how to handle ropes. */
 typedef struct ScmStringBodyRec {
     unsigned int flags;
     unsigned int length;
     unsigned int size;
     const char *start;
+    u_long hash;                /* cached default hash value, or 0 if
+                                   not computed yet.  See hash.c. */
+    const unsigned int *index;  /* cached character index of a long
+                                   multibyte string, or NULL.
+                                   See string.c. */
 } ScmStringBody;
 
+/* The hash field of bodies that shouldn't be written, for they may be
+   placed in read-only memory (see SCM_STRING_CONST_INITIALIZER).
+   Neither the hash value nor the index is cached in such bodies. */
+#define SCM_STRING_HASH_NOCACHE  ((u_long)-1)
+
 #if SIZEOF_LONG == 4
 #define SCM_STRING_MAX_SIZE    SCM_SMALL_INT_MAX
 #define SCM_STRING_MAX_LENGTH  SCM_SMALL_INT_MAX
@@ -100,6 +117,8 @@ enum ScmStringFlags {
     SCM_STRING_TERMINATED = (1L<<2),     /* [R] The string content is
                                             NUL-terminated.  This flag is used
                                             internally. */
+    SCM_STRING_ROPE       = (1L<<3),     /* [R] The body is a rope node.
+                                            This flag is used internally. */
     SCM_STRING_COPYING = (1L<<16),       /* [C]   Need to copy the content
                                             given to the constructor. */
 };
@@ -110,8 +129,21 @@ SCM_CLASS_DECL(Scm_StringClass);
 
 #define SCM_STRINGP(obj)        SCM_XTYPEP(obj, SCM_CLASS_STRING)
 #define SCM_STRING(obj)         ((ScmString*)(obj))
-#define SCM_STRING_BODY(obj) \
+#define SCM_STRING_BODY_RAW(obj) \
     ((const ScmStringBody*)(SCM_STRING(obj)->body?SCM_STRING(obj)->body:&SCM_STRING(obj)->initialBody))
+#define SCM_STRING_ROPE_P(obj) \
+    SCM_STRING_BODY_HAS_FLAG(SCM_STRING_BODY_RAW(obj), SCM_STRING_ROPE)
+#define SCM_STRING_BODY(obj) \
+    (SCM_STRING_ROPE_P(obj)                                  \
+     ? Scm__StringFlatten(SCM_STRING(obj))                   \
+     : SCM_STRING_BODY_RAW(obj))
+
+SCM_EXTERN const ScmStringBody *Scm__StringFlatten(ScmString *str);
+SCM_EXTERN void Scm__StringForEachChunk(ScmString *str,
+                                        void (*proc)(const char *chunk,
+                                                     ScmSmallInt size,
+                                                     void *data),
+                                        void *data);
 
 /* Accessor macros for string body */
 #define SCM_STRING_BODY_LENGTH(body)       ((body)->length)
@@ -132,8 +164,9 @@ SCM_CLASS_DECL(Scm_StringClass);
 #define SCM_STRING_IMMUTABLE_P(obj)  \
     SCM_STRING_BODY_IMMUTABLE_P(SCM_STRING_BODY(obj))
 
+/* The size of a rope body is valid, so we don't need to flatten it. */
 #define SCM_STRING_NULL_P(obj) \
-    (SCM_STRING_BODY_SIZE(SCM_STRING_BODY(obj)) == 0)
+    (SCM_STRING_BODY_SIZE(SCM_STRING_BODY_RAW(obj)) == 0)
 
 /* Macros for backward compatibility.  Use of these are deprecated,
    since they are not MT-safe.  Use SCM_STRING_BODY_* macros or
@@ -238,6 +271,8 @@ SCM_EXTERN ScmObj  Scm_StringAppend2(ScmString *x, ScmString *y);
 SCM_EXTERN ScmObj  Scm_StringAppendC(ScmString *x, const char *s,
                                      ScmSmallInt size, ScmSmallInt len);
 SCM_EXTERN ScmObj  Scm_StringAppend(ScmObj strs);
+SCM_EXTERN ScmObj  Scm_StringInterpolateConcat(ScmObj args);
+SCM_EXTERN void    Scm_StringInterpolateWrite(ScmObj args, ScmPort *port);
 SCM_EXTERN ScmObj  Scm_StringJoin(ScmObj strs, ScmString *delim, int grammer);
 
 
@@ -263,6 +298,17 @@ SCM_EXTERN ScmObj  Scm_StringScan(ScmString *s1, ScmString *s2, int retmode);
 SCM_EXTERN ScmObj  Scm_StringScanChar(ScmString *s1, ScmChar ch, int retmode);
 SCM_EXTERN ScmObj  Scm_StringScanRight(ScmString *s1, ScmString *s2, int retmode);
 SCM_EXTERN ScmObj  Scm_StringScanCharRight(ScmString *s1, ScmChar ch, int retmode);
+SCM_EXTERN ScmSmallInt Scm_StringIndexChar(ScmString *str, ScmChar ch,
+                                           int negate,
+                                           ScmSmallInt start,
+                                           ScmSmallInt end);
+SCM_EXTERN ScmSmallInt Scm_StringIndexCharRight(ScmString *str, ScmChar ch,
+                                                int negate,
+                                                ScmSmallInt start,
+                                                ScmSmallInt end);
+SCM_EXTERN ScmObj  Scm_StringPad(ScmString *str, ScmSmallInt len,
+                                 ScmChar pad, int right,
+                                 ScmSmallInt start, ScmSmallInt end);
 
 /* "retmode" argument for string scan */
 enum {
@@ -278,6 +324,7 @@ enum {
  * Miscellaneous
  */
 SCM_EXTERN int     Scm_MBLen(const char *str, const char *stop);
+SCM_EXTERN ScmSmallInt Scm__MBLength(const char *str, ScmSmallInt size);
 
 /* INTERNAL */
 SCM_EXTERN const char *Scm_StringPosition(ScmString *str, ScmSmallInt k); /*DEPRECATED*/
@@ -296,7 +343,8 @@ SCM_EXTERN ScmObj  Scm_MaybeSubstring(ScmString *x, ScmObj start, ScmObj end);
 
 #define SCM_STRING_CONST_INITIALIZER(str, len, siz)             \
     { { SCM_CLASS_STATIC_TAG(Scm_StringClass) }, NULL,          \
-      { SCM_STRING_IMMUTABLE|SCM_STRING_TERMINATED, (len), (siz), (str) } }
+      { SCM_STRING_IMMUTABLE|SCM_STRING_TERMINATED,             \
+        (len), (siz), (str), SCM_STRING_HASH_NOCACHE, NULL } }
 
 #define SCM_DEFINE_STRING_CONST(name, str, len, siz)            \
     ScmString name = SCM_STRING_CONST_INITIALIZER(str, len, siz)
@@ -318,12 +366,14 @@ typedef struct ScmDStringChunkRec {
 typedef struct ScmDStringChainRec {
     struct ScmDStringChainRec *next;
     ScmDStringChunk *chunk;
+    int size;                   /* capacity of the chunk */
 } ScmDStringChain;
 
 struct ScmDStringRec {
     ScmDStringChunk init;       /* initial chunk */
     ScmDStringChain *anchor;    /* chain of extra chunks */
-    ScmDStringChain *tail;      /* current chunk */
+    ScmDStringChain *tail;      /* current chunk.  chunks after tail
+                                   are empty ones kept for reuse. */
     char *current;              /* current ptr */
     char *end;                  /* end of current chunk */
     int lastChunkSize;          /* size of the last chunk */
@@ -331,6 +381,7 @@ struct ScmDStringRec {
 };
 
 SCM_EXTERN void        Scm_DStringInit(ScmDString *dstr);
+SCM_EXTERN void        Scm_DStringReset(ScmDString *dstr);
 SCM_EXTERN int         Scm_DStringSize(ScmDString *dstr);
 SCM_EXTERN ScmObj      Scm_DStringGet(ScmDString *dstr, int flags);
 SCM_EXTERN const char *Scm_DStringGetz(ScmDString *dstr);
@@ -363,6 +414,9 @@ SCM_EXTERN void        Scm_DStringPutc(ScmDString *dstr, ScmChar ch);
     } while (0)
 
 SCM_EXTERN void Scm__DStringRealloc(ScmDString *dstr, int min_incr);
+SCM_EXTERN void Scm__DStringRecycle(ScmDString *dstr);
+SCM_EXTERN void Scm_DStringReserve(ScmDString *dstr, int size);
+SCM_EXTERN ScmObj Scm__DStringTake(ScmDString *dstr, int flags);
 
 /*
  * Utility.  Returns NUL-terminated string (SRC doesn't need to be
@@ -81,6 +81,27 @@ SCM_EXTERN ScmObj Scm_OffsetToInteger(off_t o);
  */
 
 SCM_EXTERN ScmObj Scm_ReadDirectory(ScmString *pathname);
+
+/* Directory stream.  Unlike Scm_ReadDirectory, entries are read one by
+   one, with the file type if the system tells it without stat(). */
+typedef struct ScmSysDirRec {
+    SCM_HEADER;
+    ScmString *path;            /* as given; relative to the parent if any */
+    void *dirp;                 /* DIR*; NULL once closed */
+    ScmObj entries;             /* Windows: entries not read yet */
+    int closed;
+} ScmSysDir;
+
+SCM_CLASS_DECL(Scm_SysDirClass);
+#define SCM_CLASS_SYS_DIR     (&Scm_SysDirClass)
+#define SCM_SYS_DIR(obj)      ((ScmSysDir*)(obj))
+#define SCM_SYS_DIR_P(obj)    (SCM_XTYPEP(obj, SCM_CLASS_SYS_DIR))
+
+SCM_EXTERN ScmObj Scm_OpenDirectory(ScmString *path, ScmSysDir *parent);
+SCM_EXTERN ScmObj Scm_ReadDirectoryEntry(ScmSysDir *dir, ScmObj *type);
+SCM_EXTERN void   Scm_CloseDirectory(ScmSysDir *dir);
+SCM_EXTERN ScmObj Scm_DirectoryStat(ScmSysDir *dir, ScmString *name,
+                                    int follow);
 SCM_EXTERN ScmObj Scm_GetCwd(void);
 
 #define SCM_PATH_ABSOLUTE       (1L<<0)
@@ -112,6 +133,10 @@ SCM_CLASS_DECL(Scm_SysStatClass);
 
 SCM_EXTERN ScmObj Scm_MakeSysStat(void); /* returns empty SysStat */
 
+/* Batched operations; returns vectors of results */
+SCM_EXTERN ScmObj Scm_SysStatBatch(ScmObj paths, int follow, int nthreads);
+SCM_EXTERN ScmObj Scm_ReadFileBatch(ScmObj paths, int nthreads);
+
 /*==============================================================
  * Time
  */
@@ -128,6 +153,9 @@ SCM_EXTERN void Scm_GetTimeOfDay(u_long *sec, u_long *usec);
 SCM_EXTERN long Scm_CurrentMicroseconds();
 SCM_EXTERN int  Scm_ClockGetTimeMonotonic(u_long *sec, u_long *nsec);
 SCM_EXTERN int  Scm_ClockGetResMonotonic(u_long *sec, u_long *nsec);
+SCM_EXTERN ScmInt64 Scm_MonotonicNanoseconds(void);
+SCM_EXTERN ScmSmallInt Scm_CycleCounter(void);
+SCM_EXTERN double Scm_CycleCounterFrequency(void);
 
 /* Gauche also has a <time> object, as specified in SRFI-18, SRFI-19
  * and SRFI-21.  It can be constructed from the basic system interface
@@ -237,8 +265,10 @@ SCM_EXTERN int    Scm_IsSugid(void);
 /* flags for Scm_SysExec */
 enum {
     SCM_EXEC_WITH_FORK = (1L<<0), /* fork() before exec(), i.e. spawn(). */
-    SCM_EXEC_DETACHED = (1L<<1)   /* try to detach from process group.
+    SCM_EXEC_DETACHED = (1L<<1),  /* try to detach from process group.
                                      good for daemoninzing. */
+    SCM_EXEC_NO_SPAWN = (1L<<2)   /* always use fork(), even if posix_spawn()
+                                     can be used. */
 };
 
 SCM_EXTERN ScmObj Scm_SysExec(ScmString *file, ScmObj args,
@@ -278,6 +308,50 @@ typedef struct ScmHeaderRec ScmSysFdset;
 #define SCM_SYS_FDSET_P(obj)    (FALSE)
 #endif /*!HAVE_SELECT*/
 
+/* poller
+ *   A set of file descriptors to wait on, which is kept across waits.
+ *   Unlike select, the cost of a wait doesn't depend on the largest
+ *   descriptor, so it scales to many connections.  It uses epoll or
+ *   kqueue where available, and poll(2) otherwise.
+ */
+#if defined(HAVE_SELECT) && (defined(HAVE_SYS_EPOLL_H) \
+                             || defined(HAVE_SYS_EVENT_H) \
+                             || defined(HAVE_POLL_H))
+#define GAUCHE_HAVE_SYS_POLLER 1
+
+typedef struct ScmSysPollerRec {
+    SCM_HEADER;
+    int epfd;                   /* epoll or kqueue descriptor, or -1 */
+    int flags;                  /* SCM_SYS_POLLER_EDGE */
+    int nfds;                   /* # of registered descriptors */
+    int size;                   /* allocated size of fds */
+    void *fds;                  /* poll: struct pollfd[]
+                                   kqueue: unsigned char[], events
+                                   registered for each fd */
+} ScmSysPoller;
+
+SCM_CLASS_DECL(Scm_SysPollerClass);
+#define SCM_CLASS_SYS_POLLER    (&Scm_SysPollerClass)
+#define SCM_SYS_POLLER(obj)     ((ScmSysPoller*)(obj))
+#define SCM_SYS_POLLER_P(obj)   (SCM_XTYPEP(obj, SCM_CLASS_SYS_POLLER))
+
+enum {
+    SCM_SYS_POLL_READ = (1L<<0),
+    SCM_SYS_POLL_WRITE = (1L<<1),
+    SCM_SYS_POLL_ERROR = (1L<<2)   /* always reported */
+};
+
+/* Flags for Scm_MakeSysPoller */
+enum {
+    SCM_SYS_POLLER_EDGE = (1L<<0)  /* edge-triggered; not with poll(2) */
+};
+
+SCM_EXTERN ScmObj Scm_MakeSysPoller(int flags);
+SCM_EXTERN void   Scm_SysPollerSet(ScmSysPoller *poller, int fd, int events);
+SCM_EXTERN ScmObj Scm_SysPollerWait(ScmSysPoller *poller, ScmObj timeout);
+SCM_EXTERN void   Scm_SysPollerClose(ScmSysPoller *poller);
+#endif /*HAVE_SELECT && (HAVE_SYS_EPOLL_H || HAVE_SYS_EVENT_H || HAVE_POLL_H)*/
+
 /*==============================================================
  * Miscellaneous
  */
@@ -34,7 +34,7 @@
 /* This file is included from gauche.h */
 
 /*
- * Provides ScmTreeCore, a raw red-black tree implementation,
+ * Provides ScmTreeCore, a raw balanced tree implementation,
  * and ScmTreeMap, ScmObj wrapper of ScmTreeCore.
  */
 
@@ -49,13 +49,24 @@ typedef struct ScmTreeCoreRec ScmTreeCore;
 
 typedef int ScmTreeCoreCompareProc(ScmTreeCore*, intptr_t, intptr_t);
 
+/* Implementation of the core.  The red-black tree allocates a node
+   per entry.  The B+-tree keeps keys in wide nodes and entries in
+   linked leaves, which makes search and in-order scan touch fewer
+   cache lines on large trees.  Both return ScmDictEntry* that stays
+   valid until the entry is deleted. */
+typedef enum {
+    SCM_TREE_CORE_RB,
+    SCM_TREE_CORE_BTREE
+} ScmTreeCoreKind;
+
 /* A general tree map for internal use.  This is NOT a Scheme object. */
 
 struct ScmTreeCoreRec {
-    ScmDictEntry *root;
+    ScmDictEntry *root;         /* for B+-tree, points to the root node */
     ScmTreeCoreCompareProc *cmp;
     int   num_entries;
     void  *data;
+    int   kind;                 /* ScmTreeCoreKind */
 };
 
 #define SCM_TREE_CORE_DATA(core)  ((core)->data)
@@ -72,6 +83,11 @@ typedef struct ScmTreeIterRec {
 SCM_EXTERN void Scm_TreeCoreInit(ScmTreeCore *tc,
                                  ScmTreeCoreCompareProc *cmp,
                                  void *data);
+SCM_EXTERN void Scm_TreeCoreInitFull(ScmTreeCore *tc,
+                                     ScmTreeCoreCompareProc *cmp,
+                                     void *data,
+                                     ScmTreeCoreKind kind);
+SCM_EXTERN ScmTreeCoreKind Scm_TreeCoreKind(const ScmTreeCore *tc);
 SCM_EXTERN void Scm_TreeCoreCopy(ScmTreeCore *dst,
                                  const ScmTreeCore *src);
 SCM_EXTERN void Scm_TreeCoreClear(ScmTreeCore *tc);
@@ -103,6 +119,9 @@ SCM_EXTERN ScmDictEntry *Scm_TreeCorePopBound(ScmTreeCore *tc,
 
 SCM_EXTERN int           Scm_TreeCoreNumEntries(ScmTreeCore *tc);
 
+SCM_EXTERN int           Scm_TreeCoreRank(ScmTreeCore *tc, intptr_t key);
+SCM_EXTERN ScmDictEntry *Scm_TreeCoreSelect(ScmTreeCore *tc, int k);
+
 SCM_EXTERN int           Scm_TreeCoreEq(ScmTreeCore *a, ScmTreeCore *b);
 
 /*
@@ -142,6 +161,9 @@ SCM_CLASS_DECL(Scm_TreeMapClass);
 
 SCM_EXTERN ScmObj    Scm_MakeTreeMap(ScmTreeCoreCompareProc *cmp,
                                      void *data);
+SCM_EXTERN ScmObj    Scm_MakeTreeMapFull(ScmTreeCoreCompareProc *cmp,
+                                         void *data,
+                                         ScmTreeCoreKind kind);
 SCM_EXTERN ScmObj    Scm_TreeMapCopy(const ScmTreeMap *src);
 
 SCM_EXTERN ScmObj    Scm_TreeMapRef(ScmTreeMap *tm, ScmObj key,
@@ -34,8 +34,11 @@
 #ifndef GAUCHE_VM_H
 #define GAUCHE_VM_H
 
-/* Size of stack per VM (in words). */
-#define SCM_VM_STACK_SIZE      10000
+/* Size of stack per VM (in words).  A VM starts with a stack of
+   SCM_VM_INITIAL_STACK_SIZE words, which grows on overflow up to
+   SCM_VM_STACK_SIZE words.  The same goes to the flonum stack. */
+#define SCM_VM_STACK_SIZE         10000
+#define SCM_VM_INITIAL_STACK_SIZE 1000
 
 /* Maximum # of values allowed for multiple value return */
 #define SCM_VM_MAX_VALUES      20
@@ -370,11 +373,11 @@ SCM_EXTERN ScmObj Scm_VMFinalizerRun(ScmVM *vm);
 /*
  * Statistics
  *
- *  Not much stats are collected yet, but will grow in future.
  *  Stats collections are only active if SCM_COLLECT_VM_STATS
- *  runtime flag is TRUE.
- *  Stats are collected per-VM (i.e. per-thread), but currently
- *  we don't have an API to gather them.
+ *  runtime flag is TRUE.  The flag can be toggled at runtime
+ *  with Scm_VMCollectStats, and the stats can be retrieved with
+ *  Scm_VMStats (vm-collect-stats! and vm-stats in Scheme).
+ *  Stats are collected per-VM (i.e. per-thread).
  */
 
 typedef struct ScmVMStatRec {
@@ -384,6 +387,19 @@ typedef struct ScmVMStatRec {
 
     /* Load statistics chain */
     ScmObj     loadStat;
+    ScmInt64   loadReadTime;    /* cumulated time (ns) of reading and */
+    ScmInt64   loadCompileTime; /* compiling, while SCM_COLLECT_LOAD_STATS */
+    ScmInt64   loadCompileStart;/* >0 while timing a compile, -1 while it
+                                   is suspended by a nested load. */
+    ScmObj     loadStatOpen;    /* stack of start events of ongoing loads */
+
+    /* Event counters */
+    u_long     callCount;     /* # of procedure calls */
+    u_long     contCount;     /* # of continuation captures */
+    u_long     fpFlushCount;  /* # of flonum register flushes */
+    u_long    *insnCounts;    /* # of executed instructions, indexed by
+                                 the instruction code.  Allocated when
+                                 the stats collection is turned on. */
 } ScmVMStat;
 
 /* The profiler structure is defined in prof.h */
@@ -533,12 +549,33 @@ struct ScmVMRec {
                                    Can be recycled, so don't use this to
                                    identify thread programtically.
                                    Set by vm_register. */
+
+    struct ScmDStringChainRec *dstringPool;
+                                /* Spare DString chunks, recycled by
+                                   with-output-to-string.  Only touched
+                                   by the thread running this VM.
+                                   See string.c */
+    int dstringPoolCount;
+
+    ScmObj affinity;            /* CPU numbers this VM's thread is to be
+                                   pinned on when it starts, or #f to
+                                   inherit the creator's.  Set by
+                                   thread-set-affinity! in ext/threads. */
+
+    ScmAllocArena *allocArena;  /* Innermost allocation arena, or NULL.
+                                   Only touched by the thread running
+                                   this VM.  See core.c */
 };
 
 SCM_EXTERN ScmVM *Scm_NewVM(ScmVM *proto, ScmObj name);
 SCM_EXTERN int    Scm_AttachVM(ScmVM *vm);
 SCM_EXTERN void   Scm_DetachVM(ScmVM *vm);
+SCM_EXTERN int    Scm_VMRecycle(ScmVM *vm);
+SCM_EXTERN ScmObj Scm__VMAllVMs(void); /* internal */
 SCM_EXTERN void   Scm_VMDump(ScmVM *vm);
+SCM_EXTERN void   Scm_VMCollectStats(ScmVM *vm, int flag);
+SCM_EXTERN ScmObj Scm_VMStats(ScmVM *vm);
+SCM_EXTERN void   Scm_VMResetStats(ScmVM *vm);
 SCM_EXTERN void   Scm_VMDefaultExceptionHandler(ScmObj exc);
 /* TRANSIENT: Scm_VMThrowException2 is to keep ABI compatibility.  Will be
    gone in 1.0 */
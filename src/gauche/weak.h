@@ -91,7 +91,9 @@ typedef struct ScmWeakHashTableRec {
     ScmObj      defaultValue;
     ScmHashProc        *hashfn;
     ScmHashCompareProc *cmpfn;
-    u_int       goneEntries;
+    u_int       goneEntries;    /* gone entries seen since the last sweep */
+    u_int       insertions;     /* entries added since the last sweep */
+    ScmWord     gcNo;           /* GC count at the last sweep */
 } ScmWeakHashTable;
 
 typedef struct ScmWeakHashIterRec {
@@ -117,6 +119,7 @@ SCM_EXTERN ScmObj Scm_WeakHashTableRef(ScmWeakHashTable *ht,
 SCM_EXTERN ScmObj Scm_WeakHashTableSet(ScmWeakHashTable *ht,
                                        ScmObj key, ScmObj value, int flags);
 SCM_EXTERN ScmObj Scm_WeakHashTableDelete(ScmWeakHashTable *ht, ScmObj key);
+SCM_EXTERN int    Scm_WeakHashTableSweep(ScmWeakHashTable *ht);
 SCM_EXTERN ScmObj Scm_WeakHashTableKeys(ScmWeakHashTable *ht);
 SCM_EXTERN ScmObj Scm_WeakHashTableValues(ScmWeakHashTable *ht);
 
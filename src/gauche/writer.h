@@ -83,6 +83,7 @@ SCM_EXTERN void Scm_WriteWithControls(ScmObj obj, ScmObj port, int mode,
                                       const ScmWriteControls *ctrl);
 SCM_EXTERN int Scm_WriteCircular(ScmObj obj, ScmObj port, int mode, int width);
 SCM_EXTERN int Scm_WriteLimited(ScmObj obj, ScmObj port, int mode, int width);
+SCM_EXTERN void Scm_WriteSerialized(ScmObj obj, ScmPort *port, int shared);
 SCM_EXTERN void Scm_Format(ScmPort *port, ScmString *fmt, ScmObj args, int ss);
 SCM_EXTERN void Scm_Printf(ScmPort *port, const char *fmt, ...);
 SCM_EXTERN void Scm_PrintfShared(ScmPort *port, const char *fmt, ...);
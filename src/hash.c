@@ -54,6 +54,11 @@ typedef struct EntryRec {
 #define DEFAULT_NUM_BUCKETS    4
 #define MAX_AVG_CHAIN_LIMITS   3
 #define EXTEND_BITS            2
+/* Number of old buckets moved to the new bucket array per insertion
+   while the chained core is growing.  Growth by EXTEND_BITS takes
+   3/4 of the new capacity worth of insertions before the next growth,
+   so any value >= 1 finishes the migration in time. */
+#define MIGRATE_STEP           4
 
 /* We limit portable hash value to 32bits */
 #define PORTABLE_HASHMASK  0xffffffffUL
@@ -79,6 +84,7 @@ static u_int round2up(unsigned int val);
 */
 
 static ScmParameterLoc hash_salt; /* initialized by Scm__InitHash() */
+static u_long initial_salt;       /* the salt used for cached string hash */
 
 ScmSmallInt Scm_HashSaltRef()
 {
@@ -218,25 +224,151 @@ u_long Scm_EqvHash(ScmObj obj)
     return hashval&HASHMASK;
 }
 
+/* The default hash value of a string with the initial salt is cached
+   in the string body.  A string body is never modified once created
+   (mutating a string replaces its body), so the cache stays valid.
+   We write the cache without locking, as we do in get_string_from_body
+   in string.c; racing threads just store the same value.
+   Static strings are marked by SCM_STRING_HASH_NOCACHE, and their hash
+   value is computed every time, as is the hash value that happens to
+   collide with 0 or SCM_STRING_HASH_NOCACHE. */
 static u_long internal_string_hash(ScmString *str, u_long salt, int portable)
 {
     const ScmStringBody *b = SCM_STRING_BODY(str);
     if (portable) {
         return (u_long)Scm__DwSipPortableHash((uint8_t*)b->start, b->size,
                                               salt, salt);
+    } else if (salt == initial_salt) {
+        u_long h = b->hash;
+        if (h != 0 && h != SCM_STRING_HASH_NOCACHE) return h;
+        int cacheable = (h == 0);
+        h = Scm__DwSipDefaultHash((uint8_t*)b->start, b->size, salt, salt);
+        if (cacheable) {
+            ((ScmStringBody*)b)->hash = h; /* discard const qualifier */
+        }
+        return h;
     } else {
         return Scm__DwSipDefaultHash((uint8_t*)b->start, b->size,
                                      salt, salt);
     }
 }
 
+/* Fast string hash, for the tables whose keys are trusted.  This isn't
+   resistant to hash flooding, but runs several times faster than SipHash
+   on short keys.  The algorithm follows wyhash (public domain, by
+   Wang Yi): mix 64bit words with a 64x64->128 bit multiplication and
+   fold the product.  The result depends on the byte order of the
+   platform; it is only used for in-memory tables.  The salt is mixed
+   into the seed, so it still varies for each run. */
+static inline uint64_t fast_mum(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a;
+    uint64_t hb = b >> 32, lb = (uint32_t)b;
+    uint64_t rh = ha*hb, rm0 = ha*lb, rm1 = hb*la, rl = la*lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = (t < rl);
+    uint64_t lo = t + (rm1 << 32);
+    c += (lo < t);
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t fast_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t fast_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+#define FAST_S0  0xa0761d6478bd642fULL
+#define FAST_S1  0xe7037ed1a0b428dbULL
+#define FAST_S2  0x8ebc6af09c88c6e3ULL
+#define FAST_S3  0x589965cc75374cc3ULL
+
+static u_long fast_bytes_hash(const uint8_t *p, u_long len, u_long salt)
+{
+    uint64_t seed = (uint64_t)salt ^ FAST_S0;
+    uint64_t a, b;
+
+    if (len <= 16) {
+        if (len >= 4) {
+            u_long q = (len >> 3) << 2;
+            a = (fast_read32(p) << 32) | fast_read32(p + q);
+            b = (fast_read32(p + len - 4) << 32) | fast_read32(p + len - 4 - q);
+        } else if (len > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8)
+                | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        u_long i = len;
+        if (i > 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed  = fast_mum(fast_read64(p)    ^ FAST_S1,
+                                 fast_read64(p+8)  ^ seed);
+                seed1 = fast_mum(fast_read64(p+16) ^ FAST_S2,
+                                 fast_read64(p+24) ^ seed1);
+                seed2 = fast_mum(fast_read64(p+32) ^ FAST_S3,
+                                 fast_read64(p+40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = fast_mum(fast_read64(p) ^ FAST_S1, fast_read64(p+8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        /* The last 16 bytes; may overlap with the bytes already read. */
+        a = fast_read64(p + i - 16);
+        b = fast_read64(p + i - 8);
+    }
+    return (u_long)fast_mum(FAST_S1 ^ len, fast_mum(a ^ FAST_S1, b ^ seed));
+}
+
+static u_long fast_string_hash(ScmString *str)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    return fast_bytes_hash((const uint8_t*)b->start, b->size,
+                           Scm_HashSaltRef()) & HASHMASK;
+}
+
 /* equal-hash, which satisfies
      forall x, y: equal(x,y) => hash(x) = hash(y)
   
    Both default-hash and portable-hash have this property but their
    requirements are slightly different, so here's the common part.
+
+   Aggregates (pairs and vectors) are traversed iteratively with an
+   explicit stack, so deeply nested keys don't overflow the C stack.
+   For default-hash, we only look at the first EQUAL_HASH_LIMIT nodes;
+   it bounds the time to hash a huge key and makes circular structures
+   hashable.  Since the traversal order is determined by the structure,
+   equal objects still get the same hash value.  Portable-hash has to
+   keep its values across versions, so it traverses the entire structure
+   as it always did.
 */
-static u_long equal_hash_common(ScmObj obj, u_long salt, int portable)
+
+#define EQUAL_HASH_LIMIT       8192
+#define EQUAL_HASH_STACK_INIT  32
+
+static u_long equal_hash_atom(ScmObj obj, u_long salt, int portable)
 {
     if (SCM_NUMBERP(obj)) {
         return number_hash(obj, salt, portable);
@@ -246,23 +378,6 @@ static u_long equal_hash_common(ScmObj obj, u_long salt, int portable)
         return hashval&PORTABLE_HASHMASK;
     } else if (SCM_STRINGP(obj)) {
         return internal_string_hash(SCM_STRING(obj), salt, portable);
-    } else if (SCM_PAIRP(obj)) {
-        u_long h = 0, h2;
-        ScmObj cp;
-        SCM_FOR_EACH(cp, obj) {
-            h2 = equal_hash_common(SCM_CAR(cp), salt, portable);
-            h = COMBINE(h, h2);
-        }
-        h2 = equal_hash_common(cp, salt, portable);
-        return COMBINE(h, h2);
-    } else if (SCM_VECTORP(obj)) {
-        int siz = SCM_VECTOR_SIZE(obj);
-        u_long h = 0, h2;
-        for (int i=0; i<siz; i++) {
-            h2 = equal_hash_common(SCM_VECTOR_ELEMENT(obj, i), salt, portable);
-            h = COMBINE(h, h2);
-        }
-        return h;
     } else if (SCM_SYMBOLP(obj)) {
         if (portable) {
             return internal_string_hash(SCM_SYMBOL_NAME(obj), salt, TRUE);
@@ -311,6 +426,83 @@ static u_long equal_hash_common(ScmObj obj, u_long salt, int portable)
     }
 }
 
+/* A frame of the traversal.  For a list, OBJ is the rest of the list
+   and I is -1; once we've hashed its tail, I becomes -2.  For a vector,
+   OBJ is the vector and I is the index of the next element.  H is the
+   hash value accumulated so far. */
+typedef struct equal_hash_frame_rec {
+    ScmObj obj;
+    ScmSmallInt i;
+    u_long h;
+} equal_hash_frame;
+
+static u_long equal_hash_common(ScmObj obj, u_long salt, int portable)
+{
+    if (!SCM_PAIRP(obj) && !SCM_VECTORP(obj)) {
+        return equal_hash_atom(obj, salt, portable);
+    }
+
+    equal_hash_frame stack0[EQUAL_HASH_STACK_INIT];
+    equal_hash_frame *stack = stack0;
+    ScmSmallInt stack_size = EQUAL_HASH_STACK_INIT, sp = 0;
+    long budget = portable? -1 : EQUAL_HASH_LIMIT;
+
+#define PUSH(o)                                                         \
+    do {                                                                \
+        if (sp == stack_size) {                                         \
+            equal_hash_frame *s_ =                                      \
+                SCM_NEW_ARRAY(equal_hash_frame, stack_size*2);          \
+            memcpy(s_, stack, sizeof(equal_hash_frame)*stack_size);     \
+            stack = s_;                                                 \
+            stack_size *= 2;                                            \
+        }                                                               \
+        stack[sp].obj = (o);                                            \
+        stack[sp].i = SCM_VECTORP(o)? 0 : -1;                           \
+        stack[sp].h = 0;                                                \
+        sp++;                                                           \
+    } while (0)
+
+    PUSH(obj);
+    for (;;) {
+        equal_hash_frame *f = &stack[sp-1];
+        ScmObj child;
+        int done = FALSE;
+
+        if (budget == 0) {
+            done = TRUE;        /* we've seen enough */
+        } else if (f->i == -2) {
+            done = TRUE;
+        } else if (f->i >= 0) {
+            if (f->i >= SCM_VECTOR_SIZE(f->obj)) {
+                done = TRUE;
+            } else {
+                child = SCM_VECTOR_ELEMENT(f->obj, f->i);
+                f->i++;
+            }
+        } else if (SCM_PAIRP(f->obj)) {
+            child = SCM_CAR(f->obj);
+            f->obj = SCM_CDR(f->obj);
+        } else {
+            child = f->obj;     /* the tail of the list */
+            f->i = -2;
+        }
+
+        if (done) {
+            u_long h = f->h;
+            if (--sp == 0) return h;
+            stack[sp-1].h = COMBINE(stack[sp-1].h, h);
+            continue;
+        }
+        if (budget > 0) budget--;
+        if (SCM_PAIRP(child) || SCM_VECTORP(child)) {
+            PUSH(child);
+        } else {
+            f->h = COMBINE(f->h, equal_hash_atom(child, salt, portable));
+        }
+    }
+#undef PUSH
+}
+
 /* For recursive call to the current hash function - see call-object-hash
    and object-hash definitions in libomega.scm. */
 static ScmParameterLoc current_recursive_hash;
@@ -391,16 +583,106 @@ u_long Scm_CombineHashValue(u_long a, u_long b)
  * throw Scheme error.  Be aware of that.
  */
 
+/*
+ * Growing the chained core
+ *
+ * Rehashing all the entries at once makes the insertion that crosses
+ * the threshold take time proportional to the table size.  Instead,
+ * we allocate the new bucket array and keep the old one in oldBuckets,
+ * then move MIGRATE_STEP old buckets per insertion.  An entry whose
+ * old bucket index is at or above migrateIndex is still in the old
+ * array, and anything else is in the new one; chained_locate() tells
+ * which chain a hash value belongs to.  Entries themselves never move,
+ * so the pointers returned by Scm_HashCoreSearch stay valid.
+ */
+static inline Entry **chained_locate(ScmHashCore *table, u_long hashval,
+                                     u_long *index)
+{
+    if (table->oldBuckets) {
+        u_long i = HASH2INDEX(table->numOldBuckets, table->numOldBucketsLog2,
+                              hashval);
+        if (i >= (u_long)table->migrateIndex) {
+            *index = i;
+            return (Entry**)table->oldBuckets;
+        }
+    }
+    *index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
+    return BUCKETS(table);
+}
+
+/* Move up to COUNT old buckets to the new array.  Negative COUNT
+   finishes the migration. */
+static void chained_migrate(ScmHashCore *table, int count)
+{
+    Entry **oldb = (Entry**)table->oldBuckets;
+    Entry **newb = BUCKETS(table);
+    if (oldb == NULL) return;
+
+    while (table->migrateIndex < table->numOldBuckets && count-- != 0) {
+        Entry *e = oldb[table->migrateIndex];
+        while (e) {
+            Entry *next = e->next;
+            u_long index = HASH2INDEX(table->numBuckets,
+                                      table->numBucketsLog2, e->hashval);
+            e->next = newb[index];
+            newb[index] = e;
+            e = next;
+        }
+        oldb[table->migrateIndex] = NULL; /* gc friendliness */
+        table->migrateIndex++;
+    }
+    if (table->migrateIndex >= table->numOldBuckets) {
+        table->oldBuckets = NULL;
+        table->numOldBuckets = table->numOldBucketsLog2 = 0;
+        table->migrateIndex = 0;
+    }
+}
+
+/* Replace the bucket array with a larger one of NEWSIZE (power of 2).
+   The old entries are left to chained_migrate. */
+static void chained_grow(ScmHashCore *table, int newsize)
+{
+    int newbits = 0;
+    for (int i = newsize; i > 1; i /= 2) newbits++;
+
+    chained_migrate(table, -1);
+    Entry **newb = SCM_NEW_ARRAY(Entry*, newsize);
+    for (int i=0; i<newsize; i++) newb[i] = NULL;
+
+    table->oldBuckets = table->buckets;
+    table->numOldBuckets = table->numBuckets;
+    table->numOldBucketsLog2 = table->numBucketsLog2;
+    table->migrateIndex = 0;
+    table->buckets = (void**)newb;
+    table->numBuckets = newsize;
+    table->numBucketsLog2 = newbits;
+}
+
+/* Iteration runs over the new buckets, then the remaining old ones.
+   I is the combined index. */
+static inline int chained_num_chains(const ScmHashCore *table)
+{
+    return table->numBuckets + (table->oldBuckets? table->numOldBuckets : 0);
+}
+
+static inline Entry *chained_chain(const ScmHashCore *table, int i)
+{
+    if (i < table->numBuckets) return (Entry*)table->buckets[i];
+    return (Entry*)table->oldBuckets[i - table->numBuckets];
+}
+
 /*
  * Common function called when the accessor function needs to add an entry.
+ * We locate the chain again, since a general cmpfn may have modified
+ * the table during the search.
  */
 static Entry *insert_entry(ScmHashCore *table,
                            intptr_t key,
-                           u_long   hashval,
-                           int index)
+                           u_long   hashval)
 {
+    u_long index;
+    Entry **buckets = chained_locate(table, hashval, &index);
     Entry *e = SCM_NEW(Entry);
-    Entry **buckets = BUCKETS(table);
     e->key = key;
     e->value = 0;
     e->next = buckets[index];
@@ -408,28 +690,10 @@ static Entry *insert_entry(ScmHashCore *table,
     buckets[index] = e;
     table->numEntries++;
 
-    if (table->numEntries > table->numBuckets*MAX_AVG_CHAIN_LIMITS) {
-        /* Extend the table */
-        int newsize = (table->numBuckets << EXTEND_BITS);
-        int newbits = table->numBucketsLog2 + EXTEND_BITS;
-
-        Entry **newb = SCM_NEW_ARRAY(Entry*, newsize);
-        for (int i=0; i<newsize; i++) newb[i] = NULL;
-
-        ScmHashIter iter;
-        Entry *f;
-        Scm_HashIterInit(&iter, table);
-        while ((f = (Entry*)Scm_HashIterNext(&iter)) != NULL) {
-            index = HASH2INDEX(newsize, newbits, f->hashval);
-            f->next = newb[index];
-            newb[index] = f;
-        }
-        /* gc friendliness */
-        for (int i=0; i<table->numBuckets; i++) table->buckets[i] = NULL;
-
-        table->numBuckets = newsize;
-        table->numBucketsLog2 = newbits;
-        table->buckets = (void**)newb;
+    if (table->oldBuckets) {
+        chained_migrate(table, MIGRATE_STEP);
+    } else if (table->numEntries > table->numBuckets*MAX_AVG_CHAIN_LIMITS) {
+        chained_grow(table, table->numBuckets << EXTEND_BITS);
     }
     return e;
 }
@@ -441,31 +705,31 @@ static Entry *insert_entry(ScmHashCore *table,
    are running on the same hash table. */
 static Entry *delete_entry(ScmHashCore *table,
                            Entry *entry, Entry *prev,
-                           int index)
+                           Entry **buckets, int index)
 {
     if (prev) prev->next = entry->next;
-    else table->buckets[index] = (void*)entry->next;
+    else buckets[index] = entry->next;
     table->numEntries--;
     SCM_ASSERT(table->numEntries >= 0);
     entry->next = NULL;         /* GC friendliness */
     return entry;
 }
 
-#define FOUND(table, op, e, p, index)                   \
-    do {                                                \
-        switch (op) {                                   \
-        case SCM_DICT_GET:;                             \
-        case SCM_DICT_CREATE:;                          \
-            return e;                                   \
-        case SCM_DICT_DELETE:;                          \
-            return delete_entry(table, e, p, index);    \
-        }                                               \
+#define FOUND(table, op, e, p, buckets, index)                  \
+    do {                                                        \
+        switch (op) {                                           \
+        case SCM_DICT_GET:;                                     \
+        case SCM_DICT_CREATE:;                                  \
+            return e;                                           \
+        case SCM_DICT_DELETE:;                                  \
+            return delete_entry(table, e, p, buckets, index);   \
+        }                                                       \
     } while (0)
 
-#define NOTFOUND(table, op, key, hashval, index)                \
+#define NOTFOUND(table, op, key, hashval)                       \
     do {                                                        \
         if (op == SCM_DICT_CREATE) {                            \
-           return insert_entry(table, key, hashval, index);     \
+           return insert_entry(table, key, hashval);            \
         } else {                                                \
            return NULL;                                         \
         }                                                       \
@@ -479,15 +743,14 @@ static Entry *address_access(ScmHashCore *table,
                              ScmDictOp op)
 {
     u_long hashval, index;
-    Entry **buckets = (Entry**)table->buckets;
 
     ADDRESS_HASH(hashval, key);
-    index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
+    Entry **buckets = chained_locate(table, hashval, &index);
 
     for (Entry *e = buckets[index], *p = NULL; e; p = e, e = e->next) {
-        if (e->key == key) FOUND(table, op, e, p, index);
+        if (e->key == key) FOUND(table, op, e, p, buckets, index);
     }
-    NOTFOUND(table, op, key, hashval, index);
+    NOTFOUND(table, op, key, hashval);
 }
 
 static u_long address_hash(const ScmHashCore *ht, intptr_t obj)
@@ -538,8 +801,8 @@ static Entry *string_access(ScmHashCore *table, intptr_t k, ScmDictOp op)
         Scm_Error("Got non-string key %S to the string hashtable.", key);
     }
     u_long hashval = Scm_HashString(SCM_STRING(key), 0);
-    u_long index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
-    Entry **buckets = (Entry**)table->buckets;
+    u_long index;
+    Entry **buckets = chained_locate(table, hashval, &index);
 
     const ScmStringBody *keyb = SCM_STRING_BODY(key);
     long size = SCM_STRING_BODY_SIZE(keyb);
@@ -550,10 +813,10 @@ static Entry *string_access(ScmHashCore *table, intptr_t k, ScmDictOp op)
         if (size == eesize
             && memcmp(SCM_STRING_BODY_START(keyb),
                       SCM_STRING_BODY_START(eeb), eesize) == 0){
-            FOUND(table, op, e, p, index);
+            FOUND(table, op, e, p, buckets, index);
         }
     }
-    NOTFOUND(table, op, k, hashval, index);
+    NOTFOUND(table, op, k, hashval);
 }
 
 static u_long string_hash(const ScmHashCore *table, intptr_t key)
@@ -561,6 +824,26 @@ static u_long string_hash(const ScmHashCore *table, intptr_t key)
     return Scm_HashString(SCM_STRING(key), 0);
 }
 
+/* For string table with SCM_HASH_CORE_FAST_HASH.  This is called via
+   general_access, so we check the key type. */
+static u_long string_fast_hash(const ScmHashCore *table, intptr_t key)
+{
+    if (!SCM_STRINGP(key)) {
+        Scm_Error("Got non-string key %S to the string hashtable.",
+                  SCM_OBJ(key));
+    }
+    return fast_string_hash(SCM_STRING(key));
+}
+
+/* For equal table with SCM_HASH_CORE_FAST_HASH.  A string can only be
+   equal? to a string, so it's ok to use a different hash function
+   for them. */
+static u_long equal_fast_hash(const ScmHashCore *table, intptr_t key)
+{
+    if (SCM_STRINGP(key)) return fast_string_hash(SCM_STRING(key));
+    return Scm_DefaultHash(SCM_OBJ(key));
+}
+
 static int string_cmp(const ScmHashCore *table, intptr_t k1, intptr_t k2)
 {
     const ScmStringBody *b1 = SCM_STRING_BODY(k1);
@@ -596,14 +879,13 @@ static Entry *multiword_access(ScmHashCore *table, intptr_t k, ScmDictOp op)
     ScmWord keysize = (ScmWord)table->data;
 
     hashval = multiword_hash(table, k);
-    index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
-    Entry **buckets = (Entry**)table->buckets;
+    Entry **buckets = chained_locate(table, hashval, &index);
 
     for (Entry *e = buckets[index], *p = NULL; e; p = e, e = e->next) {
         if (memcmp((void*)k, (void*)e->key, keysize*sizeof(ScmWord)) == 0)
-            FOUND(table, op, e, p, index);
+            FOUND(table, op, e, p, buckets, index);
     }
-    NOTFOUND(table, op, k, hashval, index);
+    NOTFOUND(table, op, k, hashval);
 }
 #endif
 
@@ -617,13 +899,326 @@ static Entry *general_access(ScmHashCore *table, intptr_t key, ScmDictOp op)
     u_long hashval, index;
 
     hashval = table->hashfn(table, key);
-    index = HASH2INDEX(table->numBuckets, table->numBucketsLog2, hashval);
-    Entry **buckets = (Entry**)table->buckets;
+    Entry **buckets = chained_locate(table, hashval, &index);
 
     for (Entry *e = buckets[index], *p = NULL; e; p = e, e = e->next) {
-        if (table->cmpfn(table, key, e->key)) FOUND(table, op, e, p, index);
+        if (table->cmpfn(table, key, e->key))
+            FOUND(table, op, e, p, buckets, index);
     }
-    NOTFOUND(table, op, key, hashval, index);
+    NOTFOUND(table, op, key, hashval);
+}
+
+/*============================================================
+ * Open addressing core
+ */
+
+/* The open addressing core keeps an array of entry pointers along with
+ * an array of control bytes, one for each slot.  A control byte is
+ * either EMPTY, DELETED (tombstone), or the lower 7 bits of the hash
+ * value of the slot's key.  A lookup scans the control bytes by groups
+ * of 8, comparing all of them at once as a 64bit word (so called SWAR),
+ * and only touches the entries whose bytes match.  Unlike the chained
+ * core, a miss typically costs one cache line of control bytes.
+ *
+ * We still allocate an entry node for each key, and the slot array
+ * holds pointers to them.  The callers of Scm_HashCoreSearch may keep
+ * the returned entry while running Scheme code that modifies the table
+ * (e.g. hash-table-update!), so entries must not move on rehash.
+ *
+ * The slot array is placed in buckets, and its size in numBuckets.
+ * The core is open-addressing iff its accessfn is one of open_*_access.
+ */
+
+typedef struct OpenTableRec {
+    u_char *ctrl;               /* numBuckets control bytes (atomic) */
+    int numTombstones;
+    Entry *slots[1];            /* numBuckets entries */
+} OpenTable;
+
+#define OPEN_TABLE(hc)      ((OpenTable*)(hc)->buckets)
+
+#define OPEN_GROUP_WIDTH    8
+#define OPEN_MIN_SLOTS      8
+#define CTRL_EMPTY          0x80
+#define CTRL_DELETED        0xfe
+#define CTRL_FULLP(c)       (((c)&0x80) == 0)
+
+/* The table is rehashed when used slots (entries + tombstones)
+   exceed 7/8 of the slots. */
+#define OPEN_MAX_USED(nslots)  ((nslots) - (nslots)/8)
+
+#define GROUP_LSBS  0x0101010101010101ULL
+#define GROUP_MSBS  0x8080808080808080ULL
+
+/* Assemble the group in the little endian order regardless of the
+   platform, so that the lowest set bit of a match tells the first
+   matching byte.  Compilers turn this into a single load on LE. */
+static inline uint64_t group_load(const u_char *p)
+{
+    return ((uint64_t)p[0])     | ((uint64_t)p[1]<<8)
+        |  ((uint64_t)p[2]<<16) | ((uint64_t)p[3]<<24)
+        |  ((uint64_t)p[4]<<32) | ((uint64_t)p[5]<<40)
+        |  ((uint64_t)p[6]<<48) | ((uint64_t)p[7]<<56);
+}
+
+/* Bytes equal to H2.  May have false positives (a byte of H2^1 right
+   after a real match), which is harmless since we compare keys. */
+static inline uint64_t group_match(uint64_t g, u_int h2)
+{
+    uint64_t x = g ^ (GROUP_LSBS * h2);
+    return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+/* EMPTY bytes.  EMPTY and DELETED both have the MSB, but only DELETED
+   has bit 1. */
+static inline uint64_t group_match_empty(uint64_t g)
+{
+    return g & (~g << 6) & GROUP_MSBS;
+}
+
+/* EMPTY or DELETED bytes. */
+static inline uint64_t group_match_free(uint64_t g)
+{
+    return g & GROUP_MSBS;
+}
+
+static inline int group_first(uint64_t m)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(m) >> 3;
+#else
+    int n = 0;
+    while (!(m & 0x80)) { m >>= 8; n++; }
+    return n;
+#endif
+}
+
+/* Address hash leaves poor lower bits, so we mix the hash value before
+   splitting it into the control byte and the group index. */
+static inline u_long open_mix(u_long hashval)
+{
+    uint32_t h = (uint32_t)hashval;
+#if SIZEOF_LONG > 4
+    h ^= (uint32_t)(hashval >> 32);
+#endif
+    h ^= h >> 16;
+    h *= 0x45d9f3bU;
+    h ^= h >> 16;
+    return (u_long)h;
+}
+
+#define OPEN_H2(h)                 ((h) & 0x7f)
+#define OPEN_GROUP(h, ngroups)     (((h) >> 7) & ((ngroups) - 1))
+
+enum {
+    OPEN_EQ,                    /* compare keys with == */
+    OPEN_STRING,                /* compare string bodies */
+    OPEN_GENERAL                /* use cmpfn */
+};
+
+static OpenTable *open_table_alloc(int nslots)
+{
+    OpenTable *ot = SCM_NEW2(OpenTable*,
+                             sizeof(OpenTable) + (nslots-1)*sizeof(Entry*));
+    ot->ctrl = SCM_NEW_ATOMIC2(u_char*, nslots);
+    memset(ot->ctrl, CTRL_EMPTY, nslots);
+    ot->numTombstones = 0;
+    for (int i=0; i<nslots; i++) ot->slots[i] = NULL;
+    return ot;
+}
+
+/* Returns the first free slot in the probe sequence of H. */
+static int open_find_free(OpenTable *ot, int nslots, u_long h)
+{
+    u_long ngroups = nslots/OPEN_GROUP_WIDTH;
+    u_long g = OPEN_GROUP(h, ngroups);
+    for (u_long i = 1;; i++) {
+        const u_char *c = ot->ctrl + g*OPEN_GROUP_WIDTH;
+        uint64_t m = group_match_free(group_load(c));
+        if (m) return (int)(g*OPEN_GROUP_WIDTH) + group_first(m);
+        g = (g + i) & (ngroups - 1); /* triangular probing visits all groups */
+    }
+}
+
+static void open_set_table(ScmHashCore *table, OpenTable *ot, int nslots)
+{
+    table->buckets = (void**)ot;
+    table->numBuckets = nslots;
+    table->numBucketsLog2 = 0;
+    for (int i = nslots; i > 1; i /= 2) table->numBucketsLog2++;
+}
+
+/* Move all the entries to a new table of NEWSLOTS slots. */
+static void open_resize(ScmHashCore *table, int newslots)
+{
+    OpenTable *ot = OPEN_TABLE(table);
+    int nslots = table->numBuckets;
+    OpenTable *nt = open_table_alloc(newslots);
+
+    for (int i=0; i<nslots; i++) {
+        if (CTRL_FULLP(ot->ctrl[i])) {
+            Entry *e = ot->slots[i];
+            u_long h = open_mix(e->hashval);
+            int pos = open_find_free(nt, newslots, h);
+            nt->ctrl[pos] = (u_char)OPEN_H2(h);
+            nt->slots[pos] = e;
+            ot->slots[i] = NULL; /* gc friendliness */
+        }
+    }
+    open_set_table(table, nt, newslots);
+}
+
+/* Grow the table, or just sweep the tombstones if it is sparse enough. */
+static void open_rehash(ScmHashCore *table)
+{
+    int nslots = table->numBuckets;
+    open_resize(table, (table->numEntries >= nslots/2) ? nslots*2 : nslots);
+}
+
+static Entry *open_insert(ScmHashCore *table, intptr_t key, u_long hashval)
+{
+    if (table->numEntries + OPEN_TABLE(table)->numTombstones + 1
+        > OPEN_MAX_USED(table->numBuckets)) {
+        open_rehash(table);
+    }
+    OpenTable *ot = OPEN_TABLE(table);
+    u_long h = open_mix(hashval);
+    int pos = open_find_free(ot, table->numBuckets, h);
+    Entry *e = SCM_NEW(Entry);
+    e->key = key;
+    e->value = 0;
+    e->next = NULL;
+    e->hashval = hashval;
+    if (ot->ctrl[pos] == CTRL_DELETED) ot->numTombstones--;
+    ot->ctrl[pos] = (u_char)OPEN_H2(h);
+    ot->slots[pos] = e;
+    table->numEntries++;
+    return e;
+}
+
+/* If the group of the slot still has an EMPTY byte, no probe sequence
+   has ever passed beyond this group, so we can make the slot EMPTY
+   instead of leaving a tombstone.
+   The deleted entry keeps its key and value, for the caller may
+   look at them. */
+static Entry *open_delete(ScmHashCore *table, int pos)
+{
+    OpenTable *ot = OPEN_TABLE(table);
+    Entry *e = ot->slots[pos];
+    const u_char *c = ot->ctrl + (pos/OPEN_GROUP_WIDTH)*OPEN_GROUP_WIDTH;
+    if (group_match_empty(group_load(c))) {
+        ot->ctrl[pos] = CTRL_EMPTY;
+    } else {
+        ot->ctrl[pos] = CTRL_DELETED;
+        ot->numTombstones++;
+    }
+    ot->slots[pos] = NULL;
+    table->numEntries--;
+    SCM_ASSERT(table->numEntries >= 0);
+    return e;
+}
+
+static inline int open_key_match(ScmHashCore *table, int kind,
+                                 intptr_t key, u_long hashval, Entry *e)
+{
+    switch (kind) {
+    case OPEN_EQ:
+        return e->key == key;
+    case OPEN_STRING: {
+        if (e->hashval != hashval) return FALSE;
+        const ScmStringBody *kb = SCM_STRING_BODY(key);
+        const ScmStringBody *eb = SCM_STRING_BODY(e->key);
+        return (SCM_STRING_BODY_SIZE(kb) == SCM_STRING_BODY_SIZE(eb)
+                && memcmp(SCM_STRING_BODY_START(kb),
+                          SCM_STRING_BODY_START(eb),
+                          SCM_STRING_BODY_SIZE(eb)) == 0);
+    }
+    default:
+        return (e->hashval == hashval
+                && table->cmpfn(table, key, e->key));
+    }
+}
+
+/* KIND is a constant in each caller, so the key comparison is
+   specialized when this is inlined. */
+static inline Entry *open_access(ScmHashCore *table, intptr_t key,
+                                 u_long hashval, ScmDictOp op, int kind)
+{
+    OpenTable *ot = OPEN_TABLE(table);
+    u_long ngroups = table->numBuckets/OPEN_GROUP_WIDTH;
+    u_long h = open_mix(hashval);
+    u_int h2 = OPEN_H2(h);
+    u_long g = OPEN_GROUP(h, ngroups);
+
+    for (u_long i = 1;; i++) {
+        const u_char *c = ot->ctrl + g*OPEN_GROUP_WIDTH;
+        uint64_t grp = group_load(c);
+        for (uint64_t m = group_match(grp, h2); m; m &= m - 1) {
+            int pos = (int)(g*OPEN_GROUP_WIDTH) + group_first(m);
+            if (!CTRL_FULLP(ot->ctrl[pos])) continue;
+            Entry *e = ot->slots[pos];
+            if (open_key_match(table, kind, key, hashval, e)) {
+                if (op == SCM_DICT_DELETE) return open_delete(table, pos);
+                return e;
+            }
+        }
+        if (group_match_empty(grp)) break;
+        g = (g + i) & (ngroups - 1);
+    }
+    if (op == SCM_DICT_CREATE) return open_insert(table, key, hashval);
+    return NULL;
+}
+
+static Entry *open_address_access(ScmHashCore *table, intptr_t key,
+                                  ScmDictOp op)
+{
+    u_long hashval;
+    ADDRESS_HASH(hashval, key);
+    return open_access(table, key, hashval, op, OPEN_EQ);
+}
+
+static Entry *open_string_access(ScmHashCore *table, intptr_t key,
+                                 ScmDictOp op)
+{
+    if (!SCM_STRINGP(key)) {
+        Scm_Error("Got non-string key %S to the string hashtable.",
+                  SCM_OBJ(key));
+    }
+    u_long hashval = Scm_HashString(SCM_STRING(key), 0);
+    return open_access(table, key, hashval, op, OPEN_STRING);
+}
+
+static Entry *open_fast_string_access(ScmHashCore *table, intptr_t key,
+                                      ScmDictOp op)
+{
+    if (!SCM_STRINGP(key)) {
+        Scm_Error("Got non-string key %S to the string hashtable.",
+                  SCM_OBJ(key));
+    }
+    u_long hashval = fast_string_hash(SCM_STRING(key));
+    return open_access(table, key, hashval, op, OPEN_STRING);
+}
+
+static Entry *open_general_access(ScmHashCore *table, intptr_t key,
+                                  ScmDictOp op)
+{
+    u_long hashval = table->hashfn(table, key);
+    return open_access(table, key, hashval, op, OPEN_GENERAL);
+}
+
+static int open_core_p(const ScmHashCore *table)
+{
+    return (table->accessfn == (void*)open_address_access
+            || table->accessfn == (void*)open_string_access
+            || table->accessfn == (void*)open_fast_string_access
+            || table->accessfn == (void*)open_general_access);
+}
+
+static int fast_hash_core_p(const ScmHashCore *table)
+{
+    return (table->accessfn == (void*)open_fast_string_access
+            || table->hashfn == string_fast_hash
+            || table->hashfn == equal_fast_hash);
 }
 
 /*============================================================
@@ -637,17 +1232,29 @@ static void hash_core_init(ScmHashCore *table,
                            unsigned int initSize,
                            void *data)
 {
+    table->numEntries = 0;
+    table->accessfn = (void*)accessfn;
+    table->hashfn = hashfn;
+    table->cmpfn = cmpfn;
+    table->data = data;
+    table->oldBuckets = NULL;
+    table->numOldBuckets = table->numOldBucketsLog2 = 0;
+    table->migrateIndex = 0;
+
+    if (open_core_p(table)) {
+        /* INITSIZE is the number of entries expected. */
+        unsigned int nslots = OPEN_MIN_SLOTS;
+        while (OPEN_MAX_USED(nslots) < initSize) nslots <<= 1;
+        open_set_table(table, open_table_alloc(nslots), nslots);
+        return;
+    }
+
     if (initSize != 0) initSize = round2up(initSize);
     else initSize = DEFAULT_NUM_BUCKETS;
 
     Entry **b = SCM_NEW_ARRAY(Entry*, initSize);
     table->buckets = (void**)b;
     table->numBuckets = initSize;
-    table->numEntries = 0;
-    table->accessfn = (void*)accessfn;
-    table->hashfn = hashfn;
-    table->cmpfn = cmpfn;
-    table->data = data;
     table->numBucketsLog2 = 0;
     for (u_int i=initSize; i > 1; i /= 2) {
         table->numBucketsLog2++;
@@ -688,19 +1295,69 @@ int  hash_core_predef_procs(ScmHashType type,
     }
 }
 
+/* Replace the chained accessor with the open addressing one. */
+static SearchProc *open_accessor(SearchProc *accessfn)
+{
+    if (accessfn == address_access) return open_address_access;
+    if (accessfn == string_access)  return open_string_access;
+    return open_general_access;
+}
+
+void Scm_HashCoreInitFull(ScmHashCore *core,
+                          ScmHashType type,
+                          ScmHashProc *hashfn,
+                          ScmHashCompareProc *cmpfn,
+                          unsigned int initSize,
+                          void *data,
+                          int flags)
+{
+    SearchProc  *accessfn = general_access;
+    int kind = flags & SCM_HASH_CORE_KIND_MASK;
+
+    if (type == SCM_HASH_GENERAL) {
+        if (hashfn == NULL || cmpfn == NULL) {
+            Scm_Error("[internal error]: Scm_HashCoreInitFull: general hash core requires hash and compare functions");
+        }
+    } else if (hash_core_predef_procs(type, &accessfn, &hashfn, &cmpfn) == FALSE) {
+        Scm_Error("[internal error]: wrong TYPE argument passed to Scm_HashCoreInitFull: %d", type);
+    }
+    if (kind == SCM_HASH_CORE_DEFAULT) {
+        switch (type) {
+        case SCM_HASH_EQ:
+        case SCM_HASH_EQV:
+        case SCM_HASH_STRING:
+        case SCM_HASH_WORD:
+            kind = SCM_HASH_CORE_OPEN; break;
+        default:
+            kind = SCM_HASH_CORE_CHAINED; break;
+        }
+    }
+    if (flags & SCM_HASH_CORE_FAST_HASH) {
+        /* Other types don't use SipHash. */
+        if (type == SCM_HASH_STRING) {
+            accessfn = general_access;
+            hashfn = string_fast_hash;
+        } else if (type == SCM_HASH_EQUAL) {
+            hashfn = equal_fast_hash;
+        }
+    }
+    if (kind == SCM_HASH_CORE_OPEN) {
+        if (hashfn == string_fast_hash) accessfn = open_fast_string_access;
+        else accessfn = open_accessor(accessfn);
+    }
+    hash_core_init(core, accessfn, hashfn, cmpfn, initSize, data);
+}
+
 void Scm_HashCoreInitSimple(ScmHashCore *core,
                             ScmHashType type,
                             unsigned int initSize,
                             void *data)
 {
-    SearchProc  *accessfn;
-    ScmHashProc *hashfn;
-    ScmHashCompareProc *cmpfn;
-
-    if (hash_core_predef_procs(type, &accessfn, &hashfn, &cmpfn) == FALSE) {
+    if (type == SCM_HASH_GENERAL) {
         Scm_Error("[internal error]: wrong TYPE argument passed to Scm_HashCoreInitSimple: %d", type);
     }
-    hash_core_init(core, accessfn, hashfn, cmpfn, initSize, data);
+    Scm_HashCoreInitFull(core, type, NULL, NULL, initSize, data,
+                         SCM_HASH_CORE_DEFAULT);
 }
 
 void Scm_HashCoreInitGeneral(ScmHashCore *core,
@@ -713,6 +1370,11 @@ void Scm_HashCoreInitGeneral(ScmHashCore *core,
                    cmpfn, initSize, data);
 }
 
+ScmHashCoreKind Scm_HashCoreKind(const ScmHashCore *core)
+{
+    return open_core_p(core)? SCM_HASH_CORE_OPEN : SCM_HASH_CORE_CHAINED;
+}
+
 int Scm_HashCoreTypeToProcs(ScmHashType type,
                             ScmHashProc **hashfn,
                             ScmHashCompareProc **cmpfn)
@@ -721,8 +1383,48 @@ int Scm_HashCoreTypeToProcs(ScmHashType type,
     return hash_core_predef_procs(type, &accessfn, hashfn, cmpfn);
 }
 
+static void open_core_copy(ScmHashCore *dst, const ScmHashCore *src)
+{
+    OpenTable *so = OPEN_TABLE(src);
+    OpenTable *dt = open_table_alloc(src->numBuckets);
+
+    for (int i=0; i<src->numBuckets; i++) {
+        if (CTRL_FULLP(so->ctrl[i])) {
+            Entry *s = so->slots[i];
+            Entry *e = SCM_NEW(Entry);
+            e->key = s->key;
+            e->value = s->value;
+            e->next = NULL;
+            e->hashval = s->hashval;
+            dt->slots[i] = e;
+        }
+    }
+    memcpy(dt->ctrl, so->ctrl, src->numBuckets);
+    dt->numTombstones = so->numTombstones;
+
+    /* A little trick to avoid hazard in careless race condition */
+    dst->numBuckets = dst->numEntries = 0;
+
+    dst->buckets = (void**)dt;
+    dst->hashfn   = src->hashfn;
+    dst->cmpfn    = src->cmpfn;
+    dst->accessfn = src->accessfn;
+    dst->data     = src->data;
+    dst->oldBuckets = NULL;
+    dst->numOldBuckets = dst->numOldBucketsLog2 = 0;
+    dst->migrateIndex = 0;
+    dst->numEntries = src->numEntries;
+    dst->numBucketsLog2 = src->numBucketsLog2;
+    dst->numBuckets = src->numBuckets;
+}
+
 void Scm_HashCoreCopy(ScmHashCore *dst, const ScmHashCore *src)
 {
+    if (open_core_p(src)) {
+        open_core_copy(dst, src);
+        return;
+    }
+
     Entry **b = SCM_NEW_ARRAY(Entry*, src->numBuckets);
 
     for (int i=0; i<src->numBuckets; i++) {
@@ -734,12 +1436,29 @@ void Scm_HashCoreCopy(ScmHashCore *dst, const ScmHashCore *src)
             e->key = s->key;
             e->value = s->value;
             e->next = NULL;
+            e->hashval = s->hashval;
             if (p) p->next = e;
             else   b[i] = e;
             p = e;
             s = s->next;
         }
     }
+    /* The copy doesn't inherit the migration; the entries still in the
+       old buckets of SRC go directly to the new ones. */
+    if (src->oldBuckets) {
+        for (int i=src->migrateIndex; i<src->numOldBuckets; i++) {
+            for (Entry *s = (Entry*)src->oldBuckets[i]; s; s = s->next) {
+                u_long index = HASH2INDEX(src->numBuckets,
+                                          src->numBucketsLog2, s->hashval);
+                Entry *e = SCM_NEW(Entry);
+                e->key = s->key;
+                e->value = s->value;
+                e->next = b[index];
+                e->hashval = s->hashval;
+                b[index] = e;
+            }
+        }
+    }
 
     /* A little trick to avoid hazard in careless race condition */
     dst->numBuckets = dst->numEntries = 0;
@@ -749,6 +1468,9 @@ void Scm_HashCoreCopy(ScmHashCore *dst, const ScmHashCore *src)
     dst->cmpfn    = src->cmpfn;
     dst->accessfn = src->accessfn;
     dst->data     = src->data;
+    dst->oldBuckets = NULL;
+    dst->numOldBuckets = dst->numOldBucketsLog2 = 0;
+    dst->migrateIndex = 0;
     dst->numEntries = src->numEntries;
     dst->numBucketsLog2 = src->numBucketsLog2;
     dst->numBuckets = src->numBuckets;
@@ -756,12 +1478,94 @@ void Scm_HashCoreCopy(ScmHashCore *dst, const ScmHashCore *src)
 
 void Scm_HashCoreClear(ScmHashCore *table)
 {
+    if (open_core_p(table)) {
+        OpenTable *ot = OPEN_TABLE(table);
+        memset(ot->ctrl, CTRL_EMPTY, table->numBuckets);
+        for (int i=0; i<table->numBuckets; i++) ot->slots[i] = NULL;
+        ot->numTombstones = 0;
+        table->numEntries = 0;
+        return;
+    }
     for (int i=0; i<table->numBuckets; i++) {
         table->buckets[i] = NULL;
     }
+    table->oldBuckets = NULL;
+    table->numOldBuckets = table->numOldBucketsLog2 = 0;
+    table->migrateIndex = 0;
     table->numEntries = 0;
 }
 
+/* Removes entries for which PRED returns true, in one pass.  PRED must
+   not modify the table.  Returns the number of removed entries. */
+int Scm_HashCoreSweep(ScmHashCore *table,
+                      int (*pred)(const ScmDictEntry *e, void *data),
+                      void *data)
+{
+    int count = 0;
+    if (open_core_p(table)) {
+        OpenTable *ot = OPEN_TABLE(table);
+        for (int i=0; i<table->numBuckets; i++) {
+            if (CTRL_FULLP(ot->ctrl[i])
+                && pred((const ScmDictEntry*)ot->slots[i], data)) {
+                open_delete(table, i);
+                count++;
+            }
+        }
+        return count;
+    }
+    for (int k=0; k<2; k++) {
+        Entry **buckets = k? (Entry**)table->oldBuckets : BUCKETS(table);
+        int lo = k? table->migrateIndex : 0;
+        int hi = k? table->numOldBuckets : table->numBuckets;
+        if (buckets == NULL) continue;
+        for (int i=lo; i<hi; i++) {
+            Entry *e = buckets[i], *p = NULL;
+            while (e) {
+                Entry *next = e->next;
+                if (pred((const ScmDictEntry*)e, data)) {
+                    delete_entry(table, e, p, buckets, i);
+                    count++;
+                } else {
+                    p = e;
+                }
+                e = next;
+            }
+        }
+    }
+    return count;
+}
+
+/* Reserving is an explicit request, so we rehash synchronously here. */
+void Scm_HashCoreReserve(ScmHashCore *table, unsigned int numEntries)
+{
+    if (numEntries > (1U<<30)) {
+        Scm_Error("hash table size too large: %u", numEntries);
+    }
+    if (open_core_p(table)) {
+        int nslots = table->numBuckets;
+        while ((unsigned int)OPEN_MAX_USED(nslots) < numEntries) nslots <<= 1;
+        if (nslots > table->numBuckets) open_resize(table, nslots);
+        return;
+    }
+    int nbuckets = table->numBuckets;
+    while ((unsigned int)nbuckets*MAX_AVG_CHAIN_LIMITS < numEntries) {
+        nbuckets <<= 1;
+    }
+    if (nbuckets > table->numBuckets) {
+        chained_grow(table, nbuckets);
+    }
+    chained_migrate(table, -1);
+}
+
+int Scm_HashCoreCapacity(const ScmHashCore *table)
+{
+    if (open_core_p(table)) {
+        return OPEN_MAX_USED(table->numBuckets)
+            - OPEN_TABLE(table)->numTombstones;
+    }
+    return table->numBuckets*MAX_AVG_CHAIN_LIMITS;
+}
+
 ScmDictEntry *Scm_HashCoreSearch(ScmHashCore *table, intptr_t key,
                                  ScmDictOp op)
 {
@@ -782,27 +1586,54 @@ int Scm_HashCoreNumEntries(ScmHashCore *table)
 void Scm_HashIterInit(ScmHashIter *iter, ScmHashCore *table)
 {
     iter->core = table;
-    for (int i=0; i<table->numBuckets; i++) {
-        if (table->buckets[i]) {
+    if (open_core_p(table)) {
+        /* We just keep the index of the next slot to look at.  Deleting
+           the current entry only changes its control byte. */
+        iter->bucket = 0;
+        iter->next = NULL;
+        return;
+    }
+    int nchains = chained_num_chains(table);
+    for (int i=0; i<nchains; i++) {
+        Entry *e = chained_chain(table, i);
+        if (e) {
             iter->bucket = i;
-            iter->next = table->buckets[i];
+            iter->next = e;
             return;
         }
     }
     iter->next = NULL;
 }
 
+static ScmDictEntry *open_iter_next(ScmHashIter *iter)
+{
+    ScmHashCore *table = iter->core;
+    OpenTable *ot = OPEN_TABLE(table);
+    /* The table may have been rehashed since the last call; we need to
+       re-read everything, and check the bound. */
+    for (int i = iter->bucket; i < table->numBuckets; i++) {
+        if (CTRL_FULLP(ot->ctrl[i])) {
+            iter->bucket = i+1;
+            return (ScmDictEntry*)ot->slots[i];
+        }
+    }
+    iter->bucket = table->numBuckets;
+    return NULL;
+}
+
 ScmDictEntry *Scm_HashIterNext(ScmHashIter *iter)
 {
+    if (open_core_p(iter->core)) return open_iter_next(iter);
     Entry *e = (Entry*)iter->next;
     if (e != NULL) {
         if (e->next) iter->next = e->next;
         else {
-            int i = iter->bucket + 1;
-            for (; i < iter->core->numBuckets; i++) {
-                if (iter->core->buckets[i]) {
+            int nchains = chained_num_chains(iter->core);
+            for (int i = iter->bucket + 1; i < nchains; i++) {
+                Entry *f = chained_chain(iter->core, i);
+                if (f) {
                     iter->bucket = i;
-                    iter->next = iter->core->buckets[i];
+                    iter->next = f;
                     return (ScmDictEntry*)e;
                 }
             }
@@ -834,6 +1665,22 @@ ScmObj Scm_MakeHashTableSimple(ScmHashType type, unsigned int initSize)
     return SCM_OBJ(z);
 }
 
+/* Like Scm_MakeHashTableSimple, but uses the fast (non-DoS-resistant)
+   hash function for string keys.  Only use it if the keys are not
+   controlled by outsiders. */
+ScmObj Scm_MakeTrustedHashTable(ScmHashType type, unsigned int initSize)
+{
+    if (type >= SCM_HASH_GENERAL) {
+        Scm_Error("Scm_MakeTrustedHashTable: wrong type arg: %d", type);
+    }
+    ScmHashTable *z = SCM_NEW(ScmHashTable);
+    SCM_SET_CLASS(z, SCM_CLASS_HASH_TABLE);
+    Scm_HashCoreInitFull(&z->core, type, NULL, NULL, initSize, NULL,
+                         SCM_HASH_CORE_DEFAULT|SCM_HASH_CORE_FAST_HASH);
+    z->type = type;
+    return SCM_OBJ(z);
+}
+
 ScmObj Scm_MakeHashTableFull(ScmHashProc hashfn,
                              ScmHashCompareProc cmpfn,
                              unsigned int initSize, void *data)
@@ -925,15 +1772,52 @@ ScmObj Scm_HashTableStat(ScmHashTable *table)
     SCM_APPEND1(h, t, Scm_MakeInteger(c->numBuckets));
     SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("num-buckets-log2"));
     SCM_APPEND1(h, t, Scm_MakeInteger(c->numBucketsLog2));
+    SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("core"));
+    SCM_APPEND1(h, t, (open_core_p(c)
+                       ? SCM_INTERN("open-addressing")
+                       : SCM_INTERN("chained")));
+    SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("fast-hash"));
+    SCM_APPEND1(h, t, SCM_MAKE_BOOL(fast_hash_core_p(c)));
+    SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("capacity"));
+    SCM_APPEND1(h, t, Scm_MakeInteger(Scm_HashCoreCapacity(c)));
 
-    Entry** b = BUCKETS(c);
     ScmVector *v = SCM_VECTOR(Scm_MakeVector(c->numBuckets, SCM_NIL));
     ScmObj *vp = SCM_VECTOR_ELEMENTS(v);
-    for (int i = 0; i<c->numBuckets; i++, vp++) {
-        Entry *e = b[i];
-        for (; e; e = e->next) {
-            *vp = Scm_Acons(SCM_DICT_KEY(e), SCM_DICT_VALUE(e), *vp);
+    if (open_core_p(c)) {
+        OpenTable *ot = OPEN_TABLE(c);
+        for (int i = 0; i<c->numBuckets; i++, vp++) {
+            if (CTRL_FULLP(ot->ctrl[i])) {
+                Entry *e = ot->slots[i];
+                *vp = Scm_Acons(SCM_DICT_KEY(e), SCM_DICT_VALUE(e), *vp);
+            }
+        }
+        SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("num-tombstones"));
+        SCM_APPEND1(h, t, Scm_MakeInteger(ot->numTombstones));
+    } else {
+        Entry** b = BUCKETS(c);
+        for (int i = 0; i<c->numBuckets; i++, vp++) {
+            Entry *e = b[i];
+            for (; e; e = e->next) {
+                *vp = Scm_Acons(SCM_DICT_KEY(e), SCM_DICT_VALUE(e), *vp);
+            }
+        }
+        /* Entries yet to be migrated are shown in the buckets they
+           will be moved to. */
+        vp = SCM_VECTOR_ELEMENTS(v);
+        int nmigrating = 0;
+        if (c->oldBuckets) {
+            for (int i = c->migrateIndex; i<c->numOldBuckets; i++) {
+                for (Entry *e = (Entry*)c->oldBuckets[i]; e; e = e->next) {
+                    u_long index = HASH2INDEX(c->numBuckets,
+                                              c->numBucketsLog2, e->hashval);
+                    vp[index] = Scm_Acons(SCM_DICT_KEY(e), SCM_DICT_VALUE(e),
+                                          vp[index]);
+                }
+            }
+            nmigrating = c->numOldBuckets - c->migrateIndex;
         }
+        SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("num-migrating-buckets"));
+        SCM_APPEND1(h, t, Scm_MakeInteger(nmigrating));
     }
     SCM_APPEND1(h, t, SCM_MAKE_KEYWORD("contents"));
     SCM_APPEND1(h, t, SCM_OBJ(v));
@@ -1002,6 +1886,7 @@ void Scm__InitHash()
     u_long salt = ((u_long)getpid() * ((u_long)t.tv_sec^(u_long)t.tv_usec));
     ADDRESS_HASH(salt, salt);
     salt &= SCM_SMALL_INT_MAX;
+    initial_salt = salt;
     Scm_InitParameterLoc(Scm_VM(), &hash_salt, Scm_MakeIntegerU(salt));
     Scm_InitParameterLoc(Scm_VM(), &current_recursive_hash, SCM_FALSE);
 }
@@ -445,18 +445,74 @@ struct ScmLazyPairRec {
     ScmObj item;
     ScmObj generator;
     AO_t owner;
+    /* The following fields are beyond ScmExtendedPair. */
+    ScmSmallInt chunk;          /* # of items to realize per forcing */
+    ScmObj policy;              /* #f or a procedure to give next chunk */
 };
 
 ScmObj Scm_MakeLazyPair(ScmObj item, ScmObj generator)
+{
+    return Scm_MakeChunkedLazyPair(item, generator, 1, SCM_FALSE);
+}
+
+/* Chunked lazy pair.  Forcing it calls the generator up to CHUNK times
+   at once, and the items except the last one are stored in ordinary
+   pairs; only the last one becomes a lazy pair again.  It saves
+   allocation and the cost of setting up the forcing with each item,
+   at the expense of calling the generator ahead of the consumer.
+   If POLICY is a procedure, it is called with the current chunk size
+   every time we create the next chunked lazy pair, and must return
+   a positive fixnum for the next chunk size. */
+ScmObj Scm_MakeChunkedLazyPair(ScmObj item, ScmObj generator,
+                               ScmSmallInt chunk, ScmObj policy)
 {
     ScmLazyPair *z = SCM_NEW(ScmLazyPair);
+    if (chunk < 1) Scm_Error("chunk size must be positive, but got %ld",
+                             chunk);
     z->owner = (AO_t)0;
     SCM_SET_CLASS(z, SCM_CLASS_LAZY_PAIR);
     z->generator = generator;
     z->item = item;
+    z->chunk = chunk;
+    z->policy = policy;
     return SCM_OBJ(z);
 }
 
+/* Calls the generator of LP up to LP->chunk times, and returns the
+   list to be the cdr of LP. */
+static ScmObj force_chunk(volatile ScmLazyPair *lp, ScmVM *vm)
+{
+    ScmObj gen = lp->generator;
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    ScmSmallInt n = lp->chunk;
+
+    for (ScmSmallInt i = 0; i < n; i++) {
+        ScmObj val = Scm_ApplyRec0(gen);
+        if (vm->numVals != 1) gen = vm->vals[0];
+        vm->numVals = 1;
+        if (SCM_EOFP(val)) return h;
+        if (i < n-1) {
+            SCM_APPEND1(h, t, val);
+        } else {
+            ScmSmallInt next = n;
+            if (!SCM_FALSEP(lp->policy)) {
+                ScmObj r = Scm_ApplyRec1(lp->policy, SCM_MAKE_INT(n));
+                vm->numVals = 1;
+                if (!SCM_INTP(r) || SCM_INT_VALUE(r) < 1) {
+                    Scm_Error("lazy sequence chunk policy %S returned "
+                              "invalid chunk size: %S", lp->policy, r);
+                }
+                next = SCM_INT_VALUE(r);
+            }
+            ScmObj newlp = Scm_MakeChunkedLazyPair(val, gen, next,
+                                                   lp->policy);
+            if (SCM_NULLP(h)) return newlp;
+            SCM_SET_CDR(t, newlp);
+        }
+    }
+    return h;
+}
+
 /* Force a lazy pair.
    NB: When an error occurs during forcing, we release the lock of the
    pair, so that the pair can be forced again.  However, the generator
@@ -479,18 +535,22 @@ ScmObj Scm_ForceLazyPair(volatile ScmLazyPair *lp)
                incomplete stack frame if there's any. */
             int extra_frame_pushed = Scm__VMProtectStack(vm);
             SCM_UNWIND_PROTECT {
-                ScmObj val = Scm_ApplyRec0(lp->generator);
-                ScmObj newgen = (vm->numVals == 1)? lp->generator : vm->vals[0];
-                vm->numVals = 1; /* make sure the extra val won't leak out */
-
-                if (SCM_EOFP(val)) {
-                    lp->item = SCM_NIL;
-                    lp->generator = SCM_NIL;
+                if (lp->chunk > 1 || !SCM_FALSEP(lp->policy)) {
+                    lp->item = force_chunk(lp, vm);
                 } else {
-                    ScmObj newlp = Scm_MakeLazyPair(val, newgen);
-                    lp->item = newlp;
-                    lp->generator = SCM_NIL;
+                    ScmObj val = Scm_ApplyRec0(lp->generator);
+                    ScmObj newgen =
+                        (vm->numVals == 1)? lp->generator : vm->vals[0];
+                    vm->numVals = 1; /* make sure the extra val won't leak */
+
+                    if (SCM_EOFP(val)) {
+                        lp->item = SCM_NIL;
+                    } else {
+                        lp->item = Scm_MakeLazyPair(val, newgen);
+                    }
                 }
+                lp->generator = SCM_NIL;
+                lp->policy = SCM_FALSE;
                 AO_nop_full();
                 SCM_SET_CAR(lp, item);
                 /* We don't need barrier here. */
@@ -257,6 +257,41 @@
     (return (Scm_CharSetAddRange cs (cast ScmChar f) (cast ScmChar t)))))
 
 (define-cproc %char-set-add! (dst::<char-set> src::<char-set>) Scm_CharSetAdd)
+
+;; Used by srfi-13 string-index and string-skip
+(define-cproc %string-index-char-set (s::<string> cs::<char-set>
+                                      negate::<boolean>
+                                      :optional (start::<fixnum> 0)
+                                                (end::<fixnum> -1))
+  (let* ([i::ScmSmallInt (Scm_StringIndexCharSet s cs negate start end)])
+    (return (?: (< i 0) SCM_FALSE (SCM_MAKE_INT i)))))
+
+;; Used by srfi-13 string-index family and trimmers.  C/S is either
+;; a char or a char-set.  If RIGHT is true, searches from the end.
+(define-cproc %string-find (s::<string> c/s negate::<boolean> right::<boolean>
+                            :optional (start::<fixnum> 0)
+                                      (end::<fixnum> -1))
+  (let* ([i::ScmSmallInt -1])
+    (cond [(SCM_CHARP c/s)
+           (if right
+             (set! i (Scm_StringIndexCharRight s (SCM_CHAR_VALUE c/s)
+                                               negate start end))
+             (set! i (Scm_StringIndexChar s (SCM_CHAR_VALUE c/s)
+                                          negate start end)))]
+          [(SCM_CHAR_SET_P c/s)
+           (if right
+             (set! i (Scm_StringIndexCharSetRight s (SCM_CHAR_SET c/s)
+                                                  negate start end))
+             (set! i (Scm_StringIndexCharSet s (SCM_CHAR_SET c/s)
+                                             negate start end)))]
+          [else (SCM_TYPE_ERROR c/s "char or char-set")])
+    (return (?: (< i 0) SCM_FALSE (SCM_MAKE_INT i)))))
+
+;; Used by srfi-13 string-tokenize
+(define-cproc %string-tokenize (s::<string> cs::<char-set>
+                                :optional (start::<fixnum> 0)
+                                          (end::<fixnum> -1))
+  Scm_StringTokenize)
 (define-cproc %char-set-ranges (cs::<char-set>) Scm_CharSetRanges)
 (define-cproc %char-set-predefined (num::<fixnum>) Scm_GetStandardCharSet)
 
@@ -56,11 +56,32 @@
 (select-module gauche.internal)
 (define (default-type-test _) #t)
 
+(define-cfn native-tag (tag) ::u_long :static
+  (cond [(SCM_FALSEP tag) (return 0)]
+        [(SCM_EQ tag 'string) (return SCM_COMPARATOR_TYPE_STRING)]
+        [(SCM_EQ tag 'symbol) (return SCM_COMPARATOR_TYPE_SYMBOL)]
+        [(SCM_EQ tag 'char)   (return SCM_COMPARATOR_TYPE_CHAR)]
+        [(SCM_EQ tag 'boolean) (return SCM_COMPARATOR_TYPE_BOOLEAN)]
+        [(SCM_EQ tag 'exact-integer)
+         (return SCM_COMPARATOR_TYPE_EXACT_INTEGER)]
+        [(SCM_EQ tag 'eq?)    (return SCM_COMPARATOR_EQUIV_EQ)]
+        [(SCM_EQ tag 'eqv?)   (return SCM_COMPARATOR_EQUIV_EQV)]
+        [(SCM_EQ tag 'equal?) (return SCM_COMPARATOR_EQUIV_EQUAL)]
+        [(SCM_EQ tag 'string=?) (return SCM_COMPARATOR_EQUIV_STRING)]
+        [(SCM_EQ tag 'eq-hash) (return SCM_COMPARATOR_HASH_EQ)]
+        [(SCM_EQ tag 'eqv-hash) (return SCM_COMPARATOR_HASH_EQV)]
+        [(SCM_EQ tag 'default-hash) (return SCM_COMPARATOR_HASH_DEFAULT)]
+        [else (Scm_Error "[internal] unknown comparator tag: %S" tag)
+              (return 0)]))
+
+;; TAGS is a list of (type-tag equiv-tag hash-tag native-compare?)
+;; computed by %comparator-native-tags.
 (define-cproc %make-comparator (type-test equality-test
                                 comparison-proc ; or order-proc
                                 hash name 
                                 any-type::<boolean> use-cmp::<boolean>
-                                srfi-128::<boolean>)
+                                srfi-128::<boolean>
+                                :optional (tags::<list> ()))
   (let* ([flags::u_long (logior (?: srfi-128 SCM_COMPARATOR_SRFI_128 0)
                                 (?: (SCM_EQ comparison-proc SCM_FALSE)
                                     SCM_COMPARATOR_NO_ORDER 0)
@@ -68,10 +89,52 @@
                                     SCM_COMPARATOR_NO_HASH 0)
                                 (?: any-type SCM_COMPARATOR_ANY_TYPE 0)
                                 (?: use-cmp SCM_COMPARATOR_USE_COMPARISON 0))])
+    (when (== (Scm_Length tags) 4)
+      (logior= flags
+               (logior
+                (<< (native-tag (SCM_CAR tags)) SCM_COMPARATOR_TYPE_SHIFT)
+                (<< (native-tag (SCM_CADR tags)) SCM_COMPARATOR_EQUIV_SHIFT)
+                (<< (native-tag (SCM_CAR (SCM_CDDR tags)))
+                    SCM_COMPARATOR_HASH_SHIFT)
+                (?: (SCM_FALSEP (SCM_CADR (SCM_CDDR tags)))
+                    0 SCM_COMPARATOR_NATIVE_COMPARE))))
     (return
      (Scm_MakeComparator type-test equality-test comparison-proc hash
                          name flags))))
 
+;; Recognize built-in procedures given to the constructors, so that
+;; C routines (sort, tree-map and hash tables) can bypass calling them.
+;; ORDER is a comparison procedure if SRFI-128 is #f, an ordering
+;; predicate otherwise.
+(define (%comparator-native-tags type equality order hash srfi-128)
+  (define type-tag
+    (cond [(eq? type string?) 'string]
+          [(eq? type symbol?) 'symbol]
+          [(eq? type char?)   'char]
+          [(eq? type boolean?) 'boolean]
+          [(eq? type exact-integer?) 'exact-integer]
+          [else #f]))
+  (define equiv-tag
+    (cond [(eq? equality eq?) 'eq?]
+          [(eq? equality eqv?) 'eqv?]
+          [(eq? equality equal?) 'equal?]
+          [(eq? equality string=?) 'string=?]
+          [else #f]))
+  (define hash-tag
+    (cond [(eq? hash eq-hash) 'eq-hash]
+          [(eq? hash eqv-hash) 'eqv-hash]
+          [(eq? hash default-hash) 'default-hash]
+          [else #f]))
+  (define native-compare?
+    (if srfi-128
+      (case type-tag
+        [(string) (eq? order string<?)]
+        [(char)   (eq? order char<?)]
+        [(exact-integer) (eq? order <)]
+        [else #f])
+      (eq? order compare)))
+  (list type-tag equiv-tag hash-tag native-compare?))
+
 ;; Argument checkers for consturctors.
 ;; We use <bottom> for applicability check except type-test, since
 ;; those procs are only required to handle objects that passes type-test.
@@ -107,7 +170,9 @@
                       name
                       (eq? type default-type-test)
                       (eq? equality-test #t)
-                      #f)))
+                      #f
+                      (%comparator-native-tags type-test equality-test
+                                               comparison-proc hash #f))))
 
 ;; API - srfi-128 constructor
 (define-in-module gauche (make-comparator type-test equality-test
@@ -125,7 +190,9 @@
                       name
                       (eq? type default-type-test)
                       (eq? equality-test #t)
-                      #t)))
+                      #t
+                      (%comparator-native-tags type-test equality-test
+                                               ordering-pred hash #t))))
 
 (define (%make-fallback-compare comparator)
   (if (eq? (comparator-flavor comparator) 'ordering)
@@ -192,6 +259,8 @@
 ;; Used by (object-equal? <comparator> <comparator>), defined in libomega.scm
 (define-cproc comparator-equality-use-comparison? (c::<comparator>) ::<boolean>
   (return (logand (-> c flags) SCM_COMPARATOR_USE_COMPARISON)))
+(define-cproc %comparator-native-compare? (c::<comparator>) ::<boolean>
+  (return (logand (-> c flags) SCM_COMPARATOR_NATIVE_COMPARE)))
 
 ;; Expose as a class
 (select-module gauche)
@@ -283,20 +352,33 @@
 ;; will be autoloaded.  We provide a C-implemented low-level routines.
 (select-module gauche.internal)
 
-(define-cproc %sort (seq)
-  (cond [(SCM_VECTORP seq)
-         (let* ([r (Scm_VectorCopy (SCM_VECTOR seq) 0 -1 SCM_UNDEFINED)])
-           (Scm_SortArray (SCM_VECTOR_ELEMENTS r) (SCM_VECTOR_SIZE r) '#f)
-           (return r))]
-        [(>= (Scm_Length seq) 0) (return (Scm_SortList seq '#f))]
-        [else (SCM_TYPE_ERROR seq "proper list or vector")
-              (return SCM_UNDEFINED)]))
+(define-cfn sort-flags (stable::int) ::u_long :static
+  (return (logior SCM_SORT_PREDICATE (?: stable SCM_SORT_STABLE 0))))
+
+;; LESS? is a procedure that returns true iff the first argument strictly
+;; precedes the second, or #f to use the default compare.  It can also be
+;; a comparator, in which case the elements are type-checked first, and
+;; compared natively if the comparator's order is the same as 'compare'.
+(define-cproc %sort (seq :optional (less? #f) (stable::<boolean> #f))
+  (let* ([flags::u_long (sort-flags stable)])
+    (cond [(SCM_VECTORP seq)
+           (let* ([r (Scm_VectorCopy (SCM_VECTOR seq) 0 -1 SCM_UNDEFINED)])
+             (Scm_SortArrayFull (SCM_VECTOR_ELEMENTS r) (SCM_VECTOR_SIZE r)
+                                less? flags)
+             (return r))]
+          [(>= (Scm_Length seq) 0) (return (Scm_SortListFull seq less? flags))]
+          [else (SCM_TYPE_ERROR seq "proper list or vector")
+                (return SCM_UNDEFINED)])))
 
-(define-cproc %sort! (seq)
-  (cond [(SCM_VECTORP seq)
-         (Scm_SortArray (SCM_VECTOR_ELEMENTS seq) (SCM_VECTOR_SIZE seq) '#f)
-         (return seq)]
-        [(>= (Scm_Length seq) 0) (return (Scm_SortListX seq '#f))]
-        [else (SCM_TYPE_ERROR seq "proper list or vector")
-              (return SCM_UNDEFINED)]))
+(define-cproc %sort! (seq :optional (less? #f) (stable::<boolean> #f))
+  (let* ([flags::u_long (sort-flags stable)])
+    (cond [(SCM_VECTORP seq)
+           (Scm_SortArrayFull (SCM_VECTOR_ELEMENTS seq) (SCM_VECTOR_SIZE seq)
+                              less? flags)
+           (return seq)]
+          [(>= (Scm_Length seq) 0)
+           (return (Scm_SortListFull seq less?
+                                     (logior flags SCM_SORT_DESTRUCTIVE)))]
+          [else (SCM_TYPE_ERROR seq "proper list or vector")
+                (return SCM_UNDEFINED)])))
 
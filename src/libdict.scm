@@ -153,8 +153,16 @@
     (return (Scm_MakeHashTableSimple ctype init-size))))
 
 (inline-stub
+;; If the comparator's procedures are recognized built-ins, we call the
+;; C functions directly instead of going through the VM.
 (define-cfn generic-hashtable-hash (h::(const ScmHashCore*) key::intptr_t)
   ::u_long :static
+  (let* ([c::ScmComparator* (cast ScmComparator* (-> h data))])
+    (case (SCM_COMPARATOR_HASH_TAG c)
+      [(SCM_COMPARATOR_HASH_EQ)  (return (Scm_EqHash (SCM_OBJ key)))]
+      [(SCM_COMPARATOR_HASH_EQV) (return (Scm_EqvHash (SCM_OBJ key)))]
+      [(SCM_COMPARATOR_HASH_DEFAULT)
+       (return (cast u_long (Scm_DefaultHash (SCM_OBJ key))))]))
   (let* ([c::ScmComparator* (cast ScmComparator* (-> h data))]
          [v::ScmObj (Scm_ApplyRec1 (Scm_ComparatorHashFunction c)
                                    (SCM_OBJ key))])
@@ -166,30 +174,36 @@
 (define-cfn generic-hashtable-hash-typecheck (h::(const ScmHashCore*)
                                               key::intptr_t)
   ::u_long :static
-  (let* ([c::ScmComparator* (cast ScmComparator* (-> h data))]
-         [t::ScmObj (Scm_ApplyRec1 (-> c typeFn) (SCM_OBJ key))])
-    (when (SCM_FALSEP t)
+  (let* ([c::ScmComparator* (cast ScmComparator* (-> h data))])
+    (unless (Scm_ComparatorTestType c (SCM_OBJ key))
       (Scm_Error "Invalid key for hashtable: %S" (SCM_OBJ key)))
     (return (generic-hashtable-hash h key))))
 
 (define-cfn generic-hashtable-eq (h::(const ScmHashCore*)
                                   a::intptr_t b::intptr_t)
   ::int :static
-  (let* ([c::ScmComparator* (cast ScmComparator* (-> h data))]
-         [e::ScmObj (Scm_ApplyRec2 (-> c eqFn) (SCM_OBJ a) (SCM_OBJ b))])
-    (return (not (SCM_FALSEP e)))))
+  (let* ([c::ScmComparator* (cast ScmComparator* (-> h data))])
+    (case (SCM_COMPARATOR_EQUIV_TAG c)
+      [(SCM_COMPARATOR_EQUIV_EQ) (return (SCM_EQ (SCM_OBJ a) (SCM_OBJ b)))]
+      [(SCM_COMPARATOR_EQUIV_EQV) (return (Scm_EqvP (SCM_OBJ a) (SCM_OBJ b)))]
+      [(SCM_COMPARATOR_EQUIV_EQUAL)
+       (return (Scm_EqualP (SCM_OBJ a) (SCM_OBJ b)))]
+      [(SCM_COMPARATOR_EQUIV_STRING)
+       (when (and (SCM_STRINGP (SCM_OBJ a)) (SCM_STRINGP (SCM_OBJ b)))
+         (return (Scm_StringEqual (SCM_STRING a) (SCM_STRING b))))])
+    (let* ([e::ScmObj (Scm_ApplyRec2 (-> c eqFn) (SCM_OBJ a) (SCM_OBJ b))])
+      (return (not (SCM_FALSEP e))))))
 
 (define-cfn generic-hashtable-eq-typecheck (h::(const ScmHashCore*)
                                             a::intptr_t b::intptr_t)
   ::int :static
-  (let* ([c::ScmComparator* (cast ScmComparator* (-> h data))]
-         [t::ScmObj (Scm_ApplyRec1 (-> c typeFn) (SCM_OBJ a))])
+  (let* ([c::ScmComparator* (cast ScmComparator* (-> h data))])
     ;; NB: a is the key given from outside, and b is the key that's already
     ;; in the table, so we only need to check a.
     ;; TODO: Currently we may perform typecheck of a multiple times if
     ;; we have more than one items with the same hash value in the table;
     ;; optimization required.
-    (when (SCM_FALSEP t)
+    (unless (Scm_ComparatorTestType c (SCM_OBJ a))
       (Scm_Error "Invalid key for hashtable: %S" (SCM_OBJ a)))
     (return (generic-hashtable-eq h a b))))
 )
@@ -236,6 +250,27 @@
           (not (eq? (comparator-type-test-predicate comparator)
                     (with-module gauche.internal default-type-test))))])]))
 
+;; Like make-hash-table, but uses a fast hash function for string keys,
+;; which isn't resistant to hash flooding.  Only for the tables whose
+;; keys are under our control.
+(define-cproc %make-trusted-hash-table (type init-size::<int>)
+  (let* ([ctype::int 0])
+    (set-hash-type! ctype type)
+    (return (Scm_MakeTrustedHashTable ctype init-size))))
+
+(define (make-trusted-hash-table :optional (comparator 'string=?)
+                                           (init-size 0))
+  (%make-trusted-hash-table
+   (cond [(memq comparator '(eq? eqv? equal? string=?)) comparator]
+         [(eq? comparator eq-comparator) 'eq?]
+         [(eq? comparator eqv-comparator) 'eqv?]
+         [(eq? comparator equal-comparator) 'equal?]
+         [(eq? comparator string-comparator) 'string=?]
+         [else (error "make-trusted-hash-table requires one of the symbols \
+                       eq?, eqv?, equal? or string=?, or the corresponding \
+                       comparator, but got:" comparator)])
+   init-size))
+
 (define-cproc hash-table-type (hash::<hash-table>)
   (get-hash-type (-> hash type)))
 
@@ -265,6 +300,12 @@
 (define-cproc hash-table-clear! (hash::<hash-table>) ::<void>
   (Scm_HashCoreClear (SCM_HASH_TABLE_CORE hash)))
 
+(define-cproc hash-table-reserve! (hash::<hash-table> n::<uint>) ::<void>
+  (Scm_HashCoreReserve (SCM_HASH_TABLE_CORE hash) n))
+
+(define-cproc hash-table-capacity (hash::<hash-table>) ::<int>
+  (return (Scm_HashCoreCapacity (SCM_HASH_TABLE_CORE hash))))
+
 (define-cproc hash-table-get (hash::<hash-table> key :optional fallback)
   (dict-get hash Scm_HashTableRef))
 
@@ -312,11 +353,121 @@
     (Scm_HashIterInit iter (SCM_HASH_TABLE_CORE hash))
     (return (Scm_MakeSubr hash_table_iter iter 1 0 '"hash-table-iterator"))))
 
-(define-cproc hash-table-copy (hash::<hash-table>)   Scm_HashTableCopy)
 (define-cproc hash-table-keys (hash::<hash-table>)   Scm_HashTableKeys)
 (define-cproc hash-table-values (hash::<hash-table>) Scm_HashTableValues)
 (define-cproc hash-table-stat (hash::<hash-table>)   Scm_HashTableStat)
 
+;; Bulk operations.  They walk the table with a C-level iterator and
+;; call PROC through continuation frames, so that no intermediate lists
+;; or closures are allocated per entry.
+;; data[0] iterator, [1] proc, [2] current entry, [3] mode,
+;; [4] the object to return, [5] index (for HT_WALK_VECTOR)
+(inline-stub
+ (declcode
+  "#define HT_WALK_UPDATE 0  /* value := (proc key value) */"
+  "#define HT_WALK_FILTER 1  /* delete if (proc key value) is #f */"
+  "#define HT_WALK_VECTOR 2  /* vec[i] := (proc key value) */")
+
+ (define-cfn hash-table-walk-next (data::void**) :static
+   (let* ([iter::ScmHashIter* (cast ScmHashIter* (aref data 0))]
+          [mode::int (cast int (cast intptr_t (aref data 3)))]
+          [result (SCM_OBJ (aref data 4))]
+          [i::ScmSmallInt (cast ScmSmallInt (aref data 5))]
+          [e::ScmDictEntry* NULL])
+     (when (and (== mode HT_WALK_VECTOR)
+                (>= i (SCM_VECTOR_SIZE result)))
+       (return result))
+     (set! e (Scm_HashIterNext iter))
+     (when (== e NULL)
+       (if (and (== mode HT_WALK_VECTOR) (< i (SCM_VECTOR_SIZE result)))
+         ;; entries are deleted during the walk
+         (return (Scm_VectorCopy (SCM_VECTOR result) 0 i SCM_UNDEFINED))
+         (return result)))
+     (set! (aref data 2) (cast void* e))
+     (Scm_VMPushCC hash-table-walk-cc data 6)
+     (return (Scm_VMApply2 (SCM_OBJ (aref data 1))
+                           (SCM_DICT_KEY e) (SCM_DICT_VALUE e)))))
+
+ (define-cfn hash-table-walk-cc (r (data :: void**)) :static
+   (let* ([iter::ScmHashIter* (cast ScmHashIter* (aref data 0))]
+          [e::ScmDictEntry* (cast ScmDictEntry* (aref data 2))]
+          [mode::int (cast int (cast intptr_t (aref data 3)))])
+     (cond [(== mode HT_WALK_UPDATE)
+            (cast void (SCM_DICT_SET_VALUE e r))]
+           [(== mode HT_WALK_FILTER)
+            (when (SCM_FALSEP r)
+              (Scm_HashCoreSearch (-> iter core) (-> e key) SCM_DICT_DELETE))]
+           [else
+            (let* ([i::ScmSmallInt (cast ScmSmallInt (aref data 5))])
+              (set! (SCM_VECTOR_ELEMENT (SCM_OBJ (aref data 4)) i) r)
+              (set! (aref data 5) (cast void* (+ i 1))))])
+     (return (hash-table-walk-next data))))
+
+ (define-cfn hash-table-walk (ht::ScmHashTable* proc mode::int result) :static
+   (let* ([iter::ScmHashIter* (SCM_NEW ScmHashIter)]
+          [data::(.array void* [6])])
+     (Scm_HashIterInit iter (SCM_HASH_TABLE_CORE ht))
+     (set! (aref data 0) iter
+           (aref data 1) proc
+           (aref data 2) NULL
+           (aref data 3) (cast void* (cast intptr_t mode))
+           (aref data 4) result
+           (aref data 5) (cast void* 0))
+     (return (hash-table-walk-next data))))
+
+ (define-cfn hash-table-key-gen (args::ScmObj* nargs::int data::void*) :static
+   (let* ([e::ScmDictEntry* (Scm_HashIterNext (cast ScmHashIter* data))])
+     (return (?: (== e NULL) SCM_EOF (SCM_DICT_KEY e)))))
+
+ (define-cfn hash-table-value-gen (args::ScmObj* nargs::int data::void*)
+   :static
+   (let* ([e::ScmDictEntry* (Scm_HashIterNext (cast ScmHashIter* data))])
+     (return (?: (== e NULL) SCM_EOF (SCM_DICT_VALUE e)))))
+ )
+
+;; If PROC is given, the values of the copy are (proc key value).
+(define-cproc hash-table-copy (hash::<hash-table> :optional proc)
+  (let* ([h (Scm_HashTableCopy hash)])
+    (if (SCM_UNBOUNDP proc)
+      (return h)
+      (return (hash-table-walk (SCM_HASH_TABLE h) proc HT_WALK_UPDATE h)))))
+
+(define-cproc hash-table-update-all! (hash::<hash-table> proc)
+  (return (hash-table-walk hash proc HT_WALK_UPDATE SCM_UNDEFINED)))
+
+(define-cproc hash-table-filter! (hash::<hash-table> pred)
+  (return (hash-table-walk hash pred HT_WALK_FILTER (SCM_OBJ hash))))
+
+(define-cproc hash-table-map->vector (hash::<hash-table> proc)
+  (let* ([v (Scm_MakeVector (Scm_HashCoreNumEntries
+                             (SCM_HASH_TABLE_CORE hash))
+                            SCM_UNDEFINED)])
+    (return (hash-table-walk hash proc HT_WALK_VECTOR v))))
+
+;; Adds all the entries of SRC to HASH.  Values in SRC take precedence.
+(define-cproc hash-table-merge! (hash::<hash-table> src::<hash-table>)
+  (let* ([iter::ScmHashIter] [e::ScmDictEntry*])
+    (Scm_HashIterInit (& iter) (SCM_HASH_TABLE_CORE src))
+    (while (!= (set! e (Scm_HashIterNext (& iter))) NULL)
+      (let* ([d::ScmDictEntry* (Scm_HashCoreSearch (SCM_HASH_TABLE_CORE hash)
+                                                   (-> e key)
+                                                   SCM_DICT_CREATE)])
+        (cast void (SCM_DICT_SET_VALUE d (SCM_DICT_VALUE e)))))
+    (return (SCM_OBJ hash))))
+
+;; Generators walking a table without consing.
+(define-cproc hash-table-key-generator (hash::<hash-table>)
+  (let* ([iter::ScmHashIter* (SCM_NEW ScmHashIter)])
+    (Scm_HashIterInit iter (SCM_HASH_TABLE_CORE hash))
+    (return (Scm_MakeSubr hash_table_key_gen iter 0 0
+                          '"hash-table-key-generator"))))
+
+(define-cproc hash-table-value-generator (hash::<hash-table>)
+  (let* ([iter::ScmHashIter* (SCM_NEW ScmHashIter)])
+    (Scm_HashIterInit iter (SCM_HASH_TABLE_CORE hash))
+    (return (Scm_MakeSubr hash_table_value_gen iter 0 0
+                          '"hash-table-value-generator"))))
+
 ;; conversion to/from hash-table
 (define (alist->hash-table a . opt-cmpr)
   (rlet1 tb (apply make-hash-table opt-cmpr)
@@ -336,6 +487,12 @@
    ::int :static
    (let* ([cmpr (SCM_OBJ (-> core data))])
      (SCM_ASSERT (and cmpr (SCM_COMPARATORP cmpr)))
+     ;; Shortcut if the comparator orders keys just as 'compare' does.
+     (when (and (logand (-> (SCM_COMPARATOR cmpr) flags)
+                        SCM_COMPARATOR_NATIVE_COMPARE)
+                (Scm_ComparatorTestType (SCM_COMPARATOR cmpr) (SCM_OBJ x))
+                (Scm_ComparatorTestType (SCM_COMPARATOR cmpr) (SCM_OBJ y)))
+       (return (Scm_Compare (SCM_OBJ x) (SCM_OBJ y))))
      (let* ([r (Scm_ApplyRec2 (Scm_ComparatorComparisonProcedure
                                (SCM_COMPARATOR cmpr))
                               (SCM_OBJ x) (SCM_OBJ y))])
@@ -345,10 +502,15 @@
        (return (SCM_INT_VALUE r)))))
  )
 
-(define-cproc %make-tree-map (comparator)
-  (begin
+;; KIND is either red-black (default) or btree.
+(define-cproc %make-tree-map (comparator :optional (kind::<symbol>? #f))
+  (let* ([k::ScmTreeCoreKind SCM_TREE_CORE_RB])
     (SCM_ASSERT (SCM_COMPARATORP comparator))
-    (return (Scm_MakeTreeMap tree_map_cmp comparator))))
+    (cond [(or (== kind NULL) (SCM_EQ (SCM_OBJ kind) 'red-black))]
+          [(SCM_EQ (SCM_OBJ kind) 'btree) (set! k SCM_TREE_CORE_BTREE)]
+          [else (Scm_Error "tree-map kind must be either red-black or btree, \
+                            but got: %S" kind)])
+    (return (Scm_MakeTreeMapFull tree_map_cmp comparator k))))
 
 ;; TODO: We do want to return something even for tree-maps that aren't
 ;; created from the Scheme world.  But how?
@@ -406,6 +568,26 @@
       (return (Scm_Cons (SCM_DICT_KEY e) (SCM_DICT_VALUE e)))
       (return '#f))))
 
+;; Order statistics
+(define-cproc tree-map-rank (tm::<tree-map> key) ::<int>
+  (return (Scm_TreeCoreRank (SCM_TREE_MAP_CORE tm) (cast intptr_t key))))
+
+(define-cproc tree-map-select
+  (tm::<tree-map> k::<fixnum> :optional (key-fb #f) (val-fb #f)) ::(<top> <top>)
+  (let* ([e::ScmDictEntry*
+          (?: (and (>= k 0) (< k (Scm_TreeCoreNumEntries (SCM_TREE_MAP_CORE tm))))
+              (Scm_TreeCoreSelect (SCM_TREE_MAP_CORE tm) (cast int k))
+              NULL)])
+    (if e
+      (return (SCM_DICT_KEY e) (SCM_DICT_VALUE e))
+      (return key-fb val-fb))))
+
+;; Number of keys K such that LO <= K < HI.
+(define-cproc tree-map-count-range (tm::<tree-map> lo hi) ::<int>
+  (let* ([l::int (Scm_TreeCoreRank (SCM_TREE_MAP_CORE tm) (cast intptr_t lo))]
+         [h::int (Scm_TreeCoreRank (SCM_TREE_MAP_CORE tm) (cast intptr_t hi))])
+    (return (?: (< l h) (- h l) 0))))
+
 (inline-stub
  (define-cfn tree-map-iter (args::ScmObj* nargs::int data::void*) :static
    (let* ([iter::ScmTreeIter* (cast ScmTreeIter* data)]
@@ -125,7 +125,7 @@
              prev-history))
       (vm-eval-situation SCM_VM_LOADING)
       (current-read-context (%new-read-context-for-load))
-      (%record-load-stat (or (current-load-path) "(unnamed source)")))
+      (%record-load-stat 'load (or (current-load-path) "(unnamed source)")))
 
     (define (restore-load-context)
       (vm-set-current-module prev-module)
@@ -136,7 +136,7 @@
       (vm-eval-situation prev-eval-situation)
       (current-read-context prev-read-context)
       (close-port port)
-      (%record-load-stat #f)
+      (%record-load-stat 'end #f)
       (%port-unlock! port))
 
     (guard (e [else (let1 e2 (if (condition? e)
@@ -149,25 +149,25 @@
                       (restore-load-context)
                       (raise e2))])
       (setup-load-context)
-      (do ([s (read port) (read port)])
+      (do ([s (%load-read port) (%load-read port)])
           [(eof-object? s)]
         (eval s #f)))
     (restore-load-context)
     #t))
 
 ;; A few helper procedures
-(define-cproc %record-load-stat (path) ::<void>
-  (.if "defined(HAVE_GETTIMEOFDAY)"
-       (let* ([vm::ScmVM* (Scm_VM)])
-         (when (SCM_VM_RUNTIME_FLAG_IS_SET vm SCM_COLLECT_LOAD_STATS)
-           (let* ([t0::(struct timeval)])
-             (gettimeofday (& t0) NULL)
-             (let* ([t (Scm_MakeIntegerU (+ (* (ref t0 tv_sec) 1000000)
-                                            (ref t0 tv_usec)))])
-               (set! (ref (-> vm stat) loadStat)
-                     (Scm_Cons
-                      (?: (SCM_FALSEP path) t (Scm_Cons path t))
-                      (ref (-> vm stat) loadStat)))))))))
+(define-cproc %record-load-stat (kind path) ::<void> Scm__RecordLoadStat)
+
+;; read, timed if we're collecting load stats
+(define-cproc %load-read (port::<input-port>)
+  (let* ([vm::ScmVM* (Scm_VM)])
+    (if (SCM_VM_RUNTIME_FLAG_IS_SET vm SCM_COLLECT_LOAD_STATS)
+      (let* ([t0::ScmInt64 (Scm_MonotonicNanoseconds)]
+             [r (Scm_Read (SCM_OBJ port))])
+        (+= (ref (-> vm stat) loadReadTime)
+            (- (Scm_MonotonicNanoseconds) t0))
+        (return r))
+      (return (Scm_Read (SCM_OBJ port))))))
 
 (define-cproc %new-read-context-for-load ()
   (let* ([ctx::ScmReadContext* (Scm_MakeReadContext NULL)])
@@ -186,8 +186,12 @@
 ;; API
 (define-cproc dynamic-load (file::<string>
                             :key (init-function #f)
-                            (export-symbols #f)); for backward compatibility
-  (return (Scm_DynLoad file init_function 0)))
+                            (export-symbols #f) ; for backward compatibility
+                            (lazy #f))
+  (cond [(SCM_FALSEP lazy) (return (Scm_DynLoad file init_function 0))]
+        [else
+         (Scm_DefineDSOAutoload (Scm_CurrentModule) file init_function lazy)
+         (return SCM_TRUE)]))
 
 ;; API
 (define-cproc provide (feature)   Scm_Provide)
@@ -248,6 +252,10 @@
 (define-cproc %delete-load-path-hook! (proc)
   ::<void> Scm_DeleteLoadPathHook)
 
+;; Directory listing cache for find-load-file.  See load.c.
+(define-cproc %load-path-dir-listing (dir::<string>) Scm_LoadPathDirListing)
+(define-cproc %load-path-cache-clear! () ::<void> Scm_LoadPathDirCacheClear)
+
 ;; API: find-load-file
 ;;
 ;;   Core function to search specified file from the search path *PATH.
@@ -301,11 +309,48 @@
       (list found '())
       (and error-if-not-found
            (errorf "cannot find ~s to load" stem))))
+  ;; For relative search, we first consult the directory listing cache
+  ;; so that we only stat the candidates that do exist.  FILENAME is
+  ;; split into the subdirectory part and the basename.
+  (define slash (string-scan-right filename #\/ 'index))
+  (define subdir (and slash (substring filename 0 slash)))
+  (define basename (if slash
+                     (substring filename (+ slash 1) (string-length filename))
+                     filename))
+  (define candidates
+    (cons basename (map (^s (string-append basename s)) suffixes)))
+  ;; Returns the found filename, #f if it surely isn't in DIR, or
+  ;; 'unknown if the cache can't tell.
+  (define (try-listing dir)
+    (if (or (member basename '("" "." "..")) (equal? subdir ""))
+      'unknown
+      (let* ([d (if subdir (string-append dir "/" subdir) dir)]
+             [tab (%load-path-dir-listing d)])
+        (cond [(hash-table? tab)
+               (any (^n (and (hash-table-exists? tab n)
+                             (let1 file (string-append d "/" n)
+                               (and (file-ok? file) file))))
+                    candidates)]
+              ;; D isn't a directory.  If that's the load path directory
+              ;; itself, it still may be an archive.
+              [(not tab)
+               (if (and subdir (hash-table? (%load-path-dir-listing dir)))
+                 #f
+                 'unknown)]
+              [else 'unknown]))))
   (define (do-relative ps)
     (cond
      [(null? ps)
       (and error-if-not-found
            (errorf "cannot find ~s in ~s" filename paths))]
+     [(try-listing (car ps))
+      => (^[found]
+           (if (eq? found 'unknown)
+             (do-relative-probe ps)
+             (list found (cdr ps))))]
+     [else (do-relative (cdr ps))]))
+  (define (do-relative-probe ps)
+    (cond
      [(file-is-directory? (car ps))
       (if-let1 found (try-suffixes (string-append (car ps) "/" filename))
         (list found (cdr ps))
@@ -468,16 +513,115 @@
 
 ;; API
 (define-cproc gc-stat ()
-  (return
-   (list
-    (list ':total-heap-size
-          (Scm_MakeIntegerFromUI (cast u_long (GC_get_heap_size))))
-    (list ':free-bytes
-          (Scm_MakeIntegerFromUI (cast u_long (GC_get_free_bytes))))
-    (list ':bytes-since-gc
-          (Scm_MakeIntegerFromUI (cast u_long (GC_get_bytes_since_gc))))
-    (list ':total-bytes
-          (Scm_MakeIntegerFromUI (cast u_long (GC_get_total_bytes)))))))
+  (let* ([markers::int 1]
+         [pauses (Scm_GCPauseSummary)])
+    (.if "defined(GC_THREADS)"
+         (set! markers (+ (GC_get_parallel) 1)))
+    (return
+     (list
+      (list ':total-heap-size
+            (Scm_MakeIntegerFromUI (cast u_long (GC_get_heap_size))))
+      (list ':free-bytes
+            (Scm_MakeIntegerFromUI (cast u_long (GC_get_free_bytes))))
+      (list ':bytes-since-gc
+            (Scm_MakeIntegerFromUI (cast u_long (GC_get_bytes_since_gc))))
+      (list ':total-bytes
+            (Scm_MakeIntegerFromUI (cast u_long (GC_get_total_bytes))))
+      (list ':gc-count
+            (Scm_MakeIntegerFromUI (cast u_long (GC_get_gc_no))))
+      (list ':pause-count (SCM_CAR pauses))
+      (list ':max-pause (SCM_CDR pauses))
+      (list ':free-space-divisor
+            (Scm_MakeIntegerFromUI (cast u_long (GC_get_free_space_divisor))))
+      (list ':full-frequency (SCM_MAKE_INT (GC_get_full_freq)))
+      (list ':time-limit
+            (?: (== (GC_get_time_limit) GC_TIME_UNLIMITED)
+                ':unlimited
+                (Scm_MakeIntegerFromUI (GC_get_time_limit))))
+      (list ':parallel-markers (SCM_MAKE_INT markers))))))
+
+;; API
+(define-cproc gc-configure! (:key (incremental #f)
+                                  (free-space-divisor #f)
+                                  (full-frequency #f)
+                                  (max-heap-size #f)
+                                  (time-limit #f))
+  ::<void>
+  (let* ([params::ScmGCParameters])
+    (set! (ref params incremental) (?: (SCM_FALSEP incremental) -1 1))
+    (set! (ref params freeSpaceDivisor) -1)
+    (set! (ref params fullFrequency) -1)
+    (set! (ref params maxHeapSize) -1)
+    (set! (ref params timeLimit) -1)
+    (unless (SCM_FALSEP free-space-divisor)
+      (unless (and (SCM_INTP free-space-divisor)
+                   (> (SCM_INT_VALUE free-space-divisor) 0))
+        (SCM_TYPE_ERROR free-space-divisor "positive fixnum"))
+      (set! (ref params freeSpaceDivisor) (SCM_INT_VALUE free-space-divisor)))
+    (unless (SCM_FALSEP full-frequency)
+      (unless (and (SCM_INTP full-frequency)
+                   (>= (SCM_INT_VALUE full-frequency) 0))
+        (SCM_TYPE_ERROR full-frequency "nonnegative fixnum"))
+      (set! (ref params fullFrequency) (SCM_INT_VALUE full-frequency)))
+    (unless (SCM_FALSEP max-heap-size)
+      (unless (and (SCM_INTEGERP max-heap-size)
+                   (>= (Scm_Sign max-heap-size) 0))
+        (SCM_TYPE_ERROR max-heap-size "nonnegative integer"))
+      (set! (ref params maxHeapSize)
+            (Scm_GetIntegerClamp max-heap-size SCM_CLAMP_HI NULL)))
+    (cond [(SCM_FALSEP time-limit)]
+          [(SCM_EQ time-limit ':unlimited)
+           (set! (ref params timeLimit) GC_TIME_UNLIMITED)]
+          [(and (SCM_INTP time-limit) (>= (SCM_INT_VALUE time-limit) 0)
+                (< (SCM_INT_VALUE time-limit) GC_TIME_UNLIMITED))
+           (set! (ref params timeLimit) (SCM_INT_VALUE time-limit))]
+          [else (SCM_TYPE_ERROR time-limit "nonnegative fixnum or :unlimited")])
+    (Scm_GCConfigure (& params))))
+
+;; API
+(define-cproc gc-pause-histogram () Scm_GCPauseHistogram)
+(define-cproc gc-pause-log () Scm_GCPauseLog)
+(define-cproc gc-reset-pause-stats! () ::<void> Scm_GCPauseReset)
+
+;; Allocation arena.  See core.c
+(inline-stub
+ (define-cclass <allocation-arena> "ScmAllocArena*" "Scm_AllocArenaClass"
+   (c "SCM_CLASS_DEFAULT_CPL")
+   ()
+   (printer (Scm_Printf port "#<allocation-arena %p>" obj)))
+ )
+
+;; API
+(define-cproc current-allocation-arena ()
+  (let* ([a::ScmAllocArena* (-> (Scm_VM) allocArena)])
+    (return (?: a (SCM_OBJ a) '#f))))
+(define-cproc allocation-arena-stats (arena::<allocation-arena>)
+  Scm_AllocArenaStats)
+
+(select-module gauche.internal)
+(define-cproc %make-allocation-arena (chunk-size::<fixnum>)
+  (when (<= chunk-size 0) (SCM_TYPE_ERROR chunk-size "positive fixnum"))
+  (return (SCM_OBJ (Scm_MakeAllocArena chunk-size))))
+(define-cproc %allocation-arena-enter! (arena::<allocation-arena>) ::<void>
+  Scm_AllocArenaEnter)
+(define-cproc %allocation-arena-leave! (arena::<allocation-arena>) ::<void>
+  Scm_AllocArenaLeave)
+(define-cproc %allocation-arena-copy-out (arena::<allocation-arena> obj)
+  Scm_AllocArenaCopyOut)
+
+(select-module gauche)
+;; API
+;; Atomic objects allocated while THUNK runs are bump-allocated from
+;; the arena's chunks.  The results are copied out of the arena.
+(define (with-allocation-arena thunk :key (chunk-size 65536) (copy-out #t))
+  (let1 arena (%make-allocation-arena chunk-size)
+    (dynamic-wind
+      (^[] (%allocation-arena-enter! arena))
+      (^[] (receive rs (thunk)
+             (if copy-out
+               (apply values (map (cut %allocation-arena-copy-out arena <>) rs))
+               (apply values rs))))
+      (^[] (%allocation-arena-leave! arena)))))
 
 (select-module gauche.internal)
 ;; for diagnostics
@@ -557,6 +701,22 @@
   (:optional (vm::<thread> (c "SCM_OBJ(Scm_VM())")))
   (return (Scm_VMGetStackLite vm)))
 
+;; API
+;; Runtime statistics.  See Scm_VMStats in vm.c for the keys.
+(define-cproc vm-collect-stats!
+  (flag::<boolean> :optional (vm::<thread> (c "SCM_OBJ(Scm_VM())"))) ::<void>
+  (Scm_VMCollectStats vm flag))
+
+;; API
+(define-cproc vm-stats
+  (:optional (vm::<thread> (c "SCM_OBJ(Scm_VM())")))
+  (return (Scm_VMStats vm)))
+
+;; API
+(define-cproc vm-reset-stats!
+  (:optional (vm::<thread> (c "SCM_OBJ(Scm_VM())"))) ::<void>
+  (Scm_VMResetStats vm))
+
 (define (%vm-show-stack-trace trace :key
                                     (port (current-output-port))
                                     (maxdepth 0)
@@ -568,6 +728,9 @@
 (select-module gauche.internal)
 (define-cproc %vm-get-insn-offsets () Scm__VMInsnOffsets)
 
+;; Used by gauche.metrics.  Returns all live VMs.
+(define-cproc %vm-all-vms () Scm__VMAllVMs)
+
 ;; This is also called from C's Scm_ShowStackTrace
 ;; TRACE is what vm-get-stack-trace-lite returns.
 ;; Be careful not to depend on autoloaded functions.
@@ -639,6 +802,24 @@
           (ref loc initialValue) init-value)
     (return (Scm_ParameterSet (Scm_VM) (& loc) new-value))))
 
+;; LOCS is a list of (index . init-value), VALS is a list of new values.
+;; Used by parameterize for parameters without filter and hooks.
+(define-cproc %vm-parameterize (locs::<list> vals::<list> thunk)
+  (let* ([num::int (Scm_Length locs)]
+         [lv::ScmParameterLoc* (SCM_NEW_ARRAY (ScmParameterLoc) num)]
+         [vv::ScmObj* (SCM_NEW_ARRAY (ScmObj) num)]
+         [n::int 0])
+    (unless (== (Scm_Length vals) num)
+      (Scm_Error "parameter and value lists don't match: %S vs %S" locs vals))
+    (for-each (lambda (l)
+                (set! (ref (aref lv n) index) (SCM_INT_VALUE (SCM_CAR l))
+                      (ref (aref lv n) initialValue) (SCM_CDR l)
+                      (aref vv n) (SCM_CAR vals)
+                      vals (SCM_CDR vals))
+                (post++ n))
+              locs)
+    (return (Scm__VMParameterize num lv vv thunk))))
+
 ;; TRANSIENT
 ;; For the backward compatibility---files precompiled by 0.9.2 or before
 ;; can contain reference to the old API (as the result of expansion of
@@ -473,8 +473,26 @@
         [locking? (with-port-locking port formatter args port ctrl)]
         [else (formatter args port ctrl)]))
 
+;; Cache of compiled formatters, so that a format string computed at
+;; runtime isn't parsed every time.  It is a direct-mapped table indexed
+;; by the hash of the format string; each entry is (fmtstr . formatter)
+;; and is replaced as a whole, so no lock is needed.  The key is a
+;; private copy of the format string, thus mutating the original string
+;; doesn't affect the cache.
+(define *formatter-cache* (make-vector 64 #f))
+
+(define (formatter-compile/cache fmtstr)
+  (let* ([i (modulo (default-hash fmtstr) (vector-length *formatter-cache*))]
+         [e (vector-ref *formatter-cache* i)])
+    (if (and e (string=? (car e) fmtstr))
+      (cdr e)
+      (let* ([key (string-copy fmtstr)]
+             [formatter (formatter-compile key)])
+        (vector-set! *formatter-cache* i (cons key formatter))
+        formatter))))
+
 (define (format-2 shared? out control fmtstr args)
-  (let1 formatter (formatter-compile fmtstr)
+  (let1 formatter (formatter-compile/cache fmtstr)
     (case out
       [(#t)
        (call-formatter shared? #t formatter (current-output-port) control args)]
@@ -508,3 +526,83 @@
 ;; API
 (define-in-module gauche (format . args) (format-1 #f args))
 (define-in-module gauche (format/ss . args) (format-1 #t args))
+
+;; Compile-time expansion
+;; When format is called with a literal format string that consists of
+;; only plain text, ~a, ~s, ~d, ~% and ~~ without parameters and flags,
+;; we expand the call into a sequence of display/write calls, so that
+;; no parsing is done at runtime.  The expander is attached to format
+;; in libomega.scm, since the compiler isn't initialized yet here.
+;; If the format string can't be handled, or the number of arguments
+;; doesn't match, we leave the form untouched so that the runtime
+;; reports the error as before.
+
+;; Returns a list of nodes or #f.  Node = String | A | S | D
+(define (format-simple-nodes fmtstr)
+  (define (simple tree)
+    (match tree
+      [(? string?) tree]
+      [((and (or 'A 'S 'D) d) ()) d]
+      [_ #f]))
+  (and-let* ([tree (guard (e [else #f])
+                     (formatter-parse (formatter-lex fmtstr)))]
+             [nodes (cond [(null? tree) '()]
+                          [(eq? (car tree) 'Seq) (cdr tree)]
+                          [else (list tree)])]
+             [simples (map simple nodes)]
+             [ (every identity simples) ])
+    simples))
+
+(define (format-inliner form rename compare)
+  (define (expand dest fmtstr args)
+    (let* ([nodes (format-simple-nodes fmtstr)]
+           [nargs (and nodes (count symbol? nodes))])
+      (if (and nodes (= nargs (length args)))
+        (let ([temps (map (^_ (gensym)) args)]
+              [port (gensym)])
+          (define (body)
+            (let loop ([nodes nodes] [temps temps] [r '()])
+              (match nodes
+                [() (reverse r)]
+                [((? string? s) . nodes)
+                 (loop nodes temps (cons `(,(rename 'display) ,s ,port) r))]
+                [('A . nodes)
+                 (loop nodes (cdr temps)
+                       (cons `(,(rename 'display) ,(car temps) ,port) r))]
+                [('S . nodes)
+                 (loop nodes (cdr temps)
+                       (cons `(,(rename 'write) ,(car temps) ,port) r))]
+                [('D . nodes)
+                 (let1 t (car temps)
+                   (loop nodes (cdr temps)
+                         (cons `(,(rename 'display)
+                                 (,(rename 'if) (,(rename 'exact?) ,t)
+                                  (,(rename 'number->string) ,t)
+                                  ,t)
+                                 ,port)
+                               r)))])))
+          (define (locked)
+            `(,(rename 'with-port-locking) ,port
+              (,(rename 'lambda) () ,@(body))))
+          `(,(rename 'let) ,(map list temps args)
+            ,(case dest
+               [(#f) `(,(rename 'let) ([,port (,(rename 'open-output-string))])
+                       ,@(body)
+                       (,(rename 'get-output-string) ,port))]
+               [(#t) `(,(rename 'let) ([,port (,(rename 'current-output-port))])
+                       ,(locked))]
+               [else
+                ;; DEST may be a write-controls or an unusual object;
+                ;; we only handle ports, and leave others to the runtime.
+                `(,(rename 'let) ([,port ,dest])
+                  (,(rename 'if) (,(rename 'port?) ,port)
+                   ,(locked)
+                   ((,(rename 'with-module) gauche.format format-1)
+                    #f (,(rename 'list) ,port ,fmtstr ,@temps))))])))
+        form)))
+  (match form
+    [(_ (? string? fmtstr) . args) (expand #f fmtstr args)]
+    [(_ (? boolean? dest) (? string? fmtstr) . args) (expand dest fmtstr args)]
+    [(_ (? (^x (or (string? x) (boolean? x)))) . _) form]
+    [(_ dest (? string? fmtstr) . args) (expand dest fmtstr args)]
+    [_ form]))
@@ -144,6 +144,10 @@
   (if flag
     (logior= (SCM_PORT_FLAGS port) SCM_PORT_CASE_FOLD)
     (logand= (SCM_PORT_FLAGS port) (lognot SCM_PORT_CASE_FOLD))))
+(define-cproc port-make-private! (port::<port>) ::<void>
+  Scm_PortMakePrivate)
+(define-cproc port-cork! (port::<output-port>) ::<void> Scm_PortCork)
+(define-cproc port-uncork! (port::<output-port>) ::<void> Scm_PortUncork)
 
 ;;
 ;; Open and close
@@ -185,7 +189,8 @@
 (define-cproc %open-input-file (path::<string>
                                 :key (if-does-not-exist :error)
                                 (buffering #f)
-                                (element-type :character))
+                                (element-type :character)
+                                (mapped #f))
   (let* ([ignerr::int FALSE])
     (cond [(SCM_FALSEP if-does-not-exist) (set! ignerr TRUE)]
           [(not (SCM_EQ if-does-not-exist ':error))
@@ -193,8 +198,10 @@
                           if-does-not-exist)])
     (let* ([bufmode::int (Scm_BufferingMode buffering SCM_PORT_INPUT
                                             SCM_PORT_BUFFER_FULL)]
-           [o (Scm_OpenFilePort (Scm_GetStringConst path)
-                                O_RDONLY bufmode 0)])
+           [o (?: (SCM_FALSEP mapped)
+                  (Scm_OpenFilePort (Scm_GetStringConst path)
+                                    O_RDONLY bufmode 0)
+                  (Scm_OpenMappedFilePort (Scm_GetStringConst path)))])
       (when (and (SCM_FALSEP o) (not (%open/allow-noexist? ignerr)))
         (Scm_SysError "couldn't open input file: %S" path))
       (return o))))
@@ -238,6 +245,21 @@
         (Scm_Error "couldn't open output file: %S" path))
       (return o))))
 
+;; Used by copy-port.  Moves data between two file ports by the
+;; descriptors.  Returns #f if the ports can't be handled so.
+(define-cproc %copy-file-port (src::<input-port> dst::<output-port>
+                               limit::<fixnum>)
+  (let* ([r::ScmSmallInt (Scm_CopyFilePort src dst limit)])
+    (return (?: (< r 0) SCM_FALSE (SCM_MAKE_INT r)))))
+;; Used by text.tree.  Writes the string and symbol leaves of TREE in
+;; batches; other leaves are passed to FALLBACK along with PORT.
+(define-cproc %write-tree (tree port::<output-port> fallback) ::<void>
+  (Scm__WriteTree tree port fallback))
+
+;; Used by gauche.metrics.
+(define-cproc %active-buffered-port-count () ::<int>
+  Scm__ActiveBufferedPortCount)
+
 ;; Open port from fd
 (select-module gauche)
 
@@ -333,8 +355,11 @@
 (define-cproc open-input-string (string::<string> :key (private?::<boolean> #f))
   Scm_MakeInputStringPort)
 
-(define-cproc open-output-string (:key (private?::<boolean> #f))
-  Scm_MakeOutputStringPort)
+(define-cproc open-output-string (:key (private?::<boolean> #f)
+                                       (initial-capacity::<fixnum> 0))
+  (unless (and (<= 0 initial-capacity) (<= initial-capacity SCM_STRING_MAX_SIZE))
+    (Scm_Error "initial-capacity out of range: %ld" initial-capacity))
+  (return (Scm_MakeOutputStringPortWithCapacity initial-capacity private?)))
 
 (define-cproc get-output-string (oport::<output-port>) ;SRFI-6
   (return (Scm_GetOutputString oport 0)))
@@ -342,9 +367,21 @@
 (define-cproc get-output-byte-string (oport::<output-port>)
   (return (Scm_GetOutputString oport SCM_STRING_INCOMPLETE)))
 
+(define-cproc reset-output-string! (oport::<output-port>) ::<void>
+  (Scm_ResetOutputString oport FALSE))
+
+;; Used by with-output-to-string, which doesn't use the port afterwards.
+(define-cproc %get-output-string/recycle (oport::<output-port>)
+  (let* ([r (Scm_TakeOutputString oport 0)])
+    (Scm_ResetOutputString oport TRUE)
+    (return r)))
+
 (define-cproc get-remaining-input-string (iport::<input-port>)
   (return (Scm_GetRemainingInputString iport 0)))
 
+(define-cproc get-remaining-input-bytes (iport::<input-port>)
+  Scm_GetRemainingInputBytes)
+
 ;; Coding aware port
 (select-module gauche)
 
@@ -509,6 +546,40 @@
       (Scm_ReadError port "read-line: encountered illegal byte sequence: %S" r))
     (return r)))
 
+;; Reads a line into the preallocated BUF[start,end), without allocating
+;; a string.  Returns the number of bytes stored and a boolean telling
+;; whether the whole line fit.
+(define-cproc read-line-into! (buf::<u8vector>
+                               :optional (port::<input-port>
+                                          (current-input-port))
+                                         (start::<fixnum> 0)
+                                         (end::<fixnum> -1))
+  ::(<top> <top>)
+  (SCM_UVECTOR_CHECK_MUTABLE buf)
+  (let* ([size::ScmSmallInt (SCM_U8VECTOR_SIZE buf)])
+    (SCM_CHECK_START_END start end size))
+  (let* ([complete::int 0]
+         [n::ScmSmallInt
+          (Scm_ReadLineBytes port
+                             (+ (cast char* (SCM_U8VECTOR_ELEMENTS buf)) start)
+                             (- end start)
+                             (& complete))])
+    (if (< n 0)
+      (return SCM_EOF SCM_TRUE)
+      (return (SCM_MAKE_INT n) (SCM_MAKE_BOOL complete)))))
+
+;; Fills VEC[start,end) with lines read from PORT, locking the port once.
+(define-cproc read-lines-into-vector! (vec::<vector>
+                                       :optional (port::<input-port>
+                                                  (current-input-port))
+                                                 (start::<fixnum> 0)
+                                                 (end::<fixnum> -1))
+  ::<fixnum>
+  (let* ([size::ScmSmallInt (SCM_VECTOR_SIZE vec)])
+    (SCM_CHECK_START_END start end size))
+  (return (Scm_ReadLines port (+ (SCM_VECTOR_ELEMENTS vec) start)
+                         (- end start))))
+
 (define (read-string n :optional (port (current-input-port)))
   (define o (open-output-string :private? #t))
   (let loop ([i 0])
@@ -625,6 +696,12 @@
 (define-in-module gauche read-with-shared-structure read)
 (define-in-module gauche read/ss read)
 
+;; binary serialization (serial.c)
+(select-module gauche)
+(define-cproc read-serialized (:optional (port::<input-port>
+                                          (current-input-port)))
+  (return (Scm_ReadSerialized port)))
+
 ;; srfi-105
 (select-module gauche.internal)
 (define (%xform-cexpr cex)
@@ -725,6 +802,11 @@
                                  :optional (port (current-output-port)))
   ::<int> (return (Scm_WriteLimited obj port SCM_WRITE_WRITE limit)))
 
+(define-cproc write-serialized (obj :optional (port::<output-port>
+                                               (current-output-port))
+                                    (shared::<boolean> #t))
+  ::<void> (Scm_WriteSerialized obj port shared))
+
 (define write* write-shared)
 
 (define-cproc flush (:optional (oport::<output-port> (current-output-port)))
@@ -897,7 +979,7 @@
 (define-in-module gauche (with-output-to-string thunk)
   (let1 out (open-output-string)
     (with-output-to-port out thunk)
-    (get-output-string out)))
+    (%get-output-string/recycle out)))
 
 (define-in-module gauche (with-input-from-string str thunk)
   (with-input-from-port (open-input-string str) thunk))
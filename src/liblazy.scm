@@ -61,6 +61,8 @@
 (select-module gauche.internal)
 
 (define-cproc %make-lazy-pair (item generator) Scm_MakeLazyPair)
+(define-cproc %make-chunked-lazy-pair (item generator chunk::<fixnum> policy)
+  Scm_MakeChunkedLazyPair)
 
 (define-cproc %decompose-lazy-pair (obj) :: (<top> <top>)
   (let* ([item] [generator])
@@ -98,6 +100,24 @@
         (%make-lazy-pair item (car args))
         (cons item (rec (car args) (cdr args)))))))
 
+;; generator->chunked-lseq generator :optional policy
+;;  POLICY is either a positive fixnum, the fixed number of items realized
+;;  at once, or a procedure that takes the size of the previous chunk
+;;  (0 for the first) and returns the size of the next one.
+(define-in-module gauche (generator->chunked-lseq gen :optional (policy 32))
+  (receive (chunk proc)
+      (if (procedure? policy)
+        (values (policy 0) policy)
+        (values policy #f))
+    (let1 r (gen)
+      (if (eof-object? r)
+        '()
+        (%make-chunked-lazy-pair r gen chunk proc)))))
+
+;; Chunk size for the lazy sequences of numbers.  Generating them has
+;; no side effects, so there's no harm in realizing them ahead.
+(define-constant *numeric-lseq-chunk* 32)
+
 ;; For convenience.
 (define-in-module gauche (lrange start :optional (end +inf.0) (step 1))
   ;; Exact numbers.  Fast way.
@@ -122,8 +142,11 @@
   (cond [(or (and (> step 0) (>= start end))
              (and (< step 0) (<= start end))) '()]
         [(= step 0) (generator->lseq (^[] start))]
-        [(and (exact? start) (exact? step)) (generator->lseq start gen-exacts)]
-        [else (generator->lseq (inexact start) gen-inexacts)]))
+        [(and (exact? start) (exact? step))
+         (%make-chunked-lazy-pair start gen-exacts *numeric-lseq-chunk* #f)]
+        [else
+         (%make-chunked-lazy-pair (inexact start) gen-inexacts
+                                  *numeric-lseq-chunk* #f)]))
 
 (define-in-module gauche (liota :optional (count +inf.0) (start 0) (step 1))
   (let1 count (if (< count 0) +inf.0 count) ; like stream-iota
@@ -140,7 +163,7 @@
             (^[] (if (<= count 0)
                    (eof-object)
                    (rlet1 v (+ start (* k step)) (inc! k) (dec! count))))))))
-    (generator->lseq gen)))
+    (generator->chunked-lseq gen *numeric-lseq-chunk*)))
 
 (define-in-module gauche (port->char-lseq :optional (port (current-input-port)))
   (generator->lseq (cut read-char port)))
@@ -65,6 +65,49 @@
 (define-cproc set-box! (b::<box> v) ::<void> (SCM_BOX_SET b v))
 (export box box? unbox set-box!)
 
+;; Atomic boxes
+;; Operations on these boxes are atomic, so they can be shared among
+;; threads without a mutex.  The names follow srfi-230.  See box.c for
+;; the memory ordering.
+(select-module gauche)
+(inline-stub
+ (define-type <atomic-box> "ScmAtomicBox*" "atomic box"
+   "SCM_ATOMIC_BOXP" "SCM_ATOMIC_BOX" "SCM_OBJ")
+ (define-type <atomic-fxbox> "ScmAtomicBox*" "atomic fxbox"
+   "SCM_ATOMIC_FXBOXP" "SCM_ATOMIC_BOX" "SCM_OBJ")
+ )
+
+(define-cproc make-atomic-box (v) Scm_MakeAtomicBox)
+(define-cproc atomic-box? (v) ::<boolean> SCM_ATOMIC_BOXP)
+(define-cproc atomic-box-ref (b::<atomic-box>) Scm_AtomicBoxRef)
+(define-cproc atomic-box-set! (b::<atomic-box> v) ::<void> Scm_AtomicBoxSet)
+(define-cproc atomic-box-swap! (b::<atomic-box> v) Scm_AtomicBoxSwap)
+(define-cproc atomic-box-compare-and-swap! (b::<atomic-box> expected desired)
+  Scm_AtomicBoxCompareAndSwap)
+
+(define-cproc make-atomic-fxbox (n::<fixnum>) Scm_MakeAtomicFxbox)
+(define-cproc atomic-fxbox? (v) ::<boolean> SCM_ATOMIC_FXBOXP)
+(define-cproc atomic-fxbox-ref (b::<atomic-fxbox>) Scm_AtomicBoxRef)
+(define-cproc atomic-fxbox-set! (b::<atomic-fxbox> n::<fixnum>) ::<void>
+  (Scm_AtomicBoxSet b (SCM_MAKE_INT n)))
+(define-cproc atomic-fxbox-swap! (b::<atomic-fxbox> n::<fixnum>)
+  (return (Scm_AtomicBoxSwap b (SCM_MAKE_INT n))))
+(define-cproc atomic-fxbox-compare-and-swap! (b::<atomic-fxbox>
+                                              expected::<fixnum>
+                                              desired::<fixnum>)
+  (return (Scm_AtomicBoxCompareAndSwap b (SCM_MAKE_INT expected)
+                                       (SCM_MAKE_INT desired))))
+(define-cproc atomic-fxbox+/fetch! (b::<atomic-fxbox> n::<fixnum>)
+  (return (Scm_AtomicFxboxFetchAdd b n)))
+(define-cproc atomic-fxbox-/fetch! (b::<atomic-fxbox> n::<fixnum>)
+  (return (Scm_AtomicFxboxFetchAdd b (- n))))
+(define-cproc atomic-fxbox-and/fetch! (b::<atomic-fxbox> n::<fixnum>)
+  (return (Scm_AtomicFxboxFetchLogop b SCM_ATOMIC_AND n)))
+(define-cproc atomic-fxbox-ior/fetch! (b::<atomic-fxbox> n::<fixnum>)
+  (return (Scm_AtomicFxboxFetchLogop b SCM_ATOMIC_IOR n)))
+(define-cproc atomic-fxbox-xor/fetch! (b::<atomic-fxbox> n::<fixnum>)
+  (return (Scm_AtomicFxboxFetchLogop b SCM_ATOMIC_XOR n)))
+
 ;; Debug label
 (select-module gauche)
 (define-cproc debug-label (obj) (result (Scm_Sprintf "@%lx" obj)))
@@ -65,8 +65,9 @@
                (rlet1 obj (allocate-instance class initargs)
                  (initialize obj initargs)))]
       [body  (^[class initargs next-method]
-               (rlet1 obj (allocate-instance class initargs)
-                 (initialize obj initargs)))])
+               (or (%make-fast class initargs)
+                   (rlet1 obj (allocate-instance class initargs)
+                     (initialize obj initargs))))])
   (add-method! make
                (%make <method>
                       :generic make
@@ -207,6 +208,9 @@
      (return (Scm_MakeNextMethod (SCM_GENERIC gf) methods argv argc
                                  FALSE FALSE))))
 
+ ;; Returns #f if CLASS has custom allocate-instance or initialize method.
+ (define-cproc %make-fast (class::<class> initargs) Scm__VMMakeFast)
+
  (define-cproc %method-code (method::<method>)
    (if (-> method func)
      (return SCM_FALSE)
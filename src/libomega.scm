@@ -73,6 +73,12 @@
               (car src-info) (cadr src-info) expr)
       (format port "    While compiling: ~,,,,90:s\n" expr))))
 
+;; Compile-time expansion of format with a literal format string.
+;; This is here instead of libfmt.scm, for the compiler needs to be
+;; initialized to attach an inliner.
+((with-module gauche.internal %bind-inline-er-transformer)
+ (find-module 'gauche) 'format (with-module gauche.format format-inliner))
+
 ;; Built-in comparators.  These are here instead of libcmp.scm, for
 ;; hash functions need to be defined before this.
 ;; NB: These are in srfi-114 but not in srfi-128.  We provide them
@@ -211,14 +211,30 @@
 ;;;
 
 (select-module gauche)
-(define-cproc profiler-start () ::<void> Scm_ProfilerStart)
+(define-cproc profiler-start (:key (stack-depth::<fixnum> 0)
+                                   (all-threads::<boolean> #f)
+                                   (allocation-interval::<fixnum> 0))
+  ::<void>
+  (Scm_ProfilerSetAllocationInterval allocation-interval)
+  (if all-threads
+    (Scm_ProfilerStartAllThreads stack-depth)
+    (Scm_ProfilerStartWithStack stack-depth)))
 (define-cproc profiler-stop  () ::<int>  Scm_ProfilerStop)
 (define-cproc profiler-reset () ::<void> Scm_ProfilerReset)
 
+(define-cproc lock-profiler-start () ::<void> Scm_LockProfilerStart)
+(define-cproc lock-profiler-stop  () ::<void> Scm_LockProfilerStop)
+(define-cproc lock-profiler-reset () ::<void> Scm_LockProfilerReset)
+
 (select-module gauche.internal)
 ;; Autoloaded profiler-get-result will use this.
 ;; See lib/gauche/vm/profiler.scm
 (define-cproc profiler-raw-result () Scm_ProfilerRawResult)
+(define-cproc profiler-raw-stacks () Scm_ProfilerRawStacks)
+(define-cproc profiler-raw-result-all-threads ()
+  Scm_ProfilerRawResultAllThreads)
+;; Autoloaded lock-profiler-get-result will use this.
+(define-cproc lock-profiler-raw-result () Scm_LockProfilerRawResult)
 
 ;;;
 ;;; Introspection
@@ -41,7 +41,8 @@
 
 (define-cproc string->regexp (str::<string> :key (case-fold #f))
   (let* ([flags::int (?: (SCM_BOOL_VALUE case-fold) SCM_REGEXP_CASE_FOLD 0)])
-    (return (Scm_RegComp str flags))))
+    (return (Scm_RegCompCached str flags))))
+(define-cproc regexp-cache-stats () Scm_RegCompCacheStats)
 (define-cproc regexp-ast (regexp::<regexp>) (return (-> regexp ast)))
 (define-cproc regexp-case-fold? (regexp::<regexp>) ::<boolean>
   (return (logand (-> regexp flags) SCM_REGEXP_CASE_FOLD)))
@@ -57,13 +58,30 @@
 (define-cproc regexp-named-groups (regexp::<regexp>)
   (return (-> regexp grpNames)))
 
-(define-cproc rxmatch (regexp str::<string>)
+(define-cproc rxmatch (regexp input :optional (start::<fixnum> 0)
+                                               (end::<fixnum> -1))
   (let* ([rx::ScmRegexp* NULL])
-    (cond [(SCM_STRINGP regexp) (set! rx (SCM_REGEXP (Scm_RegComp
+    (cond [(SCM_STRINGP regexp) (set! rx (SCM_REGEXP (Scm_RegCompCached
                                                       (SCM_STRING regexp) 0)))]
           [(SCM_REGEXPP regexp) (set! rx (SCM_REGEXP regexp))]
           [else (SCM_TYPE_ERROR regexp "regexp")])
-    (return (Scm_RegExec rx str))))
+    (cond [(SCM_STRINGP input)
+           (return (Scm_RegExecRange rx (SCM_STRING input) start end))]
+          [(SCM_U8VECTORP input)
+           (return (Scm_RegExecBytes rx input start end))]
+          [else (SCM_TYPE_ERROR input "string or u8vector")
+                (return SCM_UNDEFINED)])))
+
+;; Regexp sets
+(define-cproc make-regexp-set (regexps) Scm_MakeRegexpSet)
+(define-cproc regexp-set? (obj) ::<boolean> SCM_REGEXP_SET_P)
+(define-cproc regexp-set-matches (set::<regexp-set> str::<string>)
+  Scm_RegexpSetMatches)
+(define-cproc regexp-set-regexps (set::<regexp-set>)
+  (let* ([h '()] [t '()])
+    (dotimes [i (-> set numRegexps)]
+      (SCM_APPEND1 h t (SCM_OBJ (aref (-> set regexps) i))))
+    (return h)))
 
 (inline-stub
  (define-cise-stmt rxmatchop
@@ -77,6 +77,12 @@
                                      suffix, or prefix")])
     (return (Scm_StringJoin strs delim gm))))
 
+;; Expansion targets of string interpolation (see lib/gauche/interpolate.scm)
+(define-cproc %string-interpolate-concat (:rest args)
+  Scm_StringInterpolateConcat)
+(define-cproc %string-interpolate-write (port::<output-port> :rest args)
+  ::<void> (Scm_StringInterpolateWrite args port))
+
 (define-reader-ctor 'string-interpolate
   (^ args
     (apply string-interpolate args))) ;;lambda is required to delay loading
@@ -117,6 +123,12 @@
 (define-cproc %maybe-substring (str::<string> :optional start end)
   Scm_MaybeSubstring)
 
+;; Used by srfi-13 string-pad and string-pad-right
+(define-cproc %string-pad (str::<string> len::<fixnum> pad::<char>
+                           right::<boolean>
+                           :optional (start::<fixnum> 0) (end::<fixnum> -1))
+  Scm_StringPad)
+
 ;; bound argument is for srfi-13
 (define-cproc %hash-string (str::<string> :optional bound) ::<ulong>
   (let* ([modulo::u_long 0])
@@ -60,6 +60,30 @@
 (select-module gauche)
 (define-cproc sys-readdir (pathname::<string>) Scm_ReadDirectory)
 
+;; Directory stream.  PARENT, if given, is a <sys-dir> the PATHNAME is
+;; relative to.
+(inline-stub
+ (define-type <sys-dir> "ScmSysDir*")
+
+ (define-cproc sys-opendir (pathname::<string> :optional parent)
+   (cond [(SCM_UNBOUNDP parent) (return (Scm_OpenDirectory pathname NULL))]
+         [(SCM_SYS_DIR_P parent)
+          (return (Scm_OpenDirectory pathname (SCM_SYS_DIR parent)))]
+         [else (SCM_TYPE_ERROR parent "<sys-dir>") (return SCM_UNDEFINED)]))
+
+ ;; Returns name and type, or EOF and #f.
+ (define-cproc sys-readdir-entry (dir::<sys-dir>) ::(<top> <top>)
+   (let* ([type SCM_FALSE]
+          [name (Scm_ReadDirectoryEntry dir (& type))])
+     (return name type)))
+
+ (define-cproc sys-closedir (dir::<sys-dir>) ::<void> Scm_CloseDirectory)
+
+ (define-cproc sys-dir-stat (dir::<sys-dir> name::<string>
+                             :optional (follow::<boolean> #t))
+   (return (Scm_DirectoryStat dir name follow)))
+ )
+
 ;; Bonus
 
 (define-cproc sys-normalize-pathname (pathname::<string>
@@ -372,6 +396,15 @@
     (make <sys-sigset>)
     (apply sys-sigset-add! (make <sys-sigset>) signals)))
 
+;; Signal fd.  MASK is a <sys-sigset>, a signal number or a list of them.
+(define-cproc %sys-signal-fd (mask::<sys-sigset>) ::<int> Scm_MakeSignalFd)
+(define (sys-signal-fd mask)
+  (%sys-signal-fd (if (is-a? mask <sys-sigset>)
+                    mask
+                    (apply sys-sigset (if (list? mask) mask (list mask))))))
+(define-cproc sys-read-signal-fd (fd::<int>) Scm_ReadSignalFd)
+(define-cproc sys-close-signal-fd (fd::<int>) ::<void> Scm_CloseSignalFd)
+
 ;;---------------------------------------------------------------------
 ;; stdio.h
 
@@ -664,6 +697,20 @@
                 (when (< r 0) (Scm_SysError "fstat failed for %d" fd))
                 (return (SCM_OBJ s))])))
 
+;; Batched versions.  PATHS is a list or a vector of pathnames, and the
+;; result is a vector, whose element is #f where the operation failed.
+;; The operations run on THREADS helper threads (0 to choose).
+(define-cproc sys-stat-batch (paths :key (follow-link?::<boolean> #t)
+                                         (threads::<int> 0))
+  (unless (or (SCM_LISTP paths) (SCM_VECTORP paths))
+    (SCM_TYPE_ERROR paths "list or vector"))
+  (return (Scm_SysStatBatch paths follow-link? threads)))
+
+(define-cproc sys-read-file-batch (paths :key (threads::<int> 0))
+  (unless (or (SCM_LISTP paths) (SCM_VECTORP paths))
+    (SCM_TYPE_ERROR paths "list or vector"))
+  (return (Scm_ReadFileBatch paths threads)))
+
 (define-cproc file-exists? (path::<const-cstring>) ::<boolean>
   (let* ([r::int])
     (SCM_SYSCALL r (access path F_OK))
@@ -772,6 +819,12 @@
 (define-cproc current-microseconds ()   ;EXPERIMENTAL
   ::<long> Scm_CurrentMicroseconds)
 
+;; These don't allocate on 64-bit platforms.  Take differences.
+(define-cproc monotonic-nanoseconds ()
+  (return (Scm_MakeInteger64 (Scm_MonotonicNanoseconds))))
+(define-cproc cycle-counter () ::<fixnum> Scm_CycleCounter)
+(define-cproc cycle-counter-frequency () ::<double> Scm_CycleCounterFrequency)
+
 ;; Returns #f and #f if the system doesn't provide monotonic time.
 (define-cproc sys-clock-gettime-monotonic () ::(<top> <top>)
   (let* ([sec::u_long] [nsec::u_long]
@@ -929,10 +982,13 @@
                                  args::<list>
                                  :key (iomap ()) (sigmask::<sys-sigset>? #f)
                                  (directory::<string>? #f)
-                                 (detached::<boolean> #f))
+                                 (detached::<boolean> #f)
+                                 (spawn::<boolean> #t))
   (let* ([flags::u_int SCM_EXEC_WITH_FORK])
     (when detached
       (set! flags (logior flags SCM_EXEC_DETACHED)))
+    (unless spawn
+      (set! flags (logior flags SCM_EXEC_NO_SPAWN)))
     (return (Scm_SysExec command args iomap sigmask directory flags))))
 
 (define-cproc sys-getcwd () Scm_GetCwd)
@@ -1294,6 +1350,52 @@
    (initcode (Scm_AddFeature "gauche.sys.select" NULL))
    ) ;; when defined(HAVE_SELECT)
  )
+;;---------------------------------------------------------------------
+;; poller
+
+(inline-stub
+ (define-type <sys-poller> "ScmSysPoller*")
+
+ (when "defined(GAUCHE_HAVE_SYS_POLLER)"
+   ;; Edge-triggered mode isn't available with the poll(2) backend.
+   (define-cproc make-sys-poller (:key (edge-triggered::<boolean> #f))
+     (return (Scm_MakeSysPoller (?: edge-triggered SCM_SYS_POLLER_EDGE 0))))
+
+   ;; FLAGS is a list of r, w and/or x.  Error conditions are always
+   ;; reported; x just keeps PORT-OR-FD registered without r nor w.
+   ;; An empty list removes PORT-OR-FD.
+   (define-cproc sys-poller-set! (poller::<sys-poller> pf flags::<list>)
+     ::<void>
+     (let* ([fd::int (Scm_GetPortFd pf TRUE)]
+            [events::int 0])
+       (dolist [f flags]
+         (cond [(or (SCM_EQ f 'r) (SCM_EQ f 'read))
+                (logior= events SCM_SYS_POLL_READ)]
+               [(or (SCM_EQ f 'w) (SCM_EQ f 'write))
+                (logior= events SCM_SYS_POLL_WRITE)]
+               [(or (SCM_EQ f 'x) (SCM_EQ f 'exception))
+                (logior= events SCM_SYS_POLL_ERROR)]
+               [else (Scm_Error "invalid flag %S, must be r, w or x" f)]))
+       (Scm_SysPollerSet poller fd events)))
+
+   ;; Returns a list of (fd flag ...), where flag is r, w or x.
+   (define-cproc sys-poller-wait (poller::<sys-poller> :optional (timeout #f))
+     (let* ([r (Scm_SysPollerWait poller timeout)])
+       (dolist [p r]
+         (let* ([e::int (SCM_INT_VALUE (SCM_CDR p))]
+                [fl SCM_NIL])
+           (when (logand e SCM_SYS_POLL_ERROR) (set! fl (Scm_Cons 'x fl)))
+           (when (logand e SCM_SYS_POLL_WRITE) (set! fl (Scm_Cons 'w fl)))
+           (when (logand e SCM_SYS_POLL_READ) (set! fl (Scm_Cons 'r fl)))
+           (SCM_SET_CDR p fl)))
+       (return r)))
+
+   (define-cproc sys-poller-close (poller::<sys-poller>) ::<void>
+     Scm_SysPollerClose)
+
+   (initcode (Scm_AddFeature "gauche.sys.poller" NULL))
+   ) ;; when defined(GAUCHE_HAVE_SYS_POLLER)
+ )
 
 ;;---------------------------------------------------------------------
 ;; miscellaneous
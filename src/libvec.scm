@@ -133,6 +133,82 @@
           (set! j (+ j k))))
       (return dst))))
 
+;; Single-vector kernels of vector-map, vector-map! and vector-for-each
+;; (see lib/gauche/vecutil.scm).  If PROC is a subr that Scm_ApplyRec
+;; calls directly, we just loop in C.  Otherwise we call PROC through
+;; continuation frames, so that we don't re-enter the VM per element.
+;; data[0] proc, [1] vector, [2] index, [3] mode, [4] accumulated results
+;; (for VEC_WALK_MAP).  The results are kept in a list and copied into
+;; a fresh vector at the end, so that the vectors returned earlier aren't
+;; mutated when PROC's continuation is reinvoked.
+(select-module gauche.internal)
+(inline-stub
+ (declcode
+  "#define VEC_WALK_MAP      0  /* vector-map */"
+  "#define VEC_WALK_UPDATE   1  /* vector-map! */"
+  "#define VEC_WALK_FOR_EACH 2  /* vector-for-each */")
+
+ (define-cfn vector-walk1-result (r len::ScmSmallInt) :static
+   (let* ([v (Scm_MakeVector len SCM_UNDEFINED)]
+          [k::ScmSmallInt len])
+     (while (> k 0)
+       (pre-- k)
+       (set! (SCM_VECTOR_ELEMENT v k) (SCM_CAR r)
+             r (SCM_CDR r)))
+     (return v)))
+
+ (define-cfn vector-walk1-cc (result data::void**) :static
+   (let* ([proc (SCM_OBJ (aref data 0))]
+          [v (SCM_OBJ (aref data 1))]
+          [i::ScmSmallInt (cast ScmSmallInt (cast intptr_t (aref data 2)))]
+          [mode::int (cast int (cast intptr_t (aref data 3)))]
+          [r (SCM_OBJ (aref data 4))])
+     (cond [(== mode VEC_WALK_MAP) (set! r (Scm_Cons result r))]
+           [(== mode VEC_WALK_UPDATE) (set! (SCM_VECTOR_ELEMENT v i) result)])
+     (pre++ i)
+     (when (>= i (SCM_VECTOR_SIZE v))
+       (if (== mode VEC_WALK_MAP)
+         (return (vector-walk1-result r i))
+         (return SCM_UNDEFINED)))
+     (set! (aref data 2) (cast void* (cast intptr_t i))
+           (aref data 4) r)
+     (Scm_VMPushCC vector-walk1-cc data 5)
+     (return (Scm_VMApply1 proc (SCM_VECTOR_ELEMENT v i)))))
+
+ (define-cfn vector-walk1 (proc v::ScmVector* mode::int) :static
+   (let* ([len::ScmSmallInt (SCM_VECTOR_SIZE v)])
+     (when (== len 0)
+       (if (== mode VEC_WALK_MAP)
+         (return (Scm_MakeVector 0 SCM_UNDEFINED))
+         (return SCM_UNDEFINED)))
+     (when (SCM_SUBR_IMMEDIATE_P proc)
+       (let* ([rv (?: (== mode VEC_WALK_MAP)
+                      (Scm_MakeVector len SCM_UNDEFINED)
+                      (SCM_OBJ v))]
+              [i::ScmSmallInt 0])
+         (for [() (< i len) (pre++ i)]
+              (let* ([e (Scm_ApplyRec1 proc (SCM_VECTOR_ELEMENT v i))])
+                (unless (== mode VEC_WALK_FOR_EACH)
+                  (set! (SCM_VECTOR_ELEMENT rv i) e))))
+         (if (== mode VEC_WALK_MAP) (return rv) (return SCM_UNDEFINED))))
+     (let* ([data::(.array void* [5])])
+       (set! (aref data 0) proc
+             (aref data 1) v
+             (aref data 2) (cast void* 0)
+             (aref data 3) (cast void* (cast intptr_t mode))
+             (aref data 4) SCM_NIL)
+       (Scm_VMPushCC vector-walk1-cc data 5)
+       (return (Scm_VMApply1 proc (SCM_VECTOR_ELEMENT v 0))))))
+
+ (define-cproc %vector-map1 (proc v::<vector>)
+   (return (vector-walk1 proc v VEC_WALK_MAP)))
+ (define-cproc %vector-map1! (proc v::<vector>)
+   (return (vector-walk1 proc v VEC_WALK_UPDATE)))
+ (define-cproc %vector-for-each1 (proc v::<vector>)
+   (return (vector-walk1 proc v VEC_WALK_FOR_EACH)))
+ )
+(select-module scheme)
+
 (define (vector->string v :optional (start 0) (end -1)) ;;R7RS
   (list->string (vector->list v start end))) ; TODO: can be more efficient
 (define (string->vector s :optional (start 0) (end -1)) ;;R7RS
@@ -39,10 +39,19 @@
 #include "gauche/priv/readerP.h"
 #include "gauche/priv/portP.h"
 #include "gauche/priv/moduleP.h"
+#include "gauche/priv/probeP.h"
 
 #include <ctype.h>
 #include <fcntl.h>
 
+/* Directory listing cache for load path lookup is only used where
+   file names are compared exactly; on case-insensitive filesystems
+   a listing can't answer whether "Foo.scm" would be found. */
+#if !defined(GAUCHE_WINDOWS) && !defined(__CYGWIN__) && !defined(__APPLE__)
+#define USE_LOAD_PATH_DIR_CACHE 1
+#include <dirent.h>
+#endif
+
 /*
  * Load file.
  */
@@ -56,6 +65,10 @@ static struct {
     ScmGloc *load_path_hooks_rec; /* *load-path-hooks*   */
     ScmInternalMutex path_mutex;
 
+    /* Directory listing cache */
+    ScmHashTable *dir_cache;     /* dirname -> #(mtime ino names) */
+    ScmInternalMutex dir_cache_mutex;
+
     /* Provided features */
     ScmObj provided;            /* List of provided features. */
     ScmObj providing;           /* Alist of features that is being loaded,
@@ -87,6 +100,11 @@ static struct {
     ScmInternalMutex dso_mutex;
 } ldinfo = { (ScmGloc*)&ldinfo, };  /* trick to put ldinfo in .data section */
 
+/* symbols used for load statistics; see Scm__RecordLoadStat */
+static ScmObj sym_load = SCM_UNBOUND;
+static ScmObj sym_dso  = SCM_UNBOUND;
+static ScmObj sym_end  = SCM_UNBOUND;
+
 /* keywords used for load and load-from-port surbs */
 static ScmObj key_error_if_not_found = SCM_UNBOUND;
 static ScmObj key_macro              = SCM_UNBOUND;
@@ -348,6 +366,97 @@ void Scm_DeleteLoadPathHook(ScmObj proc)
     (void)SCM_INTERNAL_MUTEX_UNLOCK(ldinfo.path_mutex);
 }
 
+/*------------------------------------------------------------------
+ * Directory listing cache
+ *
+ *   Searching a relative filename through *load-path* tries every
+ *   directory with every suffix, most of which fail.  On a network
+ *   filesystem those failed stat()s dominate startup time.  Instead,
+ *   find-load-file asks for the listing of each directory and only
+ *   stats the candidate that is known to exist.
+ *
+ *   Scm_LoadPathDirListing returns a string hash table whose keys
+ *   are the entry names in DIR, #f if DIR isn't a directory, or the
+ *   symbol `unknown' if we can't tell (the caller should probe the
+ *   filesystem as before).  A listing is reused as long as the mtime
+ *   and inode of DIR are unchanged.  A directory modified within the
+ *   last couple of seconds isn't cached, for an entry added in the
+ *   same mtime tick wouldn't invalidate the listing.
+ *   The returned table is never modified once it is registered, so
+ *   the caller can look it up without locking.
+ */
+
+static ScmObj sym_unknown = SCM_UNBOUND;
+
+#define DIR_CACHE_RACY_SECONDS 2
+
+#if defined(USE_LOAD_PATH_DIR_CACHE)
+static ScmObj read_dir_names(const char *path)
+{
+    DIR *dirp = opendir(path);
+    if (dirp == NULL) return SCM_FALSE;
+    ScmObj tab = Scm_MakeHashTableSimple(SCM_HASH_STRING, 0);
+    struct dirent *dire;
+    while ((dire = readdir(dirp)) != NULL) {
+        Scm_HashTableSet(SCM_HASH_TABLE(tab),
+                         SCM_MAKE_STR_COPYING(dire->d_name), SCM_TRUE, 0);
+    }
+    closedir(dirp);
+    return tab;
+}
+#endif /*USE_LOAD_PATH_DIR_CACHE*/
+
+ScmObj Scm_LoadPathDirListing(ScmString *dir)
+{
+#if defined(USE_LOAD_PATH_DIR_CACHE)
+    const char *path = Scm_GetStringConst(dir);
+    struct stat st;
+    int r;
+
+    SCM_SYSCALL(r, stat(path, &st));
+    if (r < 0 || !S_ISDIR(st.st_mode)) return SCM_FALSE;
+
+    ScmObj mtime = Scm_MakeInteger64((ScmInt64)st.st_mtime);
+    ScmObj ino = Scm_MakeIntegerU64((ScmUInt64)st.st_ino);
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(ldinfo.dir_cache_mutex);
+    ScmObj e = Scm_HashTableRef(ldinfo.dir_cache, SCM_OBJ(dir), SCM_FALSE);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(ldinfo.dir_cache_mutex);
+
+    if (SCM_VECTORP(e)
+        && Scm_NumEq(SCM_VECTOR_ELEMENT(e, 0), mtime)
+        && Scm_NumEq(SCM_VECTOR_ELEMENT(e, 1), ino)) {
+        return SCM_VECTOR_ELEMENT(e, 2);
+    }
+
+    if (time(NULL) - st.st_mtime < DIR_CACHE_RACY_SECONDS) return sym_unknown;
+
+    ScmObj names = read_dir_names(path);
+    if (SCM_FALSEP(names)) return sym_unknown;
+
+    e = Scm_MakeVector(3, SCM_FALSE);
+    SCM_VECTOR_ELEMENT(e, 0) = mtime;
+    SCM_VECTOR_ELEMENT(e, 1) = ino;
+    SCM_VECTOR_ELEMENT(e, 2) = names;
+    ScmObj key = Scm_CopyStringWithFlags(dir, SCM_STRING_IMMUTABLE,
+                                         SCM_STRING_IMMUTABLE);
+    (void)SCM_INTERNAL_MUTEX_LOCK(ldinfo.dir_cache_mutex);
+    Scm_HashTableSet(ldinfo.dir_cache, key, e, 0);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(ldinfo.dir_cache_mutex);
+    return names;
+#else  /*!USE_LOAD_PATH_DIR_CACHE*/
+    (void)dir;
+    return sym_unknown;
+#endif /*!USE_LOAD_PATH_DIR_CACHE*/
+}
+
+void Scm_LoadPathDirCacheClear(void)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(ldinfo.dir_cache_mutex);
+    Scm_HashCoreClear(SCM_HASH_TABLE_CORE(ldinfo.dir_cache));
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(ldinfo.dir_cache_mutex);
+}
+
 /*------------------------------------------------------------------
  * Dynamic linking
  */
@@ -417,6 +526,7 @@ typedef struct dlobj_initfn_rec {
     const char *name;           /* name of initfn (always w/ leading '_') */
     ScmDynLoadInitFn fn;        /* function ptr */
     int initialized;            /* TRUE once fn returns */
+    ScmVM *initializer;         /* The VM running fn, while it's running */
 } dlobj_initfn;
 
 struct ScmDLObjRec {
@@ -540,6 +650,7 @@ static dlobj_initfn *find_initfn(ScmDLObj *dlo, const char *name)
     fns->name = name;
     fns->fn = NULL;
     fns->initialized = FALSE;
+    fns->initializer = NULL;
     fns->next = dlo->initfns;
     dlo->initfns = fns;
     return fns;
@@ -604,6 +715,10 @@ static void call_initfn(ScmDLObj *dlo, const char *name)
     dlobj_initfn *ifn = find_initfn(dlo, name);
 
     if (ifn->initialized) return;
+    /* Recursive call from within fn, e.g. resolving a lazy autoload of
+       this DSO (see Scm_DefineDSOAutoload).  The caller sees the bindings
+       fn has defined so far. */
+    if (ifn->initializer == Scm_VM()) return;
 
     if (!ifn->fn) {
         /* locate initfn.  Name always has '_'.  Whether the actual
@@ -631,7 +746,11 @@ static void call_initfn(ScmDLObj *dlo, const char *name)
        loading right now.  However, if the code follows the Gauche's
        standard module structure, such circular dependency is detected
        by Scm_Load, so we don't worry about it here. */
-    ifn->fn();
+    ifn->initializer = Scm_VM();
+    SCM_UNWIND_PROTECT { ifn->fn(); }
+    SCM_WHEN_ERROR { ifn->initializer = NULL; SCM_NEXT_HANDLER; }
+    SCM_END_PROTECT;
+    ifn->initializer = NULL;
     ifn->initialized = TRUE;
 }
 
@@ -699,9 +818,17 @@ ScmObj Scm_DynLoad(ScmString *dsoname, ScmObj initfn, u_long flags/*reserved*/)
 
     /* Load the dlobj if necessary. */
     lock_dlobj(dlo);
+    int record =
+        SCM_VM_RUNTIME_FLAG_IS_SET(Scm_VM(), SCM_COLLECT_LOAD_STATS)
+        && !find_initfn(dlo, initname)->initialized;
+    if (record) Scm__RecordLoadStat(sym_dso, SCM_MAKE_STR_COPYING(dsopath));
     if (!dlo->loaded) {
         SCM_UNWIND_PROTECT { load_dlo(dlo); }
-        SCM_WHEN_ERROR { unlock_dlobj(dlo); SCM_NEXT_HANDLER; }
+        SCM_WHEN_ERROR {
+            if (record) Scm__RecordLoadStat(sym_end, SCM_FALSE);
+            unlock_dlobj(dlo);
+            SCM_NEXT_HANDLER;
+        }
         SCM_END_PROTECT;
     }
 
@@ -709,9 +836,14 @@ ScmObj Scm_DynLoad(ScmString *dsoname, ScmObj initfn, u_long flags/*reserved*/)
     SCM_ASSERT(dlo->loaded);
 
     SCM_UNWIND_PROTECT { call_initfn(dlo, initname); }
-    SCM_WHEN_ERROR { unlock_dlobj(dlo);  SCM_NEXT_HANDLER; }
+    SCM_WHEN_ERROR {
+        if (record) Scm__RecordLoadStat(sym_end, SCM_FALSE);
+        unlock_dlobj(dlo);
+        SCM_NEXT_HANDLER;
+    }
     SCM_END_PROTECT;
 
+    if (record) Scm__RecordLoadStat(sym_end, SCM_FALSE);
     unlock_dlobj(dlo);
     return SCM_TRUE;
 }
@@ -997,6 +1129,7 @@ ScmObj Scm_MakeAutoload(ScmModule *where,
     adata->module = where;
     adata->path = path;
     adata->import_from = import_from;
+    adata->dso_initfn = SCM_FALSE;
     adata->loaded = FALSE;
     adata->value = SCM_UNBOUND;
     (void)SCM_INTERNAL_MUTEX_INIT(adata->mutex);
@@ -1042,6 +1175,59 @@ void Scm_DefineAutoload(ScmModule *where,
     }
 }
 
+/* Lazy dynamic loading.
+   Instead of loading DSONAME now, each symbol in LIST is bound to
+   an autoload in WHERE, and the first reference to any of them loads
+   the DSO and calls its initfn.  If LIST is #t, the exported symbols of
+   WHERE that haven't got a binding (either in WHERE or in the modules
+   it imports) are used.  Symbols already bound in WHERE are left alone,
+   so it is harmless to call this after the DSO is loaded.
+
+   A symbol the initfn doesn't define becomes unbound again after
+   resolution, so the Scheme part of the module may define some of the
+   exported symbols itself. */
+void Scm_DefineDSOAutoload(ScmModule *where, ScmString *dsoname,
+                           ScmObj initfn, ScmObj list)
+{
+    int exported = SCM_TRUEP(list);
+    if (exported) list = Scm_ModuleExports(where);
+
+    ScmObj ep;
+    SCM_FOR_EACH(ep, list) {
+        ScmObj entry = SCM_CAR(ep);
+        if (!SCM_SYMBOLP(entry)) {
+            Scm_Error("dynamic-load: bad lazy symbol entry: %S", entry);
+        }
+        ScmSymbol *sym = SCM_SYMBOL(entry);
+        /* NB: A symbol isn't found with SCM_BINDING_STAY_IN_MODULE if
+           it has only an exported dummy binding without value. */
+        if (Scm_FindBinding(where, sym, SCM_BINDING_STAY_IN_MODULE)) continue;
+        /* An exported symbol visible via imports is a re-export. */
+        if (exported && Scm_FindBinding(where, sym, 0)) continue;
+        ScmObj a = Scm_MakeAutoload(where, sym, dsoname, NULL);
+        SCM_AUTOLOAD(a)->dso_initfn = SCM_STRINGP(initfn)? initfn : SCM_TRUE;
+        Scm_Define(where, sym, a);
+    }
+}
+
+/* Resolve an autoload made by Scm_DefineDSOAutoload.  Returns the value
+   of the binding, or SCM_UNBOUND if the DSO doesn't define it. */
+static ScmObj resolve_dso_autoload(ScmAutoload *adata)
+{
+    Scm_DynLoad(adata->path,
+                SCM_STRINGP(adata->dso_initfn)? adata->dso_initfn : SCM_FALSE,
+                0);
+    ScmGloc *g = Scm_FindBinding(adata->module, adata->name,
+                                 SCM_BINDING_STAY_IN_MODULE);
+    if (g == NULL) return SCM_UNBOUND;
+    ScmObj v = SCM_GLOC_GET(g);
+    if (SCM_EQ(v, SCM_OBJ(adata))) {
+        SCM_GLOC_SET(g, SCM_UNBOUND);
+        return SCM_UNBOUND;
+    }
+    if (SCM_AUTOLOADP(v)) return SCM_UNBOUND;
+    return v;
+}
 
 ScmObj Scm_ResolveAutoload(ScmAutoload *adata, int flags)
 {
@@ -1068,6 +1254,11 @@ ScmObj Scm_ResolveAutoload(ScmAutoload *adata, int flags)
                                  SCM_CMP_EQUAL))) {
         return SCM_UNBOUND;
     }
+    /* Likewise, the initfn of a lazily loaded DSO may refer to the
+       autoload that triggered loading it. */
+    if (!SCM_FALSEP(adata->dso_initfn) && adata->locker == vm) {
+        return SCM_UNBOUND;
+    }
 
     /* obtain the lock to load this autoload */
     (void)SCM_INTERNAL_MUTEX_LOCK(adata->mutex);
@@ -1104,37 +1295,41 @@ ScmObj Scm_ResolveAutoload(ScmAutoload *adata, int flags)
     }
 
     SCM_UNWIND_PROTECT {
-        do_require(SCM_OBJ(adata->path), SCM_LOAD_PROPAGATE_ERROR,
-                   adata->module, NULL);
-
-        if (adata->import_from) {
-            /* autoloaded file defines import_from module.  we need to
-               import the binding individually. */
-            ScmModule *m = Scm_FindModule(adata->import_from,
-                                          SCM_FIND_MODULE_QUIET);
-            if (m == NULL) {
-                Scm_Error("Trying to autoload module %S from file %S, but the file doesn't define such a module",
-                          adata->import_from, adata->path);
-            }
-            ScmGloc *f = Scm_FindBinding(SCM_MODULE(m), adata->name, 0);
-            ScmGloc *g = Scm_FindBinding(adata->module, adata->name, 0);
-            SCM_ASSERT(f != NULL);
-            SCM_ASSERT(g != NULL);
-            adata->value = SCM_GLOC_GET(f);
-            if (SCM_UNBOUNDP(adata->value) || SCM_AUTOLOADP(adata->value)) {
-                Scm_Error("Autoloaded symbol %S is not defined in the module %S",
-                          adata->name, adata->import_from);
-            }
-            SCM_GLOC_SET(g, adata->value);
+        if (!SCM_FALSEP(adata->dso_initfn)) {
+            adata->value = resolve_dso_autoload(adata);
         } else {
-            /* Normal import.  The binding must have been inserted to
-               adata->module */
-            ScmGloc *g = Scm_FindBinding(adata->module, adata->name, 0);
-            SCM_ASSERT(g != NULL);
-            adata->value = SCM_GLOC_GET(g);
-            if (SCM_UNBOUNDP(adata->value) || SCM_AUTOLOADP(adata->value)) {
-                Scm_Error("Autoloaded symbol %S is not defined in the file %S",
-                          adata->name, adata->path);
+            do_require(SCM_OBJ(adata->path), SCM_LOAD_PROPAGATE_ERROR,
+                       adata->module, NULL);
+
+            if (adata->import_from) {
+                /* autoloaded file defines import_from module.  we need to
+                   import the binding individually. */
+                ScmModule *m = Scm_FindModule(adata->import_from,
+                                              SCM_FIND_MODULE_QUIET);
+                if (m == NULL) {
+                    Scm_Error("Trying to autoload module %S from file %S, but the file doesn't define such a module",
+                              adata->import_from, adata->path);
+                }
+                ScmGloc *f = Scm_FindBinding(SCM_MODULE(m), adata->name, 0);
+                ScmGloc *g = Scm_FindBinding(adata->module, adata->name, 0);
+                SCM_ASSERT(f != NULL);
+                SCM_ASSERT(g != NULL);
+                adata->value = SCM_GLOC_GET(f);
+                if (SCM_UNBOUNDP(adata->value) || SCM_AUTOLOADP(adata->value)) {
+                    Scm_Error("Autoloaded symbol %S is not defined in the module %S",
+                              adata->name, adata->import_from);
+                }
+                SCM_GLOC_SET(g, adata->value);
+            } else {
+                /* Normal import.  The binding must have been inserted to
+                   adata->module */
+                ScmGloc *g = Scm_FindBinding(adata->module, adata->name, 0);
+                SCM_ASSERT(g != NULL);
+                adata->value = SCM_GLOC_GET(g);
+                if (SCM_UNBOUNDP(adata->value) || SCM_AUTOLOADP(adata->value)) {
+                    Scm_Error("Autoloaded symbol %S is not defined in the file %S",
+                              adata->name, adata->path);
+                }
             }
         }
     } SCM_WHEN_ERROR {
@@ -1149,6 +1344,70 @@ ScmObj Scm_ResolveAutoload(ScmAutoload *adata, int flags)
     return adata->value;
 }
 
+/*------------------------------------------------------------------
+ * Load statistics
+ *
+ *   When SCM_COLLECT_LOAD_STATS is set (gosh -pload), we record an
+ *   event at the beginning and the end of each load, into vm->stat.loadStat
+ *   in reverse order.  Each event is a vector
+ *
+ *     #(kind name time bytes read-time compile-time suspended)
+ *
+ *   KIND is `load' or `dso' at the beginning of loading NAME, and `end'
+ *   at the end of the innermost ongoing one.  TIME is in nanoseconds,
+ *   BYTES is the total bytes allocated so far, and READ-TIME and
+ *   COMPILE-TIME are cumulative counters kept in vm->stat.
+ *   The list is consumed by profiler-show-load-stats.
+ *
+ *   Since `use' loads the module while compiling the form, the time
+ *   of the compile is suspended during the nested load; SUSPENDED
+ *   remembers whether we need to resume it at the end.
+ */
+
+void Scm__RecordLoadStat(ScmObj kind, ScmObj name)
+{
+    ScmVM *vm = Scm_VM();
+#if defined(HAVE_SDT)
+    if (SCM_EQ(kind, sym_end)) {
+        SCM_PROBE0(load__done);
+    } else if (SCM_STRINGP(name)) {
+        const ScmStringBody *b = SCM_STRING_BODY(name);
+        SCM_PROBE2(load__start, SCM_STRING_BODY_START(b),
+                   (int)SCM_STRING_BODY_SIZE(b));
+    }
+#endif /*HAVE_SDT*/
+    if (!SCM_VM_RUNTIME_FLAG_IS_SET(vm, SCM_COLLECT_LOAD_STATS)) return;
+
+    ScmInt64 now = Scm_MonotonicNanoseconds();
+    int suspended = FALSE;
+    if (SCM_EQ(kind, sym_end)) {
+        if (SCM_PAIRP(vm->stat.loadStatOpen)) {
+            ScmObj e = SCM_CAR(vm->stat.loadStatOpen);
+            vm->stat.loadStatOpen = SCM_CDR(vm->stat.loadStatOpen);
+            if (!SCM_FALSEP(SCM_VECTOR_ELEMENT(e, 6))) {
+                vm->stat.loadCompileStart = now;
+            }
+        }
+    } else if (vm->stat.loadCompileStart > 0) {
+        vm->stat.loadCompileTime += now - vm->stat.loadCompileStart;
+        vm->stat.loadCompileStart = -1;
+        suspended = TRUE;
+    }
+
+    ScmObj e = Scm_MakeVector(7, SCM_FALSE);
+    SCM_VECTOR_ELEMENT(e, 0) = kind;
+    SCM_VECTOR_ELEMENT(e, 1) = name;
+    SCM_VECTOR_ELEMENT(e, 2) = Scm_MakeInteger64(now);
+    SCM_VECTOR_ELEMENT(e, 3) = Scm_MakeIntegerU(GC_get_total_bytes());
+    SCM_VECTOR_ELEMENT(e, 4) = Scm_MakeInteger64(vm->stat.loadReadTime);
+    SCM_VECTOR_ELEMENT(e, 5) = Scm_MakeInteger64(vm->stat.loadCompileTime);
+    SCM_VECTOR_ELEMENT(e, 6) = SCM_MAKE_BOOL(suspended);
+    vm->stat.loadStat = Scm_Cons(e, vm->stat.loadStat);
+    if (!SCM_EQ(kind, sym_end)) {
+        vm->stat.loadStatOpen = Scm_Cons(e, vm->stat.loadStatOpen);
+    }
+}
+
 /*------------------------------------------------------------------
  * Dynamic parameter access
  */
@@ -1231,6 +1490,7 @@ void Scm__InitLoad(void)
     (void)SCM_INTERNAL_MUTEX_INIT(ldinfo.prov_mutex);
     (void)SCM_INTERNAL_COND_INIT(ldinfo.prov_cv);
     (void)SCM_INTERNAL_MUTEX_INIT(ldinfo.dso_mutex);
+    (void)SCM_INTERNAL_MUTEX_INIT(ldinfo.dir_cache_mutex);
 
     key_error_if_not_found = SCM_MAKE_KEYWORD("error-if-not-found");
     key_macro = SCM_MAKE_KEYWORD("macro");
@@ -1258,6 +1518,12 @@ void Scm__InitLoad(void)
                                     SCM_MAKE_STR("." SHLIB_SO_SUFFIX));
     ldinfo.dso_table = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_STRING,0));
     ldinfo.dso_prelinked = SCM_NIL;
+    ldinfo.dir_cache =
+        SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_STRING, 0));
+    sym_unknown = SCM_INTERN("unknown");
+    sym_load = SCM_INTERN("load");
+    sym_dso = SCM_INTERN("dso");
+    sym_end = SCM_INTERN("end");
 
 #define PARAM_INIT(var, name, val) Scm_DefinePrimitiveParameter(m, name, val, &ldinfo.var)
     PARAM_INIT(load_history, "current-load-history", SCM_NIL);
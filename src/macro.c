@@ -485,7 +485,13 @@ static ScmObj compile_rule1(ScmObj form,
     if (SCM_SYMBOLP(form)||SCM_IDENTIFIERP(form)) {
         if (isEllipsis(ctx, form)) BAD_ELLIPSIS(ctx);
         ScmObj q = id_memq(form, ctx->literals);
-        if (!SCM_FALSEP(q)) return q;
+        if (!SCM_FALSEP(q)) {
+            /* literals inserted by the template are renamed, too */
+            if (!patternp && SCM_FALSEP(Scm_Memq(q, ctx->tvars))) {
+                ctx->tvars = Scm_Cons(q, ctx->tvars);
+            }
+            return q;
+        }
 
         if (patternp) {
             return add_pvar(ctx, spat, form);
@@ -510,6 +516,21 @@ static ScmObj compile_rule1(ScmObj form,
     return form;
 }
 
+/* Record the shape of the toplevel pattern to the branch, so that
+   synrule_expand can reject a form with the wrong number of arguments
+   without running the matcher. */
+static void pattern_shape(ScmObj pattern, ScmSyntaxRuleBranch *branch)
+{
+    int n = 0, bounded = TRUE;
+    for (; SCM_PAIRP(pattern); pattern = SCM_CDR(pattern)) {
+        if (SCM_SYNTAX_PATTERN_P(SCM_CAR(pattern))) bounded = FALSE;
+        else n++;
+    }
+    branch->dotted = !SCM_NULLP(pattern);
+    branch->minLength = n;
+    branch->maxLength = (bounded && !branch->dotted)? n : -1;
+}
+
 /* compile rules into ScmSyntaxRules structure
    NB: We use ScmSyntaxPattern for the toplevel node of pattern and template;
    they are just a placeholders and they don't represent repetition. */
@@ -559,6 +580,14 @@ static ScmSyntaxRules *compile_rules(ScmObj name,
         sr->rules[i].template = SCM_OBJ(tmpl->pattern);
         sr->rules[i].numPvars = ctx.pvcnt;
         sr->rules[i].maxLevel = ctx.maxlev;
+        pattern_shape(sr->rules[i].pattern, &sr->rules[i]);
+
+        int ntvars = Scm_Length(ctx.tvars);
+        sr->rules[i].numTvars = ntvars;
+        sr->rules[i].tvars = SCM_NEW_ARRAY(ScmObj, ntvars);
+        for (int k = 0; k < ntvars; k++, ctx.tvars = SCM_CDR(ctx.tvars)) {
+            sr->rules[i].tvars[k] = SCM_CAR(ctx.tvars);
+        }
         if (ctx.pvcnt > sr->maxNumPvars) sr->maxNumPvars = ctx.pvcnt;
     }
     return sr;
@@ -750,8 +779,17 @@ static inline int match_subpattern(ScmObj form, ScmSyntaxPattern *pat,
                                    ScmObj rest, ScmObj mod, ScmObj env,
                                    MatchVar *mvec)
 {
-    /* TODO: If pat->numFollowingItems == 0, we don't need to calculate
-       length beforehand.  Some optimization opportunity. */
+    if (pat->numFollowingItems == 0) {
+        /* The subpattern eats up all the items; no need to count them. */
+        enter_subpattern(pat, mvec);
+        for (; SCM_PAIRP(form); form = SCM_CDR(form)) {
+            if (!match_synrule(SCM_CAR(form), pat->pattern, mod, env, mvec))
+                return FALSE;
+        }
+        exit_subpattern(pat, mvec);
+        return match_synrule(form, rest, mod, env, mvec);
+    }
+
     int limit = 0;
     for (ScmObj p = form; SCM_PAIRP(p); p = SCM_CDR(p)) {
         limit++;
@@ -850,10 +888,11 @@ static int match_synrule(ScmObj form, ScmObj pattern, ScmObj mod, ScmObj env,
 
 /* If a pattern variable is exhausted, SCM_UNDEFINED is returned. */
 static ScmObj realize_template_rec(ScmObj template,
+                                   ScmSyntaxRuleBranch *branch,
                                    MatchVar *mvec,
                                    int level,
                                    int *indices,
-                                   ScmObj *idlist,
+                                   ScmObj *renamed,
                                    int *exlev)
 {
     if (SCM_PAIRP(template)) {
@@ -861,18 +900,18 @@ static ScmObj realize_template_rec(ScmObj template,
         while (SCM_PAIRP(template)) {
             ScmObj e = SCM_CAR(template);
             if (SCM_SYNTAX_PATTERN_P(e)) {
-                ScmObj r = realize_template_rec(e, mvec, level, indices, idlist, exlev);
+                ScmObj r = realize_template_rec(e, branch, mvec, level, indices, renamed, exlev);
                 if (SCM_UNBOUNDP(r)) return r;
                 SCM_APPEND(h, t, r);
             } else {
-                ScmObj r = realize_template_rec(e, mvec, level, indices, idlist, exlev);
+                ScmObj r = realize_template_rec(e, branch, mvec, level, indices, renamed, exlev);
                 if (SCM_UNBOUNDP(r)) return r;
                 SCM_APPEND1(h, t, r);
             }
             template = SCM_CDR(template);
         }
         if (!SCM_NULLP(template)) {
-            ScmObj r = realize_template_rec(template, mvec, level, indices, idlist, exlev);
+            ScmObj r = realize_template_rec(template, branch, mvec, level, indices, renamed, exlev);
             if (SCM_UNBOUNDP(r)) return r;
             if (SCM_NULLP(h)) return r; /* (a ... . b) and a ... is empty */
             SCM_APPEND(h, t, r);
@@ -887,7 +926,7 @@ static ScmObj realize_template_rec(ScmObj template,
         ScmObj h = SCM_NIL, t = SCM_NIL;
         indices[level+1] = 0;
         for (;;) {
-            ScmObj r = realize_template_rec(pat->pattern, mvec, level+1, indices, idlist, exlev);
+            ScmObj r = realize_template_rec(pat->pattern, branch, mvec, level+1, indices, renamed, exlev);
             if (SCM_UNBOUNDP(r)) return (*exlev < pat->level)? r : h;
             SCM_APPEND1(h, t, r);
             indices[level+1]++;
@@ -900,11 +939,11 @@ static ScmObj realize_template_rec(ScmObj template,
 
         for (int i=0; i<len; i++, pe++) {
             if (SCM_SYNTAX_PATTERN_P(*pe)) {
-                ScmObj r = realize_template_rec(*pe, mvec, level, indices, idlist, exlev);
+                ScmObj r = realize_template_rec(*pe, branch, mvec, level, indices, renamed, exlev);
                 if (SCM_UNBOUNDP(r)) return r;
                 SCM_APPEND(h, t, r);
             } else {
-                ScmObj r = realize_template_rec(*pe, mvec, level, indices, idlist, exlev);
+                ScmObj r = realize_template_rec(*pe, branch, mvec, level, indices, renamed, exlev);
                 if (SCM_UNBOUNDP(r)) return r;
                 SCM_APPEND1(h, t, r);
             }
@@ -917,30 +956,41 @@ static ScmObj realize_template_rec(ScmObj template,
            (e.g. the macro definitions of "letrec" and "do" shown in R5RS
            use the fact that the symbol "newtemp" introduced in each
            iteration of macro expansion are distinct. */
-        ScmObj p = Scm_Assq(template, *idlist);
-        if (SCM_PAIRP(p)) return SCM_CDR(p);
-        else {
-            ScmObj id = Scm_WrapIdentifier(SCM_IDENTIFIER(template));
-            *idlist = Scm_Acons(template, id, *idlist);
-            return id;
+        /* The template identifiers are collected in branch->tvars at
+           the compile time, so the wrapped one can be memoized in the
+           slot of the same index. */
+        for (int i=0; i<branch->numTvars; i++) {
+            if (SCM_EQ(branch->tvars[i], template)) {
+                if (renamed[i] == NULL) {
+                    renamed[i] =
+                        Scm_WrapIdentifier(SCM_IDENTIFIER(template));
+                }
+                return renamed[i];
+            }
         }
+        return Scm_WrapIdentifier(SCM_IDENTIFIER(template));
     }
     return template;
 }
 
 #define DEFAULT_MAX_LEVEL  10
+#define DEFAULT_NUM_TVARS  32
 
 static ScmObj realize_template(ScmSyntaxRuleBranch *branch,
                                MatchVar *mvec)
 {
     int index[DEFAULT_MAX_LEVEL], *indices = index;
+    ScmObj renamed_buf[DEFAULT_NUM_TVARS], *renamed = renamed_buf;
     int exlev = 0;
-    ScmObj idlist = SCM_NIL;
 
     if (branch->maxLevel > DEFAULT_MAX_LEVEL)
         indices = SCM_NEW_ATOMIC2(int*, (branch->maxLevel+1) * sizeof(int));
     for (int i=0; i<=branch->maxLevel; i++) indices[i] = 0;
-    return realize_template_rec(branch->template, mvec, 0, indices, &idlist, &exlev);
+    if (branch->numTvars > DEFAULT_NUM_TVARS)
+        renamed = SCM_NEW_ARRAY(ScmObj, branch->numTvars);
+    for (int i=0; i<branch->numTvars; i++) renamed[i] = NULL;
+    return realize_template_rec(branch->template, branch, mvec, 0, indices,
+                                renamed, &exlev);
 }
 
 static ScmObj synrule_expand(ScmObj form, ScmObj mod, ScmObj env, ScmSyntaxRules *sr)
@@ -950,10 +1000,20 @@ static ScmObj synrule_expand(ScmObj form, ScmObj mod, ScmObj env, ScmSyntaxRules
 #ifdef DEBUG_SYNRULE
     Scm_Printf(SCM_CUROUT, "**** synrule_transform: %S\n", form);
 #endif
+    /* Count the arguments once to filter out branches by their shape. */
+    int nargs = 0;
+    ScmObj argp = SCM_CDR(form);
+    for (; SCM_PAIRP(argp); argp = SCM_CDR(argp)) nargs++;
+    int properp = SCM_NULLP(argp);
+
     for (int i=0; i<sr->numRules; i++) {
 #ifdef DEBUG_SYNRULE
         Scm_Printf(SCM_CUROUT, "pattern #%d: %S\n", i, sr->rules[i].pattern);
 #endif
+        if (nargs < sr->rules[i].minLength) continue;
+        if (sr->rules[i].maxLength >= 0 && nargs > sr->rules[i].maxLength)
+            continue;
+        if (!sr->rules[i].dotted && !properp) continue;
         init_matchvec(mvec, sr->rules[i].numPvars);
         if (match_synrule(SCM_CDR(form), sr->rules[i].pattern, mod, env, mvec)) {
 #ifdef DEBUG_SYNRULE
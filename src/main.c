@@ -47,6 +47,7 @@ int batch_mode = FALSE;         /* force batch mode */
 int interactive_mode = FALSE;   /* force interactive mode */
 int test_mode = FALSE;          /* add . and ../lib implicitly  */
 int profiling_mode = FALSE;     /* profile the script? */
+int lock_profiling_mode = FALSE; /* profile lock contention? */
 int stats_mode = FALSE;         /* collect stats (EXPERIMENTAL) */
 
 ScmObj pre_cmds = SCM_NIL;      /* assoc list of commands that needs to be
@@ -90,7 +91,7 @@ void usage(void)
             "           By default, the 'main' procedure in the user module is called\n"
             "           after loading the script (srfi-22).  This option allows to call\n"
             "           a main procedure in the different module.\n"
-            "  -p<type> Turns on the profiler.  <Type> can be 'time' or 'load'.\n"
+            "  -p<type> Turns on the profiler.  <Type> can be 'time', 'load' or 'lock'.\n"
             "  -F<feature> Makes <feature> available in cond-expand forms\n"
             "  -r<standard>  Starts gosh with the default environment defined\n"
             "           in RnRS, where n is determined by <standard>.  The following\n"
@@ -181,7 +182,7 @@ void further_options(const char *optarg)
     /* For development; not for public use */
     else if (strcmp(optarg, "collect-stats") == 0) {
         stats_mode = TRUE;
-        SCM_VM_RUNTIME_FLAG_SET(vm, SCM_COLLECT_VM_STATS);
+        Scm_VMCollectStats(vm, TRUE);
     }
     /* For development; not for public use */
     else if (strcmp(optarg, "no-combine-instructions") == 0) {
@@ -216,9 +217,12 @@ void profiler_options(const char *optarg)
     else if (strcmp(optarg, "load") == 0) {
         SCM_VM_RUNTIME_FLAG_SET(vm, SCM_COLLECT_LOAD_STATS);
     }
+    else if (strcmp(optarg, "lock") == 0) {
+        lock_profiling_mode = TRUE;
+    }
     else {
         fprintf(stderr, "unknown -p option: %s\n", optarg);
-        fprintf(stderr, "supported profiling options are: -ptime or -pload\n");
+        fprintf(stderr, "supported profiling options are: -ptime, -pload or -plock\n");
     }
 }
 
@@ -330,6 +334,13 @@ void cleanup_main(void *data)
                         NULL); /* ignore errors */
     }
 
+    if (lock_profiling_mode) {
+        Scm_LockProfilerStop();
+        Scm_EvalCString("(lock-profiler-show)",
+                        SCM_OBJ(Scm_GaucheModule()),
+                        NULL); /* ignore errors */
+    }
+
     /* EXPERIMENTAL */
     if (stats_mode) {
         fprintf(stderr, "\n;; Statistics (*: main thread only):\n");
@@ -645,6 +656,7 @@ int main(int ac, char **av)
         }
         Scm_ProfilerStart();
     }
+    if (lock_profiling_mode) Scm_LockProfilerStart();
     Scm_AddCleanupHandler(cleanup_main, NULL);
 
     if (default_toplevel_module != NULL) {
@@ -119,13 +119,38 @@
    a module is simply a bad idea and shouldn't be allowed.
  */
 
+/* Note on binding resolution cache
+ *
+ * Resolving a global identifier for the first time walks the imported
+ * modules and the module precedence list (search_binding).  Once the
+ * VM resolves it, GREF replaces the identifier in the code vector by
+ * the gloc, so the cost is only paid once per reference site.  However,
+ * freshly loaded or eval'ed code references the same set of bindings
+ * over and over, and each site pays the full search.
+ *
+ * So each module keeps a table of the resolved results of non-local
+ * searches.  Instead of tracking which module can see which binding,
+ * we keep a single global version number (modules.bindingVersion),
+ * which is incremented whenever an operation may change the result of
+ * the search---creating a new binding, turning a phantom binding into
+ * a real one, importing, exporting, hiding, aliasing and extending.
+ * A module's cache is discarded lazily when its version doesn't match.
+ * Those operations mostly happen while loading programs, and at runtime
+ * the version stays the same.
+ */
+
 /* Global module table */
 static struct {
     ScmHashTable *table;    /* Maps name -> module. */
     ScmInternalMutex mutex; /* Lock for table.  Only register_module and
                                lookup_module may hold the lock. */
+    u_long bindingVersion;  /* Incremented when a change may affect the
+                               result of binding search.  Protected by
+                               mutex. */
 } modules;
 
+#define BINDING_CHANGED()  (modules.bindingVersion++)
+
 /* Predefined modules - slots will be initialized by Scm__InitModule */
 #define DEFINE_STATIC_MODULE(cname) \
     static ScmModule cname = { { NULL } }
@@ -162,6 +187,8 @@ static void init_module(ScmModule *m, ScmObj name, ScmHashTable *internal)
     m->external = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
     m->origin = m->prefix = SCM_FALSE;
     m->sealed = FALSE;
+    m->resolved = NULL;
+    m->resolvedVersion = 0;
 }
 
 /* Internal */
@@ -390,6 +417,37 @@ static ScmGloc *search_binding(ScmModule *module, ScmSymbol *symbol,
     return NULL;
 }
 
+/* Common case of search; we look up from MODULE itself and all the modules
+   visible from it.  The module's own bindings are looked up directly;
+   the results of searching other modules are cached in module->resolved
+   (see the note at the top of this file).  Must be called while
+   modules.mutex is held. */
+static ScmGloc *search_binding_cached(ScmModule *module, ScmSymbol *symbol)
+{
+    ScmObj v = Scm_HashTableRef(module->internal, SCM_OBJ(symbol), SCM_FALSE);
+    if (SCM_GLOCP(v) && !SCM_GLOC_PHANTOM_BINDING_P(SCM_GLOC(v))) {
+        return SCM_GLOC(v);
+    }
+
+    if (module->resolved == NULL) {
+        module->resolved =
+            SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+        module->resolvedVersion = modules.bindingVersion;
+    } else if (module->resolvedVersion != modules.bindingVersion) {
+        Scm_HashCoreClear(SCM_HASH_TABLE_CORE(module->resolved));
+        module->resolvedVersion = modules.bindingVersion;
+    } else {
+        v = Scm_HashTableRef(module->resolved, SCM_OBJ(symbol), SCM_UNBOUND);
+        if (SCM_GLOCP(v)) return SCM_GLOC(v);
+        if (SCM_FALSEP(v)) return NULL;
+    }
+
+    ScmGloc *g = search_binding(module, symbol, FALSE, FALSE, FALSE);
+    Scm_HashTableSet(module->resolved, SCM_OBJ(symbol),
+                     g ? SCM_OBJ(g) : SCM_FALSE, 0);
+    return g;
+}
+
 ScmGloc *Scm_FindBinding(ScmModule *module, ScmSymbol *symbol, int flags)
 {
     int stay_in_module = flags&SCM_BINDING_STAY_IN_MODULE;
@@ -397,7 +455,12 @@ ScmGloc *Scm_FindBinding(ScmModule *module, ScmSymbol *symbol, int flags)
     ScmGloc *gloc = NULL;
 
     SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(modules.mutex);
-    gloc = search_binding(module, symbol, stay_in_module, external_only, FALSE);
+    if (!stay_in_module && !external_only) {
+        gloc = search_binding_cached(module, symbol);
+    } else {
+        gloc = search_binding(module, symbol, stay_in_module, external_only,
+                              FALSE);
+    }
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
     return gloc;
 }
@@ -442,7 +505,11 @@ ScmGloc *Scm_MakeBinding(ScmModule *module, ScmSymbol *symbol,
         if (Scm_GlocConstP(g))          prev_kind = SCM_BINDING_CONST;
         else if (Scm_GlocInlinableP(g)) prev_kind = SCM_BINDING_INLINABLE;
         oldval = g->value;
+        /* A phantom binding becomes real; the searches that have gone
+           through it may find a different gloc now. */
+        if (SCM_GLOC_PHANTOM_BINDING_P(g)) BINDING_CHANGED();
     } else {
+        BINDING_CHANGED();
         g = SCM_GLOC(Scm_MakeGloc(symbol, module));
         Scm_HashTableSet(module->internal, SCM_OBJ(symbol), SCM_OBJ(g), 0);
         /* If module is marked 'export-all', export this binding by default */
@@ -504,6 +571,7 @@ void Scm_HideBinding(ScmModule *module, ScmSymbol *symbol)
         ScmGloc *g = SCM_GLOC(Scm_MakeGloc(symbol, module));
         g->hidden = TRUE;
         Scm_HashTableSet(module->external, SCM_OBJ(symbol), SCM_OBJ(g), 0);
+        BINDING_CHANGED();
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
 
@@ -547,6 +615,7 @@ int Scm_AliasBinding(ScmModule *target, ScmSymbol *targetName,
     SCM_INTERNAL_MUTEX_SAFE_LOCK_BEGIN(modules.mutex);
     Scm_HashTableSet(target->external, SCM_OBJ(targetName), SCM_OBJ(g), 0);
     Scm_HashTableSet(target->internal, SCM_OBJ(targetName), SCM_OBJ(g), 0);
+    BINDING_CHANGED();
     SCM_INTERNAL_MUTEX_SAFE_LOCK_END();
     return TRUE;
 }
@@ -600,6 +669,7 @@ ScmObj Scm_ImportModule(ScmModule *module,
             break;
         }
         module->imported = p;
+        BINDING_CHANGED();
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
 
@@ -684,6 +754,7 @@ ScmObj Scm_ExportSymbols(ScmModule *module, ScmObj specs)
                              SCM_DICT_VALUE(e), 0);
         }
     }
+    BINDING_CHANGED();
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
 
     /* Now, if this export changes the meaning of exported symbols, we
@@ -723,6 +794,7 @@ ScmObj Scm_ExportAll(ScmModule *module)
                 (void)SCM_DICT_SET_VALUE(ee, SCM_DICT_VALUE(e));
             }
         }
+        BINDING_CHANGED();
     }
     (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
     return SCM_OBJ(module);
@@ -776,7 +848,10 @@ ScmObj Scm_ExtendModule(ScmModule *module, ScmObj supers)
     if (SCM_FALSEP(mpl)) {
         Scm_Error("can't extend those modules simultaneously because of inconsistent precedence lists: %S", supers);
     }
+    (void)SCM_INTERNAL_MUTEX_LOCK(modules.mutex);
     module->mpl = Scm_Cons(SCM_OBJ(module), mpl);
+    BINDING_CHANGED();
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(modules.mutex);
     return module->mpl;
 }
 
@@ -296,7 +296,7 @@ static void report_flonum_count(void *data)
 
 ScmObj Scm_MakeFlonum(double d)
 {
-    ScmFlonum *f = SCM_NEW(ScmFlonum);
+    ScmFlonum *f = SCM_NEW_ATOMIC(ScmFlonum);
     SCM_FLONUM_VALUE(f) = d;
 #ifdef COUNT_FLONUM_ALLOC
     flonum_count++;
@@ -2656,19 +2656,9 @@ ScmObj Scm_Gcd(ScmObj x, ScmObj y)
         return Scm_MakeIntegerU(ur);
     }
 
-    /* Now we need to treat both args as bignums.  We could use
-       Algorithm L in Knuth's TAOCP 4.5.2, but we assume this path
-       is rarely executed, so we don't bother for now. */
-    x = Scm_Abs(x);
-    y = Scm_Abs(y);
-    if (Scm_NumCmp(x, y) < 0) {ScmObj t = x; x = y; y = t;}
-
-    while (!SCM_EXACT_ZERO_P(y)) {
-        ScmObj r = Scm_Modulo(x, y, TRUE);
-        x = y;
-        y = r;
-    }
-    return x;
+    /* Now we need to treat both args as bignums. */
+    SCM_ASSERT(SCM_BIGNUMP(x) && SCM_BIGNUMP(y));
+    return Scm_BignumGcd(SCM_BIGNUM(x), SCM_BIGNUM(y));
 }
 
 /*===============================================================
@@ -3356,6 +3346,133 @@ static double raise_pow10(double x, int n)
     }
 }
 
+/*
+ * Fast path of flonum reader
+ *
+ * This implements Eisel-Lemire algorithm (Daniel Lemire, "Number Parsing
+ * at a Gigabyte per Second", Software: Practice and Experience 51(8),
+ * 2021).  Given a decimal significand W that fits in 64 bits and a decimal
+ * exponent Q, it finds the double closest to W*10^Q using a 128-bit
+ * truncated approximation of 10^Q.  In rare cases the approximation
+ * can't decide the rounding; then we fall back to algorithmR.
+ */
+#if !SCM_EMULATE_INT64
+#define EISEL_LEMIRE_FAST_PATH 1
+
+#define POW10_128_MIN  (-342)
+#define POW10_128_MAX  308
+
+/* pow10_128[q-POW10_128_MIN] = {hi, lo} of 10^q * 2^s truncated, where
+   s is chosen so that the MSB of hi is set. */
+static ScmUInt64 pow10_128[POW10_128_MAX-POW10_128_MIN+1][2];
+static int pow10_128_initialized = FALSE;
+
+/* floor(q * log2(10)), valid for |q| < 1500 or so. */
+static inline int floor_log2_pow10(int q)
+{
+    if (q >= 0) return (217706 * q) >> 16;
+    else        return -((-217706 * q + 65535) >> 16);
+}
+
+static void pow10_128_init(void)
+{
+    ScmObj mask = Scm_Sub(Scm_Ash(SCM_MAKE_INT(1), 64), SCM_MAKE_INT(1));
+    IEXPT10_INIT();
+    for (int q = POW10_128_MIN; q <= POW10_128_MAX; q++) {
+        ScmObj p;
+        if (q >= 0) {
+            p = Scm_Ash(iexpt10(q), 127 - floor_log2_pow10(q));
+        } else {
+            p = Scm_Quotient(Scm_Ash(SCM_MAKE_INT(1),
+                                     128 + floor_log2_pow10(-q)),
+                             iexpt10(-q), NULL);
+        }
+        pow10_128[q-POW10_128_MIN][0] =
+            Scm_GetIntegerU64Clamp(Scm_Ash(p, -64), SCM_CLAMP_NONE, NULL);
+        pow10_128[q-POW10_128_MIN][1] =
+            Scm_GetIntegerU64Clamp(Scm_LogAnd(p, mask), SCM_CLAMP_NONE, NULL);
+    }
+    pow10_128_initialized = TRUE;
+}
+
+#define POW10_128_INIT() \
+    do { if (!pow10_128_initialized) pow10_128_init(); } while (0)
+
+/* 64x64->128bit unsigned multiplication */
+static inline void umul64(ScmUInt64 a, ScmUInt64 b,
+                          ScmUInt64 *hi, ScmUInt64 *lo)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (ScmUInt64)(r >> 64);
+    *lo = (ScmUInt64)r;
+#else
+    const ScmUInt64 m32 = 0xffffffffULL;
+    ScmUInt64 a1 = a >> 32, a0 = a & m32, b1 = b >> 32, b0 = b & m32;
+    ScmUInt64 p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+    ScmUInt64 mid = (p00 >> 32) + (p01 & m32) + (p10 & m32);
+    *lo = (mid << 32) | (p00 & m32);
+    *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+/* Returns TRUE and sets *RESULT to the double closest to W*10^Q, or
+   returns FALSE if we can't decide it quickly. */
+static int eisel_lemire(ScmUInt64 w, int q, double *result)
+{
+    if (w == 0) {
+        *result = 0.0;
+        return TRUE;
+    }
+    if (q < POW10_128_MIN || q > POW10_128_MAX) return FALSE;
+    POW10_128_INIT();
+
+    /* Normalize w so that its MSB is set. */
+    int clz = 0;
+    while (!(w & 0xff00000000000000ULL)) { w <<= 8; clz += 8; }
+    while (!(w & 0x8000000000000000ULL)) { w <<= 1; clz++; }
+    int e2 = floor_log2_pow10(q) + 64 + 1023 - clz;
+
+    /* Multiply by the upper half of 10^q, and if the lower bits can
+       affect the result, by the lower half as well. */
+    const ScmUInt64 *t = pow10_128[q - POW10_128_MIN];
+    ScmUInt64 xhi, xlo;
+    umul64(w, t[0], &xhi, &xlo);
+    if ((xhi & 0x1ff) == 0x1ff && xlo + w < w) {
+        ScmUInt64 yhi, ylo;
+        umul64(w, t[1], &yhi, &ylo);
+        ScmUInt64 mhi = xhi, mlo = xlo + yhi;
+        if (mlo < xlo) mhi++;
+        if ((mhi & 0x1ff) == 0x1ff && mlo + 1 == 0 && ylo + w < w) {
+            return FALSE;       /* can't decide */
+        }
+        xhi = mhi;
+        xlo = mlo;
+    }
+
+    /* Take 54 bits, then round to 53 bits. */
+    int msb = (int)(xhi >> 63);
+    ScmUInt64 m = xhi >> (msb + 9);
+    e2 -= 1 ^ msb;
+    if (xlo == 0 && (xhi & 0x1ff) == 0 && (m & 3) == 1) {
+        return FALSE;           /* exactly halfway; needs exact comparison */
+    }
+    m += m & 1;
+    m >>= 1;
+    if (m >> 53) {
+        m >>= 1;
+        e2++;
+    }
+    if (e2 <= 0 || e2 >= 0x7ff) {
+        return FALSE;           /* denormalized or overflow */
+    }
+    union { double d; ScmUInt64 u; } v;
+    v.u = ((ScmUInt64)e2 << 52) | (m & 0x000fffffffffffffULL);
+    *result = v.d;
+    return TRUE;
+}
+#endif /*!SCM_EMULATE_INT64*/
+
 /*
  * Number Printer
  *
@@ -3381,6 +3498,299 @@ static inline int numcmp3(ScmObj x, ScmObj d, ScmObj y)
     }
 }
 
+/*
+ * Fast path of flonum printing
+ *
+ * This is Grisu3 by Florian Loitsch ("Printing Floating-Point Numbers
+ * Quickly and Accurately with Integers", PLDI '10), which works with
+ * 64bit integers instead of bignums.  It either yields the shortest
+ * digits that are closest to the value, which are the same digits the
+ * Burger&Dybvig printer below yields, or tells that it can't be sure of
+ * that (about 0.5% of doubles), in which case we fall back to the latter.
+ */
+#if !SCM_EMULATE_INT64
+#define GRISU_FAST_PATH 1
+
+typedef struct {
+    ScmUInt64 f;
+    int e;
+} diy_fp;                       /* f * 2^e */
+
+static inline diy_fp diy_fp_mul(diy_fp x, diy_fp y)
+{
+    /* upper 64bit of 128bit product, rounded */
+    ScmUInt64 M32 = 0xffffffffULL;
+    ScmUInt64 a = x.f >> 32, b = x.f & M32;
+    ScmUInt64 c = y.f >> 32, d = y.f & M32;
+    ScmUInt64 ac = a*c, bc = b*c, ad = a*d, bd = b*d;
+    ScmUInt64 tmp = (bd >> 32) + (ad & M32) + (bc & M32) + (1ULL << 31);
+    diy_fp r;
+    r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+    r.e = x.e + y.e + 64;
+    return r;
+}
+
+static inline diy_fp diy_fp_normalize(diy_fp x)
+{
+    while (!(x.f & 0xffc0000000000000ULL)) { x.f <<= 10; x.e -= 10; }
+    while (!(x.f & 0x8000000000000000ULL)) { x.f <<= 1;  x.e -= 1; }
+    return x;
+}
+
+/* Normalized 10^k for k = -348, -340, ..., 340 */
+static const struct {
+    ScmUInt64 f;
+    short e;
+    short k;
+} cached_pow10[] = {
+    { 0xfa8fd5a0081c0288ULL, -1220, -348 },
+    { 0xbaaee17fa23ebf76ULL, -1193, -340 },
+    { 0x8b16fb203055ac76ULL, -1166, -332 },
+    { 0xcf42894a5dce35eaULL, -1140, -324 },
+    { 0x9a6bb0aa55653b2dULL, -1113, -316 },
+    { 0xe61acf033d1a45dfULL, -1087, -308 },
+    { 0xab70fe17c79ac6caULL, -1060, -300 },
+    { 0xff77b1fcbebcdc4fULL, -1034, -292 },
+    { 0xbe5691ef416bd60cULL, -1007, -284 },
+    { 0x8dd01fad907ffc3cULL,  -980, -276 },
+    { 0xd3515c2831559a83ULL,  -954, -268 },
+    { 0x9d71ac8fada6c9b5ULL,  -927, -260 },
+    { 0xea9c227723ee8bcbULL,  -901, -252 },
+    { 0xaecc49914078536dULL,  -874, -244 },
+    { 0x823c12795db6ce57ULL,  -847, -236 },
+    { 0xc21094364dfb5637ULL,  -821, -228 },
+    { 0x9096ea6f3848984fULL,  -794, -220 },
+    { 0xd77485cb25823ac7ULL,  -768, -212 },
+    { 0xa086cfcd97bf97f4ULL,  -741, -204 },
+    { 0xef340a98172aace5ULL,  -715, -196 },
+    { 0xb23867fb2a35b28eULL,  -688, -188 },
+    { 0x84c8d4dfd2c63f3bULL,  -661, -180 },
+    { 0xc5dd44271ad3cdbaULL,  -635, -172 },
+    { 0x936b9fcebb25c996ULL,  -608, -164 },
+    { 0xdbac6c247d62a584ULL,  -582, -156 },
+    { 0xa3ab66580d5fdaf6ULL,  -555, -148 },
+    { 0xf3e2f893dec3f126ULL,  -529, -140 },
+    { 0xb5b5ada8aaff80b8ULL,  -502, -132 },
+    { 0x87625f056c7c4a8bULL,  -475, -124 },
+    { 0xc9bcff6034c13053ULL,  -449, -116 },
+    { 0x964e858c91ba2655ULL,  -422, -108 },
+    { 0xdff9772470297ebdULL,  -396, -100 },
+    { 0xa6dfbd9fb8e5b88fULL,  -369,  -92 },
+    { 0xf8a95fcf88747d94ULL,  -343,  -84 },
+    { 0xb94470938fa89bcfULL,  -316,  -76 },
+    { 0x8a08f0f8bf0f156bULL,  -289,  -68 },
+    { 0xcdb02555653131b6ULL,  -263,  -60 },
+    { 0x993fe2c6d07b7facULL,  -236,  -52 },
+    { 0xe45c10c42a2b3b06ULL,  -210,  -44 },
+    { 0xaa242499697392d3ULL,  -183,  -36 },
+    { 0xfd87b5f28300ca0eULL,  -157,  -28 },
+    { 0xbce5086492111aebULL,  -130,  -20 },
+    { 0x8cbccc096f5088ccULL,  -103,  -12 },
+    { 0xd1b71758e219652cULL,   -77,   -4 },
+    { 0x9c40000000000000ULL,   -50,    4 },
+    { 0xe8d4a51000000000ULL,   -24,   12 },
+    { 0xad78ebc5ac620000ULL,     3,   20 },
+    { 0x813f3978f8940984ULL,    30,   28 },
+    { 0xc097ce7bc90715b3ULL,    56,   36 },
+    { 0x8f7e32ce7bea5c70ULL,    83,   44 },
+    { 0xd5d238a4abe98068ULL,   109,   52 },
+    { 0x9f4f2726179a2245ULL,   136,   60 },
+    { 0xed63a231d4c4fb27ULL,   162,   68 },
+    { 0xb0de65388cc8ada8ULL,   189,   76 },
+    { 0x83c7088e1aab65dbULL,   216,   84 },
+    { 0xc45d1df942711d9aULL,   242,   92 },
+    { 0x924d692ca61be758ULL,   269,  100 },
+    { 0xda01ee641a708deaULL,   295,  108 },
+    { 0xa26da3999aef774aULL,   322,  116 },
+    { 0xf209787bb47d6b85ULL,   348,  124 },
+    { 0xb454e4a179dd1877ULL,   375,  132 },
+    { 0x865b86925b9bc5c2ULL,   402,  140 },
+    { 0xc83553c5c8965d3dULL,   428,  148 },
+    { 0x952ab45cfa97a0b3ULL,   455,  156 },
+    { 0xde469fbd99a05fe3ULL,   481,  164 },
+    { 0xa59bc234db398c25ULL,   508,  172 },
+    { 0xf6c69a72a3989f5cULL,   534,  180 },
+    { 0xb7dcbf5354e9beceULL,   561,  188 },
+    { 0x88fcf317f22241e2ULL,   588,  196 },
+    { 0xcc20ce9bd35c78a5ULL,   614,  204 },
+    { 0x98165af37b2153dfULL,   641,  212 },
+    { 0xe2a0b5dc971f303aULL,   667,  220 },
+    { 0xa8d9d1535ce3b396ULL,   694,  228 },
+    { 0xfb9b7cd9a4a7443cULL,   720,  236 },
+    { 0xbb764c4ca7a44410ULL,   747,  244 },
+    { 0x8bab8eefb6409c1aULL,   774,  252 },
+    { 0xd01fef10a657842cULL,   800,  260 },
+    { 0x9b10a4e5e9913129ULL,   827,  268 },
+    { 0xe7109bfba19c0c9dULL,   853,  276 },
+    { 0xac2820d9623bf429ULL,   880,  284 },
+    { 0x80444b5e7aa7cf85ULL,   907,  292 },
+    { 0xbf21e44003acdd2dULL,   933,  300 },
+    { 0x8e679c2f5e44ff8fULL,   960,  308 },
+    { 0xd433179d9c8cb841ULL,   986,  316 },
+    { 0x9e19db92b4e31ba9ULL,  1013,  324 },
+    { 0xeb96bf6ebadf77d9ULL,  1039,  332 },
+    { 0xaf87023b9bf0ee6bULL,  1066,  340 },
+};
+
+#define GRISU_ALPHA  (-60)
+#define GRISU_GAMMA  (-32)
+
+static int grisu_round_weed(char *buf, int len, ScmUInt64 dist_high_w,
+                            ScmUInt64 unsafe, ScmUInt64 rest,
+                            ScmUInt64 ten_kappa, ScmUInt64 unit)
+{
+    ScmUInt64 small_dist = dist_high_w - unit;
+    ScmUInt64 big_dist = dist_high_w + unit;
+    /* Move the last digit down while it gets closer to the value. */
+    while (rest < small_dist
+           && unsafe - rest >= ten_kappa
+           && (rest + ten_kappa < small_dist
+               || small_dist - rest >= rest + ten_kappa - small_dist)) {
+        buf[len-1]--;
+        rest += ten_kappa;
+    }
+    /* If we can't tell which is closer, give up. */
+    if (rest < big_dist
+        && unsafe - rest >= ten_kappa
+        && (rest + ten_kappa < big_dist
+            || big_dist - rest > rest + ten_kappa - big_dist)) {
+        return FALSE;
+    }
+    /* The result must be safely inside of the interval. */
+    return (2*unit <= rest) && (rest <= unsafe - 4*unit);
+}
+
+static int grisu_digit_gen(diy_fp low, diy_fp w, diy_fp high,
+                           char *buf, int *len, int *kappa)
+{
+    ScmUInt64 unit = 1;
+    diy_fp too_low = { low.f - unit, low.e };
+    diy_fp too_high = { high.f + unit, high.e };
+    ScmUInt64 unsafe = too_high.f - too_low.f;
+    int shift = -w.e;
+    ScmUInt64 one = 1ULL << shift;
+    ScmUInt32 integrals = (ScmUInt32)(too_high.f >> shift);
+    ScmUInt64 fractionals = too_high.f & (one - 1);
+    ScmUInt32 divisor = 0;
+    int k = 0;
+
+    if (integrals > 0) {
+        for (divisor = 1, k = 1; integrals / 10 >= divisor; k++) {
+            divisor *= 10;
+        }
+    }
+    *len = 0;
+    while (k > 0) {
+        buf[(*len)++] = (char)('0' + integrals / divisor);
+        integrals %= divisor;
+        k--;
+        ScmUInt64 rest = ((ScmUInt64)integrals << shift) + fractionals;
+        if (rest < unsafe) {
+            *kappa = k;
+            return grisu_round_weed(buf, *len, too_high.f - w.f, unsafe, rest,
+                                    (ScmUInt64)divisor << shift, unit);
+        }
+        divisor /= 10;
+    }
+    for (;;) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe *= 10;
+        buf[(*len)++] = (char)('0' + (fractionals >> shift));
+        fractionals &= one - 1;
+        k--;
+        if (fractionals < unsafe) {
+            *kappa = k;
+            return grisu_round_weed(buf, *len, (too_high.f - w.f)*unit, unsafe,
+                                    fractionals, one, unit);
+        }
+    }
+}
+
+/* VAL must be positive and finite.  On success, stores the digits in BUF
+   (at least 18 bytes, not NUL-terminated) and returns the number of
+   digits.  *POINT receives the position of the decimal point, i.e. VAL
+   is 0.DDD * 10^*POINT.  Returns 0 on failure. */
+static int grisu3(double val, char *buf, int *point)
+{
+    union { double d; ScmUInt64 u; } v;
+    v.d = val;
+    ScmUInt64 mant = v.u & 0x000fffffffffffffULL;
+    int bexp = (int)((v.u >> 52) & 0x7ff);
+
+    /* The smallest normalized number; the printer below assumes the
+       lower boundary is closer for it, so we let it handle this. */
+    if (mant == 0 && bexp == 1) return 0;
+
+    diy_fp w, mp, mm;
+    if (bexp > 0) { w.f = mant | (1ULL << 52); w.e = bexp - 1075; }
+    else          { w.f = mant; w.e = -1074; }
+
+    mp.f = (w.f << 1) + 1; mp.e = w.e - 1;
+    mp = diy_fp_normalize(mp);
+    if (mant == 0 && bexp > 1) { mm.f = (w.f << 2) - 1; mm.e = w.e - 2; }
+    else                       { mm.f = (w.f << 1) - 1; mm.e = w.e - 1; }
+    mm.f <<= mm.e - mp.e;
+    mm.e = mp.e;
+    w = diy_fp_normalize(w);
+
+    /* Find 10^-k that brings the exponent of w*10^-k into
+       [GRISU_ALPHA, GRISU_GAMMA]. */
+    int emin = GRISU_ALPHA - (w.e + 64);
+    int emax = GRISU_GAMMA - (w.e + 64);
+    int kk = (int)ceil((emin + 63) * 0.30102999566398114);
+    int idx = (348 + kk - 1) / 8 + 1;
+    int ncached = (int)(sizeof(cached_pow10)/sizeof(cached_pow10[0]));
+    if (idx < 0) idx = 0;
+    if (idx >= ncached) idx = ncached - 1;
+    while (idx > 0 && cached_pow10[idx].e > emax) idx--;
+    while (idx < ncached-1 && cached_pow10[idx].e < emin) idx++;
+    if (cached_pow10[idx].e < emin || cached_pow10[idx].e > emax) return 0;
+    diy_fp c = { cached_pow10[idx].f, cached_pow10[idx].e };
+
+    int len, kappa;
+    if (!grisu_digit_gen(diy_fp_mul(mm, c), diy_fp_mul(w, c),
+                         diy_fp_mul(mp, c), buf, &len, &kappa)) {
+        return 0;
+    }
+    *point = len + kappa - cached_pow10[idx].k;
+    return len;
+}
+
+/* Format the digits the same way as print_double below.  BUF must have
+   FLT_BUF bytes.  Returns FALSE if the output may not fit. */
+static int format_shortest(char *buf, const char *digits, int len, int point,
+                           int exp_lo, int exp_hi)
+{
+    int ex;
+    if (point < exp_hi && point > exp_lo) { ex = 0; }
+    else { ex = point - 1; point = 1; }
+    if (point < -30 || point > 30) return FALSE;
+
+    if (point <= 0) {
+        *buf++ = '0';
+        *buf++ = '.';
+        for (int i=point; i<0; i++) *buf++ = '0';
+    }
+    for (int i=0; i<len; i++) {
+        *buf++ = digits[i];
+        if (i+1 == point && i+1 < len) *buf++ = '.';
+    }
+    if (len <= point) {
+        for (int i=len; i<point; i++) *buf++ = '0';
+        *buf++ = '.';
+        *buf++ = '0';
+    }
+    if (ex != 0) {
+        *buf++ = 'e';
+        sprintf(buf, "%d", ex);
+    } else {
+        *buf = '\0';
+    }
+    return TRUE;
+}
+#endif /*!SCM_EMULATE_INT64*/
+
 /* The main routine to get string representation of double.
    Convert VAL to a string and store to BUF, which must have at least FLT_BUF
    bytes long.
@@ -3415,6 +3825,17 @@ static void print_double(char *buf, int buflen, double val, int plus_sign,
 
     if (val < 0.0) *buf++ = '-', buflen--;
     else if (plus_sign) *buf++ = '+', buflen--;
+#if GRISU_FAST_PATH
+    if (precision < 0) {
+        char digits[20];
+        int point;
+        int len = grisu3(fabs(val), digits, &point);
+        if (len > 0 && format_shortest(buf, digits, len, point,
+                                       exp_lo, exp_hi)) {
+            return;
+        }
+    }
+#endif /*GRISU_FAST_PATH*/
     {
         /* variable names follows Burger&Dybvig paper. mp, mm for m+, m-.
            note that m+ == m- for most cases, and m+ == 2*m- for the rest.
@@ -3786,6 +4207,41 @@ static u_long bigdig[RADIX_MAX-RADIX_MIN+1] = { 0 };
 
 static ScmObj numread_error(const char *msg, struct numread_packet *context);
 
+/* A long run of digits is converted by divide and conquer, so that the
+   cost is dominated by a few large multiplications rather than the
+   quadratic number of word operations.  POWS[i] is radix^(READ_DC_LEAF<<i),
+   and LEN <= READ_DC_LEAF<<(K+1). */
+#define READ_DC_LEAF  1000      /* digits */
+
+static ScmObj read_uint(const char **strp, int *lenp,
+                        struct numread_packet *ctx,
+                        ScmObj initval);
+
+static ScmObj read_digits_dc(const char *str, int len,
+                             struct numread_packet *ctx,
+                             ScmObj *pows, int k)
+{
+    if (k < 0) {
+        struct numread_packet c = *ctx;
+        return read_uint(&str, &len, &c, SCM_FALSE);
+    }
+    int lo = READ_DC_LEAF << k;
+    if (len <= lo) return read_digits_dc(str, len, ctx, pows, k-1);
+    ScmObj hi = read_digits_dc(str, len-lo, ctx, pows, k-1);
+    return Scm_Add(Scm_Mul(hi, pows[k]),
+                   read_digits_dc(str+len-lo, lo, ctx, pows, k-1));
+}
+
+static inline int digit_in_radix_p(char c, int radix)
+{
+    int v;
+    if (c >= '0' && c <= '9')      v = c - '0';
+    else if (c >= 'a' && c <= 'z') v = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'Z') v = c - 'A' + 10;
+    else return FALSE;
+    return v < radix;
+}
+
 /* Returns either small integer or bignum.
    initval may be a Scheme integer that will be 'concatenated' before
    the integer to be read; it is used to read floating-point number.
@@ -3804,6 +4260,30 @@ static ScmObj read_uint(const char **strp, int *lenp,
     ScmBignum *value_big = NULL;
     static const char tab[] = "0123456789abcdefghijklmnopqrstuvwxyz";
 
+    if (!ctx->padread && len >= 2*READ_DC_LEAF) {
+        int run = 0;
+        while (run < len && digit_in_radix_p(str[run], radix)) run++;
+        if (run >= 2*READ_DC_LEAF) {
+            ScmObj pows[32];
+            int k = 0;
+            pows[0] = Scm_ExactIntegerExpt(SCM_MAKE_INT(radix),
+                                           SCM_MAKE_INT(READ_DC_LEAF));
+            while ((READ_DC_LEAF << (k+1)) < run) {
+                pows[k+1] = Scm_Mul(pows[k], pows[k]);
+                k++;
+            }
+            ScmObj v = read_digits_dc(str, run, ctx, pows, k);
+            if (!SCM_FALSEP(initval)) {
+                ScmObj scale = Scm_ExactIntegerExpt(SCM_MAKE_INT(radix),
+                                                    SCM_MAKE_INT(run));
+                v = Scm_Add(Scm_Mul(initval, scale), v);
+            }
+            initval = v;
+            str += run;
+            len -= run;
+        }
+    }
+
     if (!SCM_FALSEP(initval)) {
         if (SCM_INTP(initval)) {
             if ((u_long)SCM_INT_VALUE(initval) > limit) {
@@ -4137,11 +4617,24 @@ static ScmObj read_real(const char **strp, int *lenp,
         else        return e;
     } 
       
+    int raise_factor = exponent - fracdigs;
+
+#if EISEL_LEMIRE_FAST_PATH
+    /* If fraction fits in 64bit, we can mostly avoid bignum arithmetic. */
+    {
+        int oor = FALSE;
+        ScmUInt64 w = Scm_GetIntegerU64Clamp(fraction, SCM_CLAMP_NONE, &oor);
+        double d;
+        if (!oor && eisel_lemire(w, raise_factor, &d)) {
+            return Scm_MakeFlonum(minusp? -d : d);
+        }
+    }
+#endif /*EISEL_LEMIRE_FAST_PATH*/
+
     /* Get double approximaiton of fraction.  If fraction >= 2^53 we'll
        only get approximation, but the error will be corrected in
        AlgorithmR.  We have to be careful, however, not to overflow
        the following GetDouble call. */
-    int raise_factor = exponent - fracdigs;
     double realnum = Scm_GetDouble(fraction);
 
     if (SCM_IS_INF(realnum)) {
@@ -4335,6 +4828,86 @@ static ScmObj numread_error(const char *msg, struct numread_packet *context)
     return SCM_FALSE;
 }
 
+/* Fast path for the common decimal notation, shared by string->number
+   and the reader.  Recognizes [+-]?digits[.digits][e[+-]digits] with
+   a moderate number of significant digits, and returns SCM_UNBOUND
+   for anything else, including the cases where it can't determine
+   the result quickly.  The caller should fall back to read_number then. */
+#if SCM_EMULATE_INT64
+typedef u_long decimal_mant_t;
+#define DECIMAL_MANT_DIGITS  9
+#else
+typedef ScmUInt64 decimal_mant_t;
+#define DECIMAL_MANT_DIGITS  19
+#endif
+
+ScmObj Scm__ParseDecimalNumber(const char *str, int len)
+{
+    const char *p = str, *end = str + len;
+    int neg = FALSE, inexact = FALSE;
+    int ndigits = 0;            /* # of significant digits in w */
+    int seen = 0;               /* # of mantissa digits */
+    int e10 = 0;
+    decimal_mant_t w = 0;
+
+    if (p < end && (*p == '+' || *p == '-')) {
+        neg = (*p++ == '-');
+    }
+    for (; p < end && isdigit((unsigned char)*p); p++, seen++) {
+        if (w == 0 && *p == '0') continue;
+        if (ndigits >= DECIMAL_MANT_DIGITS) return SCM_UNBOUND;
+        w = w*10 + (*p - '0');
+        ndigits++;
+    }
+    if (p < end && *p == '.') {
+        inexact = TRUE;
+        for (p++; p < end && isdigit((unsigned char)*p); p++, seen++) {
+            e10--;
+            if (w == 0 && *p == '0') continue;
+            if (ndigits >= DECIMAL_MANT_DIGITS) return SCM_UNBOUND;
+            w = w*10 + (*p - '0');
+            ndigits++;
+        }
+    }
+    if (seen == 0) return SCM_UNBOUND;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        int eneg = FALSE, e = 0, edigits = 0;
+        inexact = TRUE;
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) {
+            eneg = (*p++ == '-');
+        }
+        for (; p < end && isdigit((unsigned char)*p); p++) {
+            if (++edigits > 4) return SCM_UNBOUND;
+            e = e*10 + (*p - '0');
+        }
+        if (edigits == 0) return SCM_UNBOUND;
+        e10 += eneg? -e : e;
+    }
+    if (p != end) return SCM_UNBOUND;
+
+    if (!inexact) {
+        /* Exact integer that surely fits in a long. */
+        if (ndigits > ((sizeof(long) >= 8)? 18 : 9)) return SCM_UNBOUND;
+        long v = (long)w;
+        return Scm_MakeInteger(neg? -v : v);
+    }
+
+    double d;
+    if (ndigits <= 15 && e10 >= -22 && e10 <= 22) {
+        /* Both w (< 10^15) and 10^|e10| are exact in double, so one rounding
+           gives the correct result. */
+        d = raise_pow10((double)w, e10);
+    } else {
+#if EISEL_LEMIRE_FAST_PATH
+        if (!eisel_lemire(w, e10, &d)) return SCM_UNBOUND;
+#else
+        return SCM_UNBOUND;
+#endif
+    }
+    return Scm_MakeFlonum(neg? -d : d);
+}
+
 /* FLAGS is enum  ScmNumberFormatFlags (see number.h).  Only some of the
    flags are recognized for printing numbers. */
 ScmObj Scm_StringToNumber(ScmString *str, int radix, u_long flags)
@@ -4345,6 +4918,10 @@ ScmObj Scm_StringToNumber(ScmString *str, int radix, u_long flags)
         /* This can't be a proper number. */
         return SCM_FALSE;
     } else {
+        if (radix == 10) {
+            ScmObj r = Scm__ParseDecimalNumber(p, size);
+            if (!SCM_UNBOUNDP(r)) return r;
+        }
         return read_number(p, size, radix, flags&SCM_NUMBER_FORMAT_ALT_RADIX);
     }
 }
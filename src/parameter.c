@@ -72,6 +72,8 @@ ScmInternalMutex parameter_mutex = SCM_INTERNAL_MUTEX_INITIALIZER;
 /* Init table.  For primordial thread, base == NULL.  For non-primordial
  * thread, base is the current thread (this must be called from the
  * creator thread).
+ * If TABLE already has a vector (the VM is recycled; see Scm_VMRecycle),
+ * it is reused when it's large enough.
  */
 void Scm__VMParameterTableInit(ScmVMParameterTable *table,
                                ScmVM *base)
@@ -80,11 +82,17 @@ void Scm__VMParameterTableInit(ScmVMParameterTable *table,
         /* NB: In this case, the caller is the owner thread of BASE,
            so we don't need to worry about base->parameters being
            modified during copying. */
-        table->vector = SCM_NEW_ARRAY(ScmObj, base->parameters.size);
-        table->size = base->parameters.size;
-        for (int i=0; i<table->size; i++) {
+        int i;
+        if (table->vector == NULL || table->size < base->parameters.size) {
+            table->vector = SCM_NEW_ARRAY(ScmObj, base->parameters.size);
+            table->size = base->parameters.size;
+        }
+        for (i=0; i<base->parameters.size; i++) {
             table->vector[i] = base->parameters.vector[i];
         }
+        for (; i<table->size; i++) {
+            table->vector[i] = SCM_UNBOUND;
+        }
     } else {
         table->vector = SCM_NEW_ARRAY(ScmObj, PARAMETER_INIT_SIZE);
         table->size = PARAMETER_INIT_SIZE;
@@ -168,6 +176,83 @@ ScmObj Scm_ParameterSet(ScmVM *vm, const ScmParameterLoc *loc, ScmObj value)
     return oldval;
 }
 
+/*
+ * Shallow binding for parameterize
+ *
+ *   The new values are swapped into the parameter table on entry,
+ *   and the saved values are swapped back on exit.  The swap itself
+ *   is the undo log; we don't need any closures or converter calls
+ *   for parameters without filters and hooks.
+ *
+ *   LOCS and VALS must be allocated in heap and must not be modified
+ *   by the caller after this call; VALS is used as the save area.
+ */
+typedef struct parameterize_frame_rec {
+    int num;
+    ScmParameterLoc *locs;
+    ScmObj *vals;
+} parameterize_frame;
+
+static void parameterize_swap(parameterize_frame *f, int enter)
+{
+    ScmVM *vm = Scm_VM();
+    if (enter) {
+        for (int i=0; i<f->num; i++) {
+            f->vals[i] = Scm_ParameterSet(vm, &f->locs[i], f->vals[i]);
+        }
+    } else {
+        /* restore in reverse order, in case the same parameter appears
+           more than once */
+        for (int i=f->num-1; i>=0; i--) {
+            f->vals[i] = Scm_ParameterSet(vm, &f->locs[i], f->vals[i]);
+        }
+    }
+}
+
+static ScmObj parameterize_before(ScmObj *args, int nargs, void *data)
+{
+    parameterize_swap((parameterize_frame*)data, TRUE);
+    return SCM_UNDEFINED;
+}
+
+static ScmObj parameterize_after(ScmObj *args, int nargs, void *data)
+{
+    parameterize_swap((parameterize_frame*)data, FALSE);
+    return SCM_UNDEFINED;
+}
+
+static ScmObj parameterize_cc(ScmObj result, void **data)
+{
+    ScmVM *vm = Scm_VM();
+    vm->handlers = SCM_OBJ(data[1]);
+    parameterize_swap((parameterize_frame*)data[0], FALSE);
+    return result;
+}
+
+ScmObj Scm__VMParameterize(int num, ScmParameterLoc *locs, ScmObj *vals,
+                           ScmObj thunk)
+{
+    ScmVM *vm = Scm_VM();
+    parameterize_frame *f = SCM_NEW(parameterize_frame);
+    f->num = num;
+    f->locs = locs;
+    f->vals = vals;
+
+    /* The subrs are only called when a continuation crosses the
+       boundary, via vm->handlers. */
+    ScmObj before = Scm_MakeSubr(parameterize_before, f, 0, 0, SCM_FALSE);
+    ScmObj after  = Scm_MakeSubr(parameterize_after, f, 0, 0, SCM_FALSE);
+    ScmObj prev = vm->handlers;
+    void *data[2];
+
+    parameterize_swap(f, TRUE);
+    vm->handlers = Scm_Cons(Scm_Cons(before, after), prev);
+    data[0] = (void*)f;
+    data[1] = (void*)prev;
+    Scm_VMPushCC(parameterize_cc, data, 2);
+    return Scm_VMApply0(thunk);
+}
+
 struct prim_data {
     const char *name;
     ScmParameterLoc loc;
@@ -35,12 +35,26 @@
 #include "gauche.h"
 #include "gauche/class.h"
 #include "gauche/priv/portP.h"
+#include "gauche/priv/probeP.h"
 #include "gauche/priv/builtin-syms.h"
 
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <ctype.h>
+#include <sys/stat.h>
+#if defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#endif
+#if !defined(GAUCHE_WINDOWS)
+#include <sys/uio.h>
+#endif
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
 
 #undef MAX
 #undef MIN
@@ -52,6 +66,11 @@
 #define SCM_PORT_BUFFER_SIGPIPE_SENSITIVE_P(obj) \
     (SCM_PORT(obj)->src.buf.mode & SCM_PORT_BUFFER_SIGPIPE_SENSITIVE)
 
+/* Buffering mode to decide when output is flushed.  A corked port
+   behaves as fully buffered until it's uncorked. */
+#define SCM_PORT_FLUSH_MODE(obj) \
+    (SCM_PORT_CORKED_P(obj)? SCM_PORT_BUFFER_FULL : SCM_PORT_BUFFER_MODE(obj))
+
 /* Parameter location for the global reader lexical mode, from which
    ports inherit. */
 static ScmParameterLoc readerLexicalMode;
@@ -66,6 +85,10 @@ static void register_buffered_port(ScmPort *port);
 static void unregister_buffered_port(ScmPort *port);
 static void bufport_flush(ScmPort*, int, int);
 static void file_closer(ScmPort *p);
+static void file_write_error(ScmPort *p);
+static int  file_wait(int fd, int dir);
+static ScmObj make_file_port(const char *path, int fd, int dir,
+                             int buffering);
 
 static ScmObj get_port_name(ScmPort *port)
 {
@@ -634,6 +657,43 @@ void Scm_SetPortCaseFolding(ScmPort *port, int folding)
     }
 }
 
+/* Make PORT private to the calling thread.  Afterwards the port APIs
+   skip locking it, so it must not be used by other threads.  If another
+   thread is using the port, we wait for it to release the port first.
+   Note that a private port stays locked by the calling thread, and
+   there's no way to make it shared again. */
+void Scm_PortMakePrivate(ScmPort *port)
+{
+    ScmVM *vm = Scm_VM();
+    if (SCM_PORT_PRIVATE_P(port)) {
+        if (!PORT_LOCK_OWNER_P(port, vm)) {
+            Scm_Error("port %S is private to another thread", port);
+        }
+        return;
+    }
+    PORT_LOCK(port, vm);
+    SCM_PORT_FLAGS(port) |= SCM_PORT_PRIVATE;
+}
+
+/* A corked output port holds the output in its buffer regardless of
+   its buffering mode, until it is uncorked or explicitly flushed, so
+   that pieces written separately go out together.  Uncorking flushes
+   the buffer. */
+void Scm_PortCork(ScmPort *port)
+{
+    SCM_PORT_FLAGS(port) |= SCM_PORT_CORKED;
+}
+
+void Scm_PortUncork(ScmPort *port)
+{
+    if (!SCM_PORT_CORKED_P(port)) return;
+    SCM_PORT_FLAGS(port) &= ~SCM_PORT_CORKED;
+    if (SCM_PORT_DIR(port) & SCM_PORT_OUTPUT
+        && !SCM_PORT_CLOSED_P(port)) {
+        Scm_Flush(port);
+    }
+}
+
 /* Port's reader lexical mode is set at port creation, taken from
    readerLexicalMode parameter.  It may be altered by reader directive
    such as #!r7rs.
@@ -692,6 +752,7 @@ static void bufport_flush(ScmPort *p, int cnt, int forcep)
 
     if (cursiz == 0) return;
     if (cnt <= 0)  { cnt = cursiz; }
+    SCM_PROBE2(port__flush, p, cnt);
     int nwrote = p->src.buf.flusher(p, cnt, forcep);
     if (nwrote < 0) {
         p->src.buf.current = p->src.buf.buffer; /* for safety */
@@ -710,10 +771,79 @@ static void bufport_flush(ScmPort *p, int cnt, int forcep)
     }
 }
 
+#if !defined(GAUCHE_WINDOWS)
+static int file_flusher(ScmPort *p, int cnt, int forcep);
+
+/* Max number of chunks passed to a single writev(2) call, besides
+   the buffer.  Well below IOV_MAX of any platform we know. */
+#define FILE_WRITEV_MAX 64
+
+/* Writes out the buffered data and N chunks in SRC together by
+   writev(2), instead of copying them through the buffer and flushing
+   it piece by piece.  Used by bufport_write and bufport_writev for
+   file ports when the data doesn't fit in the buffer.  Leaves the
+   buffer empty. */
+static void file_writev(ScmPort *p, const ScmIOVec *src, int n)
+{
+    int fd = (int)(intptr_t)p->src.buf.data;
+    struct iovec iov[FILE_WRITEV_MAX+1];
+
+    SCM_ASSERT(fd >= 0);
+    while (n > 0) {
+        int iovcnt = 0;
+        if (SCM_PORT_BUFFER_AVAIL(p) > 0) {
+            iov[iovcnt].iov_base = p->src.buf.buffer;
+            iov[iovcnt].iov_len = SCM_PORT_BUFFER_AVAIL(p);
+            iovcnt++;
+        }
+        for (; n > 0 && iovcnt <= FILE_WRITEV_MAX; src++, n--) {
+            if (src->len == 0) continue;
+            iov[iovcnt].iov_base = (void*)src->base;
+            iov[iovcnt].iov_len = src->len;
+            iovcnt++;
+        }
+
+        struct iovec *v = iov;
+        while (iovcnt > 0) {
+            ssize_t r;
+            errno = 0;
+            SCM_SYSCALL(r, writev(fd, v, iovcnt));
+            if (r < 0) {
+                if (file_wait(fd, SCM_PORT_OUTPUT)) continue;
+                p->src.buf.current = p->src.buf.buffer;
+                file_write_error(p);
+            }
+            while (iovcnt > 0 && (size_t)r >= v->iov_len) {
+                r -= v->iov_len;
+                v++;
+                iovcnt--;
+            }
+            if (iovcnt > 0) {
+                v->iov_base = (char*)v->iov_base + r;
+                v->iov_len -= r;
+            }
+        }
+        p->src.buf.current = p->src.buf.buffer;
+    }
+}
+#endif /*!GAUCHE_WINDOWS*/
+
 /* Writes siz bytes in src to the buffered port.  siz may be larger than
    the port's buffer.  Won't return until entire siz bytes are written. */
 static void bufport_write(ScmPort *p, const char *src, int siz)
 {
+#if !defined(GAUCHE_WINDOWS)
+    /* If the data overflows the buffer, emit the buffer and the data
+       in one syscall.  We can do so only if we know the flusher. */
+    if (siz > (int)(p->src.buf.end - p->src.buf.current)
+        && p->src.buf.flusher == file_flusher) {
+        ScmIOVec v;
+        v.base = src;
+        v.len = siz;
+        file_writev(p, &v, 1);
+        return;
+    }
+#endif /*!GAUCHE_WINDOWS*/
     do {
         int room = (int)(p->src.buf.end - p->src.buf.current);
         if (room >= siz) {
@@ -730,6 +860,26 @@ static void bufport_write(ScmPort *p, const char *src, int siz)
     } while (siz > 0);
 }
 
+/* Writes N chunks to the buffered port.  If they don't fit in the
+   buffer of a file port, they're written with the buffer by a single
+   writev(2) call (per FILE_WRITEV_MAX chunks). */
+static void bufport_writev(ScmPort *p, const ScmIOVec *v, int n)
+{
+#if !defined(GAUCHE_WINDOWS)
+    if (p->src.buf.flusher == file_flusher) {
+        ScmSmallInt total = 0;
+        for (int i = 0; i < n; i++) total += v[i].len;
+        if (total > (ScmSmallInt)(p->src.buf.end - p->src.buf.current)) {
+            file_writev(p, v, n);
+            return;
+        }
+    }
+#endif /*!GAUCHE_WINDOWS*/
+    for (int i = 0; i < n; i++) {
+        if (v[i].len > 0) bufport_write(p, v[i].base, (int)v[i].len);
+    }
+}
+
 /* Fills the buffer.  Reads at least MIN bytes (unless it reaches EOF).
  * If ALLOW_LESS is true, however, we allow to return before the full
  * data is read.
@@ -759,6 +909,7 @@ static int bufport_fill(ScmPort *p, int min, int allow_less)
         nread += r;
         p->src.buf.end += r;
     } while (!allow_less && nread < min);
+    SCM_PROBE2(port__fill, p, nread);
     return nread;
 }
 
@@ -891,6 +1042,20 @@ static void register_buffered_port(ScmPort *port)
     }
 }
 
+/* Returns the number of buffered output ports currently registered.
+   Used for runtime metrics. */
+int Scm__ActiveBufferedPortCount(void)
+{
+    int count = 0;
+    (void)SCM_INTERNAL_MUTEX_LOCK(active_buffered_ports.mutex);
+    for (int i = 0; i < PORT_VECTOR_SIZE; i++) {
+        ScmObj p = Scm_WeakVectorRef(active_buffered_ports.ports, i, SCM_FALSE);
+        if (SCM_PORTP(p)) count++;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(active_buffered_ports.mutex);
+    return count;
+}
+
 /* This should be called when the output buffered port is explicitly closed.
    The ports collected by GC are automatically unregistered. */
 static void unregister_buffered_port(ScmPort *port)
@@ -1014,11 +1179,107 @@ ScmObj Scm_GetBufferingMode(ScmPort *port)
  * Generic procedures
  */
 
+/* Used by Scm_Puts to write the leaves of a rope string.  The caller
+   holds the lock of the port. */
+static void putz_chunk(const char *s, ScmSmallInt size, void *port)
+{
+    Scm_PutzUnsafe(s, (int)size, SCM_PORT(port));
+}
+
+/* Used by Scm_Putzv for procedural ports, which only know Putz. */
+static void procport_writev(ScmPort *p, const ScmIOVec *v, int n)
+{
+    for (int i = 0; i < n; i++) {
+        if (v[i].len > 0) p->src.vt.Putz(v[i].base, (int)v[i].len, p);
+    }
+}
+
 #define SAFE_PORT_OP
 #include "portapi.c"
 #undef SAFE_PORT_OP
 #include "portapi.c"
 
+/*===============================================================
+ * Tree writer
+ *   The core of text.tree's write-tree.  Walks TREE without recursion
+ *   and gathers the string leaves into a batch of chunks, which is
+ *   written by a single Scm_Putzv call; thus a file port sees one lock
+ *   and, when the data overflows its buffer, one writev(2) call every
+ *   TREE_BATCH leaves.  Other leaves are passed to FALLBACK with PORT.
+ */
+
+#define TREE_BATCH  64
+#define TREE_STACK  64
+
+typedef struct tree_ctx_rec {
+    ScmPort *port;
+    ScmIOVec batch[TREE_BATCH];
+    int nbatch;
+} tree_ctx;
+
+static void tree_flush(tree_ctx *ctx)
+{
+    if (ctx->nbatch > 0) {
+        Scm_Putzv(ctx->batch, ctx->nbatch, ctx->port);
+        ctx->nbatch = 0;
+    }
+}
+
+static void tree_chunk(const char *s, ScmSmallInt size, void *data)
+{
+    tree_ctx *ctx = (tree_ctx*)data;
+    if (size == 0) return;
+    if (ctx->nbatch == TREE_BATCH) tree_flush(ctx);
+    ctx->batch[ctx->nbatch].base = s;
+    ctx->batch[ctx->nbatch].len = size;
+    ctx->nbatch++;
+}
+
+static void tree_string(tree_ctx *ctx, ScmString *s)
+{
+    if (SCM_STRING_ROPE_P(s)) {
+        Scm__StringForEachChunk(s, tree_chunk, ctx);
+    } else {
+        const ScmStringBody *b = SCM_STRING_BODY(s);
+        tree_chunk(SCM_STRING_BODY_START(b), SCM_STRING_BODY_SIZE(b), ctx);
+    }
+}
+
+void Scm__WriteTree(ScmObj tree, ScmPort *port, ScmObj fallback)
+{
+    tree_ctx ctx;
+    ScmObj stack0[TREE_STACK], *stack = stack0;
+    int sp = 0, stacksize = TREE_STACK;
+
+    ctx.port = port;
+    ctx.nbatch = 0;
+    for (;;) {
+        while (SCM_PAIRP(tree)) {
+            if (!SCM_NULLP(SCM_CDR(tree))) {
+                if (sp == stacksize) {
+                    ScmObj *s = SCM_NEW_ARRAY(ScmObj, stacksize*2);
+                    memcpy(s, stack, sizeof(ScmObj)*stacksize);
+                    stack = s;
+                    stacksize *= 2;
+                }
+                stack[sp++] = SCM_CDR(tree);
+            }
+            tree = SCM_CAR(tree);
+        }
+        if (SCM_STRINGP(tree)) {
+            tree_string(&ctx, SCM_STRING(tree));
+        } else if (SCM_SYMBOLP(tree) && !SCM_KEYWORDP(tree)) {
+            tree_string(&ctx, SCM_SYMBOL_NAME(tree));
+        } else if (!SCM_NULLP(tree)) {
+            tree_flush(&ctx);
+            Scm_ApplyRec2(fallback, tree, SCM_OBJ(port));
+        }
+        if (sp == 0) break;
+        tree = stack[--sp];
+    }
+    tree_flush(&ctx);
+}
+
 /*===============================================================
  * File Port
  */
@@ -1034,6 +1295,7 @@ static int file_filler(ScmPort *p, int cnt)
         errno = 0;
         SCM_SYSCALL(r, read(fd, datptr, cnt-nread));
         if (r < 0) {
+            if (file_wait(fd, SCM_PORT_INPUT)) continue;
             p->error = TRUE;
             Scm_SysError("read failed on %S", p);
         } else if (r == 0) {
@@ -1061,17 +1323,8 @@ static int file_flusher(ScmPort *p, int cnt, int forcep)
         errno = 0;
         SCM_SYSCALL(r, write(fd, datptr, datsiz-nwrote));
         if (r < 0) {
-            if (SCM_PORT_BUFFER_SIGPIPE_SENSITIVE_P(p)) {
-                /* (sort of) emulate termination by SIGPIPE.
-                   NB: The difference is visible from the outside world
-                   as the process exit status differ (WIFEXITED
-                   instead of WIFSIGNALED).  If it becomes a problem,
-                   we can reset the signal handler to SIG_DFL and
-                   send SIGPIPE to self. */
-                Scm_Exit(1);    /* exit code is somewhat arbitrary */
-            }
-            p->error = TRUE;
-            Scm_SysError("write failed on %S", p);
+            if (file_wait(fd, SCM_PORT_OUTPUT)) continue;
+            file_write_error(p);
         } else {
             datptr += r;
             nwrote += r;
@@ -1080,6 +1333,58 @@ static int file_flusher(ScmPort *p, int cnt, int forcep)
     return nwrote;
 }
 
+static void file_write_error(ScmPort *p)
+{
+    if (SCM_PORT_BUFFER_SIGPIPE_SENSITIVE_P(p)) {
+        /* (sort of) emulate termination by SIGPIPE.
+           NB: The difference is visible from the outside world
+           as the process exit status differ (WIFEXITED
+           instead of WIFSIGNALED).  If it becomes a problem,
+           we can reset the signal handler to SIG_DFL and
+           send SIGPIPE to self. */
+        Scm_Exit(1);    /* exit code is somewhat arbitrary */
+    }
+    p->error = TRUE;
+    Scm_SysError("write failed on %S", p);
+}
+
+/* Called when a read or write on FD failed.  If it's just because FD is
+   in non-blocking mode and isn't ready, waits until it becomes ready
+   and returns TRUE so that the caller retries.  Otherwise returns FALSE
+   with errno telling the error.  Port operations thus work on non-blocking
+   descriptors as if they were blocking; code that wants to do something
+   else meanwhile should check readiness before touching the port
+   (e.g. gauche.eventloop). */
+static int file_wait(int fd, int dir)
+{
+    if (errno != EAGAIN && errno != EWOULDBLOCK) return FALSE;
+#if defined(HAVE_POLL_H)
+    struct pollfd pfd;
+    int r;
+    pfd.fd = fd;
+    pfd.events = (dir == SCM_PORT_OUTPUT)? POLLOUT : POLLIN;
+    pfd.revents = 0;
+    SCM_SYSCALL(r, poll(&pfd, 1, -1));
+    if (r < 0) return FALSE;
+#elif defined(HAVE_SELECT) && !defined(GAUCHE_WINDOWS)
+    fd_set fds;
+    int r;
+    if (fd >= FD_SETSIZE) return FALSE;
+    FD_ZERO(&fds);
+    FD_SET(fd, &fds);
+    if (dir == SCM_PORT_OUTPUT) {
+        SCM_SYSCALL(r, select(fd+1, NULL, &fds, NULL, NULL));
+    } else {
+        SCM_SYSCALL(r, select(fd+1, &fds, NULL, NULL, NULL));
+    }
+    if (r < 0) return FALSE;
+#else
+    return FALSE;
+#endif
+    errno = 0;
+    return TRUE;
+}
+
 static void file_closer(ScmPort *p)
 {
     int fd = (int)(intptr_t)p->src.buf.data;
@@ -1129,7 +1434,11 @@ ScmObj Scm_OpenFilePort(const char *path, int flags, int buffering, int perm)
        errors would be caught by later operations anyway.
     */
     if (flags & O_APPEND) (void)lseek(fd, 0, SEEK_END);
-    
+    return make_file_port(path, fd, dir, buffering);
+}
+
+static ScmObj make_file_port(const char *path, int fd, int dir, int buffering)
+{
     ScmPortBuffer bufrec;
     bufrec.mode = buffering;
     bufrec.buffer = NULL;
@@ -1146,6 +1455,216 @@ ScmObj Scm_OpenFilePort(const char *path, int flags, int buffering, int perm)
     return p;
 }
 
+/*
+ * Mapped file port
+ *
+ *   Maps a regular file into memory and reads it as an input string
+ *   port, so that no copy is made to fill the buffer.  The mapping is
+ *   described by a small record kept in src.istr.owner, whose finalizer
+ *   unmaps the file.  The record is shared by the u8vectors returned
+ *   from Scm_GetRemainingInputBytes, so the mapping outlives the port
+ *   as long as they're alive.  Closing the port doesn't unmap the file
+ *   for the same reason.
+ *   If the file can't be mapped, e.g. it's a pipe, we fall back to
+ *   the ordinary buffered port.
+ */
+#if defined(HAVE_SYS_MMAN_H)
+typedef struct file_mapping_rec {
+    void *addr;
+    size_t len;
+} file_mapping;
+
+static void file_mapping_finalize(ScmObj obj, void *data)
+{
+    file_mapping *m = (file_mapping*)obj;
+    if (m->addr != NULL) {
+        munmap(m->addr, m->len);
+        m->addr = NULL;
+    }
+}
+#endif /*HAVE_SYS_MMAN_H*/
+
+ScmObj Scm_OpenMappedFilePort(const char *path)
+{
+    int fd = open(path, O_RDONLY
+#if defined(GAUCHE_WINDOWS)
+                  |O_BINARY
+#endif /*GAUCHE_WINDOWS*/
+                  );
+    if (fd < 0) return SCM_FALSE;
+#if defined(HAVE_SYS_MMAN_H)
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+        && (uintmax_t)st.st_size <= (uintmax_t)SCM_SMALL_INT_MAX) {
+        const char *start = "";
+        file_mapping *m = NULL;
+        if (st.st_size > 0) {
+            void *addr = mmap(NULL, (size_t)st.st_size, PROT_READ,
+                              MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) goto fallback;
+            m = SCM_NEW_ATOMIC(file_mapping);
+            m->addr = addr;
+            m->len = (size_t)st.st_size;
+            Scm_RegisterFinalizer(SCM_OBJ(m), file_mapping_finalize, NULL);
+            start = (const char*)addr;
+        }
+        close(fd);
+        ScmPort *p = make_port(SCM_CLASS_PORT, SCM_PORT_INPUT, SCM_PORT_ISTR);
+        p->src.istr.start = start;
+        p->src.istr.current = start;
+        p->src.istr.end = start + st.st_size;
+        p->src.istr.owner = m;
+        p->name = SCM_MAKE_STR_COPYING(path);
+        return SCM_OBJ(p);
+    }
+  fallback:
+#endif /*HAVE_SYS_MMAN_H*/
+    return make_file_port(path, fd, SCM_PORT_INPUT, SCM_PORT_BUFFER_FULL);
+}
+
+/*
+ * Copying between file ports
+ *
+ *   If both ports are plain file ports, we move the data between the
+ *   file descriptors directly.  What's left in SRC (pushed back bytes
+ *   and the buffer) is written to DST first, then DST is flushed, and
+ *   the rest goes by sendfile(2) if the system can do it for the pair
+ *   of descriptors, or by read(2)/write(2) through SRC's buffer
+ *   otherwise.
+ *
+ *   Returns the number of bytes copied, or -1 if the ports can't be
+ *   handled here; the caller should use the generic method then.
+ *   LIMIT is the maximum number of bytes to copy; negative means up to
+ *   EOF.  The caller must lock both ports.
+ */
+static void file_write_all(ScmPort *p, const char *buf, size_t n)
+{
+    int fd = (int)(intptr_t)p->src.buf.data;
+    while (n > 0) {
+        ssize_t r;
+        errno = 0;
+        SCM_SYSCALL(r, write(fd, buf, n));
+        if (r < 0) {
+            if (file_wait(fd, SCM_PORT_OUTPUT)) continue;
+            file_write_error(p);
+        }
+        buf += r;
+        n -= r;
+    }
+}
+
+ScmSmallInt Scm_CopyFilePortUnsafe(ScmPort *src, ScmPort *dst,
+                                   ScmSmallInt limit)
+{
+    ScmSmallInt count = 0;
+
+    if (!SCM_IPORTP(src) || SCM_PORT_TYPE(src) != SCM_PORT_FILE
+        || src->src.buf.filler != file_filler
+        || !SCM_OPORTP(dst) || SCM_PORT_TYPE(dst) != SCM_PORT_FILE
+        || dst->src.buf.flusher != file_flusher
+        || SCM_PORT_CLOSED_P(src) || SCM_PORT_CLOSED_P(dst)) {
+        return -1;
+    }
+#define ROOM() ((limit < 0)? SCM_SMALL_INT_MAX : limit - count)
+
+    /* Pending input */
+    while ((src->scrcnt > 0 || src->ungotten != SCM_CHAR_INVALID)
+           && ROOM() > 0) {
+        Scm_PutbUnsafe((ScmByte)Scm_GetbUnsafe(src), dst);
+        count++;
+    }
+    ScmSmallInt n = (ScmSmallInt)(src->src.buf.end - src->src.buf.current);
+    if (n > ROOM()) n = ROOM();
+    if (n > 0) {
+        Scm_PutzUnsafe(src->src.buf.current, (int)n, dst);
+        src->src.buf.current += n;
+        src->bytes += n;
+        count += n;
+    }
+    Scm_FlushUnsafe(dst);
+    if (ROOM() == 0) return count;
+
+    /* Now the buffer of SRC is empty and we can use the descriptors. */
+    int infd = (int)(intptr_t)src->src.buf.data;
+#if defined(HAVE_SYS_SENDFILE_H) && defined(HAVE_SENDFILE)
+    int outfd = (int)(intptr_t)dst->src.buf.data;
+    int use_sendfile = TRUE;
+#endif
+    src->src.buf.current = src->src.buf.end = src->src.buf.buffer;
+    while (ROOM() > 0) {
+        ssize_t r;
+#if defined(HAVE_SYS_SENDFILE_H) && defined(HAVE_SENDFILE)
+        if (use_sendfile) {
+            size_t chunk = (ROOM() > (1L<<30))? (1L<<30) : (size_t)ROOM();
+            errno = 0;
+            SCM_SYSCALL(r, sendfile(outfd, infd, NULL, chunk));
+            if (r >= 0) {
+                if (r == 0) break;   /* EOF */
+                src->bytes += r;
+                count += r;
+                continue;
+            }
+            /* Some kind of descriptors can't be used by sendfile; we
+               find it at the first call, before anything is moved. */
+            if (errno == EINVAL || errno == ENOSYS) {
+                use_sendfile = FALSE;
+                continue;
+            }
+            /* Either side may be non-blocking. */
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                int e = errno;
+                int rd = Scm_FdReady(infd, SCM_PORT_INPUT);
+                errno = e;
+                if (file_wait((rd == SCM_FD_WOULDBLOCK)? infd : outfd,
+                              (rd == SCM_FD_WOULDBLOCK)?
+                              SCM_PORT_INPUT : SCM_PORT_OUTPUT)) {
+                    continue;
+                }
+            }
+            if (errno == EPIPE) file_write_error(dst);
+            Scm_SysError("sendfile failed from %S to %S", src, dst);
+        }
+#endif /*HAVE_SYS_SENDFILE_H && HAVE_SENDFILE*/
+        size_t chunk = src->src.buf.size;
+        if ((ScmSmallInt)chunk > ROOM()) chunk = (size_t)ROOM();
+        errno = 0;
+        SCM_SYSCALL(r, read(infd, src->src.buf.buffer, chunk));
+        if (r < 0) {
+            if (file_wait(infd, SCM_PORT_INPUT)) continue;
+            src->error = TRUE;
+            Scm_SysError("read failed on %S", src);
+        }
+        if (r == 0) break;      /* EOF */
+        src->bytes += r;
+        file_write_all(dst, src->src.buf.buffer, (size_t)r);
+        count += r;
+    }
+#undef ROOM
+    return count;
+}
+
+static ScmSmallInt copy_file_port_to(ScmPort *src, ScmPort *dst,
+                                     ScmSmallInt limit, ScmVM *vm)
+{
+    ScmSmallInt r = -1;
+    PORT_LOCK(dst, vm);
+    PORT_SAFE_CALL(dst, r = Scm_CopyFilePortUnsafe(src, dst, limit),
+                   /*no cleanup*/);
+    PORT_UNLOCK(dst);
+    return r;
+}
+
+ScmSmallInt Scm_CopyFilePort(ScmPort *src, ScmPort *dst, ScmSmallInt limit)
+{
+    ScmVM *vm = Scm_VM();
+    ScmSmallInt r = -1;
+    PORT_LOCK(src, vm);
+    PORT_SAFE_CALL(src, r = copy_file_port_to(src, dst, limit, vm),
+                   /*no cleanup*/);
+    PORT_UNLOCK(src);
+    return r;
+}
+
 /* Create a port on specified file descriptor.
       NAME  - used for the name of the port.
       DIRECTION - either SCM_PORT_INPUT or SCM_PORT_OUTPUT
@@ -1192,15 +1711,29 @@ ScmObj Scm_MakeInputStringPort(ScmString *str, int privatep)
     p->src.istr.start = s;
     p->src.istr.current = s;
     p->src.istr.end = s + size;
+    p->src.istr.owner = NULL;
     SCM_PORT(p)->name = SCM_MAKE_STR("(input string port)");
     if (privatep) PORT_PRELOCK(p, Scm_VM());
     return SCM_OBJ(p);
 }
 
 ScmObj Scm_MakeOutputStringPort(int privatep)
+{
+    return Scm_MakeOutputStringPortWithCapacity(0, privatep);
+}
+
+/* If the caller knows the size of the output, CAPACITY bytes are
+   allocated up front in one chunk, so that the port doesn't need to
+   grow while writing up to that size.  We add one byte for the
+   terminating NUL, which allows Scm_TakeOutputString to hand the chunk
+   to the string without copying. */
+ScmObj Scm_MakeOutputStringPortWithCapacity(int capacity, int privatep)
 {
     ScmPort *p = make_port(SCM_CLASS_PORT, SCM_PORT_OUTPUT, SCM_PORT_OSTR);
     Scm_DStringInit(&p->src.ostr);
+    if (capacity >= SCM_DSTRING_INIT_CHUNK_SIZE) {
+        Scm_DStringReserve(&p->src.ostr, capacity+1);
+    }
     SCM_PORT(p)->name = SCM_MAKE_STR("(output string port)");
     if (privatep) PORT_PRELOCK(p, Scm_VM());
     return SCM_OBJ(p);
@@ -1224,6 +1757,45 @@ ScmObj Scm_GetOutputStringUnsafe(ScmPort *port, int flags)
     return Scm_DStringGet(&SCM_PORT(port)->src.ostr, flags);
 }
 
+/* Returns the accumulated string and empties the port.  If the content
+   is in a single chunk, e.g. the port is created with enough capacity,
+   the chunk becomes the string body without copying. */
+ScmObj Scm_TakeOutputString(ScmPort *port, int flags)
+{
+    if (SCM_PORT_TYPE(port) != SCM_PORT_OSTR)
+        Scm_Error("output string port required, but got %S", port);
+    ScmVM *vm = Scm_VM();
+    PORT_LOCK(port, vm);
+    ScmObj r = Scm__DStringTake(&SCM_PORT(port)->src.ostr, flags);
+    PORT_UNLOCK(port);
+    return r;
+}
+
+/* Empties the output string port, so that it can be used to build
+   another string.  The port keeps its buffer chunks for reuse, unless
+   RECYCLE is true, in which case they are given to the current VM's pool
+   for other string ports.  The latter is for with-output-to-string,
+   which drops the port afterwards.
+   When the port keeps chunks, we start writing into a chunk that can
+   hold as much as the previous content, so that a port reused for
+   strings of similar sizes keeps its content contiguous. */
+void Scm_ResetOutputString(ScmPort *port, int recycle)
+{
+    if (SCM_PORT_TYPE(port) != SCM_PORT_OSTR)
+        Scm_Error("output string port required, but got %S", port);
+    ScmVM *vm = Scm_VM();
+    ScmDString *ds = &SCM_PORT(port)->src.ostr;
+    PORT_LOCK(port, vm);
+    if (recycle) {
+        Scm__DStringRecycle(ds);
+    } else {
+        int size = (ds->tail != NULL)? Scm_DStringSize(ds) : 0;
+        Scm_DStringReset(ds);
+        if (size > 0) Scm_DStringReserve(ds, size+1);
+    }
+    PORT_UNLOCK(port);
+}
+
 /* TRANSIENT: Pre-0.9 Compatibility routine.  Kept for the binary compatibility.
    Will be removed on 1.0 */
 ScmObj Scm__GetOutputStringCompat(ScmPort *port)
@@ -1239,62 +1811,85 @@ ScmObj Scm__GetOutputStringUnsafeCompat(ScmPort *port)
 }
 
 
-static ScmObj get_remaining_input_string_aux(const char *s, int ssiz,
-                                             const char *p, int psiz,
-                                             int flags);
-
-ScmObj Scm_GetRemainingInputString(ScmPort *port, int flags)
+/* Returns the position of the remaining input of an input string port.
+   Things gets complicated if there's an ungotten char or bytes.
+   We want to share the string body whenever possible, so we
+   first check the ungotten stuff matches the content of the
+   buffer.  If it doesn't, the ungotten bytes are returned in
+   *PRE and *PRESIZ, and the caller needs to copy. */
+static const char *istr_remaining(ScmPort *port, char *cbuf,
+                                  const char **pre, int *presiz)
 {
-    if (SCM_PORT_TYPE(port) != SCM_PORT_ISTR)
-        Scm_Error("input string port required, but got %S", port);
-    /* NB: we don't need to lock the port, since the string body
-       the port is pointing won't be changed. */
-    const char *ep = port->src.istr.end;
+    const char *sp = port->src.istr.start;
     const char *cp = port->src.istr.current;
-    /* Things gets complicated if there's an ungotten char or bytes.
-       We want to share the string body whenever possible, so we
-       first check the ungotten stuff matches the content of the
-       buffer. */
+    *pre = NULL;
+    *presiz = 0;
     if (port->ungotten != SCM_CHAR_INVALID) {
-        char cbuf[SCM_CHAR_MAX_BYTES];
         int nbytes = SCM_CHAR_NBYTES(port->ungotten);
         SCM_CHAR_PUT(cbuf, port->ungotten);
-        const char *sp = port->src.istr.start;
-        if (cp - sp >= nbytes
-            && memcmp(cp - nbytes, cbuf, nbytes) == 0) {
-            cp -= nbytes;       /* we can reuse buffer */
-            return Scm_MakeString(cp, (int)(ep-cp), -1, flags);
-        } else {
-            /* we need to copy */
-            return get_remaining_input_string_aux(cp, (int)(ep-cp), cbuf,
-                                                  nbytes, flags);
+        if (cp - sp >= nbytes && memcmp(cp - nbytes, cbuf, nbytes) == 0) {
+            return cp - nbytes; /* we can reuse buffer */
         }
+        *pre = cbuf;
+        *presiz = nbytes;
     } else if (port->scrcnt > 0) {
-        const char *sp = port->src.istr.start;
         if (cp - sp >= (int)port->scrcnt
             && memcmp(cp - port->scrcnt, port->scratch, port->scrcnt) == 0) {
-            cp -= port->scrcnt; /* we can reuse buffer */
-            return Scm_MakeString(cp, (int)(ep-cp), -1, flags);
-        } else {
-            /* we need to copy */
-            return get_remaining_input_string_aux(cp, (int)(ep-cp),
-                                                  port->scratch,
-                                                  port->scrcnt, flags);
+            return cp - port->scrcnt; /* we can reuse buffer */
         }
-    } else {
+        *pre = port->scratch;
+        *presiz = port->scrcnt;
+    }
+    return cp;
+}
+
+ScmObj Scm_GetRemainingInputString(ScmPort *port, int flags)
+{
+    if (SCM_PORT_TYPE(port) != SCM_PORT_ISTR)
+        Scm_Error("input string port required, but got %S", port);
+    /* NB: we don't need to lock the port, since the string body
+       the port is pointing won't be changed. */
+    char cbuf[SCM_CHAR_MAX_BYTES];
+    const char *pre;
+    int presiz;
+    const char *ep = port->src.istr.end;
+    const char *cp = istr_remaining(port, cbuf, &pre, &presiz);
+    if (pre == NULL) {
+        /* A string can't keep a mapped file alive, so we copy the
+           content of a mapped port.  Scm_GetRemainingInputBytes gives
+           a shared view. */
+        if (port->src.istr.owner) flags |= SCM_STRING_COPYING;
         return Scm_MakeString(cp, (int)(ep-cp), -1, flags);
     }
+    /* we need to copy */
+    char *b = SCM_NEW_ATOMIC2(char *, presiz+(ep-cp)+1);
+    memcpy(b, pre, presiz);
+    memcpy(b+presiz, cp, ep-cp);
+    b[presiz+(ep-cp)] = '\0';
+    return Scm_MakeString(b, presiz+(int)(ep-cp), -1, flags);
 }
 
-static ScmObj get_remaining_input_string_aux(const char *s, int ssiz,
-                                             const char *p, int psiz,
-                                             int flags)
+/* Returns the remaining input of an input string port as an immutable
+   u8vector.  It shares the storage with the port whenever possible,
+   keeping the mapping of a mapped port alive. */
+ScmObj Scm_GetRemainingInputBytes(ScmPort *port)
 {
-    char *b = SCM_NEW_ATOMIC2(char *, psiz+ssiz+1);
-    memcpy(b, p, psiz);
-    memcpy(b+psiz, s, ssiz);
-    b[psiz+ssiz] = '\0';
-    return Scm_MakeString(b, psiz+ssiz, -1, flags);
+    if (SCM_PORT_TYPE(port) != SCM_PORT_ISTR)
+        Scm_Error("input string port required, but got %S", port);
+    char cbuf[SCM_CHAR_MAX_BYTES];
+    const char *pre;
+    int presiz;
+    const char *ep = port->src.istr.end;
+    const char *cp = istr_remaining(port, cbuf, &pre, &presiz);
+    if (pre == NULL) {
+        return Scm_MakeUVectorFull(SCM_CLASS_U8VECTOR, (ScmSmallInt)(ep-cp),
+                                   (void*)cp, TRUE, port->src.istr.owner);
+    }
+    char *b = SCM_NEW_ATOMIC2(char *, presiz+(ep-cp));
+    memcpy(b, pre, presiz);
+    memcpy(b+presiz, cp, ep-cp);
+    return Scm_MakeUVectorFull(SCM_CLASS_U8VECTOR, presiz+(ScmSmallInt)(ep-cp),
+                               b, TRUE, NULL);
 }
 
 /* TRANSIENT: Pre-0.9 Compatibility routine.  Kept for the binary compatibility.
@@ -36,8 +36,10 @@
  * locking operations.
  *
  * The macro SHORTCUT allows 'safe' version to bypass lock/unlock
- * stuff by calling 'unsafe' version when the port is already locked by
- * the calling thread.
+ * stuff by calling 'unsafe' version when the port is private, or
+ * already locked by the calling thread.  For private ports, we don't
+ * even need to know the calling thread, so VMDECL only declares vm,
+ * and SHORTCUT looks it up after checking the flag.
  */
 
 /* [scratch and ungottern buffer]
@@ -61,12 +63,16 @@
  */
 
 #ifdef SAFE_PORT_OP
-#define VMDECL        ScmVM *vm = Scm_VM()
+#define VMDECL        ScmVM *vm
 #define LOCK(p)       PORT_LOCK(p, vm)
 #define UNLOCK(p)     PORT_UNLOCK(p)
 #define SAFE_CALL(p, exp) PORT_SAFE_CALL(p, exp, /*no cleanup*/)
-#define SHORTCUT(p, unsafe) \
-  do { if (PORT_LOCKED(p, vm)) { unsafe; }} while (0)
+#define SHORTCUT(p, unsafe)                                     \
+  do {                                                          \
+    if (SCM_PORT_PRIVATE_P(p)) { PORT_PRIVATE_CHECK(p); unsafe; } \
+    vm = Scm_VM();                                              \
+    if (PORT_LOCKED(p, vm)) { unsafe; }                         \
+  } while (0)
 #else
 #define VMDECL        /*none*/
 #define LOCK(p)       /*none*/
@@ -122,7 +128,7 @@ void Scm_PutbUnsafe(ScmByte b, ScmPort *p)
         }
         SCM_ASSERT(p->src.buf.current < p->src.buf.end);
         *p->src.buf.current++ = b;
-        if (SCM_PORT_BUFFER_MODE(p) == SCM_PORT_BUFFER_NONE) {
+        if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_NONE) {
             SAFE_CALL(p, bufport_flush(p, 1, FALSE));
         }
         UNLOCK(p);
@@ -167,11 +173,11 @@ void Scm_PutcUnsafe(ScmChar c, ScmPort *p)
         SCM_ASSERT(p->src.buf.current+nb <= p->src.buf.end);
         SCM_CHAR_PUT(p->src.buf.current, c);
         p->src.buf.current += nb;
-        if (SCM_PORT_BUFFER_MODE(p) == SCM_PORT_BUFFER_LINE) {
+        if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_LINE) {
             if (c == '\n') {
                 SAFE_CALL(p, bufport_flush(p, nb, FALSE));
             }
-        } else if (SCM_PORT_BUFFER_MODE(p) == SCM_PORT_BUFFER_NONE) {
+        } else if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_NONE) {
             SAFE_CALL(p, bufport_flush(p, nb, FALSE));
         }
         UNLOCK(p);
@@ -208,13 +214,20 @@ void Scm_PutsUnsafe(ScmString *s, ScmPort *p)
     LOCK(p);
     CLOSE_CHECK(p);
 
+    if (SCM_STRING_ROPE_P(s)) {
+        /* Write the leaves directly, instead of flattening the string. */
+        SAFE_CALL(p, Scm__StringForEachChunk(s, putz_chunk, p));
+        UNLOCK(p);
+        return;
+    }
+
     switch (SCM_PORT_TYPE(p)) {
     case SCM_PORT_FILE: {
         u_int size;
         const char *ss = Scm_GetStringContent(s, &size, NULL, NULL);
         SAFE_CALL(p, bufport_write(p, ss, size));
 
-        if (SCM_PORT_BUFFER_MODE(p) == SCM_PORT_BUFFER_LINE) {
+        if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_LINE) {
             const char *cp = p->src.buf.current;
             while (cp-- > p->src.buf.buffer) {
                 if (*cp == '\n') {
@@ -222,7 +235,7 @@ void Scm_PutsUnsafe(ScmString *s, ScmPort *p)
                     break;
                 }
             }
-        } else if (SCM_PORT_BUFFER_MODE(p) == SCM_PORT_BUFFER_NONE) {
+        } else if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_NONE) {
             SAFE_CALL(p, bufport_flush(p, 0, TRUE));
         }
         UNLOCK(p);
@@ -262,7 +275,7 @@ void Scm_PutzUnsafe(const char *s, int siz, ScmPort *p)
     switch (SCM_PORT_TYPE(p)) {
     case SCM_PORT_FILE:
         SAFE_CALL(p, bufport_write(p, s, siz));
-        if (SCM_PORT_BUFFER_MODE(p) == SCM_PORT_BUFFER_LINE) {
+        if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_LINE) {
             const char *cp = p->src.buf.current;
             while (cp-- > p->src.buf.buffer) {
                 if (*cp == '\n') {
@@ -270,7 +283,7 @@ void Scm_PutzUnsafe(const char *s, int siz, ScmPort *p)
                     break;
                 }
             }
-        } else if (SCM_PORT_BUFFER_MODE(p) == SCM_PORT_BUFFER_NONE) {
+        } else if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_NONE) {
             SAFE_CALL(p, bufport_flush(p, 0, TRUE));
         }
         UNLOCK(p);
@@ -290,6 +303,56 @@ void Scm_PutzUnsafe(const char *s, int siz, ScmPort *p)
     }
 }
 
+/*=================================================================
+ * Putzv
+ *   Writes N chunks at once.  For a file port, the chunks that don't
+ *   fit in the buffer are written together with it by writev(2).
+ */
+
+#ifdef SAFE_PORT_OP
+void Scm_Putzv(const ScmIOVec *v, int n, ScmPort *p)
+#else
+void Scm_PutzvUnsafe(const ScmIOVec *v, int n, ScmPort *p)
+#endif
+{
+    VMDECL;
+    SHORTCUT(p, Scm_PutzvUnsafe(v, n, p); return);
+    WALKER_CHECK(p);
+    LOCK(p);
+    CLOSE_CHECK(p);
+    switch (SCM_PORT_TYPE(p)) {
+    case SCM_PORT_FILE:
+        SAFE_CALL(p, bufport_writev(p, v, n));
+        if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_LINE) {
+            const char *cp = p->src.buf.current;
+            while (cp-- > p->src.buf.buffer) {
+                if (*cp == '\n') {
+                    SAFE_CALL(p, bufport_flush(p, (int)(cp - p->src.buf.current), FALSE));
+                    break;
+                }
+            }
+        } else if (SCM_PORT_FLUSH_MODE(p) == SCM_PORT_BUFFER_NONE) {
+            SAFE_CALL(p, bufport_flush(p, 0, TRUE));
+        }
+        UNLOCK(p);
+        break;
+    case SCM_PORT_OSTR:
+        for (int i = 0; i < n; i++) {
+            Scm_DStringPutz(&p->src.ostr, v[i].base, v[i].len);
+        }
+        UNLOCK(p);
+        break;
+    case SCM_PORT_PROC:
+        SAFE_CALL(p, procport_writev(p, v, n));
+        UNLOCK(p);
+        break;
+    default:
+        UNLOCK(p);
+        Scm_PortError(p, SCM_PORT_ERROR_OUTPUT,
+                      "bad port type for output: %S", p);
+    }
+}
+
 /*=================================================================
  * Flush
  */
@@ -819,13 +882,6 @@ int Scm_GetzUnsafe(char *buf, int buflen, ScmPort *p)
 
 /* Auxiliary procedures */
 
-/* NB: it may be further optimized by scanning the contents of buffer
-   when the port is a buffered port or an input string, which allows
-   us to avoid mb->wc->mb conversion.   See port.c, v 1.69 for some
-   attempt to do so.  The problem there is that if I have to take
-   into account the cases of the ungotten char and the scratch buffer,
-   code becomes ugly.  There might be some better approach. */
-
 #ifndef READLINE_AUX
 #define READLINE_AUX
 /* Assumes the port is locked, and the caller takes care of unlocking
@@ -833,28 +889,147 @@ int Scm_GetzUnsafe(char *buf, int buflen, ScmPort *p)
 /* NB: this routine reads bytes, not chars.  It allows to readline
    from a port in unknown character encoding (e.g. reading the first
    line of xml doc to find out charset parameter). */
-ScmObj readline_body(ScmPort *p)
+
+/* The line read is either appended to a DString (ds != NULL), or copied
+   to a fixed buffer.  */
+typedef struct readline_sink_rec {
+    ScmDString *ds;
+    char *buf;
+    ScmSmallInt room;           /* remaining size of buf */
+    ScmSmallInt count;          /* # of bytes stored */
+} readline_sink;
+
+enum {
+    READLINE_EOF,               /* nothing read before EOF */
+    READLINE_LINE,              /* read a line */
+    READLINE_FULL               /* buf is full before the end of line */
+};
+
+/* Stores up to N bytes from S to the sink, and returns the number of
+   bytes stored. */
+static ScmSmallInt readline_store(readline_sink *k, const char *s,
+                                  ScmSmallInt n)
 {
-    ScmDString ds;
+    if (k->ds) {
+        Scm_DStringPutz(k->ds, s, n);
+    } else {
+        if (n > k->room) n = k->room;
+        memcpy(k->buf + k->count, s, n);
+        k->room -= n;
+    }
+    k->count += n;
+    return n;
+}
 
-    Scm_DStringInit(&ds);
-    int b1 = Scm_GetbUnsafe(p);
-    if (b1 == EOF) return SCM_EOF;
+/* We've read a CR.  Consume following LF if any. */
+static void readline_cr(ScmPort *p)
+{
+    int b2 = Scm_GetbUnsafe(p);
+    if (b2 != EOF && b2 != '\n') Scm_UngetbUnsafe(b2, p);
+}
+
+/* If the port is a buffered port or an input string, we scan the bytes
+   in the buffer for the line terminator and store them in one go.
+   When there's pushed back stuff, or for procedural ports, we read
+   a byte at a time. */
+static int readline_scan(ScmPort *p, readline_sink *k)
+{
+    int seen = FALSE;
+    if (SCM_PORT_CLOSED_P(p)) {
+        Scm_PortError(p, SCM_PORT_ERROR_CLOSED,
+                      "I/O attempted on closed port: %S", p);
+    }
     for (;;) {
-        if (b1 == EOF) return Scm_DStringGet(&ds, 0);
-        if (b1 == '\n') break;
-        if (b1 == '\r') {
-            int b2 = Scm_GetbUnsafe(p);
-            if (b2 == EOF || b2 == '\n') break;
-            Scm_UngetbUnsafe(b2, p);
+        const char *cur, *end;
+        if (p->scrcnt || p->ungotten != SCM_CHAR_INVALID
+            || SCM_PORT_TYPE(p) == SCM_PORT_PROC) {
+            if (!k->ds && k->room == 0) {
+                /* We can still finish the line if the terminator follows */
+                int b = Scm_PeekbUnsafe(p);
+                if (b == EOF) return seen? READLINE_LINE : READLINE_EOF;
+                if (b != '\n' && b != '\r') return READLINE_FULL;
+            }
+            int b = Scm_GetbUnsafe(p);
+            if (b == EOF) return seen? READLINE_LINE : READLINE_EOF;
+            seen = TRUE;
+            if (b == '\n') break;
+            if (b == '\r') { readline_cr(p); break; }
+            char c = (char)b;
+            readline_store(k, &c, 1);
+            continue;
+        }
+        if (SCM_PORT_TYPE(p) == SCM_PORT_FILE) {
+            if (p->src.buf.current >= p->src.buf.end
+                && bufport_fill(p, 1, FALSE) == 0) {
+                return seen? READLINE_LINE : READLINE_EOF;
+            }
+            cur = p->src.buf.current;
+            end = p->src.buf.end;
+        } else {
+            cur = p->src.istr.current;
+            end = p->src.istr.end;
+            if (cur >= end) return seen? READLINE_LINE : READLINE_EOF;
+        }
+        seen = TRUE;
+        const char *q = cur;
+        while (q < end && *q != '\n' && *q != '\r') q++;
+        ScmSmallInt n = readline_store(k, cur, q - cur);
+        if (SCM_PORT_TYPE(p) == SCM_PORT_FILE) p->src.buf.current += n;
+        else p->src.istr.current += n;
+        p->bytes += n;
+        if (cur + n < q) return READLINE_FULL;
+        if (q < end) {
+            /* consume the terminator */
+            if (Scm_GetbUnsafe(p) == '\r') readline_cr(p);
             break;
         }
-        SCM_DSTRING_PUTB(&ds, b1);
-        b1 = Scm_GetbUnsafe(p);
     }
     p->line++;
+    return READLINE_LINE;
+}
+
+ScmObj readline_body(ScmPort *p)
+{
+    ScmDString ds;
+    readline_sink k;
+
+    Scm_DStringInit(&ds);
+    k.ds = &ds;
+    k.buf = NULL;
+    k.room = k.count = 0;
+    if (readline_scan(p, &k) == READLINE_EOF) return SCM_EOF;
     return Scm_DStringGet(&ds, 0);
 }
+
+/* Reads a line into BUF, without the terminator.  Returns the number of
+   bytes stored, or -1 at EOF.  If the line doesn't fit in BUFLEN bytes,
+   the rest of the line is left in the port and *COMPLETEP is set to
+   FALSE. */
+static ScmSmallInt readline_bytes_body(ScmPort *p, char *buf,
+                                       ScmSmallInt buflen, int *completep)
+{
+    readline_sink k;
+    k.ds = NULL;
+    k.buf = buf;
+    k.room = buflen;
+    k.count = 0;
+    int r = readline_scan(p, &k);
+    if (completep) *completep = (r != READLINE_FULL);
+    if (r == READLINE_EOF) return -1;
+    return k.count;
+}
+
+/* Reads up to N lines into DST.  Returns the number of lines read. */
+static ScmSmallInt readlines_body(ScmPort *p, ScmObj *dst, ScmSmallInt n)
+{
+    ScmSmallInt i = 0;
+    for (; i < n; i++) {
+        ScmObj line = readline_body(p);
+        if (SCM_EOFP(line)) break;
+        dst[i] = line;
+    }
+    return i;
+}
 #endif /* READLINE_AUX */
 
 #ifdef SAFE_PORT_OP
@@ -873,6 +1048,43 @@ ScmObj Scm_ReadLineUnsafe(ScmPort *p)
     return r;
 }
 
+/* Like Scm_ReadLine, but reads into a caller-supplied buffer without
+   allocation.  See readline_bytes_body above. */
+#ifdef SAFE_PORT_OP
+ScmSmallInt Scm_ReadLineBytes(ScmPort *p, char *buf, ScmSmallInt buflen,
+                              int *completep)
+#else
+ScmSmallInt Scm_ReadLineBytesUnsafe(ScmPort *p, char *buf,
+                                    ScmSmallInt buflen, int *completep)
+#endif
+{
+    ScmSmallInt r = 0;
+    VMDECL;
+    SHORTCUT(p, return Scm_ReadLineBytesUnsafe(p, buf, buflen, completep));
+
+    LOCK(p);
+    SAFE_CALL(p, r = readline_bytes_body(p, buf, buflen, completep));
+    UNLOCK(p);
+    return r;
+}
+
+/* Reads up to N lines into DST, locking the port only once. */
+#ifdef SAFE_PORT_OP
+ScmSmallInt Scm_ReadLines(ScmPort *p, ScmObj *dst, ScmSmallInt n)
+#else
+ScmSmallInt Scm_ReadLinesUnsafe(ScmPort *p, ScmObj *dst, ScmSmallInt n)
+#endif
+{
+    ScmSmallInt r = 0;
+    VMDECL;
+    SHORTCUT(p, return Scm_ReadLinesUnsafe(p, dst, n));
+
+    LOCK(p);
+    SAFE_CALL(p, r = readlines_body(p, dst, n));
+    UNLOCK(p);
+    return r;
+}
+
 /*=================================================================
  * ByteReady
  */
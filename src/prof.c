@@ -38,6 +38,28 @@
 #include "gauche/vminsn.h"
 #include "gauche/prof.h"
 
+/*=============================================================
+ * Allocation sampler entry
+ */
+
+/* If the allocation interval is set, SCM_MALLOC and SCM_MALLOC_ATOMIC
+   call Scm__ProfCountAlloc while the profiler runs (via
+   Scm__HookedMalloc; see core.c).  Each time about
+   allocInterval bytes are allocated, the code the current VM is executing
+   is charged for them; if a subr allocates, the Scheme code calling it
+   is charged.  The countdown is shared among threads and updated without
+   locking, for we only need an approximation. */
+
+static long allocInterval = 0;
+static long allocCountdown = 0;
+
+static void alloc_sample(void);
+
+void Scm__ProfCountAlloc(size_t size)
+{
+    if ((allocCountdown -= (long)size) <= 0) alloc_sample();
+}
+
 #ifdef GAUCHE_PROFILE
 
 /* WARNING: duplicated code - see signal.c; we should integrate them later */
@@ -73,6 +95,65 @@
         setitimer(ITIMER_PROF, &tval, &oval);   \
     } while (0)
 
+/*=============================================================
+ * Process-wide profiling state
+ */
+
+/* In the default mode, the profiler only samples the thread that
+ * started it, using the process-wide ITIMER_PROF.  In the process-wide
+ * mode, instead, a dedicated sampler thread sends SIGPROF to each
+ * thread with a VM every SAMPLING_PERIOD.  If the CPU-time clock of
+ * threads is available, a thread is sampled only when it has consumed
+ * SAMPLING_PERIOD of CPU time since the last sample, so that idle
+ * threads don't pile up samples.  Each VM still records samples in its
+ * own buffer; the results are merged when they are retrieved.
+ *
+ * Threads created by Gauche block SIGPROF (see ext/threads), so each
+ * profiled thread unblocks it by itself---either when it is attached
+ * while profiling is active, or at the next safe point after the
+ * profiler requests it through attentionRequest.
+ *
+ * procprof.vms keeps all VMs profiled in the current session, so that
+ * their results survive the termination of threads until
+ * Scm_ProfilerReset.
+ */
+
+#ifdef GAUCHE_USE_PTHREADS
+#define PROCESS_PROFILER_AVAILABLE 1
+
+/* values of ScmVMProfiler.threadRequest */
+enum {
+    PROF_THREAD_ATTACH = 1,     /* start receiving samples */
+    PROF_THREAD_DETACH = 2      /* stop receiving samples */
+};
+
+typedef struct prof_thread_rec {
+    pthread_t thread;
+    int hasClock;
+    clockid_t clock;
+    struct timespec lastCpu;
+} prof_thread;
+
+static struct {
+    int session;                /* TRUE if process-wide mode is used */
+    int active;                 /* TRUE while the sampler thread runs */
+    int stackDepth;
+    ScmObj vms;                 /* VMs profiled in this session */
+    pthread_t sampler;
+    prof_thread *threads;       /* malloc'ed; not scanned by GC */
+    int numThreads;
+    int maxThreads;
+} procprof;
+
+static pthread_mutex_t procprof_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+#define PROCPROF_SESSION_P()  (procprof.session)
+#define PROCPROF_ACTIVE_P()   (procprof.active)
+#else  /* !GAUCHE_USE_PTHREADS */
+#define PROCPROF_SESSION_P()  FALSE
+#define PROCPROF_ACTIVE_P()   FALSE
+#endif /* !GAUCHE_USE_PTHREADS */
+
 /*=============================================================
  * Statistic sampler
  */
@@ -99,6 +180,47 @@ static void sampler_flush(ScmVM *vm)
     return;
 }
 
+/* Flush stack sample buffer to the file.  The buffer only contains
+   complete records. */
+static void stack_flush(ScmVM *vm)
+{
+    if (vm->prof == NULL) return; /* for safety */
+    if (vm->prof->stackFd < 0 || vm->prof->currentStack == 0) return;
+
+    ssize_t r = write(vm->prof->stackFd, vm->prof->stackBuf,
+                      vm->prof->currentStack * sizeof(ScmObj));
+    if (r == (ssize_t)-1) {
+        vm->prof->errorOccurred++;
+    }
+    vm->prof->currentStack = 0;
+}
+
+/* Record code bases of the continuation frames, following LEAF, which
+   is the function recorded in the flat sample.  Called from the signal
+   handler, so we can't allocate. */
+static void sampler_sample_stack(ScmVM *vm, ScmObj leaf)
+{
+    ScmVMProfiler *prof = vm->prof;
+    int depth = prof->stackDepth;
+
+    if (prof->currentStack + depth + 1 > SCM_PROF_STACK_BUFFER_SIZE) {
+        stack_flush(vm);
+    }
+
+    int head = prof->currentStack;
+    int n = 0;
+    ScmObj *p = &prof->stackBuf[head+1];
+    if (!SCM_FALSEP(leaf)) {
+        p[n++] = leaf;
+    }
+    for (ScmContFrame *c = vm->cont; c && n < depth; c = c->prev) {
+        if (c->base == NULL) continue;
+        p[n++] = SCM_OBJ(c->base);
+    }
+    prof->stackBuf[head] = SCM_MAKE_INT(n);
+    prof->currentStack = head + n + 1;
+}
+
 /* signal handler */
 static void sampler_sample(int sig)
 {
@@ -107,9 +229,13 @@ static void sampler_sample(int sig)
     if (vm->prof->state != SCM_PROFILER_RUNNING) return;
 
     if (vm->prof->currentSample >= SCM_PROF_SAMPLES_IN_BUFFER) {
-        ITIMER_STOP();
-        sampler_flush(vm);
-        ITIMER_START();
+        if (PROCPROF_ACTIVE_P()) {
+            sampler_flush(vm);
+        } else {
+            ITIMER_STOP();
+            sampler_flush(vm);
+            ITIMER_START();
+        }
     }
 
     int i = vm->prof->currentSample++;
@@ -128,6 +254,9 @@ static void sampler_sample(int sig)
         vm->prof->samples[i].func = SCM_FALSE;
         vm->prof->samples[i].pc = NULL;
     }
+    if (vm->prof->stackDepth > 0) {
+        sampler_sample_stack(vm, vm->prof->samples[i].func);
+    }
     vm->prof->totalSamples++;
 }
 
@@ -149,6 +278,55 @@ void collect_samples(ScmVMProfiler *prof)
     }
 }
 
+/* Convert stack samples in BUF into lists and push them to prof->stacks.
+   Like collect_samples, we only trust the objects that are recorded by
+   the call counter, for the addresses saved in the file don't keep the
+   objects from being collected.  The other entries are dropped. */
+static void collect_stacks(ScmVMProfiler *prof, ScmObj *buf, long nwords)
+{
+    long i = 0;
+    while (i < nwords) {
+        SCM_ASSERT(SCM_INTP(buf[i]));
+        long n = SCM_INT_VALUE(buf[i]);
+        ScmObj stack = SCM_NIL;
+        SCM_ASSERT(i + n < nwords);
+        for (long k = 1; k <= n; k++) {
+            ScmObj e = Scm_HashTableRef(prof->statHash, buf[i+k],
+                                        SCM_UNBOUND);
+            if (!SCM_UNBOUNDP(e)) stack = Scm_Cons(buf[i+k], stack);
+        }
+        if (!SCM_NULLP(stack)) prof->stacks = Scm_Cons(stack, prof->stacks);
+        i += n + 1;
+    }
+}
+
+/*=============================================================
+ * Allocation sampler
+ */
+
+static void alloc_sample(void)
+{
+    long interval = allocInterval;
+    if (interval <= 0) {
+        allocCountdown = 0;
+        return;
+    }
+    long n = 1 + (-allocCountdown) / interval;
+    allocCountdown += n * interval;
+
+    ScmVM *vm = Scm_VM();
+    if (vm == NULL || vm->prof == NULL || vm->base == NULL) return;
+    if (vm->prof->state != SCM_PROFILER_RUNNING) return;
+    /* Updating the table allocates; don't sample recursively. */
+    if (vm->prof->allocSampling) return;
+    vm->prof->allocSampling = TRUE;
+    ScmObj func = SCM_OBJ(vm->base);
+    ScmObj v = Scm_HashTableRef(vm->prof->allocHash, func, SCM_MAKE_INT(0));
+    Scm_HashTableSet(vm->prof->allocHash, func,
+                     Scm_Add(v, Scm_MakeInteger(n * interval)), 0);
+    vm->prof->allocSampling = FALSE;
+}
+
 /*=============================================================
  * Call Counter
  */
@@ -202,35 +380,71 @@ void Scm_ProfilerCountBufferFlush(ScmVM *vm)
 }
 
 /*=============================================================
- * External API
+ * Per-VM operations
  */
-void Scm_ProfilerStart(void)
+
+/* Creates an anonymous temporary file */
+static int make_tmpfile(void)
 {
-    ScmVM *vm = Scm_VM();
     ScmObj templat = Scm_StringAppendC(SCM_STRING(Scm_TmpDir()),
                                        "/gauche-profXXXXXX", -1, -1);
     char *templat_buf = Scm_GetString(SCM_STRING(templat)); /*mutable copy*/
+    int fd = Scm_Mkstemp(templat_buf);
+    unlink(templat_buf);       /* keep anonymous tmpfile */
+    return fd;
+}
 
+static void prof_init(ScmVM *vm)
+{
     if (!vm->prof) {
         vm->prof = SCM_NEW(ScmVMProfiler);
         vm->prof->state = SCM_PROFILER_INACTIVE;
-        vm->prof->samplerFd = Scm_Mkstemp(templat_buf);
+        vm->prof->samplerFd = make_tmpfile();
         vm->prof->currentSample = 0;
         vm->prof->totalSamples = 0;
         vm->prof->errorOccurred = 0;
         vm->prof->currentCount = 0;
         vm->prof->statHash =
             SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
-        unlink(templat_buf);       /* keep anonymous tmpfile */
+        vm->prof->stackDepth = 0;
+        vm->prof->stackFd = -1;
+        vm->prof->currentStack = 0;
+        vm->prof->stacks = SCM_NIL;
+        vm->prof->threadRequest = 0;
+        vm->prof->threadAttached = FALSE;
+        vm->prof->sigprofBlocked = FALSE;
+        vm->prof->allocHash =
+            SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+        vm->prof->allocSampling = FALSE;
     } else if (vm->prof->samplerFd < 0) {
-        vm->prof->samplerFd = Scm_Mkstemp(templat_buf);
-        unlink(templat_buf);
+        vm->prof->samplerFd = make_tmpfile();
     }
+}
 
-    if (vm->prof->state == SCM_PROFILER_RUNNING) return;
+/* Make VM's profiler running.  Returns FALSE if it's already running. */
+static int prof_activate(ScmVM *vm, int depth)
+{
+    prof_init(vm);
+    if (vm->prof->state == SCM_PROFILER_RUNNING) return FALSE;
+    vm->prof->stackDepth = depth;
+    if (depth > 0 && vm->prof->stackFd < 0) {
+        vm->prof->stackFd = make_tmpfile();
+    }
     vm->prof->state = SCM_PROFILER_RUNNING;
     vm->profilerRunning = TRUE;
+    if (allocInterval > 0) Scm__SetAllocHook(SCM_ALLOC_HOOK_PROFILER, TRUE);
+    return TRUE;
+}
+
+static void prof_deactivate(ScmVM *vm)
+{
+    if (vm->prof->state != SCM_PROFILER_RUNNING) return;
+    vm->prof->state = SCM_PROFILER_PAUSING;
+    vm->profilerRunning = FALSE;
+}
 
+static void install_handler(void)
+{
     /* NB: this should be done globally!!! */
     struct sigaction act;
     act.sa_handler = sampler_sample;
@@ -239,51 +453,39 @@ void Scm_ProfilerStart(void)
     if (sigaction(SIGPROF, &act, NULL) < 0) {
         Scm_SysError("sigaction failed");
     }
-
-    ITIMER_START();
 }
 
-int Scm_ProfilerStop(void)
+static void prof_reset(ScmVM *vm)
 {
-    ScmVM *vm = Scm_VM();
-    if (vm->prof == NULL) return 0;
-    if (vm->prof->state != SCM_PROFILER_RUNNING) return 0;
-    ITIMER_STOP();
-    vm->prof->state = SCM_PROFILER_PAUSING;
-    vm->profilerRunning = FALSE;
-    return vm->prof->totalSamples;
-}
-
-void Scm_ProfilerReset(void)
-{
-    ScmVM *vm = Scm_VM();
-
     if (vm->prof == NULL) return;
     if (vm->prof->state == SCM_PROFILER_INACTIVE) return;
-    if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
+    prof_deactivate(vm);
 
     if (vm->prof->samplerFd >= 0) {
         close(vm->prof->samplerFd);
         vm->prof->samplerFd = -1;
     }
+    if (vm->prof->stackFd >= 0) {
+        close(vm->prof->stackFd);
+        vm->prof->stackFd = -1;
+    }
     vm->prof->totalSamples = 0;
     vm->prof->currentSample = 0;
     vm->prof->errorOccurred = 0;
     vm->prof->currentCount = 0;
     vm->prof->statHash =
         SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+    vm->prof->currentStack = 0;
+    vm->prof->stacks = SCM_NIL;
+    vm->prof->allocHash =
+        SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
     vm->prof->state = SCM_PROFILER_INACTIVE;
 }
 
-/* Returns the statHash */
-ScmObj Scm_ProfilerRawResult(void)
+/* Collect samples of VM, which must not be running, into its statHash
+   and stacks. */
+static ScmObj prof_collect(ScmVM *vm)
 {
-    ScmVM *vm = Scm_VM();
-
-    if (vm->prof == NULL) return SCM_FALSE;
-    if (vm->prof->state == SCM_PROFILER_INACTIVE) return SCM_FALSE;
-    if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
-
     if (vm->prof->errorOccurred > 0) {
         Scm_Warn("profiler: An error has been occurred during saving profiling samples.  The result may not be accurate");
     }
@@ -297,7 +499,7 @@ ScmObj Scm_ProfilerRawResult(void)
     off_t off;
     SCM_SYSCALL(off, lseek(vm->prof->samplerFd, 0, SEEK_SET));
     if (off == (off_t)-1) {
-        Scm_ProfilerReset();
+        prof_reset(vm);
         Scm_Error("profiler: seek failed in retrieving sample data");
     }
     for (;;) {
@@ -312,15 +514,416 @@ ScmObj Scm_ProfilerRawResult(void)
         Scm_SysError("profiler: failed to truncate temporary file");
     }
 
+    /* collect stack samples.  Records in the file may span the boundary
+       of read chunks, so we read them at once. */
+    if (vm->prof->stackFd >= 0) {
+        SCM_SYSCALL(off, lseek(vm->prof->stackFd, 0, SEEK_END));
+        if (off > 0) {
+            long nwords = (long)(off / sizeof(ScmObj));
+            ScmObj *buf = SCM_NEW_ATOMIC_ARRAY(ScmObj, nwords);
+            char *bp = (char*)buf;
+            size_t rest = (size_t)nwords * sizeof(ScmObj);
+            SCM_SYSCALL(off, lseek(vm->prof->stackFd, 0, SEEK_SET));
+            while (off != (off_t)-1 && rest > 0) {
+                ssize_t r = read(vm->prof->stackFd, bp, rest);
+                if (r <= 0) break;
+                bp += r;
+                rest -= r;
+            }
+            if (rest > 0) {
+                prof_reset(vm);
+                Scm_Error("profiler: failed to retrieve stack samples");
+            }
+            collect_stacks(vm->prof, buf, nwords);
+            if (ftruncate(vm->prof->stackFd, 0) < 0) {
+                Scm_SysError("profiler: failed to truncate temporary file");
+            }
+            SCM_SYSCALL(off, lseek(vm->prof->stackFd, 0, SEEK_SET));
+        }
+    }
+    collect_stacks(vm->prof, vm->prof->stackBuf, vm->prof->currentStack);
+    vm->prof->currentStack = 0;
+
     return SCM_OBJ(vm->prof->statHash);
 }
 
+/*=============================================================
+ * Process-wide sampling
+ */
+
+#ifdef PROCESS_PROFILER_AVAILABLE
+
+/* Called in the profiled thread itself. */
+static void thread_attach(ScmVM *vm)
+{
+    if (vm->prof->threadAttached) return;
+
+    prof_thread t;
+    t.thread = pthread_self();
+    t.hasClock = FALSE;
+#if defined(_POSIX_THREAD_CPUTIME) && (_POSIX_THREAD_CPUTIME >= 0)
+    if (pthread_getcpuclockid(t.thread, &t.clock) == 0
+        && clock_gettime(t.clock, &t.lastCpu) == 0) {
+        t.hasClock = TRUE;
+    }
+#endif
+
+    (void)pthread_mutex_lock(&procprof_mutex);
+    if (procprof.numThreads == procprof.maxThreads) {
+        int n = procprof.maxThreads ? procprof.maxThreads * 2 : 8;
+        prof_thread *p = realloc(procprof.threads, n * sizeof(prof_thread));
+        if (p == NULL) {
+            (void)pthread_mutex_unlock(&procprof_mutex);
+            Scm_Warn("profiler: couldn't allocate memory to profile thread %S",
+                     vm->name);
+            return;
+        }
+        procprof.threads = p;
+        procprof.maxThreads = n;
+    }
+    procprof.threads[procprof.numThreads++] = t;
+    (void)pthread_mutex_unlock(&procprof_mutex);
+
+    sigset_t set, oset;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    SIGPROCMASK(SIG_UNBLOCK, &set, &oset);
+    vm->prof->sigprofBlocked = sigismember(&oset, SIGPROF);
+    vm->prof->threadAttached = TRUE;
+}
+
+/* Called in the profiled thread itself. */
+static void thread_detach(ScmVM *vm)
+{
+    if (!vm->prof->threadAttached) return;
+
+    pthread_t self = pthread_self();
+    (void)pthread_mutex_lock(&procprof_mutex);
+    for (int i=0; i<procprof.numThreads; i++) {
+        if (pthread_equal(procprof.threads[i].thread, self)) {
+            procprof.threads[i] = procprof.threads[--procprof.numThreads];
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&procprof_mutex);
+
+    if (vm->prof->sigprofBlocked) {
+        sigset_t set;
+        sigemptyset(&set);
+        sigaddset(&set, SIGPROF);
+        SIGPROCMASK(SIG_BLOCK, &set, NULL);
+    }
+    vm->prof->threadAttached = FALSE;
+}
+
+/* Ask VM's thread to attach/detach itself at the next safe point.
+   If VM is the current one, do it immediately. */
+static void thread_request(ScmVM *vm, int req)
+{
+    if (vm == Scm_VM()) {
+        vm->prof->threadRequest = req;
+        Scm__ProfilerThreadRequest(vm);
+    } else {
+        vm->prof->threadRequest = req;
+        vm->attentionRequest = TRUE;
+    }
+}
+
+static void add_session_vm(ScmVM *vm)
+{
+    ScmObj p = Scm_Cons(SCM_OBJ(vm), SCM_NIL);
+    (void)pthread_mutex_lock(&procprof_mutex);
+    if (SCM_FALSEP(Scm_Memq(SCM_OBJ(vm), procprof.vms))) {
+        SCM_SET_CDR(p, procprof.vms);
+        procprof.vms = p;
+    }
+    (void)pthread_mutex_unlock(&procprof_mutex);
+}
+
+static void *sampler_thread(void *data)
+{
+    sigset_t set;
+    sigfillset(&set);
+    SIGPROCMASK(SIG_BLOCK, &set, NULL);
+
+    for (;;) {
+        struct timespec req;
+        req.tv_sec = 0;
+        req.tv_nsec = SAMPLING_PERIOD * 1000;
+        nanosleep(&req, NULL);
+
+        (void)pthread_mutex_lock(&procprof_mutex);
+        if (!procprof.active) {
+            (void)pthread_mutex_unlock(&procprof_mutex);
+            break;
+        }
+        for (int i=0; i<procprof.numThreads; i++) {
+            prof_thread *t = &procprof.threads[i];
+            if (t->hasClock) {
+                struct timespec now;
+                if (clock_gettime(t->clock, &now) == 0) {
+                    long usec = (now.tv_sec - t->lastCpu.tv_sec) * 1000000L
+                        + (now.tv_nsec - t->lastCpu.tv_nsec) / 1000;
+                    if (usec < SAMPLING_PERIOD) continue;
+                    t->lastCpu = now;
+                }
+            }
+            (void)pthread_kill(t->thread, SIGPROF);
+        }
+        (void)pthread_mutex_unlock(&procprof_mutex);
+    }
+    return NULL;
+}
+
+static void procprof_start(int depth)
+{
+    if (procprof.active) return;
+
+    install_handler();
+    ScmObj vms = Scm__VMAllVMs(), lp;
+    (void)pthread_mutex_lock(&procprof_mutex);
+    if (!procprof.session) {
+        procprof.session = TRUE;
+        procprof.vms = SCM_NIL;
+    }
+    procprof.stackDepth = depth;
+    procprof.active = TRUE;
+    (void)pthread_mutex_unlock(&procprof_mutex);
+
+    SCM_FOR_EACH(lp, vms) {
+        ScmVM *vm = SCM_VM(SCM_CAR(lp));
+        prof_activate(vm, depth);
+        add_session_vm(vm);
+        thread_request(vm, PROF_THREAD_ATTACH);
+    }
+
+    if (pthread_create(&procprof.sampler, NULL, sampler_thread, NULL) != 0) {
+        (void)pthread_mutex_lock(&procprof_mutex);
+        procprof.active = FALSE;
+        (void)pthread_mutex_unlock(&procprof_mutex);
+        Scm_Error("profiler: couldn't start the sampler thread");
+    }
+}
+
+/* Returns the total number of samples in the session. */
+static int procprof_stop(void)
+{
+    (void)pthread_mutex_lock(&procprof_mutex);
+    int was_active = procprof.active;
+    procprof.active = FALSE;
+    (void)pthread_mutex_unlock(&procprof_mutex);
+    Scm__SetAllocHook(SCM_ALLOC_HOOK_PROFILER, FALSE);
+    if (was_active) (void)pthread_join(procprof.sampler, NULL);
+
+    ScmObj lp;
+    int total = 0;
+    SCM_FOR_EACH(lp, procprof.vms) {
+        ScmVM *vm = SCM_VM(SCM_CAR(lp));
+        prof_deactivate(vm);
+        if (vm->prof->threadAttached) thread_request(vm, PROF_THREAD_DETACH);
+        total += vm->prof->totalSamples;
+    }
+    return total;
+}
+
+static void procprof_reset(void)
+{
+    procprof_stop();
+    ScmObj lp;
+    SCM_FOR_EACH(lp, procprof.vms) {
+        prof_reset(SCM_VM(SCM_CAR(lp)));
+    }
+    (void)pthread_mutex_lock(&procprof_mutex);
+    procprof.session = FALSE;
+    procprof.vms = SCM_NIL;
+    (void)pthread_mutex_unlock(&procprof_mutex);
+}
+
+/* Called from Scm_AttachVM, in the newly attached thread. */
+void Scm__ProfilerVMAttached(ScmVM *vm)
+{
+    if (!procprof.active) return;
+    prof_activate(vm, procprof.stackDepth);
+    add_session_vm(vm);
+    thread_attach(vm);
+}
+
+/* Called from Scm_DetachVM, in the thread being detached. */
+void Scm__ProfilerVMDetached(ScmVM *vm)
+{
+    if (vm->prof == NULL) return;
+    thread_detach(vm);
+    prof_deactivate(vm);
+}
+
+/* Called from process_queued_requests in vm.c, when the profiler
+   asks the thread to start or stop receiving samples. */
+void Scm__ProfilerThreadRequest(ScmVM *vm)
+{
+    int req = vm->prof->threadRequest;
+    vm->prof->threadRequest = 0;
+    switch (req) {
+    case PROF_THREAD_ATTACH: thread_attach(vm); break;
+    case PROF_THREAD_DETACH: thread_detach(vm); break;
+    }
+}
+
+#else  /* !PROCESS_PROFILER_AVAILABLE */
+static void procprof_start(int depth)
+{
+    Scm_Error("profiling all threads is not supported on this platform.");
+}
+static int  procprof_stop(void) { return 0; }
+static void procprof_reset(void) { }
+void Scm__ProfilerVMAttached(ScmVM *vm) { }
+void Scm__ProfilerVMDetached(ScmVM *vm) { }
+void Scm__ProfilerThreadRequest(ScmVM *vm) { vm->prof->threadRequest = 0; }
+#endif /* !PROCESS_PROFILER_AVAILABLE */
+
+/*=============================================================
+ * External API
+ */
+
+void Scm_ProfilerStart(void)
+{
+    Scm_ProfilerStartWithStack(0);
+}
+
+static int clamp_depth(int depth)
+{
+    if (depth < 0) return 0;
+    if (depth > SCM_PROF_MAX_STACK_DEPTH) return SCM_PROF_MAX_STACK_DEPTH;
+    return depth;
+}
+
+/* If DEPTH > 0, each sample also records the code of up to DEPTH
+   continuation frames.  If a process-wide session has been started and
+   not reset, this resumes it. */
+void Scm_ProfilerStartWithStack(int depth)
+{
+    depth = clamp_depth(depth);
+    if (PROCPROF_SESSION_P()) {
+        procprof_start(depth);
+        return;
+    }
+
+    if (!prof_activate(Scm_VM(), depth)) return;
+    install_handler();
+    ITIMER_START();
+}
+
+/* Starts profiling all threads that have VMs, including the ones
+   created afterwards. */
+void Scm_ProfilerStartAllThreads(int depth)
+{
+    ScmVM *vm = Scm_VM();
+    if (vm->prof && vm->prof->state == SCM_PROFILER_RUNNING
+        && !PROCPROF_SESSION_P()) {
+        /* switching from per-thread mode */
+        ITIMER_STOP();
+        prof_deactivate(vm);
+    }
+    procprof_start(clamp_depth(depth));
+}
+
+int Scm_ProfilerStop(void)
+{
+    if (PROCPROF_SESSION_P()) return procprof_stop();
+
+    ScmVM *vm = Scm_VM();
+    if (vm->prof == NULL) return 0;
+    if (vm->prof->state != SCM_PROFILER_RUNNING) return 0;
+    ITIMER_STOP();
+    Scm__SetAllocHook(SCM_ALLOC_HOOK_PROFILER, FALSE);
+    prof_deactivate(vm);
+    return vm->prof->totalSamples;
+}
+
+/* If BYTES > 0, the profiler started afterwards also samples allocations
+   every BYTES bytes. */
+void Scm_ProfilerSetAllocationInterval(long bytes)
+{
+    allocInterval = (bytes > 0) ? bytes : 0;
+    allocCountdown = allocInterval;
+}
+
+void Scm_ProfilerReset(void)
+{
+    if (PROCPROF_SESSION_P()) {
+        procprof_reset();
+        return;
+    }
+
+    ScmVM *vm = Scm_VM();
+    if (vm->prof == NULL) return;
+    if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
+    prof_reset(vm);
+}
+
+/* Returns the statHash */
+ScmObj Scm_ProfilerRawResult(void)
+{
+    ScmVM *vm = Scm_VM();
+
+    if (vm->prof == NULL) return SCM_FALSE;
+    if (vm->prof->state == SCM_PROFILER_INACTIVE) return SCM_FALSE;
+    if (vm->prof->state == SCM_PROFILER_RUNNING) Scm_ProfilerStop();
+    return prof_collect(vm);
+}
+
+/* Returns the list of stack samples collected so far.  Each stack
+   sample is a list of code, outermost frame first. */
+ScmObj Scm_ProfilerRawStacks(void)
+{
+    ScmVM *vm = Scm_VM();
+
+    if (vm->prof == NULL) return SCM_FALSE;
+    if (vm->prof->state == SCM_PROFILER_INACTIVE) return SCM_FALSE;
+    Scm_ProfilerRawResult();
+    return vm->prof->stacks;
+}
+
+/* Returns a list of (<vm> <stat-hash> <stacks> <alloc-hash>) for every
+   VM profiled.
+   Without process-wide session, only the current VM is included. */
+ScmObj Scm_ProfilerRawResultAllThreads(void)
+{
+    ScmObj vms, lp, h = SCM_NIL, t = SCM_NIL;
+
+    if (PROCPROF_SESSION_P()) {
+        procprof_stop();
+#ifdef PROCESS_PROFILER_AVAILABLE
+        vms = procprof.vms;
+#else
+        vms = SCM_NIL;
+#endif
+    } else {
+        Scm_ProfilerStop();
+        vms = SCM_LIST1(SCM_OBJ(Scm_VM()));
+    }
+    SCM_FOR_EACH(lp, vms) {
+        ScmVM *vm = SCM_VM(SCM_CAR(lp));
+        if (vm->prof == NULL || vm->prof->state == SCM_PROFILER_INACTIVE) {
+            continue;
+        }
+        ScmObj r = prof_collect(vm);
+        SCM_APPEND1(h, t, SCM_LIST4(SCM_OBJ(vm), r, vm->prof->stacks,
+                                    SCM_OBJ(vm->prof->allocHash)));
+    }
+    return h;
+}
+
 #else  /* !GAUCHE_PROFILE */
 void Scm_ProfilerStart(void)
 {
     Scm_Error("profiler is not supported.");
 }
 
+void Scm_ProfilerStartWithStack(int depth)
+{
+    Scm_Error("profiler is not supported.");
+}
+
 int  Scm_ProfilerStop(void)
 {
     Scm_Error("profiler is not supported.");
@@ -337,4 +940,214 @@ ScmObj Scm_ProfilerRawResult(void)
     Scm_Error("profiler is not supported.");
     return SCM_FALSE;
 }
+
+ScmObj Scm_ProfilerRawStacks(void)
+{
+    Scm_Error("profiler is not supported.");
+    return SCM_FALSE;
+}
+
+void Scm_ProfilerStartAllThreads(int depth)
+{
+    Scm_Error("profiler is not supported.");
+}
+
+ScmObj Scm_ProfilerRawResultAllThreads(void)
+{
+    Scm_Error("profiler is not supported.");
+    return SCM_FALSE;
+}
+
+void Scm_ProfilerSetAllocationInterval(long bytes)
+{
+    Scm_Error("profiler is not supported.");
+}
+
+static void alloc_sample(void) { allocCountdown = 0; }
+
+void Scm__ProfilerVMAttached(ScmVM *vm) { }
+void Scm__ProfilerVMDetached(ScmVM *vm) { }
+void Scm__ProfilerThreadRequest(ScmVM *vm) { }
 #endif /* !GAUCHE_PROFILE */
+
+/*=============================================================
+ * Lock contention profiler
+ */
+
+/* While Scm__LockProfiling is TRUE, mutexes (ext/threads) and port
+   locks (PORT_LOCK in priv/portP.h) report each acquisition and release
+   here.  The statistics are kept per lock and per site, that is, the
+   code the acquiring VM is executing, as the allocation sampler does.
+   For a subr such as mutex-lock!, it is the Scheme code calling it.
+
+   All the bookkeeping is done under a single mutex.  It adds its own
+   contention, but only while profiling.  When not profiling, lockers
+   only check the flag. */
+
+int Scm__LockProfiling = FALSE;
+
+typedef struct lockprof_site_rec {
+    struct lockprof_site_rec *next;
+    ScmObj site;                /* code base, or #f */
+    u_long acquired;            /* # of acquisitions */
+    u_long contended;           /* # of acquisitions that had to wait */
+    ScmInt64 waitTime;          /* cumulated waiting time, in ns */
+    ScmInt64 maxWait;
+    ScmInt64 holdTime;          /* cumulated holding time, in ns */
+    ScmInt64 maxHold;
+    int maxWaiters;             /* max # of waiting threads seen */
+} lockprof_site;
+
+typedef struct lockprof_lock_rec {
+    ScmObj lock;
+    lockprof_site *sites;
+    int waiting;                /* # of threads waiting for the lock now */
+    ScmInt64 lockedAt;          /* when the holder acquired it, or 0 */
+    lockprof_site *holder;      /* site of the current holder */
+} lockprof_lock;
+
+static struct {
+    ScmInternalMutex mutex;
+    ScmHashCore locks;          /* lock address -> lockprof_lock */
+} lockprof;
+
+/* Caller must hold lockprof.mutex */
+static lockprof_site *lockprof_get(ScmObj lock, lockprof_lock **pl)
+{
+    ScmDictEntry *e = Scm_HashCoreSearch(&lockprof.locks, (intptr_t)lock,
+                                         SCM_DICT_CREATE);
+    if (!e->value) {
+        lockprof_lock *l = SCM_NEW(lockprof_lock);
+        l->lock = lock;
+        l->sites = NULL;
+        l->waiting = 0;
+        l->lockedAt = 0;
+        l->holder = NULL;
+        (void)SCM_DICT_SET_VALUE(e, SCM_OBJ(l));
+    }
+    lockprof_lock *l = (lockprof_lock*)e->value;
+    *pl = l;
+
+    ScmVM *vm = Scm_VM();
+    ScmObj site = (vm && vm->base) ? SCM_OBJ(vm->base) : SCM_FALSE;
+    for (lockprof_site *s = l->sites; s; s = s->next) {
+        if (SCM_EQ(s->site, site)) return s;
+    }
+    lockprof_site *s = SCM_NEW(lockprof_site);
+    memset(s, 0, sizeof(lockprof_site));
+    s->site = site;
+    s->next = l->sites;
+    l->sites = s;
+    return s;
+}
+
+/* Called when the locker finds LOCK held and is going to wait. */
+void Scm__LockProfilerWait(ScmObj lock)
+{
+    lockprof_lock *l;
+    (void)SCM_INTERNAL_MUTEX_LOCK(lockprof.mutex);
+    lockprof_site *s = lockprof_get(lock, &l);
+    l->waiting++;
+    if (l->waiting > s->maxWaiters) s->maxWaiters = l->waiting;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(lockprof.mutex);
+}
+
+/* Called after the locker obtained LOCK (ACQUIRED is TRUE) or gave up
+   waiting.  WAIT_START is the time it called Scm__LockProfilerWait, or 0
+   if it didn't wait. */
+void Scm__LockProfilerAcquired(ScmObj lock, ScmInt64 wait_start, int acquired)
+{
+    ScmInt64 now = Scm_MonotonicNanoseconds();
+    lockprof_lock *l;
+    (void)SCM_INTERNAL_MUTEX_LOCK(lockprof.mutex);
+    lockprof_site *s = lockprof_get(lock, &l);
+    if (wait_start > 0) {
+        if (l->waiting > 0) l->waiting--;
+        if (acquired) {
+            ScmInt64 w = now - wait_start;
+            s->contended++;
+            s->waitTime += w;
+            if (w > s->maxWait) s->maxWait = w;
+        }
+    }
+    if (acquired) {
+        s->acquired++;
+        l->lockedAt = now;
+        l->holder = s;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(lockprof.mutex);
+}
+
+/* Called by the holder just before it releases LOCK. */
+void Scm__LockProfilerReleased(ScmObj lock)
+{
+    ScmInt64 now = Scm_MonotonicNanoseconds();
+    (void)SCM_INTERNAL_MUTEX_LOCK(lockprof.mutex);
+    ScmDictEntry *e = Scm_HashCoreSearch(&lockprof.locks, (intptr_t)lock,
+                                         SCM_DICT_GET);
+    if (e) {
+        lockprof_lock *l = (lockprof_lock*)e->value;
+        if (l->lockedAt > 0 && l->holder) {
+            ScmInt64 h = now - l->lockedAt;
+            l->holder->holdTime += h;
+            if (h > l->holder->maxHold) l->holder->maxHold = h;
+        }
+        l->lockedAt = 0;
+        l->holder = NULL;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(lockprof.mutex);
+}
+
+void Scm_LockProfilerStart(void)
+{
+    Scm__LockProfiling = TRUE;
+}
+
+void Scm_LockProfilerStop(void)
+{
+    Scm__LockProfiling = FALSE;
+}
+
+void Scm_LockProfilerReset(void)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(lockprof.mutex);
+    Scm_HashCoreInitSimple(&lockprof.locks, SCM_HASH_ADDRESS, 0, NULL);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(lockprof.mutex);
+}
+
+/* Returns a list of
+     (<lock> <site> <acquired> <contended> <wait-ns> <max-wait-ns>
+      <hold-ns> <max-hold-ns> <max-waiters>)
+   NB: lib/gauche/vm/profiler.scm depends on this format. */
+ScmObj Scm_LockProfilerRawResult(void)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    ScmHashIter iter;
+    ScmDictEntry *e;
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(lockprof.mutex);
+    Scm_HashIterInit(&iter, &lockprof.locks);
+    while ((e = Scm_HashIterNext(&iter)) != NULL) {
+        lockprof_lock *l = (lockprof_lock*)e->value;
+        for (lockprof_site *s = l->sites; s; s = s->next) {
+            ScmObj r = Scm_List(l->lock, s->site,
+                                Scm_MakeIntegerU(s->acquired),
+                                Scm_MakeIntegerU(s->contended),
+                                Scm_MakeInteger64(s->waitTime),
+                                Scm_MakeInteger64(s->maxWait),
+                                Scm_MakeInteger64(s->holdTime),
+                                Scm_MakeInteger64(s->maxHold),
+                                SCM_MAKE_INT(s->maxWaiters),
+                                NULL);
+            SCM_APPEND1(h, t, r);
+        }
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(lockprof.mutex);
+    return h;
+}
+
+void Scm__InitProf(void)
+{
+    SCM_INTERNAL_MUTEX_INIT(lockprof.mutex);
+    Scm_HashCoreInitSimple(&lockprof.locks, SCM_HASH_ADDRESS, 0, NULL);
+}
@@ -410,6 +410,102 @@ static int char_is_delimiter(ScmChar ch)
             || SCM_CHAR_EXTRA_WHITESPACE(ch));
 }
 
+/*----------------------------------------------------------------
+ * Direct access to the port buffer
+ *
+ *   Most of the data we read are plain ASCII words and strings.  Instead
+ *   of fetching them char by char, we scan the port's buffer directly
+ *   when we can: the port is a buffered file port or an input string
+ *   port, and nothing is pushed back.  ports are locked during read,
+ *   so the buffer doesn't change under us.
+ */
+static const char *port_buffer(ScmPort *port, const char **end)
+{
+    if (port->scrcnt > 0 || port->ungotten != SCM_CHAR_INVALID) return NULL;
+    switch (SCM_PORT_TYPE(port)) {
+    case SCM_PORT_FILE:
+        *end = port->src.buf.end;
+        return port->src.buf.current;
+    case SCM_PORT_ISTR:
+        *end = port->src.istr.end;
+        return port->src.istr.current;
+    default:
+        return NULL;
+    }
+}
+
+/* Consumes N bytes in the buffer.  They must not contain newlines. */
+static void port_buffer_skip(ScmPort *port, int n)
+{
+    if (SCM_PORT_TYPE(port) == SCM_PORT_FILE) {
+        port->src.buf.current += n;
+    } else {
+        port->src.istr.current += n;
+    }
+    port->bytes += n;
+}
+
+/* If the rest of the word following in the buffer consists of ASCII
+   characters and is entirely in the buffer, sets *START to it and
+   returns its size in bytes, without consuming it.  Otherwise returns -1
+   and the caller should read the word in the normal way. */
+static int scan_word(ScmPort *port, int include_hash_sign, const char **start)
+{
+    const char *end, *p = port_buffer(port, &end);
+    if (p == NULL) return -1;
+    const char *q = p;
+    for (; q < end; q++) {
+        unsigned char b = (unsigned char)*q;
+        if (b >= 0x80) return -1;
+        if (!(ctypes[b]&1) && !(b == '#' && include_hash_sign)) break;
+    }
+    /* The word may continue beyond the buffer of a file port. */
+    if (q == end && SCM_PORT_TYPE(port) != SCM_PORT_ISTR) return -1;
+    *start = p;
+    return (int)(q - p);
+}
+
+/* Makes a string from INITIAL (if valid) and N bytes from P. */
+static ScmObj make_word(ScmChar initial, const char *p, int n)
+{
+    int size = n + ((initial != SCM_CHAR_INVALID)? 1 : 0);
+    char *buf = SCM_NEW_ATOMIC2(char*, size+1);
+    char *d = buf;
+    if (initial != SCM_CHAR_INVALID) *d++ = (char)initial;
+    memcpy(d, p, n);
+    buf[size] = '\0';
+    return Scm_MakeString(buf, size, size, 0);
+}
+
+/* A small cache of the symbols the reader interned recently.  Data files
+   tend to repeat the same symbols, and a hit saves allocating the name
+   and looking up the global symbol table, which needs the lock.
+   Entries are overwritten without a lock; since each entry is a single
+   word and we compare the name on hit, a race only causes a miss. */
+#define SYMBOL_CACHE_SIZE 1024  /* must be a power of 2 */
+static ScmObj symbol_cache[SYMBOL_CACHE_SIZE];
+
+static ScmObj intern_word(ScmChar initial, const char *p, int n)
+{
+    u_long h = 2166136261UL;    /* FNV-1a */
+    h = (h ^ (unsigned char)initial) * 16777619UL;
+    for (int i=0; i<n; i++) h = (h ^ (unsigned char)p[i]) * 16777619UL;
+    h = (h ^ (h >> 16)) & (SYMBOL_CACHE_SIZE-1);
+
+    ScmObj sym = symbol_cache[h];
+    if (sym != NULL) {
+        const ScmStringBody *b = SCM_STRING_BODY(SCM_SYMBOL_NAME(sym));
+        const char *name = SCM_STRING_BODY_START(b);
+        if (SCM_STRING_BODY_SIZE(b) == n+1 && name[0] == (char)initial
+            && memcmp(name+1, p, n) == 0) {
+            return sym;
+        }
+    }
+    sym = Scm_Intern(SCM_STRING(make_word(initial, p, n)));
+    symbol_cache[h] = sym;
+    return sym;
+}
+
 static void read_nested_comment(ScmPort *port, ScmReadContext *ctx)
 {
     int nesting = 0;
@@ -1053,6 +1149,21 @@ static ScmObj read_string(ScmPort *port, int incompletep,
     ((var)==' ' || (var)=='\t' || SCM_CHAR_EXTRA_WHITESPACE_INTRALINE(var))
 
     for (;;) {
+        if (!incompletep) {
+            /* Take a run of printable ASCII chars at once. */
+            const char *e, *p = port_buffer(port, &e);
+            if (p != NULL) {
+                const char *q = p;
+                while (q < e && *q >= 0x20 && *q < 0x7f
+                       && *q != '"' && *q != '\\') {
+                    q++;
+                }
+                if (q > p) {
+                    Scm_DStringPutz(&ds, p, (int)(q - p));
+                    port_buffer_skip(port, (int)(q - p));
+                }
+            }
+        }
         FETCH(c);
         switch (c) {
         case EOF: goto eof_exit;
@@ -1265,6 +1376,16 @@ static ScmObj read_word(ScmPort *port, ScmChar initial, ScmReadContext *ctx,
                         int temp_case_fold, int include_hash_sign)
 {
     int case_fold = temp_case_fold || SCM_PORT_CASE_FOLDING(port);
+    if (!case_fold && initial < 0x80) {
+        const char *w;
+        int n = scan_word(port, include_hash_sign, &w);
+        if (n >= 0) {
+            ScmObj s = make_word(initial, w, n);
+            port_buffer_skip(port, n);
+            return s;
+        }
+    }
+
     ScmDString ds;
     Scm_DStringInit(&ds);
     if (initial != SCM_CHAR_INVALID) {
@@ -1299,6 +1420,16 @@ static void check_valid_symbol(ScmString *s)
 /* Read a symbol starting with INITIAL (assuming unescaped), interned. */
 static ScmObj read_symbol(ScmPort *port, ScmChar initial, ScmReadContext *ctx)
 {
+    if (!SCM_PORT_CASE_FOLDING(port) && initial >= 0 && initial < 0x80) {
+        const char *w;
+        int n = scan_word(port, TRUE, &w);
+        /* If the word contains '#', let the normal path report it. */
+        if (n >= 0 && memchr(w, '#', n) == NULL) {
+            ScmObj sym = intern_word(initial, w, n);
+            port_buffer_skip(port, n);
+            return sym;
+        }
+    }
     ScmString *s = SCM_STRING(read_word(port, initial, ctx, FALSE, TRUE));
     check_valid_symbol(s);
     return Scm_Intern(s);
@@ -1353,6 +1484,20 @@ static ScmObj read_number(ScmPort *port, ScmChar initial, int radix,
 
 static ScmObj read_symbol_or_number(ScmPort *port, ScmChar initial, ScmReadContext *ctx)
 {
+    if (!SCM_PORT_CASE_FOLDING(port)) {
+        const char *w;
+        char buf[64];
+        int n = scan_word(port, TRUE, &w);
+        if (n >= 0 && n < (int)sizeof(buf) - 1 && initial < 0x80) {
+            buf[0] = (char)initial;
+            memcpy(buf+1, w, n);
+            ScmObj num = Scm__ParseDecimalNumber(buf, n+1);
+            if (!SCM_UNBOUNDP(num)) {
+                port_buffer_skip(port, n);
+                return num;
+            }
+        }
+    }
     ScmString *s = SCM_STRING(read_word(port, initial, ctx, FALSE, TRUE));
     ScmObj num = Scm_StringToNumber(s, 10, 0);
     if (num != SCM_FALSE) return num;
@@ -33,8 +33,10 @@
  */
 
 #include <setjmp.h>
+#include <limits.h>
 #include <ctype.h>
 #define LIBGAUCHE_BODY
+#include "atomic_ops.h"
 #include "gauche.h"
 #include "gauche/regexp.h"
 #include "gauche/class.h"
@@ -170,6 +172,19 @@ enum {
 #define SCM_REGEXP_SIMPLE_PREFIX  (1L<<3) /* The regexp begins with a repeating
                                              character or charset, e.g. #/a+b/.
                                              See is_simple_prefixed() below. */
+#define SCM_REGEXP_MUST_PREFIX    (1L<<4) /* Every match begins with mustMatch
+                                             string.  See
+                                             calculate_must_match() below. */
+#define SCM_REGEXP_USES_CAPTURE   (1L<<5) /* The match depends on what the
+                                             groups captured, e.g. by a
+                                             backreference.  See rex_rec(). */
+
+/* In utf-8 and the single-byte encoding, a byte sequence of a string
+   found in the input always begins at a character boundary.  In euc-jp
+   and sjis it may begin in the middle of a multibyte character. */
+#if !defined(GAUCHE_CHAR_ENCODING_EUC_JP) && !defined(GAUCHE_CHAR_ENCODING_SJIS)
+#define REGEXP_BYTEWISE_SEARCH 1
+#endif
 
 /* AST - the first pass of regexp compiler creates intermediate AST.
  * Alternatively, you can provide AST directly to the regexp compiler,
@@ -222,6 +237,9 @@ enum {
 /* NB: regexp printer is defined in libobj.scm */
 static int  regexp_compare(ScmObj x, ScmObj y, int equalp);
 
+typedef struct ScmRegDFARec ScmRegDFA;
+static ScmRegDFA *dfa_new(ScmObj ast, int casefoldp);
+
 SCM_DEFINE_BUILTIN_CLASS(Scm_RegexpClass,
                          NULL, regexp_compare, NULL, NULL,
                          SCM_CLASS_DEFAULT_CPL);
@@ -238,9 +256,11 @@ static ScmRegexp *make_regexp(void)
     rx->sets = NULL;
     rx->grpNames = SCM_NIL;
     rx->mustMatch = NULL;
+    rx->mustSkip = NULL;
     rx->flags = 0;
     rx->pattern = SCM_FALSE;
     rx->ast = SCM_FALSE;
+    rx->dfa = NULL;
     return rx;
 }
 
@@ -1673,6 +1693,7 @@ static void rc3_rec(regcomp_ctx *ctx, ScmObj ast, int lastp)
         SCM_ASSERT(SCM_INTP(SCM_CDR(ast)));
         EMIT4(!ctx->casefoldp, RE_BACKREF, RE_BACKREF_RL, RE_BACKREF_CI, RE_BACKREF_CI_RL);
         rc3_emit(ctx, (char)SCM_INT_VALUE(SCM_CDR(ast)));
+        ctx->rx->flags |= SCM_REGEXP_USES_CAPTURE;
         return;
     }
     if (SCM_EQ(type, SCM_SYM_CPAT)) {
@@ -1698,6 +1719,7 @@ static void rc3_rec(regcomp_ctx *ctx, ScmObj ast, int lastp)
         if (SCM_INTP(cond)) {
             rc3_emit(ctx, RE_CPAT);
             rc3_emit(ctx, (char)SCM_INT_VALUE(cond));
+            ctx->rx->flags |= SCM_REGEXP_USES_CAPTURE;
             int ocodep1 = ctx->codep;
             rc3_emit_offset(ctx, 0); /* will be patched */
             rc3_seq(ctx, ypat, lastp);
@@ -1873,6 +1895,170 @@ static ScmObj calculate_lasetn(ScmObj ast)
     else return calculate_laset(SCM_CAR(ast), SCM_CDR(ast));
 }
 
+/* Required literal.  We look for a literal string that every match
+   must contain.  If the input doesn't have it, we don't need to run
+   the matcher at all; and if the literal always begins the match, we
+   can jump directly to its occurrences.
+
+   For each node we compute:
+     run    - if exactp, the node always matches exactly this string.
+     prefix - a string every match of the node begins with.
+     best   - the longest string every match of the node contains.
+   Zero-width assertions are transparent.  A literal is truncated at
+   MUST_MAX bytes, which loses nothing but the tail. */
+
+#define MUST_MAX 64
+
+typedef struct must_lit_rec {
+    int len;
+    char buf[MUST_MAX];
+} must_lit;
+
+typedef struct must_info_rec {
+    int exactp;
+    must_lit run;
+    must_lit prefix;
+    must_lit best;
+} must_info;
+
+/* Appends all of SRC to DST, or nothing and returns FALSE. */
+static int must_append(must_lit *dst, const must_lit *src)
+{
+    if (dst->len + src->len > MUST_MAX) return FALSE;
+    memcpy(dst->buf + dst->len, src->buf, src->len);
+    dst->len += src->len;
+    return TRUE;
+}
+
+static void must_keep_longer(must_lit *best, const must_lit *cand)
+{
+    if (cand->len > best->len) *best = *cand;
+}
+
+static void must_clear(must_info *r, int exactp)
+{
+    r->exactp = exactp;
+    r->run.len = r->prefix.len = r->best.len = 0;
+}
+
+static void must_node(ScmObj ast, int casefoldp, must_info *r);
+
+static void must_seq(ScmObj seq, int casefoldp, must_info *r)
+{
+    must_lit cur;               /* current run of literals */
+    int leading = TRUE;         /* cur is at the beginning of seq */
+    ScmObj cp;
+
+    must_clear(r, TRUE);
+    cur.len = 0;
+    SCM_FOR_EACH(cp, seq) {
+        must_info e;
+        must_node(SCM_CAR(cp), casefoldp, &e);
+        if (e.exactp && must_append(&cur, &e.run)) continue;
+
+        /* The run ends here.  If E isn't exact, its prefix still
+           continues the run. */
+        if (!e.exactp) (void)must_append(&cur, &e.prefix);
+        must_keep_longer(&r->best, &cur);
+        if (leading) r->prefix = cur;
+        leading = FALSE;
+        r->exactp = FALSE;
+        if (e.exactp) {
+            cur = e.run;        /* overflow; start a new run */
+        } else {
+            must_keep_longer(&r->best, &e.best);
+            cur.len = 0;
+        }
+    }
+    must_keep_longer(&r->best, &cur);
+    if (r->exactp) r->run = r->prefix = cur;
+}
+
+static void must_node(ScmObj ast, int casefoldp, must_info *r)
+{
+    if (SCM_CHARP(ast)) {
+        ScmChar ch = SCM_CHAR_VALUE(ast);
+        /* Under case folding, only ASCII non-letters are literal. */
+        if (casefoldp && (ch >= 0x80 || isalpha((int)ch))) {
+            must_clear(r, FALSE);
+            return;
+        }
+        must_clear(r, TRUE);
+        r->run.len = SCM_CHAR_NBYTES(ch);
+        SCM_CHAR_PUT(r->run.buf, ch);
+        r->prefix = r->best = r->run;
+        return;
+    }
+    if (SCM_EQ(ast, SCM_SYM_BOL) || SCM_EQ(ast, SCM_SYM_WB)
+        || SCM_EQ(ast, SCM_SYM_NWB)) {
+        must_clear(r, TRUE);
+        return;
+    }
+    if (!SCM_PAIRP(ast)) {
+        must_clear(r, FALSE);   /* charset, any, eol */
+        return;
+    }
+
+    ScmObj type = SCM_CAR(ast);
+    if (SCM_INTP(type)) {
+        must_seq(SCM_CDDR(ast), casefoldp, r);
+    } else if (SCM_EQ(type, SCM_SYM_SEQ) || SCM_EQ(type, SCM_SYM_ONCE)) {
+        must_seq(SCM_CDR(ast), casefoldp, r);
+    } else if (SCM_EQ(type, SCM_SYM_SEQ_UNCASE)
+               || SCM_EQ(type, SCM_SYM_SEQ_CASE)) {
+        must_seq(SCM_CDR(ast), SCM_EQ(type, SCM_SYM_SEQ_UNCASE), r);
+    } else if (SCM_EQ(type, SCM_SYM_ASSERT)
+               || SCM_EQ(type, SCM_SYM_NASSERT)) {
+        must_clear(r, TRUE);
+    } else if (SCM_EQ(type, SCM_SYM_ALT)) {
+        ScmObj alts = SCM_CDR(ast);
+        if (SCM_PAIRP(alts) && SCM_NULLP(SCM_CDR(alts))) {
+            must_node(SCM_CAR(alts), casefoldp, r);
+        } else {
+            must_clear(r, FALSE);
+        }
+    } else if (SCM_EQ(type, SCM_SYM_REP) || SCM_EQ(type, SCM_SYM_REP_MIN)
+               || SCM_EQ(type, SCM_SYM_REP_WHILE)) {
+        if (SCM_EQ(SCM_CADR(ast), SCM_MAKE_INT(0))) {
+            must_clear(r, FALSE);
+        } else {
+            must_seq(SCM_CDR(SCM_CDDR(ast)), casefoldp, r);
+            r->exactp = FALSE;
+        }
+    } else {
+        must_clear(r, FALSE);   /* comp, backref, cpat */
+    }
+}
+
+static void calculate_must_match(regcomp_ctx *ctx, ScmObj ast)
+{
+    must_info info;
+    must_node(ast, ctx->casefoldp, &info);
+
+    /* The prefix is as selective as any other literal, and lets us jump
+       to the candidates.  We can only do so if a byte match always falls
+       on a character boundary, though. */
+    const must_lit *lit = &info.best;
+#if defined(REGEXP_BYTEWISE_SEARCH)
+    if (info.prefix.len > 0 && info.prefix.len == info.best.len) {
+        lit = &info.prefix;
+        ctx->rx->flags |= SCM_REGEXP_MUST_PREFIX;
+    }
+#endif /*REGEXP_BYTEWISE_SEARCH*/
+    if (lit->len == 0) return;
+
+    ctx->rx->mustMatch =
+        SCM_STRING(Scm_MakeString(lit->buf, lit->len, -1, SCM_STRING_COPYING));
+
+    /* Horspool's shift table. */
+    unsigned char *skip = SCM_NEW_ATOMIC2(unsigned char *, 256);
+    memset(skip, lit->len, 256);
+    for (int i = 0; i < lit->len - 1; i++) {
+        skip[(unsigned char)lit->buf[i]] = (unsigned char)(lit->len - 1 - i);
+    }
+    ctx->rx->mustSkip = skip;
+}
+
 /* pass 3 */
 static ScmObj rc3(regcomp_ctx *ctx, ScmObj ast)
 {
@@ -1880,6 +2066,8 @@ static ScmObj rc3(regcomp_ctx *ctx, ScmObj ast)
     if (is_bol_anchored(ast)) ctx->rx->flags |= SCM_REGEXP_BOL_ANCHORED;
     else if (is_simple_prefixed(ast)) ctx->rx->flags |= SCM_REGEXP_SIMPLE_PREFIX;
     ctx->rx->laset = calculate_laset(ast, SCM_NIL);
+    ctx->rx->dfa = dfa_new(ast, ctx->casefoldp);
+    calculate_must_match(ctx, ast);
 
     /* pass 3-1 : count # of insns */
     ctx->codemax = 1;
@@ -1906,6 +2094,10 @@ void Scm_RegDump(ScmRegexp *rx)
         Scm_Printf(SCM_CUROUT, ",BOL_ANCHORED");
     if (rx->flags&SCM_REGEXP_SIMPLE_PREFIX)
         Scm_Printf(SCM_CUROUT, ",SIMPLE_PREFIX");
+    if (rx->flags&SCM_REGEXP_MUST_PREFIX)
+        Scm_Printf(SCM_CUROUT, ",MUST_PREFIX");
+    if (rx->dfa)
+        Scm_Printf(SCM_CUROUT, ",DFA");
     Scm_Printf(SCM_CUROUT, ")\n");
     Scm_Printf(SCM_CUROUT, " laset = %S\n", rx->laset);
     Scm_Printf(SCM_CUROUT, "  must = ");
@@ -2278,6 +2470,603 @@ ScmObj Scm_RegCompFromAST(ScmObj ast)
     return rc3(&cctx, ast);
 }
 
+/*=======================================================================
+ * Compiled regexp cache
+ */
+
+/* Programs that build patterns at runtime tend to compile the same
+ * string over and over, e.g. (rxmatch pattern-string input) in a loop.
+ * Since a regexp is immutable, we can share the compiled one.
+ * Scm_RegCompCached keeps the RX_CACHE_SIZE most recently used regexps,
+ * keyed by the pattern and the case-fold flag.  Each hash table maps
+ * a pattern to its entry, and the entries are chained in the order
+ * of use so that we can drop the least recently used one.
+ */
+
+typedef struct rx_cache_entry_rec {
+    ScmObj pattern;             /* immutable string; the key */
+    ScmRegexp *rx;
+    int casefoldp;
+    struct rx_cache_entry_rec *prev; /* more recently used */
+    struct rx_cache_entry_rec *next; /* less recently used */
+} rx_cache_entry;
+
+#define RX_CACHE_SIZE  256
+
+static struct {
+    ScmInternalMutex mutex;
+    ScmHashCore table[2];       /* [0]: case sensitive, [1]: case folding */
+    rx_cache_entry *head;       /* most recently used */
+    rx_cache_entry *tail;       /* least recently used */
+    int numEntries;
+    u_long hits;
+    u_long misses;
+    u_long evictions;
+} rx_cache;
+
+static void rx_cache_unlink(rx_cache_entry *e)
+{
+    if (e->prev) e->prev->next = e->next;
+    else rx_cache.head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else rx_cache.tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static void rx_cache_push(rx_cache_entry *e)
+{
+    e->prev = NULL;
+    e->next = rx_cache.head;
+    if (rx_cache.head) rx_cache.head->prev = e;
+    else rx_cache.tail = e;
+    rx_cache.head = e;
+}
+
+ScmObj Scm_RegCompCached(ScmString *pattern, int flags)
+{
+    if (flags & ~SCM_REGEXP_CASE_FOLD) return Scm_RegComp(pattern, flags);
+    int fold = (flags & SCM_REGEXP_CASE_FOLD)? 1 : 0;
+    ScmRegexp *rx = NULL;
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(rx_cache.mutex);
+    ScmDictEntry *e = Scm_HashCoreSearch(&rx_cache.table[fold],
+                                         (intptr_t)pattern, SCM_DICT_GET);
+    if (e) {
+        rx_cache_entry *ce = (rx_cache_entry*)e->value;
+        rx_cache_unlink(ce);
+        rx_cache_push(ce);
+        rx = ce->rx;
+        rx_cache.hits++;
+    } else {
+        rx_cache.misses++;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(rx_cache.mutex);
+    if (rx) return SCM_OBJ(rx);
+
+    /* Compile outside of the lock, for it may raise an error. */
+    rx = SCM_REGEXP(Scm_RegComp(pattern, flags));
+    ScmObj key = Scm_CopyStringWithFlags(pattern, SCM_STRING_IMMUTABLE,
+                                         SCM_STRING_IMMUTABLE);
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(rx_cache.mutex);
+    e = Scm_HashCoreSearch(&rx_cache.table[fold], (intptr_t)key,
+                           SCM_DICT_CREATE);
+    if (e->value == 0) {
+        /* Another thread may have registered the same pattern
+           meanwhile; then we just keep that one. */
+        rx_cache_entry *ce = SCM_NEW(rx_cache_entry);
+        ce->pattern = key;
+        ce->rx = rx;
+        ce->casefoldp = fold;
+        rx_cache_push(ce);
+        e->value = (intptr_t)ce;
+        if (++rx_cache.numEntries > RX_CACHE_SIZE) {
+            rx_cache_entry *old = rx_cache.tail;
+            rx_cache_unlink(old);
+            Scm_HashCoreSearch(&rx_cache.table[old->casefoldp],
+                               (intptr_t)old->pattern, SCM_DICT_DELETE);
+            rx_cache.numEntries--;
+            rx_cache.evictions++;
+        }
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(rx_cache.mutex);
+    return SCM_OBJ(rx);
+}
+
+/* Returns ((:hits n) (:misses n) (:evictions n) (:size n) (:max-size n)) */
+ScmObj Scm_RegCompCacheStats(void)
+{
+    u_long hits, misses, evictions;
+    int size;
+    (void)SCM_INTERNAL_MUTEX_LOCK(rx_cache.mutex);
+    hits = rx_cache.hits;
+    misses = rx_cache.misses;
+    evictions = rx_cache.evictions;
+    size = rx_cache.numEntries;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(rx_cache.mutex);
+    return SCM_LIST5(SCM_LIST2(SCM_MAKE_KEYWORD("hits"),
+                               Scm_MakeIntegerU(hits)),
+                     SCM_LIST2(SCM_MAKE_KEYWORD("misses"),
+                               Scm_MakeIntegerU(misses)),
+                     SCM_LIST2(SCM_MAKE_KEYWORD("evictions"),
+                               Scm_MakeIntegerU(evictions)),
+                     SCM_LIST2(SCM_MAKE_KEYWORD("size"), SCM_MAKE_INT(size)),
+                     SCM_LIST2(SCM_MAKE_KEYWORD("max-size"),
+                               SCM_MAKE_INT(RX_CACHE_SIZE)));
+}
+
+/*=======================================================================
+ * Lazy DFA
+ */
+
+/* The backtracking matcher may take exponential time on patterns like
+ * #/(a|aa)*c/, and even in usual cases it tries every start position.
+ * If the pattern is regular, i.e. it doesn't have backreferences,
+ * lookahead/lookbehind assertions, conditional patterns, standalone
+ * patterns or word-boundary assertions, we also build an NFA of the
+ * *reversed* pattern, and run it as a DFA constructed on demand.
+ *
+ * The DFA scans the input from the end to the beginning, with the
+ * pattern unanchored at the end.  After consuming input[p..end), the
+ * state is accepting iff some match starts at p.  So the leftmost p
+ * where the state accepts is the leftmost position a match can start.
+ * If there's none, we can return #f without running the backtracker.
+ * Otherwise we run the backtracker from that position, which finds
+ * exactly the same match as it would from the beginning, and computes
+ * submatches.
+ *
+ * The NFA only needs to accept a superset of what the backtracker
+ * matches; where the bytecode behaves slightly differently (e.g. `$'
+ * in the middle of the pattern matches a literal `$'), we accept both.
+ *
+ * DFA states are interned sets of NFA nodes.  Transitions on ASCII
+ * characters are cached in the state; others are computed each time.
+ * The DFA is shared among threads, so we create states with a lock.
+ * A transition is published after the target state is filled, so
+ * readers can follow cached transitions without locking.  If the DFA
+ * grows beyond DFA_MAX_STATES, we give it up and use the backtracker
+ * only.
+ *
+ * Scanning backward requires that we can find the previous character
+ * boundary exactly.  That holds for utf-8 and the single-byte encoding,
+ * but not for euc-jp and sjis, so we don't use DFA with them.
+ */
+
+#if !defined(GAUCHE_CHAR_ENCODING_EUC_JP) && !defined(GAUCHE_CHAR_ENCODING_SJIS)
+#define REGEXP_USE_DFA 1
+#endif
+
+#define NFA_MAX_NODES   4096
+#define DFA_MAX_STATES  256
+
+enum {
+    NFA_CHAR,                   /* match ch */
+    NFA_CHAR_CI,                /* match ch, case insensitive */
+    NFA_SET,                    /* match a char in cs */
+    NFA_NSET,                   /* match a char not in cs */
+    NFA_ANY,                    /* match any char */
+    NFA_SPLIT,                  /* epsilon to out and out1 */
+    NFA_BOL,                    /* beginning of input */
+    NFA_EOL,                    /* end of input */
+    NFA_FAIL,                   /* never matches */
+    NFA_MATCH
+};
+
+typedef struct nfa_node_rec {
+    int type;
+    int out;
+    int out1;                   /* only for NFA_SPLIT */
+    ScmChar ch;
+    ScmCharSet *cs;
+} nfa_node;
+
+typedef struct dfa_state_rec {
+    struct dfa_state_rec *next[128]; /* transitions by ASCII chars */
+    struct dfa_state_rec *chain;     /* hash chain */
+    u_long hashval;
+    int accept;                 /* TRUE if this has NFA_MATCH */
+    int acceptAtBegin;          /* -1: not computed yet */
+    int numNodes;
+    int nodes[1];               /* sorted NFA node indices; variable length */
+} dfa_state;
+
+#define DFA_NUM_BUCKETS 64
+
+struct ScmRegDFARec {
+    nfa_node *nodes;
+    int numNodes;
+    int start;                  /* entry node */
+    dfa_state *initial;         /* state at the end of input */
+    dfa_state *buckets[DFA_NUM_BUCKETS];
+    int numStates;
+    int gaveup;                 /* TRUE if the DFA grew too big */
+    ScmInternalMutex mutex;     /* for creating states */
+    int *mark;                  /* [numNodes] work area, used with mutex */
+    int *stack;                 /* [numNodes] ditto */
+    int *set;                   /* [numNodes] ditto */
+    int generation;
+};
+
+/*
+ * NFA construction.  We build the reversed pattern directly; nfa_build
+ * returns the entry node to match AST and then continue to NEXT.
+ */
+typedef struct nfa_builder_rec {
+    nfa_node *nodes;
+    int numNodes;
+    int maxNodes;
+    int casefoldp;
+    int failed;                 /* TRUE if AST is not eligible */
+} nfa_builder;
+
+static int nfa_new(nfa_builder *b, int type, int out)
+{
+    if (b->numNodes >= NFA_MAX_NODES) {
+        b->failed = TRUE;
+        return out;
+    }
+    if (b->numNodes >= b->maxNodes) {
+        int newmax = b->maxNodes * 2;
+        nfa_node *newnodes = SCM_NEW_ARRAY(nfa_node, newmax);
+        memcpy(newnodes, b->nodes, sizeof(nfa_node)*b->numNodes);
+        b->nodes = newnodes;
+        b->maxNodes = newmax;
+    }
+    int i = b->numNodes++;
+    b->nodes[i].type = type;
+    b->nodes[i].out = out;
+    b->nodes[i].out1 = -1;
+    b->nodes[i].ch = 0;
+    b->nodes[i].cs = NULL;
+    return i;
+}
+
+static int nfa_split(nfa_builder *b, int out, int out1)
+{
+    int n = nfa_new(b, NFA_SPLIT, out);
+    if (!b->failed) b->nodes[n].out1 = out1;
+    return n;
+}
+
+static int nfa_build(nfa_builder *b, ScmObj ast, int next);
+
+/* Elements are read right to left, so the first element comes last. */
+static int nfa_build_seq(nfa_builder *b, ScmObj seq, int next)
+{
+    ScmObj cp;
+    SCM_FOR_EACH(cp, seq) {
+        if (b->failed) break;
+        next = nfa_build(b, SCM_CAR(cp), next);
+    }
+    return next;
+}
+
+static int nfa_build(nfa_builder *b, ScmObj ast, int next)
+{
+    if (b->failed) return next;
+    if (SCM_CHARP(ast)) {
+        int n = nfa_new(b, b->casefoldp? NFA_CHAR_CI : NFA_CHAR, next);
+        if (!b->failed) b->nodes[n].ch = SCM_CHAR_VALUE(ast);
+        return n;
+    }
+    if (SCM_CHAR_SET_P(ast)) {
+        int n = nfa_new(b, NFA_SET, next);
+        if (!b->failed) b->nodes[n].cs = SCM_CHAR_SET(ast);
+        return n;
+    }
+    if (SCM_EQ(ast, SCM_SYM_ANY)) return nfa_new(b, NFA_ANY, next);
+    if (SCM_EQ(ast, SCM_SYM_BOL)) return nfa_new(b, NFA_BOL, next);
+    if (SCM_EQ(ast, SCM_SYM_EOL)) {
+        /* EOL not at the end of the pattern matches literal '$' */
+        int lit = nfa_new(b, NFA_CHAR, next);
+        if (!b->failed) b->nodes[lit].ch = '$';
+        return nfa_split(b, nfa_new(b, NFA_EOL, next), lit);
+    }
+    if (!SCM_PAIRP(ast)) {
+        b->failed = TRUE;       /* wb, nwb, or unknown */
+        return next;
+    }
+
+    ScmObj type = SCM_CAR(ast);
+    if (SCM_EQ(type, SCM_SYM_COMP)) {
+        int n = nfa_new(b, NFA_NSET, next);
+        if (!b->failed) b->nodes[n].cs = SCM_CHAR_SET(SCM_CDR(ast));
+        return n;
+    }
+    if (SCM_INTP(type)) {
+        return nfa_build_seq(b, SCM_CDDR(ast), next);
+    }
+    if (SCM_EQ(type, SCM_SYM_SEQ)) {
+        return nfa_build_seq(b, SCM_CDR(ast), next);
+    }
+    if (SCM_EQ(type, SCM_SYM_SEQ_UNCASE) || SCM_EQ(type, SCM_SYM_SEQ_CASE)) {
+        int oldcase = b->casefoldp;
+        b->casefoldp = SCM_EQ(type, SCM_SYM_SEQ_UNCASE);
+        int n = nfa_build_seq(b, SCM_CDR(ast), next);
+        b->casefoldp = oldcase;
+        return n;
+    }
+    if (SCM_EQ(type, SCM_SYM_ALT)) {
+        ScmObj cp;
+        int n = -1;
+        SCM_FOR_EACH(cp, SCM_CDR(ast)) {
+            int alt = nfa_build(b, SCM_CAR(cp), next);
+            n = (n < 0)? alt : nfa_split(b, alt, n);
+        }
+        if (n < 0) n = nfa_new(b, NFA_FAIL, next); /* (alt) matches nothing */
+        return n;
+    }
+    if (SCM_EQ(type, SCM_SYM_REP) || SCM_EQ(type, SCM_SYM_REP_MIN)
+        || SCM_EQ(type, SCM_SYM_REP_WHILE)) {
+        ScmObj m = SCM_CADR(ast);
+        ScmObj n = SCM_CAR(SCM_CDDR(ast));
+        ScmObj body = SCM_CDR(SCM_CDDR(ast));
+        int cont = next;
+        if (SCM_FALSEP(n)) {
+            /* loop: split -> body -> split, or -> next */
+            int s = nfa_split(b, -1, next);
+            if (b->failed) return next;
+            b->nodes[s].out = nfa_build_seq(b, body, s);
+            cont = s;
+        } else {
+            for (int i = SCM_INT_VALUE(m); i < SCM_INT_VALUE(n); i++) {
+                cont = nfa_split(b, nfa_build_seq(b, body, cont), next);
+                if (b->failed) return next;
+            }
+        }
+        for (int i = 0; i < SCM_INT_VALUE(m); i++) {
+            cont = nfa_build_seq(b, body, cont);
+            if (b->failed) return next;
+        }
+        return cont;
+    }
+    /* backref, cpat, once, assert, nassert, lookbehind */
+    b->failed = TRUE;
+    return next;
+}
+
+static ScmRegDFA *dfa_new(ScmObj ast, int casefoldp)
+{
+#if defined(REGEXP_USE_DFA)
+    nfa_builder b;
+    b.maxNodes = 64;
+    b.nodes = SCM_NEW_ARRAY(nfa_node, b.maxNodes);
+    b.numNodes = 0;
+    b.casefoldp = casefoldp;
+    b.failed = FALSE;
+
+    int match = nfa_new(&b, NFA_MATCH, -1);
+    int start = nfa_build(&b, ast, match);
+    if (b.failed) return NULL;
+
+    ScmRegDFA *dfa = SCM_NEW(ScmRegDFA);
+    dfa->nodes = b.nodes;
+    dfa->numNodes = b.numNodes;
+    dfa->start = start;
+    dfa->initial = NULL;
+    for (int i=0; i<DFA_NUM_BUCKETS; i++) dfa->buckets[i] = NULL;
+    dfa->numStates = 0;
+    dfa->gaveup = FALSE;
+    (void)SCM_INTERNAL_MUTEX_INIT(dfa->mutex);
+    dfa->mark = SCM_NEW_ATOMIC_ARRAY(int, b.numNodes);
+    dfa->stack = SCM_NEW_ATOMIC_ARRAY(int, b.numNodes);
+    dfa->set = SCM_NEW_ATOMIC_ARRAY(int, b.numNodes);
+    for (int i=0; i<b.numNodes; i++) dfa->mark[i] = 0;
+    dfa->generation = 0;
+    return dfa;
+#else  /*!REGEXP_USE_DFA*/
+    return NULL;
+#endif /*!REGEXP_USE_DFA*/
+}
+
+#if defined(REGEXP_USE_DFA)
+
+/*
+ * State construction.  Called with dfa->mutex held.
+ */
+
+/* Adds the epsilon closure of node N to dfa->set.  We keep the nodes
+   that consume a char, NFA_BOL and NFA_MATCH in the set.  EOL is
+   passable only at the end of input, and BOL only at the beginning. */
+#define CLOSURE_PUSH(n)                                 \
+    do {                                                \
+        int n_ = (n);                                   \
+        if (dfa->mark[n_] != dfa->generation) {         \
+            dfa->mark[n_] = dfa->generation;            \
+            dfa->stack[sp++] = n_;                      \
+        }                                               \
+    } while (0)
+
+static int dfa_closure(ScmRegDFA *dfa, int n, int count, int atEnd, int atBegin)
+{
+    int sp = 0;
+    CLOSURE_PUSH(n);
+    while (sp > 0) {
+        n = dfa->stack[--sp];
+        nfa_node *node = &dfa->nodes[n];
+        switch (node->type) {
+        case NFA_SPLIT:
+            CLOSURE_PUSH(node->out1);
+            CLOSURE_PUSH(node->out);
+            break;
+        case NFA_EOL:
+            if (atEnd) CLOSURE_PUSH(node->out);
+            break;
+        case NFA_BOL:
+            if (atBegin) CLOSURE_PUSH(node->out);
+            else dfa->set[count++] = n;
+            break;
+        case NFA_FAIL:
+            break;
+        default:
+            dfa->set[count++] = n;
+        }
+    }
+    return count;
+}
+
+#undef CLOSURE_PUSH
+
+static int int_compare(const void *x, const void *y)
+{
+    return *(const int*)x - *(const int*)y;
+}
+
+/* Finds or creates the state for the first COUNT nodes in dfa->set.
+   Returns NULL if we exceed the limit. */
+static dfa_state *dfa_intern(ScmRegDFA *dfa, int count)
+{
+    qsort(dfa->set, count, sizeof(int), int_compare);
+    u_long hashval = (u_long)count;
+    for (int i=0; i<count; i++) hashval = hashval*31 + (u_long)dfa->set[i];
+
+    dfa_state **bucket = &dfa->buckets[hashval % DFA_NUM_BUCKETS];
+    for (dfa_state *s = *bucket; s; s = s->chain) {
+        if (s->hashval == hashval && s->numNodes == count
+            && memcmp(s->nodes, dfa->set, sizeof(int)*count) == 0) {
+            return s;
+        }
+    }
+    if (dfa->numStates >= DFA_MAX_STATES) {
+        dfa->gaveup = TRUE;
+        return NULL;
+    }
+
+    dfa_state *s = SCM_NEW2(dfa_state*,
+                            sizeof(dfa_state) + sizeof(int)*(count-1));
+    for (int i=0; i<128; i++) s->next[i] = NULL;
+    s->hashval = hashval;
+    s->accept = FALSE;
+    s->acceptAtBegin = -1;
+    s->numNodes = count;
+    for (int i=0; i<count; i++) {
+        s->nodes[i] = dfa->set[i];
+        if (dfa->nodes[dfa->set[i]].type == NFA_MATCH) s->accept = TRUE;
+    }
+    s->chain = *bucket;
+    *bucket = s;
+    dfa->numStates++;
+    return s;
+}
+
+static int nfa_node_match(nfa_node *node, ScmChar ch)
+{
+    switch (node->type) {
+    case NFA_CHAR:    return ch == node->ch;
+    case NFA_CHAR_CI: return Scm_CharDowncase(ch) == node->ch;
+    case NFA_SET:     return Scm_CharSetContains(node->cs, ch);
+    case NFA_NSET:    return !Scm_CharSetContains(node->cs, ch);
+    case NFA_ANY:     return TRUE;
+    default:          return FALSE;
+    }
+}
+
+/* Returns the state after S consumes CH, or NULL if we gave up. */
+static dfa_state *dfa_step(ScmRegDFA *dfa, dfa_state *s, ScmChar ch)
+{
+    (void)SCM_INTERNAL_MUTEX_LOCK(dfa->mutex);
+    dfa_state *r = NULL;
+    if (ch < 128 && s->next[ch]) {
+        r = s->next[ch];        /* someone has already done it */
+    } else if (!dfa->gaveup) {
+        int count = 0;
+        dfa->generation++;
+        for (int i=0; i<s->numNodes; i++) {
+            nfa_node *node = &dfa->nodes[s->nodes[i]];
+            if (nfa_node_match(node, ch)) {
+                count = dfa_closure(dfa, node->out, count, FALSE, FALSE);
+            }
+        }
+        /* the pattern is unanchored at the end */
+        count = dfa_closure(dfa, dfa->start, count, FALSE, FALSE);
+        r = dfa_intern(dfa, count);
+        if (r && ch < 128) {
+            AO_nop_full();      /* make sure r is visible before publishing */
+            s->next[ch] = r;
+        }
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(dfa->mutex);
+    return r;
+}
+
+static dfa_state *dfa_initial(ScmRegDFA *dfa)
+{
+    if (dfa->initial) return dfa->initial;
+    (void)SCM_INTERNAL_MUTEX_LOCK(dfa->mutex);
+    if (dfa->initial == NULL && !dfa->gaveup) {
+        dfa->generation++;
+        int count = dfa_closure(dfa, dfa->start, 0, TRUE, FALSE);
+        dfa_state *s = dfa_intern(dfa, count);
+        if (s) {
+            AO_nop_full();
+            dfa->initial = s;
+        }
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(dfa->mutex);
+    return dfa->initial;
+}
+
+/* Whether S accepts at the beginning of input, where BOL holds.
+   If the input is empty, EOL holds as well. */
+static int dfa_accept_at_begin(ScmRegDFA *dfa, dfa_state *s, int atEnd)
+{
+    if (s->accept) return TRUE;
+    if (!atEnd && s->acceptAtBegin >= 0) return s->acceptAtBegin;
+    (void)SCM_INTERNAL_MUTEX_LOCK(dfa->mutex);
+    int count = 0;
+    dfa->generation++;
+    for (int i=0; i<s->numNodes; i++) {
+        nfa_node *node = &dfa->nodes[s->nodes[i]];
+        if (node->type == NFA_BOL) {
+            count = dfa_closure(dfa, node->out, count, atEnd, TRUE);
+        }
+    }
+    int r = FALSE;
+    for (int i=0; i<count; i++) {
+        if (dfa->nodes[dfa->set[i]].type == NFA_MATCH) { r = TRUE; break; }
+    }
+    if (!atEnd) s->acceptAtBegin = r;
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(dfa->mutex);
+    return r;
+}
+
+/* Scans [start, end) backward.  Returns the leftmost position a match
+   can begin, or NULL if there's no match.  Sets *gaveup if the DFA
+   can't be used.  ATBEGIN is FALSE if START isn't the beginning of
+   the input, so BOL doesn't hold there. */
+static const char *dfa_scan(ScmRegDFA *dfa, const char *start,
+                            const char *end, int atBegin, int *gaveup)
+{
+    dfa_state *s = dfa_initial(dfa);
+    if (s == NULL) { *gaveup = TRUE; return NULL; }
+
+    const char *p = end, *found = NULL;
+    if (s->accept) found = p;
+    while (p > start) {
+        unsigned char b = (unsigned char)p[-1];
+        dfa_state *n;
+        if (b < 0x80) {
+            p--;
+            n = s->next[b];
+            if (n == NULL) n = dfa_step(dfa, s, b);
+        } else {
+            const char *q;
+            ScmChar ch;
+            SCM_CHAR_BACKWARD(p, start, q);
+            SCM_CHAR_GET(q, ch);
+            p = q;
+            n = dfa_step(dfa, s, ch);
+        }
+        if (n == NULL) { *gaveup = TRUE; return NULL; }
+        s = n;
+        if (s->accept) found = p;
+    }
+    if (atBegin && dfa_accept_at_begin(dfa, s, start == end)) found = start;
+    return found;
+}
+
+#endif /*REGEXP_USE_DFA*/
+
 /*=======================================================================
  * Matcher
  */
@@ -2303,10 +3092,76 @@ struct match_ctx {
     struct ScmRegMatchSub **matches;
     void *begin_stack;          /* C stack pointer the match began from. */
     sigjmp_buf *cont;
+    struct match_search *search;
 };
 
 #define MAX_STACK_USAGE   0x100000
 
+/* State shared by the match attempts of one search.
+ *
+ * We count the calls of rex_rec as steps.  If the steps exceed the
+ * value of the parameter regexp-match-step-limit, we raise an error.
+ *
+ * Rex_rec only returns when it fails, and unless the regexp consults
+ * what the groups captured (by a backreference or a conditional
+ * pattern), the failure only depends on the code and the input
+ * position.  So once a search takes many steps, we remember the failed
+ * (code, position) pairs in a bitmap and don't try them again.  It
+ * makes the search at most O(code size * input size) steps, turning
+ * patterns like #/(a|aa)*c/ from exponential to linear.  We don't
+ * do it from the start, for most searches are short and the bitmap
+ * would cost more than it saves.
+ */
+struct match_search {
+    long steps;
+    long limit;                 /* 0 for no limit */
+    long checkpoint;            /* call match_checkpoint at this step */
+    int memoizable;
+    unsigned char *memo;        /* failed (code, position) bitmap, or NULL */
+    size_t stride;              /* # of positions */
+};
+
+#define MEMO_THRESHOLD   10000      /* run this many steps before memoizing */
+#define MEMO_MAX_BITS    (1L<<26)   /* max size of the bitmap */
+
+static ScmParameterLoc step_limit;  /* regexp-match-step-limit */
+
+static void match_search_init(struct match_search *sr, ScmRegexp *rx,
+                              const char *input, const char *end)
+{
+    ScmObj lim = Scm_ParameterRef(Scm_VM(), &step_limit);
+    sr->steps = 0;
+    sr->limit = SCM_INTP(lim)? SCM_INT_VALUE(lim) : 0;
+    sr->memo = NULL;
+    sr->stride = (size_t)(end - input) + 1;
+    sr->memoizable = !(rx->flags & SCM_REGEXP_USES_CAPTURE)
+        && (double)rx->numCodes * sr->stride <= (double)MEMO_MAX_BITS;
+    sr->checkpoint = sr->memoizable? MEMO_THRESHOLD : LONG_MAX;
+    if (sr->limit > 0 && sr->limit < sr->checkpoint) {
+        sr->checkpoint = sr->limit + 1;
+    }
+}
+
+static void match_checkpoint(struct match_ctx *ctx)
+{
+    struct match_search *sr = ctx->search;
+    if (sr->limit > 0 && sr->steps > sr->limit) {
+        Scm_Error("regexp match exceeded the step limit (%ld): %S",
+                  sr->limit, ctx->rx);
+    }
+    if (sr->memoizable && sr->memo == NULL
+        && sr->steps >= MEMO_THRESHOLD) {
+        size_t nbytes = (ctx->rx->numCodes * sr->stride + 7) / 8;
+        sr->memo = SCM_NEW_ATOMIC2(unsigned char *, nbytes);
+        memset(sr->memo, 0, nbytes);
+    }
+    if (sr->limit > 0 && sr->steps <= sr->limit) {
+        sr->checkpoint = sr->limit + 1;
+    } else {
+        sr->checkpoint = LONG_MAX;
+    }
+}
+
 static int match_ci(const char **input, const unsigned char **code, int length)
 {
     do {
@@ -2350,7 +3205,28 @@ static int is_word_boundary(struct match_ctx *ctx, const char *input)
     return FALSE;
 }
 
-static void rex_rec(const unsigned char *code,
+static void rex_run(const unsigned char *code,
+                    const char *input,
+                    struct match_ctx *ctx);
+
+static inline void rex_rec(const unsigned char *code,
+                           const char *input,
+                           struct match_ctx *ctx)
+{
+    struct match_search *sr = ctx->search;
+    if (++sr->steps >= sr->checkpoint) match_checkpoint(ctx);
+    if (sr->memo == NULL) {
+        rex_run(code, input, ctx);
+        return;
+    }
+    size_t k = (size_t)(code - ctx->codehead) * sr->stride
+        + (size_t)(input - ctx->input);
+    if (sr->memo[k/8] & (1U << (k%8))) return;
+    rex_run(code, input, ctx);
+    sr->memo[k/8] |= (unsigned char)(1U << (k%8));
+}
+
+static void rex_run(const unsigned char *code,
                     const char *input,
                     struct match_ctx *ctx)
 {
@@ -2763,36 +3639,45 @@ static void rex_rec(const unsigned char *code,
     }
 }
 
-static ScmObj make_match(ScmRegexp *rx, ScmString *orig,
+/* The input the matcher runs on.  We keep information of the original
+   string separately, instead of keeping a pointer to it; For the string
+   may be destructively modified, but its body is not. */
+struct match_input {
+    const char *input;          /* beginning of the input */
+    ScmSmallInt size;           /* # of bytes */
+    ScmSmallInt len;            /* # of characters, or size for bytes */
+    ScmObj bytes;               /* u8vector the input is from, or #f */
+};
+
+static ScmObj make_match(ScmRegexp *rx, const struct match_input *in,
                          struct match_ctx *ctx)
 {
     ScmRegMatch *rm = SCM_NEW(ScmRegMatch);
     SCM_SET_CLASS(rm, SCM_CLASS_REGMATCH);
     rm->numMatches = rx->numGroups;
     rm->grpNames = rx->grpNames;
-    /* we keep information of original string separately, instead of
-       keeping a pointer to orig; For orig may be destructively modified,
-       but its elements are not. */
-    const ScmStringBody *origb = SCM_STRING_BODY(orig);
-    rm->input = SCM_STRING_BODY_START(origb);
-    rm->inputLen = SCM_STRING_BODY_LENGTH(origb);
-    rm->inputSize = SCM_STRING_BODY_SIZE(origb);
+    rm->input = in->input;
+    rm->inputLen = in->len;
+    rm->inputSize = in->size;
+    rm->bytes = in->bytes;
     rm->matches = ctx->matches;
     return SCM_OBJ(rm);
 }
 
-static ScmObj rex(ScmRegexp *rx, ScmString *orig,
-                  const char *start, const char *end)
+static ScmObj rex(ScmRegexp *rx, const struct match_input *in,
+                  const char *start, const char *end,
+                  struct match_search *sr)
 {
     struct match_ctx ctx;
     sigjmp_buf cont;
 
     ctx.rx = rx;
     ctx.codehead = rx->code;
-    ctx.input = SCM_STRING_BODY_START(SCM_STRING_BODY(orig));
+    ctx.input = in->input;
     ctx.stop = end;
     ctx.begin_stack = (void*)&ctx;
     ctx.cont = &cont;
+    ctx.search = sr;
     ctx.matches = SCM_NEW_ARRAY(struct ScmRegMatchSub *, rx->numGroups);
 
     for (int i = 0; i < rx->numGroups; i++) {
@@ -2808,7 +3693,7 @@ static ScmObj rex(ScmRegexp *rx, ScmString *orig,
         rex_rec(ctx.codehead, start, &ctx);
         return SCM_FALSE;
     }
-    return make_match(rx, orig, &ctx);
+    return make_match(rx, in, &ctx);
 }
 
 /* advance start pointer while the character matches (skip_match=TRUE) or does
@@ -2829,46 +3714,89 @@ static inline const char *skip_input(const char *start, const char *limit,
     return limit;
 }
 
+/* Returns the first occurrence of rx->mustMatch in [s, end), or NULL.
+   Horspool's algorithm; we don't bother with a fancier one, since
+   mustMatch is short and the table is calculated at compile time. */
+static const char *must_search(ScmRegexp *rx, const char *s, const char *end)
+{
+    const ScmStringBody *mb = SCM_STRING_BODY(rx->mustMatch);
+    const unsigned char *pat = (const unsigned char*)SCM_STRING_BODY_START(mb);
+    long m = SCM_STRING_BODY_SIZE(mb);
+
+    if (end - s < m) return NULL;
+    if (m == 1) return memchr(s, pat[0], end - s);
+
+    const unsigned char *skip = rx->mustSkip;
+    const unsigned char *t = (const unsigned char*)s;
+    const unsigned char *last = (const unsigned char*)end - m;
+    unsigned char c = pat[m-1];
+    while (t <= last) {
+        unsigned char x = t[m-1];
+        if (x == c && memcmp(t, pat, m-1) == 0) return (const char*)t;
+        t += skip[x];
+    }
+    return NULL;
+}
+
 /*----------------------------------------------------------------------
  * entry point
  */
-ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
+/* Searches a match in [start, end) of IN.  END works as the end of
+   the input, while the matcher can look behind START. */
+static ScmObj rx_exec(ScmRegexp *rx, const struct match_input *in,
+                      const char *start, const char *end)
 {
-    const ScmStringBody *b = SCM_STRING_BODY(str);
-    const char *start = SCM_STRING_BODY_START(b);
-    const char *end = start + SCM_STRING_BODY_SIZE(b);
     const ScmStringBody *mb = rx->mustMatch? SCM_STRING_BODY(rx->mustMatch) : NULL;
     int mustMatchLen = mb? SCM_STRING_BODY_SIZE(mb) : 0;
     const char *start_limit = end - mustMatchLen;
 
-    if (SCM_STRING_INCOMPLETE_P(str)) {
-        Scm_Error("incomplete string is not allowed: %S", str);
+    /* Prescreening.  If the input string doesn't contain mustMatch
+       string, it can't match the entire expression. */
+    const char *mustp = NULL;
+    if (mb) {
+        mustp = must_search(rx, start, end);
+        if (mustp == NULL) return SCM_FALSE;
     }
-#if 0
-    /* Disabled for now; we need to use more heuristics to determine
-       when we should apply mustMatch.  For example, if the regexp
-       begins with BOL assertion and constant string, then it would be
-       faster to go for rex directly. */
-    if (rx->mustMatch) {
-        /* Prescreening.  If the input string doesn't contain mustMatch
-           string, it can't match the entire expression. */
-        if (SCM_FALSEP(Scm_StringScan(str, rx->mustMatch,
-                                      SCM_STRING_SCAN_INDEX))) {
-            return SCM_FALSE;
-        }
-    }
-#endif
+    struct match_search sr;
+    match_search_init(&sr, rx, in->input, end);
+
     /* short cut : if rx matches only at the beginning of the string,
        we only run from the beginning of the string */
     if (rx->flags & SCM_REGEXP_BOL_ANCHORED) {
-        return rex(rx, str, start, end);
+        if (start != in->input) return SCM_FALSE;
+        return rex(rx, in, start, end, &sr);
+    }
+
+#if defined(REGEXP_USE_DFA)
+    /* The DFA tells us if there's a match at all, and if so, the leftmost
+       position it can start.  No need to try the positions before it. */
+    if (rx->dfa && !rx->dfa->gaveup) {
+        int gaveup = FALSE;
+        const char *s = dfa_scan(rx->dfa, start, end, start == in->input,
+                                 &gaveup);
+        if (!gaveup) {
+            if (s == NULL) return SCM_FALSE;
+            start = s;
+        }
+    }
+#endif /*REGEXP_USE_DFA*/
+
+    /* if every match begins with mustMatch, try only at its occurrences. */
+    if (rx->flags & SCM_REGEXP_MUST_PREFIX) {
+        if (mustp < start) mustp = must_search(rx, start, end);
+        while (mustp != NULL) {
+            ScmObj r = rex(rx, in, mustp, end, &sr);
+            if (!SCM_FALSEP(r)) return r;
+            mustp = must_search(rx, mustp + 1, end);
+        }
+        return SCM_FALSE;
     }
 
     /* if we have lookahead-set, we may be able to skip input efficiently. */
     if (!SCM_FALSEP(rx->laset)) {
         if (rx->flags & SCM_REGEXP_SIMPLE_PREFIX) {
             while (start <= start_limit) {
-                ScmObj r = rex(rx, str, start, end);
+                ScmObj r = rex(rx, in, start, end, &sr);
                 if (!SCM_FALSEP(r)) return r;
                 const char *next = skip_input(start, start_limit, rx->laset,
                                               TRUE);
@@ -2878,7 +3806,7 @@ ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
         } else {
             while (start <= start_limit) {
                 start = skip_input(start, start_limit, rx->laset, FALSE);
-                ScmObj r = rex(rx, str, start, end);
+                ScmObj r = rex(rx, in, start, end, &sr);
                 if (!SCM_FALSEP(r)) return r;
                 start += SCM_CHAR_NFOLLOWS(*start)+1;
             }
@@ -2888,13 +3816,253 @@ ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
 
     /* normal matching */
     while (start <= start_limit) {
-        ScmObj r = rex(rx, str, start, end);
+        ScmObj r = rex(rx, in, start, end, &sr);
         if (!SCM_FALSEP(r)) return r;
         start += SCM_CHAR_NFOLLOWS(*start)+1;
     }
     return SCM_FALSE;
 }
 
+ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
+{
+    return Scm_RegExecRange(rx, str, 0, -1);
+}
+
+/* START and END are character indices. */
+ScmObj Scm_RegExecRange(ScmRegexp *rx, ScmString *str,
+                        ScmSmallInt start, ScmSmallInt end)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    struct match_input in;
+
+    if (SCM_STRING_BODY_INCOMPLETE_P(b)) {
+        Scm_Error("incomplete string is not allowed: %S", str);
+    }
+    in.input = SCM_STRING_BODY_START(b);
+    in.size = SCM_STRING_BODY_SIZE(b);
+    in.len = SCM_STRING_BODY_LENGTH(b);
+    in.bytes = SCM_FALSE;
+    if (start == 0 && end < 0) {
+        return rx_exec(rx, &in, in.input, in.input + in.size);
+    }
+    SCM_CHECK_START_END(start, end, in.len);
+    return rx_exec(rx, &in, Scm_StringBodyPosition(b, start),
+                   Scm_StringBodyPosition(b, end));
+}
+
+/* Matches the bytes in a u8vector as a string, without copying.  START
+   and END, as well as the positions in the match, are byte offsets.
+   The range must consist of complete characters. */
+ScmObj Scm_RegExecBytes(ScmRegexp *rx, ScmObj bytes,
+                        ScmSmallInt start, ScmSmallInt end)
+{
+    struct match_input in;
+
+    if (!SCM_U8VECTORP(bytes)) {
+        Scm_Error("u8vector required, but got %S", bytes);
+    }
+    in.input = (const char*)SCM_U8VECTOR_ELEMENTS(bytes);
+    in.size = in.len = SCM_U8VECTOR_SIZE(bytes);
+    in.bytes = bytes;
+    SCM_CHECK_START_END(start, end, in.size);
+    if (Scm__MBLength(in.input + start, end - start) < 0) {
+        Scm_Error("u8vector contains an invalid character sequence "
+                  "between %ld and %ld", start, end);
+    }
+    return rx_exec(rx, &in, in.input + start, in.input + end);
+}
+
+/*=======================================================================
+ * Regexp sets
+ */
+
+/* A regexp set answers which of its regexps match the input.  Trying
+ * them one by one is slow when there are hundreds of them, while usually
+ * only a few can match.  So we search the mustMatch literals of all
+ * regexps at once with an Aho-Corasick automaton, and run only the
+ * regexps whose literal appears in the input (and the ones without
+ * a literal).
+ *
+ * To keep the transition table small, we map the bytes to classes;
+ * the bytes that don't appear in any literal all go to class 0.
+ */
+
+static void regexp_set_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    Scm_Printf(port, "#<regexp-set %d>", SCM_REGEXP_SET(obj)->numRegexps);
+}
+
+SCM_DEFINE_BUILTIN_CLASS(Scm_RegexpSetClass, regexp_set_print,
+                         NULL, NULL, NULL, SCM_CLASS_DEFAULT_CPL);
+
+/* Creates a new automaton state, extending the tables if needed. */
+static int ac_new_node(ScmRegexpSet *set, int *maxNodes)
+{
+    int nc = set->numClasses;
+    if (set->numNodes >= *maxNodes) {
+        int newmax = *maxNodes * 2;
+        int *delta = SCM_NEW_ATOMIC_ARRAY(int, newmax * nc);
+        int *output = SCM_NEW_ATOMIC_ARRAY(int, newmax);
+        memcpy(delta, set->delta, sizeof(int) * set->numNodes * nc);
+        memcpy(output, set->output, sizeof(int) * set->numNodes);
+        set->delta = delta;
+        set->output = output;
+        *maxNodes = newmax;
+    }
+    int n = set->numNodes++;
+    for (int c = 0; c < nc; c++) set->delta[n*nc + c] = -1;
+    set->output[n] = -1;
+    return n;
+}
+
+static void ac_build(ScmRegexpSet *set)
+{
+    int nr = set->numRegexps;
+
+    /* byte classes */
+    memset(set->byteClass, 0, 256);
+    set->numClasses = 1;
+    for (int i = 0; i < nr; i++) {
+        ScmString *lit = set->regexps[i]->mustMatch;
+        if (lit == NULL) continue;
+        const ScmStringBody *b = SCM_STRING_BODY(lit);
+        const unsigned char *p = (const unsigned char*)SCM_STRING_BODY_START(b);
+        for (int k = 0; k < SCM_STRING_BODY_SIZE(b); k++) {
+            if (set->byteClass[p[k]] == 0) {
+                set->byteClass[p[k]] = (unsigned char)set->numClasses++;
+            }
+        }
+    }
+    int nc = set->numClasses;
+
+    /* trie */
+    int maxNodes = 64;
+    set->numNodes = 0;
+    set->delta = SCM_NEW_ATOMIC_ARRAY(int, maxNodes * nc);
+    set->output = SCM_NEW_ATOMIC_ARRAY(int, maxNodes);
+    set->sameLiteral = SCM_NEW_ATOMIC_ARRAY(int, nr);
+    ac_new_node(set, &maxNodes);
+    for (int i = nr-1; i >= 0; i--) {
+        set->sameLiteral[i] = -1;
+        ScmString *lit = set->regexps[i]->mustMatch;
+        if (lit == NULL) continue;
+        const ScmStringBody *b = SCM_STRING_BODY(lit);
+        const unsigned char *p = (const unsigned char*)SCM_STRING_BODY_START(b);
+        int n = 0;
+        for (int k = 0; k < SCM_STRING_BODY_SIZE(b); k++) {
+            int c = set->byteClass[p[k]];
+            if (set->delta[n*nc + c] < 0) {
+                int m = ac_new_node(set, &maxNodes);
+                set->delta[n*nc + c] = m;
+            }
+            n = set->delta[n*nc + c];
+        }
+        set->sameLiteral[i] = set->output[n];
+        set->output[n] = i;
+    }
+
+    /* failure links, in breadth-first order.  We fold them into delta,
+       so that the scan needs just one lookup per byte. */
+    int nn = set->numNodes;
+    int *fail = SCM_NEW_ATOMIC_ARRAY(int, nn);
+    int *queue = SCM_NEW_ATOMIC_ARRAY(int, nn);
+    int qhead = 0, qtail = 0;
+    set->outputLink = SCM_NEW_ATOMIC_ARRAY(int, nn);
+    fail[0] = 0;
+    set->outputLink[0] = -1;
+    for (int c = 0; c < nc; c++) {
+        int v = set->delta[c];
+        if (v < 0) {
+            set->delta[c] = 0;
+        } else {
+            fail[v] = 0;
+            set->outputLink[v] = -1;
+            queue[qtail++] = v;
+        }
+    }
+    while (qhead < qtail) {
+        int u = queue[qhead++];
+        for (int c = 0; c < nc; c++) {
+            int v = set->delta[u*nc + c];
+            int f = set->delta[fail[u]*nc + c];
+            if (v < 0) {
+                set->delta[u*nc + c] = f;
+            } else {
+                fail[v] = f;
+                set->outputLink[v] =
+                    (set->output[f] >= 0)? f : set->outputLink[f];
+                queue[qtail++] = v;
+            }
+        }
+    }
+}
+
+/* REGEXPS is a list of regexps or strings. */
+ScmObj Scm_MakeRegexpSet(ScmObj regexps)
+{
+    int nr = (int)Scm_Length(regexps);
+    if (nr < 0) Scm_Error("proper list required, but got %S", regexps);
+
+    ScmRegexpSet *set = SCM_NEW(ScmRegexpSet);
+    SCM_SET_CLASS(set, SCM_CLASS_REGEXP_SET);
+    set->numRegexps = nr;
+    set->regexps = SCM_NEW_ARRAY(ScmRegexp*, nr);
+    int i = 0;
+    ScmObj cp;
+    SCM_FOR_EACH(cp, regexps) {
+        ScmObj rx = SCM_CAR(cp);
+        if (SCM_STRINGP(rx)) {
+            rx = Scm_RegComp(SCM_STRING(rx), 0);
+        } else if (!SCM_REGEXPP(rx)) {
+            Scm_Error("regexp or string required, but got %S", rx);
+        }
+        set->regexps[i++] = SCM_REGEXP(rx);
+    }
+    ac_build(set);
+    return SCM_OBJ(set);
+}
+
+/* Returns a list of indices of the regexps that match INPUT, in
+   increasing order. */
+ScmObj Scm_RegexpSetMatches(ScmRegexpSet *set, ScmString *input)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(input);
+    const unsigned char *p = (const unsigned char*)SCM_STRING_BODY_START(b);
+    const unsigned char *end = p + SCM_STRING_BODY_SIZE(b);
+    int nr = set->numRegexps, nc = set->numClasses;
+    char candbuf[256];
+    char *cand = (nr <= 256)? candbuf : SCM_NEW_ATOMIC2(char *, nr);
+    int nlits = 0, nfound = 0;
+
+    for (int i = 0; i < nr; i++) {
+        if (set->regexps[i]->mustMatch) {
+            cand[i] = FALSE;
+            nlits++;
+        } else {
+            cand[i] = TRUE;
+        }
+    }
+
+    int n = 0;
+    while (p < end && nfound < nlits) {
+        n = set->delta[n*nc + set->byteClass[*p++]];
+        int o = (set->output[n] >= 0)? n : set->outputLink[n];
+        for (; o >= 0; o = set->outputLink[o]) {
+            for (int i = set->output[o]; i >= 0; i = set->sameLiteral[i]) {
+                if (!cand[i]) { cand[i] = TRUE; nfound++; }
+            }
+        }
+    }
+
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    for (int i = 0; i < nr; i++) {
+        if (cand[i] && !SCM_FALSEP(Scm_RegExec(set->regexps[i], input))) {
+            SCM_APPEND1(h, t, SCM_MAKE_INT(i));
+        }
+    }
+    return h;
+}
+
 /*=======================================================================
  * Retrieving matches
  */
@@ -2927,16 +4095,16 @@ ScmObj Scm_RegExec(ScmRegexp *rx, ScmString *str)
 /* We want to avoid unnecessary character counting as much as
    possible. */
 
-#define MSUB_BEFORE_SIZE(rm, sub) ((int)((sub)->startp - (rm)->input))
-#define MSUB_SIZE(rm, sub)        ((int)((sub)->endp - (sub)->startp))
-#define MSUB_AFTER_SIZE(rm, sub)  ((int)((rm)->input + (rm)->inputSize - (sub)->endp))
+#define MSUB_BEFORE_SIZE(rm, sub) ((ScmSmallInt)((sub)->startp - (rm)->input))
+#define MSUB_SIZE(rm, sub)        ((ScmSmallInt)((sub)->endp - (sub)->startp))
+#define MSUB_AFTER_SIZE(rm, sub)  ((ScmSmallInt)((rm)->input + (rm)->inputSize - (sub)->endp))
 
 #define MSUB_BEFORE_LENGTH(rm, sub) \
-    Scm_MBLen((rm)->input, (sub)->startp)
+    Scm__MBLength((rm)->input, MSUB_BEFORE_SIZE(rm, sub))
 #define MSUB_LENGTH(rm, sub) \
-    Scm_MBLen((sub)->startp, (sub)->endp)
+    Scm__MBLength((sub)->startp, MSUB_SIZE(rm, sub))
 #define MSUB_AFTER_LENGTH(rm, sub) \
-    Scm_MBLen((sub)->endp, (rm)->input + (rm)->inputSize)
+    Scm__MBLength((sub)->endp, MSUB_AFTER_SIZE(rm, sub))
 
 #define UNCOUNTED(rm, sub)                                      \
     (((sub)->start    >= 0 ? 0 : MSUB_BEFORE_SIZE(rm, sub))     \
@@ -3030,13 +4198,22 @@ ScmObj Scm_RegMatchEnd(ScmRegMatch *rm, ScmObj obj)
     return Scm_MakeInteger(rm->inputLen - sub->after);
 }
 
+/* Substrings of a match on a u8vector are copied, for the vector may
+   be modified or unmapped.  The lengths we've counted are in bytes then. */
+static ScmObj regmatch_string(ScmRegMatch *rm, const char *p,
+                              ScmSmallInt size, ScmSmallInt len)
+{
+    if (SCM_FALSEP(rm->bytes)) return Scm_MakeString(p, size, len, 0);
+    return Scm_MakeString(p, size, -1, SCM_STRING_COPYING);
+}
+
 ScmObj Scm_RegMatchBefore(ScmRegMatch *rm, ScmObj obj)
 {
     struct ScmRegMatchSub *sub = regmatch_ref(rm, obj);
     if (sub == NULL) return SCM_FALSE;
     if (sub->start < 0) regmatch_count_start(rm, sub);
-    return Scm_MakeString(rm->input, MSUB_BEFORE_SIZE(rm, sub),
-                          sub->start, 0);
+    return regmatch_string(rm, rm->input, MSUB_BEFORE_SIZE(rm, sub),
+                           sub->start);
 }
 
 ScmObj Scm_RegMatchSubstr(ScmRegMatch *rm, ScmObj obj)
@@ -3044,8 +4221,8 @@ ScmObj Scm_RegMatchSubstr(ScmRegMatch *rm, ScmObj obj)
     struct ScmRegMatchSub *sub = regmatch_ref(rm, obj);
     if (sub == NULL) return SCM_FALSE;
     if (sub->length < 0) regmatch_count_length(rm, sub);
-    return Scm_MakeString(sub->startp, MSUB_SIZE(rm, sub),
-                          sub->length, 0);
+    return regmatch_string(rm, sub->startp, MSUB_SIZE(rm, sub),
+                           sub->length);
 }
 
 ScmObj Scm_RegMatchAfter(ScmRegMatch *rm, ScmObj obj)
@@ -3053,8 +4230,8 @@ ScmObj Scm_RegMatchAfter(ScmRegMatch *rm, ScmObj obj)
     struct ScmRegMatchSub *sub = regmatch_ref(rm, obj);
     if (sub == NULL) return SCM_FALSE;
     if (sub->after < 0) regmatch_count_after(rm, sub);
-    return Scm_MakeString(sub->endp, MSUB_AFTER_SIZE(rm, sub),
-                          sub->after, 0);
+    return regmatch_string(rm, sub->endp, MSUB_AFTER_SIZE(rm, sub),
+                           sub->after);
 }
 
 /* for debug */
@@ -3084,4 +4261,9 @@ void Scm_RegMatchDump(ScmRegMatch *rm)
 
 void Scm__InitRegexp(void)
 {
+    Scm_DefinePrimitiveParameter(Scm_GaucheModule(), "regexp-match-step-limit",
+                                 SCM_FALSE, &step_limit);
+    (void)SCM_INTERNAL_MUTEX_INIT(rx_cache.mutex);
+    Scm_HashCoreInitSimple(&rx_cache.table[0], SCM_HASH_STRING, 0, NULL);
+    Scm_HashCoreInitSimple(&rx_cache.table[1], SCM_HASH_STRING, 0, NULL);
 }
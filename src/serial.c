@@ -1,5 +1,5 @@
 /*
- * serial.c - serializer 
+ * serial.c - serializer
  *
  *   Copyright (c) 2000-2015  Shiro Kawai  <shiro@acm.org>
  * 
@@ -31,8 +31,821 @@
  *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define LIBGAUCHE_BODY
 #include "gauche.h"
+#include "gauche/class.h"
+#include "gauche/bignum.h"
+#include "gauche/priv/portP.h"
 
-/* NOT IMPLEMENTED YET */
+#include <string.h>
+
+/*
+ * Binary serialization
+ *
+ *   Scm_WriteSerialized writes an object in a compact binary format,
+ *   and Scm_ReadSerialized reads it back.  Unlike write/read, no
+ *   printed representation is involved; numbers and uvectors are
+ *   written in their binary form, and strings and symbols are written
+ *   as a byte count followed by the raw bytes.
+ *
+ *   A serialized datum begins with the header:
+ *
+ *      <magic:3> <version:1> <flags:1>
+ *
+ *   followed by one object.  Each object begins with a tag byte.
+ *   Integers in the format (sizes, counts, codepoints) are unsigned
+ *   LEB128 varints, and signed fixnums are zigzag-encoded before being
+ *   written as varints.  Multibyte binary data (flonums, uvector
+ *   elements) is always little-endian.
+ *
+ *   If SERIAL_SHARED flag is set in the header, the writer first walks
+ *   the object to find the objects referenced more than once.  The
+ *   first occurrence of such object is prefixed by TAG_DEF, which
+ *   implicitly numbers it from 0, and later occurrences are written as
+ *   TAG_REF <id>.  The reader registers a container object as soon as it
+ *   is allocated, before reading its contents, so circular structures
+ *   are reconstructed.  Without the flag, a circular structure would
+ *   loop forever, just like write-simple.
+ *
+ *   Lists are written as TAG_LIST <n> <car>... <tail>, so that the
+ *   spine of a long list doesn't consume C stack.  In shared mode, a
+ *   spine is cut at a pair that is referenced from elsewhere, and the
+ *   rest is written as the tail.
+ *
+ *   Instances of Scheme-defined classes (which includes records) are
+ *   written with the name of the class and the name of the module
+ *   where it is defined, followed by the instance slot values.  The
+ *   reader looks up the class by those names, so the class must be
+ *   defined in the reading process as well.
+ *
+ *   Other objects (procedures, ports, etc.) can't be serialized and
+ *   cause an error.
+ */
+
+#define SERIAL_MAGIC0   0xa7
+#define SERIAL_MAGIC1   'G'
+#define SERIAL_MAGIC2   's'
+#define SERIAL_VERSION  1
+
+#define SERIAL_SHARED   (1L<<0)
+
+enum {
+    TAG_NIL         = 0x00,
+    TAG_TRUE        = 0x01,
+    TAG_FALSE       = 0x02,
+    TAG_EOF         = 0x03,
+    TAG_UNDEFINED   = 0x04,
+    TAG_UNBOUND     = 0x05,     /* only appears as a slot value */
+
+    TAG_FIXNUM      = 0x08,     /* zigzag varint */
+    TAG_BIGNUM      = 0x09,     /* sign:1 nbytes magnitude-bytes(LE) */
+    TAG_RATNUM      = 0x0a,     /* numerator denominator */
+    TAG_FLONUM      = 0x0b,     /* IEEE double, LE */
+    TAG_COMPNUM     = 0x0c,     /* two IEEE doubles, LE */
+
+    TAG_CHAR        = 0x10,     /* varint */
+    TAG_STRING      = 0x11,     /* size len bytes */
+    TAG_ISTRING     = 0x12,     /* size bytes; incomplete string */
+    TAG_SYMBOL      = 0x13,     /* size len bytes */
+    TAG_USYMBOL     = 0x14,     /* size len bytes; uninterned */
+    TAG_KEYWORD     = 0x15,     /* size len bytes */
+
+    TAG_LIST        = 0x18,     /* n car... tail */
+    TAG_VECTOR      = 0x19,     /* n elt... */
+    TAG_UVECTOR     = 0x1a,     /* type:1 n bytes */
+    TAG_HASHTABLE   = 0x1b,     /* type:1 n key val ... */
+    TAG_INSTANCE    = 0x1c,     /* class-name module-name nslots slot... */
+
+    TAG_DEF         = 0x1e,     /* object */
+    TAG_REF         = 0x1f      /* id */
+};
+
+/*==================================================================
+ * Writer
+ */
+
+#define SERIAL_BUFSIZ 4096
+
+typedef struct serial_out_rec {
+    ScmPort *port;
+    int shared;
+    ScmHashCore refs;           /* obj -> count (pass 1), -(id+1) (pass 2) */
+    intptr_t nextid;
+    int pos;
+    char buf[SERIAL_BUFSIZ];
+} serial_out;
+
+static void out_flush(serial_out *so)
+{
+    if (so->pos > 0) {
+        Scm_PutzUnsafe(so->buf, so->pos, so->port);
+        so->pos = 0;
+    }
+}
+
+static inline void out_byte(serial_out *so, int b)
+{
+    if (so->pos >= SERIAL_BUFSIZ) out_flush(so);
+    so->buf[so->pos++] = (char)b;
+}
+
+static void out_bytes(serial_out *so, const void *data, ScmSmallInt size)
+{
+    const char *p = (const char*)data;
+    while (size > 0) {
+        if (so->pos >= SERIAL_BUFSIZ) out_flush(so);
+        ScmSmallInt chunk = SERIAL_BUFSIZ - so->pos;
+        if (chunk > size) chunk = size;
+        memcpy(so->buf + so->pos, p, chunk);
+        so->pos += (int)chunk;
+        p += chunk;
+        size -= chunk;
+    }
+}
+
+static void out_varint(serial_out *so, ScmUInt64 v)
+{
+    while (v >= 0x80) {
+        out_byte(so, (int)((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out_byte(so, (int)v);
+}
+
+static void out_double(serial_out *so, double d)
+{
+    union { double d; ScmUInt64 u; } v;
+    v.d = d;
+    for (int i=0; i<8; i++) {
+        out_byte(so, (int)(v.u & 0xff));
+        v.u >>= 8;
+    }
+}
+
+/* Writes size, (len), and the bytes of the string body. */
+static void out_string_body(serial_out *so, ScmString *s, int withlen)
+{
+    unsigned int size, len;
+    const char *b = Scm_GetStringContent(s, &size, &len, NULL);
+    out_varint(so, size);
+    if (withlen) out_varint(so, len);
+    out_bytes(so, b, size);
+}
+
+/* Bignum magnitude is written as a sequence of bytes, least significant
+   first, so that the format doesn't depend on the size of u_long. */
+static void out_bignum(serial_out *so, ScmBignum *b)
+{
+    ScmSmallInt nwords = SCM_BIGNUM_SIZE(b);
+    while (nwords > 0 && b->values[nwords-1] == 0) nwords--;
+    ScmSmallInt nbytes = nwords * SIZEOF_LONG;
+    if (nwords > 0) {
+        u_long top = b->values[nwords-1];
+        for (int i=SIZEOF_LONG-1; i>0 && ((top >> (i*8)) & 0xff) == 0; i--) {
+            nbytes--;
+        }
+    }
+    out_byte(so, SCM_BIGNUM_SIGN(b) < 0 ? 1 : 0);
+    out_varint(so, nbytes);
+    for (ScmSmallInt i=0; i<nbytes; i++) {
+        out_byte(so, (int)((b->values[i/SIZEOF_LONG] >> ((i%SIZEOF_LONG)*8))
+                           & 0xff));
+    }
+}
+
+/* Objects whose identity we care about in shared mode. */
+static inline int serial_sharable_p(ScmObj obj)
+{
+    if (!SCM_HPTRP(obj)) return FALSE;
+    if (SCM_PAIRP(obj) || SCM_VECTORP(obj) || SCM_STRINGP(obj)) return TRUE;
+    if (SCM_SYMBOLP(obj)) return !SCM_SYMBOL_INTERNED(obj);
+    if (SCM_NUMBERP(obj) || SCM_KEYWORDP(obj)) return FALSE;
+    return TRUE;
+}
+
+static intptr_t *ref_entry(serial_out *so, ScmObj obj)
+{
+    ScmDictEntry *e = Scm_HashCoreSearch(&so->refs, (intptr_t)obj,
+                                         SCM_DICT_GET);
+    return e ? &e->value : NULL;
+}
+
+/* Pass 1: count references of sharable objects. */
+static void scan_object(serial_out *so, ScmObj obj)
+{
+    for (;;) {
+        if (!serial_sharable_p(obj)) return;
+        ScmDictEntry *e = Scm_HashCoreSearch(&so->refs, (intptr_t)obj,
+                                             SCM_DICT_CREATE);
+        if (e->value++ > 0) return;
+
+        if (SCM_PAIRP(obj)) {
+            scan_object(so, SCM_CAR(obj));
+            obj = SCM_CDR(obj);
+            continue;
+        }
+        if (SCM_VECTORP(obj)) {
+            ScmSmallInt n = SCM_VECTOR_SIZE(obj);
+            for (ScmSmallInt i=0; i<n; i++) {
+                scan_object(so, SCM_VECTOR_ELEMENT(obj, i));
+            }
+            return;
+        }
+        if (SCM_HASH_TABLE_P(obj)) {
+            ScmHashIter iter;
+            ScmDictEntry *he;
+            Scm_HashIterInit(&iter, SCM_HASH_TABLE_CORE(obj));
+            while ((he = Scm_HashIterNext(&iter)) != NULL) {
+                scan_object(so, SCM_DICT_KEY(he));
+                scan_object(so, SCM_DICT_VALUE(he));
+            }
+            return;
+        }
+        ScmClass *k = Scm_ClassOf(obj);
+        if (SCM_CLASS_CATEGORY(k) == SCM_CLASS_SCHEME) {
+            int n = k->numInstanceSlots;
+            for (int i=0; i<n; i++) {
+                scan_object(so, Scm_InstanceSlotRef(obj, i));
+            }
+        }
+        return;
+    }
+}
+
+static void write_object(serial_out *so, ScmObj obj);
+
+/* In shared mode, emit TAG_DEF or TAG_REF as needed.  Returns TRUE
+   if OBJ is already written and the caller should not write it again. */
+static int write_ref(serial_out *so, ScmObj obj)
+{
+    if (!so->shared || !serial_sharable_p(obj)) return FALSE;
+    intptr_t *v = ref_entry(so, obj);
+    if (v == NULL) return FALSE;
+    if (*v < 0) {
+        out_byte(so, TAG_REF);
+        out_varint(so, (ScmUInt64)(-*v - 1));
+        return TRUE;
+    }
+    if (*v > 1) {
+        out_byte(so, TAG_DEF);
+        *v = -(so->nextid++) - 1;
+    }
+    return FALSE;
+}
+
+static void write_list(serial_out *so, ScmObj obj)
+{
+    /* Count the spine, stopping at a pair referenced from elsewhere. */
+    ScmSmallInt n = 1;
+    ScmObj tail = SCM_CDR(obj);
+    while (SCM_PAIRP(tail)) {
+        if (so->shared) {
+            intptr_t *v = ref_entry(so, tail);
+            if (v && (*v < 0 || *v > 1)) break;
+        }
+        n++;
+        tail = SCM_CDR(tail);
+    }
+    out_byte(so, TAG_LIST);
+    out_varint(so, n);
+    for (ScmObj cp = obj; n > 0; cp = SCM_CDR(cp), n--) {
+        write_object(so, SCM_CAR(cp));
+    }
+    write_object(so, tail);
+}
+
+static void write_uvector(serial_out *so, ScmUVector *v)
+{
+    ScmClass *k = Scm_ClassOf(SCM_OBJ(v));
+    int type = Scm_UVectorType(k);
+    int eltsize = Scm_UVectorElementSize(k);
+    ScmSmallInt n = SCM_UVECTOR_SIZE(v);
+    out_byte(so, TAG_UVECTOR);
+    out_byte(so, type);
+    out_varint(so, n);
+#ifdef WORDS_BIGENDIAN
+    if (eltsize > 1) {
+        const unsigned char *p = (const unsigned char*)SCM_UVECTOR_ELEMENTS(v);
+        for (ScmSmallInt i=0; i<n; i++, p+=eltsize) {
+            for (int j=eltsize-1; j>=0; j--) out_byte(so, p[j]);
+        }
+        return;
+    }
+#endif
+    out_bytes(so, SCM_UVECTOR_ELEMENTS(v), n*eltsize);
+}
+
+static void write_hashtable(serial_out *so, ScmHashTable *h)
+{
+    ScmHashType type = Scm_HashTableType(h);
+    if (type != SCM_HASH_EQ && type != SCM_HASH_EQV
+        && type != SCM_HASH_EQUAL && type != SCM_HASH_STRING) {
+        Scm_Error("can't serialize a hash table with custom comparator: %S",
+                  h);
+    }
+    out_byte(so, TAG_HASHTABLE);
+    out_byte(so, type);
+    out_varint(so, Scm_HashCoreNumEntries(SCM_HASH_TABLE_CORE(h)));
+    ScmHashIter iter;
+    ScmDictEntry *e;
+    Scm_HashIterInit(&iter, SCM_HASH_TABLE_CORE(h));
+    while ((e = Scm_HashIterNext(&iter)) != NULL) {
+        write_object(so, SCM_DICT_KEY(e));
+        write_object(so, SCM_DICT_VALUE(e));
+    }
+}
+
+static void write_instance(serial_out *so, ScmObj obj, ScmClass *k)
+{
+    ScmObj mod = SCM_FALSE;
+    if (SCM_PAIRP(k->modules) && SCM_MODULEP(SCM_CAR(k->modules))) {
+        mod = SCM_MODULE(SCM_CAR(k->modules))->name;
+    }
+    if (!SCM_SYMBOLP(k->name)) {
+        Scm_Error("can't serialize an instance of anonymous class: %S", obj);
+    }
+    int n = k->numInstanceSlots;
+    out_byte(so, TAG_INSTANCE);
+    write_object(so, k->name);
+    write_object(so, mod);
+    out_varint(so, n);
+    for (int i=0; i<n; i++) {
+        ScmObj v = Scm_InstanceSlotRef(obj, i);
+        if (SCM_UNBOUNDP(v)) out_byte(so, TAG_UNBOUND);
+        else write_object(so, v);
+    }
+}
+
+static void write_object(serial_out *so, ScmObj obj)
+{
+    if (SCM_NULLP(obj))       { out_byte(so, TAG_NIL); return; }
+    if (SCM_TRUEP(obj))       { out_byte(so, TAG_TRUE); return; }
+    if (SCM_FALSEP(obj))      { out_byte(so, TAG_FALSE); return; }
+    if (SCM_EOFP(obj))        { out_byte(so, TAG_EOF); return; }
+    if (SCM_UNDEFINEDP(obj))  { out_byte(so, TAG_UNDEFINED); return; }
+    if (SCM_INTP(obj)) {
+        ScmInt64 v = SCM_INT_VALUE(obj);
+        out_byte(so, TAG_FIXNUM);
+        out_varint(so, ((ScmUInt64)v << 1) ^ (ScmUInt64)(v >> 63));
+        return;
+    }
+    if (SCM_CHARP(obj)) {
+        out_byte(so, TAG_CHAR);
+        out_varint(so, (ScmUInt64)SCM_CHAR_VALUE(obj));
+        return;
+    }
+    if (SCM_FLONUMP(obj)) {
+        out_byte(so, TAG_FLONUM);
+        out_double(so, SCM_FLONUM_VALUE(obj));
+        return;
+    }
+    if (SCM_BIGNUMP(obj)) {
+        out_byte(so, TAG_BIGNUM);
+        out_bignum(so, SCM_BIGNUM(obj));
+        return;
+    }
+    if (SCM_RATNUMP(obj)) {
+        out_byte(so, TAG_RATNUM);
+        write_object(so, SCM_RATNUM_NUMER(obj));
+        write_object(so, SCM_RATNUM_DENOM(obj));
+        return;
+    }
+    if (SCM_COMPNUMP(obj)) {
+        out_byte(so, TAG_COMPNUM);
+        out_double(so, SCM_COMPNUM_REAL(obj));
+        out_double(so, SCM_COMPNUM_IMAG(obj));
+        return;
+    }
+    if (SCM_KEYWORDP(obj)) {
+        out_byte(so, TAG_KEYWORD);
+        out_string_body(so, SCM_KEYWORD_NAME(obj), TRUE);
+        return;
+    }
+    if (SCM_SYMBOLP(obj) && SCM_SYMBOL_INTERNED(obj)) {
+        out_byte(so, TAG_SYMBOL);
+        out_string_body(so, SCM_SYMBOL_NAME(obj), TRUE);
+        return;
+    }
+
+    if (write_ref(so, obj)) return;
+
+    if (SCM_PAIRP(obj)) {
+        write_list(so, obj);
+    } else if (SCM_STRINGP(obj)) {
+        if (SCM_STRING_INCOMPLETE_P(obj)) {
+            out_byte(so, TAG_ISTRING);
+            out_string_body(so, SCM_STRING(obj), FALSE);
+        } else {
+            out_byte(so, TAG_STRING);
+            out_string_body(so, SCM_STRING(obj), TRUE);
+        }
+    } else if (SCM_SYMBOLP(obj)) {
+        out_byte(so, TAG_USYMBOL);
+        out_string_body(so, SCM_SYMBOL_NAME(obj), TRUE);
+    } else if (SCM_VECTORP(obj)) {
+        ScmSmallInt n = SCM_VECTOR_SIZE(obj);
+        out_byte(so, TAG_VECTOR);
+        out_varint(so, n);
+        for (ScmSmallInt i=0; i<n; i++) {
+            write_object(so, SCM_VECTOR_ELEMENT(obj, i));
+        }
+    } else if (SCM_UVECTORP(obj)
+               && Scm_UVectorType(Scm_ClassOf(obj)) != SCM_UVECTOR_INVALID) {
+        write_uvector(so, SCM_UVECTOR(obj));
+    } else if (SCM_HASH_TABLE_P(obj)) {
+        write_hashtable(so, SCM_HASH_TABLE(obj));
+    } else {
+        ScmClass *k = Scm_ClassOf(obj);
+        if (SCM_CLASS_CATEGORY(k) != SCM_CLASS_SCHEME) {
+            Scm_Error("can't serialize object: %S", obj);
+        }
+        write_instance(so, obj, k);
+    }
+}
+
+static void write_serialized(ScmObj obj, serial_out *so)
+{
+    if (so->shared) {
+        Scm_HashCoreInitSimple(&so->refs, SCM_HASH_EQ, 0, NULL);
+        scan_object(so, obj);
+    }
+    out_byte(so, SERIAL_MAGIC0);
+    out_byte(so, SERIAL_MAGIC1);
+    out_byte(so, SERIAL_MAGIC2);
+    out_byte(so, SERIAL_VERSION);
+    out_byte(so, so->shared ? SERIAL_SHARED : 0);
+    write_object(so, obj);
+    out_flush(so);
+}
+
+void Scm_WriteSerialized(ScmObj obj, ScmPort *port, int shared)
+{
+    ScmVM *vm = Scm_VM();
+    if (SCM_PORT_DIR(port) != SCM_PORT_OUTPUT) {
+        Scm_Error("output port required: %S", port);
+    }
+    serial_out *so = SCM_NEW(serial_out);
+    so->port = port;
+    so->shared = shared;
+    so->nextid = 0;
+    so->pos = 0;
+
+    if (PORT_LOCKED(port, vm)) {
+        write_serialized(obj, so);
+    } else {
+        PORT_LOCK(port, vm);
+        PORT_SAFE_CALL(port, write_serialized(obj, so), /*no cleanup*/);
+        PORT_UNLOCK(port);
+    }
+}
+
+/*==================================================================
+ * Reader
+ */
+
+typedef struct serial_in_rec {
+    ScmPort *port;
+    ScmObj *defs;               /* objects defined by TAG_DEF */
+    ScmSmallInt ndefs;
+    ScmSmallInt defsize;
+} serial_in;
+
+static void in_eof(serial_in *si)
+{
+    Scm_Error("unexpected EOF in serialized data from %S", si->port);
+}
+
+static void in_corrupted(serial_in *si, const char *what)
+{
+    Scm_Error("corrupted serialized data (%s) from %S", what, si->port);
+}
+
+static inline int in_byte(serial_in *si)
+{
+    int b = Scm_GetbUnsafe(si->port);
+    if (b == EOF) in_eof(si);
+    return b;
+}
+
+static void in_bytes(serial_in *si, void *data, ScmSmallInt size)
+{
+    char *p = (char*)data;
+    while (size > 0) {
+        int chunk = (size > SERIAL_BUFSIZ) ? SERIAL_BUFSIZ : (int)size;
+        int r = Scm_GetzUnsafe(p, chunk, si->port);
+        if (r <= 0) in_eof(si);
+        p += r;
+        size -= r;
+    }
+}
+
+static ScmUInt64 in_varint(serial_in *si)
+{
+    ScmUInt64 v = 0;
+    int shift = 0;
+    for (;;) {
+        int b = in_byte(si);
+        if (shift >= 64) in_corrupted(si, "varint");
+        v |= (ScmUInt64)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return v;
+        shift += 7;
+    }
+}
+
+static ScmSmallInt in_size(serial_in *si)
+{
+    ScmUInt64 v = in_varint(si);
+    if (v > (ScmUInt64)SCM_SMALL_INT_MAX) in_corrupted(si, "size");
+    return (ScmSmallInt)v;
+}
+
+static double in_double(serial_in *si)
+{
+    union { double d; ScmUInt64 u; } v;
+    v.u = 0;
+    for (int i=0; i<8; i++) {
+        v.u |= (ScmUInt64)in_byte(si) << (i*8);
+    }
+    return v.d;
+}
+
+static ScmObj in_string(serial_in *si, int withlen, int flags)
+{
+    ScmSmallInt size = in_size(si);
+    ScmSmallInt len = withlen ? in_size(si) : size;
+    char *b = SCM_NEW_ATOMIC2(char*, size+1);
+    in_bytes(si, b, size);
+    b[size] = '\0';
+    return Scm_MakeString(b, size, len, flags);
+}
+
+static ScmObj in_bignum(serial_in *si)
+{
+    int neg = in_byte(si);
+    ScmSmallInt nbytes = in_size(si);
+    ScmSmallInt nwords = (nbytes + SIZEOF_LONG - 1) / SIZEOF_LONG;
+    if (nwords == 0) return SCM_MAKE_INT(0);
+    u_long *values = SCM_NEW_ATOMIC_ARRAY(u_long, nwords);
+    memset(values, 0, nwords * sizeof(u_long));
+    for (ScmSmallInt i=0; i<nbytes; i++) {
+        values[i/SIZEOF_LONG] |= (u_long)in_byte(si) << ((i%SIZEOF_LONG)*8);
+    }
+    ScmObj b = Scm_MakeBignumFromUIArray(neg ? -1 : 1, values, (int)nwords);
+    return Scm_NormalizeBignum(SCM_BIGNUM(b));
+}
+
+static ScmClass *uvector_classes[] = {
+    SCM_CLASS_S8VECTOR,  SCM_CLASS_U8VECTOR,
+    SCM_CLASS_S16VECTOR, SCM_CLASS_U16VECTOR,
+    SCM_CLASS_S32VECTOR, SCM_CLASS_U32VECTOR,
+    SCM_CLASS_S64VECTOR, SCM_CLASS_U64VECTOR,
+    SCM_CLASS_F16VECTOR, SCM_CLASS_F32VECTOR, SCM_CLASS_F64VECTOR,
+};
+
+static ScmSmallInt add_def(serial_in *si, ScmObj obj)
+{
+    if (si->ndefs >= si->defsize) {
+        ScmSmallInt newsize = si->defsize ? si->defsize*2 : 32;
+        ScmObj *newdefs = SCM_NEW_ARRAY(ScmObj, newsize);
+        if (si->ndefs > 0) {
+            memcpy(newdefs, si->defs, si->ndefs * sizeof(ScmObj));
+        }
+        si->defs = newdefs;
+        si->defsize = newsize;
+    }
+    si->defs[si->ndefs] = obj;
+    return si->ndefs++;
+}
+
+/* DEF is the index in si->defs to register the object to, or -1.
+   Containers register themselves as soon as they're allocated. */
+#define REGISTER(obj) \
+    do { if (def >= 0) si->defs[def] = (obj); } while (0)
+
+static ScmObj read_object(serial_in *si, ScmSmallInt def);
+
+static ScmObj read_list(serial_in *si, ScmSmallInt def)
+{
+    ScmSmallInt n = in_size(si);
+    if (n == 0) in_corrupted(si, "list");
+    ScmObj head = Scm_Cons(SCM_UNDEFINED, SCM_NIL);
+    REGISTER(head);
+    ScmObj last = head;
+    for (ScmSmallInt i=1; i<n; i++) {
+        ScmObj p = Scm_Cons(SCM_UNDEFINED, SCM_NIL);
+        SCM_SET_CDR(last, p);
+        last = p;
+    }
+    for (ScmObj cp = head; SCM_PAIRP(cp); cp = SCM_CDR(cp)) {
+        SCM_SET_CAR(cp, read_object(si, -1));
+    }
+    SCM_SET_CDR(last, read_object(si, -1));
+    return head;
+}
+
+static ScmObj read_uvector(serial_in *si, ScmSmallInt def)
+{
+    int type = in_byte(si);
+    if (type < 0 || type >= (int)(sizeof(uvector_classes)/sizeof(ScmClass*))) {
+        in_corrupted(si, "uvector type");
+    }
+    ScmClass *k = uvector_classes[type];
+    int eltsize = Scm_UVectorElementSize(k);
+    ScmSmallInt n = in_size(si);
+    ScmObj v = Scm_MakeUVector(k, n, NULL);
+    REGISTER(v);
+    in_bytes(si, SCM_UVECTOR_ELEMENTS(v), n*eltsize);
+#ifdef WORDS_BIGENDIAN
+    if (eltsize > 1) {
+        unsigned char *p = (unsigned char*)SCM_UVECTOR_ELEMENTS(v);
+        for (ScmSmallInt i=0; i<n; i++, p+=eltsize) {
+            for (int j=0; j<eltsize/2; j++) {
+                unsigned char t = p[j];
+                p[j] = p[eltsize-1-j];
+                p[eltsize-1-j] = t;
+            }
+        }
+    }
+#endif
+    return v;
+}
+
+static ScmObj read_hashtable(serial_in *si, ScmSmallInt def)
+{
+    int type = in_byte(si);
+    if (type != SCM_HASH_EQ && type != SCM_HASH_EQV
+        && type != SCM_HASH_EQUAL && type != SCM_HASH_STRING) {
+        in_corrupted(si, "hash table type");
+    }
+    ScmSmallInt n = in_size(si);
+    ScmObj h = Scm_MakeHashTableSimple((ScmHashType)type, (int)n);
+    REGISTER(h);
+    for (ScmSmallInt i=0; i<n; i++) {
+        ScmObj key = read_object(si, -1);
+        ScmObj val = read_object(si, -1);
+        Scm_HashTableSet(SCM_HASH_TABLE(h), key, val, 0);
+    }
+    return h;
+}
+
+static ScmObj read_instance(serial_in *si, ScmSmallInt def)
+{
+    ScmObj name = read_object(si, -1);
+    ScmObj modname = read_object(si, -1);
+    if (!SCM_SYMBOLP(name)) in_corrupted(si, "class name");
+
+    ScmModule *mod = NULL;
+    if (SCM_SYMBOLP(modname)) {
+        mod = Scm_FindModule(SCM_SYMBOL(modname), SCM_FIND_MODULE_QUIET);
+    }
+    if (mod == NULL) mod = SCM_CURRENT_MODULE();
+    ScmObj k = Scm_GlobalVariableRef(mod, SCM_SYMBOL(name), 0);
+    if (!SCM_CLASSP(k)) {
+        Scm_Error("class %S in module %S is not defined, "
+                  "which is needed to read serialized instance",
+                  name, modname);
+    }
+    ScmClass *klass = SCM_CLASS(k);
+    ScmSmallInt n = in_size(si);
+    if (SCM_CLASS_CATEGORY(klass) != SCM_CLASS_SCHEME
+        || klass->numInstanceSlots != n) {
+        Scm_Error("class %S doesn't match the serialized instance "
+                  "(%ld slots)", klass, n);
+    }
+    ScmObj obj = klass->allocate(klass, SCM_NIL);
+    REGISTER(obj);
+    for (ScmSmallInt i=0; i<n; i++) {
+        ScmObj v = read_object(si, -1);
+        Scm_InstanceSlotSet(obj, i, v);
+    }
+    return obj;
+}
+
+static ScmObj read_object(serial_in *si, ScmSmallInt def)
+{
+    int tag = in_byte(si);
+    switch (tag) {
+    case TAG_NIL:       return SCM_NIL;
+    case TAG_TRUE:      return SCM_TRUE;
+    case TAG_FALSE:     return SCM_FALSE;
+    case TAG_EOF:       return SCM_EOF;
+    case TAG_UNDEFINED: return SCM_UNDEFINED;
+    case TAG_UNBOUND:   return SCM_UNBOUND;
+    case TAG_FIXNUM: {
+        ScmUInt64 u = in_varint(si);
+        return Scm_MakeInteger64((ScmInt64)(u >> 1) ^ -(ScmInt64)(u & 1));
+    }
+    case TAG_BIGNUM:    return in_bignum(si);
+    case TAG_RATNUM: {
+        ScmObj numer = read_object(si, -1);
+        ScmObj denom = read_object(si, -1);
+        if (!SCM_INTEGERP(numer) || !SCM_INTEGERP(denom)) {
+            in_corrupted(si, "ratnum");
+        }
+        return Scm_MakeRational(numer, denom);
+    }
+    case TAG_FLONUM:    return Scm_MakeFlonum(in_double(si));
+    case TAG_COMPNUM: {
+        double re = in_double(si);
+        double im = in_double(si);
+        return Scm_MakeComplex(re, im);
+    }
+    case TAG_CHAR: {
+        ScmUInt64 c = in_varint(si);
+        if (c > SCM_CHAR_MAX) in_corrupted(si, "char");
+        return SCM_MAKE_CHAR((ScmChar)c);
+    }
+    case TAG_STRING: {
+        ScmObj s = in_string(si, TRUE, 0);
+        REGISTER(s);
+        return s;
+    }
+    case TAG_ISTRING: {
+        ScmObj s = in_string(si, FALSE, SCM_STRING_INCOMPLETE);
+        REGISTER(s);
+        return s;
+    }
+    case TAG_SYMBOL:
+        return Scm_Intern(SCM_STRING(in_string(si, TRUE, SCM_STRING_IMMUTABLE)));
+    case TAG_USYMBOL: {
+        ScmObj s = Scm_MakeSymbol(SCM_STRING(in_string(si, TRUE, SCM_STRING_IMMUTABLE)),
+                                  FALSE);
+        REGISTER(s);
+        return s;
+    }
+    case TAG_KEYWORD:
+        return Scm_MakeKeyword(SCM_STRING(in_string(si, TRUE, SCM_STRING_IMMUTABLE)));
+    case TAG_LIST:      return read_list(si, def);
+    case TAG_VECTOR: {
+        ScmSmallInt n = in_size(si);
+        ScmObj v = Scm_MakeVector(n, SCM_UNDEFINED);
+        REGISTER(v);
+        for (ScmSmallInt i=0; i<n; i++) {
+            SCM_VECTOR_ELEMENT(v, i) = read_object(si, -1);
+        }
+        return v;
+    }
+    case TAG_UVECTOR:   return read_uvector(si, def);
+    case TAG_HASHTABLE: return read_hashtable(si, def);
+    case TAG_INSTANCE:  return read_instance(si, def);
+    case TAG_DEF: {
+        if (def >= 0) in_corrupted(si, "nested def");
+        ScmSmallInt id = add_def(si, SCM_UNBOUND);
+        ScmObj obj = read_object(si, id);
+        si->defs[id] = obj;
+        return obj;
+    }
+    case TAG_REF: {
+        ScmUInt64 id = in_varint(si);
+        if (id >= (ScmUInt64)si->ndefs || SCM_UNBOUNDP(si->defs[id])) {
+            in_corrupted(si, "reference");
+        }
+        return si->defs[id];
+    }
+    default:
+        in_corrupted(si, "unknown tag");
+    }
+    return SCM_UNDEFINED;       /* dummy */
+}
+
+static ScmObj read_serialized(serial_in *si)
+{
+    int b = Scm_GetbUnsafe(si->port);
+    if (b == EOF) return SCM_EOF;
+    if (b != SERIAL_MAGIC0
+        || in_byte(si) != SERIAL_MAGIC1
+        || in_byte(si) != SERIAL_MAGIC2) {
+        in_corrupted(si, "bad magic");
+    }
+    int version = in_byte(si);
+    if (version != SERIAL_VERSION) {
+        Scm_Error("unsupported serialized data version %d from %S",
+                  version, si->port);
+    }
+    (void)in_byte(si);          /* flags; the reader doesn't need them */
+    return read_object(si, -1);
+}
+
+ScmObj Scm_ReadSerialized(ScmPort *port)
+{
+    ScmVM *vm = Scm_VM();
+    volatile ScmObj r = SCM_UNDEFINED;
+    if (SCM_PORT_DIR(port) != SCM_PORT_INPUT) {
+        Scm_Error("input port required: %S", port);
+    }
+    serial_in si;
+    si.port = port;
+    si.defs = NULL;
+    si.ndefs = si.defsize = 0;
+
+    if (PORT_LOCKED(port, vm)) {
+        r = read_serialized(&si);
+    } else {
+        PORT_LOCK(port, vm);
+        PORT_SAFE_CALL(port, r = read_serialized(&si), /*no cleanup*/);
+        PORT_UNLOCK(port);
+    }
+    return r;
+}
 
 
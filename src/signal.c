@@ -36,6 +36,15 @@
 #include "gauche/vm.h"
 #include "gauche/class.h"
 
+#if !defined(GAUCHE_WINDOWS)
+#include <fcntl.h>
+#include <unistd.h>
+# if defined(HAVE_SYS_SIGNALFD_H) && defined(HAVE_SIGNALFD)
+#include <sys/signalfd.h>
+#define USE_SIGNALFD 1
+# endif
+#endif
+
 /* Signals
  *
  *  C-application that embeds Gauche can specify a set of signals
@@ -999,6 +1008,202 @@ int Scm_SigWait(ScmSysSigset *mask)
 }
 
 
+/*================================================================
+ * Signal fd
+ *
+ *   Delivers the signals as readable data of a file descriptor instead
+ *   of calling Scheme handlers, so that an event loop can wait for them
+ *   together with other fds.  On Linux we use signalfd(2); the signals
+ *   are blocked in the calling thread, and stay pending until read.
+ *   Elsewhere we use a self-pipe; the C-level handler writes the signal
+ *   number to the pipe.
+ */
+#if !defined(GAUCHE_WINDOWS)
+
+static struct sigFdRec {
+    int fd;                     /* the fd for reading; -1 if unused */
+    int wfd;                    /* self-pipe write end; -1 for signalfd */
+    sigset_t set;
+} sigFds[SCM_NSIG];
+
+/* Self-pipe write end for each signal.  Read by the signal handler. */
+static volatile int sigPipeFds[SCM_NSIG];
+
+static void sig_pipe_handle(int signum)
+{
+    int e = errno;
+    int fd = sigPipeFds[signum];
+    if (fd >= 0) {
+        unsigned char c = (unsigned char)signum;
+        /* If the pipe is full, the reader has enough to wake up. */
+        ssize_t r = write(fd, &c, 1);
+        (void)r;
+    }
+    errno = e;
+}
+
+static struct sigFdRec *find_sigfd(int fd)
+{
+    for (int i=0; i<SCM_NSIG; i++) {
+        if (sigFds[i].fd == fd) return &sigFds[i];
+    }
+    return NULL;
+}
+
+static void set_fd_flags(int fd)
+{
+    (void)fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+}
+
+#endif /*!GAUCHE_WINDOWS*/
+
+/* Returns a nonblocking fd from which the signals in MASK can be read
+   by Scm_ReadSignalFd.  A signal can belong to only one signal fd. */
+int Scm_MakeSignalFd(ScmSysSigset *mask)
+{
+#if !defined(GAUCHE_WINDOWS)
+    sigset_t set;
+    struct sigFdRec *rec = NULL;
+    int busy = -1, fd = -1, wfd = -1;
+
+    sigemptyset(&set);
+    for (struct sigdesc *desc=sigDesc; desc->name; desc++) {
+        if (sigismember(&mask->set, desc->num)
+            && sigismember(&sigHandlers.masterSigset, desc->num)) {
+            sigaddset(&set, desc->num);
+        }
+    }
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(sigHandlers.mutex);
+    for (int i=1; i<SCM_NSIG && busy < 0; i++) {
+        if (!sigismember(&set, i)) continue;
+        for (int j=0; j<SCM_NSIG; j++) {
+            if (sigFds[j].fd >= 0 && sigismember(&sigFds[j].set, i)) {
+                busy = i;
+                break;
+            }
+        }
+    }
+    if (busy < 0) {
+        for (int i=0; i<SCM_NSIG; i++) {
+            if (sigFds[i].fd < 0) { rec = &sigFds[i]; break; }
+        }
+#if defined(USE_SIGNALFD)
+        SIGPROCMASK(SIG_BLOCK, &set, NULL);
+        fd = signalfd(-1, &set, SFD_NONBLOCK|SFD_CLOEXEC);
+        if (fd < 0) SIGPROCMASK(SIG_UNBLOCK, &set, NULL);
+#else  /*!USE_SIGNALFD*/
+        int fds[2];
+        if (pipe(fds) == 0) {
+            fd = fds[0];
+            wfd = fds[1];
+            set_fd_flags(fd);
+            set_fd_flags(wfd);
+            struct sigaction act;
+            act.sa_handler = sig_pipe_handle;
+            sigfillset(&act.sa_mask);
+            act.sa_flags = SA_RESTART;
+            for (int i=1; i<SCM_NSIG; i++) {
+                if (!sigismember(&set, i)) continue;
+                sigPipeFds[i] = wfd;
+                (void)sigaction(i, &act, NULL);
+            }
+        }
+#endif /*!USE_SIGNALFD*/
+        if (fd >= 0) {
+            rec->fd = fd;
+            rec->wfd = wfd;
+            rec->set = set;
+        }
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(sigHandlers.mutex);
+    if (busy > 0) Scm_Error("signal %d is already delivered to a signal fd",
+                            busy);
+    if (fd < 0) Scm_SysError("couldn't create a signal fd");
+    return fd;
+#else  /*GAUCHE_WINDOWS*/
+    Scm_Error("signal fd isn't supported on this platform");
+    return -1;
+#endif /*GAUCHE_WINDOWS*/
+}
+
+/* Reads the pending signals from signal fd FD without blocking, and
+   returns a list of signal numbers in the order of arrival.  The same
+   signal may appear more than once.  Returns () if nothing is pending. */
+ScmObj Scm_ReadSignalFd(int fd)
+{
+#if !defined(GAUCHE_WINDOWS)
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    struct sigFdRec *rec = find_sigfd(fd);
+    if (rec == NULL) Scm_Error("not a signal fd: %d", fd);
+    for (;;) {
+        ssize_t r;
+#if defined(USE_SIGNALFD)
+        struct signalfd_siginfo si[16];
+        SCM_SYSCALL(r, read(fd, si, sizeof(si)));
+#else
+        unsigned char si[64];
+        SCM_SYSCALL(r, read(fd, si, sizeof(si)));
+#endif
+        if (r < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            Scm_SysError("reading signal fd %d failed", fd);
+        }
+        if (r == 0) break;
+        for (size_t i=0; i < (size_t)r/sizeof(si[0]); i++) {
+#if defined(USE_SIGNALFD)
+            SCM_APPEND1(h, t, SCM_MAKE_INT(si[i].ssi_signo));
+#else
+            SCM_APPEND1(h, t, SCM_MAKE_INT(si[i]));
+#endif
+        }
+        if ((size_t)r < sizeof(si)) break;
+    }
+    return h;
+#else  /*GAUCHE_WINDOWS*/
+    Scm_Error("signal fd isn't supported on this platform");
+    return SCM_UNDEFINED;
+#endif /*GAUCHE_WINDOWS*/
+}
+
+/* Closes signal fd FD, and gives its signals back to the ordinary
+   signal handling. */
+void Scm_CloseSignalFd(int fd)
+{
+#if !defined(GAUCHE_WINDOWS)
+    (void)SCM_INTERNAL_MUTEX_LOCK(sigHandlers.mutex);
+    struct sigFdRec *rec = find_sigfd(fd);
+    if (rec == NULL) {
+        (void)SCM_INTERNAL_MUTEX_UNLOCK(sigHandlers.mutex);
+        Scm_Error("not a signal fd: %d", fd);
+    }
+#if defined(USE_SIGNALFD)
+    SIGPROCMASK(SIG_UNBLOCK, &rec->set, NULL);
+#else  /*!USE_SIGNALFD*/
+    for (int i=1; i<SCM_NSIG; i++) {
+        if (!sigismember(&rec->set, i)) continue;
+        struct sigaction act;
+        ScmObj h = sigHandlers.handlers[i];
+        if (SCM_PROCEDUREP(h))  act.sa_handler = sig_handle;
+        else if (SCM_FALSEP(h)) act.sa_handler = SIG_IGN;
+        else                    act.sa_handler = SIG_DFL;
+        sigfillset(&act.sa_mask);
+        act.sa_flags = 0;
+        (void)sigaction(i, &act, NULL);
+        sigPipeFds[i] = -1;
+    }
+    close(rec->wfd);
+#endif /*!USE_SIGNALFD*/
+    close(rec->fd);
+    rec->fd = rec->wfd = -1;
+    sigemptyset(&rec->set);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(sigHandlers.mutex);
+#else  /*GAUCHE_WINDOWS*/
+    Scm_Error("signal fd isn't supported on this platform");
+#endif /*GAUCHE_WINDOWS*/
+}
+
 /*================================================================
  * Initialize
  */
@@ -1011,6 +1216,13 @@ void Scm__InitSignal(void)
     (void)SCM_INTERNAL_MUTEX_INIT(sigHandlers.mutex);
     sigemptyset(&sigHandlers.masterSigset);
     for (int i=0; i<SCM_NSIG; i++) sigHandlers.handlers[i] = SCM_UNDEFINED;
+#if !defined(GAUCHE_WINDOWS)
+    for (int i=0; i<SCM_NSIG; i++) {
+        sigFds[i].fd = sigFds[i].wfd = -1;
+        sigemptyset(&sigFds[i].set);
+        sigPipeFds[i] = -1;
+    }
+#endif
 
     Scm_InitStaticClass(&Scm_SysSigsetClass, "<sys-sigset>",
                         mod, NULL, 0);
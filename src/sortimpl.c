@@ -0,0 +1,449 @@
+/*
+ * sortimpl.c - sort algorithms
+ *
+ *   Copyright (c) 2026  Shiro Kawai  <shiro@acm.org>
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *
+ *   3. Neither the name of the authors nor the names of its contributors
+ *      may be used to endorse or promote products derived from this
+ *      software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+ *   TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+ *   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ *   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ *   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ *   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* This file is included by compare.c several times, once for each
+ * way to compare elements, so that the comparison is inlined into the
+ * sort loops.  The includer defines the following macros:
+ *
+ *   SORT_SUFFIX      - suffix of the names of the defined functions.
+ *   SORT_LT(x, y)    - true iff x strictly precedes y.  It can refer
+ *                      to the variable 'data', the opaque pointer passed
+ *                      to the entry functions.
+ *   SORT_MAY_RAISE   - defined if SORT_LT may raise an error.  Merging
+ *                      then restores the elements kept in the temporary
+ *                      buffer, so that the array is still a permutation
+ *                      of the original when an error escapes.
+ *
+ * The entry points are pdqsort_SUFFIX (unstable) and timsort_SUFFIX
+ * (stable).  Neither assumes SORT_LT is a consistent order; an
+ * inconsistent one yields an unspecified order but never runs off the
+ * array.
+ */
+
+#define SORT_FN(name)  SORT_CAT(name, SORT_SUFFIX)
+
+/*=================================================================
+ * Heapsort - the fallback of pdqsort
+ */
+
+static void SORT_FN(sift_down)(ScmObj *a, ScmSmallInt root, ScmSmallInt n,
+                               void *data)
+{
+    for (;;) {
+        ScmSmallInt child = root*2 + 1;
+        if (child >= n) break;
+        if (child+1 < n && SORT_LT(a[child], a[child+1])) child++;
+        if (!SORT_LT(a[root], a[child])) break;
+        SORT_SWAP(a, root, child);
+        root = child;
+    }
+}
+
+static void SORT_FN(heapsort)(ScmObj *a, ScmSmallInt n, void *data)
+{
+    for (ScmSmallInt i = n/2 - 1; i >= 0; i--) {
+        SORT_FN(sift_down)(a, i, n, data);
+    }
+    for (ScmSmallInt i = n-1; i > 0; i--) {
+        SORT_SWAP(a, 0, i);
+        SORT_FN(sift_down)(a, 0, i, data);
+    }
+}
+
+/*=================================================================
+ * Pattern-defeating quicksort
+ *
+ *  Orson Peters, "Pattern-defeating Quicksort", arXiv:2106.05123.
+ *  Elements are only ever swapped, so an error raised by SORT_LT
+ *  leaves a permutation of the original.
+ */
+
+static void SORT_FN(insertion_sort)(ScmObj *a, ScmSmallInt lo, ScmSmallInt hi,
+                                    void *data)
+{
+    for (ScmSmallInt i = lo+1; i < hi; i++) {
+        for (ScmSmallInt j = i; j > lo && SORT_LT(a[j], a[j-1]); j--) {
+            SORT_SWAP(a, j, j-1);
+        }
+    }
+}
+
+/* Like insertion_sort, but gives up after moving a few elements.
+   Returns TRUE if [lo, hi) is sorted. */
+static int SORT_FN(partial_insertion_sort)(ScmObj *a,
+                                           ScmSmallInt lo, ScmSmallInt hi,
+                                           void *data)
+{
+    ScmSmallInt moved = 0;
+    for (ScmSmallInt i = lo+1; i < hi; i++) {
+        if (moved > PDQ_PARTIAL_INSERTION_LIMIT) return FALSE;
+        ScmSmallInt j = i;
+        for (; j > lo && SORT_LT(a[j], a[j-1]); j--) {
+            SORT_SWAP(a, j, j-1);
+        }
+        moved += i - j;
+    }
+    return TRUE;
+}
+
+static inline void SORT_FN(sort2)(ScmObj *a, ScmSmallInt i, ScmSmallInt j,
+                                  void *data)
+{
+    if (SORT_LT(a[j], a[i])) SORT_SWAP(a, i, j);
+}
+
+static inline void SORT_FN(sort3)(ScmObj *a, ScmSmallInt i, ScmSmallInt j,
+                                  ScmSmallInt k, void *data)
+{
+    SORT_FN(sort2)(a, i, j, data);
+    SORT_FN(sort2)(a, j, k, data);
+    SORT_FN(sort2)(a, i, j, data);
+}
+
+/* Partitions [lo, hi) around the pivot a[lo].  Elements less than the
+   pivot go left, the others right.  Returns the final position of
+   the pivot, and sets *no_swap if the range was already partitioned. */
+static ScmSmallInt SORT_FN(partition_right)(ScmObj *a,
+                                            ScmSmallInt lo, ScmSmallInt hi,
+                                            int *no_swap, void *data)
+{
+    ScmObj pivot = a[lo];
+    ScmSmallInt i = lo+1, j = hi-1;
+    while (i <= j && SORT_LT(a[i], pivot)) i++;
+    while (i <= j && !SORT_LT(a[j], pivot)) j--;
+    *no_swap = (i > j);
+    while (i < j) {
+        SORT_SWAP(a, i, j);
+        i++; j--;
+        while (i <= j && SORT_LT(a[i], pivot)) i++;
+        while (i <= j && !SORT_LT(a[j], pivot)) j--;
+    }
+    SORT_SWAP(a, lo, i-1);
+    return i-1;
+}
+
+/* The other way around; elements equal to the pivot go left.  Used when
+   the pivot equals the element just before the range, in which case
+   the left part consists of elements equal to the pivot and is done. */
+static ScmSmallInt SORT_FN(partition_left)(ScmObj *a,
+                                           ScmSmallInt lo, ScmSmallInt hi,
+                                           void *data)
+{
+    ScmObj pivot = a[lo];
+    ScmSmallInt i = lo+1, j = hi-1;
+    while (i <= j && !SORT_LT(pivot, a[i])) i++;
+    while (i <= j && SORT_LT(pivot, a[j])) j--;
+    while (i < j) {
+        SORT_SWAP(a, i, j);
+        i++; j--;
+        while (i <= j && !SORT_LT(pivot, a[i])) i++;
+        while (i <= j && SORT_LT(pivot, a[j])) j--;
+    }
+    SORT_SWAP(a, lo, i-1);
+    return i-1;
+}
+
+static void SORT_FN(pdqsort_loop)(ScmObj *a, ScmSmallInt lo, ScmSmallInt hi,
+                                  int bad_allowed, int leftmost, void *data)
+{
+    for (;;) {
+        ScmSmallInt size = hi - lo;
+        if (size < PDQ_INSERTION_THRESHOLD) {
+            SORT_FN(insertion_sort)(a, lo, hi, data);
+            return;
+        }
+
+        /* Choose the pivot and move it to a[lo]. */
+        ScmSmallInt s2 = size/2;
+        if (size > PDQ_NINTHER_THRESHOLD) {
+            SORT_FN(sort3)(a, lo,      lo+s2,   hi-1, data);
+            SORT_FN(sort3)(a, lo+1,    lo+s2-1, hi-2, data);
+            SORT_FN(sort3)(a, lo+2,    lo+s2+1, hi-3, data);
+            SORT_FN(sort3)(a, lo+s2-1, lo+s2,   lo+s2+1, data);
+            SORT_SWAP(a, lo, lo+s2);
+        } else {
+            SORT_FN(sort3)(a, lo+s2, lo, hi-1, data);
+        }
+
+        /* Lots of equal elements; skip them at once. */
+        if (!leftmost && !SORT_LT(a[lo-1], a[lo])) {
+            lo = SORT_FN(partition_left)(a, lo, hi, data) + 1;
+            continue;
+        }
+
+        int no_swap;
+        ScmSmallInt p = SORT_FN(partition_right)(a, lo, hi, &no_swap, data);
+        ScmSmallInt lsize = p - lo, rsize = hi - (p+1);
+
+        if (lsize < size/8 || rsize < size/8) {
+            /* Bad partition.  Shuffle some elements to break patterns,
+               or give up to heapsort if it happens too often. */
+            if (--bad_allowed == 0) {
+                SORT_FN(heapsort)(a+lo, size, data);
+                return;
+            }
+            if (lsize >= PDQ_INSERTION_THRESHOLD) {
+                SORT_SWAP(a, lo, lo + lsize/4);
+                SORT_SWAP(a, p-1, p - lsize/4);
+                if (lsize > PDQ_NINTHER_THRESHOLD) {
+                    SORT_SWAP(a, lo+1, lo + lsize/4 + 1);
+                    SORT_SWAP(a, lo+2, lo + lsize/4 + 2);
+                    SORT_SWAP(a, p-2, p - lsize/4 - 1);
+                    SORT_SWAP(a, p-3, p - lsize/4 - 2);
+                }
+            }
+            if (rsize >= PDQ_INSERTION_THRESHOLD) {
+                SORT_SWAP(a, p+1, p+1 + rsize/4);
+                SORT_SWAP(a, hi-1, hi - rsize/4);
+                if (rsize > PDQ_NINTHER_THRESHOLD) {
+                    SORT_SWAP(a, p+2, p+2 + rsize/4);
+                    SORT_SWAP(a, p+3, p+3 + rsize/4);
+                    SORT_SWAP(a, hi-2, hi - rsize/4 - 1);
+                    SORT_SWAP(a, hi-3, hi - rsize/4 - 2);
+                }
+            }
+        } else if (no_swap
+                   && SORT_FN(partial_insertion_sort)(a, lo, p, data)
+                   && SORT_FN(partial_insertion_sort)(a, p+1, hi, data)) {
+            /* The input looked sorted, and it was. */
+            return;
+        }
+
+        /* Recurse into the smaller side to bound the stack depth. */
+        if (lsize < rsize) {
+            SORT_FN(pdqsort_loop)(a, lo, p, bad_allowed, leftmost, data);
+            lo = p+1;
+            leftmost = FALSE;
+        } else {
+            SORT_FN(pdqsort_loop)(a, p+1, hi, bad_allowed, FALSE, data);
+            hi = p;
+        }
+    }
+}
+
+static void SORT_FN(pdqsort)(ScmObj *a, ScmSmallInt n, void *data)
+{
+    int bad_allowed = 0;
+    for (ScmSmallInt i = n; i > 0; i >>= 1) bad_allowed++;
+    SORT_FN(pdqsort_loop)(a, 0, n, bad_allowed, TRUE, data);
+}
+
+/*=================================================================
+ * TimSort
+ *
+ *  Tim Peters, "listsort.txt" in the CPython source.  We use the
+ *  corrected merge_collapse (de Gouw et al., 2015).  Instead of the
+ *  galloping mode, each merge first trims by binary search the parts
+ *  of the runs that are already in place; that is where nearly-sorted
+ *  input spends its time.
+ */
+
+/* Sorts [lo, hi) by binary insertion, given [lo, start) is sorted. */
+static void SORT_FN(binsort)(ScmObj *a, ScmSmallInt lo, ScmSmallInt hi,
+                             ScmSmallInt start, void *data)
+{
+    for (ScmSmallInt i = start; i < hi; i++) {
+        ScmObj pivot = a[i];
+        ScmSmallInt l = lo, r = i;
+        while (l < r) {
+            ScmSmallInt m = l + (r-l)/2;
+            if (SORT_LT(pivot, a[m])) r = m;
+            else l = m+1;
+        }
+        memmove(a+l+1, a+l, (i-l)*sizeof(ScmObj));
+        a[l] = pivot;
+    }
+}
+
+/* Returns the length of the run starting at lo.  A strictly descending
+   run is reversed in place. */
+static ScmSmallInt SORT_FN(count_run)(ScmObj *a, ScmSmallInt lo,
+                                      ScmSmallInt hi, void *data)
+{
+    ScmSmallInt r = lo+1;
+    if (r == hi) return 1;
+    if (SORT_LT(a[r], a[lo])) {
+        for (r++; r < hi && SORT_LT(a[r], a[r-1]); r++)
+            ;
+        for (ScmSmallInt i = lo, j = r-1; i < j; i++, j--) SORT_SWAP(a, i, j);
+    } else {
+        for (r++; r < hi && !SORT_LT(a[r], a[r-1]); r++)
+            ;
+    }
+    return r - lo;
+}
+
+/* Number of leading elements of a[0..n) that don't follow key. */
+static ScmSmallInt SORT_FN(search_right)(ScmObj key, ScmObj *a, ScmSmallInt n,
+                                         void *data)
+{
+    ScmSmallInt l = 0, r = n;
+    while (l < r) {
+        ScmSmallInt m = l + (r-l)/2;
+        if (SORT_LT(key, a[m])) r = m;
+        else l = m+1;
+    }
+    return l;
+}
+
+/* Number of leading elements of a[0..n) that precede key. */
+static ScmSmallInt SORT_FN(search_left)(ScmObj key, ScmObj *a, ScmSmallInt n,
+                                        void *data)
+{
+    ScmSmallInt l = 0, r = n;
+    while (l < r) {
+        ScmSmallInt m = l + (r-l)/2;
+        if (SORT_LT(a[m], key)) l = m+1;
+        else r = m;
+    }
+    return l;
+}
+
+/* Merges a[baseA, baseA+lenA) and the following run of lenB, copying
+   the shorter one to the temporary buffer.  The cursors live in ts,
+   for the error handler needs them. */
+static void SORT_FN(merge_loop)(timsort_state *ts, int lo_first,
+                                ScmSmallInt baseA, ScmSmallInt lenA,
+                                ScmSmallInt lenB)
+{
+    ScmObj *a = ts->a, *tmp = ts->tmp;
+    void *data = ts->data;
+    (void)data;                 /* SORT_LT may not use it */
+    if (lo_first) {
+        /* tmp holds A, and we fill from the left */
+        ScmSmallInt endB = baseA + lenA + lenB;
+        while (ts->i < ts->tmpend && ts->j < endB) {
+            if (SORT_LT(a[ts->j], tmp[ts->i])) a[ts->dest++] = a[ts->j++];
+            else                               a[ts->dest++] = tmp[ts->i++];
+        }
+    } else {
+        /* tmp holds B, and we fill from the right */
+        while (ts->i > 0 && ts->j > baseA) {
+            if (SORT_LT(tmp[ts->i-1], a[ts->j-1])) a[--ts->dest] = a[--ts->j];
+            else                                   a[--ts->dest] = tmp[--ts->i];
+        }
+    }
+}
+
+static void SORT_FN(merge_at)(timsort_state *ts, int k)
+{
+    ScmObj *a = ts->a;
+    void *data = ts->data;
+    ScmSmallInt baseA = ts->runs[k].base, lenA = ts->runs[k].len;
+    ScmSmallInt baseB = ts->runs[k+1].base, lenB = ts->runs[k+1].len;
+
+    ts->runs[k].len = lenA + lenB;
+    if (k == ts->nruns - 3) ts->runs[k+1] = ts->runs[k+2];
+    ts->nruns--;
+
+    /* Elements of A not following B[0] are already in place. */
+    ScmSmallInt skip = SORT_FN(search_right)(a[baseB], a+baseA, lenA, data);
+    baseA += skip;
+    lenA -= skip;
+    if (lenA == 0) return;
+    /* So are elements of B not preceding the last of A. */
+    lenB = SORT_FN(search_left)(a[baseA+lenA-1], a+baseB, lenB, data);
+    if (lenB == 0) return;
+
+    int lo_first = (lenA <= lenB);
+    if (lo_first) {
+        memcpy(ts->tmp, a+baseA, lenA*sizeof(ScmObj));
+        ts->i = 0; ts->tmpend = lenA;
+        ts->dest = baseA; ts->j = baseB;
+    } else {
+        memcpy(ts->tmp, a+baseB, lenB*sizeof(ScmObj));
+        ts->i = lenB;
+        ts->dest = baseB + lenB; ts->j = baseB;
+    }
+#ifdef SORT_MAY_RAISE
+    SCM_UNWIND_PROTECT {
+        SORT_FN(merge_loop)(ts, lo_first, baseA, lenA, lenB);
+    } SCM_WHEN_ERROR {
+        timsort_flush(ts, lo_first);
+        SCM_NEXT_HANDLER;
+    } SCM_END_PROTECT;
+#else
+    SORT_FN(merge_loop)(ts, lo_first, baseA, lenA, lenB);
+#endif
+    timsort_flush(ts, lo_first);
+}
+
+static void SORT_FN(timsort)(ScmObj *a, ScmSmallInt n, void *data)
+{
+    if (n < 2) return;
+    if (n < TIMSORT_MIN_MERGE) {
+        ScmSmallInt r = SORT_FN(count_run)(a, 0, n, data);
+        SORT_FN(binsort)(a, 0, n, r, data);
+        return;
+    }
+
+    timsort_state ts;
+    ts.a = a;
+    ts.tmp = SCM_NEW_ARRAY(ScmObj, n/2 + 1);
+    ts.nruns = 0;
+    ts.data = data;
+
+    ScmSmallInt minrun = timsort_minrun(n);
+    for (ScmSmallInt lo = 0; lo < n;) {
+        ScmSmallInt r = SORT_FN(count_run)(a, lo, n, data);
+        if (r < minrun) {
+            ScmSmallInt force = (n - lo < minrun)? n - lo : minrun;
+            SORT_FN(binsort)(a, lo, lo+force, lo+r, data);
+            r = force;
+        }
+        ts.runs[ts.nruns].base = lo;
+        ts.runs[ts.nruns].len = r;
+        ts.nruns++;
+        lo += r;
+
+        /* Keep the invariants of the run lengths on the stack. */
+        while (ts.nruns > 1) {
+            int k = ts.nruns - 2;
+            sort_run *s = ts.runs;
+            if ((k > 0 && s[k-1].len <= s[k].len + s[k+1].len)
+                || (k > 1 && s[k-2].len <= s[k-1].len + s[k].len)) {
+                if (s[k-1].len < s[k+1].len) k--;
+            } else if (s[k].len > s[k+1].len) {
+                break;
+            }
+            SORT_FN(merge_at)(&ts, k);
+        }
+    }
+    while (ts.nruns > 1) {
+        int k = ts.nruns - 2;
+        if (k > 0 && ts.runs[k-1].len < ts.runs[k+1].len) k--;
+        SORT_FN(merge_at)(&ts, k);
+    }
+}
+
+#undef SORT_FN
@@ -72,6 +72,8 @@ static ScmString *make_str(ScmSmallInt len, ScmSmallInt siz,
     s->initialBody.length = len;
     s->initialBody.size = siz;
     s->initialBody.start = p;
+    s->initialBody.hash = 0;
+    s->initialBody.index = NULL;
     return s;
 }
 
@@ -115,25 +117,52 @@ char *Scm_StrdupPartial(const char *src, size_t size)
 
 /* We have multiple similar functions, due to performance reasons. */
 
+/* Most text we read is mostly ASCII, so we skip runs of ASCII bytes
+   a word at a time before falling back to the per-character loop.
+   All supported encodings are ASCII-compatible, so this works for
+   every one of them.  We use memcpy to load a word, for the string
+   may not be aligned; compilers turn it into a single load. */
+#define ASCII_WORD_MSBS  ((uint64_t)0x8080808080808080ULL)
+
+/* Returns the number of leading bytes of str less than 0x80, looking
+   up to size bytes. */
+static inline ScmSmallInt ascii_prefix(const char *str, ScmSmallInt size)
+{
+    const char *p = str, *end = str + size;
+    while (end - p >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        if (w & ASCII_WORD_MSBS) break;
+        p += 8;
+    }
+    while (p < end && (unsigned char)*p < 0x80) p++;
+    return p - str;
+}
+
 /* Calculate both length and size of C-string str.
-   If str is incomplete, *plen gets -1. */
+   If str is incomplete, *plen gets -1.
+   We let strlen find the terminator, which libc does with vector
+   instructions, then count characters within the known size. */
 static inline ScmSmallInt count_size_and_length(const char *str,
                                                 ScmSmallInt *psize, /* out */
                                                 ScmSmallInt *plen)  /* out */
 {
-    char c;
+    ScmSmallInt size = (ScmSmallInt)strlen(str), rest = size, len = 0;
     const char *p = str;
-    ScmSmallInt size = 0, len = 0;
-    while ((c = *p++) != 0) {
-        int i = SCM_CHAR_NFOLLOWS(c);
+
+    while (rest > 0) {
+        ScmSmallInt n = ascii_prefix(p, rest);
+        len += n;
+        p += n;
+        rest -= n;
+        if (rest == 0) break;
+        int i = SCM_CHAR_NFOLLOWS(*p);
+        if (i > rest - 1) { len = -1; break; }
+        if (i < 0) i = 0;
         len++;
-        size++;
-        while (i-- > 0) {
-            if (!*p++) { len = -1; goto eos; }
-            size++;
-        }
+        p += i+1;
+        rest -= i+1;
     }
-  eos:
     *psize = size;
     *plen = len;
     return len;
@@ -143,16 +172,27 @@ static inline ScmSmallInt count_size_and_length(const char *str,
 static inline ScmSmallInt count_length(const char *str, ScmSmallInt size)
 {
     ScmSmallInt count = 0;
-    while (size-- > 0) {
-        unsigned char c = (unsigned char)*str;
-        int i = SCM_CHAR_NFOLLOWS(c);
-        if (i < 0 || i > size) return -1;
-        ScmChar ch;
-        SCM_CHAR_GET(str, ch);
-        if (ch == SCM_CHAR_INVALID) return -1;
-        count++;
-        str += i+1;
-        size -= i;
+    while (size > 0) {
+        ScmSmallInt n = ascii_prefix(str, size);
+        count += n;
+        str += n;
+        size -= n;
+        if (size == 0) break;
+        /* Now str points to a non-ASCII byte.  We consume a run of
+           multibyte characters here, so that text without ASCII
+           doesn't pay for ascii_prefix on every character. */
+        while (size-- > 0) {
+            unsigned char c = (unsigned char)*str;
+            if (c < 0x80) { size++; break; }
+            int i = SCM_CHAR_NFOLLOWS(c);
+            if (i < 0 || i > size) return -1;
+            ScmChar ch;
+            SCM_CHAR_GET(str, ch);
+            if (ch == SCM_CHAR_INVALID) return -1;
+            count++;
+            str += i+1;
+            size -= i;
+        }
     }
     return count;
 }
@@ -170,6 +210,12 @@ int Scm_MBLen(const char *str, const char *stop)
     return (int)len; /* we keep the result int for the backward compatibility */
 }
 
+/* Same as Scm_MBLen, but for the input that may be longer than INT_MAX. */
+ScmSmallInt Scm__MBLength(const char *str, ScmSmallInt size)
+{
+    return count_length(str, size);
+}
+
 /*----------------------------------------------------------------
  * Constructors
  */
@@ -318,7 +364,13 @@ ScmObj Scm_CopyStringWithFlags(ScmString *x, int flags, int mask)
     int newflags = ((SCM_STRING_BODY_FLAGS(b) & ~mask)
                     | (flags & mask));
 
-    return SCM_OBJ(make_str(len, size, start, newflags));
+    ScmString *s = make_str(len, size, start, newflags);
+    /* The content is the same, so are the hash value and the index. */
+    if (b->hash != SCM_STRING_HASH_NOCACHE) {
+        s->initialBody.hash = b->hash;
+        s->initialBody.index = b->index;
+    }
+    return SCM_OBJ(s);
 }
 
 ScmObj Scm_StringCompleteToIncomplete(ScmString *x)
@@ -401,6 +453,14 @@ int Scm_StringEqual(ScmString *x, ScmString *y)
     if (SCM_STRING_BODY_SIZE(xb) != SCM_STRING_BODY_SIZE(yb)) {
         return FALSE;
     }
+    if (xb == yb) return TRUE;
+    /* If both have cached hash values (see hash.c), which are computed
+       with the same salt, differing values mean differing contents. */
+    if (xb->hash != yb->hash
+        && xb->hash != 0 && xb->hash != SCM_STRING_HASH_NOCACHE
+        && yb->hash != 0 && yb->hash != SCM_STRING_HASH_NOCACHE) {
+        return FALSE;
+    }
     return (memcmp(SCM_STRING_BODY_START(xb),
                    SCM_STRING_BODY_START(yb),
                    SCM_STRING_BODY_SIZE(xb)) == 0? TRUE : FALSE);
@@ -501,6 +561,55 @@ static const char *forward_pos(const char *current, ScmSmallInt offset)
     return current;
 }
 
+/* Character index.
+ *
+ * Finding the N-th character of a multibyte string requires scanning
+ * from the beginning, which makes index-based loops quadratic.
+ * For long strings we build an index lazily, which records the byte
+ * offset of every STRING_INDEX_INTERVAL-th character, so that we
+ * never scan more than STRING_INDEX_INTERVAL characters.
+ *
+ * The index is cached in the body.  As with the hash value (see hash.c),
+ * a body is never modified once created, so the index never gets stale,
+ * and we store it without locking; racing threads just build the same
+ * index.  Static bodies may be in read-only memory, so we don't use
+ * the index for them.
+ */
+#define STRING_INDEX_INTERVAL   64
+#define STRING_INDEX_THRESHOLD  (STRING_INDEX_INTERVAL*4)
+
+static const unsigned int *string_index(const ScmStringBody *b)
+{
+    const unsigned int *index = b->index;
+    if (index) return index;
+
+    ScmSmallInt n = SCM_STRING_BODY_LENGTH(b)/STRING_INDEX_INTERVAL + 1;
+    unsigned int *v = SCM_NEW_ATOMIC_ARRAY(unsigned int, n);
+    const char *start = SCM_STRING_BODY_START(b), *p = start;
+    for (ScmSmallInt i=0; i<n; i++) {
+        if (i > 0) p = forward_pos(p, STRING_INDEX_INTERVAL);
+        v[i] = (unsigned int)(p - start);
+    }
+    ((ScmStringBody*)b)->index = v; /* discard const qualifier */
+    return v;
+}
+
+/* Returns the pointer to the OFFSET-th character of a complete string
+   body B.  OFFSET is assumed in [0, length]. */
+static const char *body_char_pos(const ScmStringBody *b, ScmSmallInt offset)
+{
+    const char *start = SCM_STRING_BODY_START(b);
+    if (SCM_STRING_BODY_SINGLE_BYTE_P(b)) return start + offset;
+    if (offset < STRING_INDEX_INTERVAL
+        || SCM_STRING_BODY_LENGTH(b) < STRING_INDEX_THRESHOLD
+        || b->hash == SCM_STRING_HASH_NOCACHE) {
+        return forward_pos(start, offset);
+    }
+    const unsigned int *index = string_index(b);
+    return forward_pos(start + index[offset/STRING_INDEX_INTERVAL],
+                       offset%STRING_INDEX_INTERVAL);
+}
+
 /* string-ref.
  * If POS is out of range,
  *   - returns SCM_CHAR_INVALID if range_error is FALSE
@@ -529,7 +638,7 @@ ScmChar Scm_StringRef(ScmString *str, ScmSmallInt pos, int range_error)
     if (SCM_STRING_BODY_SINGLE_BYTE_P(b)) {
         return (ScmChar)(((unsigned char *)SCM_STRING_BODY_START(b))[pos]);
     } else {
-        const char *p = forward_pos(SCM_STRING_BODY_START(b), pos);
+        const char *p = body_char_pos(b, pos);
         ScmChar c;
         SCM_CHAR_GET(p, c);
         return c;
@@ -567,7 +676,7 @@ const char *Scm_StringBodyPosition(const ScmStringBody *b, ScmSmallInt offset)
     if (SCM_STRING_BODY_INCOMPLETE_P(b)) {
         return (SCM_STRING_BODY_START(b)+offset);
     } else {
-        return (forward_pos(SCM_STRING_BODY_START(b), offset));
+        return body_char_pos(b, offset);
     }
 }
 
@@ -579,12 +688,184 @@ const char *Scm_StringPosition(ScmString *str, ScmSmallInt offset)
     return Scm_StringBodyPosition(SCM_STRING_BODY(str), offset);
 }
 
+/*----------------------------------------------------------------
+ * Rope
+ */
+
+/* When we append strings and the result is long, we make a rope body
+   that just points to the appended bodies, instead of copying them.
+   Repeated appending to a growing string thus takes O(1) per append.
+   A rope is flattened when its characters are needed; see
+   SCM_STRING_BODY in gauche/string.h.  Only the output port writes
+   the leaves of a rope directly, by Scm__StringForEachChunk.
+
+   The bodies in a rope node are immutable, as any other bodies, so
+   mutating an appended string doesn't affect the rope.
+
+   To avoid making a rope of tiny leaves, a short string appended to
+   a rope whose rightmost leaf is short is merged into that leaf (and
+   likewise when prepending). */
+
+typedef struct RopeRec {
+    const ScmStringBody *left;
+    const ScmStringBody *right;
+} Rope;
+
+#define ROPE_BODY_P(b)   SCM_STRING_BODY_HAS_FLAG(b, SCM_STRING_ROPE)
+#define ROPE_NODE(b)     ((const Rope*)SCM_STRING_BODY_START(b))
+
+#define ROPE_MIN_SIZE    1024   /* appending makes a rope if the result
+                                   is at least this size */
+#define ROPE_LEAF_SIZE   256    /* we merge short leaves up to this size */
+
+/* Makes a flat string of two short flat bodies. */
+static ScmString *merge_leaves(const ScmStringBody *xb,
+                               const ScmStringBody *yb)
+{
+    ScmSmallInt sizex = SCM_STRING_BODY_SIZE(xb);
+    ScmSmallInt sizey = SCM_STRING_BODY_SIZE(yb);
+    char *p = SCM_NEW_ATOMIC2(char *, sizex + sizey + 1);
+    memcpy(p, SCM_STRING_BODY_START(xb), sizex);
+    memcpy(p+sizex, SCM_STRING_BODY_START(yb), sizey);
+    p[sizex + sizey] = '\0';
+    int flags = SCM_STRING_TERMINATED;
+    if (SCM_STRING_BODY_INCOMPLETE_P(xb) || SCM_STRING_BODY_INCOMPLETE_P(yb)) {
+        flags |= SCM_STRING_INCOMPLETE;
+    }
+    return make_str(SCM_STRING_BODY_LENGTH(xb) + SCM_STRING_BODY_LENGTH(yb),
+                    sizex + sizey, p, flags);
+}
+
+#define SHORT_LEAF_P(b) \
+    (!ROPE_BODY_P(b) && SCM_STRING_BODY_SIZE(b) < ROPE_LEAF_SIZE)
+
+/* Returns a string of XB followed by YB. */
+static ScmString *rope_append(const ScmStringBody *xb,
+                              const ScmStringBody *yb)
+{
+    if (SHORT_LEAF_P(xb) && SHORT_LEAF_P(yb)
+        && (SCM_STRING_BODY_SIZE(xb) + SCM_STRING_BODY_SIZE(yb)
+            < ROPE_LEAF_SIZE)) {
+        return merge_leaves(xb, yb);
+    }
+    if (SHORT_LEAF_P(yb) && ROPE_BODY_P(xb)
+        && SHORT_LEAF_P(ROPE_NODE(xb)->right)
+        && (SCM_STRING_BODY_SIZE(ROPE_NODE(xb)->right)
+            + SCM_STRING_BODY_SIZE(yb) < ROPE_LEAF_SIZE)) {
+        ScmString *m = merge_leaves(ROPE_NODE(xb)->right, yb);
+        return rope_append(ROPE_NODE(xb)->left, SCM_STRING_BODY_RAW(m));
+    }
+    if (SHORT_LEAF_P(xb) && ROPE_BODY_P(yb)
+        && SHORT_LEAF_P(ROPE_NODE(yb)->left)
+        && (SCM_STRING_BODY_SIZE(xb)
+            + SCM_STRING_BODY_SIZE(ROPE_NODE(yb)->left) < ROPE_LEAF_SIZE)) {
+        ScmString *m = merge_leaves(xb, ROPE_NODE(yb)->left);
+        return rope_append(SCM_STRING_BODY_RAW(m), ROPE_NODE(yb)->right);
+    }
+
+    Rope *r = SCM_NEW(Rope);
+    r->left = xb;
+    r->right = yb;
+    int flags = SCM_STRING_ROPE;
+    if (SCM_STRING_BODY_INCOMPLETE_P(xb) || SCM_STRING_BODY_INCOMPLETE_P(yb)) {
+        flags |= SCM_STRING_INCOMPLETE;
+    }
+    return make_str(SCM_STRING_BODY_LENGTH(xb)+SCM_STRING_BODY_LENGTH(yb),
+                    SCM_STRING_BODY_SIZE(xb)+SCM_STRING_BODY_SIZE(yb),
+                    (const char*)r, flags);
+}
+
+/* Whether appending a string of body B to others and getting SIZE
+   bytes should make a rope. */
+static inline int rope_worthy(const ScmStringBody *b, ScmSmallInt size)
+{
+    return (size >= ROPE_MIN_SIZE
+            && (ROPE_BODY_P(b) || SCM_STRING_BODY_SIZE(b) >= ROPE_LEAF_SIZE));
+}
+
+/* Calls PROC on each leaf of body B from left to right.  We don't
+   recurse, since a rope made by repeated appending is deep. */
+static void rope_for_each(const ScmStringBody *b,
+                          void (*proc)(const char*, ScmSmallInt, void*),
+                          void *data)
+{
+#define ROPE_STACK_SIZE 64
+    const ScmStringBody *stack_s[ROPE_STACK_SIZE], **stack = stack_s;
+    int sp = 0, cap = ROPE_STACK_SIZE;
+
+    for (;;) {
+        while (ROPE_BODY_P(b)) {
+            if (sp == cap) {
+                const ScmStringBody **s =
+                    SCM_NEW_ARRAY(const ScmStringBody*, cap*2);
+                memcpy(s, stack, sp*sizeof(const ScmStringBody*));
+                stack = s;
+                cap *= 2;
+            }
+            stack[sp++] = ROPE_NODE(b)->right;
+            b = ROPE_NODE(b)->left;
+        }
+        if (SCM_STRING_BODY_SIZE(b) > 0) {
+            proc(SCM_STRING_BODY_START(b), SCM_STRING_BODY_SIZE(b), data);
+        }
+        if (sp == 0) break;
+        b = stack[--sp];
+    }
+#undef ROPE_STACK_SIZE
+}
+
+static void rope_copy_chunk(const char *chunk, ScmSmallInt size, void *data)
+{
+    char **pp = (char**)data;
+    memcpy(*pp, chunk, size);
+    *pp += size;
+}
+
+/* Replaces the rope body of STR by a flat one, and returns it.
+   Like other body replacements, we don't lock; if two threads flatten
+   the same string, one of the equivalent bodies wins.  */
+const ScmStringBody *Scm__StringFlatten(ScmString *str)
+{
+    const ScmStringBody *b = SCM_STRING_BODY_RAW(str);
+    if (!ROPE_BODY_P(b)) return b;
+
+    ScmSmallInt size = SCM_STRING_BODY_SIZE(b);
+    char *buf = SCM_NEW_ATOMIC2(char *, size+1);
+    char *p = buf;
+    rope_for_each(b, rope_copy_chunk, &p);
+    *p = '\0';
+
+    int flags = ((SCM_STRING_BODY_FLAGS(b) & ~SCM_STRING_ROPE)
+                 | SCM_STRING_TERMINATED);
+    const ScmStringBody *nb =
+        SCM_STRING_BODY_RAW(make_str(SCM_STRING_BODY_LENGTH(b), size,
+                                     buf, flags));
+    str->body = nb;
+    return nb;
+}
+
+/* Calls PROC on each piece of STR's content, without flattening it. */
+void Scm__StringForEachChunk(ScmString *str,
+                             void (*proc)(const char*, ScmSmallInt, void*),
+                             void *data)
+{
+    rope_for_each(SCM_STRING_BODY_RAW(str), proc, data);
+}
+
 /*----------------------------------------------------------------
  * Concatenation
  */
 
 ScmObj Scm_StringAppend2(ScmString *x, ScmString *y)
 {
+    const ScmStringBody *xr = SCM_STRING_BODY_RAW(x);
+    const ScmStringBody *yr = SCM_STRING_BODY_RAW(y);
+    ScmSmallInt size = SCM_STRING_BODY_SIZE(xr) + SCM_STRING_BODY_SIZE(yr);
+    if (rope_worthy(xr, size) || rope_worthy(yr, size)) {
+        CHECK_SIZE(size);
+        return SCM_OBJ(rope_append(xr, yr));
+    }
+
     const ScmStringBody *xb = SCM_STRING_BODY(x);
     const ScmStringBody *yb = SCM_STRING_BODY(y);
     ScmSmallInt sizex = SCM_STRING_BODY_SIZE(xb);
@@ -609,14 +890,21 @@ ScmObj Scm_StringAppend2(ScmString *x, ScmString *y)
 ScmObj Scm_StringAppendC(ScmString *x, const char *str,
                          ScmSmallInt sizey, ScmSmallInt leny)
 {
-    const ScmStringBody *xb = SCM_STRING_BODY(x);
-    ScmSmallInt sizex = SCM_STRING_BODY_SIZE(xb);
-    ScmSmallInt lenx = SCM_STRING_BODY_LENGTH(xb);
+    const ScmStringBody *xr = SCM_STRING_BODY_RAW(x);
     int flags = 0;
 
     if (sizey < 0) count_size_and_length(str, &sizey, &leny);
     else if (leny < 0) leny = count_length(str, sizey);
-    CHECK_SIZE(sizex+sizey);
+    CHECK_SIZE(SCM_STRING_BODY_SIZE(xr)+sizey);
+    if (rope_worthy(xr, SCM_STRING_BODY_SIZE(xr)+sizey)) {
+        ScmString *y = make_str(leny, sizey, Scm_StrdupPartial(str, sizey),
+                                SCM_STRING_TERMINATED);
+        return SCM_OBJ(rope_append(xr, SCM_STRING_BODY_RAW(y)));
+    }
+
+    const ScmStringBody *xb = SCM_STRING_BODY(x);
+    ScmSmallInt sizex = SCM_STRING_BODY_SIZE(xb);
+    ScmSmallInt lenx = SCM_STRING_BODY_LENGTH(xb);
 
     char *p = SCM_NEW_ATOMIC2(char *, sizex + sizey + 1);
     memcpy(p, xb->start, sizex);
@@ -649,29 +937,41 @@ ScmObj Scm_StringAppend(ScmObj strs)
         bodies = bodies_s;
     }
 
-    int i = 0;
+    int i = 0, ropep = FALSE;
     ScmObj cp;
     SCM_FOR_EACH(cp, strs) {
         const ScmStringBody *b;
         if (!SCM_STRINGP(SCM_CAR(cp))) {
             Scm_Error("string required, but got %S", SCM_CAR(cp));
         }
-        b = SCM_STRING_BODY(SCM_CAR(cp));
+        b = SCM_STRING_BODY_RAW(SCM_CAR(cp));
         size += SCM_STRING_BODY_SIZE(b);
         len += SCM_STRING_BODY_LENGTH(b);
         CHECK_SIZE(size);
         if (SCM_STRING_BODY_INCOMPLETE_P(b)) {
             flags |= SCM_STRING_INCOMPLETE;
         }
+        if (ROPE_BODY_P(b) || SCM_STRING_BODY_SIZE(b) >= ROPE_LEAF_SIZE) {
+            ropep = TRUE;
+        }
         bodies[i++] = b;
     }
 
+    if (ropep && numstrs > 1 && size >= ROPE_MIN_SIZE) {
+        /* Short strings are merged into leaves by rope_append. */
+        ScmString *r = rope_append(bodies[0], bodies[1]);
+        for (i=2; i<numstrs; i++) {
+            r = rope_append(SCM_STRING_BODY_RAW(r), bodies[i]);
+        }
+        bodies = NULL;          /* to help GC */
+        return SCM_OBJ(r);
+    }
+
     char *buf = SCM_NEW_ATOMIC2(char *, size+1);
     char *bufp = buf;
     for (i=0; i<numstrs; i++) {
-        const ScmStringBody *b = bodies[i];
-        memcpy(bufp, SCM_STRING_BODY_START(b), SCM_STRING_BODY_SIZE(b));
-        bufp += SCM_STRING_BODY_SIZE(b);
+        /* A single string may be a rope. */
+        rope_for_each(bodies[i], rope_copy_chunk, &bufp);
     }
     *bufp = '\0';
     bodies = NULL;              /* to help GC */
@@ -680,6 +980,118 @@ ScmObj Scm_StringAppend(ScmObj strs)
 #undef BODY_ARRAY_SIZE
 }
 
+/*----------------------------------------------------------------
+ * String interpolation
+ *
+ *   #"..." is expanded into a call of %string-interpolate-concat with
+ *   the literal fragments and the values of embedded expressions
+ *   (see lib/gauche/interpolate.scm).  The result is the same as
+ *   (string-append (x->string arg) ...), but strings, characters,
+ *   symbols and numbers are written directly into one buffer, without
+ *   calling the generic function x->string and creating an intermediate
+ *   string for each of them.
+ */
+static ScmObj x_to_string_proc = SCM_UNDEFINED;
+
+static ScmObj interpolate_x_to_string(ScmObj obj)
+{
+    SCM_BIND_PROC(x_to_string_proc, "x->string", Scm_GaucheModule());
+    ScmObj s = Scm_ApplyRec1(x_to_string_proc, obj);
+    if (!SCM_STRINGP(s)) {
+        Scm_Error("x->string returned a non-string %S for %S", s, obj);
+    }
+    return s;
+}
+
+/* Writes decimal representation of fixnum N into the end of BUF,
+   and returns the pointer to the first character. */
+static char *interpolate_fixnum(ScmSmallInt n, char *buf, size_t bufsiz)
+{
+    char *p = buf + bufsiz;
+    u_long u = (n < 0)? -(u_long)n : (u_long)n;
+    *--p = '\0';
+    do { *--p = (char)('0' + u % 10); u /= 10; } while (u > 0);
+    if (n < 0) *--p = '-';
+    return p;
+}
+
+#define INTERPOLATE_FIXNUM_BUFSIZ 24
+
+ScmObj Scm_StringInterpolateConcat(ScmObj args)
+{
+    ScmObj cp;
+    char nbuf[INTERPOLATE_FIXNUM_BUFSIZ];
+
+    /* Long strings are shared as rope leaves by Scm_StringAppend rather
+       than copied. */
+    SCM_FOR_EACH(cp, args) {
+        ScmObj a = SCM_CAR(cp);
+        if (SCM_STRINGP(a)) {
+            const ScmStringBody *b = SCM_STRING_BODY_RAW(a);
+            if (ROPE_BODY_P(b) || SCM_STRING_BODY_SIZE(b) >= ROPE_LEAF_SIZE) {
+                ScmObj h = SCM_NIL, t = SCM_NIL;
+                SCM_FOR_EACH(cp, args) {
+                    ScmObj z = SCM_CAR(cp);
+                    if (!SCM_STRINGP(z)) z = interpolate_x_to_string(z);
+                    SCM_APPEND1(h, t, z);
+                }
+                return Scm_StringAppend(h);
+            }
+        }
+    }
+
+    ScmDString ds;
+    int flags = 0;
+    Scm_DStringInit(&ds);
+    SCM_FOR_EACH(cp, args) {
+        ScmObj a = SCM_CAR(cp);
+        if (SCM_STRINGP(a)) {
+            if (SCM_STRING_INCOMPLETE_P(a)) flags |= SCM_STRING_INCOMPLETE;
+            Scm_DStringAdd(&ds, SCM_STRING(a));
+        } else if (SCM_CHARP(a)) {
+            Scm_DStringPutc(&ds, SCM_CHAR_VALUE(a));
+        } else if (SCM_INTP(a)) {
+            Scm_DStringPutz(&ds,
+                            interpolate_fixnum(SCM_INT_VALUE(a), nbuf,
+                                               sizeof(nbuf)),
+                            -1);
+        } else if (SCM_SYMBOLP(a)) {
+            Scm_DStringAdd(&ds, SCM_SYMBOL_NAME(a));
+        } else if (SCM_NUMBERP(a)) {
+            Scm_DStringAdd(&ds, SCM_STRING(Scm_NumberToString(a, 10, 0)));
+        } else {
+            Scm_DStringAdd(&ds, SCM_STRING(interpolate_x_to_string(a)));
+        }
+    }
+    return Scm__DStringTake(&ds, flags);
+}
+
+/* The same as (display (%string-interpolate-concat arg ...) port),
+   without creating the result string. */
+void Scm_StringInterpolateWrite(ScmObj args, ScmPort *port)
+{
+    ScmObj cp;
+    char nbuf[INTERPOLATE_FIXNUM_BUFSIZ];
+
+    SCM_FOR_EACH(cp, args) {
+        ScmObj a = SCM_CAR(cp);
+        if (SCM_STRINGP(a)) {
+            Scm_Puts(SCM_STRING(a), port);
+        } else if (SCM_CHARP(a)) {
+            Scm_Putc(SCM_CHAR_VALUE(a), port);
+        } else if (SCM_INTP(a)) {
+            Scm_Putz(interpolate_fixnum(SCM_INT_VALUE(a), nbuf, sizeof(nbuf)),
+                     -1, port);
+        } else if (SCM_SYMBOLP(a)) {
+            Scm_Puts(SCM_SYMBOL_NAME(a), port);
+        } else if (SCM_NUMBERP(a)) {
+            Scm_Puts(SCM_STRING(Scm_NumberToString(a, 10, 0)), port);
+        } else {
+            Scm_Puts(SCM_STRING(interpolate_x_to_string(a)), port);
+        }
+    }
+}
+
 ScmObj Scm_StringJoin(ScmObj strs, ScmString *delim, int grammer)
 {
 #define BODY_ARRAY_SIZE 32
@@ -809,12 +1221,17 @@ static ScmObj substring(const ScmStringBody *xb,
                                 flags));
     } else {
         const char *s, *e;
-        if (start) s = forward_pos(SCM_STRING_BODY_START(xb), start);
+        if (start) s = body_char_pos(xb, start);
         else s = SCM_STRING_BODY_START(xb);
         if (len == end) {
             e = SCM_STRING_BODY_START(xb) + SCM_STRING_BODY_SIZE(xb);
         } else {
-            e = forward_pos(s, end - start);
+            /* For a short substring, scanning from S is faster. */
+            if (end - start < STRING_INDEX_INTERVAL) {
+                e = forward_pos(s, end - start);
+            } else {
+                e = body_char_pos(xb, end);
+            }
             flags &= ~SCM_STRING_TERMINATED;
         }
         return SCM_OBJ(make_str((int)(end - start), (int)(e - s), s, flags));
@@ -892,6 +1309,90 @@ static ScmSmallInt boyer_moore_reverse(const char *ss1, ScmSmallInt siz1,
     return -1;
 }
 
+/* Two-way string matching (Crochemore and Perrin, 1991).  Used for
+   long needles, where Boyer-Moore's skip table can't hold the shift
+   distance, and the naive search could take O(siz1*siz2) time.  It runs
+   in linear time and constant space.  Assuming siz1 >= siz2 > 0. */
+static ScmSmallInt max_suffix(const unsigned char *x, ScmSmallInt m,
+                              int reverse, ScmSmallInt *period)
+{
+    ScmSmallInt ms = -1, j = 0, k = 1, p = 1;
+    while (j + k < m) {
+        unsigned char a = x[j + k], b = x[ms + k];
+        if (reverse ? (a > b) : (a < b)) {
+            j += k; k = 1; p = j - ms;
+        } else if (a == b) {
+            if (k != p) k++;
+            else { j += p; k = 1; }
+        } else {
+            ms = j; j = ms + 1; k = p = 1;
+        }
+    }
+    *period = p;
+    return ms;
+}
+
+static ScmSmallInt two_way(const char *ss1, ScmSmallInt siz1,
+                           const char *ss2, ScmSmallInt siz2)
+{
+    const unsigned char *y = (const unsigned char*)ss1;
+    const unsigned char *x = (const unsigned char*)ss2;
+    ScmSmallInt m = siz2, n = siz1, p, q, ell, per;
+    ScmSmallInt i = max_suffix(x, m, FALSE, &p);
+    ScmSmallInt j = max_suffix(x, m, TRUE, &q);
+    if (i > j) { ell = i; per = p; }
+    else       { ell = j; per = q; }
+
+    if (memcmp(x, x + per, ell + 1) == 0) {
+        /* The needle is periodic; remember the matched prefix. */
+        ScmSmallInt memory = -1;
+        for (j = 0; j <= n - m;) {
+            i = (ell > memory ? ell : memory) + 1;
+            while (i < m && x[i] == y[i + j]) i++;
+            if (i >= m) {
+                i = ell;
+                while (i > memory && x[i] == y[i + j]) i--;
+                if (i <= memory) return j;
+                j += per;
+                memory = m - per - 1;
+            } else {
+                j += i - ell;
+                memory = -1;
+            }
+        }
+    } else {
+        per = (ell + 1 > m - ell - 1 ? ell + 1 : m - ell - 1) + 1;
+        for (j = 0; j <= n - m;) {
+            i = ell + 1;
+            while (i < m && x[i] == y[i + j]) i++;
+            if (i >= m) {
+                i = ell;
+                while (i >= 0 && x[i] == y[i + j]) i--;
+                if (i < 0) return j;
+                j += per;
+            } else {
+                j += i - ell;
+            }
+        }
+    }
+    return -1;
+}
+
+/* For short haystacks setting up a skip table doesn't pay off.  We let
+   memchr find the candidates of the first byte. */
+static ScmSmallInt memchr_search(const char *ss1, ScmSmallInt siz1,
+                                 const char *ss2, ScmSmallInt siz2)
+{
+    const char *p = ss1, *e = ss1 + siz1 - siz2 + 1;
+    while (p < e) {
+        const char *z = memchr(p, ss2[0], e - p);
+        if (z == NULL) return -1;
+        if (memcmp(z + 1, ss2 + 1, siz2 - 1) == 0) return z - ss1;
+        p = z + 1;
+    }
+    return -1;
+}
+
 /* Primitive routines to search a substring s2 within s1.
    Returns NOT_FOUND if not fonud, FOUND_BOTH_INDEX if both byte index
    (*bi) and character index (*ci) is calculted, FOUND_BYTE_INDEX
@@ -963,16 +1464,14 @@ static int string_search(const char *s1, ScmSmallInt siz1, ScmSmallInt len1,
             ScmSmallInt i;
             /* Shortcut for single-byte strings */
             if (siz1 < siz2) return NOT_FOUND;
-            if (siz1 < 256 || siz2 >= 256) {
-                /* brute-force search */
-                for (i=0; i<=siz1-siz2; i++) {
-                    if (memcmp(s2, s1+i, siz2) == 0) break;
-                }
-                if (i == siz1-siz2+1) return NOT_FOUND;
+            if (siz2 >= 256) {
+                i = two_way(s1, siz1, s2, siz2);
+            } else if (siz1 < 256) {
+                i = memchr_search(s1, siz1, s2, siz2);
             } else {
                 i = boyer_moore(s1, siz1, s2, siz2);
-                if (i < 0) return NOT_FOUND;
             }
+            if (i < 0) return NOT_FOUND;
             *bi = *ci = i;
             return FOUND_MAYBE_BOTH;
         }
@@ -1187,6 +1686,91 @@ ScmObj Scm_StringScanCharRight(ScmString *s1, ScmChar ch, int retmode)
     else return Scm_Values2(v1, v2);
 }
 
+/* Returns the index of the first character in [start, end) of STR that
+   is CH (or is not CH, if NEGATE is TRUE), or -1 if there's none.
+   END < 0 means the end of the string.  These back srfi-13's string-index
+   family; the char-set versions are in char.c. */
+ScmSmallInt Scm_StringIndexChar(ScmString *str, ScmChar ch, int negate,
+                                ScmSmallInt start, ScmSmallInt end)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    ScmSmallInt len = SCM_STRING_BODY_LENGTH(b);
+    SCM_CHECK_START_END(start, end, len);
+    if (start == end) return -1;
+
+    const char *p = body_char_pos(b, start);
+    if (SCM_STRING_BODY_SINGLE_BYTE_P(b)) {
+        if (!negate) {
+            if (ch < 0 || ch > 0xff) return -1;
+            const char *z = memchr(p, (int)ch, end - start);
+            return z ? start + (z - p) : -1;
+        }
+        for (ScmSmallInt i=start; i<end; i++, p++) {
+            if ((ScmChar)(unsigned char)*p != ch) return i;
+        }
+        return -1;
+    }
+#if defined(GAUCHE_CHAR_ENCODING_UTF_8)
+    if (!negate) {
+        /* In utf-8, an encoded character never matches in the middle of
+           another character, so we can search bytewise and count the
+           characters afterwards. */
+        char buf[SCM_CHAR_MAX_BYTES];
+        int nb = SCM_CHAR_NBYTES(ch);
+        SCM_CHAR_PUT(buf, ch);
+        const char *e = (end == len)
+            ? SCM_STRING_BODY_START(b) + SCM_STRING_BODY_SIZE(b)
+            : body_char_pos(b, end);
+        for (const char *q = p; q < e;) {
+            const char *z = memchr(q, buf[0], e - q);
+            if (z == NULL || e - z < nb) break;
+            if (memcmp(z, buf, nb) == 0) return start + count_length(p, z - p);
+            q = z + 1;
+        }
+        return -1;
+    }
+#endif
+    for (ScmSmallInt i=start; i<end; i++) {
+        ScmChar c;
+        SCM_CHAR_GET(p, c);
+        if ((c == ch) == !negate) return i;
+        p += SCM_CHAR_NFOLLOWS(*p) + 1;
+    }
+    return -1;
+}
+
+/* Like Scm_StringIndexChar, but returns the index of the last one. */
+ScmSmallInt Scm_StringIndexCharRight(ScmString *str, ScmChar ch, int negate,
+                                     ScmSmallInt start, ScmSmallInt end)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    ScmSmallInt len = SCM_STRING_BODY_LENGTH(b);
+    SCM_CHECK_START_END(start, end, len);
+    if (start == end) return -1;
+
+    const char *s = body_char_pos(b, start);
+    if (SCM_STRING_BODY_SINGLE_BYTE_P(b)) {
+        const unsigned char *u = (const unsigned char*)s;
+        for (ScmSmallInt i=end-1; i>=start; i--) {
+            if (((ScmChar)u[i-start] == ch) == !negate) return i;
+        }
+        return -1;
+    }
+    const char *p = (end == len)
+        ? SCM_STRING_BODY_START(b) + SCM_STRING_BODY_SIZE(b)
+        : body_char_pos(b, end);
+    for (ScmSmallInt i=end-1; i>=start; i--) {
+        const char *q;
+        ScmChar c;
+        SCM_CHAR_BACKWARD(p, s, q);
+        if (q == NULL) break;
+        SCM_CHAR_GET(q, c);
+        if ((c == ch) == !negate) return i;
+        p = q;
+    }
+    return -1;
+}
+
 #undef NOT_FOUND
 #undef FOUND_BOTH_INDEX
 #undef FOUND_BYTE_INDEX
@@ -1239,6 +1823,44 @@ ScmObj Scm_StringSplitByChar(ScmString *str, ScmChar ch)
  * Miscellaneous functions
  */
 
+/* srfi-13's string-pad and string-pad-right.  Returns a string of
+   LEN characters, made of [start, end) of STR and padded with PAD on
+   the left (or on the right, if RIGHT is TRUE).  If the substring is
+   longer than LEN, it is truncated from the same side. */
+ScmObj Scm_StringPad(ScmString *str, ScmSmallInt len, ScmChar pad,
+                     int right, ScmSmallInt start, ScmSmallInt end)
+{
+    const ScmStringBody *b = SCM_STRING_BODY(str);
+    ScmSmallInt slen = SCM_STRING_BODY_LENGTH(b);
+    if (len < 0) Scm_Error("length out of range: %ld", len);
+    SCM_CHECK_START_END(start, end, slen);
+
+    ScmSmallInt n = end - start;
+    if (n >= len) {
+        if (right) return substring(b, start, start + len, FALSE);
+        else       return substring(b, end - len, end, FALSE);
+    }
+
+    const char *s = body_char_pos(b, start);
+    const char *e = (end == slen)
+        ? SCM_STRING_BODY_START(b) + SCM_STRING_BODY_SIZE(b)
+        : body_char_pos(b, end);
+    ScmSmallInt csize = SCM_CHAR_NBYTES(pad);
+    ScmSmallInt padsize = csize * (len - n);
+    ScmSmallInt size = (e - s) + padsize;
+    CHECK_SIZE(size);
+    char *ptr = SCM_NEW_ATOMIC2(char *, size+1);
+    char *q = right ? ptr + (e - s) : ptr;
+    for (ScmSmallInt i=0; i<len-n; i++, q+=csize) {
+        SCM_CHAR_PUT(q, pad);
+    }
+    memcpy(right ? ptr : ptr + padsize, s, e - s);
+    ptr[size] = '\0';
+    int flags = SCM_STRING_TERMINATED;
+    if (SCM_STRING_BODY_INCOMPLETE_P(b)) flags |= SCM_STRING_INCOMPLETE;
+    return SCM_OBJ(make_str(len, size, ptr, flags));
+}
+
 ScmObj Scm_StringToList(ScmString *str)
 {
     const ScmStringBody *b = SCM_STRING_BODY(str);
@@ -1427,12 +2049,12 @@ ScmObj Scm_MakeStringPointer(ScmString *src, ScmSmallInt index,
         ptr = sptr + index;
         effective_size = end - start;
     } else {
-        sptr = forward_pos(SCM_STRING_BODY_START(srcb), start);
-        ptr = forward_pos(sptr, index);
+        sptr = body_char_pos(srcb, start);
+        ptr = body_char_pos(srcb, start + index);
         if (end == len) {
             eptr = SCM_STRING_BODY_START(srcb) + SCM_STRING_BODY_SIZE(srcb);
         } else {
-            eptr = forward_pos(sptr, end - start);
+            eptr = body_char_pos(srcb, end);
         }
         effective_size = (int)(eptr - ptr);
     }
@@ -1583,6 +2205,9 @@ void Scm_StringPointerDump(ScmStringPointer *sp1)
 /* maximum chunk size */
 #define DSTRING_MAX_CHUNK_SIZE  8180
 
+/* maximum number of chunks kept in the per-VM pool */
+#define DSTRING_POOL_MAX  32
+
 void Scm_DStringInit(ScmDString *dstr)
 {
     dstr->init.bytes = 0;
@@ -1593,14 +2218,72 @@ void Scm_DStringInit(ScmDString *dstr)
     dstr->length = 0;
 }
 
+/* Empties the content.  The extra chunks are kept in dstr, and reused
+   as it grows again.  Useful to build many strings with one DString. */
+void Scm_DStringReset(ScmDString *dstr)
+{
+    dstr->init.bytes = 0;
+    dstr->tail = NULL;
+    dstr->current = dstr->init.data;
+    dstr->end = dstr->current + SCM_DSTRING_INIT_CHUNK_SIZE;
+    dstr->lastChunkSize = SCM_DSTRING_INIT_CHUNK_SIZE;
+    dstr->length = 0;
+}
+
+/* Empties the content, and gives the extra chunks to the pool of the
+   current VM, so that other DStrings used in this thread can take them
+   instead of allocating fresh ones.  The caller must make sure nobody
+   else is touching dstr.  The strings we've returned are always copied
+   out of the chunks, so they are not affected. */
+void Scm__DStringRecycle(ScmDString *dstr)
+{
+    ScmVM *vm = Scm_VM();
+    ScmDStringChain *chain = dstr->anchor;
+    Scm_DStringInit(dstr);
+    if (vm == NULL) return;
+    while (chain && vm->dstringPoolCount < DSTRING_POOL_MAX) {
+        ScmDStringChain *next = chain->next;
+        chain->next = vm->dstringPool;
+        vm->dstringPool = chain;
+        vm->dstringPoolCount++;
+        chain = next;
+    }
+}
+
+/* Makes sure the next SIZE bytes can be written to the current chunk.
+   Called on an empty DString, it makes the content contiguous up to
+   SIZE bytes, so that retrieving it is a single copy, or no copy at
+   all with Scm__DStringTake. */
+void Scm_DStringReserve(ScmDString *dstr, int size)
+{
+    if (dstr->current + size > dstr->end) {
+        Scm__DStringRealloc(dstr, size);
+    }
+}
+
+/* Take a chunk that can hold at least minsize bytes from the pool.
+   We only look at the head; chunks in the pool are mostly of similar
+   sizes, and it's not worth searching. */
+static ScmDStringChain *dstring_pool_take(int minsize)
+{
+    ScmVM *vm = Scm_VM();
+    if (vm == NULL) return NULL;
+    ScmDStringChain *chain = vm->dstringPool;
+    if (chain == NULL || chain->size < minsize) return NULL;
+    vm->dstringPool = chain->next;
+    vm->dstringPoolCount--;
+    return chain;
+}
+
 int Scm_DStringSize(ScmDString *dstr)
 {
     ScmSmallInt size;
     if (dstr->tail) {
         size = dstr->init.bytes;
         dstr->tail->chunk->bytes = (int)(dstr->current - dstr->tail->chunk->data);
-        for (ScmDStringChain *chain = dstr->anchor; chain; chain = chain->next) {
+        for (ScmDStringChain *chain = dstr->anchor; ; chain = chain->next) {
             size += chain->chunk->bytes;
+            if (chain == dstr->tail) break;
         }
     } else {
         size = dstr->current - dstr->init.data;
@@ -1630,24 +2313,33 @@ void Scm__DStringRealloc(ScmDString *dstr, int minincr)
         newsize = minincr;
     }
 
-    ScmDStringChunk *newchunk = SCM_NEW_ATOMIC2(
-        ScmDStringChunk*,
-        sizeof(ScmDStringChunk)+newsize-SCM_DSTRING_INIT_CHUNK_SIZE);
-    newchunk->bytes = 0;
-
-    ScmDStringChain *newchain = SCM_NEW(ScmDStringChain);
-
-    newchain->next = NULL;
-    newchain->chunk = newchunk;
-    if (dstr->tail) {
-        dstr->tail->next = newchain;
-        dstr->tail = newchain;
+    /* If we've been reset, we may have a spare chunk after the tail. */
+    ScmDStringChain *spare = dstr->tail? dstr->tail->next : dstr->anchor;
+    ScmDStringChain *newchain;
+    if (spare && spare->size >= minincr) {
+        newchain = spare;
     } else {
-        dstr->anchor = dstr->tail = newchain;
+        newchain = dstring_pool_take((int)minincr);
+        if (newchain == NULL) {
+            ScmDStringChunk *newchunk = SCM_NEW_ATOMIC2(
+                ScmDStringChunk*,
+                sizeof(ScmDStringChunk)+newsize-SCM_DSTRING_INIT_CHUNK_SIZE);
+            newchain = SCM_NEW(ScmDStringChain);
+            newchain->chunk = newchunk;
+            newchain->size = (int)newsize;
+        }
+        newchain->next = spare;
+        if (dstr->tail) {
+            dstr->tail->next = newchain;
+        } else {
+            dstr->anchor = newchain;
+        }
     }
-    dstr->current = newchunk->data;
-    dstr->end = newchunk->data + newsize;
-    dstr->lastChunkSize = newsize;
+    newchain->chunk->bytes = 0;
+    dstr->tail = newchain;
+    dstr->current = newchain->chunk->data;
+    dstr->end = newchain->chunk->data + newchain->size;
+    dstr->lastChunkSize = newchain->size;
 }
 
 /* Retrieve accumulated string. */
@@ -1655,7 +2347,7 @@ static const char *dstring_getz(ScmDString *dstr, int *psiz, int *plen, int noal
 {
     ScmSmallInt size, len;
     char *buf;
-    if (dstr->anchor == NULL) {
+    if (dstr->tail == NULL) {
         /* we only have one chunk */
         size = dstr->current - dstr->init.data;
         CHECK_SIZE(size);
@@ -1676,9 +2368,10 @@ static const char *dstring_getz(ScmDString *dstr, int *psiz, int *plen, int noal
 
         memcpy(bptr, dstr->init.data, dstr->init.bytes);
         bptr += dstr->init.bytes;
-        for (; chain; chain = chain->next) {
+        for (;; chain = chain->next) {
             memcpy(bptr, chain->chunk->data, chain->chunk->bytes);
             bptr += chain->chunk->bytes;
+            if (chain == dstr->tail) break;
         }
         *bptr = '\0';
     }
@@ -1695,6 +2388,31 @@ ScmObj Scm_DStringGet(ScmDString *dstr, int flags)
     return SCM_OBJ(make_str(len, size, str, flags|SCM_STRING_TERMINATED));
 }
 
+/* Like Scm_DStringGet, but empties DSTR as well.  If the whole content
+   is in one extra chunk, the chunk is handed to the returned string
+   without copying, and detached from DSTR.  The remaining spare chunks
+   are kept for reuse as Scm_DStringReset does. */
+ScmObj Scm__DStringTake(ScmDString *dstr, int flags)
+{
+    ScmDStringChain *chain = dstr->tail;
+    if (chain != NULL && chain == dstr->anchor && dstr->init.bytes == 0
+        && dstr->current < dstr->end) {
+        ScmSmallInt size = dstr->current - chain->chunk->data;
+        ScmSmallInt len = dstr->length;
+        CHECK_SIZE(size);
+        *dstr->current = '\0';
+        if (len < 0) len = count_length(chain->chunk->data, size);
+        ScmString *s = make_str(len, size, chain->chunk->data,
+                                flags|SCM_STRING_TERMINATED);
+        Scm_DStringInit(dstr);
+        dstr->anchor = chain->next;
+        return SCM_OBJ(s);
+    }
+    ScmObj r = Scm_DStringGet(dstr, flags);
+    Scm_DStringReset(dstr);
+    return r;
+}
+
 /* For conveninence.   Note that dstr may already contain NUL byte in it,
    in that case you'll get chopped string. */
 const char *Scm_DStringGetz(ScmDString *dstr)
@@ -1762,16 +2480,17 @@ void Scm_DStringPutc(ScmDString *ds, ScmChar ch)
 void Scm_DStringDump(FILE *out, ScmDString *dstr)
 {
     fprintf(out, "DString %p\n", dstr);
-    if (dstr->anchor) {
+    if (dstr->tail) {
         fprintf(out, "  chunk0[%3d] = \"", dstr->init.bytes);
         SCM_IGNORE_RESULT(fwrite(dstr->init.data, 1, dstr->init.bytes, out));
         fprintf(out, "\"\n");
         ScmDStringChain *chain = dstr->anchor;
-        for (int i=1; chain; chain = chain->next, i++) {
-            int size = (chain->next? chain->chunk->bytes : (int)(dstr->current - dstr->tail->chunk->data));
+        for (int i=1; ; chain = chain->next, i++) {
+            int size = (chain != dstr->tail? chain->chunk->bytes : (int)(dstr->current - dstr->tail->chunk->data));
             fprintf(out, "  chunk%d[%3d] = \"", i, size);
             SCM_IGNORE_RESULT(fwrite(chain->chunk->data, 1, size, out));
             fprintf(out, "\"\n");
+            if (chain == dstr->tail) break;
         }
     } else {
         int size = (int)(dstr->current - dstr->init.data);
@@ -36,6 +36,12 @@
 #include "gauche/priv/builtin-syms.h"
 #include "gauche/priv/moduleP.h"
 
+/* Some ARM and SH variants need pthread emulation; see lazy.c */
+#if defined(__SH4__) || defined(__ARMEL__)
+#define AO_USE_PTHREAD_DEFS 1
+#endif
+#include "atomic_ops.h"
+
 /*-----------------------------------------------------------
  * Symbols
  */
@@ -55,9 +61,137 @@ static ScmClass *keyword_cpl[] = {
 SCM_DEFINE_BUILTIN_CLASS(Scm_KeywordClass, symbol_print, symbol_compare,
                          NULL, NULL, keyword_cpl);
 
-/* name -> symbol mapper */
-static ScmInternalMutex obtable_mutex = SCM_INTERNAL_MUTEX_INITIALIZER;
-static ScmHashTable *obtable = NULL;
+/* name -> symbol mapper
+ *
+ *  The symbol table is consulted every time the reader sees a symbol,
+ *  so it must not serialize threads that read data concurrently.
+ *
+ *  Lookup of an existing symbol is lock-free.  Each bucket is a chain of
+ *  obtable_entry which is never modified once it is published; a new
+ *  entry is prepended to the chain and published with a release store.
+ *  A reader walks the chain it loaded with acquire, so it sees fully
+ *  initialized entries.  If the reader misses, it falls back to the slow
+ *  path, which takes the lock of the stripe the name hashes to, looks up
+ *  again and inserts.  Hence interning different names mostly proceeds
+ *  in parallel, and interning the same name yields the same symbol.
+ *
+ *  When the table gets crowded, we grab all the stripe locks (in order)
+ *  and build a new bucket array with fresh entries, then publish it.
+ *  Readers that still hold the old array see a consistent, if stale,
+ *  snapshot; if they miss, the slow path looks at the new one.  The old
+ *  array is left to GC, so we don't need any reclamation scheme.
+ */
+
+typedef struct obtable_entry_rec {
+    struct obtable_entry_rec *next;
+    u_long hashval;
+    ScmSymbol *sym;
+} obtable_entry;
+
+typedef struct obtable_buckets_rec {
+    u_long size;                /* power of 2 */
+    volatile AO_t bucket[1];    /* obtable_entry* ; variable length */
+} obtable_buckets;
+
+#define OBTABLE_NSTRIPES      64  /* power of 2 */
+#define OBTABLE_INITIAL_SIZE  4096
+#define OBTABLE_MAX_LOAD      2   /* entries per bucket before growing */
+
+static struct {
+    volatile AO_t buckets;      /* obtable_buckets* */
+    volatile AO_t count;
+    ScmInternalMutex stripe[OBTABLE_NSTRIPES];
+} obtable;
+
+#define OBTABLE_STRIPE(hv)  (&obtable.stripe[(hv)&(OBTABLE_NSTRIPES-1)])
+
+static obtable_buckets *obtable_alloc_buckets(u_long size)
+{
+    obtable_buckets *b =
+        SCM_NEW2(obtable_buckets*,
+                 sizeof(obtable_buckets) + sizeof(AO_t)*(size-1));
+    b->size = size;
+    for (u_long i=0; i<size; i++) b->bucket[i] = 0;
+    return b;
+}
+
+static ScmSymbol *obtable_search(obtable_buckets *b, ScmString *name,
+                                 u_long hv)
+{
+    obtable_entry *e =
+        (obtable_entry*)AO_load_acquire(&b->bucket[hv & (b->size-1)]);
+    for (; e; e = e->next) {
+        if (e->hashval == hv && Scm_StringEqual(e->sym->name, name)) {
+            return e->sym;
+        }
+    }
+    return NULL;
+}
+
+/* Caller must hold the stripe lock of HV. */
+static void obtable_push(obtable_buckets *b, ScmSymbol *sym, u_long hv)
+{
+    volatile AO_t *slot = &b->bucket[hv & (b->size-1)];
+    obtable_entry *e = SCM_NEW(obtable_entry);
+    e->next = (obtable_entry*)AO_load(slot);
+    e->hashval = hv;
+    e->sym = sym;
+    AO_store_release(slot, (AO_t)e);
+}
+
+static void obtable_grow(void)
+{
+    for (int i=0; i<OBTABLE_NSTRIPES; i++) {
+        SCM_INTERNAL_MUTEX_LOCK(obtable.stripe[i]);
+    }
+    obtable_buckets *ob = (obtable_buckets*)AO_load(&obtable.buckets);
+    /* Another thread may have grown it while we were waiting. */
+    if (AO_load(&obtable.count) > ob->size * OBTABLE_MAX_LOAD) {
+        obtable_buckets *nb = obtable_alloc_buckets(ob->size * 2);
+        for (u_long i=0; i<ob->size; i++) {
+            obtable_entry *e = (obtable_entry*)AO_load(&ob->bucket[i]);
+            for (; e; e = e->next) obtable_push(nb, e->sym, e->hashval);
+        }
+        AO_store_release(&obtable.buckets, (AO_t)nb);
+    }
+    for (int i=OBTABLE_NSTRIPES-1; i>=0; i--) {
+        SCM_INTERNAL_MUTEX_UNLOCK(obtable.stripe[i]);
+    }
+}
+
+/* Returns the symbol named NAME if it's interned, or NULL. */
+static inline ScmSymbol *obtable_lookup(ScmString *name, u_long hv)
+{
+    return obtable_search((obtable_buckets*)AO_load_acquire(&obtable.buckets),
+                          name, hv);
+}
+
+/* Registers SYM unless one with the same name is already there.  Returns
+   the registered symbol. */
+static ScmSymbol *obtable_intern(ScmSymbol *sym, u_long hv)
+{
+    ScmSymbol *r;
+    int grow = FALSE;
+    SCM_INTERNAL_MUTEX_LOCK(*OBTABLE_STRIPE(hv));
+    /* Buckets can't be replaced while we hold a stripe lock. */
+    obtable_buckets *b = (obtable_buckets*)AO_load_acquire(&obtable.buckets);
+    r = obtable_search(b, sym->name, hv);
+    if (r == NULL) {
+        obtable_push(b, sym, hv);
+        r = sym;
+        u_long cnt = AO_fetch_and_add1_full(&obtable.count) + 1;
+        grow = (cnt > b->size * OBTABLE_MAX_LOAD);
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(*OBTABLE_STRIPE(hv));
+    if (grow) obtable_grow();
+    return r;
+}
+
+/* Used by init_builtin_syms() */
+static void obtable_intern_static(ScmObj name, ScmSymbol *sym)
+{
+    (void)obtable_intern(sym, Scm_HashString(SCM_STRING(name), 0));
+}
 
 #if GAUCHE_KEEP_DISJOINT_KEYWORD_OPTION
 /* Global keyword table. */
@@ -72,12 +206,12 @@ static int keyword_disjoint_p = FALSE;
 /* internal constructor.  NAME must be an immutable string. */
 static ScmSymbol *make_sym(ScmClass *klass, ScmString *name, int interned)
 {
+    u_long hv = 0;
     if (interned) {
         /* fast path */
-        SCM_INTERNAL_MUTEX_LOCK(obtable_mutex);
-        ScmObj e = Scm_HashTableRef(obtable, SCM_OBJ(name), SCM_FALSE);
-        SCM_INTERNAL_MUTEX_UNLOCK(obtable_mutex);
-        if (!SCM_FALSEP(e)) return SCM_SYMBOL(e);
+        hv = Scm_HashString(name, 0);
+        ScmSymbol *e = obtable_lookup(name, hv);
+        if (e) return e;
     }
 
     ScmSymbol *sym = SCM_NEW(ScmSymbol);
@@ -88,14 +222,9 @@ static ScmSymbol *make_sym(ScmClass *klass, ScmString *name, int interned)
     if (!interned) {
         return sym;
     } else {
-        /* Using SCM_DICT_NO_OVERWRITE ensures that if another thread interns
-           the same name symbol between above HashTableRef and here, we'll
-           get the already interned symbol. */
-        SCM_INTERNAL_MUTEX_LOCK(obtable_mutex);
-        ScmObj e = Scm_HashTableSet(obtable, SCM_OBJ(name), SCM_OBJ(sym),
-                                    SCM_DICT_NO_OVERWRITE);
-        SCM_INTERNAL_MUTEX_UNLOCK(obtable_mutex);
-        return SCM_SYMBOL(e);
+        /* If another thread interns the same name symbol between above
+           lookup and here, we'll get the already interned symbol. */
+        return obtable_intern(sym, hv);
     }
 }
 
@@ -420,8 +549,11 @@ ScmObj Scm_DeleteKeywordX(ScmObj key, ScmObj list)
 
 void Scm__InitSymbol(void)
 {
-    SCM_INTERNAL_MUTEX_INIT(obtable_mutex);
-    obtable = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_STRING, 4096));
+    for (int i=0; i<OBTABLE_NSTRIPES; i++) {
+        SCM_INTERNAL_MUTEX_INIT(obtable.stripe[i]);
+    }
+    obtable.count = 0;
+    obtable.buckets = (AO_t)obtable_alloc_buckets(OBTABLE_INITIAL_SIZE);
     init_builtin_syms();
 #if GAUCHE_KEEP_DISJOINT_KEYWORD_OPTION
     (void)SCM_INTERNAL_MUTEX_INIT(keywords.mutex);
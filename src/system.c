@@ -62,6 +62,10 @@ extern char **environ;
    We need to use _NSGetEnviron(), and this header defines it. */
 #include <crt_externs.h>
 # endif /* HAVE_CRT_EXTERNS_H */
+# if defined(HAVE_SPAWN_H) && defined(HAVE_POSIX_SPAWNP)
+#include <spawn.h>
+#define USE_POSIX_SPAWN 1
+# endif
 #else   /* GAUCHE_WINDOWS */
 #include <lm.h>
 #include <tlhelp32.h>
@@ -76,6 +80,14 @@ static int win_wait_for_handles(HANDLE *handles, int nhandles, int options,
 #ifdef HAVE_SCHED_H
 #include <sched.h>
 #endif
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#elif defined(HAVE_SYS_EVENT_H)
+#include <sys/event.h>
+#elif defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+#include <limits.h>
 
 /*
  * Auxiliary system interface functions.   See syslib.stub for
@@ -247,6 +259,176 @@ ScmObj Scm_ReadDirectory(ScmString *pathname)
 #endif
 }
 
+/*
+ * Directory stream
+ *
+ *   If the system has openat() family, a directory opened relative to
+ *   a parent stream is opened by openat() on the parent's descriptor,
+ *   and entries are stat()-ed by fstatat(), so that the kernel doesn't
+ *   need to resolve the whole path again for every entry of a deep tree.
+ */
+#if !defined(GAUCHE_WINDOWS) && defined(HAVE_OPENAT) \
+    && defined(HAVE_FDOPENDIR) && defined(HAVE_FSTATAT)
+#define USE_DIR_FD 1
+#endif
+
+static void sysdir_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    ScmSysDir *d = SCM_SYS_DIR(obj);
+    Scm_Printf(port, "#<sys-dir %S%s>", d->path, d->closed? " (closed)" : "");
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_SysDirClass, sysdir_print);
+
+static void sysdir_finalize(ScmObj obj, void *data)
+{
+    Scm_CloseDirectory(SCM_SYS_DIR(obj));
+}
+
+static void sysdir_check(ScmSysDir *d)
+{
+    if (d->closed) Scm_Error("directory already closed: %S", d);
+}
+
+#if !defined(USE_DIR_FD)
+/* The pathname of NAME in the directory D, for the systems that can't
+   open or stat relative to a directory stream. */
+static ScmString *sysdir_path(ScmSysDir *d, ScmString *name)
+{
+    if (d == NULL) return name;
+    ScmObj p = Scm_StringAppendC(d->path, "/", 1, 1);
+    return SCM_STRING(Scm_StringAppend2(SCM_STRING(p), name));
+}
+#endif /*!USE_DIR_FD*/
+
+/* If PARENT is given, PATH is relative to it. */
+ScmObj Scm_OpenDirectory(ScmString *path, ScmSysDir *parent)
+{
+    ScmSysDir *d = SCM_NEW(ScmSysDir);
+    SCM_SET_CLASS(d, SCM_CLASS_SYS_DIR);
+    d->dirp = NULL;
+    d->entries = SCM_NIL;
+    d->closed = FALSE;
+    if (parent) sysdir_check(parent);
+#if !defined(USE_DIR_FD)
+    d->path = sysdir_path(parent, path);
+#else
+    d->path = path;
+#endif
+
+#if !defined(GAUCHE_WINDOWS)
+    DIR *dirp;
+#if defined(USE_DIR_FD)
+    if (parent) {
+        int fd;
+        SCM_SYSCALL(fd, openat(dirfd((DIR*)parent->dirp),
+                               Scm_GetStringConst(path),
+                               O_RDONLY|O_DIRECTORY|O_CLOEXEC));
+        if (fd < 0) Scm_SysError("couldn't open directory %S", path);
+        dirp = fdopendir(fd);
+        if (dirp == NULL) {
+            int e = errno;
+            close(fd);
+            errno = e;
+        }
+    } else {
+        dirp = opendir(Scm_GetStringConst(path));
+    }
+#else  /*!USE_DIR_FD*/
+    dirp = opendir(Scm_GetStringConst(d->path));
+#endif /*!USE_DIR_FD*/
+    if (dirp == NULL) {
+        SCM_SIGCHECK(Scm_VM());
+        Scm_SysError("couldn't open directory %S", path);
+    }
+    d->dirp = dirp;
+    Scm_RegisterFinalizer(SCM_OBJ(d), sysdir_finalize, NULL);
+#else  /*GAUCHE_WINDOWS*/
+    d->entries = Scm_ReadDirectory(d->path);
+#endif /*GAUCHE_WINDOWS*/
+    return SCM_OBJ(d);
+}
+
+#if !defined(GAUCHE_WINDOWS) && defined(DT_UNKNOWN)
+static ScmObj dtype_to_symbol(int type)
+{
+    switch (type) {
+    case DT_REG:  return SCM_SYM_REGULAR;
+    case DT_DIR:  return SCM_SYM_DIRECTORY;
+    case DT_LNK:  return SCM_SYM_SYMLINK;
+    case DT_FIFO: return SCM_SYM_FIFO;
+    case DT_SOCK: return SCM_SYM_SOCKET;
+    case DT_CHR:  return SCM_SYM_CHARACTER;
+    case DT_BLK:  return SCM_SYM_BLOCK;
+    default:      return SCM_FALSE;
+    }
+}
+#endif
+
+/* Returns the next entry name, or EOF.  *TYPE gets the same symbol as
+   the type slot of <sys-stat> (without following symlinks), or #f if
+   the system doesn't tell it. */
+ScmObj Scm_ReadDirectoryEntry(ScmSysDir *d, ScmObj *type)
+{
+    sysdir_check(d);
+    *type = SCM_FALSE;
+#if !defined(GAUCHE_WINDOWS)
+    struct dirent *dire;
+    errno = 0;
+    dire = readdir((DIR*)d->dirp);
+    if (dire == NULL) {
+        if (errno != 0) Scm_SysError("reading directory %S failed", d->path);
+        return SCM_EOF;
+    }
+#if defined(DT_UNKNOWN)
+    *type = dtype_to_symbol(dire->d_type);
+#endif
+    return SCM_MAKE_STR_COPYING(dire->d_name);
+#else  /*GAUCHE_WINDOWS*/
+    if (SCM_NULLP(d->entries)) return SCM_EOF;
+    ScmObj name = SCM_CAR(d->entries);
+    d->entries = SCM_CDR(d->entries);
+    return name;
+#endif /*GAUCHE_WINDOWS*/
+}
+
+void Scm_CloseDirectory(ScmSysDir *d)
+{
+    if (d->closed) return;
+    d->closed = TRUE;
+#if !defined(GAUCHE_WINDOWS)
+    if (d->dirp) {
+        closedir((DIR*)d->dirp);
+        d->dirp = NULL;
+    }
+#endif
+    d->entries = SCM_NIL;
+}
+
+/* stat() of NAME in the directory D.  If FOLLOW is false, the symlink
+   itself is examined. */
+ScmObj Scm_DirectoryStat(ScmSysDir *d, ScmString *name, int follow)
+{
+    sysdir_check(d);
+    ScmObj s = Scm_MakeSysStat();
+    int r;
+#if defined(USE_DIR_FD)
+    SCM_SYSCALL(r, fstatat(dirfd((DIR*)d->dirp), Scm_GetStringConst(name),
+                           SCM_SYS_STAT_STAT(s),
+                           follow? 0 : AT_SYMLINK_NOFOLLOW));
+#elif !defined(GAUCHE_WINDOWS)
+    const char *p = Scm_GetStringConst(sysdir_path(d, name));
+    if (follow) SCM_SYSCALL(r, stat(p, SCM_SYS_STAT_STAT(s)));
+    else        SCM_SYSCALL(r, lstat(p, SCM_SYS_STAT_STAT(s)));
+#else  /*GAUCHE_WINDOWS*/
+    /* No symlinks to care about. */
+    const char *p = Scm_GetStringConst(sysdir_path(d, name));
+    SCM_SYSCALL(r, stat(p, SCM_SYS_STAT_STAT(s)));
+#endif
+    if (r < 0) Scm_SysError("stat failed for %S in %S", name, d->path);
+    return s;
+}
+
 /* getcwd compatibility layer.
    Some implementations of getcwd accepts NULL as buffer to allocate
    enough buffer memory in it, but that's not standardized and we avoid
@@ -876,6 +1058,204 @@ static ScmClassStaticSlotSpec stat_slots[] = {
     SCM_CLASS_SLOT_SPEC_END()
 };
 
+/*
+ * Batched filesystem operations
+ *
+ *   Stat-ing or reading many files costs a syscall or a few each, and
+ *   most of the time is spent waiting the filesystem.  We run them on
+ *   several helper threads and collect the results in a vector.
+ *   The helper threads aren't known to GC, so they don't allocate;
+ *   stat buffers are prepared beforehand, and file contents are read
+ *   into malloc-ed buffers and copied afterwards.
+ */
+enum {
+    BATCH_STAT,
+    BATCH_LSTAT,
+    BATCH_READ
+};
+
+#define BATCH_CLAIM        8    /* # of entries a thread takes at once */
+#define BATCH_MAX_THREADS  16
+
+typedef struct batch_entry_rec {
+    const char *path;
+    ScmObj stat;                /* <sys-stat>, BATCH_STAT/LSTAT */
+    unsigned char *buf;         /* malloc-ed, BATCH_READ */
+    size_t size;
+    int ok;
+} batch_entry;
+
+typedef struct batch_rec {
+    int op;
+    batch_entry *entries;
+    ScmSmallInt count;
+    ScmSmallInt next;               /* first entry not taken yet */
+#if defined(GAUCHE_USE_PTHREADS)
+    pthread_mutex_t mutex;
+#endif
+} batch;
+
+#if !defined(O_BINARY)
+#define O_BINARY 0
+#endif
+
+/* Reads the whole file.  We don't trust st_size, for some files (e.g.
+   in /proc) report 0. */
+static int batch_read_file(batch_entry *e)
+{
+    int fd, r;
+    struct stat st;
+    SCM_SYSCALL(fd, open(e->path, O_RDONLY|O_BINARY));
+    if (fd < 0) return FALSE;
+    size_t cap = 4096, len = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) cap = (size_t)st.st_size + 1;
+    unsigned char *buf = malloc(cap);
+    for (;;) {
+        if (buf == NULL) break;
+        if (len == cap) {
+            unsigned char *nbuf = realloc(buf, cap*2);
+            if (nbuf == NULL) { free(buf); buf = NULL; break; }
+            buf = nbuf;
+            cap *= 2;
+        }
+        SCM_SYSCALL(r, read(fd, buf+len, cap-len));
+        if (r < 0) { free(buf); buf = NULL; break; }
+        if (r == 0) break;
+        len += r;
+    }
+    close(fd);
+    if (buf == NULL) return FALSE;
+    e->buf = buf;
+    e->size = len;
+    return TRUE;
+}
+
+static void batch_run_entry(batch *b, batch_entry *e)
+{
+    int r;
+    switch (b->op) {
+    case BATCH_STAT:
+        SCM_SYSCALL(r, stat(e->path, SCM_SYS_STAT_STAT(e->stat)));
+        e->ok = (r == 0);
+        break;
+    case BATCH_LSTAT:
+#if !defined(GAUCHE_WINDOWS)
+        SCM_SYSCALL(r, lstat(e->path, SCM_SYS_STAT_STAT(e->stat)));
+#else
+        SCM_SYSCALL(r, stat(e->path, SCM_SYS_STAT_STAT(e->stat)));
+#endif
+        e->ok = (r == 0);
+        break;
+    case BATCH_READ:
+        e->ok = batch_read_file(e);
+        break;
+    }
+}
+
+/* Takes the next range of entries.  Returns FALSE if nothing is left. */
+static int batch_claim(batch *b, ScmSmallInt *start, ScmSmallInt *end)
+{
+#if defined(GAUCHE_USE_PTHREADS)
+    (void)pthread_mutex_lock(&b->mutex);
+#endif
+    *start = b->next;
+    *end = (b->next + BATCH_CLAIM > b->count)? b->count : b->next+BATCH_CLAIM;
+    b->next = *end;
+#if defined(GAUCHE_USE_PTHREADS)
+    (void)pthread_mutex_unlock(&b->mutex);
+#endif
+    return *start < *end;
+}
+
+static void *batch_worker(void *data)
+{
+    batch *b = (batch*)data;
+    ScmSmallInt start, end;
+    while (batch_claim(b, &start, &end)) {
+        for (ScmSmallInt i = start; i < end; i++) batch_run_entry(b, &b->entries[i]);
+    }
+    return NULL;
+}
+
+/* NTHREADS <= 0 to choose the default.  The calling thread works, too. */
+static void batch_run(batch *b, int nthreads)
+{
+#if defined(GAUCHE_USE_PTHREADS)
+    pthread_t threads[BATCH_MAX_THREADS];
+    int nstarted = 0;
+
+    if (nthreads <= 0) nthreads = Scm_AvailableProcessors() * 2;
+    if (nthreads > BATCH_MAX_THREADS) nthreads = BATCH_MAX_THREADS;
+    if (nthreads > (b->count + BATCH_CLAIM - 1) / BATCH_CLAIM) {
+        nthreads = (int)((b->count + BATCH_CLAIM - 1) / BATCH_CLAIM);
+    }
+    (void)pthread_mutex_init(&b->mutex, NULL);
+    /* If we can't start a thread, we just do more by ourselves. */
+    for (; nstarted < nthreads - 1; nstarted++) {
+        if (pthread_create(&threads[nstarted], NULL, batch_worker, b) != 0)
+            break;
+    }
+    batch_worker(b);
+    for (int i = 0; i < nstarted; i++) (void)pthread_join(threads[i], NULL);
+    (void)pthread_mutex_destroy(&b->mutex);
+#else  /*!GAUCHE_USE_PTHREADS*/
+    (void)nthreads;
+    batch_worker(b);
+#endif /*!GAUCHE_USE_PTHREADS*/
+}
+
+static void batch_init(batch *b, int op, ScmObj paths)
+{
+    ScmObj v = SCM_VECTORP(paths)? paths : Scm_ListToVector(paths, 0, -1);
+    b->op = op;
+    b->count = SCM_VECTOR_SIZE(v);
+    b->next = 0;
+    b->entries = SCM_NEW_ARRAY(batch_entry, b->count);
+    for (ScmSmallInt i = 0; i < b->count; i++) {
+        ScmObj p = SCM_VECTOR_ELEMENT(v, i);
+        if (!SCM_STRINGP(p)) SCM_TYPE_ERROR(p, "string");
+        b->entries[i].path = Scm_GetStringConst(SCM_STRING(p));
+        b->entries[i].stat = (op == BATCH_READ)? SCM_FALSE : Scm_MakeSysStat();
+        b->entries[i].buf = NULL;
+        b->entries[i].size = 0;
+        b->entries[i].ok = FALSE;
+    }
+}
+
+/* Returns a vector of <sys-stat>s of PATHS, a list or a vector of
+   pathnames.  The entry is #f if stat() fails. */
+ScmObj Scm_SysStatBatch(ScmObj paths, int follow, int nthreads)
+{
+    batch b;
+    batch_init(&b, follow? BATCH_STAT : BATCH_LSTAT, paths);
+    batch_run(&b, nthreads);
+    ScmObj r = Scm_MakeVector(b.count, SCM_FALSE);
+    for (ScmSmallInt i = 0; i < b.count; i++) {
+        if (b.entries[i].ok) SCM_VECTOR_ELEMENT(r, i) = b.entries[i].stat;
+    }
+    SCM_SIGCHECK(Scm_VM());
+    return r;
+}
+
+/* Returns a vector of the contents of the files as u8vectors.  The entry
+   is #f if the file can't be read. */
+ScmObj Scm_ReadFileBatch(ScmObj paths, int nthreads)
+{
+    batch b;
+    batch_init(&b, BATCH_READ, paths);
+    batch_run(&b, nthreads);
+    ScmObj r = Scm_MakeVector(b.count, SCM_FALSE);
+    for (ScmSmallInt i = 0; i < b.count; i++) {
+        batch_entry *e = &b.entries[i];
+        if (!e->ok) continue;
+        SCM_VECTOR_ELEMENT(r, i) = Scm_MakeU8VectorFromArray(e->size, e->buf);
+        free(e->buf);
+        e->buf = NULL;
+    }
+    SCM_SIGCHECK(Scm_VM());
+    return r;
+}
+
 /*===============================================================
  * Time (sys/time.h and time.h)
  */
@@ -1039,6 +1419,87 @@ long Scm_CurrentMicroseconds()
     return (long)usec;
 }
 
+/* Nanoseconds from an unspecified origin, of the monotonic clock if the
+   system has one.  The value fits in a fixnum on 64-bit architectures
+   (for a couple of centuries), so it's allocation-free to get it from
+   Scheme. */
+ScmInt64 Scm_MonotonicNanoseconds(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    ScmTimeSpec ts;
+    int r;
+    SCM_SYSCALL(r, clock_gettime(CLOCK_MONOTONIC, &ts));
+    if (r < 0) Scm_SysError("clock_gettime failed");
+    return (ScmInt64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#elif defined(GAUCHE_WINDOWS)
+    static LARGE_INTEGER freq = { 0 };
+    LARGE_INTEGER count;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    /* Split to avoid overflow of count * 10^9 */
+    return (count.QuadPart / freq.QuadPart) * 1000000000
+        + (count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#else
+    u_long sec, usec;
+    Scm_GetTimeOfDay(&sec, &usec);
+    return (ScmInt64)sec * 1000000000 + (ScmInt64)usec * 1000;
+#endif
+}
+
+/* Cycle counter.  We read the time stamp counter on x86 and the virtual
+   counter on ARM64 directly; the cost is a few nanoseconds, much less
+   than a system call.  On other platforms it falls back to
+   Scm_MonotonicNanoseconds.  The value is truncated to fit in a fixnum,
+   so take differences of nearby readings. */
+#if (defined(__GNUC__) || defined(__clang__)) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define CYCLE_COUNTER_TSC 1
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+#define CYCLE_COUNTER_CNTVCT 1
+#endif
+
+ScmSmallInt Scm_CycleCounter(void)
+{
+#if defined(CYCLE_COUNTER_TSC)
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+    return (ScmSmallInt)((((uint64_t)hi << 32) | lo) & SCM_SMALL_INT_MAX);
+#elif defined(CYCLE_COUNTER_CNTVCT)
+    uint64_t v;
+    __asm__ __volatile__ ("isb; mrs %0, cntvct_el0" : "=r"(v) :: "memory");
+    return (ScmSmallInt)(v & SCM_SMALL_INT_MAX);
+#else
+    return (ScmSmallInt)(Scm_MonotonicNanoseconds() & SCM_SMALL_INT_MAX);
+#endif
+}
+
+/* Counts per second of Scm_CycleCounter.  The TSC is calibrated against
+   the monotonic clock once, which takes about 10ms.  The TSC of modern
+   x86 runs at a constant rate, but older CPUs may change it with the
+   clock frequency; we don't try to detect that. */
+double Scm_CycleCounterFrequency(void)
+{
+#if defined(CYCLE_COUNTER_TSC)
+    static double freq = 0.0;   /* races are harmless */
+    if (freq == 0.0) {
+        ScmInt64 t0 = Scm_MonotonicNanoseconds(), t1;
+        ScmSmallInt c0 = Scm_CycleCounter(), c1;
+        do {
+            t1 = Scm_MonotonicNanoseconds();
+        } while (t1 - t0 < 10000000);
+        c1 = Scm_CycleCounter();
+        freq = (double)(c1 - c0) * 1.0e9 / (double)(t1 - t0);
+    }
+    return freq;
+#elif defined(CYCLE_COUNTER_CNTVCT)
+    uint64_t f;
+    __asm__ __volatile__ ("mrs %0, cntfrq_el0" : "=r"(f));
+    return (double)f;
+#else
+    return 1.0e9;
+#endif
+}
+
 ScmObj Scm_CurrentTime(void)
 {
     u_long sec, usec;
@@ -1632,7 +2093,94 @@ char *win_create_command_line(ScmObj args)
  *   On Windows port, this returns a process handle obejct instead of
  *   pid of the child process in fork mode.  We need to keep handle, or
  *   the process exit status will be lost when the child process terminates.
+ *
+ *   On Unix, fork mode uses posix_spawn() instead of fork() when it can
+ *   do the same thing (see try_spawn below), unless SCM_EXEC_NO_SPAWN
+ *   is given.  fork() copies the page table of the whole process, which
+ *   takes a long time if we have a large heap; posix_spawn() can avoid it
+ *   (e.g. glibc uses clone(CLONE_VM|CLONE_VFORK)).
  */
+
+#if defined(USE_POSIX_SPAWN)
+/* Translate the fd map prepared by Scm_SysPrepareFdMap into file actions,
+   doing the same thing as Scm_SysSwapFds.  FDS isn't modified, for
+   we may fall back to fork() with it. */
+static int spawn_fd_actions(posix_spawn_file_actions_t *acts, int *fds)
+{
+#if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP)
+    int nfds = fds[0];
+    int *tofd = fds + 1;
+    int *fromfd = SCM_NEW_ATOMIC_ARRAY(int, nfds);
+    int top = 0;                /* lowest fd we can use as a temporary */
+    int closefrom = 0;          /* fds above tofd's are all closed */
+
+    for (int i=0; i<nfds; i++) {
+        fromfd[i] = fds[1+nfds+i];
+        if (tofd[i] >= top) top = tofd[i] + 1;
+        if (fromfd[i] >= top) top = fromfd[i] + 1;
+        if (tofd[i] >= closefrom) closefrom = tofd[i] + 1;
+    }
+
+    for (int i=0; i<nfds; i++) {
+        if (tofd[i] == fromfd[i]) continue;
+        for (int j=i+1; j<nfds; j++) {
+            if (tofd[i] == fromfd[j]) {
+                if (posix_spawn_file_actions_adddup2(acts, tofd[i], top) != 0)
+                    return FALSE;
+                fromfd[j] = top++;
+            }
+        }
+        if (posix_spawn_file_actions_adddup2(acts, fromfd[i], tofd[i]) != 0)
+            return FALSE;
+    }
+
+    /* Closing a fd that isn't open is not an error in file actions. */
+    for (int fd=0; fd<closefrom; fd++) {
+        int j;
+        for (j=0; j<nfds; j++) if (fd == tofd[j]) break;
+        if (j == nfds && posix_spawn_file_actions_addclose(acts, fd) != 0)
+            return FALSE;
+    }
+    return (posix_spawn_file_actions_addclosefrom_np(acts, closefrom) == 0);
+#else  /*!HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP*/
+    /* We can't close the fds not in the map. */
+    (void)acts;
+    (void)fds;
+    return FALSE;
+#endif /*!HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCLOSEFROM_NP*/
+}
+
+/* Spawns PROGRAM if we can do it without fork().  Returns TRUE and sets
+   *PID on success.  Returns FALSE if the request can't be expressed with
+   posix_spawn, or posix_spawn failed; the caller falls back to fork(),
+   which handles and reports the failure as it used to. */
+static int try_spawn(const char *program, char **argv, int *fds,
+                     const char *cdir, pid_t *pid)
+{
+#if !defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP)
+    if (cdir != NULL) return FALSE;
+#endif
+    posix_spawn_file_actions_t acts;
+    if (posix_spawn_file_actions_init(&acts) != 0) return FALSE;
+
+    int ok = TRUE;
+#if defined(HAVE_POSIX_SPAWN_FILE_ACTIONS_ADDCHDIR_NP)
+    if (cdir != NULL) {
+        ok = (posix_spawn_file_actions_addchdir_np(&acts, cdir) == 0);
+    }
+#endif
+    if (ok && fds != NULL) ok = spawn_fd_actions(&acts, fds);
+    if (ok) {
+#  if defined(HAVE_CRT_EXTERNS_H)
+        char **environ = *_NSGetEnviron();  /* OSX Hack*/
+#  endif
+        ok = (posix_spawnp(pid, program, &acts, NULL, argv, environ) == 0);
+    }
+    posix_spawn_file_actions_destroy(&acts);
+    return ok;
+}
+#endif /*USE_POSIX_SPAWN*/
+
 ScmObj Scm_SysExec(ScmString *file, ScmObj args, ScmObj iomap,
                    ScmSysSigset *mask, ScmString *dir, int flags)
 {
@@ -1662,6 +2210,17 @@ ScmObj Scm_SysExec(ScmString *file, ScmObj args, ScmObj iomap,
     const char *cdir = NULL;
     if (dir != NULL) cdir = Scm_GetStringConst(dir);
 
+#if defined(USE_POSIX_SPAWN)
+    /* Detaching needs setsid() in the intermediate child, and sigmask
+       needs ignoring the signals (Scm_ResetSignalHandlers), neither of
+       which posix_spawn can do. */
+    if (forkp && !detachp && mask == NULL && !(flags & SCM_EXEC_NO_SPAWN)) {
+        if (try_spawn(program, argv, fds, cdir, &pid)) {
+            return Scm_MakeInteger(pid);
+        }
+    }
+#endif /*USE_POSIX_SPAWN*/
+
     /* When requested, call fork() here. */
     if (forkp) {
         SCM_SYSCALL(pid, fork());
@@ -2248,6 +2807,284 @@ ScmObj Scm_SysSelectX(ScmObj rfds, ScmObj wfds, ScmObj efds, ScmObj timeout)
 
 #endif /* HAVE_SELECT */
 
+/*===============================================================
+ * poller
+ *
+ *   There are three backends, chosen at compile time: epoll, kqueue
+ *   and poll(2).  The first two keep the set of descriptors in the
+ *   kernel; with poll we keep an array of struct pollfd.
+ *
+ *   kqueue registers read and write as separate filters, so we remember
+ *   which ones we've registered for each descriptor in an array indexed
+ *   by fd (poller->fds).  Note that kqueue has no filter for error
+ *   conditions alone; a descriptor registered with only
+ *   SCM_SYS_POLL_ERROR is counted but not actually watched.  Errors
+ *   on a read or write filter are reported as usual.
+ */
+
+#if defined(GAUCHE_HAVE_SYS_POLLER)
+
+#if defined(HAVE_SYS_EPOLL_H)
+#define POLLER_EPOLL 1
+#elif defined(HAVE_SYS_EVENT_H)
+#define POLLER_KQUEUE 1
+#else
+#define POLLER_POLL 1
+#endif
+
+#define POLLER_NEVENTS 256      /* max # of events to take at once */
+
+static void poller_finalize(ScmObj obj, void *data)
+{
+    Scm_SysPollerClose(SCM_SYS_POLLER(obj));
+}
+
+static void poller_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
+{
+    ScmSysPoller *p = SCM_SYS_POLLER(obj);
+    Scm_Printf(port, "#<sys-poller %d fds%s%s>", p->nfds,
+               (p->flags & SCM_SYS_POLLER_EDGE)? " edge" : "",
+               (p->size < 0)? " (closed)" : "");
+}
+
+SCM_DEFINE_BUILTIN_CLASS_SIMPLE(Scm_SysPollerClass, poller_print);
+
+/* Converts the timeout given in the same way as sys-select to
+   milliseconds; -1 for no timeout. */
+static int poller_timeout(ScmObj timeout)
+{
+    struct timeval tm;
+    if (select_timeval(timeout, &tm) == NULL) return -1;
+    if (tm.tv_sec >= INT_MAX/1000) return INT_MAX;
+    /* round up, so that we don't busy-loop on a short timeout */
+    return (int)(tm.tv_sec*1000 + (tm.tv_usec + 999)/1000);
+}
+
+static void poller_check(ScmSysPoller *poller)
+{
+    if (poller->size < 0) Scm_Error("poller already closed: %S", poller);
+}
+
+/* FLAGS may have SCM_SYS_POLLER_EDGE, to make the poller edge-triggered;
+   that is, a descriptor is reported once when it becomes ready, and not
+   again until the condition is cleared (e.g. by reading all the available
+   data) and raised again. */
+ScmObj Scm_MakeSysPoller(int flags)
+{
+#if defined(POLLER_POLL)
+    if (flags & SCM_SYS_POLLER_EDGE) {
+        Scm_Error("edge-triggered poller isn't supported on this platform");
+    }
+#endif /*POLLER_POLL*/
+    ScmSysPoller *poller = SCM_NEW(ScmSysPoller);
+    SCM_SET_CLASS(poller, SCM_CLASS_SYS_POLLER);
+    poller->epfd = -1;
+    poller->flags = flags;
+    poller->nfds = 0;
+    poller->size = 0;
+    poller->fds = NULL;
+#if defined(POLLER_EPOLL) || defined(POLLER_KQUEUE)
+    int fd;
+#if defined(POLLER_EPOLL)
+    SCM_SYSCALL(fd, epoll_create(64));
+    if (fd < 0) Scm_SysError("epoll_create failed");
+#else  /*POLLER_KQUEUE*/
+    SCM_SYSCALL(fd, kqueue());
+    if (fd < 0) Scm_SysError("kqueue failed");
+#endif /*POLLER_KQUEUE*/
+    (void)fcntl(fd, F_SETFD, FD_CLOEXEC);
+    poller->epfd = fd;
+    Scm_RegisterFinalizer(SCM_OBJ(poller), poller_finalize, NULL);
+#endif /*POLLER_EPOLL || POLLER_KQUEUE*/
+    return SCM_OBJ(poller);
+}
+
+void Scm_SysPollerClose(ScmSysPoller *poller)
+{
+    if (poller->size < 0) return;
+    if (poller->epfd >= 0) {
+        close(poller->epfd);
+        poller->epfd = -1;
+    }
+    poller->fds = NULL;
+    poller->nfds = 0;
+    poller->size = -1;
+}
+
+#if defined(POLLER_KQUEUE)
+/* Adds or deletes one kqueue filter.  Deleting a filter that isn't there
+   is not an error; kqueue drops filters by itself when the descriptor
+   is closed. */
+static void kqueue_change(ScmSysPoller *poller, int fd, int filter, int add)
+{
+    struct kevent kev;
+    int r;
+    EV_SET(&kev, fd, filter,
+           add? (EV_ADD | ((poller->flags & SCM_SYS_POLLER_EDGE)? EV_CLEAR : 0))
+              : EV_DELETE,
+           0, 0, NULL);
+    SCM_SYSCALL(r, kevent(poller->epfd, &kev, 1, NULL, 0, NULL));
+    if (r < 0 && (add || (errno != ENOENT && errno != EBADF))) {
+        Scm_SysError("kevent failed on fd %d", fd);
+    }
+}
+#endif /*POLLER_KQUEUE*/
+
+/* Sets the events to wait on FD, which is a logior of SCM_SYS_POLL_READ
+   and SCM_SYS_POLL_WRITE.  Error conditions are always reported;
+   SCM_SYS_POLL_ERROR alone keeps FD registered just for them.
+   Zero removes FD from the poller. */
+void Scm_SysPollerSet(ScmSysPoller *poller, int fd, int events)
+{
+    poller_check(poller);
+    if (fd < 0) Scm_Error("invalid file descriptor: %d", fd);
+#if defined(POLLER_EPOLL)
+    struct epoll_event ev;
+    int r;
+    ev.events = ((events & SCM_SYS_POLL_READ)? EPOLLIN : 0)
+        | ((events & SCM_SYS_POLL_WRITE)? EPOLLOUT : 0)
+        | ((poller->flags & SCM_SYS_POLLER_EDGE)? EPOLLET : 0);
+    ev.data.fd = fd;
+    if (events == 0) {
+        SCM_SYSCALL(r, epoll_ctl(poller->epfd, EPOLL_CTL_DEL, fd, &ev));
+        if (r < 0 && errno != ENOENT && errno != EBADF) {
+            Scm_SysError("epoll_ctl failed on fd %d", fd);
+        }
+        if (r == 0) poller->nfds--;
+        return;
+    }
+    SCM_SYSCALL(r, epoll_ctl(poller->epfd, EPOLL_CTL_MOD, fd, &ev));
+    if (r < 0 && errno == ENOENT) {
+        SCM_SYSCALL(r, epoll_ctl(poller->epfd, EPOLL_CTL_ADD, fd, &ev));
+        if (r == 0) poller->nfds++;
+    }
+    if (r < 0) Scm_SysError("epoll_ctl failed on fd %d", fd);
+#elif defined(POLLER_KQUEUE)
+    unsigned char *regs = (unsigned char*)poller->fds;
+    int old = (fd < poller->size)? regs[fd] : 0;
+    if (events == 0 && old == 0) return;
+    if (fd >= poller->size) {
+        int newsize = (poller->size < 64)? 64 : poller->size;
+        while (newsize <= fd) newsize *= 2;
+        unsigned char *newregs = SCM_NEW_ATOMIC_ARRAY(unsigned char, newsize);
+        memset(newregs, 0, newsize);
+        if (poller->size > 0) memcpy(newregs, regs, poller->size);
+        poller->fds = regs = newregs;
+        poller->size = newsize;
+    }
+    if (events & SCM_SYS_POLL_READ) {
+        kqueue_change(poller, fd, EVFILT_READ, TRUE);
+    } else if (old & SCM_SYS_POLL_READ) {
+        kqueue_change(poller, fd, EVFILT_READ, FALSE);
+    }
+    if (events & SCM_SYS_POLL_WRITE) {
+        kqueue_change(poller, fd, EVFILT_WRITE, TRUE);
+    } else if (old & SCM_SYS_POLL_WRITE) {
+        kqueue_change(poller, fd, EVFILT_WRITE, FALSE);
+    }
+    regs[fd] = (unsigned char)events;
+    if (old == 0) poller->nfds++;
+    else if (events == 0) poller->nfds--;
+#else  /*POLLER_POLL*/
+    struct pollfd *fds = (struct pollfd*)poller->fds;
+    int i;
+    for (i=0; i<poller->nfds; i++) {
+        if (fds[i].fd == fd) break;
+    }
+    if (events == 0) {
+        if (i < poller->nfds) fds[i] = fds[--poller->nfds];
+        return;
+    }
+    if (i == poller->nfds) {
+        if (poller->nfds == poller->size) {
+            int newsize = (poller->size < 16)? 16 : poller->size*2;
+            struct pollfd *newfds = SCM_NEW_ATOMIC_ARRAY(struct pollfd,
+                                                         newsize);
+            if (poller->nfds > 0) {
+                memcpy(newfds, fds, sizeof(struct pollfd)*poller->nfds);
+            }
+            poller->fds = fds = newfds;
+            poller->size = newsize;
+        }
+        fds[i].fd = fd;
+        poller->nfds++;
+    }
+    fds[i].events = ((events & SCM_SYS_POLL_READ)? POLLIN : 0)
+        | ((events & SCM_SYS_POLL_WRITE)? POLLOUT : 0);
+    fds[i].revents = 0;
+#endif /*POLLER_POLL*/
+}
+
+/* Waits until any of the registered descriptors gets ready, or TIMEOUT
+   passes.  Returns a list of (fd . events) for the ready ones; an
+   empty list on timeout. */
+ScmObj Scm_SysPollerWait(ScmSysPoller *poller, ScmObj timeout)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    int ms = poller_timeout(timeout), n;
+    poller_check(poller);
+#if defined(POLLER_EPOLL)
+    struct epoll_event evs[POLLER_NEVENTS];
+    SCM_SYSCALL(n, epoll_wait(poller->epfd, evs, POLLER_NEVENTS, ms));
+    if (n < 0) Scm_SysError("epoll_wait failed");
+    for (int i=0; i<n; i++) {
+        int e = ((evs[i].events & (EPOLLIN|EPOLLHUP))? SCM_SYS_POLL_READ : 0)
+            | ((evs[i].events & EPOLLOUT)? SCM_SYS_POLL_WRITE : 0)
+            | ((evs[i].events & EPOLLERR)? SCM_SYS_POLL_ERROR : 0);
+        SCM_APPEND1(h, t, Scm_Cons(SCM_MAKE_INT(evs[i].data.fd),
+                                   SCM_MAKE_INT(e)));
+    }
+#elif defined(POLLER_KQUEUE)
+    struct kevent evs[POLLER_NEVENTS];
+    struct timespec ts, *pts = NULL;
+    int rfd[POLLER_NEVENTS], rev[POLLER_NEVENTS], nr = 0;
+    if (ms >= 0) {
+        ts.tv_sec = ms/1000;
+        ts.tv_nsec = (ms%1000)*1000000L;
+        pts = &ts;
+    }
+    SCM_SYSCALL(n, kevent(poller->epfd, NULL, 0, evs, POLLER_NEVENTS, pts));
+    if (n < 0) Scm_SysError("kevent failed");
+    /* Read and write readiness of the same fd come as separate events;
+       merge them, so that the result is the same as other backends. */
+    for (int i=0; i<n; i++) {
+        int fd = (int)evs[i].ident, e = 0, j;
+        if (evs[i].flags & EV_ERROR) {
+            e = SCM_SYS_POLL_ERROR;
+        } else {
+            if (evs[i].filter == EVFILT_READ)  e |= SCM_SYS_POLL_READ;
+            if (evs[i].filter == EVFILT_WRITE) e |= SCM_SYS_POLL_WRITE;
+            if ((evs[i].flags & EV_EOF) && evs[i].fflags != 0) {
+                e |= SCM_SYS_POLL_ERROR; /* fflags has the socket error */
+            }
+        }
+        for (j=0; j<nr; j++) {
+            if (rfd[j] == fd) break;
+        }
+        if (j == nr) { rfd[nr] = fd; rev[nr] = 0; nr++; }
+        rev[j] |= e;
+    }
+    for (int i=0; i<nr; i++) {
+        SCM_APPEND1(h, t, Scm_Cons(SCM_MAKE_INT(rfd[i]), SCM_MAKE_INT(rev[i])));
+    }
+#else  /*POLLER_POLL*/
+    struct pollfd *fds = (struct pollfd*)poller->fds;
+    SCM_SYSCALL(n, poll(fds, poller->nfds, ms));
+    if (n < 0) Scm_SysError("poll failed");
+    for (int i=0; i<poller->nfds && n > 0; i++) {
+        short re = fds[i].revents;
+        if (re == 0) continue;
+        int e = ((re & (POLLIN|POLLHUP))? SCM_SYS_POLL_READ : 0)
+            | ((re & POLLOUT)? SCM_SYS_POLL_WRITE : 0)
+            | ((re & (POLLERR|POLLNVAL))? SCM_SYS_POLL_ERROR : 0);
+        SCM_APPEND1(h, t, Scm_Cons(SCM_MAKE_INT(fds[i].fd), SCM_MAKE_INT(e)));
+        n--;
+    }
+#endif /*POLLER_POLL*/
+    return h;
+}
+#endif /*GAUCHE_HAVE_SYS_POLLER*/
+
 /*===============================================================
  * Environment
  */
@@ -3114,8 +3951,12 @@ void Scm__InitSystem(void)
     Scm_InitStaticClass(&Scm_SysTmClass, "<sys-tm>", mod, tm_slots, 0);
     Scm_InitStaticClass(&Scm_SysGroupClass, "<sys-group>", mod, grp_slots, 0);
     Scm_InitStaticClass(&Scm_SysPasswdClass, "<sys-passwd>", mod, pwd_slots, 0);
+    Scm_InitStaticClass(&Scm_SysDirClass, "<sys-dir>", mod, NULL, 0);
 #ifdef HAVE_SELECT
     Scm_InitStaticClass(&Scm_SysFdsetClass, "<sys-fdset>", mod, NULL, 0);
+#endif
+#if defined(GAUCHE_HAVE_SYS_POLLER)
+    Scm_InitStaticClass(&Scm_SysPollerClass, "<sys-poller>", mod, NULL, 0);
 #endif
     SCM_INTERNAL_MUTEX_INIT(env_mutex);
     Scm_HashCoreInitSimple(&env_strings, SCM_HASH_STRING, 0, NULL);
@@ -45,6 +45,7 @@ typedef struct NodeRec {
     intptr_t     key;
     intptr_t     value;
     int          color;
+    int          size;          /* # of nodes in the subtree */
     struct NodeRec *parent;
     struct NodeRec *left;
     struct NodeRec *right;
@@ -66,6 +67,9 @@ enum TreeOp {
 
 #define PAINT(n, c)      (n->color = c)
 
+#define SIZE(n)          ((n)? (n)->size : 0)
+#define RESIZE(n)        ((n)->size = SIZE((n)->left) + SIZE((n)->right) + 1)
+
 /* The following three macros assume N has a parent. */
 #define LEFTP(n)         (n == n->parent->left)
 #define RIGHTP(n)        (n == n->parent->right)
@@ -88,6 +92,34 @@ static Node *prev_node(Node *n);
 static Node *delete_node(ScmTreeCore *tc, Node *n);
 static Node *copy_tree(Node *parent, Node *self);
 
+typedef struct BTEntryRec BTEntry;
+typedef struct BTLeafRec BTLeaf;
+
+static BTEntry *bt_ref(ScmTreeCore *tc, intptr_t key, enum TreeOp op,
+                       BTEntry **lo, BTEntry **hi);
+static BTEntry *bt_bound(ScmTreeCore *tc, ScmTreeCoreBoundOp op, int pop);
+static BTEntry *bt_next(BTEntry *e);
+static BTEntry *bt_prev(BTEntry *e);
+static int      bt_rank(ScmTreeCore *tc, intptr_t key);
+static BTEntry *bt_select(ScmTreeCore *tc, int k);
+static void    *bt_copy(void *n, BTLeaf **last);
+static void     bt_check(ScmTreeCore *tc);
+static void     bt_dump(void *n, int depth, ScmPort *out, int scmobj);
+
+#define BTREEP(tc)       ((tc)->kind == SCM_TREE_CORE_BTREE)
+
+/* Dispatches lookup to the implementation. */
+static ScmDictEntry *tree_ref(ScmTreeCore *tc, intptr_t key, enum TreeOp op,
+                              ScmDictEntry **lo, ScmDictEntry **hi)
+{
+    if (BTREEP(tc)) {
+        return (ScmDictEntry*)bt_ref(tc, key, op,
+                                     (BTEntry**)lo, (BTEntry**)hi);
+    } else {
+        return (ScmDictEntry*)core_ref(tc, key, op, (Node**)lo, (Node**)hi);
+    }
+}
+
 /*
  * Public API
  */
@@ -95,23 +127,41 @@ static Node *copy_tree(Node *parent, Node *self);
 void Scm_TreeCoreInit(ScmTreeCore *tc,
                       ScmTreeCoreCompareProc *cmp,
                       void *data)
+{
+    Scm_TreeCoreInitFull(tc, cmp, data, SCM_TREE_CORE_RB);
+}
+
+void Scm_TreeCoreInitFull(ScmTreeCore *tc,
+                          ScmTreeCoreCompareProc *cmp,
+                          void *data,
+                          ScmTreeCoreKind kind)
 {
     tc->root = NULL;
     tc->cmp = cmp;
     tc->num_entries = 0;
     tc->data = data;
+    tc->kind = kind;
+}
+
+ScmTreeCoreKind Scm_TreeCoreKind(const ScmTreeCore *tc)
+{
+    return (ScmTreeCoreKind)tc->kind;
 }
 
 void Scm_TreeCoreCopy(ScmTreeCore *dst, const ScmTreeCore *src)
 {
-    if (ROOT(src)) {
-        SET_ROOT(dst, copy_tree(NULL, ROOT(src)));
-    } else {
+    if (src->root == NULL) {
         SET_ROOT(dst, NULL);
+    } else if (BTREEP(src)) {
+        BTLeaf *last = NULL;
+        dst->root = (ScmDictEntry*)bt_copy(src->root, &last);
+    } else {
+        SET_ROOT(dst, copy_tree(NULL, ROOT(src)));
     }
     dst->cmp = src->cmp;
     dst->num_entries = src->num_entries;
     dst->data = src->data;
+    dst->kind = src->kind;
 }
 
 void Scm_TreeCoreClear(ScmTreeCore *tc)
@@ -124,7 +174,7 @@ ScmDictEntry *Scm_TreeCoreSearch(ScmTreeCore *tc,
                                  intptr_t key,
                                  ScmDictOp op)
 {
-    return (ScmDictEntry*)core_ref(tc, key, (enum TreeOp)op, NULL, NULL);
+    return tree_ref(tc, key, (enum TreeOp)op, NULL, NULL);
 }
 
 ScmDictEntry *Scm_TreeCoreClosestEntries(ScmTreeCore *tc,
@@ -132,29 +182,28 @@ ScmDictEntry *Scm_TreeCoreClosestEntries(ScmTreeCore *tc,
                                          ScmDictEntry **lo,
                                          ScmDictEntry **hi)
 {
-    Node *l, *h;
-    Node *r = core_ref(tc, key, TREE_NEAR, &l, &h);
-    *lo = (ScmDictEntry*)l;
-    *hi = (ScmDictEntry*)h;
-    return (ScmDictEntry*)r;
+    return tree_ref(tc, key, TREE_NEAR, lo, hi);
 }
 
 ScmDictEntry *Scm_TreeCoreNextEntry(ScmTreeCore *tc, intptr_t key)
 {
-    Node *l, *h;
-    core_ref(tc, key, TREE_NEAR, &l, &h);
-    return (ScmDictEntry*)h;
+    ScmDictEntry *l, *h;
+    tree_ref(tc, key, TREE_NEAR, &l, &h);
+    return h;
 }
 
 ScmDictEntry *Scm_TreeCorePrevEntry(ScmTreeCore *tc, intptr_t key)
 {
-    Node *l, *h;
-    core_ref(tc, key, TREE_NEAR, &l, &h);
-    return (ScmDictEntry*)l;
+    ScmDictEntry *l, *h;
+    tree_ref(tc, key, TREE_NEAR, &l, &h);
+    return l;
 }
 
-static Node *core_bound(ScmTreeCore *tc, ScmTreeCoreBoundOp op, int pop)
+static ScmDictEntry *core_bound(ScmTreeCore *tc, ScmTreeCoreBoundOp op,
+                                int pop)
 {
+    if (BTREEP(tc)) return (ScmDictEntry*)bt_bound(tc, op, pop);
+
     Node *root = ROOT(tc);
     if (root) {
         Node *n = (op == SCM_TREE_CORE_MIN)? leftmost(root) : rightmost(root);
@@ -162,7 +211,7 @@ static Node *core_bound(ScmTreeCore *tc, ScmTreeCoreBoundOp op, int pop)
             n = delete_node(tc, n);
             tc->num_entries--;
         }
-        return n;
+        return (ScmDictEntry*)n;
     } else {
         return NULL;
     }
@@ -170,12 +219,12 @@ static Node *core_bound(ScmTreeCore *tc, ScmTreeCoreBoundOp op, int pop)
 
 ScmDictEntry *Scm_TreeCoreGetBound(ScmTreeCore *tc, ScmTreeCoreBoundOp op)
 {
-    return (ScmDictEntry*)core_bound(tc, op, FALSE);
+    return core_bound(tc, op, FALSE);
 }
 
 ScmDictEntry *Scm_TreeCorePopBound(ScmTreeCore *tc, ScmTreeCoreBoundOp op)
 {
-    return (ScmDictEntry*)core_bound(tc, op, TRUE);
+    return core_bound(tc, op, TRUE);
 }
 
 int Scm_TreeCoreNumEntries(ScmTreeCore *tc)
@@ -183,6 +232,55 @@ int Scm_TreeCoreNumEntries(ScmTreeCore *tc)
     return tc->num_entries;
 }
 
+/* Order statistics.  Both kinds keep the number of entries under
+   each subtree, so these are O(log n). */
+
+/* Returns the number of entries whose keys are smaller than KEY.
+   If KEY is in the tree, it is the index of its entry. */
+int Scm_TreeCoreRank(ScmTreeCore *tc, intptr_t key)
+{
+    if (BTREEP(tc)) return bt_rank(tc, key);
+
+    Node *e = ROOT(tc);
+    int rank = 0;
+    while (e) {
+        int r = 0;
+        if (tc->cmp) r = tc->cmp(tc, e->key, key);
+
+        if (tc->cmp? (r == 0) : (e->key == key)) {
+            return rank + SIZE(e->left);
+        }
+        if (tc->cmp? (r < 0) : (e->key < key)) {
+            rank += SIZE(e->left) + 1;
+            e = e->right;
+        } else {
+            e = e->left;
+        }
+    }
+    return rank;
+}
+
+/* Returns the entry at index K in the key order, or NULL if K is
+   out of range. */
+ScmDictEntry *Scm_TreeCoreSelect(ScmTreeCore *tc, int k)
+{
+    if (k < 0 || k >= tc->num_entries) return NULL;
+    if (BTREEP(tc)) return (ScmDictEntry*)bt_select(tc, k);
+
+    Node *e = ROOT(tc);
+    while (e) {
+        int ls = SIZE(e->left);
+        if (k == ls) return (ScmDictEntry*)e;
+        if (k < ls) {
+            e = e->left;
+        } else {
+            k -= ls + 1;
+            e = e->right;
+        }
+    }
+    return NULL;                /* NOTREACHED */
+}
+
 int Scm_TreeCoreEq(ScmTreeCore *a, ScmTreeCore *b)
 {
     ScmTreeIter ai, bi;
@@ -220,7 +318,11 @@ ScmDictEntry *Scm_TreeIterNext(ScmTreeIter *iter)
 {
     if (iter->at_end) return NULL;
     if (iter->e) {
-        iter->e = (ScmDictEntry*)next_node((Node*)iter->e);
+        if (BTREEP(iter->t)) {
+            iter->e = (ScmDictEntry*)bt_next((BTEntry*)iter->e);
+        } else {
+            iter->e = (ScmDictEntry*)next_node((Node*)iter->e);
+        }
     } else {
         iter->e = Scm_TreeCoreGetBound(iter->t, SCM_TREE_CORE_MIN);
     }
@@ -232,7 +334,11 @@ ScmDictEntry *Scm_TreeIterPrev(ScmTreeIter *iter)
 {
     if (iter->at_end) return NULL;
     if (iter->e) {
-        iter->e = (ScmDictEntry*)prev_node((Node*)iter->e);
+        if (BTREEP(iter->t)) {
+            iter->e = (ScmDictEntry*)bt_prev((BTEntry*)iter->e);
+        } else {
+            iter->e = (ScmDictEntry*)prev_node((Node*)iter->e);
+        }
     } else {
         iter->e = Scm_TreeCoreGetBound(iter->t, SCM_TREE_CORE_MAX);
     }
@@ -280,11 +386,19 @@ static int check_traverse(Node *node, int depth, int *count)
     if (ld != rd) {
         Scm_Error("[internal] tree map has different black-node depth (L:%d vs R:%d)", ld, rd);
     }
+    if (node->size != SIZE(node->left) + SIZE(node->right) + 1) {
+        Scm_Error("[internal] tree map has wrong subtree size: %d", node->size);
+    }
     return ld;
 }
 
 void Scm_TreeCoreCheckConsistency(ScmTreeCore *tc)
 {
+    if (BTREEP(tc)) {
+        bt_check(tc);
+        return;
+    }
+
     Node *r = ROOT(tc);
     int cnt = 0;
 
@@ -314,11 +428,17 @@ SCM_DEFINE_BUILTIN_CLASS(Scm_TreeMapClass, treemap_print, NULL, NULL, NULL,
  */
 
 ScmObj Scm_MakeTreeMap(ScmTreeCoreCompareProc *cmp, void *data)
+{
+    return Scm_MakeTreeMapFull(cmp, data, SCM_TREE_CORE_RB);
+}
+
+ScmObj Scm_MakeTreeMapFull(ScmTreeCoreCompareProc *cmp, void *data,
+                           ScmTreeCoreKind kind)
 {
     ScmTreeMap *tm = SCM_NEW(ScmTreeMap);
     SCM_SET_CLASS(tm, SCM_CLASS_TREE_MAP);
     /* TODO: default cmp should be different from TreeCore */
-    Scm_TreeCoreInit(SCM_TREE_MAP_CORE(tm), cmp, data);
+    Scm_TreeCoreInitFull(SCM_TREE_MAP_CORE(tm), cmp, data, kind);
     return SCM_OBJ(tm);
 }
 
@@ -387,7 +507,8 @@ void Scm_TreeMapDump(ScmTreeMap *tm, ScmPort *out)
     Node *r = ROOT(tc);
     Scm_Printf(out, "Entries=%d\n", tc->num_entries);
     if (r) {
-        dump_traverse(r, 0, out, TRUE);
+        if (BTREEP(tc)) bt_dump(r, 0, out, TRUE);
+        else dump_traverse(r, 0, out, TRUE);
     }
 }
 
@@ -396,7 +517,8 @@ void Scm_TreeCoreDump(ScmTreeCore *tc, ScmPort *out)
     Node *r = ROOT(tc);
     Scm_Printf(out, "Entries=%d\n", tc->num_entries);
     if (r) {
-        dump_traverse(r, 0, out, FALSE);
+        if (BTREEP(tc)) bt_dump(r, 0, out, FALSE);
+        else dump_traverse(r, 0, out, FALSE);
     }
 }
 
@@ -446,6 +568,7 @@ static Node *new_node(Node *parent, intptr_t key)
     n->key = key;
     n->value = 0;
     n->color = RED;             /* default is red */
+    n->size = 1;
     n->parent = parent;
     n->left = n->right = NULL;
     return n;
@@ -487,6 +610,8 @@ static void rotate_right(ScmTreeCore *tc, Node *n)
     replace_node(tc, n, l);
     l->right = n;  n->parent = l;
     n->left = gr;  if (gr) gr->parent = n;
+    l->size = n->size;
+    RESIZE(n);
 }
 
 /* rotate_left:
@@ -506,6 +631,8 @@ static void rotate_left(ScmTreeCore *tc, Node *n)
     replace_node(tc, n, r);
     r->left = n;   n->parent = r;
     n->right = gl; if (gl) gl->parent = n;
+    r->size = n->size;
+    RESIZE(n);
 }
 
 #if 0 /* for debug */
@@ -514,6 +641,12 @@ static void rotate_left(ScmTreeCore *tc, Node *n)
 #define BALANCE_CASE(n) /*nothing*/
 #endif
 
+/* update subtree sizes after insertion of N */
+static void grow_path(Node *n)
+{
+    for (Node *p = n->parent; p; p = p->parent) p->size++;
+}
+
 /* balance tree after insertion of N */
 static void balance_tree(ScmTreeCore *tc, Node *n)
 {
@@ -568,6 +701,7 @@ static void delete_node1(ScmTreeCore *tc, Node *todie, Node *child)
 {
     Node *parent = todie->parent;
 
+    for (Node *p = parent; p; p = p->parent) p->size--;
     replace_node(tc, todie, child);
     if (REDP(todie)) { DELETE_CASE("1"); return; }
     if (REDP(child)) { DELETE_CASE("2"); child->color = BLACK; return; }
@@ -663,6 +797,7 @@ static void swap_node(ScmTreeCore *tc, Node *x, Node *y)
 
     int c;
     SWAP(x->color, y->color, c);
+    SWAP(x->size, y->size, c);
     if (x == ROOT(tc)) SET_ROOT(tc, y);
     else if (y == ROOT(tc)) SET_ROOT(tc, x);
 #undef SWAP
@@ -734,6 +869,7 @@ Node *core_ref(ScmTreeCore *tc, intptr_t key, enum TreeOp op,
                 if (op == TREE_CREATE) {
                     n = new_node(e, key);
                     e->right = n;
+                    grow_path(n);
                     balance_tree(tc, n);
                     tc->num_entries++;
                     return n;
@@ -752,6 +888,7 @@ Node *core_ref(ScmTreeCore *tc, intptr_t key, enum TreeOp op,
                 if (op == TREE_CREATE) {
                     n = new_node(e, key);
                     e->left = n;
+                    grow_path(n);
                     balance_tree(tc, n);
                     tc->num_entries++;
                     return n;
@@ -772,7 +909,737 @@ static Node *copy_tree(Node *parent, Node *self)
     Node *n = new_node(parent, self->key);
     n->value = self->value;
     n->color = self->color;
+    n->size = self->size;
     if (self->left)  n->left = copy_tree(n, self->left);
     if (self->right) n->right = copy_tree(n, self->right);
     return n;
 }
+
+/*=============================================================
+ * Internal stuff (B+-Tree implementation)
+ */
+
+/* The B+-tree keeps entries only in the leaves, and the leaves are
+   doubly linked, so an in-order scan walks flat arrays instead of
+   chasing parent pointers.  Keys are copied into the nodes, so that
+   a search only touches the nodes on its path.
+
+   An entry is still allocated separately, since the callers retain
+   ScmDictEntry* while the tree can be modified (e.g. iterators and
+   tree-map-update!).  Each entry points back to the leaf that contains
+   it, which is updated whenever the entry moves to another leaf.
+
+   Nodes don't have parent pointers; modifying operations record the
+   path from the root instead.
+ */
+
+#define BT_ORDER      32            /* max # of keys in a node */
+#define BT_MIN        (BT_ORDER/2)  /* min # of keys in a non-root node */
+#define BT_MAX_DEPTH  32
+
+/* The first two elements must match ScmDictEntry. */
+struct BTEntryRec {
+    intptr_t key;
+    intptr_t value;
+    BTLeaf  *leaf;              /* NULL once the entry is deleted */
+};
+
+/* The first two elements are common in BTNode and BTLeaf.
+   The arrays have one extra slot, so that we can insert an element
+   into a full node before splitting it. */
+typedef struct BTNodeRec {
+    int      nkeys;
+    int      leafp;
+    intptr_t keys[BT_ORDER+1];  /* separators */
+    void    *children[BT_ORDER+2];
+    int      counts[BT_ORDER+2];   /* # of entries under each child */
+} BTNode;
+
+/* keys[i] is a copy of entries[i]->key. */
+struct BTLeafRec {
+    int      nkeys;
+    int      leafp;
+    BTLeaf  *prev;
+    BTLeaf  *next;
+    intptr_t keys[BT_ORDER+1];
+    BTEntry *entries[BT_ORDER+1];
+};
+
+#define BT_LEAFP(n)  (((BTLeaf*)(n))->leafp)
+
+typedef struct BTPathRec {
+    int     depth;
+    BTNode *nodes[BT_MAX_DEPTH];
+    int     index[BT_MAX_DEPTH];   /* index of the child we went down */
+} BTPath;
+
+static inline int bt_cmp(ScmTreeCore *tc, intptr_t a, intptr_t b)
+{
+    if (tc->cmp) return tc->cmp(tc, a, b);
+    return (a < b)? -1 : ((a > b)? 1 : 0);
+}
+
+static BTEntry *bt_new_entry(intptr_t key)
+{
+    BTEntry *e = SCM_NEW(BTEntry);
+    e->key = key;
+    e->value = 0;
+    e->leaf = NULL;
+    return e;
+}
+
+static BTLeaf *bt_new_leaf(void)
+{
+    BTLeaf *l = SCM_NEW(BTLeaf);
+    l->nkeys = 0;
+    l->leafp = TRUE;
+    l->prev = l->next = NULL;
+    return l;
+}
+
+static BTNode *bt_new_node(void)
+{
+    BTNode *n = SCM_NEW(BTNode);
+    n->nkeys = 0;
+    n->leafp = FALSE;
+    return n;
+}
+
+/* Returns # of entries under N. */
+static int bt_count(void *n)
+{
+    if (BT_LEAFP(n)) return ((BTLeaf*)n)->nkeys;
+    BTNode *b = (BTNode*)n;
+    int c = 0;
+    for (int i=0; i<=b->nkeys; i++) c += b->counts[i];
+    return c;
+}
+
+/* Adds D to the counts along PATH. */
+static void bt_path_count(BTPath *path, int d)
+{
+    for (int i=0; i<path->depth; i++) {
+        path->nodes[i]->counts[path->index[i]] += d;
+    }
+}
+
+/* Search in a leaf.  Returns the index of the first key that is not
+   less than KEY, and sets *EXACT if it is equal to KEY. */
+static int bt_leaf_search(ScmTreeCore *tc, BTLeaf *l, intptr_t key,
+                          int *exact)
+{
+    int lo = 0, hi = l->nkeys;
+    *exact = FALSE;
+    while (lo < hi) {
+        int mid = (lo+hi)/2;
+        int r = bt_cmp(tc, l->keys[mid], key);
+        if (r == 0) { *exact = TRUE; return mid; }
+        if (r < 0) lo = mid+1;
+        else       hi = mid;
+    }
+    return lo;
+}
+
+/* Search in an internal node.  Returns the index of the child that
+   may contain KEY. */
+static int bt_node_search(ScmTreeCore *tc, BTNode *n, intptr_t key)
+{
+    int lo = 0, hi = n->nkeys;
+    while (lo < hi) {
+        int mid = (lo+hi)/2;
+        if (bt_cmp(tc, n->keys[mid], key) <= 0) lo = mid+1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void bt_path_push(BTPath *path, BTNode *n, int i)
+{
+    if (path->depth >= BT_MAX_DEPTH) {
+        Scm_Panic("[internal] B-tree is too deep");
+    }
+    path->nodes[path->depth] = n;
+    path->index[path->depth] = i;
+    path->depth++;
+}
+
+static BTLeaf *bt_descend(ScmTreeCore *tc, intptr_t key, BTPath *path)
+{
+    void *n = tc->root;
+    path->depth = 0;
+    while (!BT_LEAFP(n)) {
+        int i = bt_node_search(tc, (BTNode*)n, key);
+        bt_path_push(path, (BTNode*)n, i);
+        n = ((BTNode*)n)->children[i];
+    }
+    return (BTLeaf*)n;
+}
+
+/* Returns the position of E in its leaf. */
+static int bt_entry_index(BTEntry *e)
+{
+    BTLeaf *l = e->leaf;
+    for (int i=0; i<l->nkeys; i++) {
+        if (l->entries[i] == e) return i;
+    }
+    Scm_Panic("[internal] B-tree entry isn't found in its leaf");
+    return -1;                  /* dummy */
+}
+
+static BTEntry *bt_next(BTEntry *e)
+{
+    BTLeaf *l = e->leaf;
+    if (l == NULL) return NULL; /* E has been deleted */
+    int i = bt_entry_index(e);
+    if (i+1 < l->nkeys) return l->entries[i+1];
+    if (l->next) return l->next->entries[0];
+    return NULL;
+}
+
+static BTEntry *bt_prev(BTEntry *e)
+{
+    BTLeaf *l = e->leaf;
+    if (l == NULL) return NULL; /* E has been deleted */
+    int i = bt_entry_index(e);
+    if (i > 0) return l->entries[i-1];
+    if (l->prev) return l->prev->entries[l->prev->nkeys-1];
+    return NULL;
+}
+
+static int bt_rank(ScmTreeCore *tc, intptr_t key)
+{
+    void *n = tc->root;
+    int rank = 0;
+    if (n == NULL) return 0;
+    while (!BT_LEAFP(n)) {
+        BTNode *b = (BTNode*)n;
+        int i = bt_node_search(tc, b, key);
+        for (int j=0; j<i; j++) rank += b->counts[j];
+        n = b->children[i];
+    }
+    int exact;
+    return rank + bt_leaf_search(tc, (BTLeaf*)n, key, &exact);
+}
+
+/* K must be in range. */
+static BTEntry *bt_select(ScmTreeCore *tc, int k)
+{
+    void *n = tc->root;
+    while (!BT_LEAFP(n)) {
+        BTNode *b = (BTNode*)n;
+        int i = 0;
+        while (i < b->nkeys && k >= b->counts[i]) k -= b->counts[i++];
+        n = b->children[i];
+    }
+    return ((BTLeaf*)n)->entries[k];
+}
+
+/*
+ * Insertion
+ */
+
+static void bt_leaf_insert_at(BTLeaf *l, int i, BTEntry *e)
+{
+    int n = l->nkeys - i;
+    memmove(l->keys+i+1, l->keys+i, n*sizeof(intptr_t));
+    memmove(l->entries+i+1, l->entries+i, n*sizeof(BTEntry*));
+    l->keys[i] = e->key;
+    l->entries[i] = e;
+    e->leaf = l;
+    l->nkeys++;
+}
+
+/* Inserts KEY at I and CHILD at I+1.  The I-th child is split into
+   the I-th child and CHILD, so the count is divided between them. */
+static void bt_node_insert_at(BTNode *p, int i, intptr_t key, void *child)
+{
+    int n = p->nkeys - i;
+    memmove(p->keys+i+1, p->keys+i, n*sizeof(intptr_t));
+    memmove(p->children+i+2, p->children+i+1, n*sizeof(void*));
+    memmove(p->counts+i+2, p->counts+i+1, n*sizeof(int));
+    p->keys[i] = key;
+    p->children[i+1] = child;
+    int lc = bt_count(p->children[i]);
+    p->counts[i+1] = p->counts[i] - lc;
+    p->counts[i] = lc;
+    p->nkeys++;
+}
+
+/* L has BT_ORDER+1 keys.  Moves the upper half of L to a new leaf,
+   and returns it. */
+static BTLeaf *bt_split_leaf(BTLeaf *l)
+{
+    BTLeaf *r = bt_new_leaf();
+    int m = l->nkeys/2;
+
+    r->nkeys = l->nkeys - m;
+    memcpy(r->keys, l->keys+m, r->nkeys*sizeof(intptr_t));
+    memcpy(r->entries, l->entries+m, r->nkeys*sizeof(BTEntry*));
+    for (int i=0; i<r->nkeys; i++) r->entries[i]->leaf = r;
+    /* clear the moved part, for GC */
+    memset(l->keys+m, 0, r->nkeys*sizeof(intptr_t));
+    memset(l->entries+m, 0, r->nkeys*sizeof(BTEntry*));
+    l->nkeys = m;
+
+    r->next = l->next;
+    if (r->next) r->next->prev = r;
+    r->prev = l;
+    l->next = r;
+    return r;
+}
+
+/* N has BT_ORDER+1 keys.  Moves the upper half of N to a new node,
+   and returns it.  The middle
+   key, which should go to the parent, is set to *SEP. */
+static BTNode *bt_split_node(BTNode *n, intptr_t *sep)
+{
+    BTNode *r = bt_new_node();
+    int m = n->nkeys/2;
+
+    *sep = n->keys[m];
+    r->nkeys = n->nkeys - m - 1;
+    memcpy(r->keys, n->keys+m+1, r->nkeys*sizeof(intptr_t));
+    memcpy(r->children, n->children+m+1, (r->nkeys+1)*sizeof(void*));
+    memcpy(r->counts, n->counts+m+1, (r->nkeys+1)*sizeof(int));
+    memset(n->keys+m, 0, (r->nkeys+1)*sizeof(intptr_t));
+    memset(n->children+m+1, 0, (r->nkeys+1)*sizeof(void*));
+    memset(n->counts+m+1, 0, (r->nkeys+1)*sizeof(int));
+    n->nkeys = m;
+    return r;
+}
+
+/* RIGHT is split off from the node at the bottom of PATH.  Inserts
+   it to the parent, splitting ancestors as needed. */
+static void bt_insert_up(ScmTreeCore *tc, BTPath *path,
+                         intptr_t sep, void *right)
+{
+    for (int d = path->depth-1; d >= 0; d--) {
+        BTNode *p = path->nodes[d];
+        bt_node_insert_at(p, path->index[d], sep, right);
+        if (p->nkeys <= BT_ORDER) return;
+        right = bt_split_node(p, &sep);
+    }
+    /* The root is split. */
+    BTNode *root = bt_new_node();
+    root->nkeys = 1;
+    root->keys[0] = sep;
+    root->children[0] = tc->root;
+    root->children[1] = right;
+    root->counts[0] = bt_count(tc->root);
+    root->counts[1] = bt_count(right);
+    tc->root = (ScmDictEntry*)root;
+}
+
+/* The counts along PATH are updated first, then the splits divide
+   them between the halves. */
+static void bt_insert(ScmTreeCore *tc, BTPath *path, BTLeaf *l, int i,
+                      BTEntry *e)
+{
+    bt_path_count(path, 1);
+    bt_leaf_insert_at(l, i, e);
+    if (l->nkeys <= BT_ORDER) return;
+    BTLeaf *r = bt_split_leaf(l);
+    bt_insert_up(tc, path, r->keys[0], r);
+}
+
+/*
+ * Deletion
+ */
+
+static void bt_leaf_remove_at(BTLeaf *l, int i)
+{
+    int n = l->nkeys - i - 1;
+    memmove(l->keys+i, l->keys+i+1, n*sizeof(intptr_t));
+    memmove(l->entries+i, l->entries+i+1, n*sizeof(BTEntry*));
+    l->nkeys--;
+    l->keys[l->nkeys] = 0;
+    l->entries[l->nkeys] = NULL;
+}
+
+/* Removes the key at I and the child at I+1.  The entries under the
+   removed child must have been moved to the I-th child. */
+static void bt_node_remove_at(BTNode *p, int i)
+{
+    int n = p->nkeys - i - 1;
+    p->counts[i] += p->counts[i+1];
+    memmove(p->keys+i, p->keys+i+1, n*sizeof(intptr_t));
+    memmove(p->children+i+1, p->children+i+2, n*sizeof(void*));
+    memmove(p->counts+i+1, p->counts+i+2, n*sizeof(int));
+    p->nkeys--;
+    p->keys[p->nkeys] = 0;
+    p->children[p->nkeys+1] = NULL;
+    p->counts[p->nkeys+1] = 0;
+}
+
+/* Merges the I+1-th child of P into the I-th child. */
+static void bt_merge_leaves(BTNode *p, int i)
+{
+    BTLeaf *a = (BTLeaf*)p->children[i];
+    BTLeaf *b = (BTLeaf*)p->children[i+1];
+
+    for (int j=0; j<b->nkeys; j++) {
+        a->keys[a->nkeys+j] = b->keys[j];
+        a->entries[a->nkeys+j] = b->entries[j];
+        b->entries[j]->leaf = a;
+    }
+    a->nkeys += b->nkeys;
+    a->next = b->next;
+    if (a->next) a->next->prev = a;
+    memset(b, 0, sizeof(BTLeaf)); /* for GC */
+    bt_node_remove_at(p, i);
+}
+
+static void bt_merge_nodes(BTNode *p, int i)
+{
+    BTNode *a = (BTNode*)p->children[i];
+    BTNode *b = (BTNode*)p->children[i+1];
+
+    a->keys[a->nkeys] = p->keys[i];
+    memcpy(a->keys+a->nkeys+1, b->keys, b->nkeys*sizeof(intptr_t));
+    memcpy(a->children+a->nkeys+1, b->children, (b->nkeys+1)*sizeof(void*));
+    memcpy(a->counts+a->nkeys+1, b->counts, (b->nkeys+1)*sizeof(int));
+    a->nkeys += b->nkeys + 1;
+    memset(b, 0, sizeof(BTNode)); /* for GC */
+    bt_node_remove_at(p, i);
+}
+
+/* The node at depth D of PATH may have too few keys.  Fix it by
+   borrowing a key from a sibling, or merging it with a sibling,
+   which may propagate to the ancestors. */
+static void bt_rebalance_node(ScmTreeCore *tc, BTPath *path, int d)
+{
+    for (; d > 0; d--) {
+        BTNode *n = path->nodes[d];
+        if (n->nkeys >= BT_MIN) return;
+
+        BTNode *p = path->nodes[d-1];
+        int ci = path->index[d-1];
+        if (ci > 0) {
+            BTNode *s = (BTNode*)p->children[ci-1];
+            if (s->nkeys > BT_MIN) {
+                /* rotate right */
+                memmove(n->keys+1, n->keys, n->nkeys*sizeof(intptr_t));
+                memmove(n->children+1, n->children,
+                        (n->nkeys+1)*sizeof(void*));
+                memmove(n->counts+1, n->counts, (n->nkeys+1)*sizeof(int));
+                int cc = s->counts[s->nkeys];
+                n->keys[0] = p->keys[ci-1];
+                n->children[0] = s->children[s->nkeys];
+                n->counts[0] = cc;
+                n->nkeys++;
+                p->keys[ci-1] = s->keys[s->nkeys-1];
+                p->counts[ci-1] -= cc;
+                p->counts[ci] += cc;
+                s->keys[s->nkeys-1] = 0;
+                s->children[s->nkeys] = NULL;
+                s->counts[s->nkeys] = 0;
+                s->nkeys--;
+                return;
+            }
+        }
+        if (ci < p->nkeys) {
+            BTNode *s = (BTNode*)p->children[ci+1];
+            if (s->nkeys > BT_MIN) {
+                /* rotate left */
+                int cc = s->counts[0];
+                n->keys[n->nkeys] = p->keys[ci];
+                n->children[n->nkeys+1] = s->children[0];
+                n->counts[n->nkeys+1] = cc;
+                n->nkeys++;
+                p->keys[ci] = s->keys[0];
+                p->counts[ci] += cc;
+                p->counts[ci+1] -= cc;
+                memmove(s->keys, s->keys+1, (s->nkeys-1)*sizeof(intptr_t));
+                memmove(s->children, s->children+1, s->nkeys*sizeof(void*));
+                memmove(s->counts, s->counts+1, s->nkeys*sizeof(int));
+                s->keys[s->nkeys-1] = 0;
+                s->children[s->nkeys] = NULL;
+                s->counts[s->nkeys] = 0;
+                s->nkeys--;
+                return;
+            }
+        }
+        bt_merge_nodes(p, (ci > 0)? ci-1 : ci);
+    }
+
+    /* D == 0.  We shrink the tree if the root has a single child. */
+    BTNode *root = path->nodes[0];
+    if (root->nkeys == 0) {
+        tc->root = (ScmDictEntry*)root->children[0];
+        root->children[0] = NULL;
+    }
+}
+
+/* Removes I-th entry of L, which is at the bottom of PATH. */
+static void bt_delete(ScmTreeCore *tc, BTPath *path, BTLeaf *l, int i)
+{
+    bt_path_count(path, -1);
+    l->entries[i]->leaf = NULL;
+    bt_leaf_remove_at(l, i);
+
+    if (path->depth == 0) {
+        /* L is the root. */
+        if (l->nkeys == 0) tc->root = NULL;
+        return;
+    }
+    if (l->nkeys >= BT_MIN) return;
+
+    int d = path->depth-1;
+    BTNode *p = path->nodes[d];
+    int ci = path->index[d];
+    if (ci > 0) {
+        BTLeaf *s = (BTLeaf*)p->children[ci-1];
+        if (s->nkeys > BT_MIN) {
+            /* borrow the last entry of the left sibling */
+            BTEntry *e = s->entries[s->nkeys-1];
+            bt_leaf_remove_at(s, s->nkeys-1);
+            bt_leaf_insert_at(l, 0, e);
+            p->keys[ci-1] = l->keys[0];
+            p->counts[ci-1]--;
+            p->counts[ci]++;
+            return;
+        }
+    }
+    if (ci < p->nkeys) {
+        BTLeaf *s = (BTLeaf*)p->children[ci+1];
+        if (s->nkeys > BT_MIN) {
+            /* borrow the first entry of the right sibling */
+            BTEntry *e = s->entries[0];
+            bt_leaf_remove_at(s, 0);
+            bt_leaf_insert_at(l, l->nkeys, e);
+            p->keys[ci] = s->keys[0];
+            p->counts[ci+1]--;
+            p->counts[ci]++;
+            return;
+        }
+    }
+    bt_merge_leaves(p, (ci > 0)? ci-1 : ci);
+    bt_rebalance_node(tc, path, d);
+}
+
+/*
+ * Accessors
+ */
+
+static BTEntry *bt_ref(ScmTreeCore *tc, intptr_t key, enum TreeOp op,
+                       BTEntry **lo, BTEntry **hi)
+{
+    if (tc->root == NULL) {
+        BTEntry *e = NULL;
+        if (op == TREE_CREATE) {
+            BTLeaf *l = bt_new_leaf();
+            e = bt_new_entry(key);
+            bt_leaf_insert_at(l, 0, e);
+            tc->root = (ScmDictEntry*)l;
+            tc->num_entries++;
+        }
+        if (op == TREE_NEAR) {
+            *lo = *hi = NULL;
+        }
+        return e;
+    }
+
+    BTPath path;
+    BTLeaf *l = bt_descend(tc, key, &path);
+    int exact;
+    int i = bt_leaf_search(tc, l, key, &exact);
+    BTEntry *e = exact? l->entries[i] : NULL;
+
+    switch (op) {
+    case TREE_GET:
+        break;
+    case TREE_CREATE:
+        if (!exact) {
+            e = bt_new_entry(key);
+            bt_insert(tc, &path, l, i, e);
+            tc->num_entries++;
+        }
+        break;
+    case TREE_DELETE:
+        if (exact) {
+            bt_delete(tc, &path, l, i);
+            tc->num_entries--;
+        }
+        break;
+    case TREE_NEAR:
+        if (exact) {
+            *lo = bt_prev(e);
+            *hi = bt_next(e);
+        } else {
+            if (i > 0)        *lo = l->entries[i-1];
+            else if (l->prev) *lo = l->prev->entries[l->prev->nkeys-1];
+            else              *lo = NULL;
+            if (i < l->nkeys) *hi = l->entries[i];
+            else if (l->next) *hi = l->next->entries[0];
+            else              *hi = NULL;
+        }
+        break;
+    }
+    return e;
+}
+
+static BTEntry *bt_bound(ScmTreeCore *tc, ScmTreeCoreBoundOp op, int pop)
+{
+    if (tc->root == NULL) return NULL;
+
+    BTPath path;
+    void *n = tc->root;
+    path.depth = 0;
+    while (!BT_LEAFP(n)) {
+        int i = (op == SCM_TREE_CORE_MIN)? 0 : ((BTNode*)n)->nkeys;
+        bt_path_push(&path, (BTNode*)n, i);
+        n = ((BTNode*)n)->children[i];
+    }
+    BTLeaf *l = (BTLeaf*)n;
+    int i = (op == SCM_TREE_CORE_MIN)? 0 : l->nkeys-1;
+    BTEntry *e = l->entries[i];
+    if (pop) {
+        bt_delete(tc, &path, l, i);
+        tc->num_entries--;
+    }
+    return e;
+}
+
+/* LAST keeps the last leaf copied, to link the leaves. */
+static void *bt_copy(void *n, BTLeaf **last)
+{
+    if (BT_LEAFP(n)) {
+        BTLeaf *s = (BTLeaf*)n;
+        BTLeaf *d = bt_new_leaf();
+        d->nkeys = s->nkeys;
+        for (int i=0; i<s->nkeys; i++) {
+            BTEntry *e = bt_new_entry(s->keys[i]);
+            e->value = s->entries[i]->value;
+            e->leaf = d;
+            d->keys[i] = s->keys[i];
+            d->entries[i] = e;
+        }
+        d->prev = *last;
+        if (*last) (*last)->next = d;
+        *last = d;
+        return d;
+    } else {
+        BTNode *s = (BTNode*)n;
+        BTNode *d = bt_new_node();
+        d->nkeys = s->nkeys;
+        memcpy(d->keys, s->keys, s->nkeys*sizeof(intptr_t));
+        memcpy(d->counts, s->counts, (s->nkeys+1)*sizeof(int));
+        for (int i=0; i<=s->nkeys; i++) {
+            d->children[i] = bt_copy(s->children[i], last);
+        }
+        return d;
+    }
+}
+
+/*
+ * Consistency check
+ */
+
+typedef struct BTCheckRec {
+    ScmTreeCore *tc;
+    int leaf_depth;             /* -1 if not known yet */
+    int count;
+    BTLeaf *last;               /* last leaf visited */
+} BTCheck;
+
+/* Keys of N must be in [LO, HI), where NULL means unbounded.
+   Returns # of entries under N. */
+static int bt_check_rec(BTCheck *c, void *n, int depth,
+                         const intptr_t *lo, const intptr_t *hi)
+{
+    ScmTreeCore *tc = c->tc;
+    int nkeys = ((BTLeaf*)n)->nkeys;
+    intptr_t *keys = BT_LEAFP(n)? ((BTLeaf*)n)->keys : ((BTNode*)n)->keys;
+
+    if (nkeys > BT_ORDER || nkeys < (depth == 0? 1 : BT_MIN)) {
+        Scm_Error("[internal] B-tree node has wrong number of keys: %d",
+                  nkeys);
+    }
+    for (int i=0; i<nkeys; i++) {
+        if ((lo && bt_cmp(tc, keys[i], *lo) < 0)
+            || (hi && bt_cmp(tc, keys[i], *hi) >= 0)
+            || (i > 0 && bt_cmp(tc, keys[i-1], keys[i]) >= 0)) {
+            Scm_Error("[internal] B-tree keys are out of order");
+        }
+    }
+
+    if (BT_LEAFP(n)) {
+        BTLeaf *l = (BTLeaf*)n;
+        if (c->leaf_depth < 0) c->leaf_depth = depth;
+        else if (c->leaf_depth != depth) {
+            Scm_Error("[internal] B-tree leaves have different depth "
+                      "(%d vs %d)", c->leaf_depth, depth);
+        }
+        for (int i=0; i<nkeys; i++) {
+            if (l->entries[i]->leaf != l || l->entries[i]->key != keys[i]) {
+                Scm_Error("[internal] B-tree entry doesn't match its leaf");
+            }
+        }
+        if (l->prev != c->last || (c->last && c->last->next != l)) {
+            Scm_Error("[internal] B-tree leaf link is broken");
+        }
+        c->last = l;
+        c->count += nkeys;
+        return nkeys;
+    } else {
+        BTNode *b = (BTNode*)n;
+        int total = 0;
+        for (int i=0; i<=nkeys; i++) {
+            int k = bt_check_rec(c, b->children[i], depth+1,
+                                 (i == 0)? lo : &keys[i-1],
+                                 (i == nkeys)? hi : &keys[i]);
+            if (k != b->counts[i]) {
+                Scm_Error("[internal] B-tree node has wrong subtree count "
+                          "(record %d vs actual %d)", b->counts[i], k);
+            }
+            total += k;
+        }
+        return total;
+    }
+}
+
+static void bt_check(ScmTreeCore *tc)
+{
+    BTCheck c;
+    c.tc = tc;
+    c.leaf_depth = -1;
+    c.count = 0;
+    c.last = NULL;
+    if (tc->root) {
+        bt_check_rec(&c, tc->root, 0, NULL, NULL);
+        if (c.last->next != NULL) {
+            Scm_Error("[internal] B-tree leaf link is broken");
+        }
+    }
+    if (c.count != tc->num_entries) {
+        Scm_Error("[internal] tree map node count mismatch: record %d vs actual %d", tc->num_entries, c.count);
+    }
+}
+
+/* for debug */
+static void bt_dump(void *n, int depth, ScmPort *out, int scmobj)
+{
+    if (BT_LEAFP(n)) {
+        BTLeaf *l = (BTLeaf*)n;
+        for (int i=0; i<l->nkeys; i++) {
+            for (int j=0; j<depth; j++) Scm_Printf(out, "  ");
+            if (scmobj) {
+                Scm_Printf(out, "%S => %S\n", SCM_OBJ(l->entries[i]->key),
+                           SCM_OBJ(l->entries[i]->value));
+            } else {
+                Scm_Printf(out, "%08x => %08x\n", l->entries[i]->key,
+                           l->entries[i]->value);
+            }
+        }
+    } else {
+        BTNode *b = (BTNode*)n;
+        for (int i=0; i<=b->nkeys; i++) {
+            if (i > 0) {
+                for (int j=0; j<depth; j++) Scm_Printf(out, "  ");
+                if (scmobj) Scm_Printf(out, "[%S]\n", SCM_OBJ(b->keys[i-1]));
+                else        Scm_Printf(out, "[%08x]\n", b->keys[i-1]);
+            }
+            bt_dump(b->children[i], depth+1, out, scmobj);
+        }
+    }
+}
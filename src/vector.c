@@ -582,13 +582,21 @@ DEF_PRINT(F64, f64, double, fpr)
 
 /* comparer */
 
-#define DEF_CMP(TAG, tag, T, eq, lt)                                    \
+/* If BYTEWISE is TRUE, element equality coincides with bit equality
+   (integer types), so we check equality of the entire vectors with
+   memcmp.  It can't be used for flonums, for 0.0 = -0.0 and NaN != NaN. */
+#define DEF_CMP(TAG, tag, T, eq, lt, bytewise)                          \
 static int SCM_CPP_CAT3(compare_,tag,vector)(ScmObj x, ScmObj y, int equalp) \
 {                                                                       \
     ScmSmallInt xlen = SCM_CPP_CAT3(SCM_,TAG,VECTOR_SIZE)(x);           \
     ScmSmallInt ylen = SCM_CPP_CAT3(SCM_,TAG,VECTOR_SIZE)(y);           \
     if (equalp) {                                                       \
         if (xlen != ylen) return -1;                                    \
+        if (bytewise) {                                                 \
+            return (memcmp(SCM_CPP_CAT3(SCM_,TAG,VECTOR_ELEMENTS)(x),   \
+                           SCM_CPP_CAT3(SCM_,TAG,VECTOR_ELEMENTS)(y),   \
+                           xlen*sizeof(T)) == 0)? 0 : -1;               \
+        }                                                               \
         for (ScmSmallInt i=0; i<xlen; i++) {                            \
             T xx = SCM_CPP_CAT3(SCM_,TAG,VECTOR_ELEMENTS)(x)[i];        \
             T yy = SCM_CPP_CAT3(SCM_,TAG,VECTOR_ELEMENTS)(y)[i];        \
@@ -649,14 +657,14 @@ static inline int uint64lt(ScmUInt64 x, ScmUInt64 y)
 #define f16eqv(a, b) SCM_HALF_FLOAT_CMP(==, a, b)
 #define f16lt(a, b)  SCM_HALF_FLOAT_CMP(<, a, b)
 
-DEF_CMP(S8, s8, signed char, common_eqv, common_lt)
-DEF_CMP(U8, u8, unsigned char, common_eqv, common_lt)
-DEF_CMP(S16, s16, short, common_eqv, common_lt)
-DEF_CMP(U16, u16, u_short, common_eqv, common_lt)
-DEF_CMP(S32, s32, ScmInt32, common_eqv, common_lt)
-DEF_CMP(U32, u32, ScmUInt32, common_eqv, common_lt)
-DEF_CMP(S64, s64, ScmInt64, int64eqv, int64lt)
-DEF_CMP(U64, u64, ScmUInt64, uint64eqv, uint64lt)
-DEF_CMP(F16, f16, ScmHalfFloat, f16eqv, f16lt)
-DEF_CMP(F32, f32, float, common_eqv, common_lt)
-DEF_CMP(F64, f64, double, common_eqv, common_lt)
+DEF_CMP(S8, s8, signed char, common_eqv, common_lt, TRUE)
+DEF_CMP(U8, u8, unsigned char, common_eqv, common_lt, TRUE)
+DEF_CMP(S16, s16, short, common_eqv, common_lt, TRUE)
+DEF_CMP(U16, u16, u_short, common_eqv, common_lt, TRUE)
+DEF_CMP(S32, s32, ScmInt32, common_eqv, common_lt, TRUE)
+DEF_CMP(U32, u32, ScmUInt32, common_eqv, common_lt, TRUE)
+DEF_CMP(S64, s64, ScmInt64, int64eqv, int64lt, TRUE)
+DEF_CMP(U64, u64, ScmUInt64, uint64eqv, uint64lt, TRUE)
+DEF_CMP(F16, f16, ScmHalfFloat, f16eqv, f16lt, FALSE)
+DEF_CMP(F32, f32, float, common_eqv, common_lt, FALSE)
+DEF_CMP(F64, f64, double, common_eqv, common_lt, FALSE)
@@ -39,6 +39,7 @@
 #include "gauche/code.h"
 #include "gauche/vminsn.h"
 #include "gauche/prof.h"
+#include "gauche/priv/probeP.h"
 
 
 /* Experimental code to use custom mark procedure for stack gc.
@@ -115,6 +116,16 @@ static void vm_unregister(ScmVM *vm);
 static u_long vm_numeric_id = 0;    /* used for Scm_VM->vmid */
 static ScmInternalMutex vm_id_mutex;
 
+/* Terminated VMs given to Scm_VMRecycle, to be reused by Scm_NewVM.
+   See Scm_VMRecycle below. */
+#define VM_RECYCLE_POOL_SIZE 32
+static struct {
+    ScmInternalMutex mutex;
+    int count;
+    ScmVM *vms[VM_RECYCLE_POOL_SIZE];
+} vm_recycle_pool;
+static ScmVM *take_recycled_vm(void);
+
 #ifdef GAUCHE_USE_PTHREADS
 static pthread_key_t vm_key;
 #define theVM   ((ScmVM*)pthread_getspecific(vm_key))
@@ -125,7 +136,8 @@ static DWORD vm_key;
 static ScmVM *theVM;
 #endif /* !GAUCHE_USE_PTHREADS */
 
-static void save_stack(ScmVM *vm);
+static void save_stack(ScmVM *vm, int size);
+static ScmObj *alloc_stack(ScmVM *vm, int size);
 
 static ScmSubr default_exception_handler_rec;
 #define DEFAULT_EXCEPTION_HANDLER  SCM_OBJ(&default_exception_handler_rec)
@@ -171,12 +183,25 @@ static void   call_error_reporter(ScmObj e);
 
 ScmVM *Scm_NewVM(ScmVM *proto, ScmObj name)
 {
-    ScmVM *v = SCM_NEW(ScmVM);
+    ScmVM *v = take_recycled_vm();
+    int recycled = (v != NULL);
 
-    SCM_SET_CLASS(v, SCM_CLASS_VM);
+    if (!recycled) {
+        v = SCM_NEW(ScmVM);
+        SCM_SET_CLASS(v, SCM_CLASS_VM);
+        (void)SCM_INTERNAL_MUTEX_INIT(v->vmlock);
+        (void)SCM_INTERNAL_COND_INIT(v->cond);
+        v->stack = alloc_stack(v, SCM_VM_INITIAL_STACK_SIZE);
+        v->stackEnd = v->stack + SCM_VM_INITIAL_STACK_SIZE;
+#if GAUCHE_FFX
+        v->fpstack = SCM_NEW_ATOMIC_ARRAY(ScmFlonum,
+                                          SCM_VM_INITIAL_STACK_SIZE);
+        v->fpstackEnd = v->fpstack + SCM_VM_INITIAL_STACK_SIZE;
+#endif /* GAUCHE_FFX */
+        v->dstringPool = NULL;
+        v->dstringPoolCount = 0;
+    }
     v->state = SCM_VM_NEW;
-    (void)SCM_INTERNAL_MUTEX_INIT(v->vmlock);
-    (void)SCM_INTERNAL_COND_INIT(v->cond);
     v->canceller = NULL;
     v->inspector = NULL;
     v->name = name;
@@ -200,19 +225,9 @@ ScmVM *Scm_NewVM(ScmVM *proto, ScmObj name)
     v->finalizerPending = 0;
     v->stopRequest = 0;
 
-#ifdef USE_CUSTOM_STACK_MARKER
-    v->stack = (ScmObj*)GC_generic_malloc((SCM_VM_STACK_SIZE+1)*sizeof(ScmObj),
-                                          vm_stack_kind);
-    *v->stack++ = SCM_OBJ(v);
-#else  /*!USE_CUSTOM_STACK_MARKER*/
-    v->stack = SCM_NEW_ARRAY(ScmObj, SCM_VM_STACK_SIZE);
-#endif /*!USE_CUSTOM_STACK_MARKER*/
     v->sp = v->stack;
     v->stackBase = v->stack;
-    v->stackEnd = v->stack + SCM_VM_STACK_SIZE;
 #if GAUCHE_FFX
-    v->fpstack = SCM_NEW_ATOMIC_ARRAY(ScmFlonum, SCM_VM_STACK_SIZE);
-    v->fpstackEnd = v->fpstack + SCM_VM_STACK_SIZE;
     v->fpsp = v->fpstack;
 #endif /* GAUCHE_FFX */
 
@@ -233,16 +248,31 @@ ScmVM *Scm_NewVM(ScmVM *proto, ScmObj name)
     v->escapeData[0] = NULL;
     v->escapeData[1] = NULL;
     v->customErrorReporter = (proto? proto->customErrorReporter : SCM_FALSE);
+    v->affinity = SCM_FALSE;
+    v->allocArena = NULL;
 
     v->evalSituation = SCM_VM_EXECUTING;
 
     sigemptyset(&v->sigMask);
-    Scm_SignalQueueInit(&v->sigq);
+    if (recycled) {
+        Scm_SignalQueueClear(&v->sigq);
+        v->sigq.pending = SCM_NIL;
+    } else {
+        Scm_SignalQueueInit(&v->sigq);
+    }
 
     /* stats */
     v->stat.sovCount = 0;
     v->stat.sovTime = 0;
     v->stat.loadStat = SCM_NIL;
+    v->stat.loadReadTime = 0;
+    v->stat.loadCompileTime = 0;
+    v->stat.loadCompileStart = 0;
+    v->stat.loadStatOpen = SCM_NIL;
+    v->stat.callCount = 0;
+    v->stat.contCount = 0;
+    v->stat.fpFlushCount = 0;
+    v->stat.insnCounts = NULL;
     v->profilerRunning = FALSE;
     v->prof = NULL;
 
@@ -256,10 +286,81 @@ ScmVM *Scm_NewVM(ScmVM *proto, ScmObj name)
     v->vmid = vm_numeric_id++;
     (void)SCM_INTERNAL_MUTEX_UNLOCK(vm_id_mutex);
 
-    Scm_RegisterFinalizer(SCM_OBJ(v), vm_finalize, NULL);
+    if (!recycled) Scm_RegisterFinalizer(SCM_OBJ(v), vm_finalize, NULL);
     return v;
 }
 
+/* Recycling VMs
+ *
+ *   Creating a thread allocates and initializes a fresh VM: the structure
+ *   itself, its stacks, the parameter table, the signal queue, and a
+ *   finalizer registration, which takes the GC lock.  An application
+ *   that spawns a short-lived thread per task can hand the VM of a
+ *   finished thread back by Scm_VMRecycle, and the next Scm_NewVM reuses
+ *   it, only resetting its state.
+ *
+ *   The caller promises that nobody refers to VM anymore; from the
+ *   Scheme side, the <thread> object becomes a different thread when
+ *   the VM is reused.  We can't check that, so this is opt-in.  What we
+ *   check is that the thread has terminated and the OS thread is done
+ *   with the VM, that is, it's already unregistered from vm_table by
+ *   Scm_DetachVM.  Returns TRUE if VM is put in the pool, FALSE if it
+ *   isn't (it's still in use, or the pool is full).  In the latter case
+ *   VM is left intact, and will be collected as usual.
+ */
+int Scm_VMRecycle(ScmVM *vm)
+{
+    int recycled = FALSE;
+
+    if (vm == rootVM || vm->state != SCM_VM_TERMINATED) return FALSE;
+    (void)SCM_INTERNAL_MUTEX_LOCK(vm_table_mutex);
+    int attached = (Scm_HashCoreSearch(&vm_table, (intptr_t)vm,
+                                       SCM_DICT_GET) != NULL);
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(vm_table_mutex);
+    if (attached) return FALSE;
+
+#ifdef GAUCHE_USE_WTHREADS
+    if (vm->thread != INVALID_HANDLE_VALUE) {
+        CloseHandle(vm->thread);
+        vm->thread = INVALID_HANDLE_VALUE;
+    }
+#endif /*GAUCHE_USE_WTHREADS*/
+    /* Drop references so that the pooled VM doesn't retain garbage.
+       The rest is reset by Scm_NewVM. */
+    memset(vm->stack, 0, (vm->stackEnd - vm->stack) * sizeof(ScmObj));
+    vm->env = NULL;
+    vm->cont = NULL;
+    vm->base = NULL;
+    vm->thunk = NULL;
+    vm->result = vm->resultException = SCM_UNDEFINED;
+    vm->val0 = SCM_UNDEFINED;
+    for (int i=0; i<SCM_VM_MAX_VALUES; i++) vm->vals[i] = SCM_UNDEFINED;
+    vm->name = vm->specific = SCM_FALSE;
+    vm->handlers = SCM_NIL;
+
+    (void)SCM_INTERNAL_MUTEX_LOCK(vm_recycle_pool.mutex);
+    if (vm_recycle_pool.count < VM_RECYCLE_POOL_SIZE) {
+        vm_recycle_pool.vms[vm_recycle_pool.count++] = vm;
+        recycled = TRUE;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(vm_recycle_pool.mutex);
+    return recycled;
+}
+
+static ScmVM *take_recycled_vm(void)
+{
+    ScmVM *vm = NULL;
+    /* Racy peek to avoid locking in the common case. */
+    if (vm_recycle_pool.count == 0) return NULL;
+    (void)SCM_INTERNAL_MUTEX_LOCK(vm_recycle_pool.mutex);
+    if (vm_recycle_pool.count > 0) {
+        vm = vm_recycle_pool.vms[--vm_recycle_pool.count];
+        vm_recycle_pool.vms[vm_recycle_pool.count] = NULL;
+    }
+    (void)SCM_INTERNAL_MUTEX_UNLOCK(vm_recycle_pool.mutex);
+    return vm;
+}
+
 /* Attach the thread to the current thread.
    See the notes of Scm_NewVM above.
    Returns TRUE on success, FALSE on failure. */
@@ -297,6 +398,8 @@ int Scm_AttachVM(ScmVM *vm)
     }
     vm->state = SCM_VM_RUNNABLE;
     vm_register(vm);
+    Scm__ProfilerVMAttached(vm);
+    SCM_PROBE2(thread__start, vm, (long)vm->vmid);
     return TRUE;
 #else  /* no threads */
     return FALSE;
@@ -311,6 +414,8 @@ void Scm_DetachVM(ScmVM *vm)
 {
 #ifdef GAUCHE_HAS_THREADS
     if (vm != NULL) {
+        SCM_PROBE2(thread__stop, vm, (long)vm->vmid);
+        Scm__ProfilerVMDetached(vm);
         (void)SCM_INTERNAL_THREAD_SETSPECIFIC(Scm_VMKey(), NULL);
         vm_unregister(vm);
     }
@@ -404,6 +509,24 @@ static void vm_unregister(ScmVM *vm)
     SCM_INTERNAL_MUTEX_UNLOCK(vm_table_mutex);
 }
 
+/* Internal.  Returns a list of the primordial VM and the VMs attached
+   to threads.  Used by the process-wide profiler. */
+ScmObj Scm__VMAllVMs(void)
+{
+    ScmObj h = SCM_NIL, t = SCM_NIL;
+    if (rootVM) SCM_APPEND1(h, t, SCM_OBJ(rootVM));
+    SCM_INTERNAL_MUTEX_LOCK(vm_table_mutex);
+    ScmHashIter iter;
+    Scm_HashIterInit(&iter, &vm_table);
+    ScmDictEntry *e;
+    while ((e = Scm_HashIterNext(&iter)) != NULL) {
+        ScmObj v = SCM_OBJ(e->key);
+        if (!SCM_EQ(v, SCM_OBJ(rootVM))) SCM_APPEND1(h, t, v);
+    }
+    SCM_INTERNAL_MUTEX_UNLOCK(vm_table_mutex);
+    return h;
+}
+
 /*====================================================================
  * VM interpreter
  *
@@ -426,6 +549,18 @@ static void vm_unregister(ScmVM *vm)
 #define FETCH_INSN(var)         ((var) = fetch_insn_counting(vm, var))
 #endif
 
+/* event counters, active while SCM_COLLECT_VM_STATS is set */
+#define VM_STAT_COUNT(vm, counter)                                      \
+    do {                                                                \
+        if (SCM_VM_RUNTIME_FLAG_IS_SET(vm, SCM_COLLECT_VM_STATS)) {     \
+            (vm)->stat.counter++;                                       \
+        }                                                               \
+    } while (0)
+
+#define VM_COUNTING_INSNS_P(vm)                                         \
+    (SCM_VM_RUNTIME_FLAG_IS_SET(vm, SCM_COLLECT_VM_STATS)               \
+     && (vm)->stat.insnCounts != NULL)
+
 /* For sanity check in debugging mode */
 #ifdef PARANOIA
 #define CHECK_STACK_PARANOIA(n)  CHECK_STACK(n)
@@ -476,14 +611,15 @@ static void vm_unregister(ScmVM *vm)
 #define BASE  (vm->base)
 
 /* return true if ptr points into the stack area */
-#define IN_STACK_P(ptr)                         \
-      ((unsigned long)((ptr) - vm->stackBase) < SCM_VM_STACK_SIZE)
+#define IN_STACK_P(ptr)                                                 \
+      ((unsigned long)((ptr) - vm->stackBase)                           \
+       < (unsigned long)(vm->stackEnd - vm->stackBase))
 
 /* Check if stack has room at least size bytes. */
 #define CHECK_STACK(size)                                       \
     do {                                                        \
         if (MOSTLY_FALSE(SP >= vm->stackEnd - (size))) {        \
-            save_stack(vm);                                     \
+            save_stack(vm, (size));                             \
         }                                                       \
     } while (0)
 
@@ -554,6 +690,7 @@ static void vm_unregister(ScmVM *vm)
 /* return operation. */
 #define RETURN_OP()                                     \
     do {                                                \
+        SCM_PROBE2(procedure__return, vm, VAL0);        \
         if (CONT == NULL || BOUNDARY_FRAME_P(CONT)) {   \
             return; /* no more continuations */         \
         }                                               \
@@ -732,14 +869,14 @@ static void vm_unregister(ScmVM *vm)
    new fused vm insns.
 */
 #ifdef __GNUC__
-#define SWITCH(val) goto *dispatch_table[val];
+#define SWITCH(val) goto *dispatch[val];
 #define CASE(insn)  SCM_CPP_CAT(LABEL_, insn) :
 #define DEFAULT     LABEL_DEFAULT :
 #define DISPATCH    /*empty*/
 #define NEXT                                            \
     do {                                                \
         FETCH_INSN(code);                               \
-        goto *dispatch_table[SCM_VM_INSN_CODE(code)];   \
+        goto *dispatch[SCM_VM_INSN_CODE(code)];         \
     } while (0)
 #define NEXT_PUSHCHECK                                  \
     do {                                                \
@@ -748,7 +885,7 @@ static void vm_unregister(ScmVM *vm)
             PUSH_ARG(VAL0);                             \
             FETCH_INSN(code);                           \
         }                                               \
-        goto *dispatch_table[SCM_VM_INSN_CODE(code)];   \
+        goto *dispatch[SCM_VM_INSN_CODE(code)];         \
     } while (0)
 #else /* !__GNUC__ */
 #define SWITCH(val)    switch (val)
@@ -859,11 +996,23 @@ static void run_loop()
     ScmWord code = 0;
 
 #ifdef __GNUC__
-    static void *dispatch_table[256] = {
+    static void *dispatch_table[SCM_VM_NUM_INSNS] = {
 #define DEFINSN(insn, name, nargs, type, flags)   && SCM_CPP_CAT(LABEL_, insn),
 #include "vminsn.c"
 #undef DEFINSN
     };
+    /* While the VM is counting instructions, we dispatch through this
+       table, whose entries all lead to count_insn.  This way the normal
+       dispatch doesn't pay for the check.  The table is switched when
+       run_loop is entered and when the VM processes its attention request
+       (Scm_VMCollectStats requests one).
+       NB: PUSH folded into NEXT_PUSHCHECK isn't counted. */
+    static void *counting_table[SCM_VM_NUM_INSNS] = {
+#define DEFINSN(insn, name, nargs, type, flags)   && count_insn,
+#include "vminsn.c"
+#undef DEFINSN
+    };
+    void **dispatch = VM_COUNTING_INSNS_P(vm)? counting_table : dispatch_table;
 #endif /* __GNUC__ */
 
     /* Records the offset of each instruction handler from run_loop entry
@@ -883,6 +1032,11 @@ static void run_loop()
         /*VM_DUMP("");*/
         if (vm->attentionRequest) goto process_queue;
         FETCH_INSN(code);
+#ifndef __GNUC__
+        if (VM_COUNTING_INSNS_P(vm)) {
+            vm->stat.insnCounts[SCM_VM_INSN_CODE(code)]++;
+        }
+#endif
         SWITCH(SCM_VM_INSN_CODE(code)) {
 #define VMLOOP
 #include "vminsn.c"
@@ -898,7 +1052,15 @@ static void run_loop()
         PUSH_CONT(PC);
         process_queued_requests(vm);
         POP_CONT();
+#ifdef __GNUC__
+        dispatch = VM_COUNTING_INSNS_P(vm)? counting_table : dispatch_table;
+#endif
         NEXT;
+#ifdef __GNUC__
+      count_insn:
+        vm->stat.insnCounts[SCM_VM_INSN_CODE(code)]++;
+        goto *dispatch_table[SCM_VM_INSN_CODE(code)];
+#endif
     }
 }
 /* End of run_loop */
@@ -981,15 +1143,22 @@ static inline ScmEnvFrame *save_env(ScmVM *vm, ScmEnvFrame *env_begin)
    cont frames, then updates the pointers to them.
    After save_cont, the only thing possibly left in the stack is the argument
    frame pointed by vm->argp.
+
+   If BOTTOM is not NULL, it must be an in-stack frame in the current
+   continuation chain, and we only save the frames above it; BOTTOM and
+   the frames below are left in the stack.  The caller must make sure
+   no env frame below BOTTOM is reachable from the saved frames (see
+   envs_above_frame_p), and have to cut the chain of the saved frames
+   from BOTTOM, for heap frames can't point into the stack.
  */
-static void save_cont(ScmVM *vm)
+static void save_cont_upto(ScmVM *vm, ScmContFrame *bottom)
 {
     ScmContFrame *c = vm->cont, *prev = NULL;
 
     /* Save the environment chain first. */
     vm->env = save_env(vm, vm->env);
 
-    if (!IN_STACK_P((ScmObj*)c)) return;
+    if (!IN_STACK_P((ScmObj*)c) || c == bottom) return;
 
     /* First pass */
     do {
@@ -1034,7 +1203,7 @@ static void save_cont(ScmVM *vm)
         c->prev = csave;
         c->size = -1;
         c = tmp;
-    } while (IN_STACK_P((ScmObj*)c));
+    } while (IN_STACK_P((ScmObj*)c) && c != bottom);
 
     /* Second pass */
     if (FORWARDED_CONT_P(vm->cont)) {
@@ -1057,7 +1226,78 @@ static void save_cont(ScmVM *vm)
     }
 }
 
-static void save_stack(ScmVM *vm)
+static inline void save_cont(ScmVM *vm)
+{
+    save_cont_upto(vm, NULL);
+}
+
+/* Returns TRUE iff all in-stack env frames reachable from vm->env and
+   the continuation frames above BOTTOM are located above BOTTOM, that is,
+   save_cont_upto(vm, BOTTOM) won't move env frames that the frames
+   below BOTTOM may refer to. */
+static int envs_above_frame_p(ScmVM *vm, ScmContFrame *bottom)
+{
+    ScmObj *limit = (ScmObj*)bottom;
+
+    for (ScmEnvFrame *e = vm->env; IN_STACK_P((ScmObj*)e); e = e->up) {
+        if ((ScmObj*)e < limit) return FALSE;
+    }
+    for (ScmContFrame *c = vm->cont; c != bottom; c = c->prev) {
+        for (ScmEnvFrame *e = c->env; IN_STACK_P((ScmObj*)e); e = e->up) {
+            if ((ScmObj*)e < limit) return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+/* The VM stack starts small, for most threads never go deep, and
+   thousands of mostly idle threads would otherwise keep the full-sized
+   stack each.  When it overflows, the frames are moved to the heap
+   anyway (see save_stack below), after which nothing but the current
+   argument frame is left in the stack, and nothing but vm->argp and
+   vm->sp points into it.  So that's where we can switch to a larger
+   stack safely, by just copying the argument frame.  We double the size
+   each time, up to SCM_VM_STACK_SIZE.  A thread running deep recursion
+   reaches the full size after a few overflows, and from then on behaves
+   as it had the fixed-size stack; a thread that doesn't keeps a small
+   one.
+
+   NB: With USE_CUSTOM_STACK_MARKER, the word before the stack keeps the
+   owner VM, for the marker needs it. */
+static ScmObj *alloc_stack(ScmVM *vm, int size)
+{
+#ifdef USE_CUSTOM_STACK_MARKER
+    ScmObj *s = (ScmObj*)GC_generic_malloc((size+1)*sizeof(ScmObj),
+                                           vm_stack_kind);
+    *s++ = SCM_OBJ(vm);
+    return s;
+#else  /*!USE_CUSTOM_STACK_MARKER*/
+    return SCM_NEW_ARRAY(ScmObj, size);
+#endif /*!USE_CUSTOM_STACK_MARKER*/
+}
+
+/* Called right after the stack is emptied by save_stack.  NEEDED is
+   the room the caller asked for. */
+static void grow_stack(ScmVM *vm, int needed)
+{
+    long cursize = vm->stackEnd - vm->stackBase;
+    long used = vm->sp - vm->stackBase;
+    long newsize = cursize * 2;
+
+    while (newsize < used + needed + 1 && newsize < SCM_VM_STACK_SIZE) {
+        newsize *= 2;
+    }
+    if (newsize > SCM_VM_STACK_SIZE) newsize = SCM_VM_STACK_SIZE;
+
+    ScmObj *s = alloc_stack(vm, (int)newsize);
+    memcpy(s, vm->stackBase, used * sizeof(ScmObj));
+    vm->stack = vm->stackBase = s;
+    vm->argp = s;
+    vm->sp = s + used;
+    vm->stackEnd = s + newsize;
+}
+
+static void save_stack(ScmVM *vm, int size)
 {
 #if HAVE_GETTIMEOFDAY
     int stats = SCM_VM_RUNTIME_FLAG_IS_SET(vm, SCM_COLLECT_VM_STATS);
@@ -1073,8 +1313,12 @@ static void save_stack(ScmVM *vm)
             (vm->sp - (ScmObj*)vm->argp) * sizeof(ScmObj*));
     vm->sp -= (ScmObj*)vm->argp - vm->stackBase;
     vm->argp = vm->stackBase;
-    /* Clear the stack.  This removes bogus pointers and accelerates GC */
-    for (ScmObj *p = vm->sp; p < vm->stackEnd; p++) *p = NULL;
+    if (vm->stackEnd - vm->stackBase < SCM_VM_STACK_SIZE) {
+        grow_stack(vm, size);
+    } else {
+        /* Clear the stack.  This removes bogus pointers and accelerates GC */
+        for (ScmObj *p = vm->sp; p < vm->stackEnd; p++) *p = NULL;
+    }
 
 #if HAVE_GETTIMEOFDAY
     if (stats) {
@@ -1175,6 +1419,7 @@ void Scm_VMFlushFPStack(ScmVM *vm)
     struct timeval t0, t1;
     gettimeofday(&t0, NULL);
 #endif
+    VM_STAT_COUNT(vm, fpFlushCount);
 
     /* first, scan value registers and incomplete frames */
     SCM_FLONUM_ENSURE_MEM(VAL0);
@@ -1228,6 +1473,15 @@ void Scm_VMFlushFPStack(ScmVM *vm)
         c = c->prev;
     }
 
+    /* Nothing refers to the fpstack now, so we can replace it with a larger
+       one if it's not full size yet.  See grow_stack above. */
+    long fpsize = vm->fpstackEnd - vm->fpstack;
+    if (fpsize < SCM_VM_STACK_SIZE) {
+        fpsize *= 2;
+        if (fpsize > SCM_VM_STACK_SIZE) fpsize = SCM_VM_STACK_SIZE;
+        vm->fpstack = SCM_NEW_ATOMIC_ARRAY(ScmFlonum, fpsize);
+        vm->fpstackEnd = vm->fpstack + fpsize;
+    }
     vm->fpsp = vm->fpstack;
 
 #ifdef COUNT_FLUSH_FPSTACK
@@ -1375,7 +1629,25 @@ ScmObj Scm_VMEval(ScmObj expr, ScmObj e)
     int restore_module = SCM_MODULEP(e);
     ScmVM *vm = theVM;
 
-    ScmObj v = Scm_Compile(expr, e);
+    ScmObj v;
+    ScmInt64 saved = vm->stat.loadCompileStart;
+    if (SCM_VM_RUNTIME_FLAG_IS_SET(vm, SCM_COLLECT_LOAD_STATS) && saved <= 0) {
+        /* Time the outermost compile.  A nested load suspends the timing;
+           see Scm__RecordLoadStat. */
+        vm->stat.loadCompileStart = Scm_MonotonicNanoseconds();
+        SCM_UNWIND_PROTECT { v = Scm_Compile(expr, e); }
+        SCM_WHEN_ERROR {
+            vm->stat.loadCompileStart = saved;
+            SCM_NEXT_HANDLER;
+        } SCM_END_PROTECT;
+        if (vm->stat.loadCompileStart > 0) {
+            vm->stat.loadCompileTime +=
+                Scm_MonotonicNanoseconds() - vm->stat.loadCompileStart;
+        }
+        vm->stat.loadCompileStart = saved;
+    } else {
+        v = Scm_Compile(expr, e);
+    }
     if (SCM_VM_COMPILER_FLAG_IS_SET(theVM, SCM_COMPILE_SHOWRESULT)) {
         Scm_CompiledCodeDump(SCM_COMPILED_CODE(v));
     }
@@ -1560,8 +1832,47 @@ ScmObj Scm_EvalRec(ScmObj expr, ScmObj e)
    user_eval_inner returns it would never be reused.   However, tools
    that want to keep a pointer to a code vector would need to be aware
    of this case. */
+/* Subrs flagged SCM_SUBR_IMMEDIATE_ARG are simple leaf procedures, so
+   we call them directly instead of going through user_eval_inner; this
+   makes callbacks like (sort lis <) cheap.  Returns TRUE if we handled
+   the call.  We leave it to the VM if PROC needs to report an argument
+   count error, if there's a pending attention request (e.g. signals)
+   that the VM loop should process, or if there's no C stack boundary
+   to which an error can escape. */
+static int apply_subr_direct(ScmVM *vm, ScmObj proc, int nargs)
+{
+    ScmObj argv[SCM_VM_MAX_VALUES];
+    int reqargs = SCM_PROCEDURE_REQUIRED(proc);
+    int optargs = SCM_PROCEDURE_OPTIONAL(proc);
+    int argc = nargs;
+
+    if (vm->attentionRequest || vm->cstack == NULL) return FALSE;
+    if (optargs) {
+        if (nargs < reqargs) return FALSE;
+        /* fold &rest args, as ADJUST_ARGUMENT_FRAME does */
+        ScmObj p = SCM_NIL;
+        if (argc > reqargs+optargs-1) argc = reqargs+optargs-1;
+        for (int i=nargs-1; i>=argc; i--) p = Scm_Cons(vm->vals[i], p);
+        for (int i=0; i<argc; i++) argv[i] = vm->vals[i];
+        argv[argc++] = p;
+    } else {
+        if (nargs != reqargs) return FALSE;
+        for (int i=0; i<argc; i++) argv[i] = vm->vals[i];
+    }
+    SCM_PROF_COUNT_CALL(vm, proc);
+    vm->numVals = 1;
+    vm->val0 = SCM_SUBR(proc)->func(argv, argc, SCM_SUBR(proc)->data);
+    return TRUE;
+}
+
 static ScmObj apply_rec(ScmVM *vm, ScmObj proc, int nargs)
 {
+    if (SCM_SUBR_IMMEDIATE_P(proc)
+        && nargs < SCM_VM_MAX_VALUES-1
+        && apply_subr_direct(vm, proc, nargs)) {
+        return vm->val0;
+    }
+
     ScmWord code[2];
     code[0] = SCM_WORD(SCM_VM_INSN1(SCM_VM_VALUES_APPLY, nargs));
     code[1] = SCM_WORD(SCM_VM_INSN(SCM_VM_RET));
@@ -2148,6 +2459,7 @@ ScmObj Scm_VMThrowException2(ScmVM *vm, ScmObj exception, u_long raise_flags)
 {
     ScmEscapePoint *ep = vm->escapePoint;
 
+    SCM_PROBE2(exception__raise, vm, exception);
     SCM_VM_RUNTIME_FLAG_CLEAR(vm, SCM_ERROR_BEING_HANDLED);
 
     if (vm->exceptionHandler != DEFAULT_EXCEPTION_HANDLER) {
@@ -2202,6 +2514,8 @@ static ScmObj discard_ehandler(ScmObj *args, int nargs, void *data)
     return SCM_UNDEFINED;
 }
 
+static ScmObj with_error_handler_cc(ScmObj result, void **data);
+
 static ScmObj with_error_handler(ScmVM *vm, ScmObj handler,
                                  ScmObj thunk, int rewindBefore)
 {
@@ -2223,12 +2537,32 @@ static ScmObj with_error_handler(ScmVM *vm, ScmObj handler,
         SCM_VM_RUNTIME_FLAG_IS_SET(vm, SCM_ERROR_BEING_REPORTED);
     ep->rewindBefore = rewindBefore;
 
-    vm->escapePoint = ep; /* This will be done in install_ehandler, but
-                             make sure ep is visible from save_cont
-                             to redirect ep->cont */
+    /* This is (dynamic-wind install_ehandler thunk discard_ehandler),
+       except that we run install_ehandler and discard_ehandler directly
+       instead of applying them through VM on the normal entry and exit.
+       The subrs are only called when a continuation or an error crosses
+       the boundary, via vm->handlers. */
     ScmObj before = Scm_MakeSubr(install_ehandler, ep, 0, 0, SCM_FALSE);
     ScmObj after  = Scm_MakeSubr(discard_ehandler, ep, 0, 0, SCM_FALSE);
-    return Scm_VMDynamicWind(before, thunk, after);
+    ScmObj prev = vm->handlers;
+    void *data[2];
+
+    install_ehandler(NULL, 0, ep);
+    vm->handlers = Scm_Cons(Scm_Cons(before, after), prev);
+    data[0] = (void*)ep;
+    data[1] = (void*)prev;
+    Scm_VMPushCC(with_error_handler_cc, data, 2);
+    return Scm_VMApply0(thunk);
+}
+
+/* Normal exit from with-error-handler.  Since discard_ehandler doesn't
+   touch the value registers, we can return the result(s) as they are. */
+static ScmObj with_error_handler_cc(ScmObj result, void **data)
+{
+    ScmVM *vm = theVM;
+    vm->handlers = SCM_OBJ(data[1]);
+    discard_ehandler(NULL, 0, data[0]);
+    return result;
 }
 
 ScmObj Scm_VMWithErrorHandler(ScmObj handler, ScmObj thunk)
@@ -2415,6 +2749,8 @@ ScmObj Scm_VMCallCC(ScmObj proc)
 {
     ScmVM *vm = theVM;
 
+    VM_STAT_COUNT(vm, contCount);
+    SCM_PROBE2(continuation__capture, vm, 0);
     save_cont(vm);
     ScmEscapePoint *ep = SCM_NEW(ScmEscapePoint);
     ep->prev = NULL;
@@ -2428,6 +2764,16 @@ ScmObj Scm_VMCallCC(ScmObj proc)
     return Scm_VMApply1(proc, contproc);
 }
 
+/* Body of the procedure passed to the shift operator.  The partial
+   continuation returns to where it's invoked, so we run it under a new
+   boundary frame---it's the same as (reset (apply k args)), but we don't
+   need to allocate a closure for each k. */
+static ScmObj throw_partial_continuation(ScmObj *argframe, int nargs,
+                                         void *data)
+{
+    return Scm_ApplyRec(SCM_OBJ(data), argframe[0]);
+}
+
 /* call with partial continuation.  this corresponds to the 'shift' operator
    in shift/reset controls (Gasbichler&Sperber, "Final Shift for Call/cc",
    ICFP02.)   Note that we treat the boundary frame as the bottom of
@@ -2436,14 +2782,26 @@ ScmObj Scm_VMCallPC(ScmObj proc)
 {
     ScmVM *vm = theVM;
 
+    VM_STAT_COUNT(vm, contCount);
+    SCM_PROBE2(continuation__capture, vm, 1);
+
     /* save the continuation.  we only need to save the portion above the
-       latest boundary frame (+environmentns pointed from them), but for now,
-       we save everything to make things easier.  If we want to squeeze
-       performance we'll optimize it later. */
-    save_cont(vm);
+       latest boundary frame (+environments pointed from them).  If the
+       boundary frame is in the stack, and the env frames we need are all
+       above it, we leave the frames below the boundary in the stack, so
+       that capturing partial continuation repeatedly in a deep stack
+       won't copy the whole stack each time.  Otherwise we save
+       everything. */
+    ScmContFrame *c, *cp;
+    for (c = vm->cont; c && !BOUNDARY_FRAME_P(c); c = c->prev)
+        /*empty*/;
+    if (c && IN_STACK_P((ScmObj*)c) && envs_above_frame_p(vm, c)) {
+        save_cont_upto(vm, c);
+    } else {
+        save_cont(vm);
+    }
 
     /* find the latest boundary frame */
-    ScmContFrame *c, *cp;
     for (c = vm->cont, cp = NULL;
          c && !BOUNDARY_FRAME_P(c);
          cp = c, c = c->prev)
@@ -2458,7 +2816,9 @@ ScmObj Scm_VMCallPC(ScmObj proc)
     ep->handlers = vm->handlers;
     ep->cstack = NULL; /* so that the partial continuation can be run
                           on any cstack state. */
-    ScmObj contproc = Scm_MakeSubr(throw_continuation, ep, 0, 1,
+    ScmObj k = Scm_MakeSubr(throw_continuation, ep, 0, 1,
+                            SCM_MAKE_STR("partial continuation"));
+    ScmObj contproc = Scm_MakeSubr(throw_partial_continuation, k, 0, 1,
                                    SCM_MAKE_STR("partial continuation"));
     /* Remove the saved continuation chain.
        NB: c can be NULL if we've been executing a partial continuation.
@@ -2649,6 +3009,10 @@ static void process_queued_requests(ScmVM *vm)
     if (vm->signalPending)   Scm_SigCheck(vm);
     if (vm->finalizerPending) Scm_VMFinalizerRun(vm);
 
+    /* The process-wide profiler asks this thread to start or stop
+       receiving samples.  See prof.c */
+    if (vm->prof && vm->prof->threadRequest) Scm__ProfilerThreadRequest(vm);
+
     /* VM STOP is required from other thread.
        See Scm_ThreadStop() in ext/threads/threads.c */
     if (vm->stopRequest) {
@@ -2890,9 +3254,11 @@ struct GC_ms_entry *vm_stack_mark(GC_word *addr,
     struct GC_ms_entry *e = mark_sp;
     ScmObj *vmsb = ((ScmObj*)addr)+1;
     ScmVM *vm = (ScmVM*)*addr;
+    /* A stack replaced by grow_stack may still be around */
+    if (vmsb != vm->stackBase) return e;
     int limit = vm->sp - vm->stackBase + 5;
     void *spb = (void *)vm->stackBase;
-    void *sbe = (void *)(vm->stackBase + SCM_VM_STACK_SIZE);
+    void *sbe = (void *)vm->stackEnd;
     void *hb = GC_least_plausible_heap_addr;
     void *he = GC_greatest_plausible_heap_addr;
 
@@ -2907,6 +3273,76 @@ struct GC_ms_entry *vm_stack_mark(GC_word *addr,
 }
 #endif /*USE_CUSTOM_STACK_MARKER*/
 
+/*===============================================================
+ * Statistics
+ */
+
+/* Turn on/off the stats collection of VM.  VM may be other than the
+   current VM.  In that case, VM starts (or stops) counting instructions
+   when it processes the attention request. */
+void Scm_VMCollectStats(ScmVM *vm, int flag)
+{
+    if (flag) {
+        if (vm->stat.insnCounts == NULL) {
+            vm->stat.insnCounts = SCM_NEW_ATOMIC_ARRAY(u_long,
+                                                       SCM_VM_NUM_INSNS);
+            memset(vm->stat.insnCounts, 0,
+                   SCM_VM_NUM_INSNS * sizeof(u_long));
+        }
+        SCM_VM_RUNTIME_FLAG_SET(vm, SCM_COLLECT_VM_STATS);
+    } else {
+        SCM_VM_RUNTIME_FLAG_CLEAR(vm, SCM_COLLECT_VM_STATS);
+    }
+    vm->attentionRequest = TRUE;
+}
+
+void Scm_VMResetStats(ScmVM *vm)
+{
+    vm->stat.sovCount = 0;
+    vm->stat.sovTime = 0;
+    vm->stat.callCount = 0;
+    vm->stat.contCount = 0;
+    vm->stat.fpFlushCount = 0;
+    if (vm->stat.insnCounts) {
+        memset(vm->stat.insnCounts, 0, SCM_VM_NUM_INSNS * sizeof(u_long));
+    }
+}
+
+/* Returns the stats of VM in a hash table.  The number of executed
+   instructions is kept in another hash table, keyed by instruction
+   names, under the key instruction-counts. */
+ScmObj Scm_VMStats(ScmVM *vm)
+{
+    ScmHashTable *h = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+    ScmHashTable *ih = SCM_HASH_TABLE(Scm_MakeHashTableSimple(SCM_HASH_EQ, 0));
+    u_long total = 0;
+
+    if (vm->stat.insnCounts) {
+        for (int i = 0; i < SCM_VM_NUM_INSNS; i++) {
+            u_long cnt = vm->stat.insnCounts[i];
+            if (cnt == 0) continue;
+            total += cnt;
+            Scm_HashTableSet(ih, SCM_INTERN(Scm_VMInsnName(i)),
+                             Scm_MakeIntegerU(cnt), 0);
+        }
+    }
+#define STAT_SET(key, val) \
+    Scm_HashTableSet(h, SCM_INTERN(key), val, 0)
+    STAT_SET("collecting",
+             SCM_MAKE_BOOL(SCM_VM_RUNTIME_FLAG_IS_SET(vm,
+                                                      SCM_COLLECT_VM_STATS)));
+    STAT_SET("instructions", Scm_MakeIntegerU(total));
+    STAT_SET("instruction-counts", SCM_OBJ(ih));
+    STAT_SET("calls", Scm_MakeIntegerU(vm->stat.callCount));
+    STAT_SET("stack-overflows", Scm_MakeIntegerU(vm->stat.sovCount));
+    STAT_SET("stack-overflow-time", Scm_MakeFlonum(vm->stat.sovTime/1.0e6));
+    STAT_SET("continuation-captures", Scm_MakeIntegerU(vm->stat.contCount));
+    STAT_SET("fpstack-flushes", Scm_MakeIntegerU(vm->stat.fpFlushCount));
+    STAT_SET("stack-size", Scm_MakeInteger(vm->stackEnd - vm->stackBase));
+#undef STAT_SET
+    return SCM_OBJ(h);
+}
+
 ScmObj Scm__VMInsnOffsets()
 {
     ScmObj v = Scm_MakeVector(SCM_VM_NUM_INSNS, SCM_FALSE);
@@ -2934,6 +3370,7 @@ void Scm__InitVM(void)
     Scm_HashCoreInitSimple(&vm_table, SCM_HASH_EQ, 8, NULL);
     SCM_INTERNAL_MUTEX_INIT(vm_table_mutex);
     SCM_INTERNAL_MUTEX_INIT(vm_id_mutex);
+    SCM_INTERNAL_MUTEX_INIT(vm_recycle_pool.mutex);
 
     /* Create root VM */
     rootVM = Scm_NewVM(NULL, SCM_MAKE_STR_IMMUTABLE("root"));
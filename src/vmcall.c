@@ -145,6 +145,8 @@
 
     argc = (int)(SP - ARGP);
     vm->numVals = 1; /* default */
+    VM_STAT_COUNT(vm, callCount);
+    SCM_PROBE3(procedure__entry, vm, VAL0, argc);
 
     /* object-apply hook.  shift args, and insert val0 into
        the fist arg slot, then call GenericObjectApply. */
@@ -248,13 +250,29 @@
         }
       GENERIC_ENTRY:
         /* pure generic application.  we implement MOP in C. */
+#if !defined(APPLY_CALL)
+        /* Common case.  We get sorted methods, using the dispatch cache. */
+        mm = Scm__ComputeSortedApplicableMethods(SCM_GENERIC(VAL0),
+                                                 ARGP, argc);
+        if (!SCM_NULLP(mm)) {
+#if GAUCHE_FFX
+            {
+                ScmObj *ap = ARGP;
+                for (int i=0;i<argc; i++, ap++) SCM_FLONUM_ENSURE_MEM(*ap);
+            }
+#endif /*GAUCHE_FFX*/
+            nm = Scm_MakeNextMethod(SCM_GENERIC(VAL0), SCM_CDR(mm),
+                                    ARGP, argc, TRUE, APP);
+            VAL0 = SCM_CAR(mm);
+            proctype = SCM_PROC_METHOD;
+        }
+#else  /*APPLY_CALL*/
         mm = Scm_ComputeApplicableMethods(SCM_GENERIC(VAL0), ARGP, argc, APP);
         if (!SCM_NULLP(mm)) {
             /* sort methods.  we only need as many args as
                gf->maxReqargs to order methods, so we only unfold that
                many args if applyargs.
             */
-#if defined(APPLY_CALL)
             if (argc-1<SCM_GENERIC(VAL0)->maxReqargs) {
                 ScmObj args;
                 POP_ARG(args);
@@ -267,7 +285,6 @@
                 }
                 PUSH_ARG(args);
             }
-#endif /*APPLY_CALL*/
 #if GAUCHE_FFX
             {
                 ScmObj *ap = ARGP;
@@ -280,6 +297,7 @@
             VAL0 = SCM_CAR(mm);
             proctype = SCM_PROC_METHOD;
         }
+#endif /*APPLY_CALL*/
     } else if (proctype == SCM_PROC_NEXT_METHOD) {
         ScmNextMethod *n = SCM_NEXT_METHOD(VAL0);
         int use_saved_args = FALSE;
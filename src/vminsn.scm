@@ -740,10 +740,9 @@
          (set! e (-> e up)))
     (VM-ASSERT (!= e NULL))
     (VM-ASSERT (> (-> e size) off))
-    (SCM_FLONUM_ENSURE_MEM VAL0)
     (let* ([box (ENV-DATA e off)])
       (VM_ASSERT (SCM_BOXP box))
-      (SCM_BOX_SET box VAL0))
+      (SCM_LOCAL_BOX_SET box VAL0))
     (set! (-> vm numVals) 1)
     NEXT))
 
@@ -1383,16 +1382,12 @@
 (define-insn BOX 1 none #f
   (let* ([param::int (SCM_VM_INSN_ARG code)])
     (cond [(== param 0)
-           (SCM_FLONUM_ENSURE_MEM VAL0)
-           (let* ([b::ScmBox* (Scm_MakeBox VAL0)])
-             (set! VAL0 (SCM_OBJ b)))]
+           (set! VAL0 (Scm__MakeLocalBox VAL0))]
           [(> param 0)
            (let* ([off::int (- param 1)])
              (VM-ASSERT (> (-> ENV size) off))
-             (let* ([v (ENV-DATA ENV off)])
-               (SCM_FLONUM_ENSURE_MEM v)
-               (let* ([b::ScmBox* (Scm_MakeBox v)])
-                 (set! (ENV-DATA ENV off) (SCM_OBJ b)))))])
+             (set! (ENV-DATA ENV off)
+                   (Scm__MakeLocalBox (ENV-DATA ENV off))))])
     NEXT))
 
 ;; ENV-SET(offset)
@@ -1410,10 +1405,14 @@
 
 ;; UNBOX
 ;;  VAL0 <- unbox(VAL0)
+;;  If the box holds a flonum in its own cell, we return a copy of it,
+;;  for the cell will be overwritten by the next LSET.  See box.c.
 (define-insn UNBOX 0 none #f
   ($w/argr v
-    (set! VAL0 (SCM_BOX_VALUE v))
-    NEXT))
+    (let* ([r (SCM_BOX_VALUE v)])
+      (if (== r (SCM_LOCAL_BOX_CELL v))
+        ($result:f (SCM_FLONUM_VALUE r))
+        ($result r)))))
 
 (define-insn LREF-UNBOX 2 none (LREF UNBOX) #f :fold-lref)
 
@@ -1435,3 +1434,38 @@
   (let* ([divisor::ScmSmallInt (SCM_VM_INSN_ARG code)])
     ($w/argr arg ($result (Scm_Modulo arg (SCM_MAKE_INT divisor) TRUE)))))
 
+;; Unchecked versions of arithmetic and vector access.  The compiler
+;; emits them only when it has proven the types and ranges of the
+;; operands; see pass3/specialize-fixnum in compile.scm.
+(define-insn FXADDI       1 none #f     ; +, VAL0 is a fixnum, no overflow
+  ($w/argr arg
+    (VM-ASSERT (SCM_INTP arg))
+    ($result:i (+ (SCM_INT_VALUE arg) (SCM_VM_INSN_ARG code)))))
+
+(define-insn-lref+ LREF-FXADDI 1 none (LREF FXADDI))
+(define-insn-lref+ LREF-FXADDI-PUSH 1 none (LREF FXADDI PUSH))
+
+(define-insn VEC-REF-NC   0 none #f     ; vector-ref, index in range
+  ($w/argp vec
+    (VM-ASSERT (and (SCM_VECTORP vec) (SCM_INTP VAL0)))
+    ($result (SCM_VECTOR_ELEMENT vec (SCM_INT_VALUE VAL0)))))
+
+(define-insn VEC-SET-NC   0 none #f     ; vector-set!, index in range
+  (let* ([vec] [ind] [v VAL0])
+    (POP-ARG ind)
+    (POP-ARG vec)
+    (VM-ASSERT (and (SCM_VECTORP vec) (SCM_INTP ind)))
+    (SCM_FLONUM_ENSURE_MEM v)
+    (set! (SCM_VECTOR_ELEMENT vec (SCM_INT_VALUE ind)) v)
+    ($result SCM_UNDEFINED)))
+
+;; Compact forms of CONST for #t and characters; the value is encoded
+;; in the instruction word instead of taking an extra operand word.
+;; Scm_CompiledCodeEmit narrows CONST into them.  A character whose
+;; code doesn't fit in the parameter still uses CONST.
+(define-insn CONSTT      0 none #f ($result SCM_TRUE))                ; #t
+(define-insn CONSTC      1 none #f                                    ; char
+  ($result (SCM_MAKE_CHAR (SCM_VM_INSN_ARG code))))
+(define-insn CONSTT-PUSH 0 none  (CONSTT PUSH))
+(define-insn CONSTC-PUSH 1 none  (CONSTC PUSH))
+(define-insn CONSTT-RET  0 none  (CONSTT RET))
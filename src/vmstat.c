@@ -34,6 +34,8 @@
 /* This file is included from vm.c */
 
 #ifdef COUNT_INSN_FREQUENCY
+#include <fcntl.h>
+
 /* for statistics */
 static u_long insn1_freq[SCM_VM_NUM_INSNS];
 static u_long insn2_freq[SCM_VM_NUM_INSNS][SCM_VM_NUM_INSNS];
@@ -50,16 +52,16 @@ static ScmWord fetch_insn_counting(ScmVM *vm, ScmWord code)
     code = *vm->pc++;
     insn1_freq[SCM_VM_INSN_CODE(code)]++;
     switch (SCM_VM_INSN_CODE(code)) {
-    case SCM_VM_LREF0: lref_freq[0][0]++; break;
-    case SCM_VM_LREF1: lref_freq[0][1]++; break;
-    case SCM_VM_LREF2: lref_freq[0][2]++; break;
-    case SCM_VM_LREF3: lref_freq[0][3]++; break;
-    case SCM_VM_LREF4: lref_freq[0][4]++; break;
+    case SCM_VM_LREF0:  lref_freq[0][0]++; break;
+    case SCM_VM_LREF1:  lref_freq[0][1]++; break;
+    case SCM_VM_LREF2:  lref_freq[0][2]++; break;
+    case SCM_VM_LREF3:  lref_freq[0][3]++; break;
     case SCM_VM_LREF10: lref_freq[1][0]++; break;
     case SCM_VM_LREF11: lref_freq[1][1]++; break;
     case SCM_VM_LREF12: lref_freq[1][2]++; break;
-    case SCM_VM_LREF13: lref_freq[1][3]++; break;
-    case SCM_VM_LREF14: lref_freq[1][4]++; break;
+    case SCM_VM_LREF20: lref_freq[2][0]++; break;
+    case SCM_VM_LREF21: lref_freq[2][1]++; break;
+    case SCM_VM_LREF30: lref_freq[3][0]++; break;
     case SCM_VM_LREF:
     {
         int dep = SCM_VM_INSN_ARG0(code);
@@ -69,11 +71,6 @@ static ScmWord fetch_insn_counting(ScmVM *vm, ScmWord code)
         lref_freq[dep][off]++;
         break;
     }
-    case SCM_VM_LSET0: lset_freq[0][0]++; break;
-    case SCM_VM_LSET1: lset_freq[0][1]++; break;
-    case SCM_VM_LSET2: lset_freq[0][2]++; break;
-    case SCM_VM_LSET3: lset_freq[0][3]++; break;
-    case SCM_VM_LSET4: lset_freq[0][4]++; break;
     case SCM_VM_LSET:
     {
         int dep = SCM_VM_INSN_ARG0(code);
@@ -87,34 +84,50 @@ static ScmWord fetch_insn_counting(ScmVM *vm, ScmWord code)
     return code;
 }
 
+/* The dump is an S-expression that can be fed to geninsn with
+   --superinsn option to generate combined instructions for the
+   most frequent instruction pairs.  If the environment variable
+   GAUCHE_INSN_FREQUENCY_FILE is set, the dump is written to the
+   named file; otherwise it goes to the current output port. */
 static void dump_insn_frequency(void *data)
 {
-    Scm_Printf(SCM_CUROUT, "(:instruction-frequencies (");
+    ScmObj out = SCM_OBJ(SCM_CUROUT);
+    const char *file = Scm_GetEnv("GAUCHE_INSN_FREQUENCY_FILE");
+    if (file != NULL) {
+        out = Scm_OpenFilePort(file, O_WRONLY|O_CREAT|O_TRUNC,
+                               SCM_PORT_BUFFER_FULL, 0666);
+        if (SCM_FALSEP(out)) return;
+    }
+    ScmPort *p = SCM_PORT(out);
+
+    Scm_Printf(p, "(:instruction-frequencies (");
     for (int i=0; i<SCM_VM_NUM_INSNS; i++) {
-        Scm_Printf(SCM_CUROUT, "(%s %d", Scm_VMInsnName(i), insn1_freq[i]);
+        Scm_Printf(p, "(%s %lu", Scm_VMInsnName(i), insn1_freq[i]);
         for (int j=0; j<SCM_VM_NUM_INSNS; j++) {
-            Scm_Printf(SCM_CUROUT, " %d", insn2_freq[i][j]);
+            Scm_Printf(p, " %lu", insn2_freq[i][j]);
         }
-        Scm_Printf(SCM_CUROUT, ")\n");
+        Scm_Printf(p, ")\n");
     }
-    Scm_Printf(SCM_CUROUT, ")\n :lref-frequencies (");
+    Scm_Printf(p, ")\n :lref-frequencies (");
     for (int i=0; i<LREF_FREQ_COUNT_MAX; i++) {
-        Scm_Printf(SCM_CUROUT, "(");
+        Scm_Printf(p, "(");
         for (int j=0; j<LREF_FREQ_COUNT_MAX; j++) {
-            Scm_Printf(SCM_CUROUT, "%d ", lref_freq[i][j]);
+            Scm_Printf(p, "%lu ", lref_freq[i][j]);
         }
-        Scm_Printf(SCM_CUROUT, ")\n");
+        Scm_Printf(p, ")\n");
     }
-    Scm_Printf(SCM_CUROUT, ")\n :lset-frequencies (");
+    Scm_Printf(p, ")\n :lset-frequencies (");
     for (int i=0; i<LREF_FREQ_COUNT_MAX; i++) {
-        Scm_Printf(SCM_CUROUT, "(");
+        Scm_Printf(p, "(");
         for (int j=0; j<LREF_FREQ_COUNT_MAX; j++) {
-            Scm_Printf(SCM_CUROUT, "%d ", lset_freq[i][j]);
+            Scm_Printf(p, "%lu ", lset_freq[i][j]);
         }
-        Scm_Printf(SCM_CUROUT, ")\n");
+        Scm_Printf(p, ")\n");
     }
-    Scm_Printf(SCM_CUROUT, ")\n");
-    Scm_Printf(SCM_CUROUT, ")\n");
+    Scm_Printf(p, ")\n");
+    Scm_Printf(p, ")\n");
+    if (file != NULL) Scm_ClosePort(p);
+    else Scm_Flush(p);
 }
 
 #endif /*COUNT_INSN_FREQUENCY*/
@@ -212,12 +212,51 @@ void *Scm_WeakBoxRef(ScmWeakBox *wbox)
  * If a key is GC-ed, the entry becomes inaccessible---from outside it
  * looks as if the entry is deleted.  We don't immediately delete the entry
  * at the time we found its key has been GC-ed, since the caller may not
- * expect the table is modified.  Instead we flag the table and delete
- * those entries when the table is modified.
+ * expect the table is modified.  Instead, a modifying operation sweeps the
+ * table for such entries once a GC has run since the last sweep and enough
+ * entries have been added (or found gone) to pay for it.
+ *
+ * A weak key is kept in the entry itself, hidden from GC by
+ * GC_HIDE_POINTER, and the entry's key field is registered as a
+ * disappearing link.  GC clears the field to 0 when the key is
+ * collected.  So we don't allocate a box per key, and looking up
+ * doesn't go through an indirection.  Keys that GC never collects
+ * (immediates and statically allocated objects) are kept as they are.
+ * Flonums are also kept as they are, since a hidden flonum pointer
+ * couldn't be told from a fixnum; they're held strongly.
+ *
+ * NB: Boehm GC doesn't provide ephemerons, so a value that refers to
+ * its own key keeps the entry alive.
  */
 
 #define MARK_GONE_ENTRY(ht, e)  (ht->goneEntries++)
 
+/* A hidden pointer of an 8-byte aligned object has 1s in its lower
+   3 bits, which no raw ScmObj has. */
+#define WEAK_KEY_HIDDENP(k)     ((((intptr_t)(k))&0x07) == 0x07)
+
+/* Returns the real key, or NULL if it has been GC-ed. */
+static inline ScmObj weak_key_ref(intptr_t k)
+{
+    if (k == 0) return NULL;
+    if (WEAK_KEY_HIDDENP(k)) return SCM_OBJ(GC_REVEAL_POINTER(k));
+    return SCM_OBJ(k);
+}
+
+/* The key of ScmDictEntry is const for the users of a hash core, but
+   the weak table owns its core and rewrites the key in place. */
+#define WEAK_KEY_LOC(e)         ((intptr_t*)&(e)->key)
+
+/* Called on a newly created entry, whose key is still a raw ScmObj. */
+static void weak_key_hide(ScmDictEntry *e)
+{
+    ScmObj key = SCM_OBJ(e->key);
+    if (!SCM_HPTRP(key) || (SCM_WORD(key) & 0x07) != 0) return;
+    void *base = GC_base((void*)key);
+    if (base == NULL) return;
+    *WEAK_KEY_LOC(e) = (intptr_t)GC_HIDE_POINTER(key);
+    GC_general_register_disappearing_link((void **)WEAK_KEY_LOC(e), base);
+}
 
 static void weakhash_print(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
 {
@@ -240,45 +279,58 @@ SCM_DEFINE_BUILTIN_CLASS(Scm_WeakHashTableClass, weakhash_print,
                          NULL, NULL, NULL,
                          SCM_CLASS_DICTIONARY_CPL);
 
-/* Custom hasher & comparer for key-weak table, in which we insert
-   one indirection to the real key via WeakBox. */
+/* Custom hasher & comparer for key-weak table.  The key given to the
+   search is always a real key; only the entry keys are hidden. */
 static u_long weak_key_hash(const ScmHashCore *hc, intptr_t key)
 {
     ScmWeakHashTable *wh = SCM_WEAK_HASH_TABLE(hc->data);
-    ScmWeakBox *box = (ScmWeakBox *)key;
-    intptr_t realkey = (intptr_t)Scm_WeakBoxRef(box);
-    if (Scm_WeakBoxEmptyP(box)) {
-        /* There IS a small possibility that the real key has already been
-           GCed.  We return an arbitrary value (0 here); the entry won't
-           match anyway. */
-        return 0;
-    } else {
-        u_long k= wh->hashfn(hc, realkey);
-        return k;
+    if (wh->type == SCM_HASH_STRING && !SCM_STRINGP(key)) {
+        Scm_Error("Got non-string key %S to the string hashtable.",
+                  SCM_OBJ(key));
     }
+    return wh->hashfn(hc, key);
 }
 
-
 static int weak_key_compare(const ScmHashCore *hc, intptr_t key,
                             intptr_t entrykey)
 {
     ScmWeakHashTable *wh = SCM_WEAK_HASH_TABLE(hc->data);
-    ScmWeakBox *box = (ScmWeakBox *)entrykey;
-    intptr_t realkey = (intptr_t)Scm_WeakBoxRef(box);
-    if (Scm_WeakBoxEmptyP(box)) {
-        return FALSE;
-    } else {
-        return wh->cmpfn(hc, key, realkey);
-    }
+    ScmObj realkey = weak_key_ref(entrykey);
+    if (realkey == NULL) return FALSE;
+    return wh->cmpfn(hc, key, (intptr_t)realkey);
+}
+
+static int weak_key_gone_p(const ScmDictEntry *e, void *data)
+{
+    return e->key == 0;
 }
 
-/* Scan through  */
-#if 0
-static void weak_hash_cleanup(ScmWeakHashTable *wh)
+/* Removes the entries whose keys have been GC-ed.  Returns the number
+   of removed entries. */
+int Scm_WeakHashTableSweep(ScmWeakHashTable *wh)
 {
+    int n = 0;
+    if (wh->weakness & SCM_WEAK_KEY) {
+        n = Scm_HashCoreSweep(&wh->core, weak_key_gone_p, NULL);
+    }
+    wh->goneEntries = 0;
+    wh->insertions = 0;
+    wh->gcNo = GC_get_gc_no();
+    return n;
 }
-#endif
 
+/* Sweeping costs a scan of the whole table, so we do it only if some
+   keys may have gone since the last sweep, and the insertions or the
+   gone entries we've seen amortize the scan. */
+static void weak_hash_maybe_sweep(ScmWeakHashTable *wh)
+{
+    if (!(wh->weakness & SCM_WEAK_KEY)) return;
+    if (wh->gcNo == GC_get_gc_no()) return;
+    if (wh->goneEntries > 0
+        || wh->insertions > (u_int)Scm_HashCoreNumEntries(&wh->core)/2) {
+        Scm_WeakHashTableSweep(wh);
+    }
+}
 
 ScmObj Scm_MakeWeakHashTableSimple(ScmHashType type,
                                    ScmWeakness weakness,
@@ -291,6 +343,8 @@ ScmObj Scm_MakeWeakHashTableSimple(ScmHashType type,
     wh->type = type;
     wh->defaultValue = defaultValue;
     wh->goneEntries = 0;
+    wh->insertions = 0;
+    wh->gcNo = GC_get_gc_no();
 
     if (weakness & SCM_WEAK_KEY) {
         if (!Scm_HashCoreTypeToProcs(type, &wh->hashfn, &wh->cmpfn)) {
@@ -315,7 +369,30 @@ ScmObj Scm_WeakHashTableCopy(ScmWeakHashTable *src)
     wh->hashfn = src->hashfn;
     wh->cmpfn = src->cmpfn;
     wh->goneEntries = 0;
-    Scm_HashCoreCopy(&wh->core, &src->core);
+    wh->insertions = 0;
+    wh->gcNo = GC_get_gc_no();
+    if (!(src->weakness & SCM_WEAK_KEY)) {
+        Scm_HashCoreCopy(&wh->core, &src->core);
+        wh->core.data = wh;
+        return SCM_OBJ(wh);
+    }
+
+    /* Each entry needs its own disappearing link, so we rebuild the
+       table.  We hold the real key in a variable while inserting it,
+       so that it won't be GC-ed in the middle. */
+    Scm_HashCoreInitGeneral(&wh->core, weak_key_hash, weak_key_compare,
+                            Scm_HashCoreNumEntries(&src->core), wh);
+    ScmHashIter iter;
+    ScmDictEntry *e;
+    Scm_HashIterInit(&iter, &src->core);
+    while ((e = Scm_HashIterNext(&iter)) != NULL) {
+        ScmObj realkey = weak_key_ref(e->key);
+        if (realkey == NULL) continue;
+        ScmDictEntry *d = Scm_HashCoreSearch(&wh->core, (intptr_t)realkey,
+                                             SCM_DICT_CREATE);
+        weak_key_hide(d);
+        d->value = e->value;
+    }
     return SCM_OBJ(wh);
 }
 
@@ -337,18 +414,17 @@ ScmObj Scm_WeakHashTableRef(ScmWeakHashTable *ht, ScmObj key, ScmObj fallback)
 ScmObj Scm_WeakHashTableSet(ScmWeakHashTable *ht, ScmObj key, ScmObj value,
                             int flags)
 {
-    intptr_t proxy;
-
-    if (ht->weakness&SCM_WEAK_KEY) {
-        proxy = (intptr_t)Scm_MakeWeakBox(key);
-    } else {
-        proxy = (intptr_t)key;
-    }
+    if (!(flags&SCM_DICT_NO_CREATE)) weak_hash_maybe_sweep(ht);
 
     ScmDictEntry *e = Scm_HashCoreSearch(
-        SCM_WEAK_HASH_TABLE_CORE(ht), proxy,
+        SCM_WEAK_HASH_TABLE_CORE(ht), (intptr_t)key,
         (flags&SCM_DICT_NO_CREATE)?SCM_DICT_GET:SCM_DICT_CREATE);
     if (!e) return SCM_UNBOUND;
+    if (e->value == 0 && (ht->weakness&SCM_WEAK_KEY)) {
+        /* new entry */
+        weak_key_hide(e);
+        ht->insertions++;
+    }
     if (ht->weakness&SCM_WEAK_VALUE) {
         if (flags&SCM_DICT_NO_OVERWRITE) {
             if (e->value) {
@@ -372,6 +448,9 @@ ScmObj Scm_WeakHashTableDelete(ScmWeakHashTable *ht, ScmObj key)
 {
     ScmDictEntry *e = Scm_HashCoreSearch(SCM_WEAK_HASH_TABLE_CORE(ht),
                                          (intptr_t)key, SCM_DICT_DELETE);
+    if (e && WEAK_KEY_HIDDENP(e->key)) {
+        GC_unregister_disappearing_link((void **)WEAK_KEY_LOC(e));
+    }
     if (e && e->value) {
         if (ht->weakness&SCM_WEAK_VALUE) {
             void *val = Scm_WeakBoxRef((ScmWeakBox*)e->value);
@@ -399,9 +478,8 @@ int Scm_WeakHashIterNext(ScmWeakHashIter *iter, ScmObj *key, ScmObj *value)
         ScmDictEntry *e = Scm_HashIterNext(&iter->iter);
         if (e == NULL) return FALSE;
         if (iter->table->weakness & SCM_WEAK_KEY) {
-            ScmWeakBox *box = (ScmWeakBox*)e->key;
-            ScmObj realkey = SCM_OBJ(Scm_WeakBoxRef(box));
-            if (Scm_WeakBoxEmptyP(box)) {
+            ScmObj realkey = weak_key_ref(e->key);
+            if (realkey == NULL) {
                 MARK_GONE_ENTRY(iter->table, e);
                 continue;
             }
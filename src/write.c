@@ -592,7 +592,7 @@ static void write_rec(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
             }
             goto next;
         }
-        if ((SCM_STRINGP(obj) && SCM_STRING_SIZE(obj) == 0)
+        if ((SCM_STRINGP(obj) && SCM_STRING_NULL_P(obj))
             || (SCM_VECTORP(obj) && SCM_VECTOR_SIZE(obj) == 0)) {
             /* we don't put a reference tag for these */
             write_general(obj, port, ctx);
@@ -762,6 +762,56 @@ static void write_rec(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
 #undef CHECK_DEPTH
 }
 
+/* Fast path check for circular-only write.
+   In SCM_WRITE_WRITE mode the walk pass is only to find cycles.  If OBJ
+   is a tree of pairs and vectors whose leaves are printed without
+   recursing into the writer, and we can traverse all of it within
+   WALK_BUDGET nodes, it can't contain a cycle and we can skip the walk
+   pass, which involves Scheme calls and a hash table.  A circular
+   structure (as well as a huge one) merely exhausts the budget, and
+   we fall back to the walk.  Acyclic substructure shared within OBJ is
+   traversed more than once, which is also bounded by the budget.
+   Car-side recursion is limited by WALK_DEPTH_LIMIT to save C stack. */
+#define WALK_BUDGET       100000
+#define WALK_DEPTH_LIMIT  1000
+
+static int simple_tree_rec(ScmObj obj, long *budget, int depth)
+{
+    for (;;) {
+        if (--*budget < 0) return FALSE;
+        if (!SCM_PTRP(obj) || SCM_NUMBERP(obj) || SCM_STRINGP(obj)
+            || SCM_SYMBOLP(obj) || SCM_KEYWORDP(obj)) {
+            return TRUE;
+        }
+        if (SCM_PAIRP(obj)) {
+            if (depth >= WALK_DEPTH_LIMIT) return FALSE;
+            if (!simple_tree_rec(SCM_CAR(obj), budget, depth+1)) return FALSE;
+            obj = SCM_CDR(obj);
+            continue;
+        }
+        if (SCM_VECTORP(obj)) {
+            ScmSmallInt n = SCM_VECTOR_SIZE(obj);
+            if (n == 0) return TRUE;
+            if (depth >= WALK_DEPTH_LIMIT) return FALSE;
+            for (ScmSmallInt i=0; i<n-1; i++) {
+                if (!simple_tree_rec(SCM_VECTOR_ELEMENT(obj, i),
+                                     budget, depth+1)) {
+                    return FALSE;
+                }
+            }
+            obj = SCM_VECTOR_ELEMENT(obj, n-1);
+            continue;
+        }
+        return (Scm_UVectorType(SCM_CLASS_OF(obj)) != SCM_UVECTOR_INVALID);
+    }
+}
+
+static int simple_tree_p(ScmObj obj)
+{
+    long budget = WALK_BUDGET;
+    return simple_tree_rec(obj, &budget, 0);
+}
+
 /* Write/ss main driver
    This should never be called recursively.
    We modify port->flags and port->writeState; they are cleaned up
@@ -770,6 +820,16 @@ static void write_ss(ScmObj obj, ScmPort *port, ScmWriteContext *ctx)
 {
     SCM_ASSERT(port->writeState == NULL);
 
+    if (SCM_WRITE_MODE(ctx) == SCM_WRITE_WRITE && simple_tree_p(obj)) {
+        /* No cycles.  We still need write state for print-level. */
+        ScmWriteState *s = Scm_MakeWriteState(NULL);
+        s->controls = ctx->controls;
+        port->writeState = s;
+        write_rec(obj, port, ctx);
+        cleanup_port_write_state(port);
+        return;
+    }
+
     /* pass 1 */
     port->flags |= SCM_PORT_WALKING;
     if (SCM_WRITE_MODE(ctx)==SCM_WRITE_SHARED) port->flags |= SCM_PORT_WRITESS;
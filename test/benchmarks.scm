@@ -0,0 +1,220 @@
+;;
+;; Standard benchmark suite.  Run by 'make bench'.
+;;
+;;   gosh -ftest benchmarks.scm [--cpu=SECS] [--only=REGEXP]
+;;                              [--save=FILE] [--baseline=FILE]
+;;                              [--tolerance=RATIO]
+;;
+;; With --save, the results are written to FILE in the format of
+;; write-benchmark-results.  With --baseline, the results are compared
+;; to the ones saved in FILE, and the script exits with status 1 if
+;; any of the benchmarks regressed more than the tolerance (default 0.1).
+;;
+
+(use gauche.time)
+(use gauche.parseopt)
+(use gauche.threads)
+(use rfc.json)
+(use text.tree)
+(use srfi-1)
+(use srfi-13)
+
+;;-------------------------------------------------------------------
+;; Gabriel benchmarks (reduced in size; see also r7rs-benchmarks)
+;;
+
+(define (fib n)
+  (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2)))))
+
+(define (tak x y z)
+  (if (not (< y x))
+    z
+    (tak (tak (- x 1) y z) (tak (- y 1) z x) (tak (- z 1) x y))))
+
+(define (ctak x y z)
+  (call/cc (^k (ctak-aux k x y z))))
+(define (ctak-aux k x y z)
+  (if (not (< y x))
+    (k z)
+    (ctak-aux k
+              (call/cc (^k (ctak-aux k (- x 1) y z)))
+              (call/cc (^k (ctak-aux k (- y 1) z x)))
+              (call/cc (^k (ctak-aux k (- z 1) x y))))))
+
+(define (takl x y z)
+  (define (shorter? x y)
+    (and (pair? y) (or (null? x) (shorter? (cdr x) (cdr y)))))
+  (let loop ([x x] [y y] [z z])
+    (if (not (shorter? y x))
+      z
+      (loop (loop (cdr x) y z) (loop (cdr y) z x) (loop (cdr z) x y)))))
+(define takl-18 (iota 18 18 -1))
+(define takl-12 (iota 12 12 -1))
+(define takl-6  (iota 6 6 -1))
+
+(define (nqueens n)
+  (define (ok? row dist placed)
+    (or (null? placed)
+        (and (not (= (car placed) (+ row dist)))
+             (not (= (car placed) (- row dist)))
+             (ok? row (+ dist 1) (cdr placed)))))
+  (define (try x y z)
+    (if (null? x)
+      (if (null? y) 1 0)
+      (+ (if (ok? (car x) 1 z)
+           (try (append (cdr x) y) '() (cons (car x) z))
+           0)
+         (try (cdr x) (cons (car x) y) z))))
+  (try (iota n 1) '() '()))
+
+(define (deriv a)
+  (cond [(not (pair? a)) (if (eq? a 'x) 1 0)]
+        [(eq? (car a) '+) (cons '+ (map deriv (cdr a)))]
+        [(eq? (car a) '-) (cons '- (map deriv (cdr a)))]
+        [(eq? (car a) '*)
+         (list '* a (cons '+ (map (^a (list '/ (deriv a) a)) (cdr a))))]
+        [(eq? (car a) '/)
+         (list '- (list '/ (deriv (cadr a)) (caddr a))
+               (list '/ (cadr a)
+                     (list '* (caddr a) (caddr a) (deriv (caddr a)))))]
+        [else (error "deriv: no derivation method available:" (car a))]))
+(define deriv-expr '(+ (* 3 x x) (* a x x) (* b x) 5))
+
+;;-------------------------------------------------------------------
+;; Library benchmarks
+;;
+
+(define text-lines
+  (list-tabulate 1000
+                 (^i (format "~4d: The quick brown fox jumps over ~a lazy dogs."
+                             i (* i 7)))))
+(define text (string-join text-lines "\n" 'suffix))
+
+(define (port-write)
+  (call-with-output-string
+    (^p (dolist [l text-lines] (display l p) (newline p)))))
+
+(define (port-read-line)
+  (call-with-input-string text
+    (^p (let loop ([n 0])
+          (if (eof-object? (read-line p)) n (loop (+ n 1)))))))
+
+(define (port-read-char)
+  (call-with-input-string text
+    (^p (let loop ([n 0])
+          (if (eof-object? (read-char p)) n (loop (+ n 1)))))))
+
+(define (port-write-tree)
+  (call-with-output-string
+    (^p (write-tree (map (^l (list "<li>" l "</li>\n")) text-lines) p))))
+
+(define (regexp-match)
+  (count (cut #/jumps over (\d+)/ <>) text-lines))
+
+(define (regexp-replace)
+  (regexp-replace-all #/[aeiou]/ text "_"))
+
+(define hash-keys (list-tabulate 10000 (^i (* i 7919))))
+(define hash-string-keys (map number->string hash-keys))
+
+(define (hash-table-eqv)
+  (let1 ht (make-hash-table 'eqv?)
+    (dolist [k hash-keys] (hash-table-put! ht k k))
+    (fold (^[k s] (+ s (hash-table-get ht k 0))) 0 hash-keys)))
+
+(define (hash-table-string)
+  (let1 ht (make-hash-table 'string=?)
+    (dolist [k hash-string-keys] (hash-table-put! ht k k))
+    (count (cut hash-table-get ht <> #f) hash-string-keys)))
+
+(define (string-append-many)
+  (string-length (apply string-append text-lines)))
+
+(define (string-split-join)
+  (string-join (append-map (cut string-split <> #\space) text-lines) " "))
+
+(define (string-search)
+  (count (cut string-contains <> "lazy") text-lines))
+
+(define json-data
+  (list->vector
+   (list-tabulate 200
+                  (^i `(("id" . ,i) ("name" . ,(format "item~d" i))
+                        ("price" . ,(* i 1.25)) ("tags" . #("a" "b" "c"))
+                        ("active" . ,(even? i)))))))
+(define json-text (construct-json-string json-data))
+
+(define (json-construct) (construct-json-string json-data))
+(define (json-parse) (parse-json-string json-text))
+
+(define (threads-spawn)
+  (for-each thread-join!
+            (list-tabulate 10 (^_ (thread-start! (make-thread (^[] #t)))))))
+
+(define (threads-mutex)
+  (let ([m (make-mutex)]
+        [n 0])
+    (for-each thread-join!
+              (list-tabulate 4
+                             (^_ (thread-start!
+                                  (make-thread
+                                   (^[] (dotimes [i 1000]
+                                          (with-locking-mutex m
+                                            (^[] (inc! n))))))))))
+    n))
+
+(define *benchmarks*
+  `((fib             . ,(^[] (fib 20)))
+    (tak             . ,(^[] (tak 18 12 6)))
+    (ctak            . ,(^[] (ctak 12 8 4)))
+    (takl            . ,(^[] (takl takl-18 takl-12 takl-6)))
+    (nqueens         . ,(^[] (nqueens 8)))
+    (deriv           . ,(^[] (dotimes [i 100] (deriv deriv-expr))))
+    (port-write      . ,port-write)
+    (port-read-line  . ,port-read-line)
+    (port-read-char  . ,port-read-char)
+    (port-write-tree . ,port-write-tree)
+    (regexp-match    . ,regexp-match)
+    (regexp-replace  . ,regexp-replace)
+    (hash-table-eqv  . ,hash-table-eqv)
+    (hash-table-string . ,hash-table-string)
+    (string-append   . ,string-append-many)
+    (string-split    . ,string-split-join)
+    (string-search   . ,string-search)
+    (json-construct  . ,json-construct)
+    (json-parse      . ,json-parse)
+    ,@(cond-expand
+       [gauche.sys.threads `((threads-spawn . ,threads-spawn)
+                             (threads-mutex . ,threads-mutex))]
+       [else '()])))
+
+;;-------------------------------------------------------------------
+;; Driver
+;;
+
+(define (main args)
+  (let-args (cdr args) ([cpu "cpu=f" 1.0]
+                        [only "only=s" #f]
+                        [save "save=s" #f]
+                        [baseline "baseline=s" #f]
+                        [tolerance "tolerance=f" 0.1])
+    (let* ([rx (and only (string->regexp only))]
+           [result (run-benchmark-suite
+                    `(cpu ,cpu) *benchmarks*
+                    :only (and rx (^k (rx (symbol->string k)))))])
+      (report-time-results result)
+      (when save
+        (call-with-output-file save (cut write-benchmark-results result <>)))
+      (if (and baseline (file-exists? baseline))
+        (let1 base (call-with-input-file baseline read-benchmark-results)
+          (format #t "\nCompared to ~a (tolerance ~a):\n" baseline tolerance)
+          (if (zero? (report-benchmark-comparison
+                      (compare-benchmark-results base result
+                                                 :tolerance tolerance)))
+            0
+            1))
+        (begin
+          (when baseline
+            (format #t "\nNo baseline ~a; run 'make bench-baseline' to create it.\n"
+                    baseline))
+          0)))))
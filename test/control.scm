@@ -6,6 +6,143 @@
 (use data.queue)
 
 (test-start "control")
+;;--------------------------------------------------------------------
+;; control.event-loop
+;;
+(test-section "control.event-loop")
+(use control.event-loop)
+(use gauche.uvector)
+(test-module 'control.event-loop)
+
+(cond-expand
+ [(and gauche.sys.select (not gauche.os.windows))
+  (test* "tasks waiting on a pipe" '(w0 r0 w1 (r1 #u8(1 2 3)) (r2 #u8(4)))
+         (receive (in out) (sys-pipe :buffering :none)
+           (let ([loop (make-event-loop)]
+                 [log '()])
+             (event-loop-spawn! loop
+                                (^[] (push! log 'r0)
+                                     (let1 v (async-read-uvector <u8vector> 10 in)
+                                       (push! log (list 'r1 v)))
+                                     (let1 v (async-read-uvector <u8vector> 10 in)
+                                       (push! log (list 'r2 v)))))
+             (event-loop-spawn! loop
+                                (^[] (push! log 'w0)
+                                     (event-loop-yield!)
+                                     (push! log 'w1)
+                                     (async-write-uvector '#u8(1 2 3) out)
+                                     (wait-readable in)
+                                     (event-loop-yield!)
+                                     (async-write-uvector '#u8(4) out)))
+             (event-loop-run! loop)
+             (close-port in) (close-port out)
+             (reverse log))))
+
+  (test* "wait-readable outside of tasks" '#u8(5)
+         (receive (in out) (sys-pipe :buffering :none)
+           (write-u8 5 out)
+           (wait-readable in)
+           (read-uvector <u8vector> 1 in)))]
+ [else])
+
+
+;;--------------------------------------------------------------------
+;; control.fiber
+;;
+
+(cond-expand
+ [(and gauche.sys.threads gauche.sys.select (not gauche.os.windows))
+  (test-section "control.fiber")
+  (use control.fiber)
+  (test-module 'control.fiber)
+
+  (let1 sched (make-fiber-scheduler 1)
+    (test* "spawn and join" '(3 4)
+           (let1 f (fiber-spawn! sched (^[] (values 3 4)))
+             (receive r (fiber-join! f) r)))
+
+    ;; Spawn from a fiber, so that both are queued before either runs.
+    (test* "yield" '(a0 b0 a1 b1 a2 b2)
+           (fiber-join!
+            (fiber-spawn! sched
+                          (^[] (let* ([log '()]
+                                      [body (^[tag]
+                                              (^[] (dotimes [i 3]
+                                                     (push! log (symbol-append tag i))
+                                                     (fiber-yield!))))]
+                                      [fa (fiber-spawn! sched (body 'a))]
+                                      [fb (fiber-spawn! sched (body 'b))])
+                                 (fiber-join! fa) (fiber-join! fb)
+                                 (reverse log))))))
+
+    (test* "sleep" '(b c a)
+           (let* ([log '()]
+                  [fs (map (^[tag secs]
+                             (fiber-spawn! sched (^[] (fiber-sleep! secs)
+                                                      (push! log tag))))
+                           '(a b c) '(0.06 0.02 0.04))])
+             (for-each fiber-join! fs)
+             (reverse log)))
+
+    (test* "join from a fiber" 55
+           (fiber-join!
+            (fiber-spawn! sched
+                          (^[] (define (fib n)
+                                 (if (< n 2)
+                                   n
+                                   (+ (fiber-join! (fiber-spawn! sched (cut fib (- n 1))))
+                                      (fib (- n 2)))))
+                               (fib 10)))))
+
+    (test* "error propagates to join" 'oops
+           (guard (e [(symbol? e) e])
+             (fiber-join! (fiber-spawn! sched (^[] (fiber-yield!) (raise 'oops))))))
+
+    (test* "current-fiber" '(#t #t #f)
+           (let1 f (fiber-spawn! sched (^[] (list (fiber? (current-fiber))
+                                                 (eq? (current-fiber-scheduler)
+                                                      sched))))
+             (append (fiber-join! f) (list (current-fiber)))))
+
+    (test* "waiting on a pipe" '(#u8(1 2 3) #u8(4))
+           (receive (in out) (sys-pipe :buffering :none)
+             (let* ([r (fiber-spawn! sched
+                                     (^[] (let* ([a (fiber-read-uvector <u8vector> 10 in)]
+                                                 [b (fiber-read-uvector <u8vector> 10 in)])
+                                            (list a b))))]
+                    [w (fiber-spawn! sched
+                                     (^[] (fiber-write-uvector '#u8(1 2 3) out)
+                                          (fiber-sleep! 0.02)
+                                          (fiber-write-uvector '#u8(4) out)))])
+               (fiber-join! w)
+               (begin0 (fiber-join! r)
+                 (close-port in) (close-port out)))))
+
+    (fiber-scheduler-shutdown! sched)
+    (test* "spawn after shutdown" (test-error)
+           (fiber-spawn! sched (^[] #t))))
+
+  (let ([sched (make-fiber-scheduler 4)]
+        [m (make-fiber-mutex)]
+        [count 0])
+    (test* "fiber mutex over threads" 4000
+           (let1 fs (list-tabulate
+                     400
+                     (^_ (fiber-spawn! sched
+                                       (^[] (dotimes [i 10]
+                                              (with-fiber-mutex m
+                                                (^[] (let1 c count
+                                                       (fiber-yield!)
+                                                       (set! count (+ c 1))))))))))
+             (for-each fiber-join! fs)
+             count))
+    (test* "fiber mutex from a thread" 4001
+           (begin (with-fiber-mutex m (^[] (inc! count)))
+                  count))
+    (test* "unlocking by non-owner" (test-error)
+           (fiber-mutex-unlock! m))
+    (fiber-scheduler-shutdown! sched))]
+ [else])
 
 ;;--------------------------------------------------------------------
 ;; control.job
@@ -75,6 +212,7 @@
  [gauche.sys.threads
   (test-section "control.thread-pool")
   (use control.thread-pool)
+  (use gauche.threads)
   (test-module 'control.thread-pool)
 
   (let ([pool (make-thread-pool 5)]
@@ -190,9 +328,199 @@
            (terminate-all! pool)
            (thread-terminate! t)
            (thread-state t)))
+
+  ;; work-stealing pool
+  (let ([pool (make-thread-pool 4 :work-stealing #t)]
+        [rvec (make-vector 10 #f)])
+    (test* "work-stealing pool" '(4 #t)
+           (list (length (~ pool'pool))
+                 (every thread? (~ pool'pool))))
+
+    (test* "work-stealing doit" '#(0 1 2 3 4 5 6 7 8 9)
+           (begin (dotimes [k 10]
+                    (add-job! pool (^[]
+                                     (sys-nanosleep 1e7)
+                                     (vector-set! rvec k k))))
+                  (and (wait-all pool #f 1e7) rvec)))
+
+    (test* "work-stealing error results" '(ng ng ng)
+           (begin (dotimes [k 3]
+                    (add-job! pool (^[] (raise 'ng)) #t))
+                  (and (wait-all pool #f 1e7)
+                       (map (cut job-result <>)
+                            (dequeue-all! (~ pool'result-queue))))))
+
+    (test* "fork/join" 6765
+           (letrec ([fib (^n (if (< n 2)
+                               n
+                               (let* ([j (thread-pool-fork!
+                                          pool (^[] (fib (- n 1))))]
+                                      [b (fib (- n 2))])
+                                 (+ (thread-pool-join! pool j) b))))])
+             (thread-pool-join! pool (thread-pool-fork! pool (^[] (fib 20))))))
+
+    (test* "fork/join (error)" 'oops
+           (guard (e [(symbol? e) e])
+             (thread-pool-join!
+              pool
+              (thread-pool-fork!
+               pool
+               (^[] (thread-pool-join! pool
+                                       (thread-pool-fork!
+                                        pool (^[] (raise 'oops)))))))))
+
+    (test* "add-job! from a job" 55
+           (let ([sum (atom 0)])
+             (add-job! pool
+                       (^[] (dotimes [k 10]
+                              (add-job! pool
+                                        (^[] (atomic-update!
+                                              sum (cut + <> (+ k 1))))))))
+             (wait-all pool #f 1e7)
+             (atom-ref sum)))
+
+    (test* "work-stealing shutdown" (test-error <thread-pool-shut-down>)
+           (begin (terminate-all! pool)
+                  (add-job! pool (^[] #t))))
+    (test* "work-stealing shutdown (fork)" (test-error <thread-pool-shut-down>)
+           (thread-pool-fork! pool (^[] #t)))
+    (test* "work-stealing threads terminated" #t
+           (every (^t (eq? (thread-state t) 'terminated)) (~ pool'pool)))
+    )
+
+  (test* "fork on a non work-stealing pool" (test-error)
+         (let1 pool (make-thread-pool 1)
+           (unwind-protect (thread-pool-fork! pool (^[] #t))
+             (terminate-all! pool))))
+  (test* "work-stealing with max-backlog" (test-error)
+         (make-thread-pool 1 :work-stealing #t :max-backlog 3))
+
+  ;; Affinity may not be supported on the platform, in which case
+  ;; thread-affinity returns #f.
+  (let* ([cpus (thread-affinity (current-thread))]
+         [cpu0 (if cpus (car cpus) 0)]
+         [pool (make-thread-pool 2 :pin-workers (list cpu0))])
+    (test* "pinned workers" #t
+           (let1 j (add-job! pool (^[] (thread-affinity (current-thread))))
+             (wait-all pool)
+             (let1 r (job-result j)
+               (or (not r) (equal? r (list cpu0))))))
+    (terminate-all! pool))
+  (test* "pin-workers bad spec" (test-error)
+         (make-thread-pool 1 :pin-workers 'all))
   ] ; gauche.sys.pthreads
  [else])
 
-(test-end)
+;;--------------------------------------------------------------------
+;; control.future and control.parallel
+;;
+
+(cond-expand
+ [gauche.sys.threads
+  (test-section "control.future")
+  (use control.future)
+  (use gauche.uvector)
+  (test-module 'control.future)
 
+  (let1 pool (make-thread-pool 3 :work-stealing #t)
+    (parameterize ([current-future-pool pool])
+      (test* "future and touch" '(3 #t #t)
+             (let1 f (future (+ 1 2))
+               (list (touch f) (future? f) (future-done? f))))
+      (test* "touch non-future" 5 (touch 5))
+      (test* "nested futures" 6765
+             (letrec ([fib (^n (if (< n 2)
+                                 n
+                                 (let1 f (future (fib (- n 1)))
+                                   (+ (fib (- n 2)) (touch f)))))])
+               (touch (future (fib 20)))))
+      (test* "error in future" 'oops
+             (guard (e [(symbol? e) e])
+               (touch (future (raise 'oops)))))
 
+      (test-section "control.parallel")
+      (use control.parallel)
+      (use file.util)
+      (test-module 'control.parallel)
+
+      (test* "parallel-map (list)" (map (cut * <> <>) (iota 1000))
+             (parallel-map (cut * <> <>) (iota 1000)))
+      (test* "parallel-map (vector)" (vector-map - (list->vector (iota 100)))
+             (parallel-map - (list->vector (iota 100)) :chunk-size 7))
+      (test* "parallel-map (uvector)" #(2 4 6)
+             (parallel-map (cut * 2 <>) #u8(1 2 3) :chunk-size 1))
+      (test* "parallel-map (empty)" '() (parallel-map - '()))
+      (test* "parallel-map (one chunk)" '(-1 -2)
+             (parallel-map - '(1 2) :chunk-size 10))
+      (test* "parallel-map (nested)" '((0) (0 1) (0 1 2))
+             (parallel-map (^n (parallel-map identity (iota n) :chunk-size 1))
+                           '(1 2 3) :chunk-size 1))
+      (test* "parallel-map (error)" 'bad
+             (guard (e [(symbol? e) e])
+               (parallel-map (^x (if (= x 500) (raise 'bad) x)) (iota 1000))))
+      (test* "parallel-for-each" 499500
+             (let1 a (atom 0)
+               (parallel-for-each (^x (atomic-update! a (cut + x <>)))
+                                  (list->vector (iota 1000)))
+               (atom-ref a)))
+      (test* "parallel-fold" 332833500
+             (parallel-fold (^[x acc] (+ acc (* x x))) + 0 (iota 1000)))
+      (test* "parallel-fold (order of combine)" (iota 100)
+             (parallel-fold cons (^[l r] (append r l)) '()
+                            (reverse (iota 100)) :chunk-size 9))
+      (test* "parallel-fold (f64vector)" 6.0
+             (parallel-fold + + 0.0 #f64(1.0 2.0 3.0) :chunk-size 1))
+      (test* "bad chunk-size" (test-error)
+             (parallel-map - '(1 2) :chunk-size 0))
+
+      (let* ([xs (map (^i (modulo (* i 7919) 1009)) (iota 1000))]
+             [sorted (sort xs)])
+        (test* "parallel-sort (list)" sorted
+               (parallel-sort xs :chunk-size 64))
+        (test* "parallel-sort (vector, cmp)" (list->vector (reverse sorted))
+               (parallel-sort (list->vector xs) > :chunk-size 100))
+        (test* "parallel-sort! (vector)" (list->vector sorted)
+               (parallel-sort! (list->vector xs) :chunk-size 33))
+        (test* "parallel-sort! (s32vector)" (list->s32vector sorted)
+               (parallel-sort! (list->s32vector xs) :chunk-size 50))
+        (test* "parallel-sort (f64vector)"
+               (list->f64vector (map inexact sorted))
+               (parallel-sort (list->f64vector (map inexact xs))
+                              :chunk-size 128))
+        (test* "parallel-sort (u16vector, cmp)"
+               (list->u16vector (reverse sorted))
+               (parallel-sort (list->u16vector xs) > :chunk-size 128))
+        (test* "parallel-sort (one chunk)" sorted (parallel-sort xs))
+        (test* "parallel-sort (stability)"
+               (stable-sort (map cons xs (iota 1000))
+                            (^[a b] (< (car a) (car b))))
+               (parallel-sort (map cons xs (iota 1000))
+                              (^[a b] (< (car a) (car b)))
+                              :chunk-size 70))
+        (test* "parallel-sort! (list)" (test-error)
+               (parallel-sort! xs))))
+
+      (let ()
+        (when (file-exists? "test.o")       ;just in case
+          (remove-directory* "test.o"))
+        (for-each (^d (make-directory* (build-path "test.o" d)))
+                  '("a/b" "a/c" "d" "e/f/g"))
+        (for-each (^[f i] (with-output-to-file (build-path "test.o" f)
+                            (cut display (make-string i #\x))))
+                  '("x" "a/y" "a/b/z" "a/c/w" "e/f/g/v" "e/u")
+                  '(1 2 3 4 5 6))
+        (test* "parallel-directory-fold" 21
+               (parallel-directory-fold "test.o"
+                                        (^[p acc] (+ (file-size p) acc))
+                                        + 0))
+        (test* "parallel-directory-fold (order)"
+               (reverse (directory-fold "test.o" cons '()))
+               (parallel-directory-fold "test.o" (^[p acc] (append acc (list p)))
+                                        append '()))
+        (test* "parallel-directory-fold (non-directory)" '("test.o/x")
+               (parallel-directory-fold "test.o/x" cons append '()))
+        (remove-directory* "test.o"))
+    (terminate-all! pool))]
+ [else])
+
+(test-end)
@@ -289,6 +289,118 @@
            (cache-through! c 'd symbol->string)  ; hit
            (cache-stats c))))
 
+;; native LRU cache
+(let* ([c (make-lru-cache 4 :native #t)])
+  (test* "native LRU empty" 'none (cache-lookup! c 'a 'none))
+  (test* "native LRU fill" '((a . 4) (b . 2) (c . 3) (d . 5))
+         (begin
+           (cache-write! c 'a 1)
+           (cache-write! c 'b 2)
+           (cache-write! c 'c 3)
+           (cache-write! c 'a 4)
+           (cache-write! c 'd 5)
+           (list (cache-check! c 'a)
+                 (cache-check! c 'b)
+                 (cache-check! c 'c)
+                 (cache-check! c 'd))))
+  (test* "native LRU spill" '((a . 4) #f #f (d . 5) (e . 8) (f . 9))
+         (begin
+           (cache-check! c 'a)
+           (cache-check! c 'd)
+           (cache-write! c 'e 8)
+           (cache-write! c 'f 9)
+           (list (cache-check! c 'a)
+                 (cache-check! c 'b)
+                 (cache-check! c 'c)
+                 (cache-check! c 'd)
+                 (cache-check! c 'e)
+                 (cache-check! c 'f))))
+  (test* "native LRU evict" '(#f (d . 5) 3)
+         (begin
+           (cache-evict! c 'a)
+           (list (cache-check! c 'a)
+                 (cache-check! c 'd)
+                 (size-of (cache-storage c)))))
+  (test* "native LRU storage" '(5 none #t)
+         (let1 s (cache-storage c)
+           (list (dict-get s 'd) (dict-get s 'a 'none) (dict-exists? s 'e))))
+  (test* "native LRU stats" '(:hits 11 :misses 4 :evictions 2 :rejections 0)
+         (cache-stats c))
+  (test* "native LRU clear" '(0 #f)
+         (begin
+           (cache-clear! c)
+           (list (size-of (cache-storage c)) (cache-check! c 'd)))))
+
+;; LFU cache
+(let* ([c (make-lfu-cache 3)])
+  (test* "LFU spill" '((a . 1) (b . 2) #f (d . 4))
+         (begin
+           (cache-write! c 'a 1)
+           (cache-write! c 'b 2)
+           (cache-write! c 'c 3)
+           (cache-check! c 'a)
+           (cache-check! c 'a)
+           (cache-check! c 'b)
+           (cache-write! c 'd 4)         ; spills c, the least used
+           (list (cache-check! c 'a)
+                 (cache-check! c 'b)
+                 (cache-check! c 'c)
+                 (cache-check! c 'd))))
+  (test* "LFU spill new entries" '((a . 1) (b . 2) #f #f (f . 6))
+         (begin
+           (cache-write! c 'e 5)         ; spills d
+           (cache-write! c 'f 6)         ; spills e
+           (list (cache-check! c 'a)
+                 (cache-check! c 'b)
+                 (cache-check! c 'd)
+                 (cache-check! c 'e)
+                 (cache-check! c 'f)))))
+
+(let* ([c (make-lfu-cache 2)])
+  (test* "LFU ties" '(#f (b . 2) (c . 3))
+         (begin
+           (cache-write! c 'a 1)
+           (cache-write! c 'b 2)
+           (cache-write! c 'c 3)         ; spills a, the older one
+           (list (cache-check! c 'a)
+                 (cache-check! c 'b)
+                 (cache-check! c 'c)))))
+
+;; TinyLFU cache
+(let* ([c (make-tinylfu-cache 2)])
+  (test* "TinyLFU rejection" '(#f (a . 1) (b . 2))
+         (begin
+           (cache-write! c 'a 1)
+           (cache-write! c 'b 2)
+           (dotimes [3] (cache-check! c 'a))
+           (dotimes [3] (cache-check! c 'b))
+           (cache-write! c 'c 3)         ; rarer than a, not admitted
+           (list (cache-check! c 'c)
+                 (cache-check! c 'a)
+                 (cache-check! c 'b))))
+  (test* "TinyLFU admission" '((c . 3) #f (b . 2))
+         (begin
+           (dotimes [5] (cache-check! c 'c))
+           (cache-write! c 'c 3)         ; now more frequent than a
+           (list (cache-check! c 'c)
+                 (cache-check! c 'a)
+                 (cache-check! c 'b))))
+  (test* "TinyLFU stats" '(:hits 10 :misses 7 :evictions 1 :rejections 1)
+         (cache-stats c)))
+
+;; sharded cache
+(let* ([c (make-lru-cache 100 :shards 4 :comparator string-comparator)]
+       [keys (map number->string (iota 40))])
+  (test* "sharded LRU" keys
+         (begin
+           (dolist [k keys] (cache-through! c k values))
+           (map (cut cache-lookup! c <>) keys)))
+  (test* "sharded LRU size" 40 (size-of (cache-storage c)))
+  (test* "sharded LRU non-string key" (test-error) (cache-check! c 'a)))
+
+(test* "native cache comparator" (test-error)
+       (make-lfu-cache 4 :comparator (make-comparator #t eq? #f #f)))
+
 ;;;========================================================================
 (test-section "data.ideque")
 (use data.ideque)
@@ -382,6 +494,47 @@
            (dict->alist (alist->imap data char-comparator))))
   )
 
+(let* ([z0 (alist->imap '((b . 2) (a . 1)))]
+       [z1 (imap-put z0 'c 3)]
+       [z2 (imap-delete z1 'a)])
+  (test* "imap persistence" '(((a . 1) (b . 2))
+                              ((a . 1) (b . 2) (c . 3))
+                              ((b . 2) (c . 3)))
+         (map (cut coerce-to <list> <>) (list z0 z1 z2)))
+  (test* "imap-delete nonexistent key" #t (eq? z2 (imap-delete z2 'x)))
+  (test* "imap size-of" '(2 3 2) (map size-of (list z0 z1 z2))))
+
+(let ()
+  (define (check alist cmpr)
+    (coerce-to <list> (alist->imap alist cmpr)))
+  (test* "alist->imap (ascending, duplicates)" '((1 . a) (2 . c) (3 . d))
+         (check '((1 . a) (2 . b) (2 . c) (3 . d)) default-comparator))
+  (test* "alist->imap (descending, duplicates)" '((1 . a) (2 . c) (3 . d))
+         (check '((3 . d) (2 . b) (2 . c) (1 . a)) default-comparator))
+  (test* "alist->imap (unsorted, duplicates)" '((1 . e) (2 . c) (3 . d))
+         (check '((2 . b) (1 . a) (3 . d) (2 . c) (1 . e)) default-comparator))
+  (test* "alist->imap (strings)" '(("a" . 1) ("b" . 2) ("c" . 3))
+         (check '(("c" . 3) ("a" . 1) ("b" . 2)) string-comparator))
+  (test* "alist->imap (custom order)" '((3 . c) (2 . b) (1 . a))
+         (coerce-to <list> (alist->imap '((1 . a) (3 . c) (2 . b)) = >)))
+  (test* "alist->imap (bad alist)" (test-error)
+         (alist->imap '((1 . a) 2))))
+
+(let* ([keys (map (^i (modulo (* i 7919) 3001)) (iota 3001))]
+       [z (fold (^[k z] (imap-put z (number->string k) k))
+                (make-imap string-comparator) keys)]
+       [z2 (fold (^[k z] (if (even? k) (imap-delete z (number->string k)) z))
+                 z keys)])
+  (test* "imap many entries" (sort (map number->string (iota 3001)) string<?)
+         (map car z))
+  (test* "imap many deletions"
+         (sort (map number->string (filter odd? (iota 3001))) string<?)
+         (map car z2))
+  (test* "imap many lookups" #t
+         (every (^k (eqv? (imap-get z2 (number->string k) #f)
+                          (and (odd? k) k)))
+                keys)))
+
 ;;;========================================================================
 (test-section "data.random")
 (use data.random)
@@ -540,6 +693,70 @@
                (max 1 1 1 1)))
   )
 
+;; indexed heap
+(let ((rs (make-random-source)))
+  (define (drain h)
+    (do ([r '() (cons (heap-handle-key (indexed-heap-pop-min! h)) r)])
+        [(indexed-heap-empty? h) (reverse r)]))
+  (define (do-test key-type data)       ; data must be sorted
+    (let1 input (shuffle data rs)
+      (test* (format "indexed heap(~s) push ~s" key-type input) data
+             (let1 h (make-indexed-heap key-type)
+               (dolist [k input] (indexed-heap-push! h k))
+               (drain h)))
+      (test* (format "indexed heap(~s) build ~s" key-type input) data
+             (drain (values-ref (build-indexed-heap key-type
+                                                    (list->vector input))
+                                0)))))
+
+  (do-test 'fixnum (iota 100))
+  (do-test 'flonum (map (cut * 0.5 <>) (iota 50 -10)))
+  (do-test default-comparator '("a" "aa" "b" "bb" "c"))
+  (do-test (make-comparator/compare number? #t (^[a b] (- (compare a b))) #f)
+           (reverse (iota 33)))
+
+  (let* ([keys (list->vector (shuffle (iota 40) rs))]
+         [vals (vector-map (cut * 10 <>) keys)])
+    (receive (h handles) (build-indexed-heap 'fixnum keys vals)
+      (test* "indexed heap size" 40 (indexed-heap-num-entries h))
+      (test* "indexed heap find-min" '(0 0)
+             (let1 e (indexed-heap-find-min h)
+               (list (heap-handle-key e) (heap-handle-value e))))
+      (test* "indexed heap decrease-key" '(-1 390)
+             (let1 e (find (^e (= (heap-handle-key e) 39))
+                           (vector->list handles))
+               (indexed-heap-decrease-key! h e -1)
+               (let1 m (indexed-heap-find-min h)
+                 (list (heap-handle-key m) (heap-handle-value m)))))
+      (test* "indexed heap decrease-key, increasing" (test-error)
+             (indexed-heap-decrease-key! h (indexed-heap-find-min h) 100))
+      (test* "indexed heap update-key" '(-1 1 #f)
+             (let1 e (find (^e (= (heap-handle-key e) 0))
+                           (vector->list handles))
+               (indexed-heap-update-key! h e 50)
+               (let* ([a (indexed-heap-pop-min! h)]
+                      [b (indexed-heap-pop-min! h)])
+                 (list (heap-handle-key a) (heap-handle-key b)
+                       (heap-handle-active? a)))))
+      (test* "indexed heap delete" (iota 37 2)
+             (let1 e (find (^e (= (heap-handle-key e) 50))
+                           (vector->list handles))
+               (indexed-heap-delete! h e)
+               (drain h)))))
+
+  (let1 h (make-indexed-heap 'fixnum)
+    (test* "indexed heap empty" 'none (indexed-heap-find-min h 'none))
+    (test* "indexed heap pop empty" (test-error) (indexed-heap-pop-min! h))
+    (test* "indexed heap key type" (test-error) (indexed-heap-push! h 1.5))
+    (let1 e (indexed-heap-push! h 3)
+      (test* "indexed heap clear" '(#f #t)
+             (begin (indexed-heap-clear! h)
+                    (list (heap-handle-active? e)
+                          (indexed-heap-empty? h))))
+      (test* "indexed heap foreign handle" (test-error)
+             (indexed-heap-delete! h e))))
+  )
+
 ;;;========================================================================
 ;; ring-buffer
 (test-section "data.ring-buffer")
@@ -627,6 +844,95 @@
 (test-ring-buffer (make-vector 4))
 (test-ring-buffer (make-u8vector 5))
 
+;; bulk transfer
+(let1 rb (make-ring-buffer (make-f32vector 4))
+  (ring-buffer-add-back! rb 0.0)
+  (ring-buffer-add-back! rb 1.0)
+  (ring-buffer-remove-front! rb)
+  (test* "ring-buffer-add-back-vector! (wraparound)" '(1.0 2.0 3.0 4.0)
+         (begin (ring-buffer-add-back-vector! rb '#f32(2.0 3.0 4.0))
+                (map (cut ring-buffer-ref rb <>) (iota 4))))
+  (test* "ring-buffer-remove-front-into! (wraparound)"
+         '(3 #f32(1.0 2.0 3.0 0.0) 1)
+         (let1 v (make-f32vector 4 0.0)
+           (list (ring-buffer-remove-front-into! rb v 0 3)
+                 v
+                 (ring-buffer-num-entries rb))))
+  (test* "ring-buffer-add-back-vector! (realloc)" '(#t 7)
+         (begin (ring-buffer-add-back-vector! rb '#f32(5.0 6.0 7.0 8.0 9.0 10.0))
+                (list (>= (ring-buffer-capacity rb) 7)
+                      (ring-buffer-num-entries rb))))
+  (test* "ring-buffer-remove-front-into! (short)"
+         '(7 #f32(4.0 5.0 6.0 7.0 8.0 9.0 10.0 0.0))
+         (let1 v (make-f32vector 8 0.0)
+           (list (ring-buffer-remove-front-into! rb v) v))))
+
+(let1 rb (make-ring-buffer (make-u8vector 4) :overflow-handler 'overwrite)
+  (ring-buffer-add-back-vector! rb '#u8(1 2 3))
+  (test* "ring-buffer-add-back-vector! (overwrite)" '(3 4 5 6)
+         (begin (ring-buffer-add-back-vector! rb '#u8(4 5 6))
+                (map (cut ring-buffer-ref rb <>) (iota 4))))
+  (test* "ring-buffer-add-back-vector! (overwrite, long)" '(7 8 9 10)
+         (begin (ring-buffer-add-back-vector! rb '#u8(0 0 7 8 9 10))
+                (map (cut ring-buffer-ref rb <>) (iota 4)))))
+
+(let1 rb (make-ring-buffer (make-u8vector 4) :overflow-handler 'error)
+  (test* "ring-buffer-add-back-vector! (error)" (test-error)
+         (ring-buffer-add-back-vector! rb '#u8(1 2 3 4 5))))
+
+;; single-producer/single-consumer
+(let1 rb (make-spsc-ring-buffer (make-s16vector 4))
+  (test* "spsc-ring-buffer push/pop" '(#t #t 2 10 11 none)
+         (list (spsc-ring-buffer-push! rb 10)
+               (spsc-ring-buffer-push! rb 11)
+               (spsc-ring-buffer-num-entries rb)
+               (spsc-ring-buffer-pop! rb)
+               (spsc-ring-buffer-pop! rb)
+               (spsc-ring-buffer-pop! rb 'none)))
+  (test* "spsc-ring-buffer pop (empty)" (test-error)
+         (spsc-ring-buffer-pop! rb))
+  (test* "spsc-ring-buffer-write! (partial)" '(4 #f)
+         (list (spsc-ring-buffer-write! rb '#s16(1 2 3 4 5))
+               (spsc-ring-buffer-push! rb 6)))
+  (test* "spsc-ring-buffer-read! (wraparound)" '(3 #s16(1 2 3 0) 1)
+         (let1 v (make-s16vector 4 0)
+           (list (spsc-ring-buffer-read! rb v 0 3) v
+                 (spsc-ring-buffer-num-entries rb))))
+  (test* "spsc-ring-buffer-write!/read! (wraparound)" '(3 4 #s16(4 7 8 9))
+         (let1 v (make-s16vector 4 0)
+           (list (spsc-ring-buffer-write! rb '#s16(7 8 9))
+                 (spsc-ring-buffer-read! rb v)
+                 v))))
+
+(cond-expand
+ [gauche.sys.threads
+  (use gauche.threads)
+  (let* ([rb (make-spsc-ring-buffer (make-u32vector 16))]
+         [n 10000]
+         [producer
+          (make-thread
+           (^[] (let1 chunk (make-u32vector 5)
+                  (let loop ([i 0])
+                    (when (< i n)
+                      (dotimes [k 5] (u32vector-set! chunk k (+ i k)))
+                      (let push ([s 0])
+                        (when (< s 5)
+                          (push (+ s (spsc-ring-buffer-write! rb chunk s)))))
+                      (loop (+ i 5)))))))])
+    (thread-start! producer)
+    (test* "spsc-ring-buffer threads" n
+           (let1 buf (make-u32vector 7)
+             (let loop ([expected 0])
+               (if (= expected n)
+                 (begin (thread-join! producer) expected)
+                 (let1 k (spsc-ring-buffer-read! rb buf)
+                   (if (every (^j (= (u32vector-ref buf j) (+ expected j)))
+                              (iota k))
+                     (begin (when (zero? k) (thread-yield!))
+                            (loop (+ expected k)))
+                     expected)))))))]
+ [else])
+
 ;;;========================================================================
 ;; trie
 (test-section "data.trie")
@@ -828,6 +1134,67 @@
            (let1 h (coerce-to <hash-table> t6)
              (every (cut hash-table-get h <>) strs)))
     )
+
+  ;; radix trie
+  (let ([t (make-radix-trie)]
+        [alist (map-with-index (^[i s] (cons s i)) strs)])
+    (define (key-index s) (list-index (cut equal? s <>) strs))
+    (test* "radix-trie: constructor" '(#t 0)
+           (list (radix-trie? t) (radix-trie-num-entries t)))
+    (test* "radix-trie: put!" (length strs)
+           (begin (for-each (^p (radix-trie-put! t (car p) (cdr p))) alist)
+                  (radix-trie-num-entries t)))
+    (test* "radix-trie: get" (iota (length strs))
+           (map (cut radix-trie-get t <>) strs))
+    (test* "radix-trie: get (error)" (test-error) (radix-trie-get t "lil"))
+    (test* "radix-trie: get (fallback)" 'none (radix-trie-get t "lil" 'none))
+    (test* "radix-trie: exists?" '(#t #f #t)
+           (map (cut radix-trie-exists? t <>) '("kane" "kan" "")))
+    (test* "radix-trie: keys in order" (sort strs string<?)
+           (radix-trie-keys t))
+    (test* "radix-trie: common-prefix"
+           (sort (filter (cut string-prefix? "kana" <>) strs) string<?)
+           (radix-trie-common-prefix-keys t "kana"))
+    (test* "radix-trie: common-prefix with limit" '("kana" "kanaono")
+           (radix-trie-common-prefix-keys t "kana" 2))
+    (test* "radix-trie: common-prefix-fold" 3
+           (radix-trie-common-prefix-fold t "kane" (^[k v s] (+ s 1)) 0))
+    (test* "radix-trie: longest-match"
+           `(("kanawai" . ,(key-index "kanawai"))
+             ("kua" . ,(key-index "kua"))
+             ("" . ,(key-index "")))
+           (map (cut radix-trie-longest-match t <>)
+                '("kanawai ko" "kua`a" "xyz")))
+    (test* "radix-trie: partial-key?" '(#t #t #f #f)
+           (map (cut radix-trie-partial-key? t <>)
+                '("kan" "kana" "kanaono" "x")))
+    (test* "radix-trie: u8vector keys" `(,(* 2 (length strs)) 100
+                                         ,(key-index "kane"))
+           (begin
+             (for-each (cut radix-trie-put! t <> 100) uvecs)
+             (list (radix-trie-num-entries t)
+                   (radix-trie-get t (string->u8vector "kane"))
+                   (radix-trie-get t "kane"))))
+    (test* "radix-trie: non-string key" (test-error)
+           (radix-trie-put! t '(#\a) 1))
+    (test* "radix-trie: update!" 101
+           (begin (radix-trie-update! t (string->u8vector "ku") (cut + 1 <>))
+                  (radix-trie-get t (string->u8vector "ku"))))
+    (test* "radix-trie: dict" `(,(key-index "lilo") ,(* 2 (length strs)))
+           (list (dict-get t "lilo")
+                 (dict-fold t (^[k v s] (+ s 1)) 0)))
+    (test* "radix-trie: delete!" '(#t #f)
+           (list (radix-trie-delete! t "kana")
+                 (radix-trie-delete! t "kana")))
+    (test* "radix-trie: delete! keeps others"
+           (delete "kana" (sort strs string<?))
+           (radix-trie-common-prefix-keys t ""))
+    (test* "radix-trie: delete! all" '(0 ())
+           (begin
+             (for-each (cut radix-trie-delete! t <>) strs)
+             (for-each (cut radix-trie-delete! t <>) uvecs)
+             (list (radix-trie-num-entries t) (radix-trie->list t))))
+    )
   )
 
 (test-end)
@@ -79,6 +79,103 @@
 
 
 
+(test-section "statement cache")
+
+(let1 conn (dbi-connect "dbi:null")
+  (test* "dbi-prepare-cached" #t
+         (eq? (dbi-prepare-cached conn "select * from foo where x = ?")
+              (dbi-prepare-cached conn "select * from foo where x = ?")))
+  (test* "dbi-prepare-cached (different options)" #f
+         (eq? (dbi-prepare-cached conn "select 1")
+              (dbi-prepare-cached conn "select 1" :pass-through #t)))
+  (test* "dbi-prepare-cached (execute)" '("select * from foo where x = 3")
+         (coerce-to <list>
+                    (dbi-execute
+                     (dbi-prepare-cached conn "select * from foo where x = ?")
+                     3)))
+  (test* "dbi-clear-statement-cache" #f
+         (let1 q (dbi-prepare-cached conn "select 2")
+           (dbi-clear-statement-cache conn)
+           (eq? q (dbi-prepare-cached conn "select 2"))))
+  (test* "dbi-prepare-cached (eviction)" #t
+         (let1 q (dbi-prepare-cached conn "select 0")
+           (dotimes [i 200]
+             (dbi-prepare-cached conn (format "select ~a" (+ i 1)))
+             (dbi-prepare-cached conn "select 0"))
+           (eq? q (dbi-prepare-cached conn "select 0"))))
+  )
+
+(test-section "connection pool")
+
+(use gauche.threads)
+
+(let1 pool (make-dbi-connection-pool "dbi:null:pooltest" :max-connections 2
+                                     :username "u" :password "p")
+  (test* "dbi-pool-acquire" '(#t "pooltest" "u" "p")
+         (let1 c (dbi-pool-acquire pool)
+           (begin0 (list (dbi-open? c) (ref c 'attr-string)
+                         (get-keyword :username (ref c 'options))
+                         (get-keyword :password (ref c 'options)))
+             (dbi-pool-release pool c))))
+  (test* "reuse" #t
+         (let* ([c1 (dbi-pool-acquire pool)]
+                [_  (dbi-pool-release pool c1)]
+                [c2 (dbi-pool-acquire pool)])
+           (dbi-pool-release pool c2)
+           (eq? c1 c2)))
+  (test* "health check" #f
+         (let1 c1 (dbi-pool-acquire pool)
+           (dbi-pool-release pool c1)
+           (dbi-close c1)
+           (call-with-dbi-connection pool (cut eq? c1 <>))))
+  (test* "dbi-pool-stats" '((idle . 1) (in-use . 1) (max-connections . 2))
+         (call-with-dbi-connection pool (^_ (dbi-pool-stats pool))))
+  (test* "timeout" (test-error <dbi-pool-timeout-error>)
+         (let* ([c1 (dbi-pool-acquire pool)]
+                [c2 (dbi-pool-acquire pool)])
+           (unwind-protect (dbi-pool-acquire pool 0.05)
+             (dbi-pool-release pool c1)
+             (dbi-pool-release pool c2))))
+  (test* "waiting for release" #t
+         (let* ([c1 (dbi-pool-acquire pool)]
+                [c2 (dbi-pool-acquire pool)]
+                [t (thread-start!
+                    (make-thread (^[] (dbi-pool-acquire pool 5))))])
+           (sys-nanosleep #e1e8)
+           (dbi-pool-release pool c1)
+           (let1 c3 (thread-join! t)
+             (dbi-pool-release pool c2)
+             (dbi-pool-release pool c3)
+             (eq? c1 c3))))
+  (test* "concurrent use" '(#t 40)
+         (let ([m (make-mutex)]
+               [peak 0]
+               [using 0]
+               [n 0])
+           (for-each thread-join!
+                     (list-tabulate
+                      8
+                      (^_ (thread-start!
+                           (make-thread
+                            (^[]
+                              (dotimes [i 5]
+                                (call-with-dbi-connection pool
+                                  (^c (with-locking-mutex m
+                                        (^[] (inc! using) (inc! n)
+                                          (set! peak (max peak using))))
+                                      (sys-nanosleep #e1e6)
+                                      (with-locking-mutex m
+                                        (^[] (dec! using))))))))))))
+           (list (<= peak 2) n)))
+  (test* "dbi-pool-close" '(#f #t)
+         (let1 c (dbi-pool-acquire pool)
+           (dbi-pool-close pool)
+           (dbi-pool-release pool c)
+           (list (dbi-open? c)
+                 (guard (e [(<dbi-error> e) #t])
+                   (dbi-pool-acquire pool)
+                   #f))))
+  )
 
 (test-end)
 
@@ -33,4 +33,63 @@
                      [_ #f])
                    (call/cc (^x (ra x) #f))))
 
+;;-------------------------------------------------------------------
+(test-section "runtime metrics")
+
+(use gauche.metrics)
+(test-module 'gauche.metrics)
+
+(test* "write-metrics-prometheus"
+       "# HELP foo_total A \\\\ test.\\n
+# TYPE foo_total counter
+foo_total 3
+# HELP bar_seconds B.
+# TYPE bar_seconds gauge
+bar_seconds{a=\"x\\\"y\",b=\"z\"} 0.5
+bar_seconds{a=\"w\\n\"} +Inf
+"
+       (with-output-to-string
+         (cut write-metrics-prometheus
+              '((foo_total counter "A \\ test.\n" ((() . 3)))
+                (bar_seconds gauge "B."
+                             (((("a" . "x\"y") ("b" . "z")) . 0.5)
+                              ((("a" . "w\n")) . +inf.0)))))))
+
+(test* "runtime-metrics" #t
+       (let1 ms (runtime-metrics)
+         (and (every (^m (memq (car m) (map car ms)))
+                     '((gauche_gc_heap_bytes) (gauche_threads)
+                       (gauche_vm_stack_overflows_total)
+                       (gauche_buffered_output_ports)
+                       (gauche_mutex_waits_total) (gauche_modules)))
+              (every (^m (and (memq (cadr m) '(gauge counter))
+                              (every (^s (real? (cdr s))) (cadddr m))))
+                     ms))))
+
+(test* "runtime-metrics thread state" "runnable"
+       (let* ([m (assq 'gauche_thread_state (runtime-metrics))]
+              [id (x->string (~ (current-thread)'vmid))]
+              [s (find (^s (equal? (assoc-ref (car s) "thread") id))
+                       (cadddr m))])
+         (and s (assoc-ref (car s) "state"))))
+
+(use gauche.net)
+(test* "metrics server" '("HTTP/1.0 200 OK" #t "HTTP/1.0 404 Not Found")
+       (let* ([server (start-metrics-server :port 0)]
+              [port (metrics-server-port server)])
+         (define (get path)
+           (call-with-client-socket
+               (make-client-socket 'inet "127.0.0.1" port)
+             (^[in out]
+               (format out "GET ~a HTTP/1.0\r\n\r\n" path)
+               (flush out)
+               (port->string-list in))))
+         (unwind-protect
+             (let ([r (get "/metrics")]
+                   [n (get "/nowhere")])
+               (list (regexp-replace #/\r$/ (car r) "")
+                     (boolean (any #/^gauche_gc_heap_bytes \d+$/ r))
+                     (regexp-replace #/\r$/ (car n) "")))
+           (stop-metrics-server server))))
+
 (test-end)
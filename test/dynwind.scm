@@ -449,6 +449,14 @@
 (test "calling pc multi" '(1 3 2 2 4)
       (^[] (cons 1 (reset (cons 2 (shift k (cons 3 (k (k (cons 4 '()))))))))))
 
+(test "calling pc with multiple values" '(0 1 2)
+      (^[] (cons 0 (reset (receive (a b) (shift k (k 1 2)) (list a b))))))
+(test "calling pc repeatedly" 5050
+      (^[] (reset (let loop ([i 0] [s 0])
+                    (if (> i 100)
+                      s
+                      (loop (+ i 1) (+ s (shift k (k i)))))))))
+
 ;; 'amb' example in Gasbichler&Sperber ICFP2002 paper
 (let ()
   (define (eta x) (list (x)))                    ; unit
@@ -526,6 +534,28 @@
         (^[] ((sprintf (^[] (fmt s))) "world")))
   )
 
+;; Capturing partial continuations while the frames below the reset
+;; are still in the VM stack.
+(let ()
+  (define (inv lis)
+    (define (kk)
+      (reset (for-each (^e (shift k (set! kk k) e)) lis)
+             (set! kk (^[] (eof-object)))
+             (eof-object)))
+    (^[] (kk)))
+  (define (deep n thunk)                ; non-tail recursion
+    (if (= n 0) (thunk) (car (list (deep (- n 1) thunk)))))
+  (define (collect iter)
+    (let loop ([r '()])
+      (let1 v (deep 100 iter)
+        (if (eof-object? v) (reverse r) (loop (cons v r))))))
+  (test "capture in deep stack" '(1 2 3 4 5)
+        (^[] (collect (inv '(1 2 3 4 5)))))
+  (test "capture in deep stack (local env)" '(10 (1 2 3))
+        (^[] (let* ([x 10] [r (reset (list (shift k (k (list 1 2 3)))))])
+               (list x (car r)))))
+  )
+
 ;; To be written:
 ;;  - tests for interactions of dynamic handlers and partial continuaions.
 ;;  - tests for interactions of partial and full continuations.
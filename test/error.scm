@@ -98,6 +98,42 @@
                      (loop (+ i 1)))
               i))))
 
+(prim-test "multiple values from thunk" '(1 2 3)
+      (lambda ()
+        (call-with-values
+            (lambda ()
+              (with-error-handler (lambda (e) 'ng)
+                                  (lambda () (values 1 2 3))))
+          list)))
+
+(prim-test "handler is discarded on normal exit" 'outer
+      (lambda ()
+        (with-error-handler
+         (lambda (e) 'outer)
+         (lambda ()
+           (with-error-handler (lambda (e) 'inner)
+                               (lambda () 'ok))
+           (car 0)))))
+
+(prim-test "reentering body by continuation" '(1 2 . err)
+      (lambda ()
+        (let ((k #f) (r '()))
+          (let ((v (with-error-handler
+                    (lambda (e) 'err)
+                    (lambda ()
+                      (call/cc (lambda (c) (set! k c) 0))))))
+            (set! r (cons v r))
+            (cond ((eqv? v 0) (k 1))
+                  ((eqv? v 1)
+                   (with-error-handler
+                    (lambda (e) (k 2))
+                    (lambda () (car 0))))
+                  (else
+                   (cons* (cadr r) (car r)
+                          (with-error-handler
+                           (lambda (e) 'err)
+                           (lambda () (car 0))))))))))
+
 ;;----------------------------------------------------------------
 (test-section "cascading errors")
 
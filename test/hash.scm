@@ -280,6 +280,29 @@
          (hash-table-delete! h-equal (vector (cons 'a 'b) 3+3i))
          (hash-table-get h-equal (vector (cons 'a 'b) 3+3i) #f)))
 
+(let ()
+  (define (nest n)
+    (let loop ([n n] [r '()])
+      (if (zero? n) r (loop (- n 1) (list n (vector r))))))
+  (define (cycle . lis)
+    (set-cdr! (last-pair lis) lis)
+    lis)
+  (test* "deeply nested key" 'deep
+         (let1 h (make-hash-table 'equal?)
+           (hash-table-put! h (nest 100000) 'deep)
+           (hash-table-get h (nest 100000) #f)))
+  (test* "circular key" #t
+         (= (default-hash (cycle 1 2 3)) (default-hash (cycle 1 2 3 1 2 3))))
+  (test* "long keys" '(a b #f)
+         (let ([h (make-hash-table 'equal?)]
+               [k1 (iota 20000)]
+               [k2 (append (iota 19999) '(x))])
+           (hash-table-put! h k1 'a)
+           (hash-table-put! h k2 'b)
+           (list (hash-table-get h (iota 20000) #f)
+                 (hash-table-get h (append (iota 19999) '(x)) #f)
+                 (hash-table-get h (append (iota 19999) '(y)) #f)))))
+
 ;;------------------------------------------------------------------
 (test-section "string?-hash")
 
@@ -327,6 +350,27 @@
          (hash-table-delete! h-string "d")
          (hash-table-get h-string "d" #f)))
 
+;; String bodies cache their hash values.  Make sure the cache doesn't
+;; survive mutation, and is shared by copies and literals consistently.
+(test* "cached hash and mutation" '(#f 1 2)
+       (let ([h (make-hash-table 'string=?)]
+             [s (string-copy "abcdefg")])
+         (hash-table-put! h s 1)
+         (hash-table-put! h "xbcdefg" 2)
+         (string-set! s 0 #\x)           ;s now has a new body
+         (list (hash-table-get h "abcdefg" #f)
+               (hash-table-get h (string-copy "abcdefg") 1)
+               (hash-table-get h s #f))))
+
+(test* "cached hash of copies and substrings" '(#t #t #t)
+       (let* ([s "http://example.com/some/path"]
+              [h0 (default-hash s)]
+              [h1 (default-hash s)])
+         (list (= h0 h1)
+               (= h0 (default-hash (string-copy s)))
+               (= (default-hash (substring s 7 18))
+                  (default-hash (string-copy "example.com"))))))
+
 ;;------------------------------------------------------------------
 (test-section "generic hash")
 
@@ -370,6 +414,21 @@
          (map cdr x)
          (map (^p (hash-table-comparator (make-hash-table (car p)))) x)))
 
+(let ([h (make-hash-table symbol-comparator)]
+      [s (make-hash-table (make-comparator string? string=? #f default-hash))])
+  (test* "general table with built-in procs" '(general general)
+         (list (hash-table-type h) (hash-table-type s)))
+  (test* "general table with built-in procs - put/get" '(1 2 #f)
+         (begin
+           (hash-table-put! h 'a 1)
+           (hash-table-put! s (string #\a #\b) 2)
+           (list (hash-table-get h 'a) (hash-table-get s "ab")
+                 (hash-table-get s "abc" #f))))
+  (test* "general table with built-in procs - domain error" (test-error)
+         (hash-table-put! h "a" 1))
+  (test* "general table with built-in procs - domain error" (test-error)
+         (hash-table-get s 'ab)))
+
 ;;------------------------------------------------------------------
 (test-section "iterators")
 
@@ -411,6 +470,247 @@
          (list (assoc "a" a)
                (assoc "b" a))))
 
+(test-section "bulk operations")
+
+(define (ht->sorted-alist ht)
+  (sort (hash-table->alist ht) (^[a b] (string<? (x->string (car a))
+                                                 (x->string (car b))))))
+
+(test* "hash-table-copy with proc" '(((a . 3) (b . 4) (c . 8) (d . 10))
+                                     ((a . 4) (b . 5) (c . 9) (d . 11)))
+       (let1 h (hash-table-copy h-it (^[k v] (+ v 1)))
+         (list (ht->sorted-alist h-it) (ht->sorted-alist h))))
+
+(test* "hash-table-update-all!" '((a . (a 3)) (b . (b 4)) (c . (c 8)) (d . (d 10)))
+       (rlet1 h (hash-table-copy h-it)
+         (hash-table-update-all! h list))
+       (^[a b] (equal? a (ht->sorted-alist b))))
+
+(test* "hash-table-filter!" '((b . 4) (c . 8) (d . 10))
+       (rlet1 h (hash-table-copy h-it)
+         (hash-table-filter! h (^[k v] (even? v))))
+       (^[a b] (equal? a (ht->sorted-alist b))))
+
+(test* "hash-table-filter! (large)" '(5000 0)
+       (let1 h (make-hash-table 'eqv?)
+         (dotimes [i 10000] (hash-table-put! h i i))
+         (hash-table-filter! h (^[k v] (odd? k)))
+         (list (hash-table-num-entries h)
+               (count (^k (hash-table-exists? h k)) (iota 5000 0 2)))))
+
+(test* "hash-table-map->vector" '(3 4 8 10)
+       (sort (vector->list (hash-table-map->vector h-it (^[k v] v)))))
+
+(test* "hash-table-merge!" '((a . 3) (b . 4) (c . 1) (d . 10) (e . 2))
+       (let1 h (hash-table-copy h-it)
+         (hash-table-merge! h (hash-table 'eq? '(c . 1) '(e . 2)))
+         (ht->sorted-alist h)))
+
+(test* "hash-table-key-generator" '(a b c d)
+       (let1 g (hash-table-key-generator h-it)
+         (let loop ([r '()])
+           (let1 k (g)
+             (if (eof-object? k)
+               (sort r (^[a b] (string<? (x->string a) (x->string b))))
+               (loop (cons k r)))))))
+
+(test* "hash-table-value-generator" '(3 4 8 10)
+       (let1 g (hash-table-value-generator h-it)
+         (let loop ([r '()])
+           (let1 v (g)
+             (if (eof-object? v)
+               (sort r)
+               (loop (cons v r)))))))
+
+;;------------------------------------------------------------------
+(test-section "open addressing core")
+
+(test* "core kind" '(open-addressing open-addressing open-addressing chained)
+       (map (^t (get-keyword :core (hash-table-stat (make-hash-table t))))
+            '(eq? eqv? string=? equal?)))
+
+;; Mixed insertion and deletion, exercising tombstones and growth.
+(let ()
+  (define (stress type keyfn)
+    (let ([h (make-hash-table type)]
+          [v (make-vector 2000 #f)])
+      (dotimes [n 20000]
+        (let1 k (modulo (* n 7919) 2000)
+          (if (vector-ref v k)
+            (begin (hash-table-delete! h (keyfn k)) (vector-set! v k #f))
+            (begin (hash-table-put! h (keyfn k) n) (vector-set! v k n)))))
+      (and (= (hash-table-num-entries h) (count identity (vector->list v)))
+           (let loop ([k 0])
+             (cond [(= k 2000) #t]
+                   [(eqv? (hash-table-get h (keyfn k) #f) (vector-ref v k))
+                    (loop (+ k 1))]
+                   [else k])))))
+  (test* "stress eq?" #t (stress 'eq? identity))
+  (test* "stress eqv?" #t (stress 'eqv? (cut + <> (greatest-fixnum))))
+  (test* "stress string=?" #t (stress 'string=? number->string)))
+
+(test* "delete while iterating" '(0 ())
+       (let1 h (make-hash-table 'eq?)
+         (dotimes [n 100] (hash-table-put! h n n))
+         (hash-table-for-each h (^[k v] (hash-table-delete! h k)))
+         (list (hash-table-num-entries h) (hash-table-keys h))))
+
+(test* "update! growing the table" '(1 200)
+       (let1 h (make-hash-table 'eq?)
+         (hash-table-update! h 'x
+                             (^v (dotimes [n 200] (hash-table-put! h n n)) 1)
+                             0)
+         (list (hash-table-get h 'x) (- (hash-table-num-entries h) 1))))
+
+(test* "copy and grow" '(#t #t 1000 10)
+       (let* ([h (make-hash-table 'string=?)]
+              [_ (dotimes [n 10] (hash-table-put! h (number->string n) n))]
+              [h2 (hash-table-copy h)])
+         (dotimes [n 1000] (hash-table-put! h2 (number->string n) n))
+         (list (every (^n (eqv? (hash-table-get h2 (number->string n)) n))
+                      (iota 1000))
+               (every (^n (eqv? (hash-table-get h (number->string n)) n))
+                      (iota 10))
+               (hash-table-num-entries h2)
+               (hash-table-num-entries h))))
+
+(test* "clear!" '(0 #f 1)
+       (let1 h (make-hash-table 'eqv?)
+         (dotimes [n 100] (hash-table-put! h n n))
+         (hash-table-clear! h)
+         (let1 r (list (hash-table-num-entries h) (hash-table-get h 5 #f))
+           (hash-table-put! h 5 5)
+           (append r (list (hash-table-num-entries h))))))
+
+;;------------------------------------------------------------------
+(test-section "incremental growth")
+
+;; The chained core (equal? table) moves entries to the new buckets
+;; gradually; check that the table is consistent in the middle of it.
+(define (migrating-table n)
+  (let1 h (make-hash-table 'equal?)
+    (let loop ([i 0])
+      (hash-table-put! h (list i) i)
+      (if (or (>= i n)
+              (and (> i 100)
+                   (positive? (get-keyword :num-migrating-buckets
+                                           (hash-table-stat h)))))
+        (values h (+ i 1))
+        (loop (+ i 1))))))
+
+(test* "migration happens" #t
+       (receive (h n) (migrating-table 10000)
+         (positive? (get-keyword :num-migrating-buckets (hash-table-stat h)))))
+
+(test* "lookup while migrating" #t
+       (receive (h n) (migrating-table 10000)
+         (every (^i (eqv? (hash-table-get h (list i) #f) i)) (iota n))))
+
+(test* "iterate while migrating" #t
+       (receive (h n) (migrating-table 10000)
+         (equal? (sort (map car (hash-table-keys h))) (iota n))))
+
+(test* "delete while migrating" '(0 #f)
+       (receive (h n) (migrating-table 10000)
+         (dotimes [i n] (hash-table-delete! h (list i)))
+         (list (hash-table-num-entries h) (hash-table-get h '(0) #f))))
+
+(test* "copy while migrating" #t
+       (receive (h n) (migrating-table 10000)
+         (let1 h2 (hash-table-copy h)
+           (and (zero? (get-keyword :num-migrating-buckets
+                                    (hash-table-stat h2)))
+                (= (hash-table-num-entries h2) n)
+                (every (^i (eqv? (hash-table-get h2 (list i) #f) i))
+                       (iota n))))))
+
+(test* "stat while migrating" #t
+       (receive (h n) (migrating-table 10000)
+         (= n (fold + 0 (map length
+                             (vector->list
+                              (get-keyword :contents (hash-table-stat h))))))))
+
+(test* "growth finishes" #t
+       (let1 h (make-hash-table 'equal?)
+         (dotimes [i 5000] (hash-table-put! h (list i) i))
+         (and (every (^i (eqv? (hash-table-get h (list i) #f) i))
+                     (iota 5000))
+              (= (hash-table-num-entries h) 5000))))
+
+(let ()
+  (define (check type keyfn)
+    (let* ([h (make-hash-table type)]
+           [_ (hash-table-put! h (keyfn -1) -1)]
+           [_ (hash-table-reserve! h 3000)]
+           [cap (hash-table-capacity h)]
+           [nb (get-keyword :num-buckets (hash-table-stat h))])
+      (dotimes [i 3000] (hash-table-put! h (keyfn i) i))
+      (list (>= cap 3000)
+            (= nb (get-keyword :num-buckets (hash-table-stat h)))
+            (eqv? (hash-table-get h (keyfn -1)) -1)
+            (hash-table-num-entries h))))
+  (test* "reserve! (chained)" '(#t #t #t 3001) (check 'equal? list))
+  (test* "reserve! (open addressing)" '(#t #t #t 3001) (check 'eqv? identity)))
+
+(test* "reserve! doesn't shrink" #t
+       (let1 h (make-hash-table 'equal?)
+         (dotimes [i 1000] (hash-table-put! h (list i) i))
+         (let1 cap (hash-table-capacity h)
+           (hash-table-reserve! h 10)
+           (= cap (hash-table-capacity h)))))
+
+(test* "reserve! while migrating" #t
+       (receive (h n) (migrating-table 10000)
+         (hash-table-reserve! h (* n 8))
+         (and (zero? (get-keyword :num-migrating-buckets (hash-table-stat h)))
+              (>= (hash-table-capacity h) (* n 8))
+              (every (^i (eqv? (hash-table-get h (list i) #f) i))
+                     (iota n)))))
+
+;;------------------------------------------------------------------
+(test-section "trusted hash table")
+
+(let ()
+  (define (check type keys)
+    (let1 h (make-trusted-hash-table type)
+      (for-each (^[k] (hash-table-put! h k (list k))) keys)
+      (and (get-keyword :fast-hash (hash-table-stat h))
+           (eq? (hash-table-type h) type)
+           (every (^[k] (equal? (hash-table-get h (string-copy k)) (list k)))
+                  keys)
+           (= (hash-table-num-entries h) (length keys))
+           (begin (for-each (cut hash-table-delete! h <>) keys)
+                  (zero? (hash-table-num-entries h))))))
+  ;; various lengths to cover the short and long paths
+  (define keys
+    (map (^n (string-tabulate (^i (integer->char (+ 97 (modulo (* i n) 26))))
+                              n))
+         (iota 130)))
+  (test* "string=?" #t (check 'string=? keys))
+  (test* "equal?" #t (check 'equal? keys)))
+
+(test* "trusted equal? table with non-string keys" '(1 2 #t)
+       (let1 h (make-trusted-hash-table equal-comparator)
+         (hash-table-put! h '(a "b") 1)
+         (hash-table-put! h 3.0 2)
+         (hash-table-put! h "c" #t)
+         (list (hash-table-get h (list 'a (string #\b)))
+               (hash-table-get h 3.0)
+               (hash-table-get h "c"))))
+
+(test* "trusted string=? table key check" (test-error)
+       (hash-table-put! (make-trusted-hash-table 'string=?) 'a 1))
+
+(test* "copy keeps fast hash" '(#t 1)
+       (let1 h (make-trusted-hash-table 'string=?)
+         (hash-table-put! h "abc" 1)
+         (let1 h2 (hash-table-copy h)
+           (list (get-keyword :fast-hash (hash-table-stat h2))
+                 (hash-table-get h2 "abc")))))
+
+(test* "default tables don't use fast hash" #f
+       (get-keyword :fast-hash (hash-table-stat (make-hash-table 'string=?))))
+
 (test-module 'gauche.hashutil) ; autoloaded module
 
 (test-end)
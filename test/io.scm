@@ -291,6 +291,52 @@
                (and (eof-object? s3)
                     (list (string-size s1) (string-size s2)))))))
 
+;; read-line scans the port buffer in chunks; make sure terminators
+;; are handled at chunk boundaries and line counts are kept.
+(let1 s (string-append (make-string 5000 #\a) "\r\n" "b\r" "\r" "c")
+  (test* "read-line (long line)" `(5000 "b" "" "c" #t 4)
+         (with-input-from-string s
+           (^[] (let* ([l1 (read-line)]
+                       [l2 (read-line)]
+                       [l3 (read-line)]
+                       [l4 (read-line)]
+                       [l5 (read-line)])
+                  (list (string-length l1) l2 l3 l4 (eof-object? l5)
+                        (port-current-line (current-input-port))))))))
+
+(use gauche.uvector)
+(test* "read-line-into!" '(3 #t (97 98 99 0 0 0) 1 #t 0 #t #t)
+       (with-input-from-string "abc\nd\n\n"
+         (^[] (let* ([buf (make-u8vector 6 0)]
+                     [(n1 c1) (read-line-into! buf)]
+                     [v (u8vector->list buf)]
+                     [(n2 c2) (read-line-into! buf)]
+                     [(n3 c3) (read-line-into! buf)]
+                     [(n4 c4) (read-line-into! buf)])
+                (list n1 c1 v n2 c2 n3 c3 (eof-object? n4))))))
+(test* "read-line-into! (partial)" '(2 #f 2 #f 1 #t "abcde" 1 #t)
+       (with-input-from-string "abcde\r\nf"
+         (^[] (let* ([buf (make-u8vector 8 0)]
+                     [(n1 c1) (read-line-into! buf (current-input-port) 0 2)]
+                     [(n2 c2) (read-line-into! buf (current-input-port) 2 4)]
+                     [(n3 c3) (read-line-into! buf (current-input-port) 4 6)]
+                     [(n4 c4) (read-line-into! buf (current-input-port) 6)])
+                (list n1 c1 n2 c2 n3 c3
+                      (u8vector->string buf 0 5) n4 c4)))))
+
+(test* "read-lines-into-vector!" '(2 #("a" "b" #f) 1 #("a" "b" "c"))
+       (with-input-from-string "a\nb\r\nc"
+         (^[] (let* ([v (make-vector 3 #f)]
+                     [n1 (read-lines-into-vector! v (current-input-port) 0 2)]
+                     [v1 (vector-copy v)]
+                     [n2 (read-lines-into-vector! v (current-input-port) 2)])
+                (list n1 v1 n2 v)))))
+(test* "read-lines-into-vector! (EOF)" '(2 #("x" "y" 0 0))
+       (with-input-from-string "x\ny\n"
+         (^[] (let* ([v (make-vector 4 0)]
+                     [n (read-lines-into-vector! v)])
+                (list n v)))))
+
 (with-output-to-file "tmp1.o"
   (cut display "a b c \"d e\" f g\n(0 1 2\n3 4 5)\n"))
 
@@ -781,6 +827,31 @@
 ;; regression check for format/ss
 (test* "format/ss" "z  " (format/ss "~v,a" 3 'z))
 
+;; format calls with simple literal format strings are expanded
+;; at compile time; make sure they behave the same as the runtime.
+(test* "format (expanded)" "a1 b\"x\" c2\n~"
+       (format #f "a~a b~s c~d~%~~" 1 "x" 2))
+(test* "format (expanded)" "x" (format "~a" 'x))
+(test* "format (expanded)" "1.5 #t" (format "~d ~s" 1.5 #t))
+(test* "format (expanded)" "" (format #f ""))
+(test* "format (expanded, port)" "<1>"
+       (call-with-output-string (^p (format p "<~a>" 1))))
+(test* "format (expanded, current port)" "<1>"
+       (with-output-to-string (^[] (format #t "<~a>" 1))))
+(test* "format (expanded, non-port dest)" "1"
+       (let1 d #f (format d "~a" 1)))
+(test* "format (expanded, write-controls)" "(1 2 ...)"
+       (let1 c (make-write-controls :print-length 2) (format c "~s" '(1 2 3))))
+(test* "format (expanded, too few args)" (test-error) (format #f "~a ~a" 1))
+(test* "format (expanded, too many args)" (test-error) (format #f "~a" 1 2))
+(test* "format (expanded, bad arg)" (test-error) (format #f "~d" "x"))
+
+(test* "format (cached format string)" '("1-2" "\"x\"-2")
+       (let* ([s (string-copy "~a-~a")]
+              [r1 (format #f s 1 2)])
+         (string-set! s 1 #\s)
+         (list r1 (format #f s "x" 2))))
+
 ;;-------------------------------------------------------------------
 (test-section "some corner cases in list reader")
 
@@ -795,6 +866,44 @@
 (dot-reader-tester "((). .)"  (test-error <read-error>))
 
 
+;;-------------------------------------------------------------------
+(test-section "words and strings in the reader")
+
+;; The reader scans ASCII words and strings directly in the port buffer
+;; when it can; check the boundaries.
+(test* "words" '(abc -12 +5 7 123456789012345678 1234567890123456789012
+                 -1234567890123456789012 1.5 1+ - -> |a b| "x\ty" :key)
+       (read-from-string "(abc -12 +5 007 123456789012345678 \
+                           1234567890123456789012 \
+                           -1234567890123456789012 1.5 1+ - -> |a b| \
+                           \"x\\ty\" :key)"))
+(test* "words (case fold)" '(abc def)
+       (read (open-input-string "#!fold-case (ABC Def)")))
+(test* "word at the end" 'xyz (read-from-string "xyz"))
+(test* "number at the end" 42 (read-from-string "42"))
+(test* "symbol with #" (test-error) (read-from-string "(a#b)"))
+(test* "symbols are interned" #t
+       (let1 syms (read-from-string "(foo-bar-baz foo-bar-baz)")
+         (and (eq? (car syms) (cadr syms))
+              (eq? (car syms) 'foo-bar-baz))))
+
+(let ()
+  (define (straddle pad item)
+    (call-with-output-file "test.o"
+      (^p (display (make-string pad #\space) p)
+          (display item p)
+          (display " end" p)))
+    (begin0 (call-with-input-file "test.o" (^p (list (read p) (read p))))
+      (sys-unlink "test.o")))
+  ;; The default buffer is 8K; put words and strings across it.
+  (dolist [pad '(8185 8188 8191 8192)]
+    (test* #"symbol across buffers (~pad)" '(abcdefghij end)
+           (straddle pad "abcdefghij"))
+    (test* #"number across buffers (~pad)" '(1234567890 end)
+           (straddle pad "1234567890"))
+    (test* #"string across buffers (~pad)" '("abc\ndef ghij" end)
+           (straddle pad "\"abc\\ndef ghij\""))))
+
 ;;-------------------------------------------------------------------
 (test-section "nested multi-line comments")
 
@@ -949,5 +1058,214 @@
                          (loop (read-char wrap) (cons ch r)))))))
               tdata)))
 
+;;-------------------------------------------------------------------
+(test-section "private ports")
+
+(test* "private input string port" '(#\a #\b "cd" #\e)
+       (let1 p (open-input-string "abcd\ne" :private? #t)
+         (list (read-char p) (peek-char p)
+               (begin (read-char p) (read-line p))
+               (read-char p))))
+
+(test* "private output string port" "ab12"
+       (let1 p (open-output-string :private? #t)
+         (write-char #\a p)
+         (display "b" p)
+         (write 12 p)
+         (get-output-string p)))
+
+(test* "port-make-private!" '(foo #\space bar)
+       (let1 p (open-input-string "foo bar")
+         (port-make-private! p)
+         (port-make-private! p)         ; idempotent
+         (list (read p) (read-char p)
+               (with-port-locking p (cut read p)))))
+
+(test* "port-make-private! on a closed port" (test-error)
+       (let1 p (open-input-string "foo")
+         (port-make-private! p)
+         (close-port p)
+         (read-char p)))
+
+;;-------------------------------------------------------------------
+(test-section "mapped file ports")
+
+(with-output-to-file "tmp1.o" (cut display "abc\ndef\r\nghi"))
+
+(test* "mapped port read" '("abc" #\d "ef" "ghi" #t)
+       (call-with-input-file "tmp1.o"
+         (^p (let* ([l1 (read-line p)]
+                    [c1 (read-char p)]
+                    [l2 (read-line p)]
+                    [l3 (read-line p)])
+               (list l1 c1 l2 l3 (eof-object? (read-byte p)))))
+         :mapped #t))
+
+(test* "mapped port seek" '(#\g 4 #\d 12)
+       (call-with-input-file "tmp1.o"
+         (^p (let* ([c1 (begin (port-seek p 9) (read-char p))]
+                    [c2 (begin (port-seek p 4) (port-tell p))]
+                    [c3 (read-char p)])
+               (list c1 c2 c3 (port-seek p 0 SEEK_END))))
+         :mapped #t))
+
+(test* "mapped port remaining input" '("def\r\nghi" #t "def\r\nghi" #\d)
+       (call-with-input-file "tmp1.o"
+         (^p (read-line p)
+             (let* ([b (get-remaining-input-bytes p)]
+                    [s (get-remaining-input-string p)])
+               (list (u8vector->string b)
+                     (uvector-immutable? b)
+                     s
+                     (read-char p))))
+         :mapped #t))
+
+(test* "mapped port (pushback)" "bc\ndef\r\nghi"
+       (call-with-input-file "tmp1.o"
+         (^p (read-char p) (peek-char p)
+             (u8vector->string (get-remaining-input-bytes p)))
+         :mapped #t))
+
+(with-output-to-file "tmp1.o" (cut display ""))
+(test* "mapped port (empty file)" '(#t 0)
+       (call-with-input-file "tmp1.o"
+         (^p (list (eof-object? (read-char p))
+                   (u8vector-length (get-remaining-input-bytes p))))
+         :mapped #t))
+(sys-unlink "tmp1.o")
+
+;;-------------------------------------------------------------------
+(test-section "copy-port between files")
+
+(let1 data (with-output-to-string
+             (^[] (dotimes [i 3000] (format #t "~5d\n" i))))
+  (with-output-to-file "tmp1.o" (cut display data))
+
+  (test* "copy-port (file to file)" `(18000 ,data)
+         (let1 n (call-with-input-file "tmp1.o"
+                   (^i (call-with-output-file "tmp2.o"
+                         (^o (copy-port i o)))))
+           (list n (call-with-input-file "tmp2.o" port->string))))
+
+  (test* "copy-port (file to file, buffered and pushed back)"
+         `(17991 ,(string-append "abc" (substring data 9 18000)))
+         (let1 n (call-with-input-file "tmp1.o"
+                   (^i (read-block 9 i)
+                       (peek-char i)
+                       (call-with-output-file "tmp2.o"
+                         (^o (display "abc" o)
+                             (copy-port i o)))))
+           (list n (call-with-input-file "tmp2.o" port->string))))
+
+  (test* "copy-port (file to file, size)" `(10000 ,(substring data 0 10000))
+         (let1 n (call-with-input-file "tmp1.o"
+                   (^i (call-with-output-file "tmp2.o"
+                         (^o (copy-port i o :unit 'byte :size 10000)))))
+           (list n (call-with-input-file "tmp2.o" port->string))))
+
+  (test* "copy-port (file to string port)" data
+         (call-with-input-file "tmp1.o" port->string))
+  )
+(sys-unlink "tmp1.o")
+(sys-unlink "tmp2.o")
+
+;;-------------------------------------------------------------------
+(test-section "binary serialization")
+
+(use gauche.record)
+
+(define (serial-round-trip obj . shared)
+  (call-with-input-string
+      (call-with-output-string (cut apply write-serialized obj <> shared))
+    read-serialized))
+
+(let ()
+  (define (t obj)
+    (test* (format "round trip ~s" obj) obj (serial-round-trip obj)))
+  (for-each t `(() #t #f 0 1 -1 ,(greatest-fixnum) ,(least-fixnum)
+                ,(expt 2 100) ,(- (expt 3 80)) 1/3 -22/7 1.5 -0.0 +inf.0
+                1+2i #\a #\x3bb "" "abc" "\x3bb;x" #*"ab\xff;" abc :key
+                (1 2 3) (1 . 2) (a (b (c . #(d "e"))) . f)
+                #() #(1 #(2) (3)) #u8(0 255) #s16(-1 2 -32768)
+                #u32(4294967295) #s64(-1) #f32(1.5 -2.0) #f64(0.1 1e300)
+                #f16(1.0 -0.5)))
+  (test* "eof" (eof-object) (serial-round-trip (eof-object)))
+  (test* "incomplete string" #t
+         (string-incomplete? (serial-round-trip #*"abc")))
+  (test* "uninterned symbol" '(#f "foo")
+         (let1 s (serial-round-trip (string->uninterned-symbol "foo"))
+           (list (symbol-interned? s) (symbol->string s))))
+  (test* "long list" (iota 100000) (serial-round-trip (iota 100000)))
+  (test* "without shared" '(1 "a" #(2)) (serial-round-trip '(1 "a" #(2)) #f))
+  )
+
+(test* "hash table" '(equal? ((1 . "one") ("two" . 2)))
+       (let* ([h (rlet1 h (make-hash-table 'equal?)
+                   (hash-table-put! h 1 "one")
+                   (hash-table-put! h "two" 2))]
+              [h2 (serial-round-trip h)])
+         (list (hash-table-type h2)
+               (list (assoc 1 (hash-table->alist h2))
+                     (assoc "two" (hash-table->alist h2))))))
+
+(test* "shared structure" #t
+       (let* ([s (string-copy "x")]
+              [r (serial-round-trip (list s s (vector s)))])
+         (and (eq? (car r) (cadr r))
+              (eq? (car r) (vector-ref (caddr r) 0)))))
+
+(test* "shared tail" #t
+       (let* ([tl (list 1 2)]
+              [r (serial-round-trip (list (cons 'a tl) (cons 'b tl)))])
+         (eq? (cdar r) (cdadr r))))
+
+(test* "circular list" '(1 2 3 1 2 3)
+       (let* ([l (list 1 2 3)]
+              [_ (set-cdr! (cddr l) l)]
+              [r (serial-round-trip l)])
+         (and (eq? r (cdddr r))
+              (take r 6))))
+
+(test* "circular vector" #t
+       (let* ([v (vector 1 #f)]
+              [_ (vector-set! v 1 v)]
+              [r (serial-round-trip v)])
+         (eq? r (vector-ref r 1))))
+
+(define-class <serial-point> ()
+  ((x :init-keyword :x)
+   (y :init-keyword :y)
+   (z)))
+(define-record-type serial-rec (make-serial-rec a b) serial-rec?
+  (a serial-rec-a)
+  (b serial-rec-b))
+
+(test* "instance" '(1 (2 3) #f)
+       (let1 p (serial-round-trip (make <serial-point> :x 1 :y '(2 3)))
+         (list (slot-ref p 'x) (slot-ref p 'y) (slot-bound? p 'z))))
+
+(test* "record" '(#t "a" #(b))
+       (let1 r (serial-round-trip (make-serial-rec "a" '#(b)))
+         (list (serial-rec? r) (serial-rec-a r) (serial-rec-b r))))
+
+(test* "multiple data" '((1 2) "x" #t)
+       (call-with-input-string
+           (call-with-output-string
+             (^o (write-serialized '(1 2) o)
+                 (write-serialized "x" o)))
+         (^i (let* ([a (read-serialized i)]
+                    [b (read-serialized i)])
+               (list a b (eof-object? (read-serialized i)))))))
+
+(test* "unserializable" (test-error)
+       (serial-round-trip (list car)))
+(test* "corrupted data" (test-error)
+       (call-with-input-string "(1 2 3)" read-serialized))
+(test* "truncated data" (test-error)
+       (let1 s (call-with-output-string (cut write-serialized "abcdef" <>))
+         (call-with-input-string
+             (u8vector->string (u8vector-copy (string->u8vector s) 0 8))
+           read-serialized)))
+
 (test-end)
 
@@ -229,6 +229,32 @@
            (loop (+ cnt 1) (list ls))
            (string-length (write-to-string ls)))))
 
+;; write skips the walk pass for small acyclic trees, and falls back to
+;; it when the tree is too big or too deep.  Make sure both give the
+;; same result, and cycles are still detected.
+(test* "write acyclic tree" "(a #(1 \"b\" (c . d)) #u8(1 2) . e)"
+       (write-to-string '(a #(1 "b" (c . d)) #u8(1 2) . e)))
+(test* "write shared acyclic tree" "((a b) (a b))"
+       (let1 x (list 'a 'b)
+         (write-to-string (list x x))))
+(test* "write circular list" "#0=(a b . #0#)"
+       (let1 x (list 'a 'b)
+         (set-cdr! (cdr x) x)
+         (write-to-string x)))
+(test* "write circular vector in a list" "(1 #0=#(2 #0#))"
+       (let1 v (vector 2 #f)
+         (vector-set! v 1 v)
+         (write-to-string (list 1 v))))
+(test* "write long list" 200000
+       (length (read-from-string (write-to-string (iota 200000)))))
+(test* "write long circular list" #t
+       (let1 x (iota 200000)
+         (set-cdr! (last-pair x) x)
+         (boolean (#/^#0=\(0 1 2 .* 199999 \. #0#\)$/ (write-to-string x)))))
+(test* "write with print-level" "(a (b #))"
+       (write-to-string '(a (b (c))) (cut write <> <>
+                                          (make-write-controls :print-level 2))))
+
 ;;---------------------------------------------------------------
 (test-section "format/ss")
 
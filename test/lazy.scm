@@ -254,6 +254,37 @@
 (test* "lrange" '(1.0 1.5 2.0 2.5) (lrange 1 3 0.5))
 (test* "lrange" '(3.0 2.5 2.0 1.5) (lrange 3 1 -0.5))
 
+;; chunked lazy sequences
+(test* "generator->chunked-lseq" '(0 1 2 3 4 5 6 7 8 9)
+       (generator->chunked-lseq (giota 10) 3))
+(test* "generator->chunked-lseq (exact multiple)" '(0 1 2 3 4 5)
+       (generator->chunked-lseq (giota 6) 3))
+(test* "generator->chunked-lseq (empty)" '()
+       (generator->chunked-lseq gnull 3))
+(test* "generator->chunked-lseq (chunk 1)" '(0 1 2)
+       (generator->chunked-lseq (giota 3) 1))
+(test* "generator->chunked-lseq (chunk granularity)" '(0 3)
+       (let* ([n 0]
+              [s (generator->chunked-lseq (^[] (rlet1 v n (inc! n))) 3)]
+              [n0 n])
+         (car s)
+         (cdr s)
+         (list (- n0 1) (- n 1))))
+(test* "generator->chunked-lseq (policy)" '(10 (0 1 2 4))
+       (let* ([sizes '()]
+              [s (generator->chunked-lseq (giota 10)
+                                          (^n (push! sizes n)
+                                              (if (= n 0) 1 (* n 2))))])
+         (list (length s) (reverse sizes))))
+(test* "generator->chunked-lseq (bad policy)" (test-error)
+       (length (generator->chunked-lseq (giota 10) (^n 'x))))
+(test* "generator->chunked-lseq (lazyness)" 0
+       (car (generator->chunked-lseq (gerr 5) 4)))
+(test* "generator->chunked-lseq (error)" (test-error)
+       (length (generator->chunked-lseq (gerr 5) 4)))
+(test* "liota (long)" 499500 (fold + 0 (liota 1000)))
+(test* "lrange (long)" '(990 995) (list-tail (lrange 0 1000 5) 198))
+
 ;; Interference with partial continuations
 (use gauche.partcont)
 (let ()
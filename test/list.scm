@@ -537,8 +537,29 @@
   (test* "equal? w/ car/cdr-cycle 4" #f
          (equal? (cdr-cycle (car-cycle 1 2 3))
                  (cdr-cycle (car-cycle 1 2 3) (car-cycle 1 2 3 1 2 3 1))))
+
+  (let ([v1 (vector 1 #f 2)]
+        [v2 (vector 1 #f 2)]
+        [v3 (vector 1 #f 3)])
+    (vector-set! v1 1 v1)
+    (vector-set! v2 1 (vector 1 v2 2))
+    (vector-set! v3 1 v3)
+    (test* "equal? w/ vector-cycle 1" #t (equal? v1 v2))
+    (test* "equal? w/ vector-cycle 2" #f (equal? v1 v3)))
   )
 
+;; equal? shouldn't consume C stack for deeply nested structures
+(let ()
+  (define (nest n tail)
+    (let loop ([n n] [r tail])
+      (if (zero? n) r (loop (- n 1) (list (vector r))))))
+  (test* "equal? deep nesting 1" #t
+         (equal? (nest 1000000 'x) (nest 1000000 'x)))
+  (test* "equal? deep nesting 2" #f
+         (equal? (nest 1000000 'x) (nest 1000000 'y)))
+  (test* "equal? deep nesting 3" #f
+         (equal? (nest 1000000 'x) (nest 999999 'x))))
+
 ;;--------------------------------------------------------------------------
 
 (test-section "monotonic-merge")
@@ -393,6 +393,62 @@
 
 ;; Load-path hook -----------------------------------
 
+(test-section "load path directory cache")
+
+(let ([find (with-module gauche.internal find-load-file)]
+      [dir #"~(sys-getcwd)/test.o/lp"])
+  (define (age! path secs)
+    (let1 t (- (sys-time) secs)
+      (sys-utime path t t)))
+  (define (found name)
+    (and-let* ([r (find name (list dir) '(".sld" ".scm"))])
+      (sys-basename (car r))))
+  (rmrf "test.o")
+  (sys-mkdir "test.o" #o777)
+  (sys-mkdir "test.o/lp" #o777)
+  (sys-mkdir "test.o/lp/sub" #o777)
+  (with-output-to-file "test.o/lp/a.scm" (^[] (print)))
+  (age! "test.o/lp" 100)
+  (age! "test.o/lp/sub" 100)
+
+  (test* "found" "a.scm" (found "a"))
+  (test* "not found" #f (found "b"))
+  (test* "not found in subdirectory" #f (found "sub/b"))
+  (test* "nonexistent subdirectory" #f (found "nosub/b"))
+  (test* "directory is not a file" #f (found "sub"))
+  (with-output-to-file "test.o/lp/b.scm" (^[] (print)))
+  (with-output-to-file "test.o/lp/sub/b.sld" (^[] (print)))
+  (age! "test.o/lp" 50)
+  (age! "test.o/lp/sub" 50)
+  (test* "added file found" "b.scm" (found "b"))
+  (test* "added file found in subdirectory" "b.sld" (found "sub/b"))
+  (sys-unlink "test.o/lp/b.scm")
+  (test* "removed file not found" #f (found "b"))
+  ((with-module gauche.internal %load-path-cache-clear!))
+  (test* "found after clearing cache" "a.scm" (found "a"))
+  (rmrf "test.o"))
+
+(test-section "lazy dynamic-load")
+
+(define-module lazy-dso-test
+  (export lazy-a lazy-b lazy-c))
+(with-module lazy-dso-test
+  (define lazy-b 'b)
+  (dynamic-load "no-such-dso" :lazy #t))
+
+(test* "lazy dynamic-load doesn't load immediately" #t
+       (with-module lazy-dso-test (eq? lazy-b 'b)))
+(test* "lazy dynamic-load loads on reference"
+       (test-error <error> #/no-such-dso/)
+       (with-module lazy-dso-test lazy-a))
+(test* "lazy dynamic-load with symbol list" 'b
+       (with-module lazy-dso-test
+         (dynamic-load "no-such-dso" :lazy '(lazy-b lazy-d))
+         lazy-b))
+(test* "lazy dynamic-load with symbol list"
+       (test-error <error> #/no-such-dso/)
+       (with-module lazy-dso-test lazy-d))
+
 (test-section "load-path hook")
 
 (define (dummy-load-path-hook archive relpath suffixes)
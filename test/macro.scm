@@ -467,6 +467,26 @@
 (test "qq1" '()  (lambda () (qq1 '())))
 (test "qq2" '#() (lambda () (qq2 '())))
 
+;; branches are filtered by the number of arguments before matching
+(define-syntax shape1 (syntax-rules ()
+                        ((_) 'zero)
+                        ((_ a) 'one)
+                        ((_ a b c ...) 'many)
+                        ((_ . r) 'dotted)))
+(test-macro "shape1" 'zero   (shape1))
+(test-macro "shape1" 'one    (shape1 x))
+(test-macro "shape1" 'many   (shape1 x y))
+(test-macro "shape1" 'many   (shape1 x y z w))
+(test-macro "shape1" 'dotted (shape1 x . y))
+(test-macro "shape1" 'dotted (shape1 x y z . w))
+
+;; the same identifier inserted twice must be renamed to the same one,
+;; including the literals.
+(define-syntax rename1 (syntax-rules (else)
+                         ((_ x) (let ((tmp x)) (cond (#f tmp) (else tmp))))))
+(test "rename1" 3 (lambda () (let ((tmp 5)) (rename1 3))))
+(test "rename1" 5 (lambda () (let ((tmp 5)) (rename1 tmp))))
+
 ;; R7RS style alternative ellipsis
 (test-section "alternative ellipsis")
 
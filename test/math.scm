@@ -3,6 +3,7 @@
 (use gauche.test)
 (use srfi-27)
 (use srfi-42)
+(use gauche.uvector)
 
 (test-start "math.* modules")
 
@@ -58,6 +59,36 @@
                    (loop (+ n 1))
                    `(disagreement at ,n with sample ,sample))))))))
 
+(test* "primes-in-range vs *primes*" (take-while (cut < <> 100000) *primes*)
+       (u64vector->list (primes-in-range -10 100000)))
+(test* "primes-in-range (empty)" '#u64() (primes-in-range 100 2))
+(test* "primes-in-range (beyond 2^64)" (test-error)
+       (primes-in-range 0 (+ (expt 2 64) 1)))
+
+;; The native routines for 64bit numbers vs. the generic ones
+(let ([source (make-random-source)]
+      [generic-test (with-module math.prime miller-rabin-test-generic)])
+  (random-source-pseudo-randomize! source 12 20)
+  (let1 rand (random-source-make-integers source)
+    (test* "miller-rabin (native vs generic)" '()
+           (filter-map (^_ (let1 n (+ (* 2 (rand (expt 2 62))) 3)
+                             (and (not (eq? (with-module math.prime
+                                              (miller-rabin-test 2 n))
+                                            (generic-test 2 n)))
+                                  n)))
+                       (iota 200)))))
+
+(test* "bpsw-prime? (64bit)" '(#t #f #t)
+       (map bpsw-prime? '(18446744073709551557
+                          3825123056546413051 ; strong psp up to base 23
+                          1000000000000000003)))
+
+(test* "mc-factorize (64bit semiprime)" '(4294967291 4294967279)
+       (reverse (mc-factorize (* 4294967291 4294967279))))
+
+(test* "parallel-factorize" '((2 2 3) (1000000007 1000000009) (3 3 3 11 13 37))
+       (parallel-factorize '(12 1000000016000000063 142857)))
+
 (let1 results
     ;;(a n jacobi)
     '((0    1    1)
@@ -518,4 +518,40 @@
 
 
 
+;;-------------------------------------------------------------------
+;; binding resolution cache
+;;  The results of searching imported/inherited modules are cached;
+;;  make sure operations that change visibility invalidate them.
+
+(define-module rescache-A (export x) (define x 'A))
+(define-module rescache-B (export x) (define x 'B))
+(define-module rescache-user (import rescache-A))
+
+(test* "resolution cache (import)" 'A
+       (global-variable-ref (find-module 'rescache-user) 'x #f))
+(test* "resolution cache (import)" 'B
+       (begin (eval '(import rescache-B) (find-module 'rescache-user))
+              (global-variable-ref (find-module 'rescache-user) 'x #f)))
+
+(define-module rescache-parent)
+(define-module rescache-child (extend rescache-parent))
+
+(test* "resolution cache (inherit)" #f
+       (global-variable-bound? (find-module 'rescache-child) 'y))
+(test* "resolution cache (inherit)" 'P
+       (begin (eval '(define y 'P) (find-module 'rescache-parent))
+              (global-variable-ref (find-module 'rescache-child) 'y #f)))
+(test* "resolution cache (extend)" #f
+       (begin (eval '(extend gauche) (find-module 'rescache-child))
+              (global-variable-bound? (find-module 'rescache-child) 'y)))
+
+(define-module rescache-phantom (export z))
+(define-module rescache-phantom-user (import rescache-phantom))
+
+(test* "resolution cache (phantom)" #f
+       (global-variable-bound? (find-module 'rescache-phantom-user) 'z))
+(test* "resolution cache (phantom)" 'Z
+       (begin (eval '(define z 'Z) (find-module 'rescache-phantom))
+              (global-variable-ref (find-module 'rescache-phantom-user) 'z #f)))
+
 (test-end)
@@ -317,6 +317,37 @@
        (list (= 0.0 (string->number "0e324"))
              (= 0.0 (string->number "0e325"))))
        
+;; Decimal notation without prefix takes a fast path, while "#d" prefix
+;; forces the generic reader.  They must agree.
+(let ()
+  (define (check s)
+    (test* #"fast decimal reader ~s" (string->number #"#d~s")
+           (string->number s) eqv?)
+    (test* #"fast decimal reader (read) ~s" (string->number s)
+           (read-from-string s) eqv?))
+  (for-each check
+            '("1e23" "8.41e21" "9007199254740993" "9007199254740993.0"
+              "9007199254740992.5" "-9007199254740993e-3"
+              "123456789012345678" "1234567890123456789"
+              "-1234567890123456789012" "0.1" "0.30000000000000004"
+              "2.2250738585072011e-308" "2.2250738585072014e-308"
+              "4.9406564584124654e-324" "1.7976931348623157e308"
+              "1.7976931348623159e308" "1e309" "-1e-400" "0e9999"
+              "-0.0" "7.2057594037927933e16" "1.00000000000000011102230246251565404236316680908203125"
+              "3.14159265358979323846" "6.02214076e23" "1.602176634e-19")))
+
+(let loop ([i 0] [seed 12345])
+  ;; LCG to produce pseudo-random digit strings
+  (define (next s) (modulo (+ (* s 1103515245) 12345) 2147483648))
+  (when (< i 2000)
+    (let* ([s1 (next seed)] [s2 (next s1)] [s3 (next s2)]
+           [str (format "~a.~ae~a" (quotient s1 1000) (* s2 s3)
+                        (- (modulo s3 640) 320))])
+      (unless (eqv? (string->number str) (string->number #"#d~str"))
+        (test* #"fast decimal reader ~str" (string->number #"#d~str")
+               (string->number str)))
+      (loop (+ i 1) s3))))
+
 ;; We used to allow 1#1 to be read as a symbol.  As of 0.9.4, it is an error.
 (test* "padding" '(10.0 #t) (flonum-test "1#"))
 (test* "padding" '(10.0 #t) (flonum-test "1#."))
@@ -366,6 +397,44 @@
 (test* "no integral part" -0.5 (read-from-string "-.5"))
 (test* "no integral part" 0.5 (read-from-string "+.5"))
 
+;;------------------------------------------------------------------
+(test-section "flonum writer")
+
+(let ()
+  (define (t str num)
+    (test* (format "flonum writer ~a" str) str (number->string num)))
+  (t "0.1" 0.1)
+  (t "0.3" 0.3)
+  (t "-0.3" -0.3)
+  (t "0.3333333333333333" (/ 1.0 3))
+  (t "100.0" 100.0)
+  (t "123.456" 123.456)
+  (t "0.001" 0.001)
+  (t "1.0e-4" 1.0e-4)
+  (t "1.2345678901e10" 12345678901.0)
+  (t "1.0e21" 1.0e21)
+  (t "1.0e23" 1.0e23)
+  (t "5.0e-324" (expt 2.0 -1074))
+  (t "2.2250738585072014e-308" (expt 2.0 -1022))
+  (t "1.7976931348623157e308" (string->number "1.7976931348623157e308"))
+  )
+
+;; Every flonum should be read back to the same value.  We use a simple
+;; LCG to pick values all over the range.
+(test* "flonum writer round trip" '()
+       (let loop ([i 0] [seed 12345] [bad '()])
+         (if (= i 20000)
+           bad
+           (let* ([seed (modulo (+ (* seed 6364136223846793005)
+                                   1442695040888963407)
+                                (expt 2 64))]
+                  [x (* (if (odd? seed) 1.0 -1.0)
+                        (ldexp (/ (+ (ash seed -12) 0.0) (expt 2 52))
+                               (- (modulo (ash seed -3) 2000) 1000)))]
+                  [s (number->string x)])
+             (loop (+ i 1) seed
+                   (if (eqv? x (string->number s)) bad (cons s bad)))))))
+
 ;;------------------------------------------------------------------
 (test-section "exact fractional number")
 
@@ -491,6 +560,40 @@
         "-340282366920938463463374607431768211457")
       (i-tester2 (exp2 127)))
 
+;; Long digit strings are converted by divide and conquer.  Check them
+;; against Horner's rule with 9-digit chunks.
+(let ()
+  (define (horner str)
+    (let loop ([i 0] [acc 0])
+      (if (>= i (string-length str))
+        acc
+        (let1 j (min (string-length str) (+ i 9))
+          (loop j (+ (* acc (expt 10 (- j i)))
+                     (string->number (substring str i j))))))))
+  (define (check name str)
+    (let1 x (horner str)
+      (test* #"big integer reader ~name" x (string->number str))
+      (test* #"big integer writer ~name" str (number->string x))
+      (test* #"big integer writer ~name (negative)" (string-append "-" str)
+             (number->string (- x)))))
+  (check "digits" (apply string-append (make-list 3000 "1234567890")))
+  (check "zeros" (string-append "1" (make-string 40000 #\0)))
+  (check "inner zeros"
+         (string-append "7" (make-string 20000 #\0) "3" (make-string 9999 #\0)
+                        "1" (make-string 15000 #\0) "9"))
+  (check "nines" (make-string 36000 #\9)))
+
+(test* "big integer radix conversion" '(#t #t #t #t #t)
+       (let1 x (- (ash 1 100003) (ash 12345 70000) 1)
+         (map (^r (= x (string->number (number->string x r) r)))
+              '(2 3 10 16 36))))
+(test* "big integer writer power of two"
+       (string-append "1" (make-string 10000 #\0))
+       (number->string (ash 1 40000) 16))
+(test* "big integer reader with fraction" (+ (ash 1 20000) 1/2)
+       (string->number
+        (string-append "#e" (number->string (ash 1 20000)) ".5")))
+
 ;;==================================================================
 ;; Conversions
 ;;
@@ -1273,6 +1376,42 @@
            173462447179147555430258970864309778377421844723664084649347019061363579192879108857591038330408837177983810868451546421940712978306134189864280826014542758708589243873685563973118948869399158545506611147420216132557017260564139394366945793220968665108959685482705388072645828554151936401912464931182546092879815733057795573358504982279280090942872567591518912118622751714319229788100979251036035496917279912663527358783236647193154777091427745377038294584918917590325110939381322486044298573971650711059244462177542540706913047034664643603491382441723306598834177
            ))
 
+;; Large operands go through Karatsuba and Toom-3.  Check them against
+;; the sum of products of small pieces, which only uses schoolbook method.
+(let ()
+  (define (pieces n)
+    (let loop ([n n] [k 0] [r '()])
+      (if (zero? n)
+        r
+        (loop (ash n -1000) (+ k 1000) (acons k (logand n (- (ash 1 1000) 1)) r)))))
+  (define (piecewise-mul x y)
+    (apply + (append-map (^p (map (^q (ash (* (cdr p) (cdr q)) (+ (car p) (car q))))
+                                  (pieces y)))
+                         (pieces x))))
+  (define (rand-big nbits seed)
+    ;; deterministic pseudo random number of NBITS bits
+    (let loop ([n 1] [s seed])
+      (if (>= (integer-length n) nbits)
+        n
+        (let1 s (modulo (+ (* s 6364136223846793005) 1442695040888963407)
+                        18446744073709551616)
+          (loop (+ (ash n 61) (ash s -3)) s)))))
+  (define (check a-bits b-bits seed)
+    (let ([a (rand-big a-bits seed)]
+          [b (rand-big b-bits (+ seed 1))])
+      (test* #"big multiplication ~|a-bits|x~|b-bits|"
+             (list (piecewise-mul a b) (- (piecewise-mul a b)) 0)
+             (list (* a b) (* (- a) b) (- (* a b) (* b a))))))
+  (check 3000 2500 1)
+  (check 10000 9000 2)
+  (check 14000 13999 3)
+  (check 30000 24000 4)
+  (check 40000 40000 5)
+  (check 50000 3000 6)
+  (check 60000 25000 7)
+  (test* "big multiplication all ones" (- (ash 1 80000) (ash 1 40001) -1)
+         (let1 x (- (ash 1 40000) 1) (* x x))))
+
 ;;------------------------------------------------------------------
 (test-section "multiplication short cuts")
 
@@ -1610,6 +1749,48 @@
   (do-exactness 7 9)
   )
 
+;; Large divisors use recursive division.
+(let ()
+  (define (rand-big nbits seed)
+    (let loop ([n 1] [s seed])
+      (if (>= (integer-length n) nbits)
+        n
+        (let1 s (modulo (+ (* s 6364136223846793005) 1442695040888963407)
+                        18446744073709551616)
+          (loop (+ (ash n 61) (ash s -3)) s)))))
+  (define (check a-bits b-bits seed)
+    (let ([a (rand-big a-bits seed)]
+          [b (rand-big b-bits (+ seed 1))])
+      (test* #"big quotient&remainder ~|a-bits|/~|b-bits|" '(#t #t #t)
+             (receive (q r) (quotient&remainder a b)
+               (list (= a (+ (* q b) r))
+                     (<= 0 r)
+                     (< r b))))
+      (test* #"big quotient&remainder ~|a-bits|/~|b-bits| exact" '(#t 0)
+             (let1 c (rand-big (- b-bits 7) (+ seed 2))
+               (receive (q r) (quotient&remainder (+ (* a b) c) b)
+                 (list (= q a) (- r c)))))))
+  (check 30000 15000 10)
+  (check 60000 20000 11)
+  (check 80000 40000 12)
+  (check 100000 31000 13)
+  (test* "big quotient&remainder all ones" (list (+ (ash 1 30000) 1) 0)
+         (receive (q r) (quotient&remainder (- (ash 1 60000) 1)
+                                            (- (ash 1 30000) 1))
+           (list q r))))
+
+(let ([g (* (ash 1 70) 3 (expt 7 40))])
+  (test* "gcd bignum" g
+         (gcd (* g (expt 11 30)) (* g 32 (expt 13 30))))
+  (test* "gcd bignum (negative)" g
+         (gcd (- (* g (expt 11 30))) (* g (expt 13 30))))
+  (test* "gcd bignum (coprime)" 1
+         (gcd (expt 11 300) (- (expt 13 200))))
+  (test* "gcd bignum (multiple)" (expt 13 200)
+         (gcd (expt 13 200) (* (expt 13 200) (expt 17 100))))
+  (test* "ratnum normalization" (/ (expt 11 30) (expt 13 30))
+         (/ (* g (expt 11 30)) (* g (expt 13 30)))))
+
 ;;------------------------------------------------------------------
 (test-section "div and mod")
 
@@ -2307,6 +2488,32 @@
   (test* "probit(0.975)" 1.959964 (probit 0.975) ~=)
   )
 
+;; Mutable local variables keep flonums in the cell of their box.
+;; Make sure the values taken out of the variable aren't affected by
+;; later assignments.
+(let ()
+  (define (accum xs)
+    (let ([acc 0.0] [hist '()])
+      (for-each (^x (set! acc (+ acc x)) (push! hist acc)) xs)
+      (cons acc hist)))
+  (define (counter)
+    (let ([n 0.5])
+      (^[] (set! n (* n 2.0)) n)))
+  (test* "flonum in mutable local" '(6.0 6.0 3.0 1.0)
+         (accum '(1.0 2.0 3.0)))
+  (test* "flonum in mutable local (mixed)" '(6.0 6.0 3.0 1)
+         (accum '(1 2.0 3.0)))
+  (test* "flonum in mutable local (closure)" '(1.0 2.0 4.0)
+         (let* ([c (counter)] [a (c)] [b (c)] [d (c)])
+           (list a b d)))
+  (test* "flonum in mutable local (vector)" '#(1.0 3.0 6.0)
+         (let ([v (make-vector 3)] [acc 0.0])
+           (dotimes [i 3]
+             (set! acc (+ acc i 1.0))
+             (vector-set! v i acc))
+           v))
+  )
+
 ;;------------------------------------------------------------------
 (test-section "arithmetic operation overload")
 
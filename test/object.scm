@@ -133,6 +133,26 @@
 (test* "make <r> :a" '(9 5) (slot-values r2))
 (test* "make <r> :a :b" '(20 100) (slot-values r3))
 
+;; make skips the generic protocol unless initialize or allocate-instance
+;; is customized; adding a method later must take effect.
+(define-class <r-fast> ()
+  ((a :init-keyword :a :init-form (list 'a))
+   (b :init-keyword :b :init-value 'b)
+   (c)))
+
+(test* "make <r-fast>" '((a) b #f)
+       (let1 r (make <r-fast>)
+         (list (slot-ref r 'a) (slot-ref r 'b) (slot-bound? r 'c))))
+(test* "make <r-fast> :b :a" '(1 2)
+       (let1 r (make <r-fast> :b 2 :a 1 :b 3)
+         (list (slot-ref r 'a) (slot-ref r 'b))))
+(define-method initialize ((obj <r-fast>) initargs)
+  (next-method)
+  (slot-set! obj 'c 'init))
+(test* "make <r-fast> w/ initialize method" '(init 1)
+       (let1 r (make <r-fast> :a 1)
+         (list (slot-ref r 'c) (slot-ref r 'a))))
+
 ;;----------------------------------------------------------------
 (test-section "slot allocations")
 
@@ -241,6 +261,30 @@
               (list (slot-bound? s5 'v)
                     (slot-ref s5 'v))))
 
+;; The accessor lookup is cached by (class, slot name); make sure
+;; the same slot name in different classes and positions is not confused.
+(define-class <slot-cache-a> () ((x :init-value 'ax) (y :init-value 'ay)))
+(define-class <slot-cache-b> () ((y :init-value 'by) (x :init-value 'bx)))
+(define-class <slot-cache-c> (<slot-cache-b>) ((z :init-value 'cz)))
+
+(test* "slot accessor cache" '(ax ay by bx by bx cz)
+       (let ([a (make <slot-cache-a>)]
+             [b (make <slot-cache-b>)]
+             [c (make <slot-cache-c>)])
+         (dotimes [i 3]
+           (slot-ref a 'x) (slot-ref b 'x) (slot-ref c 'x))
+         (map (^[o s] (slot-ref o s))
+              (list a a b b c c c)
+              '(x y y x y x z))))
+
+(test* "slot accessor cache (set!)" '(1 bx 2)
+       (let ([a (make <slot-cache-a>)]
+             [b (make <slot-cache-b>)]
+             [c (make <slot-cache-c>)])
+         (slot-set! a 'x 1)
+         (slot-set! c 'x 2)
+         (list (slot-ref a 'x) (slot-ref b 'x) (slot-ref c 'x))))
+
 ;;----------------------------------------------------------------
 (test-section "next method")
 
@@ -288,6 +332,61 @@
 (test* "method sorting" 2 (ms-1 "a" "a"))
 (test* "method sorting" 1 (ms-1 "a"))
 
+;;----------------------------------------------------------------
+(test-section "dispatch cache")
+
+;; The sorted method list is cached per generic function.  Make sure
+;; the cache is invalidated properly.
+(define-class <dc-a> () ())
+(define-class <dc-b> (<dc-a>) ())
+
+(define-method dc-1 ((x <dc-a>)) 'a)
+(define-method dc-1 ((x <dc-a>) (y <dc-a>)) 'aa)
+
+(test* "dispatch cache" '(a a aa aa)
+       (list (dc-1 (make <dc-a>)) (dc-1 (make <dc-b>))
+             (dc-1 (make <dc-a>) (make <dc-b>))
+             (dc-1 (make <dc-b>) (make <dc-b>))))
+
+(define-method dc-1 ((x <dc-b>)) (list 'b (next-method)))
+(define-method dc-1 ((x <dc-b>) (y <dc-b>)) 'bb)
+
+(test* "dispatch cache (after add-method)" '(a (b a) aa bb)
+       (list (dc-1 (make <dc-a>)) (dc-1 (make <dc-b>))
+             (dc-1 (make <dc-a>) (make <dc-b>))
+             (dc-1 (make <dc-b>) (make <dc-b>))))
+
+(delete-method! dc-1 (find (^m (equal? (map class-name
+                                            (slot-ref m 'specializers))
+                                       '(<dc-b> <dc-b>)))
+                           (slot-ref dc-1 'methods)))
+
+(test* "dispatch cache (after delete-method)" '(a (b a) aa aa)
+       (list (dc-1 (make <dc-a>)) (dc-1 (make <dc-b>))
+             (dc-1 (make <dc-a>) (make <dc-b>))
+             (dc-1 (make <dc-b>) (make <dc-b>))))
+
+(define-method dc-1 ((x <dc-a>)) 'a2)
+
+(test* "dispatch cache (after replacing method)" '(a2 (b a2))
+       (list (dc-1 (make <dc-a>)) (dc-1 (make <dc-b>))))
+
+(test* "dispatch cache (apply)" '((b a2) aa)
+       (list (apply dc-1 (list (make <dc-b>)))
+             (apply dc-1 (make <dc-b>) (list (make <dc-a>)))))
+
+(define-class <dc-c> (<dc-a>) ())
+(define-method dc-2 ((x <dc-a>)) 'a)
+(define-method dc-2 ((x <dc-c>)) (list 'c (next-method)))
+
+(test* "dispatch cache (before class redefinition)" '(c a)
+       (dc-2 (make <dc-c>)))
+
+(define-class <dc-c> () ())
+
+(test* "dispatch cache (class redefinition)" (test-error)
+       (dc-2 (make <dc-c>)))
+
 
 ;;----------------------------------------------------------------
 (test-section "setter method definition")
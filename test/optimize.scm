@@ -41,6 +41,32 @@
 (test* "inlining add4 + constant folding" '(((CONSTI 9)) ((RET)))
        (proc->insn/split (^[] (+ (add4 2) 3))))
 
+;; Keyword arguments with literal keywords skip the runtime scan
+(define-inline (kw-add a :key (x 1) (y 2)) (+ a x y))
+(define-inline (kw-list a :key (x a) ((:why y) (* x 2)) z) (list a x y z))
+
+(test* "keyword core + constant folding" '(((CONSTI 16)) ((RET)))
+       (proc->insn/split (^[] (kw-add 10 :y 5))))
+(test* "keyword core, no keywords" '(((CONSTI 13)) ((RET)))
+       (proc->insn/split (^[] (kw-add 10))))
+(test* "keyword core, defaults" '(1 3 6 #t)
+       (let1 r (kw-list 1 :x 3)
+         (list (car r) (cadr r) (caddr r) (undefined? (cadddr r)))))
+(test* "keyword core, explicit key" '(1 1 5 z)
+       (kw-list 1 :why 5 :z 'z))
+(test* "keyword core, duplicate keys" 7
+       (kw-add 0 :x 1 :x 5))
+(test* "keyword core, evaluation order" '(x y)
+       (let1 r '()
+         (kw-add 0 :y (begin (push! r 'y) 1) :x (begin (push! r 'x) 2))
+         r))
+(test* "keyword core, non-literal keyword" 6
+       (let1 k :x (kw-add 1 k 3)))
+(test* "keyword core, unknown keyword" (test-error)
+       (kw-add 1 :w 3))
+(test* "keyword core, as a value" '(4 13)
+       (map (cut apply kw-add <>) '((1) (1 :x 10))))
+
 (test-section "lambda lifting")
 
 ;; bug reported by teppey
@@ -64,6 +90,37 @@
 (test* "constant closure identity" #t
        (eq? (make-constant-closure) (make-constant-closure)))
 
+(test-section "profile-guided inlining")
+
+;; A procedure listed in the inline hints gets a guarded inliner, and
+;; its calls from other modules are inlined while the binding is intact.
+((with-module gauche.internal %set-auto-inline-hints!)
+ '((pgi.callee pgi-second 1000)))
+
+(define-module pgi.callee
+  (export pgi-second)
+  (define (pgi-second v) (vector-ref v 1)))
+
+(define-module pgi.caller
+  (import pgi.callee)
+  (export pgi-test)
+  (define (pgi-test v) (pgi-second v))
+  (define (pgi-test-args) (pgi-second (vector 'x (list 'y) 'z))))
+
+((with-module gauche.internal %set-auto-inline-hints!) #f)
+
+(test* "guarded inlining" 'b ((with-module pgi.caller pgi-test) '#(a b c)))
+(test* "guarded inlining (inlined)" #t
+       (pair? (filter-insn (with-module pgi.caller pgi-test) 'VEC-REFI)))
+(test* "guarded inlining (args)" '(y)
+       ((with-module pgi.caller pgi-test-args)))
+(with-module pgi.callee
+  (set! pgi-second (^v (vector-ref v 2))))
+(test* "guarded inlining (redefined)" 'c
+       ((with-module pgi.caller pgi-test) '#(a b c)))
+(test* "guarded inlining (redefined, args)" 'z
+       ((with-module pgi.caller pgi-test-args)))
+
 (test-section "transformation")
 
 ;; pass2 intermediate lref elimination
@@ -138,5 +195,59 @@
            (test (bar)))
          (foo)))
 
+(test-section "fixnum specialization")
+
+(define (has-insn? proc rx)
+  (any (^i (rx (symbol->string (caar i)))) (proc->insn/split proc)))
+
+(define (vsum v)
+  (let loop ([i 0] [s 0])
+    (if (< i (vector-length v))
+      (loop (+ i 1) (+ s (vector-ref v i)))
+      s)))
+
+(define (vsquare! v)
+  (let1 n (vector-length v)
+    (do ([i 0 (+ i 1)])
+        [(= i n) v]
+      (vector-set! v i (* i i)))))
+
+(test* "guarded by <" '(#t #t #f)
+       (list (has-insn? vsum #/FXADDI/)
+             (has-insn? vsum #/^VEC-REF-NC$/)
+             (has-insn? vsum #/NUMADDI/)))
+(test* "guarded by < (result)" 15 (vsum #(1 2 3 4 5)))
+(test* "guarded by =" '(#t #t)
+       (list (has-insn? vsquare! #/FXADDI/)
+             (has-insn? vsquare! #/^VEC-SET-NC$/)))
+(test* "guarded by = (result)" '#(0 1 4 9) (vsquare! (make-vector 4)))
+
+(test* "unknown bound" '(#f #t)
+       (let1 p (^n (let loop ([i 0]) (if (< i n) (loop (+ i 1)) i)))
+         (list (has-insn? p #/FXADDI/) (has-insn? p #/NUMADDI/))))
+(test* "= with unknown bound" #f
+       (has-insn? (^[v n] (do ([i 0 (+ i 1)]) [(= i n)] (vector-set! v i 0)))
+                  #/FXADDI|VEC-SET-NC/))
+(test* "= with initial value beyond bound" #f
+       (has-insn? (^[] (let loop ([i 10]) (if (= i 5) i (loop (+ i 1)))))
+                  #/FXADDI/))
+(test* "other vector is checked" (test-error)
+       (let ([v (make-vector 5 0)] [w (make-vector 3 0)])
+         (let loop ([i 0])
+           (when (< i (vector-length v))
+             (vector-ref w i)
+             (loop (+ i 1))))))
+
+(test-section "compact constants")
+
+(test* "#t in insn word" '(((CONSTT-RET)))
+       (proc->insn/split (^[] #t)))
+(test* "#t in insn word, pushed" '(((CONSTT-PUSH)) ((CONSTC 97)))
+       (take (proc->insn/split (^[] (list #t #\a))) 2))
+(test* "char in insn word" '(((CONSTC 955)) ((RET)))
+       (proc->insn/split (^[] #\x3bb)))
+(test* "char in insn word, values" '(#t #\a #\x3bb #\x10ffff)
+       ((^[] (list #t #\a #\x3bb #\x10ffff))))
+
 (test-end)
 
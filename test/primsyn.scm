@@ -435,6 +435,37 @@
                        (error "zz"))
                     (interaction-environment)))))
 
+;; for-each and map with a literal lambda are expanded into local loops.
+(prim-test "inlined for-each" '(3 2 1)
+           (lambda ()
+             (let ([r '()])
+               (for-each (lambda (x) (set! r (cons x r))) '(1 2 3))
+               r)))
+(prim-test "inlined map" '(2 4 6)
+           (lambda () (map (lambda (x) (* x 2)) '(1 2 3))))
+(prim-test "inlined map (empty)" '()
+           (lambda () (map (lambda (x) (* x 2)) '())))
+(prim-test "inlined map (escaping closures)" '(1 2 3)
+           (lambda ()
+             (map (lambda (p) (p))
+                  (map (lambda (x) (lambda () x)) '(1 2 3)))))
+(prim-test "inlined for-each (improper list)" 'error
+           (lambda ()
+             (with-error-handler
+                 (lambda (e) 'error)
+               (lambda () (for-each (lambda (x) x) '(1 2 . 3))))))
+(prim-test "inlined map (improper list)" 'error
+           (lambda ()
+             (with-error-handler
+                 (lambda (e) 'error)
+               (lambda () (map (lambda (x) x) '(1 2 . 3))))))
+(prim-test "inlined for-each (argument evaluated once)" '(1 (a b))
+           (lambda ()
+             (let ([n 0] [r '()])
+               (for-each (lambda (x) (set! r (cons x r)))
+                         (begin (set! n (+ n 1)) '(b a)))
+               (list n r))))
+
 ;;----------------------------------------------------------------
 (test-section "optimized frames")
 
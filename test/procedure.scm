@@ -25,6 +25,26 @@
        ((with-module gauche.internal %apply-rec)
         (lambda (a b c d e f) (list a b c d e f 'c)) 'x 'y 'z 'w 'u 'v))
 
+;; Simple subrs are called directly, without entering VM
+(test* "apply-rec2 (subr)" '(#t #f)
+       (list ((with-module gauche.internal %apply-rec2) < 1 2)
+             ((with-module gauche.internal %apply-rec2) < 2 1)))
+(test* "apply-rec (subr, rest args)" '(#t #f)
+       (list ((with-module gauche.internal %apply-rec) < 1 2 3 4 5 6)
+             ((with-module gauche.internal %apply-rec) < 1 2 3 5 4 6)))
+(test* "apply-rec1 (subr)" 'b
+       ((with-module gauche.internal %apply-rec1) cadr '(a b)))
+(test* "apply-rec1 (subr, error)" 'caught
+       (guard (e [(<error> e) 'caught])
+         ((with-module gauche.internal %apply-rec1) cadr 1)))
+(test* "apply-rec2 (subr, wrong number of args)" (test-error)
+       ((with-module gauche.internal %apply-rec2) cadr '(a b) '(c d)))
+(test* "sort with subr comparator" '(1 2 3 4 5)
+       (sort '(3 5 1 4 2) <))
+(test* "sort with subr comparator (error)" 'caught
+       (guard (e [(<error> e) 'caught])
+         (sort '(3 5 a 4 2) <)))
+
 ;;-------------------------------------------------------------------
 (test-section "combinatorial programming utilities")
 
@@ -955,4 +955,170 @@
                                               (seq #\a #\b)))
                         "abc"))
 
+;;-------------------------------------------------------------------------
+(test-section "lazy DFA")
+
+;; Regexps without backreferences or lookaround are prescreened by
+;; the DFA, which also finds where the match begins.  The result must
+;; be the same as the backtracking matcher alone.
+
+;; This takes exponential time with the backtracker alone.
+(test* "exponential pattern (no match)" #f
+       (rxmatch #/(a|aa)*c/ (make-string 40 #\a)))
+(test-re #/(a|aa)*c/ "aaaaac" '("aaaaac" "a"))
+(test-re #/x(a|aa)*c/ "aaxaaac" '("xaaac" "a"))
+
+;; The match that begins first wins, even if another one ends first.
+(test-re #/abcd|c/ "xabcd" '("abcd"))
+(test-re #/a.*b|c/ "zacb" '("acb"))
+(test-re #/a+?b/ "caaab" '("aaab"))
+(test-re #/(?i:ab+c)/ "xxABbC" '("ABbC"))
+(test-re #/x*/ "" '(""))
+(test-re #/a|$/ "bbb" '(""))
+(test-re #/[^a]b/ "aabcb" '("cb"))
+
+(test* "multibyte" (string #\u3044 #\u3044 #\u3046)
+       (rxmatch->string (string->regexp "\u3044+\u3046")
+                        (string #\u3042 #\u3044 #\u3044 #\u3046 #\a)))
+(test* "multibyte" #f
+       (rxmatch (string->regexp "\u3044+\u3046")
+                (string #\u3042 #\u3044 #\u3044 #\a)))
+
+;; DFA of this pattern has too many states; we fall back to backtracking.
+(let1 s (string-append (make-string 20 #\b) "a" (make-string 9 #\b))
+  (test* "too many states" s
+         (rxmatch->string #/(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)/
+                          s))
+  (test* "too many states" #f
+         (rxmatch #/(a|b)*a(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)(a|b)/
+                  (make-string 30 #\b))))
+
+(test-section "required literal")
+
+;; A literal every match contains is searched first.  If it begins
+;; the match, we try only where it occurs.
+
+(test-re #/GET \/api\/([a-z]+)/ "POST /api/x GET /api/users"
+         '("GET /api/users" "users"))
+(test-re #/GET \/api\/([a-z]+)/ "GET /apix GET /api" '())
+(test-re #/[0-9]+ ERROR:/ "12 WARN: 34 ERROR: x" '("34 ERROR:"))
+(test-re #/(?:ab)+cd/ "ababcab abcd" '("abcd"))
+(test-re #/a(?=bc)bcd|x/ "abcabcd" '("abcd"))
+(test-re #/ab\bcd|ab/ "xab" '("ab"))
+(test-re #/(?i:a-b)/ "xA-B" '("A-B"))
+(test-re #/(?i:a-b)/ "xA+B" '())
+(test-re #/x(?:aa|ab)y/ "xaby" '("xaby"))
+(test-re #/abc/ "ab" '())
+(test-re #/bc/ "abababc" '("bc"))
+(test-re #/ana/ "bananas" '("ana"))
+(test* "multibyte literal" (string #\u3044 #\u3046 #\a)
+       (rxmatch->string (string->regexp "\u3044\u3046.")
+                        (string #\u3042 #\u3044 #\u3042 #\u3044 #\u3046 #\a)))
+(let1 s (string-append (make-string 1000 #\a) "needle")
+  (test* "long input" "aneedle" (rxmatch->string #/[a-z]needle/ s))
+  (test* "long input" #f (rxmatch #/[a-z]needles/ s)))
+
+(test-section "regexp set")
+
+(let1 rs (make-regexp-set '(#/^GET / #/\/api\/(\w+)/ "admin" #/[0-9]+/
+                            #/(?i:ADMIN)/ #/api/))
+  (test* "regexp-set?" #t (regexp-set? rs))
+  (test* "regexp-set?" #f (regexp-set? #/a/))
+  (test* "regexp-set-regexps" 6 (length (regexp-set-regexps rs)))
+  (test* "regexp-set-matches" '(0 1 5) (regexp-set-matches rs "GET /api/users"))
+  (test* "regexp-set-matches" '(2 3 4) (regexp-set-matches rs "POST admin 42"))
+  (test* "regexp-set-matches" '(4) (regexp-set-matches rs "ADMIN"))
+  (test* "regexp-set-matches" '(5) (regexp-set-matches rs "/api/"))
+  (test* "regexp-set-matches" '() (regexp-set-matches rs "")))
+
+(let* ([words (map (cut format "word~a" <>) (iota 300))]
+       [rs (make-regexp-set (map (cut string-append "\\b" <> "\\b") words))])
+  (test* "many regexps" '(7 250)
+         (regexp-set-matches rs "x word250 word7 word30x"))
+  (test* "many regexps" '() (regexp-set-matches rs "no words here")))
+
+(test* "empty set" '() (regexp-set-matches (make-regexp-set '()) "abc"))
+(test* "bad element" (test-error) (make-regexp-set '(#/a/ 1)))
+
+(test-section "matching a range and bytes")
+
+(let1 s "foo bar foo baz"
+  (test* "start" '(8 11) (let1 m (rxmatch #/foo/ s 1)
+                           (list (rxmatch-start m) (rxmatch-end m))))
+  (test* "start" "bar foo baz" (rxmatch-after (rxmatch #/foo/ s)))
+  (test* "start" "foo bar " (rxmatch-before (rxmatch #/foo/ s 1)))
+  (test* "start, ^" #f (rxmatch #/^foo/ s 1))
+  (test* "start, lookbehind" 8 (rxmatch-start (rxmatch #/(?<= )foo/ s 1)))
+  (test* "end" #f (rxmatch #/baz/ s 0 14))
+  (test* "end, $" "foo" (rxmatch-substring (rxmatch #/fo+$/ s 0 11)))
+  (test* "range" (test-error) (rxmatch #/foo/ s 3 100))
+  (test* "successive matches" '(0 8)
+         (let loop ([pos 0] [r '()])
+           (if-let1 m (rxmatch #/foo/ s pos)
+             (loop (rxmatch-end m) (cons (rxmatch-start m) r))
+             (reverse r)))))
+
+;; "foo bar foo"
+(let1 v '#u8(102 111 111 32 98 97 114 32 102 111 111)
+  (test* "u8vector" '(4 7 "bar")
+         (let1 m (rxmatch #/b\w+/ v)
+           (list (rxmatch-start m) (rxmatch-end m) (rxmatch-substring m))))
+  (test* "u8vector" "foo" (rxmatch-after (rxmatch #/bar /  v)))
+  (test* "u8vector, start" 8 (rxmatch-start (rxmatch #/foo/ v 1)))
+  (test* "u8vector" #f (rxmatch #/baz/ v)))
+;; "a" + the first byte of "あ"
+(test* "u8vector, incomplete" (test-error) (rxmatch #/a/ '#u8(97 227)))
+(test* "u8vector, incomplete" 0 (rxmatch-start (rxmatch #/a/ '#u8(97 227) 0 1)))
+
+;;-------------------------------------------------------------------------
+(test-section "pathological patterns")
+
+;; These take exponential time without memoization.
+(let1 s (string-append (make-string 200 #\a) "xc")
+  (test* "memoized" #f (rxmatch #/(?=a)(a|aa)*c/ s))
+  (test* "memoized" #f (rxmatch #/(?!b)(?:a|aa)*\bc/ s))
+  (test* "memoized" '(200 202)
+         (let1 m (rxmatch #/(?=a)(a|aa)*y|xc/ s)
+           (list (rxmatch-start m) (rxmatch-end m)))))
+
+(let1 s (string-append (make-string 50 #\a) "xc")
+  (test* "step limit" (test-error)
+         (parameterize ([regexp-match-step-limit 100000])
+           (rxmatch #/^(a|aa)*\1c/ s)))
+  (test* "step limit" "aab"
+         (parameterize ([regexp-match-step-limit 100000])
+           (rxmatch-substring (rxmatch #/^(a|aa)*\1b/ "aab"))))
+  (test* "step limit" #f (regexp-match-step-limit)))
+
+;;-------------------------------------------------------------------------
+(test-section "regexp cache")
+
+(define (cache-stat key) (cadr (assq key (regexp-cache-stats))))
+
+(let* ([pat (string-copy "ab+c")]
+       [rx (string->regexp pat)])
+  (test* "cache hit" #t
+         (let1 hits (cache-stat :hits)
+           (and (eq? rx (string->regexp (string-copy "ab+c")))
+                (= (cache-stat :hits) (+ hits 1)))))
+  (test* "cache, case-fold" #f
+         (eq? rx (string->regexp "ab+c" :case-fold #t)))
+  (test* "cache, case-fold" "ABBC"
+         (rxmatch-substring ((string->regexp "ab+c" :case-fold #t) "xABBC")))
+  ;; the key is copied, so mutating the pattern doesn't affect the cache
+  (string-set! pat 0 #\x)
+  (test* "cache, mutated pattern" "xbc"
+         (rxmatch-substring ((string->regexp pat) "abc xbc")))
+  (test* "cache, rxmatch" "abbc" (rxmatch-substring (rxmatch "ab+c" "abbc"))))
+
+(test* "cache, error" (test-error) (string->regexp "a("))
+(test* "cache, error" (test-error) (string->regexp "a("))
+
+(test* "cache, eviction" #t
+       (let1 max (cache-stat :max-size)
+         (dotimes [i (+ max 10)]
+           (string->regexp (format "pat~a" i)))
+         (and (= (cache-stat :size) max)
+              (>= (cache-stat :evictions) 10))))
+
 (test-end)
@@ -0,0 +1,97 @@
+;; test gauche.net.resolver
+
+(use gauche.test)
+(use gauche.net)
+(use gauche.selector)
+
+(test-start "resolver")
+(use gauche.net.resolver)
+(test-module 'gauche.net.resolver)
+
+(define (cache-size r)
+  (hash-table-num-entries (slot-ref r 'cache)))
+
+(define (addr-ports addrs) (map sockaddr-port addrs))
+
+(let1 r (make-resolver)
+  (test* "lookup" '(8080) (addr-ports (resolver-lookup r "127.0.0.1" 8080)))
+  (test* "cached" '(1 (8080))
+         (list (cache-size r)
+               (addr-ports (resolver-lookup r "127.0.0.1" 8080))))
+  (test* "failure" (test-error)
+         (resolver-lookup r "127.0.0.1" "no-such-service-for-test"))
+  (test* "failure cached" 2 (cache-size r))
+  (test* "flush host" 0
+         (begin (resolver-flush! r "127.0.0.1") (cache-size r)))
+  (resolver-lookup r "127.0.0.1" 8080)
+  (test* "flush all" 0 (begin (resolver-flush! r) (cache-size r))))
+
+(test* "no caching" 0
+       (let1 r (make-resolver :ttl 0)
+         (resolver-lookup r "127.0.0.1" 8080)
+         (cache-size r)))
+
+(test* "expiration" 0
+       (let1 r (make-resolver :ttl 0.01)
+         (resolver-lookup r "127.0.0.1" 8080)
+         (sys-nanosleep #e2e7)
+         ((with-module gauche.net.resolver cache-ref) r '("127.0.0.1" 8080 tcp))
+         (cache-size r)))
+
+(cond-expand
+ [(and gauche.sys.threads gauche.sys.select (not gauche.os.windows))
+  (use gauche.threads)
+  (use data.queue)
+
+  (test* "async" '(8081)
+         (let ([r (make-resolver)]
+               [q (make-mtqueue)])
+           (resolver-lookup-async r "127.0.0.1" 8081 (cut enqueue! q <>))
+           (addr-ports (dequeue/wait! q 5))))
+
+  (test* "async failure" #t
+         (let ([r (make-resolver)]
+               [q (make-mtqueue)])
+           (resolver-lookup-async r "127.0.0.1" "no-such-service-for-test"
+                                  (cut enqueue! q <>))
+           (condition? (dequeue/wait! q 5))))
+
+  (test* "async with selector" '((8082) (8082) #t)
+         (let ([r (make-resolver)]
+               [sel (make <selector>)]
+               [results '()])
+           (dotimes [i 2]
+             (resolver-lookup-async r "127.0.0.1" 8082
+                                    (^[addrs]
+                                      (push! results
+                                             (list (addr-ports addrs)
+                                                   (current-thread))))
+                                    :selector sel))
+           (let loop ([n 0])
+             (when (and (< (length results) 2) (< n 50))
+               (selector-select sel 100000)
+               (loop (+ n 1))))
+           (list (car (car results))
+                 (car (cadr results))
+                 (every (^p (eq? (cadr p) (current-thread))) results))))]
+ [else])
+
+(test* "connect" #t
+       (let* ([server (make-server-socket 'inet 0 :reuse-addr? #t)]
+              [port (sockaddr-port (socket-address server))]
+              [r (make-resolver)]
+              [s (resolver-connect r "127.0.0.1" port)])
+         (begin0 (is-a? s <socket>)
+           (socket-close s)
+           (socket-close server))))
+
+(test* "connect failure flushes" '(#t 0)
+       (let* ([server (make-server-socket 'inet 0 :reuse-addr? #t)]
+              [port (sockaddr-port (socket-address server))]
+              [r (make-resolver)])
+         (socket-close server)
+         (list (guard (e [(<system-error> e) #t])
+                 (resolver-connect r "127.0.0.1" port))
+               (cache-size r))))
+
+(test-end)
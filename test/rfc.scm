@@ -80,6 +80,25 @@
 (test* "url-safe encode" "YTA-YTA_" (base64-encode-string "a0>a0?" :url-safe #t))
 (test* "url-safe decode" "a0>a0?" (base64-decode-string "YTA-YTA_" :url-safe #t))
 
+(test* "encode bytevector" "AP+AYQ==" (base64-encode-bytevector '#u8(0 255 128 97)))
+(test* "decode bytevector" '#u8(0 255 128 97)
+       (base64-decode-bytevector "AP+AYQ=="))
+(test* "decode bytevector (url-safe)" '#u8(251 255 191)
+       (base64-decode-bytevector "-_-_" :url-safe #t))
+(let* ([src (with-output-to-string
+              (^[] (dotimes [i 3000] (write-char (integer->char (modulo (* i 7) 128))))))]
+       [enc (base64-encode-string src)])
+  (test* "long input round trip" src (base64-decode-string enc))
+  (test* "long input line width" #t
+         (every (^l (<= (string-length l) 76))
+                (string-split enc #\newline)))
+  (test* "long input port" enc
+         (with-output-to-string
+           (^[] (with-input-from-string src base64-encode))))
+  (test* "long input port decode" src
+         (with-output-to-string
+           (^[] (with-input-from-string enc base64-decode)))))
+
 ;;--------------------------------------------------------------------
 (test-section "rfc.quoted-printable")
 (use rfc.quoted-printable)
@@ -128,6 +147,18 @@
 (test* "decode (robustness)"
        "foo=1qr =  j\r\n"
        (quoted-printable-decode-string "foo=1qr =  j\r\n="))
+(test* "encode bytevector" "a=00=FF=0D=0A"
+       (quoted-printable-encode-bytevector '#u8(97 0 255 13 10) :binary #t))
+(test* "decode bytevector" '#u8(97 0 255 13 10)
+       (quoted-printable-decode-bytevector "a=00=FF\r\n"))
+(let1 src (with-output-to-string
+            (^[] (dotimes [i 2000] (write-char (integer->char (modulo i 128))))))
+  (test* "long input round trip" src
+         (quoted-printable-decode-string
+          (quoted-printable-encode-string src :binary #t)))
+  (test* "long input port" (quoted-printable-encode-string src)
+         (with-output-to-string
+           (^[] (with-input-from-string src quoted-printable-encode)))))
 
 
 ;;--------------------------------------------------------------------
@@ -268,6 +299,22 @@
 (test* "decode" "a%y"  (uri-decode-string "a%y"))
 (test* "decode" "a%ay" (uri-decode-string "a%ay"))
 (test* "decode" ""     (uri-decode-string ""))
+(when (eq? (gauche-character-encoding) 'utf-8)
+  (test* "decode (multibyte)" "\u3042b" (uri-decode-string "%E3%81%82b"))
+  (test* "encode (multibyte)" "%E3%81%82b" (uri-encode-string "\u3042b")))
+(let* ([src (with-output-to-string
+              (^[] (dotimes [i 2000] (format #t "~d %+&=?" i))))]
+       [enc (uri-encode-string src)])
+  (test* "encode (port)" enc
+         (with-output-to-string
+           (^[] (with-input-from-string src uri-encode))))
+  (test* "decode (port)" src
+         (with-output-to-string
+           (^[] (with-input-from-string enc uri-decode))))
+  (test* "decode (port, cgi)" (regexp-replace-all #/\+/ src " ")
+         (with-output-to-string
+           (^[] (with-input-from-string src
+                  (cut uri-decode :cgi-decode #t))))))
 
 (test* "uri-scheme&specific" '("http" "//practical-scheme.net/gauche/")
        (receive r
@@ -330,6 +377,12 @@
        (receive r (uri-decompose-authority "[::1]") r))
 (test* "uri-decompose-authority" '(#f "::1" "8080")
        (receive r (uri-decompose-authority "[::1]:8080") r))
+(test* "uri-decompose-authority" '("a" "b@c" "1")
+       (receive r (uri-decompose-authority "a@b@c:1") r))
+(test* "uri-decompose-authority" '("a@b" "::1" "80")
+       (receive r (uri-decompose-authority "a@b@[::1]:80") r))
+(test* "uri-decompose-authority" '(#f #f #f)
+       (receive r (uri-decompose-authority "a:b:c") r))
 (test* "uri-decompose-authority" '("foo:bar" "::1" #f)
        (receive r (uri-decompose-authority "foo:bar@[::1]") r))
 
@@ -526,10 +579,17 @@
 
     (define (http-server socket)
       (let loop ()
-        (let* ([client (socket-accept socket)]
-               [in  (socket-input-port client)]
-               [out (socket-output-port client)]
-               [request-line (read-line in)])
+        (serve-client (socket-accept socket) 1)
+        (loop)))
+
+    ;; COUNT is the number of requests served on this connection so far,
+    ;; which /keepalive replies, keeping the connection open.
+    (define (serve-client client count)
+      (let* ([in  (socket-input-port client)]
+             [out (socket-output-port client)]
+             [request-line (read-line in)])
+        (if (eof-object? request-line)
+          (socket-close client)
           (rxmatch-if (#/^(\S+) (\S+) HTTP\/1\.1$/ request-line)
               (#f method request-uri)
             (let* ([headers (rfc822-read-headers in)]
@@ -542,17 +602,24 @@
                [(equal? request-uri "/exit")
                 (socket-close client)
                 (sys-exit 0)]
-               [(hash-table-get %predefined-contents request-uri #f)
-                => (cut for-each (cut display <> out) <>)]
+               [(equal? request-uri "/keepalive")
+                (let1 n (number->string count)
+                  (format out "HTTP/1.1 200 OK\nContent-Length: ~a\n\n~a"
+                          (string-size n) n)
+                  (flush out)
+                  (serve-client client (+ count 1)))]
                [else
-                (display "HTTP/1.x 200 OK\nContent-Type: text/plain\n\n" out)
-                (write `(("method" ,method)
-                         ("request-uri" ,request-uri)
-                         ("request-body" ,(string-incomplete->complete body))
-                         ,@headers)
-                       out)])
-              (socket-close client)
-              (loop))
+                (cond
+                 [(hash-table-get %predefined-contents request-uri #f)
+                  => (cut for-each (cut display <> out) <>)]
+                 [else
+                  (display "HTTP/1.x 200 OK\nContent-Type: text/plain\n\n" out)
+                  (write `(("method" ,method)
+                           ("request-uri" ,request-uri)
+                           ("request-body" ,(string-incomplete->complete body))
+                           ,@headers)
+                         out)])
+                (socket-close client)]))
             (error "malformed request line:" request-line)))))
 
     (define (main args)
@@ -755,6 +822,35 @@
                        '(("a" "b") ("c" "d")))))
   )
 
+(let ([host #"localhost:~*http-port*"]
+      [pool (make-http-connection-pool)])
+  (define (count . opts)
+    (values-ref (apply http-get host "/keepalive" opts) 2))
+  (test* "http-get (no pool)" '("1" "1")
+         (let* ([a (count)] [b (count)]) (list a b)))
+  (parameterize ([http-connection-pool pool])
+    (test* "http-get (pooled)" '("1" "2" "3")
+           (let* ([a (count)] [b (count)] [c (count)]) (list a b c)))
+    ;; the server closes the connection after this reply, so the pool
+    ;; must not keep it.
+    (test* "http-get (pooled, closed by server)" '("/get" "1")
+           (let* ([r (receive (code headers body) (http-get host "/get")
+                       (car (assoc-ref (read-from-string body)
+                                       "request-uri")))]
+                  [a (count)])
+             (list r a)))
+    (test* "http-get (pooled, pool cleared)" '("2" "1")
+           (let* ([a (count)]
+                  [_ (http-connection-pool-clear! pool)]
+                  [b (count)])
+             (list a b))))
+  (http-connection-pool-clear! pool)
+  (test* "http-get (:pool, max-per-host 0)" '("1" "1")
+         (let* ([p (make-http-connection-pool :max-per-host 0)]
+                [a (count :pool p)]
+                [b (count :pool p)])
+           (list a b))))
+
 (test* "<http-error>" #t
        (guard (e (else (is-a? e <http-error>)))
          (http-request 'GET #"localhost:~*http-port*" "/exit")))
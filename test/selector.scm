@@ -97,4 +97,17 @@
          (selector-select *sel* 0)
          (list *x* *y*)))
 
+(cond-expand
+ [(not gauche.os.windows)
+  (test* "selector-add-signals!" (list SIGUSR1)
+         (let* ([sel (make <selector>)]
+                [got '()]
+                [fd (selector-add-signals! sel SIGUSR1 (^s (push! got s)))])
+           (sys-kill (sys-getpid) SIGUSR1)
+           (selector-select sel 1000000)
+           (selector-delete! sel fd #f #f)
+           (sys-close-signal-fd fd)
+           got))]
+ [else])
+
 (test-end)
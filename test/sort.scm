@@ -127,6 +127,93 @@
            '("bbb" "CCC" "AAA" "aaa" "BBB" "ccc")
            '("CCC" "ccc" "bbb" "BBB" "AAA" "aaa"))
 
+;; larger inputs, to go through runs, merges and partitions
+
+(let ()
+  (define (iota-vec n) (list->vector (iota n)))
+  (define (shuffle-vec v seed)
+    ;; deterministic shuffle by a linear congruential sequence
+    (let ([n (vector-length v)])
+      (do ([i (- n 1) (- i 1)]
+           [r seed (modulo (+ (* r 1103515245) 12345) 2147483648)])
+          [(<= i 0) v]
+        (let* ([j (modulo r (+ i 1))]
+               [t (vector-ref v i)])
+          (vector-set! v i (vector-ref v j))
+          (vector-set! v j t)))))
+  (define inputs
+    `(("sorted"   ,(iota-vec 1000))
+      ("reversed" ,(list->vector (reverse (iota 1000))))
+      ("shuffled" ,(shuffle-vec (iota-vec 1000) 7))
+      ("two runs" ,(vector-append (iota-vec 500) (iota-vec 500)))
+      ("nearly sorted"
+       ,(rlet1 v (iota-vec 1000)
+          (do ([i 0 (+ i 97)]) [(>= i 990)]
+            (let1 t (vector-ref v i)
+              (vector-set! v i (vector-ref v (+ i 5)))
+              (vector-set! v (+ i 5) t)))))
+      ("few keys" ,(vector-map (cut modulo <> 3) (shuffle-vec (iota-vec 1000) 3)))))
+
+  (dolist (in inputs)
+    (let* ([name (car in)]
+           [v (cadr in)]
+           [expected (sort (vector->list v) <)])  ; via TimSort
+      (test* #"sort (~name)" expected (vector->list (sort v)))
+      (test* #"sort! (~name)" expected (sort! (vector->list v)))
+      (test* #"stable-sort (~name)" expected (vector->list (stable-sort v)))
+      (test* #"stable-sort default-comparator (~name)" expected
+             (stable-sort (vector->list v) default-comparator))
+      (test* #"sort flonum (~name)" (map exact->inexact expected)
+             (vector->list (sort (vector-map exact->inexact v))))
+      (test* #"sort string (~name)"
+             (sort (map number->string expected) string<?)
+             (sort (map number->string (vector->list v))))
+      (test* #"sort > (~name)" (reverse expected)
+             (vector->list (sort (vector-copy v) >)))
+      (test* #"sorted? (~name)" #t
+             (sorted? (sort (map (^x (cons x x)) (vector->list v))
+                            (^[a b] (< (car a) (car b))))
+                      (^[a b] (< (car a) (car b)))))))
+
+  ;; stability, with a lot of duplicates
+  (let* ([src (map (^[x i] (cons (modulo x 5) i))
+                   (vector->list (shuffle-vec (iota-vec 500) 11))
+                   (iota 500))]
+         [res (stable-sort src (^[a b] (< (car a) (car b))))])
+    (test* "stable-sort stability (many)" #t
+           (every (^[a b] (or (< (car a) (car b))
+                              (and (= (car a) (car b)) (< (cdr a) (cdr b)))))
+                  res (cdr res))))
+
+  ;; an error escaping from the comparator doesn't lose elements
+  (let ([v (shuffle-vec (iota-vec 200) 5)]
+        [count 0])
+    (test* "error in cmp" (test-error)
+           (stable-sort! v (^[a b]
+                             (inc! count)
+                             (when (= count 500) (error "boo"))
+                             (< a b))))
+    (test* "error in cmp - elements kept" (iota 200)
+           (sort (vector->list v))))
+  )
+
+;; Comparators whose order is the same as 'compare' are sorted natively
+(let* ([v (shuffle-vec (iota-vec 300) 7)]
+       [strs (map number->string (vector->list v))]
+       [expected-strs (sort strs string<?)])
+  (test* "sort string-comparator" expected-strs
+         (sort strs string-comparator))
+  (test* "stable-sort! string-comparator" expected-strs
+         (vector->list (stable-sort! (list->vector strs) string-comparator)))
+  (test* "sort srfi-128 string comparator" expected-strs
+         (sort strs (make-comparator string? string=? string<? default-hash)))
+  (test* "sort exact-integer-comparator" (iota 300)
+         (vector->list (sort v exact-integer-comparator)))
+  (test* "sort string-comparator - type check" (test-error)
+         (sort '("a" b "c") string-comparator))
+  (test* "sort custom comparator" (reverse expected-strs)
+         (sort strs (make-comparator string? string=? string>? #f))))
+
 (test-section "sort-by")
 
 (define (sort-by-nocmp key . in&exps)
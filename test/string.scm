@@ -386,6 +386,38 @@
 (test* "substring" #*"ab"
        (substring #*"abcde" 0 2))
 
+;;-------------------------------------------------------------------
+(test-section "long concatenation")
+
+;; Repeated string-append of long strings builds rope bodies internally.
+;; They must be indistinguishable from flat strings.
+(let* ([piece (string-copy "abc\u3042def")]
+       [expected (with-output-to-string
+                   (^[] (dotimes [i 500] (display i) (display piece))))]
+       [built (let loop ([i 0] [s ""])
+                (if (= i 500)
+                  s
+                  (loop (+ i 1) (string-append s (number->string i) piece))))]
+       [prepended (let loop ([i 499] [s ""])
+                    (if (< i 0)
+                      s
+                      (loop (- i 1) (string-append (number->string i) piece s))))])
+  (string-set! piece 0 #\Z)
+  (test* "append" expected built)
+  (test* "prepend" expected prepended)
+  (test* "length" (string-length expected) (string-length built))
+  (test* "ref" (map (cut string-ref expected <>) '(0 1000 2000 4000))
+         (map (cut string-ref built <>) '(0 1000 2000 4000)))
+  (test* "substring" (substring expected 1234 2345)
+         (substring built 1234 2345))
+  (test* "display" expected
+         (with-output-to-string (^[] (display built))))
+  (test* "write" (write-to-string expected) (write-to-string built))
+  (test* "append of appended" (string-append expected expected)
+         (string-append built prepended))
+  (test* "incomplete" #t
+         (string-incomplete? (string-append built #*"\xff" built))))
+
 ;;-------------------------------------------------------------------
 (test-section "string-pointer")
 
@@ -621,6 +653,63 @@
                    (* *dstr-init-size* (+ *dstr-incr-factor* 1))
                    )
 
+(test* "reset-output-string!" '("abc" "" "de" "xyz")
+       (let* ([out (open-output-string)]
+              [a (begin (display "abc" out) (get-output-string out))]
+              [b (begin (reset-output-string! out) (get-output-string out))]
+              [c (begin (display "de" out) (get-output-string out))])
+         (reset-output-string! out)
+         (display "xyz" out)
+         (list a b c (get-output-string out))))
+
+;; The reset port reuses its chunks; make sure stale content in them
+;; doesn't show up.
+(test* "reset-output-string! (reuse chunks)" #t
+       (let1 out (open-output-string)
+         (every (^n (let1 s (make-string n (integer->char (+ 65 (modulo n 26))))
+                      (reset-output-string! out)
+                      (display s out)
+                      (string=? s (get-output-string out))))
+                '(10000 50 3000 20000 1 0 9000))))
+
+;; A port with initial capacity, and a reset port, keep the content in
+;; one chunk; with-output-to-string hands such a chunk to the result.
+(test* "open-output-string :initial-capacity" #t
+       (every (^n (let ([out (open-output-string :initial-capacity 1000)]
+                        [s (make-string n #\z)])
+                    (display s out)
+                    (string=? s (get-output-string out))))
+              '(0 1 999 1000 1001 5000)))
+(test* "open-output-string :initial-capacity" (test-error)
+       (open-output-string :initial-capacity -1))
+(test* "reset-output-string! (contiguous)" '("abc" "xyz")
+       (let* ([out (open-output-string)]
+              [a (begin (display (make-string 500 #\a) out)
+                        (reset-output-string! out)
+                        (display "abc" out)
+                        (get-output-string out))])
+         (reset-output-string! out)
+         (display "xyz" out)
+         (list a (get-output-string out))))
+(test* "with-output-to-string (handoff)" #t
+       (every (^n (let* ([s (make-string n #\q)]
+                         [r1 (with-output-to-string (^[] (display s)))]
+                         [r2 (with-output-to-string (^[] (display "x")))])
+                    (and (string=? s r1) (string=? "x" r2))))
+              '(40 100 300 1000 10000)))
+
+;; with-output-to-string recycles the chunks for later string ports.
+(test* "with-output-to-string (recycle)" #t
+       (every (^n (let1 s (make-string n (integer->char (+ 97 (modulo n 26))))
+                    (and (string=? s (with-output-to-string (^[] (display s))))
+                         (string=? (string-append s s)
+                                   (with-output-to-string
+                                     (^[] (display s)
+                                          (display
+                                           (with-output-to-string
+                                             (^[] (display s))))))))))
+              '(20000 100 5000 40000 7 9000 300)))
+
 ;;-------------------------------------------------------------------
 (test-section "string interpolation")
 
@@ -638,4 +727,30 @@
           (if a "inter" "polation"))
         #"string ~(x #t)~(x #f)"))
 
+(test* "string interpolation (types)" "n=-42 x=2.5 b=12345678901234567890 c=Z s=sym l=(1 2)"
+       (let ([n -42] [x 2.5] [b 12345678901234567890] [c #\Z] [s 'sym]
+             [l '(1 2)])
+         #"n=~|n| x=~|x| b=~|b| c=~|c| s=~|s| l=~|l|"))
+(test* "string interpolation (fixnum bounds)"
+       (string-append (number->string (greatest-fixnum)) " "
+                      (number->string (least-fixnum)))
+       (let ([a (greatest-fixnum)] [b (least-fixnum)]) #"~|a| ~b"))
+(test* "string interpolation (single expr)" "5" (let ([n 5]) #"~n"))
+(test* "string interpolation (empty)" "" #"")
+(test* "string interpolation (long)" (make-string 3000 #\a)
+       (let ([s (make-string 1000 #\a)]) #"~|s|~|s|~|s|"))
+(test* "string interpolation (incomplete)" #t
+       (let ([s #*"\xff"]) (string-incomplete? #"a~|s|b")))
+(define-class <interp-test> () ())
+(define-method x->string ((obj <interp-test>)) "foo")
+(test* "string interpolation (x->string method)" "<<foo>>"
+       (let ([o (make <interp-test>)]) #"<<~|o|>>"))
+(test* "display-interpolated" "n=3, c=Z, s=sym ~"
+       (let ([n 3] [c #\Z] [s 'sym])
+         (call-with-output-string
+           (^p (display-interpolated "n=~|n|, c=~|c|, s=~|s| ~~" p)))))
+(test* "display-interpolated (current port)" "1+1=2"
+       (with-output-to-string
+         (^[] (display-interpolated "1+1=~(+ 1 1)"))))
+
 (test-end)
@@ -301,6 +301,43 @@
          (sys-rename "test.dir/xyzzy" "test.dir/zzZzz")
          (sort (sys-readdir "test.dir"))))
 
+(sys-mkdir "test.dir/sub" #o755)
+(with-output-to-file "test.dir/sub/a" (cut display "abc"))
+
+(test* "sys-opendir, sys-readdir-entry" '(("." . directory) (".." . directory)
+                                          ("sub" . directory)
+                                          ("zzZzz" . regular))
+       (let1 d (sys-opendir "test.dir")
+         (let loop ([r '()])
+           (receive (name type) (sys-readdir-entry d)
+             (if (eof-object? name)
+               (begin (sys-closedir d) (sort r string<? car))
+               ;; type can be #f if the filesystem doesn't tell
+               (loop (acons name
+                            (or type (~ (sys-dir-stat d name) 'type))
+                            r)))))))
+
+(test* "sys-opendir (relative to parent)" '("a" regular 3)
+       (let* ([d (sys-opendir "test.dir")]
+              [sub (sys-opendir "sub" d)]
+              [names (let loop ([r '()])
+                       (let1 n (sys-readdir-entry sub)
+                         (cond [(eof-object? n) r]
+                               [(member n '("." "..")) (loop r)]
+                               [else (loop (cons n r))])))]
+              [st (sys-dir-stat sub "a")])
+         (sys-closedir sub)
+         (sys-closedir d)
+         (list (car names) (~ st'type) (~ st'size))))
+
+(test* "sys-readdir-entry (closed)" (test-error)
+       (let1 d (sys-opendir "test.dir")
+         (sys-closedir d)
+         (sys-readdir-entry d)))
+
+(sys-unlink "test.dir/sub/a")
+(sys-rmdir "test.dir/sub")
+
 (test* "truncate" "abcdefghijklmno"
        (begin
          (sys-truncate "test.dir/zzZzz" 15)
@@ -413,6 +450,20 @@
          (set! (ref t'nanosecond) 4)
          t))
 
+(test* "monotonic-nanoseconds" '(#t #t)
+       (let* ([t0 (monotonic-nanoseconds)]
+              [_ (sys-nanosleep 1000000)]
+              [t1 (monotonic-nanoseconds)])
+         (list (exact-integer? t0) (>= (- t1 t0) 1000000))))
+(test* "cycle-counter" '(#t #t)
+       (let* ([c0 (cycle-counter)]
+              [_ (sys-nanosleep 1000000)]
+              [c1 (cycle-counter)]
+              [f (cycle-counter-frequency)])
+         (list (fixnum? c0)
+               ;; should be at least about 1ms
+               (> (/ (- c1 c0) f) 0.0005))))
+
 ;;-------------------------------------------------------------------
 (test-section "stat")
 
@@ -441,6 +492,26 @@
                      (sys-stat->file-type s)
                      (sys-stat->size s))))))
 
+  (test* "sys-stat-batch" '((regular 5) #f (regular 5))
+         (map (^s (and s (list (sys-stat->file-type s) (sys-stat->size s))))
+              (vector->list
+               (sys-stat-batch '("test.dir" "test.dir.none" "test.dir")))))
+
+  (test* "sys-stat-batch (many)" '(100 50)
+         (let1 v (sys-stat-batch (list->vector
+                                  (map (^i (if (even? i)
+                                             "test.dir"
+                                             "test.dir.none"))
+                                       (iota 100)))
+                                 :threads 4)
+           (list (vector-length v) (count identity (vector->list v)))))
+
+  (test* "sys-stat-batch (bad)" (test-error) (sys-stat-batch '(1)))
+
+  (test* "sys-read-file-batch" '(#u8(48 49 50 51 52) #f #u8(48 49 50 51 52))
+         (vector->list
+          (sys-read-file-batch #("test.dir" "test.dir.none" "test.dir"))))
+
   (sys-unlink "test.dir")
   (sys-mkdir "test.dir" #o700)
 
@@ -523,6 +594,32 @@
            (close-output-port out)
            r)))
 
+(test* "pipe and cork" '(#f #f #t "ab")
+       (receive (in out) (sys-pipe :buffering :line)
+         (port-cork! out)
+         (display "a\n" out)
+         (let1 f1 (char-ready? in)
+           (display "b\n" out)
+           (let1 f2 (char-ready? in)
+             (port-uncork! out)
+             (let1 f3 (char-ready? in)
+               (let1 r (string-append (read-line in) (read-line in))
+                 (close-input-port in) (close-output-port out)
+                 (list f1 f2 f3 r)))))))
+
+;; data overflowing the buffer is written together with the buffered one
+(test* "pipe and large write" '(20003 #t)
+       (receive (in out) (sys-pipe :buffering :full)
+         (let1 body (make-string 20000 #\z)
+           (display "abc" out)
+           (display body out)
+           (let1 f (char-ready? in)
+             (flush out)
+             (let1 r (read-block 20003 in)
+               (close-input-port in) (close-output-port out)
+               (list (string-size r)
+                     (and f (equal? r (string-append "abc" body)))))))))
+
 ;;-------------------------------------------------------------------
 (test-section "fork&exec")
 
@@ -622,6 +719,29 @@
                  (sys-waitpid pid)
                  #t)))))
 
+  ;; sys-fork-and-exec uses posix_spawn if possible; the results must be
+  ;; the same as the fork path.
+  (let ()
+    (define (run spawn)
+      (receive (in out) (sys-pipe)
+        (let1 pid (sys-fork-and-exec "sh" '("sh" "-c" "pwd; echo err >&2")
+                                     :iomap `((1 . ,out) (2 . ,out))
+                                     :directory "/"
+                                     :spawn spawn)
+          (close-port out)
+          (begin0 (list (read-line in) (read-line in) (read-line in))
+            (sys-waitpid pid)))))
+    (test* "fork and exec (spawn)" `("/" "err" ,(eof-object)) (run #t))
+    (test* "fork and exec (no spawn)" `("/" "err" ,(eof-object)) (run #f)))
+
+  (test* "fork and exec (nonexistent command)" #t
+         (let1 pid (sys-fork-and-exec "no-such-command-for-gauche-test"
+                                      '("no-such-command-for-gauche-test")
+                                      :iomap `((2 . ,(open-output-file
+                                                      "/dev/null"))))
+           (receive (p status) (sys-waitpid pid)
+             (not (zero? (sys-wait-exit-status status))))))
+
   ;; Testing fork&exec and detached process
   ;; NB: these tests assume we're running the testing gosh in the
   ;; current directory.
@@ -761,6 +881,42 @@
   ]
  [else]) ; cond-expand gauche.sys.select
 
+(cond-expand
+ [gauche.sys.poller
+  (test* "sys-poller" '(() ((r)) ((w)) ())
+         (receive (in out) (sys-pipe)
+           (let* ([poller (make-sys-poller)]
+                  [r0 (begin (sys-poller-set! poller in '(r))
+                             (sys-poller-wait poller 0))]
+                  [r1 (begin (display "x" out) (flush out)
+                             (map cdr (sys-poller-wait poller 0)))]
+                  [r2 (begin (sys-poller-set! poller out '(w))
+                             (sys-poller-set! poller in '())
+                             (map cdr (sys-poller-wait poller 0)))]
+                  [r3 (begin (sys-poller-set! poller out '())
+                             (sys-poller-wait poller 0))])
+             (sys-poller-close poller)
+             (close-port in) (close-port out)
+             (list r0 r1 r2 r3))))
+  (test* "sys-poller (closed)" (test-error)
+         (let1 poller (make-sys-poller)
+           (sys-poller-close poller)
+           (sys-poller-wait poller 0)))
+  ;; The poll(2) backend doesn't support edge-triggered mode.
+  (and-let1 poller (guard (e [else #f]) (make-sys-poller :edge-triggered #t))
+    (test* "sys-poller (edge-triggered)" '(((r)) () ((r)))
+           (receive (in out) (sys-pipe)
+             (sys-poller-set! poller in '(r))
+             (let* ([r0 (begin (display "x" out) (flush out)
+                               (map cdr (sys-poller-wait poller 0)))]
+                    [r1 (sys-poller-wait poller 0)] ; not drained, no edge
+                    [r2 (begin (display "y" out) (flush out)
+                               (map cdr (sys-poller-wait poller 0)))])
+               (sys-poller-close poller)
+               (close-port in) (close-port out)
+               (list r0 r1 r2)))))]
+ [else])
+
 ;;-------------------------------------------------------------------
 (test-section "signal handling")
 
@@ -930,6 +1086,27 @@
       )]
    [else]);; !cygwin
 
+  ;; signal fd
+  (let ()
+    (define fd (sys-signal-fd (list SIGUSR1 SIGUSR2)))
+    (test* "sys-read-signal-fd (nothing)" '() (sys-read-signal-fd fd))
+    (test* "sys-signal-fd" (list SIGUSR1 SIGUSR2)
+           (begin
+             (sys-kill (sys-getpid) SIGUSR1)
+             (sys-kill (sys-getpid) SIGUSR2)
+             (sort (sys-read-signal-fd fd))))
+    (test* "sys-signal-fd (busy)" (test-error)
+           (sys-signal-fd SIGUSR1))
+    (test* "sys-read-signal-fd (bad fd)" (test-error)
+           (sys-read-signal-fd 0))
+    (sys-close-signal-fd fd)
+    (test* "sys-close-signal-fd" SIGUSR1
+           (call/cc
+            (^k (with-signal-handlers ((SIGUSR1 => k))
+                  (^[] (sys-kill (sys-getpid) SIGUSR1)
+                       (sys-nanosleep 100000000)
+                       0))))))
+
   ;; sys-sigwait
   (cond-expand
    [(and gauche.sys.sigwait
@@ -969,5 +1146,218 @@
   ] 
  [else]) ; gauche.os.windows
 
+;;-------------------------------------------------------------------
+(test-section "vm statistics")
+
+(let ()
+  (define (fact n) (if (= n 0) 1 (* n (fact (- n 1)))))
+  (define (stat key) (hash-table-get (vm-stats) key))
+  (vm-reset-stats!)
+  (vm-collect-stats! #t)
+  (fact 10)
+  (call/cc (^k (k 1)))
+  (fact 10)
+  (vm-collect-stats! #f)
+  (test* "collecting" #f (stat 'collecting))
+  (test* "calls" #t (> (stat 'calls) 10))
+  (test* "continuation-captures" #t (>= (stat 'continuation-captures) 1))
+  (test* "instructions" #t (> (stat 'instructions) 0))
+  (test* "instruction-counts" #t
+         (= (stat 'instructions)
+            (apply + (hash-table-values (stat 'instruction-counts)))))
+  (test* "not counting" (stat 'calls)
+         (begin (fact 10) (stat 'calls)))
+  (vm-reset-stats!)
+  (test* "reset" '(0 0 0)
+         (list (stat 'calls) (stat 'instructions)
+               (stat 'continuation-captures)))
+  (test* "stack grows on demand" '(100000 #t)
+         (let* ([before (stat 'stack-size)]
+                [r (let loop ([n 100000])
+                     (if (= n 0) 0 (+ 1 (loop (- n 1)))))])
+           (list r (<= before (stat 'stack-size)))))
+  (test* "stack-size" 10000
+         (stat 'stack-size))
+  )
+
+;;-------------------------------------------------------------------
+(test-section "profiler output")
+
+(use gauche.vm.profiler)
+
+(test* "profiler-write-folded" "a;b 3\n(c d) 1\n"
+       (with-output-to-string
+         (^[] (profiler-write-folded (current-output-port)
+                                     '(((a b) . 3) (((c d)) . 1))))))
+(test* "profiler-write-pprof" '(#x0a 4 8 1 #x10 2)
+       (let1 in (open-input-string
+                 (with-output-to-string
+                   (^[] (profiler-write-pprof (current-output-port)
+                                              '(((a b) . 3))))))
+         (list-tabulate 6 (^_ (read-byte in)))))
+(test* "profiler-show-load-stats"
+       '("    4000     300     800    2900       0        7 a.scm"
+         "    1000     200     200     400     200        3 b.scm"
+         "    5000       10 a.scm"
+         "    1000        3   b.scm"
+         "     200        2     [dso] b.so")
+       ($ filter #/(scm|so)$/
+          $ string-split (with-output-to-string
+                           (^[] (profiler-show-load-stats
+                                 (reverse
+                                  '(#(load "a.scm" 0 0 0 0 #f)
+                                    #(load "b.scm" 1000000 100 0 100000 #t)
+                                    #(dso "b.so" 1500000 200 0 100000 #f)
+                                    #(end #f 1700000 2248 0 100000 #f)
+                                    #(end #f 2000000 3172 200000 300000 #f)
+                                    #(end #f 5000000 10340 500000 1000000 #f))))))
+          #\newline))
+;; profiler isn't supported on Windows
+(cond-expand
+ [gauche.os.windows]
+ [else
+  (test* "stack sampling" #t
+         (let ()
+           (define (loop n) (if (= n 0) 0 (+ 1 (loop (- n 1)))))
+           (profiler-reset)
+           (profiler-start :stack-depth 8)
+           (dotimes [i 200] (loop 1000))
+           (profiler-stop)
+           (rlet1 r (list? (profiler-get-stacks))
+             (profiler-reset))))
+  (test* "allocation sampling" #t
+         (let ()
+           (define (alloc n) (if (= n 0) '() (cons (make-list 10) (alloc (- n 1)))))
+           (profiler-reset)
+           (profiler-start :allocation-interval 1024)
+           (dotimes [i 100] (alloc 100))
+           (profiler-stop)
+           (rlet1 r (> (apply + (map cddr (profiler-get-allocation-result))) 0)
+             (profiler-reset))))])
+
+;;-------------------------------------------------------------------
+(test-section "gc pause statistics")
+
+(let ()
+  (define (stat key) (cadr (assq key (gc-stat))))
+  (gc-reset-pause-stats!)
+  (gc)
+  (gc)
+  (test* "pause-count" #t (>= (stat :pause-count) 2))
+  (test* "histogram" (stat :pause-count)
+         (apply + (map cdr (gc-pause-histogram))))
+  (test* "log" #t
+         (let1 log (gc-pause-log)
+           (and (>= (length log) 2)
+                (every (^e (and (get-keyword :full e)
+                                (>= (get-keyword :duration e)
+                                    (get-keyword :pause e))
+                                (> (get-keyword :heap-size e) 0)))
+                       log))))
+  (test* "log order" #t
+         (apply < (map (cut get-keyword :gc-count <>) (gc-pause-log))))
+  (gc-reset-pause-stats!)
+  (test* "reset" '(0 ()) (list (stat :pause-count) (gc-pause-log)))
+
+  (let1 d (stat :free-space-divisor)
+    (gc-configure! :free-space-divisor (+ d 1))
+    (test* "free-space-divisor" (+ d 1) (stat :free-space-divisor))
+    (gc-configure! :free-space-divisor d))
+  (test* "gc-configure! type check" (test-error)
+         (gc-configure! :full-frequency -1))
+  )
+
+;;-------------------------------------------------------------------
+(test-section "allocation arena")
+
+(test* "outside of arena" #f (current-allocation-arena))
+(test* "arena allocation" '(#t #t 100)
+       (with-allocation-arena
+        (^[] (let* ([a (current-allocation-arena)]
+                    [s (make-string 100 #\a)])
+               (list (is-a? a <allocation-arena>)
+                     (> (cadr (allocation-arena-stats a)) 0)
+                     (string-length s))))))
+(test* "arena left" #f (current-allocation-arena))
+(test* "copy out" '("abcd" 4.5 #("12345" 1.25) (2.5 . "xy"))
+       (let1 r (with-allocation-arena
+                (^[] (list (string-append "ab" "cd")
+                           (* 1.5 (exact->inexact 3))
+                           (vector (number->string 12345) (/ 5.0 4))
+                           (cons (+ 1.0 1.5) (string #\x #\y)))))
+         (gc)
+         r))
+(test* "multiple values" '("a1" 2.0)
+       (receive r (with-allocation-arena
+                   (^[] (values (string-append "a" "1") (+ 1.0 1.0))))
+         r))
+(test* "nested arena" '(#t #t #t)
+       (with-allocation-arena
+        (^[] (let1 outer (current-allocation-arena)
+               (list (with-allocation-arena
+                      (^[] (not (eq? outer (current-allocation-arena)))))
+                     (eq? outer (current-allocation-arena))
+                     (equal? (string-append "p" "q") "pq"))))))
+(test* "escape without copying out" "hello, world"
+       (let1 escaped #f
+         (with-allocation-arena
+          (^[] (set! escaped (string-append "hello, " "world")))
+          :copy-out #f)
+         (with-allocation-arena
+          (^[] (dotimes [i 1000] (string-append "garbage" "garbage"))))
+         (gc)
+         escaped))
+(test* "non-local exit" #f
+       (begin
+         (guard (e [else #t])
+           (with-allocation-arena (^[] (error "oops"))))
+         (current-allocation-arena)))
+
+;;-------------------------------------------------------------------
+(test-section "benchmark results")
+
+(use gauche.time)
+
+(let ()
+  (define (results . rates)
+    (read-benchmark-results
+     (open-input-string
+      (write-to-string
+       `(benchmark-results
+         (config 10)
+         (results ,@(map (^[k r] `(,k (count 10) (real 1.0) (user ,(/ 10 r))
+                                      (sys 0)))
+                         '(a b c) rates)))))))
+  (define r1 (run-benchmark-suite 3 `((x . ,(^[] #t)) (y . ,(^[] #f)))
+                                  :only (cut eq? 'x <>) :progress #f))
+  (test* "run-benchmark-suite" '(3 (x . 3))
+         (cons (car r1) (map (^p (cons (car p) (~ (cdr p)'count))) (cdr r1))))
+  (test* "write/read-benchmark-results" '(3 (x 3 #t))
+         (let1 r2 (read-benchmark-results
+                   (open-input-string
+                    (with-output-to-string (cut write-benchmark-results r1))))
+           (cons (car r2)
+                 (map (^[p q] (list (car p) (~ (cdr p)'count)
+                                    (= (~ (cdr p)'user) (~ (cdr q)'user))))
+                      (cdr r2) (cdr r1)))))
+  (test* "compare-benchmark-results"
+         '((a same) (b regressed) (d new) (c missing))
+         (map (^c (take c 2))
+              (compare-benchmark-results
+               (results 100 100 100)
+               (cons 10 (list (car (cdr (results 95)))
+                              (cons 'b (cdr (cadr (cdr (results 100 50)))))
+                              (cons 'd (cdr (car (cdr (results 1))))))))))
+  (test* "compare-benchmark-results tolerance" '(improved)
+         (map cadr (compare-benchmark-results (results 100) (results 106)
+                                              :tolerance 0.05)))
+  (test* "report-benchmark-comparison" '(1 "  a:  0.500 regressed\n")
+         (let* ([out (open-output-string)]
+                [n (report-benchmark-comparison
+                    (compare-benchmark-results (results 100) (results 50))
+                    out)])
+           (list n (get-output-string out))))
+  )
+
 (test-end)
 
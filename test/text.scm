@@ -50,6 +50,72 @@
        (eof-object?
         (call-with-input-string "" (make-csv-reader #\,))))
 
+(test* "csv-reader (tab, crlf)" '(("a b" "" "c") ("d" "e\tf"))
+       (call-with-input-string "a b\t\t c \r\nd\t\"e\tf\" x\r\n"
+         (^p (let1 r (make-csv-reader #\tab)
+               (let* ([a (r p)] [b (r p)])
+                 (and (eof-object? (r p)) (list a b)))))))
+
+(test* "csv-reader (no quote)" '("\"a" "b\"\"")
+       (call-with-input-string "\"a,b\"\"" (make-csv-reader #\, #f)))
+
+(cond-expand
+ [gauche.ces.utf8
+  (test* "csv-reader (multibyte)" '("\u3042" "\u3044 \u3046" "x")
+         (call-with-input-string "\u3000\u3042\u3000,\u3044 \u3046\u00a0,x"
+           (make-csv-reader #\,)))]
+ [else])
+
+(test* "csv-reader leaves the rest" '(("a" "b") 2 "rest")
+       (call-with-input-string "a,b\nrest\n"
+         (^p (let1 r ((make-csv-reader #\,) p)
+               (list r (port-current-line p) (read-line p))))))
+
+(let1 data (string-join (map (^i (format "~a,\"~a~a\", ~a ,~a" i
+                                         (make-string (* i 7) #\x) "\"\"" i
+                                         (if (odd? i) "y" "z")))
+                             (iota 500))
+                        "\n" 'suffix)
+  (with-output-to-file "test.o" (cut display data))
+  (test* "csv-reader (file port)"
+         (call-with-input-string data
+           (^p (port->list (make-csv-reader #\,) p)))
+         (call-with-input-file "test.o"
+           (^p (port->list (make-csv-reader #\,) p))))
+  (test* "csv-reader (pool)" '(#t #f)
+         (let1 rows (call-with-input-file "test.o"
+                      (^p (port->list (make-csv-reader #\, #\" #t) p)))
+           (list (eq? (list-ref (list-ref rows 1) 3)
+                      (list-ref (list-ref rows 3) 3))
+                 (eq? (list-ref (list-ref rows 1) 3)
+                      (list-ref (list-ref rows 2) 3)))))
+  (sys-unlink "test.o"))
+
+(test* "csv-read-columns"
+       '(#(a b a) #s32(1 -2 300) #f64(1.5 -0.25 100.0) #(1/2 #f 3)
+         #("x y" "" "z"))
+       (call-with-input-string
+           "a, 1 ,1.5,1/2,\"x y\",extra\nb,-2,-25e-2,no,\na,300,1e2,3,z\n"
+         (^p (csv-read-columns #\, (list <symbol> <s32vector> <f64vector>
+                                        <number> <string>)
+                               p))))
+
+(test* "csv-read-columns (skip)" '(#u8(1 2))
+       (call-with-input-string "x,1\ny,2"
+         (^p (csv-read-columns #\, (list #f <u8vector>) p))))
+
+(test* "csv-read-columns (out of range)" (test-error)
+       (call-with-input-string "1\n256\n"
+         (^p (csv-read-columns #\, (list <u8vector>) p))))
+
+(test* "csv-read-columns (not a number)" (test-error)
+       (call-with-input-string "1\nfoo\n"
+         (^p (csv-read-columns #\, (list <s64vector>) p))))
+
+(test* "csv-read-columns (short record)" (test-error)
+       (call-with-input-string "1,2\n3\n"
+         (^p (csv-read-columns #\, (list <string> <string>) p))))
+
 (test* "csv-writer"
        "abc,def,123,\"what's up?\",\"he said, \"\"nothing new.\"\"\"\n"
        (call-with-output-string
@@ -139,6 +205,7 @@
 (test-section "diff")
 (use text.diff)
 (use srfi-13)
+(use gauche.generator)
 (test-module 'text.diff)
 
 (define diff-a "foo
@@ -169,6 +236,40 @@ fuga
        (with-output-to-string
          (lambda () (diff-report diff-a diff-b))))
 
+(test* "diff :algorithm patience"
+       '(((- 2 "bar")) ((- 4 "baz") (+ 3 "fuga")) ((+ 5 "fuga")))
+       (diff diff-a diff-b :algorithm 'patience))
+
+(test* "diff-hunk-generator"
+       '((1 5 1 5 (#f . "bar") (- . "bar") (#f . "baz") (- . "baz")
+                  (+ . "fuga") (#f . "hoge") (+ . "fuga")))
+       (generator->list (diff-hunk-generator diff-a diff-b :context 1)))
+
+(test* "diff-hunk-generator :context 0"
+       '((2 1 2 0 (- . "bar"))
+         (4 1 3 1 (- . "baz") (+ . "fuga"))
+         (6 0 5 1 (+ . "fuga")))
+       (generator->list (diff-hunk-generator diff-a diff-b :context 0)))
+
+(test* "diff-hunk-generator (no change)" '()
+       (generator->list (diff-hunk-generator diff-a diff-a)))
+
+(test* "write-diff-hunk"
+       "@@ -3 +2,0 @@\n-bar\n@@ -5 +4 @@\n-baz\n+fuga\n@@ -6,0 +6 @@\n+fuga\n"
+       (with-output-to-string
+         (^[] (generator-for-each write-diff-hunk
+                                  (diff-hunk-generator diff-a diff-b
+                                                       :context 0)))))
+
+(let* ([a (map (^i (format "line ~d" i)) (iota 1000))]
+       [b (map (^i (if (memv i '(10 500)) "changed" (format "line ~d" i)))
+               (iota 1000))]
+       [text (^[ls] (string-join ls "\n" 'suffix))])
+  (test* "diff-hunk-generator (large)"
+         '((7 7 7 7) (497 7 497 7))
+         (map (^h (take h 4))
+              (generator->list (diff-hunk-generator (text a) (text b))))))
+
 ;;-------------------------------------------------------------------
 (test-section "gap-buffer")
 (use text.gap-buffer)
@@ -634,6 +735,31 @@ fuga
 (test* "tree->string"
        (if (symbol? :b) "A:b" "Ab") ; transient during symbol-keyword integration
        (tree->string '(|A| . :b)))
+(test* "tree->string" "1a2.5#\\c" (tree->string '(1 "a" (2.5 . #\c))))
+
+(define-class <tree-leaf> () ((n :init-keyword :n)))
+(define-method write-tree ((x <tree-leaf>) out)
+  (format out "<~a>" (~ x'n)))
+
+(test* "write-tree custom leaf" "a<1>b<2>c"
+       (tree->string `("a" ,(make <tree-leaf> :n 1)
+                       ("b" (,(make <tree-leaf> :n 2)) . "c"))))
+(test* "write-tree deep nesting" (make-string 10000 #\x)
+       (tree->string (fold (^[_ t] (list t "x")) '() (iota 10000))))
+(test* "write-tree deep nesting (car)" (make-string 10000 #\x)
+       (tree->string (fold (^[_ t] (cons "x" (list t))) '() (iota 10000))))
+(let* ([leaves (map (^i (number->string i)) (iota 20000))]
+       [expected (apply string-append leaves)])
+  (test* "write-tree many leaves" expected (tree->string leaves))
+  (test* "write-tree to file" expected
+         (begin
+           (call-with-output-file "test.o" (cut write-tree leaves <>))
+           (begin0 (call-with-input-file "test.o" port->string)
+                   (sys-unlink "test.o")))))
+
+(test* "tree-size" 0 (tree-size '()))
+(test* "tree-size" 6 (tree-size '("ab" (cd . ef))))
+(test* "tree-size" 8 (tree-size `("\u00e9" 12 ,(make <tree-leaf> :n 3) . x)))
 
 ;;-------------------------------------------------------------------
 (test-section "unicode.ucd")
@@ -91,6 +91,8 @@
 (do-tree-map (cut make-tree-map = <))
 (do-tree-map (cut make-tree-map (^[a b] (cond [(< a b) -1][(= a b) 0][else 1]))))
 (do-tree-map (cut make-tree-map))
+(do-tree-map (cut make-tree-map/btree = <))
+(do-tree-map (cut make-tree-map/btree))
 
 ;; Min, max, iterators
 (let ((empty (make-tree-map = <))
@@ -446,5 +448,135 @@
          (tree-map-put! tmap 3 'z))
   )
 
+(let ([tmap (make-tree-map string-comparator)]
+      [tmap2 (make-tree-map (make-comparator string? string=? string<? #f))])
+  (test* "built-in comparator" '(("a" . 1) ("b" . 2) ("c" . 3))
+         (begin
+           (dolist [p '(("c" . 3) ("a" . 1) ("b" . 2))]
+             (tree-map-put! tmap (car p) (cdr p))
+             (tree-map-put! tmap2 (car p) (cdr p)))
+           (tree-map->alist tmap)))
+  (test* "srfi-128 comparator with string<?" (tree-map->alist tmap)
+         (tree-map->alist tmap2))
+  (test* "built-in comparator error check" (test-error)
+         (tree-map-put! tmap2 'd 4))
+  )
+
+;; B+-tree.  We use enough entries to make the tree a few levels deep,
+;; so that node splits, borrowing and merging are all exercised.
+(let ([tree (make-tree-map/btree = <)]
+      [ref (make-hash-table 'eqv?)]
+      [seed 1])
+  (define (rand n)
+    (set! seed (modulo (+ (* seed 1103515245) 12345) 2147483648))
+    (modulo (quotient seed 65536) n))
+  (define (ref-keys) (sort (hash-table-keys ref)))
+  (define (c msg)
+    (test* #"btree consistency (~msg)" #t
+           (begin (%tree-map-check-consistency tree)
+                  (and (= (tree-map-num-entries tree) (hash-table-num-entries ref))
+                       (equal? (tree-map-keys tree) (ref-keys))))))
+
+  (test* "btree kind error" (test-error) (%make-tree-map default-comparator 'foo))
+
+  (dotimes [i 3000]
+    (let1 k (rand 2000)
+      (tree-map-put! tree k (* k 2))
+      (hash-table-put! ref k (* k 2))))
+  (c "insert")
+  (dotimes [i 2000]
+    (let1 k (rand 2000)
+      (tree-map-delete! tree k)
+      (hash-table-delete! ref k)))
+  (c "delete")
+
+  (test* "btree get" #t
+         (every (^k (eqv? (tree-map-get tree k #f) (hash-table-get ref k #f)))
+                (iota 2000)))
+  (test* "btree closest entries" #t
+         (let1 ks (ref-keys)
+           (every (^k (let ([lo (find-tail (cut > k <>) (reverse ks))]
+                            [hi (find-tail (cut < k <>) ks)])
+                        (and (equal? (tree-map-floor-key tree (- k 1/2))
+                                     (and lo (car lo)))
+                             (equal? (tree-map-ceiling-key tree (+ k 1/2))
+                                     (and hi (car hi))))))
+                  (iota 2000))))
+  (test* "btree fold-right" (ref-keys)
+         (tree-map-fold-right tree (^[k v s] (cons k s)) '()))
+
+  (test* "btree copy" #t
+         (let1 new (tree-map-copy tree)
+           (tree-map-put! new -1 -1)
+           (%tree-map-check-consistency new)
+           (and (equal? (tree-map->alist new)
+                        (cons '(-1 . -1) (tree-map->alist tree)))
+                (not (tree-map-exists? tree -1)))))
+
+  (test* "btree pop-min!/pop-max!" #t
+         (let loop ([ks (ref-keys)])
+           (cond [(null? ks) (tree-map-empty? tree)]
+                 [(null? (cdr ks))
+                  (and (equal? (tree-map-pop-min! tree) (cons (car ks) (* (car ks) 2)))
+                       (loop '()))]
+                 [else
+                  (let ([lo (tree-map-pop-min! tree)]
+                        [hi (tree-map-pop-max! tree)])
+                    (and (eqv? (car lo) (car ks))
+                         (eqv? (car hi) (last ks))
+                         (begin (%tree-map-check-consistency tree) #t)
+                         (loop (drop-right (cdr ks) 1))))])))
+  )
+
+;; Order statistics
+(define (test-order-statistics name ctor)
+  (let ([tree (ctor)]
+        [seed 7])
+    (define (rand n)
+      (set! seed (modulo (+ (* seed 1103515245) 12345) 2147483648))
+      (modulo (quotient seed 65536) n))
+    (define (sel k) (values-ref (tree-map-select tree k) 0))
+    (define (check msg)
+      (test* #"~name order statistics (~msg)" #t
+             (let1 ks (tree-map-keys tree)
+               (%tree-map-check-consistency tree)
+               (and (every (^[k i] (and (= (tree-map-rank tree k) i)
+                                        (= (tree-map-rank tree (+ k 1/2)) (+ i 1))
+                                        (eqv? (sel i) k)))
+                           ks (iota (length ks)))
+                    (not (sel (length ks)))
+                    (not (sel -1))))))
+
+    (test* #"~name rank of empty tree" 0 (tree-map-rank tree 0))
+    (test* #"~name select of empty tree" '(x y)
+           (values->list (tree-map-select tree 0 'x 'y)))
+    (dotimes [i 1000]
+      (let1 k (rand 500) (tree-map-put! tree k (- k))))
+    (check "insert")
+    (dotimes [i 300]
+      (tree-map-delete! tree (rand 500)))
+    (tree-map-pop-min! tree)
+    (tree-map-pop-max! tree)
+    (check "delete")
+    (test* #"~name select value" #t
+           (receive (k v) (tree-map-select tree 10) (= k (- v))))
+    (test* #"~name count-range" #t
+           (let1 ks (tree-map-keys tree)
+             (every (^[lo hi]
+                      (= (tree-map-count-range tree lo hi)
+                         (count (^k (and (<= lo k) (< k hi))) ks)))
+                    '(0 -10 100 250 499 300)
+                    '(500 10 200 250 600 100))))
+    (test* #"~name rank after copy" #t
+           (let1 new (tree-map-copy tree)
+             (tree-map-put! new -1 -1)
+             (%tree-map-check-consistency new)
+             (and (= (tree-map-rank new 1000) (+ (tree-map-rank tree 1000) 1))
+                  (eqv? (values-ref (tree-map-select new 0) 0) -1))))
+    ))
+
+(test-order-statistics "red-black" (cut make-tree-map = <))
+(test-order-statistics "btree" (cut make-tree-map/btree = <))
+
 (test-end)
 
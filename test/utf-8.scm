@@ -89,6 +89,34 @@
   (test-string-scan #f "あえいうえおあおあいうえお" "おい")
   )
 
+;; Long multibyte strings use the character index.  Make sure it agrees
+;; with sequential access, including the positions around the index
+;; boundaries.
+(let* ([chars (list-tabulate 1000 (^i (if (zero? (modulo i 7))
+                                        (integer->char (+ 97 (modulo i 26)))
+                                        (integer->char (+ #x3042 (modulo i 80))))))]
+       [str (list->string chars)]
+       [vec (list->vector chars)])
+  (test "string-ref (long)" #t
+        (lambda ()
+          (every (^i (eqv? (string-ref str i) (vector-ref vec i)))
+                 (iota 1000))))
+  (test "string-ref (long, backward)" #t
+        (lambda ()
+          (every (^i (eqv? (string-ref str i) (vector-ref vec i)))
+                 (reverse (iota 1000)))))
+  (test "substring (long)" #t
+        (lambda ()
+          (every (^[s e] (equal? (substring str s e)
+                                 (list->string (take (drop chars s) (- e s)))))
+                 '(0 63 64 65 127 128 300 999 0   500)
+                 '(1 64 65 200 128 900 301 1000 1000 500))))
+  (test "string-copy (long)" (vector-ref vec 700)
+        (lambda () (string-ref (string-copy str) 700)))
+  (test "make-string-pointer (long)" (vector-ref vec 640)
+        (lambda () (string-pointer-next! (make-string-pointer str 128 512))))
+  )
+
 ;;-------------------------------------------------------------------
 (test-section "string-pointer")
 (define sp #f)
@@ -165,6 +193,31 @@
 (test "string-incomplete->complete (replace)" "あいうふふ"
       (lambda () (string-incomplete->complete #*"あいう\xe3\x80" #\ふ)))
 
+;; Character counting skips ASCII runs a word at a time; check the
+;; boundaries around the word size.
+(test "string-incomplete->complete (ascii runs)"
+      (map (^n (+ n 3)) (iota 20))
+      (lambda ()
+        (map (^n (string-length
+                  (string-incomplete->complete
+                   (string-append #*"\xe3\x81\x82" (make-string n #\a)
+                                  #*"\xe3\x81\x84" #*"x"))))
+             (iota 20))))
+(test "string-incomplete->complete (ascii runs, reject)"
+      (make-list 20 #f)
+      (lambda ()
+        (map (^n (string-incomplete->complete
+                  (string-append (make-string n #\a) #*"\xe3\x81"
+                                 (make-string n #\b))
+                  #f))
+             (iota 20))))
+(test "string-incomplete->complete (ascii runs, truncated)"
+      (make-list 20 #f)
+      (lambda ()
+        (map (^n (string-incomplete->complete
+                  (string-append (make-string n #\a) #*"\xe3\x81") #f))
+             (iota 20))))
+
 (test "string=?" #t (lambda () (string=? #*"あいう" #*"あいう")))
 
 (test "string-byte-ref" #x81 (lambda () (string-byte-ref #*"あいう" 1)))
@@ -209,6 +262,13 @@
 (test "string-every" #t (lambda () (string-every (^x (char-ci=? x #\あ)) "ああああ")))
 (test "string-every" #f (lambda () (string-every (^x (char-ci=? x #\あ)) "あいあい")))
 
+(test "string-index" 3 (lambda () (string-index "すきーむ" #[ま-ん])))
+(test "string-index" 3 (lambda () (string-index "すaきーむ" #[ア-ンー])))
+(test "string-index" #f (lambda () (string-index "すきーむ" #[ア-ン] 1)))
+(test "string-index" 3 (lambda () (string-index "abcあいa" #[^a-z] 1)))
+(test "string-skip" 4 (lambda () (string-skip "あいうえaお" #[あ-ん])))
+(test "string-skip" #f (lambda () (string-skip "あいうえaお" #[あ-んa] 2)))
+
 (test "string-any" #t (lambda () (string-any #\あ "ああああ")))
 (test "string-any" #f (lambda () (string-any #\あ "いうえお")))
 (test "string-any" #f (lambda () (string-any #\あ "")))
@@ -443,6 +443,39 @@
        '(((+ 1 b)))
        (lcs-edit-list '(a) '(a b)))
 
+(test* "lcs-matches" '((0 . 0) (2 . 1))
+       (lcs-matches '(a b c) '(a c)))
+(test* "lcs-matches (vector)" '((1 . 0) (2 . 1))
+       (lcs-matches '#("a" "b" "c") '#("b" "c") string=?))
+(test* "lcs (comparator)" '(b c)
+       (lcs '(a b c) '(b c) eq-comparator))
+(test* "lcs (unhashable equality)" '("a" "B" "c")
+       (lcs '("a" "B" "c") '("A" "b" "C" "d") (^[x y] (string-ci=? x y))))
+
+(let ([a '(f < x > g < y > h < z >)]
+      [b '(g < y > f < x > h < z >)])
+  (test* "lcs myers" '(f < x > h < z >) (lcs a b eq? 'myers))
+  (test* "lcs patience" '(g < y > h < z >) (lcs a b eq? 'patience))
+  (test* "lcs patience edit-list"
+         '(((- 0 f) (- 1 <) (- 2 x) (- 3 >)) ((+ 3 >) (+ 4 f) (+ 5 <) (+ 6 x)))
+         (lcs-edit-list a b eq? 'patience)))
+
+(test* "lcs patience (mislead)"
+       '(6 ((a 0 0) (x 1 4) (b 2 5) (y 3 6) (c 4 7) (z 5 8)))
+       (lcs-with-positions '(a x b y c z p d q) '(a b c a x b y c z)
+                           eqv? 'patience))
+(test* "lcs patience (unhashable)" (test-error)
+       (lcs '(a) '(a) (^[x y] (eq? x y)) 'patience))
+(test* "lcs bad algorithm" (test-error)
+       (lcs '(a) '(a) eq? 'hirschberg))
+
+(let* ([a (iota 20000)]
+       [b (map (^i (if (zero? (modulo i 100)) (- i) i)) a)])
+  (test* "lcs (large)" (- 20000 199)
+         (length (lcs a b eqv?)))
+  (test* "lcs (large, patience)" (- 20000 199)
+         (length (lcs a b eqv? 'patience))))
+
 ;;-----------------------------------------------
 (test-section "util.rbtree")
 (use util.rbtree)
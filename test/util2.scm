@@ -52,5 +52,45 @@
   (test-algo "Restricted edit" re-distances caddr)
   (test-algo "Damerau-Levenshtein" dl-distances cadddr))
 
+(use srfi-27)
+;; Levenshtein distance is computed natively unless elt= is an unknown
+;; procedure; compare both paths.
+(let ()
+  (define (generic=? a b) (eqv? a b))
+  (define (random-string len)
+    (list->string (map (^_ (integer->char (+ 97 (random-integer 4))))
+                       (iota len))))
+  (define (mutate s)
+    (let1 cs (string->list s)
+      (list->string
+       (append-map (^c (case (random-integer 8)
+                         [(0) '()]
+                         [(1) (list #\z c)]
+                         [(2) (list #\y)]
+                         [else (list c)]))
+                   cs))))
+  (dolist [len '(5 63 64 65 130)]
+    (let* ([a (random-string len)]
+           [bs (map (^_ (mutate a)) (iota 10))])
+      (test* #"Levenshtein native vs generic (length ~len)"
+             (l-distances a bs :elt= generic=?)
+             (l-distances a bs))
+      (test* #"Levenshtein native vs generic (length ~len, cutoff 5)"
+             (l-distances a bs :elt= generic=? :cutoff 5)
+             (l-distances a bs :cutoff 5))))
+
+  (test* "Levenshtein (lists)" '(1 2 0)
+         (l-distances '(a b c) '((a c) (c b) (a b c))))
+  (test* "Levenshtein (vector vs list)" 1
+         (l-distance '#("a" "b") '("a" "c") :elt= equal?))
+  (cond-expand
+   [gauche.ces.none]
+   [else
+    (test* "Levenshtein (multibyte)" 1
+           (l-distance "\u3044\u308d\u306f" "\u3044\u308d\u306b"))])
+  (test* "Levenshtein (char-ci=?)" 0
+         (l-distance "abc" "ABC" :elt= char-ci=?))
+  )
+
 
 (test-end)
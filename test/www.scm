@@ -377,6 +377,207 @@ Content-Disposition: form-data; name=bbb
 
 (run-css-parser-test)
 
+;;------------------------------------------------
+(test-section "www.httpd")
+(use www.httpd)
+(test-module 'www.httpd)
+
+(cond-expand
+ [gauche.sys.threads
+  (use gauche.threads)
+  (use gauche.net)
+  (use gauche.uvector)
+  (use rfc.http)
+
+  (define (httpd-test-handler req)
+    (define body (httpd-request-body req))
+    (cond
+     [(equal? (httpd-request-path req) "/echo")
+      (values 200 '(("content-type" "text/plain"))
+              (format "~a ~a ~a" (httpd-request-method req)
+                      (or (httpd-request-query req) "")
+                      (if body (u8vector->string body) "")))]
+     [(equal? (httpd-request-path req) "/stream")
+      (values 200 '(("content-type" "text/plain"))
+              (^[send] (send "ab") (send "") (send "cde")))]
+     [(equal? (httpd-request-path req) "/peer")
+      (values 200 '()
+              (number->string
+               (sockaddr-port (httpd-request-remote-address req))))]
+     [else (values 404 '() "not found")]))
+
+  (define (raw-request port data)
+    (let1 s (make-client-socket 'inet "127.0.0.1" port)
+      (display data (socket-output-port s))
+      (flush (socket-output-port s))
+      (begin0 (port->string (socket-input-port s))
+        (socket-close s))))
+
+  (define (httpd-tests workers)
+    (define httpd (make-httpd httpd-test-handler :host "127.0.0.1" :port 0
+                              :workers workers))
+    (define port (httpd-port (httpd-listen! httpd)))
+    (define server #"127.0.0.1:~port")
+    (define pool (make-http-connection-pool))
+    (define (body-of . args)
+      (values-ref (apply http-request args) 2))
+    (define th (thread-start! (make-thread (cut httpd-start! httpd))))
+
+    (test* #"get (~workers)" "GET x=1 " (body-of 'GET server "/echo?x=1"))
+    (test* #"post (~workers)" "POST  data"
+           (body-of 'POST server "/echo" :sender (http-string-sender "data")))
+    (test* #"head (~workers)" '("200" #f)
+           (receive (code headers body) (http-request 'HEAD server "/echo")
+             (list code body)))
+    (test* #"not found (~workers)" "404"
+           (values-ref (http-request 'GET server "/nothing") 0))
+    (test* #"streaming response (~workers)" '("chunked" "abcde")
+           (receive (code headers body) (http-request 'GET server "/stream")
+             (list (rfc822-header-ref headers "transfer-encoding") body)))
+    (test* #"keep-alive (~workers)" #t
+           (let* ([a (body-of 'GET server "/peer" :pool pool)]
+                  [b (body-of 'GET server "/peer" :pool pool)])
+             (equal? a b)))
+    (http-connection-pool-clear! pool)
+    (test* #"pipelining (~workers)"
+           (string-append
+            "HTTP/1.1 200 OK\r\ncontent-type: text/plain\r\n"
+            "content-length: 6\r\n\r\nGET a "
+            "HTTP/1.1 200 OK\r\ncontent-type: text/plain\r\n"
+            "content-length: 6\r\nConnection: close\r\n\r\nGET b ")
+           (raw-request port
+                        (string-append
+                         "GET /echo?a HTTP/1.1\r\nHost: x\r\n\r\n"
+                         "GET /echo?b HTTP/1.1\r\nHost: x\r\n"
+                         "Connection: close\r\n\r\n")))
+    (test* #"chunked request (~workers)" #t
+           (boolean
+            (#/\r\n\r\nPOST  abcde$/
+             (raw-request port
+                          (string-append
+                           "POST /echo HTTP/1.1\r\nHost: x\r\n"
+                           "Transfer-Encoding: chunked\r\n"
+                           "Connection: close\r\n\r\n"
+                           "3\r\nabc\r\n2;x=y\r\nde\r\n0\r\n\r\n")))))
+    (test* #"HTTP/1.0 (~workers)" '(#t #t)
+           (let1 r (raw-request port "GET /echo HTTP/1.0\r\n\r\n")
+             (list (boolean (#/^HTTP\/1\.1 200 OK\r\n/ r))
+                   (boolean (#/Connection: close\r\n\r\nGET  $/ r)))))
+    (test* #"bad request (~workers)" #t
+           (boolean
+            (#/^HTTP\/1\.1 400 Bad Request\r\n/
+             (raw-request port "garbage\r\n\r\n"))))
+
+    (httpd-stop! httpd)
+    (thread-join! th))
+
+  (httpd-tests 0)
+  (httpd-tests 2)]
+ [else])
+
+(test-section "www.cgi.server")
+(use www.cgi.server)
+(test-module 'www.cgi.server)
+
+(cond-expand
+ [(and gauche.sys.threads (not gauche.os.windows))
+  (use gauche.threads)
+  (use gauche.net)
+  (use gauche.uvector)
+  (use binary.io)
+
+  (define (cgi-server-test-handler params)
+    `(,(cgi-header :content-type "text/plain")
+      ,(cgi-get-parameter "a" params :default "-")
+      ,(or (cgi-get-metavariable "X_ONLY_ONCE") "")))
+
+  (define (start-cgi-server protocol max-requests)
+    (when (file-exists? "sock.o") (sys-unlink "sock.o"))
+    (rlet1 th (thread-start!
+               (make-thread
+                (cut cgi-server-main cgi-server-test-handler
+                     :protocol protocol :path "sock.o"
+                     :max-requests max-requests)))
+      (let loop ([n 0])
+        (unless (or (file-exists? "sock.o") (> n 100))
+          (sys-nanosleep #e1e7)
+          (loop (+ n 1))))))
+
+  (define fcgi-write-record
+    (with-module www.cgi.server fcgi-write-record))
+  (define fcgi-read-record
+    (with-module www.cgi.server fcgi-read-record))
+  (define fcgi-encode-params
+    (with-module www.cgi.server fcgi-encode-params))
+  (define fcgi-decode-params
+    (with-module www.cgi.server fcgi-decode-params))
+
+  (define (fcgi-request in out id keep? params body)
+    (fcgi-write-record out 1 id (u8vector 0 1 (if keep? 1 0) 0 0 0 0 0))
+    (fcgi-write-record out 4 id (fcgi-encode-params params))
+    (fcgi-write-record out 4 id (u8vector))
+    (unless (equal? body "")
+      (fcgi-write-record out 5 id (string->u8vector body)))
+    (fcgi-write-record out 5 id (u8vector))
+    (flush out)
+    ;; Returns stdout content and (app-status protocol-status)
+    (let loop ([r '()])
+      (receive (type rid content) (fcgi-read-record in)
+        (cond [(not type) (list (u8vector->string (apply u8vector-append
+                                                         (reverse r)))
+                                'eof)]
+              [(= type 6) (loop (cons content r))]
+              [(= type 3)
+               (list (u8vector->string (apply u8vector-append (reverse r)))
+                     (list (get-u32be content 0) (u8vector-ref content 4)))]
+              [else (loop r)]))))
+
+  (let* ([th (start-cgi-server 'fastcgi 2)]
+         [s (make-client-socket 'unix "sock.o")]
+         [in (socket-input-port s)]
+         [out (socket-output-port s)])
+    (test* "fastcgi get-values" '(("FCGI_MPXS_CONNS" "0"))
+           (begin
+             (fcgi-write-record out 9 0
+                                (fcgi-encode-params '(("FCGI_MPXS_CONNS" "")
+                                                      ("X_UNKNOWN" ""))))
+             (flush out)
+             (receive (type id content) (fcgi-read-record in)
+               (and (= type 10) (fcgi-decode-params content)))))
+    (test* "fastcgi GET" '("Content-type: text/plain\r\n\r\n1yes" (0 0))
+           (fcgi-request in out 1 #t
+                         '(("REQUEST_METHOD" "GET")
+                           ("QUERY_STRING" "a=1")
+                           ("X_ONLY_ONCE" "yes"))
+                         ""))
+    (test* "fastcgi POST" `(,(string-append "Content-type: text/plain\r\n\r\n"
+                                            (make-string 1000 #\x))
+                            (0 0))
+           (fcgi-request in out 2 #f
+                         '(("REQUEST_METHOD" "POST")
+                           ("CONTENT_TYPE"
+                            "application/x-www-form-urlencoded")
+                           ("CONTENT_LENGTH" "1002"))
+                         (string-append "a=" (make-string 1000 #\x))))
+    (socket-close s)
+    (test* "fastcgi max-requests" 0 (thread-join! th 10)))
+
+  (let* ([th (start-cgi-server 'scgi 1)]
+         [s (make-client-socket 'unix "sock.o")]
+         [headers "CONTENT_LENGTH\x00;3\x00;REQUEST_METHOD\x00;POST\x00;\
+                   CONTENT_TYPE\x00;application/x-www-form-urlencoded\x00;"])
+    (test* "scgi" "Content-type: text/plain\r\n\r\n3"
+           (begin
+             (display (string-append
+                       (number->string (string-length headers))
+                       ":" headers ",a=3")
+                      (socket-output-port s))
+             (flush (socket-output-port s))
+             (port->string (socket-input-port s))))
+    (socket-close s)
+    (test* "scgi max-requests" 0 (thread-join! th 10)))]
+ [else])
+
 (test-end)
 
 